@@ -0,0 +1,558 @@
+/**
+ * @file asr_submit.cc
+ * @brief 批量语音识别提交：按真实协议把录好的语句尽快送进语音服务，收集 stt 结果和耗时，用于服务端回归测试
+ * @description 用法：linx_asr_submit <ws_url> <语句.opus|语句.wav|目录>... [选项]
+ *                --sessions N   并行会话（连接）数，每路会话依次提交多条语句（默认 4）
+ *                --pace X       发送节奏：1 为实时（默认），X 为 X 倍速，0 为不限速（发送队列有空位就发）
+ *                --window N     不限速时发送队列中最多积压的帧数（默认 32）
+ *                --repeat R     每条语句提交 R 遍（默认 1）
+ *                --timeout MS   等待服务器 hello、stt 的超时（默认 15000）
+ *                --wait-tts     收到 stt 后等服务器把回复播完（tts stop）再提交下一条；默认发送 abort 立即进入下一条
+ *                --token T      Authorization 令牌（默认 test-token）
+ *                --protocol V   二进制分帧版本 1~3（默认 1）
+ *                --low          WAV 输入按 20ms 帧编码（默认 60ms）
+ *                --json PATH    把每条语句的结果（文本和耗时）写入 JSON
+ *
+ *              .opus（Ogg/Opus）按文件中的包原样发送，帧长取自包本身；.wav 在启动时用一个编码器预先编码。
+ *              目录展开为其中的 *.opus 和 *.wav。每路会话是一个 WebSocketClient（共用一个 WebSocketManager 和服务线程），
+ *              按 hello -> listen start(manual) -> 发送语句 -> listen stop -> 等待 stt 的流程循环，会话状态由 SessionState 维护，
+ *              控制消息用 ControlWriter / ControlParser 收发，与 demo/linx.cc 的设备行为一致。
+ *              每条语句记录：发送耗时（第一帧到最后一帧入队）、收尾延迟（listen stop 到 stt）和总耗时（第一帧到 stt）。
+ */
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AudioProfile.h"
+#include "ControlMessage.h"
+#include "FileAudio.h"
+#include "Json.h"
+#include "LatencyHistogram.h"
+#include "Log.h"
+#include "OggOpus.h"
+#include "Opus.h"
+#include "SessionState.h"
+#include "WebSocketManager.h"
+#include "Websocket.h"
+
+using namespace linx;
+using json = nlohmann::json;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::atomic<bool> g_stop{false};
+
+void OnSignal(int) { g_stop = true; }
+
+uint64_t UsBetween(Clock::time_point from, Clock::time_point to) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(to - from).count());
+}
+
+struct Options {
+    std::string url;
+    std::vector<std::string> inputs;
+    int sessions = 4;
+    double pace = 1.0;
+    size_t window = 32;
+    int repeat = 1;
+    int timeout_ms = 15000;
+    bool wait_tts = false;
+    std::string token = "test-token";
+    int protocol = 1;
+    bool low = false;
+    std::string json_path;
+};
+
+// 预先读出（或编码）好的一条语句
+struct Utterance {
+    std::string path;
+    std::vector<std::vector<unsigned char>> packets;
+    std::vector<uint32_t> packet_us;  // 每个包的时长，决定发送节奏
+    uint64_t audio_us = 0;
+    int frame_ms = 60;                // hello 中的 frame_duration（第一个包的时长）
+};
+
+struct Result {
+    std::string path;
+    int session = 0;
+    bool ok = false;
+    std::string error;
+    std::string text;
+    uint64_t audio_us = 0;
+    uint64_t send_us = 0;   // 第一帧到最后一帧入队
+    uint64_t final_us = 0;  // listen stop 到 stt
+    uint64_t total_us = 0;  // 第一帧到 stt
+};
+
+// 一路会话：WebSocketClient 的回调在服务线程上更新状态，提交线程在条件变量上等待 hello / stt / tts stop
+class Submitter {
+public:
+    Submitter(int index, const Options& options, int frame_ms, std::shared_ptr<WebSocketManager> manager)
+        : index_(index), options_(options), frame_ms_(frame_ms), client_(options.url, std::move(manager)) {}
+
+    ~Submitter() = default;
+
+    Submitter(const Submitter&) = delete;
+    Submitter& operator=(const Submitter&) = delete;
+
+    void Start() {
+        // 本地管理的 MAC 地址（第一个字节 0x02），与 linx_loadgen 的编号方式一致
+        char mac[32];
+        std::snprintf(mac, sizeof(mac), "02:4c:ff:%02x:%02x:%02x", (index_ >> 16) & 0xff, (index_ >> 8) & 0xff,
+                      index_ & 0xff);
+        char client[32];
+        std::snprintf(client, sizeof(client), "linx-asr-submit-%06d", index_);
+        client_.SetWsHeaders({{"Authorization", "Bearer " + options_.token},
+                              {"Device-Id", mac},
+                              {"Client-Id", client},
+                              {"Protocol-Version", std::to_string(options_.protocol)}});
+        client_.SetBinaryProtocol(options_.protocol);
+        ReconnectPolicy reconnect;
+        reconnect.enabled = true;
+        client_.SetReconnectPolicy(reconnect);
+        client_.SetMaxSendQueue(std::max<size_t>(options_.window * 2, 64));
+        client_.SetOnOpenCallback([this]() -> std::string {
+            return std::string(hello_writer_.Hello(16000, 1, frame_ms_, options_.protocol));
+        });
+        client_.SetOnCloseCallback([this]() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            session_.SetListen(ListenState::Stop);
+            session_.SetSessionId({});
+            hello_ = false;
+            cv_.notify_all();
+        });
+        client_.SetOnMessageViewCallback([this](std::string_view message, bool binary) { OnMessage(message, binary); });
+        client_.start();
+    }
+
+    // 提交一条语句，失败（超时、断线）时 result->ok 为 false
+    void Submit(const Utterance& utterance, Result* result) {
+        result->path = utterance.path;
+        result->session = index_;
+        result->audio_us = utterance.audio_us;
+        std::string session_id;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!WaitLocked(lock, [this] { return hello_; })) {
+                result->error = "no hello from server";
+                return;
+            }
+            session_id = session_.SessionId();
+            stt_ = false;
+            stt_text_.clear();
+            listen_generation_ = session_.Generation();
+        }
+        session_.SetTts(TtsState::Idle);  // --wait-tts 等待的是本条语句之后的 tts stop
+        session_.SetListen(ListenState::Start);
+        client_.send_text(writer_.Listen(session_id, "start", "manual"));
+
+        Clock::time_point first = Clock::now();
+        uint64_t offset_us = 0;
+        for (size_t i = 0; i < utterance.packets.size(); ++i) {
+            if (options_.pace > 0) {
+                // 第 i 帧在其音频时间点（按倍速压缩）发出
+                std::this_thread::sleep_until(
+                    first + std::chrono::microseconds(static_cast<uint64_t>(offset_us / options_.pace)));
+            }
+            if (!SendPacket(utterance.packets[i])) {
+                result->error = g_stop ? "interrupted" : "send failed (disconnected)";
+                session_.SetListen(ListenState::Stop);
+                return;
+            }
+            offset_us += utterance.packet_us[i];
+        }
+        Clock::time_point last = Clock::now();
+        session_.SetListen(ListenState::Stop);
+        client_.send_text(writer_.Listen(session_id, "stop"));
+        result->send_us = UsBetween(first, last);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!WaitLocked(lock, [this] { return stt_ || !hello_; }) || !stt_) {
+            result->error = g_stop ? "interrupted" : (hello_ ? "stt timeout" : "disconnected before stt");
+            return;
+        }
+        result->ok = true;
+        result->text = stt_text_;
+        // stt 可能在 listen stop 之前到达（服务端 VAD 先判断出句尾），此时收尾延迟记 0
+        result->final_us = stt_time_ > last ? UsBetween(last, stt_time_) : 0;
+        result->total_us = UsBetween(first, stt_time_);
+        if (options_.wait_tts) {
+            // 等服务器把回复播完；回复不一定会来，超时不算失败
+            WaitLocked(lock, [this] { return session_.Tts() == TtsState::Stop || !hello_; });
+        } else {
+            // 回复可能还没开始，不看当前 TTS 状态，总是打断
+            lock.unlock();
+            client_.send_text(writer_.Abort(session_id));
+        }
+    }
+
+    const WebSocketClient& Client() const { return client_; }
+    uint64_t TtsBytes() const { return tts_bytes_.load(std::memory_order_relaxed); }
+
+private:
+    template <typename Predicate>
+    bool WaitLocked(std::unique_lock<std::mutex>& lock, Predicate predicate) {
+        return cv_.wait_for(lock, std::chrono::milliseconds(options_.timeout_ms),
+                            [&] { return g_stop.load() || predicate(); }) &&
+               !g_stop;
+    }
+
+    // 不限速时按发送队列深度限流；队列满（send_binary 返回 false）时稍后重试，断线时放弃
+    bool SendPacket(const std::vector<unsigned char>& packet) {
+        Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(options_.timeout_ms);
+        for (;;) {
+            if (g_stop || !client_.IsConnected()) {
+                return false;
+            }
+            if ((options_.pace > 0 || client_.SendQueueDepth() < options_.window) &&
+                client_.send_binary(packet.data(), packet.size())) {
+                return true;
+            }
+            if (Clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    }
+
+    // 服务线程
+    void OnMessage(std::string_view message, bool binary) {
+        if (binary) {
+            tts_bytes_.fetch_add(message.size(), std::memory_order_relaxed);
+            return;
+        }
+        ControlMessage control;
+        if (!parser_.Parse(message, &control)) {
+            WARN("session {}: malformed message", index_);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        switch (control.type) {
+            case ControlType::Hello:
+                session_.SetSessionId(control.session_id);
+                hello_ = true;
+                break;
+            case ControlType::Stt:
+                // 只取本次 listen start 之后、同一会话中的第一条识别结果
+                if (!stt_ && session_.Generation() == listen_generation_) {
+                    stt_ = true;
+                    stt_text_.assign(control.text.data(), control.text.size());
+                    stt_time_ = Clock::now();
+                }
+                break;
+            case ControlType::Tts: {
+                TtsState state;
+                if (ParseTtsState(control.state, &state)) {
+                    session_.SetTts(state);
+                }
+                break;
+            }
+            case ControlType::Goodbye:
+                session_.SetSessionId({});
+                hello_ = false;
+                break;
+            default:
+                break;
+        }
+        cv_.notify_all();
+    }
+
+    const int index_;
+    const Options& options_;
+    const int frame_ms_;
+    WebSocketClient client_;
+    SessionState session_;
+    ControlWriter writer_;        // 提交线程
+    ControlWriter hello_writer_;  // 服务线程（连接建立回调）
+    ControlParser parser_;        // 服务线程
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool hello_ = false;
+    bool stt_ = false;
+    std::string stt_text_;
+    Clock::time_point stt_time_;
+    uint64_t listen_generation_ = 0;
+    std::atomic<uint64_t> tts_bytes_{0};
+};
+
+bool EndsWith(const std::string& s, const char* suffix) {
+    size_t n = std::strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+bool Supported(const std::string& path) {
+    return EndsWith(path, ".opus") || EndsWith(path, ".ogg") || EndsWith(path, ".wav") || EndsWith(path, ".WAV");
+}
+
+// 目录展开为其中的语句文件（按名称排序，不递归），普通文件原样返回
+void CollectInputs(const std::string& path, std::vector<std::string>* inputs) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        inputs->push_back(path);
+        return;
+    }
+    DIR* dir = ::opendir(path.c_str());
+    if (dir == nullptr) {
+        ERROR("cannot open {}", path);
+        return;
+    }
+    std::vector<std::string> names;
+    while (struct dirent* entry = ::readdir(dir)) {
+        std::string name = entry->d_name;
+        if (Supported(name)) {
+            names.push_back(path + "/" + name);
+        }
+    }
+    ::closedir(dir);
+    std::sort(names.begin(), names.end());
+    inputs->insert(inputs->end(), names.begin(), names.end());
+}
+
+bool LoadOggOpus(const std::string& path, Utterance* utterance) {
+    OggOpusReader reader;
+    if (reader.open(path) != 0) {
+        return false;
+    }
+    std::string_view packet;
+    while (reader.readPacket(&packet)) {
+        int samples = opus_packet_get_nb_samples(reinterpret_cast<const unsigned char*>(packet.data()),
+                                                 static_cast<opus_int32>(packet.size()), 48000);
+        if (samples <= 0) {
+            WARN("{}: skipping an invalid packet", path);
+            continue;
+        }
+        utterance->packets.emplace_back(packet.begin(), packet.end());
+        utterance->packet_us.push_back(static_cast<uint32_t>(samples * 1000000ull / 48000));
+    }
+    if (!utterance->packet_us.empty()) {
+        utterance->frame_ms = static_cast<int>(utterance->packet_us.front() / 1000);
+    }
+    return true;
+}
+
+bool LoadWav(const std::string& path, const AudioProfile& profile, OpusEncoderCtx& encoder, Utterance* utterance) {
+    FileAudioConfig config;
+    config.capture_path = path;
+    config.realtime = false;
+    FileAudio audio(config);
+    audio.ApplyProfile(profile);
+    try {
+        audio.Init();
+    } catch (const std::exception& e) {
+        ERROR("{}", e.what());
+        return false;
+    }
+    encoder.Reset();
+    std::vector<short> pcm(profile.FrameSamples() * profile.channels);
+    std::vector<unsigned char> packet(4000);
+    while (!audio.CaptureDone()) {
+        audio.Read(pcm.data(), profile.FrameSamples());
+        int n = encoder.Encode(packet.data(), packet.size(), pcm.data(), profile.FrameSamples());
+        if (n > 0) {
+            utterance->packets.emplace_back(packet.begin(), packet.begin() + n);
+            utterance->packet_us.push_back(static_cast<uint32_t>(profile.frame_ms * 1000));
+        }
+    }
+    utterance->frame_ms = profile.frame_ms;
+    return true;
+}
+
+bool LoadUtterances(const std::vector<std::string>& paths, const AudioProfile& profile,
+                    std::vector<Utterance>* utterances) {
+    OpusEncoderCtx encoder(profile.sample_rate, profile.channels, OpusEncoderConfig::Preset("balanced"));
+    for (const auto& path : paths) {
+        Utterance utterance;
+        utterance.path = path;
+        bool ok = EndsWith(path, ".wav") || EndsWith(path, ".WAV") ? LoadWav(path, profile, encoder, &utterance)
+                                                                   : LoadOggOpus(path, &utterance);
+        if (!ok || utterance.packets.empty()) {
+            ERROR("cannot load {}", path);
+            return false;
+        }
+        for (uint32_t us : utterance.packet_us) {
+            utterance.audio_us += us;
+        }
+        utterances->push_back(std::move(utterance));
+    }
+    return true;
+}
+
+void PrintHistogram(const char* name, const LatencyHistogram& hist) {
+    LatencySummary s = hist.Summarize();
+    if (s.count == 0) {
+        std::printf("%-30s n=0\n", name);
+        return;
+    }
+    std::printf("%-30s n=%-6llu p50 %7.1fms  p90 %7.1fms  p99 %7.1fms  max %7.1fms\n", name,
+                static_cast<unsigned long long>(s.count), s.p50_us / 1000.0, s.p90_us / 1000.0, s.p99_us / 1000.0,
+                s.max_us / 1000.0);
+}
+
+json ResultToJson(const Result& r) {
+    return {{"path", r.path},         {"session", r.session},   {"ok", r.ok},
+            {"error", r.error},       {"text", r.text},         {"audio_us", r.audio_us},
+            {"send_us", r.send_us},   {"final_us", r.final_us}, {"total_us", r.total_us}};
+}
+
+void Usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s <ws_url> <utterance.opus|utterance.wav|dir>... [--sessions N] [--pace X] [--window N]\n"
+                 "          [--repeat R] [--timeout MS] [--wait-tts] [--token T] [--protocol V] [--low] [--json PATH]\n",
+                 argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--sessions" && has_value) {
+            options.sessions = std::atoi(argv[++i]);
+        } else if (arg == "--pace" && has_value) {
+            options.pace = std::atof(argv[++i]);
+        } else if (arg == "--window" && has_value) {
+            options.window = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--repeat" && has_value) {
+            options.repeat = std::atoi(argv[++i]);
+        } else if (arg == "--timeout" && has_value) {
+            options.timeout_ms = std::atoi(argv[++i]);
+        } else if (arg == "--wait-tts") {
+            options.wait_tts = true;
+        } else if (arg == "--token" && has_value) {
+            options.token = argv[++i];
+        } else if (arg == "--protocol" && has_value) {
+            options.protocol = std::atoi(argv[++i]);
+        } else if (arg == "--low") {
+            options.low = true;
+        } else if (arg == "--json" && has_value) {
+            options.json_path = argv[++i];
+        } else if (!arg.empty() && arg[0] == '-') {
+            Usage(argv[0]);
+            return 1;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() < 2 || options.sessions <= 0 || options.repeat <= 0 || options.pace < 0 ||
+        options.protocol < 1 || options.protocol > 3) {
+        Usage(argv[0]);
+        return 1;
+    }
+    options.url = positional[0];
+    for (size_t i = 1; i < positional.size(); ++i) {
+        CollectInputs(positional[i], &options.inputs);
+    }
+
+    lws_set_log_level(LLL_ERR | LLL_WARN, nullptr);
+    AudioProfile profile = AudioProfile::ForMode(options.low ? LatencyMode::Low : LatencyMode::Normal);
+    std::vector<Utterance> utterances;
+    if (options.inputs.empty() || !LoadUtterances(options.inputs, profile, &utterances)) {
+        return 1;
+    }
+
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+    auto manager = std::make_shared<WebSocketManager>();
+    std::vector<std::unique_ptr<Submitter>> submitters;
+    for (int i = 0; i < options.sessions; ++i) {
+        submitters.push_back(std::make_unique<Submitter>(i, options, utterances.front().frame_ms, manager));
+        submitters.back()->Start();
+    }
+
+    // 各会话线程依次领取下一条语句，一路会话一个线程：节奏等待和结果等待都在这里，服务线程只处理收发
+    size_t total = utterances.size() * static_cast<size_t>(options.repeat);
+    std::vector<Result> results(total);
+    std::atomic<size_t> next{0};
+    std::mutex print_mutex;
+    LatencyHistogram final_hist;
+    LatencyHistogram total_hist;
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> threads;
+    for (auto& submitter : submitters) {
+        threads.emplace_back([&, s = submitter.get()]() {
+            for (size_t i = next.fetch_add(1); i < total && !g_stop; i = next.fetch_add(1)) {
+                Result& result = results[i];
+                s->Submit(utterances[i % utterances.size()], &result);
+                if (result.ok) {
+                    final_hist.Record(result.final_us);
+                    total_hist.Record(result.total_us);
+                }
+                std::lock_guard<std::mutex> lock(print_mutex);
+                if (result.ok) {
+                    std::printf("ok    %6.2fs  send %7.1fms  final %7.1fms  %s  %s\n", result.audio_us / 1e6,
+                                result.send_us / 1000.0, result.final_us / 1000.0, result.path.c_str(),
+                                result.text.c_str());
+                } else {
+                    std::printf("fail  %6.2fs  %s  %s\n", result.audio_us / 1e6, result.path.c_str(),
+                                result.error.c_str());
+                }
+                std::fflush(stdout);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    uint64_t tts_bytes = 0;
+    uint64_t reconnects = 0;
+    for (const auto& submitter : submitters) {
+        tts_bytes += submitter->TtsBytes();
+        reconnects += submitter->Client().Reconnects();
+    }
+    submitters.clear();
+    manager->Stop();
+
+    size_t ok = 0;
+    uint64_t audio_us = 0;
+    for (const Result& result : results) {
+        ok += result.ok ? 1 : 0;
+        audio_us += result.ok ? result.audio_us : 0;
+    }
+    char pace[32] = "unthrottled";
+    if (options.pace > 0) {
+        std::snprintf(pace, sizeof(pace), "%gx", options.pace);
+    }
+    std::printf("%zu/%zu utterances recognised, %d sessions, %.1fs audio in %.1fs (%.1fx real time, pace %s)\n", ok,
+                total, options.sessions, audio_us / 1e6, elapsed, elapsed > 0 ? audio_us / 1e6 / elapsed : 0.0, pace);
+    std::printf("downlink %.1f KB, %llu reconnects\n", tts_bytes / 1024.0, static_cast<unsigned long long>(reconnects));
+    PrintHistogram("final (listen stop -> stt)", final_hist);
+    PrintHistogram("total (first frame -> stt)", total_hist);
+
+    if (!options.json_path.empty()) {
+        json out = json::array();
+        for (const Result& result : results) {
+            if (!result.path.empty()) {
+                out.push_back(ResultToJson(result));
+            }
+        }
+        std::ofstream file(options.json_path);
+        file << out.dump(2) << "\n";
+        if (!file) {
+            ERROR("cannot write {}", options.json_path);
+            return 1;
+        }
+    }
+    return ok == total ? 0 : 2;
+}
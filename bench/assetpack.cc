@@ -0,0 +1,124 @@
+/**
+ * @file assetpack.cc
+ * @brief 提示音资源包工具：把 WAV 或 Ogg/Opus 提示音打包成 AssetPack 映射文件，或列出已有资源包的内容
+ * @description 用法：linx_assetpack [--rate <Hz>] [--bitrate <bps>] <输出.pack> <名称>=<输入.wav|.opus> ...
+ *                    linx_assetpack --list <资源包>
+ *              WAV 先在进程内编码为 Ogg/Opus（默认 16kHz 单声道、20ms 帧、24kbps），.opus 文件直接取其中的包；
+ *              demo 通过 LINX_ASSET_PACK 加载，约定的名称为 startup、disconnected、network_error、wake
+ */
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "AssetPack.h"
+#include "AudioConvert.h"
+#include "OggOpus.h"
+
+using namespace linx;
+
+namespace {
+
+int Usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [--rate <hz>] [--bitrate <bps>] <out.pack> <name>=<input.wav|input.opus> ...\n"
+                 "       %s --list <pack>\n",
+                 argv0, argv0);
+    return 1;
+}
+
+int List(const std::string& path) {
+    AssetPack pack;
+    std::string error;
+    if (!pack.Open(path, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    for (size_t i = 0; i < pack.Count(); ++i) {
+        AssetClip clip = pack.Clip(i);
+        std::printf("%-20.*s %6ums %5zu packets %7zu bytes  %uHz/%dch\n", static_cast<int>(clip.name.size()),
+                    clip.name.data(), clip.duration_ms, clip.packets, clip.data_bytes, clip.input_rate,
+                    clip.channels);
+    }
+    return 0;
+}
+
+bool EndsWith(const std::string& text, const char* suffix) {
+    size_t n = strlen(suffix);
+    return text.size() >= n && text.compare(text.size() - n, n, suffix) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 3 && std::strcmp(argv[1], "--list") == 0) {
+        return List(argv[2]);
+    }
+    AudioConvertOptions options;
+    options.sampleRate = 16000;
+    int arg = 1;
+    for (; arg + 1 < argc && std::strncmp(argv[arg], "--", 2) == 0; arg += 2) {
+        if (std::strcmp(argv[arg], "--rate") == 0) {
+            options.sampleRate = static_cast<unsigned int>(std::atoi(argv[arg + 1]));
+        } else if (std::strcmp(argv[arg], "--bitrate") == 0) {
+            options.opus.bitrate = std::atoi(argv[arg + 1]);
+        } else {
+            return Usage(argv[0]);
+        }
+    }
+    if (argc - arg < 2) {
+        return Usage(argv[0]);
+    }
+    std::string output = argv[arg++];
+
+    AssetPackWriter writer;
+    std::string tmp = output + ".encode.opus";
+    for (; arg < argc; ++arg) {
+        std::string spec = argv[arg];
+        size_t eq = spec.find('=');
+        if (eq == std::string::npos || eq == 0) {
+            std::fprintf(stderr, "expected <name>=<file>, got '%s'\n", spec.c_str());
+            return 1;
+        }
+        std::string name = spec.substr(0, eq);
+        std::string input = spec.substr(eq + 1);
+        std::string opus_path = input;
+        if (!EndsWith(input, ".opus") && !EndsWith(input, ".ogg")) {
+            if (!wav2opus(tmp, input, options)) {
+                std::fprintf(stderr, "%s: cannot encode (16-bit PCM WAV expected)\n", input.c_str());
+                unlink(tmp.c_str());
+                return 1;
+            }
+            opus_path = tmp;
+        }
+        OggOpusReader reader;
+        if (reader.open(opus_path) != 0) {
+            std::fprintf(stderr, "%s: not an Ogg/Opus file\n", input.c_str());
+            unlink(tmp.c_str());
+            return 1;
+        }
+        std::vector<std::string> packets;
+        std::string_view packet;
+        while (reader.readPacket(&packet)) {
+            packets.emplace_back(packet);
+        }
+        const OggOpusInfo& info = reader.info();
+        bool added = writer.Add(name, info.channels, info.inputSampleRate, info.preSkip, packets);
+        reader.close();
+        unlink(tmp.c_str());
+        if (!added) {
+            std::fprintf(stderr, "%s: no valid Opus packets\n", input.c_str());
+            return 1;
+        }
+    }
+    std::string error;
+    if (!writer.Write(output, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    return List(output);
+}
@@ -0,0 +1,45 @@
+/**
+ * @file blackbox_export.cc
+ * @brief 音频黑匣子导出工具：把 AudioBlackBox 的映射文件导出为 Ogg/Opus
+ * @description 用法：linx_blackbox <blackbox.bin> [输出前缀]
+ *              写出 <前缀>-uplink.opus / <前缀>-downlink.opus（默认前缀为输入文件名去掉 .bin）。
+ *              文件可以在进程运行中或崩溃后读取；运行中的进程也可以用信号或指标端点的 blackbox 命令自行导出
+ */
+
+#include <cstdio>
+#include <string>
+
+#include "AudioBlackBox.h"
+
+using namespace linx;
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::fprintf(stderr, "usage: %s <blackbox.bin> [output-prefix]\n", argv[0]);
+        return 1;
+    }
+    std::string path = argv[1];
+    std::string prefix = argc == 3 ? argv[2] : path;
+    if (argc == 2 && prefix.size() > 4 && prefix.compare(prefix.size() - 4, 4, ".bin") == 0) {
+        prefix.resize(prefix.size() - 4);
+    }
+    BlackBoxDump dump;
+    std::string error;
+    if (!AudioBlackBox::Export(path, prefix, &dump, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    if (dump.files.empty()) {
+        std::fprintf(stderr, "%s: no packets recorded\n", path.c_str());
+        return 0;
+    }
+    const char* names[kBlackBoxStreams] = {"uplink", "downlink"};
+    for (size_t i = 0; i < kBlackBoxStreams; ++i) {
+        if (dump.packets[i] > 0) {
+            std::printf("%-8s %8llu packets %8.1fs  %s-%s.opus\n", names[i],
+                        static_cast<unsigned long long>(dump.packets[i]), dump.duration_s[i], prefix.c_str(),
+                        names[i]);
+        }
+    }
+    return 0;
+}
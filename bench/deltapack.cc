@@ -0,0 +1,391 @@
+/**
+ * @file deltapack.cc
+ * @brief 差分补丁工具：为两个固件镜像生成 DeltaUpdater 使用的 bsdiff 补丁，或在本机应用补丁做核对
+ * @description 用法：linx_deltapack diff <旧镜像> <新镜像> <补丁>
+ *                    linx_deltapack apply <旧镜像> <补丁> <输出>
+ *              diff 按 bsdiff 的算法（旧文件的后缀数组 + 近似匹配）生成 ENDSLEY/BSDIFF43 布局的未压缩补丁，
+ *              打印可以直接放进 OTA 响应 firmware.patch 的 JSON；补丁体大部分是 0，由 HTTP 服务器以
+ *              gzip / zstd 压缩传输（如预先压缩好 .gz 由 nginx gzip_static 发出）。
+ *              apply 用设备端同一个 DeltaPatchSink 按 64KB 的块应用补丁，核对生成结果与新镜像一致。
+ *              生成时需要约 旧镜像 × 16 字节的内存（后缀数组），只在构建服务器上运行
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "DeltaUpdate.h"
+
+using namespace linx;
+
+namespace {
+
+int Usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s diff <old> <new> <patch>\n"
+                 "       %s apply <old> <patch> <out>\n",
+                 argv0, argv0);
+    return 1;
+}
+
+bool ReadFile(const char* path, std::vector<uint8_t>* out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    out->assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+void PutOfft(std::string* out, int64_t value) {
+    uint64_t v = value < 0 ? static_cast<uint64_t>(-value) : static_cast<uint64_t>(value);
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; ++i) {
+        bytes[i] = static_cast<unsigned char>(v >> (8 * i));
+    }
+    if (value < 0) {
+        bytes[7] |= 0x80;
+    }
+    out->append(reinterpret_cast<const char*>(bytes), 8);
+}
+
+// Larsson-Sadakane 后缀排序（bsdiff 的 qsufsort）：I 为后缀数组，V 为各后缀的组号
+void Split(int64_t* I, int64_t* V, int64_t start, int64_t len, int64_t h) {
+    if (len < 16) {
+        int64_t j = 1;
+        for (int64_t k = start; k < start + len; k += j) {
+            j = 1;
+            int64_t x = V[I[k] + h];
+            for (int64_t i = 1; k + i < start + len; ++i) {
+                if (V[I[k + i] + h] < x) {
+                    x = V[I[k + i] + h];
+                    j = 0;
+                }
+                if (V[I[k + i] + h] == x) {
+                    std::swap(I[k + j], I[k + i]);
+                    ++j;
+                }
+            }
+            for (int64_t i = 0; i < j; ++i) {
+                V[I[k + i]] = k + j - 1;
+            }
+            if (j == 1) {
+                I[k] = -1;
+            }
+        }
+        return;
+    }
+    int64_t x = V[I[start + len / 2] + h];
+    int64_t jj = 0;
+    int64_t kk = 0;
+    for (int64_t i = start; i < start + len; ++i) {
+        if (V[I[i] + h] < x) {
+            ++jj;
+        }
+        if (V[I[i] + h] == x) {
+            ++kk;
+        }
+    }
+    jj += start;
+    kk += jj;
+    int64_t i = start;
+    int64_t j = 0;
+    int64_t k = 0;
+    while (i < jj) {
+        if (V[I[i] + h] < x) {
+            ++i;
+        } else if (V[I[i] + h] == x) {
+            std::swap(I[i], I[jj + j]);
+            ++j;
+        } else {
+            std::swap(I[i], I[kk + k]);
+            ++k;
+        }
+    }
+    while (jj + j < kk) {
+        if (V[I[jj + j] + h] == x) {
+            ++j;
+        } else {
+            std::swap(I[jj + j], I[kk + k]);
+            ++k;
+        }
+    }
+    if (jj > start) {
+        Split(I, V, start, jj - start, h);
+    }
+    for (i = 0; i < kk - jj; ++i) {
+        V[I[jj + i]] = kk - 1;
+    }
+    if (jj == kk - 1) {
+        I[jj] = -1;
+    }
+    if (start + len > kk) {
+        Split(I, V, kk, start + len - kk, h);
+    }
+}
+
+void SuffixSort(std::vector<int64_t>* suffixes, const uint8_t* old, int64_t size) {
+    std::vector<int64_t> groups(static_cast<size_t>(size) + 1);
+    suffixes->assign(static_cast<size_t>(size) + 1, 0);
+    int64_t* I = suffixes->data();
+    int64_t* V = groups.data();
+    int64_t buckets[256] = {};
+    for (int64_t i = 0; i < size; ++i) {
+        buckets[old[i]]++;
+    }
+    for (int i = 1; i < 256; ++i) {
+        buckets[i] += buckets[i - 1];
+    }
+    for (int i = 255; i > 0; --i) {
+        buckets[i] = buckets[i - 1];
+    }
+    buckets[0] = 0;
+    for (int64_t i = 0; i < size; ++i) {
+        I[++buckets[old[i]]] = i;
+    }
+    I[0] = size;
+    for (int64_t i = 0; i < size; ++i) {
+        V[i] = buckets[old[i]];
+    }
+    V[size] = 0;
+    for (int i = 1; i < 256; ++i) {
+        if (buckets[i] == buckets[i - 1] + 1) {
+            I[buckets[i]] = -1;
+        }
+    }
+    I[0] = -1;
+    for (int64_t h = 1; I[0] != -(size + 1); h += h) {
+        int64_t len = 0;
+        int64_t i = 0;
+        while (i < size + 1) {
+            if (I[i] < 0) {
+                len -= I[i];
+                i -= I[i];
+            } else {
+                if (len) {
+                    I[i - len] = -len;
+                }
+                len = V[I[i]] + 1 - i;
+                Split(I, V, i, len, h);
+                i += len;
+                len = 0;
+            }
+        }
+        if (len) {
+            I[i - len] = -len;
+        }
+    }
+    for (int64_t i = 0; i < size + 1; ++i) {
+        I[V[i]] = i;
+    }
+}
+
+int64_t MatchLen(const uint8_t* a, int64_t alen, const uint8_t* b, int64_t blen) {
+    int64_t i = 0;
+    while (i < alen && i < blen && a[i] == b[i]) {
+        ++i;
+    }
+    return i;
+}
+
+// 在后缀数组 [st, en] 中二分查找与 target 最长的公共前缀
+int64_t Search(const int64_t* I, const uint8_t* old, int64_t old_size, const uint8_t* target, int64_t target_size,
+               int64_t st, int64_t en, int64_t* pos) {
+    while (en - st >= 2) {
+        int64_t mid = st + (en - st) / 2;
+        if (memcmp(old + I[mid], target, static_cast<size_t>(std::min(old_size - I[mid], target_size))) < 0) {
+            st = mid;
+        } else {
+            en = mid;
+        }
+    }
+    int64_t x = MatchLen(old + I[st], old_size - I[st], target, target_size);
+    int64_t y = MatchLen(old + I[en], old_size - I[en], target, target_size);
+    if (x > y) {
+        *pos = I[st];
+        return x;
+    }
+    *pos = I[en];
+    return y;
+}
+
+// bsdiff：逐段找出旧文件中近似匹配的区域，写出控制三元组、差值和新增字节
+std::string Diff(const std::vector<uint8_t>& old_data, const std::vector<uint8_t>& new_data) {
+    const uint8_t* old = old_data.data();
+    const uint8_t* nw = new_data.data();
+    int64_t old_size = static_cast<int64_t>(old_data.size());
+    int64_t new_size = static_cast<int64_t>(new_data.size());
+    std::vector<int64_t> I;
+    SuffixSort(&I, old, old_size);
+
+    std::string patch(DeltaPatchSink::kMagic, 16);
+    PutOfft(&patch, new_size);
+    int64_t scan = 0;
+    int64_t len = 0;
+    int64_t pos = 0;
+    int64_t last_scan = 0;
+    int64_t last_pos = 0;
+    int64_t last_offset = 0;
+    while (scan < new_size) {
+        int64_t old_score = 0;
+        int64_t scsc = scan += len;
+        for (; scan < new_size; ++scan) {
+            len = Search(I.data(), old, old_size, nw + scan, new_size - scan, 0, old_size, &pos);
+            for (; scsc < scan + len; ++scsc) {
+                if (scsc + last_offset < old_size && old[scsc + last_offset] == nw[scsc]) {
+                    ++old_score;
+                }
+            }
+            if ((len == old_score && len != 0) || len > old_score + 8) {
+                break;
+            }
+            if (scan + last_offset < old_size && old[scan + last_offset] == nw[scan]) {
+                --old_score;
+            }
+        }
+        if (len == old_score && scan != new_size) {
+            continue;
+        }
+        // 向前延伸上一段匹配、向后延伸这一段匹配，重叠部分取得分最高的分界
+        int64_t s = 0;
+        int64_t best = 0;
+        int64_t lenf = 0;
+        for (int64_t i = 0; last_scan + i < scan && last_pos + i < old_size;) {
+            if (old[last_pos + i] == nw[last_scan + i]) {
+                ++s;
+            }
+            ++i;
+            if (s * 2 - i > best * 2 - lenf) {
+                best = s;
+                lenf = i;
+            }
+        }
+        int64_t lenb = 0;
+        if (scan < new_size) {
+            s = 0;
+            best = 0;
+            for (int64_t i = 1; scan >= last_scan + i && pos >= i; ++i) {
+                if (old[pos - i] == nw[scan - i]) {
+                    ++s;
+                }
+                if (s * 2 - i > best * 2 - lenb) {
+                    best = s;
+                    lenb = i;
+                }
+            }
+        }
+        if (last_scan + lenf > scan - lenb) {
+            int64_t overlap = (last_scan + lenf) - (scan - lenb);
+            s = 0;
+            best = 0;
+            int64_t lens = 0;
+            for (int64_t i = 0; i < overlap; ++i) {
+                if (nw[last_scan + lenf - overlap + i] == old[last_pos + lenf - overlap + i]) {
+                    ++s;
+                }
+                if (nw[scan - lenb + i] == old[pos - lenb + i]) {
+                    --s;
+                }
+                if (s > best) {
+                    best = s;
+                    lens = i + 1;
+                }
+            }
+            lenf += lens - overlap;
+            lenb -= lens;
+        }
+        int64_t extra = (scan - lenb) - (last_scan + lenf);
+        PutOfft(&patch, lenf);
+        PutOfft(&patch, extra);
+        PutOfft(&patch, (pos - lenb) - (last_pos + lenf));
+        for (int64_t i = 0; i < lenf; ++i) {
+            patch.push_back(static_cast<char>(nw[last_scan + i] - old[last_pos + i]));
+        }
+        patch.append(reinterpret_cast<const char*>(nw + last_scan + lenf), static_cast<size_t>(extra));
+        last_scan = scan - lenb;
+        last_pos = pos - lenb;
+        last_offset = pos - scan;
+    }
+    return patch;
+}
+
+std::string Sha256Of(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return std::string();
+    }
+    std::string hex = FileSha256(fd);
+    close(fd);
+    return hex;
+}
+
+int RunDiff(const char* old_path, const char* new_path, const char* patch_path) {
+    std::vector<uint8_t> old_data;
+    std::vector<uint8_t> new_data;
+    if (!ReadFile(old_path, &old_data) || !ReadFile(new_path, &new_data)) {
+        return 1;
+    }
+    std::string patch = Diff(old_data, new_data);
+    std::ofstream out(patch_path, std::ios::binary | std::ios::trunc);
+    if (!out.write(patch.data(), static_cast<std::streamsize>(patch.size())) || !out.flush()) {
+        std::fprintf(stderr, "cannot write %s\n", patch_path);
+        return 1;
+    }
+    out.close();
+    std::fprintf(stderr, "%zu -> %zu bytes, patch %zu bytes (%.1f%% of the new image, uncompressed)\n",
+                 old_data.size(), new_data.size(), patch.size(), new_data.empty() ? 0.0 : 100.0 * patch.size() / new_data.size());
+    std::printf("\"sha256\": \"%s\",\n\"patch\": {\"url\": \"<url>\", \"sha256\": \"%s\", \"base_sha256\": \"%s\"}\n",
+                Sha256Of(new_path).c_str(), Sha256Of(patch_path).c_str(), Sha256Of(old_path).c_str());
+    return 0;
+}
+
+int RunApply(const char* old_path, const char* patch_path, const char* out_path) {
+    int base_fd = open(old_path, O_RDONLY);
+    int patch_fd = open(patch_path, O_RDONLY);
+    int out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (base_fd < 0 || patch_fd < 0 || out_fd < 0) {
+        std::fprintf(stderr, "cannot open %s\n", base_fd < 0 ? old_path : patch_fd < 0 ? patch_path : out_path);
+        return 1;
+    }
+    off_t base_size = lseek(base_fd, 0, SEEK_END);
+    DeltaPatchSink sink(base_fd, static_cast<uint64_t>(base_size), out_fd);
+    char chunk[64 * 1024];
+    ssize_t n = 0;
+    bool ok = true;
+    while (ok && (n = read(patch_fd, chunk, sizeof(chunk))) > 0) {
+        ok = sink.Write(chunk, static_cast<size_t>(n));
+    }
+    ok = ok && n == 0 && sink.Finish();
+    close(base_fd);
+    close(patch_fd);
+    close(out_fd);
+    if (!ok) {
+        std::fprintf(stderr, "apply failed: %s\n", sink.Error().empty() ? "read error" : sink.Error().c_str());
+        return 1;
+    }
+    std::printf("%llu bytes (%llu from base, %llu literal), sha256 %s\n",
+                static_cast<unsigned long long>(sink.Written()), static_cast<unsigned long long>(sink.DiffBytes()),
+                static_cast<unsigned long long>(sink.ExtraBytes()), sink.Sha256().c_str());
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 5 && std::strcmp(argv[1], "diff") == 0) {
+        return RunDiff(argv[2], argv[3], argv[4]);
+    }
+    if (argc == 5 && std::strcmp(argv[1], "apply") == 0) {
+        return RunApply(argv[2], argv[3], argv[4]);
+    }
+    return Usage(argv[0]);
+}
@@ -0,0 +1,260 @@
+/**
+ * @file download_check.cc
+ * @brief Downloader 回归检查：本机起一个行为可控的 HTTP 服务器，逐个场景运行 Downloader 并核对结果
+ * @description 用法：linx_download_check [工作目录，默认 /tmp]
+ *              场景覆盖正常的 Range 分段、声明 Accept-Ranges 却忽略 Range（没有 ETag / Last-Modified，不发 If-Range）
+ *              时退回单个 GET 并按清单逐片比对、清单不符时失败，以及文件变化之后又遇到忽略 Range 的服务器时
+ *              单流重试不占用文件变化的重试机会。每个场景打印一行，全部通过时返回 0
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/evp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Downloader.h"
+
+using namespace linx;
+
+namespace {
+
+constexpr size_t kFileBytes = 300000;
+constexpr size_t kSegmentBytes = 64 * 1024;
+
+// 服务器行为：etag 为 true 时响应带强 ETag；honor_range 为 false 时对任何 GET 都返回 200 和整个文件。
+// change_after_get 为 true 时第一个 GET 之后切换为 etag = false、honor_range = false（模拟换了一台不支持 Range 的源站）
+struct ServerMode {
+    bool etag = false;
+    bool honor_range = true;
+    bool change_after_get = false;
+};
+
+class TestServer {
+public:
+    TestServer(const std::string& body, ServerMode mode) : body_(body), mode_(mode) {}
+    ~TestServer() { Stop(); }
+
+    bool Start() {
+        fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd_ < 0) {
+            return false;
+        }
+        int one = 1;
+        setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd_, 16) != 0 ||
+            getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+            return false;
+        }
+        port_ = ntohs(addr.sin_port);
+        accept_thread_ = std::thread([this]() { AcceptLoop(); });
+        return true;
+    }
+
+    void Stop() {
+        stop_ = true;
+        if (accept_thread_.joinable()) {
+            accept_thread_.join();
+        }
+        for (std::thread& thread : workers_) {
+            thread.join();
+        }
+        workers_.clear();
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    std::string Url() const { return "http://127.0.0.1:" + std::to_string(port_) + "/firmware.bin"; }
+    int RangedGets() const { return ranged_gets_; }
+    int WholeGets() const { return whole_gets_; }
+
+private:
+    void AcceptLoop() {
+        while (!stop_) {
+            pollfd pfd{fd_, POLLIN, 0};
+            if (poll(&pfd, 1, 50) <= 0) {
+                continue;
+            }
+            int client = accept(fd_, nullptr, nullptr);
+            if (client >= 0) {
+                workers_.emplace_back([this, client]() { Serve(client); });
+            }
+        }
+    }
+
+    // 每个连接只处理一个请求，响应带 Connection: close
+    void Serve(int client) {
+        std::string request;
+        char buffer[4096];
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                close(client);
+                return;
+            }
+            request.append(buffer, static_cast<size_t>(n));
+        }
+        bool head = request.compare(0, 5, "HEAD ") == 0;
+        unsigned long long first = 0;
+        unsigned long long last = 0;
+        bool ranged = false;
+        size_t range = request.find("\nRange: bytes=");
+        if (range != std::string::npos) {
+            ranged = std::sscanf(request.c_str() + range, "\nRange: bytes=%llu-%llu", &first, &last) == 2;
+        }
+
+        ServerMode mode;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            mode = mode_;
+            if (!head) {
+                (ranged ? ranged_gets_ : whole_gets_)++;
+                if (mode_.change_after_get) {
+                    mode_ = ServerMode{false, false, false};
+                }
+            }
+        }
+        bool partial = !head && ranged && mode.honor_range && first <= last && last < body_.size();
+        std::string header = partial ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+        header += "Accept-Ranges: bytes\r\nConnection: close\r\n";
+        if (mode.etag) {
+            header += "ETag: \"v1\"\r\n";
+        }
+        uint64_t offset = partial ? first : 0;
+        uint64_t length = partial ? last - first + 1 : body_.size();
+        if (partial) {
+            header += "Content-Range: bytes " + std::to_string(first) + "-" + std::to_string(last) + "/" +
+                      std::to_string(body_.size()) + "\r\n";
+        }
+        header += "Content-Length: " + std::to_string(length) + "\r\n\r\n";
+        if (!head) {
+            header.append(body_, offset, length);
+        }
+        // 客户端拒收 200 时会提前断开，写失败直接放弃
+        for (size_t sent = 0; sent < header.size();) {
+            ssize_t n = send(client, header.data() + sent, header.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                break;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        close(client);
+    }
+
+    const std::string& body_;
+    std::mutex mutex_;
+    ServerMode mode_;
+    int ranged_gets_ = 0;
+    int whole_gets_ = 0;
+    int fd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> stop_{false};
+    std::thread accept_thread_;
+    std::vector<std::thread> workers_;  // 只由 accept 线程追加，Stop 在它退出后再 join
+};
+
+std::string Sha256(const char* data, size_t len) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = 0;
+    EVP_Digest(data, len, digest, &digest_len, EVP_sha256(), nullptr);
+    static const char kHex[] = "0123456789abcdef";
+    std::string hex;
+    for (unsigned int i = 0; i < digest_len; ++i) {
+        hex += kHex[digest[i] >> 4];
+        hex += kHex[digest[i] & 0x0f];
+    }
+    return hex;
+}
+
+struct Case {
+    const char* name;
+    ServerMode mode;
+    bool corrupt_manifest;  // 清单最后一项写错，应当下载失败
+    bool expect_ok;
+    bool expect_whole_get;  // 最终应当退回单个整体 GET
+};
+
+bool RunCase(const Case& test, const std::string& body, const std::vector<std::string>& manifest,
+             const std::string& dir) {
+    TestServer server(body, test.mode);
+    if (!server.Start()) {
+        std::printf("FAIL %-28s cannot start the test server\n", test.name);
+        return false;
+    }
+    DownloadConfig config;
+    config.url = server.Url();
+    config.path = dir + "/linx_download_check.bin";
+    config.segment_bytes = kSegmentBytes;
+    config.retries = 0;
+    config.segment_sha256 = manifest;
+    if (test.corrupt_manifest) {
+        config.segment_sha256.back() = std::string(64, '0');
+    }
+    unlink(config.path.c_str());
+    unlink((config.path + ".part").c_str());
+    unlink((config.path + ".part.state").c_str());
+
+    Downloader downloader(config);
+    std::string error;
+    bool ok = downloader.Run(&error);
+    server.Stop();
+
+    std::string result;
+    if (ok) {
+        std::ifstream in(config.path, std::ios::binary);
+        result.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    bool pass = ok == test.expect_ok && (!ok || result == body) && (!test.expect_whole_get || server.WholeGets() > 0);
+    std::printf("%s %-28s ok=%d ranged_gets=%d whole_gets=%d%s%s\n", pass ? "PASS" : "FAIL", test.name, ok,
+                server.RangedGets(), server.WholeGets(), error.empty() ? "" : " error=", error.c_str());
+    unlink(config.path.c_str());
+    return pass;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string dir = argc > 1 ? argv[1] : "/tmp";
+    std::string body(kFileBytes, '\0');
+    uint32_t state = 0x12345678u;
+    for (char& c : body) {
+        state = state * 1664525u + 1013904223u;
+        c = static_cast<char>(state >> 24);
+    }
+    std::vector<std::string> manifest;
+    for (size_t offset = 0; offset < body.size(); offset += kSegmentBytes) {
+        manifest.push_back(Sha256(body.data() + offset, std::min(kSegmentBytes, body.size() - offset)));
+    }
+
+    const Case cases[] = {
+        {"ranged", ServerMode{false, true, false}, false, true, false},
+        {"range_ignored_manifest", ServerMode{false, false, false}, false, true, true},
+        {"range_ignored_bad_manifest", ServerMode{false, false, false}, true, false, true},
+        {"changed_then_range_ignored", ServerMode{true, false, true}, false, true, true},
+    };
+    int failures = 0;
+    for (const Case& test : cases) {
+        failures += RunCase(test, body, manifest, dir) ? 0 : 1;
+    }
+    std::printf("%d/%zu cases passed\n", static_cast<int>(std::size(cases)) - failures, std::size(cases));
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+/**
+ * @file footprint.cc
+ * @brief 体积与启动时间探针：同一份源码按组件组合编译成多个可执行文件，每个只链接自己用到的组件
+ * @description 用法：linx_footprint_<配置> [--startup N]
+ *              不带参数时构造一遍所选组件的代表对象（不联网、不打开声卡）后退出，确认链接和静态初始化正常；
+ *              --startup N 以 --exit 重复启动自身 N 次，报告从 posix_spawn 到子进程退出的耗时（动态加载、
+ *              重定位、静态初始化），--exit 进入 main 即返回。
+ *              编译时由 LINX_FOOTPRINT_<组件> 选择引用哪些组件，见 bench/CMakeLists.txt；footprint.sh 汇总各配置的
+ *              文件大小、段大小、依赖的共享库、重定位数与启动时间
+ */
+
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Metrics.h"
+#include "Reactor.h"
+#if defined(LINX_FOOTPRINT_DSP)
+#include "Resampler.h"
+#endif
+#if defined(LINX_FOOTPRINT_CODEC)
+#include "Opus.h"
+#endif
+#if defined(LINX_FOOTPRINT_AUDIO)
+#include "AudioInterface.h"
+#include "AudioPipeline.h"
+#endif
+#if defined(LINX_FOOTPRINT_WS)
+#include "Websocket.h"
+#endif
+#if defined(LINX_FOOTPRINT_HTTP)
+#include "HttpClient.h"
+#endif
+#if defined(LINX_FOOTPRINT_MQTT)
+#include "MqttClient.h"
+#endif
+#if defined(LINX_FOOTPRINT_UDP)
+#include "UdpAudioChannel.h"
+#endif
+
+extern char** environ;
+
+using namespace linx;
+
+namespace {
+
+// 每个组件构造一个代表对象，保证链接器把它和它的依赖带进来
+std::string Touch() {
+    std::string linked = "core";
+    MetricsRegistry registry;
+    registry.AddCounter("linx_footprint_total", "Footprint probe counter").Add(1);
+    Reactor reactor;
+#if defined(LINX_FOOTPRINT_DSP)
+    Resampler resampler(48000, 16000, 1);
+    linked += " dsp";
+#endif
+#if defined(LINX_FOOTPRINT_CODEC)
+    OpusEncoderCtx encoder(16000, 1);
+    linked += " codec";
+#endif
+#if defined(LINX_FOOTPRINT_AUDIO)
+    std::unique_ptr<AudioInterface> audio = CreateAudioInterface(AudioBackend::Null);
+    AudioPipeline pipeline;
+    linked += " audio";
+#endif
+#if defined(LINX_FOOTPRINT_WS)
+    WebSocketClient ws("ws://127.0.0.1:9/");
+    linked += " ws";
+#endif
+#if defined(LINX_FOOTPRINT_HTTP)
+    HttpClient http("http://127.0.0.1:9/");
+    linked += " http";
+#endif
+#if defined(LINX_FOOTPRINT_MQTT)
+    MqttConfig mqtt_config;
+    ParseMqttEndpoint("mqtt://127.0.0.1:9", &mqtt_config);
+    MqttClient mqtt(mqtt_config);
+    linked += " mqtt";
+#endif
+#if defined(LINX_FOOTPRINT_UDP)
+    UdpAudioChannel udp;
+    linked += " udp";
+#endif
+    return linked;
+}
+
+int Startup(const char* self, int runs) {
+    char exit_arg[] = "--exit";
+    char* argv[] = {const_cast<char*>(self), exit_arg, nullptr};
+    std::vector<double> us;
+    us.reserve(static_cast<size_t>(runs));
+    for (int i = 0; i < runs; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        pid_t pid = 0;
+        if (posix_spawn(&pid, self, nullptr, nullptr, argv, environ) != 0) {
+            std::perror("posix_spawn");
+            return 1;
+        }
+        int status = 0;
+        if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            std::fprintf(stderr, "child failed\n");
+            return 1;
+        }
+        us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(us.begin(), us.end());
+    std::printf("startup_us min %.0f p50 %.0f p90 %.0f (%d runs)\n", us.front(), us[us.size() / 2],
+                us[us.size() * 9 / 10], runs);
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 2 && std::strcmp(argv[1], "--exit") == 0) {
+        return 0;
+    }
+    if (argc == 3 && std::strcmp(argv[1], "--startup") == 0) {
+        int runs = std::atoi(argv[2]);
+        if (runs <= 0) {
+            std::fprintf(stderr, "usage: %s [--startup <runs>]\n", argv[0]);
+            return 1;
+        }
+        // 经 /proc/self/exe 启动，不受 PATH 和相对路径影响
+        return Startup("/proc/self/exe", runs);
+    }
+    if (argc != 1) {
+        std::fprintf(stderr, "usage: %s [--startup <runs>]\n", argv[0]);
+        return 1;
+    }
+    std::printf("linked: %s\n", Touch().c_str());
+    return 0;
+}
@@ -0,0 +1,45 @@
+#!/bin/sh
+# 体积与启动时间报告：汇总 LINX_BUILD_BENCH 构建出的 linx_footprint_* 探针（每个只链接一组组件）
+# 用法：bench/footprint.sh <构建目录> [启动次数，默认 200]
+#       每个探针一行：文件大小、strip 后大小、text/data/bss、依赖的共享库数、动态重定位数、启动耗时 p50/p90（微秒）；
+#       之后列出各探针依赖的共享库。比较不同配置时用发布构建（make release 的参数，或 -DCMAKE_BUILD_TYPE=Release），
+#       关闭部分组件的构建（如 -DLINX_WEBSOCKET=OFF -DLINX_HTTP=OFF）只有对应的探针
+set -e
+
+BUILD_DIR=${1:?usage: footprint.sh <build-dir> [startup-runs]}
+RUNS=${2:-200}
+BENCH_DIR=${BUILD_DIR}/bench
+PROBES=$(ls "${BENCH_DIR}"/linx_footprint_* 2>/dev/null || true)
+if [ -z "${PROBES}" ]; then
+    echo "footprint: no probes in ${BENCH_DIR}, configure with -DLINX_BUILD_BENCH=ON and build linx_footprint_*" >&2
+    exit 1
+fi
+
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "${WORK_DIR}"' EXIT
+
+printf '%-26s %10s %10s %10s %8s %8s %7s %7s %8s %8s\n' \
+    probe bytes stripped text data bss needed relocs p50_us p90_us
+for probe in ${PROBES}; do
+    name=$(basename "${probe}")
+    # 先跑一遍：构造所选组件的对象，顺便确认能启动
+    "${probe}" > /dev/null
+    bytes=$(wc -c < "${probe}")
+    strip -o "${WORK_DIR}/${name}" "${probe}"
+    stripped=$(wc -c < "${WORK_DIR}/${name}")
+    set -- $(size "${probe}" | tail -n 1)
+    text=$1 data=$2 bss=$3
+    readelf -d "${probe}" | sed -n 's/.*(NEEDED).*\[\(.*\)\]/\1/p' > "${WORK_DIR}/${name}.needed"
+    needed=$(wc -l < "${WORK_DIR}/${name}.needed")
+    # 可执行文件自身的动态重定位；加载器实际处理的总数（含各共享库）见 LD_DEBUG=statistics
+    relocs=$(readelf -r "${probe}" | grep -c '^[0-9a-f]\{8,\}' || true)
+    set -- $("${probe}" --startup "${RUNS}")
+    printf '%-26s %10s %10s %10s %8s %8s %7s %7s %8s %8s\n' \
+        "${name}" "${bytes}" "${stripped}" "${text}" "${data}" "${bss}" "${needed}" "${relocs}" "$5" "$7"
+done
+
+echo
+for probe in ${PROBES}; do
+    name=$(basename "${probe}")
+    echo "${name}: $(tr '\n' ' ' < "${WORK_DIR}/${name}.needed")"
+done
@@ -0,0 +1,636 @@
+/**
+ * @file linx_bench.cc
+ * @brief 每帧热路径微基准：Opus编解码、抖动缓冲区并发读写、WebSocket发送队列、控制消息JSON处理、DSP各级
+ * @description 用法：linx_bench [opus] [jitter] [ws] [json] [dsp]（不带参数时运行全部）
+ *              ws 项在本机启动一个 libwebsockets 服务端，端口由 LINX_BENCH_WS_PORT 指定（默认 17681）
+ *              各项输出每次操作耗时，基线结果见 bench/BASELINE.md
+ */
+
+#include <libwebsockets.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AutoGainController.h"
+#include "Beamformer.h"
+#include "ControlMessage.h"
+#include "FrameTrace.h"
+#include "JitterBuffer.h"
+#include "Json.h"
+#include "LatencyTracer.h"
+#include "Fft.h"
+#include "Log.h"
+#include "NoiseSuppressor.h"
+#include "Opus.h"
+#include "PcmKernels.h"
+#include "Resampler.h"
+#include "Vad.h"
+#include "Websocket.h"
+
+using namespace linx;
+
+namespace {
+
+constexpr unsigned int kSampleRate = 16000;
+
+volatile size_t g_sink = 0;  // 防止编译器优化掉结果
+
+using Clock = std::chrono::steady_clock;
+
+double ElapsedNs(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+template <typename Fn>
+double TimeNs(size_t iterations, Fn&& fn) {
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        fn(i);
+    }
+    return ElapsedNs(start) / iterations;
+}
+
+/**
+ * @brief 生成确定性的类语音测试信号
+ * @description 150Hz基频（带颤音）的前20次谐波叠加少量噪声，按4Hz音节包络调制，
+ *              让编码器走到与真实语音相近的码率和模式（纯正弦或白噪声都会偏离）
+ */
+std::vector<short> SpeechLikeSignal(size_t samples) {
+    std::vector<short> pcm(samples);
+    std::mt19937 rng(7);
+    std::normal_distribution<double> noise(0.0, 300.0);
+    double phase = 0;
+    for (size_t i = 0; i < samples; ++i) {
+        double t = static_cast<double>(i) / kSampleRate;
+        double f0 = 150.0 + 20.0 * std::sin(2 * M_PI * 0.7 * t);
+        phase += 2 * M_PI * f0 / kSampleRate;
+        double voiced = 0;
+        for (int h = 1; h <= 20; ++h) {
+            voiced += std::sin(h * phase) / h;
+        }
+        double envelope = 0.5 + 0.5 * std::sin(2 * M_PI * 4.0 * t);
+        double v = 6000.0 * envelope * voiced + noise(rng);
+        pcm[i] = static_cast<short>(std::max(-32768.0, std::min(32767.0, v)));
+    }
+    return pcm;
+}
+
+// ==================== Opus ====================
+
+void BenchOpus() {
+    const int kComplexities[] = {0, 2, 5, 8, 10};
+    const int kFrameMs[] = {10, 20, 40, 60};
+    std::vector<short> signal = SpeechLikeSignal(kSampleRate * 10);  // 10秒，循环使用
+    std::vector<unsigned char> packet(4000);
+
+    std::printf("[opus] %uHz mono, VOIP, 24kbps, speech-like input\n", kSampleRate);
+    std::printf("%-10s %-8s %12s %12s %10s %10s\n", "complexity", "frame", "encode us", "decode us", "bytes",
+                "cpu %");
+    for (int complexity : kComplexities) {
+        for (int frame_ms : kFrameMs) {
+            OpusEncoderConfig config = OpusEncoderConfig::Balanced();
+            config.complexity = complexity;
+            OpusAudio opus(kSampleRate, 1, config);
+            size_t frame = opus.FrameSamples(frame_ms);
+            size_t frames = signal.size() / frame;
+            size_t iterations = std::max<size_t>(200, 20000 / frame_ms);
+
+            // 先编码一遍得到解码输入，同时预热
+            std::vector<std::vector<unsigned char>> packets(frames);
+            size_t total_bytes = 0;
+            for (size_t i = 0; i < frames; ++i) {
+                int n = opus.Encode(packet.data(), packet.size(), signal.data() + i * frame, frame);
+                packets[i].assign(packet.begin(), packet.begin() + std::max(n, 0));
+                total_bytes += packets[i].size();
+            }
+
+            double encode_ns = TimeNs(iterations, [&](size_t i) {
+                g_sink = g_sink + opus.Encode(packet.data(), packet.size(), signal.data() + (i % frames) * frame, frame);
+            });
+            std::vector<short> pcm(opus.MaxFrameSamples());
+            double decode_ns = TimeNs(iterations, [&](size_t i) {
+                std::vector<unsigned char>& p = packets[i % frames];
+                g_sink = g_sink + opus.Decode(pcm.data(), pcm.size(), p.data(), p.size());
+            });
+
+            // 编解码一帧的耗时占帧时长的比例：单路实时处理需要的CPU
+            double cpu = (encode_ns + decode_ns) / (frame_ms * 1e6) * 100;
+            std::printf("%-10d %5dms %12.1f %12.1f %10zu %9.2f%%\n", complexity, frame_ms, encode_ns / 1000,
+                        decode_ns / 1000, total_bytes / frames, cpu);
+        }
+    }
+}
+
+// ==================== DSP ====================
+
+/**
+ * @brief 用户态 CPU 周期计数（perf_event_open），内核不允许或不支持时 Valid() 为 false，只输出耗时
+ */
+class CycleCounter {
+public:
+    CycleCounter() {
+#if defined(__linux__)
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+    ~CycleCounter() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+    bool Valid() const { return fd_ >= 0; }
+    uint64_t Read() const {
+        uint64_t value = 0;
+        if (fd_ < 0 || read(fd_, &value, sizeof(value)) != sizeof(value)) {
+            return 0;
+        }
+        return value;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+/**
+ * @brief 对一个每帧操作计时，输出 ns/帧 和 周期/帧
+ */
+template <typename Fn>
+void BenchDspStage(const CycleCounter& cycles, const char* name, size_t iterations, Fn&& fn) {
+    for (size_t i = 0; i < iterations / 10 + 1; ++i) {
+        fn(i);  // 预热
+    }
+    uint64_t start_cycles = cycles.Read();
+    double ns = TimeNs(iterations, fn);
+    uint64_t used = cycles.Read() - start_cycles;
+    if (cycles.Valid()) {
+        std::printf("%-24s %12.1f %14.0f\n", name, ns, static_cast<double>(used) / iterations);
+    } else {
+        std::printf("%-24s %12.1f %14s\n", name, ns, "-");
+    }
+}
+
+/**
+ * @brief 采集/播放链路各 DSP 级每 20ms 帧的开销
+ * @description 同一个二进制内对比浮点内核与 Q15 定点内核（gain/FIR 点积）；重采样、VAD 和 Opus
+ *              跟随构建方式（LINX_FIXED_POINT 与链接的 libopus），分别用浮点和定点构建各跑一次对比
+ */
+void BenchDsp() {
+    constexpr size_t kFrame = kSampleRate / 50;  // 20ms
+    constexpr size_t kTaps = 32;
+    const size_t iterations = 20000;
+    std::vector<short> signal = SpeechLikeSignal(kSampleRate * 3);
+    std::vector<short> other = SpeechLikeSignal(kSampleRate * 3 + 137);
+    std::vector<short> out(kFrame * 3);
+    CycleCounter cycles;
+#if defined(LINX_FIXED_POINT)
+    const char* build = "fixed";
+#else
+    const char* build = "float";
+#endif
+    std::printf("[dsp] %zu-sample frames (20ms@%uHz), %s build, kernels %s%s\n", kFrame, kSampleRate, build,
+                GetPcmKernels().name, cycles.Valid() ? "" : ", cycle counter unavailable");
+    std::printf("%-24s %12s %14s\n", "stage", "ns/frame", "cycles/frame");
+
+    auto frame_at = [&](const std::vector<short>& pcm, size_t i) { return pcm.data() + (i * kFrame) % (pcm.size() - kFrame * 3); };
+    const PcmKernels& k = GetPcmKernels();
+    int shift = 0;
+    int16_t mantissa = PcmGainToFixed(0.7f, &shift);
+    BenchDspStage(cycles, "gain f32", iterations, [&](size_t i) { k.gain(out.data(), frame_at(signal, i), kFrame, 0.7f); });
+    BenchDspStage(cycles, "gain q15", iterations,
+                  [&](size_t i) { k.gain_fixed(out.data(), frame_at(signal, i), kFrame, mantissa, shift); });
+    BenchDspStage(cycles, "mix s16", iterations,
+                  [&](size_t i) { k.mix(out.data(), frame_at(signal, i), frame_at(other, i), kFrame); });
+
+    // 32 抽头 FIR：每个输出样本一次点积（Resampler 每相位的工作量）
+    std::vector<float> taps_f32(kTaps, 1.0f / kTaps);
+    std::vector<short> taps_q15(kTaps, static_cast<short>(32768 / kTaps));
+    std::vector<float> signal_f32(signal.size());
+    PcmToFloat(signal_f32.data(), signal.data(), signal.size());
+    BenchDspStage(cycles, "fir32 f32", iterations / 4, [&](size_t i) {
+        const float* x = signal_f32.data() + (i * kFrame) % (signal.size() - kFrame * 3);
+        float sum = 0;
+        for (size_t n = 0; n < kFrame; ++n) {
+            sum += k.dot(taps_f32.data(), x + n, kTaps);
+        }
+        g_sink = g_sink + static_cast<size_t>(sum);
+    });
+    BenchDspStage(cycles, "fir32 q15", iterations / 4, [&](size_t i) {
+        const short* x = frame_at(signal, i);
+        int32_t sum = 0;
+        for (size_t n = 0; n < kFrame; ++n) {
+            sum += k.dot_s16(taps_q15.data(), x + n, kTaps) >> 15;
+        }
+        g_sink = g_sink + static_cast<size_t>(sum);
+    });
+
+    // 以下跟随构建方式
+    std::vector<short> signal48 = SpeechLikeSignal(kSampleRate * 9);  // 当作 48kHz 输入
+    Resampler down(48000, kSampleRate, 1, kFrame * 3);
+    Resampler up(kSampleRate, 48000, 1, kFrame);
+    std::vector<short> resampled(up.MaxOutputFrames(kFrame) + down.MaxOutputFrames(kFrame * 3));
+    BenchDspStage(cycles, "resample 48k->16k", iterations / 4, [&](size_t i) {
+        const short* x = signal48.data() + (i * kFrame * 3) % (signal48.size() - kFrame * 3);
+        g_sink = g_sink + down.Process(x, kFrame * 3, resampled.data(), resampled.size());
+    });
+    BenchDspStage(cycles, "resample 16k->48k", iterations / 4, [&](size_t i) {
+        g_sink = g_sink + up.Process(frame_at(signal, i), kFrame, resampled.data(), resampled.size());
+    });
+    EnergyVad vad;
+    BenchDspStage(cycles, "vad", iterations, [&](size_t i) { g_sink = g_sink + vad.IsSpeech(frame_at(signal, i), kFrame); });
+    // 同一 VAD 按编译期帧长特化（AudioFormat），对比运行时帧长的版本
+    FixedEnergyVad<Voice16kMono20ms> fixed_vad;
+    static_assert(Voice16kMono20ms::kFrameSamples == kFrame, "bench frame must match the specialized format");
+    BenchDspStage(cycles, "vad (fixed format)", iterations,
+                  [&](size_t i) { g_sink = g_sink + fixed_vad.IsSpeech(frame_at(signal, i), kFrame); });
+
+    // 降噪：512 点实数 FFT 一次，以及每帧两块（10ms）的完整处理
+    RealFft fft(512);
+    std::vector<float> spectrum_re(fft.Bins());
+    std::vector<float> spectrum_im(fft.Bins());
+    BenchDspStage(cycles, "fft 512 real", iterations, [&](size_t i) {
+        const float* x = signal_f32.data() + (i * kFrame) % (signal.size() - kFrame * 3);
+        fft.Forward(x, spectrum_re.data(), spectrum_im.data());
+        g_sink = g_sink + static_cast<size_t>(spectrum_re[1]);
+    });
+    NoiseSuppressorConfig ns_config;
+    ns_config.sample_rate = kSampleRate;
+    NoiseSuppressor ns(ns_config);
+    BenchDspStage(cycles, "noise suppress", iterations / 4,
+                  [&](size_t i) { ns.Process(frame_at(signal, i), out.data(), kFrame); });
+
+    // 4 麦圆阵波束形成（含方位估计）：同一段信号复制到 4 个声道
+    BeamformerConfig bf_config;
+    bf_config.sample_rate = kSampleRate;
+    bf_config.mics = Beamformer::CircularArray(4, 0.035f);
+    Beamformer beamformer(bf_config);
+    std::vector<short> array_frame(kFrame * 4);
+    BenchDspStage(cycles, "beamform 4ch", iterations / 4, [&](size_t i) {
+        const short* x = frame_at(signal, i);
+        for (size_t n = 0; n < kFrame; ++n) {
+            for (size_t c = 0; c < 4; ++c) {
+                array_frame[n * 4 + c] = x[n];
+            }
+        }
+        beamformer.Process(array_frame.data(), kFrame, out.data());
+    });
+
+    AutoGainController agc;
+    BenchDspStage(cycles, "agc", iterations, [&](size_t i) {
+        memcpy(out.data(), frame_at(signal, i), kFrame * sizeof(short));
+        agc.Process(out.data(), kFrame);
+    });
+
+    OpusAudio opus(kSampleRate, 1, OpusEncoderConfig::Balanced());
+    std::vector<unsigned char> packet(4000);
+    BenchDspStage(cycles, "opus encode", iterations / 20, [&](size_t i) {
+        g_sink = g_sink + opus.Encode(packet.data(), packet.size(), frame_at(signal, i), kFrame);
+    });
+    int encoded = opus.Encode(packet.data(), packet.size(), signal.data(), kFrame);
+    BenchDspStage(cycles, "opus decode", iterations / 20, [&](size_t) {
+        g_sink = g_sink + opus.Decode(out.data(), out.size(), packet.data(), static_cast<size_t>(std::max(encoded, 0)));
+    });
+}
+
+// ==================== 抖动缓冲区 ====================
+
+/**
+ * @brief 生产者（接收线程）和消费者（播放线程）同时满速读写一个抖动缓冲区
+ * @description 生产者按60ms一帧写入，缓冲区写不下一帧时让出CPU；消费者按16ms一个设备周期读取，
+ *              取不到数据时让出CPU。与demo中AudioBuffer的使用方式一致（条件变量唤醒除外）
+ * @param name 结果行的名称
+ * @param traced 接入延迟追踪
+ * @param frame_traced 接入帧追踪文件（每次 Push/Pop 一条记录）
+ */
+void BenchJitterOnce(const char* name, bool traced, bool frame_traced, size_t total_frames) {
+    constexpr size_t kFrame = 960;
+    constexpr size_t kPeriod = 256;
+    JitterBufferConfig config;
+    config.capacity_samples = 1 << 14;
+    JitterBuffer jitter(config);
+    if (traced) {
+        jitter.SetLatencyTracer(std::make_shared<LatencyTracer>());
+    }
+    if (frame_traced) {
+        FrameTraceConfig trace_config;
+        trace_config.path = "/tmp/linx_bench_trace.bin";
+        auto trace = std::make_shared<FrameTrace>(trace_config);
+        if (trace->Open()) {
+            jitter.SetFrameTrace(trace);
+        }
+    }
+    std::vector<short> frame = SpeechLikeSignal(kFrame);
+
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> push_ns{0};
+    size_t popped = 0;
+    uint64_t pops = 0;
+    double pop_ns = 0;
+    auto start = Clock::now();
+
+    std::thread producer([&] {
+        double ns = 0;
+        for (size_t i = 0; i < total_frames; ++i) {
+            while (config.capacity_samples - jitter.Depth() < kFrame) {
+                std::this_thread::yield();
+            }
+            auto t = Clock::now();
+            jitter.Push(frame.data(), kFrame);
+            ns += ElapsedNs(t);
+        }
+        jitter.MarkEndOfStream();
+        push_ns = static_cast<uint64_t>(ns);
+        done = true;
+    });
+
+    std::vector<short> out(kPeriod);
+    while (popped < total_frames * kFrame) {
+        auto t = Clock::now();
+        size_t n = jitter.Pop(out.data(), kPeriod);
+        if (n == 0) {
+            if (done && jitter.Depth() == 0) {
+                break;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+        pop_ns += ElapsedNs(t);
+        pops++;
+        popped += n;
+    }
+    producer.join();
+    double wall_ns = ElapsedNs(start);
+
+    JitterBufferStats stats = jitter.GetStats();
+    std::printf("%-8s %12.1f %12.1f %14.1f %10llu %10llu\n", name,
+                static_cast<double>(push_ns) / total_frames, pops ? pop_ns / pops : 0.0,
+                popped / (wall_ns / 1e9) / 1e6, static_cast<unsigned long long>(stats.underruns),
+                static_cast<unsigned long long>(stats.dropped_samples));
+}
+
+void BenchJitter() {
+    std::printf("[jitter] SPSC push 960 / pop 256 samples, producer and consumer threads\n");
+    std::printf("%-8s %12s %12s %14s %10s %10s\n", "tracer", "push ns", "pop ns", "Msamples/s", "underruns",
+                "dropped");
+    BenchJitterOnce("plain", false, false, 200000);
+    BenchJitterOnce("latency", true, false, 200000);
+    BenchJitterOnce("frame", false, true, 200000);
+}
+
+// ==================== WebSocket 发送队列 ====================
+
+std::atomic<uint64_t> g_server_frames{0};
+
+int ServerCallback(struct lws* wsi, enum lws_callback_reasons reason, void* user, void* in, size_t len) {
+    if (reason == LWS_CALLBACK_RECEIVE && lws_is_final_fragment(wsi)) {
+        g_server_frames.fetch_add(1, std::memory_order_relaxed);
+    }
+    return 0;
+}
+
+/**
+ * @brief 本机 libwebsockets 服务端：只接收并计数，协议名与 WebSocketClient 请求的一致
+ */
+class LoopbackServer {
+public:
+    bool Start(int port) {
+        protocols_[0] = {"websocket-protocol", ServerCallback, 0, 4096, 0, nullptr, 0};
+        protocols_[1] = {nullptr, nullptr, 0, 0, 0, nullptr, 0};
+        lws_context_creation_info info;
+        memset(&info, 0, sizeof(info));
+        info.port = port;
+        info.iface = "127.0.0.1";
+        info.protocols = protocols_;
+        info.gid = -1;
+        info.uid = -1;
+        context_ = lws_create_context(&info);
+        if (context_ == nullptr) {
+            return false;
+        }
+        running_ = true;
+        thread_ = std::thread([this] {
+            while (running_ && lws_service(context_, 0) >= 0) {
+            }
+        });
+        return true;
+    }
+
+    ~LoopbackServer() {
+        running_ = false;
+        if (context_) {
+            lws_cancel_service(context_);
+        }
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        if (context_) {
+            lws_context_destroy(context_);
+        }
+    }
+
+private:
+    lws_protocols protocols_[2];
+    lws_context* context_ = nullptr;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+};
+
+bool WaitFor(const std::function<bool()>& done, int timeout_ms) {
+    auto deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (!done()) {
+        if (Clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+/**
+ * @brief 一个模式：每次入队 burst 帧后等待全部写出
+ * @description burst=1 时测的是 入队->唤醒服务线程->lws_write 的单帧延迟；
+ *              burst 较大时测队列的批量吞吐（一次可写回调写出多帧）
+ */
+void BenchWsMode(const std::string& url, size_t burst, size_t total) {
+    WebSocketClient client(url);
+    client.SetMaxSendQueue(std::max<size_t>(burst, 256));
+    client.start();
+    if (!WaitFor([&] { return client.Connections() > 0; }, 3000)) {
+        std::printf("%-8zu connect failed\n", burst);
+        return;
+    }
+
+    std::vector<unsigned char> frame(120, 0x5a);  // 60ms@24kbps 的典型 Opus 包大小
+    double enqueue_ns = 0;
+    uint64_t base = g_server_frames.load();
+    auto start = Clock::now();
+    for (size_t sent = 0; sent < total; sent += burst) {
+        for (size_t i = 0; i < burst; ++i) {
+            auto t = Clock::now();
+            client.send_binary(frame.data(), frame.size());
+            enqueue_ns += ElapsedNs(t);
+        }
+        WaitFor([&] { return client.SendQueueDepth() == 0; }, 3000);
+    }
+    WaitFor([&] { return g_server_frames.load() - base >= total; }, 3000);
+    double wall_ns = ElapsedNs(start);
+
+    SendLatencyStats stats = client.GetSendLatencyStats();
+    std::printf("%-8zu %12.1f %12.1f %12.1f %12.0f %8llu\n", burst, enqueue_ns / total, stats.avg_us, stats.max_us,
+                total / (wall_ns / 1e9), static_cast<unsigned long long>(client.SendQueueDrops()));
+}
+
+void BenchWs() {
+    const char* port_env = std::getenv("LINX_BENCH_WS_PORT");
+    int port = port_env ? std::atoi(port_env) : 17681;
+    lws_set_log_level(LLL_ERR, nullptr);
+    LoopbackServer server;
+    if (!server.Start(port)) {
+        std::printf("[ws] failed to listen on 127.0.0.1:%d\n", port);
+        return;
+    }
+    std::string url = "ws://127.0.0.1:" + std::to_string(port) + "/";
+    std::printf("[ws] send_binary 120 bytes over loopback to %s\n", url.c_str());
+    std::printf("%-8s %12s %12s %12s %12s %8s\n", "burst", "enqueue ns", "avg us", "max us", "frames/s", "drops");
+    BenchWsMode(url, 1, 5000);
+    BenchWsMode(url, 16, 50000);
+    BenchWsMode(url, 256, 200000);
+}
+
+// ==================== JSON ====================
+
+void BenchJsonMessage(const char* name, const std::string& text, size_t iterations) {
+    double parse_ns = TimeNs(iterations, [&](size_t) {
+        json msg = json::parse(text);
+        g_sink = g_sink + msg.size();
+    });
+    json parsed = json::parse(text);
+    double dump_ns = TimeNs(iterations, [&](size_t) { g_sink = g_sink + parsed.dump().size(); });
+    // 与demo消息处理相同的路径：构造std::string、校验首字符、解析、按type分发
+    double handle_ns = TimeNs(iterations, [&](size_t) {
+        std::string copy(text);
+        if (copy.empty() || copy[0] != '{') {
+            return;
+        }
+        json msg = json::parse(copy);
+        g_sink = g_sink + (msg["type"] == "tts") + (msg["type"] == "hello");
+    });
+    // ControlParser：单遍扫描取协议字段并按type分发，不构建DOM
+    ControlParser parser;
+    ControlMessage control;
+    double fast_ns = TimeNs(iterations, [&](size_t) {
+        if (parser.Parse(text, &control)) {
+            g_sink = g_sink + (control.type == ControlType::Tts) + (control.type == ControlType::Hello) +
+                     control.session_id.size();
+        }
+    });
+    std::printf("%-16s %6zu %12.1f %12.1f %12.1f %12.1f\n", name, text.size(), parse_ns, dump_ns, handle_ns,
+                fast_ns);
+}
+
+void BenchJson() {
+    const size_t kIterations = 50000;
+    json client_hello = {{"type", "hello"},
+                         {"version", 1},
+                         {"transport", "websocket"},
+                         {"audio_params",
+                          {{"format", "opus"}, {"sample_rate", 16000}, {"channels", 1}, {"frame_duration", 60}}}};
+    std::string server_hello =
+        R"({"type":"hello","transport":"websocket","session_id":"5f1c9d0e-2f3a-4b5c-8d7e-0a1b2c3d4e5f",)"
+        R"("audio_params":{"format":"opus","sample_rate":24000,"channels":1,"frame_duration":60}})";
+    json listen = {{"session_id", "5f1c9d0e-2f3a-4b5c-8d7e-0a1b2c3d4e5f"},
+                   {"type", "listen"},
+                   {"state", "start"},
+                   {"mode", "auto"}};
+    std::string tts_start = R"({"type":"tts","state":"start","session_id":"5f1c9d0e-2f3a-4b5c-8d7e-0a1b2c3d4e5f"})";
+    std::string tts_sentence =
+        R"({"type":"tts","state":"sentence_start","text":"今天天气晴，最高气温二十六度，适合出门散步。",)"
+        R"("session_id":"5f1c9d0e-2f3a-4b5c-8d7e-0a1b2c3d4e5f"})";
+    std::string stt = R"({"type":"stt","text":"今天天气怎么样","session_id":"5f1c9d0e-2f3a-4b5c-8d7e-0a1b2c3d4e5f"})";
+
+    std::printf("[json] nlohmann::json, %zu iterations\n", kIterations);
+    std::printf("%-16s %6s %12s %12s %12s %12s\n", "message", "bytes", "parse ns", "dump ns", "handle ns",
+                "fast ns");
+    BenchJsonMessage("hello (client)", client_hello.dump(), kIterations);
+    BenchJsonMessage("hello (server)", server_hello, kIterations);
+    BenchJsonMessage("listen start", listen.dump(), kIterations);
+    BenchJsonMessage("tts start", tts_start, kIterations);
+    BenchJsonMessage("tts sentence", tts_sentence, kIterations);
+    BenchJsonMessage("stt", stt, kIterations);
+
+    // 回复序列化：demo原来每次构造json对象再dump，ControlWriter按模板写入复用的缓冲区
+    const std::string session_id = "5f1c9d0e-2f3a-4b5c-8d7e-0a1b2c3d4e5f";
+    ControlWriter writer;
+    std::printf("\n%-16s %12s %12s\n", "reply", "json ns", "writer ns");
+    auto bench_reply = [&](const char* name, auto&& build_json, auto&& write) {
+        double json_ns = TimeNs(kIterations, [&](size_t) { g_sink = g_sink + build_json().dump().size(); });
+        double writer_ns = TimeNs(kIterations, [&](size_t) { g_sink = g_sink + write().size(); });
+        std::printf("%-16s %12.1f %12.1f\n", name, json_ns, writer_ns);
+    };
+    bench_reply(
+        "hello", [&]() { return client_hello; }, [&]() { return writer.Hello(16000, 1, 60); });
+    bench_reply(
+        "listen start",
+        [&]() {
+            return json{{"session_id", session_id}, {"type", "listen"}, {"state", "start"}, {"mode", "auto"}};
+        },
+        [&]() { return writer.Listen(session_id, "start", "auto"); });
+    bench_reply(
+        "abort", [&]() { return json{{"session_id", session_id}, {"type", "abort"}}; },
+        [&]() { return writer.Abort(session_id); });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    auto selected = [&](const char* name) {
+        if (argc < 2) {
+            return true;
+        }
+        for (int i = 1; i < argc; ++i) {
+            if (std::strcmp(argv[i], name) == 0) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    spdlog::set_level(spdlog::level::warn);  // 连接建立等INFO日志不计入测量
+    if (selected("opus")) {
+        BenchOpus();
+    }
+    if (selected("jitter")) {
+        BenchJitter();
+    }
+    if (selected("ws")) {
+        BenchWs();
+    }
+    if (selected("json")) {
+        BenchJson();
+    }
+    if (selected("dsp")) {
+        BenchDsp();
+    }
+    return static_cast<int>(g_sink & 0);
+}
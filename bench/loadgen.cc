@@ -0,0 +1,1074 @@
+/**
+ * @file loadgen.cc
+ * @brief 服务端容量测试负载生成器：一个 lws 上下文、一个服务线程和少量节奏线程承载 N 路模拟设备会话
+ * @description 用法：linx_loadgen <ws_url> <prompt.wav>... [选项]
+ *                --sessions N   本分片的会话数（默认 10）
+ *                --shard I/M    分片编号/分片总数（默认 0/1）；设备编号 = I*N + 本地序号，多台机器各跑一个分片
+ *                --turns T      每路会话的对话轮数（默认 3）
+ *                --workers K    节奏线程数（默认 2）
+ *                --ramp S       在 S 秒内均匀建立连接（默认按每秒 50 个连接）
+ *                --pause MS     TTS 结束到下一轮开始说话的间隔（默认 1000）
+ *                --timeout MS   说完后等待回复、等待 hello 的超时（默认 15000）
+ *                --duration S   最长运行时间，0 表示跑完所有轮次（默认 0）
+ *                --token T      Authorization 令牌（默认 test-token）
+ *                --manual       每段提示音说完后发送 listen stop（默认 auto 模式，由服务端 VAD 判断句尾）
+ *                --low          20ms 上行帧（默认 60ms）
+ *                --json PATH    把本分片每路会话每一轮的延迟写入 JSON
+ *              linx_loadgen --merge a.json b.json ...  合并多个分片的 JSON 结果，输出总体分位数
+ *
+ *              每路会话有独立的 Device-Id/Client-Id，按 hello -> listen start -> 按帧节奏发送提示音 ->
+ *              等待 TTS -> listen start 的流程循环，与 demo/linx.cc 的设备行为一致。
+ *              提示音在启动时用一个编码器预先编码，所有会话共享同一组 Opus 包，压测机的开销只剩网络收发。
+ *              单轮延迟从提示音最后一帧发出开始计时，到该轮第一个 TTS 音频包到达为止（与设备端的 turn 延迟口径相同）。
+ */
+
+#include <libwebsockets.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AudioProfile.h"
+#include "FileAudio.h"
+#include "Json.h"
+#include "LatencyHistogram.h"
+#include "LatencyTracer.h"
+#include "Log.h"
+#include "Opus.h"
+
+using namespace linx;
+using json = nlohmann::json;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::atomic<bool> g_stop{false};
+
+void OnSignal(int) { g_stop = true; }
+
+uint64_t UsBetween(Clock::time_point from, Clock::time_point to) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(to - from).count());
+}
+
+struct Options {
+    std::string url;
+    std::vector<std::string> prompts;
+    int sessions = 10;
+    int shard = 0;
+    int shards = 1;
+    int turns = 3;
+    int workers = 2;
+    double ramp_s = -1;
+    int pause_ms = 1000;
+    int timeout_ms = 15000;
+    int duration_s = 0;
+    int tail_ms = 800;  // 提示音后继续发送的静音时长，与设备上行 VAD 的拖尾一致
+    std::string token = "test-token";
+    bool manual = false;
+    bool low = false;
+    std::string json_path;
+};
+
+// 预先编码好的一段提示音
+struct Prompt {
+    std::string path;
+    std::vector<std::vector<unsigned char>> packets;
+};
+
+// 每路会话的结果，--json 输出和 --merge 输入都是这个结构
+struct SessionResult {
+    uint64_t connect_us = 0;         // 开始连接 -> 收到服务器 hello
+    std::vector<uint64_t> turn_us;   // 每轮：说完 -> 第一个 TTS 音频包
+    std::vector<uint64_t> stt_us;    // 每轮：说完 -> stt 识别结果
+    int timeouts = 0;
+    bool failed = false;
+    std::string error;
+};
+
+enum class SessionState {
+    Idle,        // 等待按爬坡节奏建立连接
+    Connecting,  // 连接/握手中，等待服务器 hello
+    Speaking,    // 按帧节奏发送提示音和拖尾静音
+    AwaitReply,  // 已说完，等待 TTS
+    Replying,    // TTS 播放中，等待 tts stop
+    Pause,       // 两轮之间的间隔
+    Closing,     // 发完队列中的数据后关闭连接
+    Done,
+};
+
+struct OutFrame {
+    std::vector<unsigned char> buf;  // 前 LWS_PRE 字节为 lws 头部预留
+    enum lws_write_protocol type = LWS_WRITE_BINARY;
+};
+
+struct Session {
+    int index = 0;  // 全局设备编号（跨分片唯一）
+    std::string device_id;
+    std::string client_id;
+    size_t worker = 0;
+
+    // 仅服务线程访问
+    struct lws* wsi = nullptr;
+    bool connect_issued = false;
+    bool established = false;
+    std::string rx_buffer;    // 文本消息分片重组
+    size_t rx_binary_len = 0; // 二进制消息分片累计长度
+
+    // 以下由 mutex 保护（服务线程与节奏线程共享）
+    std::mutex mutex;
+    SessionState state = SessionState::Idle;
+    std::deque<OutFrame> out;
+    std::string session_id;
+    Clock::time_point connect_at;     // 爬坡：计划开始连接的时间（Start 时确定）
+    Clock::time_point connect_start;
+    Clock::time_point next_event;     // Speaking：下一帧的发送时间；其余状态：超时/下一轮开始时间
+    Clock::time_point speech_end;
+    const Prompt* prompt = nullptr;
+    size_t packet = 0;
+    size_t tail_left = 0;
+    int turn = 0;                     // 已结束的轮数
+    bool awaiting_audio = false;      // 本轮已说完，还没收到 TTS 音频
+    bool awaiting_stt = false;
+    SessionResult result;
+
+    bool queued = false;  // 已在服务线程的待处理列表中（受 LoadGenerator::ready_mutex_ 保护）
+};
+
+class LoadGenerator {
+public:
+    LoadGenerator(const Options& options, std::vector<Prompt> prompts, std::vector<unsigned char> silence,
+                  const AudioProfile& profile);
+    ~LoadGenerator();
+
+    bool Start();
+    // 阻塞直到所有会话结束、超过 --duration 或收到 SIGINT
+    void Run();
+    void Stop();
+
+    void PrintSummary() const;
+    bool WriteJson(const std::string& path) const;
+
+private:
+    struct Worker {
+        std::vector<Session*> sessions;
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool wake = false;
+        std::thread thread;
+    };
+
+    static int Callback(struct lws* wsi, enum lws_callback_reasons reason, void* user, void* in, size_t len);
+
+    void ServiceLoop();
+    void WorkerLoop(Worker& worker);
+    // 节奏线程对一路会话的推进（持有会话锁调用），返回是否需要服务线程处理
+    bool Tick(Session& s, Clock::time_point now, Clock::time_point& wake);
+    void StartTurn(Session& s, Clock::time_point now);
+    void EndTurn(Session& s, Clock::time_point now);
+    void Fail(Session& s, const std::string& error);
+
+    void Enqueue(Session& s, const void* data, size_t len, enum lws_write_protocol type);
+    void EnqueueListen(Session& s, const char* state);
+    void MarkReady(Session& s);
+    void WakeWorker(Session& s);
+    void ProcessReady();
+    void Connect(Session& s);
+    void Finish(Session& s, const char* error);
+
+    void OnEstablished(Session& s);
+    void OnReceive(Session& s, struct lws* wsi, const char* data, size_t len);
+    void OnText(Session& s, const std::string& text);
+    void OnAudio(Session& s, size_t len);
+    int OnWriteable(Session& s, struct lws* wsi);
+
+    Options options_;
+    std::vector<Prompt> prompts_;
+    std::vector<unsigned char> silence_;  // 一帧静音的 Opus 包
+    AudioProfile profile_;
+    Clock::duration frame_;
+    size_t tail_packets_ = 0;
+
+    std::string host_;
+    std::string path_;
+    int port_ = 80;
+    bool use_ssl_ = false;
+    std::string authorization_;
+
+    struct lws_context* context_ = nullptr;
+    struct lws_protocols protocols_[2];
+    std::thread service_thread_;
+    std::atomic<bool> running_{false};
+
+    std::vector<std::unique_ptr<Session>> sessions_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    std::mutex ready_mutex_;
+    std::vector<Session*> ready_;
+    std::vector<Session*> ready_swap_;  // 仅服务线程使用
+
+    std::atomic<int> finished_{0};
+    std::atomic<int> connected_{0};
+    std::atomic<uint64_t> turns_done_{0};
+    std::atomic<uint64_t> timeouts_{0};
+    std::atomic<uint64_t> packets_sent_{0};
+    std::atomic<uint64_t> bytes_sent_{0};
+    std::atomic<uint64_t> tts_packets_{0};
+    std::atomic<uint64_t> tts_bytes_{0};
+    LatencyHistogram connect_hist_;
+    LatencyHistogram turn_hist_;
+    LatencyHistogram stt_hist_;
+    Clock::time_point start_time_;
+    Clock::time_point end_time_;
+};
+
+bool ParseUrl(const std::string& url, std::string& host, std::string& path, int& port, bool& use_ssl) {
+    std::string rest;
+    if (url.compare(0, 6, "wss://") == 0) {
+        use_ssl = true;
+        port = 443;
+        rest = url.substr(6);
+    } else if (url.compare(0, 5, "ws://") == 0) {
+        use_ssl = false;
+        port = 80;
+        rest = url.substr(5);
+    } else {
+        return false;
+    }
+    size_t slash = rest.find('/');
+    host = rest.substr(0, slash);
+    path = slash == std::string::npos ? "/" : rest.substr(slash);
+    size_t colon = host.find(':');
+    if (colon != std::string::npos) {
+        port = std::atoi(host.c_str() + colon + 1);
+        host.resize(colon);
+    }
+    return !host.empty() && port > 0;
+}
+
+LoadGenerator::LoadGenerator(const Options& options, std::vector<Prompt> prompts, std::vector<unsigned char> silence,
+                             const AudioProfile& profile)
+    : options_(options), prompts_(std::move(prompts)), silence_(std::move(silence)), profile_(profile) {
+    frame_ = std::chrono::milliseconds(profile_.frame_ms);
+    tail_packets_ = static_cast<size_t>(options_.tail_ms / profile_.frame_ms);
+    authorization_ = "Bearer " + options_.token;
+
+    protocols_[0] = {"websocket-protocol", Callback, 0, 4096, 0, this, 0};
+    protocols_[1] = {nullptr, nullptr, 0, 0, 0, nullptr, 0};
+
+    int workers = std::max(1, options_.workers);
+    for (int i = 0; i < workers; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (int i = 0; i < options_.sessions; ++i) {
+        auto s = std::make_unique<Session>();
+        s->index = options_.shard * options_.sessions + i;
+        // 本地管理的 MAC 地址（第一个字节 0x02），按全局编号生成，跨分片不重复
+        char mac[32];
+        std::snprintf(mac, sizeof(mac), "02:4c:%02x:%02x:%02x:%02x", (s->index >> 24) & 0xff,
+                      (s->index >> 16) & 0xff, (s->index >> 8) & 0xff, s->index & 0xff);
+        s->device_id = mac;
+        char client[32];
+        std::snprintf(client, sizeof(client), "linx-loadgen-%08d", s->index);
+        s->client_id = client;
+        s->worker = static_cast<size_t>(i) % workers_.size();
+        workers_[s->worker]->sessions.push_back(s.get());
+        sessions_.push_back(std::move(s));
+    }
+    ready_.reserve(sessions_.size());
+    ready_swap_.reserve(sessions_.size());
+}
+
+LoadGenerator::~LoadGenerator() { Stop(); }
+
+bool LoadGenerator::Start() {
+    if (!ParseUrl(options_.url, host_, path_, port_, use_ssl_)) {
+        ERROR("invalid url: {}", options_.url);
+        return false;
+    }
+
+    struct lws_context_creation_info info;
+    memset(&info, 0, sizeof(info));
+    info.port = CONTEXT_PORT_NO_LISTEN;
+    info.protocols = protocols_;
+    info.gid = -1;
+    info.uid = -1;
+    info.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
+    info.user = this;
+    context_ = lws_create_context(&info);
+    if (!context_) {
+        ERROR("Failed to create libwebsockets context");
+        return false;
+    }
+
+    // 在爬坡时间内均匀建立连接，避免所有会话同时握手
+    double ramp_s = options_.ramp_s >= 0 ? options_.ramp_s : options_.sessions / 50.0;
+    start_time_ = Clock::now();
+    for (size_t i = 0; i < sessions_.size(); ++i) {
+        sessions_[i]->connect_at =
+            start_time_ + std::chrono::microseconds(static_cast<int64_t>(ramp_s * 1e6 * i / sessions_.size()));
+    }
+    running_ = true;
+    service_thread_ = std::thread(&LoadGenerator::ServiceLoop, this);
+    for (auto& worker : workers_) {
+        Worker* w = worker.get();
+        w->thread = std::thread([this, w]() { WorkerLoop(*w); });
+    }
+    return true;
+}
+
+void LoadGenerator::Run() {
+    auto last_report = Clock::now();
+    while (!g_stop && finished_ < static_cast<int>(sessions_.size())) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto now = Clock::now();
+        if (options_.duration_s > 0 && now - start_time_ >= std::chrono::seconds(options_.duration_s)) {
+            INFO("duration reached, stopping");
+            break;
+        }
+        if (now - last_report >= std::chrono::seconds(5)) {
+            last_report = now;
+            LatencySummary turn = turn_hist_.Summarize();
+            INFO("connected {}/{}, finished {}, turns {}, timeouts {}, turn p50 {:.0f}ms p99 {:.0f}ms",
+                 connected_.load(), sessions_.size(), finished_.load(), turns_done_.load(), timeouts_.load(),
+                 turn.p50_us / 1000.0, turn.p99_us / 1000.0);
+        }
+    }
+    end_time_ = Clock::now();
+    Stop();
+}
+
+void LoadGenerator::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    for (auto& worker : workers_) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            worker->wake = true;
+        }
+        worker->cv.notify_one();
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    if (context_) {
+        lws_cancel_service(context_);
+    }
+    if (service_thread_.joinable()) {
+        service_thread_.join();
+    }
+    if (context_) {
+        lws_context_destroy(context_);
+        context_ = nullptr;
+    }
+}
+
+void LoadGenerator::ServiceLoop() {
+    while (running_ && lws_service(context_, 0) >= 0) {
+    }
+}
+
+void LoadGenerator::WorkerLoop(Worker& worker) {
+    while (running_) {
+        auto now = Clock::now();
+        auto wake = now + std::chrono::seconds(1);
+        for (Session* s : worker.sessions) {
+            bool service;
+            {
+                std::lock_guard<std::mutex> lock(s->mutex);
+                service = Tick(*s, now, wake);
+            }
+            if (service) {
+                MarkReady(*s);
+            }
+        }
+        std::unique_lock<std::mutex> lock(worker.mutex);
+        worker.cv.wait_until(lock, wake, [&]() { return worker.wake; });
+        worker.wake = false;
+    }
+}
+
+bool LoadGenerator::Tick(Session& s, Clock::time_point now, Clock::time_point& wake) {
+    switch (s.state) {
+        case SessionState::Idle:
+            if (now < s.connect_at) {
+                wake = std::min(wake, s.connect_at);
+                return false;
+            }
+            s.state = SessionState::Connecting;
+            s.connect_start = now;
+            s.next_event = now + std::chrono::milliseconds(options_.timeout_ms);
+            wake = std::min(wake, s.next_event);
+            return true;
+
+        case SessionState::Connecting:
+            if (now >= s.next_event) {
+                Fail(s, "no hello from server");
+                return true;
+            }
+            wake = std::min(wake, s.next_event);
+            return false;
+
+        case SessionState::Speaking: {
+            // 按帧时长节奏发送；线程被耽搁时立即补发落后的帧，保持与真实设备相同的平均码率
+            bool sent = false;
+            while (s.next_event <= now) {
+                if (s.packet < s.prompt->packets.size()) {
+                    const auto& packet = s.prompt->packets[s.packet++];
+                    Enqueue(s, packet.data(), packet.size(), LWS_WRITE_BINARY);
+                    if (s.packet == s.prompt->packets.size()) {
+                        s.speech_end = now;
+                        s.awaiting_audio = true;
+                        s.awaiting_stt = true;
+                        s.tail_left = options_.manual ? 0 : tail_packets_;
+                        if (options_.manual) {
+                            EnqueueListen(s, "stop");
+                        }
+                    }
+                } else if (s.tail_left > 0) {
+                    Enqueue(s, silence_.data(), silence_.size(), LWS_WRITE_BINARY);
+                    s.tail_left--;
+                } else {
+                    break;
+                }
+                s.next_event += frame_;
+                sent = true;
+            }
+            if (s.packet == s.prompt->packets.size() && s.tail_left == 0) {
+                s.state = SessionState::AwaitReply;
+                s.next_event = s.speech_end + std::chrono::milliseconds(options_.timeout_ms);
+            }
+            wake = std::min(wake, s.next_event);
+            return sent;
+        }
+
+        case SessionState::AwaitReply:
+        case SessionState::Replying:
+            if (now >= s.next_event) {
+                s.result.timeouts++;
+                timeouts_++;
+                EndTurn(s, now);
+                return s.state == SessionState::Closing;
+            }
+            wake = std::min(wake, s.next_event);
+            return false;
+
+        case SessionState::Pause:
+            if (now >= s.next_event) {
+                StartTurn(s, now);
+                wake = std::min(wake, s.next_event);
+                return false;
+            }
+            wake = std::min(wake, s.next_event);
+            return false;
+
+        case SessionState::Closing:
+        case SessionState::Done:
+            return false;
+    }
+    return false;
+}
+
+void LoadGenerator::StartTurn(Session& s, Clock::time_point now) {
+    // 各会话错开选用提示音，同一时刻服务端收到的内容不完全相同
+    s.prompt = &prompts_[static_cast<size_t>(s.index + s.turn) % prompts_.size()];
+    s.packet = 0;
+    s.tail_left = 0;
+    s.state = SessionState::Speaking;
+    s.next_event = now;
+}
+
+void LoadGenerator::EndTurn(Session& s, Clock::time_point now) {
+    s.turn++;
+    s.awaiting_audio = false;
+    s.awaiting_stt = false;
+    turns_done_++;
+    if (s.turn >= options_.turns) {
+        s.state = SessionState::Closing;
+        return;
+    }
+    s.state = SessionState::Pause;
+    s.next_event = now + std::chrono::milliseconds(options_.pause_ms);
+}
+
+void LoadGenerator::Fail(Session& s, const std::string& error) {
+    if (!s.result.failed) {
+        s.result.failed = true;
+        s.result.error = error;
+        WARN("session {} ({}): {}", s.index, s.device_id, error);
+    }
+    if (s.state != SessionState::Done) {
+        s.state = SessionState::Closing;
+    }
+}
+
+// lws 在客户端 socket 上发送前会原地掩码负载，共享的 Opus 包不能直接交给 lws_write，每帧拷贝一份
+void LoadGenerator::Enqueue(Session& s, const void* data, size_t len, enum lws_write_protocol type) {
+    OutFrame frame;
+    frame.buf.resize(LWS_PRE + len);
+    memcpy(frame.buf.data() + LWS_PRE, data, len);
+    frame.type = type;
+    s.out.push_back(std::move(frame));
+    if (type == LWS_WRITE_BINARY) {
+        packets_sent_++;
+        bytes_sent_ += len;
+    }
+}
+
+void LoadGenerator::EnqueueListen(Session& s, const char* state) {
+    json msg = {{"session_id", s.session_id}, {"type", "listen"}, {"state", state}, {"mode", "auto"}};
+    if (options_.manual) {
+        msg["mode"] = "manual";
+    }
+    std::string text = msg.dump();
+    Enqueue(s, text.data(), text.size(), LWS_WRITE_TEXT);
+}
+
+void LoadGenerator::MarkReady(Session& s) {
+    {
+        std::lock_guard<std::mutex> lock(ready_mutex_);
+        if (s.queued) {
+            return;
+        }
+        s.queued = true;
+        ready_.push_back(&s);
+    }
+    if (context_) {
+        lws_cancel_service(context_);  // 由服务线程在 LWS_CALLBACK_EVENT_WAIT_CANCELLED 中处理
+    }
+}
+
+void LoadGenerator::WakeWorker(Session& s) {
+    Worker& worker = *workers_[s.worker];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.wake = true;
+    }
+    worker.cv.notify_one();
+}
+
+void LoadGenerator::ProcessReady() {
+    {
+        std::lock_guard<std::mutex> lock(ready_mutex_);
+        ready_swap_.swap(ready_);
+        for (Session* s : ready_swap_) {
+            s->queued = false;
+        }
+    }
+    for (Session* s : ready_swap_) {
+        SessionState state;
+        bool pending;
+        {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            state = s->state;
+            pending = !s->out.empty();
+        }
+        if (state == SessionState::Connecting && !s->connect_issued) {
+            Connect(*s);  // 可能同步触发 CONNECTION_ERROR 回调，不能持有会话锁
+        } else if (s->wsi && s->established && (pending || state == SessionState::Closing)) {
+            lws_callback_on_writable(s->wsi);
+        } else if (state == SessionState::Closing) {
+            if (s->wsi) {
+                lws_set_timeout(s->wsi, PENDING_TIMEOUT_USER_OK, LWS_TO_KILL_ASYNC);  // 握手未完成，直接断开
+            } else {
+                Finish(*s, nullptr);
+            }
+        }
+    }
+    ready_swap_.clear();
+}
+
+void LoadGenerator::Connect(Session& s) {
+    struct lws_client_connect_info ccinfo;
+    memset(&ccinfo, 0, sizeof(ccinfo));
+    ccinfo.context = context_;
+    ccinfo.address = host_.c_str();
+    ccinfo.port = port_;
+    ccinfo.path = path_.c_str();
+    ccinfo.host = host_.c_str();
+    ccinfo.origin = host_.c_str();
+    ccinfo.protocol = protocols_[0].name;
+    ccinfo.userdata = &s;  // 连接级回调通过 lws_wsi_user 找到会话
+    if (use_ssl_) {
+        ccinfo.ssl_connection = LCCSCF_USE_SSL | LCCSCF_ALLOW_SELFSIGNED | LCCSCF_SKIP_SERVER_CERT_HOSTNAME_CHECK;
+    }
+    s.connect_issued = true;
+    struct lws* wsi = lws_client_connect_via_info(&ccinfo);
+    if (!wsi) {
+        Finish(s, "connect failed");  // 已经同步回调过 CONNECTION_ERROR 时 Finish 不会重复计数
+        return;
+    }
+    s.wsi = wsi;
+}
+
+void LoadGenerator::Finish(Session& s, const char* error) {
+    bool was_established = s.established;
+    s.wsi = nullptr;
+    s.established = false;
+    s.rx_buffer.clear();
+    s.rx_binary_len = 0;
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (s.state == SessionState::Done) {
+        return;
+    }
+    if (s.state != SessionState::Closing) {
+        Fail(s, error ? error : "closed");
+    }
+    s.state = SessionState::Done;
+    s.out.clear();
+    if (was_established) {
+        connected_--;
+    }
+    finished_++;
+}
+
+void LoadGenerator::OnEstablished(Session& s) {
+    s.established = true;
+    connected_++;
+    json hello = {{"type", "hello"},
+                  {"version", 1},
+                  {"transport", "websocket"},
+                  {"audio_params",
+                   {{"format", "opus"},
+                    {"sample_rate", profile_.sample_rate},
+                    {"channels", profile_.channels},
+                    {"frame_duration", profile_.frame_ms}}}};
+    std::string text = hello.dump();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    Enqueue(s, text.data(), text.size(), LWS_WRITE_TEXT);
+}
+
+void LoadGenerator::OnReceive(Session& s, struct lws* wsi, const char* data, size_t len) {
+    bool message_done = lws_is_final_fragment(wsi) && lws_remaining_packet_payload(wsi) == 0;
+    bool binary = lws_frame_is_binary(wsi) != 0;
+    if (binary) {
+        // 只统计 TTS 音频，不解码；分片消息在最后一片计为一个包
+        s.rx_binary_len += len;
+        if (message_done) {
+            OnAudio(s, s.rx_binary_len);
+            s.rx_binary_len = 0;
+        }
+        return;
+    }
+    if (s.rx_buffer.empty() && message_done) {
+        OnText(s, std::string(data, len));
+        return;
+    }
+    s.rx_buffer.append(data, len);
+    if (message_done) {
+        std::string text;
+        text.swap(s.rx_buffer);
+        OnText(s, text);
+    }
+}
+
+void LoadGenerator::OnAudio(Session& s, size_t len) {
+    auto now = Clock::now();
+    tts_packets_++;
+    tts_bytes_ += len;
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (s.awaiting_audio) {
+        s.awaiting_audio = false;
+        uint64_t us = UsBetween(s.speech_end, now);
+        s.result.turn_us.push_back(us);
+        turn_hist_.Record(us);
+    }
+    if (s.state == SessionState::AwaitReply || (s.state == SessionState::Speaking && s.packet == s.prompt->packets.size())) {
+        s.state = SessionState::Replying;
+        s.tail_left = 0;
+        s.next_event = now + std::chrono::milliseconds(options_.timeout_ms) * 4;  // 一段 TTS 的最长时长
+    }
+}
+
+void LoadGenerator::OnText(Session& s, const std::string& text) {
+    json msg = json::parse(text, nullptr, false);
+    if (msg.is_discarded() || !msg.is_object()) {
+        WARN("session {}: non-JSON message ignored", s.index);
+        return;
+    }
+    std::string type = msg.value("type", "");
+    auto now = Clock::now();
+    bool wake = false;
+    bool writable = false;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (type == "hello") {
+            s.session_id = msg.value("session_id", "");
+            if (s.state == SessionState::Connecting) {
+                s.result.connect_us = UsBetween(s.connect_start, now);
+                connect_hist_.Record(s.result.connect_us);
+                EnqueueListen(s, "start");
+                StartTurn(s, now);
+                wake = true;
+            }
+        } else if (type == "stt") {
+            if (s.awaiting_stt) {
+                s.awaiting_stt = false;
+                uint64_t us = UsBetween(s.speech_end, now);
+                s.result.stt_us.push_back(us);
+                stt_hist_.Record(us);
+            }
+        } else if (type == "tts") {
+            std::string state = msg.value("state", "");
+            if (state == "start" && (s.state == SessionState::AwaitReply || s.state == SessionState::Speaking)) {
+                // 与设备一致：TTS 开始后停止上行
+                s.state = SessionState::Replying;
+                s.packet = s.prompt ? s.prompt->packets.size() : 0;
+                s.tail_left = 0;
+                s.next_event = now + std::chrono::milliseconds(options_.timeout_ms) * 4;
+                wake = true;
+            } else if (state == "stop" && s.state == SessionState::Replying) {
+                if (msg.contains("session_id") && msg["session_id"].is_string()) {
+                    s.session_id = msg["session_id"];
+                }
+                EndTurn(s, now);
+                if (s.state != SessionState::Closing) {
+                    EnqueueListen(s, "start");
+                }
+                wake = true;
+            }
+        } else if (type == "goodbye") {
+            if (s.turn < options_.turns) {
+                Fail(s, "goodbye from server");
+            }
+            wake = true;
+        }
+        writable = !s.out.empty() || s.state == SessionState::Closing;
+    }
+    if (wake) {
+        WakeWorker(s);
+    }
+    if (writable && s.wsi) {
+        lws_callback_on_writable(s.wsi);  // 已在服务线程上，回复的 listen 消息或关闭请求直接处理
+    }
+}
+
+int LoadGenerator::OnWriteable(Session& s, struct lws* wsi) {
+    while (true) {
+        OutFrame frame;
+        bool closing;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            closing = s.state == SessionState::Closing;
+            if (s.out.empty()) {
+                if (closing) {
+                    lws_close_reason(wsi, LWS_CLOSE_STATUS_NORMAL, nullptr, 0);
+                    return -1;
+                }
+                return 0;
+            }
+            frame = std::move(s.out.front());
+            s.out.pop_front();
+        }
+        size_t len = frame.buf.size() - LWS_PRE;
+        int n = lws_write(wsi, frame.buf.data() + LWS_PRE, len, frame.type);
+        if (n < static_cast<int>(len)) {
+            ERROR("session {}: lws_write failed: {} of {} bytes", s.index, n, len);
+            return -1;
+        }
+        if (lws_send_pipe_choked(wsi)) {
+            lws_callback_on_writable(wsi);
+            return 0;
+        }
+    }
+}
+
+int LoadGenerator::Callback(struct lws* wsi, enum lws_callback_reasons reason, void* user, void* in, size_t len) {
+    // 连接级事件按 lws_wsi_user 分发到会话，上下文级事件（EVENT_WAIT_CANCELLED）通过 lws_context_user 找到生成器
+    LoadGenerator* self = static_cast<LoadGenerator*>(lws_context_user(lws_get_context(wsi)));
+    Session* s = static_cast<Session*>(lws_wsi_user(wsi));
+    if (!self) {
+        return 0;
+    }
+
+    switch (reason) {
+        case LWS_CALLBACK_CLIENT_APPEND_HANDSHAKE_HEADER:
+            if (s) {
+                unsigned char** p = static_cast<unsigned char**>(in);
+                unsigned char* end = (*p) + len;
+                const std::pair<const char*, const std::string*> headers[] = {
+                    {"Authorization", &self->authorization_},
+                    {"Device-Id", &s->device_id},
+                    {"Client-Id", &s->client_id},
+                };
+                std::string lines = "Protocol-Version: 1\r\n";
+                for (const auto& header : headers) {
+                    lines += std::string(header.first) + ": " + *header.second + "\r\n";
+                }
+                if (end - (*p) < static_cast<int>(lines.size())) {
+                    return -1;
+                }
+                memcpy(*p, lines.data(), lines.size());
+                (*p) += lines.size();
+            }
+            break;
+
+        case LWS_CALLBACK_CLIENT_ESTABLISHED:
+            if (s) {
+                s->wsi = wsi;
+                self->OnEstablished(*s);
+                lws_callback_on_writable(wsi);
+            }
+            break;
+
+        case LWS_CALLBACK_CLIENT_RECEIVE:
+            if (s) {
+                self->OnReceive(*s, wsi, static_cast<const char*>(in), len);
+            }
+            break;
+
+        case LWS_CALLBACK_CLIENT_WRITEABLE:
+            if (s) {
+                return self->OnWriteable(*s, wsi);
+            }
+            break;
+
+        case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
+            if (s) {
+                self->Finish(*s, in ? static_cast<const char*>(in) : "connection error");
+            }
+            break;
+
+        case LWS_CALLBACK_CLOSED:
+            if (s) {
+                self->Finish(*s, "closed by server");
+            }
+            break;
+
+        case LWS_CALLBACK_EVENT_WAIT_CANCELLED:
+            self->ProcessReady();
+            break;
+
+        default:
+            break;
+    }
+    return 0;
+}
+
+void PrintHistogram(const char* name, const LatencyHistogram& hist) {
+    LatencySummary s = hist.Summarize();
+    if (s.count == 0) {
+        std::printf("%-34s n=0\n", name);
+        return;
+    }
+    std::printf("%-34s n=%-6llu p50 %7.1fms  p90 %7.1fms  p99 %7.1fms  max %7.1fms\n", name,
+                static_cast<unsigned long long>(s.count), s.p50_us / 1000.0, s.p90_us / 1000.0, s.p99_us / 1000.0,
+                s.max_us / 1000.0);
+}
+
+void LoadGenerator::PrintSummary() const {
+    double elapsed = std::chrono::duration<double>(end_time_ - start_time_).count();
+    int failed = 0;
+    for (const auto& s : sessions_) {
+        failed += s->result.failed ? 1 : 0;
+    }
+    std::printf("shard %d/%d: %zu sessions (devices %d..%d), %d failed, %.1fs\n", options_.shard, options_.shards,
+                sessions_.size(), options_.shard * options_.sessions,
+                options_.shard * options_.sessions + options_.sessions - 1, failed, elapsed);
+    std::printf("turns %llu (%llu timeouts), uplink %llu packets / %.1f KB, downlink %llu TTS packets / %.1f KB\n",
+                static_cast<unsigned long long>(turns_done_.load()), static_cast<unsigned long long>(timeouts_.load()),
+                static_cast<unsigned long long>(packets_sent_.load()), bytes_sent_ / 1024.0,
+                static_cast<unsigned long long>(tts_packets_.load()), tts_bytes_ / 1024.0);
+    PrintHistogram("connect (connect -> hello)", connect_hist_);
+    PrintHistogram("stt (end of speech -> stt)", stt_hist_);
+    PrintHistogram("turn (end of speech -> first TTS)", turn_hist_);
+}
+
+json ResultToJson(const Session& s) {
+    return {{"device_id", s.device_id}, {"connect_us", s.result.connect_us}, {"turn_us", s.result.turn_us},
+            {"stt_us", s.result.stt_us}, {"timeouts", s.result.timeouts}, {"failed", s.result.failed},
+            {"error", s.result.error}};
+}
+
+bool LoadGenerator::WriteJson(const std::string& path) const {
+    json sessions = json::array();
+    for (const auto& s : sessions_) {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        sessions.push_back(ResultToJson(*s));
+    }
+    json doc = {{"shard", options_.shard}, {"shards", options_.shards}, {"url", options_.url},
+                {"frame_ms", profile_.frame_ms}, {"sessions", sessions}};
+    std::ofstream out(path);
+    if (!out) {
+        ERROR("cannot write {}", path);
+        return false;
+    }
+    out << doc.dump() << "\n";
+    return true;
+}
+
+// 合并多个分片的结果：直方图只能按样本合并，所以每个分片输出原始的逐轮延迟
+int Merge(const std::vector<std::string>& paths) {
+    LatencyHistogram connect_hist;
+    LatencyHistogram stt_hist;
+    LatencyHistogram turn_hist;
+    size_t sessions = 0;
+    int failed = 0;
+    int timeouts = 0;
+    for (const auto& path : paths) {
+        std::ifstream in(path);
+        json doc = json::parse(in, nullptr, false);
+        if (doc.is_discarded() || !doc.contains("sessions")) {
+            std::fprintf(stderr, "invalid result file: %s\n", path.c_str());
+            return 1;
+        }
+        for (const auto& s : doc["sessions"]) {
+            sessions++;
+            failed += s.value("failed", false) ? 1 : 0;
+            timeouts += s.value("timeouts", 0);
+            if (s.value("connect_us", 0ull) > 0) {
+                connect_hist.Record(s["connect_us"].get<uint64_t>());
+            }
+            for (uint64_t us : s["stt_us"]) {
+                stt_hist.Record(us);
+            }
+            for (uint64_t us : s["turn_us"]) {
+                turn_hist.Record(us);
+            }
+        }
+    }
+    std::printf("%zu shards, %zu sessions, %d failed, %d timeouts\n", paths.size(), sessions, failed, timeouts);
+    PrintHistogram("connect (connect -> hello)", connect_hist);
+    PrintHistogram("stt (end of speech -> stt)", stt_hist);
+    PrintHistogram("turn (end of speech -> first TTS)", turn_hist);
+    return 0;
+}
+
+// 读取提示音并按上行帧长编码；所有会话共享编码结果
+bool LoadPrompts(const std::vector<std::string>& paths, const AudioProfile& profile, std::vector<Prompt>& prompts,
+                 std::vector<unsigned char>& silence) {
+    OpusEncoderCtx encoder(profile.sample_rate, profile.channels, OpusEncoderConfig::Preset("balanced"));
+    std::vector<short> pcm(profile.FrameSamples() * profile.channels);
+    std::vector<unsigned char> packet(4000);
+    for (const auto& path : paths) {
+        FileAudioConfig config;
+        config.capture_path = path;
+        config.realtime = false;
+        FileAudio audio(config);
+        audio.ApplyProfile(profile);
+        try {
+            audio.Init();
+        } catch (const std::exception& e) {
+            ERROR("{}", e.what());
+            return false;
+        }
+        Prompt prompt;
+        prompt.path = path;
+        while (!audio.CaptureDone()) {
+            audio.Read(pcm.data(), profile.FrameSamples());
+            int n = encoder.Encode(packet.data(), packet.size(), pcm.data(), profile.FrameSamples());
+            if (n > 0) {
+                prompt.packets.emplace_back(packet.begin(), packet.begin() + n);
+            }
+        }
+        if (prompt.packets.empty()) {
+            ERROR("empty prompt: {}", path);
+            return false;
+        }
+        INFO("prompt {}: {} packets ({:.1f}s)", path, prompt.packets.size(),
+             prompt.packets.size() * profile.frame_ms / 1000.0);
+        prompts.push_back(std::move(prompt));
+    }
+    std::fill(pcm.begin(), pcm.end(), 0);
+    int n = encoder.Encode(packet.data(), packet.size(), pcm.data(), profile.FrameSamples());
+    silence.assign(packet.begin(), packet.begin() + std::max(n, 0));
+    return true;
+}
+
+void Usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s <ws_url> <prompt.wav>... [--sessions N] [--shard I/M] [--turns T] [--workers K]\n"
+                 "          [--ramp S] [--pause MS] [--timeout MS] [--duration S] [--token T] [--manual] [--low]\n"
+                 "          [--json PATH]\n"
+                 "       %s --merge <result.json>...\n",
+                 argv0, argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc >= 2 && std::strcmp(argv[1], "--merge") == 0) {
+        return Merge(std::vector<std::string>(argv + 2, argv + argc));
+    }
+
+    Options options;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--sessions" && has_value) {
+            options.sessions = std::atoi(argv[++i]);
+        } else if (arg == "--shard" && has_value) {
+            if (std::sscanf(argv[++i], "%d/%d", &options.shard, &options.shards) != 2) {
+                Usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--turns" && has_value) {
+            options.turns = std::atoi(argv[++i]);
+        } else if (arg == "--workers" && has_value) {
+            options.workers = std::atoi(argv[++i]);
+        } else if (arg == "--ramp" && has_value) {
+            options.ramp_s = std::atof(argv[++i]);
+        } else if (arg == "--pause" && has_value) {
+            options.pause_ms = std::atoi(argv[++i]);
+        } else if (arg == "--timeout" && has_value) {
+            options.timeout_ms = std::atoi(argv[++i]);
+        } else if (arg == "--duration" && has_value) {
+            options.duration_s = std::atoi(argv[++i]);
+        } else if (arg == "--token" && has_value) {
+            options.token = argv[++i];
+        } else if (arg == "--json" && has_value) {
+            options.json_path = argv[++i];
+        } else if (arg == "--manual") {
+            options.manual = true;
+        } else if (arg == "--low") {
+            options.low = true;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            Usage(argv[0]);
+            return 1;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() < 2 || options.sessions <= 0 || options.turns <= 0 || options.shards <= 0 ||
+        options.shard < 0 || options.shard >= options.shards) {
+        Usage(argv[0]);
+        return 1;
+    }
+    options.url = positional[0];
+    options.prompts.assign(positional.begin() + 1, positional.end());
+
+    lws_set_log_level(LLL_ERR | LLL_WARN, nullptr);
+    AudioProfile profile = AudioProfile::ForMode(options.low ? LatencyMode::Low : LatencyMode::Normal);
+    std::vector<Prompt> prompts;
+    std::vector<unsigned char> silence;
+    if (!LoadPrompts(options.prompts, profile, prompts, silence)) {
+        return 1;
+    }
+
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+    LoadGenerator generator(options, std::move(prompts), std::move(silence), profile);
+    if (!generator.Start()) {
+        return 1;
+    }
+    generator.Run();
+    generator.PrintSummary();
+    if (!options.json_path.empty() && !generator.WriteJson(options.json_path)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,149 @@
+/**
+ * @file modelpack.cc
+ * @brief 模型权重打包工具：把裸的权重文件打包成 ModelFile 映射文件，或列出、校验已有模型文件
+ * @description 用法：linx_modelpack [--version <n>] <输出.model> <名称>=<类型>:<维度>:<输入.bin> ...
+ *                    linx_modelpack --list <模型文件>
+ *                    linx_modelpack --verify <模型文件>
+ *              类型为 f32 / f16 / i32 / i16 / i8 / u8，维度如 256x64（最多 4 维），输入文件为按行优先排列的
+ *              小端裸数据，长度须与类型和维度一致。--verify 读遍所有权重并校验每个张量的 CRC32
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "FileStream.h"
+#include "ModelFile.h"
+
+using namespace linx;
+
+namespace {
+
+int Usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [--version <n>] <out.model> <name>=<dtype>:<dims>:<input.bin> ...\n"
+                 "       %s --list <model>\n"
+                 "       %s --verify <model>\n",
+                 argv0, argv0, argv0);
+    return 1;
+}
+
+int List(const std::string& path, bool verify) {
+    ModelFile model;
+    std::string error;
+    if (!model.Open(path, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::printf("model version %u, %zu tensors, %zu bytes\n", model.ModelVersion(), model.Count(), model.DataBytes());
+    int failed = 0;
+    for (size_t i = 0; i < model.Count(); ++i) {
+        ModelTensor tensor = model.Tensor(i);
+        std::string dims;
+        for (int d = 0; d < tensor.rank; ++d) {
+            dims += (d > 0 ? "x" : "") + std::to_string(tensor.dims[d]);
+        }
+        const char* status = "";
+        if (verify) {
+            bool ok = model.Verify(i);
+            failed += ok ? 0 : 1;
+            status = ok ? "  ok" : "  CHECKSUM MISMATCH";
+        }
+        std::printf("%-32.*s %-4s %-16s %10zu bytes%s\n", static_cast<int>(tensor.name.size()), tensor.name.data(),
+                    ModelDTypeName(tensor.dtype), dims.empty() ? "scalar" : dims.c_str(), tensor.bytes, status);
+    }
+    return failed == 0 ? 0 : 1;
+}
+
+bool ParseDType(const std::string& text, ModelDType* out) {
+    for (size_t i = 0; i < static_cast<size_t>(ModelDType::kCount); ++i) {
+        if (text == ModelDTypeName(static_cast<ModelDType>(i))) {
+            *out = static_cast<ModelDType>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ParseDims(const std::string& text, std::vector<uint32_t>* out) {
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t x = text.find('x', start);
+        std::string item = text.substr(start, x == std::string::npos ? std::string::npos : x - start);
+        char* end = nullptr;
+        unsigned long v = std::strtoul(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || v == 0 || v > 0xffffffffUL) {
+            return false;
+        }
+        out->push_back(static_cast<uint32_t>(v));
+        if (x == std::string::npos) {
+            break;
+        }
+        start = x + 1;
+    }
+    return !out->empty() && out->size() <= static_cast<size_t>(kModelMaxRank);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 3 && std::strcmp(argv[1], "--list") == 0) {
+        return List(argv[2], false);
+    }
+    if (argc == 3 && std::strcmp(argv[1], "--verify") == 0) {
+        return List(argv[2], true);
+    }
+    ModelFileWriter writer;
+    int arg = 1;
+    for (; arg + 1 < argc && std::strncmp(argv[arg], "--", 2) == 0; arg += 2) {
+        if (std::strcmp(argv[arg], "--version") == 0) {
+            writer.SetModelVersion(static_cast<uint32_t>(std::strtoul(argv[arg + 1], nullptr, 10)));
+        } else {
+            return Usage(argv[0]);
+        }
+    }
+    if (argc - arg < 2) {
+        return Usage(argv[0]);
+    }
+    std::string output = argv[arg++];
+
+    for (; arg < argc; ++arg) {
+        std::string spec = argv[arg];
+        size_t eq = spec.find('=');
+        size_t colon1 = eq == std::string::npos ? std::string::npos : spec.find(':', eq + 1);
+        size_t colon2 = colon1 == std::string::npos ? std::string::npos : spec.find(':', colon1 + 1);
+        if (eq == 0 || colon2 == std::string::npos) {
+            std::fprintf(stderr, "expected <name>=<dtype>:<dims>:<file>, got '%s'\n", spec.c_str());
+            return 1;
+        }
+        std::string name = spec.substr(0, eq);
+        ModelDType dtype;
+        std::vector<uint32_t> dims;
+        if (!ParseDType(spec.substr(eq + 1, colon1 - eq - 1), &dtype)) {
+            std::fprintf(stderr, "%s: unknown dtype (f32, f16, i32, i16, i8, u8)\n", spec.c_str());
+            return 1;
+        }
+        if (!ParseDims(spec.substr(colon1 + 1, colon2 - colon1 - 1), &dims)) {
+            std::fprintf(stderr, "%s: bad dims (e.g. 256x64, at most %d)\n", spec.c_str(), kModelMaxRank);
+            return 1;
+        }
+        std::string input = spec.substr(colon2 + 1);
+        MappedFile file;
+        if (file.open(input) != 0) {
+            return 1;
+        }
+        if (!writer.Add(name, dtype, dims, file.data(), file.size())) {
+            std::fprintf(stderr, "%s: %zu bytes do not match %s %s\n", input.c_str(), file.size(),
+                         ModelDTypeName(dtype), spec.substr(colon1 + 1, colon2 - colon1 - 1).c_str());
+            return 1;
+        }
+    }
+    std::string error;
+    if (!writer.Write(output, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    return List(output, false);
+}
@@ -0,0 +1,89 @@
+/**
+ * @file pcm_kernels_bench.cc
+ * @brief PCM内核微基准：对比各指令集实现与标量实现的吞吐
+ * @description 用法：pcm_kernels_bench [帧样本数=960] [迭代次数=20000]
+ *              每项输出每帧耗时（ns）和相对标量实现的加速比
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "PcmKernels.h"
+
+using namespace linx;
+
+namespace {
+
+volatile int g_sink = 0;  // 防止编译器优化掉结果
+
+template <typename Fn>
+double TimeNs(size_t iterations, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        fn();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+struct Buffers {
+    std::vector<short> a, b, out, stereo, left, right;
+    std::vector<float> f;
+};
+
+void RunKernels(const PcmKernels& k, Buffers& buf, size_t n, size_t iterations, double* ns) {
+    ns[0] = TimeNs(iterations, [&] { k.gain(buf.out.data(), buf.a.data(), n, 1.7f); });
+    ns[1] = TimeNs(iterations, [&] { k.mix(buf.out.data(), buf.a.data(), buf.b.data(), n); });
+    ns[2] = TimeNs(iterations, [&] { k.s16_to_float(buf.f.data(), buf.a.data(), n); });
+    ns[3] = TimeNs(iterations, [&] { k.float_to_s16(buf.out.data(), buf.f.data(), n); });
+    ns[4] = TimeNs(iterations, [&] { g_sink = g_sink + k.level(buf.a.data(), n).peak; });
+    ns[5] = TimeNs(iterations, [&] { k.interleave2(buf.stereo.data(), buf.a.data(), buf.b.data(), n); });
+    ns[6] = TimeNs(iterations, [&] { k.deinterleave2(buf.left.data(), buf.right.data(), buf.stereo.data(), n); });
+    g_sink = g_sink + buf.out[n / 2] + buf.left[n / 2];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 960;
+    size_t iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20000;
+
+    Buffers buf;
+    buf.a.resize(n);
+    buf.b.resize(n);
+    buf.out.resize(n);
+    buf.left.resize(n);
+    buf.right.resize(n);
+    buf.stereo.resize(2 * n);
+    buf.f.resize(n);
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> dist(-32768, 32767);
+    for (size_t i = 0; i < n; ++i) {
+        buf.a[i] = static_cast<short>(dist(rng));
+        buf.b[i] = static_cast<short>(dist(rng));
+    }
+
+    static const char* kNames[] = {"gain", "mix", "s16->f32", "f32->s16", "level", "interleave2", "deinterleave2"};
+    constexpr int kCount = sizeof(kNames) / sizeof(kNames[0]);
+
+    double scalar_ns[kCount];
+    RunKernels(*FindPcmKernels("scalar"), buf, n, iterations, scalar_ns);
+
+    std::printf("frame=%zu samples, iterations=%zu, selected=%s\n", n, iterations, GetPcmKernels().name);
+    std::printf("%-8s %-14s %12s %10s\n", "impl", "kernel", "ns/frame", "speedup");
+    for (const char* impl : {"scalar", "sse2", "avx2", "neon"}) {
+        const PcmKernels* kernels = FindPcmKernels(impl);
+        if (kernels == nullptr) {
+            continue;
+        }
+        double ns[kCount];
+        RunKernels(*kernels, buf, n, iterations, ns);
+        for (int i = 0; i < kCount; ++i) {
+            std::printf("%-8s %-14s %12.1f %9.2fx\n", impl, kNames[i], ns[i], scalar_ns[i] / ns[i]);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,75 @@
+#!/bin/sh
+# PGO 训练：在 LINX_PGO=generate 的构建上跑离线回放与每帧热路径基准，写出剖析数据
+# 用法：bench/pgo_train.sh <构建目录> [输入.wav ...]
+#       没有给出输入时生成一段 20 秒的合成语音（16kHz 单声道，音节与停顿交替，VAD 会在两种状态间切换）；
+#       实际录音更接近线上的编码路径，有条件时应传入几段真实对话
+# 之后在同一构建目录中以 -DLINX_PGO=use 重新配置并编译（make pgo 会依次完成这三步）
+set -e
+
+BUILD_DIR=${1:?usage: pgo_train.sh <build-dir> [input.wav ...]}
+shift
+BENCH_DIR=${BUILD_DIR}/bench
+PROFILE_DIR=$(sed -n 's/^LINX_PGO_DIR:PATH=//p' "${BUILD_DIR}/CMakeCache.txt")
+PGO_MODE=$(sed -n 's/^LINX_PGO:STRING=//p' "${BUILD_DIR}/CMakeCache.txt")
+if [ "${PGO_MODE}" != "generate" ] || [ ! -x "${BENCH_DIR}/replay_bench" ]; then
+    echo "pgo_train: ${BUILD_DIR} must be configured with -DLINX_PGO=generate -DLINX_BUILD_BENCH=ON and built" >&2
+    exit 1
+fi
+
+# 上一次训练的数据会与这一次累加，先清掉
+rm -rf "${PROFILE_DIR}"
+mkdir -p "${PROFILE_DIR}"
+
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "${WORK_DIR}"' EXIT
+
+if [ $# -eq 0 ]; then
+    python3 - "${WORK_DIR}/speech.wav" <<'EOF'
+import math, random, struct, sys, wave
+
+rate, seconds = 16000, 20
+random.seed(1)
+samples = []
+t = 0.0
+while t < seconds:
+    # 一个“音节”：基频 110~220Hz 带谐波和噪声，包络为正弦窗；音节之间偶尔有长停顿
+    length = random.uniform(0.15, 0.35)
+    f0 = random.uniform(110, 220)
+    n = int(length * rate)
+    for i in range(n):
+        env = math.sin(math.pi * i / n)
+        x = sum(math.sin(2 * math.pi * f0 * k * i / rate) / k for k in range(1, 8))
+        samples.append(env * (0.25 * x + 0.02 * random.uniform(-1, 1)))
+    pause = random.choice([0.05, 0.05, 0.1, 0.8])
+    samples.extend(0.002 * random.uniform(-1, 1) for _ in range(int(pause * rate)))
+    t += length + pause
+
+with wave.open(sys.argv[1], "wb") as w:
+    w.setnchannels(1)
+    w.setsampwidth(2)
+    w.setframerate(rate)
+    w.writeframes(b"".join(struct.pack("<h", int(max(-1.0, min(1.0, s)) * 32767)) for s in samples))
+EOF
+    set -- "${WORK_DIR}/speech.wav"
+fi
+
+# 离线流水线：VAD + 编码 + 解码 + 抖动缓冲区，默认与低延迟两种配置
+for input in "$@"; do
+    "${BENCH_DIR}/replay_bench" "${input}" "${WORK_DIR}/out.wav"
+    "${BENCH_DIR}/replay_bench" "${input}" "${WORK_DIR}/out.wav" --low
+done
+
+# 每帧热路径：编解码、抖动缓冲区、控制消息与 DSP 内核（不跑 ws，训练不依赖本机网络）
+"${BENCH_DIR}/linx_bench" opus jitter json dsp
+"${BENCH_DIR}/pcm_kernels_bench"
+
+if ls "${PROFILE_DIR}"/*.profraw >/dev/null 2>&1; then
+    # Clang：合并为 -fprofile-use 读取的单个文件
+    PROFDATA=$(command -v llvm-profdata || xcrun -f llvm-profdata 2>/dev/null || true)
+    if [ -z "${PROFDATA}" ]; then
+        echo "pgo_train: llvm-profdata not found" >&2
+        exit 1
+    fi
+    "${PROFDATA}" merge -output="${PROFILE_DIR}/linx.profdata" "${PROFILE_DIR}"/*.profraw
+fi
+echo "pgo_train: profile written to ${PROFILE_DIR}"
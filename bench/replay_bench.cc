@@ -0,0 +1,197 @@
+/**
+ * @file replay_bench.cc
+ * @brief 离线流水线吞吐基准：WAV文件 -> 采集泵（VAD + Opus编码） -> 解码 -> 抖动缓冲区 -> WAV文件
+ * @description 用法：replay_bench <输入.wav> [输出.wav] [--low] [--realtime] [--no-vad] [--no-alloc[=预热帧数]]
+ *              不经过网络，把上行编码出的包直接当作下行TTS包解码播放，测量整条本地流水线的
+ *              吞吐（实时倍数）和每秒音频消耗的CPU时间。默认快速模式；--realtime按设备节奏运行，
+ *              此时实时倍数恒为1，CPU占用即设备上单路会话的本地开销。
+ *              --no-alloc 断言稳态零分配：预热（默认50帧）之后每帧（采集、编码、解码、出队、写出）都不得有
+ *              堆分配，否则打印分配点的调用栈并以 2 退出。需要 -DLINX_MEMORY_ACCOUNTING=ON 才能看到
+ *              operator new 的分配，否则只检查 TaggedMalloc。
+ *              结束时按 CpuAccounting 的类别（采集、DSP、编码、发送、解码、播放）打印 CPU 时间的分解，
+ *              整个文件计为一轮
+ */
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AllocationTracker.h"
+#include "AudioProfile.h"
+#include "CapturePump.h"
+#include "CpuAccounting.h"
+#include "DeadlineWatchdog.h"
+#include "FileAudio.h"
+#include "JitterBuffer.h"
+#include "Log.h"
+#include "Opus.h"
+#include "Vad.h"
+
+using namespace linx;
+
+namespace {
+
+double CpuSeconds() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr,
+                     "usage: %s <input.wav> [output.wav] [--low] [--realtime] [--no-vad] [--no-alloc[=warmup_frames]]\n",
+                     argv[0]);
+        return 1;
+    }
+    FileAudioConfig file_config;
+    file_config.capture_path = argv[1];
+    file_config.realtime = false;
+    LatencyMode mode = LatencyMode::Normal;
+    bool use_vad = true;
+    bool check_alloc = false;
+    uint64_t alloc_warmup = 50;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--low") == 0) {
+            mode = LatencyMode::Low;
+        } else if (std::strcmp(argv[i], "--realtime") == 0) {
+            file_config.realtime = true;
+        } else if (std::strcmp(argv[i], "--no-vad") == 0) {
+            use_vad = false;
+        } else if (std::strncmp(argv[i], "--no-alloc", 10) == 0) {
+            check_alloc = true;
+            if (argv[i][10] == '=') {
+                alloc_warmup = std::strtoull(argv[i] + 11, nullptr, 10);
+            }
+        } else {
+            file_config.playback_path = argv[i];
+        }
+    }
+
+    spdlog::set_level(spdlog::level::warn);
+    AudioProfile profile = AudioProfile::ForMode(mode);
+    FileAudio audio(file_config);
+    audio.ApplyProfile(profile);
+    audio.Init();
+    audio.Record();
+    audio.Play();
+
+    OpusEncoderCtx encoder(profile.sample_rate, profile.channels, OpusEncoderConfig::Preset("balanced"));
+    OpusDecoderCtx decoder(profile.sample_rate, profile.channels);
+    JitterBufferConfig jitter_config;
+    jitter_config.sample_rate = profile.sample_rate;
+    jitter_config.channels = profile.channels;
+    jitter_config.min_delay_ms = profile.MinJitterDelayMs();
+    jitter_config.initial_delay_ms = profile.InitialJitterDelayMs();
+    JitterBuffer jitter(jitter_config);
+
+    CapturePumpConfig pump_config;
+    pump_config.sample_rate = profile.sample_rate;
+    pump_config.channels = profile.channels;
+    pump_config.frame_samples = profile.FrameSamples();
+    CapturePump pump(audio, encoder, pump_config);
+    if (use_vad) {
+        EnergyVadConfig vad_config;
+        vad_config.channels = profile.channels;
+        pump.SetVoiceDetector(std::make_shared<EnergyVad>(vad_config));
+    }
+
+    // 整条流水线都在主线程上：泵的阶段打点驱动采集/DSP/编码/发送的切换，解码和写出在下面手动切换
+    CpuAccounting cpu_accounting;
+    cpu_accounting.RegisterCurrentThread("replay", CpuDomain::Capture);
+    DeadlineMonitor deadline("replay", static_cast<uint64_t>(profile.frame_ms) * 1000, 0.5);
+    pump.SetDeadlineMonitor(&deadline);
+
+    // 上行包直接作为下行TTS包：解码进抖动缓冲区，再按帧写入“扬声器”
+    uint64_t decode_ns = 0;
+    uint64_t decoded_packets = 0;
+    std::vector<short> out(profile.FrameSamples() * profile.channels);
+    pump.SetPacketHandler([&](const unsigned char* data, size_t len) {
+        CpuThread::EnterCurrent(CpuDomain::Decode);
+        auto start = std::chrono::steady_clock::now();
+        if (decoder.DecodeInto(jitter, data, len) > 0) {
+            decoded_packets++;
+        }
+        decode_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                         .count();
+        CpuThread::EnterCurrent(CpuDomain::Network);  // 回到泵的发送阶段
+    });
+
+    double cpu_start = CpuSeconds();
+    cpu_accounting.BeginTurn();
+    auto wall_start = std::chrono::steady_clock::now();
+    // 只跟踪主线程：整条流水线都在这里同步执行。预热期间编解码器、抖动缓冲区和文件输出完成首次分配
+    std::unique_ptr<AllocationTracker> tracker;
+    if (check_alloc) {
+        tracker = std::make_unique<AllocationTracker>();
+        tracker->Pause();
+    }
+    uint64_t frame_index = 0;
+    uint64_t alloc_frames = 0;
+    uint64_t max_frame_allocs = 0;
+    while (!audio.CaptureDone()) {
+        bool steady = tracker && frame_index++ >= alloc_warmup;
+        uint64_t before = steady ? tracker->Allocations() : 0;
+        if (steady) {
+            tracker->Resume();
+        }
+        pump.PumpOnce();
+        CpuThread::EnterCurrent(CpuDomain::Playback);
+        size_t n;
+        while ((n = jitter.Pop(out.data(), out.size())) > 0) {
+            audio.Write(out.data(), n / profile.channels);
+        }
+        if (steady) {
+            tracker->Pause();
+            uint64_t allocs = tracker->Allocations() - before;
+            alloc_frames += allocs > 0 ? 1 : 0;
+            max_frame_allocs = std::max(max_frame_allocs, allocs);
+        }
+    }
+    jitter.MarkEndOfStream();
+    size_t n;
+    while ((n = jitter.Pop(out.data(), out.size())) > 0) {
+        audio.Write(out.data(), n / profile.channels);
+    }
+    audio.Close();
+    cpu_accounting.EndTurn();
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    double cpu = CpuSeconds() - cpu_start;
+
+    CapturePumpStats stats = pump.GetStats();
+    double audio_seconds = static_cast<double>(audio.CaptureFrames()) / profile.sample_rate;
+    std::printf("input %.1fs, %s mode (%dms frames), %s, vad %s\n", audio_seconds, profile.ModeName(),
+                profile.frame_ms, file_config.realtime ? "realtime" : "fast", use_vad ? "on" : "off");
+    std::printf("frames: %llu read, %llu encoded (%.1f%% suppressed), %llu decoded, %llu bytes\n",
+                static_cast<unsigned long long>(stats.frames_read),
+                static_cast<unsigned long long>(stats.frames_encoded), stats.suppressed_ratio * 100,
+                static_cast<unsigned long long>(decoded_packets), static_cast<unsigned long long>(stats.bytes_encoded));
+    std::printf("encode %.1fus/frame, decode %.1fus/frame\n",
+                stats.frames_encoded ? static_cast<double>(stats.encode_us) / stats.frames_encoded : 0.0,
+                decoded_packets ? decode_ns / 1000.0 / decoded_packets : 0.0);
+    std::printf("wall %.3fs (%.1fx realtime), cpu %.3fs (%.2f%% of one core per stream)\n", wall,
+                wall > 0 ? audio_seconds / wall : 0.0, cpu, audio_seconds > 0 ? cpu / audio_seconds * 100 : 0.0);
+    std::printf("cpu by domain:\n%s", cpu_accounting.Report().c_str());
+    if (tracker) {
+        uint64_t steady_frames = frame_index > alloc_warmup ? frame_index - alloc_warmup : 0;
+        std::printf("allocations: %llu in %llu of %llu steady-state frames (max %llu/frame, %llu warmup frames)%s\n",
+                    static_cast<unsigned long long>(tracker->Allocations()),
+                    static_cast<unsigned long long>(alloc_frames), static_cast<unsigned long long>(steady_frames),
+                    static_cast<unsigned long long>(max_frame_allocs), static_cast<unsigned long long>(alloc_warmup),
+                    AllocationTracker::CoversOperatorNew() ? "" : ", operator new not tracked (LINX_MEMORY_ACCOUNTING=OFF)");
+        if (tracker->Allocations() > 0) {
+            std::fputs(tracker->Report().c_str(), stderr);
+            return 2;
+        }
+    }
+    return 0;
+}
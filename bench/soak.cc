@@ -0,0 +1,744 @@
+/**
+ * @file soak.cc
+ * @brief 长时间浸泡测试：本机模拟服务端驱动无声卡的 linx_app 跑数千轮对话和重连，定期采样资源并检测单调增长
+ * @description 用法：linx_soak <linx_app> [选项]
+ *                --duration S    总时长（默认 3600 秒）
+ *                --turns N       完成 N 轮对话后结束（默认 0，只按时长）
+ *                --reconnect K   每 K 轮由服务端断开一次连接，客户端按重连策略重连（默认 20，0 不断开）
+ *                --listen MS     收到 listen start 后多久回复（默认 800）
+ *                --reply MS      每轮 TTS 的时长（默认 1200），按下行帧节奏发送
+ *                --interval S    采样间隔（默认 10 秒）
+ *                --warmup S      预热时长，之前的样本不参与判定（默认 120 秒；相对 --duration 过长时取其五分之一）
+ *                --stall S       这么久没有完成一轮即判为卡死（默认 60 秒）
+ *                --csv PATH      每次采样写一行，所有序列一列
+ *                --log PATH      linx_app 的输出（默认临时目录下的 linx_app.log）
+ *                --port P        模拟服务端端口（默认 17690）
+ *              其余 LINX_* 环境变量原样传给 linx_app（如 LINX_REACTOR=1、LINX_PROTOCOL_VERSION 以外的配置）。
+ *
+ *              linx_app 以 LINX_AUDIO_BACKEND=null 启动（采集按设备时钟交付静音，播放丢弃），服务端地址经
+ *              LINX_WS_URLS 指定为本机，指标端点经 LINX_METRICS_SOCKET 打开。每次采样记录进程 RSS、fd 数、线程数，
+ *              以及指标端点上的发送队列、解码队列、抖动缓冲区、帧池和各模块的内存记账。
+ *
+ *              增长判定：预热之后的样本按时间分成 4 段，每段取最小值（不受轮内峰值影响，只看“回落到的底”）；
+ *              各段最小值逐段递增，且末段比首段多出该序列的阈值时判为增长。
+ *              退出码：0 没有增长，1 有序列增长，2 linx_app 提前退出、对话卡死或启动失败
+ */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <libwebsockets.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AudioProfile.h"
+#include "Json.h"
+#include "Log.h"
+#include "Opus.h"
+
+using namespace linx;
+using json = nlohmann::json;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::atomic<bool> g_stop{false};
+
+void OnSignal(int) { g_stop = true; }
+
+constexpr size_t kWindows = 4;
+
+struct Options {
+    std::string app;
+    int duration_s = 3600;
+    int turns = 0;
+    int reconnect_every = 20;
+    int listen_ms = 800;
+    int reply_ms = 1200;
+    int interval_s = 10;
+    int warmup_s = 120;
+    int stall_s = 60;
+    int port = 17690;
+    std::string csv_path;
+    std::string log_path;
+};
+
+// ==================== 模拟服务端 ====================
+
+// 每个连接的对话状态，只在服务线程上访问
+struct SoakConnection {
+    enum class Phase { WaitListen, Listening, Replying };
+    Phase phase = Phase::WaitListen;
+    Clock::time_point reply_at;     // Listening：何时开始回复
+    Clock::time_point next_packet;  // Replying：下一个下行包的发送时刻
+    int packets_left = 0;
+    std::string rx;                        // 正在重组的文本消息
+    std::deque<std::string> text;          // 待发送的文本消息
+    std::vector<unsigned char> buf;        // 写出缓冲区，前 LWS_PRE 字节为 lws 头部预留
+};
+
+struct SoakSession {
+    SoakConnection* conn;
+};
+
+/**
+ * @brief 按 demo 的协议应答的本机服务端：hello -> listen start -> 等待 -> stt + tts start/sentence_start +
+ *        一轮 Opus 包（按帧节奏）+ sentence_end/tts stop，客户端播完后再次 listen start；每 K 轮断开一次连接
+ */
+class SoakServer {
+public:
+    SoakServer(const Options& options, const AudioProfile& profile) : options_(options), profile_(profile) {}
+
+    bool Start() {
+        if (!EncodeReply()) {
+            return false;
+        }
+        protocols_[0] = {"websocket-protocol", Callback, sizeof(SoakSession), 4096, 0, nullptr, 0};
+        protocols_[1] = {nullptr, nullptr, 0, 0, 0, nullptr, 0};
+        lws_context_creation_info info;
+        memset(&info, 0, sizeof(info));
+        info.port = options_.port;
+        info.iface = "127.0.0.1";
+        info.protocols = protocols_;
+        info.gid = -1;
+        info.uid = -1;
+        info.user = this;
+        context_ = lws_create_context(&info);
+        if (context_ == nullptr) {
+            return false;
+        }
+        running_ = true;
+        thread_ = std::thread([this] {
+            while (running_ && lws_service(context_, 0) >= 0) {
+            }
+        });
+        // 回复按帧节奏发送：每 period 唤醒一次服务线程，由它检查各连接是否到了发送时刻
+        ticker_ = std::thread([this] {
+            while (running_) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(profile_.period_ms));
+                lws_cancel_service(context_);
+            }
+        });
+        return true;
+    }
+
+    ~SoakServer() {
+        running_ = false;
+        if (ticker_.joinable()) {
+            ticker_.join();
+        }
+        if (context_) {
+            lws_cancel_service(context_);
+        }
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        if (context_) {
+            lws_context_destroy(context_);
+        }
+    }
+
+    uint64_t Turns() const { return turns_.load(std::memory_order_relaxed); }
+    uint64_t Connections() const { return connections_.load(std::memory_order_relaxed); }
+    uint64_t Disconnects() const { return disconnects_.load(std::memory_order_relaxed); }
+
+private:
+    // 一轮回复用的 Opus 包：200Hz 方波式的谐波音，与实际 TTS 一样每包都有内容
+    bool EncodeReply() {
+        OpusEncoderCtx encoder(profile_.sample_rate, profile_.channels, OpusEncoderConfig::Preset("balanced"));
+        if (!encoder.Valid()) {
+            ERROR("soak: opus encoder unavailable");
+            return false;
+        }
+        const size_t frame = profile_.FrameSamples();
+        std::vector<short> pcm(frame * profile_.channels);
+        std::vector<unsigned char> packet(4000);
+        int frames = std::max(1, options_.reply_ms / profile_.frame_ms);
+        size_t t = 0;
+        for (int i = 0; i < frames; ++i) {
+            for (size_t k = 0; k < frame; ++k, ++t) {
+                double x = 0;
+                for (int h = 1; h <= 5; h += 2) {
+                    x += std::sin(2 * M_PI * 200 * h * t / profile_.sample_rate) / h;
+                }
+                for (int c = 0; c < profile_.channels; ++c) {
+                    pcm[k * profile_.channels + c] = static_cast<short>(6000 * x);
+                }
+            }
+            int n = encoder.Encode(packet.data(), packet.size(), pcm.data(), frame);
+            if (n > 0) {
+                reply_.emplace_back(packet.begin(), packet.begin() + n);
+            }
+        }
+        return !reply_.empty();
+    }
+
+    void OnText(SoakConnection& conn, const std::string& text) {
+        json message = json::parse(text, nullptr, false);
+        if (message.is_discarded() || !message.contains("type")) {
+            return;
+        }
+        std::string type = message.value("type", "");
+        if (type == "hello") {
+            uint64_t n = connections_.fetch_add(1, std::memory_order_relaxed) + 1;
+            json hello = {{"type", "hello"},
+                          {"transport", "websocket"},
+                          {"session_id", "soak-" + std::to_string(n)},
+                          {"audio_params",
+                           {{"format", "opus"},
+                            {"sample_rate", profile_.sample_rate},
+                            {"channels", profile_.channels},
+                            {"frame_duration", profile_.frame_ms}}}};
+            conn.text.push_back(hello.dump());
+        } else if (type == "listen" && message.value("state", "") == "start") {
+            conn.phase = SoakConnection::Phase::Listening;
+            conn.reply_at = Clock::now() + std::chrono::milliseconds(options_.listen_ms);
+        }
+    }
+
+    // 写出一条消息；返回 -1 关闭连接
+    int OnWriteable(struct lws* wsi, SoakConnection& conn) {
+        Clock::time_point now = Clock::now();
+        if (conn.phase == SoakConnection::Phase::Listening && now >= conn.reply_at) {
+            uint64_t turn = turns_.fetch_add(1, std::memory_order_relaxed) + 1;
+            if (options_.reconnect_every > 0 && turn % static_cast<uint64_t>(options_.reconnect_every) == 0) {
+                disconnects_.fetch_add(1, std::memory_order_relaxed);
+                return -1;  // 正在录音时断开：客户端要重连、重新 hello，上一轮的状态须全部回收
+            }
+            conn.text.push_back(json({{"type", "stt"}, {"text", "soak turn " + std::to_string(turn)}}).dump());
+            conn.text.push_back(json({{"type", "tts"}, {"state", "start"}}).dump());
+            conn.text.push_back(json({{"type", "tts"}, {"state", "sentence_start"}, {"text", "reply"}}).dump());
+            conn.phase = SoakConnection::Phase::Replying;
+            conn.packets_left = static_cast<int>(reply_.size());
+            conn.next_packet = now;
+        }
+
+        const unsigned char* data = nullptr;
+        size_t len = 0;
+        enum lws_write_protocol type = LWS_WRITE_TEXT;
+        if (!conn.text.empty()) {
+            data = reinterpret_cast<const unsigned char*>(conn.text.front().data());
+            len = conn.text.front().size();
+        } else if (conn.phase == SoakConnection::Phase::Replying && now >= conn.next_packet) {
+            if (conn.packets_left > 0) {
+                const auto& packet = reply_[reply_.size() - static_cast<size_t>(conn.packets_left)];
+                data = packet.data();
+                len = packet.size();
+                type = LWS_WRITE_BINARY;
+                conn.packets_left--;
+                conn.next_packet += std::chrono::milliseconds(profile_.frame_ms);
+            } else {
+                conn.text.push_back(json({{"type", "tts"}, {"state", "sentence_end"}}).dump());
+                conn.text.push_back(json({{"type", "tts"}, {"state", "stop"}}).dump());
+                conn.phase = SoakConnection::Phase::WaitListen;
+                lws_callback_on_writable(wsi);
+                return 0;
+            }
+        }
+        if (data == nullptr) {
+            return 0;
+        }
+        conn.buf.resize(LWS_PRE + len);
+        memcpy(conn.buf.data() + LWS_PRE, data, len);
+        if (lws_write(wsi, conn.buf.data() + LWS_PRE, len, type) < static_cast<int>(len)) {
+            return -1;
+        }
+        if (type == LWS_WRITE_TEXT) {
+            conn.text.pop_front();
+        }
+        if (!conn.text.empty()) {
+            lws_callback_on_writable(wsi);
+        }
+        return 0;
+    }
+
+    static int Callback(struct lws* wsi, enum lws_callback_reasons reason, void* user, void* in, size_t len) {
+        auto* self = static_cast<SoakServer*>(lws_context_user(lws_get_context(wsi)));
+        auto* session = static_cast<SoakSession*>(user);
+        switch (reason) {
+            case LWS_CALLBACK_ESTABLISHED:
+                session->conn = new SoakConnection();
+                break;
+            case LWS_CALLBACK_CLOSED:
+                delete session->conn;
+                session->conn = nullptr;
+                break;
+            case LWS_CALLBACK_RECEIVE: {
+                SoakConnection* conn = session->conn;
+                if (conn == nullptr || lws_frame_is_binary(wsi)) {
+                    break;  // 上行音频只是消耗掉，不解码
+                }
+                if (lws_is_first_fragment(wsi)) {
+                    conn->rx.clear();
+                }
+                conn->rx.append(static_cast<const char*>(in), len);
+                if (lws_is_final_fragment(wsi) && lws_remaining_packet_payload(wsi) == 0) {
+                    self->OnText(*conn, conn->rx);
+                    lws_callback_on_writable(wsi);
+                }
+                break;
+            }
+            case LWS_CALLBACK_SERVER_WRITEABLE:
+                if (session->conn != nullptr) {
+                    return self->OnWriteable(wsi, *session->conn);
+                }
+                break;
+            case LWS_CALLBACK_EVENT_WAIT_CANCELLED:
+                if (self != nullptr) {
+                    lws_callback_on_writable_all_protocol(self->context_, &self->protocols_[0]);
+                }
+                break;
+            default:
+                break;
+        }
+        return 0;
+    }
+
+    const Options& options_;
+    const AudioProfile profile_;
+    std::vector<std::vector<unsigned char>> reply_;
+    lws_protocols protocols_[2];
+    lws_context* context_ = nullptr;
+    std::thread thread_;
+    std::thread ticker_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> turns_{0};
+    std::atomic<uint64_t> connections_{0};
+    std::atomic<uint64_t> disconnects_{0};
+};
+
+// ==================== 资源采样 ====================
+
+// /proc/<pid>/status 中的一项（kB 或个数），读不到时返回 -1
+double ReadStatus(pid_t pid, const char* key) {
+    std::ifstream in("/proc/" + std::to_string(pid) + "/status");
+    std::string line;
+    size_t key_len = strlen(key);
+    while (std::getline(in, line)) {
+        if (line.compare(0, key_len, key) == 0 && line.size() > key_len && line[key_len] == ':') {
+            return std::atof(line.c_str() + key_len + 1);
+        }
+    }
+    return -1;
+}
+
+double CountFds(pid_t pid) {
+    DIR* dir = opendir(("/proc/" + std::to_string(pid) + "/fd").c_str());
+    if (dir == nullptr) {
+        return -1;
+    }
+    double n = 0;
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') {
+            n++;
+        }
+    }
+    closedir(dir);
+    return n;
+}
+
+// 从指标端点取一份 Prometheus 文本，只保留不带标签的样本
+std::map<std::string, double> ReadMetrics(const std::string& socket_path) {
+    std::map<std::string, double> values;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return values;
+    }
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    std::string text;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+        const char request[] = "metrics\n";
+        if (write(fd, request, sizeof(request) - 1) == static_cast<ssize_t>(sizeof(request) - 1)) {
+            char buf[4096];
+            ssize_t n;
+            while ((n = read(fd, buf, sizeof(buf))) > 0) {
+                text.append(buf, static_cast<size_t>(n));
+            }
+        }
+    }
+    close(fd);
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        std::string line = text.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        start = end == std::string::npos ? text.size() : end + 1;
+        if (line.empty() || line[0] == '#' || line.find('{') != std::string::npos) {
+            continue;
+        }
+        size_t space = line.find(' ');
+        if (space != std::string::npos) {
+            values[line.substr(0, space)] = std::atof(line.c_str() + space + 1);
+        }
+    }
+    return values;
+}
+
+// 跟踪的序列：名称、增长阈值（绝对值，与相对首段的比例取大者）
+struct SeriesSpec {
+    const char* name;
+    double min_growth;
+    double relative;
+};
+
+// 指标端点上的序列按前缀匹配，进程级的三项由 /proc 采样
+const SeriesSpec kSeries[] = {
+    {"rss_bytes", 1 << 20, 0.05},
+    {"fds", 2, 0},
+    {"threads", 2, 0},
+    {"linx_ws_send_queue_depth", 8, 0},
+    {"linx_tts_decode_queue_depth", 8, 0},
+    {"linx_jitter_depth_samples", 16000, 0},
+    {"linx_frame_pool_in_use", 8, 0},
+    {"linx_memory_", 256 << 10, 0.05},
+};
+
+const SeriesSpec* FindSpec(const std::string& name) {
+    for (const auto& spec : kSeries) {
+        size_t n = strlen(spec.name);
+        bool prefix = spec.name[n - 1] == '_';
+        if (prefix ? name.compare(0, n, spec.name) == 0 : name == spec.name) {
+            // 内存记账只看当前值，峰值本来就只增不减
+            if (prefix && name.size() >= 11 && name.compare(name.size() - 11, 11, "_peak_bytes") == 0) {
+                return nullptr;
+            }
+            return &spec;
+        }
+    }
+    return nullptr;
+}
+
+struct Series {
+    const SeriesSpec* spec = nullptr;
+    std::vector<double> t;  // 距启动的秒数
+    std::vector<double> v;
+};
+
+struct Verdict {
+    bool judged = false;  // 预热后样本足够
+    bool growing = false;
+    double first_min = 0;
+    double last_min = 0;
+    double slope_per_hour = 0;  // 最小二乘斜率
+};
+
+Verdict Analyze(const Series& series, double warmup_s) {
+    Verdict verdict;
+    std::vector<double> t;
+    std::vector<double> v;
+    for (size_t i = 0; i < series.t.size(); ++i) {
+        if (series.t[i] >= warmup_s) {
+            t.push_back(series.t[i]);
+            v.push_back(series.v[i]);
+        }
+    }
+    if (v.size() < kWindows * 2) {
+        return verdict;
+    }
+    verdict.judged = true;
+    double mins[kWindows];
+    for (size_t w = 0; w < kWindows; ++w) {
+        size_t begin = v.size() * w / kWindows;
+        size_t end = v.size() * (w + 1) / kWindows;
+        mins[w] = *std::min_element(v.begin() + static_cast<std::ptrdiff_t>(begin),
+                                    v.begin() + static_cast<std::ptrdiff_t>(end));
+    }
+    bool monotonic = true;
+    for (size_t w = 1; w < kWindows; ++w) {
+        monotonic = monotonic && mins[w] > mins[w - 1];
+    }
+    verdict.first_min = mins[0];
+    verdict.last_min = mins[kWindows - 1];
+    double threshold = std::max(series.spec->min_growth, series.spec->relative * std::fabs(mins[0]));
+    verdict.growing = monotonic && mins[kWindows - 1] - mins[0] >= threshold;
+
+    double mean_t = 0;
+    double mean_v = 0;
+    for (size_t i = 0; i < v.size(); ++i) {
+        mean_t += t[i];
+        mean_v += v[i];
+    }
+    mean_t /= static_cast<double>(v.size());
+    mean_v /= static_cast<double>(v.size());
+    double cov = 0;
+    double var = 0;
+    for (size_t i = 0; i < v.size(); ++i) {
+        cov += (t[i] - mean_t) * (v[i] - mean_v);
+        var += (t[i] - mean_t) * (t[i] - mean_t);
+    }
+    verdict.slope_per_hour = var > 0 ? cov / var * 3600 : 0;
+    return verdict;
+}
+
+// ==================== 被测进程 ====================
+
+pid_t LaunchApp(const Options& options, int* stdin_fd) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    int log_fd = open(options.log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (log_fd < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(fds[0], STDIN_FILENO);
+        dup2(log_fd, STDOUT_FILENO);
+        dup2(log_fd, STDERR_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        close(log_fd);
+        execl(options.app.c_str(), options.app.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    close(fds[0]);
+    close(log_fd);
+    if (pid < 0) {
+        close(fds[1]);
+        return -1;
+    }
+    *stdin_fd = fds[1];
+    return pid;
+}
+
+// 回车请求正常退出（demo 阻塞在 std::cin.get 上），超时后强制结束
+void StopApp(pid_t pid, int stdin_fd) {
+    if (write(stdin_fd, "\n", 1) != 1) {
+        kill(pid, SIGTERM);
+    }
+    close(stdin_fd);
+    for (int i = 0; i < 100; ++i) {
+        if (waitpid(pid, nullptr, WNOHANG) == pid) {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+}
+
+void Usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s <linx_app> [--duration S] [--turns N] [--reconnect K] [--listen MS] [--reply MS]\n"
+                 "          [--interval S] [--warmup S] [--stall S] [--csv PATH] [--log PATH] [--port P]\n",
+                 argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argv[1][0] == '-') {
+        Usage(argv[0]);
+        return 2;
+    }
+    Options options;
+    options.app = argv[1];
+    bool warmup_set = false;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--duration" && has_value) {
+            options.duration_s = std::atoi(argv[++i]);
+        } else if (arg == "--turns" && has_value) {
+            options.turns = std::atoi(argv[++i]);
+        } else if (arg == "--reconnect" && has_value) {
+            options.reconnect_every = std::atoi(argv[++i]);
+        } else if (arg == "--listen" && has_value) {
+            options.listen_ms = std::atoi(argv[++i]);
+        } else if (arg == "--reply" && has_value) {
+            options.reply_ms = std::atoi(argv[++i]);
+        } else if (arg == "--interval" && has_value) {
+            options.interval_s = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--warmup" && has_value) {
+            options.warmup_s = std::atoi(argv[++i]);
+            warmup_set = true;
+        } else if (arg == "--stall" && has_value) {
+            options.stall_s = std::atoi(argv[++i]);
+        } else if (arg == "--csv" && has_value) {
+            options.csv_path = argv[++i];
+        } else if (arg == "--log" && has_value) {
+            options.log_path = argv[++i];
+        } else if (arg == "--port" && has_value) {
+            options.port = std::atoi(argv[++i]);
+        } else {
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!warmup_set && options.duration_s > 0) {
+        options.warmup_s = std::min(options.warmup_s, options.duration_s / 5);
+    }
+
+    char dir_template[] = "/tmp/linx-soak.XXXXXX";
+    if (mkdtemp(dir_template) == nullptr) {
+        std::perror("mkdtemp");
+        return 2;
+    }
+    const std::string work_dir = dir_template;
+    if (options.log_path.empty()) {
+        options.log_path = work_dir + "/linx_app.log";
+    }
+    const std::string metrics_socket = work_dir + "/metrics.sock";
+
+    spdlog::set_level(spdlog::level::warn);
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    const AudioProfile profile;
+    SoakServer server(options, profile);
+    if (!server.Start()) {
+        std::fprintf(stderr, "cannot start soak server on 127.0.0.1:%d\n", options.port);
+        return 2;
+    }
+
+    // 被测进程的环境：无声卡后端、本机服务端、指标端点；用户设置的其他 LINX_* 保持不变
+    const std::string url = "ws://127.0.0.1:" + std::to_string(options.port);
+    setenv("LINX_AUDIO_BACKEND", "null", 1);
+    setenv("LINX_WS_URLS", url.c_str(), 1);
+    setenv("LINX_METRICS_SOCKET", metrics_socket.c_str(), 1);
+    setenv("LINX_PROTOCOL_VERSION", "1", 1);  // 模拟服务端只发裸 Opus 负载
+    setenv("LINX_CACHE_DIR", work_dir.c_str(), 0);
+    setenv("LINX_LOG", "warn", 0);
+
+    int stdin_fd = -1;
+    pid_t pid = LaunchApp(options, &stdin_fd);
+    if (pid < 0) {
+        std::perror("launch linx_app");
+        return 2;
+    }
+    std::printf("soak: %s (pid %d) against %s, log %s\n", options.app.c_str(), static_cast<int>(pid), url.c_str(),
+                options.log_path.c_str());
+
+    std::FILE* csv = options.csv_path.empty() ? nullptr : std::fopen(options.csv_path.c_str(), "w");
+    std::vector<std::string> csv_columns;
+    std::map<std::string, Series> series;
+    const Clock::time_point start = Clock::now();
+    Clock::time_point last_progress = start;
+    uint64_t last_turns = 0;
+    int failure = 0;
+
+    while (!g_stop) {
+        // 采样间隔内每 100ms 检查一次被测进程是否退出
+        for (int i = 0; i < options.interval_s * 10 && !g_stop; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            int status = 0;
+            if (waitpid(pid, &status, WNOHANG) == pid) {
+                std::fprintf(stderr, "soak: linx_app exited early (%s %d), see %s\n",
+                             WIFSIGNALED(status) ? "signal" : "status",
+                             WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status), options.log_path.c_str());
+                pid = -1;
+                g_stop = true;
+                failure = 2;
+            }
+        }
+        if (pid < 0) {
+            break;
+        }
+
+        Clock::time_point now = Clock::now();
+        const double elapsed = std::chrono::duration<double>(now - start).count();
+        std::map<std::string, double> sample = ReadMetrics(metrics_socket);
+        sample["rss_bytes"] = ReadStatus(pid, "VmRSS") * 1024;
+        sample["threads"] = ReadStatus(pid, "Threads");
+        sample["fds"] = CountFds(pid);
+        for (const auto& entry : sample) {
+            const SeriesSpec* spec = FindSpec(entry.first);
+            if (spec == nullptr || entry.second < 0) {
+                continue;
+            }
+            Series& s = series[entry.first];
+            s.spec = spec;
+            s.t.push_back(elapsed);
+            s.v.push_back(entry.second);
+        }
+
+        uint64_t turns = server.Turns();
+        if (turns != last_turns) {
+            last_turns = turns;
+            last_progress = now;
+        } else if (options.stall_s > 0 &&
+                   std::chrono::duration<double>(now - last_progress).count() > options.stall_s) {
+            std::fprintf(stderr, "soak: no turn completed in %ds (at turn %llu), see %s\n", options.stall_s,
+                         static_cast<unsigned long long>(turns), options.log_path.c_str());
+            failure = 2;
+            break;
+        }
+
+        if (csv != nullptr) {
+            if (csv_columns.empty()) {
+                for (const auto& entry : series) {
+                    csv_columns.push_back(entry.first);
+                }
+                std::fprintf(csv, "elapsed_s,turns,connections");
+                for (const auto& name : csv_columns) {
+                    std::fprintf(csv, ",%s", name.c_str());
+                }
+                std::fprintf(csv, "\n");
+            }
+            std::fprintf(csv, "%.1f,%llu,%llu", elapsed, static_cast<unsigned long long>(turns),
+                         static_cast<unsigned long long>(server.Connections()));
+            for (const auto& name : csv_columns) {
+                auto it = sample.find(name);
+                std::fprintf(csv, ",%.0f", it != sample.end() ? it->second : -1.0);
+            }
+            std::fprintf(csv, "\n");
+            std::fflush(csv);
+        }
+        std::printf("[%6.0fs] turns %llu, connections %llu, rss %.1f MiB, fds %.0f, threads %.0f\n", elapsed,
+                    static_cast<unsigned long long>(turns), static_cast<unsigned long long>(server.Connections()),
+                    sample["rss_bytes"] / (1 << 20), sample["fds"], sample["threads"]);
+        std::fflush(stdout);
+
+        if ((options.duration_s > 0 && elapsed >= options.duration_s) ||
+            (options.turns > 0 && turns >= static_cast<uint64_t>(options.turns))) {
+            break;
+        }
+    }
+    if (pid > 0) {
+        StopApp(pid, stdin_fd);
+    }
+    if (csv != nullptr) {
+        std::fclose(csv);
+    }
+
+    std::printf("\n%llu turns, %llu connections, %llu server disconnects\n",
+                static_cast<unsigned long long>(server.Turns()),
+                static_cast<unsigned long long>(server.Connections()),
+                static_cast<unsigned long long>(server.Disconnects()));
+    std::printf("%-36s %14s %14s %14s  %s\n", "series", "first min", "last min", "slope/h", "verdict");
+    bool any_growth = false;
+    for (const auto& entry : series) {
+        Verdict verdict = Analyze(entry.second, options.warmup_s);
+        const char* result = !verdict.judged ? "too few samples" : (verdict.growing ? "GROWING" : "ok");
+        any_growth = any_growth || verdict.growing;
+        std::printf("%-36s %14.0f %14.0f %14.1f  %s\n", entry.first.c_str(), verdict.first_min, verdict.last_min,
+                    verdict.slope_per_hour, result);
+    }
+    if (failure != 0) {
+        return failure;
+    }
+    return any_growth ? 1 : 0;
+}
@@ -0,0 +1,155 @@
+/**
+ * @file tap.cc
+ * @brief 音频分接读取示例：映射 LINX_AUDIO_TAP 的共享内存，逐秒打印电平，或把一路流写成裸 PCM
+ * @description 用法：linx_tap [--name /linx-audio-tap] [--stream capture|playout] [--raw <输出.pcm|->] [--seconds N]
+ *              --raw - 写到标准输出，可直接接 aplay -f S16_LE -r <采样率> -c <声道数>；
+ *              发布端重启时自动重新打开，读得太慢被覆盖的帧计入 lost
+ */
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AudioTap.h"
+
+using namespace linx;
+
+namespace {
+
+int Usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [--name <shm name>] [--stream capture|playout] [--raw <out.pcm|->] [--seconds <n>]\n",
+                 argv0);
+    return 1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string name = "/linx-audio-tap";
+    TapStream stream = TapStream::Capture;
+    std::string raw_path;
+    double seconds = 0;  // 0 表示一直运行
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--name" && i + 1 < argc) {
+            name = argv[++i];
+        } else if (arg == "--stream" && i + 1 < argc) {
+            std::string value = argv[++i];
+            if (value == "capture") {
+                stream = TapStream::Capture;
+            } else if (value == "playout") {
+                stream = TapStream::Playout;
+            } else {
+                return Usage(argv[0]);
+            }
+        } else if (arg == "--raw" && i + 1 < argc) {
+            raw_path = argv[++i];
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::atof(argv[++i]);
+        } else {
+            return Usage(argv[0]);
+        }
+    }
+
+    FILE* raw = nullptr;
+    if (raw_path == "-") {
+        raw = stdout;
+    } else if (!raw_path.empty()) {
+        raw = std::fopen(raw_path.c_str(), "wb");
+        if (raw == nullptr) {
+            std::fprintf(stderr, "open %s failed: %s\n", raw_path.c_str(), std::strerror(errno));
+            return 1;
+        }
+    }
+    FILE* log = raw == stdout ? stderr : stdout;
+
+    AudioTapReader reader;
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&]() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+    std::vector<short> copy;
+    bool waiting = false;
+    double sum = 0;
+    uint64_t counted = 0;
+    int16_t peak = 0;
+    uint64_t frames = 0;
+    uint64_t reported_lost = 0;
+    double next_report = 1.0;
+    while (seconds <= 0 || elapsed() < seconds) {
+        if (!reader.IsOpen() || reader.Closed()) {
+            std::string error;
+            if (!reader.Open(name, &error)) {
+                if (!waiting) {
+                    std::fprintf(stderr, "%s, waiting for the publisher\n", error.c_str());
+                    waiting = true;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                continue;
+            }
+            waiting = false;
+            reported_lost = 0;
+            std::fprintf(log, "%s: %s %uHz %dch\n", name.c_str(), stream == TapStream::Capture ? "capture" : "playout",
+                         reader.SampleRate(stream), reader.Channels(stream));
+        }
+        reader.Wait(stream, 100);
+        TapFrame frame;
+        while (reader.Next(stream, &frame)) {
+            // 先在映射内存上算电平，写出前拷贝一份，最后确认槽位没有在读取期间被覆盖
+            double frame_sum = 0;
+            int16_t frame_peak = 0;
+            if (frame.pcm != nullptr) {
+                for (size_t i = 0; i < frame.samples; ++i) {
+                    int32_t s = frame.pcm[i];
+                    frame_sum += static_cast<double>(s) * s;
+                    frame_peak = static_cast<int16_t>(std::max<int32_t>(frame_peak, std::min(std::abs(s), 32767)));
+                }
+            }
+            if (raw != nullptr) {
+                if (frame.pcm != nullptr) {
+                    copy.assign(frame.pcm, frame.pcm + frame.samples);
+                } else {
+                    copy.assign(frame.samples, 0);
+                }
+            }
+            if (!reader.Valid(stream, frame)) {
+                continue;
+            }
+            if (raw != nullptr) {
+                std::fwrite(copy.data(), sizeof(short), copy.size(), raw);
+            }
+            sum += frame_sum;
+            counted += frame.samples;
+            peak = std::max(peak, frame_peak);
+            ++frames;
+        }
+        if (elapsed() >= next_report) {
+            double rms = counted > 0 ? std::sqrt(sum / static_cast<double>(counted)) : 0;
+            double rms_db = rms > 0 ? 20 * std::log10(rms / 32768.0) : -120;
+            double peak_db = peak > 0 ? 20 * std::log10(peak / 32768.0) : -120;
+            uint64_t lost = reader.Lost(stream);
+            std::fprintf(log, "%7.1fs  rms %6.1f dBFS  peak %6.1f dBFS  %llu frames  %llu lost\n", elapsed(), rms_db,
+                         peak_db, static_cast<unsigned long long>(frames),
+                         static_cast<unsigned long long>(lost - reported_lost));
+            std::fflush(log);
+            reported_lost = lost;
+            sum = 0;
+            counted = 0;
+            peak = 0;
+            frames = 0;
+            next_report += 1.0;
+        }
+    }
+    if (raw != nullptr && raw != stdout) {
+        std::fclose(raw);
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+/**
+ * @file transcode.cc
+ * @brief 批量转码工具：把归档的会话 WAV 并行转换为 Ogg/Opus（或 WAV/PCM）
+ * @description 用法：linx_transcode [选项] <输出目录> <输入.wav|输入目录>...
+ *                -j N            工作线程数，默认 CPU 核数
+ *                --format F      opus（默认）、wav 或 pcm
+ *                --rate HZ       输出采样率，默认 16000，0 保持输入
+ *                --channels N    输出声道数，默认 1，0 保持输入
+ *                --bitrate BPS   Opus 码率，默认 24000
+ *                --scaling       依次用 1、2、4 … N 个线程各转换一遍，打印加速比（检查是否随核数线性增长）
+ *              输入目录下的 *.wav 都会转换（不递归），输出文件名为输入文件名换成对应的扩展名
+ */
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AudioConvert.h"
+
+using namespace linx;
+
+namespace {
+
+void Usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [-j threads] [--format opus|wav|pcm] [--rate hz] [--channels n] [--bitrate bps] [--scaling] "
+            "<output-dir> <input.wav|input-dir>...\n",
+            argv0);
+}
+
+bool EndsWith(const std::string& s, const char* suffix) {
+    size_t n = std::strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+// 目录展开为其中的 *.wav（按名称排序），普通文件原样返回
+void CollectInputs(const std::string& path, std::vector<std::string>* inputs) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        inputs->push_back(path);
+        return;
+    }
+    DIR* dir = ::opendir(path.c_str());
+    if (dir == nullptr) {
+        fprintf(stderr, "cannot open %s\n", path.c_str());
+        return;
+    }
+    std::vector<std::string> names;
+    while (struct dirent* entry = ::readdir(dir)) {
+        std::string name = entry->d_name;
+        if (EndsWith(name, ".wav") || EndsWith(name, ".WAV")) {
+            names.push_back(path + "/" + name);
+        }
+    }
+    ::closedir(dir);
+    std::sort(names.begin(), names.end());
+    inputs->insert(inputs->end(), names.begin(), names.end());
+}
+
+std::string OutputPath(const std::string& dir, const std::string& input, const char* ext) {
+    size_t slash = input.find_last_of('/');
+    std::string name = slash == std::string::npos ? input : input.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos) {
+        name.resize(dot);
+    }
+    return dir + "/" + name + ext;
+}
+
+void PrintStats(const AudioConvertBatchStats& stats, bool perWorker) {
+    double wall = std::max(stats.wallSeconds, 1e-9);
+    printf("%zu/%zu files  %.1fs audio  %.3fs wall  %.1fx realtime  %.1f MB/s  %.1f files/s  %zu threads\n",
+           stats.succeeded, stats.jobs, stats.audioSeconds, stats.wallSeconds, stats.audioSeconds / wall,
+           stats.inputBytes / wall / 1e6, stats.jobs / wall, stats.workers.size());
+    if (!perWorker) {
+        return;
+    }
+    for (size_t i = 0; i < stats.workers.size(); ++i) {
+        const AudioConvertWorkerStats& w = stats.workers[i];
+        printf("  worker %-3zu %5zu jobs %4zu stolen %8.1f MB %8.1fs audio  busy %5.1f%%\n", i, w.jobs, w.stolen,
+               w.inputBytes / 1e6, w.audioSeconds, 100.0 * w.busySeconds / wall);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    ConvertFormat format = ConvertFormat::OggOpus;
+    const char* ext = ".opus";
+    AudioConvertOptions options;
+    options.sampleRate = 16000;
+    bool scaling = false;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(arg, "-j") == 0 && hasValue) {
+            threads = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (std::strcmp(arg, "--format") == 0 && hasValue) {
+            std::string value = argv[++i];
+            if (value == "opus") {
+                format = ConvertFormat::OggOpus;
+                ext = ".opus";
+            } else if (value == "wav") {
+                format = ConvertFormat::Wav;
+                ext = ".wav";
+            } else if (value == "pcm") {
+                format = ConvertFormat::Pcm;
+                ext = ".pcm";
+            } else {
+                Usage(argv[0]);
+                return 1;
+            }
+        } else if (std::strcmp(arg, "--rate") == 0 && hasValue) {
+            options.sampleRate = static_cast<unsigned int>(std::atoi(argv[++i]));
+        } else if (std::strcmp(arg, "--channels") == 0 && hasValue) {
+            options.channels = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--bitrate") == 0 && hasValue) {
+            options.opus.bitrate = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--scaling") == 0) {
+            scaling = true;
+        } else if (arg[0] == '-') {
+            Usage(argv[0]);
+            return 1;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() < 2) {
+        Usage(argv[0]);
+        return 1;
+    }
+    const std::string& outDir = positional[0];
+    ::mkdir(outDir.c_str(), 0755);
+
+    std::vector<std::string> inputs;
+    for (size_t i = 1; i < positional.size(); ++i) {
+        CollectInputs(positional[i], &inputs);
+    }
+    std::vector<AudioConvertJob> jobs;
+    jobs.reserve(inputs.size());
+    for (const std::string& input : inputs) {
+        jobs.push_back({input, OutputPath(outDir, input, ext), format});
+    }
+    if (jobs.empty()) {
+        fprintf(stderr, "no input files\n");
+        return 1;
+    }
+
+    if (scaling) {
+        // 先用全部线程转换一遍预热页缓存，之后每一轮都完整转换一遍（输出互相覆盖）
+        convertAudioBatch(jobs, options, threads);
+        double base = 0;
+        for (size_t n = 1;; n = std::min(n * 2, threads)) {
+            AudioConvertBatchStats stats;
+            convertAudioBatch(jobs, options, n, nullptr, &stats);
+            double rate = stats.audioSeconds / std::max(stats.wallSeconds, 1e-9);
+            if (base == 0) {
+                base = rate;
+            }
+            printf("%3zu threads  %8.1fx realtime  speedup %5.2f  efficiency %5.1f%%\n", n, rate, rate / base,
+                   100.0 * rate / base / n);
+            if (n == threads) {
+                break;
+            }
+        }
+        return 0;
+    }
+
+    AudioConvertBatchStats stats;
+    std::vector<bool> results;
+    size_t converted = convertAudioBatch(jobs, options, threads, &results, &stats);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        if (!results[i]) {
+            fprintf(stderr, "failed: %s\n", jobs[i].src.c_str());
+        }
+    }
+    PrintStats(stats, true);
+    return converted == jobs.size() ? 0 : 2;
+}
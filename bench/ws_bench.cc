@@ -0,0 +1,530 @@
+/**
+ * @file ws_bench.cc
+ * @brief WebSocketClient 吞吐与往返延迟基准：进程内启动 libwebsockets 回显服务端，经本机回环测 ws 和 wss
+ * @description 用法：linx_ws_bench [选项]
+ *                --sizes LIST      消息字节数，逗号分隔（默认 32,120,1024,16384）
+ *                --rate N          每秒发送的消息数，0 为满速（默认 0）
+ *                --window W        最多同时在途（已发出、未收到回显）的消息数（默认 64）
+ *                --duration S      每种组合的测量时长，秒（默认 2）
+ *                --type T          binary / text / both（默认 both）
+ *                --transport T     ws / wss / both（默认 both）
+ *                --port P          回显服务端端口，wss 使用 P+1（默认 LINX_BENCH_WS_PORT 或 17682）
+ *
+ *              每条消息开头携带序号和发送时刻（二进制为 16 字节，文本为 32 个十六进制字符），回显服务端原样发回，
+ *              收到回显时得到往返延迟。每种组合先发 100 条预热消息，不计入结果。
+ *              cpu 列为整个进程（发送线程 + 客户端服务线程 + 回显服务端）的 CPU 时间除以回显消息数，
+ *              server 列单独给出回显服务端线程的部分，两者之差即 WebSocketClient 一侧每条消息的开销。
+ *              wss 使用启动时生成的自签名证书（EC P-256），客户端本就接受自签名证书。
+ */
+
+#include <libwebsockets.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "LatencyHistogram.h"
+#include "Log.h"
+#include "Websocket.h"
+
+using namespace linx;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kWarmupMessages = 100;
+constexpr size_t kBinaryHeader = 16;  // 序号 + 发送时刻（ns），各 8 字节
+constexpr size_t kTextHeader = 32;    // 同样的两个值，各 16 个十六进制字符
+
+struct Options {
+    std::vector<size_t> sizes = {32, 120, 1024, 16384};
+    double rate = 0;
+    size_t window = 64;
+    double duration_s = 2;
+    bool binary = true;
+    bool text = true;
+    bool ws = true;
+    bool wss = true;
+    int port = 17682;
+};
+
+uint64_t NowNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+double ReadCpuSeconds(clockid_t clock) {
+    struct timespec ts;
+    if (clock_gettime(clock, &ts) != 0) {
+        return 0;
+    }
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ==================== 回显服务端 ====================
+
+struct EchoMessage {
+    std::vector<unsigned char> buf;  // 前 LWS_PRE 字节为 lws 头部预留
+    size_t len = 0;
+    bool binary = true;
+};
+
+// 每个连接的状态，lws 的 per_session_data 只存放指针（lws 分配的是未构造的内存）
+struct EchoConnection {
+    std::vector<unsigned char> rx;  // 正在重组的消息
+    bool rx_binary = true;
+    std::deque<EchoMessage> out;
+    std::vector<std::vector<unsigned char>> spare;  // 已写出消息的缓冲区，复用以免服务端分配干扰测量
+};
+
+struct EchoSession {
+    EchoConnection* conn;
+};
+
+int EchoCallback(struct lws* wsi, enum lws_callback_reasons reason, void* user, void* in, size_t len) {
+    auto* session = static_cast<EchoSession*>(user);
+    switch (reason) {
+        case LWS_CALLBACK_ESTABLISHED:
+            session->conn = new EchoConnection();
+            break;
+        case LWS_CALLBACK_CLOSED:
+            delete session->conn;
+            session->conn = nullptr;
+            break;
+        case LWS_CALLBACK_RECEIVE: {
+            EchoConnection* conn = session->conn;
+            if (conn == nullptr) {
+                return -1;
+            }
+            if (lws_is_first_fragment(wsi)) {
+                conn->rx.assign(LWS_PRE, 0);
+                conn->rx_binary = lws_frame_is_binary(wsi) != 0;
+            }
+            const auto* data = static_cast<const unsigned char*>(in);
+            conn->rx.insert(conn->rx.end(), data, data + len);
+            if (!lws_is_final_fragment(wsi) || lws_remaining_packet_payload(wsi) > 0) {
+                break;
+            }
+            EchoMessage message;
+            message.len = conn->rx.size() - LWS_PRE;
+            message.binary = conn->rx_binary;
+            if (!conn->spare.empty()) {
+                message.buf = std::move(conn->spare.back());
+                conn->spare.pop_back();
+            }
+            message.buf.swap(conn->rx);  // 重组缓冲区直接交给发送队列，换回一个旧缓冲区
+            conn->rx.clear();
+            conn->out.push_back(std::move(message));
+            lws_callback_on_writable(wsi);
+            break;
+        }
+        case LWS_CALLBACK_SERVER_WRITEABLE: {
+            EchoConnection* conn = session->conn;
+            if (conn == nullptr || conn->out.empty()) {
+                break;
+            }
+            EchoMessage& message = conn->out.front();
+            int n = lws_write(wsi, message.buf.data() + LWS_PRE, message.len,
+                              message.binary ? LWS_WRITE_BINARY : LWS_WRITE_TEXT);
+            if (n < static_cast<int>(message.len)) {
+                return -1;
+            }
+            conn->spare.push_back(std::move(message.buf));
+            conn->out.pop_front();
+            if (!conn->out.empty()) {
+                lws_callback_on_writable(wsi);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return 0;
+}
+
+/**
+ * @brief 本机回显服务端，一个 lws 上下文和一个服务线程；协议名与 WebSocketClient 请求的一致
+ */
+class EchoServer {
+public:
+    bool Start(int port, const std::string& cert_path, const std::string& key_path) {
+        protocols_[0] = {"websocket-protocol", EchoCallback, sizeof(EchoSession), 16384, 0, nullptr, 0};
+        protocols_[1] = {nullptr, nullptr, 0, 0, 0, nullptr, 0};
+        lws_context_creation_info info;
+        memset(&info, 0, sizeof(info));
+        info.port = port;
+        info.iface = "127.0.0.1";
+        info.protocols = protocols_;
+        info.gid = -1;
+        info.uid = -1;
+        if (!cert_path.empty()) {
+            info.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
+            info.ssl_cert_filepath = cert_path.c_str();
+            info.ssl_private_key_filepath = key_path.c_str();
+        }
+        context_ = lws_create_context(&info);
+        if (context_ == nullptr) {
+            return false;
+        }
+        running_ = true;
+        thread_ = std::thread([this] {
+            while (running_ && lws_service(context_, 0) >= 0) {
+            }
+        });
+        if (pthread_getcpuclockid(thread_.native_handle(), &cpu_clock_) != 0) {
+            cpu_clock_ = CLOCK_PROCESS_CPUTIME_ID;
+            has_cpu_clock_ = false;
+        }
+        return true;
+    }
+
+    ~EchoServer() {
+        running_ = false;
+        if (context_) {
+            lws_cancel_service(context_);
+        }
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        if (context_) {
+            lws_context_destroy(context_);
+        }
+    }
+
+    // 服务线程累计 CPU 时间（秒），无法获取线程时钟时返回 -1
+    double CpuSeconds() const { return has_cpu_clock_ ? ReadCpuSeconds(cpu_clock_) : -1; }
+
+private:
+    lws_protocols protocols_[2];
+    lws_context* context_ = nullptr;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    clockid_t cpu_clock_ = CLOCK_PROCESS_CPUTIME_ID;
+    bool has_cpu_clock_ = true;
+};
+
+/**
+ * @brief 生成 wss 回显服务端使用的自签名证书和私钥（PEM）
+ */
+bool WriteSelfSignedCert(const std::string& cert_path, const std::string& key_path) {
+    EVP_PKEY* pkey = nullptr;
+    EVP_PKEY_CTX* pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    bool ok = pctx != nullptr && EVP_PKEY_keygen_init(pctx) > 0 &&
+              EVP_PKEY_CTX_set_ec_paramgen_curve_nid(pctx, NID_X9_62_prime256v1) > 0 &&
+              EVP_PKEY_keygen(pctx, &pkey) > 0;
+    EVP_PKEY_CTX_free(pctx);
+    X509* cert = ok ? X509_new() : nullptr;
+    if (cert != nullptr) {
+        X509_set_version(cert, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("127.0.0.1"), -1,
+                                   -1, 0);
+        X509_set_issuer_name(cert, name);
+        ok = X509_set_pubkey(cert, pkey) == 1 && X509_sign(cert, pkey, EVP_sha256()) > 0;
+    }
+    if (ok) {
+        FILE* key_file = std::fopen(key_path.c_str(), "w");
+        FILE* cert_file = std::fopen(cert_path.c_str(), "w");
+        ok = key_file != nullptr && cert_file != nullptr &&
+             PEM_write_PrivateKey(key_file, pkey, nullptr, nullptr, 0, nullptr, nullptr) == 1 &&
+             PEM_write_X509(cert_file, cert) == 1;
+        if (key_file) {
+            std::fclose(key_file);
+        }
+        if (cert_file) {
+            std::fclose(cert_file);
+        }
+    }
+    X509_free(cert);
+    EVP_PKEY_free(pkey);
+    return ok;
+}
+
+// ==================== 客户端 ====================
+
+bool WaitFor(const std::function<bool()>& done, int timeout_ms) {
+    auto deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (!done()) {
+        if (Clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+void WriteHeader(unsigned char* payload, bool binary, uint64_t seq, uint64_t sent_ns) {
+    if (binary) {
+        memcpy(payload, &seq, sizeof(seq));
+        memcpy(payload + sizeof(seq), &sent_ns, sizeof(sent_ns));
+        return;
+    }
+    char hex[kTextHeader + 1];
+    std::snprintf(hex, sizeof(hex), "%016llx%016llx", static_cast<unsigned long long>(seq),
+                  static_cast<unsigned long long>(sent_ns));
+    memcpy(payload, hex, kTextHeader);
+}
+
+bool ReadHeader(std::string_view message, bool binary, uint64_t& seq, uint64_t& sent_ns) {
+    if (binary) {
+        if (message.size() < kBinaryHeader) {
+            return false;
+        }
+        memcpy(&seq, message.data(), sizeof(seq));
+        memcpy(&sent_ns, message.data() + sizeof(seq), sizeof(sent_ns));
+        return true;
+    }
+    if (message.size() < kTextHeader) {
+        return false;
+    }
+    std::string seq_hex(message.substr(0, 16));
+    std::string time_hex(message.substr(16, 16));
+    seq = std::strtoull(seq_hex.c_str(), nullptr, 16);
+    sent_ns = std::strtoull(time_hex.c_str(), nullptr, 16);
+    return true;
+}
+
+/**
+ * @brief 一种组合（传输 × 消息类型 × 大小）：建立一个连接，按速率和在途窗口发送 duration 秒，统计回显
+ */
+void RunCase(const Options& options, const std::string& url, const char* transport, bool binary, size_t size,
+             const EchoServer& server) {
+    size = std::max(size, binary ? kBinaryHeader : kTextHeader);
+    WebSocketClient client(url);
+    client.SetMaxSendQueue(std::max<size_t>(options.window * 2, 256));
+
+    LatencyHistogram rtt;
+    std::atomic<uint64_t> echoed{0};
+    std::atomic<uint64_t> malformed{0};
+    std::atomic<uint64_t> last_echo_ns{0};
+    client.SetOnMessageViewCallback([&](std::string_view message, bool is_binary) {
+        uint64_t seq = 0;
+        uint64_t sent_ns = 0;
+        if (is_binary != binary || message.size() != size || !ReadHeader(message, binary, seq, sent_ns)) {
+            malformed.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        uint64_t now = NowNs();
+        if (seq >= kWarmupMessages) {
+            rtt.Record((now - sent_ns) / 1000);
+        }
+        last_echo_ns.store(now, std::memory_order_relaxed);
+        echoed.fetch_add(1, std::memory_order_release);
+    });
+    client.start();
+    if (!WaitFor([&] { return client.IsConnected(); }, 5000)) {
+        std::printf("%-5s %-6s %7zu  connect failed\n", transport, binary ? "binary" : "text", size);
+        return;
+    }
+
+    std::vector<unsigned char> payload(size, binary ? 0x5a : 'a');
+    uint64_t sent = 0;
+    uint64_t rejected = 0;
+    auto send_one = [&] {
+        WriteHeader(payload.data(), binary, sent, NowNs());
+        bool ok = binary ? client.send_binary(payload.data(), payload.size())
+                         : client.send_text(std::string_view(reinterpret_cast<const char*>(payload.data()), size));
+        if (ok) {
+            sent++;
+        } else {
+            rejected++;
+        }
+        return ok;
+    };
+    auto wait_window = [&] {
+        while (sent - echoed.load(std::memory_order_acquire) >= options.window) {
+            std::this_thread::yield();
+        }
+    };
+
+    // 预热：连接建立后的第一批消息走冷缓存和 TLS 记录层的初始化，不计入结果
+    while (sent < kWarmupMessages) {
+        wait_window();
+        if (!send_one()) {
+            std::this_thread::yield();
+        }
+    }
+    if (!WaitFor([&] { return echoed.load() >= kWarmupMessages; }, 5000)) {
+        std::printf("%-5s %-6s %7zu  warmup echo timed out\n", transport, binary ? "binary" : "text", size);
+        return;
+    }
+
+    uint64_t base = echoed.load();
+    double cpu_start = ReadCpuSeconds(CLOCK_PROCESS_CPUTIME_ID);
+    double server_start = server.CpuSeconds();
+    uint64_t start_ns = NowNs();
+    auto start = Clock::now();
+    auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.duration_s));
+    uint64_t paced = 0;
+    while (Clock::now() < end) {
+        if (options.rate > 0) {
+            std::this_thread::sleep_until(
+                start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(paced / options.rate)));
+            paced++;
+        }
+        wait_window();
+        send_one();
+    }
+    WaitFor([&] { return echoed.load() >= sent; }, 5000);
+    uint64_t messages = echoed.load() - base;
+    double wall_s = (std::max(last_echo_ns.load(), start_ns) - start_ns) / 1e9;
+    double cpu_us = (ReadCpuSeconds(CLOCK_PROCESS_CPUTIME_ID) - cpu_start) * 1e6;
+    double server_us = server_start >= 0 ? (server.CpuSeconds() - server_start) * 1e6 : -1;
+
+    LatencySummary summary = rtt.Summarize();
+    double per_second = wall_s > 0 ? messages / wall_s : 0;
+    char server_col[16] = "-";
+    if (server_us >= 0 && messages > 0) {
+        std::snprintf(server_col, sizeof(server_col), "%.2f", server_us / messages);
+    }
+    std::printf("%-5s %-6s %7zu %11.0f %9.2f %9llu %9llu %9llu %9.2f %9s %8llu\n", transport,
+                binary ? "binary" : "text", size, per_second, per_second * size / 1e6,
+                static_cast<unsigned long long>(summary.p50_us), static_cast<unsigned long long>(summary.p99_us),
+                static_cast<unsigned long long>(summary.max_us), messages ? cpu_us / messages : 0.0, server_col,
+                static_cast<unsigned long long>(rejected + malformed.load() + (sent - echoed.load())));
+}
+
+void RunTransport(const Options& options, const char* transport, const std::string& url, const EchoServer& server) {
+    for (size_t size : options.sizes) {
+        if (options.binary) {
+            RunCase(options, url, transport, true, size, server);
+        }
+        if (options.text) {
+            RunCase(options, url, transport, false, size, server);
+        }
+    }
+}
+
+bool ParseSizes(const char* list, std::vector<size_t>& sizes) {
+    sizes.clear();
+    const char* p = list;
+    while (*p != '\0') {
+        char* end = nullptr;
+        unsigned long long value = std::strtoull(p, &end, 10);
+        if (end == p || value == 0) {
+            return false;
+        }
+        sizes.push_back(static_cast<size_t>(value));
+        p = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0') {
+            return false;
+        }
+    }
+    return !sizes.empty();
+}
+
+bool ParseChoice(const std::string& value, const char* a, const char* b, bool& use_a, bool& use_b) {
+    use_a = value == a || value == "both";
+    use_b = value == b || value == "both";
+    return use_a || use_b;
+}
+
+void Usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [--sizes LIST] [--rate N] [--window W] [--duration S] [--type binary|text|both]\n"
+                 "          [--transport ws|wss|both] [--port P]\n",
+                 argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (const char* port_env = std::getenv("LINX_BENCH_WS_PORT")) {
+        options.port = std::atoi(port_env);
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        bool ok = true;
+        if (arg == "--sizes" && has_value) {
+            ok = ParseSizes(argv[++i], options.sizes);
+        } else if (arg == "--rate" && has_value) {
+            options.rate = std::atof(argv[++i]);
+        } else if (arg == "--window" && has_value) {
+            options.window = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--duration" && has_value) {
+            options.duration_s = std::atof(argv[++i]);
+        } else if (arg == "--type" && has_value) {
+            ok = ParseChoice(argv[++i], "binary", "text", options.binary, options.text);
+        } else if (arg == "--transport" && has_value) {
+            ok = ParseChoice(argv[++i], "ws", "wss", options.ws, options.wss);
+        } else if (arg == "--port" && has_value) {
+            options.port = std::atoi(argv[++i]);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    spdlog::set_level(spdlog::level::warn);  // 连接建立等INFO日志不计入测量
+    lws_set_log_level(LLL_ERR, nullptr);
+
+    std::string cert_dir;
+    std::string cert_path;
+    std::string key_path;
+    if (options.wss) {
+        char dir_template[] = "/tmp/linx-ws-bench-XXXXXX";
+        if (mkdtemp(dir_template) == nullptr) {
+            std::fprintf(stderr, "mkdtemp failed: %s\n", strerror(errno));
+            return 1;
+        }
+        cert_dir = dir_template;
+        cert_path = cert_dir + "/cert.pem";
+        key_path = cert_dir + "/key.pem";
+        if (!WriteSelfSignedCert(cert_path, key_path)) {
+            std::fprintf(stderr, "failed to generate a self-signed certificate\n");
+            return 1;
+        }
+    }
+
+    std::printf("[ws] loopback echo, window %zu, rate %s, %.1fs per case\n", options.window,
+                options.rate > 0 ? std::to_string(static_cast<long long>(options.rate)).c_str() : "max",
+                options.duration_s);
+    std::printf("%-5s %-6s %7s %11s %9s %9s %9s %9s %9s %9s %8s\n", "proto", "type", "bytes", "msgs/s", "MB/s",
+                "p50 us", "p99 us", "max us", "cpu us", "server us", "drops");
+    int status = 0;
+    if (options.ws) {
+        EchoServer server;
+        if (server.Start(options.port, "", "")) {
+            RunTransport(options, "ws", "ws://127.0.0.1:" + std::to_string(options.port) + "/", server);
+        } else {
+            std::printf("[ws] failed to listen on 127.0.0.1:%d\n", options.port);
+            status = 1;
+        }
+    }
+    if (options.wss) {
+        EchoServer server;
+        if (server.Start(options.port + 1, cert_path, key_path)) {
+            RunTransport(options, "wss", "wss://127.0.0.1:" + std::to_string(options.port + 1) + "/", server);
+        } else {
+            std::printf("[wss] failed to listen on 127.0.0.1:%d\n", options.port + 1);
+            status = 1;
+        }
+        unlink(cert_path.c_str());
+        unlink(key_path.c_str());
+        rmdir(cert_dir.c_str());
+    }
+    return status;
+}
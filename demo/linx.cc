@@ -8,23 +8,93 @@
  */
 
 // 标准库头文件
+#include <algorithm>        // std::max
 #include <atomic>           // 原子操作
+#include <cctype>           // isalnum
+#include <cerrno>           // errno
+#include <chrono>           // 时间
+#include <cmath>            // std::ceil
 #include <condition_variable> // 条件变量
+#include <cstdlib>          // getenv
+#include <cstdint>          // 定长整数
+#include <csignal>          // SIGUSR1/SIGUSR2
+#include <cstdio>           // snprintf
+#include <cstring>          // strerror
+#include <future>           // std::future
 #include <iostream>         // 输入输出流
+#include <map>              // 按格式的上行编码器
 #include <memory>           // 智能指针
 #include <mutex>            // 互斥锁
+#include <sstream>          // 逗号分隔的地址列表
 #include <string>           // 字符串
+#include <string_view>      // 字符串视图
 #include <thread>           // 线程
-#include <queue>            // 队列容器
 #include <vector>           // 向量容器
+#include <fcntl.h>          // O_NONBLOCK
+#include <poll.h>           // poll
+#include <sys/stat.h>       // mkdir
+#include <unistd.h>         // getpid、access
 
 // Linx SDK头文件
+#include "AlsaEngine.h"     // 单线程非阻塞ALSA引擎（仅Linux）
+#include "AssetPlayer.h"    // 预编码提示音资源包的播放
+#include "AudioBlackBox.h"  // 最近几分钟上下行Opus包的黑匣子
+#include "AudioCodec.h"     // 可替换的音频编解码器与格式注册表
 #include "AudioInterface.h" // 音频接口抽象类
+#include "AudioTap.h"       // 供本机其他进程读取的共享内存音频分接
+#include "AudioProfile.h"   // 延迟模式与音频流水线参数
+#include "AutoGainController.h" // 采集自动增益
+#include "BitrateController.h" // 上行自适应比特率
+#include "CapturePump.h"    // 采集-编码-发送帧泵
+#include "DecodeWorker.h"   // 下行解码线程
+#include "DownlinkDecoder.h"  // 按服务器声明的下行格式解码
+#include "DeadlineWatchdog.h" // 实时音频线程的超时看门狗
+#include "DeviceProfile.h"  // 按设备类别成套选择的调优参数（配置文件）
+#include "DriftCompensator.h" // 播放端时钟漂移补偿
+#include "Beamformer.h"     // 麦克风阵列波束形成与声源方位
+#include "ClockSync.h"      // 与服务器的时钟偏移估计（同步播放）
+#include "ControlMessage.h" // 控制消息快速解析与序列化
+#include "ControlServer.h"  // 本地控制套接字（界面/集成程序）
+#include "EchoCanceller.h"  // 回声消除与播放参考信号
+#include "FileAudio.h"      // WAV文件回放音频后端
+#include "FileStream.h"     // WAV读取（唤醒词模板）
 #include "HttpClient.h"     // HTTP客户端
+#include "Downloader.h"     // 可续传的分段并行下载（OTA固件）
+#include "DeltaUpdate.h"    // 差分补丁流式合成新固件
+#include "ResponseCache.h"  // OTA响应的磁盘缓存
+#include "OtaClient.h"      // OTA请求与响应解析
+#include "SessionRecorder.h" // 异步会话录音
+#include "TtsCache.h"       // 重复短句的合成语音缓存
 #include "Json.h"           // JSON处理
+#include "KeywordSpotter.h" // 本地唤醒词检测
 #include "Log.h"            // 日志系统
+#include "NoiseSuppressor.h" // 上行降噪
 #include "Opus.h"           // Opus音频编解码
+#include "PortAudioImpl.h"  // macOS PortAudio实现（全双工模式）
+#include "Reactor.h"        // 单线程事件循环（fd、定时器、任务投递）
+#include "Resampler.h"      // 采样率转换（唤醒词模板）
+#include "SessionState.h"   // 会话状态机（录音/TTS状态、会话代数）
+#include "StartupTasks.h"   // 带依赖的并行/惰性启动任务
+#include "StartupTrace.h"   // 启动阶段瀑布图
+#include "ThreadPolicy.h"   // 实时调度、CPU绑定与内存锁定
+#include "FrameTrace.h"     // 帧级二进制追踪（内存映射环形文件）
+#include "JitterBuffer.h"   // TTS自适应抖动缓冲区
+#include "LatencyCalibrator.h" // 设备回环延迟校准
+#include "OutputMixer.h"    // 多路播放混音（TTS与提示音）
+#include "PlayoutDrain.h"   // TTS播放排空检测
+#include "SentenceScheduler.h" // 按句调度TTS播放
+#include "LatencyTracer.h"  // 端到端延迟直方图
+#include "MetricsServer.h"  // 运行时指标注册表与拉取端点
+#include "MemoryAccounting.h" // 按模块的内存记账与预算
+#include "TelemetryUploader.h" // 批量二进制遥测上报
+#include "CpuAccounting.h"   // 按对话轮次的各线程CPU开销
+#include "LockProfiler.h"    // SDK互斥锁与条件变量的等待/持有时间
+#include "SteadyClock.h"     // 跨模块比较的单调时钟时间戳
+#include "MqttTransport.h"  // 经MQTT代理的控制通道
+#include "WebSocketManager.h" // 多连接共享的lws上下文
+#include "UdpAudioChannel.h" // UDP加密音频通道
 #include "Websocket.h"      // WebSocket客户端
+#include "WebSocketTransport.h" // WebSocket控制通道适配
 
 using namespace linx;
 
@@ -33,7 +103,8 @@ using namespace linx;
 // 服务器配置
 const std::string ota_url = "https://xrobo.qiniuapi.com/v1/ota/";  // OTA固件更新服务器地址
 const std::string ws_url = "ws://xrobo-io.qiniuapi.com/v1/ws/";  // WebSocket服务器地址
-const std::string access_token = "test-token";  // 访问令牌
+const std::string access_token = "test-token";  // 访问令牌（OTA配置中下发token时以下发的为准）
+std::string ws_access_token = access_token;      // 实际使用的访问令牌，在启动WebSocket之前确定
 
 // 设备标识
 const std::string device_mac = "98:a3:16:f9:d9:34";   // 设备MAC地址
@@ -42,59 +113,838 @@ const std::string device_uuid = "98:a3:16:f9:d9:34";  // 设备UUID
 
 
 // 音频参数配置
-const int CHUNK = 960;        // 音频数据块大小（样本数）
 const int SAMPLE_RATE = 16000; // 采样率（Hz）
 const int CHANNELS = 1;       // 声道数（单声道）
 
+/**
+ * @brief 确定要使用的设备配置名
+ * @description LINX_PROFILE=<名称>优先（内置normal/low-latency/battery/far-field，或配置文件中定义的），
+ *              其次是配置文件的"profile"，都没有时按LINX_LATENCY_MODE=low选择low-latency，默认normal
+ */
+std::string DeviceProfileName(const DeviceProfileSet& profiles, bool have_file) {
+    if (const char* env = std::getenv("LINX_PROFILE")) {
+        return env;
+    }
+    if (have_file) {
+        return profiles.DefaultName();
+    }
+    LatencyMode mode = LatencyMode::Normal;
+    const char* env = std::getenv("LINX_LATENCY_MODE");
+    if (env != nullptr && !AudioProfile::ParseMode(env, &mode)) {
+        std::cerr << "unknown LINX_LATENCY_MODE " << env << ", using normal" << std::endl;
+    }
+    return mode == LatencyMode::Low ? "low-latency" : "normal";
+}
+
+/**
+ * @brief 读取设备配置
+ * @description LINX_CONFIG=<文件>指定JSON配置文件（格式见DeviceProfile.h），其中的命名配置成套设置
+ *              帧长、设备周期与缓冲区、编码参数、抖动缓冲目标、音频线程策略、省电和上行处理级；
+ *              各LINX_*环境变量仍可单独覆盖其中的一项。运行中kill -HUP或控制套接字的profile命令重新读取，
+ *              编码参数和抖动缓冲目标立即生效，其余字段记录日志、重启后生效
+ */
+DeviceProfile LoadDeviceProfile() {
+    DeviceProfileSet profiles;
+    const char* path = std::getenv("LINX_CONFIG");
+    std::string error;
+    bool have_file = path != nullptr && *path != '\0';
+    if (have_file && !profiles.LoadFile(path, &error)) {
+        std::cerr << "invalid LINX_CONFIG " << path << ": " << error << ", using built-in profiles" << std::endl;
+        have_file = false;
+    }
+    std::string name = DeviceProfileName(profiles, have_file);
+    DeviceProfile profile;
+    if (!profiles.Find(name, &profile)) {
+        std::cerr << "unknown profile " << name << ", using normal" << std::endl;
+        DeviceProfile::Builtin("normal", &profile);
+    }
+    return profile;
+}
+
+const DeviceProfile device_profile = LoadDeviceProfile();  // 启动时选择的设备配置
+const AudioProfile audio_profile = device_profile.Audio(SAMPLE_RATE, CHANNELS);  // 当前音频流水线配置
+const int FRAME_DURATION_MS = audio_profile.frame_ms;   // 上行Opus帧时长（ms），写入hello的frame_duration
+const int CHUNK = audio_profile.FrameSamples();         // 音频数据块大小（样本数）
+
+/**
+ * @brief 读取音频线程策略
+ * @description 环境变量LINX_AUDIO_THREAD描述音频I/O线程的调度策略，如"fifo:70@1"（SCHED_FIFO优先级70，绑定CPU1）、
+ *              "rr:50"，未设置时取设备配置的策略（默认不改变调度）；无权限时自动降级，实际生效的策略打印在日志中
+ */
+ThreadPolicy LoadAudioThreadPolicy() {
+    ThreadPolicy policy = device_profile.audio_thread;
+    const char* env = std::getenv("LINX_AUDIO_THREAD");
+    if (env != nullptr && !ThreadPolicy::Parse(env, &policy)) {
+        std::cerr << "invalid LINX_AUDIO_THREAD " << env << ", using default scheduling" << std::endl;
+        policy = ThreadPolicy();
+    }
+    policy.prefault_stack = 64 * 1024;
+    return policy;
+}
+
+/**
+ * @brief 读取音频后端
+ * @description 环境变量LINX_AUDIO_BACKEND=auto/alsa/pipewire/pulse/null/sink选择音频后端；默认auto：
+ *              PipeWire守护进程在运行时用原生PipeWire流（小quantum、按流的采样率运行），其次PulseAudio，否则ALSA。
+ *              null/sink不打开声卡，按设备时钟采集静音（LINX_AUDIO_LOOP=<wav|opus>时循环该文件）、丢弃播放数据，
+ *              供无声卡的容器做压测；sink另外每10秒打印一次播放时序
+ */
+AudioBackend LoadAudioBackend() {
+    AudioBackend backend = AudioBackend::Auto;
+    const char* env = std::getenv("LINX_AUDIO_BACKEND");
+    if (env != nullptr && !ParseAudioBackend(env, &backend)) {
+        std::cerr << "unknown LINX_AUDIO_BACKEND " << env << ", using auto" << std::endl;
+    }
+    return backend;
+}
+
+// 音频设备选择，空为默认设备
+struct AudioDeviceSelection {
+    std::string capture;
+    std::string playback;
+    bool lowest_latency = false;
+};
+
+/**
+ * @brief 读取音频设备选择
+ * @description LINX_AUDIO_DEVICE=<设备>同时指定采集和播放设备，LINX_AUDIO_CAPTURE_DEVICE/LINX_AUDIO_PLAYBACK_DEVICE分别覆盖；
+ *              设备可以是LINX_AUDIO_LIST_DEVICES列出的序号、"hw:1,0"/"plughw:1,0"等ALSA设备名（绕过dmix/dsnoop），
+ *              或设备名称中的一段（如"usb"）。LINX_AUDIO_LOWEST_LATENCY=1时按设备支持的最小周期打开
+ */
+AudioDeviceSelection LoadAudioDevices() {
+    AudioDeviceSelection selection;
+    if (const char* env = std::getenv("LINX_AUDIO_DEVICE")) {
+        selection.capture = selection.playback = env;
+    }
+    if (const char* env = std::getenv("LINX_AUDIO_CAPTURE_DEVICE")) {
+        selection.capture = env;
+    }
+    if (const char* env = std::getenv("LINX_AUDIO_PLAYBACK_DEVICE")) {
+        selection.playback = env;
+    }
+    const char* lowest = std::getenv("LINX_AUDIO_LOWEST_LATENCY");
+    selection.lowest_latency = lowest != nullptr && std::string(lowest) == "1";
+    return selection;
+}
+
+/**
+ * @brief ALSA引擎的设备名
+ * @description 引擎直接用snd_pcm_open打开设备：ALSA设备名原样使用，序号和名称片段按audio（ALSA后端）枚举的结果换算为hw:设备
+ */
+std::string ResolveEngineDevice(AudioInterface& alsa, const std::string& spec, bool capture) {
+    if (spec.empty() || spec.find(':') != std::string::npos) {
+        return spec.empty() ? "default" : spec;
+    }
+    std::vector<AudioDeviceInfo> devices = alsa.ListDevices();
+    int index = FindAudioDevice(devices, spec, capture);
+    if (index < 0) {
+        throw std::runtime_error("音频设备不存在: " + spec);
+    }
+    return devices[index].id;
+}
+
+/**
+ * @brief 按环境变量列出音频设备
+ * @description LINX_AUDIO_LIST_DEVICES=1时列出LINX_AUDIO_BACKEND所选后端的全部设备：序号、设备名、名称，
+ *              以及采集/播放各自的声道范围、直接支持的采样率和最小周期，然后退出
+ * @return 已列出设备（进程应退出）时返回true
+ */
+bool ListAudioDevicesFromEnv() {
+    const char* env = std::getenv("LINX_AUDIO_LIST_DEVICES");
+    if (env == nullptr || std::string(env) != "1") {
+        return false;
+    }
+    std::unique_ptr<AudioInterface> backend = CreateAudioInterface(LoadAudioBackend());
+    std::vector<AudioDeviceInfo> devices = backend->ListDevices();
+    if (devices.empty()) {
+        std::cout << "no devices (backend does not support enumeration, or none found)" << std::endl;
+    }
+    for (const AudioDeviceInfo& device : devices) {
+        std::cout << device.index << "  " << device.id << "  " << device.name << std::endl;
+        for (bool capture : {true, false}) {
+            const AudioDeviceCaps& caps = capture ? device.capture : device.playback;
+            if (!caps.supported) {
+                continue;
+            }
+            std::cout << "    " << (capture ? "capture " : "playback") << "  ";
+            if (caps.busy) {
+                std::cout << "busy" << std::endl;
+                continue;
+            }
+            std::cout << caps.min_channels << "-" << caps.max_channels << "ch, rates";
+            for (unsigned int rate : caps.rates) {
+                std::cout << " " << rate;
+            }
+            std::cout << ", min period " << caps.min_period_frames << " frames, min buffer "
+                      << caps.min_buffer_frames << " frames" << std::endl;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 读取二进制分帧版本
+ * @description 环境变量LINX_PROTOCOL_VERSION=2/3启用带帧头的二进制协议（序号、时间戳、长度），
+ *              写入握手头Protocol-Version和hello的version；默认1，即裸Opus负载
+ */
+int LoadProtocolVersion() {
+    const char* env = std::getenv("LINX_PROTOCOL_VERSION");
+    if (env == nullptr) {
+        return 1;
+    }
+    int version = std::atoi(env);
+    if (!IsValidBinaryProtocol(version)) {
+        std::cerr << "unsupported LINX_PROTOCOL_VERSION " << env << ", using 1" << std::endl;
+        return 1;
+    }
+    return version;
+}
+
+const int PROTOCOL_VERSION = LoadProtocolVersion();                 // 二进制分帧版本
+
+/**
+ * @brief 读取省电空闲设置
+ * @description LINX_IDLE_SUSPEND_MS=<毫秒>时启用省电空闲：录音门控连续关闭这么久后暂停采集设备，
+ *              采集线程阻塞到会话状态变化；TTS播完且保活期结束后暂停播放设备，有新数据时恢复。
+ *              默认取设备配置（battery为5000，其余为0即关闭），设备照常持续采集；使用唤醒词时需要持续采集，采集端不会空闲
+ */
+int LoadIdleSuspendMs() {
+    const char* env = std::getenv("LINX_IDLE_SUSPEND_MS");
+    return env != nullptr ? std::max(0, std::atoi(env)) : device_profile.idle_suspend_ms;
+}
+
+const int IDLE_SUSPEND_MS = LoadIdleSuspendMs();                    // 省电空闲延迟（ms），0表示关闭
+
+/**
+ * @brief 读取播放补静音方式
+ * @description LINX_SILENCE_FILL=1时由驱动补静音：ALSA播放端欠载不停流、播出自动清零的区域，
+ *              PipeWire/PortAudio回调本来就在没有数据时补零；播放线程空闲时不再写静音保活，没有数据时什么都不做。
+ *              未设置时取设备配置（battery开启）；后端不支持时照旧由播放线程写静音
+ */
+bool LoadSilenceFill() {
+    const char* env = std::getenv("LINX_SILENCE_FILL");
+    return env != nullptr ? std::string(env) == "1" : device_profile.silence_fill;
+}
+
+const bool SILENCE_FILL = LoadSilenceFill();                        // 由驱动补静音
+
+/**
+ * @brief 读取麦克风阵列几何
+ * @description LINX_MIC_ARRAY=circle:<个数>:<半径mm>（均匀圆阵）、line:<个数>:<间距mm>（均匀线阵），
+ *              或逐个麦克风的坐标 "x,y[;x,y...]"（mm，顺序与采集声道一致）；设置后采集端按麦克风个数的声道打开，
+ *              波束形成合成单声道再做回声消除/降噪/编码，并估计声源方位。未设置或少于2个麦克风时为空（单声道采集）
+ */
+std::vector<MicPosition> LoadMicArray() {
+    const char* env = std::getenv("LINX_MIC_ARRAY");
+    if (env == nullptr || *env == '\0') {
+        return {};
+    }
+    std::string value(env);
+    std::vector<MicPosition> mics;
+    if (value.rfind("circle:", 0) == 0 || value.rfind("line:", 0) == 0) {
+        size_t colon = value.find(':');
+        size_t second = value.find(':', colon + 1);
+        int count = std::atoi(value.c_str() + colon + 1);
+        float size_m = second != std::string::npos ? static_cast<float>(std::atof(value.c_str() + second + 1)) / 1000 : 0;
+        if (size_m > 0) {
+            mics = value[0] == 'c' ? Beamformer::CircularArray(count, size_m) : Beamformer::LinearArray(count, size_m);
+        }
+    } else {
+        size_t start = 0;
+        while (start < value.size()) {
+            size_t end = value.find(';', start);
+            std::string item = value.substr(start, end == std::string::npos ? std::string::npos : end - start);
+            size_t comma = item.find(',');
+            if (comma != std::string::npos) {
+                MicPosition mic;
+                mic.x = static_cast<float>(std::atof(item.c_str())) / 1000;
+                mic.y = static_cast<float>(std::atof(item.c_str() + comma + 1)) / 1000;
+                mics.push_back(mic);
+            }
+            if (end == std::string::npos) {
+                break;
+            }
+            start = end + 1;
+        }
+    }
+    if (mics.size() < 2) {
+        std::cerr << "invalid LINX_MIC_ARRAY " << value << ", using mono capture" << std::endl;
+        return {};
+    }
+    return mics;
+}
+
+const std::vector<MicPosition> MIC_ARRAY = LoadMicArray();          // 麦克风阵列几何，空表示单声道采集
+
+/**
+ * @brief 读取上行帧合并配置
+ * @description LINX_AGGREGATE=auto时在蜂窝链路或高RTT下把多帧Opus合成一条消息，
+ *              =K[:hold_ms]时始终每K帧一条（第一帧最多等hold_ms），=off或未设置时每帧一条；
+ *              需要LINX_PROTOCOL_VERSION=2/3且服务器支持AudioBatch帧
+ */
+AggregationConfig LoadAggregation() {
+    AggregationConfig config;
+    const char* env = std::getenv("LINX_AGGREGATE");
+    if (env == nullptr) {
+        return config;
+    }
+    std::string value(env);
+    std::string mode = value.substr(0, value.find(':'));
+    if (value.find(':') != std::string::npos) {
+        int hold_ms = std::atoi(value.c_str() + value.find(':') + 1);
+        if (hold_ms > 0) {
+            config.max_hold = std::chrono::milliseconds(hold_ms);
+        }
+    }
+    if (mode == "auto") {
+        config.mode = AggregationMode::Auto;
+    } else if (mode != "off") {
+        int frames = std::atoi(mode.c_str());
+        if (frames < 1 || frames > 16) {
+            std::cerr << "invalid LINX_AGGREGATE " << env << ", aggregation off" << std::endl;
+            return AggregationConfig();
+        }
+        config.mode = frames > 1 ? AggregationMode::Fixed : AggregationMode::Off;
+        config.max_frames = static_cast<size_t>(frames);
+    }
+    return config;
+}
+
+const AggregationConfig AGGREGATION = LoadAggregation();               // 上行帧合并
+
+/**
+ * @brief 读取自适应比特率配置
+ * @description LINX_ABR=1时按发送队列深度、发送延迟和RTT在默认区间（12~32kbps）内调整Opus码率，
+ *              =min:max按kbps指定区间；未设置或为0时码率固定为编码器预设
+ * @param enabled 输出是否启用
+ */
+BitrateControllerConfig LoadBitrateConfig(bool* enabled) {
+    BitrateControllerConfig config;
+    const char* env = std::getenv("LINX_ABR");
+    *enabled = env != nullptr && std::string(env) != "0";
+    if (*enabled) {
+        std::string value(env);
+        size_t colon = value.find(':');
+        if (colon != std::string::npos) {
+            int min_kbps = std::atoi(value.substr(0, colon).c_str());
+            int max_kbps = std::atoi(value.c_str() + colon + 1);
+            if (min_kbps > 0 && max_kbps >= min_kbps) {
+                config.min_bitrate = min_kbps * 1000;
+                config.max_bitrate = max_kbps * 1000;
+            } else {
+                std::cerr << "invalid LINX_ABR " << env << ", using defaults" << std::endl;
+            }
+        }
+    }
+    return config;
+}
+
+/**
+ * @brief 读取UDP音频开关
+ * @description LINX_UDP=1时在hello中请求UDP音频通道：服务器在hello的udp对象中下发地址和AES密钥后，
+ *              Opus帧改走UDP（AES-CTR加密），WebSocket只承载JSON控制消息；服务器未下发时仍走WebSocket
+ */
+bool LoadUdpAudio() {
+    const char* env = std::getenv("LINX_UDP");
+    return env != nullptr && std::string(env) == "1";
+}
+
+const bool UDP_AUDIO = LoadUdpAudio();                              // 是否请求UDP音频通道
+
+/**
+ * @brief 读取首选的音频格式
+ * @description LINX_AUDIO_FORMAT=opus（默认）/pcm16/ima_adpcm：hello的audio_params.format为首选格式，
+ *              formats列出全部支持的格式（首选在前），服务器在回复的format中选定双方使用的格式。
+ *              pcm16不压缩（16kHz单声道256kbps，适合局域网），ima_adpcm为其1/4码率，两者的CPU开销都远低于Opus
+ */
+std::string LoadAudioFormat() {
+    const char* env = std::getenv("LINX_AUDIO_FORMAT");
+    if (env == nullptr || *env == '\0') {
+        return kFormatOpus;
+    }
+    if (!CodecRegistry::Instance().Has(env)) {
+        std::cerr << "unknown LINX_AUDIO_FORMAT " << env << " (" << CodecRegistry::Instance().FormatList()
+                  << "), using opus" << std::endl;
+        return kFormatOpus;
+    }
+    return env;
+}
+
+const std::string AUDIO_FORMAT = LoadAudioFormat();                 // 首选的音频格式
+
+enum class TransportMode { WebSocket, Mqtt, Auto };
+
+/**
+ * @brief 读取控制通道类型
+ * @description LINX_TRANSPORT=websocket（默认）时控制消息和音频都走常驻的WebSocket连接；
+ *              =mqtt时空闲期间只保持一条MQTT连接收发控制消息，唤醒（或按键）时发出hello开始会话，
+ *              音频走服务器在hello中下发的UDP通道，goodbye后关闭；=auto时OTA下发了mqtt配置才用MQTT
+ */
+TransportMode LoadTransportMode() {
+    const char* env = std::getenv("LINX_TRANSPORT");
+    if (env == nullptr || std::string(env) == "websocket") {
+        return TransportMode::WebSocket;
+    }
+    if (std::string(env) == "mqtt") {
+        return TransportMode::Mqtt;
+    }
+    if (std::string(env) != "auto") {
+        std::cerr << "unknown LINX_TRANSPORT " << env << ", using auto" << std::endl;
+    }
+    return TransportMode::Auto;
+}
+
+const TransportMode TRANSPORT_MODE = LoadTransportMode();           // 控制通道类型
+
+/**
+ * @brief 读取MQTT控制通道配置
+ * @description 代理地址、client_id、用户名密码和主题取自OTA响应的mqtt对象；LINX_MQTT_URL覆盖代理地址，
+ *              LINX_MQTT_KEEPALIVE_S覆盖心跳间隔（默认240秒，OTA下发时以下发为准）。
+ *              没有client_id时取设备UUID，没有主题时为linx/<设备ID>/up（上行）与linx/<设备ID>/down（下行）
+ * @param ota OTA配置
+ * @param config 输出MQTT客户端配置
+ * @param publish_topic 输出上行主题
+ * @return 有可用的代理地址时返回true
+ */
+bool LoadMqttConfig(const OtaConfig& ota, MqttConfig* config, std::string* publish_topic) {
+    const char* url_env = std::getenv("LINX_MQTT_URL");
+    std::string endpoint = url_env != nullptr ? url_env : ota.mqtt_endpoint;
+    if (endpoint.empty()) {
+        return false;
+    }
+    if (!ParseMqttEndpoint(endpoint, config)) {
+        WARN("invalid MQTT endpoint {}", endpoint);
+        return false;
+    }
+    config->client_id = ota.mqtt_client_id.empty() ? device_uuid : ota.mqtt_client_id;
+    config->username = ota.mqtt_username;
+    config->password = ota.mqtt_password;
+    config->subscribe_topic =
+        ota.mqtt_subscribe_topic.empty() ? "linx/" + device_mac + "/down" : ota.mqtt_subscribe_topic;
+    *publish_topic = ota.mqtt_publish_topic.empty() ? "linx/" + device_mac + "/up" : ota.mqtt_publish_topic;
+    if (ota.mqtt_keepalive_s > 0) {
+        config->keepalive = std::chrono::seconds(ota.mqtt_keepalive_s);
+    }
+    if (const char* keepalive_env = std::getenv("LINX_MQTT_KEEPALIVE_S")) {
+        config->keepalive = std::chrono::seconds(std::max(0, std::atoi(keepalive_env)));
+    }
+    // 与WebSocket一致：LINX_WS_RECONNECT=0时断线即退出
+    const char* reconnect_env = std::getenv("LINX_WS_RECONNECT");
+    config->reconnect = reconnect_env == nullptr || std::string(reconnect_env) != "0";
+    return true;
+}
+const ThreadPolicy audio_thread_policy = LoadAudioThreadPolicy();  // 音频I/O线程策略
+const auto process_start = std::chrono::steady_clock::now();        // 启动计时起点
+std::atomic<double> startup_ready_ms{0};                            // 启动到WebSocket连接建立的耗时（0表示尚未就绪）
+StartupTrace startup_trace(process_start);                          // 启动各阶段的起止时刻
+constexpr double kStartupBudgetMs = 500;                            // 启动到可以开始录音的目标耗时
+
+/**
+ * @brief 读取并行启动开关
+ * @description 默认并行初始化：打开音频设备、等待OTA配置、解析服务器地址、建立连接按依赖关系同时进行；
+ *              LINX_PARALLEL_INIT=0时改为顺序执行，每一步在第一次被用到时才在主线程上执行，便于对比各阶段耗时
+ */
+bool LoadParallelInit() {
+    const char* env = std::getenv("LINX_PARALLEL_INIT");
+    return env == nullptr || std::string(env) != "0";
+}
+
+const bool PARALLEL_INIT = LoadParallelInit();                      // 是否并行初始化
+
+/**
+ * @brief 读取独立解码线程开关
+ * @description 默认下行Opus包在独立的解码线程上解码：WebSocket和UDP接收回调只把包拷进队列，
+ *              lws服务线程不再被TTS解码占用，上行帧的写出不受下行解码负载影响；
+ *              LINX_DECODE_THREAD=0时在接收线程上直接解码
+ */
+bool LoadDecodeThread() {
+    const char* env = std::getenv("LINX_DECODE_THREAD");
+    return env == nullptr || std::string(env) != "0";
+}
+
+const bool DECODE_THREAD = LoadDecodeThread();                      // 是否使用独立解码线程
+
+/**
+ * @brief 读取下行TTS流控参数
+ * @description 抖动缓冲区里只保留播放所需的PCM：解码线程在深度低于目标延迟（开始播放前为起播门限）
+ *              加LINX_TTS_DECODE_AHEAD_MS（默认0，即一个播放周期）时才解码下一包，服务器提前下发的音频
+ *              以Opus压缩形式留在解码队列里，约为PCM的十五分之一，解码均匀分布在播放过程中；
+ *              排队字节数达到LINX_TTS_QUEUE_KB（默认48KB，0关闭）时暂停读取WebSocket，由TCP窗口反压服务器，
+ *              降到一半时恢复。UDP音频无法反压，仍按队列和抖动缓冲区的容量丢弃。只在LINX_DECODE_THREAD开启时生效
+ */
+struct TtsFlowControl {
+    size_t queue_bytes = 48 * 1024;
+    int decode_ahead_ms = 0;  // 0表示一个播放周期
+};
+
+TtsFlowControl LoadTtsFlowControl() {
+    TtsFlowControl flow;
+    if (const char* env = std::getenv("LINX_TTS_QUEUE_KB")) {
+        flow.queue_bytes = static_cast<size_t>(std::max(0, std::atoi(env))) * 1024;
+    }
+    if (const char* env = std::getenv("LINX_TTS_DECODE_AHEAD_MS")) {
+        flow.decode_ahead_ms = std::max(0, std::atoi(env));
+    }
+    return flow;
+}
+
+const TtsFlowControl TTS_FLOW = LoadTtsFlowControl();               // 下行TTS流控参数
+
+/**
+ * @brief 读取多设备同步播放开关
+ * @description LINX_SYNC_PLAYBACK=1时与服务器同步时钟：hello之后连发几次time请求，之后每10秒一次，
+ *              按NTP方式估计本地单调时钟与服务器墙上时间的偏移（取往返最短的样本）。服务器在tts start中
+ *              给出play_at（服务器时间）时，本段第一个样本按设备的输出延迟（snd_pcm_delay）提前取出，
+ *              在换算出的本地时刻从扬声器播出，同一房间的多台设备据此对齐到几毫秒以内
+ */
+bool LoadSyncPlayback() {
+    const char* env = std::getenv("LINX_SYNC_PLAYBACK");
+    return env != nullptr && std::string(env) == "1";
+}
+
+const bool SYNC_PLAYBACK = LoadSyncPlayback();                      // 是否按服务器时间同步播放
+constexpr size_t kClockSyncBurst = 4;                               // hello之后连续请求的样本数
+constexpr auto kClockSyncInterval = std::chrono::seconds(10);       // 之后的请求间隔
+
+/**
+ * @brief 读取乐观开始开关
+ * @description LINX_OPTIMISTIC_START=1时新会话的hello与listen start（唤醒时还有detect）背靠背发出，不等hello回复；
+ *              其间采集的音频留在门控预录环中，服务器回复hello接受会话时随门控打开一并补发，
+ *              首轮对话省去一到两个往返。hello回复之前的listen没有会话ID，需要服务器接受这种顺序
+ */
+bool LoadOptimisticStart() {
+    const char* env = std::getenv("LINX_OPTIMISTIC_START");
+    return env != nullptr && std::string(env) == "1";
+}
+
+const bool OPTIMISTIC_START = LoadOptimisticStart();                // 是否随hello直接发出listen start
+
+/**
+ * @brief 读取断线续接窗口
+ * @description 会话进行中断线、并在LINX_SESSION_RESUME_MS（默认30000，0关闭）内重连成功时，重连的hello带上
+ *              原会话ID和最后收到的下行帧序号请求续接：服务器接受（回复resumed:true）则沿用原会话，从断点继续
+ *              下发，播放缓冲区中的TTS不打断、断线前在录音的继续录音；服务器不认识或拒绝时按新会话处理
+ * @return 续接窗口（毫秒），0表示不续接
+ */
+int LoadSessionResume() {
+    const char* env = std::getenv("LINX_SESSION_RESUME_MS");
+    return env != nullptr ? std::max(0, std::atoi(env)) : 30000;
+}
+
+const int SESSION_RESUME_MS = LoadSessionResume();                  // 断线续接窗口（毫秒）
+
+/**
+ * @brief 读取空闲断开时长
+ * @description LINX_IDLE_DISCONNECT_MS（默认0关闭）：会话结束（goodbye）或连接后等待唤醒时，这么久没有任何收发
+ *              即关闭WebSocket连接，服务器不再为空闲设备保持连接；唤醒词或控制端点的listen start立即重连，
+ *              使用上次连通的IP和缓存的TLS会话，hello（乐观开始时连同唤醒词和listen）在握手完成后立即发出。
+ *              只在有唤醒词或控制端点时生效（否则断开后没有重新开始会话的方式）
+ * @return 空闲时长（毫秒），0表示不断开
+ */
+int LoadIdleDisconnect() {
+    const char* env = std::getenv("LINX_IDLE_DISCONNECT_MS");
+    return env != nullptr ? std::max(0, std::atoi(env)) : 0;
+}
+
+const int IDLE_DISCONNECT_MS = LoadIdleDisconnect();                // 空闲断开时长（毫秒）
+constexpr double kIdleResumeBudgetMs = 150;                         // 空闲断开后从唤醒到会话就绪的目标耗时
+
+/**
+ * @brief 读取退出时限
+ * @description 收到退出请求（回车、SIGTERM/SIGINT或连接最终断开）后，停止各线程、关闭连接的总时限
+ *              LINX_SHUTDOWN_TIMEOUT_MS（默认2000）；其中最多一半用于等待服务器确认WebSocket close帧。
+ *              超过时限仍有线程没有结束时打印卡住的阶段并直接退出进程，不再等待
+ * @return 时限（毫秒），0表示不限时
+ */
+int LoadShutdownTimeout() {
+    const char* env = std::getenv("LINX_SHUTDOWN_TIMEOUT_MS");
+    return env != nullptr ? std::max(0, std::atoi(env)) : 2000;
+}
+
+const int SHUTDOWN_TIMEOUT_MS = LoadShutdownTimeout();              // 退出时限（毫秒）
+
+/**
+ * @brief 读取遥测上报配置
+ * @description LINX_TELEMETRY_URL（默认空，不上报）：把指标注册表中linx_开头的指标每分钟采样为一条增量记录，
+ *              约每LINX_TELEMETRY_INTERVAL_S秒（默认600，±25%随机抖动）合成一个二进制批次POST到该地址；
+ *              失败时指数退避重试，待上传记录最多占用64KB，退出时尝试上传剩余记录
+ * @return 上报配置，url为空表示关闭
+ */
+TelemetryConfig LoadTelemetryConfig() {
+    TelemetryConfig config;
+    if (const char* url = std::getenv("LINX_TELEMETRY_URL")) {
+        config.url = url;
+    }
+    if (const char* interval = std::getenv("LINX_TELEMETRY_INTERVAL_S")) {
+        config.upload_interval_s = static_cast<uint32_t>(std::max(1, std::atoi(interval)));
+    }
+    config.device_id = device_uuid;
+    return config;
+}
+
+const TelemetryConfig TELEMETRY = LoadTelemetryConfig();            // 遥测上报配置
+
+/**
+ * @brief 读取CPU记账配置
+ * @description 各音频/网络线程的CPU时间总是按轮次记账（退出时打印，并导出linx_turn_cpu_*指标）；
+ *              LINX_CPU_ACTIVE_MW=<毫瓦>为一个核满载时比空闲多出的功率，设置后按每轮CPU时间估算能耗
+ * @return CPU记账配置
+ */
+CpuAccountingConfig LoadCpuAccounting() {
+    CpuAccountingConfig config;
+    if (const char* env = std::getenv("LINX_CPU_ACTIVE_MW")) {
+        config.active_power_mw = std::max(0.0, std::atof(env));
+    }
+    return config;
+}
+
+CpuAccounting cpu_accounting(LoadCpuAccounting());                  // 按轮次的各线程CPU开销
+
+/**
+ * @brief 检查是否已可以开始录音
+ * @description 收到服务器hello且采集已经开始时即为就绪（listen-ready），两者在不同线程上发生，各自完成后调用；
+ *              第一次就绪时输出启动瀑布图，超过启动目标耗时给出警告
+ * @return 这一次调用为第一次就绪时返回true（调用方据此播放开机提示音）
+ */
+bool CheckListenReady() {
+    if (!startup_trace.Has("hello") || !startup_trace.Has("capture") || !startup_trace.Mark("listen-ready")) {
+        return false;
+    }
+    double ready_ms = startup_trace.ElapsedMs("listen-ready");
+    INFO("startup: listen ready {:.0f}ms after start ({} init)\n{}", ready_ms,
+         PARALLEL_INIT ? "parallel" : "sequential", startup_trace.Report());
+    if (ready_ms > kStartupBudgetMs) {
+        WARN("startup: listen ready took {:.0f}ms, over the {:.0f}ms budget", ready_ms, kStartupBudgetMs);
+    }
+    return true;
+}
+
+/**
+ * @brief 按环境变量配置日志
+ * @description LINX_LOG_ASYNC=1时日志进入有界队列由后台线程输出，队列满时丢弃最旧的消息，
+ *              采集/播放/网络线程上不再有控制台I/O；LINX_LOG=debug等设置运行时级别（默认info）
+ */
+void SetupLogging() {
+    LogConfig config;
+    const char* async_env = std::getenv("LINX_LOG_ASYNC");
+    config.async = async_env != nullptr && std::string(async_env) == "1";
+    if (const char* level_env = std::getenv("LINX_LOG")) {
+        config.level = spdlog::level::from_str(level_env);
+    }
+    InitLogging(config);
+}
+
+/**
+ * @brief 按环境变量配置内存：线程栈、lws堆记账与内存预算
+ * @description 须在创建任何线程（包括异步日志线程）和lws上下文之前调用。
+ *              LINX_THREAD_STACK=256K设置此后新线程的默认栈大小（glibc默认取ulimit -s，通常8MB虚拟地址）；
+ *              LINX_MEM_BUDGET=48M,network=2M设置RSS与各模块的上限，超出时打印内存报告后abort，
+ *              LINX_MEM_BUDGET_FAIL_FAST=0时只报告不退出；RSS每秒检查一次
+ */
+void SetupMemory() {
+    WebSocketManager::EnableMemoryAccounting();
+    if (const char* stack_env = std::getenv("LINX_THREAD_STACK")) {
+        size_t bytes = 0;
+        std::string error;
+        if (!ParseMemorySize(stack_env, &bytes)) {
+            fprintf(stderr, "LINX_THREAD_STACK: invalid size '%s'\n", stack_env);
+        } else if (!SetDefaultThreadStackSize(bytes, &error)) {
+            fprintf(stderr, "LINX_THREAD_STACK: %s\n", error.c_str());
+        }
+    }
+    const char* budget_env = std::getenv("LINX_MEM_BUDGET");
+    if (budget_env == nullptr) {
+        return;
+    }
+    MemoryBudget budget;
+    const char* fail_fast_env = std::getenv("LINX_MEM_BUDGET_FAIL_FAST");
+    budget.fail_fast = fail_fast_env == nullptr || std::string(fail_fast_env) != "0";
+    if (!MemoryBudget::Parse(budget_env, &budget)) {
+        fprintf(stderr, "LINX_MEM_BUDGET: invalid budget '%s'\n", budget_env);
+        return;
+    }
+    SetMemoryBudget(budget);
+    if (budget.rss_bytes > 0) {
+        std::thread([]() {
+            while (true) {
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+                CheckMemoryBudget();
+            }
+        }).detach();
+    }
+}
+
+/**
+ * @brief 按环境变量配置WebSocket缓冲区
+ * @description LINX_WS_RX_BUFFER为每连接的接收缓冲（默认1024），LINX_WS_TX_PACKET为单次写出的上限（默认0即不限），
+ *              LINX_WS_SERV_BUFFER为lws每线程的服务缓冲（默认0即lws的4096）；小内存设备上可按实际消息大小调小
+ */
+WebSocketBufferConfig LoadWebSocketBuffers() {
+    WebSocketBufferConfig buffers;
+    size_t value = 0;
+    if (const char* env = std::getenv("LINX_WS_RX_BUFFER"); env != nullptr && ParseMemorySize(env, &value)) {
+        buffers.rx_buffer_size = value;
+    }
+    if (const char* env = std::getenv("LINX_WS_TX_PACKET"); env != nullptr && ParseMemorySize(env, &value)) {
+        buffers.tx_packet_size = value;
+    }
+    if (const char* env = std::getenv("LINX_WS_SERV_BUFFER"); env != nullptr && ParseMemorySize(env, &value)) {
+        buffers.pt_serv_buf_size = static_cast<unsigned int>(value);
+    }
+    return buffers;
+}
+
+/**
+ * @brief 按环境变量配置WebSocket的permessage-deflate
+ * @description LINX_WS_DEFLATE=1时在握手中提出permessage-deflate（服务器不接受时照常以未压缩连接），
+ *              只压缩文本控制消息，Opus二进制帧原样发出；LINX_WS_DEFLATE_MIN为压缩文本的最短长度（默认128字节），
+ *              LINX_WS_DEFLATE_LEVEL为zlib压缩级别（默认1）
+ */
+WebSocketDeflateConfig LoadWebSocketDeflate() {
+    WebSocketDeflateConfig deflate;
+    const char* env = std::getenv("LINX_WS_DEFLATE");
+    deflate.enabled = env != nullptr && std::string(env) == "1";
+    size_t value = 0;
+    if (const char* min = std::getenv("LINX_WS_DEFLATE_MIN"); min != nullptr && ParseMemorySize(min, &value)) {
+        deflate.min_text_bytes = value;
+    }
+    if (const char* level = std::getenv("LINX_WS_DEFLATE_LEVEL")) {
+        deflate.level = std::max(0, std::min(9, std::atoi(level)));
+    }
+    return deflate;
+}
+
+/**
+ * @brief 在当前线程上应用音频线程策略并打印实际结果，同时登记CPU记账
+ * @param name 线程名
+ * @param domain 线程CPU时间默认归属的类别（有阶段打点的线程再按阶段细分）
+ * @param priority_offset 相对音频线程的优先级偏移（网络线程取负值，低于音频线程）
+ */
+void ApplyAudioThreadPolicy(const char* name, CpuDomain domain, int priority_offset = 0) {
+    cpu_accounting.RegisterCurrentThread(name, domain);
+    ThreadPolicy policy = audio_thread_policy;
+    policy.name = name;
+    policy.priority = std::max(1, policy.priority + priority_offset);
+    ThreadPolicyResult result = ApplyThreadPolicy(policy);
+    INFO("thread {}: {}", name, result.Describe());
+}
+
+/**
+ * @brief 按设备配置生成抖动缓冲区配置
+ * @description 目标延迟范围和每段TTS开始播放前至少缓冲的解码音频（起播门限）取自设备配置，
+ *              避免一段回复的第一个包刚到就开始播放、紧接着欠载；LINX_PLAYOUT_START_MS=<毫秒>调整，
+ *              0表示只按随网络抖动自适应的目标延迟
+ */
+JitterBufferConfig MakeJitterConfig() {
+    JitterBufferConfig config;
+    config.sample_rate = SAMPLE_RATE;
+    config.channels = CHANNELS;
+    device_profile.ApplyTo(&config);
+    if (const char* env = std::getenv("LINX_PLAYOUT_START_MS")) {
+        config.start_threshold_ms = std::max(0, std::atoi(env));
+    }
+    return config;
+}
+
 // ==================== 音频缓冲区管理 ====================
 
 /**
  * @brief 音频缓冲区类
  * @description 线程安全的音频数据缓冲区，用于解决TTS音频数据不规律到达导致的播放underflow问题
- *              采用生产者-消费者模式，WebSocket线程作为生产者推入音频数据，播放线程作为消费者取出数据
+ *              基于SDK的自适应抖动缓冲区JitterBuffer（内部为无锁SPSC环形缓冲区PcmRing）：
+ *              WebSocket线程作为唯一生产者写入，播放线程作为唯一消费者读出，
+ *              先攒到随网络抖动自适应的目标深度再开始播放，以有界延迟换取无卡顿播放
+ *              容量在启动时一次性分配，稳态下push/pop不做任何内存分配，也不加锁
  */
 struct AudioBuffer {
-    std::queue<std::vector<short>> buffer_queue;  // 音频数据队列
-    std::mutex buffer_mutex;                      // 队列访问互斥锁
-    std::condition_variable buffer_cv;            // 条件变量，用于线程同步
+    JitterBuffer jitter{MakeJitterConfig()};      // TTS抖动缓冲区
+    ProfiledMutex wait_mutex{"tts_wait"};             // 仅用于消费者等待
+    ProfiledConditionVariable buffer_cv{"tts_wait"};  // 条件变量，用于线程同步
     std::atomic<bool> has_data{false};           // 原子布尔值，标识是否有数据
-    
+    bool woken = false;                           // wake()标志，受wait_mutex保护
+    std::atomic<bool> interrupt_pending{false};   // interrupt()请求，播放线程丢弃设备缓冲后清除
+
     /**
      * @brief 向缓冲区推入音频数据
      * @param data 音频数据指针
      * @param size 数据大小（样本数）
      */
     void push(const short* data, size_t size) {
-        std::lock_guard<std::mutex> lock(buffer_mutex);  // 自动加锁
-        std::vector<short> chunk(data, data + size);     // 复制音频数据
-        buffer_queue.push(std::move(chunk));             // 移动语义推入队列
-        has_data = true;                                 // 标记有数据
-        buffer_cv.notify_one();                          // 通知等待的消费者线程
+        jitter.Push(data, size);                  // 直接拷贝进抖动缓冲区，溢出计入jitter统计
+        has_data = true;                          // 标记有数据
+        notify();
+    }
+
+    /**
+     * @brief 生产者已通过jitter.WriteRegion/CommitWrite直接写入数据后调用，唤醒消费者
+     */
+    void commit() {
+        has_data = true;
+        notify();
     }
-    
+
     /**
      * @brief 从缓冲区取出音频数据
-     * @param chunk 输出参数，存储取出的音频数据
-     * @return true表示成功取出数据，false表示队列为空
+     * @param out 输出缓冲区
+     * @param max_size 最多取出的样本数
+     * @return 实际取出的样本数，0表示缓冲区为空
      */
-    bool pop(std::vector<short>& chunk) {
-        std::unique_lock<std::mutex> lock(buffer_mutex);  // 可解锁的锁
-        if (buffer_queue.empty()) {
-            return false;  // 队列为空，返回失败
-        }
-        chunk = std::move(buffer_queue.front());  // 移动语义取出数据
-        buffer_queue.pop();                       // 弹出队列头部
-        has_data = !buffer_queue.empty();         // 更新数据状态
-        return true;
+    size_t pop(short* out, size_t max_size) {
+        size_t n = jitter.Pop(out, max_size);
+        has_data = jitter.Depth() > 0;            // 更新数据状态
+        return n;
+    }
+
+    /**
+     * @brief 等待缓冲区可以开始/继续播放，最多等待timeout
+     * @param timeout 最长等待时间
+     * @return true表示已有可播放数据，false表示超时或被wake()唤醒
+     */
+    bool wait_ready(std::chrono::microseconds timeout) {
+        // 定时开始（同步播放）的到时不会有人通知：最多等到那个时刻；已到时但数据不够时照常等数据
+        uint64_t until_start = jitter.UsUntilStart();
+        if (until_start != UINT64_MAX && until_start > 0) {
+            timeout = std::min(timeout, std::chrono::microseconds(until_start));
+        }
+        std::unique_lock<ProfiledMutex> lock(wait_mutex);
+        bool ready = buffer_cv.wait_for(lock, timeout, [this] { return jitter.Ready() || woken; });
+        woken = false;
+        return ready && jitter.Ready();
+    }
+
+    /**
+     * @brief 打断播放：丢弃抖动缓冲区中已有的数据，并通知播放线程丢弃设备缓冲
+     * @description 任意线程可调用；播放线程最多在一个周期内（阻塞写入返回后）完成设备端的丢弃
+     */
+    void interrupt() {
+        jitter.Flush();
+        interrupt_pending = true;
+        wake();
+    }
+
+    /**
+     * @brief 播放线程：取出并清除interrupt()请求
+     * @return true表示需要丢弃设备缓冲
+     */
+    bool take_interrupt() {
+        return interrupt_pending.exchange(false);
     }
-    
+
     /**
-     * @brief 等待缓冲区有数据
-     * @description 阻塞当前线程直到缓冲区有数据可用
+     * @brief 唤醒阻塞在wait_ready上的消费者（用于退出或打断）
      */
-    void wait_for_data() {
-        std::unique_lock<std::mutex> lock(buffer_mutex);
-        buffer_cv.wait(lock, [this] { return !buffer_queue.empty(); });
+    void wake() {
+        std::lock_guard<ProfiledMutex> lock(wait_mutex);
+        woken = true;
+        buffer_cv.notify_all();
+    }
+
+private:
+    // 总是先拿wait_mutex再通知：消费者在锁内检查jitter.Ready()之后才进入等待，
+    // 生产者拿到锁时要么消费者还没检查（会看到新数据），要么已在等待（收到通知），不会漏掉一次push
+    void notify() {
+        std::lock_guard<ProfiledMutex> lock(wait_mutex);
+        buffer_cv.notify_one();
     }
 };
 
@@ -106,18 +956,1195 @@ struct AudioBuffer {
  */
 struct AudioState {
     std::atomic<bool> running{true};        // 原子布尔值，控制所有线程的运行状态
-    std::string listen_state = "stop";      // 语音识别状态："start"开始录音，"stop"停止录音
-    std::string tts_state = "idle";         // TTS播放状态："start"开始播放，"stop"停止播放，"idle"空闲
-    std::string session_id;                 // WebSocket会话ID
+    SessionState session;                   // 录音/TTS状态与会话ID：网络线程写入，采集线程每帧一次原子读
+    std::atomic<int> server_frame_duration{FRAME_DURATION_MS};  // 服务器hello中声明的下行帧时长（ms）
+    std::atomic<bool> tts_aborted{false};   // 本段TTS已被打断：丢弃服务器仍在下发的音频，直到下一段TTS开始
+    std::atomic<int> wake_pending{-1};      // 唤醒时没有会话：已重新发送hello，服务器回复后以此唤醒词开始录音
+    std::atomic<bool> listen_sent{false};   // 乐观开始：listen start已随hello发出，hello回复时只需打开门控
+    std::atomic<bool> mic_muted{false};     // 麦克风静音（控制端点）：不上传音频、不响应唤醒词
+    std::atomic<int> volume{100};           // 播放音量0-100（控制端点），作用于混音器各路的增益
+
+    // 断线续接（仅网络线程）：断线时记下的会话，重连的hello据此请求续接
+    std::string resume_session;             // 为空表示没有可续接的会话
+    uint32_t resume_sequence = 0;           // 断线前最后收到的下行帧序号
+    bool resume_listening = false;          // 断线前是否在录音
+    std::chrono::steady_clock::time_point resume_since;  // 断线时刻
+    bool resume_requested = false;          // 本次连接的hello带了续接请求
+    std::atomic<uint64_t> resumes{0};       // 服务器接受的续接次数
+    std::atomic<uint64_t> resume_rejects{0};  // 请求了续接但服务器开始了新会话的次数
+
+    // 空闲断开：唤醒（或按键）恢复连接的时刻（steady_clock微秒），服务器回复hello前非0
+    std::atomic<int64_t> idle_resume_us{0};
 };
 
+constexpr int kListenRequested = -2;        // wake_pending：控制端点请求录音，服务器回复hello后直接开始
+
+/**
+ * @brief 生成输出混音器配置
+ * @description 单次混音最多取设备周期和播放块中较大者的4倍，引擎实际周期比请求的大时也不截断；
+ *              LINX_DUCK_GAIN设置提示音播放时TTS被压低到的增益（默认0.3）
+ */
+OutputMixerConfig MakeMixerConfig() {
+    OutputMixerConfig config;
+    config.max_period_samples =
+        static_cast<size_t>(std::max<long>(CHUNK, audio_profile.PeriodSize())) * 4 * CHANNELS;
+    if (const char* env = std::getenv("LINX_DUCK_GAIN")) {
+        config.duck_gain = static_cast<float>(std::atof(env));
+    }
+    return config;
+}
+
 // ==================== 全局对象实例 ====================
 
 AudioBuffer audio_buffer;                           // 音频缓冲区实例
+PlayoutDrain playout_drain;                         // tts stop后等回复从扬声器播完再开始录音
+OutputMixer output_mixer{MakeMixerConfig()};        // TTS与提示音混成一路写入设备
+size_t tts_stream = 0;                              // 混音器中的TTS流（从抖动缓冲区拉取）
+std::unique_ptr<DriftCompensator> tts_drift;        // TTS流的时钟漂移补偿（LINX_DRIFT_COMP=0时为空）
+size_t prompt_stream = 0;                           // 混音器中的提示音流，出声时压低TTS
+size_t wake_earcon = OutputMixer::kNoClip;          // 唤醒提示音（LINX_WAKE_EARCON设置时登记）
+AssetPack asset_pack;                               // 预编码的提示音资源包（LINX_ASSET_PACK设置时映射）
+std::unique_ptr<AssetPlayer> asset_player;          // 资源包片段在提示音流上的播放源
+SentenceScheduler sentence_scheduler{audio_buffer.jitter};  // 按sentence_start/sentence_end分句，报告每句的首样本延迟
+std::atomic<int> sentence_command{0};               // 信号处理函数请求的按句操作（SIGUSR1跳过本句，SIGUSR2播完本句停止）
+std::atomic<bool> profile_reload_requested{false};  // SIGHUP请求重新读取设备配置
+std::atomic<bool> shutdown_requested{false};        // 已请求退出（信号处理函数或连接最终断开时置位）
+int shutdown_pipe[2] = {-1, -1};                    // 退出请求的自唤醒管道：主线程在等待退出时与标准输入一起poll
+std::atomic<const char*> shutdown_stage{"wait"};    // 退出过程当前所处的阶段，超时时打印
+std::mutex shutdown_mutex;                          // 与shutdown_cv配合，退出时唤醒按周期轮询的线程
+std::condition_variable shutdown_cv;
+std::mutex profile_mutex;                           // 串行化设备配置的重新加载（控制套接字与SIGHUP）
+DeviceProfile active_profile = device_profile;      // 当前生效的设备配置，持profile_mutex
 std::unique_ptr<AudioInterface> audio;              // 音频接口智能指针（平台相关实现）
-OpusAudio opus(SAMPLE_RATE, CHANNELS);              // Opus编解码器实例
+OpusEncoderCtx opus_encoder(SAMPLE_RATE, CHANNELS, device_profile.codec);  // 上行编码器，采集线程独占（参数取自设备配置）
+OpusAudioEncoder opus_uplink(opus_encoder);         // 上行格式为opus时采集泵使用的编码器
+std::map<std::string, std::unique_ptr<AudioEncoder>> uplink_encoders;  // 协商出的其他上行格式的编码器，创建后不再销毁（网络线程）
+std::atomic<bool> uplink_opus{true};                // 上行为Opus（黑匣子与Ogg/Opus录音只记录Opus包）
+std::atomic<bool> downlink_opus{true};              // 下行为Opus
+DownlinkDecoder opus_decoder(SAMPLE_RATE, CHANNELS);  // 下行解码器（按hello协商的格式直接解码到播放采样率），解码线程与播放线程的丢包隐藏共用，由decoder_mutex保护
 AudioState linx_state;                              // 全局状态实例
+std::unique_ptr<ControlServer> control_server;      // 本地控制套接字（LINX_CONTROL_SOCKET设置时创建）
+FramePool audio_frames(8, CHUNK * CHANNELS);        // 音频帧池：设备Record/Play与播放线程的帧缓冲区从这里取，稳态不分配内存
+std::mutex decoder_mutex;                           // 保护Opus解码器（接收线程解码/播放线程丢包隐藏）
 WebSocketClient ws_client(ws_url);                  // WebSocket客户端实例
+WebSocketTransport ws_transport(ws_client);         // WebSocket控制通道（默认）
+std::unique_ptr<MqttTransport> mqtt_transport;      // MQTT控制通道（LINX_TRANSPORT=mqtt/auto且有代理地址时创建）
+std::atomic<ControlTransport*> control_transport{&ws_transport};  // 控制消息经过的通道，OTA配置确定后不再变化
+
+/**
+ * @brief 当前的控制通道：hello/listen/abort等控制消息都经它收发
+ */
+ControlTransport& Control() {
+    return *control_transport.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief hello中是否请求UDP音频通道
+ * @description LINX_UDP=1，或控制通道本身不承载音频（MQTT）时
+ */
+bool UdpAudioRequested() {
+    return UDP_AUDIO || !Control().CarriesAudio();
+}
+
+/**
+ * @brief 按当前控制通道构建hello
+ * @description transport取自控制通道（WebSocket为websocket，MQTT为udp）；resume_session非空时请求续接该会话
+ */
+std::string_view HelloMessage(ControlWriter& writer, std::string_view resume_session = {}, uint32_t resume_sequence = 0) {
+    return writer.Hello(SAMPLE_RATE, CHANNELS, FRAME_DURATION_MS, PROTOCOL_VERSION, UdpAudioRequested(),
+                        resume_session, resume_sequence, Control().HelloTransport(), AUDIO_FORMAT,
+                        CodecRegistry::Instance().FormatList(AUDIO_FORMAT));
+}
+
+/**
+ * @brief 取上行格式的编码器
+ * @description opus为按设备配置创建的opus_encoder，其他格式按需从注册表创建一次，之后复用（采集泵可能仍在使用旧的）
+ * @return 格式未注册或创建失败时返回nullptr
+ */
+AudioEncoder* UplinkEncoder(const std::string& format) {
+    if (format == kFormatOpus) {
+        return &opus_uplink;
+    }
+    std::unique_ptr<AudioEncoder>& encoder = uplink_encoders[format];
+    if (!encoder) {
+        AudioCodecConfig config;
+        config.sample_rate = SAMPLE_RATE;
+        config.channels = CHANNELS;
+        config.frame_ms = FRAME_DURATION_MS;
+        encoder = CodecRegistry::Instance().CreateEncoder(format, config);
+    }
+    return encoder.get();
+}
+UdpAudioChannel udp_audio;                          // UDP音频通道（LINX_UDP=1且服务器hello下发时启用）
+ControlParser control_parser;                       // 控制消息解析（仅网络线程使用）
+ControlWriter control_writer;                       // 控制消息序列化（仅网络线程使用）
+ClockSync clock_sync;                               // 与服务器的时钟偏移（LINX_SYNC_PLAYBACK=1时）
+std::atomic<uint64_t> clock_sync_sent_us{0};        // 最近一次time请求的发送时间
+std::shared_ptr<EchoCanceller> echo_canceller;      // 回声消除器（LINX_AEC=1时创建）
+std::shared_ptr<NoiseSuppressor> noise_suppressor;  // 降噪器（LINX_NS=1时创建）
+std::shared_ptr<Beamformer> beamformer;             // 麦克风阵列波束形成（LINX_MIC_ARRAY设置时创建）
+std::shared_ptr<AutoGainController> auto_gain;      // 自动增益（LINX_AGC=1时创建）
+std::shared_ptr<SessionRecorder> session_recorder;  // 会话录音（LINX_RECORD_DIR），音频线程只写内存缓冲区
+std::shared_ptr<EchoReference> echo_reference;      // 播放参考信号：播放路径写入，采集泵取出
+LatencyCalibration latency_calibration;             // 设备回环延迟（LINX_LATENCY_CALIBRATION=1时测得或读出），启动后不再变化
+std::shared_ptr<LatencyTracer> latency_tracer = std::make_shared<LatencyTracer>();  // 各阶段与每轮对话的延迟
+std::shared_ptr<FrameTrace> frame_trace;            // 帧级追踪（LINX_TRACE设置时创建）
+std::unique_ptr<DeadlineWatchdog> deadline_watchdog;  // 采集/播放线程的超时看门狗（LINX_WATCHDOG=0时关闭）
+DeadlineMonitor* playback_deadline = nullptr;       // 播放线程的心跳与阶段打点
+std::unique_ptr<AudioBlackBox> black_box;           // 最近几分钟上下行Opus包（LINX_BLACKBOX设置时创建）
+std::unique_ptr<AudioTap> audio_tap;                // 采集/播放帧的共享内存分接（LINX_AUDIO_TAP设置时创建）
+std::unique_ptr<TtsCache> tts_cache;                // 重复短句的TTS音频缓存（LINX_TTS_CACHE=1时创建）
+std::string tts_cache_format = "opus";              // 服务器hello声明的下行格式，同一句按格式分别缓存（仅网络线程）
+std::atomic<bool> tts_cache_replaying{false};       // 当前这一句从缓存播放：服务器下发的这一句音频不再解码
+std::atomic<uint64_t> tts_interrupts{0};            // 打断次数：排队中的缓存回放据此判断是否已被打断
+std::shared_ptr<TemplateKeywordSpotter> wake_spotter;  // 本地唤醒词（LINX_WAKE_WORDS设置时创建），此时空闲不上行
+
+// 下行指标：接收线程打点，其余指标在main中注册为采样函数
+Counter& tts_packets_received = MetricsRegistry::Global().AddCounter(
+    "linx_tts_packets_received_total", "TTS packets received from the server");
+Counter& tts_packets_decoded = MetricsRegistry::Global().AddCounter(
+    "linx_tts_packets_decoded_total", "TTS packets decoded into the jitter buffer");
+Counter& tts_decode_errors = MetricsRegistry::Global().AddCounter(
+    "linx_tts_decode_errors_total", "TTS packets that failed to decode");
+Counter& tts_decode_us = MetricsRegistry::Global().AddCounter(
+    "linx_tts_decode_us_total", "CPU time spent decoding TTS packets, microseconds");
+
+/**
+ * @brief 按环境变量打开帧追踪文件
+ * @description LINX_TRACE=1时写入/tmp/linx-trace.<pid>.bin，其他非空值作为文件路径；
+ *              每帧音频和每条网络消息记录一条定长二进制记录，用 linx_trace 解码
+ */
+void SetupFrameTrace() {
+    const char* env = std::getenv("LINX_TRACE");
+    if (env == nullptr || *env == '\0' || std::string(env) == "0") {
+        return;
+    }
+    FrameTraceConfig config;
+    config.path = std::string(env) == "1" ? "/tmp/linx-trace." + std::to_string(getpid()) + ".bin" : env;
+    auto trace = std::make_shared<FrameTrace>(config);
+    if (trace->Open()) {
+        frame_trace = trace;
+    }
+}
+
+/**
+ * @brief 创建实时线程看门狗
+ * @description 默认开启（LINX_WATCHDOG=0关闭）；一次循环的忙碌时间超过周期1.5倍时记一次超时并归因到耗时最多的阶段，
+ *              LINX_WATCHDOG_DUMP_DIR设置且帧追踪已打开时，超时后把追踪环快照到该目录
+ */
+void SetupDeadlineWatchdog() {
+    const char* env = std::getenv("LINX_WATCHDOG");
+    if (env != nullptr && std::string(env) == "0") {
+        return;
+    }
+    DeadlineWatchdogConfig config;
+    if (const char* dir = std::getenv("LINX_WATCHDOG_DUMP_DIR")) {
+        config.dump_dir = dir;
+    }
+    deadline_watchdog = std::make_unique<DeadlineWatchdog>(config);
+    deadline_watchdog->SetFrameTrace(frame_trace);
+}
+
+/**
+ * @brief 请求导出黑匣子的信号
+ * @description Linux上为SIGRTMIN+1（kill -RTMIN+1 <pid>），没有实时信号的平台（macOS）为SIGINFO（终端中Ctrl+T）
+ */
+int BlackBoxSignal() {
+#ifdef SIGRTMIN
+    return SIGRTMIN + 1;
+#else
+    return SIGINFO;
+#endif
+}
+
+/**
+ * @brief 信号处理函数：只唤醒黑匣子的导出线程
+ */
+void OnBlackBoxSignal(int) {
+    if (black_box) {
+        black_box->RequestDump();
+    }
+}
+
+/**
+ * @brief 按环境变量创建音频黑匣子
+ * @description LINX_BLACKBOX=<分钟>保留最近这么久的上行和下行Opus包，环形映射到LINX_BLACKBOX_PATH
+ *              （默认/tmp/linx-blackbox.<pid>.bin，崩溃后仍可导出）；收到BlackBoxSignal()或指标端点的
+ *              blackbox命令时导出为Ogg/Opus，写到LINX_BLACKBOX_DIR（默认/tmp）
+ */
+void SetupBlackBox() {
+    const char* env = std::getenv("LINX_BLACKBOX");
+    int minutes = env != nullptr ? std::atoi(env) : 0;
+    if (minutes <= 0) {
+        return;
+    }
+    AudioBlackBoxConfig config;
+    config.duration = std::chrono::minutes(minutes);
+    const char* path = std::getenv("LINX_BLACKBOX_PATH");
+    config.path = path != nullptr ? path : "/tmp/linx-blackbox." + std::to_string(getpid()) + ".bin";
+    if (const char* dir = std::getenv("LINX_BLACKBOX_DIR")) {
+        config.dump_dir = dir;
+    }
+    BlackBoxStreamInfo& uplink = config.stream[static_cast<size_t>(BlackBoxStream::Uplink)];
+    uplink.channels = CHANNELS;
+    uplink.input_rate = SAMPLE_RATE;
+    uplink.pre_skip = static_cast<unsigned int>(opus_encoder.Lookahead()) * 48000 / SAMPLE_RATE;
+    auto box = std::make_unique<AudioBlackBox>(config);
+    if (!box->Open() || !box->Start()) {
+        return;
+    }
+    black_box = std::move(box);
+    std::signal(BlackBoxSignal(), OnBlackBoxSignal);
+    INFO("black box: last {} min of audio, dump with kill -{} {} or the metrics command 'blackbox'", minutes,
+         BlackBoxSignal(), getpid());
+}
+
+/**
+ * @brief 按环境变量创建共享内存音频分接
+ * @description LINX_AUDIO_TAP=<共享内存名>（如/linx-audio-tap，设为1时用默认名）把采集帧（回声消除、降噪、
+ *              自动增益之后）和写入设备的播放帧连同时间戳发布到POSIX共享内存，本机其他进程用AudioTapReader
+ *              零拷贝读取；LINX_AUDIO_TAP_MODE设置共享内存权限（八进制，默认0640）
+ */
+void SetupAudioTap() {
+    const char* env = std::getenv("LINX_AUDIO_TAP");
+    if (env == nullptr || *env == '\0' || std::string(env) == "0") {
+        return;
+    }
+    AudioTapConfig config;
+    if (std::string(env) != "1") {
+        config.name = env[0] == '/' ? env : std::string("/") + env;
+    }
+    if (const char* mode = std::getenv("LINX_AUDIO_TAP_MODE")) {
+        config.mode = static_cast<unsigned int>(std::strtoul(mode, nullptr, 8));
+    }
+    size_t period = static_cast<size_t>(std::max<long>(CHUNK, audio_profile.PeriodSize()));
+    for (AudioTapStreamConfig& stream : config.stream) {
+        stream.sample_rate = SAMPLE_RATE;
+        stream.channels = CHANNELS;
+        stream.slot_samples = period * CHANNELS;
+    }
+    auto tap = std::make_unique<AudioTap>(config);
+    if (tap->Open()) {
+        audio_tap = std::move(tap);
+    }
+}
+
+// 播放线程打点：未启用看门狗时为空操作
+void PlaybackBegin() {
+    if (playback_deadline) {
+        playback_deadline->Begin(DeadlineStage::Process);
+    }
+}
+
+void PlaybackStage(DeadlineStage stage) {
+    if (playback_deadline) {
+        playback_deadline->Enter(stage);
+    }
+}
+
+void PlaybackIdle() {
+    if (playback_deadline) {
+        playback_deadline->Idle();
+    }
+}
+
+/**
+ * @brief TTS数据写入设备后打点
+ * @param device_delay_us 写入时设备中已排队的时长，本轮第一次调用即为首个TTS样本的播出延迟
+ * @param samples 本次写入的样本数
+ */
+void TracePlayed(uint64_t device_delay_us, size_t samples) {
+    if (frame_trace) {
+        frame_trace->Record(TraceStage::PlaybackWrite, samples * sizeof(short),
+                            device_delay_us * SAMPLE_RATE / 1000000);
+    }
+    uint64_t first = latency_tracer->MarkPlayed(device_delay_us);
+    if (first > 0) {
+        INFO("turn: first TTS sample played {:.0f}ms after end of speech", first / 1000.0);
+    }
+}
+
+/**
+ * @brief 按播放设备当前的排队深度打点
+ * @param samples 本次写入的样本数
+ */
+void TracePlayedNow(size_t samples) {
+    long delay = audio->GetPlaybackDelay();
+    TracePlayed(delay > 0 ? static_cast<uint64_t>(delay) * 1000000 / SAMPLE_RATE : 0, samples);
+    // 后端无法报告缓冲深度时按整个设备缓冲估计，宁可晚一点开始录音
+    long queued = delay >= 0 ? delay : audio_profile.PeriodSize() * audio_profile.periods;
+    playout_drain.NoteWritten(static_cast<uint64_t>(queued) * 1000000 / SAMPLE_RATE);
+    sentence_scheduler.OnPlayed(static_cast<uint64_t>(queued) * 1000000 / SAMPLE_RATE);
+}
+
+/**
+ * @brief 每句TTS开始播出时记录首样本延迟
+ * @description 在播放线程上调用；停顿为这一句比上一句连续播完时晚开始的时长，定位多句回复卡在哪一句
+ */
+void LogSentence(const SentenceReport& report) {
+    INFO("sentence {}: first sample {:.0f}ms after sentence_start (first packet {:.0f}ms, buffered {:.0f}ms, "
+         "stall {:.0f}ms) {}",
+         report.index, report.first_play_ms, report.first_packet_ms, report.buffered_ms, report.stall_ms,
+         report.text);
+}
+
+/**
+ * @brief 信号处理函数：只记录请求，由播放线程执行
+ */
+void OnSentenceSignal(int signal) {
+    sentence_command.store(signal, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 执行信号请求的按句操作（播放线程）
+ * @description kill -USR1 跳过正在播放的一句，kill -USR2 播完这一句后停止本段回复（不通知服务器，
+ *              后续句子到达后直接丢弃，tts stop照常触发录音）
+ */
+void HandleSentenceCommand() {
+    int command = sentence_command.exchange(0, std::memory_order_relaxed);
+    if (command == SIGUSR1 && sentence_scheduler.Skip()) {
+        audio_buffer.wake();
+        INFO("sentence skipped");
+    } else if (command == SIGUSR2 && sentence_scheduler.StopAfterSentence()) {
+        INFO("stopping after the current sentence");
+    }
+}
+
+/**
+ * @brief 记录送往扬声器的数据，作为回声消除的参考信号和会话录音的播放流
+ * @param pcm 实际写入设备的数据，nullptr表示静音
+ * @param samples 样本数
+ */
+void FeedEchoReference(const short* pcm, size_t samples) {
+    if (session_recorder) {
+        session_recorder->Push(RecordStream::Playout, pcm, samples);
+    }
+    if (audio_tap) {
+        audio_tap->Publish(TapStream::Playout, pcm, samples, LatencyTracer::NowUs());
+    }
+    if (!echo_reference) {
+        return;
+    }
+    if (pcm != nullptr) {
+        echo_reference->Push(pcm, samples);
+    } else {
+        echo_reference->PushSilence(samples);
+    }
+}
+
+/**
+ * @brief 解码一个下行TTS音频包写入抖动缓冲区
+ * @description 在解码线程上调用（LINX_DECODE_THREAD=0时在接收线程上调用）
+ * @param received_us 包到达接收线程的时间
+ */
+void DecodeTtsPacket(const unsigned char* data, size_t len, uint64_t received_us) {
+    // 排队期间本段TTS被打断或所在句子被跳过
+    if (linx_state.tts_aborted || !sentence_scheduler.AcceptAudio()) {
+        return;
+    }
+    // 直接解码进抖动缓冲区借出的内存，只提交实际解码出的样本，每帧只写一次内存
+    int decoded = 0;
+    {
+        std::lock_guard<std::mutex> lock(decoder_mutex);  // 播放线程的丢包隐藏也会用到解码器
+        uint64_t decode_start_us = LatencyTracer::NowUs();
+        audio_buffer.jitter.SetArrivalTime(received_us);  // 在队列中等待过时，到达抖动仍按网络到达时间估计
+        decoded = opus_decoder.DecodeInto(audio_buffer.jitter, data, len);
+        tts_decode_us.Add(LatencyTracer::NowUs() - decode_start_us);
+    }
+    if (decoded > 0) {
+        tts_packets_decoded.Add();
+        latency_tracer->RecordSince(LatencyStage::ReceiveToDecode, received_us);
+        sentence_scheduler.OnAudio();
+        audio_buffer.commit();  // 唤醒播放线程
+    } else {
+        tts_decode_errors.Add();
+    }
+}
+
+// 下行解码线程：接收线程只入队，TTS句子边界和流结束通过Post排在已到达的音频之后生效
+DecodeWorker tts_decoder(DecodeTtsPacket, 1024);  // 流控开启时，超出解码提前量的包在这里排队
+
+/**
+ * @brief 本地打断TTS播放
+ * @description 丢弃抖动缓冲区和设备中尚未播出的数据、复位解码器，并丢弃本段TTS后续到达的音频；
+ *              播放线程在一个周期内完成设备端的丢弃，之后即可重新播放或录音
+ */
+void InterruptPlayback() {
+    linx_state.tts_aborted = true;
+    tts_interrupts++;
+    tts_cache_replaying = false;
+    if (tts_cache) {
+        tts_cache->AbortRecord();  // 不完整的一句不写入缓存
+    }
+    tts_decoder.Flush();  // 排队中尚未解码的包不再解码
+    {
+        std::lock_guard<std::mutex> lock(decoder_mutex);
+        opus_decoder.Reset();
+    }
+    audio_buffer.interrupt();
+    sentence_scheduler.Cancel();
+}
+
+/**
+ * @brief 会话结束后安排空闲断开
+ * @description LINX_IDLE_DISCONNECT_MS内没有新的收发时关闭连接；只在有唤醒词或控制端点能重新开始会话时生效
+ */
+void ArmIdleDisconnect() {
+    if (IDLE_DISCONNECT_MS > 0 && (wake_spotter || control_server)) {
+        Control().SuspendWhenIdle(std::chrono::milliseconds(IDLE_DISCONNECT_MS));
+    }
+}
+
+/**
+ * @brief 空闲断开后恢复连接
+ * @description 连接已因空闲关闭时立即重连（缓存的IP和TLS会话，不经退避）并返回true：
+ *              调用方不再自己发送hello，由连接建立回调发出；未断开时返回false，照常发送
+ */
+bool ResumeIdleConnection() {
+    // 先记下时刻：空闲连接的关闭回调可能在Resume返回前执行，据此识别为空闲关闭
+    linx_state.idle_resume_us = static_cast<int64_t>(SteadyNowUs());
+    if (!Control().Resume()) {
+        linx_state.idle_resume_us = 0;
+        return false;
+    }
+    linx_state.listen_sent = false;
+    INFO("resuming idle connection");
+    return true;
+}
+
+/**
+ * @brief 打断TTS并通知服务器停止下发（用户插话）
+ */
+void AbortSpeaking() {
+    InterruptPlayback();
+    thread_local ControlWriter abort_writer;  // 在采集线程上调用，与网络线程的control_writer分开
+    Control().SendText(abort_writer.Abort(linx_state.session.SessionId()));
+    INFO(">> abort");
+}
+
+/**
+ * @brief 处理一个下行TTS音频包
+ * @description WebSocket二进制消息和UDP音频通道收到的Opus包都从这里交给解码线程，
+ *              解码进同一个抖动缓冲区；在各自的接收线程上调用
+ */
+void HandleTtsPacket(const unsigned char* data, size_t len) {
+    if (black_box && downlink_opus.load(std::memory_order_relaxed)) {
+        black_box->Push(BlackBoxStream::Downlink, data, len);  // 记录服务器发来的全部音频，包括随后丢弃的
+    }
+    // 本段TTS已被打断：服务器停止前仍在途的音频直接丢弃
+    if (linx_state.tts_aborted) {
+        return;
+    }
+    // 所在的句子已被跳过，或本段回复在上一句句尾停止
+    if (!sentence_scheduler.AcceptAudio()) {
+        if (tts_cache) {
+            tts_cache->AbortRecord();
+        }
+        return;
+    }
+    // 这一句已从本地缓存播放，服务器的音频只用于黑匣子
+    if (tts_cache_replaying) {
+        return;
+    }
+    if (tts_cache) {
+        tts_cache->Append(data, len);
+    }
+
+    uint64_t received_us = LatencyTracer::NowUs();
+    tts_packets_received.Add();
+    if (session_recorder && downlink_opus.load(std::memory_order_relaxed)) {
+        session_recorder->PushPacket(RecordStream::Playout, data, len);  // 仅Ogg/Opus录音
+    }
+    uint64_t first_byte = latency_tracer->MarkFirstByte();
+    if (first_byte > 0) {
+        INFO("turn: first TTS packet {:.0f}ms after end of speech", first_byte / 1000.0);
+    }
+    // 超过流控高水位时暂停WebSocket读取；队列已满（UDP无法反压时）丢弃，计入linx_tts_decode_queue_drops_total
+    tts_decoder.Push(data, len, received_us);
+}
+
+/**
+ * @brief 一句TTS开始：缓存命中时从本地播放这一句，否则开始录制服务器下发的音频
+ * @description 在网络线程上、BeginSentence投递之后调用。缓存键为句子文本加下行格式，服务器在
+ *              sentence_start中给出audio_hash时一并计入（音色等变化后不会播出旧的音频）。
+ *              命中时缓存的包交给解码线程一次解码进抖动缓冲区，服务器随后下发的这一句音频直接丢弃
+ */
+void BeginCachedSentence(const ControlMessage& message) {
+    tts_cache_replaying = false;
+    if (!tts_cache) {
+        return;
+    }
+    if (!tts_cache->Cacheable(message.text)) {
+        tts_cache->AbortRecord();
+        return;
+    }
+    std::string variant = tts_cache_format;
+    if (!message.audio_hash.empty()) {
+        variant += '/';
+        variant.append(message.audio_hash);
+    }
+    uint64_t key = TtsCache::MakeKey(message.text, variant);
+    std::shared_ptr<const TtsCacheEntry> entry = tts_cache->Find(key);
+    if (!entry) {
+        tts_cache->BeginRecord(key);
+        return;
+    }
+    tts_cache->AbortRecord();
+    tts_cache_replaying = true;
+    uint64_t first_byte = latency_tracer->MarkFirstByte();
+    if (first_byte > 0) {
+        INFO("turn: first TTS packet {:.0f}ms after end of speech (cached)", first_byte / 1000.0);
+    }
+    if (session_recorder && downlink_opus.load(std::memory_order_relaxed)) {
+        for (size_t i = 0; i < entry->Packets(); ++i) {
+            size_t len = 0;
+            const unsigned char* data = entry->Packet(i, &len);
+            session_recorder->PushPacket(RecordStream::Playout, data, len);
+        }
+    }
+    uint64_t received_us = LatencyTracer::NowUs();
+    tts_decoder.Post([entry, received_us, interrupts = tts_interrupts.load()]() {
+        // 回放期间被打断时停止（Flush不会丢弃已投递的任务）
+        for (size_t i = 0; i < entry->Packets() && tts_interrupts.load() == interrupts; ++i) {
+            size_t len = 0;
+            const unsigned char* data = entry->Packet(i, &len);
+            DecodeTtsPacket(data, len, received_us);
+        }
+    });
+}
+
+/**
+ * @brief 一句TTS结束：完整录制到的一句写入缓存
+ * @description 在网络线程上调用
+ */
+void EndCachedSentence() {
+    if (tts_cache && !tts_cache_replaying) {
+        tts_cache->Commit();
+    }
+    tts_cache_replaying = false;
+}
+
+/**
+ * @brief 按服务器hello中的udp参数建立UDP音频通道
+ * @description 参数缺失或无效时关闭通道，音频回落到WebSocket；在网络线程上调用
+ */
+void SetupUdpAudio(const ControlMessage& hello) {
+    // MQTT控制通道不能承载音频，没有UDP通道时这次会话没有音频
+    const char* fallback = Control().CarriesAudio() ? "audio stays on the WebSocket" : "session has no audio channel";
+    UdpAudioConfig config;
+    if (!hello.has_udp || hello.udp_server.empty() || hello.udp_port <= 0 || hello.udp_port > 65535 ||
+        !DecodeHex(hello.udp_key, &config.key) || !DecodeHex(hello.udp_nonce, &config.nonce)) {
+        if (hello.has_udp) {
+            WARN("invalid udp parameters in server hello, {}", fallback);
+        }
+        udp_audio.Close();
+        return;
+    }
+    config.server = std::string(hello.udp_server);
+    config.port = static_cast<uint16_t>(hello.udp_port);
+    if (!udp_audio.Open(config)) {
+        WARN("udp audio unavailable, {}", fallback);
+        return;
+    }
+    udp_audio.SetPacketHandler([](const unsigned char* data, size_t len, uint32_t) { HandleTtsPacket(data, len); });
+    if (!udp_audio.Start()) {
+        udp_audio.Close();
+        WARN("udp audio unavailable, {}", fallback);
+    }
+}
+
+/**
+ * @brief listen消息的模式
+ * @description 启用回声消除时播放TTS期间也保持录音（可随时打断），使用realtime模式；否则为auto
+ */
+const char* ListenMode() {
+    return echo_canceller ? "realtime" : "auto";
+}
+
+/**
+ * @brief 回复播完后开始录音
+ * @description 由播放线程（或ALSA引擎回调）在tts stop之后、抖动缓冲区和设备缓冲都播完时调用
+ */
+void ListenAfterPlayout() {
+    thread_local ControlWriter drain_writer;  // 在播放线程上调用，与网络线程的control_writer分开
+    linx_state.session.SetListen(ListenState::Start);  // 重新开始录音
+    Control().SendText(drain_writer.Listen(linx_state.session.SessionId(), "start", ListenMode()));
+    PlayoutDrainStats stats = playout_drain.GetStats();
+    INFO("playout drained {:.0f}ms after tts stop, listening", stats.last_wait_ms);
+}
+
+/**
+ * @brief 读取16位WAV的第一个声道并转换到SAMPLE_RATE
+ * @param path WAV路径
+ * @param mono 输出的单声道样本
+ * @return 文件不存在或不是16位WAV时返回false
+ */
+bool LoadWavMono(const std::string& path, std::vector<short>* mono) {
+    PcmReader reader;
+    if (reader.open(path) != 0 || reader.info().bitsPerSample != 16) {
+        return false;
+    }
+    int channels = std::max(1, reader.info().numChannels);
+    std::vector<short> interleaved(reader.remaining() / sizeof(short));
+    interleaved.resize(reader.readChunk(interleaved.data(), interleaved.size() * sizeof(short)) / sizeof(short));
+    mono->resize(interleaved.size() / channels);
+    for (size_t i = 0; i < mono->size(); ++i) {
+        (*mono)[i] = interleaved[i * channels];
+    }
+    if (reader.info().sampleRate != static_cast<unsigned int>(SAMPLE_RATE)) {
+        Resampler resampler(reader.info().sampleRate, SAMPLE_RATE, 1, mono->size());
+        std::vector<short> resampled(resampler.MaxOutputFrames(mono->size()));
+        resampled.resize(resampler.Process(mono->data(), mono->size(), resampled.data(), resampled.size()));
+        mono->swap(resampled);
+    }
+    return true;
+}
+
+/**
+ * @brief 创建TTS流的时钟漂移补偿
+ * @description 服务端按自己的时钟下发音频，扬声器按声卡晶振消耗，几十ppm的偏差在长时间连续播放中
+ *              会让抖动缓冲区慢慢变深（延迟变大）或被取空（欠载）。默认开启，按缓冲深度相对目标的
+ *              长期趋势微调消耗速率（至多±500ppm）；LINX_DRIFT_COMP=0关闭，TTS直接从抖动缓冲区拉取
+ */
+void SetupDriftCompensation() {
+    const char* env = std::getenv("LINX_DRIFT_COMP");
+    if (env != nullptr && std::string(env) == "0") {
+        return;
+    }
+    DriftCompensatorConfig config;
+    config.sample_rate = SAMPLE_RATE;
+    config.channels = CHANNELS;
+    config.max_period_samples = MakeMixerConfig().max_period_samples;
+    tts_drift = std::make_unique<DriftCompensator>(config, [](short* out, size_t samples) {
+        return audio_buffer.pop(out, samples);
+    });
+}
+
+/**
+ * @brief TTS流的数据源：按所取样本数推进时钟漂移补偿，再从抖动缓冲区拉取
+ * @param out 输出缓冲区
+ * @param samples 最多取出的样本数
+ * @return 实际取出的样本数
+ */
+size_t PullTts(short* out, size_t samples) {
+    size_t pulled = 0;
+    if (!tts_drift) {
+        pulled = audio_buffer.pop(out, samples);
+    } else {
+        const JitterBuffer& jitter = audio_buffer.jitter;
+        const double samples_per_ms = SAMPLE_RATE * CHANNELS / 1000.0;
+        tts_drift->Update(jitter.Depth() / samples_per_ms, jitter.TargetDelayMs(), samples / samples_per_ms / 1000.0,
+                          jitter.Playing());
+        pulled = tts_drift->Pull(out, samples);
+    }
+    tts_decoder.SinkChanged();  // 按需解码：解码线程等待时立即补上下一个周期
+    return pulled;
+}
+
+/**
+ * @brief 登记混音器的各路输入
+ * @description TTS流从抖动缓冲区拉取（经时钟漂移补偿）；提示音流播放事先解码好的片段和资源包中的片段，
+ *              出声时把TTS压低。LINX_ASSET_PACK=<资源包>映射预编码的提示音（startup、disconnected、
+ *              network_error、wake，见PlayPrompt），播放时才按周期解码；
+ *              LINX_WAKE_EARCON=<wav>设置唤醒词命中时播放的提示音（优先于资源包中的wake）
+ */
+void SetupOutputMixer() {
+    SetupDriftCompensation();
+    MixerStreamConfig tts_config;
+    tts_config.name = "tts";
+    tts_stream = output_mixer.AddStream(tts_config, PullTts);
+    MixerStreamConfig prompt_config;
+    prompt_config.name = "prompt";
+    prompt_config.ducks_others = true;
+    const char* pack_env = std::getenv("LINX_ASSET_PACK");
+    std::string pack_error;
+    if (pack_env != nullptr && *pack_env != '\0') {
+        if (!asset_pack.Open(pack_env, &pack_error)) {
+            WARN("asset pack: {}", pack_error);
+        } else {
+            auto player = std::make_unique<AssetPlayer>(asset_pack, SAMPLE_RATE, CHANNELS);
+            if (player->Valid()) {
+                asset_player = std::move(player);
+                asset_pack.Prefetch();  // 异步预读，不阻塞启动
+                INFO("asset pack: {} clips in {}", asset_pack.Count(), pack_env);
+            }
+        }
+    }
+    if (asset_player) {
+        prompt_stream = output_mixer.AddStream(
+            prompt_config, [](short* out, size_t samples) { return asset_player->Pull(out, samples); },
+            []() { return asset_player->Active(); });
+    } else {
+        prompt_stream = output_mixer.AddStream(prompt_config);
+    }
+
+    const char* earcon_env = std::getenv("LINX_WAKE_EARCON");
+    if (earcon_env == nullptr || *earcon_env == '\0') {
+        return;
+    }
+    std::vector<short> mono;
+    if (!LoadWavMono(earcon_env, &mono)) {
+        WARN("wake earcon: {} is not a 16-bit WAV", earcon_env);
+        return;
+    }
+    std::vector<short> clip(mono.size() * CHANNELS);
+    for (size_t i = 0; i < clip.size(); ++i) {
+        clip[i] = mono[i / CHANNELS];
+    }
+    wake_earcon = output_mixer.AddClip(std::move(clip));
+    INFO("wake earcon: {} ({}ms)", earcon_env, mono.size() * 1000 / SAMPLE_RATE);
+}
+
+/**
+ * @brief 播放资源包中的提示音
+ * @description 没有资源包或包中没有这一段时不播放；可在任意线程调用
+ * @return 开始播放时返回true
+ */
+bool PlayPrompt(std::string_view name) {
+    if (!asset_player || !asset_player->Play(name)) {
+        return false;
+    }
+    audio_buffer.wake();  // 播放线程可能正阻塞在空闲等待上
+    return true;
+}
+
+/**
+ * @brief 加载唤醒词模板
+ * @param spec 逗号分隔的"唤醒词=模板WAV路径"，同一唤醒词可以出现多次（多录几遍更稳）
+ * @description 模板取第一个声道，采样率与SAMPLE_RATE不同时先重采样；首尾静音由检测器裁掉。
+ *              LINX_WAKE_THRESHOLD调整命中阈值（平均倒谱距离，越小越严格）
+ * @return 至少登记了一个模板时返回检测器，否则返回nullptr
+ */
+std::shared_ptr<TemplateKeywordSpotter> LoadWakeWords(const std::string& spec) {
+    TemplateSpotterConfig config;
+    config.sample_rate = SAMPLE_RATE;
+    config.channels = CHANNELS;
+    if (const char* threshold_env = std::getenv("LINX_WAKE_THRESHOLD")) {
+        config.threshold = std::atof(threshold_env);
+    }
+    auto spotter = std::make_shared<TemplateKeywordSpotter>(config);
+
+    size_t begin = 0;
+    while (begin < spec.size()) {
+        size_t end = spec.find(',', begin);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+        std::string entry = spec.substr(begin, end - begin);
+        begin = end + 1;
+        size_t eq = entry.find('=');
+        if (eq == std::string::npos || eq == 0) {
+            WARN("wake word: ignoring '{}', expected <word>=<template.wav>", entry);
+            continue;
+        }
+        std::string word = entry.substr(0, eq);
+        std::string path = entry.substr(eq + 1);
+
+        std::vector<short> mono;
+        if (!LoadWavMono(path, &mono)) {
+            WARN("wake word: {} is not a 16-bit WAV", path);
+            continue;
+        }
+        if (spotter->AddTemplate(word, mono.data(), mono.size()) < 0) {
+            WARN("wake word: {} has too little speech for a template", path);
+            continue;
+        }
+        INFO("wake word: '{}' template {}", word, path);
+    }
+    return spotter->Templates() > 0 ? spotter : nullptr;
+}
+
+/**
+ * @brief 唤醒词命中（采集线程）
+ * @description 打断正在播放的TTS，发送listen detect和start后打开采集门控，
+ *              门控预录中的唤醒词和随后的语音起始在下一帧一并发出。
+ *              会话已结束（goodbye之后）时先重新发送hello，等服务器回复了新会话再开始
+ */
+void OnWakeWord(int keyword) {
+    if (linx_state.mic_muted) {
+        return;
+    }
+    std::string_view word = wake_spotter->Keyword(keyword);
+    INFO("wake word: '{}'", word);
+    if (!linx_state.tts_aborted && (audio_buffer.jitter.Playing() || audio_buffer.jitter.Depth() > 0)) {
+        AbortSpeaking();
+    }
+    if (wake_earcon != OutputMixer::kNoClip) {
+        output_mixer.Play(prompt_stream, wake_earcon);
+        audio_buffer.wake();  // 播放线程可能正阻塞在空闲等待上
+    } else {
+        PlayPrompt("wake");
+    }
+    thread_local ControlWriter wake_writer;  // 在采集线程上调用，与网络线程的control_writer分开
+    if (ResumeIdleConnection()) {
+        linx_state.wake_pending = keyword;  // hello（乐观开始时连同唤醒词和listen）在连接建立时发出
+        return;
+    }
+    std::string session_id = linx_state.session.SessionId();
+    if (session_id.empty()) {
+        if (OPTIMISTIC_START) {
+            // detect和listen随hello一并发出，hello回复时不再重发
+            linx_state.wake_pending = kListenRequested;
+            linx_state.listen_sent = true;
+            Control().SendText(HelloMessage(wake_writer));
+            Control().SendText(wake_writer.Detect({}, word));
+            Control().SendText(wake_writer.Listen({}, "start", ListenMode()));
+            return;
+        }
+        linx_state.wake_pending = keyword;
+        Control().SendText(HelloMessage(wake_writer));
+        return;
+    }
+    Control().SendText(wake_writer.Detect(session_id, word));
+    Control().SendText(wake_writer.Listen(session_id, "start", ListenMode()));
+    linx_state.session.SetListen(ListenState::Start);
+}
+
+// ==================== 本地控制端点 ====================
+
+/**
+ * @brief 手动开始录音（控制端点的listen start，相当于按键说话）
+ * @description 正在播放TTS时先打断；会话已结束（goodbye之后）时重新发送hello，服务器回复后开始录音
+ */
+void StartListening() {
+    if (!linx_state.tts_aborted && (audio_buffer.jitter.Playing() || audio_buffer.jitter.Depth() > 0)) {
+        AbortSpeaking();
+    }
+    thread_local ControlWriter listen_writer;  // 在reactor线程上调用，与网络线程的control_writer分开
+    if (ResumeIdleConnection()) {
+        linx_state.wake_pending = kListenRequested;  // 连接建立后随hello开始录音
+        return;
+    }
+    std::string session_id = linx_state.session.SessionId();
+    if (session_id.empty()) {
+        linx_state.wake_pending = kListenRequested;
+        linx_state.listen_sent = OPTIMISTIC_START;
+        Control().SendText(HelloMessage(listen_writer));
+        if (OPTIMISTIC_START) {
+            Control().SendText(listen_writer.Listen({}, "start", ListenMode()));
+        }
+        return;
+    }
+    Control().SendText(listen_writer.Listen(session_id, "start", ListenMode()));
+    linx_state.session.SetListen(ListenState::Start);
+}
+
+/**
+ * @brief 手动结束录音：服务器以已上传的部分作为这一句
+ */
+void StopListening() {
+    thread_local ControlWriter listen_writer;
+    linx_state.session.SetListen(ListenState::Stop);
+    std::string session_id = linx_state.session.SessionId();
+    if (!session_id.empty()) {
+        Control().SendText(listen_writer.Listen(session_id, "stop"));
+    }
+}
+
+/**
+ * @brief 设置播放音量
+ * @param volume 0-100，按平方换算为TTS和提示音两路的线性增益（低音量段调节更细）
+ */
+void SetVolume(int volume) {
+    volume = std::min(100, std::max(0, volume));
+    linx_state.volume = volume;
+    float gain = static_cast<float>(volume * volume) / 10000.0f;
+    output_mixer.SetGain(tts_stream, gain);
+    output_mixer.SetGain(prompt_stream, gain);
+}
+
+/**
+ * @brief 重新读取设备配置，应用其中可在运行中更换的部分
+ * @description 重新解析LINX_CONFIG并按name（空表示按启动时的规则选择）取配置：编码参数在采集线程的下一帧生效
+ *              （开启自适应比特率时作为新的基础配置），抖动缓冲目标从下一个到达的包生效；
+ *              帧长、周期、线程策略、省电和处理级与当前不同时只记录日志，重启后生效
+ * @param name 配置名
+ * @param capture_pump 更换编码参数的采集泵
+ * @param reply 写入结果说明
+ * @return 配置文件无效或配置名未知时返回false，当前配置不变
+ */
+bool ReloadDeviceProfile(const std::string& name, CapturePump& capture_pump, std::string* reply) {
+    DeviceProfileSet profiles;
+    const char* path = std::getenv("LINX_CONFIG");
+    bool have_file = path != nullptr && *path != '\0';
+    std::string error;
+    if (have_file && !profiles.LoadFile(path, &error)) {
+        *reply = "invalid config: " + error;
+        WARN("profile reload: {}", *reply);
+        return false;
+    }
+    std::string wanted = name.empty() ? DeviceProfileName(profiles, have_file) : name;
+    DeviceProfile profile;
+    if (!profiles.Find(wanted, &profile)) {
+        *reply = "unknown profile " + wanted;
+        WARN("profile reload: {}", *reply);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    capture_pump.SetEncoderConfig(profile.codec);
+    audio_buffer.jitter.SetDelayLimits(profile.jitter_min_ms, profile.jitter_max_ms, profile.playout_start_ms);
+    std::string pending;
+    if (profile.RestartRequired(device_profile, &pending)) {
+        WARN("profile {}: {} take effect after restart", profile.name, pending);
+    }
+    INFO("profile {} applied: bitrate {}, complexity {}, jitter {}..{}ms, start {}ms", profile.name,
+         profile.codec.bitrate, profile.codec.complexity, profile.jitter_min_ms, profile.jitter_max_ms,
+         profile.playout_start_ms);
+    active_profile = profile;
+    *reply = profile.name;
+    if (!pending.empty()) {
+        *reply += " restart " + pending;
+    }
+    return true;
+}
+
+/**
+ * @brief SIGHUP处理函数：只记录请求，由配置监视线程执行重新加载
+ */
+void OnReloadSignal(int) {
+    profile_reload_requested.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 按环境变量创建本地控制套接字
+ * @description LINX_CONTROL_SOCKET=<路径> 开启，LINX_CONTROL_MODE设置套接字权限（八进制，默认0660）。
+ *              行协议，每行一条命令，回复一行"ok ..."或"err ..."，如 `echo 'volume 60' | nc -U /tmp/linx-ctl.sock`：
+ *              listen start|stop、abort、volume [0-100]、mute [on|off]、state、metrics [指标名前缀]、
+ *              profile [名称|reload]（不带参数返回当前设备配置）；
+ *              subscribe之后连接上还会收到会话状态变化的"event ..."行。
+ *              监听和连接都挂在reactor上，命令在reactor线程上执行，不另开线程
+ * @param reactor 没有reactor线程时由主线程驱动
+ */
+void SetupControlServer(Reactor& reactor, CapturePump& capture_pump) {
+    const char* path = std::getenv("LINX_CONTROL_SOCKET");
+    if (path == nullptr || *path == '\0') {
+        return;
+    }
+    ControlServerConfig config;
+    config.path = path;
+    if (const char* mode = std::getenv("LINX_CONTROL_MODE")) {
+        config.mode = static_cast<unsigned int>(std::strtoul(mode, nullptr, 8));
+    }
+    auto server = std::make_unique<ControlServer>(config);
+    server->AddCommand("listen", [](std::string_view args, std::string* reply) {
+        if (args == "start") {
+            StartListening();
+        } else if (args == "stop") {
+            StopListening();
+        } else {
+            *reply = "usage: listen start|stop";
+            return false;
+        }
+        return true;
+    });
+    server->AddCommand("abort", [](std::string_view, std::string*) {
+        AbortSpeaking();
+        return true;
+    });
+    server->AddCommand("volume", [](std::string_view args, std::string* reply) {
+        if (!args.empty()) {
+            std::string value(args);
+            char* end = nullptr;
+            long volume = std::strtol(value.c_str(), &end, 10);
+            if (end == value.c_str() || *end != '\0' || volume < 0 || volume > 100) {
+                *reply = "usage: volume [0-100]";
+                return false;
+            }
+            SetVolume(static_cast<int>(volume));
+            audio_buffer.wake();  // 播放线程可能正阻塞在空闲等待上
+        }
+        *reply = std::to_string(linx_state.volume.load());
+        return true;
+    });
+    server->AddCommand("mute", [&capture_pump](std::string_view args, std::string* reply) {
+        if (args == "on" || args == "off") {
+            linx_state.mic_muted = args == "on";
+            capture_pump.Wake();  // 采集端处于省电空闲时重新检查门控
+            INFO("microphone {}", linx_state.mic_muted ? "muted" : "unmuted");
+        } else if (!args.empty()) {
+            *reply = "usage: mute [on|off]";
+            return false;
+        }
+        *reply = linx_state.mic_muted ? "on" : "off";
+        return true;
+    });
+    server->AddCommand("state", [](std::string_view, std::string* reply) {
+        SessionSnapshot snapshot = linx_state.session.Snapshot();
+        std::string session_id = linx_state.session.SessionId();
+        *reply = std::string("listen ") + ListenStateName(snapshot.listen) + " tts " + TtsStateName(snapshot.tts) +
+                 " session " + (session_id.empty() ? "-" : session_id) + " mute " +
+                 (linx_state.mic_muted ? "on" : "off") + " volume " + std::to_string(linx_state.volume.load());
+        return true;
+    });
+    if (beamformer) {
+        // doa：当前声源方位；doa steer <度> 固定波束方向，doa track 恢复跟随声源
+        server->AddCommand("doa", [](std::string_view args, std::string* reply) {
+            if (args.rfind("steer", 0) == 0) {
+                std::string value(args.substr(5));
+                char* end = nullptr;
+                float degrees = std::strtof(value.c_str(), &end);
+                if (end == value.c_str() || *end != '\0') {
+                    *reply = "usage: doa [steer <deg>|track]";
+                    return false;
+                }
+                beamformer->SetTracking(false);
+                beamformer->Steer(degrees);
+            } else if (args == "track") {
+                beamformer->SetTracking(true);
+            } else if (!args.empty()) {
+                *reply = "usage: doa [steer <deg>|track]";
+                return false;
+            }
+            char text[64];
+            snprintf(text, sizeof(text), "%.1f confidence %.2f steer %.1f", beamformer->DoaDegrees(),
+                     beamformer->DoaConfidence(), beamformer->SteerDegrees());
+            *reply = text;
+            return true;
+        });
+    }
+    server->AddCommand("profile", [&capture_pump](std::string_view args, std::string* reply) {
+        if (args.empty()) {
+            std::lock_guard<std::mutex> lock(profile_mutex);
+            *reply = active_profile.name;
+            return true;
+        }
+        return ReloadDeviceProfile(args == "reload" ? std::string() : std::string(args), capture_pump, reply);
+    });
+    server->AddCommand("metrics", [](std::string_view args, std::string* reply) {
+        *reply = MetricsRegistry::Global().JsonSnapshot(args);
+        return true;
+    });
+    if (server->Start(reactor)) {
+        control_server = std::move(server);
+    }
+}
+
+/**
+ * @brief 请求退出：可在信号处理函数中调用，只置标志并写自唤醒管道
+ */
+void RequestShutdown() {
+    shutdown_requested.store(true, std::memory_order_relaxed);
+    if (shutdown_pipe[1] >= 0) {
+        char c = 1;
+        ssize_t n = write(shutdown_pipe[1], &c, 1);  // 管道已满时已有未读的唤醒，忽略
+        (void)n;
+    }
+}
+
+void OnShutdownSignal(int) { RequestShutdown(); }
+
+/**
+ * @brief 创建自唤醒管道并安装SIGTERM/SIGINT处理函数
+ * @description 进程管理器（systemd、升级脚本）发送SIGTERM、终端Ctrl+C时与按回车一样有序退出
+ */
+bool InstallShutdownHandlers() {
+    if (pipe2(shutdown_pipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+        WARN("shutdown pipe: {}", strerror(errno));
+        shutdown_pipe[0] = shutdown_pipe[1] = -1;
+        return false;
+    }
+    std::signal(SIGTERM, OnShutdownSignal);
+    std::signal(SIGINT, OnShutdownSignal);
+    return true;
+}
+
+/**
+ * @brief 标准输入可读时处理一个字符
+ * @return 读到回车或EOF（按回车退出）时返回true
+ */
+bool StdinRequestsExit(int fd) {
+    char c;
+    return read(fd, &c, 1) <= 0 || c == '\n';
+}
+
+/**
+ * @brief 等待退出请求，代替阻塞的std::cin.get()：回车、标准输入EOF或退出请求（信号、连接最终断开）时返回
+ */
+void WaitForShutdown() {
+    struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {shutdown_pipe[0], POLLIN, 0}};
+    const nfds_t count = shutdown_pipe[0] >= 0 ? 2 : 1;
+    while (!shutdown_requested.load(std::memory_order_relaxed)) {
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if ((fds[0].revents & (POLLIN | POLLHUP | POLLERR)) && StdinRequestsExit(STDIN_FILENO)) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 没有reactor线程时在主线程上运行reactor服务控制套接字，代替阻塞的std::cin.get()
+ * @description 标准输入可读（回车或EOF）或收到退出请求时返回，与“按回车退出”的行为一致
+ */
+void RunControlLoop(Reactor& reactor) {
+    reactor.AddFd(STDIN_FILENO, POLLIN, [&reactor](int fd, short) {
+        if (StdinRequestsExit(fd)) {
+            reactor.Stop();
+        }
+    });
+    if (shutdown_pipe[0] >= 0) {
+        reactor.AddFd(shutdown_pipe[0], POLLIN, [&reactor](int, short) { reactor.Stop(); });
+    }
+    if (!shutdown_requested.load(std::memory_order_relaxed)) {
+        reactor.Run();
+    }
+    reactor.RemoveFd(STDIN_FILENO);
+    if (shutdown_pipe[0] >= 0) {
+        reactor.RemoveFd(shutdown_pipe[0]);
+    }
+}
+
+/**
+ * @brief 退出过程的看门狗：Arm之后SHUTDOWN_TIMEOUT_MS内没有Disarm时打印卡住的阶段并直接结束进程
+ * @description 进程升级重启时旧进程必须在限定时间内让出声卡和连接，某个线程卡在驱动或网络中也不能无限等待
+ */
+class ShutdownWatchdog {
+public:
+    ~ShutdownWatchdog() { Disarm(); }
+
+    void Arm() {
+        if (SHUTDOWN_TIMEOUT_MS <= 0 || thread_.joinable()) {
+            return;
+        }
+        start_ = std::chrono::steady_clock::now();
+        thread_ = std::thread([this]() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (cv_.wait_for(lock, std::chrono::milliseconds(SHUTDOWN_TIMEOUT_MS), [this]() { return done_; })) {
+                return;
+            }
+            // 日志可能是异步的，直接写stderr后退出，不执行静态析构（其中的析构可能正是卡住的地方）
+            fprintf(stderr, "shutdown timed out after %dms in stage '%s', exiting\n", SHUTDOWN_TIMEOUT_MS,
+                    shutdown_stage.load());
+            _exit(EXIT_FAILURE);
+        });
+    }
+
+    void Disarm() {
+        if (!thread_.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+        INFO("shutdown: {:.1f}ms", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_)
+                                       .count());
+    }
+
+private:
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool done_ = false;
+    std::chrono::steady_clock::time_point start_;
+};
 
 // ==================== OTA固件更新相关函数 ====================
 
@@ -126,7 +2153,178 @@ WebSocketClient ws_client(ws_url);                  // WebSocket客户端实例
  * @description 向OTA服务器发送设备硬件信息，获取最新固件版本和WebSocket连接信息
  *              这是应用启动时的第一步，用于设备注册和配置获取
  */
-void get_ota_version() {
+/**
+ * @brief 按环境变量创建文件回放音频后端
+ * @return LINX_AUDIO_FILE_IN未设置时返回nullptr；否则返回新建的FileAudio，所有权交给调用方
+ */
+FileAudio* CreateFileAudioFromEnv() {
+    const char* input = std::getenv("LINX_AUDIO_FILE_IN");
+    if (input == nullptr || *input == '\0') {
+        return nullptr;
+    }
+    FileAudioConfig config;
+    config.capture_path = input;
+    if (const char* output = std::getenv("LINX_AUDIO_FILE_OUT")) {
+        config.playback_path = output;
+    }
+    const char* fast = std::getenv("LINX_AUDIO_FILE_FAST");
+    config.realtime = fast == nullptr || std::string(fast) != "1";
+    return new FileAudio(config);
+}
+
+/**
+ * @brief 文件回放时代替“按回车退出”：等待输入文件采集完毕，且TTS回复播放完毕后返回
+ * @description 输入结束后继续采集静音，让服务端检测到句尾并完成回复；
+ *              抖动缓冲区持续空闲kIdle后认为回复已结束，最长再等kMaxTail
+ * @param reactor 非空时等待期间在主线程上驱动它（控制套接字），代替睡眠
+ */
+void WaitForReplay(const FileAudio& file_audio, Reactor* reactor) {
+    constexpr auto kPoll = std::chrono::milliseconds(100);
+    constexpr auto kIdle = std::chrono::seconds(3);
+    constexpr auto kMaxTail = std::chrono::seconds(60);
+    auto idle = [reactor, kPoll]() {
+        if (reactor != nullptr) {
+            reactor->RunOnce(static_cast<int>(kPoll.count()));
+        } else {
+            std::this_thread::sleep_for(kPoll);
+        }
+    };
+    while (linx_state.running && !shutdown_requested && !file_audio.CaptureDone()) {
+        idle();
+    }
+    auto tail_start = std::chrono::steady_clock::now();
+    auto idle_since = tail_start;
+    while (linx_state.running && !shutdown_requested) {
+        auto now = std::chrono::steady_clock::now();
+        if (audio_buffer.jitter.Depth() > 0 || audio_buffer.jitter.Playing()) {
+            idle_since = now;
+        }
+        if (now - idle_since >= kIdle || now - tail_start >= kMaxTail) {
+            break;
+        }
+        idle();
+    }
+    INFO("replay finished: {:.1f}s of input", static_cast<double>(file_audio.CaptureFrames()) / SAMPLE_RATE);
+}
+
+/**
+ * @brief OTA响应缓存目录：LINX_CACHE_DIR，否则 $HOME/.cache/linx，都没有时用 /tmp/linx-cache
+ */
+std::string CacheDir() {
+    if (const char* dir = std::getenv("LINX_CACHE_DIR")) {
+        return dir;
+    }
+    if (const char* home = std::getenv("HOME")) {
+        return std::string(home) + "/.cache/linx";
+    }
+    return "/tmp/linx-cache";
+}
+
+ResponseCache ota_cache(CacheDir());  // 按设备ID缓存OTA响应
+
+/**
+ * @brief 按环境变量创建TTS音频缓存
+ * @description LINX_TTS_CACHE=1时开启：重复出现的短句（不超过256字节的句子文本）直接从本地播放。
+ *              条目写到LINX_TTS_CACHE_DIR（默认为缓存目录下的tts，设为空字符串时只缓存在内存中），
+ *              LINX_TTS_CACHE_BUDGET为磁盘预算（默认4M），LINX_TTS_CACHE_MEMORY为内存预算（默认256K），
+ *              都接受k/m/g后缀
+ */
+void SetupTtsCache() {
+    const char* env = std::getenv("LINX_TTS_CACHE");
+    if (env == nullptr || std::atoi(env) <= 0) {
+        return;
+    }
+    TtsCacheConfig config;
+    const char* dir = std::getenv("LINX_TTS_CACHE_DIR");
+    config.dir = dir != nullptr ? dir : CacheDir() + "/tts";
+    const char* disk = std::getenv("LINX_TTS_CACHE_BUDGET");
+    if (disk != nullptr && !ParseMemorySize(disk, &config.disk_budget_bytes)) {
+        WARN("invalid LINX_TTS_CACHE_BUDGET {}, using {} bytes", disk, config.disk_budget_bytes);
+    }
+    const char* memory = std::getenv("LINX_TTS_CACHE_MEMORY");
+    if (memory != nullptr && !ParseMemorySize(memory, &config.memory_budget_bytes)) {
+        WARN("invalid LINX_TTS_CACHE_MEMORY {}, using {} bytes", memory, config.memory_budget_bytes);
+    }
+    tts_cache = std::make_unique<TtsCache>(config);
+    INFO("tts cache: {} (disk budget {} bytes, memory budget {} bytes)",
+         config.dir.empty() ? std::string("memory only") : config.dir, config.disk_budget_bytes,
+         config.memory_budget_bytes);
+}
+const std::string kEndpointStateKey = "ws-endpoints";  // 同一缓存目录中记录各候选服务器的建连耗时
+
+constexpr int kEchoTailMs = 64;  // 回声纯延迟之后的混响尾部，校准后回声消除滤波器只需覆盖这一段（加上测量误差）
+
+/**
+ * @brief 取得设备的回环延迟
+ * @description LINX_LATENCY_CALIBRATION=1时先按设备（采集/播放设备名、采样率和缓冲配置）读取缓存目录下latency.json中
+ *              上次的结果，没有时播放约2.7秒的扫频测量并保存；=force时总是重新测量。须在设备初始化之后、
+ *              采集和播放线程启动之前调用
+ * @return 得到有效结果时返回true，结果写入latency_calibration
+ */
+bool CalibrateLatency(const AudioDeviceSelection& devices) {
+    const char* env = std::getenv("LINX_LATENCY_CALIBRATION");
+    if (env == nullptr || (std::string(env) != "1" && std::string(env) != "force")) {
+        return false;
+    }
+    std::string path = CacheDir() + "/latency.json";
+    std::string key = (devices.capture.empty() ? "default" : devices.capture) + "|" +
+                      (devices.playback.empty() ? "default" : devices.playback) + "|" + std::to_string(SAMPLE_RATE) +
+                      "|" + std::to_string(audio_profile.PeriodSize()) + "x" + std::to_string(audio_profile.periods) +
+                      (devices.lowest_latency ? "|lowest" : "");
+    if (std::string(env) != "force" && LoadLatencyCalibration(path, key, &latency_calibration)) {
+        INFO("latency: {:.1f}ms round trip for {} (saved)", latency_calibration.round_trip_ms, key);
+        return true;
+    }
+    std::string error;
+    if (!MeasureLoopbackLatency(*audio, LatencyCalibrationConfig(), &latency_calibration, &error)) {
+        WARN("latency calibration failed: {}, keeping default delays", error);
+        return false;
+    }
+    INFO("latency: {:.1f}ms round trip ({:.1f}ms queued in the device, {:.1f}ms beyond it), spread {:.1f}ms, "
+         "peak ratio {:.1f}", latency_calibration.round_trip_ms, latency_calibration.output_queue_ms,
+         latency_calibration.echo_delay_ms, latency_calibration.spread_ms, latency_calibration.peak_ratio);
+    if (::mkdir(CacheDir().c_str(), 0755) != 0 && errno != EEXIST) {
+        WARN("latency: cannot create {}", CacheDir());
+    }
+    SaveLatencyCalibration(path, key, latency_calibration);
+    return true;
+}
+
+/**
+ * @brief 按测得的回环延迟配置流水线
+ * @description 回声消除：参考信号按设备待播量对齐后仍超前于麦克风回声echo_delay_ms，先固定延迟这一段（减去一个设备周期和
+ *              测量离散度的余量），滤波器只需覆盖kEchoTailMs的混响尾部加两倍余量，不再用128ms的保守长度；
+ *              播放排空：设备报告的待播时长之外再等echo_delay_ms，回复的尾音和回声都采集完才开始录音
+ */
+void ApplyLatencyCalibration(CapturePump& pump) {
+    const LatencyCalibration& cal = latency_calibration;
+    double beyond_ms = cal.output_queue_ms >= 0
+                           ? cal.echo_delay_ms
+                           : std::max(0.0, cal.round_trip_ms - audio_profile.period_ms * audio_profile.periods);
+    playout_drain.SetExtraDelay(std::chrono::microseconds(static_cast<int64_t>(beyond_ms * 1000)));
+    if (echo_canceller && cal.output_queue_ms >= 0) {
+        int margin_ms = audio_profile.period_ms + static_cast<int>(std::ceil(cal.spread_ms));
+        EchoCancellerConfig aec_config;
+        aec_config.sample_rate = SAMPLE_RATE;
+        aec_config.delay_ms = std::max(0, static_cast<int>(cal.echo_delay_ms) - margin_ms);
+        aec_config.filter_ms = kEchoTailMs + 2 * margin_ms;
+        echo_canceller = std::make_shared<EchoCanceller>(aec_config);
+        pump.SetEchoCanceller(echo_canceller, echo_reference);
+        INFO("aec: reference delayed {}ms, {} taps", aec_config.delay_ms, echo_canceller->Taps());
+    }
+}
+
+OtaClient ota_client(ota_url, device_mac, &ota_cache);  // 构造时读出并解析上次缓存的配置
+const std::string kAppVersion = "1.6.0";  // 上报给OTA服务器的应用版本，firmware.version与之不同时视为有新固件
+
+/**
+ * @brief 异步上报设备信息并获取OTA版本信息
+ * @description 请求在HTTP后台线程上执行、立即返回，与音频设备初始化和WebSocket连接并行进行，
+ *              冷启动不再被OTA服务器的往返延迟串行阻塞。有缓存时带If-None-Match重新验证：
+ *              服务器返回304或配置未变化时不改写缓存；配置变化时更新缓存，下次启动生效
+ * @return 本次请求得到的配置（请求失败或响应中没有配置时 valid 为 false）
+ */
+std::future<OtaConfig> get_ota_version() {
     // 构建设备信息JSON数据
     json ota_post_data = {
         {"flash_size", 16777216},                    // Flash存储大小（16MB）
@@ -134,28 +2332,118 @@ void get_ota_version() {
         {"mac_address", device_mac},                // 设备MAC地址
         {"chip_model_name", "esp32s3"},             // 芯片型号
         {"chip_info", {{"model", 9}, {"cores", 2}, {"revision", 2}, {"features", 18}}}, // 芯片详细信息
-        {"application", {{"name", "Linx"}, {"version", "1.6.0"}}},  // 应用程序信息
+        {"application", {{"name", "Linx"}, {"version", kAppVersion}}},  // 应用程序信息
         {"partition_table", json::array()},         // 分区表信息
         {"ota", {{"label", "factory"}}},            // OTA标签
         {"board", {{"type", "bread-compact-wifi"}, {"ip", "192.168.124.38"}, {"mac", device_mac}}} // 开发板信息
     };
 
-    // 发送HTTP POST请求
+    // 记录请求日志，发送POST请求，响应到达后记录响应日志
     std::string post_data = ota_post_data.dump();  // 转换为JSON字符串
-    std::string response;                           // 服务器响应
-    linx::HttpClient hc;                           // HTTP客户端实例
-    hc.reset(ota_url);                             // 设置服务器URL
-    
-    // 设置HTTP请求头
-    std::map<std::string, std::string> header;
-    header["Device-Id"] = device_mac;              // 添加设备ID头部
-    
-    // 发送POST请求
-    hc.postJson(response, post_data, header);
-
-    // 记录请求和响应日志
     INFO("OTA Request:{}", post_data);
-    INFO("OTA Response:{}", response);
+    auto result = std::make_shared<std::promise<OtaConfig>>();
+    std::future<OtaConfig> future = result->get_future();
+    startup_trace.Begin("ota-fetch");
+    ota_client.FetchAsync(post_data, [result](OtaResult response) {
+        startup_trace.End("ota-fetch");
+        if (response.status == 0) {
+            WARN("OTA request failed after {:.0f}ms: {}", response.total_ms, response.error);
+        } else if (response.not_modified) {
+            INFO("OTA: cached config still valid ({:.0f}ms)", response.total_ms);
+        } else {
+            INFO("OTA Response ({} in {:.0f}ms):{}", response.status, response.total_ms, response.body);
+            if (response.changed) {
+                INFO("OTA: config changed (firmware {} -> {}, ws {}), takes effect on next start",
+                     ota_client.Cached().firmware_version, response.config.firmware_version, response.config.ws_url);
+            }
+        }
+        if (response.config.server_time_ms > 0) {
+            // 没有RTC的板子上电后时钟可能差得很远，TLS证书校验和录音文件名都依赖它
+            int64_t local_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   std::chrono::system_clock::now().time_since_epoch()).count();
+            int64_t skew_ms = local_ms - response.config.server_time_ms;
+            if (skew_ms > 60000 || skew_ms < -60000) {
+                WARN("OTA: local clock is {}s off server time", skew_ms / 1000);
+            }
+        }
+        result->set_value(response.ok ? response.config : OtaConfig());
+    });
+    return future;
+}
+
+std::unique_ptr<Downloader> firmware_download;  // 后台固件下载（LINX_FIRMWARE_DIR）
+std::unique_ptr<DeltaUpdater> firmware_delta;   // 有可用的差分补丁时先于整包下载尝试
+std::thread firmware_thread;
+
+/**
+ * @brief 后台下载OTA下发的新固件
+ * @description LINX_FIRMWARE_DIR=<目录>时，firmware.version与本机版本不同就把新固件生成为
+ *              <目录>/firmware-<version>.bin。OTA下发了firmware.patch（基线版本为本机版本）且本机镜像存在时，
+ *              先流式下载差分补丁、与本机镜像合成新固件：补丁只有整包的一小部分，慢速链路上省下大部分流量和时间；
+ *              本机镜像取LINX_FIRMWARE_BASE，未设置时为<目录>/firmware-<本机版本>.bin，按patch.base_sha256校验。
+ *              没有补丁、基线不符或合成失败时退回整包下载：按HTTP Range分段并行下载，给出firmware.sha256时校验
+ *              整个文件，中断（退出、断网、断电）后下次启动从已完成的分段续传，已下载完成的版本不再重复下载。
+ *              LINX_FIRMWARE_PARALLEL设置并行的分段数（默认4）。只负责下载，刷写由外部的升级程序处理
+ * @param config 本次启动使用的OTA配置（缓存的或刚取回的）
+ */
+void StartFirmwareDownload(const OtaConfig& config) {
+    const char* dir = std::getenv("LINX_FIRMWARE_DIR");
+    if (dir == nullptr || config.firmware_url.empty() || config.firmware_version.empty() ||
+        config.firmware_version == kAppVersion || firmware_download) {
+        return;
+    }
+    std::string version = config.firmware_version;
+    for (char& c : version) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '-' && c != '_') {
+            c = '_';  // 版本号来自服务器，不让它带出目录
+        }
+    }
+    DownloadConfig download;
+    download.url = config.firmware_url;
+    download.path = std::string(dir) + "/firmware-" + version + ".bin";
+    download.sha256 = config.firmware_sha256;
+    if (const char* parallel = std::getenv("LINX_FIRMWARE_PARALLEL")) {
+        download.parallel = std::max(1, std::atoi(parallel));
+    }
+    if (access(download.path.c_str(), F_OK) == 0) {
+        INFO("firmware {} already downloaded to {}", config.firmware_version, download.path);
+        return;
+    }
+    const char* base_env = std::getenv("LINX_FIRMWARE_BASE");
+    std::string base = base_env != nullptr ? base_env : std::string(dir) + "/firmware-" + kAppVersion + ".bin";
+    if (!config.firmware_patch_url.empty() && !config.firmware_sha256.empty() &&
+        (config.firmware_patch_from.empty() || config.firmware_patch_from == kAppVersion) &&
+        access(base.c_str(), R_OK) == 0) {
+        DeltaUpdateConfig delta;
+        delta.url = config.firmware_patch_url;
+        delta.base_path = base;
+        delta.base_sha256 = config.firmware_patch_base_sha256;
+        delta.path = download.path;
+        delta.sha256 = config.firmware_sha256;
+        delta.patch_sha256 = config.firmware_patch_sha256;
+        firmware_delta = std::make_unique<DeltaUpdater>(delta);
+    }
+    INFO("firmware {} available (running {}), {} to {}", config.firmware_version, kAppVersion,
+         firmware_delta ? "patching " + base : std::string("downloading"), download.path);
+    firmware_download = std::make_unique<Downloader>(download);
+    firmware_thread = std::thread([]() {
+        std::string error;
+        if (firmware_delta) {
+            if (firmware_delta->Run(&error)) {
+                DeltaUpdateStats stats = firmware_delta->GetStats();
+                INFO("firmware patched: {} bytes from a {} byte patch ({} transferred, {:.1f}% of the image) "
+                     "in {:.0f}ms", stats.size, stats.patch_bytes, stats.transfer_bytes,
+                     stats.size ? 100.0 * stats.transfer_bytes / stats.size : 0.0, stats.total_ms);
+                return;
+            }
+            WARN("firmware patch failed ({}), downloading the full image", error);
+        }
+        if (firmware_download->Run(&error)) {
+            DownloadStats stats = firmware_download->GetStats();
+            INFO("firmware downloaded: {} bytes in {:.0f}ms ({} of {} segments resumed, {} retries)", stats.size,
+                 stats.total_ms, stats.segments_resumed, stats.segments, stats.retries);
+        }
+    });
 }
 
 // ==================== 主函数 ====================
@@ -167,247 +2455,1797 @@ void get_ota_version() {
  * @return 0表示正常退出，-1表示异常退出
  */
 int main() {
+    SetupMemory();
+    SetupLogging();
+    if (ListAudioDevicesFromEnv()) {
+        ShutdownLogging();
+        return 0;
+    }
+    SetupFrameTrace();
+    SetupDeadlineWatchdog();
+    SetupOutputMixer();
+    // 编解码器创建失败（如采样率不受支持）时不再退出进程，由这里统一处理
+    if (!opus_encoder.Valid() || !opus_decoder.Valid()) {
+        ERROR("Opus codec unavailable for {}Hz/{}ch", SAMPLE_RATE, CHANNELS);
+        return -1;
+    }
+    SetupBlackBox();
+    SetupAudioTap();
+    SetupTtsCache();
+    InstallShutdownHandlers();  // 启动期间收到的SIGTERM同样生效：初始化完成后立即进入退出流程
     try {
         // ==================== 初始化阶段 ====================
         
-        // 1. 获取OTA固件信息和服务器配置
-        get_ota_version();
+        // 1. 获取OTA固件信息和服务器配置（异步，与后续初始化并行）
+        //    有缓存时直接使用上次的配置，请求只用于后台重新验证
+        bool have_cached_ota = ota_client.HasCache();
+        OtaConfig ota_config = ota_client.Cached();
+        std::future<OtaConfig> ota_pending = get_ota_version();
+        std::shared_ptr<EndpointSelector> ws_endpoints;  // 有多个候选服务器时使用
+
+        // 启动任务及其依赖：
+        //   ota(等待配置) -> resolve(DNS) -> connect(TCP/TLS/WebSocket握手，需先设置好会话回调)
+        //   audio(打开并协商设备) -> 启动播放线程和采集泵
+        // 并行模式下各任务登记即开始，音频设备的打开与OTA、DNS、建立连接同时进行；
+        // 顺序模式下主线程在第一次用到时依次执行
+        StartupTasks startup(PARALLEL_INIT, &startup_trace);
+        startup.Add("ota", {}, [&]() {
+            // 没有可用的缓存时（首次启动）等待OTA结果，最多等到请求超时，第一次连接即使用服务器下发的地址
+            if (!ota_config.valid && ota_pending.wait_for(std::chrono::seconds(6)) == std::future_status::ready) {
+                ota_config = ota_pending.get();
+            }
+            if (ota_config.valid && !ota_config.ws_url.empty()) {
+                ws_client.SetUrl(ota_config.ws_url);
+                if (!ota_config.ws_token.empty()) {
+                    ws_access_token = ota_config.ws_token;
+                }
+            }
+            // 多个候选服务器：LINX_WS_URLS（逗号分隔）优先，否则用OTA下发的websocket.urls；
+            // 启动时按延迟竞速，各候选的建连耗时缓存在OTA缓存目录中，下次启动优先尝试上次最快的
+            std::vector<std::string> candidates;
+            if (const char* urls_env = std::getenv("LINX_WS_URLS")) {
+                std::stringstream list(urls_env);
+                std::string url;
+                while (std::getline(list, url, ',')) {
+                    candidates.push_back(url);
+                }
+            } else if (ota_config.valid) {
+                candidates = ota_config.Endpoints();
+            }
+            ws_endpoints = std::make_shared<EndpointSelector>(candidates);
+            if (ws_endpoints->Size() > 1) {
+                CachedResponse state;
+                if (ota_cache.Load(kEndpointStateKey, &state)) {
+                    ws_endpoints->LoadState(state.body);
+                }
+                ws_client.SetEndpoints(ws_endpoints);
+            } else {
+                if (!candidates.empty()) {
+                    ws_client.SetUrl(candidates.front());
+                }
+                ws_endpoints.reset();
+            }
+            StartFirmwareDownload(ota_config);
+            if (TRANSPORT_MODE != TransportMode::WebSocket) {
+                MqttConfig mqtt_config;
+                std::string publish_topic;
+                if (LoadMqttConfig(ota_config, &mqtt_config, &publish_topic)) {
+                    mqtt_transport = std::make_unique<MqttTransport>(mqtt_config, publish_topic);
+                    control_transport.store(mqtt_transport.get(), std::memory_order_release);
+                    INFO("control transport: mqtt {}:{}{}, keepalive {}s, topics {} / {}", mqtt_config.host,
+                         mqtt_config.port, mqtt_config.tls ? " (tls)" : "", mqtt_config.keepalive.count(),
+                         publish_topic, mqtt_config.subscribe_topic);
+                    return;  // 不使用WebSocket连接
+                }
+                if (TRANSPORT_MODE == TransportMode::Mqtt) {
+                    WARN("no MQTT broker (LINX_MQTT_URL or OTA mqtt.endpoint), using the WebSocket");
+                }
+            }
+            INFO("ws endpoint: {} ({}{})", ws_client.Url(),
+                 ota_config.valid ? (have_cached_ota ? "cached OTA config" : "OTA config") : "built-in default",
+                 ws_endpoints ? ", racing " + std::to_string(ws_endpoints->Size()) + " candidates" : "");
+        });
+        startup.Add("resolve", {"ota"}, [&]() {
+            if (mqtt_transport) {
+                return;  // MQTT客户端在自己的线程上解析代理地址
+            }
+            ws_client.Resolve();
+            if (ws_endpoints) {
+                CachedResponse state;
+                state.body = ws_endpoints->SaveState();
+                ota_cache.Store(kEndpointStateKey, state);
+            }
+        });
         
-        // 2. 初始化音频接口（平台相关：Linux使用ALSA，macOS使用PortAudio）
-        audio = CreateAudioInterface();                              // 创建平台相关的音频接口实例
-        audio->Init();                                              // 初始化音频系统
-        audio->SetConfig(SAMPLE_RATE, 320, CHANNELS, 4, 4096, 1024); // 配置音频参数
-        audio->Record();                                            // 初始化录音流
-        audio->Play();                                              // 初始化播放流，用于TTS音频输出
+        // 2. 初始化音频接口（平台相关：Linux按LINX_AUDIO_BACKEND使用PipeWire/PulseAudio/ALSA，macOS使用PortAudio）
+        //    LINX_ALSA_ENGINE=1时改用单线程非阻塞ALSA引擎：采集和播放在同一个poll循环中按周期回调，
+        //    不再需要独立的播放线程和采集线程，设备由引擎打开，AudioInterface不再初始化设备
+        //    LINX_REACTOR=1（隐含LINX_ALSA_ENGINE=1）时ALSA引擎和WebSocket都挂在同一个reactor线程上：
+        //    lws的socket与ALSA的设备描述符由一个poll复用，进程只有主线程和reactor线程
+        const WebSocketBufferConfig ws_buffers = LoadWebSocketBuffers();  // 共享上下文和私有上下文都按它建立
+        ws_client.SetBufferConfig(ws_buffers);
+        const WebSocketDeflateConfig ws_deflate = LoadWebSocketDeflate();
+        ws_client.SetDeflateConfig(ws_deflate);
+        const char* engine_env = std::getenv("LINX_ALSA_ENGINE");
+        const char* reactor_env = std::getenv("LINX_REACTOR");
+        bool use_reactor = reactor_env != nullptr && std::string(reactor_env) == "1";
+        bool use_engine = use_reactor || (engine_env != nullptr && std::string(engine_env) == "1");
+#ifdef __APPLE__
+        use_engine = false;
+#endif
+        // LINX_AUDIO_FILE_IN=<wav>时以文件代替麦克风和扬声器：采集读取该文件，播放写入LINX_AUDIO_FILE_OUT=<wav>，
+        // 默认按实时节奏运行（输出与输入在同一时间轴上），LINX_AUDIO_FILE_FAST=1时不等待、尽快跑完
+        FileAudio* file_audio = CreateFileAudioFromEnv();
+        FileAudio* null_audio = nullptr;                            // LINX_AUDIO_BACKEND=null/sink时的空设备
+        AudioDeviceSelection audio_devices = LoadAudioDevices();    // 设备选择，ALSA引擎打开设备时也使用
+        if (file_audio != nullptr) {
+            audio.reset(file_audio);
+            use_engine = false;
+        } else {
+            // 创建平台相关的音频接口实例：LINX_AUDIO_BACKEND选择后端，ALSA引擎直接打开ALSA设备，固定用ALSA；
+            // null/sink没有设备，不走ALSA引擎
+            AudioBackend backend = LoadAudioBackend();
+            bool headless = backend == AudioBackend::Null || backend == AudioBackend::Sink;
+            if (headless) {
+                use_engine = false;
+            }
+            const char* loop_env = std::getenv("LINX_AUDIO_LOOP");
+            audio = CreateAudioInterface(use_engine ? AudioBackend::Alsa : backend,
+                                         loop_env != nullptr ? loop_env : "");
+            if (headless) {
+                null_audio = static_cast<FileAudio*>(audio.get());  // 工厂对null/sink返回FileAudio
+            } else if (!use_engine) {
+                // 选择设备（USB麦克风阵列、直接打开hw:绕过dmix/dsnoop），须在Init之前
+                if ((!audio_devices.capture.empty() || !audio_devices.playback.empty()) &&
+                    !audio->SetDevice(audio_devices.capture, audio_devices.playback)) {
+                    throw std::runtime_error("音频设备不存在");
+                }
+                audio->SetLowestLatency(audio_devices.lowest_latency);
+                audio->SetSilenceFill(SILENCE_FILL);
+                // 麦克风阵列：采集端按麦克风个数的声道打开，播放端仍为单声道
+                if (!MIC_ARRAY.empty() && CHANNELS == 1) {
+                    if (audio->SetCaptureChannels(static_cast<int>(MIC_ARRAY.size()))) {
+                        BeamformerConfig bf_config;
+                        bf_config.sample_rate = SAMPLE_RATE;
+                        bf_config.mics = MIC_ARRAY;
+                        // LINX_MIC_STEER=<度>固定波束方向，不随声源方位转向
+                        if (const char* steer_env = std::getenv("LINX_MIC_STEER")) {
+                            bf_config.steer_deg = static_cast<float>(std::atof(steer_env));
+                            bf_config.track = false;
+                        }
+                        beamformer = std::make_shared<Beamformer>(bf_config);
+                        INFO("mic array: {} mics, beam {} at {:.0f} deg", MIC_ARRAY.size(),
+                             bf_config.track ? "tracking the talker" : "fixed", bf_config.steer_deg);
+                    } else {
+                        WARN("mic array: backend cannot capture {} channels, using mono", MIC_ARRAY.size());
+                    }
+                }
+            }
+        }
+        use_reactor = use_reactor && use_engine;
+#ifdef __APPLE__
+        // LINX_DUPLEX=1时采集与播放共用一个全双工PortAudio流，两者同一时钟、逐样本对齐
+        const char* duplex_env = std::getenv("LINX_DUPLEX");
+        if (file_audio == nullptr && null_audio == nullptr && duplex_env != nullptr &&
+            std::string(duplex_env) == "1") {
+            static_cast<PortAudioImpl*>(audio.get())->SetDuplexMode(true);
+        }
+#endif
+        audio->SetFramePool(&audio_frames);                         // Record/Play的临时缓冲区从帧池取
+        audio->ApplyProfile(audio_profile);                         // 配置音频参数（设备周期与帧对齐），须在Init之前
+        INFO("profile {} (latency mode {}): frame {}ms, period {} frames x {}", device_profile.name,
+             audio_profile.ModeName(), audio_profile.frame_ms, audio_profile.PeriodSize(), audio_profile.periods);
+        if (!use_engine) {
+            startup.Add("audio", {}, []() {
+                audio->Init();                                      // 按配置打开并协商音频设备
+                audio->Record();                                    // 初始化录音流
+                audio->Play();                                      // 初始化播放流，用于TTS音频输出
+            });
+        }
+
+        // LINX_MLOCK=1时锁定进程内存，避免音频路径上的缺页（抖动缓冲区、Opus状态已在此之前分配）
+        const char* mlock_env = std::getenv("LINX_MLOCK");
+        if (mlock_env != nullptr && std::string(mlock_env) == "1") {
+            std::string error;
+            if (LockProcessMemory(&error)) {
+                INFO("process memory locked");
+            } else {
+                WARN("mlockall failed: {}", error);
+            }
+        }
+
+        // TTS中途断流时由Opus解码器做丢包隐藏（PLC），代替硬静音
+        // 延迟追踪：抖动缓冲区停留时间、发送队列延迟，采集泵和消息处理中的打点见下文
+        audio_buffer.jitter.SetLatencyTracer(latency_tracer);
+        ws_client.SetLatencyTracer(latency_tracer);
+        audio_buffer.jitter.SetFrameTrace(frame_trace);
+        ws_client.SetFrameTrace(frame_trace);
+        // 按句报告首样本延迟和停顿；SIGUSR1/SIGUSR2在本地跳过一句、播完本句停止
+        sentence_scheduler.SetLatencyTracer(latency_tracer);
+        sentence_scheduler.SetReportHandler(LogSentence);
+        std::signal(SIGUSR1, OnSentenceSignal);
+        std::signal(SIGUSR2, OnSentenceSignal);
+
+        audio_buffer.jitter.SetConcealer([](short* out, size_t samples) -> size_t {
+            std::lock_guard<std::mutex> lock(decoder_mutex);
+            int n = opus_decoder.DecodeMissing(out, samples);
+            return n > 0 ? static_cast<size_t>(n) : 0;
+        });
 
         // ==================== 启动工作线程 ====================
         
         // 3. 启动音频播放线程（消费者线程）
         // 功能：从音频缓冲区取出TTS数据并播放，防止播放underflow
-        std::thread playback_thread = std::thread([]() {
-            std::vector<short> audio_chunk;  // 临时存储音频数据块
-            
+        // 事件驱动：没有数据时阻塞等待，等待期限由设备剩余缓冲决定；
+        // 只有设备即将欠载时才补一个周期的静音，空闲超过kIdleKeepAlive后停止补静音、让设备自然停下；
+        // LINX_SILENCE_FILL=1且后端支持时由驱动补静音，没有数据时播放线程什么都不写
+        auto playback_loop = []() {
+            ApplyAudioThreadPolicy("linx-playback", CpuDomain::Playback);
+            const long kLowWater = audio_profile.PeriodSize();            // 设备剩余不足一个周期时补静音
+            constexpr auto kIdleKeepAlive = std::chrono::seconds(1);    // TTS结束后继续保活的时长
+            constexpr auto kIdleWait = std::chrono::milliseconds(500);  // 完全空闲时的等待上限（仅用于检查退出）
+            FrameRef chunk_frame = audio_frames.Acquire();               // 播放数据块从帧池取
+            std::vector<short> chunk_fallback(chunk_frame ? 0 : CHUNK * CHANNELS);  // 池已空时退回预分配的缓冲区
+            short* audio_chunk = chunk_frame ? chunk_frame->data : chunk_fallback.data();
+            std::vector<short> silence(kLowWater * CHANNELS, 0);         // 一个周期的静音
+            constexpr auto kSuspendedWait = std::chrono::minutes(10);   // 播放设备暂停后只由新数据或退出唤醒
+            auto last_audio = std::chrono::steady_clock::now();
+            bool playback_suspended = false;
+            const bool silence_fill = SILENCE_FILL && audio->SilenceFill();
+            if (SILENCE_FILL) {
+                INFO("playback silence fill: {}", silence_fill ? "driver" : "unsupported by backend, writing silence");
+            }
+
             while (linx_state.running) {
-                if (audio_buffer.pop(audio_chunk)) {
-                    // 有TTS音频数据时，播放实际音频
-                    audio->Write(audio_chunk.data(), audio_chunk.size());
+                PlaybackBegin();
+                // 打断：丢弃设备中尚未播出的数据，参考信号同步丢弃
+                if (audio_buffer.take_interrupt()) {
+                    audio->DropPlayback();
+                    playout_drain.Dropped();
+                    if (tts_drift) {
+                        tts_drift->Reset();
+                    }
+                    if (echo_reference) {
+                        echo_reference->Flush();
+                    }
+                    last_audio = std::chrono::steady_clock::now();
+                    continue;
+                }
+
+                // tts stop之后：抖动缓冲区取空且设备里的回复播完时开始录音
+                playout_drain.Poll(audio_buffer.jitter.Drained());
+                HandleSentenceCommand();
+
+                // 同步播放：等待定时开始期间按设备当前的排队深度换算本周期写入的样本何时播出
+                if (audio_buffer.jitter.ScheduledStart() != 0) {
+                    long delay = audio->GetPlaybackDelay();
+                    audio_buffer.jitter.SetOutputDelay(delay > 0 ? static_cast<uint64_t>(delay) * 1000000 / SAMPLE_RATE
+                                                                 : 0);
+                }
+
+                // 省电空闲中来了新的TTS或提示音：先恢复播放设备
+                if (playback_suspended && (audio_buffer.jitter.Depth() > 0 || output_mixer.Pending())) {
+                    audio->ResumePlayback();
+                    playback_suspended = false;
+                }
+
+                // 后端支持mmap时直接把混音结果写进设备DMA缓冲区（只有TTS时即抖动缓冲区的数据），省掉一次拷贝
+                if (audio_buffer.jitter.Ready() || output_mixer.Pending()) {
+                    size_t frames = 0;
+                    short* region = audio->AcquirePlayback(CHUNK, &frames);
+                    if (region != nullptr) {
+                        size_t n = output_mixer.Mix(region, frames * CHANNELS);
+                        FeedEchoReference(region, n);
+                        PlaybackStage(DeadlineStage::Write);
+                        audio->CommitPlayback(n / CHANNELS);
+                        if (n > 0) {
+                            if (output_mixer.Produced(tts_stream) > 0) {
+                                TracePlayedNow(output_mixer.Produced(tts_stream));
+                            }
+                            last_audio = std::chrono::steady_clock::now();
+                            continue;
+                        }
+                    }
+                }
+
+                size_t n = output_mixer.Mix(audio_chunk, CHUNK);
+                if (n > 0) {
+                    // 有TTS或提示音时，播放实际音频
+                    PlaybackStage(DeadlineStage::Write);
+                    audio->Write(audio_chunk, n);
+                    FeedEchoReference(audio_chunk, n);
+                    if (output_mixer.Produced(tts_stream) > 0) {
+                        TracePlayedNow(output_mixer.Produced(tts_stream));
+                    }
+                    last_audio = std::chrono::steady_clock::now();
+                    continue;
+                }
+
+                if (silence_fill) {
+                    // 设备自己补静音：没有数据时不写任何东西。TTS中途断流、设备即将耗尽时仍用丢包隐藏补一个周期
+                    bool keep_alive = std::chrono::steady_clock::now() - last_audio <= kIdleKeepAlive;
+                    long delay = audio->GetPlaybackDelay();
+                    if (keep_alive && delay >= 0 && delay <= kLowWater) {
+                        PlaybackStage(DeadlineStage::Decode);
+                        size_t concealed = audio_buffer.jitter.Conceal(audio_chunk, kLowWater);
+                        if (concealed > 0) {
+                            PlaybackStage(DeadlineStage::Write);
+                            audio->Write(audio_chunk, concealed);
+                            FeedEchoReference(audio_chunk, concealed);
+                            continue;
+                        }
+                    }
+                    std::chrono::microseconds wait = kIdleWait;
+                    if (keep_alive && delay > kLowWater) {
+                        wait = std::min(wait, std::chrono::microseconds((delay - kLowWater) * 1000000 / SAMPLE_RATE));
+                    }
+                    auto remaining = playout_drain.Remaining();
+                    if (remaining.count() > 0 && remaining < wait) {
+                        wait = remaining;
+                    }
+                    if (!keep_alive && IDLE_SUSPEND_MS > 0 && !playback_suspended) {
+                        playback_suspended = audio->SuspendPlayback();
+                    }
+                    PlaybackIdle();
+                    audio_buffer.wait_ready(playback_suspended ? kSuspendedWait : wait);
+                    continue;
+                }
+
+                if (std::chrono::steady_clock::now() - last_audio > kIdleKeepAlive) {
+                    // 空闲：设备允许排空，阻塞到有新数据；启用省电空闲时停止播放设备的DMA
+                    if (IDLE_SUSPEND_MS > 0 && !playback_suspended) {
+                        playback_suspended = audio->SuspendPlayback();
+                    }
+                    PlaybackIdle();
+                    audio_buffer.wait_ready(playback_suspended ? kSuspendedWait : kIdleWait);
+                    continue;
+                }
+
+                long delay = audio->GetPlaybackDelay();
+                if (delay < 0) {
+                    // 后端无法报告缓冲深度：等一个周期，仍无数据则补静音
+                    PlaybackIdle();
+                    if (!audio_buffer.wait_ready(std::chrono::milliseconds(audio_profile.period_ms))) {
+                        PlaybackStage(DeadlineStage::Write);
+                        audio->Write(silence.data(), kLowWater);
+                        FeedEchoReference(nullptr, kLowWater);
+                    }
+                } else if (delay > kLowWater) {
+                    // 设备里还有数据：等到它即将耗尽为止；等待排空时在回复播完的时刻醒来
+                    auto deadline = std::chrono::microseconds((delay - kLowWater) * 1000000 / SAMPLE_RATE);
+                    auto remaining = playout_drain.Remaining();
+                    if (remaining.count() > 0 && remaining < deadline) {
+                        deadline = remaining;
+                    }
+                    PlaybackIdle();
+                    audio_buffer.wait_ready(deadline);
                 } else {
-                    // 没有数据时播放静音，防止PortAudio输出underflow错误
-                    short silence[CHUNK] = {0};  // 创建静音数据
-                    audio->Write(silence, CHUNK);
-                    usleep(20 * 1000);           // 休眠20毫秒，对应一个音频帧的时长
+                    // 设备即将欠载：TTS中途断流时先用Opus丢包隐藏补一个周期，否则补静音
+                    PlaybackStage(DeadlineStage::Decode);
+                    size_t concealed = audio_buffer.jitter.Conceal(audio_chunk, kLowWater);
+                    PlaybackStage(DeadlineStage::Write);
+                    if (concealed > 0) {
+                        audio->Write(audio_chunk, concealed);
+                        FeedEchoReference(audio_chunk, concealed);
+                    } else {
+                        audio->Write(silence.data(), kLowWater);
+                        FeedEchoReference(nullptr, kLowWater);
+                    }
                 }
             }
-        });
+            PlaybackIdle();
+        };
+        std::thread playback_thread;  // 音频设备打开后在下文启动
 
-        // 4. 启动音频录制线程（生产者线程）
+        // 4. 启动音频采集泵（生产者线程）
         // 功能：持续录制音频，编码为Opus格式，通过WebSocket发送给服务器进行语音识别
-        std::thread audio_thread = std::thread([]() {
-            std::vector<unsigned char> opus_buffer(CHUNK);  // Opus编码缓冲区
-            short buffer[CHUNK] = {};                       // PCM音频数据缓冲区
+        //       采集泵持有预分配的PCM/Opus缓冲区，只以audio->Read的阻塞节奏驱动，每帧无堆分配
+        CapturePumpConfig pump_config;
+        pump_config.sample_rate = SAMPLE_RATE;
+        pump_config.channels = CHANNELS;
+        pump_config.frame_samples = CHUNK;
+        // 本地唤醒词（LINX_WAKE_WORDS=<唤醒词>=<模板.wav>[,...]）：服务器hello之后不自动开始录音，
+        // 采集泵在门控关闭期间只做本地检测，命中后才发送listen，空闲时没有上行音频
+        if (const char* wake_env = std::getenv("LINX_WAKE_WORDS")) {
+            if (CHANNELS == 1) {
+                wake_spotter = LoadWakeWords(wake_env);
+            }
+            if (!wake_spotter) {
+                WARN("wake word: no usable template, listening starts on server hello");
+            }
+        }
+        // 门控预录：非录音状态下也持续编码，最近400ms（唤醒词模式下1000ms，包含唤醒词本身；
+        // 乐观开始时1000ms，覆盖等待hello回复的往返）的包
+        // 在开始录音时先补发，不切掉状态切换前说出的首字；LINX_LISTEN_PREROLL_MS=<毫秒>调整（上限1000），
+        // 0关闭（非录音状态下不编码）
+        pump_config.gate_preroll_ms = wake_spotter || OPTIMISTIC_START ? 1000 : 400;
+        if (const char* preroll_env = std::getenv("LINX_LISTEN_PREROLL_MS")) {
+            pump_config.gate_preroll_ms = std::max(0, std::atoi(preroll_env));
+        }
+        pump_config.idle_suspend_ms = IDLE_SUSPEND_MS;  // 不录音时暂停采集设备，会话状态变化时由Wake()恢复
+        // 输出缓冲区按所有格式中最大的包分配，hello协商换格式时不用重新分配
+        for (const std::string& format : CodecRegistry::Instance().Formats()) {
+            if (AudioEncoder* encoder = UplinkEncoder(format)) {
+                pump_config.max_packet_bytes = std::max(pump_config.max_packet_bytes, encoder->MaxPacketBytes(CHUNK));
+            }
+        }
+        AudioEncoder* initial_encoder = UplinkEncoder(AUDIO_FORMAT);
+        if (initial_encoder == nullptr) {
+            WARN("audio format {}: encoder unavailable, using opus", AUDIO_FORMAT);
+            initial_encoder = &opus_uplink;
+        }
+        uplink_opus = initial_encoder->Opus() != nullptr;
+        // 服务器回复hello之前（乐观开始、门控预录）按首选格式编码，与hello中声明的format一致
+        CapturePump capture_pump(*audio, *initial_encoder, pump_config);
+        capture_pump.SetGate([]() { return linx_state.session.Listening() && !linx_state.mic_muted; });  // 仅在录音状态下编码发送
+        // 上行VAD：跳过非语音帧的编码和发送（拖尾800ms保证服务端能检测到句尾），LINX_UPLINK_VAD=0关闭
+        const char* vad_env = std::getenv("LINX_UPLINK_VAD");
+        if (vad_env == nullptr || std::string(vad_env) != "0") {
+            EnergyVadConfig vad_config;
+            vad_config.channels = CHANNELS;
+            capture_pump.SetVoiceDetector(MakeEnergyVad(vad_config, AudioFormatInfo::FromProfile(audio_profile)));  // 已知帧长时用特化版本
+        }
+        if (wake_spotter) {
+            capture_pump.SetKeywordSpotter(wake_spotter, OnWakeWord);
+        }
+        // 回声消除（LINX_AEC=1）：从采集信号中减去扬声器回声，TTS播放期间保持录音，用户可随时打断。
+        // 参考信号取自全双工流（LINX_DUPLEX=1）或播放路径写入设备的数据，后者与回声的错位由滤波器长度覆盖
+        const char* aec_env = std::getenv("LINX_AEC");
+        if (aec_env != nullptr && std::string(aec_env) == "1" && CHANNELS == 1) {
+            EchoCancellerConfig aec_config;
+            aec_config.sample_rate = SAMPLE_RATE;
+            echo_canceller = std::make_shared<EchoCanceller>(aec_config);
+            size_t device_frames = audio_profile.PeriodSize() * audio_profile.periods;
+            echo_reference = std::make_shared<EchoReference>(SAMPLE_RATE, device_frames + CHUNK);
+            capture_pump.SetEchoCanceller(echo_canceller, echo_reference);
+            // 插话打断：TTS播放中VAD检测到（消除回声后的）近端语音时，立即停止播放并通知服务器
+            capture_pump.SetSpeechStartHandler([]() {
+                if (!linx_state.tts_aborted &&
+                    (audio_buffer.jitter.Playing() || audio_buffer.jitter.Depth() > 0)) {
+                    AbortSpeaking();
+                }
+            });
+            INFO("aec: {} taps", echo_canceller->Taps());
+        }
+        // 波束形成在回声消除之前：回声消除、降噪都只处理波束输出的单声道
+        if (beamformer) {
+            capture_pump.SetBeamformer(beamformer);
+        }
+        // 降噪（LINX_NS=1，或设备配置开启，如far-field）：回声消除之后、VAD和编码之前的频域维纳滤波，增加10ms延迟；
+        // LINX_NS_SUPPRESS_DB调整最大压低量（默认15dB）
+        const char* ns_env = std::getenv("LINX_NS");
+        bool ns_enabled = ns_env != nullptr ? std::string(ns_env) == "1" : device_profile.noise_suppression;
+        if (ns_enabled && CHANNELS == 1) {
+            NoiseSuppressorConfig ns_config;
+            ns_config.sample_rate = SAMPLE_RATE;
+            if (const char* depth_env = std::getenv("LINX_NS_SUPPRESS_DB")) {
+                ns_config.max_suppression_db = static_cast<float>(std::atof(depth_env));
+            }
+            noise_suppressor = std::make_shared<NoiseSuppressor>(ns_config);
+            capture_pump.SetNoiseSuppressor(noise_suppressor);
+            INFO("ns: fft {}, block {} samples, max suppression {:.0f}dB", noise_suppressor->FftSize(),
+                 noise_suppressor->BlockSamples(), ns_config.max_suppression_db);
+        }
+        // 自动增益（LINX_AGC=1，或设备配置开启）：把说话电平拉到LINX_AGC_TARGET_DBFS（默认-20dBFS），峰值限制在-1dBFS，
+        // 不同外壳和距离下送给ASR的电平一致，响亮环境也不削波
+        const char* agc_env = std::getenv("LINX_AGC");
+        bool agc_enabled = agc_env != nullptr ? std::string(agc_env) == "1" : device_profile.auto_gain;
+        if (agc_enabled) {
+            AutoGainConfig agc_config;
+            agc_config.sample_rate = SAMPLE_RATE;
+            agc_config.channels = CHANNELS;
+            if (const char* target_env = std::getenv("LINX_AGC_TARGET_DBFS")) {
+                agc_config.target_dbfs = static_cast<float>(std::atof(target_env));
+            }
+            if (const char* max_gain_env = std::getenv("LINX_AGC_MAX_GAIN_DB")) {
+                agc_config.max_gain_db = static_cast<float>(std::atof(max_gain_env));
+            }
+            auto_gain = std::make_shared<AutoGainController>(agc_config);
+            capture_pump.SetAutoGain(auto_gain);
+            INFO("agc: target {:.0f}dBFS, gain {:.0f}..{:.0f}dB, limiter {:.0f}dBFS", agc_config.target_dbfs,
+                 agc_config.min_gain_db, agc_config.max_gain_db, agc_config.limiter_dbfs);
+        }
+        // 会话录音（LINX_RECORD_DIR=<目录>）：每个会话的麦克风和播放音频各写一组文件，
+        // 文件I/O全部在录音线程上，采集/播放线程只拷贝进内存缓冲区。
+        // LINX_RECORD_FORMAT=opus时直接封装上下行的Opus包（Ogg/Opus），写盘量约为WAV的1/10。
+        // LINX_RECORD_IO=auto|uring|threads时录音线程也不阻塞在写盘上（io_uring或I/O线程池），
+        // LINX_RECORD_DIRECT=1时以O_DIRECT写，长时间录音不占页缓存
+        bool record_mic = false;  // WAV录音需要采集帧
+        if (const char* record_dir = std::getenv("LINX_RECORD_DIR")) {
+            SessionRecorderConfig record_config;
+            record_config.directory = record_dir;
+            record_config.sample_rate = SAMPLE_RATE;
+            record_config.channels = CHANNELS;
+            const char* record_format = std::getenv("LINX_RECORD_FORMAT");
+            if (record_format != nullptr && std::string(record_format) == "opus") {
+                record_config.format = RecordFormat::OggOpus;
+            }
+            if (const char* record_io = std::getenv("LINX_RECORD_IO")) {
+                std::string io = record_io;
+                record_config.async_io = io == "auto" || io == "uring" || io == "threads";
+                record_config.io.backend = io == "uring"     ? AsyncIoBackend::IoUring
+                                           : io == "threads" ? AsyncIoBackend::Threads
+                                                             : AsyncIoBackend::Auto;
+                const char* record_direct = std::getenv("LINX_RECORD_DIRECT");
+                record_config.io.direct = record_direct != nullptr && std::string(record_direct) == "1";
+            }
+            session_recorder = std::make_shared<SessionRecorder>(record_config);
+            session_recorder->Start();
+            record_mic = record_config.format == RecordFormat::Wav;
+            INFO("session recorder: {} ({}, {} io{})", record_dir,
+                 record_config.format == RecordFormat::OggOpus ? "ogg/opus" : "wav",
+                 record_config.async_io ? AsyncIoBackendName(record_config.io.backend) : "stdio",
+                 record_config.io.direct ? ", O_DIRECT" : "");
+        }
+        // 采集帧分接：WAV录音和共享内存音频分接共用一个回调
+        if (record_mic || audio_tap) {
+            capture_pump.SetPcmTap([record_mic](const short* pcm, size_t samples) {
+                if (record_mic) {
+                    session_recorder->Push(RecordStream::Mic, pcm, samples);
+                }
+                if (audio_tap) {
+                    audio_tap->Publish(TapStream::Capture, pcm, samples, LatencyTracer::NowUs());
+                }
+            });
+        }
+        capture_pump.SetLatencyTracer(latency_tracer);
+        capture_pump.SetFrameTrace(frame_trace);
+        capture_pump.SetThreadHook([]() { ApplyAudioThreadPolicy("linx-capture", CpuDomain::Capture); });
+        if (deadline_watchdog) {
+            // 采集以帧为节拍，播放以设备周期为节拍；引擎模式下播放在引擎回调中完成，只监视采集
+            capture_pump.SetDeadlineMonitor(
+                deadline_watchdog->Register("capture", static_cast<uint64_t>(FRAME_DURATION_MS) * 1000));
+            if (!use_engine) {
+                playback_deadline =
+                    deadline_watchdog->Register("playback", static_cast<uint64_t>(audio_profile.period_ms) * 1000);
+            }
+            deadline_watchdog->Start();
+        }
+        // 自适应比特率（LINX_ABR）：上行拥塞时降低码率，避免帧在发送队列中积压、延迟无限增长
+        bool abr_enabled = false;
+        BitrateControllerConfig abr_config = LoadBitrateConfig(&abr_enabled);
+        std::shared_ptr<BitrateController> bitrate_controller;
+        if (abr_enabled) {
+            bitrate_controller = std::make_shared<BitrateController>(abr_config, []() {
+                CongestionSignals signals;
+                if (!udp_audio.IsOpen()) {  // UDP通道不经过发送队列，只看RTT
+                    signals.queue_depth = ws_client.SendQueueDepth();
+                    signals.send_delay_ms = ws_client.GetSendLatencyStats().last_us / 1000.0;
+                }
+                signals.rtt_ms = ws_client.RttMs();
+                return signals;
+            });
+            capture_pump.SetBitrateController(bitrate_controller);
+            INFO("abr: {}~{} bps", abr_config.min_bitrate, abr_config.max_bitrate);
+        }
+        capture_pump.SetPacketHandler([](const unsigned char* data, size_t len) {
+            bool opus = uplink_opus.load(std::memory_order_relaxed);
+            if (black_box && opus) {
+                black_box->Push(BlackBoxStream::Uplink, data, len);
+            }
+            if (session_recorder && opus) {
+                session_recorder->PushPacket(RecordStream::Mic, data, len);  // 仅Ogg/Opus录音
+            }
+            // 服务器下发了UDP通道时音频走UDP，否则通过WebSocket发送二进制数据
+            if (udp_audio.IsOpen()) {
+                udp_audio.Send(data, len);
+            } else {
+                Control().SendBinary(data, len);  // MQTT控制通道不承载音频，没有UDP通道时丢弃
+            }
+        });
+        Reactor reactor;                  // 先于引擎构造、后于引擎析构
+        std::thread reactor_thread;
+        std::shared_ptr<WebSocketManager> ws_manager;
+#ifndef __APPLE__
+        AlsaEngine engine;
+        if (use_engine) {
+            AlsaEngineConfig engine_config;
+            engine_config.sample_rate = SAMPLE_RATE;
+            engine_config.channels = CHANNELS;
+            engine_config.period_frames = audio_profile.PeriodSize();
+            engine_config.periods = audio_profile.periods;
+            engine_config.capture_device = ResolveEngineDevice(*audio, audio_devices.capture, true);
+            engine_config.playback_device = ResolveEngineDevice(*audio, audio_devices.playback, false);
+            if (!engine.Open(engine_config)) {
+                throw std::runtime_error("打开ALSA引擎失败");
+            }
+            // 采集回调：每个周期推给采集泵，攒满一帧后编码发送
+            engine.SetCaptureHandler([&capture_pump](const short* pcm, size_t frames) {
+                capture_pump.PushPcm(pcm, frames);
+            });
+            // 播放回调：从抖动缓冲区取数据，TTS中途断流时用Opus丢包隐藏补齐，其余由引擎补静音
+            // 引擎把播放缓冲维持在 playback_fill_periods 个周期，新写入的周期前面约排着其余周期
+            uint64_t engine_delay_us = static_cast<uint64_t>(engine.PeriodFrames()) *
+                                       (std::max(2u, engine_config.playback_fill_periods) - 1) * 1000000 /
+                                       std::max(1u, engine.SampleRate());
+            engine.SetPlaybackHandler([&engine, engine_delay_us](short* out, size_t frames) -> size_t {
+                size_t want = frames * CHANNELS;
+                playout_drain.Poll(audio_buffer.jitter.Drained());
+                HandleSentenceCommand();
+                if (audio_buffer.take_interrupt()) {
+                    engine.DropPlayback();        // 引擎在下一轮循环中丢弃设备缓冲
+                    playout_drain.Dropped();
+                    if (tts_drift) {
+                        tts_drift->Reset();
+                    }
+                    if (echo_reference) {
+                        echo_reference->Flush();
+                    }
+                    FeedEchoReference(nullptr, want);
+                    return 0;
+                }
+                size_t n = output_mixer.Mix(out, want);
+                size_t tts = output_mixer.Produced(tts_stream);
+                if (tts > 0) {
+                    TracePlayed(engine_delay_us, tts);
+                    uint64_t played_through_us = engine_delay_us + tts / CHANNELS * 1000000 / std::max(1u, engine.SampleRate());
+                    playout_drain.NoteWritten(played_through_us);
+                    sentence_scheduler.OnPlayed(played_through_us);
+                }
+                if (n < want) {
+                    n += audio_buffer.jitter.Conceal(out + n, want - n);
+                }
+                n = n / CHANNELS * CHANNELS;
+                FeedEchoReference(out, n);
+                FeedEchoReference(nullptr, want - n);  // 引擎补的静音
+                return n / CHANNELS;
+            });
+            if (use_reactor) {
+                // 引擎的回调和lws回调都在reactor线程上串行执行，该线程按音频线程的策略调度
+                engine.Attach(reactor);
+                ws_manager = std::make_shared<WebSocketManager>(&reactor, ws_buffers, ws_deflate);
+                ws_client.SetManager(ws_manager);
+                reactor_thread = std::thread([&reactor]() {
+                    ApplyAudioThreadPolicy("linx-reactor", CpuDomain::Network);
+                    reactor.Run();
+                });
+            } else {
+                engine.SetThreadHook([]() { ApplyAudioThreadPolicy("linx-audio", CpuDomain::Capture); });
+                engine.Start();
+            }
+        }
+#endif
 
-            while (linx_state.running) {
-                // 从音频设备读取PCM数据
-                audio->Read(buffer, CHUNK);
+        // 运行时指标：LINX_METRICS_SOCKET=<路径> 和/或 LINX_METRICS_PORT=<端口> 开启拉取端点，
+        // 如 `curl 127.0.0.1:9464/metrics` 或 `echo json | nc -U /tmp/linx.sock`。
+        // 已有的统计都注册为采样函数，只在被抓取时读取，采集/播放/网络线程上没有新增开销
+        MetricsRegistry& metrics = MetricsRegistry::Global();
+        metrics.AddCounterSampler("linx_capture_frames_read_total", "Frames read from the capture device",
+                                  [&capture_pump]() { return capture_pump.GetStats().frames_read; });
+        metrics.AddCounterSampler("linx_capture_frames_encoded_total", "Frames encoded and handed to the socket",
+                                  [&capture_pump]() { return capture_pump.GetStats().frames_encoded; });
+        metrics.AddCounterSampler("linx_capture_frames_suppressed_total", "Frames skipped by the uplink VAD",
+                                  [&capture_pump]() { return capture_pump.GetStats().frames_suppressed; });
+        metrics.AddCounterSampler("linx_capture_bytes_encoded_total", "Opus bytes produced by the encoder",
+                                  [&capture_pump]() { return capture_pump.GetStats().bytes_encoded; });
+        metrics.AddCounterSampler("linx_capture_encode_us_total", "CPU time spent encoding, microseconds",
+                                  [&capture_pump]() { return capture_pump.GetStats().encode_us; });
+        metrics.AddCounterSampler("linx_capture_preroll_frames_total",
+                                  "Pre-roll frames flushed when listening started",
+                                  [&capture_pump]() { return capture_pump.GetStats().gate_preroll_sent; });
+        metrics.AddCounterSampler("linx_capture_idle_suspends_total", "Times the capture device was suspended while idle",
+                                  [&capture_pump]() { return capture_pump.GetStats().idle_suspends; });
+        metrics.AddCounterSampler("linx_capture_idle_ms_total", "Time the capture device spent suspended",
+                                  [&capture_pump]() { return capture_pump.GetStats().idle_ms; });
+        metrics.AddGaugeSampler("linx_capture_wake_latency_us", "Last wake latency from state change to first frame",
+                                [&capture_pump]() { return capture_pump.GetStats().wake_latency_us; });
+        metrics.AddGaugeSampler("linx_capture_buffer_ms",
+                                "Time captured audio waited in driver buffers before it was read",
+                                [&capture_pump]() { return capture_pump.GetStats().capture_buffer_ms; });
+        metrics.AddCounterSampler("linx_capture_wake_words_total", "Wake words detected on the device",
+                                  [&capture_pump]() { return capture_pump.GetStats().keywords_detected; });
+        metrics.AddCounterSampler("linx_ws_frames_sent_total", "Frames written to the WebSocket",
+                                  []() { return ws_client.GetSendLatencyStats().frames; });
+        metrics.AddCounterSampler("linx_ws_send_drops_total", "Frames dropped by the send queue (all reasons)",
+                                  []() { return ws_client.SendQueueDrops(); });
+        metrics.AddCounterSampler("linx_ws_send_expired_total", "Uplink audio frames dropped after queueing past the deadline",
+                                  []() { return ws_client.GetSendDropStats().expired; });
+        metrics.AddCounterSampler("linx_ws_send_over_budget_total",
+                                  "Oldest uplink audio frames dropped to stay within the queue budget",
+                                  []() { return ws_client.GetSendDropStats().over_budget; });
+        metrics.AddCounterSampler("linx_frame_pool_exhausted_total", "Audio frame pool requests that found the pool empty",
+                                  []() { return audio_frames.GetStats().exhausted; });
+        metrics.AddGaugeSampler("linx_frame_pool_in_use", "Audio frames currently referenced",
+                                []() { return audio_frames.GetStats().in_use; });
+        metrics.AddGaugeSampler("linx_playout_drain_wait_ms", "Last wait from tts stop until playout drained",
+                                []() { return playout_drain.GetStats().last_wait_ms; });
+        metrics.AddCounterSampler("linx_playout_drain_timeouts_total", "Playout drains forced by the timeout",
+                                  []() { return playout_drain.GetStats().timeouts; });
+        metrics.AddCounterSampler("linx_mixer_mixed_periods_total", "Playback periods that mixed two or more streams",
+                                  []() { return output_mixer.GetStats().mixed_periods; });
+        metrics.AddCounterSampler("linx_mixer_ducked_periods_total", "Playback periods with TTS ducked under a prompt",
+                                  []() { return output_mixer.GetStats().ducked_periods; });
+        if (asset_player) {
+            metrics.AddCounterSampler("linx_prompts_played_total", "Asset pack prompts started",
+                                      []() { return asset_player->GetStats().started; });
+        }
+        metrics.AddCounterSampler("linx_tts_sentences_total", "TTS sentences announced by sentence_start",
+                                  []() { return sentence_scheduler.GetStats().sentences; });
+        metrics.AddCounterSampler("linx_tts_sentences_skipped_total", "TTS sentences skipped locally",
+                                  []() { return sentence_scheduler.GetStats().skipped; });
+        metrics.AddGaugeSampler("linx_tts_sentence_stall_ms", "How late the last sentence started after the previous one",
+                                []() { return sentence_scheduler.GetStats().last_stall_ms; });
+        metrics.AddGaugeSampler("linx_startup_ready_ms", "Time from process start to the first WebSocket connection",
+                                []() { return startup_ready_ms.load(); });
+        metrics.AddGaugeSampler("linx_startup_listen_ready_ms",
+                                "Time from process start until capture runs and the server hello arrived",
+                                []() { return std::max(0.0, startup_trace.ElapsedMs("listen-ready")); });
+        metrics.AddGaugeSampler("linx_ws_send_queue_depth", "Frames waiting in the send queue",
+                                []() { return ws_client.SendQueueDepth(); });
+        metrics.AddGaugeSampler("linx_ws_send_control_depth", "Control messages waiting in the send queue",
+                                []() { return ws_client.SendQueueDepth(SendLane::Control); });
+        metrics.AddGaugeSampler("linx_ws_send_audio_depth", "Audio frames waiting in the send queue",
+                                []() { return ws_client.SendQueueDepth(SendLane::Audio); });
+        metrics.AddGaugeSampler("linx_ws_send_bulk_depth", "Bulk messages waiting in the send queue",
+                                []() { return ws_client.SendQueueDepth(SendLane::Bulk); });
+        metrics.AddCounterSampler("linx_ws_connections_total", "WebSocket connections established",
+                                  []() { return ws_client.Connections(); });
+        metrics.AddCounterSampler("linx_ws_connect_errors_total", "WebSocket connection attempts that failed",
+                                  []() { return ws_client.ConnectErrors(); });
+        metrics.AddCounterSampler("linx_ws_disconnects_total", "Established WebSocket connections that closed",
+                                  []() { return ws_client.Disconnects(); });
+        metrics.AddCounterSampler("linx_ws_rx_frames_lost_total", "Downlink frames missing from sequence gaps",
+                                  []() { return ws_client.GetBinaryRxStats().lost; });
+        metrics.AddCounterSampler("linx_ws_rx_frames_reordered_total", "Downlink frames that arrived out of order",
+                                  []() { return ws_client.GetBinaryRxStats().reordered; });
+        metrics.AddCounterSampler("linx_ws_rx_frames_malformed_total", "Downlink binary frames with a bad header",
+                                  []() { return ws_client.GetBinaryRxStats().malformed; });
+        metrics.AddCounterSampler("linx_udp_packets_sent_total", "Opus packets sent over the UDP audio channel",
+                                  []() { return udp_audio.GetStats().packets_sent; });
+        metrics.AddCounterSampler("linx_udp_send_errors_total", "UDP audio packets that could not be sent",
+                                  []() { return udp_audio.GetStats().send_errors; });
+        metrics.AddCounterSampler("linx_udp_packets_received_total", "Opus packets received over UDP",
+                                  []() { return udp_audio.GetStats().packets_received; });
+        metrics.AddCounterSampler("linx_udp_packets_lost_total", "Downlink UDP packets missing from sequence gaps",
+                                  []() { return udp_audio.GetStats().lost; });
+        metrics.AddCounterSampler("linx_udp_packets_malformed_total", "UDP packets with a bad header or payload",
+                                  []() { return udp_audio.GetStats().malformed; });
+        metrics.AddCounterSampler("linx_ws_reconnects_total", "WebSocket reconnect attempts",
+                                  []() { return ws_client.Reconnects(); });
+        metrics.AddCounterSampler("linx_session_resumes_total", "Sessions resumed by the server after a reconnect",
+                                  []() { return linx_state.resumes.load(); });
+        metrics.AddCounterSampler("linx_session_resume_rejects_total",
+                                  "Reconnects that asked to resume but got a new session",
+                                  []() { return linx_state.resume_rejects.load(); });
+        metrics.AddGaugeSampler("linx_tts_decode_queue_depth", "TTS packets waiting for the decode thread",
+                                []() { return tts_decoder.Depth(); });
+        metrics.AddCounterSampler("linx_tts_decode_queue_drops_total",
+                                  "TTS packets dropped because the decode queue was full",
+                                  []() { return tts_decoder.GetStats().dropped; });
+        metrics.AddGaugeSampler("linx_tts_queue_bytes", "Compressed TTS bytes waiting for the decode thread",
+                                []() { return tts_decoder.Bytes(); });
+        metrics.AddGaugeSampler("linx_tts_buffer_bytes",
+                                "Downlink TTS memory in use: queued packets plus decoded PCM in the jitter buffer",
+                                []() { return tts_decoder.Bytes() + audio_buffer.jitter.Depth() * sizeof(short); });
+        metrics.AddCounterSampler("linx_tts_decode_held_ms_total",
+                                  "Time the decode thread waited because the jitter buffer was full enough",
+                                  []() { return tts_decoder.GetStats().held_us / 1000.0; });
+        metrics.AddGaugeSampler("linx_clock_offset_ms", "Estimated server clock minus local monotonic clock",
+                                []() { return clock_sync.OffsetUs() / 1000.0; });
+        metrics.AddGaugeSampler("linx_clock_rtt_ms", "Round trip of the clock sync sample in use (error bound x2)",
+                                []() { return clock_sync.DelayUs() / 1000.0; });
+        metrics.AddCounterSampler("linx_tts_scheduled_starts_total", "TTS segments started at the server's play_at",
+                                  []() { return audio_buffer.jitter.GetStats().scheduled_starts; });
+        metrics.AddCounterSampler("linx_tts_late_starts_total",
+                                  "Scheduled TTS starts that were late and skipped ahead to stay in sync",
+                                  []() { return audio_buffer.jitter.GetStats().late_starts; });
+        metrics.AddCounterSampler("linx_tts_missed_starts_total",
+                                  "Scheduled TTS starts too late to align, played from the beginning",
+                                  []() { return audio_buffer.jitter.GetStats().missed_starts; });
+        metrics.AddCounterSampler("linx_ws_rx_pauses_total", "Times WebSocket reads were paused for TTS backpressure",
+                                  []() { return ws_client.ReceivePauses(); });
+        metrics.AddCounterSampler("linx_ws_rx_paused_ms_total", "Time WebSocket reads spent paused",
+                                  []() { return ws_client.ReceivePausedMs(); });
+        metrics.AddCounterSampler("linx_ws_endpoint_switches_total",
+                                  "Switches to another candidate server after a failed connection",
+                                  []() { return ws_client.EndpointSwitches(); });
+        metrics.AddCounterSampler("linx_ws_tls_resumed_total", "WebSocket connections that resumed a TLS session",
+                                  []() { return ws_client.ResumedSessions(); });
+        metrics.AddCounterSampler("linx_ws_idle_suspends_total", "WebSocket connections closed after the idle timeout",
+                                  []() { return ws_client.IdleSuspends(); });
+        metrics.AddGaugeSampler("linx_ws_idle_resume_ms", "Last reconnect time after an idle disconnect",
+                                []() { return ws_client.LastResumeMs(); });
+        metrics.AddGaugeSampler("linx_ws_rtt_ms", "Smoothed WebSocket ping round-trip time",
+                                []() { return ws_client.RttMs(); });
+        metrics.AddGaugeSampler("linx_ws_rtt_jitter_ms", "Mean deviation of the WebSocket ping round-trip time",
+                                []() { return ws_client.RttJitterMs(); });
+        metrics.AddCounterSampler("linx_ws_dead_peer_total", "WebSocket connections closed after a ping went unanswered",
+                                  []() { return ws_client.DeadPeers(); });
+        metrics.AddGaugeSampler("linx_ws_batch_frames", "Opus frames per uplink message (1 = no aggregation)",
+                                []() { return ws_client.BatchFrames(); });
+        metrics.AddCounterSampler("linx_ws_batches_sent_total", "Uplink messages carrying several Opus frames",
+                                  []() { return ws_client.BatchesSent(); });
+        if (ws_deflate.enabled) {
+            metrics.AddCounterSampler("linx_ws_deflate_in_bytes_total", "Text message bytes before permessage-deflate",
+                                      []() { return ws_client.GetDeflateStats().bytes_in; });
+            metrics.AddCounterSampler("linx_ws_deflate_out_bytes_total", "Text message bytes after permessage-deflate",
+                                      []() { return ws_client.GetDeflateStats().bytes_out; });
+        }
+        if (bitrate_controller) {
+            metrics.AddGaugeSampler("linx_abr_bitrate_bps", "Current Opus bitrate chosen by the congestion controller",
+                                    [bitrate_controller]() { return bitrate_controller->GetStats().bitrate; });
+            metrics.AddCounterSampler("linx_abr_decreases_total", "Bitrate reductions caused by uplink congestion",
+                                      [bitrate_controller]() { return bitrate_controller->GetStats().decreases; });
+        }
+        if (beamformer) {
+            metrics.AddHistogram("linx_bf_frame_us", "CPU time of mic-array beamforming per capture frame, microseconds",
+                                 &beamformer->FrameCost());
+            metrics.AddGaugeSampler("linx_doa_degrees", "Estimated talker direction of arrival, degrees",
+                                    []() { return beamformer->DoaDegrees(); });
+            metrics.AddGaugeSampler("linx_doa_confidence", "Confidence of the direction-of-arrival estimate (0-1)",
+                                    []() { return beamformer->DoaConfidence(); });
+        }
+        if (noise_suppressor) {
+            metrics.AddHistogram("linx_ns_frame_us", "CPU time of noise suppression per capture frame, microseconds",
+                                 &noise_suppressor->FrameCost());
+            metrics.AddGaugeSampler("linx_ns_noise_dbfs", "Noise level tracked by the noise suppressor",
+                                    []() { return noise_suppressor->GetStats().noise_dbfs; });
+        }
+        if (auto_gain) {
+            metrics.AddGaugeSampler("linx_agc_gain_db", "Gain currently applied by the capture AGC",
+                                    []() { return auto_gain->GetStats().gain_db; });
+            metrics.AddCounterSampler("linx_agc_limited_blocks_total", "Capture blocks whose gain the limiter reduced",
+                                      []() { return auto_gain->GetStats().limited_blocks; });
+        }
+        metrics.AddCounterSampler("linx_log_dropped_total", "Log messages dropped because the async queue was full",
+                                  []() { return LogDroppedMessages(); });
+        metrics.AddCounterSampler("linx_session_changes_total", "Session ID changes (new session or goodbye)",
+                                  []() { return linx_state.session.Generation(); });
+        metrics.AddGaugeSampler("linx_jitter_depth_samples", "Samples buffered in the TTS jitter buffer",
+                                []() { return audio_buffer.jitter.Depth(); });
+        metrics.AddGaugeSampler("linx_jitter_target_delay_ms", "Current jitter buffer target delay",
+                                []() { return audio_buffer.jitter.TargetDelayMs(); });
+        metrics.AddCounterSampler("linx_jitter_underruns_total", "Jitter buffer underruns during playback",
+                                  []() { return audio_buffer.jitter.GetStats().underruns; });
+        metrics.AddCounterSampler("linx_jitter_concealed_samples_total", "Samples generated by packet loss concealment",
+                                  []() { return audio_buffer.jitter.GetStats().concealed_samples; });
+        if (tts_drift) {
+            metrics.AddGaugeSampler("linx_playout_drift_ppm", "Estimated clock offset between server and speaker",
+                                    []() { return tts_drift->GetStats().drift_ppm; });
+            metrics.AddGaugeSampler("linx_playout_drift_correction_ppm", "Playout rate correction currently applied",
+                                    []() { return tts_drift->GetStats().correction_ppm; });
+            metrics.AddGaugeSampler("linx_playout_drift_error_ms", "Smoothed jitter buffer depth minus its target",
+                                    []() { return tts_drift->GetStats().depth_error_ms; });
+        }
+        bool engine_xruns = false;  // 引擎模式下设备由引擎打开，xrun计在引擎统计中
+#ifndef __APPLE__
+        if (use_engine) {
+            metrics.AddCounterSampler("linx_capture_xruns_total", "Capture overruns",
+                                      [&engine]() { return engine.GetStats().capture_xruns; });
+            metrics.AddCounterSampler("linx_playback_xruns_total", "Playback underruns",
+                                      [&engine]() { return engine.GetStats().playback_xruns; });
+            engine_xruns = true;
+        }
+#endif
+        if (!engine_xruns) {
+            metrics.AddCounterSampler("linx_capture_xruns_total", "Capture overruns",
+                                      []() { return audio->GetXrunStats().capture_xruns; });
+            metrics.AddCounterSampler("linx_playback_xruns_total", "Playback underruns",
+                                      []() { return audio->GetXrunStats().playback_xruns; });
+        }
+        for (size_t i = 0; i < static_cast<size_t>(LatencyStage::kCount); ++i) {
+            LatencyStage stage = static_cast<LatencyStage>(i);
+            metrics.AddHistogram(std::string("linx_latency_") + LatencyStageMetricName(stage) + "_us",
+                                 std::string("Latency of ") + LatencyStageName(stage) + ", microseconds",
+                                 &latency_tracer->Histogram(stage));
+        }
+        if (deadline_watchdog) {
+            for (const auto& monitor : deadline_watchdog->Monitors()) {
+                DeadlineMonitor* m = monitor.get();
+                std::string prefix = "linx_" + m->Name() + "_deadline_";
+                metrics.AddCounterSampler(prefix + "misses_total", "Loop iterations of the " + m->Name() +
+                                          " thread that overran their period",
+                                          [m]() { return m->Misses(); });
+                metrics.AddCounterSampler(prefix + "stalls_total", "Times the " + m->Name() +
+                                          " thread stopped heartbeating inside a stage",
+                                          [m]() { return m->GetStats().stalls; });
+                metrics.AddHistogram(prefix + "lateness_us", "Time each " + m->Name() +
+                                     " iteration ran past its period, microseconds", &m->Lateness());
+            }
+        }
+        MetricsServerConfig metrics_config;
+        if (const char* socket_env = std::getenv("LINX_METRICS_SOCKET")) {
+            metrics_config.unix_path = socket_env;
+        }
+        if (const char* port_env = std::getenv("LINX_METRICS_PORT")) {
+            metrics_config.tcp_port = std::atoi(port_env);
+        }
+        MetricsServer metrics_server(metrics, metrics_config);  // 先于采集泵和引擎析构，采样函数不会访问已销毁的对象
+        RegisterMemoryMetrics(metrics);
+        metrics_server.AddCommand("memory", []() { return MemoryReport(); });
+        RegisterLockMetrics(metrics);
+        metrics_server.AddCommand("locks", []() { return LockReport(); });
+        if (tts_cache) {
+            metrics.AddCounterSampler("linx_tts_cache_hits_total", "TTS sentences played from the local cache",
+                                      []() { return tts_cache->GetStats().hits; });
+            metrics.AddCounterSampler("linx_tts_cache_misses_total", "Cacheable TTS sentences not in the local cache",
+                                      []() { return tts_cache->GetStats().misses; });
+            metrics.AddGaugeSampler("linx_tts_cache_disk_bytes", "Bytes of TTS cache entries on disk",
+                                    []() { return tts_cache->GetStats().disk_bytes; });
+            metrics_server.AddCommand("tts-cache-clear", []() {
+                tts_cache->Clear();
+                return std::string("tts cache cleared");
+            });
+        }
+        if (audio_tap) {
+            metrics.AddCounterSampler("linx_audio_tap_frames_total", "Frames published to the shared-memory audio tap",
+                                      []() {
+                                          AudioTapStats stats = audio_tap->GetStats();
+                                          return stats.frames[0] + stats.frames[1];
+                                      });
+        }
+        if (black_box) {
+            metrics_server.AddCommand("blackbox", []() { return black_box->DumpToDir(); });
+            metrics.AddCounterSampler("linx_blackbox_overwritten_total", "Black box packets overwritten by newer ones",
+                                      []() {
+                                          AudioBlackBoxStats stats = black_box->GetStats();
+                                          return stats.overwritten[0] + stats.overwritten[1];
+                                      });
+            metrics.AddCounterSampler("linx_blackbox_dumps_total", "Black box exports to Ogg/Opus",
+                                      []() { return black_box->GetStats().dumps; });
+        }
+        if (!metrics_config.unix_path.empty() || metrics_config.tcp_port > 0) {
+            metrics_server.Start();
+        }
+        for (size_t i = 0; i < static_cast<size_t>(CpuDomain::kCount); ++i) {
+            CpuDomain domain = static_cast<CpuDomain>(i);
+            std::string name = CpuDomainName(domain);
+            metrics.AddHistogram("linx_turn_cpu_" + name + "_us", "CPU time spent on " + name + " per conversation turn",
+                                 &cpu_accounting.TurnHistogram(domain));
+            metrics.AddCounterSampler("linx_cpu_" + name + "_us_total", "CPU time spent on " + name + ", microseconds",
+                                      [domain]() { return cpu_accounting.Snapshot().Ns(domain) / 1000; });
+        }
+        metrics.AddHistogram("linx_turn_cpu_us", "Process CPU time per conversation turn",
+                             &cpu_accounting.TurnTotal());
+        metrics.AddCounterSampler("linx_cpu_turns_total", "Conversation turns with a CPU cost breakdown",
+                                  []() { return cpu_accounting.Turns(); });
+        if (cpu_accounting.Config().active_power_mw > 0) {
+            metrics.AddGaugeSampler("linx_turn_energy_mj", "Estimated CPU energy of the last conversation turn",
+                                    []() { return cpu_accounting.LastTurn().energy_mj; });
+        }
+        TelemetryUploader telemetry(metrics, TELEMETRY);  // 析构先于metrics_server
+        if (telemetry.Start()) {
+            metrics.AddCounterSampler("linx_telemetry_uploads_total", "Telemetry batches accepted by the server",
+                                      [&telemetry]() { return telemetry.GetStats().uploads; });
+            metrics.AddCounterSampler("linx_telemetry_failures_total", "Telemetry uploads that failed or were rejected",
+                                      [&telemetry]() { return telemetry.GetStats().failures; });
+            metrics.AddCounterSampler("linx_telemetry_dropped_total",
+                                      "Telemetry records dropped by the memory bound or a server rejection",
+                                      [&telemetry]() { return telemetry.GetStats().records_dropped; });
+            metrics.AddGaugeSampler("linx_telemetry_pending_bytes", "Encoded telemetry records waiting for upload",
+                                    [&telemetry]() { return telemetry.GetStats().pending_bytes; });
+        }
+        SetupControlServer(reactor, capture_pump);
 
-                // 检查是否处于录音状态
-                if (linx_state.listen_state != "start") {
-                    usleep(10 * 1000);  // 非录音状态时休眠10毫秒
-                    continue;
+        // 会话状态变化都在网络线程上发生，逐条记录便于对照服务端日志
+        linx_state.session.SetTransitionHandler([&capture_pump](const SessionSnapshot& from,
+                                                                const SessionSnapshot& to) {
+            if (control_server) {
+                // 订阅的界面据此更新显示，不需要轮询state
+                if (from.listen != to.listen) {
+                    control_server->Broadcast(std::string("listen ") + ListenStateName(to.listen));
                 }
-
-                // 将PCM数据编码为Opus格式
-                opus_buffer.insert(opus_buffer.end(), buffer, buffer + CHUNK);
-                int encoded = opus.Encode(opus_buffer.data(), 2 * CHUNK, buffer, CHUNK);
-                
-                // 如果编码成功，通过WebSocket发送二进制数据
-                if (encoded > 0) {
-                    ws_client.send_binary(opus_buffer.data(), encoded);
+                if (from.tts != to.tts) {
+                    control_server->Broadcast(std::string("tts ") + TtsStateName(to.tts));
+                }
+            }
+            // CPU按轮次记账：一轮从开始录音起，到这一轮的回复播完（tts stop）为止；
+            // 回复播完后仍在录音（实时对话）时下一轮立即开始，会话结束时结束当前轮
+            if (from.listen != to.listen && to.Listening()) {
+                cpu_accounting.BeginTurn();
+            }
+            if (from.tts != to.tts && to.tts == TtsState::Stop) {
+                cpu_accounting.EndTurn();
+                if (to.Listening()) {
+                    cpu_accounting.BeginTurn();
+                }
+            }
+            if (from.generation != to.generation) {
+                cpu_accounting.EndTurn();
+            }
+            if (from.listen != to.listen) {
+                INFO("session: listen {} -> {}", ListenStateName(from.listen), ListenStateName(to.listen));
+                if (linx_state.running) {
+                    capture_pump.Wake();  // 采集端处于省电空闲时重新检查门控
+                }
+            }
+            if (from.tts != to.tts) {
+                INFO("session: tts {} -> {}", TtsStateName(from.tts), TtsStateName(to.tts));
+                if (to.tts == TtsState::Stop && !echo_canceller) {
+                    capture_pump.DiscardGatePreroll();  // 没有回声消除时，播放期间预录的是扬声器回声
+                }
+            }
+            if (from.generation != to.generation) {
+                INFO("session: generation {}", to.generation);
+                if (session_recorder) {
+                    session_recorder->StartSession(linx_state.session.SessionId());  // 空ID时停止录音
                 }
-                
-                opus_buffer.clear();  // 清空缓冲区
-                usleep(10 * 1000);    // 休眠10毫秒
             }
         });
 
         // 5. 启动WebSocket通信线程
         // 功能：建立WebSocket连接，处理服务器消息，管理会话状态
-        std::thread ws_thread = std::thread([]() {
+        auto start_ws = [&capture_pump]() {
             // 设置WebSocket请求头
             std::map<std::string, std::string> headers;
-            headers["Authorization"] = "Bearer " + access_token;  // 认证令牌
-            headers["Protocol-Version"] = "1";                   // 协议版本
+            headers["Authorization"] = "Bearer " + ws_access_token;  // 认证令牌
+            headers["Protocol-Version"] = std::to_string(PROTOCOL_VERSION);  // 协议版本（二进制分帧）
             headers["Device-Id"] = device_mac;                   // 设备ID
             headers["Client-Id"] = device_uuid;                  // 客户端ID
 
+            ws_client.SetBinaryProtocol(PROTOCOL_VERSION);  // 上行帧加帧头，下行帧校验并剥离帧头
             ws_client.SetWsHeaders(headers);  // 设置WebSocket头部
+
+            // 断线重连：指数退避，重连使用缓存的服务器地址和TLS会话；LINX_WS_RECONNECT=0时断线即退出
+            const char* reconnect_env = std::getenv("LINX_WS_RECONNECT");
+            ReconnectPolicy reconnect;
+            reconnect.enabled = reconnect_env == nullptr || std::string(reconnect_env) != "0";
+            ws_client.SetReconnectPolicy(reconnect);
+            // 每5秒一次ping测量RTT：用于自动帧合并的判定和linx_ws_rtt_ms指标；
+            // ping后LINX_WS_PING_TIMEOUT_MS（默认15000，0关闭）内无任何应答即判定对端失联，断开并重连
+            const char* ping_timeout_env = std::getenv("LINX_WS_PING_TIMEOUT_MS");
+            int ping_timeout_ms = ping_timeout_env != nullptr ? std::max(0, std::atoi(ping_timeout_env)) : 15000;
+            ws_client.SetPingInterval(std::chrono::milliseconds(5000), std::chrono::milliseconds(ping_timeout_ms));
+            // 上行背压：网络停顿时丢弃排队超过LINX_WS_AUDIO_DEADLINE_MS（默认500，0关闭）的音频，
+            // LINX_WS_AUDIO_BUDGET限制队列中的音频帧数；控制消息不受影响
+            const char* deadline_env = std::getenv("LINX_WS_AUDIO_DEADLINE_MS");
+            const char* budget_env = std::getenv("LINX_WS_AUDIO_BUDGET");
+            SendBackpressure backpressure;
+            backpressure.max_audio_age =
+                std::chrono::milliseconds(deadline_env != nullptr ? std::max(0, std::atoi(deadline_env)) : 500);
+            backpressure.max_audio_frames = budget_env != nullptr ? std::max(0, std::atoi(budget_env)) : 0;
+            ws_client.SetSendBackpressure(backpressure);
+            if (AGGREGATION.mode != AggregationMode::Off) {
+                ws_client.SetAggregation(AGGREGATION);
+            }
             // 设置WebSocket连接建立回调
             // 功能：连接成功后发送hello消息，告知服务器音频参数
-            ws_client.SetOnOpenCallback([&]() -> std::string {
+            // 会话回调设置在控制通道上（WebSocket或MQTT），下面的应用逻辑与通道类型无关
+            ControlTransport& transport = Control();
+            transport.SetOnOpenMessagesCallback([&]() -> std::vector<std::string> {
                 INFO("on open");  // 记录连接成功日志
+                // 回调在网络服务线程上执行（lws服务线程、MQTT线程或reactor），该线程由SDK创建，在这里登记
+                cpu_accounting.RegisterCurrentThread("network", CpuDomain::Network);
+                if (startup_ready_ms.load() == 0) {
+                    // 冷启动就绪耗时：进程启动到第一次连上服务器（OTA、音频初始化与连接并行进行）
+                    startup_trace.End("ws-open");
+                    startup_ready_ms = startup_trace.ElapsedMs("ws-open");
+                    INFO("startup: connected {:.0f}ms after start", startup_ready_ms.load());
+                }
                 
-                // 构建hello消息，包含音频参数配置
-                json hello_msg = {
-                    {"type", "hello"},                    // 消息类型
-                    {"version", 1},                      // 协议版本
-                    {"transport", "websocket"},          // 传输方式
-                    {"audio_params", {                   // 音频参数
-                        {"format", "opus"},              // 音频格式：Opus
-                        {"sample_rate", SAMPLE_RATE},    // 采样率：16kHz
-                        {"channels", CHANNELS},          // 声道数：单声道
-                        {"frame_duration", 60}           // 帧持续时间：60ms
-                    }}
-                };
-                return hello_msg.dump();  // 返回JSON字符串
+                // 断线后在续接窗口内重连：hello带上原会话ID和最后收到的下行序号，请求服务器从断点继续
+                linx_state.resume_requested = false;
+                if (!linx_state.resume_session.empty()) {
+                    auto offline = std::chrono::steady_clock::now() - linx_state.resume_since;
+                    if (offline <= std::chrono::milliseconds(SESSION_RESUME_MS)) {
+                        linx_state.resume_requested = true;
+                        INFO("resuming session {} after {}ms offline, last sequence {}", linx_state.resume_session,
+                             std::chrono::duration_cast<std::chrono::milliseconds>(offline).count(),
+                             linx_state.resume_sequence);
+                    } else {
+                        linx_state.resume_session.clear();
+                        PlayPrompt("disconnected");  // 断线太久，原会话已无法续接
+                    }
+                }
+
+                // 构建hello消息，包含音频参数配置：Opus、采样率、声道数、上行帧持续时间
+                std::vector<std::string> messages;
+                if (!Control().CarriesAudio() && wake_spotter && !linx_state.resume_requested) {
+                    // MQTT控制通道：空闲时不开会话（也就没有UDP音频通道），唤醒时再发hello
+                    INFO("{} connected, idle until wake word", Control().Name());
+                    if (startup_trace.Mark("hello") && CheckListenReady()) {
+                        PlayPrompt("startup");
+                    }
+                    return messages;
+                }
+                messages.emplace_back(HelloMessage(
+                    control_writer,
+                    linx_state.resume_requested ? std::string_view(linx_state.resume_session) : std::string_view(),
+                    linx_state.resume_sequence));
+                // 乐观开始：listen start紧跟hello发出，服务器处理完hello即开始识别，不再等一个往返；
+                // 唤醒词模式下连接时还没有人说话，等唤醒后再开始；续接时按服务器的回复恢复录音
+                int wake_keyword = linx_state.wake_pending.load();
+                if (OPTIMISTIC_START && !wake_spotter && !linx_state.resume_requested) {
+                    linx_state.listen_sent = true;
+                    messages.emplace_back(control_writer.Listen({}, "start", ListenMode()));
+                } else if (OPTIMISTIC_START && !linx_state.resume_requested &&
+                           (wake_keyword >= 0 || wake_keyword == kListenRequested)) {
+                    // 空闲断开后由唤醒（或按键）恢复的连接：唤醒词和listen随hello一并发出，与连接时唤醒相同
+                    if (wake_keyword >= 0 && wake_spotter) {
+                        messages.emplace_back(control_writer.Detect({}, wake_spotter->Keyword(wake_keyword)));
+                    }
+                    linx_state.wake_pending = kListenRequested;
+                    linx_state.listen_sent = true;
+                    messages.emplace_back(control_writer.Listen({}, "start", ListenMode()));
+                }
+                return messages;
             });
 
             // 设置WebSocket连接关闭回调
             // 功能：连接断开时清理状态，停止所有线程
-            ws_client.SetOnCloseCallback([]() {
-                linx_state.listen_state = "stop";  // 停止录音
+            // 启用断线重连时（默认）只停止录音，播放缓冲区、发送队列和各线程保持不动，重连后服务器的hello重新开始监听
+            // 会话进行中断线且会重连时记下会话以便续接，此时不播放断线提示，播放缓冲区中的TTS继续播出
+            transport.SetOnCloseCallback([]() {
+                if (shutdown_requested) {
+                    linx_state.running = false;    // 退出时主动关闭的连接：不续接、不提示
+                    return;
+                }
+                if (Control().Suspended() || linx_state.idle_resume_us.load() != 0) {
+                    // 空闲断开（或刚关闭就已被唤醒恢复）：没有进行中的会话，不续接、不提示；
+                    // 唤醒状态（wake_pending、listen_sent）留给恢复后的连接
+                    linx_state.session.SetSessionId("");
+                    INFO("{} closed while idle", Control().Name());
+                    return;
+                }
+                std::string session_id = linx_state.session.SessionId();
+                bool resumable = SESSION_RESUME_MS > 0 && Control().Reconnecting() && !session_id.empty();
+                if (resumable && linx_state.resume_session != session_id) {
+                    // 同一会话在续接过程中再次断线时保留第一次断线的时刻和录音状态
+                    linx_state.resume_session = session_id;
+                    linx_state.resume_listening = linx_state.session.Listening();
+                    linx_state.resume_since = std::chrono::steady_clock::now();
+                }
+                if (resumable) {
+                    // UDP通道的序号与WebSocket帧无关，此时不上报序号，由服务器按自己发出的位置继续
+                    linx_state.resume_sequence = udp_audio.IsOpen() ? 0 : ws_client.LastRxSequence();
+                } else {
+                    linx_state.resume_session.clear();
+                }
+                playout_drain.Cancel();                           // 连接已断开，回复播完后不再发送listen
+                linx_state.session.SetListen(ListenState::Stop);  // 停止录音
+                linx_state.listen_sent = false;                   // 随hello发出的listen已随连接失效
+                if (!resumable) {
+                    PlayPrompt("disconnected");
+                }
+                if (Control().Reconnecting()) {
+                    INFO("{} disconnected, reconnecting", Control().Name());
+                    return;
+                }
                 linx_state.running = false;        // 停止所有线程
-                INFO("WebSocket disconnected");    // 记录断开日志
+                INFO("{} disconnected", Control().Name());  // 记录断开日志
+                RequestShutdown();                 // 唤醒等待退出的主线程
             });
 
             // 设置WebSocket连接失败回调
             // 功能：连接失败时记录错误日志
-            ws_client.SetOnFailCallback([]() { 
-                ERROR("WebSocket connection failed"); 
+            transport.SetOnFailCallback([]() {
+                ERROR("{} connection failed", Control().Name());
+                // 启动后一直连不上时提示一次，重连期间的每次失败不再重复
+                static std::atomic<bool> prompted{false};
+                if (startup_ready_ms.load() == 0 && !prompted.exchange(true)) {
+                    PlayPrompt("network_error");
+                }
             });
 
             // 设置WebSocket消息接收回调
             // 功能：处理服务器发送的文本消息和二进制音频数据
-            ws_client.SetOnMessageCallback([](const std::string& msg, bool binary) -> std::string {
+            // 消息处理函数：返回需要回复给服务器的文本（为空表示无需回复）
+            // 回复指向control_writer的缓冲区，在下一条消息处理之前有效
+            auto handle_message = [&capture_pump](std::string_view msg, bool binary) -> std::string_view {
                 if (binary) {
                     // ==================== 处理二进制音频数据（TTS） ====================
-                    // INFO("<< binary data");  // 可选：记录接收到二进制数据
-                    
-                    // 解码Opus音频数据为PCM格式
-                    std::vector<opus_int16> pcm_data(CHUNK);  // PCM解码缓冲区
-                    int decoded = opus.Decode(pcm_data.data(), CHUNK, 
-                                            (unsigned char*)(msg.data()), msg.size());
-                    
-                    if (decoded > 0) {
-                        // 解码成功，将PCM数据转换为short格式
-                        short buffer[CHUNK] = {};
-                        memcpy((char*)&buffer[0], (char*)&pcm_data[0], CHUNK * 2);
-                        
-                        // 将音频数据推入缓冲区，由播放线程异步播放
-                        // 这样可以避免直接播放导致的underflow问题
-                        audio_buffer.push(buffer, CHUNK);
-                    }
-                    return "";  // 二进制消息不需要回复
+                    HandleTtsPacket(reinterpret_cast<const unsigned char*>(msg.data()), msg.size());
+                    return {};  // 二进制消息不需要回复
                 } else {
                     // ==================== 处理文本消息（控制指令） ====================
-                    try {
-                        std::string resmsg = msg;
-                        INFO("<< {}", resmsg);  // 记录接收到的消息
-                        
-                        // 验证消息格式：必须是有效的JSON
-                        if (resmsg.empty() || resmsg[0] != '{') {
-                            WARN("Received non-JSON message, ignoring: {}", resmsg);
-                            return "";  // 忽略非JSON消息
+                    INFO("<< {}", msg);  // 记录接收到的消息
+
+                    // 单遍扫描解析：只取协议字段，不构建DOM；失败时再交给nlohmann给出详细错误
+                    ControlMessage received;
+                    if (!control_parser.Parse(msg, &received)) {
+                        try {
+                            MemoryScope json_scope(MemoryTag::Json);
+                            json parsed = json::parse(msg);
+                            WARN("Unsupported control message ({}), ignoring", parsed.type_name());
+                        } catch (const std::exception& e) {
+                            // JSON解析异常处理
+                            ERROR("JSON parse error: {}", e.what());
+                            ERROR("Raw message content (first 100 chars): {}", msg.substr(0, 100));
+
+                            // 输出消息的十六进制表示，便于调试非标准JSON消息
+                            std::string hex_dump;
+                            for (size_t i = 0; i < std::min(msg.size(), size_t(50)); ++i) {
+                                char buf[4];
+                                sprintf(buf, "%02x ", (unsigned char)msg[i]);  // 转换为十六进制
+                                hex_dump += buf;
+                            }
+                            ERROR("Message hex dump: {}", hex_dump);
+                        }
+                        return {};
+                    }
+
+                    // 时钟同步应答：攒够几个样本之前接着请求
+                    if (received.type == ControlType::Time) {
+                        if (!clock_sync.AddSample(static_cast<uint64_t>(received.t0), received.t1, received.t2,
+                                                  LatencyTracer::NowUs())) {
+                            return {};
+                        }
+                        if (clock_sync.Samples() < kClockSyncBurst) {
+                            clock_sync_sent_us = LatencyTracer::NowUs();
+                            return control_writer.Time(clock_sync_sent_us);
                         }
-                        
-                        // 解析JSON消息
-                        json received_msg = json::parse(resmsg);
-                        
-                        // 处理hello响应：服务器确认连接，返回会话ID
-                        if (received_msg["type"] == "hello") {
-                            linx_state.session_id = received_msg["session_id"];  // 保存会话ID
-                            
-                            // 构建开始录音消息
-                            json start_msg = {
-                                {"session_id", linx_state.session_id},  // 会话ID
-                                {"type", "listen"},                     // 消息类型：开始监听
-                                {"state", "start"},                    // 状态：开始
-                                {"mode", "auto"}                       // 模式：自动
-                            };
-
-                            linx_state.listen_state = "start";  // 设置录音状态为开始
-                            INFO("");                            // 空日志行，用于格式化
-                            return start_msg.dump();             // 返回开始录音消息
+                        if (clock_sync.Samples() == kClockSyncBurst) {
+                            INFO("clock sync: offset {:.3f}s, rtt {:.1f}ms", clock_sync.OffsetUs() / 1e6,
+                                 clock_sync.DelayUs() / 1000.0);
+                        }
+                        return {};
+                    }
+
+                    // 处理hello响应：服务器确认连接，返回会话ID
+                    if (received.type == ControlType::Hello) {
+                        // 续接：服务器回复resumed且会话ID不变（可省略）时沿用原会话，否则按新会话处理
+                        bool resumed = linx_state.resume_requested && received.resumed &&
+                                       (received.session_id.empty() ||
+                                        received.session_id == linx_state.resume_session);
+                        if (linx_state.resume_requested && !resumed) {
+                            linx_state.resume_rejects.fetch_add(1, std::memory_order_relaxed);
+                            WARN("session {} was not resumed, starting a new session", linx_state.resume_session);
+                            PlayPrompt("disconnected");
+                        }
+                        linx_state.resume_requested = false;
+                        linx_state.resume_session.clear();
+                        if (!resumed || !received.session_id.empty()) {
+                            linx_state.session.SetSessionId(received.session_id);  // 保存会话ID
+                        }
+                        if (SYNC_PLAYBACK) {
+                            // 可能换了服务器：重新估计时钟偏移
+                            clock_sync.Reset();
+                            clock_sync_sent_us = LatencyTracer::NowUs();
+                            Control().SendText(control_writer.Time(clock_sync_sent_us));
+                        }
+                        if (startup_trace.Mark("hello")) {
+                            if (CheckListenReady()) {
+                                PlayPrompt("startup");
+                            }
+                        }
+                        if (int64_t since_us = linx_state.idle_resume_us.exchange(0)) {
+                            double ready_ms = (static_cast<int64_t>(SteadyNowUs()) - since_us) / 1000.0;
+                            INFO("idle resume: session ready {:.0f}ms after wake (connect {:.0f}ms)", ready_ms,
+                                 ws_client.LastResumeMs());
+                            if (ready_ms > kIdleResumeBudgetMs) {
+                                WARN("idle resume took {:.0f}ms, over the {:.0f}ms budget", ready_ms,
+                                     kIdleResumeBudgetMs);
+                            }
+                        }
+                        if (received.version != 0 && received.version != PROTOCOL_VERSION) {
+                            WARN("server hello version {} differs from protocol version {}", received.version,
+                                 PROTOCOL_VERSION);
+                        }
+                        if (UdpAudioRequested()) {
+                            SetupUdpAudio(received);  // 每次hello都按服务器下发的参数重新建立（含重连后）
+                        }
+                        if (!resumed && audio_buffer.jitter.Depth() > 0) {
+                            InterruptPlayback();  // 新会话开始，上一会话未播完的TTS不再播放
+                        }
+
+                        // 下行帧时长以服务器声明为准；接收端按包内实际样本数解码，任意合法帧长都能处理
+                        if (received.has_audio_params) {
+                            int duration = received.frame_duration > 0 ? received.frame_duration : FRAME_DURATION_MS;
+                            if (OpusEncoderCtx::IsValidFrameDuration(duration)) {
+                                linx_state.server_frame_duration = duration;
+                            }
+                            if (duration != FRAME_DURATION_MS) {
+                                INFO("server frame_duration {}ms (uplink {}ms)", duration, FRAME_DURATION_MS);
+                            }
+                            // 服务器选定的格式用于上下行，未声明时为opus（不认识formats的服务器）
+                            std::string format = received.format.empty() ? kFormatOpus : std::string(received.format);
+                            AudioEncoder* encoder = CodecRegistry::Instance().Has(format) ? UplinkEncoder(format) : nullptr;
+                            if (encoder == nullptr) {
+                                WARN("server audio format {} is not supported, using opus", format);
+                                format = kFormatOpus;
+                                encoder = &opus_uplink;
+                            }
+                            if (format != capture_pump.EncoderFormat()) {
+                                INFO("audio format {} (offered {})", format, AUDIO_FORMAT);
+                            }
+                            if (capture_pump.SetEncoder(*encoder)) {
+                                uplink_opus = encoder->Opus() != nullptr;
+                            } else {
+                                WARN("audio format {}: encoder does not fit the capture pump", format);
+                            }
+                            downlink_opus = format == kFormatOpus;
+                            // 下行采样率/声道以服务器声明为准：Opus 解码器直接输出播放采样率，只有播放采样率不是
+                            // Opus 支持的采样率时才重采样，其他格式按流的采样率解码。排在已到达的音频之后，在解码线程上生效
+                            unsigned int stream_rate = received.sample_rate > 0 ? received.sample_rate : 0;
+                            int stream_channels = received.channels;
+                            tts_cache_format = format + "/" + std::to_string(stream_rate) + "/" +
+                                               std::to_string(stream_channels) + "/" + std::to_string(duration);
+                            tts_decoder.Post([stream_rate, stream_channels, format]() {
+                                std::lock_guard<std::mutex> lock(decoder_mutex);
+                                bool changed = opus_decoder.Configure(stream_rate, stream_channels, format);
+                                if (changed || (stream_rate != 0 && stream_rate != SAMPLE_RATE)) {
+                                    INFO("server downlink {} {}Hz/{}ch, decoding at {}Hz{}", opus_decoder.Format(),
+                                         stream_rate, stream_channels, opus_decoder.DecodeRate(),
+                                         opus_decoder.Resampling() ? " + resampling" : "");
+                                }
+                            });
                         }
 
-                        // 处理TTS状态消息：服务器通知TTS播放状态变化
-                        if (received_msg["type"] == "tts") {
-                            linx_state.tts_state = received_msg["state"];  // 更新TTS状态
+                        // 续接成功：服务器从断点继续下发，播放缓冲区保留；断线前在录音的恢复录音，
+                        // 回复已经收完、正在播出的，播完后照常开始下一轮录音
+                        if (resumed) {
+                            linx_state.resumes.fetch_add(1, std::memory_order_relaxed);
+                            INFO("session {} resumed", linx_state.session.SessionId());
+                            if (linx_state.resume_listening) {
+                                linx_state.session.SetListen(ListenState::Start);
+                                return control_writer.Listen(linx_state.session.SessionId(), "start", ListenMode());
+                            }
+                            if (linx_state.session.Tts() == TtsState::Stop) {
+                                tts_decoder.Post([]() {
+                                    playout_drain.Request(ListenAfterPlayout);
+                                    audio_buffer.wake();
+                                });
+                            }
+                            return {};
                         }
 
-                        // TTS播放结束后，重新开始录音监听
-                        if (linx_state.tts_state == "stop") {
-                            linx_state.session_id = received_msg["session_id"];  // 更新会话ID
-                            
-                            // 构建重新开始录音消息
-                            json start_msg = {
-                                {"session_id", linx_state.session_id},  // 会话ID
-                                {"type", "listen"},                     // 消息类型：开始监听
-                                {"state", "start"},                    // 状态：开始
-                                {"mode", "auto"}                       // 模式：自动
-                            };
-
-                            linx_state.listen_state = "start";  // 重新开始录音
-                            INFO("");                            // 空日志行
-                            return start_msg.dump();             // 返回开始录音消息
+                        // 唤醒词模式：等本地唤醒后再开始录音；hello是唤醒时重新发起的，则先上报唤醒词
+                        if (wake_spotter) {
+                            int keyword = linx_state.wake_pending.exchange(-1);
+                            if (keyword < 0 && keyword != kListenRequested) {
+                                INFO("waiting for wake word");
+                                ArmIdleDisconnect();  // 等待唤醒期间没有收发时断开
+                                return {};
+                            }
+                            if (keyword >= 0) {
+                                Control().SendText(control_writer.Detect(received.session_id,
+                                                                          wake_spotter->Keyword(keyword)));
+                            }
                         }
+                        linx_state.session.SetListen(ListenState::Start);  // 设置录音状态为开始
+                        INFO("");                            // 空日志行，用于格式化
+                        if (linx_state.listen_sent.exchange(false)) {
+                            // listen start已随hello发出：门控刚打开，预录环中等待hello期间的音频随下一帧补发
+                            INFO("listen was sent with hello, streaming buffered audio");
+                            return {};
+                        }
+                        // 开始录音消息：模式为自动，启用回声消除时为实时
+                        return control_writer.Listen(received.session_id, "start", ListenMode());
+                    }
 
-                        // TTS开始播放时，停止录音避免回音
-                        if (linx_state.tts_state == "start") {
-                            linx_state.listen_state = "stop";   // 停止录音
+                    // 处理TTS状态消息：服务器通知TTS播放状态变化
+                    if (received.type == ControlType::Tts) {
+                        TtsState tts_state;
+                        if (ParseTtsState(received.state, &tts_state)) {
+                            linx_state.session.SetTts(tts_state);  // 更新TTS状态
+                        } else {
+                            WARN("unknown tts state: {}", received.state);
+                        }
+                        // 以下涉及抖动缓冲区写入位置的操作交给解码线程，排在已到达、尚未解码的音频之后
+                        if (linx_state.session.Tts() == TtsState::Start) {
+                            playout_drain.Cancel();          // 上一段还没播完又开始新的一段，不再开始录音
+                            linx_state.tts_aborted = false;  // 新一段TTS开始，恢复接收音频
+                            tts_cache_replaying = false;
+                            latency_tracer->BeginReply();    // 以最近的语音帧为本轮延迟起点
+                            // 同步播放：本段第一个样本在服务器指定的时刻播出
+                            uint64_t play_at = 0;
+                            if (SYNC_PLAYBACK && received.play_at > 0) {
+                                play_at = clock_sync.ToLocal(received.play_at);
+                                if (play_at == 0) {
+                                    WARN("tts play_at ignored: clock not synchronized yet");
+                                }
+                            }
+                            tts_decoder.Post([play_at]() {
+                                sentence_scheduler.BeginReply();
+                                audio_buffer.jitter.ScheduleStart(play_at);
+                            });
+                        }
+                        // 句子边界：之后的音频属于这一句 / 这一句已发完，下一句没到时在句尾干净结束
+                        if (linx_state.session.Tts() == TtsState::SentenceStart) {
+                            tts_decoder.Post([text = std::string(received.text)]() {
+                                sentence_scheduler.BeginSentence(text);
+                            });
+                            BeginCachedSentence(received);
                         }
+                        if (linx_state.session.Tts() == TtsState::SentenceEnd) {
+                            EndCachedSentence();
+                            tts_decoder.Post([]() { sentence_scheduler.EndSentence(); });
+                        }
+                        if (linx_state.session.Tts() == TtsState::Stop) {
+                            // 没有sentence_end的一句不完整，不写入缓存
+                            tts_cache_replaying = false;
+                            if (tts_cache) {
+                                tts_cache->AbortRecord();
+                            }
+                            // 本段TTS已结束，剩余数据直接播完，不再等待目标深度
+                            tts_decoder.Post([]() {
+                                audio_buffer.jitter.MarkEndOfStream();
+                                JitterBufferStats stats = audio_buffer.jitter.GetStats();
+                                INFO("jitter: target {}ms, jitter {:.1f}ms, late {}, dropped {}, underruns {}, "
+                                     "flushes {}", stats.target_delay_ms, stats.jitter_ms, stats.late_frames,
+                                     stats.dropped_samples, stats.underruns, stats.flushes);
+                            });
+                        }
+                    }
 
-                        // 处理goodbye消息：会话结束
-                        if (received_msg["type"] == "goodbye" &&
-                            linx_state.session_id == received_msg["session_id"]) {
-                            INFO("<< Goodbye");              // 记录会话结束
-                            linx_state.session_id = "";      // 清空会话ID
+                    // TTS播放结束后，重新开始录音监听：服务器已发完，但抖动缓冲区和设备里还有没播出的音频，
+                    // 等它们从扬声器播完再发送listen start（由播放线程回调），避免切掉回复的结尾
+                    if (linx_state.session.Tts() == TtsState::Stop) {
+                        if (!received.session_id.empty()) {
+                            linx_state.session.SetSessionId(received.session_id);  // 更新会话ID
                         }
+                        tts_decoder.Post([]() {
+                            // 剩余的音频解码完之后再等待播完
+                            playout_drain.Request(ListenAfterPlayout);
+                            audio_buffer.wake();             // 播放线程可能正阻塞在空闲等待上
+                        });
+                        INFO("");                            // 空日志行
+                        return {};
+                    }
 
-                    } catch (const std::exception& e) {
-                        // JSON解析异常处理
-                        ERROR("JSON parse error: {}", e.what());
-                        ERROR("Raw message content (first 100 chars): {}", msg.substr(0, 100));
-                        
-                        // 输出消息的十六进制表示，便于调试非标准JSON消息
-                        std::string hex_dump;
-                        for (size_t i = 0; i < std::min(msg.size(), size_t(50)); ++i) {
-                            char buf[4];
-                            sprintf(buf, "%02x ", (unsigned char)msg[i]);  // 转换为十六进制
-                            hex_dump += buf;
+                    // TTS开始播放时，停止录音避免回音（启用回声消除时继续录音，允许打断）
+                    if (linx_state.session.Tts() == TtsState::Start && !echo_canceller) {
+                        linx_state.session.SetListen(ListenState::Stop);  // 停止录音
+                    }
+
+                    // 处理goodbye消息：会话结束
+                    if (received.type == ControlType::Goodbye && linx_state.session.IsSession(received.session_id)) {
+                        INFO("<< Goodbye");              // 记录会话结束
+                        playout_drain.Cancel();          // 会话已结束，回复播完后不再开始录音
+                        linx_state.session.SetSessionId("");  // 清空会话ID，会话代数随之加一
+                        if (wake_spotter) {
+                            linx_state.session.SetListen(ListenState::Stop);  // 回到本地唤醒
                         }
-                        ERROR("Message hex dump: {}", hex_dump);
+                        if (!Control().CarriesAudio()) {
+                            udp_audio.Close();  // 会话的UDP音频通道随goodbye关闭，空闲时只保留MQTT连接
+                        }
+                        ArmIdleDisconnect();
                     }
                 }
-                return "";  // 文本消息处理完成，无需回复
+                return {};  // 文本消息处理完成，无需回复
+            };
+
+            // 使用零拷贝接收回调：msg直接指向lws接收缓冲区（分片消息由SDK重组），不再为每条消息构造std::string
+            transport.SetOnMessageViewCallback([handle_message](std::string_view msg, bool binary) {
+                std::string_view reply = handle_message(msg, binary);
+                if (!reply.empty()) {
+                    Control().SendText(reply);
+                }
+            });
+
+            // 启动控制通道，开始连接服务器（MQTT时连接代理）
+            transport.Start();
+        };
+        // 会话回调都已设置好，地址解析完成后即可发起连接，不必等待音频设备
+        if (DECODE_THREAD) {
+            // 解码线程的优先级介于音频I/O线程和网络线程之间：解码落后会直接造成播放欠载
+            tts_decoder.SetThreadHook([]() { ApplyAudioThreadPolicy("linx-decode", CpuDomain::Decode, -5); });
+            // 按需解码：抖动缓冲区只比播放所需多出一个周期，其余的包压缩着留在队列中，播放线程取走数据时唤醒；
+            // 队列字节数过高时暂停读取WebSocket
+            tts_decoder.SetSinkReady([]() {
+                int ahead_ms = TTS_FLOW.decode_ahead_ms > 0 ? TTS_FLOW.decode_ahead_ms : audio_profile.period_ms;
+                size_t ahead = static_cast<size_t>(ahead_ms) * SAMPLE_RATE * CHANNELS / 1000;
+                return audio_buffer.jitter.Depth() < audio_buffer.jitter.WantedDepth() + ahead;
+            });
+            if (TTS_FLOW.queue_bytes > 0) {
+                tts_decoder.SetFlowControl(TTS_FLOW.queue_bytes, TTS_FLOW.queue_bytes / 2, [](bool paused) {
+                    ws_client.PauseReceive(paused && !udp_audio.IsOpen());
+                });
+            }
+            tts_decoder.Start();
+        }
+        startup.Add("connect", {"resolve"}, [start_ws, use_reactor]() {
+            startup_trace.Begin("ws-open");  // 到连接建立（on open）为止
+            if (use_reactor) {
+                start_ws();  // 连接在reactor线程上发起，不需要单独的网络线程
+                return;
+            }
+            // lws服务线程继承发起线程的调度策略：在独立线程上降低优先级后再启动，避免抢占音频I/O
+            std::thread ws_thread([start_ws]() {
+                ApplyAudioThreadPolicy("linx-ws", CpuDomain::Network, -10);
+                start_ws();
             });
+            ws_thread.join();
+        });
+        if (!use_engine) {
+            try {
+                startup.Wait("audio");
+            } catch (...) {
+                // 设备打开失败：连接可能已经建立，先停止回调对采集泵等局部对象的访问再退出
+                linx_state.running = false;
+                throw;
+            }
+            // 回环延迟校准：文件和空设备没有声学回路，不校准
+            if (file_audio == nullptr && null_audio == nullptr && CalibrateLatency(audio_devices)) {
+                ApplyLatencyCalibration(capture_pump);
+            }
+            playback_thread = std::thread(playback_loop);
+            capture_pump.Start();
+        }
+        startup_trace.Mark("capture");
+        if (CheckListenReady()) {
+            PlayPrompt("startup");
+        }
+        startup.Wait("connect");
 
-            // 启动WebSocket客户端，开始连接服务器
-            ws_client.start();
+        // kill -HUP重新读取设备配置：信号处理函数只置标志，文件读取和参数下发在这个普通优先级的线程上；
+        // 同步播放时顺带定期发出time请求，跟上两端时钟的频偏
+        std::thread profile_thread([&capture_pump]() {
+            ControlWriter writer;  // control_writer只供网络线程使用
+            while (linx_state.running) {
+                {
+                    std::unique_lock<std::mutex> lock(shutdown_mutex);
+                    shutdown_cv.wait_for(lock, std::chrono::milliseconds(200), []() { return !linx_state.running; });
+                }
+                if (profile_reload_requested.exchange(false, std::memory_order_relaxed)) {
+                    std::string reply;
+                    ReloadDeviceProfile(std::string(), capture_pump, &reply);
+                }
+                uint64_t now = LatencyTracer::NowUs();
+                if (SYNC_PLAYBACK && Control().IsConnected() &&
+                    now - clock_sync_sent_us.load() >=
+                        static_cast<uint64_t>(std::chrono::microseconds(kClockSyncInterval).count())) {
+                    clock_sync_sent_us = now;
+                    Control().SendText(writer.Time(now));
+                }
+            }
         });
+        std::signal(SIGHUP, OnReloadSignal);
 
         // ==================== 主线程等待和清理 ====================
         
         // 主线程等待用户输入，按回车键退出程序
-        INFO("Press Enter to exit...");
-        std::cin.get();                    // 阻塞等待用户输入
-        linx_state.running = false;        // 设置退出标志，通知所有线程停止
-        
+        // 控制套接字挂在reactor上：没有reactor线程时由主线程在等待退出期间驱动
+        Reactor* main_reactor = control_server && !reactor_thread.joinable() ? &reactor : nullptr;
+        if (file_audio != nullptr) {
+            WaitForReplay(*file_audio, main_reactor);  // 文件回放：输入播完且回复播放完毕后自动退出
+        } else {
+            INFO("Press Enter to exit...");
+            if (main_reactor != nullptr) {
+                RunControlLoop(*main_reactor);
+            } else {
+                WaitForShutdown();         // 阻塞等待回车或退出信号
+            }
+        }
+        // 以下每一步都有界：阻塞的设备读写由Abort打断，连接发出close帧后最多等待一半时限，超时由看门狗兜底
+        ShutdownWatchdog shutdown_watchdog;
+        shutdown_watchdog.Arm();
+        shutdown_requested = true;         // 回车退出时也置位：之后的关闭回调不再续接、不再提示
+        INFO("shutting down");
+        shutdown_stage = "control";
+        if (control_server) {
+            control_server->Stop();        // 不再接受命令（reactor线程上执行）
+        }
+        {
+            std::lock_guard<std::mutex> lock(shutdown_mutex);
+            linx_state.running = false;    // 设置退出标志，通知所有线程停止
+        }
+        shutdown_cv.notify_all();          // 唤醒按周期轮询的线程
+        audio_buffer.wake();               // 唤醒等待数据的播放线程
+        if (deadline_watchdog) {
+            deadline_watchdog->Stop();      // 线程退出过程中不再报告停滞
+        }
+        shutdown_stage = "audio abort";
+        audio->Abort();                     // 唤醒阻塞在设备读写中的采集/播放线程，设备中未播完的数据直接丢弃
+        shutdown_stage = "websocket close";
+        if (Control().IsConnected() &&
+            !Control().Close(std::chrono::milliseconds(SHUTDOWN_TIMEOUT_MS > 0 ? SHUTDOWN_TIMEOUT_MS / 2 : 1000))) {
+            WARN("{} close not acknowledged, dropping connection", Control().Name());
+        }
+        if (mqtt_transport) {
+            mqtt_transport->Close(std::chrono::milliseconds(0));  // 未连接时停止重连，等待网络线程结束
+            MqttStats mqtt_stats = mqtt_transport->Client().GetStats();
+            INFO("mqtt: {} connections ({} errors, {} disconnects), {} published ({} dropped), {} received, "
+                 "{} pings ({} timeouts), {}/{} bytes sent/received",
+                 mqtt_stats.connections, mqtt_stats.connect_errors, mqtt_stats.disconnects, mqtt_stats.published,
+                 mqtt_stats.publish_drops, mqtt_stats.received, mqtt_stats.pings, mqtt_stats.ping_timeouts,
+                 mqtt_stats.bytes_sent, mqtt_stats.bytes_received);
+        }
+
+        cpu_accounting.EndTurn();
+        cpu_accounting.Freeze();            // 各线程即将退出，之后不再读取它们的CPU时钟
+
         // 等待所有工作线程安全结束
+        shutdown_stage = "playback thread";
         if (playback_thread.joinable()) {
             playback_thread.join();         // 等待播放线程结束
         }
-        if (audio_thread.joinable()) {
-            audio_thread.join();            // 等待录音线程结束
+        shutdown_stage = "profile thread";
+        if (profile_thread.joinable()) {
+            profile_thread.join();          // 配置监视线程随退出标志结束
+        }
+        shutdown_stage = "firmware download";
+        if (firmware_download) {
+            if (firmware_delta) {
+                firmware_delta->Cancel();   // 补丁不续传，下次启动重新下载
+            }
+            firmware_download->Cancel();    // 写出进度，下次启动续传
+            firmware_thread.join();
+        }
+        shutdown_stage = "capture thread";
+        capture_pump.Stop();                // 等待采集线程结束
+        shutdown_stage = "decoder";
+        tts_decoder.Stop();                 // 停止解码线程，之后到达的包在接收线程上直接解码
+        shutdown_stage = "network";
+        if (udp_audio.IsOpen()) {
+            UdpAudioStats udp_stats = udp_audio.GetStats();
+            INFO("udp audio: {} sent ({} errors), {} received, {} lost, {} reordered, {} malformed",
+                 udp_stats.packets_sent, udp_stats.send_errors, udp_stats.packets_received, udp_stats.lost,
+                 udp_stats.reordered, udp_stats.malformed);
+            udp_audio.Close();              // 停止UDP接收线程
+        }
+#ifndef __APPLE__
+        if (use_engine) {
+            shutdown_stage = "audio engine";
+            engine.Stop();                  // 等待ALSA引擎线程结束（reactor模式下从reactor注销）
+            AlsaEngineStats engine_stats = engine.GetStats();
+            INFO("alsa engine: {} wakeups, {} capture / {} playback periods, {} padded frames, xruns {}/{}, drops {}",
+                 engine_stats.wakeups, engine_stats.capture_periods, engine_stats.playback_periods,
+                 engine_stats.playback_padded, engine_stats.capture_xruns, engine_stats.playback_xruns,
+                 engine_stats.playback_drops);
+        }
+#endif
+        if (use_reactor) {
+            shutdown_stage = "reactor";
+            ws_manager->Stop();             // 在reactor线程上关闭连接、销毁lws上下文
+            reactor.Stop();
+            reactor_thread.join();
+            ReactorStats reactor_stats = reactor.GetStats();
+            INFO("reactor: {} wakeups, {} fd events, {} timers, {} tasks", reactor_stats.wakeups,
+                 reactor_stats.fd_events, reactor_stats.timers_fired, reactor_stats.tasks_run);
+        }
+        shutdown_watchdog.Disarm();         // 各线程均已结束，以下只输出统计和补全文件
+        if (telemetry.Running()) {
+            telemetry.Stop(true);           // 采样最后一次并上传剩余记录（最多等待flush_timeout_seconds）
+            TelemetryStats telemetry_stats = telemetry.GetStats();
+            INFO("telemetry: {} records, {} uploads ({} bytes), {} failures, {} records dropped, {} pending",
+                 telemetry_stats.records, telemetry_stats.uploads, telemetry_stats.bytes_uploaded,
+                 telemetry_stats.failures, telemetry_stats.records_dropped, telemetry_stats.pending_records);
+        }
+        CapturePumpStats pump_stats = capture_pump.GetStats();
+        INFO("capture: {} frames, {} sent, period {:.1f}ms [{:.1f}, {:.1f}]", pump_stats.frames_read,
+             pump_stats.frames_encoded, pump_stats.period_ms, pump_stats.min_period_ms,
+             pump_stats.max_period_ms);
+        INFO("vad: {} speech, {} suppressed ({:.1f}%)", pump_stats.frames_speech,
+             pump_stats.frames_suppressed, pump_stats.suppressed_ratio * 100);
+        INFO("listen preroll: {} frames in {} flushes", pump_stats.gate_preroll_sent,
+             pump_stats.gate_preroll_flushes);
+        if (IDLE_SUSPEND_MS > 0) {
+            INFO("idle: {} suspends, {:.1f}s suspended, wake latency {:.1f}ms (max {:.1f}ms)", pump_stats.idle_suspends,
+                 pump_stats.idle_ms / 1000.0, pump_stats.wake_latency_us / 1000.0,
+                 pump_stats.max_wake_latency_us / 1000.0);
+        }
+        if (wake_spotter) {
+            INFO("wake word: {} detections, {:.1f}ms spotting", pump_stats.keywords_detected,
+                 pump_stats.kws_us / 1000.0);
+        }
+        if (session_recorder) {
+            session_recorder->Stop();       // 写出剩余的缓冲数据并补全文件头
+            SessionRecorderStats record_stats = session_recorder->GetStats();
+            INFO("session recorder: {} samples ({} packets, {} bytes) in {} files, {} samples / {} packets dropped, "
+                 "{} write errors, {} io stalls",
+                 record_stats.samples_recorded, record_stats.packets_recorded, record_stats.bytes_written,
+                 record_stats.files_written, record_stats.samples_dropped, record_stats.packets_dropped,
+                 record_stats.write_errors, record_stats.io_stalls);
+        }
+        if (bitrate_controller) {
+            BitrateControllerStats abr_stats = bitrate_controller->GetStats();
+            INFO("abr: {} bps, {} decreases, {} increases, {} congested intervals", abr_stats.bitrate,
+                 abr_stats.decreases, abr_stats.increases, abr_stats.congested_intervals);
+        }
+        if (echo_canceller) {
+            EchoCancellerStats aec_stats = echo_canceller->GetStats();
+            INFO("aec: erle {:.1f}dB, {} active / {} blocks, double talk {}, diverged {}", aec_stats.erle_db,
+                 aec_stats.active_blocks, aec_stats.blocks, aec_stats.double_talk_blocks,
+                 aec_stats.diverged_blocks);
+        }
+        if (beamformer) {
+            BeamformerStats bf_stats = beamformer->GetStats();
+            INFO("beamformer: {} frames, {:.0f}us avg, {}us max, doa {:.1f}deg (confidence {:.2f}), {} steers",
+                 bf_stats.frames, bf_stats.frames ? static_cast<double>(bf_stats.total_us) / bf_stats.frames : 0.0,
+                 bf_stats.max_us, bf_stats.doa_deg, bf_stats.confidence, bf_stats.steers);
+        }
+        if (noise_suppressor) {
+            NoiseSuppressorStats ns_stats = noise_suppressor->GetStats();
+            INFO("ns: {} frames, {:.0f}us avg, {}us max, noise {:.1f}dBFS", ns_stats.frames,
+                 ns_stats.frames ? static_cast<double>(ns_stats.total_us) / ns_stats.frames : 0.0, ns_stats.max_us,
+                 ns_stats.noise_dbfs);
         }
-        if (ws_thread.joinable()) {
-            ws_thread.join();               // 等待WebSocket线程结束
+        if (auto_gain) {
+            AutoGainStats agc_stats = auto_gain->GetStats();
+            INFO("agc: gain {:.1f}dB, input {:.1f}dBFS, {} active / {} blocks, limited {}", agc_stats.gain_db,
+                 agc_stats.input_dbfs, agc_stats.active_blocks, agc_stats.blocks, agc_stats.limited_blocks);
+        }
+        INFO("latency ({} turns):\n{}", latency_tracer->Turns(), latency_tracer->Report());
+        INFO("cpu ({} turns):\n{}", cpu_accounting.Turns(), cpu_accounting.Report());
+        PlayoutDrainStats drain_stats = playout_drain.GetStats();
+        INFO("playout drain: {} drained, {} timed out, {} cancelled, wait max {:.0f}ms", drain_stats.drains,
+             drain_stats.timeouts, drain_stats.cancelled, drain_stats.max_wait_ms);
+        OutputMixerStats mixer_stats = output_mixer.GetStats();
+        INFO("mixer: {} clips, {} mixed periods, {} ducked periods", mixer_stats.clips_started,
+             mixer_stats.mixed_periods, mixer_stats.ducked_periods);
+        if (asset_player) {
+            AssetPlayerStats prompt_stats = asset_player->GetStats();
+            INFO("prompts: {} started, {} completed, {} decode errors", prompt_stats.started, prompt_stats.completed,
+                 prompt_stats.decode_errors);
+        }
+        if (tts_drift) {
+            DriftCompensatorStats drift_stats = tts_drift->GetStats();
+            INFO("playout drift: {:.1f}ppm estimated, {:+.1f}ppm applied, {} frames adjusted", drift_stats.drift_ppm,
+                 drift_stats.correction_ppm, drift_stats.adjusted_frames);
+        }
+        INFO("memory:\n{}", MemoryReport());
+        if (LockProfilingEnabled()) {
+            INFO("{}", LockReport());
+        }
+        SentenceStats sentence_stats = sentence_scheduler.GetStats();
+        INFO("sentences: {} announced, {} played, {} skipped, {} truncated, first play max {:.0f}ms, stall max {:.0f}ms",
+             sentence_stats.sentences, sentence_stats.played, sentence_stats.skipped, sentence_stats.truncated,
+             sentence_stats.max_first_play_ms, sentence_stats.max_stall_ms);
+        if (frame_trace) {
+            INFO("frame trace: {} records in {}", frame_trace->Records(), frame_trace->Path());
+        }
+        if (deadline_watchdog) {
+            for (const DeadlineStats& deadline : deadline_watchdog->GetStats()) {
+                std::string stages;
+                for (size_t i = 0; i < static_cast<size_t>(DeadlineStage::kCount); ++i) {
+                    if (deadline.stage_misses[i] > 0) {
+                        stages += std::string(" ") + DeadlineStageName(static_cast<DeadlineStage>(i)) + " " +
+                                  std::to_string(deadline.stage_misses[i]);
+                    }
+                }
+                INFO("{} deadline: {} iterations, {} misses{}, {} stalls, lateness p99 {}us max {}us", deadline.name,
+                     deadline.iterations, deadline.misses, stages.empty() ? "" : " (" + stages.substr(1) + ")",
+                     deadline.stalls, deadline.lateness.p99_us, deadline.lateness.max_us);
+            }
+        }
+        if (tts_cache) {
+            TtsCacheStats cache_stats = tts_cache->GetStats();
+            INFO("tts cache: {} hits ({} from disk), {} misses, {} stored, {} too long, {} evicted, {} entries "
+                 "({} bytes on disk)", cache_stats.hits, cache_stats.disk_hits, cache_stats.misses, cache_stats.stores,
+                 cache_stats.rejected, cache_stats.evictions, cache_stats.entries, cache_stats.disk_bytes);
+        }
+        if (control_server) {
+            ControlServerStats control_stats = control_server->GetStats();
+            INFO("control socket: {} connections ({} rejected), {} commands ({} failed), {} events",
+                 control_stats.accepted, control_stats.rejected, control_stats.commands, control_stats.errors,
+                 control_stats.events);
+        }
+        if (audio_tap) {
+            audio_tap->Close();             // 采集与播放线程均已停止，读取端看到closed后退出或重新打开
+            AudioTapStats tap_stats = audio_tap->GetStats();
+            INFO("audio tap: {} capture / {} playout frames, {} wakeups", tap_stats.frames[0], tap_stats.frames[1],
+                 tap_stats.wakeups);
+        }
+        if (black_box) {
+            AudioBlackBoxStats box_stats = black_box->GetStats();
+            INFO("black box: {} uplink / {} downlink packets ({} / {} overwritten), {} dumps, {}",
+                 box_stats.packets[0], box_stats.packets[1], box_stats.overwritten[0], box_stats.overwritten[1],
+                 box_stats.dumps, black_box->Path());
+        }
+        AudioXrunStats xrun_stats = audio->GetXrunStats();
+        INFO("xruns: capture {}, playback {}, suspends {}, recover failures {}, recovery max {}us total {}us",
+             xrun_stats.capture_xruns, xrun_stats.playback_xruns, xrun_stats.suspends,
+             xrun_stats.recover_failures, xrun_stats.max_recover_us, xrun_stats.total_recover_us);
+        if (file_audio != nullptr) {
+            file_audio->Close();            // 写出剩余的播放数据并补全WAV头
+            FileAudioStats file_stats = file_audio->GetStats();
+            INFO("file audio: {} frames captured, {} played ({} padded, {} dropped)", file_stats.captured_frames,
+                 file_stats.played_frames, file_stats.padded_frames, file_stats.dropped_frames);
+        }
+        if (null_audio != nullptr) {
+            FileAudioStats null_stats = null_audio->GetStats();
+            INFO("null audio: {} frames captured, {} played ({} padded, {} dropped, {} underruns)",
+                 null_stats.captured_frames, null_stats.played_frames, null_stats.padded_frames,
+                 null_stats.dropped_frames, null_stats.underruns);
+            if (null_stats.writes > 0) {
+                INFO("sink: {} writes, interval p50 {}us p99 {}us max {}us, blocked p99 {}us max {}us, "
+                     "min buffered {} frames", null_stats.writes, null_stats.write_interval.p50_us,
+                     null_stats.write_interval.p99_us, null_stats.write_interval.max_us,
+                     null_stats.write_block.p99_us, null_stats.write_block.max_us, null_stats.min_buffered_frames);
+            }
         }
 
     } catch (const std::exception& e) {
         // 捕获所有异常，记录错误日志
         ERROR("Fatal error: {}", e.what());
+        ShutdownLogging();
         return -1;  // 异常退出
     }
 
+    if (uint64_t dropped = LogDroppedMessages()) {
+        WARN("log: {} messages dropped (async queue full)", dropped);
+    }
+    ShutdownLogging();  // 输出异步队列中剩余的日志
     return 0;  // 正常退出
 }
\ No newline at end of file
@@ -7,12 +7,20 @@
 #include <termios.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "FileStream.h"
 #include "Log.h"
 #include "AudioInterface.h"
+#include "PcmKernels.h"
+#include "Resampler.h"
+#include "Tracepoints.h"
 
 namespace linx {
 
@@ -42,37 +50,202 @@ bool IsSpaceKeyPressed() {
     return false;
 }
 
+// 单路 PCM 实际协商到的参数（设备采样率下的帧数）
+struct AlsaStreamParams {
+    unsigned int rate = 0;
+    snd_pcm_uframes_t period_size = 0;
+    snd_pcm_uframes_t buffer_size = 0;
+    unsigned int periods = 0;
+    snd_pcm_uframes_t start_threshold = 0;
+    bool mmap = false;
+    bool can_pause = false;  // 硬件支持 snd_pcm_pause
+    bool silence_fill = false;  // 播放端欠载不停流，由驱动补静音
+    bool float_samples = false;  // 以 SND_PCM_FORMAT_FLOAT_LE 打开（SetSampleFormat(F32) 且设备支持）
+    bool monotonic_tstamp = false;  // 采集端：驱动时间戳为 CLOCK_MONOTONIC，可推算每帧的硬件采集时刻
+};
+
 class AlsaAudio : public AudioInterface {
 public:
     AlsaAudio() {}
 
-    // 析构函数，关闭录制和播放设备
+    // 析构函数，关闭录制和播放设备；Abort 之后不再等待播放缓冲区播完
     ~AlsaAudio() override {
-        snd_pcm_drain(capture_handle_);
-        snd_pcm_close(capture_handle_);
-        snd_pcm_drain(playback_handle_);
-        snd_pcm_close(playback_handle_);
+        if (capture_handle_ != nullptr) {
+            snd_pcm_drop(capture_handle_);
+            snd_pcm_close(capture_handle_);
+        }
+        if (playback_handle_ != nullptr) {
+            if (aborted_.load(std::memory_order_relaxed)) {
+                snd_pcm_drop(playback_handle_);
+            } else {
+                snd_pcm_drain(playback_handle_);
+            }
+            snd_pcm_close(playback_handle_);
+        }
+    }
+
+    // snd_pcm_drop 把两路设备置为 SETUP 状态：阻塞在 readi/writei 或 snd_pcm_wait 中的线程随即以 -EBADFD 返回，
+    // 读写路径看到 aborted_ 后不再 prepare 恢复，直接返回失败
+    void Abort() override {
+        if (aborted_.exchange(true)) {
+            return;
+        }
+        if (capture_handle_ != nullptr) {
+            snd_pcm_drop(capture_handle_);
+        }
+        if (playback_handle_ != nullptr) {
+            snd_pcm_drop(playback_handle_);
+        }
     }
 
     void Init() override {
         int err;
         // 打开录音设备
-        if ((err = snd_pcm_open(&capture_handle_, "default", SND_PCM_STREAM_CAPTURE, 0)) < 0) {
-            std::cerr << "无法打开录音 PCM 设备: " << snd_strerror(err) << std::endl;
+        if ((err = snd_pcm_open(&capture_handle_, capture_device_.c_str(), SND_PCM_STREAM_CAPTURE, 0)) < 0) {
+            ERROR("无法打开录音 PCM 设备 {}: {}", capture_device_, snd_strerror(err));
+            capture_handle_ = nullptr;
             throw std::runtime_error("打开录音 PCM 设备失败");
         }
         // 打开播放设备
-        if ((err = snd_pcm_open(&playback_handle_, "default", SND_PCM_STREAM_PLAYBACK, 0)) < 0) {
-            std::cerr << "无法打开播放 PCM 设备: " << snd_strerror(err) << std::endl;
+        if ((err = snd_pcm_open(&playback_handle_, playback_device_.c_str(), SND_PCM_STREAM_PLAYBACK, 0)) < 0) {
+            ERROR("无法打开播放 PCM 设备 {}: {}", playback_device_, snd_strerror(err));
             snd_pcm_close(capture_handle_);
+            capture_handle_ = playback_handle_ = nullptr;
             throw std::runtime_error("打开播放 PCM 设备失败");
         }
-        // 分配硬件参数对象
-        snd_pcm_hw_params_alloca(&hw_params_);
+        INFO("ALSA devices: capture {}, playback {}", capture_device_, playback_device_);
         SetupParams(capture_handle_);
         SetupParams(playback_handle_);
     }
 
+    std::vector<AudioDeviceInfo> ListDevices() override { return EnumerateDevices(); }
+
+    bool SetDevice(const std::string& capture, const std::string& playback) override {
+        std::string capture_name;
+        std::string playback_name;
+        if (!ResolveDevice(capture, true, &capture_name) || !ResolveDevice(playback, false, &playback_name)) {
+            return false;
+        }
+        capture_device_ = capture_name;
+        playback_device_ = playback_name;
+        return true;
+    }
+
+    void SetLowestLatency(bool enabled) override { lowest_latency_ = enabled; }
+
+    // 播放端 stop_threshold 设为 boundary：数据耗尽时设备继续运行，播出的是 ALSA 按
+    // silence_size 自动清零的区域，不报 -EPIPE，也不需要应用写静音保活
+    void SetSilenceFill(bool enabled) override { silence_fill_ = enabled; }
+
+    // 采集端以 channels 声道打开（如麦克风阵列），播放端仍为 SetConfig 的声道数；须在 Init 之前调用
+    bool SetCaptureChannels(int channels) override {
+        if (channels <= 0) {
+            return false;
+        }
+        capture_channels_ = channels;
+        return true;
+    }
+    int CaptureChannels() const override { return capture_channels_ > 0 ? capture_channels_ : channels_; }
+
+    // F32：两路设备优先以 SND_PCM_FORMAT_FLOAT_LE 打开，不支持的一路仍用 S16_LE；须在 Init 之前调用
+    bool SetSampleFormat(SampleFormat format) override {
+        prefer_float_ = format == SampleFormat::F32;
+        return true;
+    }
+    SampleFormat CaptureFormat() const override { return capture_float_ ? SampleFormat::F32 : SampleFormat::S16; }
+    SampleFormat PlaybackFormat() const override { return playback_float_ ? SampleFormat::F32 : SampleFormat::S16; }
+
+    // 设备为 float32 且不需要进程内重采样时直接读写设备（mmap 或 readi/writei），不经过 int16
+    bool ReadFloat(float* buffer, size_t frames) override {
+        if (!capture_float_ || capture_resampler_) {
+            return AudioInterface::ReadFloat(buffer, frames);
+        }
+        LINX_PROBE_SCOPE(audio_read, frames);
+        if (!ReadDeviceRaw(buffer, frames)) {
+            return false;
+        }
+        StampRead(frames);
+        return true;
+    }
+
+    bool WriteFloat(const float* buffer, size_t frames) override {
+        if (!playback_float_ || playback_resampler_) {
+            return AudioInterface::WriteFloat(buffer, frames);
+        }
+        LINX_PROBE_SCOPE(audio_write, frames);
+        return WriteDeviceRaw(buffer, frames);
+    }
+    bool SilenceFill() const override { return playback_silence_fill_; }
+
+    // 遍历所有声卡的 PCM 设备（hw:<card>,<device>），逐个以非阻塞方式打开探测参数后关闭；
+    // 已被占用的设备（包括本进程已打开的）标记为 busy
+    static std::vector<AudioDeviceInfo> EnumerateDevices() {
+        std::vector<AudioDeviceInfo> devices;
+        snd_ctl_card_info_t* card_info = nullptr;
+        snd_pcm_info_t* pcm_info = nullptr;
+        snd_ctl_card_info_alloca(&card_info);
+        snd_pcm_info_alloca(&pcm_info);
+        int card = -1;
+        while (snd_card_next(&card) == 0 && card >= 0) {
+            std::string ctl_name = "hw:" + std::to_string(card);
+            snd_ctl_t* ctl = nullptr;
+            if (snd_ctl_open(&ctl, ctl_name.c_str(), 0) < 0) {
+                continue;
+            }
+            std::string card_name = snd_ctl_card_info(ctl, card_info) == 0 ? snd_ctl_card_info_get_name(card_info)
+                                                                            : ctl_name;
+            int device = -1;
+            while (snd_ctl_pcm_next_device(ctl, &device) == 0 && device >= 0) {
+                AudioDeviceInfo info;
+                info.card = card;
+                info.device = device;
+                info.id = ctl_name + "," + std::to_string(device);
+                std::string pcm_name;
+                for (snd_pcm_stream_t stream : {SND_PCM_STREAM_CAPTURE, SND_PCM_STREAM_PLAYBACK}) {
+                    snd_pcm_info_set_device(pcm_info, static_cast<unsigned int>(device));
+                    snd_pcm_info_set_subdevice(pcm_info, 0);
+                    snd_pcm_info_set_stream(pcm_info, stream);
+                    if (snd_ctl_pcm_info(ctl, pcm_info) < 0) {
+                        continue;
+                    }
+                    if (pcm_name.empty()) {
+                        pcm_name = snd_pcm_info_get_name(pcm_info);
+                    }
+                    ProbeCaps(info.id, stream, stream == SND_PCM_STREAM_CAPTURE ? &info.capture : &info.playback);
+                }
+                info.name = card_name + ": " + pcm_name;
+                info.index = static_cast<int>(devices.size());
+                devices.push_back(std::move(info));
+            }
+            snd_ctl_close(ctl);
+        }
+        return devices;
+    }
+
+    // 把 SetDevice 的参数换算为 snd_pcm_open 的设备名：含 ':' 的按 PCM 名原样使用（hw:/plughw:/dsnoop: 等），
+    // 否则按序号或名称片段在 EnumerateDevices 中查找，得到 "hw:<card>,<device>"
+    static bool ResolveDevice(const std::string& spec, bool capture, std::string* name) {
+        if (spec.empty() || spec == "default") {
+            *name = "default";
+            return true;
+        }
+        if (spec.find(':') != std::string::npos) {
+            *name = spec;
+            return true;
+        }
+        std::vector<AudioDeviceInfo> devices = EnumerateDevices();
+        int index = FindAudioDevice(devices, spec, capture);
+        if (index < 0) {
+            ERROR("ALSA {} device \"{}\" not found", capture ? "capture" : "playback", spec);
+            return false;
+        }
+        *name = devices[index].id;
+        INFO("ALSA {} device \"{}\" -> {} ({})", capture ? "capture" : "playback", spec, *name,
+             devices[index].name);
+        return true;
+    }
+
+    // 可在 Init 之前或之后调用；设备已打开时按新参数重新协商两路设备
     void SetConfig(unsigned int sample_rate, int frame_size, int channels, int periods, int alsa_buffer_size,
                    int alsa_period_size) override {
         sample_rate_ = sample_rate;  // 20ms,  0.02*16000 = 320
@@ -82,54 +255,327 @@ public:
         periods_ = periods;
         alsa_buffer_size_ = alsa_buffer_size;
         alsa_period_size_ = alsa_period_size;
+        if (capture_handle_ != nullptr && playback_handle_ != nullptr) {
+            snd_pcm_drop(capture_handle_);
+            snd_pcm_drop(playback_handle_);
+            SetupParams(capture_handle_);
+            SetupParams(playback_handle_);
+        }
     }
 
-    bool Read(short* buffer, size_t frame_size_) override {
-        int err = 0;
-        if ((err = snd_pcm_readi(capture_handle_, buffer, frame_size_)) !=
-            static_cast<int>(frame_size_)) {
-            std::cerr << "录音出错: " << snd_strerror(err) << std::endl;
-            if (err == -EPIPE) {
-                ERROR("录音失败EPIPE");
-                if ((err = snd_pcm_prepare(capture_handle_)) < 0) {
-                    std::cerr << "无法重新准备录音 PCM 设备: " << snd_strerror(err) << std::endl;
-                }
-                frame_size_ = snd_pcm_recover(capture_handle_, frame_size_, 0);
-                if (frame_size_ < 0) {
-                    std::cerr << "ALSA read error: " << snd_strerror(frame_size_) << std::endl;
-                }
-            } else {
-                ERROR("录音失败");
+    // 两路设备实际协商到的参数，Init 之后有效
+    const AlsaStreamParams& CaptureParams() const { return capture_params_; }
+    const AlsaStreamParams& PlaybackParams() const { return playback_params_; }
+
+    // 设备以原生采样率打开时，读出后在进程内重采样到 sample_rate_；frames 为应用采样率下的帧数
+    bool Read(short* buffer, size_t frames) override {
+        LINX_PROBE_SCOPE(audio_read, frames);
+        if (!capture_resampler_) {
+            if (!ReadDevice(buffer, frames)) {
+                return false;
+            }
+            StampRead(frames);
+            return true;
+        }
+        const int channels = CaptureChannels();
+        size_t have = 0;
+        while (have < frames) {
+            if (capture_pending_len_ > capture_pending_pos_) {
+                size_t n = std::min(frames - have, capture_pending_len_ - capture_pending_pos_);
+                memcpy(buffer + have * channels, capture_pending_.data() + capture_pending_pos_ * channels,
+                       n * channels * sizeof(short));
+                capture_pending_pos_ += n;
+                have += n;
+                continue;
             }
+            size_t need = frames - have;
+            size_t hw_frames = (need * capture_rate_ + sample_rate_ - 1) / sample_rate_;
+            if (capture_hw_.size() < hw_frames * channels) {
+                capture_hw_.resize(hw_frames * channels);
+            }
+            if (!ReadDevice(capture_hw_.data(), hw_frames)) {
+                return false;
+            }
+            size_t max_out = capture_resampler_->MaxOutputFrames(hw_frames);
+            if (capture_pending_.size() < max_out * channels) {
+                capture_pending_.resize(max_out * channels);
+            }
+            capture_pending_len_ =
+                capture_resampler_->Process(capture_hw_.data(), hw_frames, capture_pending_.data(), max_out);
+            capture_pending_pos_ = 0;
+        }
+        // 重采样后尚未交出的帧比本次交出的更晚采集（忽略重采样滤波器的群延迟）
+        StampRead(frames + capture_pending_len_ - capture_pending_pos_);
+        return true;
+    }
+
+    uint64_t CaptureTimestampUs() const override { return capture_stamp_us_; }
+
+    // 应用采样率的数据先重采样到设备原生采样率再写入
+    bool Write(short* buffer, size_t frames) override {
+        LINX_PROBE_SCOPE(audio_write, frames);
+        if (!playback_resampler_) {
+            return WriteDevice(buffer, frames);
+        }
+        size_t max_out = playback_resampler_->MaxOutputFrames(frames);
+        if (playback_hw_.size() < max_out * channels_) {
+            playback_hw_.resize(max_out * channels_);
+        }
+        size_t n = playback_resampler_->Process(buffer, frames, playback_hw_.data(), max_out);
+        return n == 0 || WriteDevice(playback_hw_.data(), n);
+    }
+
+    // 设备支持时以 mmap 方式访问 DMA 缓冲区（默认开启），须在 Init 之前设置
+    void SetMmapEnabled(bool enabled) { prefer_mmap_ = enabled; }
+    bool CaptureUsesMmap() const { return capture_mmap_; }
+    bool PlaybackUsesMmap() const { return playback_mmap_; }
+
+    // 零拷贝接口交出的是 int16 区域：设备以 float32 打开时不提供，调用方回退到 Read / Write
+    const short* AcquireCapture(size_t frames, size_t* got) override {
+        if (!capture_mmap_ || capture_resampler_ || capture_float_) {
+            return nullptr;
+        }
+        const short* region =
+            static_cast<const short*>(MmapBegin(capture_handle_, frames, &capture_mmap_offset_, got));
+        // 区域中的第一帧就是设备缓冲区里最早的未读帧
+        capture_stamp_us_ = region != nullptr ? HwCaptureEndUs() : 0;
+        return region;
+    }
+
+    void ReleaseCapture(size_t frames) override {
+        MmapCommit(capture_handle_, true, capture_mmap_offset_, frames);
+    }
+
+    short* AcquirePlayback(size_t frames, size_t* got) override {
+        if (!playback_mmap_ || playback_resampler_ || playback_float_) {
+            return nullptr;
+        }
+        RealignPlayback();
+        return static_cast<short*>(MmapBegin(playback_handle_, frames, &playback_mmap_offset_, got));
+    }
+
+    void CommitPlayback(size_t frames) override {
+        MmapCommit(playback_handle_, false, playback_mmap_offset_, frames);
+    }
+
+    // int16 数据与设备之间的读写：设备为 float32 时在这里转换一次
+    bool ReadDevice(short* buffer, size_t frames) {
+        if (!capture_float_) {
+            return ReadDeviceRaw(buffer, frames);
+        }
+        const size_t samples = frames * CaptureChannels();
+        if (capture_f32_.size() < samples) {
+            capture_f32_.resize(samples);
+        }
+        if (!ReadDeviceRaw(capture_f32_.data(), frames)) {
+            return false;
+        }
+        PcmFromFloat(buffer, capture_f32_.data(), samples);
+        return true;
+    }
+
+    bool WriteDevice(const short* buffer, size_t frames) {
+        if (!playback_float_) {
+            return WriteDeviceRaw(buffer, frames);
+        }
+        const size_t samples = frames * channels_;
+        if (playback_f32_.size() < samples) {
+            playback_f32_.resize(samples);
+        }
+        PcmToFloat(playback_f32_.data(), buffer, samples);
+        return WriteDeviceRaw(playback_f32_.data(), frames);
+    }
+
+    // 按设备格式原样读写（buffer 为 int16 或 float32，与协商结果一致）
+    bool ReadDeviceRaw(void* buffer, size_t frame_size_) {
+        if (aborted_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        if (capture_mmap_) {
+            bool ok = MmapTransfer(capture_handle_, true, buffer, frame_size_);
+            capture_end_us_ = ok ? HwCaptureEndUs() : 0;
+            return ok;
+        }
+        snd_pcm_sframes_t n = snd_pcm_readi(capture_handle_, buffer, frame_size_);
+        if (n == static_cast<snd_pcm_sframes_t>(frame_size_)) {
+            capture_end_us_ = HwCaptureEndUs();
+            return true;
+        }
+        capture_end_us_ = 0;
+        if (n < 0) {
+            // 溢出期间的数据已经丢失，恢复后由下一次读取继续
+            RecoverStream(capture_handle_, static_cast<int>(n));
+        } else if (error_log_.Allow()) {
+            WARN("ALSA short read: {} of {} frames", n, frame_size_);
+        }
+        return false;
+    }
+
+    bool WriteDeviceRaw(const void* buffer, size_t frame_size_) {
+        if (aborted_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        RealignPlayback();
+        if (playback_mmap_) {
+            return MmapTransfer(playback_handle_, false, const_cast<void*>(buffer), frame_size_);
+        }
+        snd_pcm_sframes_t n = snd_pcm_writei(playback_handle_, buffer, frame_size_);
+        if (n == static_cast<snd_pcm_sframes_t>(frame_size_)) {
+            return true;
+        }
+        if (n < 0 && RecoverStream(playback_handle_, static_cast<int>(n))) {
+            // 空闲时播放端允许欠载，恢复后重写本块数据，避免丢掉新一段TTS的开头
+            return snd_pcm_writei(playback_handle_, buffer, frame_size_) ==
+                   static_cast<snd_pcm_sframes_t>(frame_size_);
+        }
+        if (n >= 0 && error_log_.Allow()) {
+            WARN("ALSA short write: {} of {} frames", n, frame_size_);
+        }
+        return false;
+    }
+
+    // 由驱动时间戳推算已读出数据的末尾（即下一个未读帧）的采集时刻：htstamp 为硬件指针最近一次更新的时刻，
+    // 此时设备缓冲区中还有 avail 帧未读，它们都在 htstamp 之前采集。时间戳不是单调时钟、驱动尚未更新
+    // （流刚启动）或结果超出两个缓冲区的时长时都不可信，返回 0
+    uint64_t HwCaptureEndUs() const {
+        if (!capture_params_.monotonic_tstamp || capture_rate_ == 0) {
+            return 0;
+        }
+        snd_pcm_status_t* status = nullptr;
+        snd_pcm_status_alloca(&status);
+        if (snd_pcm_status(capture_handle_, status) < 0) {
+            return 0;
+        }
+        snd_htimestamp_t ts;
+        snd_pcm_status_get_htstamp(status, &ts);
+        uint64_t at = static_cast<uint64_t>(ts.tv_sec) * 1000000 + static_cast<uint64_t>(ts.tv_nsec) / 1000;
+        uint64_t behind = static_cast<uint64_t>(snd_pcm_status_get_avail(status)) * 1000000 / capture_rate_;
+        uint64_t window = static_cast<uint64_t>(capture_params_.buffer_size) * 2 * 1000000 / capture_rate_;
+        uint64_t now = SteadyNowUs();
+        if (at == 0 || at > now || behind >= at || now - (at - behind) > window) {
+            return 0;
+        }
+        return at - behind;
+    }
+
+    // 交出 frames 帧（应用采样率，含已读出、尚未交出的重采样余量）后，推算其中第一帧的采集时刻
+    void StampRead(size_t frames) {
+        uint64_t span = static_cast<uint64_t>(frames) * 1000000 / sample_rate_;
+        capture_stamp_us_ = capture_end_us_ > span ? capture_end_us_ - span : 0;
+    }
+
+    // xrun 发生后是否先补静音到启动阈值再继续写入（默认开启），以一个周期的延迟换取恢复后立即有余量
+    void SetXrunPrefill(bool enabled) { xrun_prefill_ = enabled; }
+
+    unsigned int SampleRate() const override { return sample_rate_; }
+    int Channels() const override { return channels_; }
+
+    AudioXrunStats GetXrunStats() const override {
+        AudioXrunStats stats;
+        stats.capture_xruns = capture_xruns_.load(std::memory_order_relaxed);
+        stats.playback_xruns = playback_xruns_.load(std::memory_order_relaxed);
+        stats.suspends = suspends_.load(std::memory_order_relaxed);
+        stats.recover_failures = recover_failures_.load(std::memory_order_relaxed);
+        stats.last_recover_us = last_recover_us_.load(std::memory_order_relaxed);
+        stats.max_recover_us = max_recover_us_.load(std::memory_order_relaxed);
+        stats.total_recover_us = total_recover_us_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    long GetPlaybackDelay() override {
+        snd_pcm_sframes_t avail = 0;
+        snd_pcm_sframes_t delay = 0;
+        // 设备未运行（已欠载或尚未开始）时视为没有待播数据
+        if (snd_pcm_avail_delay(playback_handle_, &avail, &delay) < 0 || delay < 0) {
+            return 0;
+        }
+        if (playback_resampler_) {
+            // 换算回应用采样率下的帧数
+            return static_cast<long>(delay * sample_rate_ / playback_rate_);
+        }
+        return delay;
+    }
+
+    // snd_pcm_drop 立即停止并丢弃缓冲区中的全部数据，随后 prepare 回到可写状态，
+    // 下一次写入攒够启动阈值（一个周期）后设备重新启动
+    bool DropPlayback() override {
+        if (playback_handle_ == nullptr) {
+            return false;
+        }
+        int err = snd_pcm_drop(playback_handle_);
+        if (err >= 0) {
+            err = snd_pcm_prepare(playback_handle_);
+        }
+        if (playback_resampler_) {
+            playback_resampler_->Reset();
+        }
+        if (err < 0) {
+            ERROR("ALSA playback drop failed: {}", snd_strerror(err));
             return false;
         }
         return true;
     }
 
-    bool Write(short* buffer, size_t frame_size_) override {
+    // 硬件支持时 snd_pcm_pause 暂停 DMA（恢复最快），否则 snd_pcm_drop 停止采集流
+    bool SuspendCapture() override {
+        if (capture_handle_ == nullptr) {
+            return false;
+        }
+        if (capture_suspended_) {
+            return true;
+        }
+        int err = -1;
+        capture_paused_ = capture_params_.can_pause && snd_pcm_state(capture_handle_) == SND_PCM_STATE_RUNNING;
+        if (capture_paused_ && (err = snd_pcm_pause(capture_handle_, 1)) < 0) {
+            capture_paused_ = false;
+        }
+        if (!capture_paused_ && (err = snd_pcm_drop(capture_handle_)) < 0) {
+            ERROR("ALSA capture suspend failed: {}", snd_strerror(err));
+            return false;
+        }
+        capture_suspended_ = true;
+        return true;
+    }
+
+    // 暂停前还没读走的样本已经过时：pause 恢复后 snd_pcm_reset 丢弃，drop 之后重新 prepare 并立即启动，
+    // 不等第一次读取才开始采集
+    bool ResumeCapture() override {
+        if (capture_handle_ == nullptr || !capture_suspended_) {
+            return capture_handle_ != nullptr;
+        }
+        capture_suspended_ = false;
         int err = 0;
-        if ((err = snd_pcm_writei(playback_handle_, buffer, frame_size_)) !=
-            static_cast<int>(frame_size_)) {
-            // std::cerr << "播放出错: " << snd_strerror(err) << err << std::endl;
-            if (err == -EPIPE) {
-                if ((err = snd_pcm_prepare(playback_handle_)) < 0) {
-                    std::cerr << "无法重新准备播放 PCM 设备: " << snd_strerror(err) << std::endl;
-                    ERROR("重新准备播放 PCM 设备失败");
-                    frame_size_ = snd_pcm_recover(playback_handle_, frame_size_, 0);
-                } else {
-                    // INFO("recover sleep");
-                    usleep(100);
-                }
-            } else {
-                ERROR("播放失败");
+        if (capture_paused_) {
+            err = snd_pcm_pause(capture_handle_, 0);
+            if (err >= 0) {
+                err = snd_pcm_reset(capture_handle_);
+            }
+        }
+        if (!capture_paused_ || err < 0) {
+            err = snd_pcm_prepare(capture_handle_);
+            if (err >= 0) {
+                err = snd_pcm_start(capture_handle_);
             }
+        }
+        if (capture_resampler_) {
+            capture_resampler_->Reset();
+        }
+        capture_pending_len_ = capture_pending_pos_ = 0;
+        if (err < 0) {
+            ERROR("ALSA capture resume failed: {}", snd_strerror(err));
             return false;
         }
         return true;
     }
 
+    // 播放流空闲时 drop + prepare：DMA 停止且不计为欠载，下一次写入攒够启动阈值后自动重新启动
+    bool SuspendPlayback() override { return DropPlayback(); }
+    bool ResumePlayback() override { return playback_handle_ != nullptr; }
+
     void Record() override {
-        short buffer[chunk_ * channels_];
+        FrameRef frame;
+        const int capture_channels = CaptureChannels();
+        short* buffer = AcquireScratch(chunk_ * capture_channels, &frame, &scratch_);
         std::cout << "按下空格开始录音，松开空格播放录制的声音。" << std::endl;
         SetTerminalToNonCanonical();
 
@@ -144,9 +590,9 @@ public:
         FileStream fp("abc.pcm", "wb");
         while (IsSpaceKeyPressed()) {
             INFO("begin");
-            if (Read(buffer, chunk_ * channels_)) {
-                audio_data_.insert(audio_data_.end(), buffer, buffer + chunk_ * channels_);
-                fp.fwrite((char*)&buffer[0], 1, chunk_ * channels_ * sizeof(short));
+            if (Read(buffer, chunk_)) {
+                audio_data_.insert(audio_data_.end(), buffer, buffer + chunk_ * capture_channels);
+                fp.fwrite((char*)&buffer[0], 1, chunk_ * capture_channels * sizeof(short));
                 INFO("{}, {}", count++, audio_data_.size());
             }
         }
@@ -156,7 +602,8 @@ public:
     }
 
     void Play() override {
-        short buffer[chunk_ * channels_];
+        FrameRef frame;
+        short* buffer = AcquireScratch(chunk_ * channels_, &frame, &scratch_);
 
         // 开始播放录制的声音
         size_t index = 0;
@@ -173,84 +620,448 @@ public:
     }
 
 private:
-    // 设置 PCM 设备的硬件参数
+    // 等待至少 frames 帧可用（采集为可读、播放为可写），必要时启动设备并从 xrun 恢复；返回可用帧数或负的错误码
+    snd_pcm_sframes_t MmapWait(snd_pcm_t* handle, snd_pcm_uframes_t frames) {
+        for (;;) {
+            if (aborted_.load(std::memory_order_relaxed)) {
+                return -EBADFD;
+            }
+            snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+            if (avail < 0) {
+                if (!RecoverStream(handle, static_cast<int>(avail))) {
+                    return avail;
+                }
+                continue;
+            }
+            if (static_cast<snd_pcm_uframes_t>(avail) >= frames) {
+                return avail;
+            }
+            // mmap 模式下设备不会因读写自动启动：采集需要先启动才会有数据，播放缓冲区满了也要启动才会腾出空间
+            if (snd_pcm_state(handle) == SND_PCM_STATE_PREPARED) {
+                int err = snd_pcm_start(handle);
+                if (err < 0) {
+                    ERROR("ALSA start failed: {}", snd_strerror(err));
+                    return err;
+                }
+                continue;
+            }
+            int err = snd_pcm_wait(handle, 1000);
+            if (err < 0 && !RecoverStream(handle, err)) {
+                return err;
+            }
+        }
+    }
+
+    int StreamChannels(snd_pcm_t* handle) const { return handle == capture_handle_ ? CaptureChannels() : channels_; }
+    // 一帧（全部声道）的字节数
+    size_t FrameBytes(snd_pcm_t* handle) const {
+        bool is_float = handle == capture_handle_ ? capture_float_ : playback_float_;
+        return StreamChannels(handle) * (is_float ? sizeof(float) : sizeof(short));
+    }
+
+    void* MmapBegin(snd_pcm_t* handle, size_t frames, snd_pcm_uframes_t* offset, size_t* got) {
+        *got = 0;
+        if (MmapWait(handle, frames) < 0) {
+            return nullptr;
+        }
+        const snd_pcm_channel_area_t* areas = nullptr;
+        snd_pcm_uframes_t n = frames;
+        int err = snd_pcm_mmap_begin(handle, &areas, offset, &n);
+        if (err < 0) {
+            ERROR("ALSA mmap begin failed: {}", snd_strerror(err));
+            return nullptr;
+        }
+        // 交织格式：area[0] 的 first/step 以 bit 为单位，帧起点 = addr + offset * 帧字节数
+        *got = n;
+        return static_cast<char*>(areas[0].addr) + areas[0].first / 8 + *offset * FrameBytes(handle);
+    }
+
+    void MmapCommit(snd_pcm_t* handle, bool capture, snd_pcm_uframes_t offset, size_t frames) {
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit(handle, offset, frames);
+        if (committed < 0 || static_cast<size_t>(committed) != frames) {
+            RecoverStream(handle, committed < 0 ? static_cast<int>(committed) : -EPIPE);
+            return;
+        }
+        if (!capture && frames > 0 && snd_pcm_state(handle) == SND_PCM_STATE_PREPARED) {
+            snd_pcm_start(handle);  // mmap 播放需要显式启动
+        }
+    }
+
+    // 从 xrun（-EPIPE）或挂起（-ESTRPIPE）中恢复并计数，返回是否可以继续传输。
+    // snd_pcm_recover 会重新 prepare，挂起时等待 resume；播放端可选地先补静音到启动阈值
+    bool RecoverStream(snd_pcm_t* handle, int err) {
+        const bool capture = handle == capture_handle_;
+        const char* name = capture ? "capture" : "playback";
+        if (aborted_.load(std::memory_order_relaxed)) {
+            return false;  // Abort 之后的错误是 snd_pcm_drop 造成的，不再重新 prepare
+        }
+        if (err == -EAGAIN || err == -EINTR) {
+            return true;
+        }
+        auto begin = std::chrono::steady_clock::now();
+        if (err == -EPIPE) {
+            (capture ? capture_xruns_ : playback_xruns_).fetch_add(1, std::memory_order_relaxed);
+        } else if (err == -ESTRPIPE) {
+            suspends_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        int rc = snd_pcm_recover(handle, err, 1);
+        if (rc == 0 && !capture && xrun_prefill_) {
+            PrefillSilence(handle);
+        }
+
+        uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin)
+                          .count();
+        last_recover_us_.store(us, std::memory_order_relaxed);
+        total_recover_us_.fetch_add(us, std::memory_order_relaxed);
+        if (us > max_recover_us_.load(std::memory_order_relaxed)) {
+            max_recover_us_.store(us, std::memory_order_relaxed);
+        }
+
+        uint64_t suppressed = 0;
+        if (rc < 0) {
+            recover_failures_.fetch_add(1, std::memory_order_relaxed);
+            if (error_log_.Allow(&suppressed)) {
+                ERROR("ALSA {} recover from {} failed: {} ({} similar suppressed)", name, snd_strerror(err),
+                      snd_strerror(rc), suppressed);
+            }
+            return false;
+        }
+        if (xrun_log_.Allow(&suppressed)) {
+            WARN("ALSA {} {} recovered in {}us ({} similar suppressed)", name,
+                 err == -ESTRPIPE ? "suspend" : "xrun", us, suppressed);
+        }
+        return true;
+    }
+
+    // 自己补静音时设备欠载后照常运行，空闲期间硬件指针越过了应用指针（avail 超过缓冲区）：
+    // 先把应用指针前移到硬件指针之后一个周期（这段已被清零），新数据从即将播出的位置写起，而不是写进已播过的区域
+    void RealignPlayback() {
+        if (!playback_silence_fill_) {
+            return;
+        }
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(playback_handle_);
+        snd_pcm_sframes_t buffer = static_cast<snd_pcm_sframes_t>(playback_params_.buffer_size);
+        if (avail > buffer) {
+            snd_pcm_forward(playback_handle_,
+                            static_cast<snd_pcm_uframes_t>(avail - buffer) + playback_params_.period_size);
+        }
+    }
+
+    // 恢复后的播放设备处于 PREPARED 状态：写入启动阈值那么多的静音让它立即启动并留出余量
+    void PrefillSilence(snd_pcm_t* handle) {
+        snd_pcm_uframes_t frames = std::max<snd_pcm_uframes_t>(playback_params_.start_threshold, 1);
+        if (playback_mmap_) {
+            const snd_pcm_channel_area_t* areas = nullptr;
+            snd_pcm_uframes_t offset = 0;
+            snd_pcm_uframes_t n = frames;
+            if (snd_pcm_avail_update(handle) < 0 || snd_pcm_mmap_begin(handle, &areas, &offset, &n) < 0) {
+                return;
+            }
+            // S16 与 FLOAT_LE 的静音都是全零字节
+            memset(static_cast<char*>(areas[0].addr) + areas[0].first / 8 + offset * FrameBytes(handle), 0,
+                   n * FrameBytes(handle));
+            if (snd_pcm_mmap_commit(handle, offset, n) >= 0 && snd_pcm_state(handle) == SND_PCM_STATE_PREPARED) {
+                snd_pcm_start(handle);
+            }
+            return;
+        }
+        size_t samples = frames * FrameBytes(handle) / sizeof(short);
+        if (playback_silence_.size() < samples) {
+            playback_silence_.assign(samples, 0);
+        }
+        snd_pcm_writei(handle, playback_silence_.data(), frames);
+    }
+
+    // 经 mmap 搬运一整块数据（环绕时分段），供不使用零拷贝接口的 Read/Write 路径
+    bool MmapTransfer(snd_pcm_t* handle, bool capture, void* buffer, size_t frames) {
+        const size_t frame_bytes = FrameBytes(handle);
+        char* data = static_cast<char*>(buffer);
+        size_t done = 0;
+        while (done < frames) {
+            snd_pcm_uframes_t offset = 0;
+            size_t got = 0;
+            void* area = MmapBegin(handle, frames - done, &offset, &got);
+            if (area == nullptr || got == 0) {
+                return false;
+            }
+            size_t bytes = got * frame_bytes;
+            if (capture) {
+                memcpy(data + done * frame_bytes, area, bytes);
+            } else {
+                memcpy(area, data + done * frame_bytes, bytes);
+            }
+            MmapCommit(handle, capture, offset, got);
+            done += got;
+        }
+        return true;
+    }
+
+    // 探测一个方向的参数：声道范围、kProbeSampleRates 中直接支持的采样率、最小周期和缓冲区
+    static void ProbeCaps(const std::string& id, snd_pcm_stream_t stream, AudioDeviceCaps* caps) {
+        caps->supported = true;
+        snd_pcm_t* handle = nullptr;
+        int err = snd_pcm_open(&handle, id.c_str(), stream, SND_PCM_NONBLOCK);
+        if (err < 0) {
+            caps->busy = true;
+            return;
+        }
+        snd_pcm_hw_params_t* hw_params = nullptr;
+        snd_pcm_hw_params_alloca(&hw_params);
+        if (snd_pcm_hw_params_any(handle, hw_params) >= 0) {
+            snd_pcm_hw_params_get_channels_min(hw_params, &caps->min_channels);
+            snd_pcm_hw_params_get_channels_max(hw_params, &caps->max_channels);
+            for (unsigned int rate : kProbeSampleRates) {
+                if (snd_pcm_hw_params_test_rate(handle, hw_params, rate, 0) == 0) {
+                    caps->rates.push_back(rate);
+                }
+            }
+            snd_pcm_uframes_t frames = 0;
+            int dir = 0;
+            if (snd_pcm_hw_params_get_period_size_min(hw_params, &frames, &dir) == 0) {
+                caps->min_period_frames = frames;
+            }
+            if (snd_pcm_hw_params_get_buffer_size_min(hw_params, &frames) == 0) {
+                caps->min_buffer_frames = frames;
+            }
+        }
+        snd_pcm_close(handle);
+    }
+
+    // 最低延迟配置：采样率已定的参数空间里，取不小于设备最小周期、且能整除应用帧（换算到设备采样率）的最小周期，
+    // 使每帧的唤醒次数均匀；没有这样的值时直接取最小周期。缓冲区为两个周期，不小于设备最小缓冲区
+    void ProbeLowestLatency(snd_pcm_t* handle, snd_pcm_hw_params_t* hw_params, unsigned int rate,
+                            snd_pcm_uframes_t* period_size, snd_pcm_uframes_t* buffer_size) {
+        snd_pcm_uframes_t min_period = 0;
+        snd_pcm_uframes_t min_buffer = 0;
+        int dir = 0;
+        if (snd_pcm_hw_params_get_period_size_min(hw_params, &min_period, &dir) < 0 || min_period == 0) {
+            WARN("ALSA lowest-latency probe: device does not report a minimum period, using configured values");
+            return;
+        }
+        snd_pcm_hw_params_get_buffer_size_min(hw_params, &min_buffer);
+        snd_pcm_uframes_t chosen = min_period;
+        snd_pcm_uframes_t frame = static_cast<snd_pcm_uframes_t>(frame_size_) * rate / sample_rate_;
+        for (snd_pcm_uframes_t k = frame / min_period; k >= 1; k--) {
+            if (frame % k == 0 && snd_pcm_hw_params_test_period_size(handle, hw_params, frame / k, 0) == 0) {
+                chosen = frame / k;
+                break;
+            }
+        }
+        *period_size = chosen;
+        *buffer_size = std::max(chosen * 2, min_buffer);
+        INFO("ALSA lowest-latency probe: min period {} frames, min buffer {} frames -> period {}, buffer {}",
+             min_period, min_buffer, *period_size, *buffer_size);
+    }
+
+    // 为一路 PCM 协商硬件/软件参数并读回实际值；每路使用独立的参数对象
     void SetupParams(snd_pcm_t* handle) {
         int err;
+        const bool capture = handle == capture_handle_;
+        snd_pcm_hw_params_t* hw_params = nullptr;
+        snd_pcm_hw_params_alloca(&hw_params);
+
         // 填充参数对象
-        if ((err = snd_pcm_hw_params_any(handle, hw_params_)) < 0) {
-            std::cerr << "无法初始化硬件参数结构: " << snd_strerror(err) << std::endl;
+        if ((err = snd_pcm_hw_params_any(handle, hw_params)) < 0) {
+            ERROR("无法初始化硬件参数结构: {}", snd_strerror(err));
             throw std::runtime_error("初始化硬件参数结构失败");
         }
 
-        // 设置参数
-        if ((err = snd_pcm_hw_params_set_access(handle, hw_params_,
-                                                SND_PCM_ACCESS_RW_INTERLEAVED)) < 0) {
-            std::cerr << "无法设置访问类型: " << snd_strerror(err) << std::endl;
+        // 设置参数：优先 mmap 直接访问 DMA 缓冲区，设备不支持时回退到 readi/writei
+        bool mmap = prefer_mmap_ &&
+                    snd_pcm_hw_params_set_access(handle, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0;
+        if (!mmap && (err = snd_pcm_hw_params_set_access(handle, hw_params,
+                                                         SND_PCM_ACCESS_RW_INTERLEAVED)) < 0) {
+            ERROR("无法设置访问类型: {}", snd_strerror(err));
             throw std::runtime_error("设置访问类型失败");
         }
+        (capture ? capture_mmap_ : playback_mmap_) = mmap;
 
-        if ((err = snd_pcm_hw_params_set_format(handle, hw_params_, SND_PCM_FORMAT_S16_LE)) < 0) {
-            std::cerr << "无法设置样本格式: " << snd_strerror(err) << std::endl;
+        // SetSampleFormat(F32) 时优先 float32：浮点 DSP 链路直接读写设备，不再经过 int16
+        bool is_float = prefer_float_ &&
+                        snd_pcm_hw_params_set_format(handle, hw_params, SND_PCM_FORMAT_FLOAT_LE) == 0;
+        if (!is_float && (err = snd_pcm_hw_params_set_format(handle, hw_params, SND_PCM_FORMAT_S16_LE)) < 0) {
+            ERROR("无法设置样本格式: {}", snd_strerror(err));
             throw std::runtime_error("设置样本格式失败");
         }
+        (capture ? capture_float_ : playback_float_) = is_float;
 
-        if ((err = snd_pcm_hw_params_set_rate_near(handle, hw_params_, &sample_rate_, 0)) < 0) {
-            std::cerr << "无法设置采样率: " << snd_strerror(err) << std::endl;
-            throw std::runtime_error("设置采样率失败");
-        }
-
-        if ((err = snd_pcm_hw_params_set_channels(handle, hw_params_, channels_)) < 0) {
-            std::cerr << "无法设置声道数: " << snd_strerror(err) << std::endl;
+        if ((err = snd_pcm_hw_params_set_channels(handle, hw_params, StreamChannels(handle))) < 0) {
+            ERROR("无法设置声道数: {}", snd_strerror(err));
             throw std::runtime_error("设置声道数失败");
         }
 
-        // 设置缓冲区大小
-        snd_pcm_uframes_t buffer_size = alsa_buffer_size_;
-        if ((err = snd_pcm_hw_params_set_buffer_size_near(handle, hw_params_, &buffer_size)) < 0) {
-            std::cerr << "ALSA set buffer size error: " << snd_strerror(err) << std::endl;
-            throw std::runtime_error("设置缓冲区大小");
+        // 关闭 plug 层的线性软件重采样，让设备以原生采样率打开，由 SDK 多相重采样器在进程内转换
+        snd_pcm_hw_params_set_rate_resample(handle, hw_params, 0);
+        unsigned int rate = sample_rate_;
+        if ((err = snd_pcm_hw_params_set_rate_near(handle, hw_params, &rate, 0)) < 0) {
+            ERROR("无法设置采样率: {}", snd_strerror(err));
+            throw std::runtime_error("设置采样率失败");
         }
 
-        // 设置周期大小
-        snd_pcm_uframes_t period_size = alsa_period_size_;
-        if ((err = snd_pcm_hw_params_set_period_size_near(handle, hw_params_, &period_size, 0)) <
-            0) {
-            std::cerr << "无法设置周期大小: " << snd_strerror(err) << std::endl;
+        // 先定周期，再按周期数定缓冲区：周期决定唤醒粒度和最小延迟，缓冲区只决定抗抖动余量。
+        // 缓冲区和周期按应用采样率配置，设备采样率不同时等比例换算
+        snd_pcm_uframes_t period_size = static_cast<snd_pcm_uframes_t>(alsa_period_size_) * rate / sample_rate_;
+        snd_pcm_uframes_t buffer_size = static_cast<snd_pcm_uframes_t>(alsa_buffer_size_) * rate / sample_rate_;
+        if (lowest_latency_) {
+            ProbeLowestLatency(handle, hw_params, rate, &period_size, &buffer_size);
+        }
+        if ((err = snd_pcm_hw_params_set_period_size_near(handle, hw_params, &period_size, 0)) < 0) {
+            ERROR("无法设置周期大小: {}", snd_strerror(err));
             throw std::runtime_error("设置周期大小失败");
         }
-
-        // 设置周期数
-        if ((err = snd_pcm_hw_params_set_periods(handle, hw_params_, periods_, 0)) < 0) {
-            std::cerr << "无法设置周期数: " << snd_strerror(err) << std::endl;
-            throw std::runtime_error("设置周期数失败");
+        buffer_size = std::max(buffer_size, period_size * 2);
+        if ((err = snd_pcm_hw_params_set_buffer_size_near(handle, hw_params, &buffer_size)) < 0) {
+            ERROR("ALSA set buffer size error: {}", snd_strerror(err));
+            throw std::runtime_error("设置缓冲区大小");
         }
 
         // 将参数应用到 PCM 设备
-        if ((err = snd_pcm_hw_params(handle, hw_params_)) < 0) {
-            std::cerr << "无法设置硬件参数: " << snd_strerror(err) << std::endl;
+        if ((err = snd_pcm_hw_params(handle, hw_params)) < 0) {
+            ERROR("无法设置硬件参数: {}", snd_strerror(err));
             throw std::runtime_error("设置硬件参数失败");
         }
 
+        // 读回驱动实际给出的值，后续所有换算以此为准
+        AlsaStreamParams granted;
+        granted.mmap = mmap;
+        granted.float_samples = is_float;
+        snd_pcm_hw_params_get_rate(hw_params, &granted.rate, nullptr);
+        snd_pcm_hw_params_get_period_size(hw_params, &granted.period_size, nullptr);
+        snd_pcm_hw_params_get_buffer_size(hw_params, &granted.buffer_size);
+        snd_pcm_hw_params_get_periods(hw_params, &granted.periods, nullptr);
+        granted.can_pause = snd_pcm_hw_params_can_pause(hw_params) == 1;
+        rate = granted.rate;
+
+        // 软件参数：每个周期唤醒一次；播放攒够一个周期即启动（最小启动延迟），
+        // 采集首次读取即启动；播放端已播出的区域由 ALSA 自动清零，欠载时不会重放旧数据。
+        // SetSilenceFill 时播放端欠载也不停（stop_threshold = boundary），由这些清零的区域补静音
+        snd_pcm_sw_params_t* sw_params = nullptr;
+        snd_pcm_sw_params_alloca(&sw_params);
+        snd_pcm_uframes_t boundary = 0;
+        granted.start_threshold = capture ? 1 : granted.period_size;
+        granted.silence_fill = !capture && silence_fill_;
+        if ((err = snd_pcm_sw_params_current(handle, sw_params)) < 0) {
+            ERROR("无法设置软件参数: {}", snd_strerror(err));
+            throw std::runtime_error("设置软件参数失败");
+        }
+        // 采集端打开驱动时间戳，并要求与 NowUs 同源的单调时钟：读出的每帧可以推算硬件采集时刻。
+        // 插件或内核不支持时退回读出时刻，不影响打开设备
+        granted.monotonic_tstamp =
+            capture && snd_pcm_sw_params_set_tstamp_mode(handle, sw_params, SND_PCM_TSTAMP_ENABLE) >= 0 &&
+            snd_pcm_sw_params_set_tstamp_type(handle, sw_params, SND_PCM_TSTAMP_TYPE_MONOTONIC) >= 0;
+        if ((err = snd_pcm_sw_params_set_avail_min(handle, sw_params, granted.period_size)) < 0 ||
+            (err = snd_pcm_sw_params_set_start_threshold(handle, sw_params, granted.start_threshold)) < 0 ||
+            (err = snd_pcm_sw_params_get_boundary(sw_params, &boundary)) < 0 ||
+            (!capture && (err = snd_pcm_sw_params_set_silence_threshold(handle, sw_params, 0)) < 0) ||
+            (!capture && (err = snd_pcm_sw_params_set_silence_size(handle, sw_params, boundary)) < 0) ||
+            (granted.silence_fill && (err = snd_pcm_sw_params_set_stop_threshold(handle, sw_params, boundary)) < 0) ||
+            (err = snd_pcm_sw_params(handle, sw_params)) < 0) {
+            ERROR("无法设置软件参数: {}", snd_strerror(err));
+            throw std::runtime_error("设置软件参数失败");
+        }
+
         // 准备播放设备
         if ((err = snd_pcm_prepare(handle)) < 0) {
-            std::cerr << "无法准备 PCM 设备: " << snd_strerror(err) << std::endl;
+            ERROR("无法准备 PCM 设备: {}", snd_strerror(err));
             throw std::runtime_error("准备播放 PCM 设备失败");
         }
+
+        INFO("ALSA {}: {}Hz {}, period {} frames, buffer {} frames ({} periods), start {}, {}{}{}",
+             capture ? "capture" : "playback", granted.rate, is_float ? "f32" : "s16", granted.period_size,
+             granted.buffer_size, granted.periods, granted.start_threshold, mmap ? "mmap" : "rw",
+             granted.silence_fill ? ", silence fill" : "", granted.monotonic_tstamp ? ", hw timestamps" : "");
+        // 应用帧不是设备周期的整数倍时每帧的唤醒次数不均匀，提示调整周期
+        snd_pcm_uframes_t app_period = granted.period_size * sample_rate_ / rate;
+        if (app_period > 0 && frame_size_ > 0 && static_cast<snd_pcm_uframes_t>(frame_size_) % app_period != 0) {
+            WARN("ALSA {} period {} frames does not divide the {}-frame application frame",
+                 capture ? "capture" : "playback", app_period, frame_size_);
+        }
+
+        // 按协商到的实际采样率决定是否需要进程内重采样
+        std::unique_ptr<Resampler> resampler;
+        if (rate != sample_rate_) {
+            INFO("ALSA {} device runs at {}Hz, resampling to {}Hz in-process", capture ? "capture" : "playback",
+                 rate, sample_rate_);
+            resampler = capture ? std::make_unique<Resampler>(rate, sample_rate_, CaptureChannels())
+                                : std::make_unique<Resampler>(sample_rate_, rate, channels_);
+        }
+        if (capture) {
+            capture_params_ = granted;
+            capture_rate_ = rate;
+            capture_resampler_ = std::move(resampler);
+            capture_pending_len_ = capture_pending_pos_ = 0;
+        } else {
+            playback_params_ = granted;
+            playback_silence_fill_ = granted.silence_fill;
+            playback_rate_ = rate;
+            playback_resampler_ = std::move(resampler);
+        }
     }
 
 private:
-    snd_pcm_t* capture_handle_;
-    snd_pcm_t* playback_handle_;
-    snd_pcm_hw_params_t* hw_params_;
+    snd_pcm_t* capture_handle_ = nullptr;
+    snd_pcm_t* playback_handle_ = nullptr;
+    AlsaStreamParams capture_params_;
+    AlsaStreamParams playback_params_;
     std::vector<short> audio_data_;
+    std::vector<short> scratch_;  // Record/Play 没有可用的帧池时的临时缓冲区
+    bool capture_suspended_ = false;  // SuspendCapture 之后、ResumeCapture 之前
+    bool capture_paused_ = false;     // 以 snd_pcm_pause 暂停（否则为 snd_pcm_drop）
+
+    std::string capture_device_ = "default";   // snd_pcm_open 的设备名，SetDevice 设置
+    std::string playback_device_ = "default";
+    bool lowest_latency_ = false;
+    bool silence_fill_ = false;           // SetSilenceFill 的请求
+    bool playback_silence_fill_ = false;  // 播放端实际以补静音方式打开
+    bool prefer_float_ = false;           // SetSampleFormat(F32) 的请求
+    bool capture_float_ = false;          // 设备实际以 FLOAT_LE 打开
+    bool playback_float_ = false;
+    std::vector<float> capture_f32_;      // int16 读取路径在 float32 设备上的中转
+    std::vector<float> playback_f32_;
 
     unsigned int sample_rate_ = 16000;  // 20ms,  0.02*16000 = 320
     int frame_size_ = 320;
     int channels_ = 1;
+    int capture_channels_ = 0;  // SetCaptureChannels 设置，0 表示与 channels_ 相同
     int chunk_ = frame_size_ * 3;  // 20ms*3
     int periods_ = 4;
     int alsa_buffer_size_ = 4096;
     int alsa_period_size_ = 1024;
+
+    // 设备实际采样率与进程内重采样（与 sample_rate_ 相同时为空）
+    unsigned int capture_rate_ = 16000;
+    unsigned int playback_rate_ = 16000;
+    std::unique_ptr<Resampler> capture_resampler_;
+    std::unique_ptr<Resampler> playback_resampler_;
+    std::vector<short> capture_hw_;       // 设备采样率下的读取缓冲
+    std::vector<short> capture_pending_;  // 已重采样、尚未交给调用方的数据
+    size_t capture_pending_len_ = 0;
+    size_t capture_pending_pos_ = 0;
+    std::vector<short> playback_hw_;      // 设备采样率下的写入缓冲
+    uint64_t capture_end_us_ = 0;         // 最近一次读设备后，已读出数据末尾的采集时刻（仅采集线程）
+    uint64_t capture_stamp_us_ = 0;       // CaptureTimestampUs（仅采集线程）
+
+    // mmap 访问模式
+    bool prefer_mmap_ = true;
+    bool capture_mmap_ = false;
+    bool playback_mmap_ = false;
+    snd_pcm_uframes_t capture_mmap_offset_ = 0;
+    snd_pcm_uframes_t playback_mmap_offset_ = 0;
+
+    // xrun 恢复与统计
+    bool xrun_prefill_ = true;
+    std::vector<short> playback_silence_;
+    LogRateLimiter xrun_log_;
+    LogRateLimiter error_log_;
+    std::atomic<uint64_t> capture_xruns_{0};
+    std::atomic<uint64_t> playback_xruns_{0};
+    std::atomic<uint64_t> suspends_{0};
+    std::atomic<uint64_t> recover_failures_{0};
+    std::atomic<uint64_t> last_recover_us_{0};
+    std::atomic<uint64_t> max_recover_us_{0};
+    std::atomic<uint64_t> total_recover_us_{0};
+    std::atomic<bool> aborted_{false};  // Abort 之后读写立即失败
 };
 
 }  // namespace linx
@@ -0,0 +1,554 @@
+#pragma once
+
+#ifndef __APPLE__
+
+#include <alsa/asoundlib.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Log.h"
+#include "Reactor.h"
+#include "Tracepoints.h"
+
+namespace linx {
+
+// 非阻塞 ALSA 引擎配置
+struct AlsaEngineConfig {
+    std::string capture_device = "default";
+    std::string playback_device = "default";
+    bool capture = true;               // 是否打开采集
+    bool playback = true;              // 是否打开播放
+    unsigned int sample_rate = 16000;  // 采样率
+    int channels = 1;                  // 声道数
+    snd_pcm_uframes_t period_frames = 320;  // 每个周期的帧数，回调按此粒度触发
+    unsigned int periods = 4;          // 设备缓冲区周期数
+    unsigned int playback_fill_periods = 2;  // 播放端维持的缓冲深度（周期），决定输出延迟
+};
+
+// 引擎统计
+struct AlsaEngineStats {
+    uint64_t wakeups = 0;           // poll 返回次数
+    uint64_t capture_periods = 0;   // 交给采集回调的周期数
+    uint64_t playback_periods = 0;  // 写入设备的周期数
+    uint64_t playback_padded = 0;   // 播放回调数据不足而补的静音帧数
+    uint64_t capture_xruns = 0;     // 采集溢出次数
+    uint64_t playback_xruns = 0;    // 播放欠载次数
+    uint64_t playback_drops = 0;    // DropPlayback 执行次数
+};
+
+// 单线程非阻塞 ALSA 引擎
+// 以 SND_PCM_NONBLOCK 打开采集和播放设备，用 snd_pcm_poll_descriptors 把两路设备
+// 复用到同一个 poll 循环中：采集端每满一个周期调用一次采集回调，播放端每腾出一个周期
+// 调用一次播放回调取数据。播放回调返回的帧数不足时由引擎补静音，设备始终保持运行，
+// 不再需要上层在欠载前补静音。一个线程、每周期一次唤醒，替代每路一个阻塞线程。
+// 也可以不启动自己的线程，用 Attach 把设备描述符挂到外部 Reactor 上，与网络等共用一个循环线程。
+class AlsaEngine {
+public:
+    // 采集回调：pcm 为一个周期的交织数据，只在回调期间有效
+    using CaptureHandler = std::function<void(const short* pcm, size_t frames)>;
+    // 播放回调：向 pcm 写入最多 frames 帧，返回实际写入的帧数（其余补静音）
+    using PlaybackHandler = std::function<size_t(short* pcm, size_t frames)>;
+    // 音频线程启动时在线程内调用一次，用于设置调度策略、CPU 绑定等
+    using ThreadHook = std::function<void()>;
+
+    AlsaEngine() = default;
+    ~AlsaEngine() {
+        Stop();
+        Close();
+    }
+
+    AlsaEngine(const AlsaEngine&) = delete;
+    AlsaEngine& operator=(const AlsaEngine&) = delete;
+
+    // 打开并配置设备，失败时关闭已打开的设备并返回 false
+    bool Open(const AlsaEngineConfig& config) {
+        Close();
+        config_ = config;
+        period_frames_ = 0;
+        if (config_.capture && !OpenStream(config_.capture_device, SND_PCM_STREAM_CAPTURE, &capture_)) {
+            Close();
+            return false;
+        }
+        if (config_.playback && !OpenStream(config_.playback_device, SND_PCM_STREAM_PLAYBACK, &playback_)) {
+            Close();
+            return false;
+        }
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd_ < 0) {
+            ERROR("AlsaEngine: eventfd failed");
+            Close();
+            return false;
+        }
+        capture_buffer_.assign(period_frames_ * config_.channels, 0);
+        playback_buffer_.assign(period_frames_ * config_.channels, 0);
+        return true;
+    }
+
+    void Close() {
+        if (capture_ != nullptr) {
+            snd_pcm_drop(capture_);
+            snd_pcm_close(capture_);
+            capture_ = nullptr;
+        }
+        if (playback_ != nullptr) {
+            snd_pcm_drop(playback_);
+            snd_pcm_close(playback_);
+            playback_ = nullptr;
+        }
+        if (wake_fd_ >= 0) {
+            close(wake_fd_);
+            wake_fd_ = -1;
+        }
+    }
+
+    // 须在 Start 之前设置
+    void SetCaptureHandler(CaptureHandler handler) { capture_handler_ = std::move(handler); }
+    void SetPlaybackHandler(PlaybackHandler handler) { playback_handler_ = std::move(handler); }
+    void SetThreadHook(ThreadHook hook) { thread_hook_ = std::move(hook); }
+
+    // 启动/停止音频线程
+    bool Start() {
+        if (running_ || (capture_ == nullptr && playback_ == nullptr)) {
+            return false;
+        }
+        running_ = true;
+        thread_ = std::thread(&AlsaEngine::Run, this);
+        return true;
+    }
+
+    void Stop() {
+        if (reactor_ != nullptr) {
+            Detach();
+            return;
+        }
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+        Wake();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    bool Running() const { return running_; }
+
+    // 不启动音频线程，把设备描述符和唤醒 fd 注册到 reactor，回调改在 reactor 的循环线程上执行。
+    // 与 Start 二选一；ThreadHook 不会被调用，调度策略由运行 reactor 的线程自行设置。
+    // 设备在循环线程上启动，reactor 尚未运行时等到它运行。
+    bool Attach(Reactor& reactor) {
+        if (running_ || (capture_ == nullptr && playback_ == nullptr)) {
+            return false;
+        }
+        reactor_ = &reactor;
+        running_ = true;
+        reactor.Post([this]() {
+            if (!running_) {
+                return;  // 启动前已经 Detach
+            }
+            StartDevices();
+            SyncReactorFds();
+        });
+        return true;
+    }
+
+    // 从 reactor 注销；在其他线程调用且 reactor 正在运行时，等循环线程注销完成后返回
+    void Detach() {
+        if (reactor_ == nullptr) {
+            return;
+        }
+        running_ = false;
+        auto teardown = [this]() {
+            for (const struct pollfd& entry : reactor_fds_) {
+                reactor_->RemoveFd(entry.fd);
+            }
+            reactor_fds_.clear();
+        };
+        if (reactor_->Running() && !reactor_->InLoopThread()) {
+            std::promise<void> done;
+            reactor_->Post([&]() {
+                teardown();
+                done.set_value();
+            });
+            done.get_future().wait();
+        } else {
+            teardown();
+        }
+        reactor_ = nullptr;
+    }
+
+    // 丢弃播放设备中尚未播出的数据（打断 TTS）。任意线程（包括播放回调内）可调用，
+    // 由音频线程在下一轮循环中 snd_pcm_drop 并重新垫静音启动，不等待当前周期播完
+    void DropPlayback() {
+        if (playback_ == nullptr) {
+            return;
+        }
+        drop_playback_.store(true, std::memory_order_release);
+        Wake();
+    }
+
+    // 设备实际协商到的周期帧数与采样率（Open 之后有效）
+    snd_pcm_uframes_t PeriodFrames() const { return period_frames_; }
+    unsigned int SampleRate() const { return rate_; }
+
+    AlsaEngineStats GetStats() const {
+        AlsaEngineStats stats;
+        stats.wakeups = wakeups_.load(std::memory_order_relaxed);
+        stats.capture_periods = capture_periods_.load(std::memory_order_relaxed);
+        stats.playback_periods = playback_periods_.load(std::memory_order_relaxed);
+        stats.playback_padded = playback_padded_.load(std::memory_order_relaxed);
+        stats.capture_xruns = capture_xruns_.load(std::memory_order_relaxed);
+        stats.playback_xruns = playback_xruns_.load(std::memory_order_relaxed);
+        stats.playback_drops = playback_drops_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    void Wake() {
+        uint64_t one = 1;
+        if (write(wake_fd_, &one, sizeof(one)) < 0) {
+            WARN("AlsaEngine: wake failed");
+        }
+    }
+
+    bool OpenStream(const std::string& device, snd_pcm_stream_t stream, snd_pcm_t** handle) {
+        const bool capture = stream == SND_PCM_STREAM_CAPTURE;
+        int err = snd_pcm_open(handle, device.c_str(), stream, SND_PCM_NONBLOCK);
+        if (err < 0) {
+            ERROR("AlsaEngine: open {} {} failed: {}", capture ? "capture" : "playback", device, snd_strerror(err));
+            *handle = nullptr;
+            return false;
+        }
+        return Configure(*handle, capture);
+    }
+
+    // 硬件参数与 Open 的配置一致；软件参数让 poll 按周期唤醒，并由引擎显式启动设备
+    bool Configure(snd_pcm_t* handle, bool capture) {
+        const char* name = capture ? "capture" : "playback";
+        snd_pcm_hw_params_t* hw = nullptr;
+        snd_pcm_hw_params_alloca(&hw);
+        unsigned int rate = config_.sample_rate;
+        snd_pcm_uframes_t period = config_.period_frames;
+        snd_pcm_uframes_t buffer = config_.period_frames * config_.periods;
+        int err = 0;
+        if ((err = snd_pcm_hw_params_any(handle, hw)) < 0 ||
+            (err = snd_pcm_hw_params_set_access(handle, hw, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0 ||
+            (err = snd_pcm_hw_params_set_format(handle, hw, SND_PCM_FORMAT_S16_LE)) < 0 ||
+            (err = snd_pcm_hw_params_set_channels(handle, hw, config_.channels)) < 0 ||
+            (err = snd_pcm_hw_params_set_rate_near(handle, hw, &rate, 0)) < 0 ||
+            (err = snd_pcm_hw_params_set_period_size_near(handle, hw, &period, 0)) < 0 ||
+            (err = snd_pcm_hw_params_set_buffer_size_near(handle, hw, &buffer)) < 0 ||
+            (err = snd_pcm_hw_params(handle, hw)) < 0) {
+            ERROR("AlsaEngine: {} hw params failed: {}", name, snd_strerror(err));
+            return false;
+        }
+        snd_pcm_hw_params_get_period_size(hw, &period, 0);
+        snd_pcm_hw_params_get_buffer_size(hw, &buffer);
+        if (rate != config_.sample_rate) {
+            WARN("AlsaEngine: {} runs at {}Hz instead of {}Hz", name, rate, config_.sample_rate);
+        }
+        // 两路设备共用一个周期粒度，以先打开的一路为准
+        if (period_frames_ == 0) {
+            period_frames_ = period;
+            rate_ = rate;
+        } else if (period != period_frames_) {
+            WARN("AlsaEngine: {} period {} differs from {}", name, period, period_frames_);
+        }
+
+        // 播放端维持 fill 帧深度：剩余不足 fill - period 时唤醒，一次补足
+        snd_pcm_uframes_t avail_min = period;
+        if (!capture) {
+            snd_pcm_uframes_t fill = std::min<snd_pcm_uframes_t>(
+                buffer, period * std::max(2u, config_.playback_fill_periods));
+            playback_fill_ = fill;
+            playback_buffer_frames_ = buffer;
+            avail_min = buffer - fill + period;
+        }
+
+        snd_pcm_sw_params_t* sw = nullptr;
+        snd_pcm_sw_params_alloca(&sw);
+        if ((err = snd_pcm_sw_params_current(handle, sw)) < 0 ||
+            (err = snd_pcm_sw_params_set_avail_min(handle, sw, avail_min)) < 0 ||
+            (err = snd_pcm_sw_params_set_start_threshold(handle, sw, capture ? buffer * 2 : period)) < 0 ||
+            (err = snd_pcm_sw_params(handle, sw)) < 0) {
+            ERROR("AlsaEngine: {} sw params failed: {}", name, snd_strerror(err));
+            return false;
+        }
+        if ((err = snd_pcm_prepare(handle)) < 0) {
+            ERROR("AlsaEngine: {} prepare failed: {}", name, snd_strerror(err));
+            return false;
+        }
+        INFO("AlsaEngine: {} {}Hz, period {} frames, buffer {} frames", name, rate, period, buffer);
+        return true;
+    }
+
+    void Run() {
+        if (thread_hook_) {
+            thread_hook_();
+        }
+        StartDevices();
+
+        while (running_) {
+            LoadDescriptors();
+            int ready = poll(fds_.data(), fds_.size(), 1000);
+            if (ready < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                ERROR("AlsaEngine: poll failed: {}", strerror(errno));
+                break;
+            }
+            wakeups_.fetch_add(1, std::memory_order_relaxed);
+            LINX_PROBE(engine_wakeup, ready);
+            if (!running_) {
+                break;
+            }
+            ServiceReady();
+        }
+    }
+
+    // 分配描述符表并启动设备；描述符表末尾固定为唤醒 fd
+    void StartDevices() {
+        capture_fd_count_ = capture_ ? snd_pcm_poll_descriptors_count(capture_) : 0;
+        playback_fd_count_ = playback_ ? snd_pcm_poll_descriptors_count(playback_) : 0;
+        fds_.assign(capture_fd_count_ + playback_fd_count_ + 1, {});
+        LoadDescriptors();
+
+        if (capture_ != nullptr) {
+            snd_pcm_start(capture_);  // 采集的 start_threshold 大于缓冲区，须显式启动
+        }
+        if (playback_ != nullptr) {
+            FillPlayback(false);  // 先垫满目标深度（静音），设备随之启动
+        }
+    }
+
+    // 每轮都重新取描述符：xrun 恢复后部分插件会换 fd/事件
+    void LoadDescriptors() {
+        if (capture_fd_count_ > 0) {
+            snd_pcm_poll_descriptors(capture_, fds_.data(), capture_fd_count_);
+        }
+        if (playback_fd_count_ > 0) {
+            snd_pcm_poll_descriptors(playback_, fds_.data() + capture_fd_count_, playback_fd_count_);
+        }
+        struct pollfd& wake = fds_.back();
+        wake.fd = wake_fd_;
+        wake.events = POLLIN;
+        wake.revents = 0;
+    }
+
+    // 按 fds_ 中的 revents 处理唤醒、打断、采集和播放，线程模式与 reactor 模式共用
+    void ServiceReady() {
+        if (fds_.back().revents & POLLIN) {
+            uint64_t count = 0;
+            if (read(wake_fd_, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+                WARN("AlsaEngine: wake read failed: {}", strerror(errno));
+            }
+        }
+        if (drop_playback_.exchange(false, std::memory_order_acquire)) {
+            DropAndRestartPlayback();
+        }
+
+        unsigned short revents = 0;
+        if (capture_fd_count_ > 0 &&
+            snd_pcm_poll_descriptors_revents(capture_, fds_.data(), capture_fd_count_, &revents) == 0 &&
+            (revents & (POLLIN | POLLERR))) {
+            ServiceCapture();
+        }
+        revents = 0;
+        if (playback_fd_count_ > 0 &&
+            snd_pcm_poll_descriptors_revents(playback_, fds_.data() + capture_fd_count_, playback_fd_count_,
+                                             &revents) == 0 &&
+            (revents & (POLLOUT | POLLERR))) {
+            FillPlayback(true);
+        }
+    }
+
+    // reactor 回调：一次只带一个 fd 的事件，填回描述符表后按线程模式同样处理
+    void OnReactorFd(int fd, short revents) {
+        for (struct pollfd& entry : fds_) {
+            entry.revents = entry.fd == fd ? revents : 0;
+        }
+        wakeups_.fetch_add(1, std::memory_order_relaxed);
+        if (!running_) {
+            return;
+        }
+        ServiceReady();
+        SyncReactorFds();
+    }
+
+    // 让 reactor 中的注册与设备当前的描述符一致，只在 fd 或事件变化时增删改
+    void SyncReactorFds() {
+        LoadDescriptors();
+        std::vector<struct pollfd> wanted;
+        for (const struct pollfd& entry : fds_) {
+            auto it = std::find_if(wanted.begin(), wanted.end(),
+                                   [&](const struct pollfd& w) { return w.fd == entry.fd; });
+            if (it != wanted.end()) {
+                it->events |= entry.events;
+            } else {
+                wanted.push_back({entry.fd, entry.events, 0});
+            }
+        }
+        for (const struct pollfd& old : reactor_fds_) {
+            if (std::none_of(wanted.begin(), wanted.end(), [&](const struct pollfd& w) { return w.fd == old.fd; })) {
+                reactor_->RemoveFd(old.fd);
+            }
+        }
+        for (const struct pollfd& want : wanted) {
+            auto it = std::find_if(reactor_fds_.begin(), reactor_fds_.end(),
+                                   [&](const struct pollfd& r) { return r.fd == want.fd; });
+            if (it == reactor_fds_.end()) {
+                reactor_->AddFd(want.fd, want.events, [this](int fd, short revents) { OnReactorFd(fd, revents); });
+            } else if (it->events != want.events) {
+                reactor_->ModifyFd(want.fd, want.events);
+            }
+        }
+        reactor_fds_.swap(wanted);
+    }
+
+    // 读出所有已满的周期，逐个交给采集回调
+    void ServiceCapture() {
+        for (;;) {
+            snd_pcm_sframes_t avail = snd_pcm_avail_update(capture_);
+            if (avail < 0) {
+                Recover(capture_, static_cast<int>(avail), true);
+                return;
+            }
+            if (static_cast<snd_pcm_uframes_t>(avail) < period_frames_) {
+                return;
+            }
+            snd_pcm_sframes_t n = snd_pcm_readi(capture_, capture_buffer_.data(), period_frames_);
+            if (n == -EAGAIN) {
+                return;
+            }
+            if (n < 0) {
+                Recover(capture_, static_cast<int>(n), true);
+                return;
+            }
+            capture_periods_.fetch_add(1, std::memory_order_relaxed);
+            LINX_PROBE(engine_capture, n);
+            if (capture_handler_) {
+                capture_handler_(capture_buffer_.data(), static_cast<size_t>(n));
+            }
+        }
+    }
+
+    // 把播放缓冲补到目标深度；from_handler 为 false 时只写静音（启动/恢复时垫底）
+    void FillPlayback(bool from_handler) {
+        for (;;) {
+            snd_pcm_sframes_t avail = snd_pcm_avail_update(playback_);
+            if (avail < 0) {
+                Recover(playback_, static_cast<int>(avail), false);
+                return;
+            }
+            if (static_cast<snd_pcm_uframes_t>(avail) < period_frames_ ||
+                playback_buffer_frames_ - avail + period_frames_ > playback_fill_) {
+                return;
+            }
+
+            size_t got = 0;
+            if (from_handler && playback_handler_) {
+                got = std::min<size_t>(playback_handler_(playback_buffer_.data(), period_frames_), period_frames_);
+            }
+            if (got < period_frames_) {
+                std::fill(playback_buffer_.begin() + got * config_.channels, playback_buffer_.end(), 0);
+                if (from_handler) {
+                    playback_padded_.fetch_add(period_frames_ - got, std::memory_order_relaxed);
+                }
+            }
+            snd_pcm_sframes_t n = snd_pcm_writei(playback_, playback_buffer_.data(), period_frames_);
+            if (n == -EAGAIN) {
+                return;
+            }
+            if (n < 0) {
+                Recover(playback_, static_cast<int>(n), false);
+                return;
+            }
+            playback_periods_.fetch_add(1, std::memory_order_relaxed);
+            LINX_PROBE(engine_playback, got);
+        }
+    }
+
+    // 丢弃播放缓冲中的全部数据后重新垫静音启动，与 xrun 恢复走同样的启动路径
+    void DropAndRestartPlayback() {
+        int err = snd_pcm_drop(playback_);
+        if (err >= 0) {
+            err = snd_pcm_prepare(playback_);
+        }
+        if (err < 0) {
+            ERROR("AlsaEngine: playback drop failed: {}", snd_strerror(err));
+            return;
+        }
+        playback_drops_.fetch_add(1, std::memory_order_relaxed);
+        FillPlayback(false);
+    }
+
+    // xrun/挂起恢复后重新启动：采集显式 start，播放重新垫静音
+    void Recover(snd_pcm_t* handle, int err, bool capture) {
+        if (err == -EAGAIN) {
+            return;
+        }
+        (capture ? capture_xruns_ : playback_xruns_).fetch_add(1, std::memory_order_relaxed);
+        WARN("AlsaEngine: {} xrun: {}", capture ? "capture" : "playback", snd_strerror(err));
+        if ((err = snd_pcm_recover(handle, err, 1)) < 0) {
+            ERROR("AlsaEngine: {} recover failed: {}", capture ? "capture" : "playback", snd_strerror(err));
+            return;
+        }
+        if (capture) {
+            snd_pcm_start(handle);
+        } else {
+            FillPlayback(false);
+        }
+    }
+
+    AlsaEngineConfig config_;
+    snd_pcm_t* capture_ = nullptr;
+    snd_pcm_t* playback_ = nullptr;
+    int wake_fd_ = -1;
+
+    snd_pcm_uframes_t period_frames_ = 0;
+    unsigned int rate_ = 0;
+    snd_pcm_uframes_t playback_fill_ = 0;
+    snd_pcm_uframes_t playback_buffer_frames_ = 0;
+    std::vector<short> capture_buffer_;
+    std::vector<short> playback_buffer_;
+
+    CaptureHandler capture_handler_;
+    PlaybackHandler playback_handler_;
+    ThreadHook thread_hook_;
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> drop_playback_{false};
+
+    // 仅音频线程（或 reactor 循环线程）访问
+    std::vector<struct pollfd> fds_;
+    int capture_fd_count_ = 0;
+    int playback_fd_count_ = 0;
+    Reactor* reactor_ = nullptr;
+    std::vector<struct pollfd> reactor_fds_;  // 已注册到 reactor 的 fd（同一 fd 的事件已合并）
+
+    std::atomic<uint64_t> wakeups_{0};
+    std::atomic<uint64_t> capture_periods_{0};
+    std::atomic<uint64_t> playback_periods_{0};
+    std::atomic<uint64_t> playback_padded_{0};
+    std::atomic<uint64_t> capture_xruns_{0};
+    std::atomic<uint64_t> playback_xruns_{0};
+    std::atomic<uint64_t> playback_drops_{0};
+};
+
+}  // namespace linx
+
+#endif  // !__APPLE__
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "AssetPack.h"
+#include "Opus.h"
+
+namespace linx {
+
+struct AssetPlayerStats {
+    uint64_t started = 0;        // Play 开始播放的片段数
+    uint64_t completed = 0;      // 播放到结尾的片段数（未被替换或停止）
+    uint64_t decode_errors = 0;  // 解码失败或包表损坏而跳过的包
+};
+
+// 资源包片段的播放源：作为 OutputMixer 一路输入的拉取回调，在播放线程上按需解码映射内存中的 Opus 包，
+// 每次只解码这一个周期用到的部分。片段不预先解码成 PCM，也不拷贝进堆，常驻内存只有一个解码器和一包的 PCM。
+// 解码器按播放格式（sample_rate / channels）创建，任意采样率、单/双声道编码的片段都直接解码到播放格式。
+// Play / Stop 可在任意线程调用（后一次替换前一次，在下一次 Pull 时生效）；Pull 只在播放线程上调用
+class AssetPlayer {
+public:
+    AssetPlayer(const AssetPack& pack, unsigned int sample_rate, int channels);
+
+    AssetPlayer(const AssetPlayer&) = delete;
+    AssetPlayer& operator=(const AssetPlayer&) = delete;
+
+    bool Valid() const { return decoder_.Valid(); }
+
+    // 从头播放片段，替换正在播放的片段；编号无效时返回 false
+    bool Play(size_t clip);
+    // 按名称播放，资源包中没有时返回 false
+    bool Play(std::string_view name);
+    void Stop();
+    // 有片段在播放或等待开始（用于唤醒播放线程，见 OutputMixer::AddStream 的 pending）
+    bool Active() const { return active_.load(std::memory_order_relaxed); }
+
+    // 播放线程：最多写入 samples 个样本（交错），返回实际写入数，没有片段时返回 0
+    size_t Pull(short* out, size_t samples);
+
+    AssetPlayerStats GetStats() const;
+
+private:
+    void Post(uint64_t field);
+    void ApplyCommand();
+    // 解码下一个包到 pcm_，片段已播完时返回 false
+    bool DecodeNext();
+
+    const AssetPack& pack_;
+    OpusDecoderCtx decoder_;
+    // 命令：序号 << 32 | (片段编号 + 1)，低 32 位为 0 表示停止
+    std::atomic<uint64_t> command_{0};
+    std::atomic<uint32_t> sequence_{0};
+    std::atomic<bool> active_{false};
+
+    // 以下只在播放线程访问
+    uint64_t seen_command_ = 0;
+    AssetClip clip_;
+    bool playing_ = false;
+    size_t packet_ = 0;
+    size_t skip_ = 0;         // 开头还要丢弃的样本（pre_skip 换算到播放格式）
+    std::vector<short> pcm_;  // 一个包解码出的 PCM（最长 120ms）
+    size_t pcm_pos_ = 0;
+    size_t pcm_len_ = 0;
+
+    std::atomic<uint64_t> started_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> decode_errors_{0};
+};
+
+}  // namespace linx
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+#include "AudioProfile.h"
+
+namespace linx {
+
+// 编译期音频格式：采样率、声道数和每帧样本数（每声道）都是常量。
+// DSP 内核、帧缓冲区和编解码封装按它特化后，缓冲区大小为 constexpr，逐样本循环的次数和步长也是常量，
+// 编译器可以完全展开并向量化（GCC -O2 的 very-cheap 模型只向量化次数已知的循环），不需要尾部处理
+template <unsigned int Rate, int Channels, size_t FrameSamples>
+struct AudioFormat {
+    static_assert(Rate >= 8000 && Rate <= 48000, "unsupported sample rate");
+    static_assert(Channels >= 1 && Channels <= 2, "unsupported channel count");
+    static_assert(FrameSamples > 0 && FrameSamples * 1000 % Rate == 0, "frame must be a whole number of ms");
+
+    static constexpr unsigned int kSampleRate = Rate;
+    static constexpr int kChannels = Channels;
+    static constexpr size_t kFrameSamples = FrameSamples;                    // 每声道
+    static constexpr size_t kFrameInterleaved = FrameSamples * Channels;     // 交错后的样本数
+    static constexpr size_t kFrameBytes = kFrameInterleaved * sizeof(short);
+    static constexpr int kFrameMs = static_cast<int>(FrameSamples * 1000 / Rate);
+
+    // 一帧交错 PCM，按 cache line 对齐，可直接放在栈上或作为成员
+    struct alignas(64) Frame {
+        short data[kFrameInterleaved];
+    };
+};
+
+// 流水线实际使用的两种格式（AudioProfile 的 normal / low 两种延迟模式）
+using Voice16kMono60ms = AudioFormat<16000, 1, 960>;
+using Voice16kMono20ms = AudioFormat<16000, 1, 320>;
+
+// 运行时的格式描述（类型擦除后的 AudioFormat），与编译期格式比较后选择特化实现
+struct AudioFormatInfo {
+    unsigned int sample_rate = 16000;
+    int channels = 1;
+    size_t frame_samples = 960;  // 每声道
+
+    static AudioFormatInfo FromProfile(const AudioProfile& profile) {
+        AudioFormatInfo info;
+        info.sample_rate = profile.sample_rate;
+        info.channels = profile.channels;
+        info.frame_samples = static_cast<size_t>(profile.FrameSamples());
+        return info;
+    }
+
+    template <typename Format>
+    static constexpr AudioFormatInfo Of() {
+        return AudioFormatInfo{Format::kSampleRate, Format::kChannels, Format::kFrameSamples};
+    }
+
+    template <typename Format>
+    bool Is() const {
+        return sample_rate == Format::kSampleRate && channels == Format::kChannels &&
+               frame_samples == Format::kFrameSamples;
+    }
+};
+
+// 在 Formats 中找到与 info 一致的第一个格式，调用 fn(Format{}) 并返回 true；
+// 都不一致时返回 false，调用方退回到运行时参数的通用实现
+template <typename... Formats, typename Fn>
+bool DispatchAudioFormat(const AudioFormatInfo& info, Fn&& fn) {
+    bool matched = false;
+    ((!matched && info.Is<Formats>() ? (fn(Formats{}), matched = true) : false), ...);
+    return matched;
+}
+
+// 按流水线的两种格式分派
+template <typename Fn>
+bool DispatchVoiceFormat(const AudioFormatInfo& info, Fn&& fn) {
+    return DispatchAudioFormat<Voice16kMono60ms, Voice16kMono20ms>(info, std::forward<Fn>(fn));
+}
+
+}  // namespace linx
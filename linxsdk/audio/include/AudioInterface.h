@@ -1,10 +1,59 @@
 #pragma once
 
-#include <vector>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
+
+#include "AudioProfile.h"
+#include "FramePool.h"
+#include "MediaFrame.h"
+#include "PcmKernels.h"
 
 namespace linx {
 
+// 设备的样本格式
+enum class SampleFormat : uint8_t {
+    S16 = 0,  // int16 交织
+    F32 = 1,  // float32 交织，满幅为 [-1, 1)
+};
+
+// 设备 xrun 与恢复统计
+struct AudioXrunStats {
+    uint64_t capture_xruns = 0;      // 采集溢出（-EPIPE）次数
+    uint64_t playback_xruns = 0;     // 播放欠载（-EPIPE）次数
+    uint64_t suspends = 0;           // 设备挂起（-ESTRPIPE）次数
+    uint64_t recover_failures = 0;   // 恢复失败次数
+    uint64_t last_recover_us = 0;    // 最近一次恢复耗时
+    uint64_t max_recover_us = 0;     // 最长恢复耗时
+    uint64_t total_recover_us = 0;   // 恢复总耗时
+};
+
+// 设备一个方向（采集或播放）支持的参数，由 ListDevices 探测
+struct AudioDeviceCaps {
+    bool supported = false;                 // 设备有这个方向
+    bool busy = false;                      // 探测时设备被占用（或无权限），以下参数未知
+    unsigned int min_channels = 0;
+    unsigned int max_channels = 0;
+    std::vector<unsigned int> rates;        // kProbeSampleRates 中设备直接支持的采样率
+    unsigned long min_period_frames = 0;    // 设备允许的最小周期，0 表示未知
+    unsigned long min_buffer_frames = 0;    // 设备允许的最小缓冲区，0 表示未知
+};
+
+// 枚举到的一个音频设备
+struct AudioDeviceInfo {
+    int index = -1;    // 在 ListDevices 结果中的序号，可直接作为 SetDevice 的参数
+    std::string id;    // 打开设备用的名字：ALSA 为 "hw:<card>,<device>"，PortAudio 为设备序号
+    std::string name;  // 可读名称，如 "USB Audio Device: USB Audio"
+    int card = -1;     // ALSA 声卡号，其他后端为 -1
+    int device = -1;   // ALSA 设备号，其他后端为 -1
+    AudioDeviceCaps capture;
+    AudioDeviceCaps playback;
+};
+
+// ListDevices 探测的采样率
+constexpr unsigned int kProbeSampleRates[] = {8000, 11025, 16000, 22050, 24000, 32000, 44100, 48000, 96000};
+
 class AudioInterface {
 public:
     virtual ~AudioInterface() = default;
@@ -16,9 +65,207 @@ public:
     virtual bool Write(short* buffer, size_t frame_size) = 0;
     virtual void Record() = 0;
     virtual void Play() = 0;
+
+    // 按统一的音频流水线配置设置设备参数，周期与 Opus 帧对齐
+    void ApplyProfile(const AudioProfile& profile) {
+        SetConfig(profile.sample_rate, profile.PeriodSize(), profile.channels, profile.periods,
+                  profile.BufferSize(), profile.PeriodSize());
+    }
+
+    // 零拷贝采集：阻塞直到设备缓冲区中有 frames 帧数据，返回指向其中连续一段的指针，
+    // *got 为这段的帧数（环绕时可能小于 frames）；处理完后调用 ReleaseCapture 归还。
+    // 后端不支持（未使用 mmap 或需要重采样）时返回 nullptr，调用方改用 Read
+    virtual const short* AcquireCapture(size_t frames, size_t* got) { return nullptr; }
+    virtual void ReleaseCapture(size_t frames) {}
+
+    // 最近一次 Read / AcquireCapture 交出的数据中第一帧的硬件采集时刻（MediaFrame::NowUs 时钟），
+    // 由驱动给出的时间戳推算，包含了数据在驱动和设备缓冲区中排队的时间（读出时刻会漏掉这一段，最多一整个缓冲区）。
+    // 由读采集数据的线程调用；后端不支持或时间戳不可信时返回 0，调用方改用读出时刻
+    virtual uint64_t CaptureTimestampUs() const { return 0; }
+
+    // 零拷贝播放：阻塞直到设备缓冲区有 frames 帧空间，返回可直接写入的连续区域，
+    // 写完后调用 CommitPlayback 提交实际写入的帧数；不支持时返回 nullptr，调用方改用 Write
+    virtual short* AcquirePlayback(size_t frames, size_t* got) { return nullptr; }
+    virtual void CommitPlayback(size_t frames) {}
+
+    // 播放设备中已写入但尚未播出的帧数，用于决定何时需要补数据；-1 表示后端无法获知
+    virtual long GetPlaybackDelay() { return -1; }
+
+    // 丢弃播放设备中已写入但尚未播出的数据（打断 TTS），返回后可立即写入新数据；
+    // 由写播放数据的线程调用。后端不支持时返回 false，此时已写入的数据会照常播完
+    virtual bool DropPlayback() { return false; }
+
+    // 退出：可在任意线程调用，唤醒阻塞在 Read/Write/AcquireCapture/AcquirePlayback 中的线程并让它们返回失败，
+    // 之后的读写都立即失败，设备中未播完的数据直接丢弃（析构时不再等待播完）。不可恢复，只用于进程退出。
+    // 后端不支持时为空操作，读写最多再阻塞一个周期
+    virtual void Abort() {}
+
+    // 省电：暂停采集流（停止 DMA，编解码芯片可以进入低功耗），由读采集数据的线程在长时间不需要录音时调用，
+    // 暂停期间不要调用 Read/AcquireCapture。ResumeCapture 恢复后丢弃暂停前残留的样本，下一次读取从新采集的数据开始。
+    // 后端不支持时返回 false，调用方继续照常读取
+    virtual bool SuspendCapture() { return false; }
+    virtual bool ResumeCapture() { return false; }
+
+    // 省电：暂停播放流（设备中的数据已播完、不再补静音时），由写播放数据的线程调用；
+    // ResumePlayback 之后照常 Write。后端不支持时返回 false，设备照旧在欠载后自然停下
+    virtual bool SuspendPlayback() { return false; }
+    virtual bool ResumePlayback() { return false; }
+
+    // 由驱动（或后端的实时回调）在没有新数据时自己补静音：欠载不停流、不重放旧数据，
+    // 播放线程空闲时不必再写静音。须在 Init 之前调用；后端不支持时忽略
+    virtual void SetSilenceFill(bool enabled) {}
+    // Init 之后：播放设备是否自己补静音。回调式后端总是在回调里补零，与 SetSilenceFill 无关
+    virtual bool SilenceFill() const { return false; }
+
+    // 全双工后端：取出与最近一次 Read 逐样本对齐的播放参考信号（同一设备时钟、同一回调中渲染的输出），
+    // 供回声消除使用；frames 不能超过上次 Read 的帧数。后端不支持时返回 false
+    virtual bool ReadEchoReference(short* buffer, size_t frames) { return false; }
+
+    // 枚举本后端可用的设备，并探测各自支持的声道数、采样率和最小周期；后端不支持枚举时返回空
+    virtual std::vector<AudioDeviceInfo> ListDevices() { return {}; }
+
+    // 选择采集和播放设备，须在 Init 之前调用。每个参数可以是：空或 "default"（默认设备）、
+    // ListDevices 的序号、后端的设备名（ALSA 的 "hw:1,0"/"plughw:1,0" 等 PCM 名，绕过 dmix/dsnoop），
+    // 或设备名称中的一段（不区分大小写）。任一个找不到时返回 false，两路都保持原来的选择
+    virtual bool SetDevice(const std::string& capture, const std::string& playback) { return false; }
+
+    // 以设备支持的最低延迟配置打开：周期取设备允许的最小值（优先能整除应用帧的值），缓冲区为两个周期，
+    // 不再使用 SetConfig 给出的周期和缓冲区；须在 Init 之前调用。后端不支持时忽略
+    virtual void SetLowestLatency(bool enabled) {}
+
+    // xrun 计数与恢复耗时，后端不统计时全为 0
+    virtual AudioXrunStats GetXrunStats() const { return AudioXrunStats(); }
+
+    // 当前配置的采样率与声道数（SetConfig 设置的值），未配置时采样率为 0
+    virtual unsigned int SampleRate() const { return 0; }
+    virtual int Channels() const { return 1; }
+
+    // 采集端单独使用的声道数（如多麦克风阵列，每帧 channels 个交织样本），播放端仍为 Channels()；
+    // 须在 Init 之前调用，后端不支持时返回 false。Read / AcquireCapture 的数据按 CaptureChannels() 交织
+    virtual bool SetCaptureChannels(int channels) { return channels == Channels(); }
+    virtual int CaptureChannels() const { return Channels(); }
+
+    // 请求设备以 format 打开（须在 Init 之前）。后端不支持 float32 时返回 false，设备仍以 int16 打开，
+    // ReadFloat / WriteFloat 照常可用（经一次转换）
+    virtual bool SetSampleFormat(SampleFormat format) { return format == SampleFormat::S16; }
+    // Init 之后：采集 / 播放设备实际使用的格式
+    virtual SampleFormat CaptureFormat() const { return SampleFormat::S16; }
+    virtual SampleFormat PlaybackFormat() const { return SampleFormat::S16; }
+
+    // float32 读写（交织，满幅为 [-1, 1)），供浮点 DSP 链路：设备以 F32 打开时后端直接读写设备缓冲区，
+    // 不经过 int16；否则在这里与 int16 转换一次（PcmKernels 的 SIMD 内核）。Read 与 Write 在不同线程时各用各的缓冲区
+    virtual bool ReadFloat(float* buffer, size_t frames) {
+        const size_t samples = frames * CaptureChannels();
+        if (read_convert_.size() < samples) {
+            read_convert_.resize(samples);
+        }
+        if (!Read(read_convert_.data(), frames)) {
+            return false;
+        }
+        PcmToFloat(buffer, read_convert_.data(), samples);
+        return true;
+    }
+    virtual bool WriteFloat(const float* buffer, size_t frames) {
+        const size_t samples = frames * Channels();
+        if (write_convert_.size() < samples) {
+            write_convert_.resize(samples);
+        }
+        PcmFromFloat(write_convert_.data(), buffer, samples);
+        return Write(write_convert_.data(), frames);
+    }
+
+    // 带元数据的读取：从 pool 取一帧，Read 读入 frames 帧（每声道）后填好格式、采集时间戳
+    // （后端有硬件时间戳时为第一帧的采集时刻，否则为读出时刻）和序号
+    // （每次成功读取加一，失败后的下一帧带 kFrameDiscontinuity）。读取失败、池已空或帧容量不足时返回空帧
+    MediaFrame ReadFrame(FramePool& pool, size_t frames) {
+        const int channels = CaptureChannels();
+        const size_t samples = frames * channels;
+        FrameRef ref = pool.FrameSamples() >= samples ? pool.Acquire() : FrameRef();
+        if (!ref) {
+            capture_discontinuity_ = true;
+            return MediaFrame();
+        }
+        if (!Read(ref->data, frames)) {
+            capture_discontinuity_ = true;
+            return MediaFrame();
+        }
+        ref->samples = samples;
+        const uint64_t captured_us = CaptureTimestampUs();
+        ref->timestamp_us = captured_us != 0 ? captured_us : SteadyNowUs();
+        MediaFrame frame = MediaFrame::FromPool(MediaKind::Pcm, std::move(ref), samples);
+        frame.sample_rate = SampleRate();
+        frame.channels = channels;
+        frame.sequence = capture_sequence_++;
+        if (capture_discontinuity_) {
+            frame.flags |= kFrameDiscontinuity;
+            capture_discontinuity_ = false;
+        }
+        return frame;
+    }
+
+    // 带元数据的写入：播放一个 PCM 帧（视图或池中的帧），声道数须与设备一致
+    bool WriteFrame(const MediaFrame& frame) {
+        if (!frame || frame.kind != MediaKind::Pcm || frame.channels != Channels()) {
+            return false;
+        }
+        return Write(const_cast<short*>(frame.Pcm()), frame.Frames());
+    }
+
+    // Record/Play 等非零拷贝路径上的临时缓冲区从该池取帧，不在栈上或堆上另行分配；
+    // 须在 Record/Play 之前设置，池的帧长不小于一个周期（frame_size × channels）
+    void SetFramePool(FramePool* pool) { frame_pool_ = pool; }
+
+protected:
+    // 从帧池取一个至少 samples 个样本的缓冲区；没有设置帧池、帧长不够或池已空时使用 fallback
+    // （调用方预先分配的缓冲区），返回的句柄在使用期间必须保持存活
+    short* AcquireScratch(size_t samples, FrameRef* frame, std::vector<short>* fallback) {
+        if (frame_pool_ != nullptr && frame_pool_->FrameSamples() >= samples) {
+            *frame = frame_pool_->Acquire();
+            if (*frame) {
+                (*frame)->samples = samples;
+                return (*frame)->data;
+            }
+        }
+        fallback->resize(samples);
+        return fallback->data();
+    }
+
+    FramePool* frame_pool_ = nullptr;
+
+private:
+    std::vector<short> read_convert_;   // ReadFloat 的 int16 中转（仅采集线程）
+    std::vector<short> write_convert_;  // WriteFloat 的 int16 中转（仅播放线程）
+    uint64_t capture_sequence_ = 0;     // 仅采集线程
+    bool capture_discontinuity_ = false;
+};
+
+// 音频后端。PipeWire / PulseAudio 需在构建时找到对应的开发库（LINX_PIPEWIRE / LINX_PULSEAUDIO）
+enum class AudioBackend : uint8_t {
+    Auto = 0,    // 运行时选择：PipeWire 守护进程在运行时用 PipeWire，否则 PulseAudio，否则 ALSA；macOS 为 PortAudio
+    Alsa,        // ALSA "default" 设备（桌面发行版上通常经 pulse/pipewire 插件转发）
+    PipeWire,
+    PulseAudio,
+    PortAudio,   // 仅 macOS
+    Null,        // 无声卡：按设备时钟采集静音（或循环一个文件），丢弃播放数据；用于容器中的压测和长稳测试
+    Sink,        // 同 Null，另外记录播放时序（Write 间隔、阻塞时长、缓冲余量、欠载）并定期打印
 };
 
-// Factory function to create platform-specific audio implementation
-std::unique_ptr<AudioInterface> CreateAudioInterface();
+// auto/alsa/pipewire/pulse/portaudio/null/sink
+const char* AudioBackendName(AudioBackend backend);
+// 无法识别时返回 false 且不修改 *backend
+bool ParseAudioBackend(const std::string& name, AudioBackend* backend);
+// 该后端是否编译进来
+bool AudioBackendBuilt(AudioBackend backend);
+// Auto 的选择结果：检查各守护进程的 socket 是否存在，不建立连接
+AudioBackend DetectAudioBackend();
+
+// 按 SetDevice 的规则在 devices 中查找 spec：序号或名称片段（不区分大小写），且设备有所需的方向；
+// 返回 devices 中的下标，找不到时返回 -1（"default" 和后端设备名由调用方先行处理）
+int FindAudioDevice(const std::vector<AudioDeviceInfo>& devices, const std::string& spec, bool capture);
+
+// 创建平台相关的音频接口实例；请求的后端没有编译进来时警告并改用 Auto 的选择结果。
+// Null/Sink 返回 FileAudio（实时模式），capture_loop 为其循环采集的 WAV/Opus 文件，为空时采集静音；其他后端忽略
+std::unique_ptr<AudioInterface> CreateAudioInterface(AudioBackend backend = AudioBackend::Auto,
+                                                     const std::string& capture_loop = std::string());
 
 }  // namespace linx
\ No newline at end of file
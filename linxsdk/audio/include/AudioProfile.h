@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+
+namespace linx {
+
+// 延迟模式
+enum class LatencyMode {
+    Normal,  // 60ms 帧，带宽和 CPU 占用最低
+    Low,     // 20ms 帧，端到端延迟最低
+};
+
+// 音频流水线的帧时长、设备周期、Opus 帧长和 hello 参数统一由这一个配置推导，
+// 采集/播放/编码/协商各处不再各自写死常量
+struct AudioProfile {
+    LatencyMode mode = LatencyMode::Normal;
+    unsigned int sample_rate = 16000;  // 采样率
+    int channels = 1;                  // 声道数
+    int frame_ms = 60;                 // Opus 帧时长，同时是 hello 中的 frame_duration
+    int period_ms = 20;                // 设备周期时长，frame_ms 是它的整数倍
+    int periods = 6;                   // 设备缓冲区包含的周期数（缓冲区容纳两帧）
+
+    static AudioProfile ForMode(LatencyMode mode, unsigned int sample_rate = 16000, int channels = 1) {
+        AudioProfile profile;
+        profile.mode = mode;
+        profile.sample_rate = sample_rate;
+        profile.channels = channels;
+        if (mode == LatencyMode::Low) {
+            profile.frame_ms = 20;
+            profile.period_ms = 10;
+            profile.periods = 4;
+        }
+        return profile;
+    }
+
+    // "low"/"normal"，无法识别时返回 false 且不修改 *mode
+    static bool ParseMode(const std::string& name, LatencyMode* mode) {
+        if (name == "low") {
+            *mode = LatencyMode::Low;
+            return true;
+        }
+        if (name == "normal") {
+            *mode = LatencyMode::Normal;
+            return true;
+        }
+        return false;
+    }
+
+    const char* ModeName() const { return mode == LatencyMode::Low ? "low" : "normal"; }
+
+    // 每帧样本数（每声道）
+    int FrameSamples() const { return static_cast<int>(sample_rate) * frame_ms / 1000; }
+
+    // 设备周期大小（帧数），与 Opus 帧对齐
+    int PeriodSize() const { return static_cast<int>(sample_rate) * period_ms / 1000; }
+
+    // 设备缓冲区大小（帧数）
+    int BufferSize() const { return PeriodSize() * periods; }
+
+    // 播放端建议的最小/初始抖动缓冲延迟
+    int MinJitterDelayMs() const { return mode == LatencyMode::Low ? 2 * frame_ms : 60; }
+    int InitialJitterDelayMs() const { return mode == LatencyMode::Low ? 3 * frame_ms : 120; }
+};
+
+}  // namespace linx
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace linx {
+
+// 音频分接的两路流
+enum class TapStream : uint8_t {
+    Capture = 0,  // 采集帧（回声消除、降噪、自动增益之后，编码之前）
+    Playout = 1,  // 写入播放设备的混音结果（TTS 与提示音）
+};
+
+constexpr size_t kTapStreams = 2;
+
+// 共享内存布局（同一台机器上的进程共享，与写入进程同一 ABI）：4096 字节文件头，之后每路流一个槽位环。
+// 每个槽位：AudioTapSlot 头，之后是 slot_samples 个 16-bit 交错样本，按 64 字节对齐。
+// 写入端每路流只有一个线程，发布第 seq 帧时先写 begin = seq + 1，再写数据，最后写 end = seq + 1；
+// 读取端看到 end == seq + 1 后直接读映射内存中的数据（不拷贝），用完检查 begin 仍为 seq + 1，
+// 不等说明这期间槽位已被新帧覆盖（读得太慢），数据作废
+constexpr char kAudioTapMagic[8] = {'L', 'I', 'N', 'X', 'T', 'A', 'P', '\0'};
+constexpr uint32_t kAudioTapVersion = 1;
+constexpr uint32_t kTapSilence = 1u;  // 帧标志：这段时间播放的是静音，不带样本数据
+
+struct AudioTapStreamHeader {
+    std::atomic<uint64_t> head;      // 已发布的帧数（下一帧的序号）
+    std::atomic<uint32_t> notify;    // 每发布一帧加一；Linux 上读取端以 futex 等待这个字
+    std::atomic<uint32_t> waiters;   // 正在等待的读取端数，为 0 时发布不做系统调用
+    uint64_t offset;                 // 槽位环在共享内存中的偏移
+    uint32_t slots;
+    uint32_t slot_samples;           // 每个槽位最多的样本数（交错）
+    uint32_t slot_stride;            // 相邻槽位的字节距离
+    uint32_t sample_rate;
+    uint32_t channels;
+    uint32_t reserved;
+};
+
+struct AudioTapHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t streams;
+    uint64_t pid;
+    uint64_t size;                   // 共享内存总字节数
+    std::atomic<uint32_t> closed;    // 写入端已关闭（进程退出），读取端应重新打开
+    uint32_t reserved;
+    alignas(64) AudioTapStreamHeader stream[kTapStreams];
+};
+
+struct AudioTapSlot {
+    std::atomic<uint64_t> begin;     // 正在写入 / 已写入的帧序号 + 1
+    std::atomic<uint64_t> end;       // 写完的帧序号 + 1
+    uint64_t time_us;                // steady_clock（CLOCK_MONOTONIC）微秒：采集帧为读出时刻，播放帧为写入设备时刻
+    uint64_t position;               // 这一帧第一个样本在这路流中的位置（每声道样本数）
+    uint32_t samples;                // 样本数（交错）
+    uint32_t flags;                  // kTapSilence 等
+    uint64_t reserved;
+};
+
+static_assert(sizeof(AudioTapHeader) <= 4096, "audio tap header layout");
+static_assert(sizeof(AudioTapSlot) == 48, "audio tap slot layout");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "audio tap atomics must be lock-free to be shared");
+
+struct AudioTapStreamConfig {
+    unsigned int sample_rate = 16000;
+    int channels = 1;
+    size_t slot_samples = 960;  // 一帧最多的样本数（交错），更长的帧拆成多个槽位
+};
+
+struct AudioTapConfig {
+    std::string name = "/linx-audio-tap";  // POSIX 共享内存名（Linux 上为 /dev/shm/linx-audio-tap）
+    size_t slots = 128;                    // 每路流的槽位数，读取端落后超过这么多帧时丢帧
+    unsigned int mode = 0640;              // 共享内存的权限：读取端需要写权限才能阻塞等待（否则轮询）
+    AudioTapStreamConfig stream[kTapStreams];
+};
+
+struct AudioTapStats {
+    uint64_t frames[kTapStreams] = {};  // 发布的槽位数
+    uint64_t wakeups = 0;               // 有读取端等待时的唤醒次数
+};
+
+// 音频分接发布端：把采集帧和播放帧连同时间戳写进 POSIX 共享内存中的无锁环，同一设备上的其他进程
+// （本地命令词识别、电平表界面等）用 AudioTapReader 直接映射读取，不需要另开 ALSA（dsnoop 增加延迟）、
+// 也不经过套接字拷贝，读取端数量不限、互不影响，也不会阻塞写入端。
+// Publish 只做一次 memcpy 和几次原子写，不分配内存；只有读取端在等待时才有一次 futex 唤醒。
+// 每路流只能由一个线程调用 Publish
+class AudioTap {
+public:
+    explicit AudioTap(const AudioTapConfig& config);
+    ~AudioTap();
+
+    AudioTap(const AudioTap&) = delete;
+    AudioTap& operator=(const AudioTap&) = delete;
+
+    // 创建（替换同名的）共享内存并预先触碰全部页面，失败返回 false
+    bool Open();
+    // 标记关闭并删除共享内存名，已打开的读取端映射仍有效；须在写入线程停止后调用
+    void Close();
+    bool IsOpen() const { return header_ != nullptr; }
+
+    // 发布一帧，pcm 为 nullptr 时发布一段静音（只记录时长，不写样本）
+    void Publish(TapStream stream, const short* pcm, size_t samples, uint64_t time_us);
+
+    AudioTapStats GetStats() const;
+    const std::string& Name() const { return config_.name; }
+
+private:
+    void PublishSlot(size_t index, const short* pcm, size_t samples, uint64_t time_us);
+
+    AudioTapConfig config_;
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    AudioTapHeader* header_ = nullptr;
+    unsigned char* base_ = nullptr;
+    uint64_t position_[kTapStreams] = {};  // 各路流已发布的每声道样本数（仅写入线程）
+    std::atomic<uint64_t> wakeups_{0};
+};
+
+// 读取端看到的一帧：指向共享内存，用完后以 AudioTapReader::Valid 确认没有被覆盖
+struct TapFrame {
+    const short* pcm = nullptr;  // 静音帧为 nullptr
+    size_t samples = 0;
+    uint64_t time_us = 0;
+    uint64_t position = 0;
+    uint32_t flags = 0;
+    uint64_t sequence = 0;
+};
+
+// 音频分接读取端：映射发布端的共享内存，按帧顺序读取。打开时从最新的一帧开始（实时分接），
+// 落后超过环的容量时跳到仍有效的最旧一帧并计入 Lost。每个读取端有自己的读取位置，可在任意进程打开
+class AudioTapReader {
+public:
+    AudioTapReader() = default;
+    ~AudioTapReader();
+
+    AudioTapReader(const AudioTapReader&) = delete;
+    AudioTapReader& operator=(const AudioTapReader&) = delete;
+
+    bool Open(const std::string& name = "/linx-audio-tap", std::string* error = nullptr);
+    void Close();
+    bool IsOpen() const { return header_ != nullptr; }
+    // 发布端已关闭（进程退出或重启），需要重新 Open
+    bool Closed() const;
+
+    unsigned int SampleRate(TapStream stream) const { return Stream(stream).sample_rate; }
+    int Channels(TapStream stream) const { return static_cast<int>(Stream(stream).channels); }
+
+    // 取出下一帧，没有新帧时返回 false
+    bool Next(TapStream stream, TapFrame* frame);
+    // 用完 frame 的数据之后调用：返回 false 表示读取期间槽位已被覆盖，数据不可用
+    bool Valid(TapStream stream, const TapFrame& frame) const;
+    // 等待这路流有新帧，最多 timeout_ms 毫秒；有新帧时返回 true。
+    // 只读打开（没有共享内存的写权限）或非 Linux 系统上以 2ms 间隔轮询
+    bool Wait(TapStream stream, int timeout_ms);
+
+    uint64_t Lost(TapStream stream) const { return lost_[static_cast<size_t>(stream)]; }
+
+private:
+    const AudioTapStreamHeader& Stream(TapStream stream) const { return header_->stream[static_cast<size_t>(stream)]; }
+    const AudioTapSlot* Slot(TapStream stream, uint64_t sequence) const;
+
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    bool writable_ = false;
+    AudioTapHeader* header_ = nullptr;
+    const unsigned char* base_ = nullptr;
+    uint64_t next_[kTapStreams] = {};
+    uint64_t lost_[kTapStreams] = {};
+};
+
+}  // namespace linx
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace linx {
+
+// 时钟漂移补偿配置
+struct DriftCompensatorConfig {
+    unsigned int sample_rate = 16000;
+    int channels = 1;
+    size_t max_period_samples = 4096;       // 单次 Pull 的最大样本数（交错），插值历史按此一次性分配
+    double max_ppm = 500;                   // 校正量上限（±百万分之一）；0.05% 的速度/音高变化听不出来
+    double drift_limit_ppm = 300;           // 时钟偏差估计（积分项）上限，晶振偏差通常在 ±100ppm 以内
+    double smoothing_s = 2.0;               // 深度误差低通的时间常数，滤掉逐包到达的抖动
+    double proportional_ppm_per_ms = 10.0;  // 比例项：每毫秒深度误差对应的校正量（闭环时间常数约 100 秒）
+    double integral_s = 200;                // 积分时间：持续的误差按此速度累积为时钟偏差估计（阻尼约 0.7）
+    double deadband_ms = 2;                 // |误差| 小于此值时比例项为 0，积分照常
+    double integral_window_ms = 100;        // |误差| 超过此值时不积分：服务端快于实时下发造成的堆积不是时钟偏差
+};
+
+// 时钟漂移补偿统计
+struct DriftCompensatorStats {
+    double correction_ppm = 0;   // 当前校正量，正数为比名义速率更快地消耗缓冲
+    double drift_ppm = 0;        // 估计的时钟偏差（积分项）
+    double depth_error_ms = 0;   // 平滑后的缓冲深度与目标之差
+    int64_t adjusted_frames = 0;  // 累计多消耗（正）或少消耗（负）的输入帧数
+    uint64_t updates = 0;        // 播放中参与估计的 Update 次数
+};
+
+// 播放端时钟漂移补偿：设备时钟与服务端节奏存在几十 ppm 的偏差，长时间连续播放时抖动缓冲区会慢慢变深或被取空。
+// Update 把缓冲深度与目标之差低通后送入 PI 控制器，积分项收敛到两个时钟的偏差；
+// Pull 按得到的速率比（1 + 校正量）以四点三次插值从数据源重采样，每个输出帧比名义多或少消耗一点输入，
+// 深度回到目标附近并长期保持。校正量最大 0.05%，插值是连续的，没有插入/删除样本那样的咔嗒声；
+// 速率比为 1 且相位为 0 时输出与输入逐样本相同。
+// Pull / Update / Reset 只在播放线程调用，GetStats 可在任意线程调用
+class DriftCompensator {
+public:
+    // 数据源：最多向 out 写入 samples 个样本（交错），返回实际写入数
+    using Source = std::function<size_t(short* out, size_t samples)>;
+
+    DriftCompensator(const DriftCompensatorConfig& config, Source source);
+
+    DriftCompensator(const DriftCompensator&) = delete;
+    DriftCompensator& operator=(const DriftCompensator&) = delete;
+
+    // 从数据源取数据，按当前速率比输出最多 samples 个样本；数据源供不上（缓冲中、段尾）时返回更少，
+    // 并把插值历史中剩下的帧原样输出，不留到下一段开头
+    size_t Pull(short* out, size_t samples);
+
+    // 报告当前缓冲深度与目标（毫秒），dt_s 为距上次报告的时间；
+    // playing 为 false（缓冲中、段间）时不更新估计，下一次开始播放时误差重新起算
+    void Update(double depth_ms, double target_ms, double dt_s, bool playing);
+
+    // 打断播放时调用：丢弃插值历史（至多几帧），保留时钟偏差估计
+    void Reset();
+
+    double Ratio() const { return ratio_; }
+
+    DriftCompensatorStats GetStats() const;
+
+private:
+    // 四点三次（Catmull-Rom）插值：t 位于 x1 与 x2 之间，t = 0 时结果就是 x1
+    static short Interpolate(short x0, short x1, short x2, short x3, float t);
+    // 把历史中位置 [1, hist_frames_) 的帧原样输出到 out，最多 frames 帧
+    size_t FlushHistory(short* out, size_t frames);
+
+    DriftCompensatorConfig config_;
+    Source source_;
+    size_t channels_ = 1;
+    size_t max_frames_ = 0;
+
+    // 插值历史：hist_[0] 为当前帧的前一帧，当前输出位置在 hist_[1] 之后 pos_ 帧
+    std::vector<short> hist_;
+    size_t hist_frames_ = 1;
+    double pos_ = 0;
+    double ratio_ = 1.0;
+
+    // 控制器状态（仅播放线程）
+    bool was_playing_ = false;
+    double error_ms_ = 0;
+    double drift_ppm_ = 0;
+
+    std::atomic<double> correction_ppm_{0};
+    std::atomic<double> drift_ppm_out_{0};
+    std::atomic<double> error_ms_out_{0};
+    std::atomic<int64_t> adjusted_frames_{0};
+    std::atomic<uint64_t> updates_{0};
+};
+
+}  // namespace linx
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AudioInterface.h"
+#include "FileStream.h"
+#include "LatencyHistogram.h"
+#include "LockProfiler.h"
+
+namespace linx {
+
+// 文件音频后端配置
+struct FileAudioConfig {
+    std::string capture_path;   // 采集输入 WAV（16-bit PCM，采样率/声道数不同时加载时转换）或 Ogg/Opus
+                                // （.opus/.ogg，如 SessionRecorder 的录音，加载时解码）；为空时采集静音
+    std::string playback_path;  // 播放输出 WAV；为空时丢弃播放数据
+    bool realtime = true;       // true：按设备时钟节奏阻塞；false：不等待，尽快完成
+    bool loop = false;          // 输入播完后从头循环，否则之后一直采集到静音
+    bool playout_timing = false;       // 实时模式下记录每次 Write 的调用间隔、阻塞时长和写入时的缓冲余量
+    unsigned int report_interval_ms = 0;  // >0 时每隔这么久打印一次播放时序汇总（需 playout_timing）
+};
+
+// 文件音频统计
+struct FileAudioStats {
+    uint64_t captured_frames = 0;   // 已采集的帧数（含输入结束后的静音）
+    uint64_t played_frames = 0;     // 已写入输出文件的帧数（含欠载补的静音）
+    uint64_t padded_frames = 0;     // 播放欠载补的静音帧数
+    uint64_t dropped_frames = 0;    // DropPlayback 丢弃的帧数
+    uint64_t underruns = 0;         // 欠载次数（连续补静音算一次）
+    // 以下仅 playout_timing 时有效
+    uint64_t writes = 0;                 // Write 调用次数
+    uint64_t min_buffered_frames = 0;    // 开始播放后 Write 进入时虚拟缓冲区中的最少帧数（0 即已欠载）
+    LatencySummary write_interval;       // 相邻两次 Write 进入的间隔
+    LatencySummary write_block;          // Write 因缓冲区满而阻塞的时长
+};
+
+// 以 WAV 文件代替麦克风和扬声器的 AudioInterface，用于在构建机上确定性地回放整条流水线。
+// 实时模式模拟一个按 steady_clock 运行的设备：Read 按采样率节奏阻塞；Write 写入容量为 buffer_size 帧的
+// 虚拟播放缓冲区，数据按设备时钟“播出”到输出文件，缓冲区变空时补静音（计为欠载），
+// 因此输出文件的第 n 个样本就是第 n 个样本时刻扬声器发出的声音，与输入文件在同一时间轴上，
+// 可直接对比计算端到端延迟。快速模式下 Read/Write 都不等待，播放数据按写入顺序直接落盘（不补静音，
+// GetPlaybackDelay 始终报告缓冲区已满），用于测量吞吐和 CPU 开销。
+// 两个路径都为空时即无声卡环境下的空设备（AudioBackend::Null / Sink），按设备时钟采集静音、丢弃播放数据。
+class FileAudio : public AudioInterface {
+public:
+    explicit FileAudio(const FileAudioConfig& config);
+    ~FileAudio() override;
+
+    FileAudio(const FileAudio&) = delete;
+    FileAudio& operator=(const FileAudio&) = delete;
+
+    // 加载输入文件、创建输出文件；失败时抛出 std::runtime_error
+    void Init() override;
+    void SetConfig(unsigned int sample_rate, int frame_size, int channels, int periods, int buffer_size,
+                   int period_size) override;
+    bool Read(short* buffer, size_t frame_size) override;
+    bool Write(short* buffer, size_t frame_size) override;
+    // 启动设备时钟（Record/Play 中先调用的一个生效，两者共用同一时间起点）
+    void Record() override;
+    void Play() override;
+
+    long GetPlaybackDelay() override;
+    bool DropPlayback() override;
+    AudioXrunStats GetXrunStats() const override;
+    unsigned int SampleRate() const override { return sample_rate_; }
+    int Channels() const override { return channels_; }
+
+    // 输入文件已全部采集（循环模式下始终为 false）
+    bool CaptureDone() const;
+    // 输入文件时长（帧，已转换到设备采样率）
+    size_t CaptureFrames() const { return capture_.size() / channels_; }
+
+    // 把虚拟缓冲区中剩余的数据全部写出并补全 WAV 头，析构时自动调用
+    void Close();
+
+    FileAudioStats GetStats() const;
+
+private:
+    void StartClock();
+    uint64_t NowFrames() const;
+    void WaitUntilFrame(uint64_t frame) const;
+    void LoadCapture();
+    void LoadOpusCapture();
+    // 转换好声道的输入按需重采样到设备采样率，存为 capture_
+    void SetCapture(std::vector<short> converted, unsigned int src_rate);
+    // 把设备时钟已经走过的数据写出到文件（加锁调用）
+    void AdvancePlayback(uint64_t now);
+    void WriteOut(const short* pcm, size_t frames);
+    void WriteSilence(size_t frames);
+    // 按 report_interval_ms 打印播放时序汇总（不持锁调用）
+    void ReportPlayoutTiming();
+
+    FileAudioConfig config_;
+    unsigned int sample_rate_ = 16000;
+    int channels_ = 1;
+    size_t buffer_frames_ = 0;  // 虚拟播放缓冲区容量
+
+    std::atomic<bool> started_{false};
+    std::chrono::steady_clock::time_point start_;
+    std::once_flag start_once_;
+
+    // 采集：整段输入预先转换到设备格式
+    std::vector<short> capture_;
+    std::atomic<uint64_t> captured_{0};
+
+    // 播放：queue_ 为尚未播出的数据（环形），played_ 为已写入输出文件的帧数，即输出文件的时间轴
+    mutable ProfiledMutex playback_mutex_{"file_playback"};
+    FileStream output_;
+    bool output_open_ = false;
+    std::vector<short> queue_;
+    size_t queue_head_ = 0;   // 帧
+    size_t queue_count_ = 0;  // 帧
+    uint64_t played_ = 0;
+    bool has_played_ = false;
+    bool starving_ = false;  // 正在补静音（欠载中）
+    std::vector<short> silence_;
+    uint64_t padded_ = 0;
+    uint64_t dropped_ = 0;
+    uint64_t underruns_ = 0;
+
+    // 播放时序（playout_timing）
+    LatencyHistogram write_interval_us_;
+    LatencyHistogram write_block_us_;
+    std::chrono::steady_clock::time_point last_write_;
+    std::chrono::steady_clock::time_point last_report_;
+    uint64_t writes_ = 0;
+    uint64_t min_buffered_ = UINT64_MAX;
+};
+
+}  // namespace linx
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "MemoryAccounting.h"
+
+namespace linx {
+
+class FramePool;
+
+// 池中的一帧音频：样本缓冲区在 FramePool 构造时一次性分配，帧本身不拥有内存
+struct AudioFrame {
+    short* data = nullptr;
+    size_t capacity = 0;    // 缓冲区容量（样本数）
+    size_t samples = 0;     // 有效样本数（交错），由写入方设置
+    uint64_t timestamp_us = 0;  // 可选：采集/接收时刻（LatencyTracer::NowUs）
+
+private:
+    friend class FramePool;
+    friend class FrameRef;
+
+    FramePool* pool = nullptr;
+    std::atomic<uint32_t> refs{0};
+    std::atomic<uint32_t> next{0};  // 空闲链表中的下一帧编号
+};
+
+// 帧的引用计数句柄：拷贝增加引用、析构减少引用，最后一个引用释放时帧回到池中。
+// 句柄本身不是线程安全的，但同一帧的不同句柄可以分别在不同线程上拷贝和释放
+// （例如采集线程保留一份、把另一份交给网络线程），引用计数为原子操作。
+class FrameRef {
+public:
+    FrameRef() = default;
+    FrameRef(const FrameRef& other) : frame_(other.frame_) {
+        if (frame_ != nullptr) {
+            frame_->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    FrameRef(FrameRef&& other) noexcept : frame_(other.frame_) { other.frame_ = nullptr; }
+    FrameRef& operator=(FrameRef other) noexcept {
+        std::swap(frame_, other.frame_);
+        return *this;
+    }
+    ~FrameRef() { Reset(); }
+
+    void Reset();
+
+    explicit operator bool() const { return frame_ != nullptr; }
+    AudioFrame* operator->() const { return frame_; }
+    AudioFrame& operator*() const { return *frame_; }
+    AudioFrame* get() const { return frame_; }
+    // 当前引用数（仅供诊断，其他线程可能同时改变）
+    uint32_t UseCount() const { return frame_ != nullptr ? frame_->refs.load(std::memory_order_relaxed) : 0; }
+
+private:
+    friend class FramePool;
+    explicit FrameRef(AudioFrame* frame) : frame_(frame) {}
+
+    AudioFrame* frame_ = nullptr;
+};
+
+struct FramePoolStats {
+    uint64_t acquired = 0;    // 成功取出的帧数
+    uint64_t exhausted = 0;   // 池已空、Acquire 返回空句柄的次数
+    size_t in_use = 0;        // 当前被引用的帧数
+    size_t high_water = 0;    // 同时被引用的最大帧数
+    size_t frames = 0;        // 池容量（帧数）
+};
+
+// 定长音频帧池：所有帧的样本缓冲区在构造时一次性分配（按 cache line 对齐），
+// 空闲帧组成无锁链表（Treiber 栈，表头带版本号防 ABA），任意线程都可以 Acquire 和释放，
+// 稳态不分配内存、不加锁。帧在采集、编解码、网络、播放之间以 FrameRef 传递，不拷贝样本。
+// 池必须比从它取出的所有帧活得长
+class FramePool {
+public:
+    FramePool(size_t frames, size_t samples_per_frame);
+    ~FramePool() = default;
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // 取出一帧（samples 清零，引用数为 1）；池已空时返回空句柄并计入 exhausted，调用方自行降级
+    FrameRef Acquire();
+
+    size_t Frames() const { return count_; }
+    size_t FrameSamples() const { return samples_per_frame_; }
+
+    FramePoolStats GetStats() const;
+
+private:
+    friend class FrameRef;
+
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    void Release(AudioFrame* frame);
+    static uint64_t Pack(uint32_t tag, uint32_t index) { return (static_cast<uint64_t>(tag) << 32) | index; }
+
+    size_t count_;
+    size_t samples_per_frame_;
+    size_t stride_;  // 相邻两帧缓冲区之间的样本数（对齐到 cache line）
+    TaggedArray<short, MemoryTag::Audio> storage_;
+    TaggedArray<AudioFrame, MemoryTag::Audio> frames_;
+    std::atomic<uint64_t> head_;  // 高 32 位版本号，低 32 位空闲链表首帧编号
+
+    std::atomic<uint64_t> acquired_{0};
+    std::atomic<uint64_t> exhausted_{0};
+    std::atomic<size_t> in_use_{0};
+    std::atomic<size_t> high_water_{0};
+};
+
+inline void FrameRef::Reset() {
+    if (frame_ != nullptr) {
+        if (frame_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            frame_->pool->Release(frame_);
+        }
+        frame_ = nullptr;
+    }
+}
+
+}  // namespace linx
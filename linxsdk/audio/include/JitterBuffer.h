@@ -0,0 +1,235 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "FrameTrace.h"
+#include "LatencyTracer.h"
+#include "PcmRing.h"
+
+namespace linx {
+
+// 抖动缓冲区配置
+struct JitterBufferConfig {
+    unsigned int sample_rate = 16000;  // 采样率
+    int channels = 1;                  // 声道数
+    int min_delay_ms = 60;             // 最小播放延迟
+    int max_delay_ms = 600;            // 目标延迟上限
+    bool trim_to_max_delay = false;    // 缓冲超过 max_delay_ms 时丢弃最旧数据（TTS 常快于实时下发，默认关闭）
+    int initial_delay_ms = 120;        // 初始目标延迟
+    int start_threshold_ms = 0;        // 每次开始播放（一段 TTS 的开头、欠载后重新缓冲）前至少攒够的解码音频，
+                                       // 与自适应目标延迟取较大者；0 表示只按目标延迟
+    int spurt_gap_ms = 500;            // 到达间隔超过该值视为新的一段 TTS，不计入抖动
+    int max_conceal_ms = 120;          // 单次断流最多隐藏的时长，超过后按欠载处理
+    size_t capacity_samples = 1 << 19;  // 底层环形缓冲区容量（样本数）
+    int max_start_skip_ms = 200;       // 定时开始（ScheduleStart）迟到时，不超过该时长的部分直接跳过以对齐，超过则放弃对齐
+};
+
+// 抖动缓冲区统计
+struct JitterBufferStats {
+    uint64_t frames_in = 0;       // 收到的帧数
+    uint64_t late_frames = 0;     // 到达时播放端已经欠载的帧数
+    uint64_t dropped_samples = 0;  // 因超过最大延迟或缓冲区满而丢弃的样本数
+    uint64_t underruns = 0;       // 播放中途缓冲区被取空的次数
+    uint64_t drained = 0;         // 缓冲区正常播完的段数（不算欠载）
+    uint64_t concealed_samples = 0;  // 由丢包隐藏生成的样本数
+    uint64_t flushes = 0;         // Flush 打断次数
+    uint64_t flushed_samples = 0;  // 被 Flush 丢弃的样本数
+    int target_delay_ms = 0;      // 当前目标延迟
+    double jitter_ms = 0;         // 平滑后的到达抖动估计
+    size_t depth_samples = 0;     // 当前缓冲深度
+    uint64_t scheduled_starts = 0;  // 按 ScheduleStart 的时刻开始播放的段数（含迟到后跳过对齐的）
+    uint64_t late_starts = 0;       // 其中迟到、跳过开头对齐的段数
+    uint64_t missed_starts = 0;     // 迟到超过 max_start_skip_ms、放弃对齐的段数
+};
+
+// TTS 播放自适应抖动缓冲区
+// 生产者（WebSocket 接收线程）调用 Push 或 WriteRegion/CommitWrite，消费者（播放线程）调用 Pop。
+// 目标深度按 RFC 3550 方式估计到达抖动并在 [min_delay_ms, max_delay_ms] 范围内自适应，
+// 缓冲区先攒到目标深度再开始播放，播放中被取空则回到缓冲状态。
+class JitterBuffer {
+public:
+    explicit JitterBuffer(const JitterBufferConfig& config = JitterBufferConfig());
+
+    JitterBuffer(const JitterBuffer&) = delete;
+    JitterBuffer& operator=(const JitterBuffer&) = delete;
+
+    // 生产者：写入一帧解码后的 PCM，返回实际写入的样本数
+    size_t Push(const short* pcm, size_t samples);
+    size_t Write(const short* pcm, size_t samples) { return Push(pcm, samples); }  // 与 PcmRing 一致的写入接口
+
+    // 生产者零拷贝写入：借用一段连续可写区域，写入后 CommitWrite 提交（计为一次到达）
+    short* WriteRegion(size_t* contiguous) { return ring_.WriteRegion(contiguous); }
+    void CommitWrite(size_t samples);
+
+    // 生产者：下一次 Push / CommitWrite 的帧的网络到达时间（LatencyTracer::NowUs 时钟），用来估计到达抖动。
+    // 包以压缩形式排队、临近播放才解码时，写入时间只反映解码的节奏，须用包到达接收线程的时间；只对下一帧有效
+    void SetArrivalTime(uint64_t arrival_us) { arrival_us_ = arrival_us; }
+
+    // 定时开始（多设备同步播放）：下一段开始播放时，第一个样本在 start_us（LatencyTracer::NowUs 时钟）从扬声器播出。
+    // 到时之前 Ready 为 false、Pop 返回 0；到时所在的一次 Pop 先补静音到 start_us 再接上数据，精确到样本。
+    // 到时还没攒够起播门限而迟到时跳过迟到的部分，与其他设备对齐；迟到超过 max_start_skip_ms 时放弃对齐从头播放。
+    // 任意线程调用，0 取消；只作用于下一段，开始播放时清除
+    void ScheduleStart(uint64_t start_us) { start_at_us_.store(start_us, std::memory_order_release); }
+    uint64_t ScheduledStart() const { return start_at_us_.load(std::memory_order_acquire); }
+    // 距离定时开始就绪（到时落入下一次 Pop）还有多久（微秒），已就绪为 0；没有定时开始时为 UINT64_MAX。
+    // 消费者据此限制空闲等待，不会睡过开始的时刻
+    uint64_t UsUntilStart() const;
+    // 消费者：此刻写入设备的样本还要多久才从扬声器播出（设备缓冲中排队的时长，通常由 snd_pcm_delay 换算），
+    // 定时开始按它提前取出数据。每次 Pop 之前更新
+    void SetOutputDelay(uint64_t delay_us) { output_delay_us_.store(delay_us, std::memory_order_relaxed); }
+
+    // 消费者：最多取出 samples 个样本，返回实际取出的数量
+    // 缓冲中（未达到目标深度）时返回 0，由调用方决定是否补静音
+    size_t Pop(short* out, size_t samples);
+
+    // 丢包隐藏回调：生成 samples 个外推样本（通常调用 OpusAudio::DecodeMissing），返回生成数量
+    using Concealer = std::function<size_t(short* out, size_t samples)>;
+    void SetConcealer(Concealer concealer) { concealer_ = std::move(concealer); }
+
+    // 记录每帧在缓冲区中的停留时间（LatencyStage::BufferResidence），须在开始收发数据之前设置
+    void SetLatencyTracer(std::shared_ptr<LatencyTracer> tracer) { tracer_ = std::move(tracer); }
+
+    // 每次写入/取出/欠载/隐藏记录到帧追踪文件（深度为样本数），须在开始收发数据之前设置
+    void SetFrameTrace(std::shared_ptr<FrameTrace> trace) { frame_trace_ = std::move(trace); }
+
+    // 消费者：播放中途断流且设备即将欠载时调用，用丢包隐藏代替硬静音。
+    // 返回生成的样本数；未设置隐藏回调、不在断流中或隐藏时长已超过上限时返回 0
+    size_t Conceal(short* out, size_t samples);
+
+    // 生产者：标记已写入的数据到此为一段的结尾（收到 tts stop，或一句的 sentence_end），
+    // 剩余数据无需等待目标深度即可播完；播到这里时缓冲区已取空则干净地结束本段（计入 drained），
+    // 不做丢包隐藏、不计欠载，之后的数据重新攒到起播门限。取到这里时后面已有数据则连续播放，标记作废
+    void MarkEndOfStream();
+
+    // 打断播放（如用户插话）：丢弃调用时刻之前写入的全部数据并回到缓冲状态，下一段重新估计到达基准。
+    // 任意线程可调用；实际丢弃由消费者下一次 Pop/Conceal 完成，调用之后写入的数据不受影响
+    void Flush() { FlushTo(ring_.WritePosition()); }
+    // 同 Flush，但只丢弃累计写入位置 position 之前的数据（如跳过一句、直接从下一句开头播放）
+    void FlushTo(size_t position);
+
+    // 在累计写入位置 position 处截断：消费者播到该位置即结束本段，不再取出之后的数据，
+    // 到达时缓冲区中剩余的数据全部丢弃（计入 flushed_samples）。任意线程可调用，Flush 会取消截断
+    void Truncate(size_t position);
+
+    // 累计写入/读取位置（样本数），用于把外部事件（如句子边界）对应到缓冲区中的数据
+    size_t WritePosition() const { return ring_.WritePosition(); }
+    size_t ReadPosition() const { return ring_.ReadPosition(); }
+
+    // 当前缓冲深度（样本数）
+    size_t Depth() const { return ring_.Size(); }
+
+    // 播放需要保持的缓冲深度（样本数）：播放中为目标延迟，缓冲中为开始播放的门限。
+    // 按需解码时生产者只在深度低于它加一个播放周期时再解码，其余数据以压缩形式留在上游
+    size_t WantedDepth() const;
+
+    // 当前目标延迟（毫秒）
+    int TargetDelayMs() const { return target_delay_ms_.load(std::memory_order_relaxed); }
+
+    bool Playing() const { return playing_.load(std::memory_order_relaxed); }
+
+    // 已写入的数据都已被取出、不在播放中（段尾已播完或从未开始），用于判断播放是否排空
+    bool Drained() const {
+        return ring_.Size() == 0 && !playing_.load(std::memory_order_relaxed) &&
+               !flush_pending_.load(std::memory_order_acquire);
+    }
+
+    // 消费者：下一次 Pop 是否能取到数据（正在播放，或已攒够目标深度/到达段尾）
+    bool Ready() const;
+
+    JitterBufferStats GetStats() const;
+
+    // 运行中调整目标延迟的范围和起播门限（任意线程调用，如重新加载设备配置），从下一帧到达起生效；
+    // 参数的校正与构造时相同。Config() 仍返回构造时的配置
+    void SetDelayLimits(int min_delay_ms, int max_delay_ms, int start_threshold_ms);
+
+    const JitterBufferConfig& Config() const { return config_; }
+
+private:
+    size_t MsToSamples(int ms) const;
+    size_t UsToSamples(uint64_t us) const;
+    // 消费者：丢弃最旧的 samples 个样本，返回实际丢弃的数量
+    size_t Skip(size_t samples);
+    // 消费者：定时开始时在 out 开头补的静音样本数，到时之前返回 samples（本次不开始）；迟到时跳过对齐
+    size_t ScheduledLead(short* out, size_t samples);
+    // 开始播放所需的缓冲深度：目标延迟与起播门限取较大者
+    size_t StartSamples() const;
+    void UpdateJitter(size_t samples);
+    void OnArrival(size_t samples);
+    void ApplyFlush();
+    // 消费者：截断位置之前最多还能取出的样本数（未截断时为 samples）；已到截断位置时丢弃剩余数据并结束本段
+    size_t ApplyTruncate(size_t samples);
+    // 段尾标记在读位置之后（尚有数据未播到段尾）
+    bool EndBuffered() const;
+    // 已播到段尾标记处
+    bool EndReached() const;
+    void FinishStream();
+    void PushMarker();
+    void PopMarkers(bool record);
+    void TraceFrame(TraceStage stage, size_t samples);
+
+    // 到达标记：一帧写完后的累计写入位置和到达时间，消费者读过该位置时记录停留时间。
+    // 固定大小的 SPSC 数组，满时新标记直接丢弃（只少记样本，不影响数据）
+    struct Marker {
+        size_t position;
+        uint64_t arrival_us;
+    };
+    static constexpr size_t kMarkers = 256;
+    std::shared_ptr<LatencyTracer> tracer_;
+    std::shared_ptr<FrameTrace> frame_trace_;
+    Marker markers_[kMarkers];
+    std::atomic<size_t> marker_head_{0};
+    std::atomic<size_t> marker_tail_{0};
+
+    JitterBufferConfig config_;
+    PcmRing ring_;
+
+    // 生产者侧状态
+    std::chrono::steady_clock::time_point last_arrival_;
+    std::chrono::steady_clock::time_point spurt_start_;
+    bool has_arrival_ = false;
+    double media_ms_ = 0;
+    double min_relative_ms_ = 0;
+    double jitter_ms_ = 0;
+    uint64_t arrival_us_ = 0;  // SetArrivalTime 给出的下一帧到达时间，0 表示按写入时间
+
+    // 消费者侧状态
+    Concealer concealer_;
+    bool gap_ = false;
+    size_t concealed_in_gap_ = 0;
+
+    // 跨线程共享状态
+    std::atomic<size_t> end_mark_{0};  // 段尾的累计写入位置 + 1，0 表示没有段尾标记
+    std::atomic<bool> flush_pending_{false};
+    std::atomic<bool> restart_spurt_{false};
+    std::atomic<size_t> flush_position_{0};
+    std::atomic<bool> truncate_pending_{false};
+    std::atomic<size_t> truncate_position_{0};
+    std::atomic<bool> playing_{false};
+    std::atomic<bool> starving_{false};
+    std::atomic<int> target_delay_ms_{0};
+    std::atomic<int> min_delay_ms_{0};
+    std::atomic<int> max_delay_ms_{0};
+    std::atomic<int> start_threshold_ms_{0};
+    std::atomic<double> jitter_snapshot_ms_{0};
+    std::atomic<uint64_t> frames_in_{0};
+    std::atomic<uint64_t> late_frames_{0};
+    std::atomic<uint64_t> dropped_samples_{0};
+    std::atomic<uint64_t> underruns_{0};
+    std::atomic<uint64_t> drained_{0};
+    std::atomic<uint64_t> concealed_samples_{0};
+    std::atomic<uint64_t> flushes_{0};
+    std::atomic<uint64_t> flushed_samples_{0};
+    std::atomic<uint64_t> start_at_us_{0};
+    std::atomic<uint64_t> output_delay_us_{0};
+    std::atomic<uint64_t> pop_window_us_{0};  // 最近一次 Pop 请求的时长，Ready 据此判断定时开始是否落在下一次 Pop 中
+    std::atomic<uint64_t> scheduled_starts_{0};
+    std::atomic<uint64_t> late_starts_{0};
+    std::atomic<uint64_t> missed_starts_{0};
+};
+
+}  // namespace linx
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "AudioInterface.h"
+
+namespace linx {
+
+// 回环延迟校准配置
+struct LatencyCalibrationConfig {
+    int chirp_ms = 200;          // 扫频信号时长
+    float start_hz = 300;        // 扫频起止频率（对数扫频），止频率不超过采样率的 0.45 倍
+    float end_hz = 4000;
+    float level_dbfs = -12;      // 扫频电平
+    int lead_ms = 100;           // 第一次扫频之前的静音（设备刚启动时的不稳定期）
+    int max_latency_ms = 500;    // 搜索范围：写入设备到采集回来的最大延迟，也是两次扫频之间的静音
+    int repeats = 3;             // 扫频次数，结果取中位数
+    float min_peak_ratio = 4;    // 相关峰与主瓣之外最大旁瓣之比的下限，低于时该次测量无效
+};
+
+// 一次校准的结果：时间都以应用的视角计，即样本交给 Write 的时刻到它的回声被 Read 读出的时刻
+struct LatencyCalibration {
+    bool valid = false;
+    double round_trip_ms = 0;    // 写入设备 -> 从采集读出的回环延迟（中位数）
+    double output_queue_ms = -1; // 写入扫频时设备报告的待播时长（GetPlaybackDelay），-1 表示后端无法获知
+    double echo_delay_ms = 0;    // 回环延迟中设备报告之外的部分：转换器/编解码芯片、声学路径和采集缓冲，
+                                 // 即按待播时长对齐的回声参考仍然超前于麦克风回声的时间
+    double spread_ms = 0;        // 各次测量的最大差值
+    double peak_ratio = 0;       // 各次测量中最差的峰旁瓣比
+    int measurements = 0;        // 有效的测量次数
+};
+
+// 生成电平为 level_dbfs 的对数扫频（首尾各 5ms 余弦渐变），sample_rate 下共 chirp_ms 毫秒
+std::vector<float> MakeCalibrationChirp(const LatencyCalibrationConfig& config, unsigned int sample_rate);
+
+// 在 capture[0, n) 中寻找 chirp[0, m) 的位置：逐个滞后做点积（DotF32，SIMD），取绝对值最大的相关峰，
+// 抛物线插值到亚样本。*lag 为峰所在的样本位置，*peak_ratio 为峰与主瓣（±2ms）之外最大旁瓣之比。
+// n < m 时返回 false
+bool FindChirp(const float* capture, size_t n, const float* chirp, size_t m, unsigned int sample_rate, double* lag,
+               double* peak_ratio);
+
+// 设备回环延迟校准：在一个线程上依次写入静音、扫频和静音，同时在调用线程上连续采集，按每次扫频写入的时刻
+// 在采集信号中找到它的回声，测得回环延迟。需要扬声器和麦克风在同一个声学空间（或硬件回环），
+// 扫频会被听到，约 lead_ms + repeats * (chirp_ms + max_latency_ms) + max_latency_ms 毫秒。
+// 须在 Init / Record / Play 之后、采集和播放线程启动之前调用；多声道采集只用第一个声道
+bool MeasureLoopbackLatency(AudioInterface& audio, const LatencyCalibrationConfig& config, LatencyCalibration* result,
+                            std::string* error = nullptr);
+
+// 按设备保存的校准结果：一个 JSON 文件，键为设备标识（调用方拼接设备名、采样率和缓冲配置，配置变了即重新校准）
+bool LoadLatencyCalibration(const std::string& path, const std::string& device_key, LatencyCalibration* result);
+// 写入（或替换）device_key 的结果，先写临时文件再改名
+bool SaveLatencyCalibration(const std::string& path, const std::string& device_key, const LatencyCalibration& result);
+
+}  // namespace linx
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "FramePool.h"
+#include "SteadyClock.h"
+
+namespace linx {
+
+enum class MediaKind : uint8_t {
+    Pcm,   // 交错 int16 PCM，size 为样本数（所有声道合计）
+    Opus,  // 一个 Opus 包，size 为字节数
+};
+
+// MediaFrame::flags 的位
+enum MediaFrameFlag : uint32_t {
+    kFrameSpeech = 1u << 0,         // VAD 判为语音（含拖尾和预录）
+    kFrameConcealed = 1u << 1,      // 由 PLC / FEC 补出，不是真实收到的数据
+    kFrameDiscontinuity = 1u << 2,  // 与上一帧不连续（前面有丢帧、设备重启、打断后的第一帧等）
+};
+
+// 在采集、编解码、网络、播放之间传递的一帧及其元数据。
+// 数据要么是借用的视图（owner 为空，data 只在当前调用期间有效，如 DMA 缓冲区、WebSocket 接收缓冲区），
+// 要么在池中的帧里（owner 持有引用，可保留、可跨线程，拷贝 MediaFrame 只增加引用）。
+// 时间戳、序号、格式和标志随帧一路传递，延迟追踪、抖动缓冲、按帧龄丢弃都直接读取，不必再旁路记录
+struct MediaFrame {
+    MediaKind kind = MediaKind::Pcm;
+    const void* data = nullptr;
+    size_t size = 0;
+    unsigned int sample_rate = 0;  // PCM 的采样率，Opus 包为解码后的采样率；0 表示未知
+    int channels = 1;
+    uint64_t timestamp_us = 0;     // 采集时刻（SteadyNowUs），下游各级原样继承
+    uint64_t sequence = 0;         // 源头分配的序号，编解码后保持不变
+    uint32_t flags = 0;            // MediaFrameFlag 的组合
+    FrameRef owner;
+
+    explicit operator bool() const { return data != nullptr; }
+    const short* Pcm() const { return static_cast<const short*>(data); }
+    const unsigned char* Bytes() const { return static_cast<const unsigned char*>(data); }
+    bool Owned() const { return static_cast<bool>(owner); }
+    bool Has(MediaFrameFlag flag) const { return (flags & flag) != 0; }
+    size_t SizeBytes() const { return kind == MediaKind::Pcm ? size * sizeof(short) : size; }
+    // PCM 的每声道样本数
+    size_t Frames() const { return kind == MediaKind::Pcm && channels > 0 ? size / channels : 0; }
+    // PCM 的时长（微秒），采样率未知时为 0
+    uint64_t DurationUs() const { return sample_rate > 0 ? Frames() * 1000000ull / sample_rate : 0; }
+    // 距采集时刻的时长，没有时间戳时为 0
+    uint64_t AgeUs(uint64_t now_us) const {
+        return timestamp_us != 0 && now_us > timestamp_us ? now_us - timestamp_us : 0;
+    }
+
+    // 继承上游帧的时间戳、序号和标志（编解码、重采样等产生新数据的阶段调用）
+    void InheritFrom(const MediaFrame& upstream) {
+        timestamp_us = upstream.timestamp_us;
+        sequence = upstream.sequence;
+        flags = upstream.flags;
+    }
+
+    static MediaFrame View(MediaKind kind, const void* data, size_t size, uint64_t timestamp_us = 0) {
+        MediaFrame frame;
+        frame.kind = kind;
+        frame.data = data;
+        frame.size = size;
+        frame.timestamp_us = timestamp_us;
+        return frame;
+    }
+    // 池中的帧：PCM 时 size 通常取 ref->samples；Opus 时负载按字节存放在帧缓冲区中，size 为字节数
+    static MediaFrame FromPool(MediaKind kind, FrameRef ref, size_t size) {
+        MediaFrame frame;
+        frame.kind = kind;
+        frame.data = ref->data;
+        frame.size = size;
+        frame.timestamp_us = ref->timestamp_us;
+        frame.owner = std::move(ref);
+        return frame;
+    }
+    // 把本帧（视图或池中的帧）拷贝进 pool 中新取的一帧，元数据原样保留；池已空或帧容量不足时返回空帧
+    MediaFrame CopyTo(FramePool& pool) const {
+        FrameRef ref = pool.Acquire();
+        size_t bytes = SizeBytes();
+        if (!ref || bytes > ref->capacity * sizeof(short)) {
+            return MediaFrame();
+        }
+        std::copy(Bytes(), Bytes() + bytes, reinterpret_cast<unsigned char*>(ref->data));
+        ref->samples = kind == MediaKind::Pcm ? size : (bytes + 1) / sizeof(short);
+        ref->timestamp_us = timestamp_us;
+        MediaFrame copy = FromPool(kind, std::move(ref), size);
+        copy.sample_rate = sample_rate;
+        copy.channels = channels;
+        copy.InheritFrom(*this);
+        return copy;
+    }
+};
+
+}  // namespace linx
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PcmRing.h"
+
+namespace linx {
+
+// 混音器的一路输入
+struct MixerStreamConfig {
+    std::string name;
+    float gain = 1.0f;          // 这一路的增益（线性），运行中可用 SetGain 调整
+    bool ducks_others = false;  // 这一路有声音时把其他不带该标记的流压到 duck_gain（如提示音压低 TTS）
+    size_t ring_samples = 0;    // >0 时为这一路分配输入环形缓冲区，生产者用 Write 写入
+};
+
+struct OutputMixerConfig {
+    size_t max_period_samples = 0;  // 单次 Mix 的最大样本数（交错），工作缓冲区按此一次性分配
+    float duck_gain = 0.3f;         // 被压低时的增益
+};
+
+struct OutputMixerStats {
+    uint64_t mixes = 0;          // Mix 调用次数
+    uint64_t mixed_periods = 0;  // 有两路及以上同时出声、实际做了混音的周期数
+    uint64_t ducked_periods = 0;  // 有流被压低的周期数
+    uint64_t clips_started = 0;   // Play 开始的片段数
+};
+
+// 输出混音器：把多路播放源（TTS、提示音、通知音等）混成一路，交给一次设备写入。
+// 每一路的来源可以是：拉取回调（如从抖动缓冲区取 TTS）、自带的 SPSC 输入环形缓冲区、
+// 或者事先登记的解码好的 PCM 片段（可循环播放）。各路按自己的增益缩放后用饱和加法（PcmKernels 的 SIMD 内核）叠加，
+// 带 ducks_others 的流出声时其余流在一个周期内平滑压低到 duck_gain。
+// 混音器本身不缓冲：每次 Mix 只取这一个周期的数据，不增加延迟；所有缓冲区、流和片段在开始播放前登记好，
+// Mix 及各流的 Write / Play / Stop / SetGain 不分配内存、不加锁。
+// AddStream / AddClip 只在开始播放之前调用；Mix 只在播放线程上调用；Write 由各流唯一的生产者调用；
+// Play / Stop / SetGain 可在任意线程调用
+class OutputMixer {
+public:
+    // 拉取回调：最多向 out 写入 samples 个样本，返回实际写入数（0 表示这一路此刻没有声音）
+    using Source = std::function<size_t(short* out, size_t samples)>;
+    // 拉取回调此刻是否有待播的数据（任意线程调用，须无锁），用于唤醒或恢复播放设备
+    using PendingCheck = std::function<bool()>;
+
+    static constexpr size_t kNoClip = static_cast<size_t>(-1);
+
+    explicit OutputMixer(const OutputMixerConfig& config);
+
+    OutputMixer(const OutputMixer&) = delete;
+    OutputMixer& operator=(const OutputMixer&) = delete;
+
+    // 登记一路输入，返回流编号；source 为空时这一路只播 Play 的片段和 Write 写入的数据。
+    // pending 给出时计入 Pending()：拉取回调的数据不经过缓冲区（如 AssetPlayer 按需解码），混音器无从得知
+    size_t AddStream(const MixerStreamConfig& config, Source source = nullptr, PendingCheck pending = nullptr);
+    // 登记一段解码好的 PCM（交错），返回片段编号
+    size_t AddClip(std::vector<short> pcm);
+
+    // 生产者：写入这一路的输入环形缓冲区（ring_samples 为 0 时返回 0），返回实际写入的样本数
+    size_t Write(size_t stream, const short* pcm, size_t samples);
+    // 从头播放片段，替换这一路正在播放的片段；loop 为 true 时循环直到 Stop
+    void Play(size_t stream, size_t clip, bool loop = false);
+    // 停止这一路的片段（输入环形缓冲区和拉取回调不受影响）
+    void Stop(size_t stream);
+    void SetGain(size_t stream, float gain);
+
+    // 除拉取回调外还有待播的数据（片段在播放中、输入环形缓冲区非空或 pending 回调为真），用于唤醒或恢复播放设备
+    bool Pending() const;
+
+    // 播放线程：混出最多 samples 个样本（超过 max_period_samples 时截断），返回有效样本数，0 表示各路都没有声音。
+    // 各路长度不一时短的一路按静音补齐
+    size_t Mix(short* out, size_t samples);
+    // 上一次 Mix 中这一路贡献的样本数（仅播放线程），用于区分 TTS 和提示音
+    size_t Produced(size_t stream) const { return streams_[stream]->produced; }
+
+    OutputMixerStats GetStats() const;
+
+private:
+    struct Stream {
+        MixerStreamConfig config;
+        Source source;
+        PendingCheck pending;
+        std::unique_ptr<PcmRing> ring;
+        std::atomic<float> gain{1.0f};
+        // 片段命令：序号 << 32 | 片段编号 << 1 | 循环，序号变化即为新命令；片段编号全 1 表示停止
+        std::atomic<uint64_t> command{0};
+        std::atomic<bool> clip_active{false};
+        // 以下只在播放线程访问
+        uint64_t seen_command = 0;
+        size_t clip = kNoClip;
+        size_t clip_position = 0;
+        bool loop = false;
+        float level = 1.0f;  // 当前实际施加的压低系数，向目标平滑过渡
+        size_t produced = 0;
+    };
+
+    void PostCommand(Stream& stream, size_t clip, bool loop);
+    void ApplyCommand(Stream& stream);
+    // 从这一路取出最多 samples 个样本到 out
+    size_t Pull(Stream& stream, short* out, size_t samples);
+    // 按增益和压低系数缩放：系数变化时分几段插值，避免台阶
+    void Scale(short* pcm, size_t samples, float gain, float from, float to) const;
+    // 把 src 叠加到 out，out 中已有 *valid 个有效样本
+    static void Accumulate(short* out, size_t* valid, const short* src, size_t n);
+
+    OutputMixerConfig config_;
+    std::vector<std::unique_ptr<Stream>> streams_;  // 按流编号
+    std::vector<size_t> order_;                     // 混音顺序：带 ducks_others 的流排在前面，先取出才能决定是否压低
+    std::vector<std::vector<short>> clips_;
+    std::vector<short> scratch_;       // 第二路起先取到这里再叠加
+    std::vector<short> clip_scratch_;  // 同一路的片段叠加到实时输入上时使用
+    std::atomic<uint32_t> next_sequence_{0};
+
+    std::atomic<uint64_t> mixes_{0};
+    std::atomic<uint64_t> mixed_periods_{0};
+    std::atomic<uint64_t> ducked_periods_{0};
+    std::atomic<uint64_t> clips_started_{0};
+};
+
+}  // namespace linx
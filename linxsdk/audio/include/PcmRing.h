@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+#include "MemoryAccounting.h"
+
+namespace linx {
+
+// 单生产者/单消费者无锁 PCM 环形缓冲区（int16 样本）
+// 容量在构造时一次性分配并向上取整为 2 的幂，稳态读写不做任何内存分配。
+// 生产者只修改 tail_，消费者只修改 head_，两者位于不同的 cache line，避免伪共享。
+class PcmRing {
+public:
+    static constexpr size_t kCacheLine = 64;
+
+    explicit PcmRing(size_t capacity) {
+        size_t cap = 1;
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        capacity_ = cap;
+        mask_ = cap - 1;
+        data_ = MakeTaggedArray<short, MemoryTag::Audio>(cap);
+    }
+
+    PcmRing(const PcmRing&) = delete;
+    PcmRing& operator=(const PcmRing&) = delete;
+
+    size_t Capacity() const { return capacity_; }
+
+    // 当前可读样本数（任意线程可调用，结果为近似值）
+    // 先读 head_ 再读 tail_：head_ 不会超过之后读到的 tail_，差值不会回绕；两次读取之间生产者可能又写入，
+    // 旁观线程算出的差值可能超过容量，截断到 capacity_
+    size_t Size() const {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t size = tail_.load(std::memory_order_acquire) - head;
+        return size < capacity_ ? size : capacity_;
+    }
+
+    // 当前可写样本数（任意线程可调用，结果为近似值）
+    size_t Space() const { return capacity_ - Size(); }
+
+    bool Empty() const { return Size() == 0; }
+
+    // ==================== 生产者接口 ====================
+
+    // 获取一段连续的可写区域，*contiguous 返回该区域的样本数（可能小于 Space，环绕时需两次提交）
+    short* WriteRegion(size_t* contiguous) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t free = capacity_ - (tail - cached_head_);
+        if (free == 0) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            free = capacity_ - (tail - cached_head_);
+        }
+        size_t offset = tail & mask_;
+        size_t until_wrap = capacity_ - offset;
+        *contiguous = free < until_wrap ? free : until_wrap;
+        return data_.get() + offset;
+    }
+
+    // 提交写入 WriteRegion 返回区域中的前 n 个样本
+    void CommitWrite(size_t n) {
+        tail_.store(tail_.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // 拷贝写入，返回实际写入的样本数（空间不足时只写入能容纳的部分）
+    size_t Write(const short* data, size_t n) {
+        size_t written = 0;
+        while (written < n) {
+            size_t contiguous = 0;
+            short* dst = WriteRegion(&contiguous);
+            if (contiguous == 0) {
+                break;
+            }
+            size_t chunk = (n - written) < contiguous ? (n - written) : contiguous;
+            memcpy(dst, data + written, chunk * sizeof(short));
+            CommitWrite(chunk);
+            written += chunk;
+        }
+        return written;
+    }
+
+    // ==================== 消费者接口 ====================
+
+    // 获取一段连续的可读区域，*contiguous 返回该区域的样本数
+    const short* ReadRegion(size_t* contiguous) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t avail = cached_tail_ - head;
+        if (avail == 0) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            avail = cached_tail_ - head;
+        }
+        size_t offset = head & mask_;
+        size_t until_wrap = capacity_ - offset;
+        *contiguous = avail < until_wrap ? avail : until_wrap;
+        return data_.get() + offset;
+    }
+
+    // 消费 ReadRegion 返回区域中的前 n 个样本
+    void CommitRead(size_t n) {
+        head_.store(head_.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // 拷贝读出，返回实际读出的样本数
+    size_t Read(short* out, size_t n) {
+        size_t read = 0;
+        while (read < n) {
+            size_t contiguous = 0;
+            const short* src = ReadRegion(&contiguous);
+            if (contiguous == 0) {
+                break;
+            }
+            size_t chunk = (n - read) < contiguous ? (n - read) : contiguous;
+            memcpy(out + read, src, chunk * sizeof(short));
+            CommitRead(chunk);
+            read += chunk;
+        }
+        return read;
+    }
+
+    // 丢弃所有未读数据（仅消费者线程调用）
+    void Clear() {
+        size_t tail = tail_.load(std::memory_order_acquire);
+        cached_tail_ = tail;
+        head_.store(tail, std::memory_order_release);
+    }
+
+    // 累计读出位置（任意线程可调用）
+    size_t ReadPosition() const { return head_.load(std::memory_order_acquire); }
+
+    // 累计写入位置（任意线程可调用），配合 DiscardTo 丢弃某一时刻之前写入的数据
+    size_t WritePosition() const { return tail_.load(std::memory_order_acquire); }
+
+    // 丢弃写入位置 position 之前的未读数据，之后写入的保留；返回丢弃的样本数（仅消费者线程调用）
+    size_t DiscardTo(size_t position) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (static_cast<ptrdiff_t>(position - head) <= 0) {
+            return 0;
+        }
+        if (static_cast<ptrdiff_t>(cached_tail_ - position) < 0) {
+            cached_tail_ = position;
+        }
+        head_.store(position, std::memory_order_release);
+        return position - head;
+    }
+
+private:
+    // 消费者侧
+    alignas(kCacheLine) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;
+
+    // 生产者侧
+    alignas(kCacheLine) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;
+
+    // 只读字段
+    alignas(kCacheLine) size_t capacity_ = 0;
+    size_t mask_ = 0;
+    TaggedArray<short, MemoryTag::Audio> data_;
+};
+
+}  // namespace linx
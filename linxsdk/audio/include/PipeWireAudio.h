@@ -0,0 +1,104 @@
+#pragma once
+
+#ifdef LINX_HAVE_PIPEWIRE
+
+#include <pipewire/pipewire.h>
+#include <semaphore.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "AudioInterface.h"
+#include "PcmRing.h"
+
+namespace linx {
+
+// PipeWire 原生后端：采集和播放各一个 pw_stream，挂在一个 pw_thread_loop 上。
+// 流以 node.latency = 一个周期 / 采样率 请求小的图周期（quantum），并以 node.rate 请求图按流的采样率运行，
+// 服务端允许切换图采样率（default.clock.allowed-rates 包含该采样率）时整条链路不做重采样；
+// 不允许时只由 PipeWire 的适配器重采样一次，而不是经 ALSA 的 pulse/pipewire 插件再转一道。
+//
+// 实时回调只与无锁环形缓冲区交换数据并 sem_post 通知，不加锁、不分配内存；
+// Read/Write 在调用线程上读写环，与 PortAudio 回调模式相同。
+class PipeWireAudio : public AudioInterface {
+public:
+    PipeWireAudio();
+    ~PipeWireAudio() override;
+
+    PipeWireAudio(const PipeWireAudio&) = delete;
+    PipeWireAudio& operator=(const PipeWireAudio&) = delete;
+
+    void Init() override;
+    void SetConfig(unsigned int sample_rate, int frame_size, int channels, int periods, int buffer_size,
+                   int period_size) override;
+    bool Read(short* buffer, size_t frame_size) override;
+    bool Write(short* buffer, size_t frame_size) override;
+    void Record() override;
+    void Play() override;
+    // 环中待播数据 + 图中尚未播出的部分（pw_stream_get_time 的 delay）
+    long GetPlaybackDelay() override;
+    // 丢弃此刻之前写入播放环的数据，由下一次回调完成，不停流
+    bool DropPlayback() override;
+    // 置退出标志并 sem_post 两个信号量，等待中的 Read/Write 立即返回失败
+    void Abort() override;
+    // 省电：pw_stream_set_active 停用 / 恢复各自的流，节点空闲后服务端可以挂起设备
+    bool SuspendCapture() override;
+    bool ResumeCapture() override;
+    bool SuspendPlayback() override;
+    bool ResumePlayback() override;
+    // process 回调在播放环里没有数据时整块补零，空闲时不需要写静音
+    bool SilenceFill() const override { return true; }
+    // 以节点名（node.name，如 pw-cli ls Node 所列）或对象序号指定目标节点，空或 "default" 为默认设备；
+    // 不做校验，目标不存在时由会话管理器报错。须在 Record/Play 之前调用
+    bool SetDevice(const std::string& capture, const std::string& playback) override;
+    AudioXrunStats GetXrunStats() const override;
+    unsigned int SampleRate() const override { return sample_rate_; }
+    int Channels() const override { return channels_; }
+
+    // 连接 PipeWire 守护进程的 socket 是否存在（不建立连接），CreateAudioInterface 据此自动选择后端
+    static bool ServerAvailable();
+
+private:
+    static void OnCaptureProcess(void* data);
+    static void OnPlaybackProcess(void* data);
+    static void OnStateChanged(void* data, enum pw_stream_state old, enum pw_stream_state state, const char* error);
+
+    // 在线程循环上创建并连接一个流（持循环锁调用）
+    pw_stream* Connect(bool capture, const pw_stream_events* events);
+    bool SetActive(pw_stream* stream, bool active);
+    void OnInput(const short* input, size_t frames);
+    void OnOutput(short* output, size_t frames);
+
+    pw_thread_loop* loop_ = nullptr;
+    pw_stream* capture_stream_ = nullptr;
+    pw_stream* playback_stream_ = nullptr;
+    pw_stream_events capture_events_{};
+    pw_stream_events playback_events_{};
+    std::string capture_target_;   // SetDevice 指定的目标节点，空为默认
+    std::string playback_target_;
+
+    unsigned int sample_rate_ = 16000;
+    int channels_ = 1;
+    int periods_ = 4;
+    int buffer_size_ = 4096;
+    int period_size_ = 1024;
+
+    std::unique_ptr<PcmRing> capture_ring_;   // 回调 -> Read
+    std::unique_ptr<PcmRing> playback_ring_;  // Write -> 回调
+    size_t playback_limit_ = 0;               // 播放环允许的最大样本数，决定软件缓冲延迟
+    std::atomic<bool> playback_drop_{false};  // DropPlayback 请求，回调中执行
+    std::atomic<size_t> playback_drop_to_{0};
+    sem_t capture_sem_;
+    sem_t playback_sem_;
+    std::atomic<bool> capture_active_{false};
+    std::atomic<bool> playback_active_{false};
+    std::atomic<bool> aborted_{false};
+    std::atomic<uint64_t> input_overflows_{0};
+    std::atomic<uint64_t> output_underflows_{0};
+};
+
+}  // namespace linx
+
+#endif  // LINX_HAVE_PIPEWIRE
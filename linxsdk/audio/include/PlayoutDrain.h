@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+#include "LockProfiler.h"
+
+namespace linx {
+
+struct PlayoutDrainStats {
+    uint64_t drains = 0;      // 排空后完成的请求数
+    uint64_t timeouts = 0;    // 等到上限仍未排空、强制完成的请求数
+    uint64_t cancelled = 0;   // 被新请求覆盖或取消的请求数
+    double last_wait_ms = 0;  // 最近一次请求到完成的等待时间
+    double max_wait_ms = 0;
+};
+
+// 播放排空检测：服务器发完一段 TTS 时，抖动缓冲区和设备缓冲里往往还有几百毫秒没播出的音频，
+// 这时立即开始录音会切掉回复的结尾（没有回声消除时还把它录进去）。
+// 播放线程每把一段 TTS 写进设备就调用 NoteWritten，记下这段音频从扬声器播完的时刻（写入时刻 + 设备延迟）；
+// Request 之后，播放线程在缓冲区已取空且过了这个时刻时回调一次。播完后补的静音不影响判断。
+// Request / Cancel 可在任意线程调用，NoteWritten / Dropped / Poll 只在播放线程（或引擎回调）上调用
+class PlayoutDrain {
+public:
+    using Callback = std::function<void()>;
+
+    // max_wait_ms：请求后（或最近一次写入后）超过这么久仍未排空即强制完成，兜底设备卡住或不再被驱动的情况；
+    // 按最近一次写入计时，缓冲区里排着很长的回复时不会提前超时。0 为不限
+    explicit PlayoutDrain(int max_wait_ms = 5000) : max_wait_us_(static_cast<uint64_t>(max_wait_ms) * 1000) {}
+
+    PlayoutDrain(const PlayoutDrain&) = delete;
+    PlayoutDrain& operator=(const PlayoutDrain&) = delete;
+
+    // 播放线程：刚写入设备的音频还要 delay_us 才能全部播出（snd_pcm_delay 换算，包含这次写入）
+    void NoteWritten(uint64_t delay_us);
+    // 设备报告的延迟之外还要等多久：编解码芯片、转换器的延迟和回声经麦克风采集回来的时间（如回环校准测得），
+    // 加在每次 NoteWritten 上，回复的尾音连同回声都过去后才算排空。任意线程调用
+    void SetExtraDelay(std::chrono::microseconds extra) {
+        extra_delay_us_.store(extra.count() > 0 ? static_cast<uint64_t>(extra.count()) : 0, std::memory_order_relaxed);
+    }
+    // 播放线程：设备缓冲已丢弃（打断），之前写入的音频不会再播出
+    void Dropped() { content_due_us_.store(0, std::memory_order_relaxed); }
+
+    // 请求在播放排空后回调 on_drained；覆盖尚未完成的请求（旧回调不再调用）
+    void Request(Callback on_drained);
+    // 取消尚未完成的请求
+    void Cancel();
+    bool Pending() const { return pending_.load(std::memory_order_acquire); }
+
+    // 播放线程：buffer_empty 为上游缓冲区（抖动缓冲区）已全部取出。排空或超时时回调并返回 true
+    bool Poll(bool buffer_empty);
+    // 距离已写入的音频播完还有多久（没有请求或已播完时为 0），用于缩短播放线程的等待
+    std::chrono::microseconds Remaining() const;
+
+    PlayoutDrainStats GetStats() const;
+
+private:
+    void RecordWait(uint64_t requested_us, uint64_t now_us);
+
+    const uint64_t max_wait_us_;
+    std::atomic<uint64_t> extra_delay_us_{0};
+    std::atomic<uint64_t> content_due_us_{0};  // 已写入设备的音频预计播完的时刻
+    std::atomic<uint64_t> last_written_us_{0};
+    std::atomic<bool> pending_{false};
+    ProfiledMutex mutex_{"playout_drain"};  // 保护 callback_ / requested_us_
+    Callback callback_;
+    uint64_t requested_us_ = 0;
+
+    std::atomic<uint64_t> drains_{0};
+    std::atomic<uint64_t> timeouts_{0};
+    std::atomic<uint64_t> cancelled_{0};
+    std::atomic<double> last_wait_ms_{0};
+    std::atomic<double> max_wait_ms_{0};
+};
+
+}  // namespace linx
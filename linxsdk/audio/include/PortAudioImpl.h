@@ -3,10 +3,16 @@
 #ifdef __APPLE__
 
 #include "AudioInterface.h"
+#include <dispatch/dispatch.h>
 #include <portaudio.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 #include "Log.h"
 #include "FileStream.h"
+#include "PcmRing.h"
 
 namespace linx {
 
@@ -22,8 +28,85 @@ public:
     bool Write(short* buffer, size_t frame_size) override;
     void Record() override;
     void Play() override;
+    long GetPlaybackDelay() override;
+    // 回调模式下丢弃播放环中此刻之前写入的数据（由下一次回调完成，不停流）；
+    // 阻塞模式下 Pa_AbortStream 后立即重新启动输出流
+    bool DropPlayback() override;
+    // 省电：Pa_StopStream / Pa_StartStream 停止和重启各自的流（全双工模式不支持，返回 false）
+    bool SuspendCapture() override;
+    bool ResumeCapture() override;
+    bool SuspendPlayback() override;
+    bool ResumePlayback() override;
+    // 列出 PortAudio 的所有设备，序号即 PaDeviceIndex；可在 Init 之前调用
+    std::vector<AudioDeviceInfo> ListDevices() override;
+    // 按序号或名称片段选择输入/输出设备；PortAudio 没有 ALSA 式的设备名，"hw:" 等返回 false
+    bool SetDevice(const std::string& capture, const std::string& playback) override;
+    // suggestedLatency 取 0，由宿主 API 给出它支持的最小延迟
+    void SetLowestLatency(bool enabled) override { lowest_latency_ = enabled; }
+    // 回调模式下播放回调在环里没有数据时整块补零，本来就不需要写静音；阻塞模式不支持
+    bool SilenceFill() const override { return callback_mode_ || duplex_mode_; }
+    // F32 只在阻塞模式下生效（Pa_ReadStream / Pa_WriteStream 直接交换 float32）；回调和全双工模式仍为 int16。
+    // 须在 Record/Play 之前调用
+    bool SetSampleFormat(SampleFormat format) override {
+        prefer_float_ = format == SampleFormat::F32;
+        return true;
+    }
+    SampleFormat CaptureFormat() const override { return input_float_ ? SampleFormat::F32 : SampleFormat::S16; }
+    SampleFormat PlaybackFormat() const override { return output_float_ ? SampleFormat::F32 : SampleFormat::S16; }
+    bool ReadFloat(float* buffer, size_t frames) override;
+    bool WriteFloat(const float* buffer, size_t frames) override;
+
+    // 回调模式（默认开启）：CoreAudio 实时回调直接与无锁环形缓冲区交换数据，
+    // Read/Write 只读写环；关闭时使用 Pa_ReadStream/Pa_WriteStream 阻塞模式。须在 Record/Play 之前设置
+    void SetCallbackMode(bool enabled) { callback_mode_ = enabled; }
+    bool CallbackMode() const { return callback_mode_; }
+
+    // 全双工模式：Record/Play 共用一个同时带输入和输出参数的 Pa_OpenStream，采集与播放在同一个回调、
+    // 同一个设备时钟下完成，不会随时间漂移；播出的数据与采集逐样本对齐，可由 ReadEchoReference 取出。
+    // 隐含回调模式，须在 Record/Play 之前设置
+    void SetDuplexMode(bool enabled) { duplex_mode_ = enabled; }
+    bool DuplexMode() const { return duplex_mode_; }
+    bool ReadEchoReference(short* buffer, size_t frames) override;
+    // 回调模式取自回调的 PaStreamCallbackTimeInfo::inputBufferAdcTime；阻塞模式按读取后仍在流中的帧数
+    // 和流报告的输入延迟推算
+    uint64_t CaptureTimestampUs() const override { return capture_stamp_us_; }
+    unsigned int SampleRate() const override { return sample_rate_; }
+    int Channels() const override { return channels_; }
+
+    // 回调模式下的丢帧统计：采集环满时丢弃的帧数、播放中途数据不足补零的次数
+    uint64_t InputOverflows() const { return input_overflows_.load(std::memory_order_relaxed); }
+    uint64_t OutputUnderflows() const { return output_underflows_.load(std::memory_order_relaxed); }
 
 private:
+    // 回调模式下每个回调的处理：只做环读写和信号量通知，不加锁、不分配内存
+    void OnInput(const short* input, unsigned long frames);
+    void OnOutput(short* output, unsigned long frames);
+    void OnDuplex(const short* input, short* output, unsigned long frames);
+    // 回调中、写入采集环之前：按本次输入的 ADC 时刻校准采集环的时间原点
+    void StampInput(const PaStreamCallbackTimeInfo* time_info);
+    // Read 线程：读出 frames 帧之后推算其中第一帧的采集时刻（阻塞模式）
+    void StampStreamRead(size_t frames);
+    // Read 线程：从采集环读出一次之后，按读出的第一帧在环中的累计序号换算采集时刻（回调模式）
+    void StampRingRead(uint64_t first_frame);
+    void OpenDuplex();
+    bool ReadRing(short* buffer, size_t frames);
+    // 阻塞模式下按流的样本格式读写
+    bool ReadStream(void* buffer, size_t frames);
+    bool WriteStream(const void* buffer, size_t frames);
+    bool WriteRing(const short* buffer, size_t frames);
+    // 回调模式下请求的设备延迟：一个周期，端到端延迟由环的深度决定
+    PaTime CallbackLatency() const {
+        return lowest_latency_ ? 0 : static_cast<PaTime>(period_size_) / sample_rate_;
+    }
+    PaDeviceIndex InputDevice() const {
+        return input_device_ != paNoDevice ? input_device_ : Pa_GetDefaultInputDevice();
+    }
+    PaDeviceIndex OutputDevice() const {
+        return output_device_ != paNoDevice ? output_device_ : Pa_GetDefaultOutputDevice();
+    }
+    // spec 换算为设备序号，"default" 为 paNoDevice
+    bool ResolveDevice(const std::string& spec, bool capture, PaDeviceIndex* device);
+
     PaStream* input_stream_;
     PaStream* output_stream_;
     std::vector<short> audio_data_;
@@ -35,6 +118,36 @@ private:
     int periods_ = 4;
     int buffer_size_ = 4096;
     int period_size_ = 1024;
+    long output_capacity_ = 0;  // 观察到的最大可写帧数，近似为输出缓冲区容量
+    PaDeviceIndex input_device_ = paNoDevice;   // SetDevice 选择的设备，paNoDevice 为默认设备
+    PaDeviceIndex output_device_ = paNoDevice;
+    bool lowest_latency_ = false;
+    bool prefer_float_ = false;  // SetSampleFormat(F32) 的请求
+    bool input_float_ = false;   // 流实际以 paFloat32 打开
+    bool output_float_ = false;
+    std::vector<float> input_f32_;   // int16 读写路径在 float32 流上的中转
+    std::vector<float> output_f32_;
+
+    bool callback_mode_ = true;
+    std::unique_ptr<PcmRing> capture_ring_;   // 回调 -> Read
+    std::unique_ptr<PcmRing> playback_ring_;  // Write -> 回调
+    size_t playback_limit_ = 0;               // 播放环允许的最大样本数，决定软件缓冲延迟
+    std::atomic<bool> playback_drop_{false};    // DropPlayback 请求，回调中执行
+    std::atomic<size_t> playback_drop_to_{0};   // 丢弃到的播放环写入位置
+    dispatch_semaphore_t capture_sem_ = nullptr;   // 回调写入采集数据后通知 Read
+    dispatch_semaphore_t playback_sem_ = nullptr;  // 回调取走播放数据后通知 Write
+    // 全双工：采集环中每帧依次存放 [采集 channels_ 个样本 | 同时播出的 channels_ 个样本]
+    bool duplex_mode_ = false;
+    std::vector<short> duplex_scratch_;  // 回调内交织用，预分配
+    std::vector<short> duplex_read_;     // Read 侧解交织用
+    std::vector<short> reference_;       // 最近一次 Read 对应的播放参考
+    size_t reference_frames_ = 0;
+    // 采集环中累计第 k 帧的采集时刻为 capture_origin_us_ + k / sample_rate_（回调每次按 ADC 时间戳重新校准，
+    // 环满丢帧、时钟漂移也就此消化）；0 表示宿主 API 不提供时间戳
+    std::atomic<int64_t> capture_origin_us_{0};
+    uint64_t capture_stamp_us_ = 0;  // CaptureTimestampUs（仅 Read 线程）
+    std::atomic<uint64_t> input_overflows_{0};
+    std::atomic<uint64_t> output_underflows_{0};
     
     static int RecordCallback(const void* inputBuffer, void* outputBuffer,
                              unsigned long framesPerBuffer,
@@ -42,6 +155,12 @@ private:
                              PaStreamCallbackFlags statusFlags,
                              void* userData);
                              
+    static int DuplexCallback(const void* inputBuffer, void* outputBuffer,
+                              unsigned long framesPerBuffer,
+                              const PaStreamCallbackTimeInfo* timeInfo,
+                              PaStreamCallbackFlags statusFlags,
+                              void* userData);
+
     static int PlayCallback(const void* inputBuffer, void* outputBuffer,
                            unsigned long framesPerBuffer,
                            const PaStreamCallbackTimeInfo* timeInfo,
@@ -0,0 +1,67 @@
+#pragma once
+
+#ifdef LINX_HAVE_PULSEAUDIO
+
+#include <pulse/simple.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "AudioInterface.h"
+
+namespace linx {
+
+// PulseAudio 后端（pa_simple 阻塞接口）：没有 PipeWire 的桌面系统，或 PipeWire 只提供 pipewire-pulse 时使用。
+// 缓冲区属性按设备周期设置：采集 fragsize 为一个周期，播放 tlength 为 buffer_size、minreq 为一个周期，
+// pa_simple 以 PA_STREAM_ADJUST_LATENCY 打开流，服务端据此把设备延迟调小，而不是使用默认的约 2 秒缓冲。
+// 设备采样率与流不同时只由服务端重采样一次，不再经 ALSA 的 pulse 插件多转一道。
+// Read/Write 各自只由一个线程调用；pa_simple 的每次调用都持有其主循环锁（等待时释放），
+// GetPlaybackDelay/DropPlayback 可与阻塞中的 Write 并发
+class PulseAudio : public AudioInterface {
+public:
+    PulseAudio() = default;
+    ~PulseAudio() override;
+
+    PulseAudio(const PulseAudio&) = delete;
+    PulseAudio& operator=(const PulseAudio&) = delete;
+
+    void Init() override {}
+    void SetConfig(unsigned int sample_rate, int frame_size, int channels, int periods, int buffer_size,
+                   int period_size) override;
+    bool Read(short* buffer, size_t frame_size) override;
+    bool Write(short* buffer, size_t frame_size) override;
+    void Record() override;
+    void Play() override;
+    // 服务端报告的播放延迟（pa_simple_get_latency），换算为帧数
+    long GetPlaybackDelay() override;
+    // pa_simple_flush 丢弃服务端缓冲中尚未播出的数据
+    bool DropPlayback() override;
+    // 以 source/sink 名（pactl list short sources/sinks 所列）指定设备，空或 "default" 为默认设备；
+    // 须在 Record/Play 之前调用
+    bool SetDevice(const std::string& capture, const std::string& playback) override;
+    AudioXrunStats GetXrunStats() const override;
+    unsigned int SampleRate() const override { return sample_rate_; }
+    int Channels() const override { return channels_; }
+
+    // PulseAudio（或 pipewire-pulse）的 socket 是否存在，或设置了 PULSE_SERVER；不建立连接
+    static bool ServerAvailable();
+
+private:
+    pa_simple* capture_ = nullptr;
+    pa_simple* playback_ = nullptr;
+    std::string capture_device_;   // SetDevice 指定的 source，空为默认
+    std::string playback_device_;  // SetDevice 指定的 sink，空为默认
+
+    unsigned int sample_rate_ = 16000;
+    int channels_ = 1;
+    int buffer_size_ = 4096;
+    int period_size_ = 1024;
+
+    std::atomic<uint64_t> capture_errors_{0};
+    std::atomic<uint64_t> playback_errors_{0};
+};
+
+}  // namespace linx
+
+#endif  // LINX_HAVE_PULSEAUDIO
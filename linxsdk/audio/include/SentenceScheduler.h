@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "JitterBuffer.h"
+#include "LatencyTracer.h"
+#include "LockProfiler.h"
+
+namespace linx {
+
+// 一句开始播出时的报告
+struct SentenceReport {
+    uint32_t index = 0;          // 本段回复中的句序号，从 1 开始
+    std::string text;            // sentence_start 带的文本
+    double first_packet_ms = 0;  // sentence_start 到该句第一个音频包
+    double first_play_ms = 0;    // sentence_start 到该句第一个样本从扬声器播出
+    double stall_ms = 0;         // 比上一句连续播完时晚开始了多久（首句和上一句被跳过时为 0）
+    double buffered_ms = 0;      // 开始播出时该句已缓冲（预读）的音频时长
+};
+
+struct SentenceStats {
+    uint64_t sentences = 0;   // 收到的 sentence_start 数
+    uint64_t played = 0;      // 已开始播出的句数
+    uint64_t skipped = 0;     // 被跳过的句数
+    uint64_t truncated = 0;   // 因在句尾停止而被丢弃的后续句数
+    double last_stall_ms = 0;
+    double max_stall_ms = 0;
+    double max_first_play_ms = 0;
+};
+
+// 按句调度 TTS 播放：服务器在每句音频前发 tts sentence_start（带文本）、之后发 sentence_end，
+// 这里把句子边界记成抖动缓冲区中的累计写入位置，整段回复仍连续解码进同一个抖动缓冲区，
+// 下一句的音频在上一句播放期间就已预读进来，边界处无缝衔接；下一句还没到时上一句在句尾干净结束
+// （不做丢包隐藏），下一句重新攒到起播门限再开始。
+// 播放线程读过一句的起点时报告这一句的首样本播出延迟和相对上一句的停顿，用来定位多句回复卡在哪一句。
+// BeginReply / BeginSentence / EndSentence / AcceptAudio / OnAudio 在接收线程上调用，
+// OnPlayed 只在播放线程上调用，Skip / StopAfterSentence / Cancel 可在任意线程调用
+class SentenceScheduler {
+public:
+    using ReportHandler = std::function<void(const SentenceReport&)>;
+
+    explicit SentenceScheduler(JitterBuffer& jitter) : jitter_(jitter) {}
+
+    SentenceScheduler(const SentenceScheduler&) = delete;
+    SentenceScheduler& operator=(const SentenceScheduler&) = delete;
+
+    // 每句开始播出时在播放线程上回调，须在开始播放之前设置
+    void SetReportHandler(ReportHandler handler) { report_handler_ = std::move(handler); }
+    // 首样本播出延迟计入 SentenceFirstPlay，停顿计入 SentenceStall，须在开始播放之前设置
+    void SetLatencyTracer(std::shared_ptr<LatencyTracer> tracer) { tracer_ = std::move(tracer); }
+
+    // tts start：新的一段回复，句序号从 1 开始，取消上一段的跳过和截断
+    void BeginReply();
+    // tts sentence_start：之后写入抖动缓冲区的音频属于这一句
+    void BeginSentence(std::string_view text);
+    // tts sentence_end：这一句的音频已发完，播到这里时下一句还没到就在句尾结束
+    void EndSentence();
+
+    // 每个 TTS 包解码前调用：所在的句子已被跳过或截断时返回 false，调用方直接丢弃该包
+    bool AcceptAudio() const { return !dropping_.load(std::memory_order_acquire); }
+    // TTS 包解码写入抖动缓冲区之后调用，记录当前句的首包时间
+    void OnAudio();
+
+    // 播放线程：每次从抖动缓冲区取出 TTS 数据并写入设备后调用，
+    // played_through_us 为这次写入的最后一个样本还要多久才能从扬声器播出
+    void OnPlayed(uint64_t played_through_us);
+
+    // 跳过正在播放的一句：已缓冲的部分丢弃，下一句已预读时直接从它的开头播放，
+    // 否则丢弃这一句后续到达的音频，直到下一句开始。没有可跳过的句子时返回 false
+    bool Skip();
+    // 播完正在播放的一句后停止本段回复：之后的句子（包括已预读的部分）全部丢弃。
+    // 不通知服务器，调用方需要时自行发送 abort。没有句子时返回 false
+    bool StopAfterSentence();
+    // 整段回复已被打断（Flush），丢弃所有句子记录
+    void Cancel();
+
+    SentenceStats GetStats() const;
+
+private:
+    struct Sentence {
+        uint32_t index = 0;
+        std::string text;
+        size_t start = 0;            // 抖动缓冲区中的起点（累计写入位置）
+        uint64_t begin_us = 0;       // 收到 sentence_start 的时间
+        uint64_t first_packet_us = 0;
+        uint64_t first_play_us = 0;  // 起点样本的播出时间，0 表示尚未播出
+        bool skipped = false;
+    };
+    static constexpr size_t kNone = static_cast<size_t>(-1);
+    static constexpr size_t kMaxSentences = 64;  // 记录上限，异常情况下（如一直不播放）不无限增长
+
+    double SamplesToMs(size_t samples) const;
+    // 正在播放的一句在 sentences_ 中的下标（最后一个已开始播出或被跳过的，都没有时为第一句），没有句子时返回 kNone
+    size_t CurrentLocked() const;
+    void UpdateNextStartLocked();
+    void RecordStall(double stall_ms);
+
+    JitterBuffer& jitter_;
+    ReportHandler report_handler_;
+    std::shared_ptr<LatencyTracer> tracer_;
+
+    mutable ProfiledMutex mutex_{"sentence_scheduler"};  // 保护 sentences_ 及以下
+    std::deque<Sentence> sentences_;  // 本段回复中尚未播完的句子，按起点排列
+    uint32_t next_index_ = 1;
+    bool stop_after_ = false;     // 下一句开始时截断
+
+    // 播放线程的快速路径：读位置没有越过下一个待播句子的起点时不加锁
+    std::atomic<bool> has_next_start_{false};
+    std::atomic<size_t> next_start_{0};
+    std::atomic<bool> awaiting_packet_{false};
+    std::atomic<bool> dropping_{false};
+
+    std::atomic<uint64_t> sentences_total_{0};
+    std::atomic<uint64_t> played_{0};
+    std::atomic<uint64_t> skipped_{0};
+    std::atomic<uint64_t> truncated_{0};
+    std::atomic<double> last_stall_ms_{0};
+    std::atomic<double> max_stall_ms_{0};
+    std::atomic<double> max_first_play_ms_{0};
+};
+
+}  // namespace linx
@@ -0,0 +1,115 @@
+#include "AssetPlayer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace linx {
+
+namespace {
+
+constexpr uint64_t kFieldMask = 0xffffffffull;
+
+}  // namespace
+
+AssetPlayer::AssetPlayer(const AssetPack& pack, unsigned int sample_rate, int channels)
+    : pack_(pack), decoder_(sample_rate, channels) {
+    pcm_.resize(decoder_.MaxFrameSamples() * static_cast<size_t>(channels));
+}
+
+void AssetPlayer::Post(uint64_t field) {
+    uint64_t sequence = sequence_.fetch_add(1, std::memory_order_relaxed) + 1;
+    command_.store(sequence << 32 | field, std::memory_order_release);
+    active_.store(field != 0, std::memory_order_relaxed);
+}
+
+bool AssetPlayer::Play(size_t clip) {
+    if (clip >= pack_.Count()) {
+        return false;
+    }
+    Post(static_cast<uint64_t>(clip) + 1);
+    return true;
+}
+
+bool AssetPlayer::Play(std::string_view name) {
+    size_t clip = pack_.Find(name);
+    return clip != AssetPack::kNotFound && Play(clip);
+}
+
+void AssetPlayer::Stop() {
+    Post(0);
+}
+
+void AssetPlayer::ApplyCommand() {
+    uint64_t command = command_.load(std::memory_order_acquire);
+    if (command == seen_command_) {
+        return;
+    }
+    seen_command_ = command;
+    uint64_t field = command & kFieldMask;
+    pcm_pos_ = pcm_len_ = 0;
+    playing_ = field != 0;
+    if (!playing_) {
+        return;
+    }
+    clip_ = pack_.Clip(static_cast<size_t>(field - 1));
+    packet_ = 0;
+    skip_ = static_cast<size_t>(clip_.pre_skip) * decoder_.SampleRate() / 48000 * decoder_.Channels();
+    decoder_.Reset();  // 与上一个片段无关，不做重叠平滑
+    started_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool AssetPlayer::DecodeNext() {
+    while (packet_ < clip_.packets) {
+        size_t len = 0;
+        const unsigned char* data = clip_.Packet(packet_++, &len);
+        if (data == nullptr) {
+            decode_errors_.fetch_add(1, std::memory_order_relaxed);
+            packet_ = clip_.packets;  // 包表损坏，后面的位置都不可信
+            break;
+        }
+        int n = decoder_.Decode(pcm_.data(), decoder_.MaxFrameSamples(), data, len);
+        if (n <= 0) {
+            decode_errors_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        pcm_len_ = static_cast<size_t>(n) * decoder_.Channels();
+        pcm_pos_ = std::min(skip_, pcm_len_);
+        skip_ -= pcm_pos_;
+        if (pcm_pos_ < pcm_len_) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t AssetPlayer::Pull(short* out, size_t samples) {
+    ApplyCommand();
+    size_t written = 0;
+    while (playing_ && written < samples) {
+        if (pcm_pos_ == pcm_len_ && !DecodeNext()) {
+            playing_ = false;
+            completed_.fetch_add(1, std::memory_order_relaxed);
+            // 播完时若已有新的 Play 排队，保持 active 让播放线程继续拉取
+            active_.store(false, std::memory_order_relaxed);
+            if (command_.load(std::memory_order_acquire) != seen_command_) {
+                active_.store(true, std::memory_order_relaxed);
+            }
+            break;
+        }
+        size_t n = std::min(samples - written, pcm_len_ - pcm_pos_);
+        memcpy(out + written, pcm_.data() + pcm_pos_, n * sizeof(short));
+        pcm_pos_ += n;
+        written += n;
+    }
+    return written;
+}
+
+AssetPlayerStats AssetPlayer::GetStats() const {
+    AssetPlayerStats stats;
+    stats.started = started_.load(std::memory_order_relaxed);
+    stats.completed = completed_.load(std::memory_order_relaxed);
+    stats.decode_errors = decode_errors_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace linx
@@ -1,14 +1,163 @@
 #include "AudioInterface.h"
 
+#include <algorithm>
+#include <cctype>
+
+#include "FileAudio.h"
+#include "Log.h"
+
 #ifdef __APPLE__
 #include "PortAudioImpl.h"
 #else
 #include "AlsaAudio.h"
 #endif
+#ifdef LINX_HAVE_PIPEWIRE
+#include "PipeWireAudio.h"
+#endif
+#ifdef LINX_HAVE_PULSEAUDIO
+#include "PulseAudio.h"
+#endif
 
 namespace linx {
 
-std::unique_ptr<AudioInterface> CreateAudioInterface() {
+const char* AudioBackendName(AudioBackend backend) {
+    switch (backend) {
+        case AudioBackend::Auto:
+            return "auto";
+        case AudioBackend::Alsa:
+            return "alsa";
+        case AudioBackend::PipeWire:
+            return "pipewire";
+        case AudioBackend::PulseAudio:
+            return "pulse";
+        case AudioBackend::PortAudio:
+            return "portaudio";
+        case AudioBackend::Null:
+            return "null";
+        case AudioBackend::Sink:
+            return "sink";
+    }
+    return "unknown";
+}
+
+bool ParseAudioBackend(const std::string& name, AudioBackend* backend) {
+    if (name == "auto") {
+        *backend = AudioBackend::Auto;
+    } else if (name == "alsa") {
+        *backend = AudioBackend::Alsa;
+    } else if (name == "pipewire" || name == "pw") {
+        *backend = AudioBackend::PipeWire;
+    } else if (name == "pulse" || name == "pulseaudio") {
+        *backend = AudioBackend::PulseAudio;
+    } else if (name == "portaudio") {
+        *backend = AudioBackend::PortAudio;
+    } else if (name == "null") {
+        *backend = AudioBackend::Null;
+    } else if (name == "sink") {
+        *backend = AudioBackend::Sink;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool AudioBackendBuilt(AudioBackend backend) {
+    switch (backend) {
+        case AudioBackend::Auto:
+        case AudioBackend::Null:
+        case AudioBackend::Sink:
+            return true;
+#ifdef __APPLE__
+        case AudioBackend::PortAudio:
+            return true;
+#else
+        case AudioBackend::Alsa:
+            return true;
+#endif
+#ifdef LINX_HAVE_PIPEWIRE
+        case AudioBackend::PipeWire:
+            return true;
+#endif
+#ifdef LINX_HAVE_PULSEAUDIO
+        case AudioBackend::PulseAudio:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+int FindAudioDevice(const std::vector<AudioDeviceInfo>& devices, const std::string& spec, bool capture) {
+    auto has_direction = [capture](const AudioDeviceInfo& info) {
+        return capture ? info.capture.supported : info.playback.supported;
+    };
+    if (!spec.empty() && spec.size() < 6 && std::all_of(spec.begin(), spec.end(), [](char c) { return std::isdigit(c) != 0; })) {
+        size_t index = std::stoul(spec);
+        return index < devices.size() && has_direction(devices[index]) ? static_cast<int>(index) : -1;
+    }
+    auto lower = [](std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+        return text;
+    };
+    const std::string needle = lower(spec);
+    for (size_t i = 0; i < devices.size(); i++) {
+        if (has_direction(devices[i]) && lower(devices[i].name).find(needle) != std::string::npos) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+AudioBackend DetectAudioBackend() {
+#ifdef __APPLE__
+    return AudioBackend::PortAudio;
+#else
+#ifdef LINX_HAVE_PIPEWIRE
+    if (PipeWireAudio::ServerAvailable()) {
+        return AudioBackend::PipeWire;
+    }
+#endif
+#ifdef LINX_HAVE_PULSEAUDIO
+    if (PulseAudio::ServerAvailable()) {
+        return AudioBackend::PulseAudio;
+    }
+#endif
+    return AudioBackend::Alsa;
+#endif
+}
+
+std::unique_ptr<AudioInterface> CreateAudioInterface(AudioBackend backend, const std::string& capture_loop) {
+    if (backend == AudioBackend::Auto) {
+        backend = DetectAudioBackend();
+    } else if (!AudioBackendBuilt(backend)) {
+        WARN("audio backend {} is not built in, using the platform default", AudioBackendName(backend));
+        backend = DetectAudioBackend();
+    }
+    INFO("audio backend: {}", AudioBackendName(backend));
+    switch (backend) {
+        case AudioBackend::Null:
+        case AudioBackend::Sink: {
+            FileAudioConfig config;
+            config.capture_path = capture_loop;
+            config.realtime = true;
+            config.loop = true;
+            if (backend == AudioBackend::Sink) {
+                config.playout_timing = true;
+                config.report_interval_ms = 10000;
+            }
+            return std::make_unique<FileAudio>(config);
+        }
+#ifdef LINX_HAVE_PIPEWIRE
+        case AudioBackend::PipeWire:
+            return std::make_unique<PipeWireAudio>();
+#endif
+#ifdef LINX_HAVE_PULSEAUDIO
+        case AudioBackend::PulseAudio:
+            return std::make_unique<PulseAudio>();
+#endif
+        default:
+            break;
+    }
 #ifdef __APPLE__
     return std::make_unique<PortAudioImpl>();
 #else
@@ -16,4 +165,4 @@ std::unique_ptr<AudioInterface> CreateAudioInterface() {
 #endif
 }
 
-}  // namespace linx
\ No newline at end of file
+}  // namespace linx
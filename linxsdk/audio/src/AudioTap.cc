@@ -0,0 +1,339 @@
+#include "AudioTap.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "Log.h"
+#include "MemoryAccounting.h"
+
+namespace linx {
+
+namespace {
+
+constexpr size_t kHeaderSize = 4096;
+constexpr size_t kSlotAlign = 64;
+
+#ifdef __linux__
+// 共享映射上的 futex（不能用 FUTEX_PRIVATE_FLAG），等待方与唤醒方在不同进程
+long FutexWait(std::atomic<uint32_t>* word, uint32_t expected, int timeout_ms) {
+    struct timespec timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000;
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+void FutexWakeAll(std::atomic<uint32_t>* word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+}
+#endif
+
+}  // namespace
+
+AudioTap::AudioTap(const AudioTapConfig& config) : config_(config) {
+    config_.slots = std::max<size_t>(config_.slots, 4);
+}
+
+AudioTap::~AudioTap() {
+    Close();
+}
+
+bool AudioTap::Open() {
+    if (IsOpen()) {
+        return true;
+    }
+    size_t strides[kTapStreams];
+    map_size_ = kHeaderSize;
+    for (size_t i = 0; i < kTapStreams; ++i) {
+        size_t bytes = sizeof(AudioTapSlot) + std::max<size_t>(config_.stream[i].slot_samples, 1) * sizeof(short);
+        strides[i] = (bytes + kSlotAlign - 1) / kSlotAlign * kSlotAlign;
+        map_size_ += strides[i] * config_.slots;
+    }
+    map_size_ = (map_size_ + 4095) & ~static_cast<size_t>(4095);
+
+    shm_unlink(config_.name.c_str());  // 上次异常退出留下的同名共享内存，已打开的读取端不受影响
+    mode_t mask = umask(0);            // 权限以 config_.mode 为准
+    int fd = shm_open(config_.name.c_str(), O_RDWR | O_CREAT | O_EXCL, config_.mode);
+    umask(mask);
+    if (fd < 0) {
+        ERROR("audio tap: shm_open {} failed: {}", config_.name, strerror(errno));
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(map_size_)) != 0) {
+        ERROR("audio tap: resize {} failed: {}", config_.name, strerror(errno));
+        close(fd);
+        shm_unlink(config_.name.c_str());
+        return false;
+    }
+    map_ = mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);  // 映射保持有效
+    if (map_ == MAP_FAILED) {
+        ERROR("audio tap: mmap {} failed: {}", config_.name, strerror(errno));
+        map_ = nullptr;
+        shm_unlink(config_.name.c_str());
+        return false;
+    }
+    // 预先触碰全部页面，热路径上的第一次写入不再触发缺页
+    memset(map_, 0, map_size_);
+    AccountMemory(MemoryTag::Audio, static_cast<int64_t>(map_size_));
+
+    header_ = static_cast<AudioTapHeader*>(map_);
+    base_ = static_cast<unsigned char*>(map_);
+    header_->version = kAudioTapVersion;
+    header_->streams = kTapStreams;
+    header_->pid = static_cast<uint64_t>(getpid());
+    header_->size = map_size_;
+    size_t offset = kHeaderSize;
+    for (size_t i = 0; i < kTapStreams; ++i) {
+        AudioTapStreamHeader& stream = header_->stream[i];
+        stream.offset = offset;
+        stream.slots = static_cast<uint32_t>(config_.slots);
+        stream.slot_samples = static_cast<uint32_t>(std::max<size_t>(config_.stream[i].slot_samples, 1));
+        stream.slot_stride = static_cast<uint32_t>(strides[i]);
+        stream.sample_rate = config_.stream[i].sample_rate;
+        stream.channels = static_cast<uint32_t>(config_.stream[i].channels);
+        offset += strides[i] * config_.slots;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header_->magic, kAudioTapMagic, sizeof(header_->magic));  // 最后写入：文件头完整后才可识别
+    INFO("audio tap: {} ({} KB, {} slots per stream)", config_.name, map_size_ / 1024, config_.slots);
+    return true;
+}
+
+void AudioTap::Close() {
+    if (map_ == nullptr) {
+        return;
+    }
+    header_->closed.store(1, std::memory_order_release);
+#ifdef __linux__
+    for (size_t i = 0; i < kTapStreams; ++i) {
+        header_->stream[i].notify.fetch_add(1);
+        FutexWakeAll(&header_->stream[i].notify);  // 等待中的读取端立即返回并发现已关闭
+    }
+#endif
+    shm_unlink(config_.name.c_str());
+    munmap(map_, map_size_);
+    AccountMemory(MemoryTag::Audio, -static_cast<int64_t>(map_size_));
+    map_ = nullptr;
+    header_ = nullptr;
+    base_ = nullptr;
+}
+
+void AudioTap::Publish(TapStream stream, const short* pcm, size_t samples, uint64_t time_us) {
+    if (header_ == nullptr || samples == 0) {
+        return;
+    }
+    size_t index = static_cast<size_t>(stream);
+    size_t per_slot = header_->stream[index].slot_samples;
+    size_t channels = std::max<uint32_t>(header_->stream[index].channels, 1);
+    per_slot -= per_slot % channels;  // 拆分时不把一个采样帧分到两个槽位
+    uint64_t rate = std::max<uint32_t>(header_->stream[index].sample_rate, 1);
+    // 一次调用超过槽位容量时拆成多个槽位，后面各段的时间戳按样本数顺延
+    for (size_t done = 0; done < samples;) {
+        size_t n = std::min(samples - done, per_slot);
+        uint64_t offset_us = (done / channels) * 1000000 / rate;
+        PublishSlot(index, pcm != nullptr ? pcm + done : nullptr, n, time_us + offset_us);
+        done += n;
+    }
+}
+
+void AudioTap::PublishSlot(size_t index, const short* pcm, size_t samples, uint64_t time_us) {
+    AudioTapStreamHeader& stream = header_->stream[index];
+    uint64_t sequence = stream.head.load(std::memory_order_relaxed);
+    auto* slot = reinterpret_cast<AudioTapSlot*>(base_ + stream.offset +
+                                                 (sequence % stream.slots) * stream.slot_stride);
+    slot->begin.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);  // begin 先于数据可见
+    slot->time_us = time_us;
+    slot->position = position_[index];
+    slot->samples = static_cast<uint32_t>(samples);
+    slot->flags = pcm == nullptr ? kTapSilence : 0;
+    if (pcm != nullptr) {
+        memcpy(reinterpret_cast<unsigned char*>(slot) + sizeof(AudioTapSlot), pcm, samples * sizeof(short));
+    }
+    slot->end.store(sequence + 1, std::memory_order_release);
+    position_[index] += samples / std::max<uint32_t>(stream.channels, 1);
+
+    stream.head.store(sequence + 1);
+    stream.notify.fetch_add(1);
+#ifdef __linux__
+    if (stream.waiters.load() > 0) {
+        FutexWakeAll(&stream.notify);
+        wakeups_.fetch_add(1, std::memory_order_relaxed);
+    }
+#endif
+}
+
+AudioTapStats AudioTap::GetStats() const {
+    AudioTapStats stats;
+    if (header_ != nullptr) {
+        for (size_t i = 0; i < kTapStreams; ++i) {
+            stats.frames[i] = header_->stream[i].head.load(std::memory_order_relaxed);
+        }
+    }
+    stats.wakeups = wakeups_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+AudioTapReader::~AudioTapReader() {
+    Close();
+}
+
+bool AudioTapReader::Open(const std::string& name, std::string* error) {
+    Close();
+    auto fail = [&](const std::string& message) {
+        if (error != nullptr) {
+            *error = name + ": " + message;
+        }
+        Close();
+        return false;
+    };
+    // 有写权限时读写打开，才能登记等待（waiters）；否则只读打开，Wait 退回轮询
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    writable_ = fd >= 0;
+    if (fd < 0) {
+        fd = shm_open(name.c_str(), O_RDONLY, 0);
+    }
+    if (fd < 0) {
+        return fail(strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < kHeaderSize) {
+        close(fd);
+        return fail("not an audio tap (too small)");
+    }
+    map_size_ = static_cast<size_t>(st.st_size);
+    map_ = mmap(nullptr, map_size_, writable_ ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map_ == MAP_FAILED) {
+        map_ = nullptr;
+        return fail(std::string("mmap failed: ") + strerror(errno));
+    }
+    header_ = static_cast<AudioTapHeader*>(map_);
+    base_ = static_cast<const unsigned char*>(map_);
+    if (memcmp(header_->magic, kAudioTapMagic, sizeof(header_->magic)) != 0) {
+        return fail("not an audio tap (or still being created)");
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header_->version != kAudioTapVersion || header_->streams != kTapStreams || header_->size != map_size_) {
+        return fail("unsupported audio tap layout");
+    }
+    for (size_t i = 0; i < kTapStreams; ++i) {
+        const AudioTapStreamHeader& stream = header_->stream[i];
+        uint64_t ring = static_cast<uint64_t>(stream.slots) * stream.slot_stride;
+        if (stream.slots == 0 || stream.slot_stride < sizeof(AudioTapSlot) + stream.slot_samples * sizeof(short) ||
+            stream.offset > map_size_ || ring > map_size_ - stream.offset) {
+            return fail("audio tap stream out of bounds");
+        }
+        next_[i] = stream.head.load(std::memory_order_acquire);  // 从最新的一帧开始
+        lost_[i] = 0;
+    }
+    return true;
+}
+
+void AudioTapReader::Close() {
+    if (map_ != nullptr) {
+        munmap(map_, map_size_);
+        map_ = nullptr;
+    }
+    header_ = nullptr;
+    base_ = nullptr;
+    writable_ = false;
+}
+
+bool AudioTapReader::Closed() const {
+    return header_ == nullptr || header_->closed.load(std::memory_order_acquire) != 0;
+}
+
+const AudioTapSlot* AudioTapReader::Slot(TapStream stream, uint64_t sequence) const {
+    const AudioTapStreamHeader& header = Stream(stream);
+    return reinterpret_cast<const AudioTapSlot*>(base_ + header.offset + (sequence % header.slots) * header.slot_stride);
+}
+
+bool AudioTapReader::Next(TapStream stream, TapFrame* frame) {
+    if (header_ == nullptr) {
+        return false;
+    }
+    size_t index = static_cast<size_t>(stream);
+    const AudioTapStreamHeader& header = Stream(stream);
+    uint64_t head = header.head.load(std::memory_order_acquire);
+    while (next_[index] < head) {
+        // 落后超过环的容量：跳到最旧的仍有效的一帧（留一个槽位给正在写入的帧）
+        if (head - next_[index] >= header.slots) {
+            uint64_t oldest = head - header.slots + 1;
+            lost_[index] += oldest - next_[index];
+            next_[index] = oldest;
+        }
+        uint64_t sequence = next_[index]++;
+        const AudioTapSlot* slot = Slot(stream, sequence);
+        if (slot->end.load(std::memory_order_acquire) != sequence + 1) {
+            lost_[index]++;  // 读取期间已被覆盖
+            continue;
+        }
+        uint32_t samples = std::min(slot->samples, header.slot_samples);
+        frame->flags = slot->flags;
+        frame->pcm = (slot->flags & kTapSilence) != 0
+                         ? nullptr
+                         : reinterpret_cast<const short*>(reinterpret_cast<const unsigned char*>(slot) +
+                                                          sizeof(AudioTapSlot));
+        frame->samples = samples;
+        frame->time_us = slot->time_us;
+        frame->position = slot->position;
+        frame->sequence = sequence;
+        if (!Valid(stream, *frame)) {
+            lost_[index]++;
+            continue;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool AudioTapReader::Valid(TapStream stream, const TapFrame& frame) const {
+    if (header_ == nullptr) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);  // 先读完数据，再检查 begin
+    return Slot(stream, frame.sequence)->begin.load(std::memory_order_relaxed) == frame.sequence + 1;
+}
+
+bool AudioTapReader::Wait(TapStream stream, int timeout_ms) {
+    if (header_ == nullptr) {
+        return false;
+    }
+    size_t index = static_cast<size_t>(stream);
+    auto* header = &header_->stream[index];
+    auto ready = [&]() { return header->head.load() > next_[index] || Closed(); };
+    if (ready()) {
+        return !Closed();
+    }
+#ifdef __linux__
+    if (writable_) {
+        header->waiters.fetch_add(1);
+        uint32_t seen = header->notify.load();
+        if (!ready()) {
+            FutexWait(&header->notify, seen, timeout_ms);
+        }
+        header->waiters.fetch_sub(1);
+        return ready() && !Closed();
+    }
+#endif
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (!ready() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    return ready() && !Closed();
+}
+
+}  // namespace linx
@@ -0,0 +1,140 @@
+#include "DriftCompensator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace linx {
+
+DriftCompensator::DriftCompensator(const DriftCompensatorConfig& config, Source source)
+    : config_(config), source_(std::move(source)) {
+    channels_ = static_cast<size_t>(std::max(1, config_.channels));
+    max_frames_ = std::max<size_t>(1, config_.max_period_samples / channels_);
+    // 一次 Pull 最多消耗 max_frames_ × 最大速率比 帧，另加插值需要的前后各几帧
+    size_t capacity = static_cast<size_t>(max_frames_ * (1.0 + config_.max_ppm * 1e-6)) + 8;
+    hist_.assign(capacity * channels_, 0);
+}
+
+short DriftCompensator::Interpolate(short x0, short x1, short x2, short x3, float t) {
+    float a = x0;
+    float b = x1;
+    float c = x2;
+    float d = x3;
+    float y = b + 0.5f * t * (c - a + t * (2.0f * a - 5.0f * b + 4.0f * c - d + t * (3.0f * (b - c) + d - a)));
+    return static_cast<short>(std::lrint(std::min(32767.0f, std::max(-32768.0f, y))));
+}
+
+size_t DriftCompensator::FlushHistory(short* out, size_t frames) {
+    size_t n = std::min(frames, hist_frames_ - 1);
+    if (n == 0) {
+        return 0;
+    }
+    memcpy(out, &hist_[channels_], n * channels_ * sizeof(short));
+    // 最后输出的一帧成为新的“前一帧”，下一段从它开始插值
+    memmove(hist_.data(), &hist_[n * channels_], (hist_frames_ - n) * channels_ * sizeof(short));
+    hist_frames_ -= n;
+    pos_ = 0;
+    return n;
+}
+
+size_t DriftCompensator::Pull(short* out, size_t samples) {
+    const size_t frames = std::min(samples / channels_, max_frames_);
+    if (frames == 0) {
+        return 0;
+    }
+    const double ratio = ratio_;
+    // 输出第 k 帧位于 hist_[1] 之后 pos_ + k × ratio 处，插值需要它前一帧和后两帧；
+    // 逐帧累加的位置与乘法算出的可能差一点越过整数边界，多取一帧，避免有数据时少输出一帧
+    size_t need = static_cast<size_t>(pos_ + (frames - 1) * ratio) + 5;
+    need = std::min(need, hist_.size() / channels_);
+    bool short_read = false;
+    if (need > hist_frames_) {
+        size_t want = (need - hist_frames_) * channels_;
+        size_t got = source_(&hist_[hist_frames_ * channels_], want);
+        hist_frames_ += got / channels_;
+        short_read = got < want;
+    }
+
+    size_t produced = 0;
+    double p = pos_;
+    while (produced < frames) {
+        size_t i = static_cast<size_t>(p);
+        if (i + 4 > hist_frames_) {
+            break;
+        }
+        float t = static_cast<float>(p - static_cast<double>(i));
+        const short* x = &hist_[i * channels_];
+        short* y = out + produced * channels_;
+        for (size_t c = 0; c < channels_; c++) {
+            y[c] = Interpolate(x[c], x[channels_ + c], x[2 * channels_ + c], x[3 * channels_ + c], t);
+        }
+        produced++;
+        p += ratio;
+    }
+    if (produced > 0) {
+        size_t consumed = std::min(static_cast<size_t>(p), hist_frames_ - 1);
+        pos_ = p - static_cast<double>(consumed);
+        memmove(hist_.data(), &hist_[consumed * channels_], (hist_frames_ - consumed) * channels_ * sizeof(short));
+        hist_frames_ -= consumed;
+        adjusted_frames_.fetch_add(static_cast<int64_t>(consumed) - static_cast<int64_t>(produced),
+                                   std::memory_order_relaxed);
+    }
+    if (short_read) {
+        // 数据源断流：剩下的几帧直接播出，下一段开头不会混入这一段的尾巴
+        produced += FlushHistory(out + produced * channels_, frames - produced);
+    }
+    return produced * channels_;
+}
+
+void DriftCompensator::Update(double depth_ms, double target_ms, double dt_s, bool playing) {
+    if (!playing || dt_s <= 0) {
+        was_playing_ = false;
+        return;
+    }
+    const double error = depth_ms - target_ms;
+    if (!was_playing_) {
+        // 新的一段从攒够的起播深度开始，误差重新起算，时钟偏差估计保留
+        error_ms_ = error;
+        was_playing_ = true;
+    } else {
+        error_ms_ += std::min(1.0, dt_s / config_.smoothing_s) * (error - error_ms_);
+    }
+
+    double effective = 0;
+    if (error_ms_ > config_.deadband_ms) {
+        effective = error_ms_ - config_.deadband_ms;
+    } else if (error_ms_ < -config_.deadband_ms) {
+        effective = error_ms_ + config_.deadband_ms;
+    }
+    const double proportional = config_.proportional_ppm_per_ms * effective;
+    if (std::fabs(error_ms_) < config_.integral_window_ms) {
+        drift_ppm_ += config_.proportional_ppm_per_ms * error_ms_ * dt_s / config_.integral_s;
+        drift_ppm_ = std::max(-config_.drift_limit_ppm, std::min(config_.drift_limit_ppm, drift_ppm_));
+    }
+    const double correction = std::max(-config_.max_ppm, std::min(config_.max_ppm, proportional + drift_ppm_));
+    ratio_ = 1.0 + correction * 1e-6;
+
+    correction_ppm_.store(correction, std::memory_order_relaxed);
+    drift_ppm_out_.store(drift_ppm_, std::memory_order_relaxed);
+    error_ms_out_.store(error_ms_, std::memory_order_relaxed);
+    updates_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DriftCompensator::Reset() {
+    std::fill(hist_.begin(), hist_.begin() + static_cast<std::ptrdiff_t>(channels_), 0);
+    hist_frames_ = 1;
+    pos_ = 0;
+    was_playing_ = false;
+}
+
+DriftCompensatorStats DriftCompensator::GetStats() const {
+    DriftCompensatorStats stats;
+    stats.correction_ppm = correction_ppm_.load(std::memory_order_relaxed);
+    stats.drift_ppm = drift_ppm_out_.load(std::memory_order_relaxed);
+    stats.depth_error_ms = error_ms_out_.load(std::memory_order_relaxed);
+    stats.adjusted_frames = adjusted_frames_.load(std::memory_order_relaxed);
+    stats.updates = updates_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace linx
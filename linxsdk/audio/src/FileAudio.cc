@@ -0,0 +1,399 @@
+#include "FileAudio.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include "Log.h"
+#include "OggOpus.h"
+#include "Opus.h"
+#include "Resampler.h"
+#include "Tracepoints.h"
+
+namespace linx {
+
+FileAudio::FileAudio(const FileAudioConfig& config) : config_(config) {}
+
+FileAudio::~FileAudio() { Close(); }
+
+void FileAudio::SetConfig(unsigned int sample_rate, int frame_size, int channels, int periods, int buffer_size,
+                          int period_size) {
+    sample_rate_ = sample_rate;
+    channels_ = channels;
+    buffer_frames_ = static_cast<size_t>(std::max(buffer_size, period_size));
+}
+
+void FileAudio::Init() {
+    if (buffer_frames_ == 0) {
+        buffer_frames_ = sample_rate_ / 10;  // 未调用 SetConfig 时按 100ms 设备缓冲
+    }
+    queue_.assign(buffer_frames_ * channels_, 0);
+    silence_.assign(1024 * channels_, 0);
+    if (!config_.capture_path.empty()) {
+        LoadCapture();
+    }
+    if (!config_.playback_path.empty()) {
+        if (output_.wavfopen(config_.playback_path, "wb") != 0 || !output_.valid()) {
+            throw std::runtime_error("无法创建播放输出文件: " + config_.playback_path);
+        }
+        output_open_ = true;
+    }
+    INFO("FileAudio: capture {} ({:.1f}s), playback {}, {} mode", config_.capture_path.empty() ? "<silence>"
+                                                                                         : config_.capture_path,
+         static_cast<double>(CaptureFrames()) / sample_rate_,
+         config_.playback_path.empty() ? "<discard>" : config_.playback_path,
+         config_.realtime ? "realtime" : "fast");
+}
+
+namespace {
+
+bool EndsWith(const std::string& s, const char* suffix) {
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+}  // namespace
+
+void FileAudio::LoadCapture() {
+    if (EndsWith(config_.capture_path, ".opus") || EndsWith(config_.capture_path, ".ogg")) {
+        LoadOpusCapture();
+        return;
+    }
+    // 映射输入文件按块转换声道，不再先把整段原始数据读进内存
+    PcmReader input;
+    if (input.open(config_.capture_path) != 0) {
+        throw std::runtime_error("无法读取采集输入文件: " + config_.capture_path);
+    }
+    const WavInfo& fmt = input.info();
+    if ((fmt.audioFormat != 1 && fmt.audioFormat != 0xFFFE) || fmt.bitsPerSample != 16 ||
+        fmt.blockAlign != std::max(1, fmt.numChannels) * 2) {
+        throw std::runtime_error("采集输入文件不是16-bit PCM: " + config_.capture_path);
+    }
+    int src_channels = std::max<int>(1, fmt.numChannels);
+    size_t src_frames = fmt.dataSize / fmt.blockAlign;
+
+    // 声道转换：输出单声道时取各声道平均；否则每个输出声道取对应的输入声道（不足时取最后一个）
+    constexpr size_t kReadFrames = 4096;
+    std::vector<short> raw(kReadFrames * src_channels);
+    std::vector<short> converted(src_frames * channels_);
+    size_t frame_index = 0;
+    while (size_t bytes = input.readChunk(raw.data(), raw.size() * sizeof(short))) {
+        size_t frames = bytes / fmt.blockAlign;
+        for (size_t i = 0; i < frames; ++i, ++frame_index) {
+            const short* in = &raw[i * src_channels];
+            short* out = &converted[frame_index * channels_];
+            if (channels_ == 1 && src_channels > 1) {
+                int sum = 0;
+                for (int c = 0; c < src_channels; ++c) {
+                    sum += in[c];
+                }
+                out[0] = static_cast<short>(sum / src_channels);
+            } else {
+                for (int c = 0; c < channels_; ++c) {
+                    out[c] = in[std::min(c, src_channels - 1)];
+                }
+            }
+        }
+    }
+    converted.resize(frame_index * channels_);
+    SetCapture(std::move(converted), fmt.sampleRate);
+}
+
+void FileAudio::LoadOpusCapture() {
+    // 会话录音等 Ogg/Opus 文件：逐包解码，解码器直接输出设备声道数
+    OggOpusReader input;
+    if (input.open(config_.capture_path) != 0) {
+        throw std::runtime_error("无法读取采集输入文件: " + config_.capture_path);
+    }
+    unsigned int rate = 48000;  // 解码器只支持 8/12/16/24/48kHz，其他采样率解码到 48kHz 后重采样
+    for (unsigned int r : {8000u, 12000u, 16000u, 24000u}) {
+        if (sample_rate_ == r) {
+            rate = r;
+        }
+    }
+    int err = OPUS_OK;
+    OpusDecoder* decoder = opus_decoder_create(rate, channels_, &err);
+    if (err != OPUS_OK) {
+        throw std::runtime_error("创建Opus解码器失败: " + config_.capture_path);
+    }
+    std::vector<short> pcm(rate * 120 / 1000 * channels_);  // 单包最长 120ms
+    std::vector<short> decoded;
+    size_t errors = 0;
+    std::string_view packet;
+    while (input.readPacket(&packet)) {
+        int frames = opus_decode(decoder, reinterpret_cast<const unsigned char*>(packet.data()),
+                                 static_cast<opus_int32>(packet.size()), pcm.data(),
+                                 static_cast<int>(pcm.size() / channels_), 0);
+        if (frames < 0) {
+            errors++;
+            continue;
+        }
+        decoded.insert(decoded.end(), pcm.begin(), pcm.begin() + static_cast<size_t>(frames) * channels_);
+    }
+    opus_decoder_destroy(decoder);
+    // 去掉编码器前瞻
+    size_t skip = std::min(decoded.size(), static_cast<size_t>(input.info().preSkip) * rate / 48000 * channels_);
+    decoded.erase(decoded.begin(), decoded.begin() + skip);
+    if (errors > 0 || input.corruptPages() > 0) {
+        WARN("FileAudio: {} undecodable packets, {} corrupt pages in {}", errors, input.corruptPages(),
+             config_.capture_path);
+    }
+    SetCapture(std::move(decoded), rate);
+}
+
+void FileAudio::SetCapture(std::vector<short> converted, unsigned int src_rate) {
+    size_t src_frames = converted.size() / channels_;
+    if (src_rate == sample_rate_) {
+        capture_ = std::move(converted);
+        return;
+    }
+    constexpr size_t kChunk = 4096;
+    Resampler resampler(src_rate, sample_rate_, channels_, kChunk);
+    std::vector<short> out(resampler.MaxOutputFrames(kChunk) * channels_);
+    capture_.clear();
+    capture_.reserve(src_frames * sample_rate_ / src_rate * channels_ + out.size());
+    for (size_t pos = 0; pos < src_frames; pos += kChunk) {
+        size_t n = std::min(kChunk, src_frames - pos);
+        size_t produced = resampler.Process(&converted[pos * channels_], n, out.data(), out.size() / channels_);
+        capture_.insert(capture_.end(), out.begin(), out.begin() + produced * channels_);
+    }
+    INFO("FileAudio: resampled {} from {}Hz to {}Hz", config_.capture_path, src_rate, sample_rate_);
+}
+
+void FileAudio::StartClock() {
+    std::call_once(start_once_, [this]() {
+        start_ = std::chrono::steady_clock::now();
+        started_.store(true, std::memory_order_release);
+    });
+}
+
+void FileAudio::Record() { StartClock(); }
+
+void FileAudio::Play() { StartClock(); }
+
+uint64_t FileAudio::NowFrames() const {
+    if (!started_.load(std::memory_order_acquire)) {
+        return 0;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_);
+    return static_cast<uint64_t>(elapsed.count()) * sample_rate_ / 1000000000ull;
+}
+
+void FileAudio::WaitUntilFrame(uint64_t frame) const {
+    if (!config_.realtime) {
+        return;
+    }
+    auto offset = std::chrono::nanoseconds(frame * 1000000000ull / sample_rate_);
+    std::this_thread::sleep_until(start_ + offset);
+}
+
+bool FileAudio::Read(short* buffer, size_t frame_size) {
+    LINX_PROBE_SCOPE(audio_read, frame_size);
+    StartClock();
+    uint64_t pos = captured_.load(std::memory_order_relaxed);
+    WaitUntilFrame(pos + frame_size);
+
+    size_t total = CaptureFrames();
+    size_t done = 0;
+    while (done < frame_size) {
+        uint64_t at = pos + done;
+        if (config_.loop && total > 0) {
+            at %= total;
+        }
+        size_t n = at < total ? std::min<size_t>(frame_size - done, total - at) : frame_size - done;
+        if (at < total) {
+            memcpy(buffer + done * channels_, &capture_[at * channels_], n * channels_ * sizeof(short));
+        } else {
+            memset(buffer + done * channels_, 0, n * channels_ * sizeof(short));
+        }
+        done += n;
+    }
+    captured_.store(pos + frame_size, std::memory_order_relaxed);
+    return true;
+}
+
+bool FileAudio::CaptureDone() const {
+    return !config_.loop && captured_.load(std::memory_order_relaxed) >= CaptureFrames();
+}
+
+void FileAudio::WriteOut(const short* pcm, size_t frames) {
+    if (output_open_ && frames > 0) {
+        output_.fwrite(const_cast<short*>(pcm), sizeof(short) * channels_, static_cast<int>(frames));
+    }
+    played_ += frames;
+}
+
+void FileAudio::WriteSilence(size_t frames) {
+    size_t chunk = silence_.size() / channels_;
+    while (frames > 0) {
+        size_t n = std::min(chunk, frames);
+        WriteOut(silence_.data(), n);
+        frames -= n;
+    }
+}
+
+void FileAudio::AdvancePlayback(uint64_t now) {
+    if (played_ >= now) {
+        return;
+    }
+    size_t n = static_cast<size_t>(std::min<uint64_t>(queue_count_, now - played_));
+    while (n > 0) {
+        size_t segment = std::min(n, buffer_frames_ - queue_head_);
+        WriteOut(&queue_[queue_head_ * channels_], segment);
+        queue_head_ = (queue_head_ + segment) % buffer_frames_;
+        queue_count_ -= segment;
+        n -= segment;
+    }
+    if (played_ < now) {
+        // 虚拟缓冲区已空：设备照常运行，输出静音。开始播放之前的静音只是时间轴的前导，不计为欠载
+        size_t gap = static_cast<size_t>(now - played_);
+        if (has_played_) {
+            padded_ += gap;
+            if (!starving_) {
+                underruns_++;  // 连续的补静音只算一次欠载
+                starving_ = true;
+            }
+        }
+        WriteSilence(gap);
+    }
+}
+
+bool FileAudio::Write(short* buffer, size_t frame_size) {
+    LINX_PROBE_SCOPE(audio_write, frame_size);
+    std::unique_lock<ProfiledMutex> lock(playback_mutex_);
+    if (!config_.realtime) {
+        WriteOut(buffer, frame_size);
+        return true;
+    }
+    StartClock();
+    AdvancePlayback(NowFrames());
+    auto enter = std::chrono::steady_clock::now();
+    if (config_.playout_timing) {
+        if (writes_ > 0) {
+            write_interval_us_.Record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(enter - last_write_).count()));
+        } else {
+            last_report_ = enter;
+        }
+        if (has_played_) {
+            min_buffered_ = std::min<uint64_t>(min_buffered_, queue_count_);
+        }
+        last_write_ = enter;
+        writes_++;
+    }
+
+    size_t done = 0;
+    bool blocked = false;
+    while (done < frame_size) {
+        // 缓冲区装不下时等到设备播出足够的数据，与真实设备的阻塞写入一致
+        size_t n = std::min(frame_size - done, buffer_frames_);
+        while (queue_count_ + n > buffer_frames_) {
+            uint64_t target = played_ + (queue_count_ + n - buffer_frames_);
+            blocked = true;
+            lock.unlock();
+            WaitUntilFrame(target);
+            lock.lock();
+            AdvancePlayback(NowFrames());
+        }
+        starving_ = false;
+        size_t tail = (queue_head_ + queue_count_) % buffer_frames_;
+        size_t left = n;
+        const short* src = buffer + done * channels_;
+        while (left > 0) {
+            size_t segment = std::min(left, buffer_frames_ - tail);
+            memcpy(&queue_[tail * channels_], src, segment * channels_ * sizeof(short));
+            src += segment * channels_;
+            tail = (tail + segment) % buffer_frames_;
+            queue_count_ += segment;
+            left -= segment;
+        }
+        done += n;
+    }
+    has_played_ = true;
+    if (!config_.playout_timing) {
+        return true;
+    }
+    auto leave = std::chrono::steady_clock::now();
+    if (blocked) {
+        write_block_us_.Record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(leave - enter).count()));
+    }
+    bool report = config_.report_interval_ms > 0 &&
+                  leave - last_report_ >= std::chrono::milliseconds(config_.report_interval_ms);
+    if (report) {
+        last_report_ = leave;
+    }
+    lock.unlock();
+    if (report) {
+        ReportPlayoutTiming();
+    }
+    return true;
+}
+
+void FileAudio::ReportPlayoutTiming() {
+    FileAudioStats stats = GetStats();
+    INFO("sink: {} writes, interval p50 {}us p99 {}us max {}us, blocked p99 {}us, min buffered {} frames, "
+         "{} underruns ({} frames padded)",
+         stats.writes, stats.write_interval.p50_us, stats.write_interval.p99_us, stats.write_interval.max_us,
+         stats.write_block.p99_us, stats.min_buffered_frames, stats.underruns, stats.padded_frames);
+}
+
+long FileAudio::GetPlaybackDelay() {
+    if (!config_.realtime) {
+        // 快速模式没有设备时钟：报告缓冲区已满，调用方不会为防欠载补静音
+        return static_cast<long>(buffer_frames_);
+    }
+    std::lock_guard<ProfiledMutex> lock(playback_mutex_);
+    AdvancePlayback(NowFrames());
+    return static_cast<long>(queue_count_);
+}
+
+bool FileAudio::DropPlayback() {
+    std::lock_guard<ProfiledMutex> lock(playback_mutex_);
+    if (config_.realtime) {
+        AdvancePlayback(NowFrames());
+    }
+    dropped_ += queue_count_;
+    queue_head_ = 0;
+    queue_count_ = 0;
+    return true;
+}
+
+void FileAudio::Close() {
+    std::lock_guard<ProfiledMutex> lock(playback_mutex_);
+    while (queue_count_ > 0) {
+        size_t segment = std::min(queue_count_, buffer_frames_ - queue_head_);
+        WriteOut(&queue_[queue_head_ * channels_], segment);
+        queue_head_ = (queue_head_ + segment) % buffer_frames_;
+        queue_count_ -= segment;
+    }
+    if (output_open_) {
+        output_.wavfclose(static_cast<int>(played_ * channels_ * sizeof(short)), channels_, sample_rate_);
+        output_open_ = false;
+    }
+}
+
+AudioXrunStats FileAudio::GetXrunStats() const {
+    std::lock_guard<ProfiledMutex> lock(playback_mutex_);
+    AudioXrunStats stats;
+    stats.playback_xruns = underruns_;
+    return stats;
+}
+
+FileAudioStats FileAudio::GetStats() const {
+    std::lock_guard<ProfiledMutex> lock(playback_mutex_);
+    FileAudioStats stats;
+    stats.captured_frames = captured_.load(std::memory_order_relaxed);
+    stats.played_frames = played_;
+    stats.padded_frames = padded_;
+    stats.dropped_frames = dropped_;
+    stats.underruns = underruns_;
+    stats.writes = writes_;
+    stats.min_buffered_frames = min_buffered_ == UINT64_MAX ? 0 : min_buffered_;
+    stats.write_interval = write_interval_us_.Summarize();
+    stats.write_block = write_block_us_.Summarize();
+    return stats;
+}
+
+}  // namespace linx
@@ -0,0 +1,84 @@
+#include "FramePool.h"
+
+#include <algorithm>
+
+namespace linx {
+
+namespace {
+
+constexpr size_t kCacheLineSamples = 64 / sizeof(short);
+
+}  // namespace
+
+FramePool::FramePool(size_t frames, size_t samples_per_frame)
+    : count_(std::max<size_t>(frames, 1)), samples_per_frame_(std::max<size_t>(samples_per_frame, 1)) {
+    // 每帧缓冲区按 cache line 对齐，不同线程同时写相邻两帧时不会伪共享
+    stride_ = (samples_per_frame_ + kCacheLineSamples - 1) / kCacheLineSamples * kCacheLineSamples;
+    storage_ = MakeTaggedArray<short, MemoryTag::Audio>(count_ * stride_ + kCacheLineSamples);
+    short* base = storage_.get();
+    size_t misalign = reinterpret_cast<uintptr_t>(base) % 64 / sizeof(short);
+    if (misalign != 0) {
+        base += kCacheLineSamples - misalign;
+    }
+    frames_ = MakeTaggedArray<AudioFrame, MemoryTag::Audio>(count_);
+    for (size_t i = 0; i < count_; ++i) {
+        AudioFrame& frame = frames_[i];
+        frame.data = base + i * stride_;
+        frame.capacity = samples_per_frame_;
+        frame.pool = this;
+        frame.next.store(i + 1 < count_ ? static_cast<uint32_t>(i + 1) : kNone, std::memory_order_relaxed);
+    }
+    head_.store(Pack(0, 0), std::memory_order_release);
+}
+
+FrameRef FramePool::Acquire() {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    for (;;) {
+        uint32_t index = static_cast<uint32_t>(head);
+        if (index == kNone) {
+            exhausted_.fetch_add(1, std::memory_order_relaxed);
+            return FrameRef();
+        }
+        // 读到的 next 可能已被其他线程改掉，此时表头的版本号也变了，CAS 会失败重试
+        uint32_t next = frames_[index].next.load(std::memory_order_relaxed);
+        if (head_.compare_exchange_weak(head, Pack(static_cast<uint32_t>(head >> 32) + 1, next),
+                                        std::memory_order_acquire, std::memory_order_acquire)) {
+            AudioFrame* frame = &frames_[index];
+            frame->samples = 0;
+            frame->timestamp_us = 0;
+            frame->refs.store(1, std::memory_order_relaxed);
+            acquired_.fetch_add(1, std::memory_order_relaxed);
+            size_t in_use = in_use_.fetch_add(1, std::memory_order_relaxed) + 1;
+            size_t high = high_water_.load(std::memory_order_relaxed);
+            while (in_use > high && !high_water_.compare_exchange_weak(high, in_use, std::memory_order_relaxed)) {
+            }
+            return FrameRef(frame);
+        }
+    }
+}
+
+void FramePool::Release(AudioFrame* frame) {
+    uint32_t index = static_cast<uint32_t>(frame - frames_.get());
+    in_use_.fetch_sub(1, std::memory_order_relaxed);
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    for (;;) {
+        frame->next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        // release：帧里的样本写入先于它重新出现在空闲链表上
+        if (head_.compare_exchange_weak(head, Pack(static_cast<uint32_t>(head >> 32) + 1, index),
+                                        std::memory_order_release, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+FramePoolStats FramePool::GetStats() const {
+    FramePoolStats stats;
+    stats.acquired = acquired_.load(std::memory_order_relaxed);
+    stats.exhausted = exhausted_.load(std::memory_order_relaxed);
+    stats.in_use = in_use_.load(std::memory_order_relaxed);
+    stats.high_water = high_water_.load(std::memory_order_relaxed);
+    stats.frames = count_;
+    return stats;
+}
+
+}  // namespace linx
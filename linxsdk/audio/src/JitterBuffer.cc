@@ -0,0 +1,437 @@
+#include "JitterBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Tracepoints.h"
+
+namespace linx {
+
+JitterBuffer::JitterBuffer(const JitterBufferConfig& config)
+    : config_(config), ring_(config.capacity_samples) {
+    config_.min_delay_ms = std::max(0, config_.min_delay_ms);
+    config_.max_delay_ms = std::max(config_.min_delay_ms, config_.max_delay_ms);
+    config_.start_threshold_ms = std::min(std::max(0, config_.start_threshold_ms), config_.max_delay_ms);
+    target_delay_ms_ =
+        std::min(std::max(config_.initial_delay_ms, config_.min_delay_ms), config_.max_delay_ms);
+    min_delay_ms_ = config_.min_delay_ms;
+    max_delay_ms_ = config_.max_delay_ms;
+    start_threshold_ms_ = config_.start_threshold_ms;
+}
+
+void JitterBuffer::SetDelayLimits(int min_delay_ms, int max_delay_ms, int start_threshold_ms) {
+    min_delay_ms = std::max(0, min_delay_ms);
+    max_delay_ms = std::max(min_delay_ms, max_delay_ms);
+    start_threshold_ms = std::min(std::max(0, start_threshold_ms), max_delay_ms);
+    min_delay_ms_.store(min_delay_ms, std::memory_order_relaxed);
+    max_delay_ms_.store(max_delay_ms, std::memory_order_relaxed);
+    start_threshold_ms_.store(start_threshold_ms, std::memory_order_relaxed);
+    // 当前目标立即收进新的范围，下一帧到达时再按抖动估计重新计算
+    int target = target_delay_ms_.load(std::memory_order_relaxed);
+    target_delay_ms_.store(std::min(std::max(target, min_delay_ms), max_delay_ms), std::memory_order_relaxed);
+}
+
+size_t JitterBuffer::MsToSamples(int ms) const {
+    return static_cast<size_t>(config_.sample_rate) * ms / 1000 * config_.channels;
+}
+
+size_t JitterBuffer::UsToSamples(uint64_t us) const {
+    return static_cast<size_t>(us * config_.sample_rate / 1000000) * config_.channels;
+}
+
+size_t JitterBuffer::StartSamples() const {
+    return MsToSamples(std::max(target_delay_ms_.load(std::memory_order_relaxed),
+                                start_threshold_ms_.load(std::memory_order_relaxed)));
+}
+
+size_t JitterBuffer::WantedDepth() const {
+    if (playing_.load(std::memory_order_relaxed)) {
+        return MsToSamples(target_delay_ms_.load(std::memory_order_relaxed));
+    }
+    return StartSamples();
+}
+
+// 按媒体时间计算每帧相对于本段起点的到达延迟，延迟的离散程度即为需要的缓冲量。
+// 快速跟随变大、缓慢回落，避免网络偶发抖动时目标深度来回振荡。
+void JitterBuffer::UpdateJitter(size_t samples) {
+    auto now = arrival_us_ == 0
+                   ? std::chrono::steady_clock::now()
+                   : std::chrono::steady_clock::time_point(std::chrono::microseconds(arrival_us_));
+    arrival_us_ = 0;
+    double frame_ms = 1000.0 * samples / (config_.sample_rate * config_.channels);
+
+    if (!has_arrival_ || restart_spurt_.exchange(false, std::memory_order_relaxed) ||
+        std::chrono::duration<double, std::milli>(now - last_arrival_).count() > config_.spurt_gap_ms) {
+        // 新的一段 TTS，重新建立到达基准
+        spurt_start_ = now;
+        media_ms_ = 0;
+        min_relative_ms_ = 0;
+        has_arrival_ = true;
+    } else {
+        double elapsed_ms = std::chrono::duration<double, std::milli>(now - spurt_start_).count();
+        double relative_ms = elapsed_ms - media_ms_;
+        min_relative_ms_ = std::min(min_relative_ms_, relative_ms);
+        double spread_ms = relative_ms - min_relative_ms_;
+        if (spread_ms > jitter_ms_) {
+            jitter_ms_ += (spread_ms - jitter_ms_) / 4;
+        } else {
+            jitter_ms_ += (spread_ms - jitter_ms_) / 64;
+        }
+    }
+
+    last_arrival_ = now;
+    media_ms_ += frame_ms;
+
+    int target = static_cast<int>(frame_ms + 2 * jitter_ms_);
+    target = std::min(std::max(target, min_delay_ms_.load(std::memory_order_relaxed)),
+                      max_delay_ms_.load(std::memory_order_relaxed));
+    target_delay_ms_.store(target, std::memory_order_relaxed);
+    jitter_snapshot_ms_.store(jitter_ms_, std::memory_order_relaxed);
+}
+
+void JitterBuffer::OnArrival(size_t samples) {
+    UpdateJitter(samples);
+    frames_in_.fetch_add(1, std::memory_order_relaxed);
+
+    // 播放端已经欠载，这一帧来迟了
+    if (starving_.exchange(false, std::memory_order_relaxed)) {
+        late_frames_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void JitterBuffer::CommitWrite(size_t samples) {
+    if (samples == 0) {
+        return;
+    }
+    OnArrival(samples);
+    ring_.CommitWrite(samples);
+    PushMarker();
+    TraceFrame(TraceStage::JitterPush, samples);
+}
+
+void JitterBuffer::TraceFrame(TraceStage stage, size_t samples) {
+    LINX_PROBE(jitter, static_cast<int>(stage), samples, ring_.Size());
+    if (frame_trace_) {
+        frame_trace_->Record(stage, samples * sizeof(short), ring_.Size());
+    }
+}
+
+void JitterBuffer::PushMarker() {
+    if (!tracer_) {
+        return;
+    }
+    size_t tail = marker_tail_.load(std::memory_order_relaxed);
+    if (tail - marker_head_.load(std::memory_order_acquire) >= kMarkers) {
+        return;
+    }
+    markers_[tail % kMarkers] = Marker{ring_.WritePosition(), LatencyTracer::NowUs()};
+    marker_tail_.store(tail + 1, std::memory_order_release);
+}
+
+// 消费者：弹出已被完整取出的帧的标记；record 为 false 时（Flush 丢弃的帧）不计入直方图
+void JitterBuffer::PopMarkers(bool record) {
+    if (!tracer_) {
+        return;
+    }
+    size_t read = ring_.ReadPosition();
+    size_t head = marker_head_.load(std::memory_order_relaxed);
+    size_t tail = marker_tail_.load(std::memory_order_acquire);
+    uint64_t now = 0;
+    while (head != tail) {
+        const Marker& marker = markers_[head % kMarkers];
+        if (static_cast<ptrdiff_t>(read - marker.position) < 0) {
+            break;
+        }
+        if (record) {
+            now = now == 0 ? LatencyTracer::NowUs() : now;
+            tracer_->Record(LatencyStage::BufferResidence, now > marker.arrival_us ? now - marker.arrival_us : 0);
+        }
+        ++head;
+    }
+    marker_head_.store(head, std::memory_order_release);
+}
+
+size_t JitterBuffer::Push(const short* pcm, size_t samples) {
+    if (samples == 0) {
+        return 0;
+    }
+    OnArrival(samples);
+
+    size_t written = ring_.Write(pcm, samples);
+    if (written < samples) {
+        dropped_samples_.fetch_add(samples - written, std::memory_order_relaxed);
+    }
+    if (written > 0) {
+        PushMarker();
+        TraceFrame(TraceStage::JitterPush, written);
+    }
+    return written;
+}
+
+void JitterBuffer::MarkEndOfStream() {
+    end_mark_.store(ring_.WritePosition() + 1, std::memory_order_release);
+}
+
+bool JitterBuffer::EndBuffered() const {
+    size_t mark = end_mark_.load(std::memory_order_acquire);
+    return mark != 0 && static_cast<ptrdiff_t>(mark - 1 - ring_.ReadPosition()) > 0;
+}
+
+bool JitterBuffer::EndReached() const {
+    size_t mark = end_mark_.load(std::memory_order_acquire);
+    return mark != 0 && static_cast<ptrdiff_t>(ring_.ReadPosition() - (mark - 1)) >= 0;
+}
+
+// 消费者：本段正常结束，回到缓冲状态。只清除已播到的段尾标记，生产者同时写入的新标记保留
+void JitterBuffer::FinishStream() {
+    size_t mark = end_mark_.load(std::memory_order_acquire);
+    if (mark != 0 && static_cast<ptrdiff_t>(ring_.ReadPosition() - (mark - 1)) >= 0) {
+        end_mark_.compare_exchange_strong(mark, 0, std::memory_order_relaxed);
+    }
+    if (playing_.exchange(false, std::memory_order_relaxed)) {
+        drained_.fetch_add(1, std::memory_order_relaxed);
+    }
+    gap_ = false;
+    concealed_in_gap_ = 0;
+}
+
+void JitterBuffer::FlushTo(size_t position) {
+    flush_position_.store(position, std::memory_order_relaxed);
+    restart_spurt_.store(true, std::memory_order_relaxed);
+    flush_pending_.store(true, std::memory_order_release);
+    flushes_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void JitterBuffer::ApplyFlush() {
+    if (!flush_pending_.exchange(false, std::memory_order_acquire)) {
+        return;
+    }
+    size_t dropped = ring_.DiscardTo(flush_position_.load(std::memory_order_relaxed));
+    flushed_samples_.fetch_add(dropped, std::memory_order_relaxed);
+    PopMarkers(false);
+    playing_.store(false, std::memory_order_relaxed);
+    starving_.store(false, std::memory_order_relaxed);
+    // 落在被丢弃范围内的段尾和截断一并作废
+    size_t read = ring_.ReadPosition();
+    size_t mark = end_mark_.load(std::memory_order_acquire);
+    if (mark != 0 && static_cast<ptrdiff_t>(read - (mark - 1)) >= 0) {
+        end_mark_.compare_exchange_strong(mark, 0, std::memory_order_relaxed);
+    }
+    if (truncate_pending_.load(std::memory_order_acquire) &&
+        static_cast<ptrdiff_t>(read - truncate_position_.load(std::memory_order_relaxed)) >= 0) {
+        truncate_pending_.store(false, std::memory_order_relaxed);
+    }
+    gap_ = false;
+    concealed_in_gap_ = 0;
+}
+
+void JitterBuffer::Truncate(size_t position) {
+    truncate_position_.store(position, std::memory_order_relaxed);
+    truncate_pending_.store(true, std::memory_order_release);
+}
+
+size_t JitterBuffer::ApplyTruncate(size_t samples) {
+    if (!truncate_pending_.load(std::memory_order_acquire)) {
+        return samples;
+    }
+    ptrdiff_t remaining =
+        static_cast<ptrdiff_t>(truncate_position_.load(std::memory_order_relaxed) - ring_.ReadPosition());
+    if (remaining > 0) {
+        return std::min(samples, static_cast<size_t>(remaining));
+    }
+    // 已播到截断位置：之后的数据不再播放
+    size_t dropped = ring_.DiscardTo(ring_.WritePosition());
+    flushed_samples_.fetch_add(dropped, std::memory_order_relaxed);
+    PopMarkers(false);
+    truncate_pending_.store(false, std::memory_order_relaxed);
+    FinishStream();
+    return 0;
+}
+
+size_t JitterBuffer::Pop(short* out, size_t samples) {
+    ApplyFlush();
+    samples = ApplyTruncate(samples);
+    if (samples == 0) {
+        return 0;
+    }
+    size_t depth = ring_.Size();
+
+    // 超过最大延迟：丢弃最旧的数据，回到目标深度
+    size_t max_samples = MsToSamples(max_delay_ms_.load(std::memory_order_relaxed));
+    if (config_.trim_to_max_delay && depth > max_samples) {
+        size_t skipped = Skip(depth - MsToSamples(target_delay_ms_.load(std::memory_order_relaxed)));
+        dropped_samples_.fetch_add(skipped, std::memory_order_relaxed);
+        depth -= skipped;
+        PopMarkers(false);
+    }
+
+    size_t lead = 0;
+    if (!playing_.load(std::memory_order_relaxed)) {
+        pop_window_us_.store(static_cast<uint64_t>(samples) * 1000000 / (config_.sample_rate * config_.channels),
+                             std::memory_order_relaxed);
+        size_t target = StartSamples();
+        if (depth == 0 || (depth < target && !EndBuffered())) {
+            return 0;
+        }
+        lead = ScheduledLead(out, samples);
+        if (lead == samples) {
+            return 0;
+        }
+        playing_.store(true, std::memory_order_relaxed);
+    }
+
+    size_t n = lead + ring_.Read(out + lead, samples - lead);
+    PopMarkers(true);
+    size_t mark = end_mark_.load(std::memory_order_acquire);
+    if (mark != 0 && static_cast<ptrdiff_t>(ring_.ReadPosition() - (mark - 1)) > 0) {
+        // 段尾之后已有数据（如下一句已预读进来），连续播放，标记作废
+        end_mark_.compare_exchange_strong(mark, 0, std::memory_order_relaxed);
+    }
+    if (n == samples) {
+        gap_ = false;
+        concealed_in_gap_ = 0;
+        TraceFrame(TraceStage::JitterPop, n);
+        return n;
+    }
+
+    if (EndReached()) {
+        FinishStream();
+        TraceFrame(TraceStage::JitterPop, n);
+    } else if (concealer_) {
+        // 播放中途断流：保持播放状态，由 Conceal 在设备即将欠载时补隐藏帧，数据一到立即续播
+        gap_ = true;
+        TraceFrame(TraceStage::JitterPop, n);
+    } else {
+        playing_.store(false, std::memory_order_relaxed);
+        underruns_.fetch_add(1, std::memory_order_relaxed);
+        starving_.store(true, std::memory_order_relaxed);
+        TraceFrame(TraceStage::Underrun, n);
+    }
+    return n;
+}
+
+size_t JitterBuffer::Skip(size_t samples) {
+    size_t skipped = 0;
+    while (skipped < samples) {
+        size_t contiguous = 0;
+        ring_.ReadRegion(&contiguous);
+        if (contiguous == 0) {
+            break;
+        }
+        size_t chunk = std::min(contiguous, samples - skipped);
+        ring_.CommitRead(chunk);
+        skipped += chunk;
+    }
+    return skipped;
+}
+
+size_t JitterBuffer::ScheduledLead(short* out, size_t samples) {
+    uint64_t start_at = start_at_us_.load(std::memory_order_acquire);
+    if (start_at == 0) {
+        return 0;
+    }
+    // 本次取出的第一个样本从扬声器播出的时刻
+    uint64_t played_at = LatencyTracer::NowUs() + output_delay_us_.load(std::memory_order_relaxed);
+    if (start_at > played_at) {
+        size_t lead = UsToSamples(start_at - played_at);
+        if (lead >= samples) {
+            return samples;  // 还没到时
+        }
+        std::memset(out, 0, lead * sizeof(short));
+        start_at_us_.compare_exchange_strong(start_at, 0, std::memory_order_relaxed);
+        scheduled_starts_.fetch_add(1, std::memory_order_relaxed);
+        return lead;
+    }
+    start_at_us_.compare_exchange_strong(start_at, 0, std::memory_order_relaxed);
+    uint64_t late_us = played_at - start_at;
+    if (late_us > static_cast<uint64_t>(config_.max_start_skip_ms) * 1000) {
+        missed_starts_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    // 迟到：其他设备已经播到这里，跳过迟到的部分（至少留下本次要取的数据）
+    size_t late = UsToSamples(late_us);
+    if (late > 0) {
+        size_t depth = ring_.Size();
+        size_t skipped = Skip(depth > samples ? std::min(late, depth - samples) : 0);
+        flushed_samples_.fetch_add(skipped, std::memory_order_relaxed);
+        PopMarkers(false);
+        late_starts_.fetch_add(1, std::memory_order_relaxed);
+    }
+    scheduled_starts_.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+}
+
+size_t JitterBuffer::Conceal(short* out, size_t samples) {
+    ApplyFlush();
+    if (!concealer_ || !gap_ || !playing_.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    if (ring_.Size() == 0 && EndReached()) {
+        // 断流中收到了段尾（如 sentence_end 晚于最后一个音频包），按正常结束处理
+        FinishStream();
+        return 0;
+    }
+    if (concealed_in_gap_ >= MsToSamples(config_.max_conceal_ms)) {
+        // 断流太久，隐藏只会产生伪声，按欠载处理并重新缓冲
+        gap_ = false;
+        concealed_in_gap_ = 0;
+        playing_.store(false, std::memory_order_relaxed);
+        underruns_.fetch_add(1, std::memory_order_relaxed);
+        starving_.store(true, std::memory_order_relaxed);
+        TraceFrame(TraceStage::Underrun, 0);
+        return 0;
+    }
+    size_t n = concealer_(out, samples);
+    concealed_in_gap_ += n;
+    concealed_samples_.fetch_add(n, std::memory_order_relaxed);
+    TraceFrame(TraceStage::Conceal, n);
+    return n;
+}
+
+bool JitterBuffer::Ready() const {
+    size_t depth = ring_.Size();
+    // 有待处理的 Flush 时先让消费者走一次 Pop 完成丢弃
+    if (depth == 0 || flush_pending_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    if (playing_.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    if (!EndBuffered() && depth < StartSamples()) {
+        return false;
+    }
+    // 定时开始：到时落在下一次 Pop 之内才算就绪
+    uint64_t wait = UsUntilStart();
+    return wait == 0 || wait == UINT64_MAX;
+}
+
+uint64_t JitterBuffer::UsUntilStart() const {
+    uint64_t start_at = start_at_us_.load(std::memory_order_acquire);
+    if (start_at == 0) {
+        return UINT64_MAX;
+    }
+    uint64_t ready_at = LatencyTracer::NowUs() + output_delay_us_.load(std::memory_order_relaxed) +
+                        pop_window_us_.load(std::memory_order_relaxed);
+    return start_at > ready_at ? start_at - ready_at : 0;
+}
+
+JitterBufferStats JitterBuffer::GetStats() const {
+    JitterBufferStats stats;
+    stats.frames_in = frames_in_.load(std::memory_order_relaxed);
+    stats.late_frames = late_frames_.load(std::memory_order_relaxed);
+    stats.dropped_samples = dropped_samples_.load(std::memory_order_relaxed);
+    stats.underruns = underruns_.load(std::memory_order_relaxed);
+    stats.drained = drained_.load(std::memory_order_relaxed);
+    stats.concealed_samples = concealed_samples_.load(std::memory_order_relaxed);
+    stats.flushes = flushes_.load(std::memory_order_relaxed);
+    stats.flushed_samples = flushed_samples_.load(std::memory_order_relaxed);
+    stats.target_delay_ms = target_delay_ms_.load(std::memory_order_relaxed);
+    stats.jitter_ms = jitter_snapshot_ms_.load(std::memory_order_relaxed);
+    stats.depth_samples = ring_.Size();
+    stats.scheduled_starts = scheduled_starts_.load(std::memory_order_relaxed);
+    stats.late_starts = late_starts_.load(std::memory_order_relaxed);
+    stats.missed_starts = missed_starts_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace linx
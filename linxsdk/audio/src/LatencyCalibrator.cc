@@ -0,0 +1,337 @@
+#include "LatencyCalibrator.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "Json.h"
+#include "Log.h"
+#include "PcmKernels.h"
+
+namespace linx {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr int kFadeMs = 5;
+constexpr int kBlockMs = 10;        // 校准时每次读写的时长
+constexpr double kMainLobeMs = 2;   // 相关峰两侧这么宽的范围算作主瓣，不参与旁瓣比较
+constexpr int kMaxDrainBlocks = 100;
+
+using Clock = std::chrono::steady_clock;
+
+double Seconds(Clock::time_point t) { return std::chrono::duration<double>(t.time_since_epoch()).count(); }
+
+double Median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    size_t mid = values.size() / 2;
+    return values.size() % 2 == 1 ? values[mid] : (values[mid - 1] + values[mid]) / 2;
+}
+
+void SetError(std::string* error, const std::string& message) {
+    if (error != nullptr) {
+        *error = message;
+    }
+}
+
+}  // namespace
+
+std::vector<float> MakeCalibrationChirp(const LatencyCalibrationConfig& config, unsigned int sample_rate) {
+    size_t samples = static_cast<size_t>(sample_rate) * std::max(1, config.chirp_ms) / 1000;
+    std::vector<float> chirp(samples);
+    double f0 = std::max(20.0f, config.start_hz);
+    double f1 = std::min<double>(config.end_hz, sample_rate * 0.45);
+    f1 = std::max(f1, f0 * 1.01);
+    double duration = static_cast<double>(samples) / sample_rate;
+    double k = std::log(f1 / f0);
+    double amplitude = std::pow(10.0, config.level_dbfs / 20.0);
+    size_t fade = std::min(samples / 2, static_cast<size_t>(sample_rate) * kFadeMs / 1000);
+    for (size_t i = 0; i < samples; ++i) {
+        double t = static_cast<double>(i) / sample_rate;
+        // 对数扫频：瞬时频率 f0 * (f1/f0)^(t/T)，相位为其积分
+        double phase = 2 * kPi * f0 * duration / k * (std::exp(k * t / duration) - 1);
+        double gain = amplitude;
+        if (i < fade) {
+            gain *= 0.5 - 0.5 * std::cos(kPi * i / fade);
+        } else if (i >= samples - fade) {
+            gain *= 0.5 - 0.5 * std::cos(kPi * (samples - 1 - i) / fade);
+        }
+        chirp[i] = static_cast<float>(gain * std::sin(phase));
+    }
+    return chirp;
+}
+
+bool FindChirp(const float* capture, size_t n, const float* chirp, size_t m, unsigned int sample_rate, double* lag,
+               double* peak_ratio) {
+    if (m == 0 || n < m) {
+        return false;
+    }
+    const size_t lags = n - m + 1;
+    std::vector<float> corr(lags);
+    size_t best = 0;
+    for (size_t l = 0; l < lags; ++l) {
+        corr[l] = DotF32(capture + l, chirp, m);
+        if (std::fabs(corr[l]) > std::fabs(corr[best])) {
+            best = l;
+        }
+    }
+    const float peak = std::fabs(corr[best]);
+    if (peak <= 0) {
+        return false;
+    }
+    // 旁瓣：主瓣之外的最大值；整个搜索范围都在主瓣内时按峰本身计（比值为 1）
+    const size_t lobe = std::max<size_t>(1, static_cast<size_t>(sample_rate * kMainLobeMs / 1000));
+    float side = 0;
+    for (size_t l = 0; l < lags; ++l) {
+        if (l + lobe < best || l > best + lobe) {
+            side = std::max(side, std::fabs(corr[l]));
+        }
+    }
+    *peak_ratio = side > 0 ? peak / side : (lags > 2 * lobe ? 1e6 : 1);
+
+    // 抛物线插值：按峰的符号取三个点，得到亚样本位置
+    double offset = 0;
+    if (best > 0 && best + 1 < lags) {
+        double sign = corr[best] < 0 ? -1 : 1;
+        double a = sign * corr[best - 1];
+        double b = sign * corr[best];
+        double c = sign * corr[best + 1];
+        double denom = a - 2 * b + c;
+        if (denom < 0) {
+            offset = std::max(-0.5, std::min(0.5, 0.5 * (a - c) / denom));
+        }
+    }
+    *lag = static_cast<double>(best) + offset;
+    return true;
+}
+
+bool MeasureLoopbackLatency(AudioInterface& audio, const LatencyCalibrationConfig& config, LatencyCalibration* result,
+                            std::string* error) {
+    *result = LatencyCalibration();
+    const unsigned int rate = audio.SampleRate();
+    if (rate == 0) {
+        SetError(error, "audio device is not configured");
+        return false;
+    }
+    const int channels = std::max(1, audio.Channels());
+    const int capture_channels = std::max(1, audio.CaptureChannels());
+    const int repeats = std::max(1, config.repeats);
+    const size_t block = std::max<size_t>(1, rate * kBlockMs / 1000);
+    const std::vector<float> chirp = MakeCalibrationChirp(config, rate);
+    const size_t lead = static_cast<size_t>(rate) * std::max(0, config.lead_ms) / 1000;
+    const size_t gap = static_cast<size_t>(rate) * std::max(kBlockMs, config.max_latency_ms) / 1000;
+    const size_t play_frames = lead + repeats * (chirp.size() + gap);
+    const size_t capture_frames = play_frames + gap;
+
+    std::vector<short> capture_block(block * capture_channels);
+    // 先读空采集缓冲中 Record 之后积压的数据：某次读取阻塞了半个块以上即说明已追上实时
+    for (int i = 0; i < kMaxDrainBlocks; ++i) {
+        auto begin = Clock::now();
+        if (!audio.Read(capture_block.data(), block)) {
+            SetError(error, "capture read failed");
+            return false;
+        }
+        if (Clock::now() - begin >= std::chrono::milliseconds(kBlockMs / 2)) {
+            break;
+        }
+    }
+
+    // 播放线程：静音 lead，随后每次为扫频 + gap 静音。记下每次扫频第一块写入的时刻和此时的待播时长
+    std::vector<double> written_s(repeats, 0);
+    std::vector<long> queued(repeats, -1);
+    std::atomic<bool> stop{false};
+    std::atomic<bool> write_failed{false};
+    std::thread player([&]() {
+        std::vector<short> out(block * channels);
+        std::vector<short> mono(block);
+        size_t position = 0;  // 在播放时间线上的帧位置
+        while (position < play_frames && !stop.load(std::memory_order_relaxed)) {
+            size_t frames = std::min(block, play_frames - position);
+            int repeat = -1;
+            size_t chirp_offset = 0;
+            if (position < lead) {
+                frames = std::min(frames, lead - position);
+            } else {
+                size_t in_cycle = (position - lead) % (chirp.size() + gap);
+                if (in_cycle < chirp.size()) {
+                    repeat = static_cast<int>((position - lead) / (chirp.size() + gap));
+                    chirp_offset = in_cycle;
+                    frames = std::min(frames, chirp.size() - in_cycle);  // 扫频的第一块从块边界开始
+                } else {
+                    frames = std::min(frames, chirp.size() + gap - in_cycle);
+                }
+            }
+            if (repeat >= 0) {
+                PcmFromFloat(mono.data(), chirp.data() + chirp_offset, frames);
+            } else {
+                std::fill(mono.begin(), mono.begin() + frames, 0);
+            }
+            for (size_t i = 0; i < frames; ++i) {
+                for (int c = 0; c < channels; ++c) {
+                    out[i * channels + c] = mono[i];
+                }
+            }
+            if (!audio.Write(out.data(), frames)) {
+                write_failed = true;
+                return;
+            }
+            if (repeat >= 0 && chirp_offset == 0) {
+                written_s[repeat] = Seconds(Clock::now());
+                long delay = audio.GetPlaybackDelay();
+                queued[repeat] = delay >= 0 ? std::max(0L, delay - static_cast<long>(frames)) : -1;
+            }
+            position += frames;
+        }
+    });
+
+    // 采集：第一声道存为 float；offset 为“读出时刻 - 样本位置/采样率”的最小值，即采集时间线的零点
+    // （读取只会晚于数据就绪，取最小值去掉调度延迟）
+    std::vector<float> captured(capture_frames);
+    std::vector<short> mono(block);
+    double offset = 1e300;
+    size_t got = 0;
+    bool read_ok = true;
+    while (got < capture_frames && !write_failed.load(std::memory_order_relaxed)) {
+        size_t frames = std::min(block, capture_frames - got);
+        if (!audio.Read(capture_block.data(), frames)) {
+            read_ok = false;
+            break;
+        }
+        double now = Seconds(Clock::now());
+        for (size_t i = 0; i < frames; ++i) {
+            mono[i] = capture_block[i * capture_channels];
+        }
+        PcmToFloat(captured.data() + got, mono.data(), frames);
+        got += frames;
+        offset = std::min(offset, now - static_cast<double>(got) / rate);
+    }
+    stop = true;
+    player.join();
+    if (!read_ok || write_failed) {
+        SetError(error, read_ok ? "playback write failed" : "capture read failed");
+        return false;
+    }
+
+    std::vector<double> round_trips;
+    std::vector<double> queues;
+    double worst_ratio = 1e300;
+    double best_rejected = 0;
+    for (int r = 0; r < repeats; ++r) {
+        // 扫频写入时刻在采集时间线上的位置，从这里起搜索 max_latency_ms
+        double start_pos = (written_s[r] - offset) * rate;
+        size_t start = start_pos > 0 ? static_cast<size_t>(start_pos) : 0;
+        if (start >= got) {
+            continue;
+        }
+        size_t span = std::min(got - start, gap + chirp.size());
+        double lag = 0;
+        double ratio = 0;
+        if (!FindChirp(captured.data() + start, span, chirp.data(), chirp.size(), rate, &lag, &ratio)) {
+            continue;
+        }
+        if (ratio < config.min_peak_ratio) {
+            best_rejected = std::max(best_rejected, ratio);
+            continue;
+        }
+        double echo_s = offset + (static_cast<double>(start) + lag) / rate;
+        round_trips.push_back((echo_s - written_s[r]) * 1000);
+        if (queued[r] >= 0) {
+            queues.push_back(queued[r] * 1000.0 / rate);
+        }
+        worst_ratio = std::min(worst_ratio, ratio);
+    }
+    if (round_trips.empty()) {
+        char message[96];
+        snprintf(message, sizeof(message), "no clear echo of the sweep (best peak ratio %.1f)", best_rejected);
+        SetError(error, message);
+        return false;
+    }
+
+    result->valid = true;
+    result->measurements = static_cast<int>(round_trips.size());
+    result->round_trip_ms = Median(round_trips);
+    auto range = std::minmax_element(round_trips.begin(), round_trips.end());
+    result->spread_ms = *range.second - *range.first;
+    result->peak_ratio = worst_ratio;
+    if (!queues.empty()) {
+        result->output_queue_ms = Median(queues);
+        result->echo_delay_ms = std::max(0.0, result->round_trip_ms - result->output_queue_ms);
+    }
+    return true;
+}
+
+bool LoadLatencyCalibration(const std::string& path, const std::string& device_key, LatencyCalibration* result) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    json root = json::parse(text.str(), nullptr, false);
+    if (!root.is_object() || !root.contains(device_key) || !root[device_key].is_object()) {
+        return false;
+    }
+    const json& entry = root[device_key];
+    LatencyCalibration loaded;
+    loaded.round_trip_ms = entry.value("round_trip_ms", 0.0);
+    loaded.output_queue_ms = entry.value("output_queue_ms", -1.0);
+    loaded.echo_delay_ms = entry.value("echo_delay_ms", 0.0);
+    loaded.spread_ms = entry.value("spread_ms", 0.0);
+    loaded.peak_ratio = entry.value("peak_ratio", 0.0);
+    loaded.measurements = entry.value("measurements", 0);
+    loaded.valid = loaded.round_trip_ms > 0 && loaded.measurements > 0;
+    if (!loaded.valid) {
+        return false;
+    }
+    *result = loaded;
+    return true;
+}
+
+bool SaveLatencyCalibration(const std::string& path, const std::string& device_key, const LatencyCalibration& result) {
+    json root = json::object();
+    {
+        std::ifstream file(path);
+        if (file) {
+            std::stringstream text;
+            text << file.rdbuf();
+            json existing = json::parse(text.str(), nullptr, false);
+            if (existing.is_object()) {
+                root = std::move(existing);
+            }
+        }
+    }
+    root[device_key] = {
+        {"round_trip_ms", result.round_trip_ms},
+        {"output_queue_ms", result.output_queue_ms},
+        {"echo_delay_ms", result.echo_delay_ms},
+        {"spread_ms", result.spread_ms},
+        {"peak_ratio", result.peak_ratio},
+        {"measurements", result.measurements},
+    };
+    std::string tmp = path + ".tmp";
+    std::string data = root.dump(2);
+    FILE* file = fopen(tmp.c_str(), "wb");
+    if (file == nullptr) {
+        WARN("latency calibration: open {} failed", tmp);
+        return false;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = fflush(file) == 0 && ok;
+    ok = fsync(fileno(file)) == 0 && ok;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        WARN("latency calibration: write {} failed", path);
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace linx
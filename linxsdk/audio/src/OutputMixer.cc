@@ -0,0 +1,208 @@
+#include "OutputMixer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "PcmKernels.h"
+
+namespace linx {
+
+namespace {
+
+constexpr uint64_t kClipMask = 0x7fffffff;  // 命令中的片段编号字段，全 1 表示停止
+constexpr size_t kRampSegments = 8;         // 压低系数变化时一个周期内分这么多段插值
+
+}  // namespace
+
+OutputMixer::OutputMixer(const OutputMixerConfig& config)
+    : config_(config), scratch_(config.max_period_samples), clip_scratch_(config.max_period_samples) {
+    config_.duck_gain = std::min(std::max(config_.duck_gain, 0.0f), 1.0f);
+}
+
+size_t OutputMixer::AddStream(const MixerStreamConfig& config, Source source, PendingCheck pending) {
+    auto stream = std::make_unique<Stream>();
+    stream->config = config;
+    stream->source = std::move(source);
+    stream->pending = std::move(pending);
+    if (!stream->source && config.ring_samples > 0) {
+        stream->ring = std::make_unique<PcmRing>(config.ring_samples);
+    }
+    stream->gain.store(config.gain, std::memory_order_relaxed);
+    size_t id = streams_.size();
+    streams_.push_back(std::move(stream));
+    if (config.ducks_others) {
+        auto first_plain = std::find_if(order_.begin(), order_.end(),
+                                        [this](size_t i) { return !streams_[i]->config.ducks_others; });
+        order_.insert(first_plain, id);
+    } else {
+        order_.push_back(id);
+    }
+    return id;
+}
+
+size_t OutputMixer::AddClip(std::vector<short> pcm) {
+    clips_.push_back(std::move(pcm));
+    return clips_.size() - 1;
+}
+
+size_t OutputMixer::Write(size_t stream, const short* pcm, size_t samples) {
+    PcmRing* ring = streams_[stream]->ring.get();
+    return ring != nullptr ? ring->Write(pcm, samples) : 0;
+}
+
+void OutputMixer::PostCommand(Stream& stream, size_t clip, bool loop) {
+    uint64_t sequence = next_sequence_.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint64_t field = clip == kNoClip ? kClipMask : (clip & kClipMask);
+    stream.clip_active.store(clip != kNoClip, std::memory_order_relaxed);
+    stream.command.store(sequence << 32 | field << 1 | (loop ? 1 : 0), std::memory_order_release);
+}
+
+void OutputMixer::Play(size_t stream, size_t clip, bool loop) {
+    if (clip >= clips_.size()) {
+        return;
+    }
+    clips_started_.fetch_add(1, std::memory_order_relaxed);
+    PostCommand(*streams_[stream], clip, loop);
+}
+
+void OutputMixer::Stop(size_t stream) { PostCommand(*streams_[stream], kNoClip, false); }
+
+void OutputMixer::SetGain(size_t stream, float gain) {
+    streams_[stream]->gain.store(gain, std::memory_order_relaxed);
+}
+
+bool OutputMixer::Pending() const {
+    for (const auto& stream : streams_) {
+        if (stream->clip_active.load(std::memory_order_relaxed) || (stream->ring && !stream->ring->Empty()) ||
+            (stream->pending && stream->pending())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void OutputMixer::ApplyCommand(Stream& stream) {
+    uint64_t command = stream.command.load(std::memory_order_acquire);
+    if (command == stream.seen_command) {
+        return;
+    }
+    stream.seen_command = command;
+    uint64_t field = (command >> 1) & kClipMask;
+    stream.clip = field == kClipMask ? kNoClip : static_cast<size_t>(field);
+    stream.clip_position = 0;
+    stream.loop = (command & 1) != 0;
+}
+
+size_t OutputMixer::Pull(Stream& stream, short* out, size_t samples) {
+    ApplyCommand(stream);
+    size_t live = 0;
+    if (stream.source) {
+        live = stream.source(out, samples);
+    } else if (stream.ring) {
+        live = stream.ring->Read(out, samples);
+    }
+    if (stream.clip == kNoClip) {
+        return live;
+    }
+
+    // 片段：没有实时输入时直接写进 out，否则先取到 clip_scratch_ 再叠加
+    const std::vector<short>& clip = clips_[stream.clip];
+    short* dst = live == 0 ? out : clip_scratch_.data();
+    size_t got = 0;
+    while (got < samples && stream.clip != kNoClip) {
+        size_t chunk = std::min(samples - got, clip.size() - stream.clip_position);
+        memcpy(dst + got, clip.data() + stream.clip_position, chunk * sizeof(short));
+        got += chunk;
+        stream.clip_position += chunk;
+        if (stream.clip_position >= clip.size()) {
+            if (stream.loop && !clip.empty()) {
+                stream.clip_position = 0;
+            } else {
+                stream.clip = kNoClip;
+                // 播完时没有新命令才清除，避免覆盖刚到的 Play
+                stream.clip_active.store(false, std::memory_order_relaxed);
+                if (stream.command.load(std::memory_order_acquire) != stream.seen_command) {
+                    stream.clip_active.store(true, std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+    if (live == 0) {
+        return got;
+    }
+    Accumulate(out, &live, dst, got);
+    return live;
+}
+
+void OutputMixer::Scale(short* pcm, size_t samples, float gain, float from, float to) const {
+    if (from == to) {
+        if (gain * to != 1.0f) {
+            PcmGain(pcm, pcm, samples, gain * to);
+        }
+        return;
+    }
+    size_t begin = 0;
+    for (size_t k = 1; k <= kRampSegments; ++k) {
+        size_t end = samples * k / kRampSegments;
+        float level = from + (to - from) * k / kRampSegments;
+        PcmGain(pcm + begin, pcm + begin, end - begin, gain * level);
+        begin = end;
+    }
+}
+
+void OutputMixer::Accumulate(short* out, size_t* valid, const short* src, size_t n) {
+    size_t overlap = std::min(*valid, n);
+    PcmMix(out, out, src, overlap);
+    if (n > *valid) {
+        memcpy(out + *valid, src + *valid, (n - *valid) * sizeof(short));
+        *valid = n;
+    }
+}
+
+size_t OutputMixer::Mix(short* out, size_t samples) {
+    samples = std::min(samples, config_.max_period_samples);
+    mixes_.fetch_add(1, std::memory_order_relaxed);
+    size_t valid = 0;
+    size_t sounding = 0;
+    bool ducking = false;
+    bool ducked = false;
+    for (size_t index : order_) {
+        Stream& stream = *streams_[index];
+        float target = !stream.config.ducks_others && ducking ? config_.duck_gain : 1.0f;
+        // 第一路有声音的流直接取进 out，只有一路出声时没有额外拷贝
+        short* dst = sounding == 0 ? out : scratch_.data();
+        size_t n = Pull(stream, dst, samples);
+        stream.produced = n;
+        if (n == 0) {
+            stream.level = target;  // 静音期间直接到位，下次出声不再渐变
+            continue;
+        }
+        Scale(dst, n, stream.gain.load(std::memory_order_relaxed), stream.level, target);
+        stream.level = target;
+        ducked = ducked || target < 1.0f;
+        ducking = ducking || stream.config.ducks_others;
+        if (sounding++ == 0) {
+            valid = n;
+        } else {
+            Accumulate(out, &valid, dst, n);
+        }
+    }
+    if (sounding > 1) {
+        mixed_periods_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (ducked) {
+        ducked_periods_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return valid;
+}
+
+OutputMixerStats OutputMixer::GetStats() const {
+    OutputMixerStats stats;
+    stats.mixes = mixes_.load(std::memory_order_relaxed);
+    stats.mixed_periods = mixed_periods_.load(std::memory_order_relaxed);
+    stats.ducked_periods = ducked_periods_.load(std::memory_order_relaxed);
+    stats.clips_started = clips_started_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace linx
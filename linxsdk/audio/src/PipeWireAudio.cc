@@ -0,0 +1,428 @@
+#ifdef LINX_HAVE_PIPEWIRE
+
+#include "PipeWireAudio.h"
+
+#include <spa/param/audio/format-utils.h>
+#include <spa/pod/builder.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+#include "Log.h"
+#include "Tracepoints.h"
+
+namespace linx {
+
+namespace {
+
+// 等待回调通知，超时返回 false
+bool WaitSem(sem_t* sem, long timeout_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    while (sem_timedwait(sem, &deadline) != 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+PipeWireAudio::PipeWireAudio() {
+    sem_init(&capture_sem_, 0, 0);
+    sem_init(&playback_sem_, 0, 0);
+}
+
+PipeWireAudio::~PipeWireAudio() {
+    if (loop_ != nullptr) {
+        pw_thread_loop_stop(loop_);
+        if (capture_stream_ != nullptr) {
+            pw_stream_destroy(capture_stream_);
+        }
+        if (playback_stream_ != nullptr) {
+            pw_stream_destroy(playback_stream_);
+        }
+        pw_thread_loop_destroy(loop_);
+        pw_deinit();
+    }
+    sem_destroy(&capture_sem_);
+    sem_destroy(&playback_sem_);
+}
+
+bool PipeWireAudio::ServerAvailable() {
+    const char* dir = std::getenv("PIPEWIRE_RUNTIME_DIR");
+    if (dir == nullptr) {
+        dir = std::getenv("XDG_RUNTIME_DIR");
+    }
+    if (dir == nullptr) {
+        return false;
+    }
+    const char* remote = std::getenv("PIPEWIRE_REMOTE");
+    std::string path = std::string(dir) + "/" + (remote != nullptr ? remote : "pipewire-0");
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode);
+}
+
+void PipeWireAudio::Init() {
+    if (loop_ != nullptr) {
+        return;
+    }
+    pw_init(nullptr, nullptr);
+    loop_ = pw_thread_loop_new("linx-pipewire", nullptr);
+    if (loop_ == nullptr || pw_thread_loop_start(loop_) != 0) {
+        ERROR("PipeWire: failed to start the thread loop");
+        return;
+    }
+    INFO("PipeWire initialized (library {})", pw_get_library_version());
+}
+
+void PipeWireAudio::SetConfig(unsigned int sample_rate, int frame_size, int channels, int periods, int buffer_size,
+                              int period_size) {
+    (void)frame_size;
+    sample_rate_ = sample_rate;
+    channels_ = channels;
+    periods_ = periods;
+    buffer_size_ = buffer_size;
+    period_size_ = period_size;
+}
+
+bool PipeWireAudio::SetDevice(const std::string& capture, const std::string& playback) {
+    capture_target_ = capture == "default" ? std::string() : capture;
+    playback_target_ = playback == "default" ? std::string() : playback;
+    return true;
+}
+
+pw_stream* PipeWireAudio::Connect(bool capture, const pw_stream_events* events) {
+    pw_properties* props = pw_properties_new(PW_KEY_MEDIA_TYPE, "Audio", PW_KEY_MEDIA_CATEGORY,
+                                             capture ? "Capture" : "Playback", PW_KEY_MEDIA_ROLE, "Communication",
+                                             PW_KEY_APP_NAME, "linx", nullptr);
+    // 每个回调一个周期：请求的图周期就是设备周期，软件缓冲只有环中的部分
+    pw_properties_setf(props, PW_KEY_NODE_LATENCY, "%d/%u", period_size_, sample_rate_);
+#ifdef PW_KEY_NODE_RATE
+    // 请求图按流的采样率运行（服务端允许时不做重采样）
+    pw_properties_setf(props, PW_KEY_NODE_RATE, "1/%u", sample_rate_);
+#endif
+    const std::string& target = capture ? capture_target_ : playback_target_;
+    if (!target.empty()) {
+        // 连接到指定节点（node.name 或对象序号），否则由会话管理器连接默认设备
+#ifdef PW_KEY_TARGET_OBJECT
+        pw_properties_set(props, PW_KEY_TARGET_OBJECT, target.c_str());
+#else
+        pw_properties_set(props, PW_KEY_NODE_TARGET, target.c_str());
+#endif
+    }
+    pw_stream* stream =
+        pw_stream_new_simple(pw_thread_loop_get_loop(loop_), capture ? "linx-capture" : "linx-playback", props,
+                             events, this);
+    if (stream == nullptr) {
+        ERROR("PipeWire: failed to create the {} stream", capture ? "capture" : "playback");
+        return nullptr;
+    }
+
+    uint8_t buffer[1024];
+    spa_pod_builder builder = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+    spa_audio_info_raw info{};
+    info.format = SPA_AUDIO_FORMAT_S16;
+    info.rate = sample_rate_;
+    info.channels = static_cast<uint32_t>(channels_);
+    if (channels_ == 1) {
+        info.position[0] = SPA_AUDIO_CHANNEL_MONO;
+    } else {
+        info.position[0] = SPA_AUDIO_CHANNEL_FL;
+        info.position[1] = SPA_AUDIO_CHANNEL_FR;
+    }
+    const spa_pod* params[1] = {spa_format_audio_raw_build(&builder, SPA_PARAM_EnumFormat, &info)};
+    auto flags = static_cast<pw_stream_flags>(PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS |
+                                              PW_STREAM_FLAG_RT_PROCESS);
+    int ret = pw_stream_connect(stream, capture ? PW_DIRECTION_INPUT : PW_DIRECTION_OUTPUT, PW_ID_ANY, flags, params,
+                                1);
+    if (ret < 0) {
+        ERROR("PipeWire: failed to connect the {} stream: {}", capture ? "capture" : "playback", strerror(-ret));
+        pw_stream_destroy(stream);
+        return nullptr;
+    }
+    return stream;
+}
+
+void PipeWireAudio::Record() {
+    if (loop_ == nullptr || capture_stream_ != nullptr) {
+        return;
+    }
+    // 采集环容纳缓冲区或三个周期中较大者的两倍，Read 稍有延迟也不会丢数据
+    size_t frames = static_cast<size_t>(std::max(buffer_size_, period_size_ * 3)) * 2;
+    capture_ring_ = std::make_unique<PcmRing>(frames * channels_);
+    capture_events_.version = PW_VERSION_STREAM_EVENTS;
+    capture_events_.state_changed = &PipeWireAudio::OnStateChanged;
+    capture_events_.process = &PipeWireAudio::OnCaptureProcess;
+    pw_thread_loop_lock(loop_);
+    capture_stream_ = Connect(true, &capture_events_);
+    pw_thread_loop_unlock(loop_);
+    capture_active_ = capture_stream_ != nullptr;
+    if (capture_stream_ != nullptr) {
+        INFO("PipeWire recording started ({}Hz, {}ch, quantum {} frames)", sample_rate_, channels_, period_size_);
+    }
+}
+
+void PipeWireAudio::Play() {
+    if (loop_ == nullptr || playback_stream_ != nullptr) {
+        return;
+    }
+    // Write 最多在环里排 buffer_size_ 帧（至少两个周期），这就是图之外的全部软件缓冲
+    playback_limit_ = static_cast<size_t>(std::max(buffer_size_, period_size_ * 2)) * channels_;
+    playback_ring_ = std::make_unique<PcmRing>(playback_limit_);
+    playback_events_.version = PW_VERSION_STREAM_EVENTS;
+    playback_events_.state_changed = &PipeWireAudio::OnStateChanged;
+    playback_events_.process = &PipeWireAudio::OnPlaybackProcess;
+    pw_thread_loop_lock(loop_);
+    playback_stream_ = Connect(false, &playback_events_);
+    pw_thread_loop_unlock(loop_);
+    playback_active_ = playback_stream_ != nullptr;
+    if (playback_stream_ != nullptr) {
+        INFO("PipeWire playback started ({}Hz, {}ch, quantum {} frames)", sample_rate_, channels_, period_size_);
+    }
+}
+
+void PipeWireAudio::OnStateChanged(void* data, enum pw_stream_state old, enum pw_stream_state state,
+                                   const char* error) {
+    (void)data;
+    if (state == PW_STREAM_STATE_ERROR) {
+        ERROR("PipeWire stream error: {}", error != nullptr ? error : "unknown");
+    } else {
+        DEBUG("PipeWire stream {} -> {}", pw_stream_state_as_string(old), pw_stream_state_as_string(state));
+    }
+}
+
+void PipeWireAudio::OnCaptureProcess(void* data) {
+    auto* self = static_cast<PipeWireAudio*>(data);
+    pw_buffer* b = pw_stream_dequeue_buffer(self->capture_stream_);
+    if (b == nullptr) {
+        return;
+    }
+    spa_data& d = b->buffer->datas[0];
+    if (d.data != nullptr && d.chunk != nullptr) {
+        uint32_t offset = std::min(d.chunk->offset, d.maxsize);
+        uint32_t size = std::min(d.chunk->size, d.maxsize - offset);
+        size_t stride = sizeof(short) * self->channels_;
+        self->OnInput(reinterpret_cast<const short*>(static_cast<const uint8_t*>(d.data) + offset), size / stride);
+    }
+    pw_stream_queue_buffer(self->capture_stream_, b);
+}
+
+void PipeWireAudio::OnPlaybackProcess(void* data) {
+    auto* self = static_cast<PipeWireAudio*>(data);
+    pw_buffer* b = pw_stream_dequeue_buffer(self->playback_stream_);
+    if (b == nullptr) {
+        return;
+    }
+    spa_data& d = b->buffer->datas[0];
+    if (d.data != nullptr) {
+        uint32_t stride = sizeof(short) * self->channels_;
+        uint32_t frames = d.maxsize / stride;
+#if PW_CHECK_VERSION(0, 3, 49)
+        if (b->requested > 0) {
+            frames = std::min(frames, static_cast<uint32_t>(b->requested));  // 本周期图实际需要的帧数
+        }
+#endif
+        self->OnOutput(static_cast<short*>(d.data), frames);
+        d.chunk->offset = 0;
+        d.chunk->stride = static_cast<int32_t>(stride);
+        d.chunk->size = frames * stride;
+    }
+    pw_stream_queue_buffer(self->playback_stream_, b);
+}
+
+void PipeWireAudio::OnInput(const short* input, size_t frames) {
+    size_t samples = frames * channels_;
+    size_t written = capture_ring_->Write(input, samples);
+    if (written < samples) {
+        input_overflows_.fetch_add((samples - written) / channels_, std::memory_order_relaxed);
+    }
+    sem_post(&capture_sem_);
+}
+
+void PipeWireAudio::OnOutput(short* output, size_t frames) {
+    size_t samples = frames * channels_;
+    if (playback_drop_.exchange(false, std::memory_order_acquire)) {
+        playback_ring_->DiscardTo(playback_drop_to_.load(std::memory_order_relaxed));
+    }
+    size_t n = playback_ring_->Read(output, samples);
+    if (n < samples) {
+        // 空闲时整块补零是正常状态，只有播放中途数据不足才计为欠载
+        if (n > 0) {
+            output_underflows_.fetch_add(1, std::memory_order_relaxed);
+        }
+        memset(output + n, 0, (samples - n) * sizeof(short));
+    }
+    sem_post(&playback_sem_);
+}
+
+bool PipeWireAudio::Read(short* buffer, size_t frame_size) {
+    LINX_PROBE_SCOPE(audio_read, frame_size);
+    if (capture_stream_ == nullptr) {
+        ERROR("PipeWire capture stream not initialized");
+        return false;
+    }
+    size_t want = frame_size * channels_;
+    size_t got = 0;
+    while (got < want) {
+        if (aborted_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        got += capture_ring_->Read(buffer + got, want - got);
+        if (got < want && !WaitSem(&capture_sem_, 1000)) {
+            ERROR("PipeWire read timeout");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PipeWireAudio::Write(short* buffer, size_t frame_size) {
+    LINX_PROBE_SCOPE(audio_write, frame_size);
+    if (playback_stream_ == nullptr) {
+        ERROR("PipeWire playback stream not initialized");
+        return false;
+    }
+    size_t want = frame_size * channels_;
+    size_t put = 0;
+    while (put < want) {
+        if (aborted_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        size_t queued = playback_ring_->Size();
+        size_t room = playback_limit_ > queued ? playback_limit_ - queued : 0;
+        put += playback_ring_->Write(buffer + put, std::min(room, want - put));
+        if (put < want && !WaitSem(&playback_sem_, 1000)) {
+            ERROR("PipeWire write timeout");
+            return false;
+        }
+    }
+    return true;
+}
+
+void PipeWireAudio::Abort() {
+    if (aborted_.exchange(true)) {
+        return;
+    }
+    sem_post(&capture_sem_);
+    sem_post(&playback_sem_);
+}
+
+long PipeWireAudio::GetPlaybackDelay() {
+    if (playback_stream_ == nullptr) {
+        return -1;
+    }
+    long queued = static_cast<long>(playback_ring_->Size() / channels_);
+    pw_time time{};
+#if PW_CHECK_VERSION(0, 3, 50)
+    int ret = pw_stream_get_time_n(playback_stream_, &time, sizeof(time));
+#else
+    int ret = pw_stream_get_time(playback_stream_, &time);
+#endif
+    if (ret == 0 && time.rate.denom > 0 && time.delay > 0) {
+        // delay 以图的时钟（rate.num / rate.denom 秒）为单位，换算成本流的帧数
+        queued += static_cast<long>(time.delay * time.rate.num * sample_rate_ / time.rate.denom);
+    }
+    return queued;
+}
+
+bool PipeWireAudio::DropPlayback() {
+    if (playback_stream_ == nullptr) {
+        return false;
+    }
+    playback_drop_to_.store(playback_ring_->WritePosition(), std::memory_order_relaxed);
+    playback_drop_.store(true, std::memory_order_release);
+    return true;
+}
+
+bool PipeWireAudio::SetActive(pw_stream* stream, bool active) {
+    pw_thread_loop_lock(loop_);
+    int ret = pw_stream_set_active(stream, active);
+    pw_thread_loop_unlock(loop_);
+    if (ret < 0) {
+        ERROR("PipeWire: failed to {} the stream: {}", active ? "resume" : "suspend", strerror(-ret));
+        return false;
+    }
+    return true;
+}
+
+bool PipeWireAudio::SuspendCapture() {
+    if (capture_stream_ == nullptr) {
+        return false;
+    }
+    if (!capture_active_) {
+        return true;
+    }
+    if (!SetActive(capture_stream_, false)) {
+        return false;
+    }
+    capture_active_ = false;
+    return true;
+}
+
+bool PipeWireAudio::ResumeCapture() {
+    if (capture_stream_ == nullptr) {
+        return false;
+    }
+    if (capture_active_) {
+        return true;
+    }
+    // 流已停用，采集环里只剩暂停前的旧数据，Read 所在的线程就是消费者，可以直接清空
+    capture_ring_->Clear();
+    if (!SetActive(capture_stream_, true)) {
+        return false;
+    }
+    capture_active_ = true;
+    return true;
+}
+
+bool PipeWireAudio::SuspendPlayback() {
+    if (playback_stream_ == nullptr) {
+        return false;
+    }
+    if (!playback_active_) {
+        return true;
+    }
+    if (!SetActive(playback_stream_, false)) {
+        return false;
+    }
+    playback_active_ = false;
+    return true;
+}
+
+bool PipeWireAudio::ResumePlayback() {
+    if (playback_stream_ == nullptr) {
+        return false;
+    }
+    if (playback_active_) {
+        return true;
+    }
+    if (!SetActive(playback_stream_, true)) {
+        return false;
+    }
+    playback_active_ = true;
+    return true;
+}
+
+AudioXrunStats PipeWireAudio::GetXrunStats() const {
+    AudioXrunStats stats;
+    stats.capture_xruns = input_overflows_.load(std::memory_order_relaxed);
+    stats.playback_xruns = output_underflows_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace linx
+
+#endif  // LINX_HAVE_PIPEWIRE
@@ -0,0 +1,94 @@
+#include "PlayoutDrain.h"
+
+#include <algorithm>
+
+#include "LatencyTracer.h"
+
+namespace linx {
+
+void PlayoutDrain::NoteWritten(uint64_t delay_us) {
+    uint64_t now = LatencyTracer::NowUs();
+    uint64_t due = now + delay_us + extra_delay_us_.load(std::memory_order_relaxed);
+    last_written_us_.store(now, std::memory_order_relaxed);
+    // 只往后推：同一时刻写入的静音或更短的一段不会让已排队的 TTS 提前算作播完
+    if (due > content_due_us_.load(std::memory_order_relaxed)) {
+        content_due_us_.store(due, std::memory_order_relaxed);
+    }
+}
+
+void PlayoutDrain::Request(Callback on_drained) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    if (pending_.load(std::memory_order_relaxed)) {
+        cancelled_.fetch_add(1, std::memory_order_relaxed);
+    }
+    callback_ = std::move(on_drained);
+    requested_us_ = LatencyTracer::NowUs();
+    pending_.store(true, std::memory_order_release);
+}
+
+void PlayoutDrain::Cancel() {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    if (pending_.exchange(false, std::memory_order_relaxed)) {
+        cancelled_.fetch_add(1, std::memory_order_relaxed);
+    }
+    callback_ = nullptr;
+}
+
+bool PlayoutDrain::Poll(bool buffer_empty) {
+    if (!pending_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    uint64_t now = LatencyTracer::NowUs();
+    Callback callback;
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        if (!pending_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        bool drained = buffer_empty && now >= content_due_us_.load(std::memory_order_relaxed);
+        uint64_t since = std::max(requested_us_, last_written_us_.load(std::memory_order_relaxed));
+        bool expired = max_wait_us_ > 0 && now >= since + max_wait_us_;
+        if (!drained && !expired) {
+            return false;
+        }
+        (drained ? drains_ : timeouts_).fetch_add(1, std::memory_order_relaxed);
+        RecordWait(requested_us_, now);
+        pending_.store(false, std::memory_order_relaxed);
+        callback = std::move(callback_);
+        callback_ = nullptr;
+    }
+    // 锁外回调：回调里可以再次 Request
+    if (callback) {
+        callback();
+    }
+    return true;
+}
+
+std::chrono::microseconds PlayoutDrain::Remaining() const {
+    if (!pending_.load(std::memory_order_acquire)) {
+        return std::chrono::microseconds(0);
+    }
+    uint64_t due = content_due_us_.load(std::memory_order_relaxed);
+    uint64_t now = LatencyTracer::NowUs();
+    return std::chrono::microseconds(due > now ? due - now : 0);
+}
+
+void PlayoutDrain::RecordWait(uint64_t requested_us, uint64_t now_us) {
+    double wait_ms = (now_us - requested_us) / 1000.0;
+    last_wait_ms_.store(wait_ms, std::memory_order_relaxed);
+    if (wait_ms > max_wait_ms_.load(std::memory_order_relaxed)) {
+        max_wait_ms_.store(wait_ms, std::memory_order_relaxed);
+    }
+}
+
+PlayoutDrainStats PlayoutDrain::GetStats() const {
+    PlayoutDrainStats stats;
+    stats.drains = drains_.load(std::memory_order_relaxed);
+    stats.timeouts = timeouts_.load(std::memory_order_relaxed);
+    stats.cancelled = cancelled_.load(std::memory_order_relaxed);
+    stats.last_wait_ms = last_wait_ms_.load(std::memory_order_relaxed);
+    stats.max_wait_ms = max_wait_ms_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace linx
@@ -1,9 +1,12 @@
 #ifdef __APPLE__
 
 #include "PortAudioImpl.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <termios.h>
 #include <unistd.h>
+#include "Tracepoints.h"
 
 namespace linx {
 
@@ -40,10 +43,16 @@ PortAudioImpl::~PortAudioImpl() {
     if (input_stream_) {
         Pa_CloseStream(input_stream_);
     }
-    if (output_stream_) {
+    if (output_stream_ && output_stream_ != input_stream_) {
         Pa_CloseStream(output_stream_);
     }
     Pa_Terminate();
+    if (capture_sem_) {
+        dispatch_release(capture_sem_);
+    }
+    if (playback_sem_) {
+        dispatch_release(playback_sem_);
+    }
 }
 
 void PortAudioImpl::Init() {
@@ -55,6 +64,76 @@ void PortAudioImpl::Init() {
     INFO("PortAudio initialized successfully");
 }
 
+std::vector<AudioDeviceInfo> PortAudioImpl::ListDevices() {
+    std::vector<AudioDeviceInfo> devices;
+    // Pa_Initialize/Pa_Terminate 按引用计数，与 Init 的初始化互不影响
+    if (Pa_Initialize() != paNoError) {
+        return devices;
+    }
+    int count = Pa_GetDeviceCount();
+    for (int i = 0; i < count; i++) {
+        const PaDeviceInfo* info = Pa_GetDeviceInfo(i);
+        if (info == nullptr) {
+            continue;
+        }
+        AudioDeviceInfo device;
+        device.index = i;
+        device.id = std::to_string(i);
+        device.name = info->name;
+        for (bool capture : {true, false}) {
+            AudioDeviceCaps& caps = capture ? device.capture : device.playback;
+            int channels = capture ? info->maxInputChannels : info->maxOutputChannels;
+            if (channels <= 0) {
+                continue;
+            }
+            caps.supported = true;
+            caps.min_channels = 1;
+            caps.max_channels = static_cast<unsigned int>(channels);
+            PaStreamParameters params;
+            params.device = i;
+            params.channelCount = 1;
+            params.sampleFormat = paInt16;
+            params.suggestedLatency = capture ? info->defaultLowInputLatency : info->defaultLowOutputLatency;
+            params.hostApiSpecificStreamInfo = nullptr;
+            for (unsigned int rate : kProbeSampleRates) {
+                if (Pa_IsFormatSupported(capture ? &params : nullptr, capture ? nullptr : &params, rate) ==
+                    paFormatIsSupported) {
+                    caps.rates.push_back(rate);
+                }
+            }
+            caps.min_period_frames = static_cast<unsigned long>(params.suggestedLatency * info->defaultSampleRate);
+        }
+        devices.push_back(std::move(device));
+    }
+    Pa_Terminate();
+    return devices;
+}
+
+bool PortAudioImpl::ResolveDevice(const std::string& spec, bool capture, PaDeviceIndex* device) {
+    if (spec.empty() || spec == "default") {
+        *device = paNoDevice;
+        return true;
+    }
+    int index = FindAudioDevice(ListDevices(), spec, capture);
+    if (index < 0) {
+        ERROR("PortAudio {} device \"{}\" not found", capture ? "input" : "output", spec);
+        return false;
+    }
+    *device = index;
+    return true;
+}
+
+bool PortAudioImpl::SetDevice(const std::string& capture, const std::string& playback) {
+    PaDeviceIndex input = paNoDevice;
+    PaDeviceIndex output = paNoDevice;
+    if (!ResolveDevice(capture, true, &input) || !ResolveDevice(playback, false, &output)) {
+        return false;
+    }
+    input_device_ = input;
+    output_device_ = output;
+    return true;
+}
+
 void PortAudioImpl::SetConfig(unsigned int sample_rate, int frame_size, int channels, 
                              int periods, int buffer_size, int period_size) {
     sample_rate_ = sample_rate;
@@ -67,26 +146,83 @@ void PortAudioImpl::SetConfig(unsigned int sample_rate, int frame_size, int chan
 }
 
 bool PortAudioImpl::Read(short* buffer, size_t frame_size) {
+    LINX_PROBE_SCOPE(audio_read, frame_size);
     if (!input_stream_) {
         ERROR("Input stream not initialized");
         return false;
     }
+    if (callback_mode_) {
+        return ReadRing(buffer, frame_size);
+    }
     
-    PaError err = Pa_ReadStream(input_stream_, buffer, frame_size);
+    if (input_float_) {
+        const size_t samples = frame_size * channels_;
+        if (input_f32_.size() < samples) {
+            input_f32_.resize(samples);
+        }
+        if (!ReadStream(input_f32_.data(), frame_size)) {
+            return false;
+        }
+        PcmFromFloat(buffer, input_f32_.data(), samples);
+        return true;
+    }
+    return ReadStream(buffer, frame_size);
+}
+
+bool PortAudioImpl::ReadFloat(float* buffer, size_t frames) {
+    if (!input_float_ || !input_stream_) {
+        return AudioInterface::ReadFloat(buffer, frames);
+    }
+    LINX_PROBE_SCOPE(audio_read, frames);
+    return ReadStream(buffer, frames);
+}
+
+bool PortAudioImpl::ReadStream(void* buffer, size_t frames) {
+    PaError err = Pa_ReadStream(input_stream_, buffer, frames);
     if (err != paNoError) {
         ERROR("PortAudio read error: {}", Pa_GetErrorText(err));
+        capture_stamp_us_ = 0;
         return false;
     }
+    StampStreamRead(frames);
     return true;
 }
 
 bool PortAudioImpl::Write(short* buffer, size_t frame_size) {
+    LINX_PROBE_SCOPE(audio_write, frame_size);
     if (!output_stream_) {
         ERROR("Output stream not initialized");
         return false;
     }
+    if (callback_mode_) {
+        return WriteRing(buffer, frame_size);
+    }
     
-    PaError err = Pa_WriteStream(output_stream_, buffer, frame_size);
+    if (output_float_) {
+        const size_t samples = frame_size * channels_;
+        if (output_f32_.size() < samples) {
+            output_f32_.resize(samples);
+        }
+        PcmToFloat(output_f32_.data(), buffer, samples);
+        return WriteStream(output_f32_.data(), frame_size);
+    }
+    return WriteStream(buffer, frame_size);
+}
+
+bool PortAudioImpl::WriteFloat(const float* buffer, size_t frames) {
+    if (!output_float_ || !output_stream_) {
+        return AudioInterface::WriteFloat(buffer, frames);
+    }
+    LINX_PROBE_SCOPE(audio_write, frames);
+    return WriteStream(buffer, frames);
+}
+
+bool PortAudioImpl::WriteStream(const void* buffer, size_t frames) {
+    PaError err = Pa_WriteStream(output_stream_, buffer, frames);
+    if (err == paOutputUnderflowed) {
+        // 空闲期间允许输出欠载，数据已经写入，不算失败
+        return true;
+    }
     if (err != paNoError) {
         ERROR("PortAudio write error: {}", Pa_GetErrorText(err));
         return false;
@@ -94,18 +230,140 @@ bool PortAudioImpl::Write(short* buffer, size_t frame_size) {
     return true;
 }
 
+bool PortAudioImpl::DropPlayback() {
+    if (!output_stream_) {
+        return false;
+    }
+    if (callback_mode_) {
+        playback_drop_to_.store(playback_ring_->WritePosition(), std::memory_order_relaxed);
+        playback_drop_.store(true, std::memory_order_release);
+        return true;
+    }
+    PaError err = Pa_AbortStream(output_stream_);
+    if (err == paNoError) {
+        err = Pa_StartStream(output_stream_);
+    }
+    if (err != paNoError) {
+        ERROR("PortAudio playback drop failed: {}", Pa_GetErrorText(err));
+        return false;
+    }
+    return true;
+}
+
+bool PortAudioImpl::SuspendCapture() {
+    if (duplex_mode_ || !input_stream_) {
+        return false;
+    }
+    if (Pa_IsStreamStopped(input_stream_) == 1) {
+        return true;
+    }
+    PaError err = Pa_StopStream(input_stream_);
+    if (err != paNoError) {
+        ERROR("PortAudio capture suspend failed: {}", Pa_GetErrorText(err));
+        return false;
+    }
+    return true;
+}
+
+bool PortAudioImpl::ResumeCapture() {
+    if (duplex_mode_ || !input_stream_) {
+        return false;
+    }
+    if (Pa_IsStreamStopped(input_stream_) != 1) {
+        return true;
+    }
+    // 回调已经停止，采集环里只剩暂停前的旧数据，Read 所在的线程就是消费者，可以直接清空
+    if (capture_ring_) {
+        capture_ring_->Clear();
+    }
+    PaError err = Pa_StartStream(input_stream_);
+    if (err != paNoError) {
+        ERROR("PortAudio capture resume failed: {}", Pa_GetErrorText(err));
+        return false;
+    }
+    return true;
+}
+
+bool PortAudioImpl::SuspendPlayback() {
+    if (duplex_mode_ || !output_stream_) {
+        return false;
+    }
+    if (Pa_IsStreamStopped(output_stream_) == 1) {
+        return true;
+    }
+    // 空闲时播放环已经排空，Pa_StopStream 等剩余的设备缓冲播完后返回
+    PaError err = Pa_StopStream(output_stream_);
+    if (err != paNoError) {
+        ERROR("PortAudio playback suspend failed: {}", Pa_GetErrorText(err));
+        return false;
+    }
+    return true;
+}
+
+bool PortAudioImpl::ResumePlayback() {
+    if (duplex_mode_ || !output_stream_) {
+        return false;
+    }
+    if (Pa_IsStreamStopped(output_stream_) != 1) {
+        return true;
+    }
+    PaError err = Pa_StartStream(output_stream_);
+    if (err != paNoError) {
+        ERROR("PortAudio playback resume failed: {}", Pa_GetErrorText(err));
+        return false;
+    }
+    return true;
+}
+
+long PortAudioImpl::GetPlaybackDelay() {
+    if (!output_stream_) {
+        return -1;
+    }
+    if (callback_mode_) {
+        // 环中待播数据 + 设备自身的输出延迟
+        const PaStreamInfo* info = Pa_GetStreamInfo(output_stream_);
+        long device = info ? static_cast<long>(info->outputLatency * sample_rate_) : 0;
+        return static_cast<long>(playback_ring_->Size() / channels_) + device;
+    }
+    long avail = Pa_GetStreamWriteAvailable(output_stream_);
+    if (avail < 0) {
+        return -1;
+    }
+    if (avail > output_capacity_) {
+        output_capacity_ = avail;
+    }
+    return output_capacity_ - avail;
+}
+
 void PortAudioImpl::Record() {
+    if (duplex_mode_) {
+        OpenDuplex();
+        return;
+    }
     PaStreamParameters inputParameters;
-    inputParameters.device = Pa_GetDefaultInputDevice();
+    inputParameters.device = InputDevice();
     if (inputParameters.device == paNoDevice) {
-        ERROR("No default input device");
+        ERROR("No input device");
         return;
     }
     
     inputParameters.channelCount = channels_;
-    inputParameters.sampleFormat = paInt16;
-    inputParameters.suggestedLatency = Pa_GetDeviceInfo(inputParameters.device)->defaultLowInputLatency;
+    // 阻塞模式下 SetSampleFormat(F32) 以 paFloat32 打开，ReadFloat 直接读出宿主 API 的浮点数据；
+    // 回调模式的环按 int16 存放，仍用 paInt16
+    input_float_ = prefer_float_ && !callback_mode_;
+    inputParameters.sampleFormat = input_float_ ? paFloat32 : paInt16;
+    inputParameters.suggestedLatency =
+        lowest_latency_ ? 0 : Pa_GetDeviceInfo(inputParameters.device)->defaultLowInputLatency;
     inputParameters.hostApiSpecificStreamInfo = nullptr;
+    if (callback_mode_) {
+        // 采集环容纳缓冲区或三帧中较大者的两倍，Read 稍有延迟也不会丢数据
+        size_t frames = static_cast<size_t>(std::max(buffer_size_, chunk_)) * 2;
+        capture_ring_ = std::make_unique<PcmRing>(frames * channels_);
+        if (!capture_sem_) {
+            capture_sem_ = dispatch_semaphore_create(0);
+        }
+        inputParameters.suggestedLatency = CallbackLatency();
+    }
     
     PaError err = Pa_OpenStream(&input_stream_,
                                &inputParameters,
@@ -113,8 +371,8 @@ void PortAudioImpl::Record() {
                                sample_rate_,
                                period_size_,
                                paClipOff,
-                               nullptr,
-                               nullptr);
+                               callback_mode_ ? &PortAudioImpl::RecordCallback : nullptr,
+                               callback_mode_ ? this : nullptr);
     
     if (err != paNoError) {
         ERROR("PortAudio open input stream error: {}", Pa_GetErrorText(err));
@@ -127,21 +385,38 @@ void PortAudioImpl::Record() {
         return;
     }
     
-    INFO("Recording started");
+    const PaStreamInfo* info = Pa_GetStreamInfo(input_stream_);
+    INFO("Recording started ({} mode, input latency {:.1f}ms)", callback_mode_ ? "callback" : "blocking",
+         info ? info->inputLatency * 1000 : 0.0);
 }
 
 void PortAudioImpl::Play() {
+    if (duplex_mode_) {
+        OpenDuplex();
+        return;
+    }
     PaStreamParameters outputParameters;
-    outputParameters.device = Pa_GetDefaultOutputDevice();
+    outputParameters.device = OutputDevice();
     if (outputParameters.device == paNoDevice) {
-        ERROR("No default output device");
+        ERROR("No output device");
         return;
     }
     
     outputParameters.channelCount = channels_;
-    outputParameters.sampleFormat = paInt16;
-    outputParameters.suggestedLatency = Pa_GetDeviceInfo(outputParameters.device)->defaultLowOutputLatency;
+    output_float_ = prefer_float_ && !callback_mode_;
+    outputParameters.sampleFormat = output_float_ ? paFloat32 : paInt16;
+    outputParameters.suggestedLatency =
+        lowest_latency_ ? 0 : Pa_GetDeviceInfo(outputParameters.device)->defaultLowOutputLatency;
     outputParameters.hostApiSpecificStreamInfo = nullptr;
+    if (callback_mode_) {
+        // Write 最多在环里排 buffer_size_ 帧（至少两个周期），这就是设备之外的全部软件缓冲
+        playback_limit_ = static_cast<size_t>(std::max(buffer_size_, period_size_ * 2)) * channels_;
+        playback_ring_ = std::make_unique<PcmRing>(playback_limit_);
+        if (!playback_sem_) {
+            playback_sem_ = dispatch_semaphore_create(0);
+        }
+        outputParameters.suggestedLatency = CallbackLatency();
+    }
     
     PaError err = Pa_OpenStream(&output_stream_,
                                nullptr,
@@ -149,8 +424,8 @@ void PortAudioImpl::Play() {
                                sample_rate_,
                                period_size_,
                                paClipOff,
-                               nullptr,
-                               nullptr);
+                               callback_mode_ ? &PortAudioImpl::PlayCallback : nullptr,
+                               callback_mode_ ? this : nullptr);
     
     if (err != paNoError) {
         ERROR("PortAudio open output stream error: {}", Pa_GetErrorText(err));
@@ -163,7 +438,75 @@ void PortAudioImpl::Play() {
         return;
     }
     
-    INFO("Playback started");
+    const PaStreamInfo* info = Pa_GetStreamInfo(output_stream_);
+    INFO("Playback started ({} mode, output latency {:.1f}ms)", callback_mode_ ? "callback" : "blocking",
+         info ? info->outputLatency * 1000 : 0.0);
+}
+
+void PortAudioImpl::OpenDuplex() {
+    if (input_stream_) {
+        return;  // Record/Play 中先调用的一个已经打开了双工流
+    }
+    PaStreamParameters inputParameters;
+    inputParameters.device = InputDevice();
+    PaStreamParameters outputParameters;
+    outputParameters.device = OutputDevice();
+    if (inputParameters.device == paNoDevice || outputParameters.device == paNoDevice) {
+        ERROR("No input/output device for duplex stream");
+        return;
+    }
+    callback_mode_ = true;
+    inputParameters.channelCount = channels_;
+    inputParameters.sampleFormat = paInt16;
+    inputParameters.suggestedLatency = CallbackLatency();
+    inputParameters.hostApiSpecificStreamInfo = nullptr;
+    outputParameters.channelCount = channels_;
+    outputParameters.sampleFormat = paInt16;
+    outputParameters.suggestedLatency = CallbackLatency();
+    outputParameters.hostApiSpecificStreamInfo = nullptr;
+
+    // 采集环每帧多存一份播放参考，容量翻倍
+    size_t frames = static_cast<size_t>(std::max(buffer_size_, chunk_)) * 2;
+    capture_ring_ = std::make_unique<PcmRing>(frames * channels_ * 2);
+    playback_limit_ = static_cast<size_t>(std::max(buffer_size_, period_size_ * 2)) * channels_;
+    playback_ring_ = std::make_unique<PcmRing>(playback_limit_);
+    // 回调帧数通常等于 period_size_，预留余量应对宿主 API 给出更大的块
+    duplex_scratch_.assign(static_cast<size_t>(period_size_) * 4 * channels_ * 2, 0);
+    if (!capture_sem_) {
+        capture_sem_ = dispatch_semaphore_create(0);
+    }
+    if (!playback_sem_) {
+        playback_sem_ = dispatch_semaphore_create(0);
+    }
+
+    PaError err = Pa_OpenStream(&input_stream_, &inputParameters, &outputParameters, sample_rate_, period_size_,
+                                paClipOff, &PortAudioImpl::DuplexCallback, this);
+    if (err != paNoError) {
+        ERROR("PortAudio open duplex stream error: {}", Pa_GetErrorText(err));
+        input_stream_ = nullptr;
+        return;
+    }
+    output_stream_ = input_stream_;
+
+    err = Pa_StartStream(input_stream_);
+    if (err != paNoError) {
+        ERROR("PortAudio start duplex stream error: {}", Pa_GetErrorText(err));
+        return;
+    }
+    const PaStreamInfo* info = Pa_GetStreamInfo(input_stream_);
+    INFO("Duplex stream started (input latency {:.1f}ms, output latency {:.1f}ms)",
+         info ? info->inputLatency * 1000 : 0.0, info ? info->outputLatency * 1000 : 0.0);
+}
+
+int PortAudioImpl::DuplexCallback(const void* inputBuffer, void* outputBuffer,
+                                  unsigned long framesPerBuffer,
+                                  const PaStreamCallbackTimeInfo* timeInfo,
+                                  PaStreamCallbackFlags statusFlags,
+                                  void* userData) {
+    auto* self = static_cast<PortAudioImpl*>(userData);
+    self->StampInput(timeInfo);
+    self->OnDuplex(static_cast<const short*>(inputBuffer), static_cast<short*>(outputBuffer), framesPerBuffer);
+    return paContinue;
 }
 
 int PortAudioImpl::RecordCallback(const void* inputBuffer, void* outputBuffer,
@@ -171,7 +514,11 @@ int PortAudioImpl::RecordCallback(const void* inputBuffer, void* outputBuffer,
                                  const PaStreamCallbackTimeInfo* timeInfo,
                                  PaStreamCallbackFlags statusFlags,
                                  void* userData) {
-    // Implementation for callback-based recording if needed
+    auto* self = static_cast<PortAudioImpl*>(userData);
+    if (inputBuffer != nullptr) {
+        self->StampInput(timeInfo);
+        self->OnInput(static_cast<const short*>(inputBuffer), framesPerBuffer);
+    }
     return paContinue;
 }
 
@@ -180,10 +527,167 @@ int PortAudioImpl::PlayCallback(const void* inputBuffer, void* outputBuffer,
                                const PaStreamCallbackTimeInfo* timeInfo,
                                PaStreamCallbackFlags statusFlags,
                                void* userData) {
-    // Implementation for callback-based playback if needed
+    auto* self = static_cast<PortAudioImpl*>(userData);
+    self->OnOutput(static_cast<short*>(outputBuffer), framesPerBuffer);
     return paContinue;
 }
 
+void PortAudioImpl::StampInput(const PaStreamCallbackTimeInfo* time_info) {
+    // inputBufferAdcTime 与 currentTime 同为流时间（Pa_GetStreamTime），两者之差即本块第一帧已经采集了多久；
+    // 宿主 API 不提供时为 0，保持原点不变（从未校准过时 Read 退回读出时刻）
+    if (time_info == nullptr || time_info->inputBufferAdcTime <= 0 ||
+        time_info->currentTime < time_info->inputBufferAdcTime) {
+        return;
+    }
+    const size_t frame_samples = static_cast<size_t>(channels_) * (duplex_mode_ ? 2 : 1);
+    int64_t age_us = static_cast<int64_t>((time_info->currentTime - time_info->inputBufferAdcTime) * 1e6);
+    int64_t adc_us = static_cast<int64_t>(SteadyNowUs()) - age_us;
+    uint64_t index = capture_ring_->WritePosition() / frame_samples;
+    capture_origin_us_.store(adc_us - static_cast<int64_t>(index * 1000000 / sample_rate_),
+                             std::memory_order_release);
+}
+
+void PortAudioImpl::StampStreamRead(size_t frames) {
+    // 读取返回时流中还剩 avail 帧，加上流报告的输入延迟（设备到宿主缓冲区），就是本次第一帧采集以来的时长
+    const PaStreamInfo* info = Pa_GetStreamInfo(input_stream_);
+    signed long avail = Pa_GetStreamReadAvailable(input_stream_);
+    if (info == nullptr || avail < 0) {
+        capture_stamp_us_ = 0;
+        return;
+    }
+    uint64_t age_us = static_cast<uint64_t>((avail + frames) * 1000000 / sample_rate_) +
+                      static_cast<uint64_t>(info->inputLatency * 1e6);
+    uint64_t now = SteadyNowUs();
+    capture_stamp_us_ = now > age_us ? now - age_us : 0;
+}
+
+void PortAudioImpl::StampRingRead(uint64_t first_frame) {
+    int64_t origin = capture_origin_us_.load(std::memory_order_acquire);
+    int64_t stamp = origin + static_cast<int64_t>(first_frame * 1000000 / sample_rate_);
+    capture_stamp_us_ = origin != 0 && stamp > 0 && static_cast<uint64_t>(stamp) <= SteadyNowUs()
+                            ? static_cast<uint64_t>(stamp)
+                            : 0;
+}
+
+void PortAudioImpl::OnInput(const short* input, unsigned long frames) {
+    size_t samples = frames * channels_;
+    size_t written = capture_ring_->Write(input, samples);
+    if (written < samples) {
+        input_overflows_.fetch_add((samples - written) / channels_, std::memory_order_relaxed);
+    }
+    dispatch_semaphore_signal(capture_sem_);
+}
+
+void PortAudioImpl::OnOutput(short* output, unsigned long frames) {
+    size_t samples = frames * channels_;
+    if (playback_drop_.exchange(false, std::memory_order_acquire)) {
+        playback_ring_->DiscardTo(playback_drop_to_.load(std::memory_order_relaxed));
+    }
+    size_t n = playback_ring_->Read(output, samples);
+    if (n < samples) {
+        // 空闲时整块补零是正常状态，只有播放中途数据不足才计为欠载
+        if (n > 0) {
+            output_underflows_.fetch_add(1, std::memory_order_relaxed);
+        }
+        memset(output + n, 0, (samples - n) * sizeof(short));
+    }
+    dispatch_semaphore_signal(playback_sem_);
+}
+
+void PortAudioImpl::OnDuplex(const short* input, short* output, unsigned long frames) {
+    // 先渲染输出，再把本回调的采集和刚渲染的输出按帧交织存入采集环，两者天然对齐
+    OnOutput(output, frames);
+    const size_t ch = channels_;
+    const size_t max_frames = duplex_scratch_.size() / (ch * 2);
+    size_t done = 0;
+    while (done < frames) {
+        size_t n = std::min<size_t>(frames - done, max_frames);
+        short* dst = duplex_scratch_.data();
+        for (size_t i = 0; i < n; ++i) {
+            const size_t f = done + i;
+            for (size_t c = 0; c < ch; ++c) {
+                dst[(2 * i) * ch + c] = input ? input[f * ch + c] : 0;
+                dst[(2 * i + 1) * ch + c] = output[f * ch + c];
+            }
+        }
+        // 环满时只写入完整的帧，保证 [采集 | 参考] 的帧边界不错位
+        size_t fit = std::min(n, capture_ring_->Space() / (ch * 2));
+        capture_ring_->Write(dst, fit * ch * 2);
+        if (fit < n) {
+            input_overflows_.fetch_add(n - fit, std::memory_order_relaxed);
+        }
+        done += n;
+    }
+    dispatch_semaphore_signal(capture_sem_);
+}
+
+bool PortAudioImpl::ReadEchoReference(short* buffer, size_t frames) {
+    if (!duplex_mode_ || frames > reference_frames_) {
+        return false;
+    }
+    memcpy(buffer, reference_.data(), frames * channels_ * sizeof(short));
+    return true;
+}
+
+bool PortAudioImpl::ReadRing(short* buffer, size_t frames) {
+    const size_t frame_samples = static_cast<size_t>(channels_) * (duplex_mode_ ? 2 : 1);
+    const uint64_t first_frame = capture_ring_->ReadPosition() / frame_samples;
+    if (duplex_mode_) {
+        // 环中每帧是 [采集 | 参考]，整帧读出后拆开；第一次调用时按帧数分配
+        const size_t ch = channels_;
+        if (duplex_read_.size() < frames * ch * 2) {
+            duplex_read_.resize(frames * ch * 2);
+            reference_.resize(frames * ch);
+        }
+        size_t want = frames * ch * 2;
+        size_t got = 0;
+        while (got < want) {
+            got += capture_ring_->Read(duplex_read_.data() + got, want - got);
+            if (got < want &&
+                dispatch_semaphore_wait(capture_sem_, dispatch_time(DISPATCH_TIME_NOW, NSEC_PER_SEC)) != 0) {
+                ERROR("PortAudio read timeout");
+                return false;
+            }
+        }
+        for (size_t f = 0; f < frames; ++f) {
+            memcpy(buffer + f * ch, duplex_read_.data() + (2 * f) * ch, ch * sizeof(short));
+            memcpy(reference_.data() + f * ch, duplex_read_.data() + (2 * f + 1) * ch, ch * sizeof(short));
+        }
+        reference_frames_ = frames;
+        StampRingRead(first_frame);
+        return true;
+    }
+
+    size_t want = frames * channels_;
+    size_t got = 0;
+    while (got < want) {
+        got += capture_ring_->Read(buffer + got, want - got);
+        if (got < want &&
+            dispatch_semaphore_wait(capture_sem_, dispatch_time(DISPATCH_TIME_NOW, NSEC_PER_SEC)) != 0) {
+            ERROR("PortAudio read timeout");
+            return false;
+        }
+    }
+    StampRingRead(first_frame);
+    return true;
+}
+
+bool PortAudioImpl::WriteRing(const short* buffer, size_t frames) {
+    size_t want = frames * channels_;
+    size_t put = 0;
+    while (put < want) {
+        size_t queued = playback_ring_->Size();
+        size_t room = playback_limit_ > queued ? playback_limit_ - queued : 0;
+        put += playback_ring_->Write(buffer + put, std::min(room, want - put));
+        if (put < want &&
+            dispatch_semaphore_wait(playback_sem_, dispatch_time(DISPATCH_TIME_NOW, NSEC_PER_SEC)) != 0) {
+            ERROR("PortAudio write timeout");
+            return false;
+        }
+    }
+    return true;
+}
+
 }  // namespace linx
 
 #endif  // __APPLE__
\ No newline at end of file
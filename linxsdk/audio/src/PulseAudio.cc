@@ -0,0 +1,174 @@
+#ifdef LINX_HAVE_PULSEAUDIO
+
+#include "PulseAudio.h"
+
+#include <pulse/error.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+#include "Log.h"
+#include "Tracepoints.h"
+
+namespace linx {
+
+PulseAudio::~PulseAudio() {
+    if (capture_ != nullptr) {
+        pa_simple_free(capture_);
+    }
+    if (playback_ != nullptr) {
+        pa_simple_free(playback_);
+    }
+}
+
+bool PulseAudio::ServerAvailable() {
+    if (std::getenv("PULSE_SERVER") != nullptr) {
+        return true;
+    }
+    const char* dir = std::getenv("XDG_RUNTIME_DIR");
+    if (dir == nullptr) {
+        return false;
+    }
+    std::string path = std::string(dir) + "/pulse/native";
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode);
+}
+
+void PulseAudio::SetConfig(unsigned int sample_rate, int frame_size, int channels, int periods, int buffer_size,
+                           int period_size) {
+    (void)frame_size;
+    (void)periods;
+    sample_rate_ = sample_rate;
+    channels_ = channels;
+    buffer_size_ = buffer_size;
+    period_size_ = period_size;
+}
+
+bool PulseAudio::SetDevice(const std::string& capture, const std::string& playback) {
+    capture_device_ = capture == "default" ? std::string() : capture;
+    playback_device_ = playback == "default" ? std::string() : playback;
+    return true;
+}
+
+void PulseAudio::Record() {
+    if (capture_ != nullptr) {
+        return;
+    }
+    pa_sample_spec spec;
+    spec.format = PA_SAMPLE_S16LE;
+    spec.rate = sample_rate_;
+    spec.channels = static_cast<uint8_t>(channels_);
+    const uint32_t frame_bytes = static_cast<uint32_t>(sizeof(short) * channels_);
+    pa_buffer_attr attr;
+    attr.maxlength = static_cast<uint32_t>(-1);
+    attr.tlength = static_cast<uint32_t>(-1);
+    attr.prebuf = static_cast<uint32_t>(-1);
+    attr.minreq = static_cast<uint32_t>(-1);
+    attr.fragsize = static_cast<uint32_t>(period_size_) * frame_bytes;  // 每个周期交付一次
+    int error = 0;
+    capture_ = pa_simple_new(nullptr, "linx", PA_STREAM_RECORD,
+                             capture_device_.empty() ? nullptr : capture_device_.c_str(), "capture", &spec,
+                             nullptr, &attr, &error);
+    if (capture_ == nullptr) {
+        ERROR("PulseAudio open capture stream failed: {}", pa_strerror(error));
+        return;
+    }
+    INFO("PulseAudio recording started ({}Hz, {}ch, fragment {} frames)", sample_rate_, channels_, period_size_);
+}
+
+void PulseAudio::Play() {
+    if (playback_ != nullptr) {
+        return;
+    }
+    pa_sample_spec spec;
+    spec.format = PA_SAMPLE_S16LE;
+    spec.rate = sample_rate_;
+    spec.channels = static_cast<uint8_t>(channels_);
+    const uint32_t frame_bytes = static_cast<uint32_t>(sizeof(short) * channels_);
+    const uint32_t period_bytes = static_cast<uint32_t>(period_size_) * frame_bytes;
+    pa_buffer_attr attr;
+    attr.maxlength = static_cast<uint32_t>(-1);
+    // 服务端缓冲的目标长度：与 ALSA 设备缓冲相同（至少两个周期），一个周期的空间空出即可再写
+    attr.tlength = static_cast<uint32_t>(std::max(buffer_size_, period_size_ * 2)) * frame_bytes;
+    attr.prebuf = period_bytes;  // 攒够一个周期就开始播放
+    attr.minreq = period_bytes;
+    attr.fragsize = static_cast<uint32_t>(-1);
+    int error = 0;
+    playback_ = pa_simple_new(nullptr, "linx", PA_STREAM_PLAYBACK,
+                              playback_device_.empty() ? nullptr : playback_device_.c_str(), "playback", &spec,
+                              nullptr, &attr, &error);
+    if (playback_ == nullptr) {
+        ERROR("PulseAudio open playback stream failed: {}", pa_strerror(error));
+        return;
+    }
+    INFO("PulseAudio playback started ({}Hz, {}ch, target {} frames)", sample_rate_, channels_,
+         std::max(buffer_size_, period_size_ * 2));
+}
+
+bool PulseAudio::Read(short* buffer, size_t frame_size) {
+    LINX_PROBE_SCOPE(audio_read, frame_size);
+    if (capture_ == nullptr) {
+        ERROR("PulseAudio capture stream not initialized");
+        return false;
+    }
+    int error = 0;
+    if (pa_simple_read(capture_, buffer, frame_size * channels_ * sizeof(short), &error) < 0) {
+        capture_errors_.fetch_add(1, std::memory_order_relaxed);
+        ERROR("PulseAudio read error: {}", pa_strerror(error));
+        return false;
+    }
+    return true;
+}
+
+bool PulseAudio::Write(short* buffer, size_t frame_size) {
+    LINX_PROBE_SCOPE(audio_write, frame_size);
+    if (playback_ == nullptr) {
+        ERROR("PulseAudio playback stream not initialized");
+        return false;
+    }
+    int error = 0;
+    if (pa_simple_write(playback_, buffer, frame_size * channels_ * sizeof(short), &error) < 0) {
+        playback_errors_.fetch_add(1, std::memory_order_relaxed);
+        ERROR("PulseAudio write error: {}", pa_strerror(error));
+        return false;
+    }
+    return true;
+}
+
+long PulseAudio::GetPlaybackDelay() {
+    if (playback_ == nullptr) {
+        return -1;
+    }
+    int error = 0;
+    pa_usec_t latency = pa_simple_get_latency(playback_, &error);
+    if (latency == static_cast<pa_usec_t>(-1)) {
+        return -1;
+    }
+    return static_cast<long>(latency * sample_rate_ / 1000000);
+}
+
+bool PulseAudio::DropPlayback() {
+    if (playback_ == nullptr) {
+        return false;
+    }
+    int error = 0;
+    if (pa_simple_flush(playback_, &error) < 0) {
+        ERROR("PulseAudio playback drop failed: {}", pa_strerror(error));
+        return false;
+    }
+    return true;
+}
+
+AudioXrunStats PulseAudio::GetXrunStats() const {
+    // pa_simple 不报告欠载，只能统计读写失败
+    AudioXrunStats stats;
+    stats.capture_xruns = capture_errors_.load(std::memory_order_relaxed);
+    stats.playback_xruns = playback_errors_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace linx
+
+#endif  // LINX_HAVE_PULSEAUDIO
@@ -0,0 +1,227 @@
+#include "SentenceScheduler.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace linx {
+
+double SentenceScheduler::SamplesToMs(size_t samples) const {
+    const JitterBufferConfig& config = jitter_.Config();
+    return 1000.0 * samples / (config.sample_rate * std::max(1, config.channels));
+}
+
+size_t SentenceScheduler::CurrentLocked() const {
+    for (size_t i = sentences_.size(); i > 0; --i) {
+        const Sentence& sentence = sentences_[i - 1];
+        if (sentence.first_play_us != 0 || sentence.skipped) {
+            return i - 1;
+        }
+    }
+    return sentences_.empty() ? kNone : 0;
+}
+
+void SentenceScheduler::UpdateNextStartLocked() {
+    for (const Sentence& sentence : sentences_) {
+        if (sentence.first_play_us == 0 && !sentence.skipped) {
+            next_start_.store(sentence.start, std::memory_order_relaxed);
+            has_next_start_.store(true, std::memory_order_release);
+            return;
+        }
+    }
+    has_next_start_.store(false, std::memory_order_release);
+}
+
+void SentenceScheduler::BeginReply() {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    sentences_.clear();
+    next_index_ = 1;
+    stop_after_ = false;
+    has_next_start_.store(false, std::memory_order_release);
+    awaiting_packet_.store(false, std::memory_order_relaxed);
+    dropping_.store(false, std::memory_order_release);
+}
+
+void SentenceScheduler::BeginSentence(std::string_view text) {
+    uint64_t now = LatencyTracer::NowUs();
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    sentences_total_.fetch_add(1, std::memory_order_relaxed);
+    if (stop_after_) {
+        // 已请求在上一句句尾停止：从这里截断，本句及之后的音频都不再播放
+        if (!dropping_.load(std::memory_order_relaxed)) {
+            jitter_.Truncate(jitter_.WritePosition());
+            dropping_.store(true, std::memory_order_release);
+        }
+        truncated_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    dropping_.store(false, std::memory_order_release);  // 上一句被跳过时，从这一句恢复接收
+    if (sentences_.size() >= kMaxSentences) {
+        sentences_.pop_front();
+    }
+    Sentence sentence;
+    sentence.index = next_index_++;
+    sentence.text = std::string(text);
+    sentence.start = jitter_.WritePosition();
+    sentence.begin_us = now;
+    sentences_.push_back(std::move(sentence));
+    awaiting_packet_.store(true, std::memory_order_relaxed);
+    UpdateNextStartLocked();
+}
+
+void SentenceScheduler::EndSentence() {
+    // 被跳过或截断的句子没有数据留在缓冲区里，不需要标记句尾
+    if (!dropping_.load(std::memory_order_acquire)) {
+        jitter_.MarkEndOfStream();
+    }
+}
+
+void SentenceScheduler::OnAudio() {
+    if (!awaiting_packet_.exchange(false, std::memory_order_relaxed)) {
+        return;
+    }
+    uint64_t now = LatencyTracer::NowUs();
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    if (!sentences_.empty() && sentences_.back().first_packet_us == 0) {
+        sentences_.back().first_packet_us = now;
+    }
+}
+
+void SentenceScheduler::OnPlayed(uint64_t played_through_us) {
+    if (!has_next_start_.load(std::memory_order_acquire)) {
+        return;
+    }
+    size_t read = jitter_.ReadPosition();
+    if (static_cast<ptrdiff_t>(read - next_start_.load(std::memory_order_relaxed)) <= 0) {
+        return;
+    }
+
+    uint64_t now = LatencyTracer::NowUs();
+    const JitterBufferConfig& config = jitter_.Config();
+    uint64_t samples_per_second = static_cast<uint64_t>(config.sample_rate) * std::max(1, config.channels);
+    std::vector<SentenceReport> reports;
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        size_t write = jitter_.WritePosition();
+        for (size_t i = 0; i < sentences_.size(); ++i) {
+            Sentence& sentence = sentences_[i];
+            if (sentence.first_play_us != 0 || sentence.skipped) {
+                continue;
+            }
+            ptrdiff_t ahead = static_cast<ptrdiff_t>(read - sentence.start);
+            if (ahead <= 0) {
+                break;
+            }
+            // 这次写入的最后一个样本在 played_through_us 后播出，起点样本比它早 ahead 个样本
+            uint64_t ahead_us = static_cast<uint64_t>(ahead) * 1000000 / samples_per_second;
+            uint64_t play_us = now + played_through_us;
+            play_us = play_us > ahead_us ? play_us - ahead_us : 0;
+            play_us = std::max(play_us, sentence.begin_us + 1);
+            sentence.first_play_us = play_us;
+
+            SentenceReport report;
+            report.index = sentence.index;
+            report.text = sentence.text;
+            report.first_packet_ms =
+                sentence.first_packet_us > sentence.begin_us ? (sentence.first_packet_us - sentence.begin_us) / 1000.0 : 0;
+            report.first_play_ms = (play_us - sentence.begin_us) / 1000.0;
+            size_t end = i + 1 < sentences_.size() ? sentences_[i + 1].start : write;
+            report.buffered_ms = SamplesToMs(static_cast<ptrdiff_t>(end - sentence.start) > 0 ? end - sentence.start : 0);
+            if (i > 0 && sentences_[i - 1].first_play_us != 0 && !sentences_[i - 1].skipped) {
+                // 上一句从开始播出起连续播放的话，这一句本应在这个时刻开始
+                const Sentence& previous = sentences_[i - 1];
+                uint64_t expected_us =
+                    previous.first_play_us + (sentence.start - previous.start) * 1000000 / samples_per_second;
+                report.stall_ms = play_us > expected_us ? (play_us - expected_us) / 1000.0 : 0;
+            }
+            reports.push_back(std::move(report));
+        }
+        // 只保留正在播放的一句（下一句计算停顿要用）和之后的句子
+        while (sentences_.size() > 1 && (sentences_[1].first_play_us != 0 || sentences_[1].skipped)) {
+            sentences_.pop_front();
+        }
+        UpdateNextStartLocked();
+    }
+
+    for (const SentenceReport& report : reports) {
+        played_.fetch_add(1, std::memory_order_relaxed);
+        RecordStall(report.stall_ms);
+        if (report.first_play_ms > max_first_play_ms_.load(std::memory_order_relaxed)) {
+            max_first_play_ms_.store(report.first_play_ms, std::memory_order_relaxed);
+        }
+        if (tracer_) {
+            tracer_->Record(LatencyStage::SentenceFirstPlay, static_cast<uint64_t>(report.first_play_ms * 1000));
+            tracer_->Record(LatencyStage::SentenceStall, static_cast<uint64_t>(report.stall_ms * 1000));
+        }
+        if (report_handler_) {
+            report_handler_(report);
+        }
+    }
+}
+
+void SentenceScheduler::RecordStall(double stall_ms) {
+    last_stall_ms_.store(stall_ms, std::memory_order_relaxed);
+    if (stall_ms > max_stall_ms_.load(std::memory_order_relaxed)) {
+        max_stall_ms_.store(stall_ms, std::memory_order_relaxed);
+    }
+}
+
+bool SentenceScheduler::Skip() {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    size_t current = CurrentLocked();
+    // 连续跳过时，上一次跳过的句子之后的那一句才是要跳过的
+    while (current != kNone && sentences_[current].skipped) {
+        current = current + 1 < sentences_.size() ? current + 1 : kNone;
+    }
+    if (current == kNone) {
+        return false;
+    }
+    sentences_[current].skipped = true;
+    skipped_.fetch_add(1, std::memory_order_relaxed);
+    if (current + 1 < sentences_.size()) {
+        jitter_.FlushTo(sentences_[current + 1].start);  // 下一句已预读，直接从它的开头播放
+    } else {
+        jitter_.Flush();
+        dropping_.store(true, std::memory_order_release);  // 这一句剩下的音频到达后直接丢弃
+    }
+    UpdateNextStartLocked();
+    return true;
+}
+
+bool SentenceScheduler::StopAfterSentence() {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    size_t current = CurrentLocked();
+    if (current == kNone) {
+        return false;
+    }
+    stop_after_ = true;
+    if (current + 1 < sentences_.size()) {
+        // 后面的句子已经开始预读：在下一句起点截断
+        jitter_.Truncate(sentences_[current + 1].start);
+        dropping_.store(true, std::memory_order_release);
+        truncated_.fetch_add(sentences_.size() - current - 1, std::memory_order_relaxed);
+        sentences_.erase(sentences_.begin() + static_cast<ptrdiff_t>(current) + 1, sentences_.end());
+        UpdateNextStartLocked();
+    }
+    return true;
+}
+
+void SentenceScheduler::Cancel() {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    sentences_.clear();
+    has_next_start_.store(false, std::memory_order_release);
+    awaiting_packet_.store(false, std::memory_order_relaxed);
+}
+
+SentenceStats SentenceScheduler::GetStats() const {
+    SentenceStats stats;
+    stats.sentences = sentences_total_.load(std::memory_order_relaxed);
+    stats.played = played_.load(std::memory_order_relaxed);
+    stats.skipped = skipped_.load(std::memory_order_relaxed);
+    stats.truncated = truncated_.load(std::memory_order_relaxed);
+    stats.last_stall_ms = last_stall_ms_.load(std::memory_order_relaxed);
+    stats.max_stall_ms = max_stall_ms_.load(std::memory_order_relaxed);
+    stats.max_first_play_ms = max_first_play_ms_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace linx
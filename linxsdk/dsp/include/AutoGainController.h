@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace linx {
+
+// 自动增益配置
+struct AutoGainConfig {
+    unsigned int sample_rate = 16000;
+    int channels = 1;                 // 交错声道数，所有声道使用同一增益
+    float target_dbfs = -20.0f;       // 目标电平（块 RMS）
+    float max_gain_db = 24.0f;        // 最大放大量
+    float min_gain_db = -12.0f;       // 最大衰减量
+    float attack_ms = 20.0f;          // 电平高于目标时增益下降的时间常数
+    float release_ms = 1500.0f;       // 电平低于目标时增益回升的时间常数
+    float min_input_dbfs = -55.0f;    // 低于此电平的块视为静音，保持增益不变（不把底噪放大到目标）
+    float limiter_dbfs = -1.0f;       // 限幅：输出峰值不超过此电平
+};
+
+// 自动增益统计
+struct AutoGainStats {
+    uint64_t blocks = 0;          // 处理的 10ms 块数
+    uint64_t active_blocks = 0;   // 电平高于 min_input_dbfs、参与增益调节的块数
+    uint64_t limited_blocks = 0;  // 限幅器压低了增益的块数
+    double gain_db = 0;           // 当前增益
+    double input_dbfs = -100;     // 最近一个有声块的输入电平
+};
+
+// 采集路径的数字 AGC：按 10ms 一块用 PcmMeasure（SIMD）测量 RMS 和峰值，
+// 在 dB 域里把增益往 target_dbfs - 输入电平 平滑（高于目标用 attack_ms，低于目标用 release_ms），
+// 静音块保持增益；每块分几段从上一块的增益插值到新增益，用 PcmGain（SIMD，饱和）原地施加。
+// 限幅器按每段的峰值把该段增益压到峰值不超过 limiter_dbfs，本块已在手中，不需要额外的前视延迟。
+// O(帧长)，不分配内存，不增加延迟；只在一个线程上调用 Process
+class AutoGainController {
+public:
+    explicit AutoGainController(const AutoGainConfig& config = AutoGainConfig());
+
+    AutoGainController(const AutoGainController&) = delete;
+    AutoGainController& operator=(const AutoGainController&) = delete;
+
+    // 原地处理交错 PCM，frames 为每声道样本数，任意长度（不足一块的尾部按实际时长单独算一块）
+    void Process(short* pcm, size_t frames);
+
+    // 增益回到 0dB
+    void Reset();
+
+    AutoGainStats GetStats() const;
+
+private:
+    static constexpr size_t kSegments = 4;  // 每块的插值段数
+
+    // 处理一块（或不足一块的尾部），frames 为每声道样本数
+    void ProcessBlock(short* pcm, size_t frames);
+    float Coefficient(float tau_ms, size_t frames) const;
+
+    AutoGainConfig config_;
+    size_t block_frames_;    // 每块的每声道样本数（10ms）
+    float attack_;           // 整块的平滑系数
+    float release_;
+    float min_input_ms_;     // min_input_dbfs 换算为每样本均方（满幅 32768 为 1）
+    float limit_peak_;       // limiter_dbfs 换算为峰值（int16）
+    float gain_db_ = 0;      // 平滑后的增益
+    float applied_gain_ = 1.0f;  // 上一段实际施加的线性增益，插值起点
+
+    std::atomic<uint64_t> blocks_{0};
+    std::atomic<uint64_t> active_blocks_{0};
+    std::atomic<uint64_t> limited_blocks_{0};
+    std::atomic<double> gain_db_stat_{0};
+    std::atomic<double> input_dbfs_{-100};
+};
+
+}  // namespace linx
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Fft.h"
+#include "LatencyHistogram.h"
+
+namespace linx {
+
+// 麦克风在阵列坐标系中的位置（米）。方位角在 xy 平面内从 +x 轴起逆时针计（度）
+struct MicPosition {
+    float x = 0;
+    float y = 0;
+    float z = 0;
+};
+
+// 波束形成配置
+struct BeamformerConfig {
+    unsigned int sample_rate = 16000;
+    std::vector<MicPosition> mics;  // 每个采集声道一个，顺序与交织顺序一致（至少 2 个）
+    float steer_deg = 0;            // 初始波束方向
+    bool track = true;              // 按声源方位估计自动转向波束
+    int directions = 72;            // 方位扫描的方向数（360 / directions 度一格）
+    float doa_min_hz = 300;         // 方位估计使用的频带
+    float doa_max_hz = 4000;
+    float doa_smoothing = 0.9f;     // 方位谱的逐块平滑系数（0～1），越大越稳、转向越慢
+    float min_confidence = 0.3f;    // 置信度达到这个值才转向波束
+    float doa_gate_dbfs = -55;      // 块电平低于这个值时不更新方位（静音时保持上一次的方向）
+};
+
+// 波束形成统计
+struct BeamformerStats {
+    uint64_t frames = 0;     // Process 调用次数
+    uint64_t blocks = 0;     // 处理的 10ms 块数
+    uint64_t doa_updates = 0;  // 参与方位估计的块数（电平超过 doa_gate_dbfs）
+    uint64_t steers = 0;     // 波束转向次数（含 Steer 调用）
+    uint64_t total_us = 0;   // Process 累计耗时（微秒）
+    uint64_t max_us = 0;     // 单次 Process 最长耗时
+    float doa_deg = 0;       // 当前方位估计
+    float confidence = 0;    // 方位估计的置信度（0～1）
+    float steer_deg = 0;     // 当前波束方向
+};
+
+// 麦克风阵列的频域延迟求和波束形成与声源方位估计，输出单声道供后续回声消除 / 降噪 / 编码。
+// 分帧与 NoiseSuppressor 相同：10ms 一块、50% 重叠的平方根汉宁窗，补零到 2 的幂做实数 FFT。
+// 交织输入先拆成逐声道的平面（PcmDeinterleave），每声道各做一次 FFT，频谱按声道连续存放（SoA）；
+// 波束输出为各声道频谱乘以转向权重 e^(-jωτ)/C 后求和（PcmKernels::complex_mac，SIMD），逆变换后重叠相加。
+// 方位估计用 SRP-PHAT：频带内各声道的白化频谱按预先算好的方向表逐方向加权求和，取能量最大的方向，
+// 方位谱逐块平滑，置信度为峰值高出均值的比例。线阵（麦克风共线）无法区分前后，方位只在 0～180 度有意义。
+// 输出比输入延迟一块（10ms）。构造时分配全部状态，Process 不分配内存；每次 Process 的耗时计入 FrameCost() 直方图
+class Beamformer {
+public:
+    explicit Beamformer(const BeamformerConfig& config);
+
+    Beamformer(const Beamformer&) = delete;
+    Beamformer& operator=(const Beamformer&) = delete;
+
+    // 均匀圆阵：mics 个麦克风从 +x 轴起逆时针等分半径为 radius_m 的圆
+    static std::vector<MicPosition> CircularArray(int mics, float radius_m);
+    // 均匀线阵：沿 x 轴、以原点为中心、间距 spacing_m
+    static std::vector<MicPosition> LinearArray(int mics, float spacing_m);
+
+    // in 为 Channels() 声道交织的 frames 帧，输出 frames 个单声道样本到 out。
+    // frames 应为 BlockSamples() 的整数倍，不足一块的尾部输出第一个声道
+    void Process(const short* in, size_t frames, short* out);
+
+    // 把波束转向 degrees（任意线程调用，下一块生效）；打开跟踪时之后仍会按方位估计转向
+    void Steer(float degrees);
+    void SetTracking(bool enabled) { track_.store(enabled, std::memory_order_relaxed); }
+
+    // 最近的声源方位（度，0～360）与置信度，任意线程读取
+    float DoaDegrees() const { return doa_deg_.load(std::memory_order_relaxed); }
+    float DoaConfidence() const { return confidence_.load(std::memory_order_relaxed); }
+    float SteerDegrees() const { return steer_deg_.load(std::memory_order_relaxed); }
+
+    // 清空窗口历史和方位谱
+    void Reset();
+
+    int Channels() const { return channels_; }
+    size_t BlockSamples() const { return hop_; }
+    const LatencyHistogram& FrameCost() const { return frame_us_; }
+    BeamformerStats GetStats() const;
+
+private:
+    void ProcessBlock(const short* const* planes);
+    void UpdateWeights(float degrees);
+    void EstimateDoa();
+    // 声源在 degrees 方向时第 c 个麦克风相对原点提前到达的时间（秒）
+    double Advance(int c, double degrees) const;
+
+    BeamformerConfig config_;
+    int channels_;
+    size_t hop_;
+    size_t window_size_;
+    size_t bins_;
+    size_t band_lo_ = 0;        // 方位估计频带 [band_lo_, band_lo_ + band_bins_)
+    size_t band_bins_ = 0;
+    float gate_mean_square_;    // doa_gate_dbfs 换算的每样本均方（浮点满幅为 1）
+
+    RealFft fft_;
+    std::vector<float> window_;
+    std::vector<float> input_;      // 每声道 window_size_：上一块 + 当前块
+    std::vector<short> planes_;     // 每声道 hop_ 个 int16（拆分后的平面）
+    std::vector<short*> plane_ptrs_;
+    std::vector<float> frame_;
+    std::vector<float> spec_re_;    // 每声道 bins_ 个频点，按声道连续存放
+    std::vector<float> spec_im_;
+    std::vector<float> weight_re_;  // 当前波束的转向权重，每声道 bins_ 个
+    std::vector<float> weight_im_;
+    std::vector<float> sum_re_;     // 加权求和后的频谱
+    std::vector<float> sum_im_;
+    std::vector<float> output_;
+    std::vector<float> overlap_;
+    // SRP-PHAT
+    std::vector<float> phat_re_;    // 频带内白化后的频谱，每声道 band_bins_ 个
+    std::vector<float> phat_im_;
+    std::vector<float> table_re_;   // 方向表：[方向][声道][频带频点]
+    std::vector<float> table_im_;
+    std::vector<float> acc_re_;
+    std::vector<float> acc_im_;
+    std::vector<float> srp_;        // 平滑后的方位谱
+    bool srp_primed_ = false;
+    float current_steer_;           // 权重对应的方向（仅处理线程）
+
+    LatencyHistogram frame_us_;
+    std::atomic<bool> track_;
+    std::atomic<bool> steer_pending_{false};
+    std::atomic<float> steer_request_{0};
+    std::atomic<float> doa_deg_{0};
+    std::atomic<float> confidence_{0};
+    std::atomic<float> steer_deg_{0};
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> blocks_{0};
+    std::atomic<uint64_t> doa_updates_{0};
+    std::atomic<uint64_t> steers_{0};
+    std::atomic<uint64_t> total_us_{0};
+    std::atomic<uint64_t> max_us_{0};
+};
+
+}  // namespace linx
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PcmRing.h"
+
+namespace linx {
+
+// 回声消除配置（单声道）
+struct EchoCancellerConfig {
+    unsigned int sample_rate = 16000;
+    int filter_ms = 128;             // 自适应滤波器覆盖的回声路径长度（含参考信号的对齐误差）
+    int delay_ms = 0;                // 参考信号先固定延迟这么久再进滤波器（回声路径中的纯延迟，如启动时的回环校准结果），
+                                     // 滤波器只需覆盖其后的 filter_ms
+    float step = 0.3f;               // NLMS 步长（0～1），越大收敛越快、稳态失调越大
+    float reference_floor_dbfs = -60.0f;  // 参考信号低于此电平时视为无回声，不更新滤波器
+    float residual_ratio = 0.5f;     // 双讲检测：残差能量超过回声估计能量的 ratio 倍判为近端说话
+    int double_talk_hangover_ms = 80;  // 检测到双讲后冻结自适应的时长
+    bool suppress = true;            // 残余回声抑制（NLP）
+    float suppress_floor = 0.1f;     // 抑制增益下限（线性，0.1 约 -20dB）
+};
+
+// 回声消除统计
+struct EchoCancellerStats {
+    uint64_t blocks = 0;              // 处理的块数
+    uint64_t active_blocks = 0;       // 参考信号有效（扬声器在播放）的块数
+    uint64_t double_talk_blocks = 0;  // 判为双讲、冻结自适应的块数
+    uint64_t diverged_blocks = 0;     // 输出能量超过输入、按原信号输出的块数
+    double erle_db = 0;               // 回声回波损耗增强（平滑），越大消除越彻底
+};
+
+// 时域 NLMS 自适应回声消除器
+// 按 64 样本一块处理：对每个样本用参考信号历史与滤波器做点积（DotF32，SIMD）估计回声并相减，
+// 无双讲时按归一化步长更新滤波器；收敛后若残差相对回声估计明显变大则判为近端说话并冻结自适应，
+// 避免滤波器被近端语音带偏（能量比判据不受扬声器-麦克风耦合强弱影响）；
+// 可选的残余回声抑制按块估计回声占比衰减输出。构造时分配全部状态，Process 不分配内存。
+// 代价约为每样本 2 * taps 次乘加（16kHz、128ms 时 taps = 2048）。
+class EchoCanceller {
+public:
+    explicit EchoCanceller(const EchoCancellerConfig& config = EchoCancellerConfig());
+
+    EchoCanceller(const EchoCanceller&) = delete;
+    EchoCanceller& operator=(const EchoCanceller&) = delete;
+
+    // mic 为采集信号，ref 为同一时刻送往扬声器的信号（与 mic 大致对齐，误差在 filter_ms 内），
+    // 输出写入 out（可与 mic 相同）；n 为样本数，任意长度
+    void Process(const short* mic, const short* ref, short* out, size_t n);
+
+    // 清空滤波器和历史（如切换设备后）
+    void Reset();
+
+    size_t Taps() const { return taps_; }
+    size_t DelaySamples() const { return delay_line_.size(); }
+    EchoCancellerStats GetStats() const;
+
+private:
+    static constexpr size_t kBlock = 64;
+
+    void ProcessBlock(const float* mic, size_t n, float* out);
+
+    EchoCancellerConfig config_;
+    size_t taps_;
+    float ref_floor_;         // 参考信号有效的块能量下限（每样本均方）
+    size_t hangover_blocks_;
+
+    std::vector<float> weights_;  // 按时间逆序存放，与参考历史窗口直接点积
+    std::vector<float> history_;  // 参考信号历史，前 taps-1 个为上一块遗留
+    std::vector<float> delay_line_;  // delay_ms 的固定延迟线（环形），为空时不延迟
+    size_t delay_pos_ = 0;
+    float energy_ = 0;            // 当前窗口内参考信号能量
+    size_t double_talk_left_ = 0;
+    size_t double_talk_run_ = 0;  // 连续冻结的块数，过长视为回声路径变化
+    size_t diverged_run_ = 0;     // 连续发散的块数
+    bool residual_double_talk_ = false;  // 上一块按残差判定的双讲结果
+    float nlp_gain_ = 1.0f;
+
+    std::vector<float> mic_block_;
+    std::vector<float> out_block_;
+
+    std::atomic<uint64_t> blocks_{0};
+    std::atomic<uint64_t> active_blocks_{0};
+    std::atomic<uint64_t> double_talk_blocks_{0};
+    std::atomic<uint64_t> diverged_blocks_{0};
+    std::atomic<double> erle_db_{0};
+};
+
+// 播放参考信号缓冲：播放路径（单生产者）写入实际送往设备的数据，采集路径（单消费者）按帧取出。
+// 播放端每次写设备都同步写入参考、采集端按实时节奏读取，因此缓冲深度自然约等于设备中的待播数据，
+// 读出的参考与当前采集的回声大致对齐，剩余误差由 EchoCanceller 的滤波器长度覆盖。
+class EchoReference {
+public:
+    // capacity_samples 为最多缓存的样本数，max_delay_samples 为允许的最大深度（超出的旧数据在 Pull 时丢弃）
+    EchoReference(size_t capacity_samples, size_t max_delay_samples)
+        : ring_(capacity_samples), max_delay_(max_delay_samples) {}
+
+    // 播放线程：写入送往设备的数据；满时丢弃
+    void Push(const short* pcm, size_t n) { ring_.Write(pcm, n); }
+
+    // 播放线程：写入 n 个静音样本（设备补静音时调用，保持时间线连续）
+    void PushSilence(size_t n) {
+        while (n > 0) {
+            size_t contiguous = 0;
+            short* dst = ring_.WriteRegion(&contiguous);
+            if (contiguous == 0) {
+                return;
+            }
+            size_t chunk = n < contiguous ? n : contiguous;
+            for (size_t i = 0; i < chunk; ++i) {
+                dst[i] = 0;
+            }
+            ring_.CommitWrite(chunk);
+            n -= chunk;
+        }
+    }
+
+    // 播放线程：设备缓冲被丢弃（DropPlayback）时调用，此前写入的参考不会再被播出，由下一次 Pull 丢弃
+    void Flush() {
+        flush_to_.store(ring_.WritePosition(), std::memory_order_relaxed);
+        flush_pending_.store(true, std::memory_order_release);
+    }
+
+    // 采集线程：取出 n 个样本，不足的部分补零；深度超过 max_delay 时先丢弃最旧的数据
+    void Pull(short* out, size_t n) {
+        if (flush_pending_.exchange(false, std::memory_order_acquire)) {
+            ring_.DiscardTo(flush_to_.load(std::memory_order_relaxed));
+        }
+        size_t depth = ring_.Size();
+        while (depth > max_delay_ + n) {
+            size_t contiguous = 0;
+            ring_.ReadRegion(&contiguous);
+            size_t skip = depth - max_delay_ - n;
+            skip = skip < contiguous ? skip : contiguous;
+            if (skip == 0) {
+                break;
+            }
+            ring_.CommitRead(skip);
+            depth -= skip;
+        }
+        size_t got = ring_.Read(out, n);
+        for (size_t i = got; i < n; ++i) {
+            out[i] = 0;
+        }
+    }
+
+    size_t Depth() const { return ring_.Size(); }
+
+private:
+    PcmRing ring_;
+    size_t max_delay_;
+    std::atomic<bool> flush_pending_{false};
+    std::atomic<size_t> flush_to_{0};
+};
+
+}  // namespace linx
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PcmKernels.h"
+
+namespace linx {
+
+// 基 2 复数 FFT（实部虚部分开存放，原地计算）
+// 构造时算好位反转表和逐级连续存放的旋转因子，每级的蝶形交给 PcmKernels::fft_butterfly（SIMD），
+// 变换本身不分配内存。长度须为 2 的幂（>= 2）。Forward 不归一化，Inverse 含 1/N
+class Fft {
+public:
+    explicit Fft(size_t size);
+
+    size_t Size() const { return size_; }
+
+    void Forward(float* re, float* im) const;
+    void Inverse(float* re, float* im) const;
+
+private:
+    size_t size_;
+    std::vector<uint32_t> swaps_;  // 位反转需要交换的下标对
+    std::vector<float> twiddle_re_;  // 第 s 级（半长 h = 2^s，h >= 2）的 h 个因子从下标 h - 2 开始
+    std::vector<float> twiddle_im_;
+    const PcmKernels& kernels_;
+};
+
+// 实数 FFT：把 N 点实数序列按奇偶样本打包成 N/2 点复数序列做 FFT，再拆出 N/2 + 1 个频点，
+// 代价约为同长度复数 FFT 的一半。变换不分配内存，但有内部工作缓冲区，同一对象不能在多个线程上同时使用。
+// 长度须为 2 的幂（>= 4）。Forward 不归一化，Inverse 含 1/N
+class RealFft {
+public:
+    explicit RealFft(size_t size);
+
+    size_t Size() const { return size_; }
+    size_t Bins() const { return size_ / 2 + 1; }
+
+    // x 为 Size() 个样本，输出 Bins() 个频点（0 ～ Nyquist）
+    void Forward(const float* x, float* re, float* im);
+    // 由 Bins() 个频点还原 Size() 个样本（DC 和 Nyquist 的虚部忽略）
+    void Inverse(const float* re, const float* im, float* x);
+
+private:
+    size_t size_;
+    Fft half_;
+    std::vector<float> split_re_;  // e^(-2πik/N)，k < N/2
+    std::vector<float> split_im_;
+    std::vector<float> work_re_;
+    std::vector<float> work_im_;
+};
+
+}  // namespace linx
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Fft.h"
+
+namespace linx {
+
+// 唤醒词检测接口：逐帧送入 PCM，命中时返回关键词编号（>= 0），否则返回 -1。
+// 由 CapturePump 在门控关闭期间调用，可替换为任意神经网络或模板实现；
+// 实现须保证单帧耗时与帧长成正比且不分配内存，命中后自行处理防抖（同一次发声只返回一次）。
+class KeywordSpotter {
+public:
+    virtual ~KeywordSpotter() = default;
+
+    // pcm 为交织样本，samples 为每声道样本数
+    virtual int Process(const short* pcm, size_t samples) = 0;
+
+    // 丢弃已累积的音频（如门控重新关闭时）
+    virtual void Reset() {}
+
+    // 编号对应的关键词文本（用于 listen detect 消息），编号无效时返回空
+    virtual std::string_view Keyword(int index) const = 0;
+};
+
+// 模板匹配唤醒词配置
+struct TemplateSpotterConfig {
+    unsigned int sample_rate = 16000;
+    int channels = 1;               // 声道数，只分析第一个声道
+    double threshold = 5.0;         // 匹配路径上每帧的平均倒谱距离低于此值时命中，须按设备和模板标定
+    double min_speech_dbfs = -45.0;  // 登记模板时裁掉首尾低于此能量的帧；检测时整段都低于此值不命中
+    int refractory_ms = 1500;       // 命中后的静默期，期间不再检测
+};
+
+// 基于模板的唤醒词检测：每 10ms 计算一帧 MFCC（c1~c12，不含能量项，对音量不敏感），
+// 与登记的模板做子序列 DTW（开放起点，每帧只更新一列，O(模板帧数 × 12)），
+// 路径终点到达模板末尾且平均距离低于阈值即命中。适合设备上录几遍唤醒词登记的场景，
+// 同一关键词可登记多个模板。
+class TemplateKeywordSpotter : public KeywordSpotter {
+public:
+    static constexpr int kCoefficients = 12;
+
+    explicit TemplateKeywordSpotter(const TemplateSpotterConfig& config = TemplateSpotterConfig());
+
+    // 登记一段录音（sample_rate、channels 与配置一致）为关键词模板，首尾静音自动裁掉；
+    // 返回关键词编号，有效语音不足 200ms 时返回 -1。须在开始检测前调用
+    int AddTemplate(std::string_view keyword, const short* pcm, size_t samples);
+
+    int Process(const short* pcm, size_t samples) override;
+    void Reset() override;
+    std::string_view Keyword(int index) const override;
+
+    size_t Templates() const { return templates_.size(); }
+    // 最近一帧各模板中最好的匹配得分（平均距离），便于标定阈值；还没有完整匹配时为很大的值
+    double LastScore() const { return last_score_; }
+
+private:
+    struct Features {
+        float c[kCoefficients];
+        float dbfs;
+    };
+    struct Template {
+        int keyword;
+        std::vector<Features> frames;
+        // DTW 的上一列和当前列：累计距离、路径帧数、路径上能量超过下限的帧数
+        std::vector<float> cost;
+        std::vector<float> next_cost;
+        std::vector<uint32_t> length;
+        std::vector<uint32_t> next_length;
+        std::vector<uint32_t> voiced;
+        std::vector<uint32_t> next_voiced;
+    };
+
+    // 把一个声道的样本送进分帧缓冲，每凑满一跳计算一帧特征并交给 on_frame
+    template <typename OnFrame>
+    void Analyze(const short* pcm, size_t samples, OnFrame on_frame);
+    void ComputeFeatures(Features* out);
+    // 用一帧特征推进所有模板的 DTW，返回命中的关键词编号
+    int Match(const Features& frame);
+    void ResetMatch();
+
+    TemplateSpotterConfig config_;
+    size_t hop_;          // 每帧步长（10ms）
+    size_t window_;       // 分析窗长（25ms）
+    size_t fft_size_;
+    std::vector<float> history_;   // 最近 window_ 个样本
+    size_t history_fill_ = 0;
+    std::vector<float> hamming_;
+    std::unique_ptr<RealFft> fft_;
+    std::vector<float> frame_;     // 预加重、加窗并补零后的一帧
+    std::vector<float> re_;        // 频谱（0 ～ Nyquist）
+    std::vector<float> im_;
+    std::vector<float> mel_;       // 三角滤波器组：每个 FFT 点对各滤波器的权重（稠密存储，尺寸小）
+    std::vector<float> dct_;
+    std::vector<float> bands_;
+    std::vector<std::string> keywords_;
+    std::vector<Template> templates_;
+    size_t refractory_frames_;
+    size_t refractory_left_ = 0;
+    double last_score_ = 1e9;
+};
+
+}  // namespace linx
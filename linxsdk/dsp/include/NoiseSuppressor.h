@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Fft.h"
+#include "LatencyHistogram.h"
+
+namespace linx {
+
+// 降噪配置（单声道）
+struct NoiseSuppressorConfig {
+    unsigned int sample_rate = 16000;
+    float max_suppression_db = 15.0f;  // 每个频点最多压低多少 dB（增益下限），越大残余噪声越少、语音失真越明显
+    float noise_rise_db_per_s = 5.0f;  // 噪声估计的最大上升速度，决定噪声变大后多久跟上
+    float prior_smoothing = 0.98f;     // 先验信噪比的判决引导平滑系数（0～1），越大音乐噪声越少、语音起始越钝
+};
+
+// 降噪统计
+struct NoiseSuppressorStats {
+    uint64_t frames = 0;     // Process 调用次数（通常每次一个采集帧）
+    uint64_t blocks = 0;     // 处理的 10ms 块数
+    uint64_t total_us = 0;   // Process 累计耗时（微秒）
+    uint64_t max_us = 0;     // 单次 Process 最长耗时
+    double noise_dbfs = 0;   // 当前噪声估计的电平
+};
+
+// 频域维纳滤波降噪器
+// 按 10ms 一块、50% 重叠的平方根汉宁窗分析（窗长 20ms，补零到 2 的幂做实数 FFT，蝶形走 PcmKernels 的 SIMD 内核），
+// 逐频点以平滑功率谱的最小值跟踪噪声（快降、按 noise_rise_db_per_s 慢升），判决引导法估计先验信噪比，
+// 增益 ξ / (1 + ξ) 不低于 max_suppression_db 对应的下限，再逆变换加窗重叠相加。
+// 每次 Process 处理整数个块，帧内先算后出，输出比输入只延迟一块（10ms），20/60ms 的采集帧直接整帧送入。
+// 构造时分配全部状态，Process 不分配内存；每次 Process 的耗时计入 FrameCost() 直方图
+class NoiseSuppressor {
+public:
+    explicit NoiseSuppressor(const NoiseSuppressorConfig& config = NoiseSuppressorConfig());
+
+    NoiseSuppressor(const NoiseSuppressor&) = delete;
+    NoiseSuppressor& operator=(const NoiseSuppressor&) = delete;
+
+    // 输出写入 out（可与 in 相同），n 应为 BlockSamples() 的整数倍，不足一块的尾部原样输出
+    void Process(const short* in, short* out, size_t n);
+    // float32 版本（满幅为 [-1, 1)，输入输出都不经过 int16），供 ReadFloat → 浮点 DSP → 浮点编码的链路
+    void Process(const float* in, float* out, size_t n);
+
+    // 清空窗口历史和噪声估计（如切换设备后）
+    void Reset();
+
+    size_t BlockSamples() const { return hop_; }
+    size_t FftSize() const { return fft_.Size(); }
+    // 每次 Process 的耗时（微秒），可直接注册到 MetricsRegistry
+    const LatencyHistogram& FrameCost() const { return frame_us_; }
+    NoiseSuppressorStats GetStats() const;
+
+private:
+    void ProcessBlock();
+    void RecordCost(std::chrono::steady_clock::time_point start);
+
+    NoiseSuppressorConfig config_;
+    size_t hop_;                // 块长（10ms）
+    size_t window_size_;        // 分析窗长（两块）
+    float gain_floor_;
+    float noise_rise_;          // 每块噪声估计最多乘以这个系数
+    size_t startup_blocks_;     // 开始的这么多块里噪声估计跟随平滑功率，尽快建立
+
+    RealFft fft_;
+    std::vector<float> window_;     // 平方根汉宁窗（周期型），分析和合成各乘一次
+    std::vector<float> input_;      // 上一块 + 当前块的输入
+    std::vector<float> output_;     // 最近一块处理后重建完成的样本（上一块的位置）
+    std::vector<float> overlap_;    // 合成窗后半部分，与下一块相加
+    std::vector<float> frame_;      // FFT 输入输出（补零到 FFT 长度）
+    std::vector<float> re_;
+    std::vector<float> im_;
+    std::vector<float> smoothed_;   // 平滑后的功率谱
+    std::vector<float> noise_;      // 噪声功率估计
+    std::vector<float> clean_;      // 上一块增益后的功率，用于判决引导
+    size_t block_count_ = 0;
+
+    LatencyHistogram frame_us_;
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> blocks_{0};
+    std::atomic<uint64_t> total_us_{0};
+    std::atomic<uint64_t> max_us_{0};
+    std::atomic<double> noise_dbfs_{-100.0};
+};
+
+}  // namespace linx
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace linx {
+
+// 一段 PCM 的电平统计
+struct PcmLevel {
+    int peak = 0;             // 绝对峰值（0～32768）
+    uint64_t sum_squares = 0;  // 样本平方和
+    size_t samples = 0;       // 参与统计的样本数
+
+    double Rms() const;       // 均方根（线性，0～32768）
+    double RmsDbfs() const;   // 均方根（dBFS），静音返回 -100
+    double PeakDbfs() const;  // 峰值（dBFS），静音返回 -100
+};
+
+// int16 PCM 内核函数表。所有函数允许 dst 与某个输入完全重叠（原地处理），不允许部分重叠。
+// 除 dot（浮点累加顺序不同）和 fft_butterfly / complex_mac（标量版本可能被编译器融合为乘加）外，各实现结果与标量实现逐位一致。
+// gain_fixed / dot_s16 是纯整数（Q15）版本，供定点构建（LINX_FIXED_POINT）在没有快速浮点的 ARM 上使用。
+struct PcmKernels {
+    const char* name;
+
+    // dst[i] = sat(round(src[i] * gain))
+    void (*gain)(short* dst, const short* src, size_t n, float gain);
+    // dst[i] = sat(a[i] + b[i])
+    void (*mix)(short* dst, const short* a, const short* b, size_t n);
+    // dst[i] = src[i] / 32768
+    void (*s16_to_float)(float* dst, const short* src, size_t n);
+    // dst[i] = sat(round(src[i] * 32768))
+    void (*float_to_s16)(short* dst, const float* src, size_t n);
+    // 峰值与平方和
+    PcmLevel (*level)(const short* src, size_t n);
+    // 两路单声道交织为立体声 / 立体声拆为两路单声道，n 为每声道样本数
+    void (*interleave2)(short* dst, const short* left, const short* right, size_t n);
+    void (*deinterleave2)(short* left, short* right, const short* src, size_t n);
+    // sum(a[i] * b[i])，用于 FIR 滤波
+    float (*dot)(const float* a, const float* b, size_t n);
+    // dst[i] = sat((src[i] * mantissa + 2^(shift-1)) >> shift)，shift 为 0～30（增益 = mantissa / 2^shift）
+    void (*gain_fixed)(short* dst, const short* src, size_t n, int16_t mantissa, int shift);
+    // sum(a[i] * b[i])，int32 累加：调用方保证部分和不溢出（如 Q15 抽头的绝对值之和小于 2）
+    int32_t (*dot_s16)(const short* a, const short* b, size_t n);
+    // 基 2 FFT 的一组蝶形（实部虚部分开存放）：t = hi[k] * w[k]，hi[k] = lo[k] - t，lo[k] = lo[k] + t，k < n
+    void (*fft_butterfly)(float* lo_re, float* lo_im, float* hi_re, float* hi_im, const float* w_re,
+                          const float* w_im, size_t n);
+    // 复数乘加（实部虚部分开存放）：acc[k] += x[k] * w[k]，k < n；用于多通道频域加权求和（波束形成）
+    void (*complex_mac)(float* acc_re, float* acc_im, const float* x_re, const float* x_im, const float* w_re,
+                        const float* w_im, size_t n);
+};
+
+// 运行时按 CPU 特性选出的最快实现（AVX2 > SSE2 > NEON > scalar），首次调用时确定。
+// 设置环境变量 LINX_DSP_KERNELS=scalar|sse2|avx2|neon 可强制指定（不支持时回退）。
+const PcmKernels& GetPcmKernels();
+
+// 按名字取实现，当前 CPU 不支持或未编译时返回 nullptr；主要用于基准测试和对比验证
+const PcmKernels* FindPcmKernels(const char* name);
+
+// 浮点增益转为 gain_fixed 的尾数和移位：取尾数不溢出 int16 的最大移位（小增益也保留 15 位精度），
+// |gain| 超出 int16 时饱和。与浮点实现相比只在取整上相差 ±1
+int16_t PcmGainToFixed(float gain, int* shift);
+
+// 便捷封装，使用 GetPcmKernels()。定点构建下增益按 PcmGainToFixed 转换后走整数内核
+inline void PcmGain(short* dst, const short* src, size_t n, float gain) {
+#if defined(LINX_FIXED_POINT)
+    int shift = 0;
+    int16_t mantissa = PcmGainToFixed(gain, &shift);
+    GetPcmKernels().gain_fixed(dst, src, n, mantissa, shift);
+#else
+    GetPcmKernels().gain(dst, src, n, gain);
+#endif
+}
+inline void PcmMix(short* dst, const short* a, const short* b, size_t n) {
+    GetPcmKernels().mix(dst, a, b, n);
+}
+inline void PcmToFloat(float* dst, const short* src, size_t n) {
+    GetPcmKernels().s16_to_float(dst, src, n);
+}
+inline void PcmFromFloat(short* dst, const float* src, size_t n) {
+    GetPcmKernels().float_to_s16(dst, src, n);
+}
+inline PcmLevel PcmMeasure(const short* src, size_t n) { return GetPcmKernels().level(src, n); }
+inline void PcmInterleave2(short* dst, const short* left, const short* right, size_t n) {
+    GetPcmKernels().interleave2(dst, left, right, n);
+}
+inline void PcmDeinterleave2(short* left, short* right, const short* src, size_t n) {
+    GetPcmKernels().deinterleave2(left, right, src, n);
+}
+inline float DotF32(const float* a, const float* b, size_t n) { return GetPcmKernels().dot(a, b, n); }
+inline int32_t DotS16(const short* a, const short* b, size_t n) { return GetPcmKernels().dot_s16(a, b, n); }
+inline void ComplexMac(float* acc_re, float* acc_im, const float* x_re, const float* x_im, const float* w_re,
+                       const float* w_im, size_t n) {
+    GetPcmKernels().complex_mac(acc_re, acc_im, x_re, x_im, w_re, w_im, n);
+}
+
+namespace pcm_detail {
+
+// 固定声道数的拆分：内层循环次数为常量，编译器展开为逐声道的定长步进，按帧顺序读一遍输入
+template <int Channels>
+inline void DeinterleaveFixed(short* const* planes, const short* src, size_t frames) {
+    short* out[Channels];
+    for (int c = 0; c < Channels; ++c) {
+        out[c] = planes[c];
+    }
+    for (size_t i = 0; i < frames; ++i) {
+        for (int c = 0; c < Channels; ++c) {
+            out[c][i] = src[i * Channels + c];
+        }
+    }
+}
+
+// 固定声道数的交织：按帧顺序写一遍输出，每帧的 Channels 次读取步长为常量
+template <int Channels>
+inline void InterleaveFixed(short* dst, const short* const* planes, size_t frames) {
+    const short* in[Channels];
+    for (int c = 0; c < Channels; ++c) {
+        in[c] = planes[c];
+    }
+    for (size_t i = 0; i < frames; ++i) {
+        for (int c = 0; c < Channels; ++c) {
+            dst[i * Channels + c] = in[c][i];
+        }
+    }
+}
+
+}  // namespace pcm_detail
+
+// 多声道交织 PCM 拆为 channels 个平面（每声道连续存放，供逐声道的 SIMD / FFT 处理），frames 为每声道样本数；
+// 立体声走 deinterleave2 内核，常见的阵列声道数（4/6/8）用定长展开的版本
+inline void PcmDeinterleave(short* const* planes, const short* src, size_t frames, int channels) {
+    switch (channels) {
+        case 1:
+            for (size_t i = 0; i < frames; ++i) {
+                planes[0][i] = src[i];
+            }
+            break;
+        case 2:
+            PcmDeinterleave2(planes[0], planes[1], src, frames);
+            break;
+        case 4:
+            pcm_detail::DeinterleaveFixed<4>(planes, src, frames);
+            break;
+        case 6:
+            pcm_detail::DeinterleaveFixed<6>(planes, src, frames);
+            break;
+        case 8:
+            pcm_detail::DeinterleaveFixed<8>(planes, src, frames);
+            break;
+        default:
+            for (size_t i = 0; i < frames; ++i) {
+                for (int c = 0; c < channels; ++c) {
+                    planes[c][i] = src[i * channels + c];
+                }
+            }
+            break;
+    }
+}
+
+// PcmDeinterleave 的逆操作：channels 个平面交织为一段交织 PCM（多路录音写 WAV 等），frames 为每声道样本数；
+// 立体声走 interleave2 内核，4/6/8 声道用定长展开的版本
+inline void PcmInterleave(short* dst, const short* const* planes, size_t frames, int channels) {
+    switch (channels) {
+        case 1:
+            for (size_t i = 0; i < frames; ++i) {
+                dst[i] = planes[0][i];
+            }
+            break;
+        case 2:
+            PcmInterleave2(dst, planes[0], planes[1], frames);
+            break;
+        case 4:
+            pcm_detail::InterleaveFixed<4>(dst, planes, frames);
+            break;
+        case 6:
+            pcm_detail::InterleaveFixed<6>(dst, planes, frames);
+            break;
+        case 8:
+            pcm_detail::InterleaveFixed<8>(dst, planes, frames);
+            break;
+        default:
+            for (size_t i = 0; i < frames; ++i) {
+                for (int c = 0; c < channels; ++c) {
+                    dst[i * channels + c] = planes[c][i];
+                }
+            }
+            break;
+    }
+}
+
+// 帧长和声道数在编译期已知时的版本（按 AudioFormat 特化的路径使用）：逐样本循环的次数和步长都是常量，
+// 编译器可以直接展开并向量化，不需要尾部处理；已有 SIMD 内核的操作仍交给函数表。
+// 结果与运行时版本一致。Samples 为每声道样本数，只统计第一个声道
+template <size_t Samples, int Channels = 1>
+inline PcmLevel PcmMeasureFixed(const short* pcm) {
+    if constexpr (Channels == 1) {
+        return PcmMeasure(pcm, Samples);
+    } else {
+        int peak = 0;
+        uint64_t sum = 0;
+        for (size_t i = 0; i < Samples; ++i) {
+            int s = pcm[i * Channels];
+            int a = s < 0 ? -s : s;
+            peak = a > peak ? a : peak;
+            sum += static_cast<uint32_t>(s * s);
+        }
+        PcmLevel level;
+        level.peak = peak;
+        level.sum_squares = sum;
+        level.samples = Samples;
+        return level;
+    }
+}
+
+// 第一个声道的过零次数（相邻样本符号位不同的次数）：无分支的异或取符号位，常量次数下可向量化
+template <size_t Samples, int Channels = 1>
+inline size_t PcmZeroCrossingsFixed(const short* pcm) {
+    uint32_t crossings = 0;
+    for (size_t i = 1; i < Samples; ++i) {
+        crossings += static_cast<uint16_t>(pcm[i * Channels] ^ pcm[(i - 1) * Channels]) >> 15;
+    }
+    return crossings;
+}
+
+}  // namespace linx
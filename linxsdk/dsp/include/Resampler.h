@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "PcmKernels.h"
+
+namespace linx {
+
+// 有理数比例多相 FIR 重采样器（int16 交织输入输出）
+// 采样率比按最大公约数约简为 L/M（如 48k->16k 为 1/3，24k->16k 为 2/3，16k->48k 为 3/1），
+// 用 Kaiser 窗 sinc 原型滤波器拆成 L 个相位，每个输出样本只做一次 taps 点的点积（DotF32，SIMD）。
+// 流式处理：内部保留 taps-1 个历史样本，任意长度分块输入结果与一次性输入一致。
+// 构造时分配全部缓冲区，Process 单次输入不超过 max_input_frames 时不分配内存。
+// 定点构建（LINX_FIXED_POINT）下抽头为 Q15、历史为 int16，点积走整数内核 DotS16。
+class Resampler {
+public:
+#if defined(LINX_FIXED_POINT)
+    using Sample = short;
+#else
+    using Sample = float;
+#endif
+
+    Resampler(unsigned int in_rate, unsigned int out_rate, int channels, size_t max_input_frames = 4096);
+
+    Resampler(const Resampler&) = delete;
+    Resampler& operator=(const Resampler&) = delete;
+
+    unsigned int InputRate() const { return in_rate_; }
+    unsigned int OutputRate() const { return out_rate_; }
+    int Channels() const { return channels_; }
+
+    // 输入输出采样率相同，Process 直接拷贝
+    bool Passthrough() const { return up_ == down_; }
+
+    // 输入 in_frames 帧时最多产生的输出帧数
+    size_t MaxOutputFrames(size_t in_frames) const;
+
+    // 滤波器引入的延迟（输出帧）
+    size_t LatencyFrames() const;
+
+    // 处理 in_frames 帧交织输入，写入 out（容量 out_capacity 帧），返回输出帧数。
+    // 输出容量不足时多余的输出被丢弃，调用方应按 MaxOutputFrames 预留空间。
+    size_t Process(const short* in, size_t in_frames, short* out, size_t out_capacity);
+
+    // 清空历史，下一次 Process 视为新的流
+    void Reset();
+
+private:
+    void DesignFilter();
+
+    unsigned int in_rate_;
+    unsigned int out_rate_;
+    int channels_;
+    size_t up_ = 1;    // L
+    size_t down_ = 1;  // M
+    size_t taps_ = 0;  // 每相位抽头数
+
+    // phases_[p * taps_ + k]：第 p 相位的抽头，按时间逆序存放，可直接与输入窗口做点积
+    std::vector<Sample> phases_;
+
+    // 每声道的输入历史（float 为 [-1, 1)，定点为原始 int16），前 taps_-1 个为上一块遗留的样本
+    std::vector<std::vector<Sample>> history_;
+    size_t history_len_ = 0;  // 当前历史中的有效样本数
+    size_t max_input_frames_;
+
+    // 下一个输出样本在 history_ 中的位置，以 1/L 输入样本为单位
+    size_t position_ = 0;
+};
+
+}  // namespace linx
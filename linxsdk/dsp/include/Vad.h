@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "AudioFormat.h"
+#include "PcmKernels.h"
+
+namespace linx {
+
+// 语音活动检测接口：对一帧 PCM 给出原始的语音/非语音判决。
+// 拖尾（hangover）和预录（pre-roll）由调用方（如 CapturePump）统一处理，
+// 因此可以替换为任意模型实现。实现须保证单帧 O(frame) 且不分配内存。
+class VoiceDetector {
+public:
+    virtual ~VoiceDetector() = default;
+
+    // pcm 为交织样本，samples 为每声道样本数
+    virtual bool IsSpeech(const short* pcm, size_t samples) = 0;
+
+    // 重置内部状态（如噪声底估计）
+    virtual void Reset() {}
+};
+
+// 能量 + 过零率 VAD 配置
+struct EnergyVadConfig {
+    int channels = 1;                 // 声道数，只分析第一个声道
+    double threshold_db = 9.0;        // 高出噪声底多少 dB 判为语音
+    double min_speech_dbfs = -50.0;   // 绝对能量下限，低于此值一律判为非语音
+    double initial_noise_dbfs = -60.0;  // 初始噪声底
+    double max_zcr = 0.30;            // 过零率上限（每样本），高于此值且能量不突出时视为噪声
+    double noise_rise = 0.02;         // 非语音帧时噪声底上升的平滑系数
+    double noise_fall = 0.30;         // 能量低于噪声底时噪声底下降的平滑系数
+};
+
+// 基于帧能量和过零率的轻量 VAD，自适应跟踪噪声底
+class EnergyVad : public VoiceDetector {
+public:
+    explicit EnergyVad(const EnergyVadConfig& config = EnergyVadConfig());
+
+    bool IsSpeech(const short* pcm, size_t samples) override;
+    void Reset() override;
+
+    // 最近一帧的能量（dBFS）、过零率和当前噪声底，便于调参
+    double LastLevelDbfs() const { return last_dbfs_; }
+    double LastZcr() const { return last_zcr_; }
+    double NoiseFloorDbfs() const { return noise_dbfs_; }
+
+protected:
+    // 由一帧第一个声道的电平和过零次数做判决并更新噪声底
+    bool Classify(const PcmLevel& level, size_t crossings);
+
+private:
+    EnergyVadConfig config_;
+    double noise_dbfs_;
+    double last_dbfs_ = -100.0;
+    double last_zcr_ = 0;
+};
+
+// 按编译期格式特化的 EnergyVad：帧长与 Format 一致时电平和过零率走常量次数的内联循环，
+// 其他帧长退回运行时版本，判决结果与 EnergyVad 完全相同
+template <typename Format>
+class FixedEnergyVad final : public EnergyVad {
+public:
+    explicit FixedEnergyVad(const EnergyVadConfig& config = EnergyVadConfig()) : EnergyVad(ForFormat(config)) {}
+
+    bool IsSpeech(const short* pcm, size_t samples) override {
+        if (samples != Format::kFrameSamples) {
+            return EnergyVad::IsSpeech(pcm, samples);
+        }
+        return Classify(PcmMeasureFixed<Format::kFrameSamples, Format::kChannels>(pcm),
+                        PcmZeroCrossingsFixed<Format::kFrameSamples, Format::kChannels>(pcm));
+    }
+
+private:
+    static EnergyVadConfig ForFormat(EnergyVadConfig config) {
+        config.channels = Format::kChannels;
+        return config;
+    }
+};
+
+// 按运行时格式创建 VAD：格式是流水线的已知格式之一（DispatchVoiceFormat）时返回特化版本，否则返回 EnergyVad。
+// config.channels 以 format 为准
+std::shared_ptr<VoiceDetector> MakeEnergyVad(const EnergyVadConfig& config, const AudioFormatInfo& format);
+
+}  // namespace linx
@@ -0,0 +1,111 @@
+#include "AutoGainController.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "PcmKernels.h"
+
+namespace linx {
+
+AutoGainController::AutoGainController(const AutoGainConfig& config) : config_(config) {
+    if (config_.sample_rate == 0) {
+        config_.sample_rate = 16000;
+    }
+    if (config_.channels < 1) {
+        config_.channels = 1;
+    }
+    config_.min_gain_db = std::min(config_.min_gain_db, 0.0f);
+    config_.max_gain_db = std::max(config_.max_gain_db, 0.0f);
+    block_frames_ = std::max<size_t>(1, config_.sample_rate / 100);
+    attack_ = Coefficient(config_.attack_ms, block_frames_);
+    release_ = Coefficient(config_.release_ms, block_frames_);
+    min_input_ms_ = static_cast<float>(std::pow(10.0, config_.min_input_dbfs / 10.0));
+    limit_peak_ = static_cast<float>(32768.0 * std::pow(10.0, std::min(config_.limiter_dbfs, 0.0f) / 20.0));
+}
+
+float AutoGainController::Coefficient(float tau_ms, size_t frames) const {
+    if (tau_ms <= 0) {
+        return 1.0f;
+    }
+    double block_ms = 1000.0 * frames / config_.sample_rate;
+    return static_cast<float>(1.0 - std::exp(-block_ms / tau_ms));
+}
+
+void AutoGainController::Reset() {
+    gain_db_ = 0;
+    applied_gain_ = 1.0f;
+    gain_db_stat_.store(0, std::memory_order_relaxed);
+}
+
+void AutoGainController::Process(short* pcm, size_t frames) {
+    const size_t channels = static_cast<size_t>(config_.channels);
+    while (frames > 0) {
+        size_t n = std::min(frames, block_frames_);
+        ProcessBlock(pcm, n);
+        pcm += n * channels;
+        frames -= n;
+    }
+}
+
+void AutoGainController::ProcessBlock(short* pcm, size_t frames) {
+    const size_t samples = frames * static_cast<size_t>(config_.channels);
+    // 分段测量：各段峰值用于限幅，合起来的平方和即整块 RMS
+    size_t bounds[kSegments + 1];
+    PcmLevel levels[kSegments];
+    uint64_t sum_squares = 0;
+    for (size_t s = 0; s <= kSegments; ++s) {
+        bounds[s] = samples * s / kSegments;
+    }
+    for (size_t s = 0; s < kSegments; ++s) {
+        levels[s] = PcmMeasure(pcm + bounds[s], bounds[s + 1] - bounds[s]);
+        sum_squares += levels[s].sum_squares;
+    }
+    blocks_.fetch_add(1, std::memory_order_relaxed);
+
+    double mean_square = static_cast<double>(sum_squares) / samples / (32768.0 * 32768.0);
+    if (mean_square > min_input_ms_) {
+        float input_dbfs = static_cast<float>(10.0 * std::log10(mean_square));
+        float desired = std::min(std::max(config_.target_dbfs - input_dbfs, config_.min_gain_db), config_.max_gain_db);
+        bool full = frames == block_frames_;
+        float coefficient = desired < gain_db_ ? (full ? attack_ : Coefficient(config_.attack_ms, frames))
+                                               : (full ? release_ : Coefficient(config_.release_ms, frames));
+        gain_db_ += coefficient * (desired - gain_db_);
+        active_blocks_.fetch_add(1, std::memory_order_relaxed);
+        input_dbfs_.store(input_dbfs, std::memory_order_relaxed);
+        gain_db_stat_.store(gain_db_, std::memory_order_relaxed);
+    }
+
+    float from = applied_gain_;
+    float to = static_cast<float>(std::pow(10.0, gain_db_ / 20.0));
+    bool limited = false;
+    for (size_t s = 0; s < kSegments; ++s) {
+        size_t n = bounds[s + 1] - bounds[s];
+        if (n == 0) {
+            continue;
+        }
+        float gain = from + (to - from) * (s + 1) / kSegments;
+        if (levels[s].peak > 0 && levels[s].peak * gain > limit_peak_) {
+            gain = limit_peak_ / levels[s].peak;
+            limited = true;
+        }
+        if (gain != 1.0f) {
+            PcmGain(pcm + bounds[s], pcm + bounds[s], n, gain);
+        }
+        applied_gain_ = gain;
+    }
+    if (limited) {
+        limited_blocks_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+AutoGainStats AutoGainController::GetStats() const {
+    AutoGainStats stats;
+    stats.blocks = blocks_.load(std::memory_order_relaxed);
+    stats.active_blocks = active_blocks_.load(std::memory_order_relaxed);
+    stats.limited_blocks = limited_blocks_.load(std::memory_order_relaxed);
+    stats.gain_db = gain_db_stat_.load(std::memory_order_relaxed);
+    stats.input_dbfs = input_dbfs_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace linx
@@ -0,0 +1,292 @@
+#include "Beamformer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "PcmKernels.h"
+
+namespace linx {
+
+namespace {
+
+constexpr double kSpeedOfSound = 343.0;  // 米/秒（约 20°C）
+constexpr float kMinMagnitude = 1e-9f;
+
+size_t FftSizeFor(size_t window) {
+    size_t size = 4;
+    while (size < window) {
+        size <<= 1;
+    }
+    return size;
+}
+
+float WrapDegrees(float degrees) {
+    float wrapped = std::fmod(degrees, 360.0f);
+    return wrapped < 0 ? wrapped + 360.0f : wrapped;
+}
+
+// 两个方位之间的最小夹角（0～180 度）
+float AngleBetween(float a, float b) {
+    float diff = std::fabs(WrapDegrees(a) - WrapDegrees(b));
+    return diff > 180.0f ? 360.0f - diff : diff;
+}
+
+}  // namespace
+
+std::vector<MicPosition> Beamformer::CircularArray(int mics, float radius_m) {
+    std::vector<MicPosition> positions(std::max(mics, 0));
+    for (int i = 0; i < mics; ++i) {
+        double angle = 2.0 * M_PI * i / mics;
+        positions[i].x = static_cast<float>(radius_m * std::cos(angle));
+        positions[i].y = static_cast<float>(radius_m * std::sin(angle));
+    }
+    return positions;
+}
+
+std::vector<MicPosition> Beamformer::LinearArray(int mics, float spacing_m) {
+    std::vector<MicPosition> positions(std::max(mics, 0));
+    for (int i = 0; i < mics; ++i) {
+        positions[i].x = spacing_m * (i - (mics - 1) / 2.0f);
+    }
+    return positions;
+}
+
+Beamformer::Beamformer(const BeamformerConfig& config)
+    : config_(config),
+      channels_(std::max<int>(1, static_cast<int>(config.mics.size()))),
+      hop_(std::max(2u, (config.sample_rate == 0 ? 16000u : config.sample_rate) / 100)),
+      window_size_(2 * hop_),
+      fft_(FftSizeFor(window_size_)),
+      track_(config.track) {
+    if (config_.sample_rate == 0) {
+        config_.sample_rate = 16000;
+    }
+    config_.mics.resize(channels_);
+    config_.directions = std::max(config_.directions, 4);
+    config_.doa_smoothing = std::min(std::max(config_.doa_smoothing, 0.0f), 0.999f);
+    bins_ = fft_.Bins();
+    gate_mean_square_ = static_cast<float>(std::pow(10.0, config_.doa_gate_dbfs / 10.0));
+
+    const double bin_hz = static_cast<double>(config_.sample_rate) / fft_.Size();
+    size_t lo = std::max<size_t>(1, static_cast<size_t>(std::ceil(config_.doa_min_hz / bin_hz)));
+    size_t hi = std::min(bins_ - 2, static_cast<size_t>(std::floor(config_.doa_max_hz / bin_hz)));
+    band_lo_ = lo;
+    band_bins_ = hi >= lo ? hi - lo + 1 : 0;
+
+    window_.resize(window_size_);
+    for (size_t i = 0; i < window_size_; ++i) {
+        window_[i] = static_cast<float>(std::sqrt(0.5 - 0.5 * std::cos(2.0 * M_PI * i / window_size_)));
+    }
+    input_.assign(window_size_ * channels_, 0.0f);
+    planes_.assign(hop_ * channels_, 0);
+    plane_ptrs_.resize(channels_);
+    for (int c = 0; c < channels_; ++c) {
+        plane_ptrs_[c] = planes_.data() + c * hop_;
+    }
+    frame_.assign(fft_.Size(), 0.0f);
+    spec_re_.assign(bins_ * channels_, 0.0f);
+    spec_im_.assign(bins_ * channels_, 0.0f);
+    weight_re_.assign(bins_ * channels_, 0.0f);
+    weight_im_.assign(bins_ * channels_, 0.0f);
+    sum_re_.assign(bins_, 0.0f);
+    sum_im_.assign(bins_, 0.0f);
+    output_.assign(hop_, 0.0f);
+    overlap_.assign(hop_, 0.0f);
+
+    // 方向表：声源在第 d 个方向时把各声道对齐到原点的相位 e^(-jωτ)，只覆盖方位估计的频带
+    const size_t directions = config_.directions;
+    phat_re_.assign(band_bins_ * channels_, 0.0f);
+    phat_im_.assign(band_bins_ * channels_, 0.0f);
+    table_re_.assign(directions * channels_ * band_bins_, 0.0f);
+    table_im_.assign(directions * channels_ * band_bins_, 0.0f);
+    for (size_t d = 0; d < directions; ++d) {
+        double degrees = 360.0 * d / directions;
+        for (int c = 0; c < channels_; ++c) {
+            double tau = Advance(c, degrees);
+            size_t base = (d * channels_ + c) * band_bins_;
+            for (size_t k = 0; k < band_bins_; ++k) {
+                double phase = 2.0 * M_PI * (band_lo_ + k) * bin_hz * tau;
+                table_re_[base + k] = static_cast<float>(std::cos(phase));
+                table_im_[base + k] = static_cast<float>(-std::sin(phase));
+            }
+        }
+    }
+    acc_re_.assign(band_bins_, 0.0f);
+    acc_im_.assign(band_bins_, 0.0f);
+    srp_.assign(directions, 0.0f);
+
+    UpdateWeights(WrapDegrees(config_.steer_deg));
+}
+
+double Beamformer::Advance(int c, double degrees) const {
+    double radians = degrees * M_PI / 180.0;
+    const MicPosition& p = config_.mics[c];
+    return (p.x * std::cos(radians) + p.y * std::sin(radians)) / kSpeedOfSound;
+}
+
+void Beamformer::UpdateWeights(float degrees) {
+    const double bin_hz = static_cast<double>(config_.sample_rate) / fft_.Size();
+    const float scale = 1.0f / channels_;
+    for (int c = 0; c < channels_; ++c) {
+        double tau = Advance(c, degrees);
+        for (size_t k = 0; k < bins_; ++k) {
+            double phase = 2.0 * M_PI * k * bin_hz * tau;
+            weight_re_[c * bins_ + k] = static_cast<float>(std::cos(phase)) * scale;
+            weight_im_[c * bins_ + k] = static_cast<float>(-std::sin(phase)) * scale;
+        }
+    }
+    current_steer_ = degrees;
+    steer_deg_.store(degrees, std::memory_order_relaxed);
+}
+
+void Beamformer::Steer(float degrees) {
+    steer_request_.store(WrapDegrees(degrees), std::memory_order_relaxed);
+    steer_pending_.store(true, std::memory_order_release);
+}
+
+void Beamformer::Reset() {
+    std::fill(input_.begin(), input_.end(), 0.0f);
+    std::fill(output_.begin(), output_.end(), 0.0f);
+    std::fill(overlap_.begin(), overlap_.end(), 0.0f);
+    std::fill(srp_.begin(), srp_.end(), 0.0f);
+    srp_primed_ = false;
+    confidence_.store(0.0f, std::memory_order_relaxed);
+}
+
+void Beamformer::Process(const short* in, size_t frames, short* out) {
+    auto start = std::chrono::steady_clock::now();
+    if (steer_pending_.exchange(false, std::memory_order_acquire)) {
+        UpdateWeights(steer_request_.load(std::memory_order_relaxed));
+        steers_.fetch_add(1, std::memory_order_relaxed);
+    }
+    size_t blocks = frames / hop_;
+    for (size_t b = 0; b < blocks; ++b) {
+        PcmDeinterleave(plane_ptrs_.data(), in + b * hop_ * channels_, hop_, channels_);
+        ProcessBlock(plane_ptrs_.data());
+        PcmFromFloat(out + b * hop_, output_.data(), hop_);
+    }
+    for (size_t i = blocks * hop_; i < frames; ++i) {
+        out[i] = in[i * channels_];
+    }
+    uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    frame_us_.Record(us);
+    frames_.fetch_add(1, std::memory_order_relaxed);
+    total_us_.fetch_add(us, std::memory_order_relaxed);
+    if (us > max_us_.load(std::memory_order_relaxed)) {
+        max_us_.store(us, std::memory_order_relaxed);
+    }
+}
+
+void Beamformer::ProcessBlock(const short* const* planes) {
+    for (int c = 0; c < channels_; ++c) {
+        float* input = input_.data() + c * window_size_;
+        PcmToFloat(input + hop_, planes[c], hop_);
+        for (size_t i = 0; i < window_size_; ++i) {
+            frame_[i] = input[i] * window_[i];
+        }
+        std::fill(frame_.begin() + window_size_, frame_.end(), 0.0f);
+        fft_.Forward(frame_.data(), spec_re_.data() + c * bins_, spec_im_.data() + c * bins_);
+        memmove(input, input + hop_, hop_ * sizeof(float));
+    }
+
+    // 延迟求和：sum = Σ X_c · W_c
+    std::fill(sum_re_.begin(), sum_re_.end(), 0.0f);
+    std::fill(sum_im_.begin(), sum_im_.end(), 0.0f);
+    for (int c = 0; c < channels_; ++c) {
+        ComplexMac(sum_re_.data(), sum_im_.data(), spec_re_.data() + c * bins_, spec_im_.data() + c * bins_,
+                   weight_re_.data() + c * bins_, weight_im_.data() + c * bins_, bins_);
+    }
+    fft_.Inverse(sum_re_.data(), sum_im_.data(), frame_.data());
+    for (size_t i = 0; i < hop_; ++i) {
+        output_[i] = overlap_[i] + frame_[i] * window_[i];
+        overlap_[i] = frame_[hop_ + i] * window_[hop_ + i];
+    }
+
+    if (channels_ >= 2 && band_bins_ > 0) {
+        PcmLevel level = PcmMeasure(planes[0], hop_);
+        double mean_square = static_cast<double>(level.sum_squares) / hop_ / (32768.0 * 32768.0);
+        if (mean_square >= gate_mean_square_) {
+            EstimateDoa();
+        }
+    }
+    blocks_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Beamformer::EstimateDoa() {
+    // PHAT 白化：只保留相位，各频点对方位谱的贡献相同，不被低频能量主导
+    for (int c = 0; c < channels_; ++c) {
+        const float* re = spec_re_.data() + c * bins_ + band_lo_;
+        const float* im = spec_im_.data() + c * bins_ + band_lo_;
+        float* phat_re = phat_re_.data() + c * band_bins_;
+        float* phat_im = phat_im_.data() + c * band_bins_;
+        for (size_t k = 0; k < band_bins_; ++k) {
+            float inv = 1.0f / (std::sqrt(re[k] * re[k] + im[k] * im[k]) + kMinMagnitude);
+            phat_re[k] = re[k] * inv;
+            phat_im[k] = im[k] * inv;
+        }
+    }
+
+    const size_t directions = srp_.size();
+    const float alpha = srp_primed_ ? config_.doa_smoothing : 0.0f;
+    const float norm = 1.0f / (static_cast<float>(channels_) * channels_ * band_bins_);
+    size_t best = 0;
+    double total = 0;
+    for (size_t d = 0; d < directions; ++d) {
+        std::fill(acc_re_.begin(), acc_re_.end(), 0.0f);
+        std::fill(acc_im_.begin(), acc_im_.end(), 0.0f);
+        for (int c = 0; c < channels_; ++c) {
+            size_t base = (d * channels_ + c) * band_bins_;
+            ComplexMac(acc_re_.data(), acc_im_.data(), phat_re_.data() + c * band_bins_,
+                       phat_im_.data() + c * band_bins_, table_re_.data() + base, table_im_.data() + base,
+                       band_bins_);
+        }
+        // 归一化到 0～1：全部声道在该方向同相时为 1
+        float power = (DotF32(acc_re_.data(), acc_re_.data(), band_bins_) +
+                       DotF32(acc_im_.data(), acc_im_.data(), band_bins_)) *
+                      norm;
+        srp_[d] = alpha * srp_[d] + (1 - alpha) * power;
+        total += srp_[d];
+        if (srp_[d] > srp_[best]) {
+            best = d;
+        }
+    }
+    srp_primed_ = true;
+
+    float peak = srp_[best];
+    float mean = static_cast<float>(total / directions);
+    float confidence = peak > 0 ? (peak - mean) / peak : 0.0f;
+    // 峰值两侧抛物线插值，方位精度细于一格
+    float left = srp_[(best + directions - 1) % directions];
+    float right = srp_[(best + 1) % directions];
+    float curvature = left - 2 * peak + right;
+    float offset = curvature < 0 ? std::min(std::max(0.5f * (left - right) / curvature, -0.5f), 0.5f) : 0.0f;
+    const float step = 360.0f / directions;
+    float doa = WrapDegrees((best + offset) * step);
+    doa_deg_.store(doa, std::memory_order_relaxed);
+    confidence_.store(confidence, std::memory_order_relaxed);
+    doa_updates_.fetch_add(1, std::memory_order_relaxed);
+
+    if (track_.load(std::memory_order_relaxed) && confidence >= config_.min_confidence &&
+        AngleBetween(doa, current_steer_) >= step) {
+        UpdateWeights(doa);
+        steers_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+BeamformerStats Beamformer::GetStats() const {
+    BeamformerStats stats;
+    stats.frames = frames_.load(std::memory_order_relaxed);
+    stats.blocks = blocks_.load(std::memory_order_relaxed);
+    stats.doa_updates = doa_updates_.load(std::memory_order_relaxed);
+    stats.steers = steers_.load(std::memory_order_relaxed);
+    stats.total_us = total_us_.load(std::memory_order_relaxed);
+    stats.max_us = max_us_.load(std::memory_order_relaxed);
+    stats.doa_deg = doa_deg_.load(std::memory_order_relaxed);
+    stats.confidence = confidence_.load(std::memory_order_relaxed);
+    stats.steer_deg = steer_deg_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace linx
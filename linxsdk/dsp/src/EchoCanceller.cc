@@ -0,0 +1,197 @@
+#include "EchoCanceller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "PcmKernels.h"
+
+namespace linx {
+
+namespace {
+
+constexpr double kConvergedErleDb = 6.0;  // ERLE 高于此值视为已收敛，改用残差双讲检测
+constexpr size_t kMaxFrozenBlocks = 250;   // 连续冻结约 1s（16kHz）后强制恢复自适应
+constexpr size_t kMaxDivergedBlocks = 30;  // 连续发散的块数达到此值时清空滤波器
+
+}  // namespace
+
+EchoCanceller::EchoCanceller(const EchoCancellerConfig& config) : config_(config) {
+    if (config_.sample_rate == 0) {
+        config_.sample_rate = 16000;
+    }
+    if (config_.filter_ms < 1) {
+        config_.filter_ms = 1;
+    }
+    // 滤波器长度取块长的整数倍
+    taps_ = static_cast<size_t>(config_.sample_rate) * config_.filter_ms / 1000;
+    taps_ = std::max(kBlock, (taps_ + kBlock - 1) / kBlock * kBlock);
+    ref_floor_ = static_cast<float>(std::pow(10.0, config_.reference_floor_dbfs / 10.0));
+    size_t block_ms = std::max<size_t>(1, kBlock * 1000 / config_.sample_rate);
+    hangover_blocks_ = (config_.double_talk_hangover_ms + block_ms - 1) / block_ms;
+
+    weights_.assign(taps_, 0.0f);
+    history_.assign(taps_ - 1 + kBlock, 0.0f);
+    if (config_.delay_ms > 0) {
+        delay_line_.assign(static_cast<size_t>(config_.sample_rate) * config_.delay_ms / 1000, 0.0f);
+    }
+    mic_block_.assign(kBlock, 0.0f);
+    out_block_.assign(kBlock, 0.0f);
+}
+
+void EchoCanceller::Reset() {
+    std::fill(weights_.begin(), weights_.end(), 0.0f);
+    std::fill(history_.begin(), history_.end(), 0.0f);
+    std::fill(delay_line_.begin(), delay_line_.end(), 0.0f);
+    delay_pos_ = 0;
+    energy_ = 0;
+    double_talk_left_ = 0;
+    double_talk_run_ = 0;
+    diverged_run_ = 0;
+    residual_double_talk_ = false;
+    nlp_gain_ = 1.0f;
+    erle_db_.store(0, std::memory_order_relaxed);
+}
+
+EchoCancellerStats EchoCanceller::GetStats() const {
+    EchoCancellerStats stats;
+    stats.blocks = blocks_.load(std::memory_order_relaxed);
+    stats.active_blocks = active_blocks_.load(std::memory_order_relaxed);
+    stats.double_talk_blocks = double_talk_blocks_.load(std::memory_order_relaxed);
+    stats.diverged_blocks = diverged_blocks_.load(std::memory_order_relaxed);
+    stats.erle_db = erle_db_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void EchoCanceller::Process(const short* mic, const short* ref, short* out, size_t n) {
+    while (n > 0) {
+        size_t chunk = std::min(n, kBlock);
+        // 先把输入都转成 float，允许 out 与 mic 重叠
+        PcmToFloat(mic_block_.data(), mic, chunk);
+        float* ref_block = history_.data() + taps_ - 1;
+        PcmToFloat(ref_block, ref, chunk);
+        if (!delay_line_.empty()) {
+            // 固定延迟：新样本进延迟线，换出 delay_ms 之前的样本
+            for (size_t i = 0; i < chunk; ++i) {
+                std::swap(ref_block[i], delay_line_[delay_pos_]);
+                if (++delay_pos_ == delay_line_.size()) {
+                    delay_pos_ = 0;
+                }
+            }
+        }
+        ProcessBlock(mic_block_.data(), chunk, out_block_.data());
+        PcmFromFloat(out, out_block_.data(), chunk);
+
+        // 保留最后 taps-1 个参考样本作为下一块的历史
+        memmove(history_.data(), history_.data() + chunk, (taps_ - 1) * sizeof(float));
+        mic += chunk;
+        ref += chunk;
+        out += chunk;
+        n -= chunk;
+    }
+}
+
+void EchoCanceller::ProcessBlock(const float* mic, size_t n, float* out) {
+    const auto& kernels = GetPcmKernels();
+    const float* ref_new = history_.data() + taps_ - 1;
+
+    // 参考信号活跃度
+    float ref_energy = kernels.dot(ref_new, ref_new, n) / n;
+    const bool active = ref_energy > ref_floor_;
+
+    // 双讲检测：收敛后按上一块的残差/回声能量比判定；收敛前回声估计不可信，不检测，
+    // 此时的峰值类判据（Geigel）在扬声器耦合强时会把远端单讲误判为双讲，导致始终无法收敛
+    const bool converged = erle_db_.load(std::memory_order_relaxed) > kConvergedErleDb;
+    if (active && converged && residual_double_talk_) {
+        double_talk_left_ = hangover_blocks_;
+    } else if (double_talk_left_ > 0) {
+        --double_talk_left_;
+    }
+    bool frozen = double_talk_left_ > 0;
+    // 长时间一直判为双讲多半是回声路径变了（如设备移动），强制恢复自适应重新收敛
+    double_talk_run_ = frozen ? double_talk_run_ + 1 : 0;
+    if (double_talk_run_ > kMaxFrozenBlocks) {
+        frozen = false;
+        double_talk_left_ = 0;
+        double_talk_run_ = 0;
+        erle_db_.store(0, std::memory_order_relaxed);
+    }
+    const bool adapt = active && !frozen;
+
+    // 窗口能量：从本块第一个样本对应的窗口开始，之后逐样本增减
+    const float* window = history_.data();
+    energy_ = kernels.dot(window, window, taps_);
+    const float delta = taps_ * ref_floor_;
+    float mic_power = 0;
+    float err_power = 0;
+    float echo_power = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const float* x = history_.data() + i;
+        float y = kernels.dot(weights_.data(), x, taps_);
+        float e = mic[i] - y;
+        out[i] = e;
+        mic_power += mic[i] * mic[i];
+        err_power += e * e;
+        echo_power += y * y;
+
+        if (adapt) {
+            float g = config_.step * e / (energy_ + delta);
+            float* w = weights_.data();
+            for (size_t k = 0; k < taps_; ++k) {
+                w[k] += g * x[k];
+            }
+        }
+        // 滑到下一个窗口：移出最旧的样本，移入下一个参考样本
+        if (i + 1 < n) {
+            energy_ += x[taps_] * x[taps_] - x[0] * x[0];
+            energy_ = std::max(energy_, 0.0f);
+        }
+    }
+
+    blocks_.fetch_add(1, std::memory_order_relaxed);
+    if (active) {
+        active_blocks_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (frozen && active) {
+        double_talk_blocks_.fetch_add(1, std::memory_order_relaxed);
+    }
+    residual_double_talk_ = active && echo_power > 0 && err_power > config_.residual_ratio * echo_power;
+
+    // 发散保护（仅收敛后）：消除后能量反而比原信号大时按原信号输出，持续发散则清空滤波器
+    if (converged && err_power > mic_power * 2 && mic_power > 0) {
+        diverged_blocks_.fetch_add(1, std::memory_order_relaxed);
+        memcpy(out, mic, n * sizeof(float));
+        if (++diverged_run_ >= kMaxDivergedBlocks) {
+            std::fill(weights_.begin(), weights_.end(), 0.0f);
+            erle_db_.store(0, std::memory_order_relaxed);
+            diverged_run_ = 0;
+        }
+        return;
+    }
+    diverged_run_ = 0;
+
+    // ERLE：只在远端单讲时统计
+    if (active && !frozen && err_power > 0 && mic_power > 0) {
+        double inst = 10.0 * std::log10(mic_power / err_power);
+        double erle = erle_db_.load(std::memory_order_relaxed);
+        erle_db_.store(erle + (inst - erle) * 0.05, std::memory_order_relaxed);
+    }
+
+    // 残余回声抑制：远端单讲时按残差在（残差 + 回声估计）中的占比衰减，近端说话时不衰减；
+    // 增益在块内线性过渡，避免块边界的咔嗒声
+    if (!config_.suppress) {
+        return;
+    }
+    float target = 1.0f;
+    if (active && !frozen && echo_power > 0) {
+        target = std::max(config_.suppress_floor, std::min(1.0f, err_power / (err_power + echo_power)));
+    }
+    float next = target < nlp_gain_ ? nlp_gain_ + (target - nlp_gain_) * 0.5f : nlp_gain_ + (target - nlp_gain_) * 0.1f;
+    for (size_t i = 0; i < n; ++i) {
+        float g = nlp_gain_ + (next - nlp_gain_) * (i + 1) / n;
+        out[i] *= g;
+    }
+    nlp_gain_ = next;
+}
+
+}  // namespace linx
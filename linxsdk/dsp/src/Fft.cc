@@ -0,0 +1,122 @@
+#include "Fft.h"
+
+#include <cmath>
+#include <utility>
+
+namespace linx {
+
+Fft::Fft(size_t size) : size_(size), kernels_(GetPcmKernels()) {
+    for (size_t i = 1, j = 0; i < size_; ++i) {
+        size_t bit = size_ >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            swaps_.push_back(static_cast<uint32_t>(i));
+            swaps_.push_back(static_cast<uint32_t>(j));
+        }
+    }
+    // 半长为 1 的第一级旋转因子恒为 1，单独处理，不进表
+    for (size_t half = 2; half < size_; half <<= 1) {
+        for (size_t k = 0; k < half; ++k) {
+            double angle = -M_PI * k / half;
+            twiddle_re_.push_back(static_cast<float>(std::cos(angle)));
+            twiddle_im_.push_back(static_cast<float>(std::sin(angle)));
+        }
+    }
+}
+
+void Fft::Forward(float* re, float* im) const {
+    for (size_t i = 0; i < swaps_.size(); i += 2) {
+        std::swap(re[swaps_[i]], re[swaps_[i + 1]]);
+        std::swap(im[swaps_[i]], im[swaps_[i + 1]]);
+    }
+    for (size_t i = 0; i + 1 < size_; i += 2) {
+        float r = re[i + 1];
+        float m = im[i + 1];
+        re[i + 1] = re[i] - r;
+        im[i + 1] = im[i] - m;
+        re[i] += r;
+        im[i] += m;
+    }
+    for (size_t half = 2; half < size_; half <<= 1) {
+        const float* wr = twiddle_re_.data() + half - 2;
+        const float* wi = twiddle_im_.data() + half - 2;
+        for (size_t i = 0; i < size_; i += 2 * half) {
+            kernels_.fft_butterfly(re + i, im + i, re + i + half, im + i + half, wr, wi, half);
+        }
+    }
+}
+
+void Fft::Inverse(float* re, float* im) const {
+    // 交换实部虚部后做正变换即得共轭结果，再交换回来
+    Forward(im, re);
+    float scale = 1.0f / size_;
+    for (size_t i = 0; i < size_; ++i) {
+        re[i] *= scale;
+        im[i] *= scale;
+    }
+}
+
+RealFft::RealFft(size_t size)
+    : size_(size), half_(size / 2), split_re_(size / 2), split_im_(size / 2), work_re_(size / 2), work_im_(size / 2) {
+    for (size_t k = 0; k < size_ / 2; ++k) {
+        double angle = -2.0 * M_PI * k / size_;
+        split_re_[k] = static_cast<float>(std::cos(angle));
+        split_im_[k] = static_cast<float>(std::sin(angle));
+    }
+}
+
+void RealFft::Forward(const float* x, float* re, float* im) {
+    const size_t m = size_ / 2;
+    for (size_t i = 0; i < m; ++i) {
+        work_re_[i] = x[2 * i];
+        work_im_[i] = x[2 * i + 1];
+    }
+    half_.Forward(work_re_.data(), work_im_.data());
+    // 偶数样本的频谱 E = (Z[k] + conj(Z[M-k])) / 2，奇数样本的 O = (Z[k] - conj(Z[M-k])) / 2i，X[k] = E + W^k O
+    re[0] = work_re_[0] + work_im_[0];
+    im[0] = 0;
+    re[m] = work_re_[0] - work_im_[0];
+    im[m] = 0;
+    for (size_t k = 1; k < m; ++k) {
+        float zr = work_re_[k];
+        float zi = work_im_[k];
+        float cr = work_re_[m - k];
+        float ci = -work_im_[m - k];
+        float er = 0.5f * (zr + cr);
+        float ei = 0.5f * (zi + ci);
+        float or_ = 0.5f * (zi - ci);
+        float oi = -0.5f * (zr - cr);
+        re[k] = er + split_re_[k] * or_ - split_im_[k] * oi;
+        im[k] = ei + split_re_[k] * oi + split_im_[k] * or_;
+    }
+}
+
+void RealFft::Inverse(const float* re, const float* im, float* x) {
+    const size_t m = size_ / 2;
+    // 由 X[k] 和 conj(X[M-k]) 还原 E、O，Z[k] = E + iO，逆变换后实部为偶数样本、虚部为奇数样本
+    for (size_t k = 0; k < m; ++k) {
+        float xr = re[k];
+        float xi = k == 0 ? 0.0f : im[k];
+        float cr = re[m - k];
+        float ci = k == 0 ? 0.0f : -im[m - k];
+        float er = 0.5f * (xr + cr);
+        float ei = 0.5f * (xi + ci);
+        float dr = 0.5f * (xr - cr);
+        float di = 0.5f * (xi - ci);
+        // O = D * W^-k
+        float or_ = dr * split_re_[k] + di * split_im_[k];
+        float oi = di * split_re_[k] - dr * split_im_[k];
+        work_re_[k] = er - oi;
+        work_im_[k] = ei + or_;
+    }
+    half_.Inverse(work_re_.data(), work_im_.data());
+    for (size_t i = 0; i < m; ++i) {
+        x[2 * i] = work_re_[i];
+        x[2 * i + 1] = work_im_[i];
+    }
+}
+
+}  // namespace linx
@@ -0,0 +1,269 @@
+#include "KeywordSpotter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace linx {
+
+namespace {
+
+constexpr int kBands = 20;           // Mel 滤波器个数
+constexpr float kPreEmphasis = 0.97f;
+constexpr float kInfinity = 1e30f;
+constexpr size_t kMinTemplateFrames = 20;  // 200ms
+
+float HzToMel(float hz) { return 2595.0f * std::log10(1.0f + hz / 700.0f); }
+float MelToHz(float mel) { return 700.0f * (std::pow(10.0f, mel / 2595.0f) - 1.0f); }
+
+}  // namespace
+
+TemplateKeywordSpotter::TemplateKeywordSpotter(const TemplateSpotterConfig& config) : config_(config) {
+    if (config_.channels < 1) {
+        config_.channels = 1;
+    }
+    if (config_.sample_rate < 8000) {
+        config_.sample_rate = 8000;
+    }
+    hop_ = config_.sample_rate / 100;
+    window_ = config_.sample_rate * 25 / 1000;
+    fft_size_ = 1;
+    while (fft_size_ < window_) {
+        fft_size_ <<= 1;
+    }
+    refractory_frames_ = static_cast<size_t>(std::max(0, config_.refractory_ms)) / 10;
+
+    history_.assign(window_, 0);
+    hamming_.resize(window_);
+    for (size_t i = 0; i < window_; ++i) {
+        hamming_[i] = 0.54f - 0.46f * std::cos(2.0f * static_cast<float>(M_PI) * i / (window_ - 1));
+    }
+    fft_ = std::make_unique<RealFft>(fft_size_);
+    frame_.resize(fft_size_);
+    re_.resize(fft_->Bins());
+    im_.resize(fft_->Bins());
+    bands_.resize(kBands);
+
+    // 100Hz ~ Nyquist 之间等 Mel 间隔的三角滤波器
+    size_t bins = fft_size_ / 2 + 1;
+    mel_.assign(bins * kBands, 0);
+    float low = HzToMel(100.0f);
+    float high = HzToMel(config_.sample_rate / 2.0f);
+    float edges[kBands + 2];
+    for (int i = 0; i < kBands + 2; ++i) {
+        edges[i] = MelToHz(low + (high - low) * i / (kBands + 1)) * fft_size_ / config_.sample_rate;
+    }
+    for (int b = 0; b < kBands; ++b) {
+        for (size_t k = 0; k < bins; ++k) {
+            float bin = static_cast<float>(k);
+            float weight = 0;
+            if (bin > edges[b] && bin <= edges[b + 1]) {
+                weight = (bin - edges[b]) / (edges[b + 1] - edges[b]);
+            } else if (bin > edges[b + 1] && bin < edges[b + 2]) {
+                weight = (edges[b + 2] - bin) / (edges[b + 2] - edges[b + 1]);
+            }
+            mel_[k * kBands + b] = weight;
+        }
+    }
+    dct_.resize(kCoefficients * kBands);
+    float scale = std::sqrt(2.0f / kBands);
+    for (int c = 0; c < kCoefficients; ++c) {
+        for (int b = 0; b < kBands; ++b) {
+            dct_[c * kBands + b] = scale * std::cos(static_cast<float>(M_PI) * (c + 1) * (b + 0.5f) / kBands);
+        }
+    }
+}
+
+void TemplateKeywordSpotter::ComputeFeatures(Features* out) {
+    double energy = 0;
+    for (size_t i = 0; i < window_; ++i) {
+        energy += static_cast<double>(history_[i]) * history_[i];
+        float previous = i > 0 ? history_[i - 1] : history_[0];
+        frame_[i] = (history_[i] - kPreEmphasis * previous) * hamming_[i];
+    }
+    std::fill(frame_.begin() + window_, frame_.end(), 0.0f);
+    double rms = std::sqrt(energy / window_);
+    out->dbfs = rms > 0 ? static_cast<float>(20.0 * std::log10(rms)) : -100.0f;
+
+    fft_->Forward(frame_.data(), re_.data(), im_.data());
+    std::fill(bands_.begin(), bands_.end(), 0.0f);
+    for (size_t k = 0; k <= fft_size_ / 2; ++k) {
+        float power = re_[k] * re_[k] + im_[k] * im_[k];
+        const float* weights = &mel_[k * kBands];
+        for (int b = 0; b < kBands; ++b) {
+            bands_[b] += power * weights[b];
+        }
+    }
+    for (int b = 0; b < kBands; ++b) {
+        bands_[b] = std::log(std::max(bands_[b], 1e-10f));
+    }
+    for (int c = 0; c < kCoefficients; ++c) {
+        float sum = 0;
+        for (int b = 0; b < kBands; ++b) {
+            sum += dct_[c * kBands + b] * bands_[b];
+        }
+        out->c[c] = sum;
+    }
+}
+
+template <typename OnFrame>
+void TemplateKeywordSpotter::Analyze(const short* pcm, size_t samples, OnFrame on_frame) {
+    const size_t stride = static_cast<size_t>(config_.channels);
+    Features features;
+    for (size_t i = 0; i < samples; ++i) {
+        history_[history_fill_++] = pcm[i * stride] / 32768.0f;
+        if (history_fill_ == window_) {
+            ComputeFeatures(&features);
+            on_frame(features);
+            std::copy(history_.begin() + hop_, history_.end(), history_.begin());
+            history_fill_ = window_ - hop_;
+        }
+    }
+}
+
+int TemplateKeywordSpotter::AddTemplate(std::string_view keyword, const short* pcm, size_t samples) {
+    std::vector<Features> frames;
+    history_fill_ = 0;
+    Analyze(pcm, samples, [&frames](const Features& features) { frames.push_back(features); });
+    history_fill_ = 0;
+
+    auto voiced = [this](const Features& features) { return features.dbfs >= config_.min_speech_dbfs; };
+    auto first = std::find_if(frames.begin(), frames.end(), voiced);
+    auto last = std::find_if(frames.rbegin(), frames.rend(), voiced).base();
+    if (first >= last || static_cast<size_t>(last - first) < kMinTemplateFrames) {
+        return -1;
+    }
+
+    int index = -1;
+    for (size_t i = 0; i < keywords_.size(); ++i) {
+        if (keywords_[i] == keyword) {
+            index = static_cast<int>(i);
+        }
+    }
+    if (index < 0) {
+        index = static_cast<int>(keywords_.size());
+        keywords_.emplace_back(keyword);
+    }
+
+    Template entry;
+    entry.keyword = index;
+    entry.frames.assign(first, last);
+    size_t length = entry.frames.size();
+    entry.cost.assign(length, kInfinity);
+    entry.next_cost.assign(length, kInfinity);
+    entry.length.assign(length, 0);
+    entry.next_length.assign(length, 0);
+    entry.voiced.assign(length, 0);
+    entry.next_voiced.assign(length, 0);
+    templates_.push_back(std::move(entry));
+    return index;
+}
+
+int TemplateKeywordSpotter::Match(const Features& frame) {
+    if (refractory_left_ > 0) {
+        --refractory_left_;
+        return -1;
+    }
+    const uint32_t is_voiced = frame.dbfs >= config_.min_speech_dbfs ? 1 : 0;
+    double best = 1e9;
+    int hit = -1;
+    for (Template& entry : templates_) {
+        size_t length = entry.frames.size();
+        // 允许的步进：模板停留、前进一帧、前进两帧（语速 0.5 倍 ~ 任意慢），路径长度不超过模板的 2 倍
+        const uint32_t max_length = static_cast<uint32_t>(length * 2);
+        for (size_t j = 0; j < length; ++j) {
+            const float* a = entry.frames[j].c;
+            float distance = 0;
+            for (int c = 0; c < kCoefficients; ++c) {
+                float diff = a[c] - frame.c[c];
+                distance += diff * diff;
+            }
+            distance = std::sqrt(distance);
+
+            float cost = 0;
+            uint32_t steps = 0;
+            uint32_t voiced = 0;
+            if (j == 0) {
+                // 开放起点：每一帧都可以是关键词的起点
+                if (entry.cost[0] < kInfinity && entry.cost[0] / entry.length[0] < distance) {
+                    cost = entry.cost[0];
+                    steps = entry.length[0];
+                    voiced = entry.voiced[0];
+                }
+            } else {
+                size_t from = j;
+                if (entry.cost[j - 1] < entry.cost[from]) {
+                    from = j - 1;
+                }
+                if (j >= 2 && entry.cost[j - 2] < entry.cost[from]) {
+                    from = j - 2;
+                }
+                if (entry.cost[from] >= kInfinity) {
+                    entry.next_cost[j] = kInfinity;
+                    continue;
+                }
+                cost = entry.cost[from];
+                steps = entry.length[from];
+                voiced = entry.voiced[from];
+            }
+            if (steps + 1 > max_length) {
+                entry.next_cost[j] = kInfinity;
+                continue;
+            }
+            entry.next_cost[j] = cost + distance;
+            entry.next_length[j] = steps + 1;
+            entry.next_voiced[j] = voiced + is_voiced;
+        }
+        entry.cost.swap(entry.next_cost);
+        entry.length.swap(entry.next_length);
+        entry.voiced.swap(entry.next_voiced);
+
+        size_t end = length - 1;
+        if (entry.cost[end] < kInfinity) {
+            double score = entry.cost[end] / entry.length[end];
+            best = std::min(best, score);
+            // 路径至少一半的帧是语音，避免静音段凑巧匹配
+            if (score < config_.threshold && entry.voiced[end] * 2 >= entry.length[end] && hit < 0) {
+                hit = entry.keyword;
+            }
+        }
+    }
+    last_score_ = best;
+    if (hit >= 0) {
+        refractory_left_ = refractory_frames_;
+        ResetMatch();
+    }
+    return hit;
+}
+
+int TemplateKeywordSpotter::Process(const short* pcm, size_t samples) {
+    int hit = -1;
+    Analyze(pcm, samples, [this, &hit](const Features& features) {
+        int keyword = Match(features);
+        if (hit < 0) {
+            hit = keyword;
+        }
+    });
+    return hit;
+}
+
+void TemplateKeywordSpotter::ResetMatch() {
+    for (Template& entry : templates_) {
+        std::fill(entry.cost.begin(), entry.cost.end(), kInfinity);
+    }
+}
+
+void TemplateKeywordSpotter::Reset() {
+    history_fill_ = 0;
+    refractory_left_ = 0;
+    last_score_ = 1e9;
+    ResetMatch();
+}
+
+std::string_view TemplateKeywordSpotter::Keyword(int index) const {
+    if (index < 0 || static_cast<size_t>(index) >= keywords_.size()) {
+        return {};
+    }
+    return keywords_[index];
+}
+
+}  // namespace linx
@@ -0,0 +1,166 @@
+#include "NoiseSuppressor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "PcmKernels.h"
+
+namespace linx {
+
+namespace {
+
+constexpr float kPowerSmoothing = 0.7f;  // 功率谱的递归平滑系数（每块）
+constexpr float kNoiseBias = 1.5f;       // 平滑功率的最小值低于噪声均值，按此倍数补偿
+constexpr float kMinPower = 1e-12f;
+constexpr int kStartupMs = 200;
+
+size_t FftSizeFor(size_t window) {
+    size_t size = 4;
+    while (size < window) {
+        size <<= 1;
+    }
+    return size;
+}
+
+}  // namespace
+
+NoiseSuppressor::NoiseSuppressor(const NoiseSuppressorConfig& config)
+    : config_(config),
+      hop_(std::max(2u, (config.sample_rate == 0 ? 16000u : config.sample_rate) / 100)),
+      window_size_(2 * hop_),
+      fft_(FftSizeFor(window_size_)) {
+    if (config_.sample_rate == 0) {
+        config_.sample_rate = 16000;
+    }
+    config_.prior_smoothing = std::min(std::max(config_.prior_smoothing, 0.0f), 0.999f);
+    gain_floor_ = static_cast<float>(std::pow(10.0, -std::max(0.0f, config_.max_suppression_db) / 20.0));
+    noise_rise_ = static_cast<float>(std::pow(10.0, std::max(0.0f, config_.noise_rise_db_per_s) / 10.0 / 100.0));
+    startup_blocks_ = kStartupMs / 10;
+
+    window_.resize(window_size_);
+    for (size_t i = 0; i < window_size_; ++i) {
+        window_[i] = static_cast<float>(std::sqrt(0.5 - 0.5 * std::cos(2.0 * M_PI * i / window_size_)));
+    }
+    input_.assign(window_size_, 0.0f);
+    output_.assign(hop_, 0.0f);
+    overlap_.assign(hop_, 0.0f);
+    frame_.assign(fft_.Size(), 0.0f);
+    re_.assign(fft_.Bins(), 0.0f);
+    im_.assign(fft_.Bins(), 0.0f);
+    smoothed_.assign(fft_.Bins(), 0.0f);
+    noise_.assign(fft_.Bins(), 0.0f);
+    clean_.assign(fft_.Bins(), 0.0f);
+}
+
+void NoiseSuppressor::Reset() {
+    std::fill(input_.begin(), input_.end(), 0.0f);
+    std::fill(output_.begin(), output_.end(), 0.0f);
+    std::fill(overlap_.begin(), overlap_.end(), 0.0f);
+    std::fill(smoothed_.begin(), smoothed_.end(), 0.0f);
+    std::fill(noise_.begin(), noise_.end(), 0.0f);
+    std::fill(clean_.begin(), clean_.end(), 0.0f);
+    block_count_ = 0;
+    noise_dbfs_.store(-100.0, std::memory_order_relaxed);
+}
+
+void NoiseSuppressor::Process(const short* in, short* out, size_t n) {
+    auto start = std::chrono::steady_clock::now();
+    // 每块先处理再输出：输出是上一块的重建结果，延迟正好一块
+    size_t blocks = n / hop_;
+    for (size_t b = 0; b < blocks; ++b) {
+        PcmToFloat(input_.data() + hop_, in + b * hop_, hop_);
+        ProcessBlock();
+        PcmFromFloat(out + b * hop_, output_.data(), hop_);
+    }
+    if (n > blocks * hop_ && out != in) {
+        memcpy(out + blocks * hop_, in + blocks * hop_, (n - blocks * hop_) * sizeof(short));
+    }
+    RecordCost(start);
+}
+
+void NoiseSuppressor::Process(const float* in, float* out, size_t n) {
+    auto start = std::chrono::steady_clock::now();
+    size_t blocks = n / hop_;
+    for (size_t b = 0; b < blocks; ++b) {
+        memcpy(input_.data() + hop_, in + b * hop_, hop_ * sizeof(float));
+        ProcessBlock();
+        memcpy(out + b * hop_, output_.data(), hop_ * sizeof(float));
+    }
+    if (n > blocks * hop_ && out != in) {
+        memcpy(out + blocks * hop_, in + blocks * hop_, (n - blocks * hop_) * sizeof(float));
+    }
+    RecordCost(start);
+}
+
+void NoiseSuppressor::RecordCost(std::chrono::steady_clock::time_point start) {
+    uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    frame_us_.Record(us);
+    frames_.fetch_add(1, std::memory_order_relaxed);
+    total_us_.fetch_add(us, std::memory_order_relaxed);
+    if (us > max_us_.load(std::memory_order_relaxed)) {
+        max_us_.store(us, std::memory_order_relaxed);
+    }
+}
+
+void NoiseSuppressor::ProcessBlock() {
+    for (size_t i = 0; i < window_size_; ++i) {
+        frame_[i] = input_[i] * window_[i];
+    }
+    std::fill(frame_.begin() + window_size_, frame_.end(), 0.0f);
+    fft_.Forward(frame_.data(), re_.data(), im_.data());
+
+    const size_t bins = fft_.Bins();
+    const bool startup = block_count_ < startup_blocks_;
+    const float alpha = config_.prior_smoothing;
+    double noise_sum = 0;
+    for (size_t k = 0; k < bins; ++k) {
+        float power = re_[k] * re_[k] + im_[k] * im_[k];
+        float smoothed = block_count_ == 0 ? power : kPowerSmoothing * smoothed_[k] + (1 - kPowerSmoothing) * power;
+        smoothed_[k] = smoothed;
+        float noise = noise_[k];
+        if (startup || smoothed < noise) {
+            noise = smoothed;
+        } else {
+            noise = std::min(noise * noise_rise_, smoothed);
+        }
+        noise = std::max(noise, kMinPower);
+        noise_[k] = noise;
+        noise_sum += (k == 0 || k + 1 == bins) ? noise : 2.0 * noise;
+
+        // 后验信噪比 γ = P / N，先验信噪比 ξ = α · 上一块增益后的功率 / N + (1 - α) · max(γ - 1, 0)
+        float estimate = kNoiseBias * noise;
+        float posterior = power / estimate;
+        float prior = alpha * clean_[k] / estimate + (1 - alpha) * std::max(posterior - 1.0f, 0.0f);
+        float gain = std::max(prior / (1.0f + prior), gain_floor_);
+        clean_[k] = gain * gain * power;
+        re_[k] *= gain;
+        im_[k] *= gain;
+    }
+
+    fft_.Inverse(re_.data(), im_.data(), frame_.data());
+    for (size_t i = 0; i < hop_; ++i) {
+        output_[i] = overlap_[i] + frame_[i] * window_[i];
+        overlap_[i] = frame_[hop_ + i] * window_[hop_ + i];
+    }
+    memmove(input_.data(), input_.data() + hop_, hop_ * sizeof(float));
+
+    // 由 Parseval 定理把单边噪声谱换算为每样本均方：除以 FFT 长度、窗长和窗平方的均值（0.5）
+    double mean_square = noise_sum / fft_.Size() / (window_size_ * 0.5);
+    noise_dbfs_.store(mean_square > 1e-10 ? 10.0 * std::log10(mean_square) : -100.0, std::memory_order_relaxed);
+    ++block_count_;
+    blocks_.fetch_add(1, std::memory_order_relaxed);
+}
+
+NoiseSuppressorStats NoiseSuppressor::GetStats() const {
+    NoiseSuppressorStats stats;
+    stats.frames = frames_.load(std::memory_order_relaxed);
+    stats.blocks = blocks_.load(std::memory_order_relaxed);
+    stats.total_us = total_us_.load(std::memory_order_relaxed);
+    stats.max_us = max_us_.load(std::memory_order_relaxed);
+    stats.noise_dbfs = noise_dbfs_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace linx
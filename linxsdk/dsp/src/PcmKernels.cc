@@ -0,0 +1,194 @@
+#include "PcmKernels.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+
+#include "PcmKernelsImpl.h"
+
+namespace linx {
+
+double PcmLevel::Rms() const {
+    return samples ? std::sqrt(static_cast<double>(sum_squares) / samples) : 0;
+}
+
+double PcmLevel::RmsDbfs() const {
+    double rms = Rms();
+    return rms > 0 ? 20.0 * std::log10(rms / 32768.0) : -100.0;
+}
+
+double PcmLevel::PeakDbfs() const {
+    return peak > 0 ? 20.0 * std::log10(peak / 32768.0) : -100.0;
+}
+
+namespace pcm_detail {
+
+void GainScalar(short* dst, const short* src, size_t n, float gain) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = SaturateS16(src[i] * gain);
+    }
+}
+
+void MixScalar(short* dst, const short* a, const short* b, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = SaturateS16(static_cast<int>(a[i]) + b[i]);
+    }
+}
+
+void S16ToFloatScalar(float* dst, const short* src, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = src[i] * (1.0f / 32768.0f);
+    }
+}
+
+void FloatToS16Scalar(short* dst, const float* src, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = SaturateS16(src[i] * 32768.0f);
+    }
+}
+
+PcmLevel LevelScalar(const short* src, size_t n) {
+    PcmLevel level;
+    int peak = 0;
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        int s = src[i];
+        int a = s < 0 ? -s : s;
+        peak = a > peak ? a : peak;
+        sum += static_cast<uint64_t>(s * s);
+    }
+    level.peak = peak;
+    level.sum_squares = sum;
+    level.samples = n;
+    return level;
+}
+
+void Interleave2Scalar(short* dst, const short* left, const short* right, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[2 * i] = left[i];
+        dst[2 * i + 1] = right[i];
+    }
+}
+
+void Deinterleave2Scalar(short* left, short* right, const short* src, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        left[i] = src[2 * i];
+        right[i] = src[2 * i + 1];
+    }
+}
+
+float DotScalar(const float* a, const float* b, size_t n) {
+    float sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+void GainFixedScalar(short* dst, const short* src, size_t n, int16_t mantissa, int shift) {
+    const int32_t round = shift > 0 ? 1 << (shift - 1) : 0;
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = SaturateS16((static_cast<int32_t>(src[i]) * mantissa + round) >> shift);
+    }
+}
+
+int32_t DotS16Scalar(const short* a, const short* b, size_t n) {
+    int32_t sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += static_cast<int32_t>(a[i]) * b[i];
+    }
+    return sum;
+}
+
+void FftButterflyScalar(float* lo_re, float* lo_im, float* hi_re, float* hi_im, const float* w_re,
+                        const float* w_im, size_t n) {
+    for (size_t k = 0; k < n; ++k) {
+        float tr = hi_re[k] * w_re[k] - hi_im[k] * w_im[k];
+        float ti = hi_re[k] * w_im[k] + hi_im[k] * w_re[k];
+        hi_re[k] = lo_re[k] - tr;
+        hi_im[k] = lo_im[k] - ti;
+        lo_re[k] += tr;
+        lo_im[k] += ti;
+    }
+}
+
+void ComplexMacScalar(float* acc_re, float* acc_im, const float* x_re, const float* x_im, const float* w_re,
+                      const float* w_im, size_t n) {
+    for (size_t k = 0; k < n; ++k) {
+        acc_re[k] += x_re[k] * w_re[k] - x_im[k] * w_im[k];
+        acc_im[k] += x_re[k] * w_im[k] + x_im[k] * w_re[k];
+    }
+}
+
+const PcmKernels kScalarKernels = {
+    "scalar",          GainScalar,         MixScalar,          S16ToFloatScalar,
+    FloatToS16Scalar,  LevelScalar,        Interleave2Scalar,  Deinterleave2Scalar,
+    DotScalar,         GainFixedScalar,    DotS16Scalar,       FftButterflyScalar,
+    ComplexMacScalar,
+};
+
+}  // namespace pcm_detail
+
+int16_t PcmGainToFixed(float gain, int* shift) {
+    float magnitude = std::fabs(gain);
+    int s = 30;
+    while (s > 0 && std::ldexp(magnitude, s) > 32767.0f) {
+        --s;
+    }
+    *shift = s;
+    return pcm_detail::SaturateS16(std::ldexp(gain, s));
+}
+
+namespace {
+
+bool CpuSupports(const char* name) {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    if (strcmp(name, "avx2") == 0) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (strcmp(name, "sse2") == 0) {
+        return __builtin_cpu_supports("sse2");
+    }
+#endif
+    // NEON 实现只在编译期确认可用（__ARM_NEON）时才会被编译进来
+    return strcmp(name, "neon") == 0 || strcmp(name, "scalar") == 0;
+}
+
+const PcmKernels& SelectPcmKernels() {
+    const char* forced = std::getenv("LINX_DSP_KERNELS");
+    if (forced != nullptr) {
+        if (const PcmKernels* kernels = FindPcmKernels(forced)) {
+            return *kernels;
+        }
+    }
+    for (const char* name : {"avx2", "sse2", "neon"}) {
+        if (const PcmKernels* kernels = FindPcmKernels(name)) {
+            return *kernels;
+        }
+    }
+    return pcm_detail::kScalarKernels;
+}
+
+}  // namespace
+
+const PcmKernels* FindPcmKernels(const char* name) {
+    const PcmKernels* kernels = nullptr;
+    if (strcmp(name, "scalar") == 0) {
+        kernels = &pcm_detail::kScalarKernels;
+    } else if (strcmp(name, "sse2") == 0) {
+        kernels = pcm_detail::kSse2Kernels;
+    } else if (strcmp(name, "avx2") == 0) {
+        kernels = pcm_detail::kAvx2Kernels;
+    } else if (strcmp(name, "neon") == 0) {
+        kernels = pcm_detail::kNeonKernels;
+    }
+    return kernels != nullptr && CpuSupports(name) ? kernels : nullptr;
+}
+
+const PcmKernels& GetPcmKernels() {
+    static const PcmKernels& kernels = SelectPcmKernels();
+    return kernels;
+}
+
+}  // namespace linx
@@ -0,0 +1,49 @@
+#pragma once
+
+// dsp 模块内部使用：各指令集实现的函数表及共用的标量尾部处理
+
+#include <cmath>
+
+#include "PcmKernels.h"
+
+namespace linx {
+namespace pcm_detail {
+
+inline short SaturateS16(float v) {
+    if (v >= 32767.0f) {
+        return 32767;
+    }
+    if (v <= -32768.0f) {
+        return -32768;
+    }
+    return static_cast<short>(std::lrint(v));
+}
+
+inline short SaturateS16(int v) {
+    return static_cast<short>(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+}
+
+void GainScalar(short* dst, const short* src, size_t n, float gain);
+void MixScalar(short* dst, const short* a, const short* b, size_t n);
+void S16ToFloatScalar(float* dst, const short* src, size_t n);
+void FloatToS16Scalar(short* dst, const float* src, size_t n);
+PcmLevel LevelScalar(const short* src, size_t n);
+void Interleave2Scalar(short* dst, const short* left, const short* right, size_t n);
+void Deinterleave2Scalar(short* left, short* right, const short* src, size_t n);
+float DotScalar(const float* a, const float* b, size_t n);
+void GainFixedScalar(short* dst, const short* src, size_t n, int16_t mantissa, int shift);
+int32_t DotS16Scalar(const short* a, const short* b, size_t n);
+void FftButterflyScalar(float* lo_re, float* lo_im, float* hi_re, float* hi_im, const float* w_re,
+                        const float* w_im, size_t n);
+void ComplexMacScalar(float* acc_re, float* acc_im, const float* x_re, const float* x_im, const float* w_re,
+                      const float* w_im, size_t n);
+
+extern const PcmKernels kScalarKernels;
+
+// 未编译对应实现时为 nullptr
+extern const PcmKernels* const kSse2Kernels;
+extern const PcmKernels* const kAvx2Kernels;
+extern const PcmKernels* const kNeonKernels;
+
+}  // namespace pcm_detail
+}  // namespace linx
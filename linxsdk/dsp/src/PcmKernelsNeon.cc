@@ -0,0 +1,237 @@
+// NEON 实现（AArch64 始终可用；ARMv7 需以 -mfpu=neon 编译才会启用）
+
+#include "PcmKernelsImpl.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+#include <arm_neon.h>
+
+namespace linx {
+namespace pcm_detail {
+
+namespace {
+
+// 浮点转 int32，就近取整（ARMv7 没有 vcvtnq，加上带符号的 0.5 后截断）
+inline int32x4_t RoundToS32(float32x4_t v) {
+#if defined(__aarch64__)
+    return vcvtnq_s32_f32(v);
+#else
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    uint32x4_t negative = vcltq_f32(v, vdupq_n_f32(0));
+    float32x4_t bias = vbslq_f32(negative, vnegq_f32(half), half);
+    return vcvtq_s32_f32(vaddq_f32(v, bias));
+#endif
+}
+
+inline int16x8_t GainBlockNeon(int16x8_t x, float32x4_t g) {
+    const float32x4_t lo_limit = vdupq_n_f32(-32768.0f);
+    const float32x4_t hi_limit = vdupq_n_f32(32767.0f);
+    float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(x)));
+    float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(x)));
+    lo = vminq_f32(vmaxq_f32(vmulq_f32(lo, g), lo_limit), hi_limit);
+    hi = vminq_f32(vmaxq_f32(vmulq_f32(hi, g), lo_limit), hi_limit);
+    return vcombine_s16(vqmovn_s32(RoundToS32(lo)), vqmovn_s32(RoundToS32(hi)));
+}
+
+void GainNeon(short* dst, const short* src, size_t n, float gain) {
+    const float32x4_t g = vdupq_n_f32(gain);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        vst1q_s16(dst + i, GainBlockNeon(vld1q_s16(src + i), g));
+    }
+    GainScalar(dst + i, src + i, n - i, gain);
+}
+
+void MixNeon(short* dst, const short* a, const short* b, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        vst1q_s16(dst + i, vqaddq_s16(vld1q_s16(a + i), vld1q_s16(b + i)));
+    }
+    MixScalar(dst + i, a + i, b + i, n - i);
+}
+
+void S16ToFloatNeon(float* dst, const short* src, size_t n) {
+    const float32x4_t scale = vdupq_n_f32(1.0f / 32768.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t x = vld1q_s16(src + i);
+        vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), scale));
+        vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), scale));
+    }
+    S16ToFloatScalar(dst + i, src + i, n - i);
+}
+
+void FloatToS16Neon(short* dst, const float* src, size_t n) {
+    const float32x4_t scale = vdupq_n_f32(32768.0f);
+    const float32x4_t lo_limit = vdupq_n_f32(-32768.0f);
+    const float32x4_t hi_limit = vdupq_n_f32(32767.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t lo = vmulq_f32(vld1q_f32(src + i), scale);
+        float32x4_t hi = vmulq_f32(vld1q_f32(src + i + 4), scale);
+        lo = vminq_f32(vmaxq_f32(lo, lo_limit), hi_limit);
+        hi = vminq_f32(vmaxq_f32(hi, lo_limit), hi_limit);
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(RoundToS32(lo)), vqmovn_s32(RoundToS32(hi))));
+    }
+    FloatToS16Scalar(dst + i, src + i, n - i);
+}
+
+PcmLevel LevelNeon(const short* src, size_t n) {
+    int16x8_t vmax = vdupq_n_s16(0);
+    int16x8_t vmin = vdupq_n_s16(0);
+    uint64x2_t acc = vdupq_n_u64(0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t x = vld1q_s16(src + i);
+        vmax = vmaxq_s16(vmax, x);
+        vmin = vminq_s16(vmin, x);
+        // 每个平方最大 2^30，两两相加后按无符号累加到 64 位
+        int32x4_t lo = vmull_s16(vget_low_s16(x), vget_low_s16(x));
+        int32x4_t hi = vmull_s16(vget_high_s16(x), vget_high_s16(x));
+        acc = vpadalq_u32(acc, vreinterpretq_u32_s32(lo));
+        acc = vpadalq_u32(acc, vreinterpretq_u32_s32(hi));
+    }
+
+    short maxs[8];
+    short mins[8];
+    uint64_t sums[2];
+    vst1q_s16(maxs, vmax);
+    vst1q_s16(mins, vmin);
+    vst1q_u64(sums, acc);
+
+    PcmLevel level = LevelScalar(src + i, n - i);
+    for (int k = 0; k < 8; ++k) {
+        int a = maxs[k];
+        int b = -static_cast<int>(mins[k]);
+        level.peak = a > level.peak ? a : level.peak;
+        level.peak = b > level.peak ? b : level.peak;
+    }
+    level.sum_squares += sums[0] + sums[1];
+    level.samples = n;
+    return level;
+}
+
+void Interleave2Neon(short* dst, const short* left, const short* right, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8x2_t lr;
+        lr.val[0] = vld1q_s16(left + i);
+        lr.val[1] = vld1q_s16(right + i);
+        vst2q_s16(dst + 2 * i, lr);
+    }
+    Interleave2Scalar(dst + 2 * i, left + i, right + i, n - i);
+}
+
+void Deinterleave2Neon(short* left, short* right, const short* src, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8x2_t lr = vld2q_s16(src + 2 * i);
+        vst1q_s16(left + i, lr.val[0]);
+        vst1q_s16(right + i, lr.val[1]);
+    }
+    Deinterleave2Scalar(left + i, right + i, src + 2 * i, n - i);
+}
+
+float DotNeon(const float* a, const float* b, size_t n) {
+    float32x4_t acc0 = vdupq_n_f32(0);
+    float32x4_t acc1 = vdupq_n_f32(0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float lanes[4];
+    vst1q_f32(lanes, vaddq_f32(acc0, acc1));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + DotScalar(a + i, b + i, n - i);
+}
+
+// 定点增益：16x16->32 乘法后就近取整右移（vrshl 负移位），饱和收窄回 int16，全程不用浮点
+void GainFixedNeon(short* dst, const short* src, size_t n, int16_t mantissa, int shift) {
+    const int16x4_t m = vdup_n_s16(mantissa);
+    const int32x4_t right = vdupq_n_s32(-shift);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t x = vld1q_s16(src + i);
+        int32x4_t lo = vrshlq_s32(vmull_s16(vget_low_s16(x), m), right);
+        int32x4_t hi = vrshlq_s32(vmull_s16(vget_high_s16(x), m), right);
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+    GainFixedScalar(dst + i, src + i, n - i, mantissa, shift);
+}
+
+int32_t DotS16Neon(const short* a, const short* b, size_t n) {
+    int32x4_t acc0 = vdupq_n_s32(0);
+    int32x4_t acc1 = vdupq_n_s32(0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t x = vld1q_s16(a + i);
+        int16x8_t y = vld1q_s16(b + i);
+        acc0 = vmlal_s16(acc0, vget_low_s16(x), vget_low_s16(y));
+        acc1 = vmlal_s16(acc1, vget_high_s16(x), vget_high_s16(y));
+    }
+    int32_t lanes[4];
+    vst1q_s32(lanes, vaddq_s32(acc0, acc1));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + DotS16Scalar(a + i, b + i, n - i);
+}
+
+void FftButterflyNeon(float* lo_re, float* lo_im, float* hi_re, float* hi_im, const float* w_re,
+                      const float* w_im, size_t n) {
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        float32x4_t hr = vld1q_f32(hi_re + k);
+        float32x4_t hi = vld1q_f32(hi_im + k);
+        float32x4_t wr = vld1q_f32(w_re + k);
+        float32x4_t wi = vld1q_f32(w_im + k);
+        float32x4_t lr = vld1q_f32(lo_re + k);
+        float32x4_t li = vld1q_f32(lo_im + k);
+        float32x4_t tr = vmlsq_f32(vmulq_f32(hr, wr), hi, wi);
+        float32x4_t ti = vmlaq_f32(vmulq_f32(hr, wi), hi, wr);
+        vst1q_f32(hi_re + k, vsubq_f32(lr, tr));
+        vst1q_f32(hi_im + k, vsubq_f32(li, ti));
+        vst1q_f32(lo_re + k, vaddq_f32(lr, tr));
+        vst1q_f32(lo_im + k, vaddq_f32(li, ti));
+    }
+    FftButterflyScalar(lo_re + k, lo_im + k, hi_re + k, hi_im + k, w_re + k, w_im + k, n - k);
+}
+
+void ComplexMacNeon(float* acc_re, float* acc_im, const float* x_re, const float* x_im, const float* w_re,
+                    const float* w_im, size_t n) {
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        float32x4_t xr = vld1q_f32(x_re + k);
+        float32x4_t xi = vld1q_f32(x_im + k);
+        float32x4_t wr = vld1q_f32(w_re + k);
+        float32x4_t wi = vld1q_f32(w_im + k);
+        float32x4_t re = vmlsq_f32(vmulq_f32(xr, wr), xi, wi);
+        float32x4_t im = vmlaq_f32(vmulq_f32(xr, wi), xi, wr);
+        vst1q_f32(acc_re + k, vaddq_f32(vld1q_f32(acc_re + k), re));
+        vst1q_f32(acc_im + k, vaddq_f32(vld1q_f32(acc_im + k), im));
+    }
+    ComplexMacScalar(acc_re + k, acc_im + k, x_re + k, x_im + k, w_re + k, w_im + k, n - k);
+}
+
+}  // namespace
+
+const PcmKernels kNeonTable = {
+    "neon",         GainNeon,      MixNeon,         S16ToFloatNeon,
+    FloatToS16Neon, LevelNeon,     Interleave2Neon, Deinterleave2Neon,
+    DotNeon,        GainFixedNeon, DotS16Neon,      FftButterflyNeon,
+    ComplexMacNeon,
+};
+
+const PcmKernels* const kNeonKernels = &kNeonTable;
+
+}  // namespace pcm_detail
+}  // namespace linx
+
+#else
+
+namespace linx {
+namespace pcm_detail {
+
+const PcmKernels* const kNeonKernels = nullptr;
+
+}  // namespace pcm_detail
+}  // namespace linx
+
+#endif
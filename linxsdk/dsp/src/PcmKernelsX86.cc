@@ -0,0 +1,427 @@
+// SSE2 / AVX2 实现。AVX2 函数用 target 属性单独编译，整个库仍按基线指令集构建，
+// 是否调用由 GetPcmKernels() 在运行时检测 CPU 决定。
+
+#include "PcmKernelsImpl.h"
+
+#if (defined(__x86_64__) || defined(__i386__) && defined(__SSE2__)) && (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#define LINX_AVX2 __attribute__((target("avx2")))
+
+namespace linx {
+namespace pcm_detail {
+
+namespace {
+
+// ==================== SSE2 ====================
+
+// 8 个 int16 乘以 gain 后饱和回 int16（先钳位到 int16 范围再转换，避免溢出成 0x80000000）
+inline __m128i GainBlockSse2(__m128i x, __m128 g) {
+    const __m128 lo_limit = _mm_set1_ps(-32768.0f);
+    const __m128 hi_limit = _mm_set1_ps(32767.0f);
+    __m128i sign = _mm_srai_epi16(x, 15);
+    __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(x, sign));
+    __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(x, sign));
+    lo = _mm_min_ps(_mm_max_ps(_mm_mul_ps(lo, g), lo_limit), hi_limit);
+    hi = _mm_min_ps(_mm_max_ps(_mm_mul_ps(hi, g), lo_limit), hi_limit);
+    return _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+}
+
+void GainSse2(short* dst, const short* src, size_t n, float gain) {
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), GainBlockSse2(x, g));
+    }
+    GainScalar(dst + i, src + i, n - i, gain);
+}
+
+void MixSse2(short* dst, const short* a, const short* b, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_adds_epi16(x, y));
+    }
+    MixScalar(dst + i, a + i, b + i, n - i);
+}
+
+void S16ToFloatSse2(float* dst, const short* src, size_t n) {
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i sign = _mm_srai_epi16(x, 15);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(x, sign)), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(x, sign)), scale));
+    }
+    S16ToFloatScalar(dst + i, src + i, n - i);
+}
+
+void FloatToS16Sse2(short* dst, const float* src, size_t n) {
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    const __m128 lo_limit = _mm_set1_ps(-32768.0f);
+    const __m128 hi_limit = _mm_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 lo = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+        __m128 hi = _mm_mul_ps(_mm_loadu_ps(src + i + 4), scale);
+        lo = _mm_min_ps(_mm_max_ps(lo, lo_limit), hi_limit);
+        hi = _mm_min_ps(_mm_max_ps(hi, lo_limit), hi_limit);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi)));
+    }
+    FloatToS16Scalar(dst + i, src + i, n - i);
+}
+
+// 平方和：madd 得到的每个 int32 是两个平方之和，最大 2^31，按无符号 32 位零扩展累加到 64 位
+PcmLevel LevelSse2(const short* src, size_t n) {
+    __m128i vmax = _mm_set1_epi16(0);
+    __m128i vmin = _mm_set1_epi16(0);
+    __m128i acc = _mm_setzero_si128();
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        vmax = _mm_max_epi16(vmax, x);
+        vmin = _mm_min_epi16(vmin, x);
+        __m128i sq = _mm_madd_epi16(x, x);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(sq, zero));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(sq, zero));
+    }
+
+    alignas(16) short maxs[8];
+    alignas(16) short mins[8];
+    alignas(16) uint64_t sums[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(maxs), vmax);
+    _mm_store_si128(reinterpret_cast<__m128i*>(mins), vmin);
+    _mm_store_si128(reinterpret_cast<__m128i*>(sums), acc);
+
+    PcmLevel level = LevelScalar(src + i, n - i);
+    for (int k = 0; k < 8; ++k) {
+        int a = maxs[k];
+        int b = -static_cast<int>(mins[k]);
+        level.peak = a > level.peak ? a : level.peak;
+        level.peak = b > level.peak ? b : level.peak;
+    }
+    level.sum_squares += sums[0] + sums[1];
+    level.samples = n;
+    return level;
+}
+
+void Interleave2Sse2(short* dst, const short* left, const short* right, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i));
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), _mm_unpacklo_epi16(l, r));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i + 8), _mm_unpackhi_epi16(l, r));
+    }
+    Interleave2Scalar(dst + 2 * i, left + i, right + i, n - i);
+}
+
+void Deinterleave2Sse2(short* left, short* right, const short* src, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i + 8));
+        // 偶数位（左声道）：符号扩展后饱和打包；奇数位（右声道）：算术右移 16 位
+        __m128i l = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                                    _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+        __m128i r = _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(left + i), l);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(right + i), r);
+    }
+    Deinterleave2Scalar(left + i, right + i, src + 2 * i, n - i);
+}
+
+float DotSse2(const float* a, const float* b, size_t n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, _mm_add_ps(acc0, acc1));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + DotScalar(a + i, b + i, n - i);
+}
+
+// 定点增益：mullo/mulhi 拼出 32 位乘积，加上取整偏置后算术右移，饱和打包回 int16
+void GainFixedSse2(short* dst, const short* src, size_t n, int16_t mantissa, int shift) {
+    const __m128i m = _mm_set1_epi16(mantissa);
+    const __m128i round = _mm_set1_epi32(shift > 0 ? 1 << (shift - 1) : 0);
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i lo16 = _mm_mullo_epi16(x, m);
+        __m128i hi16 = _mm_mulhi_epi16(x, m);
+        __m128i lo = _mm_sra_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo16, hi16), round), count);
+        __m128i hi = _mm_sra_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo16, hi16), round), count);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(lo, hi));
+    }
+    GainFixedScalar(dst + i, src + i, n - i, mantissa, shift);
+}
+
+int32_t DotS16Sse2(const short* a, const short* b, size_t n) {
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(x, y));
+    }
+    alignas(16) int32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + DotS16Scalar(a + i, b + i, n - i);
+}
+
+void FftButterflySse2(float* lo_re, float* lo_im, float* hi_re, float* hi_im, const float* w_re,
+                      const float* w_im, size_t n) {
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m128 hr = _mm_loadu_ps(hi_re + k);
+        __m128 hi = _mm_loadu_ps(hi_im + k);
+        __m128 wr = _mm_loadu_ps(w_re + k);
+        __m128 wi = _mm_loadu_ps(w_im + k);
+        __m128 lr = _mm_loadu_ps(lo_re + k);
+        __m128 li = _mm_loadu_ps(lo_im + k);
+        __m128 tr = _mm_sub_ps(_mm_mul_ps(hr, wr), _mm_mul_ps(hi, wi));
+        __m128 ti = _mm_add_ps(_mm_mul_ps(hr, wi), _mm_mul_ps(hi, wr));
+        _mm_storeu_ps(hi_re + k, _mm_sub_ps(lr, tr));
+        _mm_storeu_ps(hi_im + k, _mm_sub_ps(li, ti));
+        _mm_storeu_ps(lo_re + k, _mm_add_ps(lr, tr));
+        _mm_storeu_ps(lo_im + k, _mm_add_ps(li, ti));
+    }
+    FftButterflyScalar(lo_re + k, lo_im + k, hi_re + k, hi_im + k, w_re + k, w_im + k, n - k);
+}
+
+void ComplexMacSse2(float* acc_re, float* acc_im, const float* x_re, const float* x_im, const float* w_re,
+                    const float* w_im, size_t n) {
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m128 xr = _mm_loadu_ps(x_re + k);
+        __m128 xi = _mm_loadu_ps(x_im + k);
+        __m128 wr = _mm_loadu_ps(w_re + k);
+        __m128 wi = _mm_loadu_ps(w_im + k);
+        __m128 re = _mm_sub_ps(_mm_mul_ps(xr, wr), _mm_mul_ps(xi, wi));
+        __m128 im = _mm_add_ps(_mm_mul_ps(xr, wi), _mm_mul_ps(xi, wr));
+        _mm_storeu_ps(acc_re + k, _mm_add_ps(_mm_loadu_ps(acc_re + k), re));
+        _mm_storeu_ps(acc_im + k, _mm_add_ps(_mm_loadu_ps(acc_im + k), im));
+    }
+    ComplexMacScalar(acc_re + k, acc_im + k, x_re + k, x_im + k, w_re + k, w_im + k, n - k);
+}
+
+// ==================== AVX2 ====================
+
+LINX_AVX2 void GainAvx2(short* dst, const short* src, size_t n, float gain) {
+    const __m256 g = _mm256_set1_ps(gain);
+    const __m256 lo_limit = _mm256_set1_ps(-32768.0f);
+    const __m256 hi_limit = _mm256_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(x)));
+        __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(x, 1)));
+        lo = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(lo, g), lo_limit), hi_limit);
+        hi = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(hi, g), lo_limit), hi_limit);
+        // packs 在 128 位通道内交错，permute 恢复顺序
+        __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(lo), _mm256_cvtps_epi32(hi));
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+    GainScalar(dst + i, src + i, n - i, gain);
+}
+
+LINX_AVX2 void MixAvx2(short* dst, const short* a, const short* b, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_adds_epi16(x, y));
+    }
+    MixScalar(dst + i, a + i, b + i, n - i);
+}
+
+LINX_AVX2 void S16ToFloatAvx2(float* dst, const short* src, size_t n) {
+    const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(x)), scale));
+    }
+    S16ToFloatScalar(dst + i, src + i, n - i);
+}
+
+LINX_AVX2 void FloatToS16Avx2(short* dst, const float* src, size_t n) {
+    const __m256 scale = _mm256_set1_ps(32768.0f);
+    const __m256 lo_limit = _mm256_set1_ps(-32768.0f);
+    const __m256 hi_limit = _mm256_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 lo = _mm256_mul_ps(_mm256_loadu_ps(src + i), scale);
+        __m256 hi = _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale);
+        lo = _mm256_min_ps(_mm256_max_ps(lo, lo_limit), hi_limit);
+        hi = _mm256_min_ps(_mm256_max_ps(hi, lo_limit), hi_limit);
+        __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(lo), _mm256_cvtps_epi32(hi));
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+    FloatToS16Scalar(dst + i, src + i, n - i);
+}
+
+LINX_AVX2 PcmLevel LevelAvx2(const short* src, size_t n) {
+    __m256i vmax = _mm256_setzero_si256();
+    __m256i vmin = _mm256_setzero_si256();
+    __m256i acc = _mm256_setzero_si256();
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        vmax = _mm256_max_epi16(vmax, x);
+        vmin = _mm256_min_epi16(vmin, x);
+        __m256i sq = _mm256_madd_epi16(x, x);
+        acc = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(sq, zero));
+        acc = _mm256_add_epi64(acc, _mm256_unpackhi_epi32(sq, zero));
+    }
+
+    alignas(32) short maxs[16];
+    alignas(32) short mins[16];
+    alignas(32) uint64_t sums[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(maxs), vmax);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(mins), vmin);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(sums), acc);
+
+    PcmLevel level = LevelScalar(src + i, n - i);
+    for (int k = 0; k < 16; ++k) {
+        int a = maxs[k];
+        int b = -static_cast<int>(mins[k]);
+        level.peak = a > level.peak ? a : level.peak;
+        level.peak = b > level.peak ? b : level.peak;
+    }
+    level.sum_squares += sums[0] + sums[1] + sums[2] + sums[3];
+    level.samples = n;
+    return level;
+}
+
+LINX_AVX2 float DotAvx2(const float* a, const float* b, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, sum);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + DotScalar(a + i, b + i, n - i);
+}
+
+LINX_AVX2 void GainFixedAvx2(short* dst, const short* src, size_t n, int16_t mantissa, int shift) {
+    const __m256i m = _mm256_set1_epi16(mantissa);
+    const __m256i round = _mm256_set1_epi32(shift > 0 ? 1 << (shift - 1) : 0);
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i lo16 = _mm256_mullo_epi16(x, m);
+        __m256i hi16 = _mm256_mulhi_epi16(x, m);
+        // unpack 与 packs 都在 128 位通道内进行，两者的交错相互抵消，不需要 permute
+        __m256i lo = _mm256_sra_epi32(_mm256_add_epi32(_mm256_unpacklo_epi16(lo16, hi16), round), count);
+        __m256i hi = _mm256_sra_epi32(_mm256_add_epi32(_mm256_unpackhi_epi16(lo16, hi16), round), count);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packs_epi32(lo, hi));
+    }
+    GainFixedScalar(dst + i, src + i, n - i, mantissa, shift);
+}
+
+LINX_AVX2 int32_t DotS16Avx2(const short* a, const short* b, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(x, y));
+    }
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    alignas(16) int32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), sum);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + DotS16Scalar(a + i, b + i, n - i);
+}
+
+LINX_AVX2 void FftButterflyAvx2(float* lo_re, float* lo_im, float* hi_re, float* hi_im, const float* w_re,
+                                const float* w_im, size_t n) {
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256 hr = _mm256_loadu_ps(hi_re + k);
+        __m256 hi = _mm256_loadu_ps(hi_im + k);
+        __m256 wr = _mm256_loadu_ps(w_re + k);
+        __m256 wi = _mm256_loadu_ps(w_im + k);
+        __m256 lr = _mm256_loadu_ps(lo_re + k);
+        __m256 li = _mm256_loadu_ps(lo_im + k);
+        __m256 tr = _mm256_sub_ps(_mm256_mul_ps(hr, wr), _mm256_mul_ps(hi, wi));
+        __m256 ti = _mm256_add_ps(_mm256_mul_ps(hr, wi), _mm256_mul_ps(hi, wr));
+        _mm256_storeu_ps(hi_re + k, _mm256_sub_ps(lr, tr));
+        _mm256_storeu_ps(hi_im + k, _mm256_sub_ps(li, ti));
+        _mm256_storeu_ps(lo_re + k, _mm256_add_ps(lr, tr));
+        _mm256_storeu_ps(lo_im + k, _mm256_add_ps(li, ti));
+    }
+    FftButterflySse2(lo_re + k, lo_im + k, hi_re + k, hi_im + k, w_re + k, w_im + k, n - k);
+}
+
+LINX_AVX2 void ComplexMacAvx2(float* acc_re, float* acc_im, const float* x_re, const float* x_im, const float* w_re,
+                              const float* w_im, size_t n) {
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256 xr = _mm256_loadu_ps(x_re + k);
+        __m256 xi = _mm256_loadu_ps(x_im + k);
+        __m256 wr = _mm256_loadu_ps(w_re + k);
+        __m256 wi = _mm256_loadu_ps(w_im + k);
+        __m256 re = _mm256_sub_ps(_mm256_mul_ps(xr, wr), _mm256_mul_ps(xi, wi));
+        __m256 im = _mm256_add_ps(_mm256_mul_ps(xr, wi), _mm256_mul_ps(xi, wr));
+        _mm256_storeu_ps(acc_re + k, _mm256_add_ps(_mm256_loadu_ps(acc_re + k), re));
+        _mm256_storeu_ps(acc_im + k, _mm256_add_ps(_mm256_loadu_ps(acc_im + k), im));
+    }
+    ComplexMacSse2(acc_re + k, acc_im + k, x_re + k, x_im + k, w_re + k, w_im + k, n - k);
+}
+
+}  // namespace
+
+const PcmKernels kSse2Table = {
+    "sse2",         GainSse2,      MixSse2,         S16ToFloatSse2,
+    FloatToS16Sse2, LevelSse2,     Interleave2Sse2, Deinterleave2Sse2,
+    DotSse2,        GainFixedSse2, DotS16Sse2,      FftButterflySse2,
+    ComplexMacSse2,
+};
+
+// 交织/解交织受限于 AVX2 的 128 位通道内 unpack，收益不明显，沿用 SSE2 实现
+const PcmKernels kAvx2Table = {
+    "avx2",         GainAvx2,      MixAvx2,         S16ToFloatAvx2,
+    FloatToS16Avx2, LevelAvx2,     Interleave2Sse2, Deinterleave2Sse2,
+    DotAvx2,        GainFixedAvx2, DotS16Avx2,      FftButterflyAvx2,
+    ComplexMacAvx2,
+};
+
+const PcmKernels* const kSse2Kernels = &kSse2Table;
+const PcmKernels* const kAvx2Kernels = &kAvx2Table;
+
+}  // namespace pcm_detail
+}  // namespace linx
+
+#else
+
+namespace linx {
+namespace pcm_detail {
+
+const PcmKernels* const kSse2Kernels = nullptr;
+const PcmKernels* const kAvx2Kernels = nullptr;
+
+}  // namespace pcm_detail
+}  // namespace linx
+
+#endif
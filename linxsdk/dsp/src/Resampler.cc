@@ -0,0 +1,216 @@
+#include "Resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace linx {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr size_t kBaseTaps = 32;     // 每相位基础抽头数（降采样时按比例增加）
+constexpr double kRolloff = 0.90;    // 通带截止相对于目标奈奎斯特频率的比例
+constexpr double kKaiserBeta = 8.0;  // 约 80dB 阻带衰减
+
+// 第一类零阶修正贝塞尔函数（级数展开）
+double BesselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    double half = x / 2;
+    for (int k = 1; k < 32; ++k) {
+        term *= (half / k) * (half / k);
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+// Q15 点积结果就近取整回 int16
+inline short ToS16(int32_t acc) {
+    int32_t v = (acc + (1 << 14)) >> 15;
+    return static_cast<short>(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+}
+
+inline short ToS16(float v) {
+    v *= 32768.0f;
+    if (v >= 32767.0f) {
+        return 32767;
+    }
+    if (v <= -32768.0f) {
+        return -32768;
+    }
+    return static_cast<short>(std::lrint(v));
+}
+
+}  // namespace
+
+Resampler::Resampler(unsigned int in_rate, unsigned int out_rate, int channels, size_t max_input_frames)
+    : in_rate_(in_rate),
+      out_rate_(out_rate),
+      channels_(channels < 1 ? 1 : channels),
+      max_input_frames_(max_input_frames == 0 ? 1 : max_input_frames) {
+    unsigned int g = std::gcd(in_rate_ == 0 ? 1 : in_rate_, out_rate_ == 0 ? 1 : out_rate_);
+    up_ = (out_rate_ == 0 ? 1 : out_rate_) / g;
+    down_ = (in_rate_ == 0 ? 1 : in_rate_) / g;
+    if (Passthrough()) {
+        up_ = down_ = 1;
+        return;
+    }
+
+    // 降采样时截止频率更低，需要更长的滤波器才能保持同样的过渡带宽度
+    size_t ratio = (down_ + up_ - 1) / up_;
+    taps_ = kBaseTaps * std::max<size_t>(1, ratio);
+    DesignFilter();
+
+    history_.assign(channels_, std::vector<Sample>(taps_ - 1 + max_input_frames_, 0));
+    Reset();
+}
+
+void Resampler::DesignFilter() {
+    const size_t length = taps_ * up_;
+    // 以上采样后的速率归一化的截止频率（周期/样本）
+    const double cutoff = 0.5 * kRolloff / static_cast<double>(std::max(up_, down_));
+    const double center = (length - 1) / 2.0;
+    const double i0_beta = BesselI0(kKaiserBeta);
+
+    std::vector<double> prototype(length);
+    for (size_t n = 0; n < length; ++n) {
+        double t = n - center;
+        double x = 2 * cutoff * t;
+        double sinc = std::fabs(x) < 1e-12 ? 1.0 : std::sin(kPi * x) / (kPi * x);
+        double r = 2.0 * n / (length - 1) - 1.0;
+        double window = BesselI0(kKaiserBeta * std::sqrt(std::max(0.0, 1.0 - r * r))) / i0_beta;
+        // 乘以 L 补偿插零上采样带来的增益损失
+        prototype[n] = 2 * cutoff * sinc * window * up_;
+    }
+
+    // 拆分多相：第 p 相位第 j 个抽头为 h[p + j*L]，逆序存放以便与输入窗口 x[idx-taps+1..idx] 直接点积
+    phases_.assign(up_ * taps_, 0);
+#if defined(LINX_FIXED_POINT)
+    // Q15 抽头，int32 累加：各相位抽头绝对值之和（最大增益）须小于 2，否则整体缩小，以免点积溢出
+    double max_abs_sum = 0;
+    for (size_t p = 0; p < up_; ++p) {
+        double abs_sum = 0;
+        for (size_t j = 0; j < taps_; ++j) {
+            abs_sum += std::fabs(prototype[p + j * up_]);
+        }
+        max_abs_sum = std::max(max_abs_sum, abs_sum);
+    }
+    const double scale = 32768.0 * std::min(1.0, 1.99 / max_abs_sum);
+    for (size_t p = 0; p < up_; ++p) {
+        for (size_t j = 0; j < taps_; ++j) {
+            double q = std::round(prototype[p + j * up_] * scale);
+            phases_[p * taps_ + (taps_ - 1 - j)] = static_cast<short>(std::max(-32768.0, std::min(32767.0, q)));
+        }
+    }
+#else
+    for (size_t p = 0; p < up_; ++p) {
+        for (size_t j = 0; j < taps_; ++j) {
+            phases_[p * taps_ + (taps_ - 1 - j)] = static_cast<float>(prototype[p + j * up_]);
+        }
+    }
+#endif
+}
+
+void Resampler::Reset() {
+    if (Passthrough()) {
+        return;
+    }
+    for (auto& h : history_) {
+        std::fill(h.begin(), h.end(), 0);
+    }
+    // 预填 taps-1 个零，第一个输出对准第一个真实输入样本
+    history_len_ = taps_ - 1;
+    position_ = (taps_ - 1) * up_;
+}
+
+size_t Resampler::MaxOutputFrames(size_t in_frames) const {
+    if (Passthrough()) {
+        return in_frames;
+    }
+    return in_frames * up_ / down_ + 2;
+}
+
+size_t Resampler::LatencyFrames() const {
+    if (Passthrough()) {
+        return 0;
+    }
+    return ((taps_ * up_ - 1) / 2 + down_ / 2) / down_;
+}
+
+size_t Resampler::Process(const short* in, size_t in_frames, short* out, size_t out_capacity) {
+    if (Passthrough()) {
+        size_t n = std::min(in_frames, out_capacity);
+        memcpy(out, in, n * channels_ * sizeof(short));
+        return n;
+    }
+
+#if defined(LINX_FIXED_POINT)
+    const auto dot = GetPcmKernels().dot_s16;
+#else
+    const auto dot = GetPcmKernels().dot;
+#endif
+    size_t produced = 0;
+    while (in_frames > 0) {
+        size_t chunk = std::min(in_frames, max_input_frames_);
+
+        // 追加到各声道历史
+        for (int c = 0; c < channels_; ++c) {
+            Sample* dst = history_[c].data() + history_len_;
+#if defined(LINX_FIXED_POINT)
+            if (channels_ == 1) {
+                memcpy(dst, in, chunk * sizeof(short));
+            } else {
+                for (size_t i = 0; i < chunk; ++i) {
+                    dst[i] = in[i * channels_ + c];
+                }
+            }
+#else
+            if (channels_ == 1) {
+                PcmToFloat(dst, in, chunk);
+            } else {
+                for (size_t i = 0; i < chunk; ++i) {
+                    dst[i] = in[i * channels_ + c] * (1.0f / 32768.0f);
+                }
+            }
+#endif
+        }
+        history_len_ += chunk;
+        in += chunk * channels_;
+        in_frames -= chunk;
+
+        // 逐个输出：位置 position_ 对应输入下标 idx = position_ / L、相位 position_ % L
+        for (;;) {
+            size_t idx = position_ / up_;
+            if (idx >= history_len_) {
+                break;
+            }
+            size_t phase = position_ % up_;
+            const Sample* coeffs = phases_.data() + phase * taps_;
+            if (produced < out_capacity) {
+                short* frame = out + produced * channels_;
+                for (int c = 0; c < channels_; ++c) {
+                    frame[c] = ToS16(dot(coeffs, history_[c].data() + idx + 1 - taps_, taps_));
+                }
+                ++produced;
+            }
+            position_ += down_;
+        }
+
+        // 只保留最后 taps-1 个样本作为下一块的历史
+        size_t keep = taps_ - 1;
+        size_t drop = history_len_ - keep;
+        for (auto& h : history_) {
+            memmove(h.data(), h.data() + drop, keep * sizeof(Sample));
+        }
+        history_len_ = keep;
+        position_ -= drop * up_;
+    }
+    return produced;
+}
+
+}  // namespace linx
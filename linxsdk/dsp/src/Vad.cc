@@ -0,0 +1,83 @@
+#include "Vad.h"
+
+#include "PcmKernels.h"
+
+namespace linx {
+
+EnergyVad::EnergyVad(const EnergyVadConfig& config)
+    : config_(config), noise_dbfs_(config.initial_noise_dbfs) {
+    if (config_.channels < 1) {
+        config_.channels = 1;
+    }
+}
+
+void EnergyVad::Reset() {
+    noise_dbfs_ = config_.initial_noise_dbfs;
+    last_dbfs_ = -100.0;
+    last_zcr_ = 0;
+}
+
+bool EnergyVad::IsSpeech(const short* pcm, size_t samples) {
+    if (samples == 0) {
+        return false;
+    }
+
+    // 逐样本只有整数运算（单声道时平方和走 SIMD 内核），每帧的对数和比较各一次，没有快速浮点的 ARM 上也很便宜
+    const size_t stride = static_cast<size_t>(config_.channels);
+    PcmLevel level;
+    if (stride == 1) {
+        level = PcmMeasure(pcm, samples);
+    } else {
+        for (size_t i = 0; i < samples; ++i) {
+            int s = pcm[i * stride];
+            level.sum_squares += static_cast<uint64_t>(s * s);
+        }
+        level.samples = samples;
+    }
+    size_t crossings = 0;
+    short prev = pcm[0];
+    for (size_t i = 0; i < samples; ++i) {
+        short s = pcm[i * stride];
+        crossings += (s >= 0) != (prev >= 0);
+        prev = s;
+    }
+    return Classify(level, crossings);
+}
+
+bool EnergyVad::Classify(const PcmLevel& level, size_t crossings) {
+    double dbfs = level.RmsDbfs();
+    double zcr = static_cast<double>(crossings) / level.samples;
+    last_dbfs_ = dbfs;
+    last_zcr_ = zcr;
+
+    // 浊音过零率低；高过零率的帧只有能量明显突出（如清辅音起始）才算语音
+    double above = dbfs - noise_dbfs_;
+    bool speech = dbfs >= config_.min_speech_dbfs && above >= config_.threshold_db &&
+                  (zcr <= config_.max_zcr || above >= 2 * config_.threshold_db);
+
+    // 噪声底：遇到更安静的帧快速下降，非语音帧缓慢上升；浊音帧以更慢的速度上升，
+    // 避免持续的强稳态噪声（风扇、空调）被永远判为语音
+    if (dbfs < noise_dbfs_) {
+        noise_dbfs_ += (dbfs - noise_dbfs_) * config_.noise_fall;
+    } else {
+        bool voiced = speech && zcr <= config_.max_zcr;
+        double rise = voiced ? config_.noise_rise / 16 : config_.noise_rise;
+        noise_dbfs_ += (dbfs - noise_dbfs_) * rise;
+    }
+    return speech;
+}
+
+std::shared_ptr<VoiceDetector> MakeEnergyVad(const EnergyVadConfig& config, const AudioFormatInfo& format) {
+    std::shared_ptr<VoiceDetector> vad;
+    DispatchVoiceFormat(format, [&](auto tag) {
+        vad = std::make_shared<FixedEnergyVad<decltype(tag)>>(config);
+    });
+    if (!vad) {
+        EnergyVadConfig runtime = config;
+        runtime.channels = format.channels;
+        vad = std::make_shared<EnergyVad>(runtime);
+    }
+    return vad;
+}
+
+}  // namespace linx
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "FileStream.h"
+
+namespace linx {
+
+// 资源包文件布局（小端、与写入进程同一 ABI）：
+//   AssetPackHeader | AssetPackEntry × count（按名称排序）| 名称（不以 '\0' 结尾，首尾相接）|
+//   每个片段：uint32 包结束位置 × packets，之后是首尾相接的 Opus 包
+// 所有偏移都相对文件开头；表和片段按 8 字节对齐，映射后可以直接当数组访问，读取时不解析、不拷贝
+constexpr char kAssetPackMagic[8] = {'L', 'I', 'N', 'X', 'A', 'P', 'K', '\0'};
+constexpr uint32_t kAssetPackVersion = 1;
+
+struct AssetPackHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;         // 片段数
+    uint64_t entries;       // AssetPackEntry 表的偏移
+    uint64_t names;         // 名称区的偏移
+    uint64_t file_size;     // 写入时的文件大小，打开时校验（截断的文件直接拒绝）
+    char reserved[24];
+};
+
+struct AssetPackEntry {
+    uint32_t name;          // 名称在名称区中的偏移
+    uint16_t name_len;
+    uint16_t channels;      // Opus 流的声道数
+    uint32_t input_rate;    // 编码前的采样率（仅供参考，解码端可选任意采样率）
+    uint32_t pre_skip;      // 解码后开头丢弃的 48kHz 样本数（编码器前瞻）
+    uint32_t packets;
+    uint32_t duration_ms;   // 全部包的时长（含 pre_skip）
+    uint64_t offset;        // 包结束位置表的偏移，包数据紧随其后
+    uint64_t data_bytes;    // 包数据的总字节数
+};
+
+static_assert(sizeof(AssetPackHeader) == 64, "asset pack header layout");
+static_assert(sizeof(AssetPackEntry) == 40, "asset pack entry layout");
+
+// 资源包中的一个片段：指向映射内存的视图，资源包打开期间有效
+struct AssetClip {
+    std::string_view name;
+    int channels = 1;
+    unsigned int input_rate = 16000;
+    unsigned int pre_skip = 0;
+    unsigned int duration_ms = 0;
+    size_t packets = 0;
+    const uint32_t* ends = nullptr;       // 每个包在 data 中的结束位置
+    const unsigned char* data = nullptr;
+    size_t data_bytes = 0;
+
+    // 第 index 个包；结束位置表损坏（不递增或越界）时返回 nullptr
+    const unsigned char* Packet(size_t index, size_t* len) const {
+        size_t begin = index == 0 ? 0 : ends[index - 1];
+        size_t end = ends[index];
+        if (end < begin || end > data_bytes) {
+            *len = 0;
+            return nullptr;
+        }
+        *len = end - begin;
+        return data + begin;
+    }
+};
+
+// 预编码的提示音资源包：一个文件里放若干段 Opus 编码的提示音（开机、断网、唤醒等），按名称索引。
+// 打开时整个文件只读映射，只校验文件头和索引表的边界；片段数据按需缺页读入，
+// 占用的是页缓存而不是堆，内存紧张时内核可以直接丢弃、再次播放时重新读入。
+// 打包见 AssetPackWriter 和 bench/ 中的 linx_assetpack 工具，播放见 AssetPlayer（audio 模块）
+class AssetPack {
+public:
+    static constexpr size_t kNotFound = static_cast<size_t>(-1);
+
+    AssetPack() = default;
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    // 映射并校验资源包，失败时返回 false 并写入 error
+    bool Open(const std::string& path, std::string* error = nullptr);
+    void Close();
+    bool IsOpen() const { return header_ != nullptr; }
+
+    size_t Count() const { return header_ != nullptr ? header_->count : 0; }
+    // 按名称查找（二分查找），返回片段编号，没有时返回 kNotFound
+    size_t Find(std::string_view name) const;
+    // 片段编号须小于 Count()
+    AssetClip Clip(size_t index) const;
+
+    // 包数据所在页预读进页缓存（启动后空闲时调用，第一次播放不缺页）
+    void Prefetch() const;
+    const std::string& Path() const { return path_; }
+
+private:
+    std::string_view Name(const AssetPackEntry& entry) const;
+
+    MappedFile file_;
+    std::string path_;
+    const AssetPackHeader* header_ = nullptr;
+    const AssetPackEntry* entries_ = nullptr;
+};
+
+// 资源包写入：攒齐全部片段后一次写出（写临时文件再 rename）
+class AssetPackWriter {
+public:
+    // 登记一个片段；packets 为按顺序排列的 Opus 包，同名时替换。包为空或名称为空时返回 false
+    bool Add(const std::string& name, int channels, unsigned int input_rate, unsigned int pre_skip,
+             const std::vector<std::string>& packets);
+    bool Write(const std::string& path, std::string* error = nullptr) const;
+    size_t Count() const { return clips_.size(); }
+
+private:
+    struct Pending {
+        std::string name;
+        int channels = 1;
+        unsigned int input_rate = 16000;
+        unsigned int pre_skip = 0;
+        unsigned int duration_ms = 0;
+        std::vector<uint32_t> ends;
+        std::string data;
+    };
+    std::vector<Pending> clips_;
+};
+
+}  // namespace linx
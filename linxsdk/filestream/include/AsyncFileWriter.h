@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "LockProfiler.h"
+
+namespace linx {
+
+// 异步写盘的后端
+enum class AsyncIoBackend : uint8_t {
+    Auto = 0,     // 内核支持时用 io_uring，否则线程池
+    IoUring = 1,  // 只用 io_uring，不可用时 Open 失败
+    Threads = 2,  // 共享的 I/O 线程池（pwrite）
+};
+
+const char* AsyncIoBackendName(AsyncIoBackend backend);
+
+struct AsyncFileWriterConfig {
+    AsyncIoBackend backend = AsyncIoBackend::Auto;
+    size_t buffer_bytes = 64 * 1024;  // 每块缓冲区的大小（O_DIRECT 时向上取整到 4096）
+    size_t buffers = 8;               // 预分配的缓冲区数，也是在途写请求的上限；io_uring 下注册为固定缓冲区
+    size_t submit_batch = 4;          // 攒够这么多块写满的缓冲区再一次提交（Flush 时不论多少都提交）
+    bool direct = false;              // O_DIRECT：大文件顺序写不经过页缓存，不在回写时阻塞；文件系统不支持时自动关闭
+};
+
+struct AsyncFileWriterStats {
+    uint64_t writes = 0;       // 完成的写请求数
+    uint64_t bytes = 0;        // 写入文件的字节数
+    uint64_t submits = 0;      // 提交次数（io_uring_enter / 投递线程池）
+    uint64_t stalls = 0;       // 全部缓冲区都在途、Write 只能等一个写完成的次数
+    uint64_t errors = 0;       // 写失败（之后的写入都被拒绝）
+    size_t max_inflight = 0;   // 同时在途的写请求数峰值
+};
+
+// 异步顺序写文件：Write 只把数据拷进预分配的缓冲区，写满的缓冲区攒成一批提交给内核（io_uring 的
+// WRITE_FIXED，缓冲区预先注册，内核不再逐次映射用户页）或 I/O 线程池，调用线程不等写盘完成；
+// 闪存回写慢时只有在全部缓冲区都在途时 Write 才会等待（计入 stalls），而不是每次 fwrite 都可能阻塞在内核里。
+// 打开 O_DIRECT 时缓冲区按 4096 对齐、每块按对齐的偏移写出，末尾不足一块的部分在 Close 时去掉 O_DIRECT 写出。
+// 只从一个线程使用（录音线程、导出线程等）
+class AsyncFileWriter {
+public:
+    explicit AsyncFileWriter(const AsyncFileWriterConfig& config = {});
+    ~AsyncFileWriter();
+
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+    // 创建（截断）文件，失败返回 false
+    bool Open(const std::string& path);
+    // 追加数据；写失败之后返回 false
+    bool Write(const void* data, size_t len);
+    // 提交当前缓冲区（未写满的也提交）和攒着的写请求，不等待完成
+    bool Flush();
+    // 等全部写请求完成后同步写 [offset, offset + len)（如补全文件头），只在 Close 之前调用
+    bool WriteAt(uint64_t offset, const void* data, size_t len);
+    // 写出剩余数据、等待全部完成并关闭文件
+    bool Close();
+
+    bool IsOpen() const { return fd_ >= 0; }
+    bool Failed() const { return failed_; }
+    uint64_t Size() const { return offset_ + fill_; }  // 已追加的字节数（含尚未写完的）
+    AsyncIoBackend Backend() const { return backend_; }
+    AsyncFileWriterStats GetStats() const;
+
+private:
+    class Ring;
+
+    struct Buffer {
+        char* data = nullptr;
+        size_t len = 0;
+        uint64_t offset = 0;
+    };
+
+    bool Drain();
+    bool Submit(size_t index);
+    bool FlushQueued();
+    bool WaitFree();
+    void Complete(size_t index, long result);
+    bool Reap(bool wait);
+
+    AsyncFileWriterConfig config_;
+    AsyncIoBackend backend_ = AsyncIoBackend::Threads;
+    std::unique_ptr<Ring> ring_;  // io_uring，不可用时为空
+    int fd_ = -1;
+    bool direct_ = false;
+    bool failed_ = false;
+    std::string path_;
+
+    char* memory_ = nullptr;  // 全部缓冲区的一块对齐内存
+    std::vector<Buffer> buffers_;
+    std::vector<size_t> free_;    // 空闲的缓冲区
+    std::vector<size_t> queued_;  // 写满、等待批量提交的缓冲区
+    size_t current_ = SIZE_MAX;   // 正在填充的缓冲区
+    size_t fill_ = 0;
+    uint64_t offset_ = 0;         // 当前缓冲区在文件中的起始偏移
+    size_t inflight_ = 0;
+
+    // 线程池后端的完成通知
+    ProfiledMutex mutex_{"file_writer_done"};
+    ProfiledConditionVariable done_cv_{"file_writer_done"};
+    std::vector<std::pair<size_t, long>> completed_;  // （缓冲区，pwrite 结果），持 mutex_
+
+    std::atomic<uint64_t> writes_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> submits_{0};
+    std::atomic<uint64_t> stalls_{0};
+    std::atomic<uint64_t> errors_{0};
+    std::atomic<size_t> max_inflight_{0};
+};
+
+}  // namespace linx
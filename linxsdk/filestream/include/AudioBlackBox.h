@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "LockProfiler.h"
+
+namespace linx {
+
+// 黑匣子记录的音频流
+enum class BlackBoxStream : uint8_t {
+    Uplink = 0,    // 编码后发往服务器的 Opus 包
+    Downlink = 1,  // 收到的 TTS Opus 包（解码前）
+};
+
+constexpr size_t kBlackBoxStreams = 2;
+
+// 黑匣子文件布局（小端、与写入进程同一 ABI）：256 字节文件头，之后每路流一个 capacity 字节的环。
+// 环中依次存放 [BlackBoxRecord][Opus 包]，按 8 字节对齐；记录放不下时写一个回绕标记，从环的开头继续。
+// head/tail 为写入的逻辑字节位置（只增不减），[tail, head) 之间是完整的记录
+constexpr char kBlackBoxMagic[8] = {'L', 'I', 'N', 'X', 'B', 'B', 'X', '\0'};
+constexpr uint32_t kBlackBoxVersion = 1;
+constexpr uint32_t kBlackBoxWrap = 0xffffffffu;  // 记录长度为该值时表示环的剩余部分为空，下一条从开头开始
+
+struct BlackBoxStreamHeader {
+    std::atomic<uint64_t> head;  // 下一条记录的写入位置
+    std::atomic<uint64_t> tail;  // 最旧的有效记录，写入前先推进（读取端据此判断拷贝期间被覆盖的部分）
+    uint64_t offset;             // 环在文件中的偏移
+    uint32_t channels;           // 以下三项写入导出文件的 OpusHead
+    uint32_t pre_skip;
+    uint32_t input_rate;
+    uint32_t reserved;
+};
+
+struct BlackBoxHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t streams;
+    uint64_t capacity;         // 每路流的环字节数（8 的倍数）
+    uint64_t pid;
+    uint64_t start_steady_us;  // 打开时的单调时钟（与记录的 time_us 同一时钟）
+    uint64_t start_system_us;  // 同一时刻的墙上时间（unix 微秒）
+    char reserved[16];
+    alignas(64) BlackBoxStreamHeader stream[kBlackBoxStreams];
+};
+
+struct BlackBoxRecord {
+    uint32_t len;      // 包字节数，kBlackBoxWrap 为回绕标记
+    uint32_t reserved;
+    uint64_t time_us;  // steady_clock 微秒
+};
+
+static_assert(sizeof(BlackBoxHeader) <= 256, "black box header layout");
+static_assert(sizeof(BlackBoxRecord) == 16, "black box record layout");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "black box atomics must be lock-free to live in a file");
+
+// 每路流在导出文件 OpusHead 中的参数
+struct BlackBoxStreamInfo {
+    int channels = 1;
+    unsigned int pre_skip = 0;         // 编码器前瞻（48kHz 样本数），下行未知时为 0
+    unsigned int input_rate = 16000;
+};
+
+struct AudioBlackBoxConfig {
+    std::string path;                          // 映射文件，进程崩溃后仍可用 Export 导出；为空时使用匿名内存
+    std::chrono::seconds duration{300};        // 每路流保留的时长（按 max_bitrate 估算容量）
+    unsigned int max_bitrate = 32000;          // 估算容量用的码率上限（bps），实际码率更低时覆盖更久
+    BlackBoxStreamInfo stream[kBlackBoxStreams];
+    std::string dump_dir = "/tmp";             // RequestDump 的导出目录
+};
+
+struct AudioBlackBoxStats {
+    uint64_t packets[kBlackBoxStreams] = {};      // 写入的包数
+    uint64_t overwritten[kBlackBoxStreams] = {};  // 被新包覆盖的旧包数
+    uint64_t rejected = 0;                        // 过大（超过环的 1/4）或为空而未记录的包
+    uint64_t dumps = 0;                           // 成功导出的次数
+    size_t capacity = 0;                          // 每路流的环字节数
+};
+
+// 一次导出的结果
+struct BlackBoxDump {
+    std::vector<std::string> files;                // 写出的文件（没有包的流不写）
+    uint64_t packets[kBlackBoxStreams] = {};
+    double duration_s[kBlackBoxStreams] = {};      // 最旧到最新一个包的时间跨度
+};
+
+// 音频黑匣子：把最近 N 分钟的上行、下行 Opus 包连同到达时间保存在固定大小的内存映射环中，
+// 设备上“没听到我说话”一类问题出现后再导出为 Ogg/Opus，不需要一直写盘录音。
+// Push 只做一次自旋标志、一次 16 字节头写入和一次 memcpy，不分配内存、不做系统调用；
+// 空间不足时覆盖最旧的包。每路流的环按 duration × max_bitrate（外加每包 16 字节头）分配，打开时预先触碰全部页面。
+//
+// 导出（Dump / RequestDump / Export）在调用线程或黑匣子自己的线程上进行：拷贝环、校验拷贝期间被覆盖的部分，
+// 每路流写成一个 Ogg/Opus 文件。两个文件以两路流中最早的包为共同起点，包之间超过一帧的空隙（VAD 静音、
+// 没有回复时）用空帧补齐，两个文件可以对齐播放；下行 TTS 通常快于实时到达，这部分按到达顺序紧接排列
+class AudioBlackBox {
+public:
+    explicit AudioBlackBox(const AudioBlackBoxConfig& config);
+    ~AudioBlackBox();
+
+    AudioBlackBox(const AudioBlackBox&) = delete;
+    AudioBlackBox& operator=(const AudioBlackBox&) = delete;
+
+    // 创建（截断）映射文件或匿名映射，失败返回 false
+    bool Open();
+    void Close();
+    bool IsOpen() const { return header_ != nullptr; }
+
+    // 启动导出线程，之后可以用 RequestDump 从信号处理函数中请求导出
+    bool Start();
+    void Stop();
+
+    // 记录一个包（任意线程，同一路流的并发写入串行化）；未打开、包为空或过大时返回 false
+    bool Push(BlackBoxStream stream, const void* data, size_t len);
+
+    // 立即导出到 <prefix>-uplink.opus / <prefix>-downlink.opus（调用线程上进行文件写入）
+    bool Dump(const std::string& prefix, BlackBoxDump* result = nullptr);
+    // 异步信号安全：请求导出线程把黑匣子导出到 dump_dir/linx-blackbox-<墙上毫秒>
+    void RequestDump();
+    // 导出到 dump_dir 下按时间命名的文件，返回结果说明（供指标端点的命令回复使用）
+    std::string DumpToDir();
+
+    AudioBlackBoxStats GetStats() const;
+    const std::string& Path() const { return config_.path; }
+
+    // 导出另一个进程留下（如崩溃后）的黑匣子文件
+    static bool Export(const std::string& path, const std::string& prefix, BlackBoxDump* result,
+                       std::string* error);
+
+private:
+    bool Map();
+    void RunDumper();
+    unsigned char* Ring(size_t index) const { return base_ + header_->stream[index].offset; }
+
+    AudioBlackBoxConfig config_;
+    int fd_ = -1;
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    BlackBoxHeader* header_ = nullptr;
+    unsigned char* base_ = nullptr;
+    uint64_t capacity_ = 0;
+
+    std::atomic_flag writing_[kBlackBoxStreams] = {ATOMIC_FLAG_INIT, ATOMIC_FLAG_INIT};
+    std::atomic<uint64_t> packets_[kBlackBoxStreams] = {};
+    std::atomic<uint64_t> overwritten_[kBlackBoxStreams] = {};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> dumps_{0};
+    ProfiledMutex dump_mutex_{"blackbox_dump"};  // 信号触发和指标端点触发的导出互斥
+
+    int wake_read_ = -1;
+    std::atomic<int> wake_write_{-1};  // RequestDump 写入一个字节唤醒导出线程（非阻塞），Stop 时关闭
+    std::thread thread_;
+};
+
+}  // namespace linx
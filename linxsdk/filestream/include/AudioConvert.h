@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Opus.h"
+
+namespace linx {
+
+// 转换输出格式
+enum class ConvertFormat : uint8_t {
+    Pcm = 0,      // 裸 16-bit 交错 PCM
+    Wav = 1,      // 16-bit PCM WAV
+    OggOpus = 2,  // Ogg/Opus（OggOpusWriter）
+};
+
+struct AudioConvertOptions {
+    unsigned int sampleRate = 8000;  // 输出采样率，0 保持输入；OggOpus 只支持 8/12/16/24/48kHz
+    int channels = 1;                // 输出声道数（1 或 2），0 保持输入
+    // OggOpus：离线转换不在乎 CPU，默认最高复杂度、不开 DTX（归档文件保留完整的静音段）
+    OpusEncoderConfig opus = [] {
+        OpusEncoderConfig config;
+        config.application = OPUS_APPLICATION_VOIP;
+        config.bitrate = 24000;
+        config.signal = OPUS_SIGNAL_VOICE;
+        return config;
+    }();
+    int frameMs = 20;  // Opus 帧时长
+};
+
+// 批量转换的一项任务
+struct AudioConvertJob {
+    std::string src;  // 输入 WAV（格式任意，解析见 parseWavHeader）
+    std::string dst;
+    ConvertFormat format = ConvertFormat::OggOpus;
+};
+
+// 进程内的音频转换：PcmReader 流式读入输入 WAV，按块做声道转换（立体声转单声道用 SIMD 内核）、
+// 重采样（Resampler，SIMD 点积）并写出，不调用 ffmpeg，内存占用与文件长度无关。
+// 输入不是 16-bit PCM WAV、参数不支持或写文件失败时返回 false
+bool convertAudio(const std::string& dstPath, const std::string& srcPath, ConvertFormat format,
+                  const AudioConvertOptions& options = AudioConvertOptions());
+
+// 输入 WAV 编码为 Ogg/Opus
+bool wav2opus(const std::string& opusFilePath, const std::string& wavFilePath,
+              const AudioConvertOptions& options = AudioConvertOptions());
+
+// 批量转换中一个工作线程的统计
+struct AudioConvertWorkerStats {
+    size_t jobs = 0;          // 处理的任务数（含失败）
+    size_t succeeded = 0;
+    size_t stolen = 0;        // 从其他线程队列窃取的任务数
+    uint64_t inputBytes = 0;  // 输入文件字节数
+    double audioSeconds = 0;  // 成功转换的音频时长
+    double busySeconds = 0;   // 处理任务的时间（不含挑选、窃取）
+};
+
+struct AudioConvertBatchStats {
+    size_t jobs = 0;
+    size_t succeeded = 0;
+    uint64_t inputBytes = 0;
+    double audioSeconds = 0;
+    double wallSeconds = 0;  // 整个批次的耗时，audioSeconds / wallSeconds 即实时倍数
+    std::vector<AudioConvertWorkerStats> workers;
+};
+
+// 批量转换：任务分给 threads 个工作线程（0 表示 CPU 核数，调用线程也参与）。
+// 任务按输入文件大小从大到小轮流分到各线程自己的队列，线程从队首取任务，队列空了就从剩余最多的队列尾部窃取，
+// 文件长短不一时各线程几乎同时做完。每个线程只有一份编码器、重采样器和缓冲区，采样率和声道数不变时任务之间只 Reset；
+// 输入经 mmap 流式读入，内存占用与文件长度、文件数都无关。
+// results 非空时写入每个任务是否成功，stats 非空时写入批次和各线程的统计，返回成功的个数
+size_t convertAudioBatch(const std::vector<AudioConvertJob>& jobs, const AudioConvertOptions& options,
+                         size_t threads = 0, std::vector<bool>* results = nullptr,
+                         AudioConvertBatchStats* stats = nullptr);
+
+}  // namespace linx
@@ -1,9 +1,13 @@
 #pragma once
 #include <stdio.h>
 
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "AsyncFileWriter.h"
 #include "Log.h"
 
 #define ASSERT(expression)                                                                        \
@@ -36,6 +40,76 @@ struct WAVE_DATA {
     unsigned int subchunk2Size;  //==NumSamples*numChannels*bitsPerSample/8
 };
 
+// 解析出的 WAV 参数，dataOffset/dataSize 为 data 块数据在文件中的位置和字节数
+struct WavInfo {
+    int audioFormat = 1;            // 1 为 PCM，0xFFFE 为 WAVE_FORMAT_EXTENSIBLE
+    int numChannels = 1;
+    unsigned int sampleRate = 16000;
+    int bitsPerSample = 16;
+    int blockAlign = 2;             // 每帧字节数
+    size_t dataOffset = 0;
+    size_t dataSize = 0;
+};
+
+// 从内存中的文件内容解析 WAV 头：逐块遍历，fmt 块可大于 16 字节，data 前可有 LIST/fact 等块，
+// 头部不是固定的 44 字节。data 块长度为 0 或超出文件（边录边写、未补全的头）时取到文件末尾。
+// 不是 RIFF/WAVE 或缺少 fmt/data 块时返回 false
+bool parseWavHeader(const void* data, size_t size, WavInfo* info);
+
+// 只读内存映射文件：不把整个文件读进堆内存，页面按访问从页缓存映射进来
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    int open(const std::string& filePath);
+    void close();
+    bool valid() const { return fd_ >= 0; }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    // 告知内核 [offset, offset + len) 之后不再访问，释放这部分已映射的页面（按页对齐向内收缩）
+    void release(size_t offset, size_t len);
+
+private:
+    int fd_ = -1;
+    char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// 流式 PCM 读取：基于 MappedFile，按块顺序读出 WAV（自动解析头部）或裸 PCM 文件的数据，
+// 已读过的部分按窗口释放映射，处理任意长度的录音时常驻内存保持恒定
+class PcmReader {
+public:
+    PcmReader() = default;
+
+    // 打开 WAV 文件；不是 WAV 时返回 -1
+    int open(const std::string& filePath);
+    // 打开裸 PCM 文件（16-bit 交错），格式由调用方给出
+    int openRaw(const std::string& filePath, int channels, unsigned int sampleRate);
+    void close();
+    bool valid() const { return file_.valid(); }
+    const WavInfo& info() const { return info_; }
+
+    // 拷贝至多 len 字节（按整帧向下取整）到 buf，返回实际字节数，读完返回 0
+    size_t readChunk(void* buf, size_t len);
+    // 零拷贝：返回映射内存中至多 maxBytes 字节（整帧）的视图，在下一次读取前有效。
+    // 数据起始不保证按 2 字节对齐，需要 short 访问时用 readChunk
+    std::string_view nextChunk(size_t maxBytes);
+    size_t position() const { return pos_; }
+    size_t remaining() const { return info_.dataSize - pos_; }
+    void rewind() { pos_ = 0; released_ = 0; }
+
+private:
+    void advance(size_t len);
+
+    MappedFile file_;
+    WavInfo info_;
+    size_t pos_ = 0;       // data 块内的读取位置
+    size_t released_ = 0;  // 已释放映射的字节数（相对 data 块起始）
+};
+
 class FileStream {
 public:
     FileStream();
@@ -50,22 +124,80 @@ public:
     int ftell();
     void rewind();
     void fclose();
+    // 以下三个把整个文件读进内存，长录音用 PcmReader 流式读取
     std::vector<char> readStream(size_t begin_offset, size_t end_offset);
     std::vector<char> readStream();
     std::string readAll();
     int wavfopen(const std::string& filePath, const std::string& FLAG);
-    void wavfclose(int pcmsize, int channels);
-    void saveWavWithOneChannel(const std::string& path, const std::vector<char>& src);
+    // 异步写打开：数据经 AsyncFileWriter 写出（io_uring 或 I/O 线程池），fwrite 只拷贝进缓冲区；
+    // 只能顺序 fwrite/fflush，不支持 fread/fseek/ftell。写者在 fclose 后保留，下次打开复用缓冲区
+    int fopenAsync(const std::string& filePath, const AsyncFileWriterConfig& config);
+    int wavfopenAsync(const std::string& filePath, const AsyncFileWriterConfig& config);
+    void wavfclose(int pcmsize, int channels, unsigned int sampleRate = 8000);
+    // 异步写时提交已缓冲的数据（不等待完成），否则 fflush
+    int fflush();
+    const AsyncFileWriter* asyncWriter() const { return async_.get(); }
+    // 打开 WAV 文件读取：解析 fmt 块（跳过 LIST 等其他块），成功时文件位置停在 data 块数据起始处，
+    // *dataSize 为数据字节数；不是 PCM WAV 时返回 -1
+    int wavfopenread(const std::string& filePath, WAVE_FMT* fmt, unsigned int* dataSize);
+    // 16-bit PCM 字节流写成 WAV；两路时按样本交织，短的一路补静音（经 WavWriter 分块写出，不复制整段音频）
+    void saveWavWithOneChannel(const std::string& path, const std::vector<char>& src,
+                               unsigned int sampleRate = 16000);
     void saveWavWithTwoChannel(const std::string& path, const std::vector<char>& first,
-                               std::vector<char>& second);
+                               const std::vector<char>& second, unsigned int sampleRate = 16000);
 
 private:
     FILE* fp_ = nullptr;
+    std::unique_ptr<AsyncFileWriter> async_;
     std::string filePath_;
 };
 
-bool pcm2wav(const std::string& wavFilePath, const std::string& pcmFilePath);
+// 一路单声道 16-bit PCM
+struct PcmPlane {
+    const short* data = nullptr;
+    size_t samples = 0;
+};
+
+// 流式多声道 WAV 写出：把 N 路单声道平面（或已交织的 PCM）按固定大小的块交织（PcmInterleave，立体声为 SIMD 内核）
+// 后顺序写出，常驻内存只有一个块，任意长度的多路录音（如麦克风 + TTS 的双声道 QA 录音）都是恒定内存。
+// close 时按实际写入的帧数、声道数和采样率补全 WAV 头
+class WavWriter {
+public:
+    explicit WavWriter(size_t blockFrames = 4096);
+    ~WavWriter();
+    WavWriter(const WavWriter&) = delete;
+    WavWriter& operator=(const WavWriter&) = delete;
+
+    int open(const std::string& path, int channels, unsigned int sampleRate);
+    // planes 为 channels 个指针，各指向 frames 个样本；为 nullptr 的声道写静音
+    bool write(const short* const* planes, size_t frames);
+    // 已交织的 frames 帧
+    bool writeInterleaved(const short* pcm, size_t frames);
+    // 补全头并关闭，返回写入的帧数
+    size_t close();
+    bool isOpen() const { return open_; }
+    size_t frames() const { return frames_; }
+
+private:
+    FileStream file_;
+    std::vector<short> block_;       // 一块交织数据
+    std::vector<short> silence_;     // 一块静音，供 nullptr 声道使用
+    std::vector<const short*> planes_;
+    size_t blockFrames_;
+    int channels_ = 0;
+    unsigned int sampleRate_ = 16000;
+    size_t frames_ = 0;
+    bool open_ = false;
+};
+
+// 多路单声道 PCM 交织写成一个 WAV：各路长度可以不同，短的在结尾补静音；按块写出，不复制整段音频
+bool saveWavPlanar(const std::string& path, const PcmPlane* planes, int channels, unsigned int sampleRate = 16000);
+
+// 流式转换（恒定内存），channels/sampleRate 写入 WAV 头
+bool pcm2wav(const std::string& wavFilePath, const std::string& pcmFilePath, int channels = 1,
+             unsigned int sampleRate = 8000);
+// 进程内转换为 8kHz 单声道裸 PCM（不再调用 ffmpeg），其他参数和格式见 AudioConvert.h
 bool wav2pcm(const std::string& pcmFilePath, const std::string& wavFilePath);
-void wav2mp3(const std::string& dst_path, const std::string& src_path, bool override);
+// 没有内置 MP3 编码器（原先声明的 wav2mp3 已删除），压缩归档用 AudioConvert.h 的 wav2opus
 
 }  // namespace linx
\ No newline at end of file
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "FileStream.h"
+
+namespace linx {
+
+// 模型权重文件布局（小端、与写入进程同一 ABI）：
+//   ModelFileHeader | ModelTensorEntry × count（按名称排序）| 名称（不以 '\0' 结尾，首尾相接）| 各张量数据
+// 张量数据按 64 字节对齐（映射基址按页对齐，映射后的指针同样对齐，可以直接交给 SIMD 内核）。
+// header_crc 覆盖文件头（该字段按 0 计）、张量表和名称区；每个张量另有数据的 CRC32，按需校验
+constexpr char kModelFileMagic[8] = {'L', 'I', 'N', 'X', 'M', 'D', 'L', '\0'};
+constexpr uint32_t kModelFileVersion = 1;
+constexpr size_t kModelTensorAlign = 64;
+constexpr int kModelMaxRank = 4;
+
+enum class ModelDType : uint8_t {
+    F32 = 0,
+    F16,
+    I32,
+    I16,
+    I8,
+    U8,
+    kCount,
+};
+
+// 元素字节数，无效类型返回 0
+size_t ModelDTypeSize(ModelDType dtype);
+// 小写名称，如 f32、i8
+const char* ModelDTypeName(ModelDType dtype);
+
+struct ModelFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;         // 张量数
+    uint64_t entries;       // ModelTensorEntry 表的偏移
+    uint64_t names;         // 名称区的偏移
+    uint64_t file_size;     // 写入时的文件大小，打开时校验（截断的文件直接拒绝）
+    uint32_t header_crc;    // CRC32（IEEE），见上
+    uint32_t model_version; // 模型自己的版本号，由使用方解释
+    char reserved[16];
+};
+
+struct ModelTensorEntry {
+    uint32_t name;          // 名称在名称区中的偏移
+    uint16_t name_len;
+    uint8_t dtype;          // ModelDType
+    uint8_t rank;           // 维数，不超过 kModelMaxRank
+    uint32_t dims[kModelMaxRank];  // 未用的维为 1
+    uint64_t offset;        // 数据的偏移，kModelTensorAlign 对齐
+    uint64_t bytes;         // = 元素数 × 元素字节数
+    uint32_t data_crc;      // 数据的 CRC32
+    uint32_t reserved;
+};
+
+static_assert(sizeof(ModelFileHeader) == 64, "model file header layout");
+static_assert(sizeof(ModelTensorEntry) == 48, "model tensor entry layout");
+
+// 模型中的一个张量：指向映射内存的视图，模型文件打开期间有效
+struct ModelTensor {
+    std::string_view name;
+    ModelDType dtype = ModelDType::F32;
+    int rank = 0;
+    uint32_t dims[kModelMaxRank] = {1, 1, 1, 1};
+    const void* data = nullptr;
+    size_t bytes = 0;
+
+    size_t Elements() const { return ModelDTypeSize(dtype) == 0 ? 0 : bytes / ModelDTypeSize(dtype); }
+    // 按元素类型取数据，调用方须先确认 dtype
+    template <typename T>
+    const T* As() const {
+        return static_cast<const T*>(data);
+    }
+};
+
+// 降噪、唤醒词、回声消除等阶段的模型权重：整个文件只读映射，按名称索引张量，读取时不解析、不拷贝。
+// 打开时只校验文件头、张量表和名称区（header_crc 与边界），权重本身不读，第一次使用时才缺页读入；
+// 占用的是页缓存而不是堆，多个进程映射同一个文件时共享同一份物理页，内存紧张时内核可以直接丢弃干净页。
+// 打包见 ModelFileWriter 和 bench/ 中的 linx_modelpack 工具
+class ModelFile {
+public:
+    static constexpr size_t kNotFound = static_cast<size_t>(-1);
+
+    ModelFile() = default;
+
+    ModelFile(const ModelFile&) = delete;
+    ModelFile& operator=(const ModelFile&) = delete;
+
+    // 映射并校验文件头和索引，失败时返回 false 并写入 error
+    bool Open(const std::string& path, std::string* error = nullptr);
+    void Close();
+    bool IsOpen() const { return header_ != nullptr; }
+
+    size_t Count() const { return header_ != nullptr ? header_->count : 0; }
+    uint32_t ModelVersion() const { return header_ != nullptr ? header_->model_version : 0; }
+    // 按名称查找（二分查找），返回张量编号，没有时返回 kNotFound
+    size_t Find(std::string_view name) const;
+    // 张量编号须小于 Count()；只构造视图，不触碰数据页
+    ModelTensor Tensor(size_t index) const;
+    // 按名称取张量并检查类型和元素数（expected_elements 为 0 时不检查），不符或不存在时返回 false 并写入 error
+    bool Lookup(std::string_view name, ModelDType dtype, size_t expected_elements, ModelTensor* out,
+                std::string* error = nullptr) const;
+
+    // 张量所在页预读进页缓存（MADV_WILLNEED，异步）：阶段启用时调用，第一帧推理不因缺页拖过周期
+    void Prefetch(size_t index) const;
+    void PrefetchAll() const;
+    // 校验张量数据的 CRC32：读遍该张量的所有页（同步 I/O），只在后台线程、OTA 之后或排查时调用
+    bool Verify(size_t index, std::string* error = nullptr) const;
+    bool VerifyAll(std::string* error = nullptr) const;
+
+    // 张量数据总字节数与当前驻留在内存中的字节数（mincore），后者说明按需缺页实际读入了多少
+    size_t DataBytes() const;
+    size_t ResidentBytes() const;
+    const std::string& Path() const { return path_; }
+
+private:
+    std::string_view Name(const ModelTensorEntry& entry) const;
+
+    MappedFile file_;
+    std::string path_;
+    const ModelFileHeader* header_ = nullptr;
+    const ModelTensorEntry* entries_ = nullptr;
+};
+
+// 模型文件写入：攒齐全部张量后一次写出（写临时文件再 rename）
+class ModelFileWriter {
+public:
+    // 登记一个张量，data 拷贝一份；同名时替换。名称为空、维数超过 kModelMaxRank、
+    // 类型无效或 bytes 与维度不符时返回 false
+    bool Add(const std::string& name, ModelDType dtype, const std::vector<uint32_t>& dims, const void* data,
+             size_t bytes);
+    void SetModelVersion(uint32_t version) { model_version_ = version; }
+    bool Write(const std::string& path, std::string* error = nullptr) const;
+    size_t Count() const { return tensors_.size(); }
+
+private:
+    struct Pending {
+        std::string name;
+        ModelDType dtype = ModelDType::F32;
+        std::vector<uint32_t> dims;
+        std::string data;
+    };
+    std::vector<Pending> tensors_;
+    uint32_t model_version_ = 0;
+};
+
+// CRC32（IEEE 802.3，与 zlib 的 crc32 相同）；crc 为前一段的结果，可分段计算
+uint32_t Crc32(const void* data, size_t len, uint32_t crc = 0);
+
+}  // namespace linx
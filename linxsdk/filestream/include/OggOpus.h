@@ -0,0 +1,125 @@
+#pragma once
+
+#include <stdio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "FileStream.h"
+
+namespace linx {
+
+// 按 TOC 字节计算一个 Opus 包的时长（48kHz 样本数，与采样率无关），包无效时返回 0
+uint32_t opusPacketSamples48k(const void* data, size_t len);
+
+// Ogg 页校验和（多项式 0x04c11db7，不反转，初值 0）
+uint32_t oggCrc(const void* data, size_t len, uint32_t crc = 0);
+
+// OpusHead 中的流参数
+struct OggOpusInfo {
+    int channels = 1;
+    unsigned int preSkip = 0;              // 解码端开头丢弃的 48kHz 样本数（编码器前瞻）
+    unsigned int inputSampleRate = 16000;  // 编码前的原始采样率（仅供参考，解码端可选任意采样率）
+    int outputGain = 0;                    // Q7.8 dB
+    std::string vendor;
+};
+
+// Ogg/Opus（RFC 7845）写入：直接封装已编码的 Opus 包，不重新编码。
+// 包先攒进内存中的页，页满（255 个分段）或页时长达到 pageDuration 时才整页写出，
+// 每秒只有一两次 fwrite，码率 16~32kbps 时写盘量约为 16-bit PCM 的 1/10~1/16
+class OggOpusWriter {
+public:
+    OggOpusWriter() = default;
+    ~OggOpusWriter();
+    OggOpusWriter(const OggOpusWriter&) = delete;
+    OggOpusWriter& operator=(const OggOpusWriter&) = delete;
+
+    // 创建文件并写出 OpusHead/OpusTags 头页；pageDurationMs 为每页最多容纳的音频时长
+    int open(const std::string& filePath, const OggOpusInfo& info, unsigned int pageDurationMs = 1000);
+    // 追加一个包，时长由 TOC 计算；包无效或超过单页容量时返回 false
+    bool writePacket(const void* data, size_t len);
+    // 写出剩余的包并以 EOS 页结束
+    void close();
+    // 之后打开的文件经 AsyncFileWriter 写出（io_uring 或 I/O 线程池），须在 open 之前调用
+    void setAsync(const AsyncFileWriterConfig& config);
+    // 异步写时提交已写出的页（不等待完成）
+    void flush();
+    const AsyncFileWriter* asyncWriter() const { return async_.get(); }
+    bool valid() const { return fp_ != nullptr || (async_ && async_->IsOpen()); }
+    bool failed() const { return failed_; }  // 写文件失败，之后的包都被拒绝
+
+    uint64_t granule() const { return granule_; }        // 已写入的 48kHz 样本数（含 preSkip）
+    uint64_t bytesWritten() const { return bytes_; }     // 已写出的文件字节数
+    uint64_t packets() const { return packets_; }
+
+private:
+    // 把当前页（可能为空）写出，eos 时设置结束标志
+    bool flushPage(bool eos);
+    bool writePage(uint8_t flags, uint64_t granule, const std::vector<uint8_t>& lacing, const void* body,
+                   size_t bodyLen);
+
+    FILE* fp_ = nullptr;
+    std::unique_ptr<AsyncFileWriter> async_;
+    uint32_t serial_ = 0;
+    uint32_t pageSeq_ = 0;
+    uint64_t granule_ = 0;
+    uint32_t pageSamples_ = 0;     // 当前页已攒的时长
+    uint32_t maxPageSamples_ = 48000;
+    std::vector<uint8_t> lacing_;  // 当前页的分段表
+    std::vector<char> body_;       // 当前页的数据
+    std::vector<char> page_;       // 写出时拼接页头的缓冲区，复用
+    uint64_t bytes_ = 0;
+    uint64_t packets_ = 0;
+    bool failed_ = false;
+};
+
+// Ogg/Opus 读取：基于 MappedFile 逐页解析（校验 CRC，跨页的包自动拼接），按顺序取出 Opus 包，
+// 供离线回放解码。只读取第一个逻辑流；CRC 错误的页跳过并重新同步到下一个 "OggS"
+class OggOpusReader {
+public:
+    OggOpusReader() = default;
+
+    // 打开文件并解析 OpusHead/OpusTags；不是 Ogg/Opus 时返回 -1
+    int open(const std::string& filePath);
+    void close();
+    bool valid() const { return file_.valid(); }
+    const OggOpusInfo& info() const { return info_; }
+
+    // 取出下一个音频包，读完返回 false；包跨页时拷贝进内部缓冲区，否则直接指向映射内存，
+    // 视图在下一次读取前有效
+    bool readPacket(std::string_view* packet);
+    void rewind();
+
+    uint64_t position() const { return position_; }    // 已读出的包的总时长（48kHz 样本数）
+    uint64_t corruptPages() const { return corrupt_; }  // 校验失败而跳过的页数
+
+private:
+    // 读取下一个原始包（含头包）
+    bool nextRawPacket(std::string_view* packet);
+    // 定位并校验下一页，成功时设置 seg_/segCount_/body_
+    bool nextPage();
+    // 从头解析 OpusHead/OpusTags，读取位置停在第一个音频包
+    bool readHeaders();
+
+    MappedFile file_;
+    OggOpusInfo info_;
+    size_t offset_ = 0;         // 下一页在文件中的位置
+    bool haveSerial_ = false;
+    uint32_t serial_ = 0;
+    const uint8_t* seg_ = nullptr;
+    size_t segCount_ = 0;
+    size_t segIndex_ = 0;
+    const char* body_ = nullptr;
+    size_t bodyPos_ = 0;
+    bool skipContinued_ = false;  // 丢弃页首接续的包（前一页损坏或缺失）
+    std::string partial_;         // 跨页的包
+    bool inPartial_ = false;
+    uint64_t position_ = 0;
+    uint64_t corrupt_ = 0;
+};
+
+}  // namespace linx
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FileStream.h"
+#include "LockProfiler.h"
+#include "MemoryAccounting.h"
+#include "OggOpus.h"
+
+namespace linx {
+
+// 会话录音的音频流
+enum class RecordStream : uint8_t {
+    Mic = 0,      // 采集路径（回声消除之后、门控之前，即服务器可能听到的声音）
+    Playout = 1,  // 播放路径写入设备的数据（含补的静音，与采集在同一时间轴上）
+};
+
+// 录音文件格式
+enum class RecordFormat : uint8_t {
+    Wav = 0,      // 16-bit PCM WAV，由 Push 写入
+    OggOpus = 1,  // Ogg/Opus，由 PushPacket 写入已编码的包（不重新编码），写盘量约为 WAV 的 1/10
+};
+
+struct SessionRecorderConfig {
+    std::string directory = ".";                      // 录音目录（需已存在）
+    RecordFormat format = RecordFormat::Wav;
+    unsigned int sample_rate = 16000;                 // 写入 WAV 头（或 OpusHead）的实际采样率
+    int channels = 1;                                 // 写入 WAV 头（或 OpusHead）的实际声道数
+    std::chrono::milliseconds buffer_duration{2000};  // 每个缓冲区的容量，写盘线程落后超过该时长时丢帧
+                                                      // （OggOpus 按 128kbps 估算字节数）
+    std::chrono::milliseconds flush_interval{500};    // 写盘线程至少每隔这么久写一次
+    size_t max_file_bytes = 64u << 20;                // 单个文件的数据上限，超过后换下一个分段
+    std::chrono::seconds max_file_duration{0};        // 单个文件的时长上限（按样本数计），0 表示不限
+    bool async_io = false;                            // 经 AsyncFileWriter 写盘（io_uring 或 I/O 线程池），
+                                                      // 闪存回写慢时写盘线程也不阻塞在 fwrite 里
+    AsyncFileWriterConfig io;                         // async_io 时的后端、缓冲区和 O_DIRECT 设置
+};
+
+struct SessionRecorderStats {
+    uint64_t samples_recorded = 0;  // 写入文件的样本数（所有流；OggOpus 为解码后的样本数）
+    uint64_t samples_dropped = 0;   // 缓冲区已满而丢弃的样本数
+    uint64_t packets_recorded = 0;  // OggOpus：写入文件的包数
+    uint64_t packets_dropped = 0;   // OggOpus：缓冲区已满或无效而丢弃的包数
+    uint64_t bytes_written = 0;     // 写入文件的音频数据字节数（OggOpus 含页头）
+    uint64_t files_written = 0;     // 已关闭（头部已补全）的文件数
+    uint64_t write_errors = 0;      // 打开或写入文件失败的次数
+    uint64_t io_stalls = 0;         // async_io：全部写缓冲区都在途、写盘线程等待写完成的次数
+};
+
+// 异步会话录音：音频线程只把帧拷贝进内存缓冲区，文件的创建、写入、补全 WAV 头都在后台写盘线程上进行。
+// 每路流有两块预分配的缓冲区（双缓冲）：音频线程追加到前台缓冲区，写盘线程在锁内交换前后台后，
+// 在锁外把后台缓冲区写进文件，音频线程只在交换的瞬间与写盘线程争锁，稳态不分配内存、不做文件 I/O。
+// 每个会话每路流写成独立的文件：<directory>/<session>-mic-000.wav、<session>-playout-000.wav
+// （OggOpus 为 .opus），超过 max_file_bytes 或 max_file_duration 时换下一个分段。没有会话时不录音
+class SessionRecorder {
+public:
+    explicit SessionRecorder(const SessionRecorderConfig& config);
+    ~SessionRecorder();
+
+    SessionRecorder(const SessionRecorder&) = delete;
+    SessionRecorder& operator=(const SessionRecorder&) = delete;
+
+    // 启动/停止写盘线程；Stop 写出缓冲中剩余的数据并补全所有文件的头部
+    void Start();
+    void Stop();
+
+    // 开始新会话（任意线程），之前推入的数据仍写入上一个会话的文件；空字符串表示会话结束
+    void StartSession(const std::string& session_id);
+
+    // 音频线程调用：pcm 为交错样本，nullptr 表示 samples 个静音样本。缓冲区已满时丢弃并返回 false。
+    // 仅 Wav 格式，OggOpus 格式下忽略
+    bool Push(RecordStream stream, const short* pcm, size_t samples);
+    // 推入一个已编码的 Opus 包（上行编码输出或下行收到的包）。仅 OggOpus 格式，Wav 格式下忽略
+    bool PushPacket(RecordStream stream, const unsigned char* data, size_t len);
+
+    SessionRecorderStats GetStats() const;
+
+private:
+    static constexpr size_t kStreams = 2;
+
+    using PcmBuffer = std::vector<short, TaggedAllocator<short, MemoryTag::Recording>>;
+    using PacketBuffer = std::vector<unsigned char, TaggedAllocator<unsigned char, MemoryTag::Recording>>;
+
+    struct StreamState {
+        ProfiledMutex mutex{"recorder_stream"};
+        PcmBuffer front;                     // 音频线程追加（持 mutex）
+        PacketBuffer packets;                // OggOpus：[2 字节长度][包] 依次排列（持 mutex）
+        uint64_t pushed = 0;                 // 累计进入缓冲区的样本数（OggOpus 为包数，持 mutex）
+        // 以下仅写盘线程
+        PcmBuffer back;
+        PacketBuffer packets_back;
+        size_t back_pos = 0;       // back（或 packets_back 的字节）中已写出的位置
+        uint64_t drained = 0;      // 累计从缓冲区取出的样本数（OggOpus 为包数）
+        FileStream file;
+        OggOpusWriter ogg;
+        bool open = false;
+        size_t bytes = 0;
+        int part = 0;
+    };
+
+    void Run();
+    // 把缓冲的数据写出到当前会话的文件，直到累计取出 until 个样本或包（会话边界）
+    void Drain(size_t index, uint64_t until);
+    void DrainPackets(size_t index, uint64_t until);
+    void Write(size_t index, const short* data, size_t samples);
+    void WritePacket(size_t index, const unsigned char* data, size_t len);
+    void OpenFile(size_t index);
+    void CloseFile(size_t index);
+    std::string FilePath(size_t index) const;
+    void FlushFiles();
+
+    SessionRecorderConfig config_;
+    size_t capacity_ = 0;      // 每块缓冲区的样本数（OggOpus 为字节数）
+    size_t max_samples_ = 0;   // 按时长轮转的样本数（OggOpus 为 48kHz 样本数），0 表示不限
+    StreamState streams_[kStreams];
+
+    ProfiledMutex control_mutex_{"recorder_control"};
+    ProfiledConditionVariable cv_{"recorder_control"};
+    bool stop_ = false;
+    bool session_pending_ = false;
+    std::string pending_session_;
+    uint64_t pending_boundary_[kStreams] = {};  // StartSession 时各流已推入的样本数
+    std::string session_;  // 仅写盘线程
+    std::atomic<bool> flush_wanted_{false};
+    std::thread thread_;
+
+    std::atomic<uint64_t> samples_recorded_{0};
+    std::atomic<uint64_t> samples_dropped_{0};
+    std::atomic<uint64_t> packets_recorded_{0};
+    std::atomic<uint64_t> packets_dropped_{0};
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<uint64_t> files_written_{0};
+    std::atomic<uint64_t> write_errors_{0};
+    std::atomic<uint64_t> io_stalls_{0};
+};
+
+}  // namespace linx
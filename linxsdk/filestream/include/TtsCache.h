@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "LockProfiler.h"
+
+namespace linx {
+
+struct TtsCacheConfig {
+    std::string dir;                          // 磁盘缓存目录，为空时只缓存在内存中
+    size_t memory_budget_bytes = 256 * 1024;  // 内存中常驻的条目总字节数上限
+    size_t disk_budget_bytes = 4 * 1024 * 1024;  // 磁盘上的条目总字节数上限，超出时删除最久未用的文件
+    size_t max_entry_bytes = 32 * 1024;       // 单条（一句）的 Opus 字节数上限，更长的句子不缓存
+    size_t max_text_bytes = 256;              // 句子文本超过该长度时不缓存（长句很少重复）
+};
+
+struct TtsCacheStats {
+    uint64_t hits = 0;         // 命中（含从磁盘读回的）
+    uint64_t disk_hits = 0;    // 内存中已淘汰、从磁盘读回的命中
+    uint64_t misses = 0;
+    uint64_t stores = 0;       // 录制完成写入的条目
+    uint64_t rejected = 0;     // 过长而放弃录制的句子
+    uint64_t evictions = 0;    // 因超出磁盘预算删除的条目（只在内存中时为内存淘汰）
+    size_t memory_bytes = 0;   // 当前内存中的条目字节数
+    size_t disk_bytes = 0;     // 当前磁盘上的条目字节数
+    size_t entries = 0;        // 当前条目数（内存或磁盘）
+};
+
+// 缓存的一句 TTS：按到达顺序排列的 Opus 包
+struct TtsCacheEntry {
+    std::vector<unsigned char> data;  // 全部包首尾相接
+    std::vector<uint32_t> ends;       // 每个包在 data 中的结束位置
+
+    size_t Packets() const { return ends.size(); }
+    const unsigned char* Packet(size_t index, size_t* len) const {
+        size_t begin = index == 0 ? 0 : ends[index - 1];
+        *len = ends[index] - begin;
+        return data.data() + begin;
+    }
+    size_t Bytes() const { return data.size() + ends.size() * sizeof(uint32_t); }
+};
+
+// 合成语音缓存：按句子内容（文本 + 音色/格式）寻址，保存服务器下发的 Opus 包，“好的”“请再说一遍”
+// 一类重复的短句再次出现时直接从本地播放，不等服务器的音频。
+// 内存和磁盘各有一个 LRU 预算：内存中淘汰的条目仍可从磁盘读回，磁盘超出预算时删除最久未用的文件；
+// 重启后按文件修改时间恢复使用顺序（命中时更新修改时间）。文件写临时文件再 rename，不做 fsync，
+// 掉电丢失的条目只是少一次命中；文件头带魔数和长度，损坏的文件读取时删除。
+// 录制一次只进行一句：BeginRecord 开始，Append 逐包追加，Commit 在句子完整结束时写入；
+// 句子被打断、跳过或超出长度时 AbortRecord 丢弃。全部方法线程安全
+class TtsCache {
+public:
+    explicit TtsCache(const TtsCacheConfig& config);
+    ~TtsCache();
+
+    TtsCache(const TtsCache&) = delete;
+    TtsCache& operator=(const TtsCache&) = delete;
+
+    // 句子的缓存键：text 为句子文本，variant 区分同一文本的不同合成结果（音色、采样率、服务器给出的音频标识等）
+    static uint64_t MakeKey(std::string_view text, std::string_view variant);
+    // 文本是否适合缓存（非空且不超过 max_text_bytes）
+    bool Cacheable(std::string_view text) const;
+
+    // 查找并更新使用顺序，未命中返回空；内存中已淘汰时从磁盘读回（调用线程上读文件）
+    std::shared_ptr<const TtsCacheEntry> Find(uint64_t key);
+
+    // 开始录制 key 对应的一句，替换未提交的录制；key 已缓存时不录制
+    void BeginRecord(uint64_t key);
+    // 追加一个包；没有在录制或超出 max_entry_bytes 时忽略（超出时放弃这一句）
+    void Append(const unsigned char* data, size_t len);
+    // 这一句已完整结束：写入内存和磁盘（调用线程上写文件），没有包时丢弃
+    bool Commit();
+    void AbortRecord();
+    bool Recording() const;
+
+    // 删除全部条目（内存与磁盘）
+    void Clear();
+
+    TtsCacheStats GetStats() const;
+    const TtsCacheConfig& Config() const { return config_; }
+
+private:
+    struct Node {
+        std::shared_ptr<const TtsCacheEntry> entry;  // 内存中已淘汰时为空
+        size_t disk_bytes = 0;                       // 磁盘文件大小，没有文件时为 0
+        std::list<uint64_t>::iterator lru;
+    };
+
+    void LoadIndex();
+    std::string PathFor(uint64_t key) const;
+    std::shared_ptr<TtsCacheEntry> ReadFile(uint64_t key) const;
+    size_t WriteFile(uint64_t key, const TtsCacheEntry& entry) const;
+    void AddMemory(int64_t delta);  // 内存中的条目字节数变化，同时计入 Recording 记账
+    void Touch(Node& node, uint64_t key);
+    void EnforceBudgets(uint64_t keep);
+    void Erase(std::unordered_map<uint64_t, Node>::iterator it);
+
+    TtsCacheConfig config_;
+    mutable ProfiledMutex mutex_{"tts_cache"};
+    std::unordered_map<uint64_t, Node> nodes_;
+    std::list<uint64_t> lru_;  // 最近使用的在前
+    size_t memory_bytes_ = 0;
+    size_t disk_bytes_ = 0;
+
+    bool recording_ = false;
+    uint64_t record_key_ = 0;
+    std::shared_ptr<TtsCacheEntry> record_;
+
+    TtsCacheStats stats_;
+};
+
+}  // namespace linx
@@ -0,0 +1,224 @@
+#include "AssetPack.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "Opus.h"
+
+namespace linx {
+
+namespace {
+
+constexpr size_t kAlign = 8;
+
+size_t AlignUp(size_t value) {
+    return (value + kAlign - 1) / kAlign * kAlign;
+}
+
+bool Fail(std::string* error, const std::string& message) {
+    if (error != nullptr) {
+        *error = message;
+    }
+    return false;
+}
+
+}  // namespace
+
+bool AssetPack::Open(const std::string& path, std::string* error) {
+    Close();
+    if (file_.open(path) != 0) {
+        return Fail(error, "cannot open " + path);
+    }
+    const char* base = file_.data();
+    size_t size = file_.size();
+    auto invalid = [&](const char* what) {
+        file_.close();
+        return Fail(error, path + ": " + what);
+    };
+    if (size < sizeof(AssetPackHeader)) {
+        return invalid("too small for an asset pack");
+    }
+    const auto* header = reinterpret_cast<const AssetPackHeader*>(base);
+    if (memcmp(header->magic, kAssetPackMagic, sizeof(header->magic)) != 0) {
+        return invalid("not an asset pack");
+    }
+    if (header->version != kAssetPackVersion) {
+        return invalid("unsupported asset pack version");
+    }
+    if (header->file_size != size) {
+        return invalid("truncated or modified asset pack");
+    }
+    if (header->entries % kAlign != 0 || header->entries > size ||
+        header->count > (size - header->entries) / sizeof(AssetPackEntry) || header->names > size) {
+        return invalid("index out of bounds");
+    }
+    // 只校验索引：名称和包表在文件范围内、按名称排序；包数据本身不读，播放时才缺页
+    const auto* entries = reinterpret_cast<const AssetPackEntry*>(base + header->entries);
+    for (uint32_t i = 0; i < header->count; ++i) {
+        const AssetPackEntry& entry = entries[i];
+        uint64_t table_bytes = static_cast<uint64_t>(entry.packets) * sizeof(uint32_t);
+        if (entry.packets == 0 || entry.channels < 1 || entry.channels > 2 || entry.offset % kAlign != 0 ||
+            header->names + entry.name + entry.name_len > size || entry.offset > size ||
+            table_bytes > size - entry.offset || entry.data_bytes > size - entry.offset - table_bytes) {
+            return invalid("clip out of bounds");
+        }
+        if (i > 0) {
+            std::string_view prev(base + header->names + entries[i - 1].name, entries[i - 1].name_len);
+            std::string_view name(base + header->names + entry.name, entry.name_len);
+            if (!(prev < name)) {
+                return invalid("index is not sorted");
+            }
+        }
+    }
+    path_ = path;
+    header_ = header;
+    entries_ = entries;
+    return true;
+}
+
+void AssetPack::Close() {
+    file_.close();
+    header_ = nullptr;
+    entries_ = nullptr;
+}
+
+std::string_view AssetPack::Name(const AssetPackEntry& entry) const {
+    return std::string_view(file_.data() + header_->names + entry.name, entry.name_len);
+}
+
+size_t AssetPack::Find(std::string_view name) const {
+    if (header_ == nullptr) {
+        return kNotFound;
+    }
+    const AssetPackEntry* end = entries_ + header_->count;
+    const AssetPackEntry* it = std::lower_bound(
+        entries_, end, name, [this](const AssetPackEntry& entry, std::string_view key) { return Name(entry) < key; });
+    if (it == end || Name(*it) != name) {
+        return kNotFound;
+    }
+    return static_cast<size_t>(it - entries_);
+}
+
+AssetClip AssetPack::Clip(size_t index) const {
+    const AssetPackEntry& entry = entries_[index];
+    const char* base = file_.data();
+    AssetClip clip;
+    clip.name = Name(entry);
+    clip.channels = entry.channels;
+    clip.input_rate = entry.input_rate;
+    clip.pre_skip = entry.pre_skip;
+    clip.duration_ms = entry.duration_ms;
+    clip.packets = entry.packets;
+    clip.ends = reinterpret_cast<const uint32_t*>(base + entry.offset);
+    clip.data = reinterpret_cast<const unsigned char*>(base + entry.offset + entry.packets * sizeof(uint32_t));
+    clip.data_bytes = static_cast<size_t>(entry.data_bytes);
+    return clip;
+}
+
+void AssetPack::Prefetch() const {
+    if (header_ != nullptr) {
+        madvise(const_cast<char*>(file_.data()), file_.size(), MADV_WILLNEED);
+    }
+}
+
+bool AssetPackWriter::Add(const std::string& name, int channels, unsigned int input_rate, unsigned int pre_skip,
+                          const std::vector<std::string>& packets) {
+    if (name.empty() || name.size() > 0xffff || packets.empty() || channels < 1 || channels > 2) {
+        return false;
+    }
+    Pending clip;
+    clip.name = name;
+    clip.channels = channels;
+    clip.input_rate = input_rate;
+    clip.pre_skip = pre_skip;
+    uint64_t samples = 0;  // 48kHz
+    for (const std::string& packet : packets) {
+        int n = opus_packet_get_nb_samples(reinterpret_cast<const unsigned char*>(packet.data()),
+                                           static_cast<opus_int32>(packet.size()), 48000);
+        if (packet.empty() || n <= 0) {
+            return false;
+        }
+        samples += static_cast<uint64_t>(n);
+        clip.data += packet;
+        clip.ends.push_back(static_cast<uint32_t>(clip.data.size()));
+    }
+    clip.duration_ms = static_cast<unsigned int>(samples / 48);
+    auto it = std::find_if(clips_.begin(), clips_.end(), [&](const Pending& p) { return p.name == name; });
+    if (it != clips_.end()) {
+        *it = std::move(clip);
+    } else {
+        clips_.push_back(std::move(clip));
+    }
+    return true;
+}
+
+bool AssetPackWriter::Write(const std::string& path, std::string* error) const {
+    std::vector<const Pending*> sorted;
+    for (const Pending& clip : clips_) {
+        sorted.push_back(&clip);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Pending* a, const Pending* b) { return a->name < b->name; });
+
+    // 先排好布局，再整块写出
+    AssetPackHeader header = {};
+    memcpy(header.magic, kAssetPackMagic, sizeof(header.magic));
+    header.version = kAssetPackVersion;
+    header.count = static_cast<uint32_t>(sorted.size());
+    header.entries = sizeof(AssetPackHeader);
+    header.names = header.entries + sorted.size() * sizeof(AssetPackEntry);
+    std::vector<AssetPackEntry> entries(sorted.size());
+    std::string names;
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        entries[i] = {};
+        entries[i].name = static_cast<uint32_t>(names.size());
+        entries[i].name_len = static_cast<uint16_t>(sorted[i]->name.size());
+        names += sorted[i]->name;
+    }
+    size_t offset = AlignUp(header.names + names.size());
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        const Pending& clip = *sorted[i];
+        AssetPackEntry& entry = entries[i];
+        entry.channels = static_cast<uint16_t>(clip.channels);
+        entry.input_rate = clip.input_rate;
+        entry.pre_skip = clip.pre_skip;
+        entry.packets = static_cast<uint32_t>(clip.ends.size());
+        entry.duration_ms = clip.duration_ms;
+        entry.offset = offset;
+        entry.data_bytes = clip.data.size();
+        offset = AlignUp(offset + clip.ends.size() * sizeof(uint32_t) + clip.data.size());
+    }
+    header.file_size = offset;
+
+    std::string image(offset, '\0');
+    memcpy(&image[0], &header, sizeof(header));
+    if (!entries.empty()) {
+        memcpy(&image[header.entries], entries.data(), entries.size() * sizeof(AssetPackEntry));
+    }
+    memcpy(&image[header.names], names.data(), names.size());
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        const Pending& clip = *sorted[i];
+        size_t table = entries[i].offset;
+        memcpy(&image[table], clip.ends.data(), clip.ends.size() * sizeof(uint32_t));
+        memcpy(&image[table + clip.ends.size() * sizeof(uint32_t)], clip.data.data(), clip.data.size());
+    }
+
+    std::string tmp = path + ".tmp";
+    FILE* file = fopen(tmp.c_str(), "wb");
+    if (file == nullptr) {
+        return Fail(error, "open " + tmp + " failed: " + strerror(errno));
+    }
+    bool ok = fwrite(image.data(), 1, image.size(), file) == image.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return Fail(error, "write " + path + " failed: " + strerror(errno));
+    }
+    return true;
+}
+
+}  // namespace linx
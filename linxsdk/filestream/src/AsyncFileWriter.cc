@@ -0,0 +1,623 @@
+#include "AsyncFileWriter.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <thread>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define LINX_HAVE_IO_URING 1
+#endif
+
+#include "Log.h"
+#include "MemoryAccounting.h"
+
+namespace linx {
+
+namespace {
+
+constexpr size_t kDirectAlign = 4096;
+
+size_t AlignUp(size_t value, size_t align) {
+    return (value + align - 1) / align * align;
+}
+
+bool PwriteAll(int fd, const char* data, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, data, len, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+// 线程池后端：进程内所有写盘共用的少量 I/O 线程，第一次使用时启动，进程退出时等已投递的写完成
+class IoPool {
+public:
+    static IoPool& Instance() {
+        static IoPool pool;
+        return pool;
+    }
+
+    void Post(std::function<void()> task) {
+        {
+            std::lock_guard<ProfiledMutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+private:
+    static constexpr int kThreads = 2;  // 闪存上并发写收益有限，两个线程足以让一个文件的慢写不挡住另一个
+
+    IoPool() {
+        for (int i = 0; i < kThreads; ++i) {
+            threads_.emplace_back([this]() { Run(); });
+        }
+    }
+
+    ~IoPool() {
+        {
+            std::lock_guard<ProfiledMutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (std::thread& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    void Run() {
+        std::unique_lock<ProfiledMutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            std::function<void()> task = std::move(tasks_.front());
+            tasks_.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+    ProfiledMutex mutex_{"io_pool"};
+    ProfiledConditionVariable cv_{"io_pool"};
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::thread> threads_;
+    bool stop_ = false;
+};
+
+}  // namespace
+
+const char* AsyncIoBackendName(AsyncIoBackend backend) {
+    switch (backend) {
+        case AsyncIoBackend::Auto:
+            return "auto";
+        case AsyncIoBackend::IoUring:
+            return "io_uring";
+        case AsyncIoBackend::Threads:
+            return "threads";
+    }
+    return "unknown";
+}
+
+#ifdef LINX_HAVE_IO_URING
+
+// 直接用系统调用驱动 io_uring（不依赖 liburing）：一个写者独占一个环，只有写者线程访问，
+// 提交队列和完成队列各自只有一个生产者和一个消费者，按内核约定的 acquire/release 顺序读写头尾指针
+class AsyncFileWriter::Ring {
+public:
+    static std::unique_ptr<Ring> Create(unsigned entries) {
+        std::unique_ptr<Ring> ring(new Ring());
+        if (!ring->Setup(entries)) {
+            return nullptr;
+        }
+        return ring;
+    }
+
+    ~Ring() {
+        if (sqes_ != nullptr) {
+            munmap(sqes_, sqes_size_);
+        }
+        if (cq_map_ != nullptr && cq_map_ != sq_map_) {
+            munmap(cq_map_, cq_map_size_);
+        }
+        if (sq_map_ != nullptr) {
+            munmap(sq_map_, sq_map_size_);
+        }
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    // 注册固定缓冲区，之后的写请求用 WRITE_FIXED，内核不再逐次锁定用户页；失败时（如 RLIMIT_MEMLOCK 太小）退回普通 WRITE
+    void Register(const std::vector<Buffer>& buffers, size_t buffer_bytes) {
+        std::vector<iovec> iov(buffers.size());
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            iov[i].iov_base = buffers[i].data;
+            iov[i].iov_len = buffer_bytes;
+        }
+        fixed_ = syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, iov.data(),
+                         static_cast<unsigned>(iov.size())) == 0;
+        if (!fixed_) {
+            WARN("io_uring: registering buffers failed ({}), using unregistered writes", strerror(errno));
+        }
+    }
+
+    // 填一个写请求，不提交；队列满时返回 false
+    bool Push(int fd, size_t index, const Buffer& buffer) {
+        unsigned tail = *sq_tail_;
+        unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (tail - head >= sq_entries_) {
+            return false;
+        }
+        unsigned slot = tail & *sq_mask_;
+        io_uring_sqe* sqe = &sqes_[slot];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = fixed_ ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(buffer.data);
+        sqe->len = static_cast<uint32_t>(buffer.len);
+        sqe->off = buffer.offset;
+        sqe->buf_index = fixed_ ? static_cast<uint16_t>(index) : 0;
+        sqe->user_data = index;
+        sq_array_[slot] = slot;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // 提交 submit 个请求并至少等 wait 个完成
+    bool Enter(unsigned submit, unsigned wait) {
+        while (true) {
+            long ret = syscall(__NR_io_uring_enter, fd_, submit, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0,
+                               nullptr, 0);
+            if (ret >= 0) {
+                return true;
+            }
+            if (errno != EINTR) {
+                return false;
+            }
+        }
+    }
+
+    // 取出已完成的请求，不做系统调用
+    template <typename Fn>
+    size_t Reap(Fn&& fn) {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        size_t count = 0;
+        while (head != tail) {
+            const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+            fn(static_cast<size_t>(cqe.user_data), static_cast<long>(cqe.res));
+            ++head;
+            ++count;
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        return count;
+    }
+
+private:
+    Ring() = default;
+
+    bool Setup(unsigned entries) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd_ < 0) {
+            return false;
+        }
+        sq_map_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_map_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            sq_map_size_ = cq_map_size_ = std::max(sq_map_size_, cq_map_size_);
+        }
+        sq_map_ = Map(sq_map_size_, IORING_OFF_SQ_RING);
+        if (sq_map_ == nullptr) {
+            return false;
+        }
+        cq_map_ = single ? sq_map_ : Map(cq_map_size_, IORING_OFF_CQ_RING);
+        if (cq_map_ == nullptr) {
+            return false;
+        }
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(Map(sqes_size_, IORING_OFF_SQES));
+        if (sqes_ == nullptr) {
+            return false;
+        }
+        char* sq = static_cast<char*>(sq_map_);
+        char* cq = static_cast<char*>(cq_map_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        sq_entries_ = params.sq_entries;
+        return true;
+    }
+
+    void* Map(size_t size, off_t offset) {
+        void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    int fd_ = -1;
+    bool fixed_ = false;
+    void* sq_map_ = nullptr;
+    void* cq_map_ = nullptr;
+    size_t sq_map_size_ = 0;
+    size_t cq_map_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_entries_ = 0;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+#else
+
+// 没有 io_uring 头文件的平台（macOS 等）只有线程池后端
+class AsyncFileWriter::Ring {
+public:
+    static std::unique_ptr<Ring> Create(unsigned) { return nullptr; }
+    void Register(const std::vector<Buffer>&, size_t) {}
+    bool Push(int, size_t, const Buffer&) { return false; }
+    bool Enter(unsigned, unsigned) { return false; }
+    template <typename Fn>
+    size_t Reap(Fn&&) {
+        return 0;
+    }
+};
+
+#endif
+
+AsyncFileWriter::AsyncFileWriter(const AsyncFileWriterConfig& config) : config_(config) {
+    config_.buffers = std::max<size_t>(config_.buffers, 2);
+    config_.buffer_bytes = AlignUp(std::max<size_t>(config_.buffer_bytes, kDirectAlign), kDirectAlign);
+    config_.submit_batch = std::min(std::max<size_t>(config_.submit_batch, 1), config_.buffers);
+    size_t total = config_.buffers * config_.buffer_bytes;
+    memory_ = static_cast<char*>(std::aligned_alloc(kDirectAlign, total));
+    if (memory_ == nullptr) {
+        ERROR("AsyncFileWriter: cannot allocate {} bytes of buffers", total);
+        failed_ = true;
+        return;
+    }
+    AccountMemory(MemoryTag::Recording, static_cast<int64_t>(total));
+    buffers_.resize(config_.buffers);
+    for (size_t i = 0; i < buffers_.size(); ++i) {
+        buffers_[i].data = memory_ + i * config_.buffer_bytes;
+    }
+    if (config_.backend != AsyncIoBackend::Threads) {
+        ring_ = Ring::Create(static_cast<unsigned>(config_.buffers));
+        if (ring_) {
+            ring_->Register(buffers_, config_.buffer_bytes);
+            backend_ = AsyncIoBackend::IoUring;
+        } else if (config_.backend == AsyncIoBackend::IoUring) {
+            ERROR("AsyncFileWriter: io_uring unavailable: {}", strerror(errno));
+            failed_ = true;
+        }
+    }
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+    Close();
+    ring_.reset();
+    if (memory_ != nullptr) {
+        std::free(memory_);
+        AccountMemory(MemoryTag::Recording, -static_cast<int64_t>(config_.buffers * config_.buffer_bytes));
+    }
+}
+
+bool AsyncFileWriter::Open(const std::string& path) {
+    Close();
+    if (memory_ == nullptr || (config_.backend == AsyncIoBackend::IoUring && !ring_)) {
+        return false;
+    }
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    direct_ = false;
+#ifdef O_DIRECT
+    if (config_.direct) {
+        fd_ = open(path.c_str(), flags | O_DIRECT, 0644);
+        direct_ = fd_ >= 0;  // tmpfs 等不支持 O_DIRECT 时返回 EINVAL，按普通文件打开
+    }
+#endif
+    if (fd_ < 0) {
+        fd_ = open(path.c_str(), flags, 0644);
+    }
+    if (fd_ < 0) {
+        ERROR("AsyncFileWriter: open {} failed: {}", path, strerror(errno));
+        return false;
+    }
+    path_ = path;
+    failed_ = false;
+    free_.clear();
+    for (size_t i = buffers_.size(); i > 0; --i) {
+        free_.push_back(i - 1);
+    }
+    queued_.clear();
+    current_ = SIZE_MAX;
+    fill_ = 0;
+    offset_ = 0;
+    inflight_ = 0;
+    return true;
+}
+
+bool AsyncFileWriter::Write(const void* data, size_t len) {
+    if (fd_ < 0 || failed_) {
+        return false;
+    }
+    const char* bytes = static_cast<const char*>(data);
+    while (len > 0) {
+        if (current_ == SIZE_MAX) {
+            if (free_.empty() && !WaitFree()) {
+                return false;
+            }
+            current_ = free_.back();
+            free_.pop_back();
+            fill_ = 0;
+        }
+        size_t n = std::min(len, config_.buffer_bytes - fill_);
+        memcpy(buffers_[current_].data + fill_, bytes, n);
+        fill_ += n;
+        bytes += n;
+        len -= n;
+        if (fill_ == config_.buffer_bytes) {
+            Buffer& buffer = buffers_[current_];
+            buffer.len = fill_;
+            buffer.offset = offset_;
+            offset_ += fill_;
+            fill_ = 0;
+            queued_.push_back(current_);
+            current_ = SIZE_MAX;
+            if (queued_.size() >= config_.submit_batch && !FlushQueued()) {
+                return false;
+            }
+        }
+    }
+    return !failed_;
+}
+
+bool AsyncFileWriter::WaitFree() {
+    Reap(false);
+    if (!free_.empty()) {
+        return true;
+    }
+    if (!queued_.empty() && !FlushQueued()) {
+        return false;
+    }
+    while (free_.empty() && inflight_ > 0) {
+        stalls_.fetch_add(1, std::memory_order_relaxed);  // 写盘跟不上：全部缓冲区都在途
+        if (!Reap(true)) {
+            return false;
+        }
+    }
+    return !free_.empty() && !failed_;
+}
+
+bool AsyncFileWriter::FlushQueued() {
+    if (queued_.empty()) {
+        return true;
+    }
+    size_t submitted = 0;
+    for (size_t index : queued_) {
+        if (!Submit(index)) {
+            break;
+        }
+        ++submitted;
+    }
+    if (ring_ && submitted > 0 && !ring_->Enter(static_cast<unsigned>(submitted), 0)) {
+        ERROR("AsyncFileWriter: io_uring_enter failed: {}", strerror(errno));
+        failed_ = true;
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    submits_.fetch_add(1, std::memory_order_relaxed);
+    inflight_ += submitted;
+    if (inflight_ > max_inflight_.load(std::memory_order_relaxed)) {
+        max_inflight_.store(inflight_, std::memory_order_relaxed);
+    }
+    queued_.erase(queued_.begin(), queued_.begin() + static_cast<std::ptrdiff_t>(submitted));
+    return queued_.empty();
+}
+
+bool AsyncFileWriter::Submit(size_t index) {
+    const Buffer& buffer = buffers_[index];
+    if (ring_) {
+        return ring_->Push(fd_, index, buffer);  // 环的容量等于缓冲区数，不会满
+    }
+    int fd = fd_;
+    IoPool::Instance().Post([this, fd, index, buffer]() {
+        long result = pwrite(fd, buffer.data, buffer.len, static_cast<off_t>(buffer.offset));
+        if (result < 0) {
+            result = -errno;
+        }
+        {
+            std::lock_guard<ProfiledMutex> lock(mutex_);
+            completed_.emplace_back(index, result);
+        }
+        done_cv_.notify_one();
+    });
+    return true;
+}
+
+bool AsyncFileWriter::Reap(bool wait) {
+    if (ring_) {
+        size_t reaped = ring_->Reap([this](size_t index, long result) { Complete(index, result); });
+        if (reaped > 0 || !wait) {
+            return true;
+        }
+        if (!ring_->Enter(0, 1)) {
+            ERROR("AsyncFileWriter: io_uring_enter failed: {}", strerror(errno));
+            failed_ = true;
+            return false;
+        }
+        ring_->Reap([this](size_t index, long result) { Complete(index, result); });
+        return true;
+    }
+    std::vector<std::pair<size_t, long>> completed;
+    {
+        std::unique_lock<ProfiledMutex> lock(mutex_);
+        if (wait) {
+            done_cv_.wait(lock, [this]() { return !completed_.empty(); });
+        }
+        completed.swap(completed_);
+    }
+    for (const auto& entry : completed) {
+        Complete(entry.first, entry.second);
+    }
+    return true;
+}
+
+void AsyncFileWriter::Complete(size_t index, long result) {
+    inflight_--;
+    Buffer& buffer = buffers_[index];
+    size_t written = result > 0 ? static_cast<size_t>(result) : 0;
+    if (result >= 0 && written < buffer.len) {
+        // 短写（磁盘将满等）：余下部分同步补写
+        if (PwriteAll(fd_, buffer.data + written, buffer.len - written, buffer.offset + written)) {
+            written = buffer.len;
+        }
+    }
+    if (written != buffer.len) {
+        if (!failed_) {
+            ERROR("AsyncFileWriter: write to {} failed: {}", path_, strerror(result < 0 ? static_cast<int>(-result) : ENOSPC));
+        }
+        failed_ = true;
+        errors_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        writes_.fetch_add(1, std::memory_order_relaxed);
+        bytes_.fetch_add(buffer.len, std::memory_order_relaxed);
+    }
+    free_.push_back(index);
+}
+
+bool AsyncFileWriter::Flush() {
+    if (fd_ < 0 || failed_) {
+        return false;
+    }
+    // O_DIRECT 的写必须是整块：未写满的缓冲区留到 Close 时写
+    if (current_ != SIZE_MAX && fill_ > 0 && !direct_) {
+        Buffer& buffer = buffers_[current_];
+        buffer.len = fill_;
+        buffer.offset = offset_;
+        offset_ += fill_;
+        fill_ = 0;
+        queued_.push_back(current_);
+        current_ = SIZE_MAX;
+    }
+    FlushQueued();
+    Reap(false);
+    return !failed_;
+}
+
+bool AsyncFileWriter::Drain() {
+    while (!queued_.empty() && !failed_) {
+        if (!FlushQueued()) {
+            break;
+        }
+    }
+    while (inflight_ > 0) {
+        if (!Reap(true)) {
+            break;
+        }
+    }
+    return !failed_;
+}
+
+bool AsyncFileWriter::WriteAt(uint64_t offset, const void* data, size_t len) {
+    if (fd_ < 0) {
+        return false;
+    }
+    Flush();
+    Drain();
+    // 还在内存里的部分（O_DIRECT 下未写满的最后一块）同样改掉，Close 时写出的不会覆盖这次的内容
+    if (current_ != SIZE_MAX && offset < offset_ + fill_ && offset + len > offset_) {
+        uint64_t begin = std::max(offset, offset_);
+        uint64_t end = std::min(offset + len, offset_ + fill_);
+        memcpy(buffers_[current_].data + (begin - offset_), static_cast<const char*>(data) + (begin - offset),
+               end - begin);
+    }
+#ifdef O_DIRECT
+    if (direct_) {
+        fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+        direct_ = false;
+    }
+#endif
+    if (!PwriteAll(fd_, static_cast<const char*>(data), len, offset)) {
+        failed_ = true;
+        errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return !failed_;
+}
+
+bool AsyncFileWriter::Close() {
+    if (fd_ < 0) {
+        return !failed_;
+    }
+    Flush();
+    Drain();
+    if (current_ != SIZE_MAX && fill_ > 0 && !failed_) {
+        // O_DIRECT 末尾不足一块：去掉 O_DIRECT 后普通写出
+#ifdef O_DIRECT
+        fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+#endif
+        if (PwriteAll(fd_, buffers_[current_].data, fill_, offset_)) {
+            writes_.fetch_add(1, std::memory_order_relaxed);
+            bytes_.fetch_add(fill_, std::memory_order_relaxed);
+        } else {
+            failed_ = true;
+            errors_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (current_ != SIZE_MAX) {
+        free_.push_back(current_);
+        current_ = SIZE_MAX;
+    }
+    offset_ += fill_;
+    fill_ = 0;
+    close(fd_);
+    fd_ = -1;
+    direct_ = false;
+    return !failed_;
+}
+
+AsyncFileWriterStats AsyncFileWriter::GetStats() const {
+    AsyncFileWriterStats stats;
+    stats.writes = writes_.load(std::memory_order_relaxed);
+    stats.bytes = bytes_.load(std::memory_order_relaxed);
+    stats.submits = submits_.load(std::memory_order_relaxed);
+    stats.stalls = stalls_.load(std::memory_order_relaxed);
+    stats.errors = errors_.load(std::memory_order_relaxed);
+    stats.max_inflight = max_inflight_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace linx
@@ -0,0 +1,423 @@
+#include "AudioBlackBox.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "Log.h"
+#include "MemoryAccounting.h"
+#include "OggOpus.h"
+#include "SteadyClock.h"
+
+namespace linx {
+
+namespace {
+
+constexpr size_t kHeaderSize = 256;
+constexpr unsigned int kAssumedPacketsPerSecond = 50;  // 估算每包头部开销用的包率（20ms 帧）
+constexpr uint32_t kFillSamples = 960;                 // 空隙补齐用的空帧时长（48kHz 样本数，20ms）
+const char* const kStreamNames[kBlackBoxStreams] = {"uplink", "downlink"};
+
+uint64_t Align8(uint64_t n) { return (n + 7) & ~static_cast<uint64_t>(7); }
+
+uint64_t WallMs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                     std::chrono::system_clock::now().time_since_epoch())
+                                     .count());
+}
+
+// pos 处记录（或回绕标记）占用的字节数
+uint64_t RecordSpan(const unsigned char* ring, uint64_t capacity, uint64_t pos) {
+    uint64_t offset = pos % capacity;
+    uint32_t len;
+    memcpy(&len, ring + offset, sizeof(len));
+    if (len == kBlackBoxWrap) {
+        return capacity - offset;
+    }
+    return Align8(sizeof(BlackBoxRecord) + len);
+}
+
+// 拷贝出的一个包：data 指向 copy 内部
+struct PacketRef {
+    uint64_t time_us;
+    const unsigned char* data;
+    uint32_t len;
+};
+
+/**
+ * @brief 拷贝一路流的环并取出其中完整的包
+ * @description 先取 head/tail 再整体拷贝，拷贝后重新读取 tail：写入端覆盖旧记录前先推进 tail，
+ *              所以新 tail 到 head 之间的记录在拷贝里一定完整，之前的部分丢弃
+ */
+void CopyStream(const BlackBoxStreamHeader& stream, const unsigned char* ring, uint64_t capacity,
+                std::vector<unsigned char>& copy, std::vector<PacketRef>& packets) {
+    packets.clear();
+    uint64_t head = stream.head.load(std::memory_order_acquire);
+    copy.assign(ring, ring + capacity);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t pos = stream.tail.load(std::memory_order_relaxed);
+    while (pos < head) {
+        uint64_t offset = pos % capacity;
+        BlackBoxRecord record;
+        memcpy(&record.len, copy.data() + offset, sizeof(record.len));
+        if (record.len == kBlackBoxWrap) {
+            pos += capacity - offset;
+            continue;
+        }
+        if (offset + sizeof(BlackBoxRecord) + record.len > capacity) {
+            break;  // 文件损坏（如崩溃时的残页）
+        }
+        memcpy(&record, copy.data() + offset, sizeof(record));
+        packets.push_back({record.time_us, copy.data() + offset + sizeof(record), record.len});
+        pos += Align8(sizeof(BlackBoxRecord) + record.len);
+    }
+}
+
+/**
+ * @brief 把映射中的各路流导出为 Ogg/Opus 文件
+ */
+bool DumpMapping(const BlackBoxHeader* header, const unsigned char* base, const std::string& prefix,
+                 BlackBoxDump* result) {
+    std::vector<unsigned char> copies[kBlackBoxStreams];
+    std::vector<PacketRef> packets[kBlackBoxStreams];
+    uint64_t origin_us = UINT64_MAX;
+    for (size_t i = 0; i < kBlackBoxStreams; ++i) {
+        const BlackBoxStreamHeader& stream = header->stream[i];
+        CopyStream(stream, base + stream.offset, header->capacity, copies[i], packets[i]);
+        if (!packets[i].empty()) {
+            origin_us = std::min(origin_us, packets[i].front().time_us);
+        }
+    }
+
+    BlackBoxDump dump;
+    bool ok = true;
+    for (size_t i = 0; i < kBlackBoxStreams; ++i) {
+        if (packets[i].empty()) {
+            continue;
+        }
+        const BlackBoxStreamHeader& stream = header->stream[i];
+        OggOpusInfo info;
+        info.channels = static_cast<int>(stream.channels);
+        info.preSkip = stream.pre_skip;
+        info.inputSampleRate = stream.input_rate;
+        info.vendor = "linx black box";
+        std::string path = prefix + "-" + kStreamNames[i] + ".opus";
+        OggOpusWriter writer;
+        if (writer.open(path, info) != 0) {
+            ERROR("black box: open {} failed", path);
+            ok = false;
+            continue;
+        }
+        // 空帧：CELT 全频带 20ms、单帧、长度为 0（RFC 6716 中的 DTX），解码端按丢包隐藏处理并很快衰减为静音
+        const unsigned char fill = static_cast<unsigned char>((31 << 3) | (stream.channels == 2 ? 0x04 : 0));
+        for (const PacketRef& packet : packets[i]) {
+            uint64_t due = stream.pre_skip + (packet.time_us - origin_us) * 48 / 1000;
+            while (writer.granule() + kFillSamples <= due && writer.writePacket(&fill, 1)) {
+            }
+            writer.writePacket(packet.data, packet.len);  // 无效的包（TOC 无法解析）跳过
+        }
+        writer.close();
+        if (writer.failed()) {
+            ERROR("black box: write {} failed", path);
+            ok = false;
+            continue;
+        }
+        dump.files.push_back(path);
+        dump.packets[i] = packets[i].size();
+        dump.duration_s[i] = (packets[i].back().time_us - packets[i].front().time_us) / 1e6;
+    }
+    if (result) {
+        *result = std::move(dump);
+    }
+    return ok;
+}
+
+}  // namespace
+
+AudioBlackBox::AudioBlackBox(const AudioBlackBoxConfig& config) : config_(config) {}
+
+AudioBlackBox::~AudioBlackBox() {
+    Stop();
+    Close();
+}
+
+bool AudioBlackBox::Open() {
+    if (IsOpen()) {
+        return true;
+    }
+    uint64_t per_second = config_.max_bitrate / 8 + kAssumedPacketsPerSecond * sizeof(BlackBoxRecord);
+    uint64_t capacity = std::max<uint64_t>(static_cast<uint64_t>(config_.duration.count()) * per_second, 64 * 1024);
+    capacity_ = (capacity + 4095) & ~static_cast<uint64_t>(4095);
+    map_size_ = kHeaderSize + kBlackBoxStreams * capacity_;
+    if (!Map()) {
+        return false;
+    }
+    // 预先触碰全部页面，热路径上的第一次写入不再触发缺页；这些页从此常驻，计入 Recording
+    memset(map_, 0, map_size_);
+    AccountMemory(MemoryTag::Recording, static_cast<int64_t>(map_size_));
+
+    header_ = static_cast<BlackBoxHeader*>(map_);
+    base_ = static_cast<unsigned char*>(map_);
+    header_->version = kBlackBoxVersion;
+    header_->streams = kBlackBoxStreams;
+    header_->capacity = capacity_;
+    header_->pid = static_cast<uint64_t>(getpid());
+    header_->start_steady_us = SteadyNowUs();
+    header_->start_system_us = WallMs() * 1000;
+    for (size_t i = 0; i < kBlackBoxStreams; ++i) {
+        BlackBoxStreamHeader& stream = header_->stream[i];
+        stream.offset = kHeaderSize + i * capacity_;
+        stream.channels = static_cast<uint32_t>(config_.stream[i].channels);
+        stream.pre_skip = config_.stream[i].pre_skip;
+        stream.input_rate = config_.stream[i].input_rate;
+    }
+    memcpy(header_->magic, kBlackBoxMagic, sizeof(header_->magic));  // 最后写入：文件头完整后才可识别
+    INFO("black box: {} ({} KB per stream, ~{}s at {}bps)", config_.path.empty() ? "anonymous" : config_.path,
+         capacity_ / 1024, capacity_ / per_second, config_.max_bitrate);
+    return true;
+}
+
+bool AudioBlackBox::Map() {
+    if (config_.path.empty()) {
+        map_ = mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map_ == MAP_FAILED) {
+            ERROR("black box: mmap {} bytes failed: {}", map_size_, strerror(errno));
+            map_ = nullptr;
+            return false;
+        }
+        return true;
+    }
+    fd_ = open(config_.path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        ERROR("black box: open {} failed: {}", config_.path, strerror(errno));
+        return false;
+    }
+    if (ftruncate(fd_, static_cast<off_t>(map_size_)) != 0) {
+        ERROR("black box: resize {} failed: {}", config_.path, strerror(errno));
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    map_ = mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map_ == MAP_FAILED) {
+        ERROR("black box: mmap {} failed: {}", config_.path, strerror(errno));
+        map_ = nullptr;
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    return true;
+}
+
+// 须在所有写入线程停止后调用
+void AudioBlackBox::Close() {
+    if (map_ != nullptr) {
+        if (fd_ >= 0) {
+            msync(map_, map_size_, MS_ASYNC);
+        }
+        munmap(map_, map_size_);
+        AccountMemory(MemoryTag::Recording, -static_cast<int64_t>(map_size_));
+        map_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    header_ = nullptr;
+    base_ = nullptr;
+}
+
+bool AudioBlackBox::Push(BlackBoxStream stream, const void* data, size_t len) {
+    if (header_ == nullptr) {
+        return false;
+    }
+    uint64_t need = Align8(sizeof(BlackBoxRecord) + len);
+    if (len == 0 || need > capacity_ / 4) {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    size_t index = static_cast<size_t>(stream);
+    while (writing_[index].test_and_set(std::memory_order_acquire)) {
+    }
+    BlackBoxStreamHeader& state = header_->stream[index];
+    unsigned char* ring = Ring(index);
+    uint64_t head = state.head.load(std::memory_order_relaxed);
+    uint64_t offset = head % capacity_;
+    uint64_t start = offset + need > capacity_ ? head + (capacity_ - offset) : head;  // 放不下时从下一圈开头写
+    uint64_t end = start + need;
+
+    // 先推进 tail 让出空间，再写入；读取端拷贝后重新读取 tail，据此丢弃拷贝期间被覆盖的记录
+    uint64_t tail = state.tail.load(std::memory_order_relaxed);
+    uint64_t overwritten = 0;
+    while (end - tail > capacity_) {
+        tail += RecordSpan(ring, capacity_, tail);
+        overwritten++;
+    }
+    if (overwritten > 0) {
+        state.tail.store(tail, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        overwritten_[index].fetch_add(overwritten, std::memory_order_relaxed);
+    }
+    if (start != head) {
+        memcpy(ring + offset, &kBlackBoxWrap, sizeof(kBlackBoxWrap));
+    }
+    BlackBoxRecord record{static_cast<uint32_t>(len), 0, SteadyNowUs()};
+    unsigned char* slot = ring + start % capacity_;
+    memcpy(slot, &record, sizeof(record));
+    memcpy(slot + sizeof(record), data, len);
+    state.head.store(end, std::memory_order_release);
+    writing_[index].clear(std::memory_order_release);
+    packets_[index].fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool AudioBlackBox::Dump(const std::string& prefix, BlackBoxDump* result) {
+    if (header_ == nullptr) {
+        return false;
+    }
+    std::lock_guard<ProfiledMutex> lock(dump_mutex_);
+    bool ok = DumpMapping(header_, base_, prefix, result);
+    if (ok) {
+        dumps_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return ok;
+}
+
+std::string AudioBlackBox::DumpToDir() {
+    std::string prefix = config_.dump_dir + "/linx-blackbox-" + std::to_string(WallMs());
+    BlackBoxDump dump;
+    if (!Dump(prefix, &dump)) {
+        return "black box dump failed\n";
+    }
+    if (dump.files.empty()) {
+        INFO("black box: nothing recorded yet");
+        return "black box empty\n";
+    }
+    std::string reply;
+    for (size_t i = 0; i < kBlackBoxStreams; ++i) {
+        if (dump.packets[i] == 0) {
+            continue;
+        }
+        INFO("black box: {} {} packets over {:.1f}s -> {}-{}.opus", kStreamNames[i], dump.packets[i],
+             dump.duration_s[i], prefix, kStreamNames[i]);
+        reply += std::string(kStreamNames[i]) + " " + std::to_string(dump.packets[i]) + " packets " + prefix + "-" +
+                 kStreamNames[i] + ".opus\n";
+    }
+    return reply;
+}
+
+bool AudioBlackBox::Start() {
+    if (thread_.joinable()) {
+        return true;
+    }
+    int fds[2];
+    if (pipe(fds) < 0) {
+        ERROR("black box: pipe failed: {}", strerror(errno));
+        return false;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);  // 信号处理函数中写入不能阻塞
+    wake_read_ = fds[0];
+    wake_write_.store(fds[1]);
+    thread_ = std::thread(&AudioBlackBox::RunDumper, this);
+    return true;
+}
+
+void AudioBlackBox::Stop() {
+    int fd = wake_write_.exchange(-1);
+    if (fd >= 0) {
+        close(fd);  // 导出线程读到 EOF 后退出
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (wake_read_ >= 0) {
+        close(wake_read_);
+        wake_read_ = -1;
+    }
+}
+
+void AudioBlackBox::RequestDump() {
+    int fd = wake_write_.load(std::memory_order_relaxed);
+    if (fd >= 0) {
+        char c = 'd';
+        (void)!write(fd, &c, 1);
+    }
+}
+
+void AudioBlackBox::RunDumper() {
+    char buf[16];
+    while (true) {
+        ssize_t n = read(wake_read_, buf, sizeof(buf));  // 连续的多次请求合并为一次导出
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        DumpToDir();
+    }
+}
+
+AudioBlackBoxStats AudioBlackBox::GetStats() const {
+    AudioBlackBoxStats stats;
+    for (size_t i = 0; i < kBlackBoxStreams; ++i) {
+        stats.packets[i] = packets_[i].load(std::memory_order_relaxed);
+        stats.overwritten[i] = overwritten_[i].load(std::memory_order_relaxed);
+    }
+    stats.rejected = rejected_.load(std::memory_order_relaxed);
+    stats.dumps = dumps_.load(std::memory_order_relaxed);
+    stats.capacity = capacity_;
+    return stats;
+}
+
+bool AudioBlackBox::Export(const std::string& path, const std::string& prefix, BlackBoxDump* result,
+                           std::string* error) {
+    auto fail = [&](const std::string& message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return fail("open " + path + " failed: " + strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < kHeaderSize) {
+        close(fd);
+        return fail(path + " is too small to be a black box file");
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return fail("mmap " + path + " failed: " + strerror(errno));
+    }
+    const auto* header = static_cast<const BlackBoxHeader*>(map);
+    bool valid = memcmp(header->magic, kBlackBoxMagic, sizeof(header->magic)) == 0 &&
+                 header->version == kBlackBoxVersion && header->streams == kBlackBoxStreams &&
+                 header->capacity > 0 && header->capacity % 8 == 0;
+    for (size_t i = 0; valid && i < kBlackBoxStreams; ++i) {
+        valid = header->stream[i].offset + header->capacity <= size;
+    }
+    bool ok = false;
+    if (!valid) {
+        fail(path + " is not a black box file (or was written by another version)");
+    } else {
+        ok = DumpMapping(header, static_cast<const unsigned char*>(map), prefix, result);
+        if (!ok) {
+            fail("failed to write " + prefix + "-*.opus");
+        }
+    }
+    munmap(map, size);
+    return ok;
+}
+
+}  // namespace linx
@@ -0,0 +1,415 @@
+#include "AudioConvert.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+#include "FileStream.h"
+#include "LockProfiler.h"
+#include "OggOpus.h"
+#include "PcmKernels.h"
+#include "Resampler.h"
+
+namespace linx {
+
+namespace {
+
+constexpr size_t kChunkFrames = 4096;
+
+bool OpusRateSupported(unsigned int rate) {
+    return rate == 8000 || rate == 12000 || rate == 16000 || rate == 24000 || rate == 48000;
+}
+
+// 转换流水线：读入一块 -> 声道转换 -> 重采样 -> 写出，各缓冲区按块大小一次分配。
+// 一个 Converter 可以依次转换多个文件：缓冲区按需增长后不再释放，采样率、声道数不变时
+// 编码器和重采样器只 Reset 不重建，批量转换时每个工作线程持有一个
+class Converter {
+public:
+    explicit Converter(const AudioConvertOptions& options) : options_(options) {}
+
+    bool Run(const std::string& dstPath, const std::string& srcPath, ConvertFormat format) {
+        format_ = format;
+        bytes_ = 0;
+        frame_fill_ = 0;
+        inputFrames_ = 0;
+        inputRate_ = 0;
+        if (input_.open(srcPath) != 0) {
+            return false;
+        }
+        const WavInfo& info = input_.info();
+        if ((info.audioFormat != 1 && info.audioFormat != 0xFFFE) || info.bitsPerSample != 16 ||
+            info.blockAlign != std::max(1, info.numChannels) * 2) {
+            ERROR("convertAudio: {} is not 16-bit PCM", srcPath);
+            input_.close();
+            return false;
+        }
+        inputRate_ = info.sampleRate;
+        srcChannels_ = std::max(1, info.numChannels);
+        channels_ = options_.channels > 0 ? std::min(options_.channels, 2) : std::min(srcChannels_, 2);
+        rate_ = options_.sampleRate > 0 ? options_.sampleRate : info.sampleRate;
+        if (!OpenOutput(dstPath)) {
+            input_.close();
+            return false;
+        }
+        bool resample = rate_ != info.sampleRate;
+        if (resample) {
+            PrepareResampler(info.sampleRate);
+        }
+
+        raw_.resize(kChunkFrames * srcChannels_);
+        mixed_.resize(kChunkFrames * channels_);
+        left_.resize(kChunkFrames);
+        right_.resize(kChunkFrames);
+        bool ok = true;
+        while (size_t bytes = input_.readChunk(raw_.data(), raw_.size() * sizeof(short))) {
+            size_t frames = bytes / info.blockAlign;
+            inputFrames_ += frames;
+            const short* pcm = Remix(frames);
+            if (resample) {
+                frames = resampler_->Process(pcm, frames, resampled_.data(), resampled_.size() / channels_);
+                pcm = resampled_.data();
+            }
+            if (!Emit(pcm, frames)) {
+                ok = false;
+                break;
+            }
+        }
+        ok = CloseOutput() && ok;
+        input_.close();
+        return ok;
+    }
+
+    // 上一次 Run 读入的时长（秒）
+    double InputSeconds() const {
+        return inputRate_ > 0 ? static_cast<double>(inputFrames_) / inputRate_ : 0.0;
+    }
+
+private:
+    bool OpenOutput(const std::string& path) {
+        if (format_ == ConvertFormat::OggOpus) {
+            if (!OpusRateSupported(rate_) || !OpusEncoderCtx::IsValidFrameDuration(options_.frameMs)) {
+                ERROR("convertAudio: Opus does not support {}Hz / {}ms frames", rate_, options_.frameMs);
+                return false;
+            }
+            if (opus_ && opus_->SampleRate() == rate_ && opus_->Channels() == channels_) {
+                opus_->Reset();  // 同参数的下一个文件：只清空编码状态
+            } else {
+                opus_.reset(new OpusEncoderCtx(rate_, channels_, options_.opus));
+                if (!opus_->Valid()) {
+                    opus_.reset();
+                    return false;
+                }
+            }
+            frame_.resize(opus_->FrameSamples(options_.frameMs) * channels_);
+            packet_.resize(4000);
+            OggOpusInfo info;
+            info.channels = channels_;
+            info.inputSampleRate = input_.info().sampleRate;
+            info.preSkip = static_cast<unsigned int>(opus_->Lookahead()) * (48000 / rate_);
+            return ogg_.open(path, info) == 0;
+        }
+        if (format_ == ConvertFormat::Wav) {
+            output_.wavfopen(path, "wb");
+        } else {
+            output_.fopen(path, "wb");
+        }
+        return output_.valid();
+    }
+
+    void PrepareResampler(unsigned int inRate) {
+        if (resampler_ && resamplerIn_ == inRate && resamplerOut_ == rate_ && resamplerChannels_ == channels_) {
+            resampler_->Reset();
+        } else {
+            resampler_.reset(new Resampler(inRate, rate_, channels_, kChunkFrames));
+            resamplerIn_ = inRate;
+            resamplerOut_ = rate_;
+            resamplerChannels_ = channels_;
+        }
+        resampled_.resize(resampler_->MaxOutputFrames(kChunkFrames) * channels_);
+    }
+
+    // 声道转换，返回 channels_ 声道的交错数据
+    const short* Remix(size_t frames) {
+        if (srcChannels_ == channels_) {
+            return raw_.data();
+        }
+        if (srcChannels_ == 2 && channels_ == 1) {
+            // 立体声取平均：拆分、各乘 0.5、相加，三步都是 SIMD 内核
+            PcmDeinterleave2(left_.data(), right_.data(), raw_.data(), frames);
+            PcmGain(left_.data(), left_.data(), frames, 0.5f);
+            PcmGain(right_.data(), right_.data(), frames, 0.5f);
+            PcmMix(mixed_.data(), left_.data(), right_.data(), frames);
+        } else if (srcChannels_ == 1 && channels_ == 2) {
+            PcmInterleave2(mixed_.data(), raw_.data(), raw_.data(), frames);
+        } else if (channels_ == 1) {
+            for (size_t i = 0; i < frames; ++i) {
+                int sum = 0;
+                for (int c = 0; c < srcChannels_; ++c) {
+                    sum += raw_[i * srcChannels_ + c];
+                }
+                mixed_[i] = static_cast<short>(sum / srcChannels_);
+            }
+        } else {
+            // 多声道转立体声：取前两个声道
+            for (size_t i = 0; i < frames; ++i) {
+                mixed_[i * 2] = raw_[i * srcChannels_];
+                mixed_[i * 2 + 1] = raw_[i * srcChannels_ + 1];
+            }
+        }
+        return mixed_.data();
+    }
+
+    bool Emit(const short* pcm, size_t frames) {
+        size_t samples = frames * channels_;
+        if (format_ != ConvertFormat::OggOpus) {
+            if (samples > 0 && output_.fwrite(const_cast<short*>(pcm), sizeof(short), static_cast<int>(samples)) !=
+                                   static_cast<int>(samples)) {
+                return false;
+            }
+            bytes_ += samples * sizeof(short);
+            return true;
+        }
+        // 攒满一帧编码一次
+        while (samples > 0) {
+            size_t n = std::min(samples, frame_.size() - frame_fill_);
+            std::copy(pcm, pcm + n, frame_.begin() + frame_fill_);
+            frame_fill_ += n;
+            pcm += n;
+            samples -= n;
+            if (frame_fill_ == frame_.size() && !EncodeFrame()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool EncodeFrame() {
+        frame_fill_ = 0;
+        int encoded = opus_->Encode(packet_.data(), packet_.size(), frame_.data(), frame_.size() / channels_);
+        return encoded > 0 && ogg_.writePacket(packet_.data(), static_cast<size_t>(encoded));
+    }
+
+    bool CloseOutput() {
+        if (format_ == ConvertFormat::OggOpus) {
+            bool ok = true;
+            if (frame_fill_ > 0) {
+                std::fill(frame_.begin() + frame_fill_, frame_.end(), 0);  // 最后不足一帧补静音
+                ok = EncodeFrame();
+            }
+            ogg_.close();
+            return ok && !ogg_.failed();
+        }
+        if (format_ == ConvertFormat::Wav) {
+            output_.wavfclose(static_cast<int>(bytes_), channels_, rate_);
+        } else {
+            output_.fclose();
+        }
+        return true;
+    }
+
+    ConvertFormat format_ = ConvertFormat::Pcm;
+    const AudioConvertOptions& options_;
+    PcmReader input_;
+    size_t inputFrames_ = 0;
+    unsigned int inputRate_ = 0;
+    int srcChannels_ = 1;
+    int channels_ = 1;
+    unsigned int rate_ = 8000;
+    std::unique_ptr<Resampler> resampler_;
+    unsigned int resamplerIn_ = 0;
+    unsigned int resamplerOut_ = 0;
+    int resamplerChannels_ = 0;
+    std::vector<short> raw_;
+    std::vector<short> mixed_;
+    std::vector<short> left_;
+    std::vector<short> right_;
+    std::vector<short> resampled_;
+    // Pcm/Wav
+    FileStream output_;
+    size_t bytes_ = 0;
+    // OggOpus
+    std::unique_ptr<OpusEncoderCtx> opus_;
+    OggOpusWriter ogg_;
+    std::vector<short> frame_;
+    size_t frame_fill_ = 0;
+    std::vector<unsigned char> packet_;
+};
+
+// 批量转换的任务队列：所有者从队首取（大文件在前），空闲线程从其他队列的队尾窃取（小文件），
+// 最后剩下的都是小任务，各线程几乎同时做完
+struct WorkQueue {
+    ProfiledMutex mutex{"convert_queue"};
+    std::deque<size_t> jobs;
+    uint64_t bytes = 0;  // 队列中剩余任务的输入字节数，窃取时挑最多的队列
+
+    bool PopFront(size_t* job, const std::vector<uint64_t>& sizes) {
+        std::lock_guard<ProfiledMutex> lock(mutex);
+        if (jobs.empty()) {
+            return false;
+        }
+        *job = jobs.front();
+        jobs.pop_front();
+        bytes -= sizes[*job];
+        return true;
+    }
+
+    bool PopBack(size_t* job, const std::vector<uint64_t>& sizes) {
+        std::lock_guard<ProfiledMutex> lock(mutex);
+        if (jobs.empty()) {
+            return false;
+        }
+        *job = jobs.back();
+        jobs.pop_back();
+        bytes -= sizes[*job];
+        return true;
+    }
+
+    // 队列非空时返回 true 并给出剩余字节数
+    bool Remaining(uint64_t* remaining) {
+        std::lock_guard<ProfiledMutex> lock(mutex);
+        *remaining = bytes;
+        return !jobs.empty();
+    }
+};
+
+uint64_t FileSize(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+bool convertAudio(const std::string& dstPath, const std::string& srcPath, ConvertFormat format,
+                  const AudioConvertOptions& options) {
+    if (dstPath.empty() || srcPath.empty()) {
+        ERROR("convertAudio: empty path");
+        return false;
+    }
+    Converter converter(options);
+    if (!converter.Run(dstPath, srcPath, format)) {
+        ERROR("convertAudio: {} -> {} failed", srcPath, dstPath);
+        return false;
+    }
+    return true;
+}
+
+bool wav2opus(const std::string& opusFilePath, const std::string& wavFilePath, const AudioConvertOptions& options) {
+    return convertAudio(opusFilePath, wavFilePath, ConvertFormat::OggOpus, options);
+}
+
+// 声明在 FileStream.h，定义在这里：FileStream.cc 不引用编码器，linx_filestream 不依赖 libopus
+bool wav2pcm(const std::string& pcmFilePath, const std::string& wavFilePath) {
+    // 与原先的 ffmpeg 命令参数一致：8kHz、单声道、s16le
+    return convertAudio(pcmFilePath, wavFilePath, ConvertFormat::Pcm);
+}
+
+size_t convertAudioBatch(const std::vector<AudioConvertJob>& jobs, const AudioConvertOptions& options,
+                         size_t threads, std::vector<bool>* results, AudioConvertBatchStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::max<size_t>(1, std::min(threads, jobs.size()));
+
+    // 按输入大小从大到小轮流分给各线程队列：各队列总量接近，最长的文件最先开始
+    std::vector<uint64_t> sizes(jobs.size());
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        sizes[i] = FileSize(jobs[i].src);
+    }
+    std::vector<size_t> order(jobs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+    std::vector<WorkQueue> queues(threads);
+    for (size_t i = 0; i < order.size(); ++i) {
+        WorkQueue& queue = queues[i % threads];
+        queue.jobs.push_back(order[i]);
+        queue.bytes += sizes[order[i]];
+    }
+
+    std::vector<char> ok(jobs.size(), 0);
+    std::vector<AudioConvertWorkerStats> workers(threads);
+    auto worker = [&](size_t self) {
+        Converter converter(options);  // 每个线程一份编码器、重采样器和缓冲区，任务之间复用
+        AudioConvertWorkerStats& mine = workers[self];
+        for (;;) {
+            size_t job;
+            bool stolen = false;
+            if (!queues[self].PopFront(&job, sizes)) {
+                // 自己的队列空了：从剩余最多的队列尾部窃取；任务不会再增加，全部为空时结束
+                size_t victim = self;
+                uint64_t most = 0;
+                for (size_t q = 0; q < threads; ++q) {
+                    uint64_t remaining = 0;
+                    if (q != self && queues[q].Remaining(&remaining) && (victim == self || remaining > most)) {
+                        victim = q;
+                        most = remaining;
+                    }
+                }
+                if (victim == self) {
+                    break;
+                }
+                if (!queues[victim].PopBack(&job, sizes)) {
+                    continue;  // 被别的线程抢先取空，重新挑选
+                }
+                stolen = true;
+            }
+            auto jobStart = std::chrono::steady_clock::now();
+            const AudioConvertJob& item = jobs[job];
+            if (item.dst.empty() || item.src.empty() || !converter.Run(item.dst, item.src, item.format)) {
+                ERROR("convertAudioBatch: {} -> {} failed", item.src, item.dst);
+            } else {
+                ok[job] = 1;
+                mine.succeeded++;
+                mine.audioSeconds += converter.InputSeconds();
+            }
+            mine.jobs++;
+            mine.stolen += stolen ? 1 : 0;
+            mine.inputBytes += sizes[job];
+            mine.busySeconds += SecondsSince(jobStart);
+        }
+    };
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (size_t t = 1; t < threads; ++t) {
+        pool.emplace_back(worker, t);
+    }
+    if (!jobs.empty()) {
+        worker(0);  // 调用线程也参与
+    }
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+
+    size_t succeeded = 0;
+    for (const AudioConvertWorkerStats& w : workers) {
+        succeeded += w.succeeded;
+    }
+    if (results != nullptr) {
+        results->assign(ok.begin(), ok.end());
+    }
+    if (stats != nullptr) {
+        stats->jobs = jobs.size();
+        stats->succeeded = succeeded;
+        stats->inputBytes = std::accumulate(sizes.begin(), sizes.end(), uint64_t{0});
+        stats->audioSeconds = 0;
+        for (const AudioConvertWorkerStats& w : workers) {
+            stats->audioSeconds += w.audioSeconds;
+        }
+        stats->wallSeconds = SecondsSince(start);
+        stats->workers = std::move(workers);
+    }
+    return succeeded;
+}
+
+}  // namespace linx
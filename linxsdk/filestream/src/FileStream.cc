@@ -1,7 +1,177 @@
 #include "FileStream.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "PcmKernels.h"
+
 namespace linx {
 
+namespace {
+
+constexpr size_t kReleaseWindow = 1 << 20;  // 每读过 1MB 释放一次映射
+
+uint32_t GetLe32(const unsigned char* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint16_t GetLe16(const unsigned char* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+}  // namespace
+
+bool parseWavHeader(const void* data, size_t size, WavInfo* info) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    if (size < 12 || memcmp(p, "RIFF", 4) != 0 || memcmp(p + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+    bool has_fmt = false;
+    size_t pos = 12;
+    while (pos + 8 <= size) {
+        const unsigned char* chunk = p + pos;
+        size_t chunk_size = GetLe32(chunk + 4);
+        size_t body = pos + 8;
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunk_size < 16 || body + 16 > size) {
+                return false;
+            }
+            info->audioFormat = GetLe16(chunk + 8);
+            info->numChannels = GetLe16(chunk + 10);
+            info->sampleRate = GetLe32(chunk + 12);
+            info->blockAlign = GetLe16(chunk + 20);
+            info->bitsPerSample = GetLe16(chunk + 22);
+            has_fmt = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!has_fmt || info->numChannels <= 0 || info->blockAlign <= 0) {
+                return false;
+            }
+            info->dataOffset = body;
+            size_t available = size - body;
+            info->dataSize = chunk_size == 0 || chunk_size > available ? available : chunk_size;
+            info->dataSize -= info->dataSize % info->blockAlign;
+            return true;
+        }
+        pos = body + chunk_size + (chunk_size & 1);  // 块按偶数字节对齐
+    }
+    return false;
+}
+
+MappedFile::~MappedFile() { close(); }
+
+int MappedFile::open(const std::string& filePath) {
+    close();
+    int fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ERROR("MappedFile::open, open {} failed: {}", filePath, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ERROR("MappedFile::open, stat {} failed: {}", filePath, strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            ERROR("MappedFile::open, mmap {} failed: {}", filePath, strerror(errno));
+            ::close(fd);
+            size_ = 0;
+            return -1;
+        }
+        data_ = static_cast<char*>(addr);
+        madvise(data_, size_, MADV_SEQUENTIAL);  // 加大预读，读过的页优先回收
+    }
+    fd_ = fd;
+    return 0;
+}
+
+void MappedFile::close() {
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+        data_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    size_ = 0;
+}
+
+void MappedFile::release(size_t offset, size_t len) {
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t begin = (offset + page - 1) / page * page;
+    size_t end = std::min(offset + len, size_) / page * page;
+    if (data_ != nullptr && end > begin) {
+        madvise(data_ + begin, end - begin, MADV_DONTNEED);
+    }
+}
+
+int PcmReader::open(const std::string& filePath) {
+    close();
+    if (file_.open(filePath) != 0) {
+        return -1;
+    }
+    if (!parseWavHeader(file_.data(), file_.size(), &info_)) {
+        ERROR("PcmReader::open, {} is not a WAV file", filePath);
+        close();
+        return -1;
+    }
+    return 0;
+}
+
+int PcmReader::openRaw(const std::string& filePath, int channels, unsigned int sampleRate) {
+    close();
+    if (channels <= 0 || file_.open(filePath) != 0) {
+        return -1;
+    }
+    info_.numChannels = channels;
+    info_.sampleRate = sampleRate;
+    info_.blockAlign = channels * 2;
+    info_.dataOffset = 0;
+    info_.dataSize = file_.size() - file_.size() % info_.blockAlign;
+    return 0;
+}
+
+void PcmReader::close() {
+    file_.close();
+    info_ = WavInfo();
+    pos_ = 0;
+    released_ = 0;
+}
+
+std::string_view PcmReader::nextChunk(size_t maxBytes) {
+    size_t len = std::min(maxBytes, remaining());
+    len -= len % info_.blockAlign;
+    std::string_view chunk(file_.data() + info_.dataOffset + pos_, len);
+    advance(len);
+    return chunk;
+}
+
+size_t PcmReader::readChunk(void* buf, size_t len) {
+    std::string_view chunk = nextChunk(len);
+    memcpy(buf, chunk.data(), chunk.size());
+    return chunk.size();
+}
+
+void PcmReader::advance(size_t len) {
+    pos_ += len;
+    // 释放时落后读取位置一个窗口：nextChunk 返回的视图在下一次读取前仍然有效
+    if (pos_ >= released_ + 2 * kReleaseWindow) {
+        file_.release(info_.dataOffset + released_, kReleaseWindow);
+        released_ += kReleaseWindow;
+    }
+}
+
 FileStream::FileStream() {}
 FileStream::FileStream(const std::string& filePath, const std::string& FLAG) {
     fopen(filePath, FLAG);
@@ -31,8 +201,25 @@ int FileStream::fopen(const std::string& filePath, const std::string& FLAG) {
     return 0;
 }
 
+int FileStream::fopenAsync(const std::string& filePath, const AsyncFileWriterConfig& config) {
+    fclose();
+    if (!filePath.size()) {
+        ERROR("FileStream::fopenAsync, filePath {} is null", filePath);
+        return -1;
+    }
+    filePath_ = filePath;
+    if (!async_) {
+        async_ = std::make_unique<AsyncFileWriter>(config);
+    }
+    if (!async_->Open(filePath)) {
+        ERROR("FileStream::fopenAsync, open {} is failed", filePath);
+        return -1;
+    }
+    return 0;
+}
+
 int FileStream::valid() {
-    if (nullptr != fp_)
+    if (nullptr != fp_ || (async_ && async_->IsOpen()))
         return 1;
     else
         return 0;
@@ -41,8 +228,20 @@ int FileStream::valid() {
 int FileStream::fwrite(void* buf, int typesize, int len) {
     if (nullptr != fp_)
         return ::fwrite(buf, typesize, len, fp_);
-    else
-        return -1;
+    if (async_ && async_->IsOpen()) {
+        return async_->Write(buf, static_cast<size_t>(typesize) * len) ? len : 0;
+    }
+    return -1;
+}
+
+int FileStream::fflush() {
+    if (nullptr != fp_) {
+        return ::fflush(fp_);
+    }
+    if (async_ && async_->IsOpen()) {
+        return async_->Flush() ? 0 : -1;
+    }
+    return -1;
 }
 
 int FileStream::fread(void* buf, int typesize, int len) {
@@ -61,6 +260,9 @@ void FileStream::fclose() {
         ::fclose(fp_);
         fp_ = nullptr;
     }
+    if (async_ && async_->IsOpen() && !async_->Close()) {
+        ERROR("FileStream::fclose, writing {} failed", filePath_);
+    }
 }
 
 /*  0L          ~   begin_offset
@@ -108,6 +310,7 @@ std::string FileStream::readAll() {
         ERROR("the content of {} is wrong", filePath_);
         throw -1;
     }
+    rewind();
 
     std::string lines(len, '0');
     int size = fread(&lines[0], 1, len);
@@ -125,106 +328,237 @@ int FileStream::wavfopen(const std::string& filePath, const std::string& FLAG) {
     return 0;
 }
 
-void FileStream::wavfclose(int pcmsize, int channels) {
+int FileStream::wavfopenAsync(const std::string& filePath, const AsyncFileWriterConfig& config) {
+    if (fopenAsync(filePath, config) != 0) {
+        return -1;
+    }
+    // 先占位 44 字节，wavfclose 时补全
+    char header[sizeof(WAVE_HEADER) + sizeof(WAVE_FMT) + sizeof(WAVE_DATA)] = {};
+    async_->Write(header, sizeof(header));
+    return 0;
+}
+
+void FileStream::wavfclose(int pcmsize, int channels, unsigned int sampleRate) {
     WAVE_HEADER wavHeader;
     WAVE_FMT wavFmt;
     WAVE_DATA wavData;
 
     /* write WAVE_HEADER */
-    rewind();
     memcpy(wavHeader.chunkID, "RIFF", 4);
     wavHeader.chunkSize = sizeof(wavHeader) + sizeof(wavFmt) + pcmsize;
     memcpy(wavHeader.format, "WAVE", 4);
 
-    fwrite(&wavHeader, sizeof(wavHeader), 1);
-
     /* write wavFmt */
     memcpy(wavFmt.subchunk1ID, "fmt ", 4);
     wavFmt.subchunk1Size = 16;
     wavFmt.audioFormat = 0x0001;
     wavFmt.numChannels = channels;  // channel
-    wavFmt.sampleRate = 8000;       // samplerate
+    wavFmt.sampleRate = sampleRate;  // samplerate
     wavFmt.bitsPerSample = 16;
     wavFmt.byteRate = wavFmt.sampleRate * wavFmt.numChannels * wavFmt.bitsPerSample / 8;
     wavFmt.blockAlign = wavFmt.numChannels * wavFmt.bitsPerSample / 8;
-    fwrite(&wavFmt, sizeof(wavFmt), 1);
 
     /* wirte wavData */
     memcpy(wavData.subchunk2ID, "data", 4);
     wavData.subchunk2Size = pcmsize;
-    fwrite(&wavData, sizeof(wavData), 1);
+
+    char header[sizeof(wavHeader) + sizeof(wavFmt) + sizeof(wavData)];
+    memcpy(header, &wavHeader, sizeof(wavHeader));
+    memcpy(header + sizeof(wavHeader), &wavFmt, sizeof(wavFmt));
+    memcpy(header + sizeof(wavHeader) + sizeof(wavFmt), &wavData, sizeof(wavData));
+    if (async_ && async_->IsOpen()) {
+        async_->WriteAt(0, header, sizeof(header));
+    } else {
+        rewind();
+        fwrite(header, sizeof(header), 1);
+    }
 
     fclose();
 }
 
-void FileStream::saveWavWithOneChannel(const std::string& path, const std::vector<char>& src) {
-    wavfopen(path, "wb");
-    fwrite((char*)&src[0], 1, src.size());
-    wavfclose(src.size(), 1);
-}
+int FileStream::wavfopenread(const std::string& filePath, WAVE_FMT* fmt, unsigned int* dataSize) {
+    if (fopen(filePath, "rb") != 0) {
+        return -1;
+    }
+    WAVE_HEADER wavHeader;
+    if (fread(&wavHeader, sizeof(wavHeader), 1) != 1 || memcmp(wavHeader.chunkID, "RIFF", 4) != 0 ||
+        memcmp(wavHeader.format, "WAVE", 4) != 0) {
+        ERROR("FileStream::wavfopenread, {} is not a WAV file", filePath);
+        fclose();
+        return -1;
+    }
 
-void FileStream::saveWavWithTwoChannel(const std::string& path, const std::vector<char>& first,
-                                       std::vector<char>& second) {
-    wavfopen(path, "wb");
-    size_t len1 = first.size();
-    size_t len2 = second.size();
-    size_t len = len1 > len2 ? len1 : len2;
-    size_t recordSize = 2 * len;
-    std::vector<char> dst(recordSize, 0);
-
-    size_t ci = 0;
-    size_t si = 0;
-    size_t i = 0;
-    while (i < recordSize) {
-        if (ci < len) {
-            dst[i] = first[ci];
-            dst[i + 1] = first[ci + 1];
-            ci += 2;
+    // 按块遍历：fmt 块可能大于 16 字节（WAVE_FORMAT_EXTENSIBLE），data 前可能有 LIST/fact 等块
+    bool has_fmt = false;
+    WAVE_DATA chunk;
+    while (fread(&chunk, sizeof(chunk), 1) == 1) {
+        unsigned int size = chunk.subchunk2Size;
+        if (memcmp(chunk.subchunk2ID, "fmt ", 4) == 0 && size >= 16) {
+            memcpy(fmt->subchunk1ID, chunk.subchunk2ID, 4);
+            fmt->subchunk1Size = size;
+            if (fread(&fmt->audioFormat, 16, 1) != 1) {
+                break;
+            }
+            fseek(static_cast<int>(size - 16 + (size & 1)), SEEK_CUR);
+            has_fmt = true;
+        } else if (memcmp(chunk.subchunk2ID, "data", 4) == 0) {
+            if (!has_fmt) {
+                break;
+            }
+            // 0xFFFE 为 WAVE_FORMAT_EXTENSIBLE，子格式按 PCM 处理
+            if ((fmt->audioFormat != 1 && fmt->audioFormat != static_cast<short>(0xFFFE)) ||
+                fmt->bitsPerSample != 16) {
+                ERROR("FileStream::wavfopenread, {}: only 16-bit PCM is supported", filePath);
+                break;
+            }
+            *dataSize = size;
+            return 0;
         } else {
-            dst[i] = 0;
-            dst[i + 1] = 0;
+            fseek(static_cast<int>(size + (size & 1)), SEEK_CUR);
         }
+    }
+    ERROR("FileStream::wavfopenread, {}: no usable fmt/data chunk", filePath);
+    fclose();
+    return -1;
+}
 
-        if (si < len) {
-            dst[i + 2] = second[si];
-            dst[i + 3] = second[si + 1];
-            si += 2;
-        } else {
-            dst[i + 2] = 0;
-            dst[i + 3] = 0;
-        }
-        i += 4;
+void FileStream::saveWavWithOneChannel(const std::string& path, const std::vector<char>& src,
+                                       unsigned int sampleRate) {
+    PcmPlane plane{reinterpret_cast<const short*>(src.data()), src.size() / sizeof(short)};
+    saveWavPlanar(path, &plane, 1, sampleRate);
+}
+
+void FileStream::saveWavWithTwoChannel(const std::string& path, const std::vector<char>& first,
+                                       const std::vector<char>& second, unsigned int sampleRate) {
+    // 每路按自己的长度读取，短的一路在结尾补静音
+    PcmPlane planes[2] = {
+        {reinterpret_cast<const short*>(first.data()), first.size() / sizeof(short)},
+        {reinterpret_cast<const short*>(second.data()), second.size() / sizeof(short)},
+    };
+    saveWavPlanar(path, planes, 2, sampleRate);
+}
+
+WavWriter::WavWriter(size_t blockFrames) : blockFrames_(blockFrames > 0 ? blockFrames : 4096) {}
+
+WavWriter::~WavWriter() {
+    close();
+}
+
+int WavWriter::open(const std::string& path, int channels, unsigned int sampleRate) {
+    close();
+    if (channels <= 0 || file_.wavfopen(path, "wb") != 0 || !file_.valid()) {
+        ERROR("WavWriter: cannot open {}", path);
+        return -1;
     }
-    fwrite((char*)&dst[0], 1, dst.size());
-    wavfclose(dst.size(), 2);
+    channels_ = channels;
+    sampleRate_ = sampleRate;
+    frames_ = 0;
+    block_.resize(blockFrames_ * channels);
+    silence_.assign(blockFrames_, 0);
+    planes_.resize(channels);
+    open_ = true;
+    return 0;
 }
 
-bool pcm2wav(const std::string& wavFilePath, const std::string& pcmFilePath) {
-    if (wavFilePath.size() == 0 || pcmFilePath.size() == 0) {
-        INFO("error in pcm2wav");
+bool WavWriter::write(const short* const* planes, size_t frames) {
+    if (!open_) {
         return false;
     }
-    FileStream pcmfs(pcmFilePath.c_str(), "rb");
-    FileStream wavfs;
-    wavfs.wavfopen(wavFilePath.c_str(), "wb");
-    std::vector<char> buf = pcmfs.readStream();
-    wavfs.fwrite(&buf[0], 1, buf.size());
-    wavfs.wavfclose(buf.size(), 1);
+    for (size_t done = 0; done < frames; done += blockFrames_) {
+        size_t n = std::min(blockFrames_, frames - done);
+        for (int c = 0; c < channels_; ++c) {
+            planes_[c] = planes[c] != nullptr ? planes[c] + done : silence_.data();
+        }
+        PcmInterleave(block_.data(), planes_.data(), n, channels_);
+        size_t bytes = n * channels_ * sizeof(short);
+        if (file_.fwrite(block_.data(), 1, static_cast<int>(bytes)) != static_cast<int>(bytes)) {
+            ERROR("WavWriter: write failed after {} frames", frames_);
+            return false;
+        }
+        frames_ += n;
+    }
     return true;
 }
 
-bool wav2pcm(const std::string& pcmFilePath, const std::string& wavFilePath) {
-    if (wavFilePath.size() == 0 || pcmFilePath.size() == 0) {
-        INFO("error in wav2pcm");
+bool WavWriter::writeInterleaved(const short* pcm, size_t frames) {
+    if (!open_) {
+        return false;
+    }
+    size_t bytes = frames * channels_ * sizeof(short);
+    if (bytes > 0 && file_.fwrite(const_cast<short*>(pcm), 1, static_cast<int>(bytes)) != static_cast<int>(bytes)) {
+        ERROR("WavWriter: write failed after {} frames", frames_);
         return false;
     }
-    std::string cmd =
-        "ffmpeg -i " + wavFilePath + " -f s16le -ar 8000 -ac 1 -acodec pcm_s16le -y " + pcmFilePath;
-    int ret = system(cmd.c_str());
-    INFO("{}", ret);
+    frames_ += frames;
     return true;
 }
 
+size_t WavWriter::close() {
+    if (!open_) {
+        return frames_;
+    }
+    file_.wavfclose(static_cast<int>(frames_ * channels_ * sizeof(short)), channels_, sampleRate_);
+    open_ = false;
+    return frames_;
+}
+
+bool saveWavPlanar(const std::string& path, const PcmPlane* planes, int channels, unsigned int sampleRate) {
+    WavWriter writer;
+    if (writer.open(path, channels, sampleRate) != 0) {
+        return false;
+    }
+    size_t frames = 0;
+    for (int c = 0; c < channels; ++c) {
+        frames = std::max(frames, planes[c].samples);
+    }
+    // 按块推进：某一路在块中间结束时，把它的尾部拷进该路补零的暂存块（每路至多一次）
+    constexpr size_t kBlock = 4096;
+    std::vector<std::vector<short>> tails(channels);
+    std::vector<const short*> block(channels);
+    bool ok = true;
+    for (size_t done = 0; ok && done < frames; done += kBlock) {
+        size_t n = std::min(kBlock, frames - done);
+        for (int c = 0; c < channels; ++c) {
+            size_t have = planes[c].samples > done ? planes[c].samples - done : 0;
+            if (have >= n) {
+                block[c] = planes[c].data + done;
+            } else if (have == 0) {
+                block[c] = nullptr;
+            } else {
+                tails[c].assign(n, 0);
+                std::copy(planes[c].data + done, planes[c].data + done + have, tails[c].begin());
+                block[c] = tails[c].data();
+            }
+        }
+        ok = writer.write(block.data(), n);
+    }
+    writer.close();
+    return ok;
+}
 
+bool pcm2wav(const std::string& wavFilePath, const std::string& pcmFilePath, int channels,
+             unsigned int sampleRate) {
+    if (wavFilePath.size() == 0 || pcmFilePath.size() == 0) {
+        INFO("error in pcm2wav");
+        return false;
+    }
+    PcmReader reader;
+    if (reader.openRaw(pcmFilePath, channels, sampleRate) != 0) {
+        return false;
+    }
+    FileStream wavfs;
+    if (wavfs.wavfopen(wavFilePath.c_str(), "wb") != 0 || !wavfs.valid()) {
+        return false;
+    }
+    // 逐块从映射内存写出，不把整个 PCM 文件读进内存
+    constexpr size_t kChunk = 64 * 1024;
+    size_t total = 0;
+    for (std::string_view chunk = reader.nextChunk(kChunk); !chunk.empty(); chunk = reader.nextChunk(kChunk)) {
+        wavfs.fwrite(const_cast<char*>(chunk.data()), 1, static_cast<int>(chunk.size()));
+        total += chunk.size();
+    }
+    wavfs.wavfclose(static_cast<int>(total), channels, sampleRate);
+    return true;
+}
 
 }  // namespace linx
\ No newline at end of file
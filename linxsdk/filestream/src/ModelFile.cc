@@ -0,0 +1,358 @@
+#include "ModelFile.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace linx {
+
+namespace {
+
+const char* const kDTypeNames[] = {"f32", "f16", "i32", "i16", "i8", "u8"};
+const size_t kDTypeSizes[] = {4, 2, 4, 2, 1, 1};
+
+size_t AlignUp(size_t value) {
+    return (value + kModelTensorAlign - 1) / kModelTensorAlign * kModelTensorAlign;
+}
+
+bool Fail(std::string* error, const std::string& message) {
+    if (error != nullptr) {
+        *error = message;
+    }
+    return false;
+}
+
+struct CrcTable {
+    uint32_t entries[256];
+
+    CrcTable() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) != 0 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+    }
+};
+
+// 文件头（header_crc 按 0 计）+ 张量表 + 名称区
+uint32_t HeaderCrc(const char* base, const ModelFileHeader& header, size_t names_end) {
+    ModelFileHeader copy = header;
+    copy.header_crc = 0;
+    uint32_t crc = Crc32(&copy, sizeof(copy));
+    return Crc32(base + sizeof(copy), names_end - sizeof(copy), crc);
+}
+
+}  // namespace
+
+uint32_t Crc32(const void* data, size_t len, uint32_t crc) {
+    static const CrcTable table;
+    const auto* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i) {
+        crc = table.entries[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+size_t ModelDTypeSize(ModelDType dtype) {
+    size_t index = static_cast<size_t>(dtype);
+    return index < static_cast<size_t>(ModelDType::kCount) ? kDTypeSizes[index] : 0;
+}
+
+const char* ModelDTypeName(ModelDType dtype) {
+    size_t index = static_cast<size_t>(dtype);
+    return index < static_cast<size_t>(ModelDType::kCount) ? kDTypeNames[index] : "unknown";
+}
+
+bool ModelFile::Open(const std::string& path, std::string* error) {
+    Close();
+    if (file_.open(path) != 0) {
+        return Fail(error, "cannot open " + path);
+    }
+    const char* base = file_.data();
+    size_t size = file_.size();
+    auto invalid = [&](const char* what) {
+        file_.close();
+        return Fail(error, path + ": " + what);
+    };
+    if (size < sizeof(ModelFileHeader)) {
+        return invalid("too small for a model file");
+    }
+    const auto* header = reinterpret_cast<const ModelFileHeader*>(base);
+    if (memcmp(header->magic, kModelFileMagic, sizeof(header->magic)) != 0) {
+        return invalid("not a model file");
+    }
+    if (header->version != kModelFileVersion) {
+        return invalid("unsupported model file version");
+    }
+    if (header->file_size != size) {
+        return invalid("truncated or modified model file");
+    }
+    if (header->entries != sizeof(ModelFileHeader) ||
+        header->count > (size - header->entries) / sizeof(ModelTensorEntry) ||
+        header->names != header->entries + static_cast<uint64_t>(header->count) * sizeof(ModelTensorEntry) ||
+        header->names > size) {
+        return invalid("index out of bounds");
+    }
+    // 名称区的末尾：最后一个名称的结束位置（名称按写入顺序首尾相接）
+    const auto* entries = reinterpret_cast<const ModelTensorEntry*>(base + header->entries);
+    uint64_t names_end = header->names;
+    for (uint32_t i = 0; i < header->count; ++i) {
+        uint64_t end = header->names + entries[i].name + entries[i].name_len;
+        if (end > size) {
+            return invalid("name out of bounds");
+        }
+        names_end = std::max(names_end, end);
+    }
+    if (HeaderCrc(base, *header, static_cast<size_t>(names_end)) != header->header_crc) {
+        return invalid("header checksum mismatch");
+    }
+    // 只校验索引：张量在文件范围内、对齐、长度与维度一致、按名称排序；权重本身不读，第一次使用时才缺页
+    for (uint32_t i = 0; i < header->count; ++i) {
+        const ModelTensorEntry& entry = entries[i];
+        size_t element = ModelDTypeSize(static_cast<ModelDType>(entry.dtype));
+        uint64_t elements = 1;
+        for (int d = 0; d < kModelMaxRank; ++d) {
+            elements *= entry.dims[d];
+        }
+        if (element == 0 || entry.rank > kModelMaxRank || entry.offset % kModelTensorAlign != 0 ||
+            entry.offset < names_end || entry.offset > size || entry.bytes > size - entry.offset ||
+            elements * element != entry.bytes) {
+            return invalid("tensor out of bounds");
+        }
+        if (i > 0) {
+            std::string_view prev(base + header->names + entries[i - 1].name, entries[i - 1].name_len);
+            std::string_view name(base + header->names + entry.name, entry.name_len);
+            if (!(prev < name)) {
+                return invalid("index is not sorted");
+            }
+        }
+    }
+    // MappedFile 默认按顺序读取建议内核回收读过的页；权重每帧都要重读，恢复默认的预读和回收策略
+    madvise(const_cast<char*>(base), size, MADV_NORMAL);
+    path_ = path;
+    header_ = header;
+    entries_ = entries;
+    return true;
+}
+
+void ModelFile::Close() {
+    file_.close();
+    header_ = nullptr;
+    entries_ = nullptr;
+}
+
+std::string_view ModelFile::Name(const ModelTensorEntry& entry) const {
+    return std::string_view(file_.data() + header_->names + entry.name, entry.name_len);
+}
+
+size_t ModelFile::Find(std::string_view name) const {
+    if (header_ == nullptr) {
+        return kNotFound;
+    }
+    const ModelTensorEntry* end = entries_ + header_->count;
+    const ModelTensorEntry* it = std::lower_bound(
+        entries_, end, name, [this](const ModelTensorEntry& entry, std::string_view key) { return Name(entry) < key; });
+    if (it == end || Name(*it) != name) {
+        return kNotFound;
+    }
+    return static_cast<size_t>(it - entries_);
+}
+
+ModelTensor ModelFile::Tensor(size_t index) const {
+    const ModelTensorEntry& entry = entries_[index];
+    ModelTensor tensor;
+    tensor.name = Name(entry);
+    tensor.dtype = static_cast<ModelDType>(entry.dtype);
+    tensor.rank = entry.rank;
+    std::copy(entry.dims, entry.dims + kModelMaxRank, tensor.dims);
+    tensor.data = file_.data() + entry.offset;
+    tensor.bytes = static_cast<size_t>(entry.bytes);
+    return tensor;
+}
+
+bool ModelFile::Lookup(std::string_view name, ModelDType dtype, size_t expected_elements, ModelTensor* out,
+                       std::string* error) const {
+    size_t index = Find(name);
+    if (index == kNotFound) {
+        return Fail(error, path_ + ": no tensor " + std::string(name));
+    }
+    ModelTensor tensor = Tensor(index);
+    if (tensor.dtype != dtype) {
+        return Fail(error, path_ + ": tensor " + std::string(name) + " is " + ModelDTypeName(tensor.dtype) +
+                               ", expected " + ModelDTypeName(dtype));
+    }
+    if (expected_elements != 0 && tensor.Elements() != expected_elements) {
+        return Fail(error, path_ + ": tensor " + std::string(name) + " has " + std::to_string(tensor.Elements()) +
+                               " elements, expected " + std::to_string(expected_elements));
+    }
+    *out = tensor;
+    return true;
+}
+
+void ModelFile::Prefetch(size_t index) const {
+    if (header_ == nullptr) {
+        return;
+    }
+    const ModelTensorEntry& entry = entries_[index];
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t begin = static_cast<size_t>(entry.offset) / page * page;
+    size_t end = static_cast<size_t>(entry.offset + entry.bytes);
+    if (end > begin) {
+        madvise(const_cast<char*>(file_.data()) + begin, end - begin, MADV_WILLNEED);
+    }
+}
+
+void ModelFile::PrefetchAll() const {
+    if (header_ != nullptr) {
+        madvise(const_cast<char*>(file_.data()), file_.size(), MADV_WILLNEED);
+    }
+}
+
+bool ModelFile::Verify(size_t index, std::string* error) const {
+    const ModelTensorEntry& entry = entries_[index];
+    if (Crc32(file_.data() + entry.offset, static_cast<size_t>(entry.bytes)) != entry.data_crc) {
+        return Fail(error, path_ + ": tensor " + std::string(Name(entry)) + " checksum mismatch");
+    }
+    return true;
+}
+
+bool ModelFile::VerifyAll(std::string* error) const {
+    for (size_t i = 0; i < Count(); ++i) {
+        if (!Verify(i, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t ModelFile::DataBytes() const {
+    size_t total = 0;
+    for (size_t i = 0; i < Count(); ++i) {
+        total += static_cast<size_t>(entries_[i].bytes);
+    }
+    return total;
+}
+
+size_t ModelFile::ResidentBytes() const {
+    if (header_ == nullptr) {
+        return 0;
+    }
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t pages = (file_.size() + page - 1) / page;
+    std::vector<unsigned char> residency(pages);
+#ifdef __APPLE__
+    using MincoreVec = char;
+#else
+    using MincoreVec = unsigned char;
+#endif
+    if (mincore(const_cast<char*>(file_.data()), file_.size(), reinterpret_cast<MincoreVec*>(residency.data())) != 0) {
+        return 0;
+    }
+    size_t resident = 0;
+    for (unsigned char r : residency) {
+        resident += r & 1;
+    }
+    return std::min(resident * page, file_.size());
+}
+
+bool ModelFileWriter::Add(const std::string& name, ModelDType dtype, const std::vector<uint32_t>& dims,
+                          const void* data, size_t bytes) {
+    size_t element = ModelDTypeSize(dtype);
+    if (name.empty() || name.size() > 0xffff || element == 0 || dims.size() > static_cast<size_t>(kModelMaxRank)) {
+        return false;
+    }
+    uint64_t elements = 1;
+    for (uint32_t d : dims) {
+        elements *= d;
+    }
+    if (elements * element != bytes) {
+        return false;
+    }
+    Pending tensor;
+    tensor.name = name;
+    tensor.dtype = dtype;
+    tensor.dims = dims;
+    tensor.data.assign(static_cast<const char*>(data), bytes);
+    auto it = std::find_if(tensors_.begin(), tensors_.end(), [&](const Pending& p) { return p.name == name; });
+    if (it != tensors_.end()) {
+        *it = std::move(tensor);
+    } else {
+        tensors_.push_back(std::move(tensor));
+    }
+    return true;
+}
+
+bool ModelFileWriter::Write(const std::string& path, std::string* error) const {
+    std::vector<const Pending*> sorted;
+    for (const Pending& tensor : tensors_) {
+        sorted.push_back(&tensor);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Pending* a, const Pending* b) { return a->name < b->name; });
+
+    // 先排好布局，再整块写出
+    ModelFileHeader header = {};
+    memcpy(header.magic, kModelFileMagic, sizeof(header.magic));
+    header.version = kModelFileVersion;
+    header.count = static_cast<uint32_t>(sorted.size());
+    header.model_version = model_version_;
+    header.entries = sizeof(ModelFileHeader);
+    header.names = header.entries + sorted.size() * sizeof(ModelTensorEntry);
+    std::vector<ModelTensorEntry> entries(sorted.size());
+    std::string names;
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        const Pending& tensor = *sorted[i];
+        ModelTensorEntry& entry = entries[i];
+        entry = {};
+        entry.name = static_cast<uint32_t>(names.size());
+        entry.name_len = static_cast<uint16_t>(tensor.name.size());
+        entry.dtype = static_cast<uint8_t>(tensor.dtype);
+        entry.rank = static_cast<uint8_t>(tensor.dims.size());
+        for (int d = 0; d < kModelMaxRank; ++d) {
+            entry.dims[d] = static_cast<size_t>(d) < tensor.dims.size() ? tensor.dims[d] : 1;
+        }
+        entry.bytes = tensor.data.size();
+        entry.data_crc = Crc32(tensor.data.data(), tensor.data.size());
+        names += tensor.name;
+    }
+    size_t names_end = header.names + names.size();
+    size_t offset = AlignUp(names_end);
+    for (ModelTensorEntry& entry : entries) {
+        entry.offset = offset;
+        offset = AlignUp(offset + static_cast<size_t>(entry.bytes));
+    }
+    header.file_size = offset;
+
+    std::string image(offset, '\0');
+    memcpy(&image[0], &header, sizeof(header));
+    if (!entries.empty()) {
+        memcpy(&image[header.entries], entries.data(), entries.size() * sizeof(ModelTensorEntry));
+    }
+    memcpy(&image[header.names], names.data(), names.size());
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        memcpy(&image[entries[i].offset], sorted[i]->data.data(), sorted[i]->data.size());
+    }
+    header.header_crc = HeaderCrc(image.data(), header, names_end);
+    memcpy(&image[0], &header, sizeof(header));
+
+    std::string tmp = path + ".tmp";
+    FILE* file = fopen(tmp.c_str(), "wb");
+    if (file == nullptr) {
+        return Fail(error, "open " + tmp + " failed: " + strerror(errno));
+    }
+    bool ok = fwrite(image.data(), 1, image.size(), file) == image.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return Fail(error, "write " + path + " failed: " + strerror(errno));
+    }
+    return true;
+}
+
+}  // namespace linx
@@ -0,0 +1,437 @@
+#include "OggOpus.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace linx {
+
+namespace {
+
+constexpr size_t kPageHeaderSize = 27;
+constexpr size_t kMaxSegments = 255;
+constexpr uint8_t kFlagContinued = 0x01;
+constexpr uint8_t kFlagBos = 0x02;
+constexpr uint8_t kFlagEos = 0x04;
+
+void PutLE16(char* p, uint32_t v) {
+    p[0] = static_cast<char>(v);
+    p[1] = static_cast<char>(v >> 8);
+}
+
+void PutLE32(char* p, uint32_t v) {
+    PutLE16(p, v);
+    PutLE16(p + 2, v >> 16);
+}
+
+void PutLE64(char* p, uint64_t v) {
+    PutLE32(p, static_cast<uint32_t>(v));
+    PutLE32(p + 4, static_cast<uint32_t>(v >> 32));
+}
+
+uint32_t GetLE16(const char* p) {
+    const auto* u = reinterpret_cast<const unsigned char*>(p);
+    return u[0] | (static_cast<uint32_t>(u[1]) << 8);
+}
+
+uint32_t GetLE32(const char* p) {
+    return GetLE16(p) | (GetLE16(p + 2) << 16);
+}
+
+const uint32_t* CrcTable() {
+    static const auto table = []() {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t r = i << 24;
+            for (int k = 0; k < 8; ++k) {
+                r = (r & 0x80000000u) ? (r << 1) ^ 0x04c11db7u : r << 1;
+            }
+            t[i] = r;
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+}  // namespace
+
+uint32_t opusPacketSamples48k(const void* data, size_t len) {
+    if (len == 0) {
+        return 0;
+    }
+    const auto* p = static_cast<const unsigned char*>(data);
+    // TOC：高 5 位为配置（模式 + 帧长），低 2 位为帧数编码（RFC 6716 3.1）
+    unsigned config = p[0] >> 3;
+    uint32_t frame = 0;
+    if (config < 12) {  // SILK：10/20/40/60ms
+        static const uint32_t kSilk[] = {480, 960, 1920, 2880};
+        frame = kSilk[config & 3];
+    } else if (config < 16) {  // Hybrid：10/20ms
+        frame = (config & 1) ? 960 : 480;
+    } else {  // CELT：2.5/5/10/20ms
+        static const uint32_t kCelt[] = {120, 240, 480, 960};
+        frame = kCelt[config & 3];
+    }
+    uint32_t count = 0;
+    switch (p[0] & 3) {
+        case 0:
+            count = 1;
+            break;
+        case 1:
+        case 2:
+            count = 2;
+            break;
+        default:
+            if (len < 2) {
+                return 0;
+            }
+            count = p[1] & 0x3f;
+            break;
+    }
+    uint32_t samples = frame * count;
+    return samples <= 5760 ? samples : 0;  // 一个包最长 120ms
+}
+
+uint32_t oggCrc(const void* data, size_t len, uint32_t crc) {
+    const uint32_t* table = CrcTable();
+    const auto* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < len; ++i) {
+        crc = (crc << 8) ^ table[((crc >> 24) ^ p[i]) & 0xff];
+    }
+    return crc;
+}
+
+OggOpusWriter::~OggOpusWriter() { close(); }
+
+int OggOpusWriter::open(const std::string& filePath, const OggOpusInfo& info, unsigned int pageDurationMs) {
+    close();
+    if (async_) {
+        if (!async_->Open(filePath)) {
+            return -1;
+        }
+    } else {
+        fp_ = ::fopen(filePath.c_str(), "wb");
+        if (fp_ == nullptr) {
+            ERROR("fopen {} failed", filePath);
+            return -1;
+        }
+    }
+    serial_ = std::random_device()();
+    pageSeq_ = 0;
+    granule_ = 0;
+    pageSamples_ = 0;
+    maxPageSamples_ = std::max(1u, pageDurationMs) * 48;
+    lacing_.clear();
+    body_.clear();
+    bytes_ = 0;
+    packets_ = 0;
+    failed_ = false;
+
+    // 头页：OpusHead 单独一页（BOS），OpusTags 单独一页，两者的 granule 都为 0
+    char head[19];
+    memcpy(head, "OpusHead", 8);
+    head[8] = 1;  // version
+    head[9] = static_cast<char>(std::max(1, info.channels));
+    PutLE16(head + 10, info.preSkip);
+    PutLE32(head + 12, info.inputSampleRate);
+    PutLE16(head + 16, static_cast<uint32_t>(info.outputGain));
+    head[18] = 0;  // 映射族 0：单声道/立体声
+    std::vector<uint8_t> lacing{sizeof(head)};
+    if (!writePage(kFlagBos, 0, lacing, head, sizeof(head))) {
+        close();
+        return -1;
+    }
+
+    std::string vendor = info.vendor.empty() ? "linx" : info.vendor;
+    std::vector<char> tags(8 + 4 + vendor.size() + 4);
+    memcpy(tags.data(), "OpusTags", 8);
+    PutLE32(tags.data() + 8, static_cast<uint32_t>(vendor.size()));
+    memcpy(tags.data() + 12, vendor.data(), vendor.size());
+    PutLE32(tags.data() + 12 + vendor.size(), 0);  // 没有用户注释
+    lacing.assign(tags.size() / 255, 255);
+    lacing.push_back(static_cast<uint8_t>(tags.size() % 255));
+    if (lacing.size() > kMaxSegments || !writePage(0, 0, lacing, tags.data(), tags.size())) {
+        close();
+        return -1;
+    }
+    return 0;
+}
+
+bool OggOpusWriter::writePacket(const void* data, size_t len) {
+    if (!valid() || failed_) {
+        return false;
+    }
+    uint32_t samples = opusPacketSamples48k(data, len);
+    size_t segments = len / 255 + 1;
+    if (samples == 0 || segments > kMaxSegments) {
+        return false;
+    }
+    if (lacing_.size() + segments > kMaxSegments && !flushPage(false)) {
+        return false;
+    }
+    lacing_.insert(lacing_.end(), segments - 1, 255);
+    lacing_.push_back(static_cast<uint8_t>(len % 255));
+    const char* bytes = static_cast<const char*>(data);
+    body_.insert(body_.end(), bytes, bytes + len);
+    granule_ += samples;
+    pageSamples_ += samples;
+    packets_++;
+    if (pageSamples_ >= maxPageSamples_) {
+        return flushPage(false);
+    }
+    return true;
+}
+
+bool OggOpusWriter::flushPage(bool eos) {
+    if (lacing_.empty() && !eos) {
+        return true;
+    }
+    // 页的 granule 为结束于本页的最后一个包之后的位置
+    bool ok = writePage(eos ? kFlagEos : 0, granule_, lacing_, body_.data(), body_.size());
+    lacing_.clear();
+    body_.clear();
+    pageSamples_ = 0;
+    return ok;
+}
+
+bool OggOpusWriter::writePage(uint8_t flags, uint64_t granule, const std::vector<uint8_t>& lacing,
+                              const void* body, size_t bodyLen) {
+    page_.resize(kPageHeaderSize + lacing.size() + bodyLen);
+    char* p = page_.data();
+    memcpy(p, "OggS", 4);
+    p[4] = 0;  // version
+    p[5] = static_cast<char>(flags);
+    PutLE64(p + 6, granule);
+    PutLE32(p + 14, serial_);
+    PutLE32(p + 18, pageSeq_++);
+    PutLE32(p + 22, 0);
+    p[26] = static_cast<char>(lacing.size());
+    if (!lacing.empty()) {
+        memcpy(p + kPageHeaderSize, lacing.data(), lacing.size());
+    }
+    if (bodyLen > 0) {
+        memcpy(p + kPageHeaderSize + lacing.size(), body, bodyLen);
+    }
+    PutLE32(p + 22, oggCrc(p, page_.size()));
+    bool written = async_ ? async_->Write(p, page_.size()) : ::fwrite(p, 1, page_.size(), fp_) == page_.size();
+    if (!written) {
+        failed_ = true;
+        return false;
+    }
+    bytes_ += page_.size();
+    return true;
+}
+
+void OggOpusWriter::close() {
+    if (!valid()) {
+        return;
+    }
+    if (!failed_) {
+        flushPage(true);
+    }
+    if (async_) {
+        failed_ = !async_->Close() || failed_;
+        return;
+    }
+    ::fclose(fp_);
+    fp_ = nullptr;
+}
+
+void OggOpusWriter::setAsync(const AsyncFileWriterConfig& config) {
+    close();
+    async_ = std::make_unique<AsyncFileWriter>(config);
+}
+
+void OggOpusWriter::flush() {
+    if (async_ && async_->IsOpen()) {
+        async_->Flush();
+    }
+}
+
+int OggOpusReader::open(const std::string& filePath) {
+    close();
+    if (file_.open(filePath) != 0) {
+        return -1;
+    }
+    if (!readHeaders()) {
+        ERROR("{} is not an Ogg/Opus file", filePath);
+        close();
+        return -1;
+    }
+    return 0;
+}
+
+void OggOpusReader::close() {
+    file_.close();
+    info_ = OggOpusInfo();
+    haveSerial_ = false;
+    offset_ = 0;
+    seg_ = nullptr;
+    segCount_ = segIndex_ = 0;
+    partial_.clear();
+    inPartial_ = false;
+    skipContinued_ = false;
+    position_ = 0;
+    corrupt_ = 0;
+}
+
+void OggOpusReader::rewind() {
+    if (!valid()) {
+        return;
+    }
+    haveSerial_ = false;
+    offset_ = 0;
+    seg_ = nullptr;
+    segCount_ = segIndex_ = 0;
+    partial_.clear();
+    inPartial_ = false;
+    skipContinued_ = false;
+    position_ = 0;
+    readHeaders();
+}
+
+bool OggOpusReader::readHeaders() {
+    std::string_view packet;
+    if (!nextRawPacket(&packet) || packet.size() < 19 || packet.compare(0, 8, "OpusHead") != 0 ||
+        (packet[8] & 0xF0) != 0) {
+        return false;
+    }
+    info_.channels = static_cast<unsigned char>(packet[9]);
+    info_.preSkip = GetLE16(packet.data() + 10);
+    info_.inputSampleRate = GetLE32(packet.data() + 12);
+    info_.outputGain = static_cast<int16_t>(GetLE16(packet.data() + 16));
+    if (!nextRawPacket(&packet) || packet.size() < 12 || packet.compare(0, 8, "OpusTags") != 0) {
+        return false;
+    }
+    size_t vendorLen = GetLE32(packet.data() + 8);
+    info_.vendor = std::string(packet.substr(12, std::min(vendorLen, packet.size() - 12)));
+    return true;
+}
+
+bool OggOpusReader::nextPage() {
+    const char* data = file_.data();
+    size_t size = file_.size();
+    while (offset_ + kPageHeaderSize <= size) {
+        const char* found = static_cast<const char*>(memmem(data + offset_, size - offset_, "OggS", 4));
+        if (found == nullptr) {
+            break;
+        }
+        size_t pos = found - data;
+        offset_ = pos + 1;  // 本页无效时从下一个字节继续找
+        if (pos + kPageHeaderSize > size || data[pos + 4] != 0) {
+            continue;
+        }
+        size_t nsegs = static_cast<unsigned char>(data[pos + 26]);
+        if (pos + kPageHeaderSize + nsegs > size) {
+            break;
+        }
+        const auto* lacing = reinterpret_cast<const uint8_t*>(data + pos + kPageHeaderSize);
+        size_t bodyLen = 0;
+        for (size_t i = 0; i < nsegs; ++i) {
+            bodyLen += lacing[i];
+        }
+        size_t pageLen = kPageHeaderSize + nsegs + bodyLen;
+        if (pos + pageLen > size) {
+            break;  // 截断的最后一页（边录边写）
+        }
+        // 校验时 CRC 字段按 0 计算
+        static const char kZero[4] = {0, 0, 0, 0};
+        uint32_t crc = oggCrc(data + pos, 22);
+        crc = oggCrc(kZero, 4, crc);
+        crc = oggCrc(data + pos + 26, pageLen - 26, crc);
+        if (crc != GetLE32(data + pos + 22)) {
+            corrupt_++;
+            partial_.clear();
+            inPartial_ = false;
+            continue;
+        }
+        uint8_t flags = static_cast<uint8_t>(data[pos + 5]);
+        uint32_t serial = GetLE32(data + pos + 14);
+        if (!haveSerial_) {
+            if (!(flags & kFlagBos)) {
+                offset_ = pos + pageLen;
+                continue;
+            }
+            haveSerial_ = true;
+            serial_ = serial;
+        } else if (serial != serial_) {
+            offset_ = pos + pageLen;  // 其他逻辑流
+            continue;
+        }
+        offset_ = pos + pageLen;
+        seg_ = lacing;
+        segCount_ = nsegs;
+        segIndex_ = 0;
+        body_ = data + pos + kPageHeaderSize + nsegs;
+        bodyPos_ = 0;
+        // 接续标志与拼接状态不一致：丢弃不完整的包
+        bool continued = flags & kFlagContinued;
+        if (continued && !inPartial_) {
+            skipContinued_ = true;
+        } else if (!continued && inPartial_) {
+            partial_.clear();
+            inPartial_ = false;
+        }
+        return true;
+    }
+    offset_ = size;
+    return false;
+}
+
+bool OggOpusReader::nextRawPacket(std::string_view* packet) {
+    while (true) {
+        if (seg_ == nullptr || segIndex_ == segCount_) {
+            if (!nextPage()) {
+                return false;
+            }
+            continue;
+        }
+        size_t start = bodyPos_;
+        size_t len = 0;
+        bool complete = false;
+        while (segIndex_ < segCount_) {
+            uint8_t s = seg_[segIndex_++];
+            len += s;
+            if (s < 255) {
+                complete = true;
+                break;
+            }
+        }
+        bodyPos_ += len;
+        std::string_view span(body_ + start, len);
+        if (skipContinued_) {
+            skipContinued_ = !complete;
+            continue;
+        }
+        if (!complete) {
+            if (!inPartial_) {
+                partial_.clear();
+                inPartial_ = true;
+            }
+            partial_.append(span.data(), span.size());
+            continue;
+        }
+        if (inPartial_) {
+            partial_.append(span.data(), span.size());
+            inPartial_ = false;
+            *packet = partial_;
+        } else {
+            *packet = span;
+        }
+        return true;
+    }
+}
+
+bool OggOpusReader::readPacket(std::string_view* packet) {
+    while (nextRawPacket(packet)) {
+        uint32_t samples = opusPacketSamples48k(packet->data(), packet->size());
+        if (samples == 0) {
+            continue;  // 空包或无效的 TOC
+        }
+        position_ += samples;
+        return true;
+    }
+    return false;
+}
+
+}  // namespace linx
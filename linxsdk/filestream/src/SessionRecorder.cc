@@ -0,0 +1,404 @@
+#include "SessionRecorder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+namespace linx {
+
+namespace {
+
+const char* const kStreamNames[] = {"mic", "playout"};
+
+// 会话 ID 来自服务器，只保留适合做文件名的字符
+std::string SanitizeFileName(const std::string& name) {
+    std::string out;
+    out.reserve(name.size());
+    for (char c : name) {
+        bool ok = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '-' || c == '_';
+        out.push_back(ok ? c : '_');
+    }
+    return out;
+}
+
+}  // namespace
+
+SessionRecorder::SessionRecorder(const SessionRecorderConfig& config) : config_(config) {
+    config_.channels = std::max(config_.channels, 1);
+    if (config_.format == RecordFormat::OggOpus) {
+        // 包的大小随码率变化，按 128kbps（16 字节/ms）留足余量
+        capacity_ = std::max<size_t>(static_cast<size_t>(config_.buffer_duration.count()) * 16, 16384);
+        max_samples_ = static_cast<size_t>(48000) * config_.max_file_duration.count();
+    } else {
+        capacity_ = static_cast<size_t>(config_.sample_rate) * config_.channels * config_.buffer_duration.count() / 1000;
+        capacity_ = std::max<size_t>(capacity_, 1024);
+        max_samples_ = static_cast<size_t>(config_.sample_rate) * config_.channels * config_.max_file_duration.count();
+    }
+    for (StreamState& stream : streams_) {
+        // 一次性分配：交换只交换指针，容量随缓冲区一起保留
+        if (config_.format == RecordFormat::OggOpus) {
+            stream.packets.reserve(capacity_);
+            stream.packets_back.reserve(capacity_);
+        } else {
+            stream.front.reserve(capacity_);
+            stream.back.reserve(capacity_);
+        }
+        if (config_.async_io && config_.format == RecordFormat::OggOpus) {
+            stream.ogg.setAsync(config_.io);
+        }
+    }
+}
+
+SessionRecorder::~SessionRecorder() { Stop(); }
+
+void SessionRecorder::Start() {
+    std::lock_guard<ProfiledMutex> lock(control_mutex_);
+    if (thread_.joinable()) {
+        return;
+    }
+    stop_ = false;
+    thread_ = std::thread(&SessionRecorder::Run, this);
+}
+
+void SessionRecorder::Stop() {
+    {
+        std::lock_guard<ProfiledMutex> lock(control_mutex_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void SessionRecorder::StartSession(const std::string& session_id) {
+    // 记下边界：此刻之前推入的样本属于上一个会话，之后的属于新会话
+    uint64_t boundary[kStreams];
+    for (size_t i = 0; i < kStreams; ++i) {
+        std::lock_guard<ProfiledMutex> lock(streams_[i].mutex);
+        boundary[i] = streams_[i].pushed;
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(control_mutex_);
+        pending_session_ = session_id;
+        std::copy(boundary, boundary + kStreams, pending_boundary_);
+        session_pending_ = true;
+    }
+    cv_.notify_one();
+}
+
+bool SessionRecorder::Push(RecordStream stream, const short* pcm, size_t samples) {
+    if (config_.format != RecordFormat::Wav) {
+        return true;
+    }
+    StreamState& state = streams_[static_cast<size_t>(stream)];
+    size_t accepted = 0;
+    bool wake = false;
+    {
+        std::lock_guard<ProfiledMutex> lock(state.mutex);
+        accepted = std::min(samples, capacity_ - state.front.size());
+        if (pcm != nullptr) {
+            state.front.insert(state.front.end(), pcm, pcm + accepted);
+        } else {
+            state.front.resize(state.front.size() + accepted, 0);
+        }
+        state.pushed += accepted;
+        wake = state.front.size() >= capacity_ / 2;
+    }
+    if (wake && !flush_wanted_.exchange(true)) {
+        cv_.notify_one();  // 缓冲区过半，不等 flush_interval
+    }
+    if (accepted < samples) {
+        samples_dropped_.fetch_add(samples - accepted, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+bool SessionRecorder::PushPacket(RecordStream stream, const unsigned char* data, size_t len) {
+    if (config_.format != RecordFormat::OggOpus) {
+        return true;
+    }
+    if (len == 0 || len > 0xffff) {
+        packets_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    StreamState& state = streams_[static_cast<size_t>(stream)];
+    bool accepted = false;
+    bool wake = false;
+    {
+        std::lock_guard<ProfiledMutex> lock(state.mutex);
+        if (state.packets.size() + 2 + len <= capacity_) {
+            state.packets.push_back(static_cast<unsigned char>(len >> 8));
+            state.packets.push_back(static_cast<unsigned char>(len));
+            state.packets.insert(state.packets.end(), data, data + len);
+            state.pushed++;
+            accepted = true;
+        }
+        wake = state.packets.size() >= capacity_ / 2;
+    }
+    if (wake && !flush_wanted_.exchange(true)) {
+        cv_.notify_one();
+    }
+    if (!accepted) {
+        packets_dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return accepted;
+}
+
+void SessionRecorder::Run() {
+    std::unique_lock<ProfiledMutex> lock(control_mutex_);
+    while (true) {
+        cv_.wait_for(lock, config_.flush_interval,
+                     [this]() { return stop_ || session_pending_ || flush_wanted_.load(); });
+        flush_wanted_ = false;
+        bool stop = stop_;
+        bool switch_session = session_pending_;
+        std::string next = pending_session_;
+        uint64_t boundary[kStreams];
+        std::copy(pending_boundary_, pending_boundary_ + kStreams, boundary);
+        session_pending_ = false;
+        lock.unlock();
+
+        if (switch_session) {
+            // 边界之前的数据写进上一个会话的文件，之后的留给新会话
+            for (size_t i = 0; i < kStreams; ++i) {
+                Drain(i, boundary[i]);
+                CloseFile(i);
+                streams_[i].part = 0;
+            }
+            session_ = SanitizeFileName(next);
+            if (!session_.empty()) {
+                INFO("session recorder: recording session {}", next);
+            }
+        }
+        for (size_t i = 0; i < kStreams; ++i) {
+            Drain(i, UINT64_MAX);
+        }
+        FlushFiles();
+        if (stop) {
+            for (size_t i = 0; i < kStreams; ++i) {
+                CloseFile(i);
+            }
+            return;
+        }
+        lock.lock();
+    }
+}
+
+void SessionRecorder::Drain(size_t index, uint64_t until) {
+    if (config_.format == RecordFormat::OggOpus) {
+        DrainPackets(index, until);
+        return;
+    }
+    StreamState& state = streams_[index];
+    // back 中可能留有边界之后的数据，最多再交换一次就能取到边界（或当前）为止的全部数据
+    for (int swaps = 0; swaps < 2 && state.drained < until; ++swaps) {
+        if (state.back_pos == state.back.size()) {
+            state.back.clear();
+            state.back_pos = 0;
+            std::lock_guard<ProfiledMutex> lock(state.mutex);
+            state.front.swap(state.back);
+        }
+        size_t available = state.back.size() - state.back_pos;
+        if (available == 0) {
+            break;
+        }
+        size_t n = static_cast<size_t>(std::min<uint64_t>(available, until - state.drained));
+        Write(index, state.back.data() + state.back_pos, n);
+        state.back_pos += n;
+        state.drained += n;
+    }
+}
+
+void SessionRecorder::DrainPackets(size_t index, uint64_t until) {
+    StreamState& state = streams_[index];
+    for (int swaps = 0; swaps < 2 && state.drained < until; ++swaps) {
+        if (state.back_pos == state.packets_back.size()) {
+            state.packets_back.clear();
+            state.back_pos = 0;
+            std::lock_guard<ProfiledMutex> lock(state.mutex);
+            state.packets.swap(state.packets_back);
+        }
+        const PacketBuffer& back = state.packets_back;
+        while (state.back_pos < back.size() && state.drained < until) {
+            size_t len = (static_cast<size_t>(back[state.back_pos]) << 8) | back[state.back_pos + 1];
+            WritePacket(index, back.data() + state.back_pos + 2, len);
+            state.back_pos += 2 + len;
+            state.drained++;
+        }
+        if (state.back_pos < back.size()) {
+            break;  // 到达边界
+        }
+    }
+}
+
+void SessionRecorder::WritePacket(size_t index, const unsigned char* data, size_t len) {
+    StreamState& state = streams_[index];
+    if (session_.empty()) {
+        return;
+    }
+    if (state.open && ((config_.max_file_bytes > 0 && state.ogg.bytesWritten() + len > config_.max_file_bytes) ||
+                       (max_samples_ > 0 && state.ogg.granule() >= max_samples_))) {
+        CloseFile(index);
+        state.part++;
+    }
+    if (!state.open) {
+        OpenFile(index);
+        if (!state.open) {
+            return;
+        }
+    }
+    uint64_t before = state.ogg.bytesWritten();
+    bool ok = state.ogg.writePacket(data, len);
+    bytes_written_.fetch_add(state.ogg.bytesWritten() - before, std::memory_order_relaxed);
+    if (!ok) {
+        if (state.ogg.failed()) {
+            write_errors_.fetch_add(1, std::memory_order_relaxed);
+            WARN_EVERY(10000, "session recorder: write to {} failed", FilePath(index));
+        } else {
+            packets_dropped_.fetch_add(1, std::memory_order_relaxed);  // TOC 无效
+        }
+        return;
+    }
+    packets_recorded_.fetch_add(1, std::memory_order_relaxed);
+    samples_recorded_.fetch_add(opusPacketSamples48k(data, len) * config_.sample_rate / 48000 * config_.channels,
+                                std::memory_order_relaxed);
+}
+
+void SessionRecorder::Write(size_t index, const short* data, size_t samples) {
+    StreamState& state = streams_[index];
+    if (session_.empty() || samples == 0) {
+        return;  // 没有会话：丢弃
+    }
+    // 每个分段的样本数上限（整帧），按大小和时长两者中较小的一个
+    size_t per_file = SIZE_MAX;
+    if (config_.max_file_bytes > 0) {
+        per_file = config_.max_file_bytes / sizeof(short);
+    }
+    if (max_samples_ > 0) {
+        per_file = std::min(per_file, max_samples_);
+    }
+    per_file = std::max<size_t>(per_file - per_file % config_.channels, config_.channels);
+
+    size_t left = samples;
+    while (left > 0) {
+        if (!state.open) {
+            OpenFile(index);
+            if (!state.open) {
+                return;
+            }
+        }
+        size_t in_file = state.bytes / sizeof(short);
+        if (in_file >= per_file) {
+            CloseFile(index);
+            state.part++;
+            continue;
+        }
+        size_t limit = std::min(left, per_file - in_file);
+        int written = state.file.fwrite(const_cast<short*>(data), sizeof(short), static_cast<int>(limit));
+        if (written != static_cast<int>(limit)) {
+            write_errors_.fetch_add(1, std::memory_order_relaxed);
+            WARN_EVERY(10000, "session recorder: write to {} failed", FilePath(index));
+            return;
+        }
+        state.bytes += limit * sizeof(short);
+        bytes_written_.fetch_add(limit * sizeof(short), std::memory_order_relaxed);
+        samples_recorded_.fetch_add(limit, std::memory_order_relaxed);
+        data += limit;
+        left -= limit;
+    }
+}
+
+std::string SessionRecorder::FilePath(size_t index) const {
+    char part[16];
+    snprintf(part, sizeof(part), "%03d", streams_[index].part);
+    const char* ext = config_.format == RecordFormat::OggOpus ? ".opus" : ".wav";
+    return config_.directory + "/" + session_ + "-" + kStreamNames[index] + "-" + part + ext;
+}
+
+void SessionRecorder::OpenFile(size_t index) {
+    StreamState& state = streams_[index];
+    std::string path = FilePath(index);
+    if (config_.format == RecordFormat::OggOpus) {
+        OggOpusInfo info;
+        info.channels = config_.channels;
+        info.inputSampleRate = config_.sample_rate;
+        if (state.ogg.open(path, info) != 0) {
+            write_errors_.fetch_add(1, std::memory_order_relaxed);
+            WARN_EVERY(10000, "session recorder: cannot create {}", path);
+            return;
+        }
+        bytes_written_.fetch_add(state.ogg.bytesWritten(), std::memory_order_relaxed);  // 头页
+        state.open = true;
+        return;
+    }
+    int opened = config_.async_io ? state.file.wavfopenAsync(path, config_.io) : state.file.wavfopen(path, "wb");
+    if (opened != 0 || !state.file.valid()) {
+        write_errors_.fetch_add(1, std::memory_order_relaxed);
+        WARN_EVERY(10000, "session recorder: cannot create {}", path);
+        return;
+    }
+    state.open = true;
+    state.bytes = 0;
+}
+
+void SessionRecorder::CloseFile(size_t index) {
+    StreamState& state = streams_[index];
+    if (!state.open) {
+        return;
+    }
+    if (config_.format == RecordFormat::OggOpus) {
+        uint64_t before = state.ogg.bytesWritten();
+        state.ogg.close();  // 写出最后一页（EOS）
+        bytes_written_.fetch_add(state.ogg.bytesWritten() - before, std::memory_order_relaxed);
+        state.open = false;
+        files_written_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // 以实际的采样率和声道数补全 WAV 头
+    state.file.wavfclose(static_cast<int>(state.bytes), config_.channels, config_.sample_rate);
+    state.open = false;
+    files_written_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SessionRecorder::FlushFiles() {
+    if (!config_.async_io) {
+        return;
+    }
+    // 每轮写完提交一次：文件内容最多落后 flush_interval，与 stdio 缓冲时相当
+    uint64_t stalls = 0;
+    for (StreamState& state : streams_) {
+        const AsyncFileWriter* writer = nullptr;
+        if (config_.format == RecordFormat::OggOpus) {
+            if (state.open) {
+                state.ogg.flush();
+            }
+            writer = state.ogg.asyncWriter();
+        } else {
+            if (state.open) {
+                state.file.fflush();
+            }
+            writer = state.file.asyncWriter();
+        }
+        if (writer != nullptr) {
+            stalls += writer->GetStats().stalls;
+        }
+    }
+    io_stalls_.store(stalls, std::memory_order_relaxed);
+}
+
+SessionRecorderStats SessionRecorder::GetStats() const {
+    SessionRecorderStats stats;
+    stats.samples_recorded = samples_recorded_.load(std::memory_order_relaxed);
+    stats.samples_dropped = samples_dropped_.load(std::memory_order_relaxed);
+    stats.packets_recorded = packets_recorded_.load(std::memory_order_relaxed);
+    stats.packets_dropped = packets_dropped_.load(std::memory_order_relaxed);
+    stats.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+    stats.files_written = files_written_.load(std::memory_order_relaxed);
+    stats.write_errors = write_errors_.load(std::memory_order_relaxed);
+    stats.io_stalls = io_stalls_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace linx
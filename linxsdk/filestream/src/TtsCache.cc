@@ -0,0 +1,368 @@
+#include "TtsCache.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+
+#include "Log.h"
+#include "MemoryAccounting.h"
+
+namespace linx {
+
+namespace {
+
+// 缓存文件布局（小端、与写入进程同一 ABI）：文件头，之后是 packets 个 uint32 结束位置，再之后是包数据
+constexpr char kTtsCacheMagic[8] = {'L', 'I', 'N', 'X', 'T', 'T', 'S', '\0'};
+constexpr uint32_t kTtsCacheVersion = 1;
+constexpr const char* kTtsCacheSuffix = ".tts";
+
+struct TtsCacheFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t packets;
+    uint64_t key;
+    uint32_t data_bytes;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(TtsCacheFileHeader) == 32, "tts cache file header layout");
+
+// 逐级创建目录（缓存目录的上级可能还不存在）
+bool MakeDirs(const std::string& dir) {
+    for (size_t pos = 1; pos <= dir.size(); ++pos) {
+        if (pos != dir.size() && dir[pos] != '/') {
+            continue;
+        }
+        std::string prefix = dir.substr(0, pos);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+            WARN("tts cache: mkdir {} failed: {}", prefix, strerror(errno));
+            return false;
+        }
+    }
+    return true;
+}
+
+// "<16 位十六进制>.tts" 形式的文件名，解析出键
+bool ParseFileName(const char* name, uint64_t* key) {
+    size_t len = strlen(name);
+    size_t suffix = strlen(kTtsCacheSuffix);
+    if (len != 16 + suffix || strcmp(name + 16, kTtsCacheSuffix) != 0) {
+        return false;
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < 16; ++i) {
+        char c = name[i];
+        int digit = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+        if (digit < 0) {
+            return false;
+        }
+        value = (value << 4) | static_cast<uint64_t>(digit);
+    }
+    *key = value;
+    return true;
+}
+
+}  // namespace
+
+TtsCache::TtsCache(const TtsCacheConfig& config) : config_(config) {
+    while (config_.dir.size() > 1 && config_.dir.back() == '/') {
+        config_.dir.pop_back();
+    }
+    if (!config_.dir.empty()) {
+        LoadIndex();
+    }
+}
+
+TtsCache::~TtsCache() {
+    AccountMemory(MemoryTag::Recording, -static_cast<int64_t>(memory_bytes_));
+}
+
+uint64_t TtsCache::MakeKey(std::string_view text, std::string_view variant) {
+    // FNV-1a，文本与 variant 之间插入一个不会出现在 UTF-8 中的字节，避免拼接歧义
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](unsigned char c) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    };
+    for (char c : text) {
+        mix(static_cast<unsigned char>(c));
+    }
+    mix(0xff);
+    for (char c : variant) {
+        mix(static_cast<unsigned char>(c));
+    }
+    return hash;
+}
+
+bool TtsCache::Cacheable(std::string_view text) const {
+    return !text.empty() && text.size() <= config_.max_text_bytes;
+}
+
+std::string TtsCache::PathFor(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx%s", static_cast<unsigned long long>(key), kTtsCacheSuffix);
+    return config_.dir + "/" + name;
+}
+
+void TtsCache::LoadIndex() {
+    DIR* dir = opendir(config_.dir.c_str());
+    if (dir == nullptr) {
+        return;  // 第一次 Commit 时创建
+    }
+    std::vector<std::tuple<int64_t, uint64_t, size_t>> files;  // 修改时间（纳秒）、键、大小
+    while (struct dirent* item = readdir(dir)) {
+        std::string path = config_.dir + "/" + item->d_name;
+        size_t len = strlen(item->d_name);
+        if (len > 4 && strcmp(item->d_name + len - 4, ".tmp") == 0) {
+            unlink(path.c_str());  // 上次写到一半的临时文件
+            continue;
+        }
+        uint64_t key = 0;
+        struct stat st;
+        if (!ParseFileName(item->d_name, &key) || stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        int64_t mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        files.emplace_back(mtime, key, static_cast<size_t>(st.st_size));
+    }
+    closedir(dir);
+
+    std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) { return std::get<0>(a) > std::get<0>(b); });
+    for (const auto& file : files) {
+        Node node;
+        node.disk_bytes = std::get<2>(file);
+        lru_.push_back(std::get<1>(file));
+        node.lru = std::prev(lru_.end());
+        nodes_.emplace(std::get<1>(file), std::move(node));
+        disk_bytes_ += std::get<2>(file);
+    }
+    if (!lru_.empty()) {
+        EnforceBudgets(lru_.front());  // 预算调小后，多出的旧文件在这里删除
+    }
+    INFO("tts cache: {} entries ({} bytes) in {}", nodes_.size(), disk_bytes_, config_.dir);
+}
+
+std::shared_ptr<TtsCacheEntry> TtsCache::ReadFile(uint64_t key) const {
+    std::string path = PathFor(key);
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return nullptr;
+    }
+    auto entry = std::make_shared<TtsCacheEntry>();
+    TtsCacheFileHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, kTtsCacheMagic, 8) == 0 &&
+              header.version == kTtsCacheVersion && header.key == key && header.packets > 0 &&
+              header.data_bytes <= config_.max_entry_bytes;
+    if (ok) {
+        entry->ends.resize(header.packets);
+        entry->data.resize(header.data_bytes);
+        ok = fread(entry->ends.data(), sizeof(uint32_t), header.packets, file) == header.packets &&
+             fread(entry->data.data(), 1, header.data_bytes, file) == header.data_bytes;
+    }
+    fclose(file);
+    // 结束位置须递增且最后一个等于数据长度，Packet() 才不会越界
+    for (size_t i = 0; ok && i < entry->ends.size(); ++i) {
+        uint32_t begin = i == 0 ? 0 : entry->ends[i - 1];
+        ok = entry->ends[i] > begin && entry->ends[i] <= header.data_bytes;
+    }
+    ok = ok && entry->ends.back() == header.data_bytes;
+    if (!ok) {
+        WARN("tts cache: {} is corrupt, removed", path);
+        unlink(path.c_str());
+        return nullptr;
+    }
+    return entry;
+}
+
+size_t TtsCache::WriteFile(uint64_t key, const TtsCacheEntry& entry) const {
+    if (!MakeDirs(config_.dir)) {
+        return 0;
+    }
+    TtsCacheFileHeader header = {};
+    memcpy(header.magic, kTtsCacheMagic, sizeof(header.magic));
+    header.version = kTtsCacheVersion;
+    header.packets = static_cast<uint32_t>(entry.ends.size());
+    header.key = key;
+    header.data_bytes = static_cast<uint32_t>(entry.data.size());
+
+    std::string path = PathFor(key);
+    std::string tmp = path + ".tmp";
+    FILE* file = fopen(tmp.c_str(), "wb");
+    if (file == nullptr) {
+        WARN("tts cache: open {} failed: {}", tmp, strerror(errno));
+        return 0;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(entry.ends.data(), sizeof(uint32_t), entry.ends.size(), file) == entry.ends.size() &&
+              fwrite(entry.data.data(), 1, entry.data.size(), file) == entry.data.size();
+    // 不做 fsync：掉电时最多丢失这一条，下次重新录制；rename 保证不会读到半个文件
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        WARN("tts cache: write {} failed: {}", path, strerror(errno));
+        unlink(tmp.c_str());
+        return 0;
+    }
+    return sizeof(header) + entry.ends.size() * sizeof(uint32_t) + entry.data.size();
+}
+
+void TtsCache::AddMemory(int64_t delta) {
+    memory_bytes_ = static_cast<size_t>(static_cast<int64_t>(memory_bytes_) + delta);
+    AccountMemory(MemoryTag::Recording, delta);
+}
+
+void TtsCache::Touch(Node& node, uint64_t key) {
+    lru_.splice(lru_.begin(), lru_, node.lru);
+    if (node.disk_bytes > 0) {
+        // 修改时间即磁盘上的使用顺序，重启后据此恢复 LRU
+        utimensat(AT_FDCWD, PathFor(key).c_str(), nullptr, 0);
+    }
+}
+
+void TtsCache::Erase(std::unordered_map<uint64_t, Node>::iterator it) {
+    Node& node = it->second;
+    if (node.entry) {
+        AddMemory(-static_cast<int64_t>(node.entry->Bytes()));
+    }
+    if (node.disk_bytes > 0) {
+        disk_bytes_ -= node.disk_bytes;
+        unlink(PathFor(it->first).c_str());
+    }
+    lru_.erase(node.lru);
+    nodes_.erase(it);
+}
+
+void TtsCache::EnforceBudgets(uint64_t keep) {
+    // 从最久未用的一端往前：磁盘超预算时删除条目；内存超预算时只释放内存中的副本，没有磁盘文件的才整条删除
+    auto it = lru_.end();
+    while (it != lru_.begin() &&
+           (memory_bytes_ > config_.memory_budget_bytes || disk_bytes_ > config_.disk_budget_bytes)) {
+        --it;
+        if (*it == keep) {
+            continue;
+        }
+        auto node = nodes_.find(*it);
+        bool drop_disk = disk_bytes_ > config_.disk_budget_bytes && node->second.disk_bytes > 0;
+        bool drop_memory = memory_bytes_ > config_.memory_budget_bytes && node->second.entry;
+        if (drop_disk || (drop_memory && node->second.disk_bytes == 0)) {
+            it = std::next(it);  // Erase 删除当前元素，从它后面一个继续往前
+            Erase(node);
+            stats_.evictions++;
+        } else if (drop_memory) {
+            AddMemory(-static_cast<int64_t>(node->second.entry->Bytes()));
+            node->second.entry.reset();
+        }
+    }
+}
+
+std::shared_ptr<const TtsCacheEntry> TtsCache::Find(uint64_t key) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    auto it = nodes_.find(key);
+    if (it == nodes_.end()) {
+        stats_.misses++;
+        return nullptr;
+    }
+    Node& node = it->second;
+    if (!node.entry) {
+        std::shared_ptr<TtsCacheEntry> entry = ReadFile(key);
+        if (!entry) {
+            node.disk_bytes = 0;  // 文件已不存在或已在 ReadFile 中删除
+            Erase(it);
+            stats_.misses++;
+            return nullptr;
+        }
+        node.entry = std::move(entry);
+        AddMemory(static_cast<int64_t>(node.entry->Bytes()));
+        stats_.disk_hits++;
+    }
+    stats_.hits++;
+    Touch(node, key);
+    std::shared_ptr<const TtsCacheEntry> entry = node.entry;
+    EnforceBudgets(key);
+    return entry;
+}
+
+void TtsCache::BeginRecord(uint64_t key) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    record_.reset();
+    recording_ = nodes_.find(key) == nodes_.end();
+    if (recording_) {
+        record_key_ = key;
+        record_ = std::make_shared<TtsCacheEntry>();
+    }
+}
+
+void TtsCache::Append(const unsigned char* data, size_t len) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    if (!recording_ || len == 0) {
+        return;
+    }
+    if (record_->data.size() + len > config_.max_entry_bytes) {
+        stats_.rejected++;
+        recording_ = false;
+        record_.reset();
+        return;
+    }
+    record_->data.insert(record_->data.end(), data, data + len);
+    record_->ends.push_back(static_cast<uint32_t>(record_->data.size()));
+}
+
+bool TtsCache::Commit() {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    bool recording = recording_;
+    recording_ = false;
+    std::shared_ptr<TtsCacheEntry> entry = std::move(record_);
+    if (!recording || entry->ends.empty() || nodes_.find(record_key_) != nodes_.end()) {
+        return false;
+    }
+    Node node;
+    node.entry = entry;
+    AddMemory(static_cast<int64_t>(entry->Bytes()));
+    if (!config_.dir.empty()) {
+        node.disk_bytes = WriteFile(record_key_, *entry);
+        disk_bytes_ += node.disk_bytes;
+    }
+    lru_.push_front(record_key_);
+    node.lru = lru_.begin();
+    nodes_.emplace(record_key_, std::move(node));
+    stats_.stores++;
+    EnforceBudgets(record_key_);
+    return true;
+}
+
+void TtsCache::AbortRecord() {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    recording_ = false;
+    record_.reset();
+}
+
+bool TtsCache::Recording() const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    return recording_;
+}
+
+void TtsCache::Clear() {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    while (!nodes_.empty()) {
+        Erase(nodes_.begin());
+    }
+    recording_ = false;
+    record_.reset();
+}
+
+TtsCacheStats TtsCache::GetStats() const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    TtsCacheStats stats = stats_;
+    stats.memory_bytes = memory_bytes_;
+    stats.disk_bytes = disk_bytes_;
+    stats.entries = nodes_.size();
+    return stats;
+}
+
+}  // namespace linx
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <openssl/evp.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Downloader.h"
+#include "HttpClient.h"
+
+namespace linx {
+
+// bsdiff 补丁的流式应用：ENDSLEY/BSDIFF43 布局，补丁体不压缩（压缩交给 HTTP 的 Content-Encoding）。
+//   头部：16 字节 "ENDSLEY/BSDIFF43" | 8 字节新文件长度
+//   之后重复：控制三元组（各 8 字节：diff 长度、extra 长度、旧文件位置的偏移）| diff 字节 | extra 字节
+// diff 字节与旧文件当前位置的字节逐字节相加得到新文件（超出旧文件范围的按 0），extra 字节原样写出，
+// 然后旧文件位置加上偏移；写满新文件长度即结束。整数为小端、最高位为符号位的原码（与 bsdiff 相同）。
+// 补丁可以按任意大小的块交给 Write：旧文件用 pread 按需读取，新文件经一块缓冲顺序写出，
+// 内存占用是两块 buffer_bytes，与文件大小无关；写出的同时计算新文件和补丁流的 SHA-256
+class DeltaPatchSink : public HttpSink {
+public:
+    static constexpr char kMagic[] = "ENDSLEY/BSDIFF43";
+    static constexpr size_t kHeaderSize = 24;
+    static constexpr size_t kControlSize = 24;
+
+    // base_fd 为旧文件（只读，用 pread 访问），out_fd 为新文件（从当前位置顺序写）；两者由调用方关闭
+    DeltaPatchSink(int base_fd, uint64_t base_size, int out_fd, size_t buffer_bytes = 64 * 1024);
+    ~DeltaPatchSink() override;
+
+    DeltaPatchSink(const DeltaPatchSink&) = delete;
+    DeltaPatchSink& operator=(const DeltaPatchSink&) = delete;
+
+    // 只接受 2xx
+    bool Begin(long status, int64_t content_length) override;
+    // 补丁格式错误、越界或写盘失败时返回 false，原因见 Error()
+    bool Write(const char* data, size_t len) override;
+
+    // 补丁流结束后调用：写出缓冲中剩余的数据，新文件未写满或补丁有多余数据时返回 false
+    bool Finish();
+
+    const std::string& Error() const { return error_; }
+    bool HeaderDone() const { return state_ != State::Header; }
+    uint64_t NewSize() const { return new_size_; }     // 头部解析之后有效
+    uint64_t Written() const { return new_pos_; }      // 已生成的新文件字节数（含尚在缓冲中的）
+    uint64_t PatchBytes() const { return patch_bytes_; }
+    uint64_t DiffBytes() const { return diff_bytes_; }    // 由旧文件加差值得到的字节数
+    uint64_t ExtraBytes() const { return extra_bytes_; }  // 补丁中原样携带的字节数
+    // Finish 成功之后有效，十六进制小写
+    const std::string& Sha256() const { return sha256_; }
+    const std::string& PatchSha256() const { return patch_sha256_; }
+
+private:
+    enum class State { Header, Control, Diff, Extra, Done, Failed };
+
+    bool Fail(std::string error);
+    bool ParseHeader();
+    bool ParseControl();
+    // 把补丁中的 n 个 diff 字节与旧文件相加后写入输出缓冲
+    bool ApplyDiff(const unsigned char* data, size_t n);
+    bool Emit(const unsigned char* data, size_t n);
+    bool Flush();
+
+    int base_fd_;
+    uint64_t base_size_;
+    int out_fd_;
+    size_t buffer_bytes_;
+
+    State state_ = State::Header;
+    unsigned char pending_[kHeaderSize] = {};  // 头部/控制三元组跨块时的暂存
+    size_t pending_len_ = 0;
+    uint64_t new_size_ = 0;
+    uint64_t new_pos_ = 0;
+    int64_t old_pos_ = 0;
+    uint64_t diff_left_ = 0;
+    uint64_t extra_left_ = 0;
+    int64_t seek_ = 0;
+
+    std::vector<unsigned char> old_buf_;
+    std::vector<unsigned char> out_buf_;
+    size_t out_len_ = 0;
+    EVP_MD_CTX* new_sha_ = nullptr;
+    EVP_MD_CTX* patch_sha_ = nullptr;
+
+    uint64_t patch_bytes_ = 0;
+    uint64_t diff_bytes_ = 0;
+    uint64_t extra_bytes_ = 0;
+    std::string error_;
+    std::string sha256_;
+    std::string patch_sha256_;
+};
+
+// 差分更新配置
+struct DeltaUpdateConfig {
+    std::string url;                  // 补丁地址（OTA 的 firmware.patch.url）
+    std::string base_path;            // 设备上当前版本的镜像，即补丁的旧文件
+    std::string base_sha256;          // 旧文件的 SHA-256，不符时不下载补丁（调用方改为整包下载），为空时不校验
+    std::string path;                 // 新文件；生成时写 path.part，校验通过后改名为 path
+    std::string sha256;               // 新文件的 SHA-256，必须给出：基线不对时补丁照样能应用完，只有它能发现
+    std::string patch_sha256;         // 补丁流（解压后）的 SHA-256，为空时不校验
+    size_t buffer_bytes = 64 * 1024;  // 旧文件读缓冲和新文件写缓冲各一块
+    bool compressed = true;           // 请求 Content-Encoding 压缩（curl 支持的 gzip / br / zstd），边收边解压
+    std::map<std::string, std::string> headers;  // 附加的请求头（如 Authorization）
+    DownloadProgress progress;        // done / total 为已生成和新文件的字节数
+};
+
+// 差分更新统计
+struct DeltaUpdateStats {
+    uint64_t base_size = 0;       // 旧文件长度
+    uint64_t size = 0;            // 新文件长度
+    uint64_t patch_bytes = 0;     // 补丁流的字节数（解压后）
+    uint64_t transfer_bytes = 0;  // curl 统计的响应体字节数
+    uint64_t diff_bytes = 0;      // 由旧文件加差值得到的字节数
+    uint64_t extra_bytes = 0;     // 补丁原样携带的字节数
+    double total_ms = 0;          // 最近一次 Run 的耗时（含校验旧文件）
+};
+
+// 差分更新：先校验旧文件的哈希，再经 HttpClient::get 流式下载补丁，边收边由 DeltaPatchSink 生成新文件，
+// 最后核对新文件（和补丁）的 SHA-256，fsync 后改名为 path。补丁不能续传：中断后下次从头下载，
+// 补丁通常只有整包的几分之一，重下比维护续传点更简单。任何一步失败都删除 path.part 并返回 false，
+// 调用方退回整包下载（Downloader）。
+class DeltaUpdater {
+public:
+    explicit DeltaUpdater(DeltaUpdateConfig config);
+
+    DeltaUpdater(const DeltaUpdater&) = delete;
+    DeltaUpdater& operator=(const DeltaUpdater&) = delete;
+
+    // 阻塞直到完成、失败或被 Cancel，原因写入 *error（可为空）
+    bool Run(std::string* error = nullptr);
+    // 任意线程调用：中止进行中的 Run，之后的 Run 立即返回 false
+    void Cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+
+    const DeltaUpdateConfig& Config() const { return config_; }
+    // 任意线程读取
+    DeltaUpdateStats GetStats() const;
+
+private:
+    bool Apply(int base_fd, uint64_t base_size, std::string* error);
+
+    DeltaUpdateConfig config_;
+    std::string part_;
+
+    std::atomic<bool> cancelled_{false};
+    std::atomic<uint64_t> base_size_{0};
+    std::atomic<uint64_t> size_{0};
+    std::atomic<uint64_t> patch_bytes_{0};
+    std::atomic<uint64_t> transfer_bytes_{0};
+    std::atomic<uint64_t> diff_bytes_{0};
+    std::atomic<uint64_t> extra_bytes_{0};
+    std::atomic<double> total_ms_{0};
+};
+
+// 十六进制小写的 SHA-256，按 buffer_bytes 分块读取，读取失败时返回空字符串
+std::string FileSha256(int fd, size_t buffer_bytes = 64 * 1024);
+
+}  // namespace linx
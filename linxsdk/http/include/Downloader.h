@@ -0,0 +1,133 @@
+#pragma once
+
+#include <curl/curl.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "LockProfiler.h"
+
+namespace linx {
+
+// 下载进度回调：已完成的字节数（含上次中断前已完成的分段）与文件总长度，在 Run 的线程上调用
+using DownloadProgress = std::function<void(uint64_t done, uint64_t total)>;
+
+// 分段下载配置
+struct DownloadConfig {
+    std::string url;
+    std::string path;                         // 目标文件；下载中写 path.part，进度记录在 path.part.state
+    size_t segment_bytes = 1024 * 1024;       // 每个 Range 分段的长度
+    int parallel = 4;                         // 同时进行的分段请求数
+    int retries = 3;                          // 每个分段失败（传输出错、长度不符、哈希不符）后的重试次数
+    long low_speed_seconds = 30;              // 一个分段这么长时间没有收到数据即按失败处理
+    std::string sha256;                       // 整个文件的 SHA-256（十六进制），为空时不校验
+    std::vector<std::string> segment_sha256;  // 各分段的 SHA-256（按 segment_bytes 切分的清单），为空时不逐段比对
+    std::map<std::string, std::string> headers;  // 附加的请求头（如 Authorization）
+    DownloadProgress progress;
+};
+
+// 分段下载统计
+struct DownloadStats {
+    uint64_t size = 0;               // 文件总长度
+    uint64_t bytes_downloaded = 0;   // 本次从网络收到的字节数（含重试时丢弃的部分）
+    uint64_t bytes_resumed = 0;      // 沿用上次中断前已完成的分段的字节数
+    uint64_t segments = 0;           // 分段总数
+    uint64_t segments_resumed = 0;   // 其中沿用上次结果的分段数
+    uint64_t retries = 0;            // 分段重试次数
+    uint64_t hash_failures = 0;      // 分段或整个文件的哈希不符次数
+    bool ranged = false;             // 服务器支持 Range，按分段并行下载
+    double total_ms = 0;             // 最近一次 Run 的耗时
+};
+
+// 可续传的分段并行下载（OTA 固件、资源包）：
+// 先以 HEAD 取长度、ETag / Last-Modified 和 Accept-Ranges（跟随重定向，分段请求直接使用重定向后的地址），
+// path.part 预先分配到完整长度（空间不足时立即失败）并以 MAP_SHARED 映射；文件按 segment_bytes 切成 Range 分段，
+// 在一个 curl_multi 句柄上至多 parallel 个并行传输（HTTP/2 上复用同一连接，HTTP/1.1 上各用一条连接），
+// 收到的数据直接写入映射中对应的位置，同时计算这一段的 SHA-256，与清单比对后记为完成。
+// 已完成的分段先 msync 落盘，再写入 path.part.state（先写临时文件再改名），进程被杀、断网或断电后
+// 再次 Run 只下载未完成的分段；续传前重新计算已完成分段的哈希，与记录不符的重新下载。
+// 分段请求带 If-Range：服务器上的文件已变化时返回 200 而不是 206，此时丢弃全部进度从头下载。
+// 服务器不支持 Range 或长度未知时退化为单个请求、不能续传。全部完成且整个文件的哈希相符后改名为 path。
+// 所有句柄经 ConfigureCurlHandle 与 HttpClient 共享 DNS 缓存、TLS 会话和连接池
+class Downloader {
+public:
+    explicit Downloader(DownloadConfig config);
+    ~Downloader();
+
+    Downloader(const Downloader&) = delete;
+    Downloader& operator=(const Downloader&) = delete;
+
+    // 阻塞下载直到完成、失败或被 Cancel；失败时保留已完成的分段供下次续传，原因写入 *error（可为空）
+    bool Run(std::string* error = nullptr);
+    // 任意线程调用：中止进行中的 Run（写出进度后返回 false），之后的 Run 立即返回 false
+    void Cancel();
+
+    const DownloadConfig& Config() const { return config_; }
+    // 任意线程读取
+    DownloadStats GetStats() const;
+
+private:
+    struct Segment;
+    struct Remote {
+        int64_t size = -1;
+        std::string url;            // 重定向后的地址
+        std::string etag;
+        std::string last_modified;
+        bool ranges = false;
+    };
+    // Transfer 中途放弃、由 Run 重新开始的原因
+    enum class Restart {
+        None,
+        Changed,   // 服务器上的文件已变化：丢弃全部进度重新下载
+        Unranged,  // 服务器声明 Accept-Ranges 却忽略了 Range：改为单个 GET 整体下载
+    };
+
+    bool Probe(Remote* remote, std::string* error);
+    // 长度未知：整个响应经 FileSink 写入 path.part，不能续传
+    bool FetchWhole(const Remote& remote, std::string* error);
+    // 读出并核对上次的进度，不可沿用时删除；返回 count 个分段各自的 SHA-256，未完成的为空
+    std::vector<std::string> LoadState(const Remote& remote, size_t count);
+    bool SaveState(const Remote& remote, const std::vector<std::string>& hashes);
+    bool MapPart(uint64_t size, std::string* error);
+    void UnmapPart();
+    bool StartSegment(Segment* segment, const Remote& remote);
+    // 在 multi 句柄上并行下载 hashes 中未完成的分段；需要整体重来时 *restart 给出原因
+    bool Transfer(const Remote& remote, std::vector<std::string>* hashes, Restart* restart, std::string* error);
+    // ranged 为 false（整体下载）时按 segment_bytes 切片补做清单比对，再核对整个文件的 SHA-256
+    bool Finish(bool ranged, std::string* error);
+    // 删除 path.part 和进度记录
+    void Discard();
+    void ReportProgress(bool force);
+    static size_t OnData(char* data, size_t size, size_t nmemb, void* arg);
+
+    DownloadConfig config_;
+    std::string part_;
+    std::string state_;
+    ProfiledMutex mutex_{"downloader"};  // 保护 multi_ 的创建和销毁（Cancel 从其他线程唤醒它）
+    CURLM* multi_ = nullptr;
+    int fd_ = -1;
+    unsigned char* map_ = nullptr;
+    uint64_t map_size_ = 0;
+    uint64_t done_bytes_ = 0;       // 已完成分段的字节数（仅 Run 的线程）
+    uint64_t partial_bytes_ = 0;    // 进行中的分段已收到的字节数
+    int64_t last_progress_ms_ = 0;
+
+    std::atomic<bool> cancelled_{false};
+    std::atomic<uint64_t> size_{0};
+    std::atomic<uint64_t> bytes_downloaded_{0};
+    std::atomic<uint64_t> bytes_resumed_{0};
+    std::atomic<uint64_t> segments_{0};
+    std::atomic<uint64_t> segments_resumed_{0};
+    std::atomic<uint64_t> retries_{0};
+    std::atomic<uint64_t> hash_failures_{0};
+    std::atomic<bool> ranged_{false};
+    std::atomic<double> total_ms_{0};
+};
+
+}  // namespace linx
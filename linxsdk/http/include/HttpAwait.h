@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Coroutine.h"
+
+#ifdef LINX_HAS_COROUTINES
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include "HttpClient.h"
+#include "Reactor.h"
+
+namespace linx {
+
+// co_await PostJson(reactor, http, body, head)：异步 POST JSON，请求在 curl_multi 线程上执行，
+// 完成后在 reactor 的循环线程上恢复协程并返回 HttpResponse（与 postJsonAsync 的结果相同），等待期间不占用线程
+inline auto PostJson(Reactor& reactor, HttpClient& http, std::string body,
+                     std::map<std::string, std::string> head = {}) {
+    struct Awaiter {
+        Reactor& reactor;
+        HttpClient& http;
+        std::string body;
+        std::map<std::string, std::string> head;
+        HttpResponse response;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            // 协程挂起期间 Awaiter 留在协程帧里，回调写入后再投递恢复
+            http.postJsonAsync(body, head, [this, handle](HttpResponse result) {
+                response = std::move(result);
+                reactor.Post([handle] { handle.resume(); });
+            });
+        }
+        HttpResponse await_resume() { return std::move(response); }
+    };
+    return Awaiter{reactor, http, std::move(body), std::move(head), HttpResponse()};
+}
+
+}  // namespace linx
+
+#endif  // LINX_HAS_COROUTINES
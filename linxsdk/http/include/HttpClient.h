@@ -2,30 +2,209 @@
 
 #include <curl/curl.h>
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 
+#include "AsyncFileWriter.h"
+#include "LockProfiler.h"
+
 namespace linx {
 
+class FileStream;
+
+// HTTP 客户端统计
+struct HttpClientStats {
+    uint64_t requests = 0;         // 发出的请求数
+    uint64_t failures = 0;         // curl 返回错误的请求数
+    uint64_t new_connections = 0;  // 新建的连接数，requests - new_connections 即复用已有连接的请求数
+    uint64_t bytes_uploaded = 0;   // 上传请求发出的请求体字节数（含 multipart 分隔）
+    uint64_t bytes_downloaded = 0; // 收到的响应体字节数
+};
+
+// 流式响应的接收端：响应体按 curl 收到的块依次交给 Write，不在内存中攒出整个响应。
+// 同步请求在调用线程上回调，异步请求在 curl_multi 线程上回调
+class HttpSink {
+public:
+    virtual ~HttpSink() = default;
+    // Begin(status, content_length)：第一块数据之前（没有响应体时在传输结束时）调用一次，
+    // content_length 为 -1 表示未知（分块传输）；返回 false 中止传输
+    virtual bool Begin(long, int64_t) { return true; }
+    // 返回 false 中止传输（如写盘失败、超出目标区域）
+    virtual bool Write(const char* data, size_t len) = 0;
+    // End(ok)：传输结束，ok 为 false 表示失败或被中止
+    virtual void End(bool) {}
+};
+
+// 写入 std::string：按 Content-Length 一次预留（不超过 max_reserve），之后逐块追加不再重新分配
+class StringSink : public HttpSink {
+public:
+    explicit StringSink(std::string* out, size_t max_reserve = 16 * 1024 * 1024)
+        : out_(out), max_reserve_(max_reserve) {}
+    bool Begin(long status, int64_t content_length) override;
+    bool Write(const char* data, size_t len) override {
+        out_->append(data, len);
+        return true;
+    }
+
+private:
+    std::string* out_;
+    size_t max_reserve_;
+};
+
+// 写入调用方提供的固定内存（如 mmap 映射的区域、预先分配的缓冲区），不做任何分配；
+// 响应体超出 capacity 或 Content-Length 已知且大于 capacity 时中止
+class BufferSink : public HttpSink {
+public:
+    BufferSink(void* data, size_t capacity) : data_(static_cast<char*>(data)), capacity_(capacity) {}
+    bool Begin(long status, int64_t content_length) override;
+    bool Write(const char* data, size_t len) override;
+    size_t Size() const { return size_; }
+
+private:
+    char* data_;
+    size_t capacity_;
+    size_t size_ = 0;
+};
+
+// 写入文件（OTA 固件、资源包）：先写 path.part，传输成功且 HTTP 状态为 2xx 时改名为 path，失败时删除。
+// async 非空时经 FileStream 的异步写（AsyncFileWriter）写盘，curl 线程不阻塞在 fwrite 上
+class FileSink : public HttpSink {
+public:
+    explicit FileSink(const std::string& path, const AsyncFileWriterConfig* async = nullptr);
+    ~FileSink() override;
+    bool Begin(long status, int64_t content_length) override;
+    bool Write(const char* data, size_t len) override;
+    void End(bool ok) override;
+    uint64_t Size() const { return size_; }
+
+private:
+    std::string path_;
+    std::string part_;
+    std::unique_ptr<AsyncFileWriterConfig> async_;
+    std::unique_ptr<FileStream> stream_;
+    bool accepted_ = false;  // 状态码为 2xx
+    uint64_t size_ = 0;
+};
+
+// 逐块回调：返回 false 中止传输
+using HttpChunkHandler = std::function<bool(const char* data, size_t len)>;
 
+class CallbackSink : public HttpSink {
+public:
+    explicit CallbackSink(HttpChunkHandler handler) : handler_(std::move(handler)) {}
+    bool Write(const char* data, size_t len) override { return handler_(data, len); }
+
+private:
+    HttpChunkHandler handler_;
+};
+
+// multipart/form-data 上传的参数
+struct UploadRequest {
+    std::map<std::string, std::string> fields;  // 普通表单字段（如 sid），按键的顺序写在文件之前
+    std::string fileField = "file";             // 文件部分的字段名
+    std::string fileName;                       // 文件部分的 filename
+    std::string contentType = "application/octet-stream";
+    long timeoutSeconds = 0;                    // 整个请求的超时，0 表示不限（边录边传时请求与录音一样长）
+};
+
+// 流式上传的数据源：把至多 size 字节写入 buffer，返回写入的字节数，返回 0 表示数据结束。
+// 在发起上传的线程上调用，可以阻塞等待新数据（如录音线程尚未产出）；返回 kUploadAbort 中止上传
+using UploadProducer = std::function<size_t(char* buffer, size_t size)>;
+constexpr size_t kUploadAbort = CURL_READFUNC_ABORT;
+
+// 异步请求的结果
+struct HttpResponse {
+    bool ok = false;      // 传输完成（不检查 HTTP 状态码）
+    long status = 0;      // HTTP 状态码
+    std::string body;
+    std::string error;    // 失败原因
+    std::string etag;     // 响应的 ETag 头（没有时为空），用于下次请求的 If-None-Match
+    double total_ms = 0;  // 从提交到完成的耗时
+};
+
+// 异步请求完成回调，在后台 curl_multi 线程上调用
+using HttpCallback = std::function<void(HttpResponse response)>;
+
+// 设置 HttpClient 所有请求共用的句柄选项：进程级 CURLSH（DNS 缓存、TLS 会话缓存、连接池）、HTTP/2 协商、keep-alive。
+// 自行管理 easy 句柄的调用方（如 Downloader 的分段请求）用它与 HttpClient 共享连接和缓存；首次调用时完成 curl_global_init
+void ConfigureCurlHandle(CURL* curl);
+
+// HTTP 客户端
+// 每个实例持有一个长期存在的 CURL easy 句柄，请求之间保留 keep-alive 连接；所有实例通过进程级 CURLSH
+// 共享 DNS 缓存、TLS 会话缓存和连接池，换一个实例访问同一主机也不必重新握手。HTTPS 上优先协商 HTTP/2。
+// 同一实例的同步请求串行执行（内部加锁），可从任意线程调用。
+// 异步请求在进程共享的 curl_multi 线程上执行：各自使用独立的句柄、并行进行，同样经 CURLSH 复用连接和缓存。
 class HttpClient {
     public:
         HttpClient() {}
         HttpClient(const std::string& webApi);
+        ~HttpClient();
+
+        HttpClient(const HttpClient&) = delete;
+        HttpClient& operator=(const HttpClient&) = delete;
+
         void reset(const std::string& webApi);
         bool postJson(std::string& response, const std::string& body,
                     const std::map<std::string, std::string>& head);
+        // 上传文件：sid 与 fileType（按扩展名推断）作为表单字段，文件内容由 curl 边读边发
         bool upload(std::string& outputText, const std::string& sid, const std::string& fileName,
                     const std::string& filePath);
+        // 上传内存中的数据，不拷贝、不落盘；data 在调用返回前须保持有效
+        bool uploadData(std::string& outputText, const UploadRequest& request, const void* data, size_t len);
+        // 流式上传：请求体由 producer 边产出边发送。size 为 -1（未知）时使用分块传输
+        // （HTTP/1.1 chunked；HTTP/2 上直接按帧发送），录音可以边录边传
+        bool uploadStream(std::string& outputText, const UploadRequest& request, UploadProducer producer,
+                          int64_t size = -1);
+        // POST 任意请求体（如二进制遥测批次）：不校验响应格式，*status 为 HTTP 状态码（可为空）。
+        // 返回传输是否完成（不检查状态码），data 在调用返回前须保持有效
+        bool post(std::string& response, const void* data, size_t len, const std::string& contentType,
+                  const std::map<std::string, std::string>& head = {}, long timeoutSeconds = 10,
+                  long* status = nullptr);
+        // 异步 POST JSON：立即返回，完成后在 curl_multi 线程上回调 done（回调中不要做耗时操作）。
+        // 请求提交时复制 URL、请求体和头部，之后与本实例无关，实例可以先于请求完成而销毁
+        void postJsonAsync(const std::string& body, const std::map<std::string, std::string>& head,
+                           HttpCallback done);
+        std::future<HttpResponse> postJsonAsync(const std::string& body,
+                                                const std::map<std::string, std::string>& head);
+        // 流式 GET：响应体按块交给 sink（跟随重定向），用于 OTA 固件、资源包这类大响应。
+        // timeoutSeconds 为 0 时不限总时长，30 秒内没有收到数据则中止；*status 为 HTTP 状态码（可为空）。
+        // 返回传输是否完成且未被 sink 中止（不检查状态码，由 sink 的 Begin 决定是否接受）。
+        // head 中的 Accept-Encoding 交给 curl：由它发出并透明解压，值为空时列出支持的全部编码（gzip / br / zstd）
+        bool get(HttpSink& sink, const std::map<std::string, std::string>& head = {}, long timeoutSeconds = 0,
+                 long* status = nullptr);
+        bool get(HttpChunkHandler on_chunk, const std::map<std::string, std::string>& head = {},
+                 long timeoutSeconds = 0, long* status = nullptr);
         std::string getWebApi();
 
+        HttpClientStats GetStats() const;
+
     private:
-        bool postRequest(std::string& response, CURL* curl);
+        // 取出复用的句柄并恢复默认选项（保留其连接和缓存），调用方须持有 mutex_
+        CURL* prepare();
+        bool postRequest(std::string& response, CURL* curl, long timeoutSeconds = 5);
+        bool performRequest(HttpSink& sink, CURL* curl, long timeoutSeconds);
+        // 按 request 组装 multipart 表单（字段 + 一个文件部分，文件部分的数据源由 attach 设置）并发送
+        bool postMime(std::string& outputText, CURL* curl, const UploadRequest& request,
+                      const std::function<void(curl_mimepart*)>& attach);
 
     private:
         std::string webApi_;
         std::string host_;
+
+        ProfiledMutex mutex_{"http_client"};
+        CURL* curl_ = nullptr;
+        std::atomic<uint64_t> requests_{0};
+        std::atomic<uint64_t> failures_{0};
+        std::atomic<uint64_t> new_connections_{0};
+        std::atomic<uint64_t> bytes_uploaded_{0};
+        std::atomic<uint64_t> bytes_downloaded_{0};
 };
 
 
-}  // namespace linx
\ No newline at end of file
+}  // namespace linx
@@ -16,7 +16,7 @@ class HttpClientHelper {
         }
         void uploadFile(std::string& outputText, const std::string& sid, const std::string& filePath) {
             int index = filePath.rfind("/");
-            std::string fileName = filePath.substr(0, index);
+            std::string fileName = filePath.substr(index + 1);
             INFO("fileName, " + fileName + ", filePath, " + filePath);
             hc_.upload(outputText, sid, fileName, filePath);
         }
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ResponseCache.h"
+
+namespace linx {
+
+// OTA 响应中客户端用到的字段，响应体只解析这一次
+struct OtaConfig {
+    bool valid = false;                // 响应中包含 websocket 地址或 mqtt 代理地址
+    std::string ws_url;                // websocket.url（没有时取 urls 的第一个）
+    std::vector<std::string> ws_urls;  // websocket.urls，多区域部署时下发的候选服务器
+    std::string ws_token;              // websocket.token，可为空
+    // mqtt：空闲时经 MQTT 代理收发控制消息（见 protocol/include/MqttTransport.h），可与 websocket 同时下发
+    std::string mqtt_endpoint;         // mqtt.endpoint：host[:port]、mqtt://… 或 mqtts://…
+    std::string mqtt_client_id;        // mqtt.client_id
+    std::string mqtt_username;         // mqtt.username，可为空
+    std::string mqtt_password;         // mqtt.password，可为空
+    std::string mqtt_publish_topic;    // mqtt.publish_topic，设备发往服务器的主题
+    std::string mqtt_subscribe_topic;  // mqtt.subscribe_topic，服务器发往设备的主题，可为空
+    int mqtt_keepalive_s = 0;          // mqtt.keepalive（秒），0 为未下发
+    std::string firmware_version;      // firmware.version
+    std::string firmware_url;          // firmware.url，有新固件时的下载地址，可为空
+    std::string firmware_sha256;       // firmware.sha256，固件的 SHA-256（十六进制），可为空
+    // firmware.patch：从某个旧版本到 firmware.version 的差分补丁（见 DeltaUpdate.h），没有时 url 为空
+    std::string firmware_patch_from;         // patch.from，补丁的基线版本，为空表示即本机上报的版本
+    std::string firmware_patch_url;          // patch.url
+    std::string firmware_patch_sha256;       // patch.sha256，补丁流的 SHA-256，可为空
+    std::string firmware_patch_base_sha256;  // patch.base_sha256，基线镜像的 SHA-256，可为空
+    int64_t server_time_ms = 0;        // server_time.timestamp（unix 毫秒），0 为未下发
+    int timezone_offset_min = 0;       // server_time.timezone_offset（分钟）
+
+    // 解析响应体；不是 JSON 时返回 false 且 *out 为默认值，是 JSON 但 websocket 和 mqtt 地址都没有时返回 true、valid 为 false
+    static bool Parse(const std::string& body, OtaConfig* out);
+
+    // ws_url 在前、去重后的全部候选地址，供 EndpointSelector 使用
+    std::vector<std::string> Endpoints() const;
+    // "Bearer <token>"，没有令牌时为空
+    std::string Authorization() const;
+
+    // 只比较连接和固件字段，server_time 每次都不同，不参与
+    bool operator==(const OtaConfig& other) const {
+        return valid == other.valid && ws_url == other.ws_url && ws_urls == other.ws_urls &&
+               ws_token == other.ws_token && mqtt_endpoint == other.mqtt_endpoint &&
+               mqtt_client_id == other.mqtt_client_id && mqtt_username == other.mqtt_username &&
+               mqtt_password == other.mqtt_password && mqtt_publish_topic == other.mqtt_publish_topic &&
+               mqtt_subscribe_topic == other.mqtt_subscribe_topic && mqtt_keepalive_s == other.mqtt_keepalive_s &&
+               firmware_version == other.firmware_version &&
+               firmware_url == other.firmware_url && firmware_sha256 == other.firmware_sha256 &&
+               firmware_patch_from == other.firmware_patch_from && firmware_patch_url == other.firmware_patch_url &&
+               firmware_patch_sha256 == other.firmware_patch_sha256 &&
+               firmware_patch_base_sha256 == other.firmware_patch_base_sha256;
+    }
+    bool operator!=(const OtaConfig& other) const { return !(*this == other); }
+};
+
+// 一次 OTA 请求的结果
+struct OtaResult {
+    bool ok = false;          // 得到了可用的配置：200 且包含 websocket 或 mqtt 地址，或 304 且有缓存
+    bool not_modified = false;  // 304，缓存中的配置仍然有效
+    bool changed = false;     // 与缓存相比配置有变化（已写入缓存）
+    long status = 0;          // HTTP 状态码，传输失败时为 0
+    OtaConfig config;         // ok 为 false 时也可能包含部分字段（如响应中只有 firmware）
+    std::string body;         // 响应体（304 时为空），用于日志
+    std::string error;        // 传输失败的原因
+    double total_ms = 0;      // 从提交到完成的耗时
+};
+
+// OTA 客户端：上报设备信息，取回 WebSocket 地址、令牌、固件信息和服务器时间。
+// 给出 ResponseCache 时按设备 ID 缓存响应：构造时读出并解析上次的配置（启动时可以直接使用），
+// 请求带 If-None-Match 重新验证；304 时返回缓存的配置，配置或 ETag 变化时更新缓存。
+// 请求在进程共享的 curl_multi 线程上执行，cache 须比所有未完成的请求活得久
+class OtaClient {
+public:
+    OtaClient(const std::string& url, const std::string& device_id, ResponseCache* cache = nullptr);
+
+    // 上次缓存的配置，没有缓存时 valid 为 false
+    const OtaConfig& Cached() const { return cached_->config; }
+    bool HasCache() const { return cached_->present; }
+
+    // 异步发送 request（设备信息 JSON），完成后在 curl_multi 线程上回调 done（回调中不要做耗时操作）
+    void FetchAsync(const std::string& request, std::function<void(OtaResult)> done);
+    std::future<OtaResult> FetchAsync(const std::string& request);
+
+    const std::string& Url() const { return url_; }
+
+private:
+    struct CacheState {
+        bool present = false;
+        CachedResponse entry;
+        OtaConfig config;
+    };
+
+    std::string url_;
+    std::string device_id_;
+    ResponseCache* cache_ = nullptr;
+    std::shared_ptr<const CacheState> cached_;  // 进行中的请求持有一份，与客户端实例的生命周期无关
+};
+
+}  // namespace linx
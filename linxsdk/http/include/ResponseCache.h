@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace linx {
+
+// 缓存的一条 HTTP 响应
+struct CachedResponse {
+    std::string body;
+    std::string etag;         // 响应的 ETag，重新验证时作为 If-None-Match 发送，可为空
+    int64_t stored_at = 0;    // 写入时间（unix 秒）
+};
+
+// 按键（如设备 ID）持久化 HTTP 响应的磁盘缓存：每个键一个 JSON 文件，写入时先写临时文件再 rename，
+// 掉电或崩溃时不会留下半个文件。供启动时先用上次的配置、再在后台重新验证的场景使用（如 OTA 配置）。
+class ResponseCache {
+public:
+    // dir 不存在时在第一次 Store 时创建（只创建最后一级）
+    explicit ResponseCache(const std::string& dir);
+
+    // 读取 key 对应的缓存，不存在或已损坏时返回 false
+    bool Load(const std::string& key, CachedResponse* entry) const;
+    // 写入 key 对应的缓存，stored_at 为 0 时填入当前时间
+    bool Store(const std::string& key, const CachedResponse& entry);
+    bool Remove(const std::string& key);
+
+    // key 中文件名不允许的字符替换为 '_'
+    std::string PathFor(const std::string& key) const;
+
+private:
+    std::string dir_;
+};
+
+}  // namespace linx
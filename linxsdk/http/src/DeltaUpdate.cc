@@ -0,0 +1,455 @@
+#include "DeltaUpdate.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+
+#include "Log.h"
+#include "SteadyClock.h"
+
+namespace linx {
+
+namespace {
+
+constexpr int64_t kProgressIntervalMs = 250;  // 进度回调的最短间隔
+constexpr int64_t kMaxSeek = int64_t(1) << 62;  // 控制三元组中的值超过它视为补丁损坏
+
+std::string Hex(const unsigned char* digest, unsigned int len) {
+    static const char kDigits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(len * 2);
+    for (unsigned int i = 0; i < len; ++i) {
+        hex.push_back(kDigits[digest[i] >> 4]);
+        hex.push_back(kDigits[digest[i] & 0x0f]);
+    }
+    return hex;
+}
+
+std::string FinalHex(EVP_MD_CTX* ctx) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int len = 0;
+    if (ctx == nullptr || EVP_DigestFinal_ex(ctx, digest, &len) != 1) {
+        return std::string();
+    }
+    return Hex(digest, len);
+}
+
+EVP_MD_CTX* NewSha256() {
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    if (ctx != nullptr && EVP_DigestInit_ex(ctx, EVP_sha256(), nullptr) != 1) {
+        EVP_MD_CTX_free(ctx);
+        return nullptr;
+    }
+    return ctx;
+}
+
+std::string Lower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+// bsdiff 的 offtin：小端 8 字节，最高位为符号位
+int64_t ReadOfft(const unsigned char* p) {
+    uint64_t v = p[7] & 0x7f;
+    for (int i = 6; i >= 0; --i) {
+        v = (v << 8) | p[i];
+    }
+    return (p[7] & 0x80) ? -static_cast<int64_t>(v) : static_cast<int64_t>(v);
+}
+
+bool WriteAll(int fd, const unsigned char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Write 之上加取消检查和进度回调
+class UpdateSink : public DeltaPatchSink {
+public:
+    UpdateSink(int base_fd, uint64_t base_size, int out_fd, const DeltaUpdateConfig& config,
+               const std::atomic<bool>* cancelled)
+        : DeltaPatchSink(base_fd, base_size, out_fd, config.buffer_bytes),
+          progress_(config.progress),
+          cancelled_(cancelled) {}
+
+    bool Write(const char* data, size_t len) override {
+        if (cancelled_->load(std::memory_order_relaxed) || !DeltaPatchSink::Write(data, len)) {
+            return false;
+        }
+        int64_t now = SteadyNowMs();
+        if (progress_ && HeaderDone() && now - last_progress_ms_ >= kProgressIntervalMs) {
+            last_progress_ms_ = now;
+            progress_(Written(), NewSize());
+        }
+        return true;
+    }
+
+private:
+    const DownloadProgress& progress_;
+    const std::atomic<bool>* cancelled_;
+    int64_t last_progress_ms_ = 0;
+};
+
+}  // namespace
+
+constexpr char DeltaPatchSink::kMagic[];
+
+DeltaPatchSink::DeltaPatchSink(int base_fd, uint64_t base_size, int out_fd, size_t buffer_bytes)
+    : base_fd_(base_fd),
+      base_size_(base_size),
+      out_fd_(out_fd),
+      buffer_bytes_(std::max<size_t>(buffer_bytes, 4096)),
+      new_sha_(NewSha256()),
+      patch_sha_(NewSha256()) {
+    old_buf_.resize(buffer_bytes_);
+    out_buf_.resize(buffer_bytes_);
+    if (new_sha_ == nullptr || patch_sha_ == nullptr) {
+        Fail("cannot initialize SHA-256");
+    }
+}
+
+DeltaPatchSink::~DeltaPatchSink() {
+    EVP_MD_CTX_free(new_sha_);
+    EVP_MD_CTX_free(patch_sha_);
+}
+
+bool DeltaPatchSink::Fail(std::string error) {
+    if (state_ != State::Failed) {
+        error_ = std::move(error);
+        state_ = State::Failed;
+    }
+    return false;
+}
+
+bool DeltaPatchSink::Begin(long status, int64_t) {
+    if (status < 200 || status >= 300) {
+        return Fail("HTTP " + std::to_string(status));
+    }
+    return state_ != State::Failed;
+}
+
+bool DeltaPatchSink::ParseHeader() {
+    if (memcmp(pending_, kMagic, 16) != 0) {
+        return Fail("not an ENDSLEY/BSDIFF43 patch");
+    }
+    int64_t size = ReadOfft(pending_ + 16);
+    if (size < 0 || size > kMaxSeek) {
+        return Fail("corrupt patch header");
+    }
+    new_size_ = static_cast<uint64_t>(size);
+    state_ = new_size_ == 0 ? State::Done : State::Control;
+    return true;
+}
+
+bool DeltaPatchSink::ParseControl() {
+    int64_t diff = ReadOfft(pending_);
+    int64_t extra = ReadOfft(pending_ + 8);
+    int64_t seek = ReadOfft(pending_ + 16);
+    if (diff < 0 || extra < 0 || seek > kMaxSeek || seek < -kMaxSeek ||
+        static_cast<uint64_t>(diff) > new_size_ - new_pos_ ||
+        static_cast<uint64_t>(extra) > new_size_ - new_pos_ - static_cast<uint64_t>(diff)) {
+        return Fail("corrupt patch control block at output offset " + std::to_string(new_pos_));
+    }
+    diff_left_ = static_cast<uint64_t>(diff);
+    extra_left_ = static_cast<uint64_t>(extra);
+    seek_ = seek;
+    state_ = diff_left_ > 0 ? State::Diff : State::Extra;
+    return true;
+}
+
+bool DeltaPatchSink::ApplyDiff(const unsigned char* data, size_t n) {
+    while (n > 0) {
+        size_t chunk = std::min(n, buffer_bytes_);
+        // 旧文件中与 [old_pos_, old_pos_ + chunk) 重叠的部分读入 old_buf_，其余按 0
+        memset(old_buf_.data(), 0, chunk);
+        int64_t begin = std::max<int64_t>(old_pos_, 0);
+        int64_t end = std::min<int64_t>(old_pos_ + static_cast<int64_t>(chunk), static_cast<int64_t>(base_size_));
+        if (end > begin) {
+            size_t at = static_cast<size_t>(begin - old_pos_);
+            size_t want = static_cast<size_t>(end - begin);
+            size_t got = 0;
+            while (got < want) {
+                ssize_t r = pread(base_fd_, old_buf_.data() + at + got, want - got, begin + static_cast<int64_t>(got));
+                if (r < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (r <= 0) {
+                    return Fail(std::string("cannot read base image: ") + (r < 0 ? strerror(errno) : "short read"));
+                }
+                got += static_cast<size_t>(r);
+            }
+        }
+        for (size_t i = 0; i < chunk; ++i) {
+            old_buf_[i] = static_cast<unsigned char>(old_buf_[i] + data[i]);
+        }
+        if (!Emit(old_buf_.data(), chunk)) {
+            return false;
+        }
+        old_pos_ += static_cast<int64_t>(chunk);
+        diff_bytes_ += chunk;
+        data += chunk;
+        n -= chunk;
+    }
+    return true;
+}
+
+bool DeltaPatchSink::Emit(const unsigned char* data, size_t n) {
+    new_pos_ += n;
+    while (n > 0) {
+        size_t room = std::min(n, out_buf_.size() - out_len_);
+        memcpy(out_buf_.data() + out_len_, data, room);
+        out_len_ += room;
+        data += room;
+        n -= room;
+        if (out_len_ == out_buf_.size() && !Flush()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DeltaPatchSink::Flush() {
+    if (out_len_ == 0) {
+        return true;
+    }
+    EVP_DigestUpdate(new_sha_, out_buf_.data(), out_len_);
+    if (!WriteAll(out_fd_, out_buf_.data(), out_len_)) {
+        return Fail(std::string("cannot write output: ") + strerror(errno));
+    }
+    out_len_ = 0;
+    return true;
+}
+
+bool DeltaPatchSink::Write(const char* data, size_t len) {
+    if (state_ == State::Failed) {
+        return false;
+    }
+    const auto* p = reinterpret_cast<const unsigned char*>(data);
+    EVP_DigestUpdate(patch_sha_, p, len);
+    patch_bytes_ += len;
+    while (len > 0) {
+        switch (state_) {
+            case State::Header:
+            case State::Control: {
+                size_t need = (state_ == State::Header ? kHeaderSize : kControlSize) - pending_len_;
+                size_t take = std::min(need, len);
+                memcpy(pending_ + pending_len_, p, take);
+                pending_len_ += take;
+                p += take;
+                len -= take;
+                if (pending_len_ < (state_ == State::Header ? kHeaderSize : kControlSize)) {
+                    break;
+                }
+                pending_len_ = 0;
+                if (!(state_ == State::Header ? ParseHeader() : ParseControl())) {
+                    return false;
+                }
+                break;
+            }
+            case State::Diff: {
+                size_t take = static_cast<size_t>(std::min<uint64_t>(diff_left_, len));
+                if (!ApplyDiff(p, take)) {
+                    return false;
+                }
+                p += take;
+                len -= take;
+                diff_left_ -= take;
+                if (diff_left_ == 0) {
+                    state_ = State::Extra;
+                }
+                break;
+            }
+            case State::Extra: {
+                size_t take = static_cast<size_t>(std::min<uint64_t>(extra_left_, len));
+                if (!Emit(p, take)) {
+                    return false;
+                }
+                extra_bytes_ += take;
+                p += take;
+                len -= take;
+                extra_left_ -= take;
+                break;
+            }
+            case State::Done:
+                return Fail("patch has trailing data after the output is complete");
+            case State::Failed:
+                return false;
+        }
+        if (state_ == State::Extra && extra_left_ == 0) {
+            old_pos_ += seek_;
+            state_ = new_pos_ == new_size_ ? State::Done : State::Control;
+        }
+    }
+    return true;
+}
+
+bool DeltaPatchSink::Finish() {
+    if (state_ == State::Failed) {
+        return false;
+    }
+    if (state_ != State::Done) {
+        return Fail("patch ended early: " + std::to_string(new_pos_) + " of " + std::to_string(new_size_) +
+                    " bytes produced");
+    }
+    if (!Flush()) {
+        return false;
+    }
+    sha256_ = FinalHex(new_sha_);
+    patch_sha256_ = FinalHex(patch_sha_);
+    return true;
+}
+
+std::string FileSha256(int fd, size_t buffer_bytes) {
+    EVP_MD_CTX* ctx = NewSha256();
+    if (ctx == nullptr) {
+        return std::string();
+    }
+    std::vector<unsigned char> buf(std::max<size_t>(buffer_bytes, 4096));
+    off_t offset = 0;
+    for (;;) {
+        ssize_t n = pread(fd, buf.data(), buf.size(), offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            EVP_MD_CTX_free(ctx);
+            return std::string();
+        }
+        if (n == 0) {
+            break;
+        }
+        EVP_DigestUpdate(ctx, buf.data(), static_cast<size_t>(n));
+        offset += n;
+    }
+    std::string hex = FinalHex(ctx);
+    EVP_MD_CTX_free(ctx);
+    return hex;
+}
+
+DeltaUpdater::DeltaUpdater(DeltaUpdateConfig config) : config_(std::move(config)), part_(config_.path + ".part") {
+    config_.base_sha256 = Lower(config_.base_sha256);
+    config_.sha256 = Lower(config_.sha256);
+    config_.patch_sha256 = Lower(config_.patch_sha256);
+}
+
+DeltaUpdateStats DeltaUpdater::GetStats() const {
+    DeltaUpdateStats stats;
+    stats.base_size = base_size_.load(std::memory_order_relaxed);
+    stats.size = size_.load(std::memory_order_relaxed);
+    stats.patch_bytes = patch_bytes_.load(std::memory_order_relaxed);
+    stats.transfer_bytes = transfer_bytes_.load(std::memory_order_relaxed);
+    stats.diff_bytes = diff_bytes_.load(std::memory_order_relaxed);
+    stats.extra_bytes = extra_bytes_.load(std::memory_order_relaxed);
+    stats.total_ms = total_ms_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+bool DeltaUpdater::Run(std::string* error) {
+    std::string message;
+    if (error == nullptr) {
+        error = &message;
+    }
+    if (cancelled_.load(std::memory_order_relaxed)) {
+        *error = "cancelled";
+        return false;
+    }
+    if (config_.sha256.empty()) {
+        *error = "delta update needs the SHA-256 of the new image";
+        return false;
+    }
+    int64_t start = SteadyNowMs();
+    int base_fd = open(config_.base_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (base_fd < 0) {
+        *error = "cannot open base image " + config_.base_path + ": " + strerror(errno);
+        return false;
+    }
+    struct stat st;
+    bool ok = fstat(base_fd, &st) == 0;
+    if (!ok) {
+        *error = "cannot stat base image " + config_.base_path + ": " + strerror(errno);
+    } else {
+        base_size_.store(static_cast<uint64_t>(st.st_size), std::memory_order_relaxed);
+        if (!config_.base_sha256.empty()) {
+            // 补丁只对确定的旧文件有效：先校验，不符时不浪费流量下载补丁
+            std::string actual = FileSha256(base_fd, config_.buffer_bytes);
+            if (actual != config_.base_sha256) {
+                *error = "base image SHA-256 mismatch: expected " + config_.base_sha256 + ", got " + actual;
+                ok = false;
+            }
+        }
+    }
+    ok = ok && Apply(base_fd, static_cast<uint64_t>(st.st_size), error);
+    close(base_fd);
+    total_ms_.store(static_cast<double>(SteadyNowMs() - start), std::memory_order_relaxed);
+    if (ok) {
+        INFO("delta update {}: {} bytes from a {} byte patch ({} transferred) in {}ms", config_.path,
+             size_.load(std::memory_order_relaxed), patch_bytes_.load(std::memory_order_relaxed),
+             transfer_bytes_.load(std::memory_order_relaxed), SteadyNowMs() - start);
+    }
+    return ok;
+}
+
+bool DeltaUpdater::Apply(int base_fd, uint64_t base_size, std::string* error) {
+    int out_fd = open(part_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out_fd < 0) {
+        *error = "cannot create " + part_ + ": " + strerror(errno);
+        return false;
+    }
+    UpdateSink sink(base_fd, base_size, out_fd, config_, &cancelled_);
+    std::map<std::string, std::string> headers = config_.headers;
+    if (config_.compressed) {
+        headers["Accept-Encoding"] = "";  // 交给 curl：列出它支持的全部编码并透明解压
+    }
+    HttpClient http(config_.url);
+    long status = 0;
+    bool received = http.get(sink, headers, 0, &status);
+    bool ok = received && sink.Finish();
+    patch_bytes_.store(sink.PatchBytes(), std::memory_order_relaxed);
+    transfer_bytes_.store(http.GetStats().bytes_downloaded, std::memory_order_relaxed);
+    diff_bytes_.store(sink.DiffBytes(), std::memory_order_relaxed);
+    extra_bytes_.store(sink.ExtraBytes(), std::memory_order_relaxed);
+    size_.store(sink.NewSize(), std::memory_order_relaxed);
+    if (!ok) {
+        if (cancelled_.load(std::memory_order_relaxed)) {
+            *error = "cancelled";
+        } else if (!sink.Error().empty()) {
+            *error = sink.Error();
+        } else {
+            *error = "patch download failed (HTTP " + std::to_string(status) + ")";
+        }
+    } else if (sink.Sha256() != config_.sha256) {
+        *error = "SHA-256 mismatch: expected " + config_.sha256 + ", got " + sink.Sha256();
+        ok = false;
+    } else if (!config_.patch_sha256.empty() && sink.PatchSha256() != config_.patch_sha256) {
+        *error = "patch SHA-256 mismatch: expected " + config_.patch_sha256 + ", got " + sink.PatchSha256();
+        ok = false;
+    } else if (fsync(out_fd) != 0) {
+        *error = "fsync " + part_ + " failed: " + strerror(errno);
+        ok = false;
+    }
+    close(out_fd);
+    if (ok && rename(part_.c_str(), config_.path.c_str()) != 0) {
+        *error = "cannot rename " + part_ + " to " + config_.path + ": " + strerror(errno);
+        ok = false;
+    }
+    if (!ok) {
+        unlink(part_.c_str());
+    }
+    return ok;
+}
+
+}  // namespace linx
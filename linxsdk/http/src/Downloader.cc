@@ -0,0 +1,770 @@
+#include "Downloader.h"
+
+#include <fcntl.h>
+#include <openssl/evp.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "HttpClient.h"
+#include "Json.h"
+#include "Log.h"
+#include "SteadyClock.h"
+
+namespace linx {
+
+namespace {
+
+constexpr long kConnectTimeoutSeconds = 10;
+constexpr int64_t kRetryBackoffMs = 500;      // 第 n 次重试前等待 n 倍
+constexpr int64_t kStateIntervalMs = 1000;    // 进度记录的最短写出间隔
+constexpr int64_t kProgressIntervalMs = 250;  // 进度回调的最短间隔
+
+std::string Hex(const unsigned char* digest, unsigned int len) {
+    static const char kDigits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(len * 2);
+    for (unsigned int i = 0; i < len; ++i) {
+        hex.push_back(kDigits[digest[i] >> 4]);
+        hex.push_back(kDigits[digest[i] & 0x0f]);
+    }
+    return hex;
+}
+
+std::string Sha256(const unsigned char* data, size_t len) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = 0;
+    static const unsigned char kEmpty = 0;
+    if (EVP_Digest(data != nullptr ? data : &kEmpty, len, digest, &digest_len, EVP_sha256(), nullptr) != 1) {
+        return std::string();
+    }
+    return Hex(digest, digest_len);
+}
+
+std::string Lower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+curl_slist* AppendHeaders(curl_slist* list, const std::map<std::string, std::string>& headers) {
+    for (const auto& item : headers) {
+        list = curl_slist_append(list, (item.first + ": " + item.second).c_str());
+    }
+    return list;
+}
+
+// 弱 ETag（W/ 开头）不能用于 If-Range
+bool StrongEtag(const std::string& etag) {
+    return !etag.empty() && etag.compare(0, 2, "W/") != 0;
+}
+
+// HEAD 响应头：每经过一次重定向从新的状态行开始重新记录
+struct ProbeHeaders {
+    std::string etag;
+    std::string last_modified;
+    bool ranges = false;
+};
+
+size_t ProbeHeader(char* buffer, size_t size, size_t nitems, void* arg) {
+    size_t len = size * nitems;
+    auto* headers = static_cast<ProbeHeaders*>(arg);
+    std::string line(buffer, len);
+    if (line.compare(0, 5, "HTTP/") == 0) {
+        *headers = ProbeHeaders();
+        return len;
+    }
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+        return len;
+    }
+    std::string name = Lower(line.substr(0, colon));
+    size_t begin = line.find_first_not_of(" \t", colon + 1);
+    size_t end = line.find_last_not_of(" \t\r\n");
+    std::string value = begin == std::string::npos || end < begin ? std::string() : line.substr(begin, end - begin + 1);
+    if (name == "etag") {
+        headers->etag = value;
+    } else if (name == "last-modified") {
+        headers->last_modified = value;
+    } else if (name == "accept-ranges") {
+        headers->ranges = Lower(value).find("bytes") != std::string::npos;
+    }
+    return len;
+}
+
+// 探测 / 整体下载期间检查 Cancel
+int CancelCheck(void* arg, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    return static_cast<std::atomic<bool>*>(arg)->load(std::memory_order_relaxed) ? 1 : 0;
+}
+
+// 整体下载的接收端：FileSink 之上加一个取消检查
+class CancellableSink : public HttpSink {
+public:
+    CancellableSink(const std::string& path, const std::atomic<bool>* cancelled)
+        : file_(path), cancelled_(cancelled) {}
+    bool Begin(long status, int64_t content_length) override { return file_.Begin(status, content_length); }
+    bool Write(const char* data, size_t len) override {
+        return !cancelled_->load(std::memory_order_relaxed) && file_.Write(data, len);
+    }
+    void End(bool ok) override { file_.End(ok); }
+    uint64_t Size() const { return file_.Size(); }
+
+private:
+    FileSink file_;
+    const std::atomic<bool>* cancelled_;
+};
+
+}  // namespace
+
+// 一个分段的传输状态，句柄的 CURLOPT_PRIVATE 指向它
+struct Downloader::Segment {
+    Downloader* owner = nullptr;
+    size_t index = 0;
+    uint64_t offset = 0;
+    uint64_t length = 0;
+    uint64_t received = 0;
+    CURL* curl = nullptr;
+    curl_slist* headers = nullptr;
+    EVP_MD_CTX* sha = nullptr;
+    long expected_status = 206;
+    bool checked = false;   // 已核对状态码
+    bool rejected = false;  // 状态码或长度不符，已中止
+    bool if_range = false;  // 请求带了 If-Range
+    bool changed = false;   // 带 If-Range 的请求得到 200：服务器上的文件已变化
+    bool unranged = false;  // 不带 If-Range 的范围请求得到 200：服务器忽略了 Range
+    int attempts = 0;
+    int64_t ready_ms = 0;   // 重试不早于这个时间
+    std::string error;
+
+    void Release() {
+        if (curl != nullptr) {
+            curl_easy_cleanup(curl);
+            curl = nullptr;
+        }
+        curl_slist_free_all(headers);
+        headers = nullptr;
+        if (sha != nullptr) {
+            EVP_MD_CTX_free(sha);
+            sha = nullptr;
+        }
+    }
+};
+
+Downloader::Downloader(DownloadConfig config)
+    : config_(std::move(config)), part_(config_.path + ".part"), state_(config_.path + ".part.state") {
+    config_.segment_bytes = std::max<size_t>(config_.segment_bytes, 64 * 1024);
+    config_.parallel = std::max(config_.parallel, 1);
+    config_.retries = std::max(config_.retries, 0);
+    config_.sha256 = Lower(config_.sha256);
+    for (auto& hash : config_.segment_sha256) {
+        hash = Lower(hash);
+    }
+}
+
+Downloader::~Downloader() {
+    UnmapPart();
+}
+
+void Downloader::Cancel() {
+    cancelled_.store(true, std::memory_order_relaxed);
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    if (multi_ != nullptr) {
+        curl_multi_wakeup(multi_);
+    }
+}
+
+DownloadStats Downloader::GetStats() const {
+    DownloadStats stats;
+    stats.size = size_.load(std::memory_order_relaxed);
+    stats.bytes_downloaded = bytes_downloaded_.load(std::memory_order_relaxed);
+    stats.bytes_resumed = bytes_resumed_.load(std::memory_order_relaxed);
+    stats.segments = segments_.load(std::memory_order_relaxed);
+    stats.segments_resumed = segments_resumed_.load(std::memory_order_relaxed);
+    stats.retries = retries_.load(std::memory_order_relaxed);
+    stats.hash_failures = hash_failures_.load(std::memory_order_relaxed);
+    stats.ranged = ranged_.load(std::memory_order_relaxed);
+    stats.total_ms = total_ms_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+bool Downloader::Run(std::string* error) {
+    std::string unused;
+    if (error == nullptr) {
+        error = &unused;
+    }
+    int64_t started = SteadyNowMs();
+    bool ok = false;
+    bool single_stream = false;  // 服务器忽略过 Range，不再分段
+    int passes = 2;              // 首次 + 文件变化后重来一次；改为单流时另加一次
+    for (int pass = 0; pass < passes; ++pass) {
+        if (cancelled_.load(std::memory_order_relaxed)) {
+            *error = "cancelled";
+            break;
+        }
+        error->clear();
+        Remote remote;
+        if (!Probe(&remote, error)) {
+            break;
+        }
+        if (remote.size < 0) {
+            ok = FetchWhole(remote, error);
+            break;
+        }
+        if (single_stream) {
+            remote.ranges = false;
+        }
+        size_.store(static_cast<uint64_t>(remote.size), std::memory_order_relaxed);
+        ranged_.store(remote.ranges, std::memory_order_relaxed);
+        uint64_t size = static_cast<uint64_t>(remote.size);
+        // 清单总是按 segment_bytes 切分；不分段时只有一个传输分段，清单在 Finish 中逐片比对
+        size_t manifest_count = static_cast<size_t>((size + config_.segment_bytes - 1) / config_.segment_bytes);
+        size_t count = remote.ranges ? manifest_count : 1;
+        if (!config_.segment_sha256.empty() && config_.segment_sha256.size() != manifest_count) {
+            *error = "segment manifest has " + std::to_string(config_.segment_sha256.size()) + " entries, expected " +
+                     std::to_string(manifest_count);
+            break;
+        }
+        segments_.store(count, std::memory_order_relaxed);
+        std::vector<std::string> hashes = LoadState(remote, count);
+        if (!MapPart(size, error)) {
+            break;
+        }
+
+        // 核对沿用的分段：记录与磁盘内容（以及清单）一致的才算完成
+        done_bytes_ = 0;
+        partial_bytes_ = 0;
+        uint64_t resumed = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (hashes[i].empty()) {
+                continue;
+            }
+            uint64_t offset = i * static_cast<uint64_t>(config_.segment_bytes);
+            uint64_t length = std::min<uint64_t>(config_.segment_bytes, size - offset);
+            std::string actual = Sha256(map_ + offset, length);
+            if (actual != hashes[i] || (!config_.segment_sha256.empty() && actual != config_.segment_sha256[i])) {
+                WARN("download {}: segment {} changed on disk, fetching it again", config_.path, i);
+                hash_failures_.fetch_add(1, std::memory_order_relaxed);
+                hashes[i].clear();
+                continue;
+            }
+            done_bytes_ += length;
+            ++resumed;
+        }
+        segments_resumed_.fetch_add(resumed, std::memory_order_relaxed);
+        bytes_resumed_.fetch_add(done_bytes_, std::memory_order_relaxed);
+        if (resumed > 0) {
+            INFO("download {}: resuming, {}/{} segments ({} bytes) already done", config_.path, resumed, count,
+                 done_bytes_);
+        }
+
+        {
+            std::lock_guard<ProfiledMutex> lock(mutex_);
+            multi_ = curl_multi_init();
+        }
+        curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        curl_multi_setopt(multi_, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(config_.parallel));
+        Restart restart = Restart::None;
+        ok = Transfer(remote, &hashes, &restart, error);
+        {
+            std::lock_guard<ProfiledMutex> lock(mutex_);
+            curl_multi_cleanup(multi_);
+            multi_ = nullptr;
+        }
+        if (restart == Restart::Changed) {
+            // 服务器上换了文件（如发布了新固件）：已下载的分段属于旧文件，全部丢弃后重来一次
+            WARN("download {}: remote file changed, restarting from scratch", config_.path);
+            Discard();
+            ok = false;
+            *error = "remote file changed during download";
+            continue;
+        }
+        if (restart == Restart::Unranged) {
+            // 没有校验器可发 If-Range，200 说明不了文件是否变化，只说明 Range 不可用：不分段，用一个 GET 取整个文件
+            WARN("download {}: server ignored Range, downloading as a single stream", config_.path);
+            Discard();
+            single_stream = true;
+            ++passes;  // 不占用文件变化的重试机会
+            ok = false;
+            *error = "server ignored Range";
+            continue;
+        }
+        ok = ok && Finish(remote.ranges, error);
+        break;
+    }
+    UnmapPart();
+    ReportProgress(true);
+    total_ms_.store(static_cast<double>(SteadyNowMs() - started), std::memory_order_relaxed);
+    if (!ok) {
+        WARN("download {} failed: {}", config_.path, *error);
+    }
+    return ok;
+}
+
+bool Downloader::Probe(Remote* remote, std::string* error) {
+    CURL* curl = curl_easy_init();
+    if (curl == nullptr) {
+        *error = "curl_easy_init failed";
+        return false;
+    }
+    ConfigureCurlHandle(curl);
+    ProbeHeaders headers;
+    curl_slist* list = AppendHeaders(nullptr, config_.headers);
+    curl_easy_setopt(curl, CURLOPT_URL, config_.url.c_str());
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 5L);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, list);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, ProbeHeader);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &headers);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, kConnectTimeoutSeconds);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, CancelCheck);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &cancelled_);
+    CURLcode res = curl_easy_perform(curl);
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    curl_off_t length = -1;
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+    char* effective = nullptr;
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &effective);
+    remote->url = effective != nullptr ? effective : config_.url;
+    curl_easy_cleanup(curl);
+    curl_slist_free_all(list);
+
+    if (res != CURLE_OK) {
+        *error = cancelled_.load(std::memory_order_relaxed) ? "cancelled" : curl_easy_strerror(res);
+        return false;
+    }
+    if (status == 405 || status == 501) {
+        // 不支持 HEAD：按长度未知整体下载
+        remote->url = config_.url;
+        return true;
+    }
+    if (status < 200 || status >= 300) {
+        *error = "HTTP status " + std::to_string(status);
+        return false;
+    }
+    remote->size = length;
+    remote->etag = headers.etag;
+    remote->last_modified = headers.last_modified;
+    remote->ranges = headers.ranges && length > 0;
+    return true;
+}
+
+bool Downloader::FetchWhole(const Remote& remote, std::string* error) {
+    // FileSink 写 part_.part，完整收到后改名为 part_，校验通过后再改名为 path
+    CancellableSink sink(part_, &cancelled_);
+    HttpClient client(remote.url);
+    long status = 0;
+    bool ok = client.get(sink, config_.headers, 0, &status);
+    bytes_downloaded_.fetch_add(sink.Size(), std::memory_order_relaxed);
+    if (!ok) {
+        *error = cancelled_.load(std::memory_order_relaxed) ? "cancelled" : "HTTP status " + std::to_string(status);
+        return false;
+    }
+    segments_.store(1, std::memory_order_relaxed);
+    size_.store(sink.Size(), std::memory_order_relaxed);
+    done_bytes_ = sink.Size();
+    if (!MapPart(sink.Size(), error)) {
+        return false;
+    }
+    return Finish(false, error);
+}
+
+std::vector<std::string> Downloader::LoadState(const Remote& remote, size_t count) {
+    std::vector<std::string> hashes(count);
+    // 没有校验器（ETag / Last-Modified）也没有清单时无法判断服务器上的文件是否还是同一个，不续传
+    bool resumable = remote.ranges && (!remote.etag.empty() || !remote.last_modified.empty() ||
+                                       !config_.segment_sha256.empty());
+    std::ifstream in(state_);
+    if (!in) {
+        return hashes;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    json state = json::parse(buffer.str(), nullptr, false);
+    struct stat st;
+    bool valid = resumable && state.is_object() && state.value("url", "") == config_.url &&
+                 state.value("size", static_cast<int64_t>(-1)) == remote.size &&
+                 state.value("etag", "") == remote.etag && state.value("last_modified", "") == remote.last_modified &&
+                 state.value("segment_bytes", static_cast<uint64_t>(0)) == config_.segment_bytes &&
+                 stat(part_.c_str(), &st) == 0 && st.st_size == remote.size;
+    auto segments = valid ? state.find("segments") : state.end();
+    if (!valid || segments == state.end() || !segments->is_array() || segments->size() != count) {
+        INFO("download {}: previous progress does not match the remote file, starting over", config_.path);
+        unlink(state_.c_str());
+        return hashes;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if ((*segments)[i].is_string()) {
+            hashes[i] = (*segments)[i].get<std::string>();
+        }
+    }
+    return hashes;
+}
+
+bool Downloader::SaveState(const Remote& remote, const std::vector<std::string>& hashes) {
+    // 分段数据先落盘，记录中出现的分段掉电后一定完整
+    if (map_ != nullptr && msync(map_, map_size_, MS_SYNC) != 0) {
+        WARN("download {}: msync failed: {}", part_, strerror(errno));
+        return false;
+    }
+    json state = {
+        {"url", config_.url},
+        {"size", remote.size},
+        {"etag", remote.etag},
+        {"last_modified", remote.last_modified},
+        {"segment_bytes", static_cast<uint64_t>(config_.segment_bytes)},
+        {"segments", hashes},
+    };
+    std::string tmp = state_ + ".tmp";
+    std::string data = state.dump();
+    FILE* file = fopen(tmp.c_str(), "wb");
+    if (file == nullptr) {
+        WARN("download {}: open {} failed: {}", config_.path, tmp, strerror(errno));
+        return false;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = fflush(file) == 0 && ok;
+    ok = fsync(fileno(file)) == 0 && ok;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), state_.c_str()) != 0) {
+        WARN("download {}: write {} failed: {}", config_.path, state_, strerror(errno));
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Downloader::MapPart(uint64_t size, std::string* error) {
+    UnmapPart();
+    fd_ = open(part_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        *error = "cannot open " + part_ + ": " + strerror(errno);
+        return false;
+    }
+    if (ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+        *error = "cannot resize " + part_ + ": " + strerror(errno);
+        UnmapPart();
+        return false;
+    }
+    // 先占住全部空间：磁盘不够时现在就失败，而不是下载到一半在缺页处收到 SIGBUS
+    int rc = size > 0 ? posix_fallocate(fd_, 0, static_cast<off_t>(size)) : 0;
+    if (rc != 0 && rc != EOPNOTSUPP && rc != EINVAL) {
+        *error = "cannot allocate " + std::to_string(size) + " bytes for " + part_ + ": " + strerror(rc);
+        UnmapPart();
+        return false;
+    }
+    if (size > 0) {
+        void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (map == MAP_FAILED) {
+            *error = "cannot map " + part_ + ": " + strerror(errno);
+            UnmapPart();
+            return false;
+        }
+        map_ = static_cast<unsigned char*>(map);
+        map_size_ = size;
+    }
+    return true;
+}
+
+void Downloader::UnmapPart() {
+    if (map_ != nullptr) {
+        munmap(map_, map_size_);
+        map_ = nullptr;
+        map_size_ = 0;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+size_t Downloader::OnData(char* data, size_t size, size_t nmemb, void* arg) {
+    auto* segment = static_cast<Segment*>(arg);
+    size_t len = size * nmemb;
+    if (!segment->checked) {
+        segment->checked = true;
+        long status = 0;
+        curl_easy_getinfo(segment->curl, CURLINFO_RESPONSE_CODE, &status);
+        if (status != segment->expected_status) {
+            if (segment->expected_status == 206 && status == 200) {
+                segment->changed = segment->if_range;
+                segment->unranged = !segment->if_range;
+            }
+            segment->rejected = true;
+            segment->error = "HTTP status " + std::to_string(status);
+            return 0;
+        }
+    }
+    if (len > segment->length - segment->received) {
+        segment->rejected = true;
+        segment->error = "response longer than the requested range";
+        return 0;
+    }
+    Downloader* owner = segment->owner;
+    memcpy(owner->map_ + segment->offset + segment->received, data, len);
+    EVP_DigestUpdate(segment->sha, data, len);
+    segment->received += len;
+    owner->partial_bytes_ += len;
+    owner->bytes_downloaded_.fetch_add(len, std::memory_order_relaxed);
+    return len;
+}
+
+bool Downloader::StartSegment(Segment* segment, const Remote& remote) {
+    segment->Release();
+    segment->received = 0;
+    segment->checked = false;
+    segment->rejected = false;
+    segment->if_range = false;
+    segment->changed = false;
+    segment->unranged = false;
+    segment->error.clear();
+    segment->attempts++;
+    segment->curl = curl_easy_init();
+    segment->sha = EVP_MD_CTX_new();
+    if (segment->curl == nullptr || segment->sha == nullptr ||
+        EVP_DigestInit_ex(segment->sha, EVP_sha256(), nullptr) != 1) {
+        segment->error = "out of memory";
+        return false;
+    }
+    CURL* curl = segment->curl;
+    ConfigureCurlHandle(curl);
+    segment->headers = AppendHeaders(nullptr, config_.headers);
+    if (remote.ranges) {
+        std::string range = "Range: bytes=" + std::to_string(segment->offset) + "-" +
+                            std::to_string(segment->offset + segment->length - 1);
+        segment->headers = curl_slist_append(segment->headers, range.c_str());
+        // 文件变化时服务器返回整个新文件（200），据此丢弃旧进度
+        const std::string& validator = StrongEtag(remote.etag) ? remote.etag : remote.last_modified;
+        if (!validator.empty()) {
+            segment->headers = curl_slist_append(segment->headers, ("If-Range: " + validator).c_str());
+            segment->if_range = true;
+        }
+        segment->expected_status = 206;
+    } else {
+        segment->expected_status = 200;
+    }
+    curl_easy_setopt(curl, CURLOPT_URL, remote.url.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 5L);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, segment->headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, OnData);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, segment);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, segment);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, kConnectTimeoutSeconds);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, config_.low_speed_seconds);
+    CURLMcode code = curl_multi_add_handle(multi_, curl);
+    if (code != CURLM_OK) {
+        segment->error = curl_multi_strerror(code);
+        return false;
+    }
+    return true;
+}
+
+bool Downloader::Transfer(const Remote& remote, std::vector<std::string>* hashes, Restart* restart,
+                          std::string* error) {
+    size_t count = hashes->size();
+    uint64_t size = static_cast<uint64_t>(remote.size);
+    uint64_t segment_bytes = remote.ranges ? config_.segment_bytes : size;
+    std::vector<Segment> segments(count);
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < count; ++i) {
+        Segment& segment = segments[i];
+        segment.owner = this;
+        segment.index = i;
+        segment.offset = i * segment_bytes;
+        segment.length = std::min(segment_bytes, size - segment.offset);
+        if ((*hashes)[i].empty()) {
+            pending.push_back(i);
+        }
+    }
+
+    size_t active = 0;
+    bool failed = false;
+    bool dirty = false;
+    int64_t last_save_ms = SteadyNowMs();
+    while (!failed && *restart == Restart::None && (!pending.empty() || active > 0)) {
+        if (cancelled_.load(std::memory_order_relaxed)) {
+            *error = "cancelled";
+            failed = true;
+            break;
+        }
+        int64_t now = SteadyNowMs();
+        int64_t next_ready_ms = now + 1000;
+        for (auto it = pending.begin(); it != pending.end() && active < static_cast<size_t>(config_.parallel);) {
+            Segment& segment = segments[*it];
+            if (segment.ready_ms > now) {
+                next_ready_ms = std::min(next_ready_ms, segment.ready_ms);
+                ++it;
+                continue;
+            }
+            if (!StartSegment(&segment, remote)) {
+                *error = "segment " + std::to_string(segment.index) + ": " + segment.error;
+                failed = true;
+                break;
+            }
+            ++active;
+            it = pending.erase(it);
+        }
+        if (failed) {
+            break;
+        }
+
+        int running = 0;
+        curl_multi_perform(multi_, &running);
+        int left = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi_, &left)) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            Segment* segment = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &segment);
+            CURLcode result = msg->data.result;
+            curl_multi_remove_handle(multi_, msg->easy_handle);
+            --active;
+            partial_bytes_ -= segment->received;
+
+            unsigned char digest[EVP_MAX_MD_SIZE];
+            unsigned int digest_len = 0;
+            EVP_DigestFinal_ex(segment->sha, digest, &digest_len);
+            std::string hash = Hex(digest, digest_len);
+            bool ok = result == CURLE_OK && !segment->rejected && segment->received == segment->length;
+            if (ok && remote.ranges && !config_.segment_sha256.empty() &&
+                hash != config_.segment_sha256[segment->index]) {
+                hash_failures_.fetch_add(1, std::memory_order_relaxed);
+                segment->error = "SHA-256 mismatch";
+                ok = false;
+            } else if (!ok && segment->error.empty()) {
+                segment->error = result != CURLE_OK ? curl_easy_strerror(result)
+                                                    : "short response (" + std::to_string(segment->received) + " of " +
+                                                          std::to_string(segment->length) + " bytes)";
+            }
+            segment->Release();
+
+            if (ok) {
+                (*hashes)[segment->index] = hash;
+                done_bytes_ += segment->length;
+                dirty = true;
+            } else if (segment->changed) {
+                *restart = Restart::Changed;
+            } else if (segment->unranged) {
+                *restart = Restart::Unranged;
+            } else if (segment->attempts <= config_.retries) {
+                WARN("download {}: segment {} failed ({}), retry {}/{}", config_.path, segment->index,
+                     segment->error, segment->attempts, config_.retries);
+                retries_.fetch_add(1, std::memory_order_relaxed);
+                segment->ready_ms = SteadyNowMs() + kRetryBackoffMs * segment->attempts;
+                pending.push_back(segment->index);
+            } else {
+                *error = "segment " + std::to_string(segment->index) + ": " + segment->error;
+                failed = true;
+            }
+        }
+
+        ReportProgress(false);
+        if (dirty && remote.ranges && SteadyNowMs() - last_save_ms >= kStateIntervalMs) {
+            dirty = !SaveState(remote, *hashes);
+            last_save_ms = SteadyNowMs();
+        }
+        if (!failed && *restart == Restart::None && (!pending.empty() || active > 0)) {
+            int timeout_ms = static_cast<int>(std::max<int64_t>(std::min<int64_t>(next_ready_ms - SteadyNowMs(), 1000), 0));
+            curl_multi_poll(multi_, nullptr, 0, timeout_ms, nullptr);
+        }
+    }
+
+    for (Segment& segment : segments) {
+        if (segment.curl != nullptr) {
+            curl_multi_remove_handle(multi_, segment.curl);
+            partial_bytes_ -= segment.received;
+        }
+        segment.Release();
+    }
+    if (*restart != Restart::None) {
+        return false;
+    }
+    if (remote.ranges) {
+        SaveState(remote, *hashes);  // 失败或取消时下次从这里续传
+    }
+    return !failed;
+}
+
+bool Downloader::Finish(bool ranged, std::string* error) {
+    if (!ranged && !config_.segment_sha256.empty()) {
+        // 整体下载没有逐段校验过：按 segment_bytes 切片与清单比对
+        size_t count = static_cast<size_t>((map_size_ + config_.segment_bytes - 1) / config_.segment_bytes);
+        if (config_.segment_sha256.size() != count) {
+            *error = "segment manifest has " + std::to_string(config_.segment_sha256.size()) + " entries, expected " +
+                     std::to_string(count);
+            Discard();
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t offset = i * static_cast<uint64_t>(config_.segment_bytes);
+            uint64_t length = std::min<uint64_t>(config_.segment_bytes, map_size_ - offset);
+            if (Sha256(map_ + offset, length) != config_.segment_sha256[i]) {
+                hash_failures_.fetch_add(1, std::memory_order_relaxed);
+                *error = "segment " + std::to_string(i) + ": SHA-256 mismatch";
+                Discard();
+                return false;
+            }
+        }
+    }
+    if (!config_.sha256.empty()) {
+        std::string actual = Sha256(map_, map_size_);
+        if (actual != config_.sha256) {
+            // 分段都已通过（或没有清单），无法判断是哪一段错了，全部丢弃
+            hash_failures_.fetch_add(1, std::memory_order_relaxed);
+            *error = "SHA-256 mismatch: expected " + config_.sha256 + ", got " + actual;
+            Discard();
+            return false;
+        }
+    }
+    if (map_ != nullptr && msync(map_, map_size_, MS_SYNC) != 0) {
+        *error = "msync " + part_ + " failed: " + strerror(errno);
+        return false;
+    }
+    UnmapPart();
+    if (rename(part_.c_str(), config_.path.c_str()) != 0) {
+        *error = "cannot rename " + part_ + " to " + config_.path + ": " + strerror(errno);
+        return false;
+    }
+    unlink(state_.c_str());
+    INFO("download {}: {} bytes in {} segments ({} resumed, {} retries)", config_.path,
+         size_.load(std::memory_order_relaxed), segments_.load(std::memory_order_relaxed),
+         segments_resumed_.load(std::memory_order_relaxed), retries_.load(std::memory_order_relaxed));
+    return true;
+}
+
+void Downloader::Discard() {
+    UnmapPart();
+    unlink(part_.c_str());
+    unlink(state_.c_str());
+    done_bytes_ = 0;
+    partial_bytes_ = 0;
+}
+
+void Downloader::ReportProgress(bool force) {
+    if (!config_.progress) {
+        return;
+    }
+    int64_t now = SteadyNowMs();
+    if (!force && now - last_progress_ms_ < kProgressIntervalMs) {
+        return;
+    }
+    last_progress_ms_ = now;
+    config_.progress(done_bytes_ + partial_bytes_, size_.load(std::memory_order_relaxed));
+}
+
+}  // namespace linx
@@ -1,5 +1,17 @@
 #include "HttpClient.h"
 
+#include <strings.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "FileStream.h"
 #include "Json.h"
 #include "Log.h"
 
@@ -20,33 +32,392 @@ int getContent(std::string& content, const std::string& inputText, const std::st
 
 namespace linx {
 
-static size_t write_data(void* buffer, size_t size, size_t nmemb, void* stream) {
-    std::string* pStream = static_cast<std::string*>(stream);
-    (*pStream).append((char*)buffer, size * nmemb);
-    return size * nmemb;
+bool StringSink::Begin(long, int64_t content_length) {
+    if (content_length > 0) {
+        out_->reserve(out_->size() + std::min(static_cast<size_t>(content_length), max_reserve_));
+    }
+    return true;
+}
+
+bool BufferSink::Begin(long, int64_t content_length) {
+    if (content_length > 0 && static_cast<uint64_t>(content_length) > capacity_ - size_) {
+        ERROR("HttpClient: response of {} bytes does not fit the {} byte buffer", content_length, capacity_ - size_);
+        return false;
+    }
+    return true;
+}
+
+bool BufferSink::Write(const char* data, size_t len) {
+    if (len > capacity_ - size_) {
+        ERROR("HttpClient: response exceeds the {} byte buffer", capacity_);
+        return false;
+    }
+    memcpy(data_ + size_, data, len);
+    size_ += len;
+    return true;
+}
+
+FileSink::FileSink(const std::string& path, const AsyncFileWriterConfig* async)
+    : path_(path), part_(path + ".part") {
+    if (async != nullptr) {
+        async_ = std::make_unique<AsyncFileWriterConfig>(*async);
+    }
 }
 
+FileSink::~FileSink() {
+    if (stream_ && stream_->valid()) {
+        End(false);  // 传输没有走到结束（如请求在开始前就失败），不留下半个文件
+    }
+}
+
+bool FileSink::Begin(long status, int64_t) {
+    accepted_ = status >= 200 && status < 300;
+    if (!accepted_) {
+        ERROR("HttpClient: {} not written, HTTP status {}", path_, status);
+        return false;
+    }
+    stream_ = std::make_unique<FileStream>();
+    int opened = async_ ? stream_->fopenAsync(part_, *async_) : stream_->fopen(part_, "wb");
+    return opened == 0;
+}
+
+bool FileSink::Write(const char* data, size_t len) {
+    if (stream_->fwrite(const_cast<char*>(data), 1, static_cast<int>(len)) != static_cast<int>(len)) {
+        ERROR("HttpClient: writing {} failed", part_);
+        return false;
+    }
+    size_ += len;
+    return true;
+}
+
+void FileSink::End(bool ok) {
+    if (!stream_) {
+        return;
+    }
+    ok = ok && accepted_ && stream_->fflush() == 0;
+    stream_->fclose();
+    ok = ok && !(stream_->asyncWriter() != nullptr && stream_->asyncWriter()->Failed());
+    stream_.reset();
+    if (!ok || rename(part_.c_str(), path_.c_str()) != 0) {
+        unlink(part_.c_str());
+        if (ok) {
+            ERROR("HttpClient: cannot rename {} to {}", part_, path_);
+        }
+    }
+}
+
+namespace {
+
+// 一次传输的接收状态：第一块数据到达时取状态码和 Content-Length 调用 Begin
+struct SinkContext {
+    CURL* curl = nullptr;
+    HttpSink* sink = nullptr;
+    bool begun = false;
+    bool aborted = false;  // sink 拒绝了数据
+};
+
+bool BeginSink(SinkContext* context) {
+    if (!context->begun) {
+        context->begun = true;
+        long status = 0;
+        curl_easy_getinfo(context->curl, CURLINFO_RESPONSE_CODE, &status);
+        curl_off_t length = -1;
+        curl_easy_getinfo(context->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+        context->aborted = !context->sink->Begin(status, length);
+    }
+    return !context->aborted;
+}
+
+// 传输结束：没有响应体时补一次 Begin，然后 End
+bool EndSink(SinkContext* context, bool transferred) {
+    bool ok = transferred && BeginSink(context) && !context->aborted;
+    context->sink->End(ok);
+    return ok;
+}
+
+size_t write_data(void* buffer, size_t size, size_t nmemb, void* arg) {
+    auto* context = static_cast<SinkContext*>(arg);
+    size_t len = size * nmemb;
+    if (!BeginSink(context)) {
+        return 0;  // 与 len 不等即中止，curl 返回 CURLE_WRITE_ERROR
+    }
+    if (!context->sink->Write(static_cast<const char*>(buffer), len)) {
+        context->aborted = true;
+        return 0;
+    }
+    return len;
+}
+
+}  // namespace
+
+// 从响应头中取出 ETag（头部名不区分大小写），用于条件请求
+static size_t header_data(char* buffer, size_t size, size_t nitems, void* userdata) {
+    size_t len = size * nitems;
+    static const char kName[] = "etag:";
+    constexpr size_t kNameLen = sizeof(kName) - 1;
+    if (len > kNameLen && strncasecmp(buffer, kName, kNameLen) == 0) {
+        std::string value(buffer + kNameLen, len - kNameLen);
+        size_t begin = value.find_first_not_of(" \t");
+        size_t end = value.find_last_not_of(" \t\r\n");
+        *static_cast<std::string*>(userdata) =
+            begin == std::string::npos ? std::string() : value.substr(begin, end - begin + 1);
+    }
+    return len;
+}
+
+namespace {
+
+// 进程级共享对象：所有 HttpClient 的句柄共用 DNS 缓存、TLS 会话缓存和连接池。
+// curl 对每类共享数据分别回调加解锁，这里每类一个互斥锁
+class HttpShare {
+public:
+    // 有意不释放：进程退出时全局 HttpClient 的句柄可能在静态析构阶段仍会回调加解锁
+    static HttpShare& Instance() {
+        static HttpShare* share = new HttpShare();
+        return *share;
+    }
+
+    CURLSH* Handle() const { return share_; }
+
+private:
+    HttpShare() {
+        curl_global_init(CURL_GLOBAL_DEFAULT);  // 非线程安全，借静态局部变量的初始化保证只执行一次
+        share_ = curl_share_init();
+        if (share_ == nullptr) {
+            ERROR("HttpClient: curl_share_init failed, handles will not share caches");
+            return;
+        }
+        curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, Lock);
+        curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, Unlock);
+        curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    }
+
+    static void Lock(CURL*, curl_lock_data data, curl_lock_access, void* user) {
+        static_cast<HttpShare*>(user)->locks_[Index(data)].mutex.lock();
+    }
+    static void Unlock(CURL*, curl_lock_data data, void* user) {
+        static_cast<HttpShare*>(user)->locks_[Index(data)].mutex.unlock();
+    }
+    static size_t Index(curl_lock_data data) {
+        size_t index = static_cast<size_t>(data);
+        return index < CURL_LOCK_DATA_LAST ? index : 0;
+    }
+
+    // 每类共享数据一把锁，全部计入 http_share
+    struct ShareLock {
+        ProfiledMutex mutex{"http_share"};
+    };
+
+    CURLSH* share_ = nullptr;
+    ShareLock locks_[CURL_LOCK_DATA_LAST];
+};
+
+}  // namespace
+
+void ConfigureCurlHandle(CURL* curl) {
+    if (CURLSH* share = HttpShare::Instance().Handle()) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, share);
+    }
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);                   // 多线程下不用 SIGALRM 做 DNS 超时
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);  // HTTPS 上经 ALPN 协商 HTTP/2
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);                   // 优先在已有的 HTTP/2 连接上多路复用
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+}
+
+namespace {
+
+// 一个异步请求：句柄、请求数据和响应都归它所有，在 curl_multi 线程上完成后释放
+struct AsyncRequest {
+    CURL* curl = nullptr;
+    curl_slist* headers = nullptr;
+    std::string url;
+    std::string body;
+    HttpResponse response;
+    StringSink sink{&response.body};
+    SinkContext context;
+    HttpCallback done;
+    std::chrono::steady_clock::time_point submitted;
+
+    ~AsyncRequest() {
+        if (curl != nullptr) {
+            curl_easy_cleanup(curl);
+        }
+        curl_slist_free_all(headers);
+    }
+};
+
+// 进程级 curl_multi 线程：按需启动，提交的请求加入同一个 multi 句柄并行传输，
+// 空闲时阻塞在 curl_multi_poll 上，提交时由 curl_multi_wakeup 唤醒。与 HttpShare 一样有意不释放
+class HttpMulti {
+public:
+    static HttpMulti& Instance() {
+        static HttpMulti* multi = new HttpMulti();
+        return *multi;
+    }
+
+    void Submit(std::unique_ptr<AsyncRequest> request) {
+        {
+            std::lock_guard<ProfiledMutex> lock(mutex_);
+            pending_.push_back(std::move(request));
+        }
+        curl_multi_wakeup(multi_);
+    }
+
+private:
+    HttpMulti() {
+        HttpShare::Instance();  // 先完成 curl_global_init
+        multi_ = curl_multi_init();
+        curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        std::thread([this]() { Run(); }).detach();
+    }
+
+    void Run() {
+        std::vector<std::unique_ptr<AsyncRequest>> added;
+        while (true) {
+            {
+                std::lock_guard<ProfiledMutex> lock(mutex_);
+                added.swap(pending_);
+            }
+            for (auto& request : added) {
+                curl_easy_setopt(request->curl, CURLOPT_PRIVATE, request.get());
+                CURLMcode code = curl_multi_add_handle(multi_, request->curl);
+                if (code != CURLM_OK) {
+                    request->response.error = curl_multi_strerror(code);
+                    Finish(std::move(request));
+                    continue;
+                }
+                request.release();  // 由 multi 句柄持有，完成时经 CURLINFO_PRIVATE 取回
+            }
+            added.clear();
+
+            int running = 0;
+            curl_multi_perform(multi_, &running);
+            int left = 0;
+            while (CURLMsg* msg = curl_multi_info_read(multi_, &left)) {
+                if (msg->msg != CURLMSG_DONE) {
+                    continue;
+                }
+                AsyncRequest* raw = nullptr;
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &raw);
+                std::unique_ptr<AsyncRequest> request(raw);
+                CURLcode result = msg->data.result;
+                curl_multi_remove_handle(multi_, request->curl);
+                if (EndSink(&request->context, result == CURLE_OK)) {
+                    request->response.ok = true;
+                    curl_easy_getinfo(request->curl, CURLINFO_RESPONSE_CODE, &request->response.status);
+                } else {
+                    request->response.error = curl_easy_strerror(result);
+                }
+                Finish(std::move(request));
+            }
+            curl_multi_poll(multi_, nullptr, 0, 1000, nullptr);
+        }
+    }
+
+    static void Finish(std::unique_ptr<AsyncRequest> request) {
+        request->response.total_ms = std::chrono::duration<double, std::milli>(
+                                         std::chrono::steady_clock::now() - request->submitted)
+                                         .count();
+        if (!request->response.ok) {
+            ERROR("HttpClient async {} failed: {}", request->url, request->response.error);
+        }
+        if (request->done) {
+            request->done(std::move(request->response));
+        }
+    }
+
+    CURLM* multi_ = nullptr;
+    ProfiledMutex mutex_{"http_multi"};
+    std::vector<std::unique_ptr<AsyncRequest>> pending_;
+};
+
+}  // namespace
+
 HttpClient::HttpClient(const std::string& webApi) {
     webApi_ = webApi;
     getContent(host_, webApi_, std::string("//"), 0, std::string("/"));
 }
 
+HttpClient::~HttpClient() {
+    if (curl_ != nullptr) {
+        curl_easy_cleanup(curl_);
+    }
+}
+
 void HttpClient::reset(const std::string& webApi) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
     webApi_ = webApi;
     getContent(host_, webApi_, std::string("//"), 0, std::string("/"));
 }
 
-std::string HttpClient::getWebApi() { return webApi_; }
+std::string HttpClient::getWebApi() {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    return webApi_;
+}
+
+HttpClientStats HttpClient::GetStats() const {
+    HttpClientStats stats;
+    stats.requests = requests_.load(std::memory_order_relaxed);
+    stats.failures = failures_.load(std::memory_order_relaxed);
+    stats.new_connections = new_connections_.load(std::memory_order_relaxed);
+    stats.bytes_uploaded = bytes_uploaded_.load(std::memory_order_relaxed);
+    stats.bytes_downloaded = bytes_downloaded_.load(std::memory_order_relaxed);
+    return stats;
+}
 
-bool HttpClient::postRequest(std::string& response, CURL* curl) {
+CURL* HttpClient::prepare() {
+    HttpShare::Instance();  // 首次调用时完成 curl_global_init
+    if (curl_ == nullptr) {
+        curl_ = curl_easy_init();
+        if (curl_ == nullptr) {
+            return nullptr;
+        }
+    } else {
+        // 清掉上一个请求的选项（POST 数据、头部、表单），连接、DNS 和 TLS 会话缓存不受影响
+        curl_easy_reset(curl_);
+    }
+    ConfigureCurlHandle(curl_);
+    return curl_;
+}
+
+bool HttpClient::postRequest(std::string& response, CURL* curl, long timeoutSeconds) {
+    StringSink sink(&response);
+    return performRequest(sink, curl, timeoutSeconds);
+}
+
+bool HttpClient::performRequest(HttpSink& sink, CURL* curl, long timeoutSeconds) {
     INFO("{}", webApi_.c_str());
-    std::string* pStream = &response;
+    SinkContext context;
+    context.curl = curl;
+    context.sink = &sink;
     curl_easy_setopt(curl, CURLOPT_URL, (char*)webApi_.c_str());
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, pStream);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5);
-    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 5);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &context);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeoutSeconds);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 5L);
     CURLcode res = curl_easy_perform(curl);
+    bool delivered = EndSink(&context, res == CURLE_OK);
+    requests_.fetch_add(1, std::memory_order_relaxed);
+    long connects = 0;
+    if (curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects) == CURLE_OK && connects > 0) {
+        new_connections_.fetch_add(static_cast<uint64_t>(connects), std::memory_order_relaxed);
+    }
+    curl_off_t uploaded = 0;
+    if (curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &uploaded) == CURLE_OK && uploaded > 0) {
+        bytes_uploaded_.fetch_add(static_cast<uint64_t>(uploaded), std::memory_order_relaxed);
+    }
+    curl_off_t downloaded = 0;
+    if (curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &downloaded) == CURLE_OK && downloaded > 0) {
+        bytes_downloaded_.fetch_add(static_cast<uint64_t>(downloaded), std::memory_order_relaxed);
+    }
+    if (res == CURLE_WRITE_ERROR && context.aborted) {
+        failures_.fetch_add(1, std::memory_order_relaxed);
+        ERROR("HttpClient: {} aborted by the response sink", webApi_);
+        return false;
+    }
     if (res != CURLE_OK) {
         std::string errorMsg;
         switch (res) {
@@ -67,12 +438,53 @@ bool HttpClient::postRequest(std::string& response, CURL* curl) {
                            std::to_string(res);
         }
 
-        curl_easy_cleanup(curl);
+        failures_.fetch_add(1, std::memory_order_relaxed);
         ERROR("{}", errorMsg);
         return false;
     }
-    curl_easy_cleanup(curl);
-    return true;
+    return delivered;
+}
+
+bool HttpClient::get(HttpSink& sink, const std::map<std::string, std::string>& head, long timeoutSeconds,
+                     long* status) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    CURL* curl = prepare();
+    if (curl == nullptr) {
+        ERROR("get, curl failed");
+        sink.End(false);
+        return false;
+    }
+    struct curl_slist* headers = nullptr;
+    for (auto& item : head) {
+        if (strcasecmp(item.first.c_str(), "Accept-Encoding") == 0) {
+            // 由 curl 发出并负责解压，sink 收到的是解码后的响应体；值为空时列出 curl 支持的全部编码
+            curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, item.second.c_str());
+            continue;
+        }
+        std::string headValue = item.first + ":" + item.second;
+        headers = curl_slist_append(headers, headValue.c_str());
+    }
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 5L);
+    // 不限总时长时按速度判断卡死：30 秒内一个字节都没有收到即中止
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 30L);
+    bool ret = performRequest(sink, curl, timeoutSeconds);
+    if (status != nullptr) {
+        *status = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, status);
+    }
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, nullptr);
+    curl_slist_free_all(headers);
+    return ret;
+}
+
+bool HttpClient::get(HttpChunkHandler on_chunk, const std::map<std::string, std::string>& head,
+                     long timeoutSeconds, long* status) {
+    CallbackSink sink(std::move(on_chunk));
+    return get(sink, head, timeoutSeconds, status);
 }
 
 bool HttpClient::postJson(std::string& response, const std::string& body,
@@ -84,18 +496,12 @@ bool HttpClient::postJson(std::string& response, const std::string& body,
         ERROR("HttpClient::postJson, the body is null");
         ret = false;
     } else {
-        // std::string hostHead = "Host:" + host_;
-        std::string contentLengthHead = "Content-Length:" + std::to_string(body.size());
-
-        CURL* curl = curl_easy_init();
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        CURL* curl = prepare();
         if (curl) {
             struct curl_slist* headers = NULL;
             headers = curl_slist_append(headers, "Accept:application/json");
             headers = curl_slist_append(headers, "Content-Type:application/json");
-            // headers = curl_slist_append(headers, "charset:utf-8");
-            // headers = curl_slist_append(headers, "User-Agent:NumX");
-            // headers = curl_slist_append(headers, (char*)hostHead.c_str());
-            // headers = curl_slist_append(headers, (char*)contentLengthHead.c_str());
             for (auto& item : head) {
                 headValue = item.first + ":" + item.second;
                 headers = curl_slist_append(headers, (char*)headValue.c_str());
@@ -103,16 +509,18 @@ bool HttpClient::postJson(std::string& response, const std::string& body,
             curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
             curl_easy_setopt(curl, CURLOPT_POST, 1);
             curl_easy_setopt(curl, CURLOPT_POSTFIELDS, (char*)body.c_str());
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(body.size()));
             ret = postRequest(response, curl);
-            // INFO("HttpClient::postJson, {}", response);
+            // 句柄只保存了头部链表的指针，请求结束后即可释放
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, nullptr);
+            curl_slist_free_all(headers);
         } else {
             ERROR("postJson, curl failed");
             return false;
         }
 
-        try {
-            json jOut = json::parse(response);  // 判定返回值是否是json
-        } catch (nlohmann::detail::exception& e) {
+        // 只校验是否为JSON，不构建DOM：调用方（如 OtaConfig::Parse）会自己解析一次
+        if (!json::accept(response)) {
             if (response.empty()) {
                 ERROR("postJson, the result is not json, is null");
             } else {
@@ -124,34 +532,206 @@ bool HttpClient::postJson(std::string& response, const std::string& body,
     return ret;
 }
 
+bool HttpClient::post(std::string& response, const void* data, size_t len, const std::string& contentType,
+                      const std::map<std::string, std::string>& head, long timeoutSeconds, long* status) {
+    response.clear();
+    if (status != nullptr) {
+        *status = 0;
+    }
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    CURL* curl = prepare();
+    if (curl == nullptr) {
+        ERROR("post, curl failed");
+        return false;
+    }
+    struct curl_slist* headers = nullptr;
+    std::string typeValue = "Content-Type:" + contentType;
+    headers = curl_slist_append(headers, typeValue.c_str());
+    for (auto& item : head) {
+        std::string headValue = item.first + ":" + item.second;
+        headers = curl_slist_append(headers, headValue.c_str());
+    }
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, static_cast<const char*>(data));
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(len));
+    bool ret = postRequest(response, curl, timeoutSeconds);
+    if (status != nullptr) {
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, status);
+    }
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, nullptr);
+    curl_slist_free_all(headers);
+    return ret;
+}
+
+void HttpClient::postJsonAsync(const std::string& body, const std::map<std::string, std::string>& head,
+                               HttpCallback done) {
+    auto request = std::make_unique<AsyncRequest>();
+    request->submitted = std::chrono::steady_clock::now();
+    request->done = std::move(done);
+    request->url = getWebApi();
+    request->body = body;
+    HttpShare::Instance();  // curl_easy_init 之前完成 curl_global_init
+    request->curl = curl_easy_init();
+    if (request->curl == nullptr) {
+        request->response.error = "curl_easy_init failed";
+        if (request->done) {
+            request->done(std::move(request->response));
+        }
+        return;
+    }
+    ConfigureCurlHandle(request->curl);
+    request->headers = curl_slist_append(request->headers, "Accept:application/json");
+    request->headers = curl_slist_append(request->headers, "Content-Type:application/json");
+    for (auto& item : head) {
+        std::string headValue = item.first + ":" + item.second;
+        request->headers = curl_slist_append(request->headers, headValue.c_str());
+    }
+    CURL* curl = request->curl;
+    curl_easy_setopt(curl, CURLOPT_URL, request->url.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, request->headers);
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request->body.c_str());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(request->body.size()));
+    request->context.curl = curl;
+    request->context.sink = &request->sink;
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &request->context);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_data);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &request->response.etag);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 5L);
+    HttpMulti::Instance().Submit(std::move(request));
+}
+
+std::future<HttpResponse> HttpClient::postJsonAsync(const std::string& body,
+                                                    const std::map<std::string, std::string>& head) {
+    auto promise = std::make_shared<std::promise<HttpResponse>>();
+    std::future<HttpResponse> future = promise->get_future();
+    postJsonAsync(body, head, [promise](HttpResponse response) { promise->set_value(std::move(response)); });
+    return future;
+}
+
+bool HttpClient::postMime(std::string& outputText, CURL* curl, const UploadRequest& request,
+                          const std::function<void(curl_mimepart*)>& attach) {
+    outputText.clear();
+    curl_mime* mime = curl_mime_init(curl);
+    if (mime == nullptr) {
+        ERROR("HttpClient: curl_mime_init failed");
+        return false;
+    }
+    for (const auto& field : request.fields) {
+        curl_mimepart* part = curl_mime_addpart(mime);
+        curl_mime_name(part, field.first.c_str());
+        curl_mime_data(part, field.second.data(), field.second.size());
+    }
+    curl_mimepart* file = curl_mime_addpart(mime);
+    curl_mime_name(file, request.fileField.c_str());
+    attach(file);
+    if (!request.fileName.empty()) {
+        curl_mime_filename(file, request.fileName.c_str());  // 在 attach 之后设置，覆盖 filedata 推断的文件名
+    }
+    curl_mime_type(file, request.contentType.c_str());
+    curl_easy_setopt(curl, CURLOPT_MIMEPOST, mime);
+
+    bool ret = postRequest(outputText, curl, request.timeoutSeconds);
+    curl_easy_setopt(curl, CURLOPT_MIMEPOST, nullptr);
+    curl_mime_free(mime);
+    return ret;
+}
+
 bool HttpClient::upload(std::string& outputText, const std::string& sid,
                         const std::string& fileName, const std::string& filePath) {
-    CURL* curl = curl_easy_init();
-    if (curl) {
-        struct curl_httppost* post = NULL;
-        struct curl_httppost* last = NULL;
+    UploadRequest request;
+    request.fields["sid"] = sid;
+    // fileType 过去写死为 mp3，现在按扩展名推断
+    size_t dot = filePath.rfind('.');
+    std::string ext = dot == std::string::npos ? "" : filePath.substr(dot + 1);
+    request.fields["fileType"] = ext.empty() ? "bin" : ext;
+    if (ext == "wav") {
+        request.contentType = "audio/wav";
+    } else if (ext == "opus" || ext == "ogg") {
+        request.contentType = "audio/ogg";
+    } else if (ext == "mp3") {
+        request.contentType = "audio/mpeg";
+    }
+    request.fileName = fileName;
+    request.timeoutSeconds = 60;
 
-#if 0
-        for(auto& i : kv)
-        {
-            curl_formadd(&post, &last, CURLFORM_PTRNAME, i.first.c_str(), CURLFORM_PTRCONTENTS, i.second.c_str(), CURLFORM_END);
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    CURL* curl = prepare();
+    if (curl == nullptr) {
+        ERROR("upload, curl failed");
+        return false;
+    }
+    return postMime(outputText, curl, request, [&filePath](curl_mimepart* part) {
+        if (curl_mime_filedata(part, filePath.c_str()) != CURLE_OK) {
+            ERROR("upload, cannot read {}", filePath);
         }
-#else
-        curl_formadd(&post, &last, CURLFORM_PTRNAME, "sid", CURLFORM_PTRCONTENTS, sid.c_str(),
-                     CURLFORM_END);
-        // curl_formadd(&post, &last, CURLFORM_PTRNAME, "appCode", CURLFORM_PTRCONTENTS,
-        // appCode.c_str(), CURLFORM_END);
-#endif
-        curl_formadd(&post, &last, CURLFORM_PTRNAME, "fileType", CURLFORM_PTRCONTENTS, "mp3",
-                     CURLFORM_END);
-        curl_formadd(&post, &last, CURLFORM_PTRNAME, "file", CURLFORM_FILE, filePath.c_str(),
-                     CURLFORM_FILENAME, fileName.c_str(), CURLFORM_END);
-        curl_easy_setopt(curl, CURLOPT_HTTPPOST, post);
-
-        return postRequest(outputText, curl);
-    } else {
-        ERROR("postJson, curl failed");
+    });
+}
+
+namespace {
+
+// uploadData 的数据源：直接从调用方的内存读取，支持 curl 重发请求（重定向、认证）时回绕
+struct BufferSource {
+    const char* data;
+    size_t size;
+    size_t pos;
+};
+
+size_t ReadBuffer(char* buffer, size_t size, size_t nitems, void* arg) {
+    auto* source = static_cast<BufferSource*>(arg);
+    size_t n = std::min(size * nitems, source->size - source->pos);
+    memcpy(buffer, source->data + source->pos, n);
+    source->pos += n;
+    return n;
+}
+
+int SeekBuffer(void* arg, curl_off_t offset, int origin) {
+    auto* source = static_cast<BufferSource*>(arg);
+    if (origin != SEEK_SET || offset < 0 || static_cast<size_t>(offset) > source->size) {
+        return CURL_SEEKFUNC_CANTSEEK;
+    }
+    source->pos = static_cast<size_t>(offset);
+    return CURL_SEEKFUNC_OK;
+}
+
+size_t ReadProducer(char* buffer, size_t size, size_t nitems, void* arg) {
+    return (*static_cast<UploadProducer*>(arg))(buffer, size * nitems);
+}
+
+}  // namespace
+
+bool HttpClient::uploadData(std::string& outputText, const UploadRequest& request, const void* data,
+                            size_t len) {
+    BufferSource source{static_cast<const char*>(data), len, 0};
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    CURL* curl = prepare();
+    if (curl == nullptr) {
+        ERROR("uploadData, curl failed");
+        return false;
+    }
+    return postMime(outputText, curl, request, [&source](curl_mimepart* part) {
+        curl_mime_data_cb(part, static_cast<curl_off_t>(source.size), ReadBuffer, SeekBuffer, nullptr, &source);
+    });
+}
+
+bool HttpClient::uploadStream(std::string& outputText, const UploadRequest& request, UploadProducer producer,
+                              int64_t size) {
+    if (!producer) {
+        ERROR("uploadStream, no producer");
+        return false;
+    }
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    CURL* curl = prepare();
+    if (curl == nullptr) {
+        ERROR("uploadStream, curl failed");
         return false;
     }
+    // 数据只能读一遍，不提供 seek：需要重发请求体时 curl 报错而不是发出错位的数据
+    return postMime(outputText, curl, request, [&producer, size](curl_mimepart* part) {
+        curl_mime_data_cb(part, static_cast<curl_off_t>(size), ReadProducer, nullptr, nullptr, &producer);
+    });
 }
-}  // namespace linx
\ No newline at end of file
+}  // namespace linx
@@ -0,0 +1,148 @@
+#include "OtaClient.h"
+
+#include <algorithm>
+#include <map>
+
+#include "HttpClient.h"
+#include "Json.h"
+#include "Log.h"
+
+namespace linx {
+
+bool OtaConfig::Parse(const std::string& body, OtaConfig* out) {
+    *out = OtaConfig();
+    json response = json::parse(body, nullptr, false);
+    if (response.is_discarded() || !response.is_object()) {
+        return false;
+    }
+    OtaConfig config;
+    try {
+        auto websocket = response.find("websocket");
+        if (websocket != response.end() && websocket->is_object()) {
+            config.ws_url = websocket->value("url", "");
+            config.ws_token = websocket->value("token", "");
+            auto urls = websocket->find("urls");
+            if (urls != websocket->end() && urls->is_array()) {
+                for (const auto& url : *urls) {
+                    if (url.is_string()) {
+                        config.ws_urls.push_back(url.get<std::string>());
+                    }
+                }
+            }
+            if (config.ws_url.empty() && !config.ws_urls.empty()) {
+                config.ws_url = config.ws_urls.front();
+            }
+        }
+        auto mqtt = response.find("mqtt");
+        if (mqtt != response.end() && mqtt->is_object()) {
+            config.mqtt_endpoint = mqtt->value("endpoint", "");
+            config.mqtt_client_id = mqtt->value("client_id", "");
+            config.mqtt_username = mqtt->value("username", "");
+            config.mqtt_password = mqtt->value("password", "");
+            config.mqtt_publish_topic = mqtt->value("publish_topic", "");
+            config.mqtt_subscribe_topic = mqtt->value("subscribe_topic", "");
+            config.mqtt_keepalive_s = mqtt->value("keepalive", 0);
+        }
+        auto firmware = response.find("firmware");
+        if (firmware != response.end() && firmware->is_object()) {
+            config.firmware_version = firmware->value("version", "");
+            config.firmware_url = firmware->value("url", "");
+            config.firmware_sha256 = firmware->value("sha256", "");
+            auto patch = firmware->find("patch");
+            if (patch != firmware->end() && patch->is_object()) {
+                config.firmware_patch_from = patch->value("from", "");
+                config.firmware_patch_url = patch->value("url", "");
+                config.firmware_patch_sha256 = patch->value("sha256", "");
+                config.firmware_patch_base_sha256 = patch->value("base_sha256", "");
+            }
+        }
+        auto server_time = response.find("server_time");
+        if (server_time != response.end() && server_time->is_object()) {
+            config.server_time_ms = server_time->value("timestamp", static_cast<int64_t>(0));
+            config.timezone_offset_min = server_time->value("timezone_offset", 0);
+        }
+    } catch (const json_exception& e) {
+        // 字段类型不对（如 url 不是字符串）：按没有下发处理
+        WARN("OTA response has unexpected field types: {}", e.what());
+        return true;
+    }
+    config.valid = !config.ws_url.empty() || !config.mqtt_endpoint.empty();
+    *out = std::move(config);
+    return true;
+}
+
+std::vector<std::string> OtaConfig::Endpoints() const {
+    std::vector<std::string> endpoints;
+    if (!ws_url.empty()) {
+        endpoints.push_back(ws_url);
+    }
+    for (const auto& url : ws_urls) {
+        if (std::find(endpoints.begin(), endpoints.end(), url) == endpoints.end()) {
+            endpoints.push_back(url);
+        }
+    }
+    return endpoints;
+}
+
+std::string OtaConfig::Authorization() const {
+    return ws_token.empty() ? std::string() : "Bearer " + ws_token;
+}
+
+OtaClient::OtaClient(const std::string& url, const std::string& device_id, ResponseCache* cache)
+    : url_(url), device_id_(device_id), cache_(cache) {
+    auto state = std::make_shared<CacheState>();
+    if (cache_ != nullptr && cache_->Load(device_id_, &state->entry)) {
+        state->present = true;
+        OtaConfig::Parse(state->entry.body, &state->config);
+    }
+    cached_ = std::move(state);
+}
+
+void OtaClient::FetchAsync(const std::string& request, std::function<void(OtaResult)> done) {
+    std::map<std::string, std::string> headers;
+    headers["Device-Id"] = device_id_;
+    if (cached_->present && !cached_->entry.etag.empty()) {
+        headers["If-None-Match"] = cached_->entry.etag;  // 条件请求：未变化时服务器只回 304
+    }
+    HttpClient hc(url_);  // 异步请求提交后即与实例无关
+    hc.postJsonAsync(request, headers, [cached = cached_, cache = cache_, device_id = device_id_,
+                                        done = std::move(done)](HttpResponse response) {
+        OtaResult result;
+        result.status = response.status;
+        result.total_ms = response.total_ms;
+        if (!response.ok) {
+            result.error = response.error;
+        } else if (response.status == 304 && cached->present) {
+            result.ok = cached->config.valid;
+            result.not_modified = true;
+            result.config = cached->config;
+        } else {
+            if (!OtaConfig::Parse(response.body, &result.config)) {
+                result.error = "response is not JSON";
+            }
+            result.ok = response.status == 200 && result.config.valid;
+            result.changed = result.ok && cached->present && result.config != cached->config;
+            // 配置和 ETag 都没变时不改写缓存，减少闪存写入
+            if (result.ok && cache != nullptr &&
+                (!cached->present || result.changed || response.etag != cached->entry.etag)) {
+                CachedResponse entry;
+                entry.body = response.body;
+                entry.etag = response.etag;
+                cache->Store(device_id, entry);
+            }
+            result.body = std::move(response.body);
+        }
+        if (done) {
+            done(std::move(result));
+        }
+    });
+}
+
+std::future<OtaResult> OtaClient::FetchAsync(const std::string& request) {
+    auto promise = std::make_shared<std::promise<OtaResult>>();
+    std::future<OtaResult> future = promise->get_future();
+    FetchAsync(request, [promise](OtaResult result) { promise->set_value(std::move(result)); });
+    return future;
+}
+
+}  // namespace linx
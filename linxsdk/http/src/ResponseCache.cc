@@ -0,0 +1,89 @@
+#include "ResponseCache.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+#include "Json.h"
+#include "Log.h"
+
+namespace linx {
+
+ResponseCache::ResponseCache(const std::string& dir) : dir_(dir) {
+    while (dir_.size() > 1 && dir_.back() == '/') {
+        dir_.pop_back();
+    }
+}
+
+std::string ResponseCache::PathFor(const std::string& key) const {
+    std::string name;
+    name.reserve(key.size());
+    for (char c : key) {
+        bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' ||
+                    c == '_' || c == '.';
+        name.push_back(safe ? c : '_');
+    }
+    return dir_ + "/" + name + ".json";
+}
+
+bool ResponseCache::Load(const std::string& key, CachedResponse* entry) const {
+    std::ifstream in(PathFor(key));
+    if (!in) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    try {
+        json stored = json::parse(buffer.str());
+        entry->body = stored.at("body").get<std::string>();
+        entry->etag = stored.value("etag", "");
+        entry->stored_at = stored.value("stored_at", static_cast<int64_t>(0));
+    } catch (const json_exception& e) {
+        WARN("response cache: {} is corrupt, ignored: {}", PathFor(key), e.what());
+        return false;
+    }
+    return true;
+}
+
+bool ResponseCache::Store(const std::string& key, const CachedResponse& entry) {
+    if (mkdir(dir_.c_str(), 0755) != 0 && errno != EEXIST) {
+        WARN("response cache: mkdir {} failed: {}", dir_, strerror(errno));
+        return false;
+    }
+    json stored = {
+        {"body", entry.body},
+        {"etag", entry.etag},
+        {"stored_at", entry.stored_at != 0 ? entry.stored_at : static_cast<int64_t>(time(nullptr))},
+    };
+    std::string path = PathFor(key);
+    std::string tmp = path + ".tmp";
+    std::string data = stored.dump();
+
+    FILE* file = fopen(tmp.c_str(), "wb");
+    if (file == nullptr) {
+        WARN("response cache: open {} failed: {}", tmp, strerror(errno));
+        return false;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = fflush(file) == 0 && ok;
+    ok = fsync(fileno(file)) == 0 && ok;  // 先落盘再 rename，掉电后要么是旧文件要么是新文件
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        WARN("response cache: write {} failed: {}", path, strerror(errno));
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ResponseCache::Remove(const std::string& key) {
+    return unlink(PathFor(key).c_str()) == 0;
+}
+
+}  // namespace linx
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace linx {
+
+// 协议中固定的控制消息类型
+enum class ControlType : uint8_t {
+    Unknown = 0,  // 其他类型（如 iot、mcp），需要时用 nlohmann 解析 raw
+    Hello,
+    Listen,
+    Tts,
+    Stt,
+    Llm,
+    Goodbye,
+    Abort,
+    Time,     // 时钟同步的请求/应答（见 ClockSync）
+};
+
+const char* ControlTypeName(ControlType type);
+
+// 解析出的控制消息。字符串字段指向原消息或解析器内部的反转义缓冲，在下一次 Parse 之前有效；
+// 缺失的字段为空
+struct ControlMessage {
+    ControlType type = ControlType::Unknown;
+    std::string_view type_name;   // type 字段原文，Unknown 时用于日志或转交完整解析
+    std::string_view session_id;
+    std::string_view state;       // listen/tts 的 state
+    std::string_view mode;        // listen 的 mode
+    std::string_view text;        // stt/llm/tts 的文本
+    std::string_view emotion;     // llm 的 emotion
+    std::string_view reason;      // abort 的 reason
+    std::string_view transport;   // hello 的 transport
+    std::string_view audio_hash;  // tts sentence_start 的 audio_hash：服务器给出的合成音频内容标识（可选，用于本地缓存）
+    int version = 0;
+    bool resumed = false;         // hello 回复的 resumed：服务器接受了续接请求，沿用原会话并从断点继续下发
+
+    // time 应答：t0 为请求中本端的发送时间（原样带回），t1/t2 为服务器收到请求、发出应答的墙上时间（Unix 微秒）
+    int64_t t0 = 0;
+    int64_t t1 = 0;
+    int64_t t2 = 0;
+    // tts start 的 play_at：本段第一个样本从扬声器播出的服务器墙上时间（Unix 微秒），用于多设备同步播放；0 为立即播放
+    int64_t play_at = 0;
+
+    // hello 的 audio_params
+    bool has_audio_params = false;
+    std::string_view format;
+    int sample_rate = 0;
+    int channels = 0;
+    int frame_duration = 0;
+
+    // hello 的 udp：服务器下发的 UDP 音频通道参数（key/nonce 为十六进制）
+    bool has_udp = false;
+    std::string_view udp_server;
+    int udp_port = 0;
+    std::string_view udp_key;
+    std::string_view udp_nonce;
+
+    std::string_view raw;         // 整条消息
+};
+
+// 控制消息的单遍扫描解析：只识别顶层和 audio_params 中协议用到的字段，其余值直接跳过，
+// 不构建 DOM、不插入缺失的键。字符串没有转义时字段直接指向原消息，只有含转义的字段
+// 才解码到解析器持有的缓冲中（缓冲在多次解析之间复用，稳定后不再分配）。
+// 一个解析器只供一个线程使用。
+class ControlParser {
+public:
+    // 不是合法的 JSON 对象时返回 false，调用方可以改用 nlohmann 获取详细错误
+    bool Parse(std::string_view text, ControlMessage* message);
+
+private:
+    enum Field {
+        kType, kSessionId, kState, kMode, kText, kEmotion, kReason, kTransport, kFormat,
+        kUdpServer, kUdpKey, kUdpNonce, kAudioHash, kFieldCount
+    };
+    // 当前解析的对象：顶层，或 hello 中嵌套的 audio_params / udp
+    enum Scope { kTopLevel, kAudioParams, kUdp };
+
+    bool ParseObject(ControlMessage* message, Scope scope);
+    bool ParseString(std::string_view* out, int field);
+    bool ParseInt(int* out);
+    bool ParseInt64(int64_t* out);
+    bool ParseBool(bool* out);
+    bool SkipValue(int depth);
+    bool SkipString();
+    void SkipSpace();
+
+    const char* pos_ = nullptr;
+    const char* end_ = nullptr;
+    std::string scratch_[kFieldCount];  // 各字段的反转义缓冲
+};
+
+// 控制消息的序列化：按预先排好的模板把字段拼进复用的缓冲区，返回的视图在下一次调用前有效。
+// 一个实例只供一个线程使用。
+class ControlWriter {
+public:
+    // version 为二进制分帧版本，与握手头 Protocol-Version 一致
+    // udp 为 true 时带上 "features":{"udp":true}，请求服务器在 hello 中下发 UDP 音频通道
+    // resume_session 非空时带上 "resume":{"session_id":...,"sequence":...}，请求续接断线前的会话：
+    // sequence 为最后收到的下行帧序号（0 时不输出，由服务器按自己发出的位置继续）
+    // transport 为控制通道的类型（ControlTransport::HelloTransport），MQTT 控制通道时为 "udp"
+    // format 为上行音频格式；formats 为逗号分隔的本端支持的格式（CodecRegistry::FormatList），非空时在
+    // audio_params 中带上 "formats":[...]，服务器在回复的 audio_params.format 中选定双方使用的格式
+    std::string_view Hello(int sample_rate, int channels, int frame_duration_ms, int version = 1, bool udp = false,
+                           std::string_view resume_session = {}, uint32_t resume_sequence = 0,
+                           std::string_view transport = "websocket", std::string_view format = "opus",
+                           std::string_view formats = {});
+    // mode 为空时不输出该字段
+    std::string_view Listen(std::string_view session_id, std::string_view state, std::string_view mode = {});
+    // 本地唤醒：{"type":"listen","state":"detect","text":<唤醒词>}，通常紧接着 Listen(..., "start")
+    std::string_view Detect(std::string_view session_id, std::string_view text);
+    // reason 为空时不输出该字段
+    std::string_view Abort(std::string_view session_id, std::string_view reason = {});
+    std::string_view Goodbye(std::string_view session_id);
+    // 时钟同步请求：{"type":"time","t0":<本端单调时钟微秒>}，服务器原样带回 t0 并填上 t1/t2
+    std::string_view Time(uint64_t t0);
+
+private:
+    void Begin(std::string_view type);
+    void AddString(std::string_view key, std::string_view value);
+    void AddInt(std::string_view key, int value);
+    void AddInt64(std::string_view key, int64_t value);
+    std::string_view End();
+
+    std::string buffer_;
+};
+
+}  // namespace linx
@@ -0,0 +1,559 @@
+#include "ControlMessage.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace linx {
+
+namespace {
+
+struct TypeName {
+    ControlType type;
+    const char* name;
+};
+
+constexpr TypeName kTypeNames[] = {
+    {ControlType::Hello, "hello"}, {ControlType::Listen, "listen"},   {ControlType::Tts, "tts"},
+    {ControlType::Stt, "stt"},     {ControlType::Llm, "llm"},         {ControlType::Goodbye, "goodbye"},
+    {ControlType::Abort, "abort"}, {ControlType::Time, "time"},
+};
+
+ControlType LookupType(std::string_view name) {
+    for (const TypeName& entry : kTypeNames) {
+        if (name == entry.name) {
+            return entry.type;
+        }
+    }
+    return ControlType::Unknown;
+}
+
+int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+void AppendUtf8(std::string* out, uint32_t cp) {
+    if (cp < 0x80) {
+        out->push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out->push_back(static_cast<char>(0xc0 | (cp >> 6)));
+        out->push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    } else if (cp < 0x10000) {
+        out->push_back(static_cast<char>(0xe0 | (cp >> 12)));
+        out->push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+        out->push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    } else {
+        out->push_back(static_cast<char>(0xf0 | (cp >> 18)));
+        out->push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+        out->push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+        out->push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    }
+}
+
+// 嵌套对象/数组的最大深度，超过时按非法消息处理
+constexpr int kMaxDepth = 32;
+
+}  // namespace
+
+const char* ControlTypeName(ControlType type) {
+    for (const TypeName& entry : kTypeNames) {
+        if (entry.type == type) {
+            return entry.name;
+        }
+    }
+    return "unknown";
+}
+
+// ==================== ControlParser ====================
+
+bool ControlParser::Parse(std::string_view text, ControlMessage* message) {
+    *message = ControlMessage();
+    message->raw = text;
+    pos_ = text.data();
+    end_ = text.data() + text.size();
+    SkipSpace();
+    if (!ParseObject(message, kTopLevel)) {
+        return false;
+    }
+    SkipSpace();
+    if (pos_ != end_) {
+        return false;  // 对象之后还有内容
+    }
+    message->type = LookupType(message->type_name);
+    return true;
+}
+
+void ControlParser::SkipSpace() {
+    while (pos_ < end_ && (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\n' || *pos_ == '\r')) {
+        ++pos_;
+    }
+}
+
+bool ControlParser::ParseObject(ControlMessage* message, Scope scope) {
+    if (pos_ >= end_ || *pos_ != '{') {
+        return false;
+    }
+    ++pos_;
+    SkipSpace();
+    if (pos_ < end_ && *pos_ == '}') {
+        ++pos_;
+        return true;
+    }
+    for (;;) {
+        // 键名：协议中的键都是不含转义的 ASCII，含转义的键不会匹配任何字段，按未知键跳过
+        SkipSpace();
+        if (pos_ >= end_ || *pos_ != '"') {
+            return false;
+        }
+        const char* key_begin = ++pos_;
+        while (pos_ < end_ && *pos_ != '"') {
+            pos_ += (*pos_ == '\\' && end_ - pos_ > 1) ? 2 : 1;
+        }
+        if (pos_ >= end_) {
+            return false;
+        }
+        std::string_view key(key_begin, pos_ - key_begin);
+        ++pos_;
+        SkipSpace();
+        if (pos_ >= end_ || *pos_ != ':') {
+            return false;
+        }
+        ++pos_;
+        SkipSpace();
+
+        bool ok = true;
+        if (scope == kTopLevel) {
+            if (key == "type") {
+                ok = ParseString(&message->type_name, kType);
+            } else if (key == "session_id") {
+                ok = ParseString(&message->session_id, kSessionId);
+            } else if (key == "state") {
+                ok = ParseString(&message->state, kState);
+            } else if (key == "mode") {
+                ok = ParseString(&message->mode, kMode);
+            } else if (key == "text") {
+                ok = ParseString(&message->text, kText);
+            } else if (key == "emotion") {
+                ok = ParseString(&message->emotion, kEmotion);
+            } else if (key == "reason") {
+                ok = ParseString(&message->reason, kReason);
+            } else if (key == "transport") {
+                ok = ParseString(&message->transport, kTransport);
+            } else if (key == "audio_hash") {
+                ok = ParseString(&message->audio_hash, kAudioHash);
+            } else if (key == "version") {
+                ok = ParseInt(&message->version);
+            } else if (key == "resumed") {
+                ok = ParseBool(&message->resumed);
+            } else if (key == "t0") {
+                ok = ParseInt64(&message->t0);
+            } else if (key == "t1") {
+                ok = ParseInt64(&message->t1);
+            } else if (key == "t2") {
+                ok = ParseInt64(&message->t2);
+            } else if (key == "play_at") {
+                ok = ParseInt64(&message->play_at);
+            } else if (key == "audio_params" && pos_ < end_ && *pos_ == '{') {
+                message->has_audio_params = true;
+                ok = ParseObject(message, kAudioParams);
+            } else if (key == "udp" && pos_ < end_ && *pos_ == '{') {
+                message->has_udp = true;
+                ok = ParseObject(message, kUdp);
+            } else {
+                ok = SkipValue(0);
+            }
+        } else if (scope == kUdp) {
+            if (key == "server") {
+                ok = ParseString(&message->udp_server, kUdpServer);
+            } else if (key == "port") {
+                ok = ParseInt(&message->udp_port);
+            } else if (key == "key") {
+                ok = ParseString(&message->udp_key, kUdpKey);
+            } else if (key == "nonce") {
+                ok = ParseString(&message->udp_nonce, kUdpNonce);
+            } else {
+                ok = SkipValue(1);
+            }
+        } else {
+            if (key == "format") {
+                ok = ParseString(&message->format, kFormat);
+            } else if (key == "sample_rate") {
+                ok = ParseInt(&message->sample_rate);
+            } else if (key == "channels") {
+                ok = ParseInt(&message->channels);
+            } else if (key == "frame_duration") {
+                ok = ParseInt(&message->frame_duration);
+            } else {
+                ok = SkipValue(1);
+            }
+        }
+        if (!ok) {
+            return false;
+        }
+
+        SkipSpace();
+        if (pos_ >= end_) {
+            return false;
+        }
+        if (*pos_ == ',') {
+            ++pos_;
+            continue;
+        }
+        if (*pos_ == '}') {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+}
+
+bool ControlParser::ParseString(std::string_view* out, int field) {
+    if (pos_ >= end_ || *pos_ != '"') {
+        // 字段类型不符（如 null 或数字）：跳过，视为缺失
+        return SkipValue(0);
+    }
+    const char* begin = ++pos_;
+    while (pos_ < end_ && *pos_ != '"' && *pos_ != '\\') {
+        ++pos_;
+    }
+    if (pos_ >= end_) {
+        return false;
+    }
+    if (*pos_ == '"') {
+        *out = std::string_view(begin, pos_ - begin);  // 无转义：直接指向原消息
+        ++pos_;
+        return true;
+    }
+
+    std::string& scratch = scratch_[field];
+    scratch.assign(begin, pos_ - begin);
+    while (pos_ < end_ && *pos_ != '"') {
+        if (*pos_ != '\\') {
+            scratch.push_back(*pos_++);
+            continue;
+        }
+        if (++pos_ >= end_) {
+            return false;
+        }
+        char c = *pos_++;
+        switch (c) {
+            case '"': scratch.push_back('"'); break;
+            case '\\': scratch.push_back('\\'); break;
+            case '/': scratch.push_back('/'); break;
+            case 'b': scratch.push_back('\b'); break;
+            case 'f': scratch.push_back('\f'); break;
+            case 'n': scratch.push_back('\n'); break;
+            case 'r': scratch.push_back('\r'); break;
+            case 't': scratch.push_back('\t'); break;
+            case 'u': {
+                auto read_hex4 = [this](uint32_t* cp) {
+                    if (end_ - pos_ < 4) {
+                        return false;
+                    }
+                    uint32_t value = 0;
+                    for (int i = 0; i < 4; ++i) {
+                        int h = HexValue(pos_[i]);
+                        if (h < 0) {
+                            return false;
+                        }
+                        value = (value << 4) | static_cast<uint32_t>(h);
+                    }
+                    pos_ += 4;
+                    *cp = value;
+                    return true;
+                };
+                uint32_t cp = 0;
+                if (!read_hex4(&cp)) {
+                    return false;
+                }
+                // 代理对组合成一个码点；落单的代理项替换为 U+FFFD
+                if (cp >= 0xd800 && cp < 0xdc00) {
+                    uint32_t low = 0;
+                    if (end_ - pos_ >= 6 && pos_[0] == '\\' && pos_[1] == 'u') {
+                        pos_ += 2;
+                        if (!read_hex4(&low)) {
+                            return false;
+                        }
+                    }
+                    cp = (low >= 0xdc00 && low < 0xe000) ? 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00) : 0xfffd;
+                } else if (cp >= 0xdc00 && cp < 0xe000) {
+                    cp = 0xfffd;
+                }
+                AppendUtf8(&scratch, cp);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    if (pos_ >= end_) {
+        return false;
+    }
+    ++pos_;
+    *out = scratch;
+    return true;
+}
+
+bool ControlParser::ParseInt(int* out) {
+    int64_t value = *out;
+    if (!ParseInt64(&value)) {
+        return false;
+    }
+    *out = static_cast<int>(std::min<int64_t>(std::max<int64_t>(value, -1000000000), 1000000000));
+    return true;
+}
+
+bool ControlParser::ParseInt64(int64_t* out) {
+    const char* begin = pos_;
+    bool negative = pos_ < end_ && *pos_ == '-';
+    if (negative) {
+        ++pos_;
+    }
+    if (pos_ >= end_ || *pos_ < '0' || *pos_ > '9') {
+        pos_ = begin;
+        return SkipValue(0);  // 不是数字：视为缺失
+    }
+    int64_t value = 0;
+    while (pos_ < end_ && *pos_ >= '0' && *pos_ <= '9') {
+        if (value < 100000000000000000LL) {
+            value = value * 10 + (*pos_ - '0');
+        }
+        ++pos_;
+    }
+    // 小数和指数部分截断
+    while (pos_ < end_ && (*pos_ == '.' || *pos_ == 'e' || *pos_ == 'E' || *pos_ == '+' || *pos_ == '-' ||
+                           (*pos_ >= '0' && *pos_ <= '9'))) {
+        ++pos_;
+    }
+    *out = negative ? -value : value;
+    return true;
+}
+
+bool ControlParser::ParseBool(bool* out) {
+    static constexpr std::string_view kTrue = "true";
+    if (static_cast<size_t>(end_ - pos_) >= kTrue.size() && std::string_view(pos_, kTrue.size()) == kTrue) {
+        pos_ += kTrue.size();
+        *out = true;
+        return true;
+    }
+    return SkipValue(0);  // false、null 或其他类型：视为 false
+}
+
+bool ControlParser::SkipString() {
+    ++pos_;  // 开头的引号
+    while (pos_ < end_ && *pos_ != '"') {
+        pos_ += (*pos_ == '\\' && end_ - pos_ > 1) ? 2 : 1;
+    }
+    if (pos_ >= end_) {
+        return false;
+    }
+    ++pos_;
+    return true;
+}
+
+bool ControlParser::SkipValue(int depth) {
+    if (pos_ >= end_ || depth > kMaxDepth) {
+        return false;
+    }
+    char c = *pos_;
+    if (c == '"') {
+        return SkipString();
+    }
+    if (c == '{' || c == '[') {
+        const char close = c == '{' ? '}' : ']';
+        ++pos_;
+        SkipSpace();
+        if (pos_ < end_ && *pos_ == close) {
+            ++pos_;
+            return true;
+        }
+        for (;;) {
+            SkipSpace();
+            if (c == '{') {
+                if (pos_ >= end_ || *pos_ != '"' || !SkipString()) {
+                    return false;
+                }
+                SkipSpace();
+                if (pos_ >= end_ || *pos_ != ':') {
+                    return false;
+                }
+                ++pos_;
+                SkipSpace();
+            }
+            if (!SkipValue(depth + 1)) {
+                return false;
+            }
+            SkipSpace();
+            if (pos_ >= end_) {
+                return false;
+            }
+            if (*pos_ == ',') {
+                ++pos_;
+                continue;
+            }
+            if (*pos_ == close) {
+                ++pos_;
+                return true;
+            }
+            return false;
+        }
+    }
+    // 数字、true/false/null：扫到分隔符为止
+    const char* begin = pos_;
+    while (pos_ < end_ && *pos_ != ',' && *pos_ != '}' && *pos_ != ']' && *pos_ != ' ' && *pos_ != '\t' &&
+           *pos_ != '\n' && *pos_ != '\r') {
+        ++pos_;
+    }
+    return pos_ > begin;
+}
+
+// ==================== ControlWriter ====================
+
+void ControlWriter::Begin(std::string_view type) {
+    buffer_.clear();  // 保留容量，稳定后不再分配
+    buffer_ += "{\"type\":\"";
+    buffer_ += type;
+    buffer_ += '"';
+}
+
+void ControlWriter::AddString(std::string_view key, std::string_view value) {
+    buffer_ += ",\"";
+    buffer_ += key;
+    buffer_ += "\":\"";
+    for (char c : value) {
+        switch (c) {
+            case '"': buffer_ += "\\\""; break;
+            case '\\': buffer_ += "\\\\"; break;
+            case '\n': buffer_ += "\\n"; break;
+            case '\r': buffer_ += "\\r"; break;
+            case '\t': buffer_ += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+                    buffer_ += escaped;
+                } else {
+                    buffer_ += c;
+                }
+        }
+    }
+    buffer_ += '"';
+}
+
+void ControlWriter::AddInt(std::string_view key, int value) {
+    char digits[16];
+    int n = snprintf(digits, sizeof(digits), "%d", value);
+    buffer_ += ",\"";
+    buffer_ += key;
+    buffer_ += "\":";
+    buffer_.append(digits, n);
+}
+
+void ControlWriter::AddInt64(std::string_view key, int64_t value) {
+    char digits[24];
+    int n = snprintf(digits, sizeof(digits), "%lld", static_cast<long long>(value));
+    buffer_ += ",\"";
+    buffer_ += key;
+    buffer_ += "\":";
+    buffer_.append(digits, n);
+}
+
+std::string_view ControlWriter::End() {
+    buffer_ += '}';
+    return buffer_;
+}
+
+std::string_view ControlWriter::Hello(int sample_rate, int channels, int frame_duration_ms, int version,
+                                     bool udp, std::string_view resume_session, uint32_t resume_sequence,
+                                     std::string_view transport, std::string_view format,
+                                     std::string_view formats) {
+    Begin("hello");
+    AddInt("version", version);
+    AddString("transport", transport);
+    if (udp) {
+        buffer_ += ",\"features\":{\"udp\":true}";
+    }
+    if (!resume_session.empty()) {
+        // 嵌套对象的第一个字段前没有逗号：先以 AddString 输出再去掉开头的逗号
+        buffer_ += ",\"resume\":{";
+        size_t begin = buffer_.size();
+        AddString("session_id", resume_session);
+        buffer_.erase(begin, 1);
+        if (resume_sequence != 0) {
+            char digits[16];
+            int n = snprintf(digits, sizeof(digits), "%u", resume_sequence);
+            buffer_ += ",\"sequence\":";
+            buffer_.append(digits, n);
+        }
+        buffer_ += '}';
+    }
+    buffer_ += ",\"audio_params\":{";
+    size_t params = buffer_.size();
+    AddString("format", format);
+    buffer_.erase(params, 1);
+    if (!formats.empty()) {
+        buffer_ += ",\"formats\":[";
+        size_t start = 0;
+        while (start <= formats.size()) {
+            size_t comma = std::min(formats.find(',', start), formats.size());
+            std::string_view item = formats.substr(start, comma - start);
+            if (!item.empty()) {
+                // 借 AddString 转义，再去掉它输出的键 "":（第一项连前面的逗号一起去掉）
+                bool first = buffer_.back() == '[';
+                size_t begin = buffer_.size();
+                AddString({}, item);
+                buffer_.erase(first ? begin : begin + 1, first ? 4 : 3);
+            }
+            start = comma + 1;
+        }
+        buffer_ += ']';
+    }
+    AddInt("sample_rate", sample_rate);
+    AddInt("channels", channels);
+    AddInt("frame_duration", frame_duration_ms);
+    buffer_ += '}';
+    return End();
+}
+
+std::string_view ControlWriter::Listen(std::string_view session_id, std::string_view state, std::string_view mode) {
+    Begin("listen");
+    AddString("session_id", session_id);
+    AddString("state", state);
+    if (!mode.empty()) {
+        AddString("mode", mode);
+    }
+    return End();
+}
+
+std::string_view ControlWriter::Detect(std::string_view session_id, std::string_view text) {
+    Begin("listen");
+    AddString("session_id", session_id);
+    AddString("state", "detect");
+    AddString("text", text);
+    return End();
+}
+
+std::string_view ControlWriter::Abort(std::string_view session_id, std::string_view reason) {
+    Begin("abort");
+    AddString("session_id", session_id);
+    if (!reason.empty()) {
+        AddString("reason", reason);
+    }
+    return End();
+}
+
+std::string_view ControlWriter::Goodbye(std::string_view session_id) {
+    Begin("goodbye");
+    AddString("session_id", session_id);
+    return End();
+}
+
+std::string_view ControlWriter::Time(uint64_t t0) {
+    Begin("time");
+    AddInt64("t0", static_cast<int64_t>(t0));
+    return End();
+}
+
+}  // namespace linx
@@ -1,21 +1,125 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
 #include "spdlog/spdlog.h"
 
 namespace linx {
 
+// 编译期日志级别：低于 LINX_LOG_LEVEL 的宏展开为空，参数不求值、格式串不进二进制。
+// 由 CMake 的 -DLINX_LOG_LEVEL=info 等设置；默认全部保留，运行时仍按 spdlog 的级别过滤
+#define LINX_LOG_LEVEL_TRACE SPDLOG_LEVEL_TRACE
+#define LINX_LOG_LEVEL_DEBUG SPDLOG_LEVEL_DEBUG
+#define LINX_LOG_LEVEL_INFO SPDLOG_LEVEL_INFO
+#define LINX_LOG_LEVEL_WARN SPDLOG_LEVEL_WARN
+#define LINX_LOG_LEVEL_ERROR SPDLOG_LEVEL_ERROR
+#define LINX_LOG_LEVEL_CRITICAL SPDLOG_LEVEL_CRITICAL
+#define LINX_LOG_LEVEL_OFF SPDLOG_LEVEL_OFF
+
+#ifndef LINX_LOG_LEVEL
+#define LINX_LOG_LEVEL LINX_LOG_LEVEL_TRACE
+#endif
 
+// 关闭的级别：参数只出现在不求值的分支里，不产生代码，也不会让只用于日志的变量报未使用
+#define LINX_LOG_DISABLED(fn, ...) (false ? spdlog::fn(__VA_ARGS__) : (void)0)
 
+#if LINX_LOG_LEVEL <= LINX_LOG_LEVEL_TRACE
 #define TRACE(...) spdlog::trace(__VA_ARGS__)
+#else
+#define TRACE(...) LINX_LOG_DISABLED(trace, __VA_ARGS__)
+#endif
+#if LINX_LOG_LEVEL <= LINX_LOG_LEVEL_DEBUG
+#define DEBUG(...) spdlog::debug(__VA_ARGS__)
+#else
+#define DEBUG(...) LINX_LOG_DISABLED(debug, __VA_ARGS__)
+#endif
+#if LINX_LOG_LEVEL <= LINX_LOG_LEVEL_INFO
 #define INFO(...) spdlog::info(__VA_ARGS__)
+#else
+#define INFO(...) LINX_LOG_DISABLED(info, __VA_ARGS__)
+#endif
+#if LINX_LOG_LEVEL <= LINX_LOG_LEVEL_WARN
 #define WARN(...) spdlog::warn(__VA_ARGS__)
+#else
+#define WARN(...) LINX_LOG_DISABLED(warn, __VA_ARGS__)
+#endif
+#if LINX_LOG_LEVEL <= LINX_LOG_LEVEL_ERROR
 #define ERROR(...) spdlog::error(__VA_ARGS__)
+#else
+#define ERROR(...) LINX_LOG_DISABLED(error, __VA_ARGS__)
+#endif
+#if LINX_LOG_LEVEL <= LINX_LOG_LEVEL_CRITICAL
 #define CRITICAL(...) spdlog::critical(__VA_ARGS__)
-
-#if 1
-#define DEBUG(...) WARN("{}, {}, {}({})", __FUNCTION__, #__VA_ARGS__, __FILE__, __LINE__)
 #else
-#define DEBUG(...) spdlog::debug(__VA_ARGS__)
+#define CRITICAL(...) LINX_LOG_DISABLED(critical, __VA_ARGS__)
 #endif
 
+// 日志输出方式
+struct LogConfig {
+    // 异步模式：调用方只把消息放进有界队列，由后台线程格式化输出，热路径上不做 I/O
+    bool async = false;
+    size_t queue_size = 8192;        // 异步队列容量（条）
+    bool block_on_overflow = false;  // 队列满时阻塞调用方；默认丢弃最旧的一条，调用方永不阻塞
+    std::chrono::seconds flush_interval{1};  // 后台定期刷新，0 为不定期刷新
+    spdlog::level::level_enum level = spdlog::level::info;  // 运行时级别
+};
+
+// 按配置替换默认 logger（控制台输出），应在启动其他线程之前调用
+void InitLogging(const LogConfig& config);
+// 输出队列中剩余的消息并停止后台线程；异步模式下退出前调用
+void ShutdownLogging();
+// 异步队列溢出丢弃的消息条数
+uint64_t LogDroppedMessages();
+
+// 日志限频：每个 interval 内至多放行一次，其余计入被抑制条数，放行时取出。
+// 用于音频线程等热路径上可能连续出现的错误，避免刷屏和阻塞
+class LogRateLimiter {
+public:
+    explicit LogRateLimiter(std::chrono::milliseconds interval = std::chrono::seconds(1))
+        : interval_ns_(std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count()) {}
+
+    // 返回本次是否输出；输出时 *suppressed 为上次输出以来被抑制的条数
+    bool Allow(uint64_t* suppressed = nullptr) {
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now().time_since_epoch())
+                          .count();
+        int64_t next = next_ns_.load(std::memory_order_relaxed);
+        if (now < next || !next_ns_.compare_exchange_strong(next, now + interval_ns_, std::memory_order_relaxed)) {
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        uint64_t n = suppressed_.exchange(0, std::memory_order_relaxed);
+        if (suppressed != nullptr) {
+            *suppressed = n;
+        }
+        return true;
+    }
+
+private:
+    int64_t interval_ns_;
+    std::atomic<int64_t> next_ns_{0};
+    std::atomic<uint64_t> suppressed_{0};
+};
+
+// 限频日志：同一调用点每 interval_ms 至多输出一次，放行时先报告期间被抑制的条数。
+// 用于每帧都可能失败的热路径（如设备读写错误），不必为每个调用点手写 LogRateLimiter
+#define LINX_LOG_EVERY(LOG, interval_ms, ...)                                                    \
+    do {                                                                                         \
+        static ::linx::LogRateLimiter linx_log_limiter_{std::chrono::milliseconds(interval_ms)}; \
+        uint64_t linx_log_suppressed_ = 0;                                                       \
+        if (linx_log_limiter_.Allow(&linx_log_suppressed_)) {                                    \
+            if (linx_log_suppressed_ > 0) {                                                      \
+                LOG("({} similar messages suppressed)", linx_log_suppressed_);                   \
+            }                                                                                    \
+            LOG(__VA_ARGS__);                                                                    \
+        }                                                                                        \
+    } while (0)
+
+#define INFO_EVERY(interval_ms, ...) LINX_LOG_EVERY(INFO, interval_ms, __VA_ARGS__)
+#define WARN_EVERY(interval_ms, ...) LINX_LOG_EVERY(WARN, interval_ms, __VA_ARGS__)
+#define ERROR_EVERY(interval_ms, ...) LINX_LOG_EVERY(ERROR, interval_ms, __VA_ARGS__)
+
 }  // namespace linx
@@ -0,0 +1,59 @@
+#include "Log.h"
+
+#include <memory>
+#include <mutex>
+
+#include "MemoryAccounting.h"
+#include "spdlog/async.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+namespace linx {
+
+namespace {
+
+std::mutex g_log_mutex;
+std::shared_ptr<spdlog::details::thread_pool> g_thread_pool;  // 异步模式的队列和后台线程
+
+}  // namespace
+
+void InitLogging(const LogConfig& config) {
+    std::lock_guard<std::mutex> lock(g_log_mutex);
+    MemoryScope scope(MemoryTag::Log);  // 异步队列按 queue_size 一次性分配，开启全局计数时计入 log
+    auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+    std::shared_ptr<spdlog::logger> logger;
+    if (config.async) {
+        // 一个后台线程按入队顺序输出；溢出时丢弃最旧的消息，保证热路径上的调用方不会被控制台 I/O 阻塞
+        g_thread_pool = std::make_shared<spdlog::details::thread_pool>(config.queue_size, 1);
+        logger = std::make_shared<spdlog::async_logger>(
+            "", sink, g_thread_pool,
+            config.block_on_overflow ? spdlog::async_overflow_policy::block
+                                     : spdlog::async_overflow_policy::overrun_oldest);
+    } else {
+        logger = std::make_shared<spdlog::logger>("", sink);
+    }
+    logger->set_level(config.level);
+    logger->flush_on(spdlog::level::err);  // 错误立即刷出，便于崩溃前定位
+    spdlog::set_default_logger(logger);
+    if (config.flush_interval.count() > 0) {
+        spdlog::flush_every(config.flush_interval);
+    }
+}
+
+void ShutdownLogging() {
+    std::lock_guard<std::mutex> lock(g_log_mutex);
+    if (auto logger = spdlog::default_logger()) {
+        logger->flush();
+    }
+    // 后台线程在析构时处理完队列中剩余的消息再退出；换回同步 logger，之后的日志直接输出
+    auto logger = std::make_shared<spdlog::logger>("", std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+    logger->set_level(spdlog::default_logger()->level());
+    spdlog::set_default_logger(logger);
+    g_thread_pool.reset();
+}
+
+uint64_t LogDroppedMessages() {
+    std::lock_guard<std::mutex> lock(g_log_mutex);
+    return g_thread_pool ? g_thread_pool->overrun_counter() : 0;
+}
+
+}  // namespace linx
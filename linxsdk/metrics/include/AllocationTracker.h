@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace linx {
+
+// 一个分配点：按调用栈聚合的分配次数与字节数
+struct AllocationSite {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+    std::vector<std::string> frames;  // 调用栈，最内层（发起分配的函数）在前，不含 operator new / TaggedMalloc 本身
+};
+
+// 分配跟踪：统计构造它的线程此后的堆分配，给热路径的“稳态每帧零分配”做回归守卫。
+// 计入经全局 operator new（需 LINX_MEMORY_ACCOUNTING，见 MemoryAccounting.h）和 TaggedMalloc / TaggedAllocator 的分配；
+// 第三方 C 库直接调用的 malloc（libopus、lws）不计。只统计本线程，其他线程的分配互不干扰。
+// capture_sites 时每次分配取一次调用栈（backtrace），按栈聚合出最多 kMaxSites 个分配点；
+// 函数名需要符号表导出（-rdynamic，CMake 的 ENABLE_EXPORTS），否则只有地址。
+// 嵌套时只有最内层的跟踪器计数，析构后恢复外层
+class AllocationTracker {
+public:
+    static constexpr size_t kMaxSites = 64;
+    static constexpr int kMaxDepth = 8;
+
+    explicit AllocationTracker(bool capture_sites = true);
+    ~AllocationTracker();
+
+    AllocationTracker(const AllocationTracker&) = delete;
+    AllocationTracker& operator=(const AllocationTracker&) = delete;
+
+    // 是否能看到 std::vector / std::string / json 等经 operator new 的分配（即 HeapAccountingEnabled()）
+    static bool CoversOperatorNew();
+
+    uint64_t Allocations() const { return allocations_; }
+    uint64_t Bytes() const { return bytes_; }
+    // 分配点多于 kMaxSites 时其余的只计入 Allocations()
+    uint64_t DroppedSites() const { return dropped_sites_; }
+
+    // 计数和分配点清零（如预热结束时）
+    void Reset();
+    // 暂停 / 恢复计数：两帧之间的、不属于热路径的代码（统计、打印）在暂停中执行
+    void Pause();
+    void Resume();
+
+    // 按分配次数降序的前 max_sites 个分配点（符号化），调用本身的分配不计入
+    std::vector<AllocationSite> Sites(size_t max_sites = 10) const;
+    // 可读的报告：总次数/字节与各分配点的调用栈
+    std::string Report(size_t max_sites = 10) const;
+
+    // 内部：detail::NoteAllocation 调用，frames 为分配点的调用栈（capture_sites 为 false 时为空）
+    void Record(size_t bytes, void* const* frames, int depth);
+    bool CapturesSites() const { return capture_sites_ && !paused_; }
+    bool Paused() const { return paused_; }
+
+private:
+    struct Site {
+        void* frames[kMaxDepth];
+        int depth;
+        uint64_t count;
+        uint64_t bytes;
+    };
+
+    AllocationTracker* previous_;
+    bool capture_sites_;
+    bool paused_ = false;
+    uint64_t allocations_ = 0;
+    uint64_t bytes_ = 0;
+    uint64_t dropped_sites_ = 0;
+    size_t site_count_ = 0;
+    Site sites_[kMaxSites];
+};
+
+// 硬守卫：作用域内当前线程的任何分配都把调用栈写到 stderr 后 abort，直接指出回归的分配点。
+// 覆盖范围同 AllocationTracker；what 写进报告（如 "capture frame"），须在作用域内有效
+class NoAllocationScope {
+public:
+    explicit NoAllocationScope(const char* what);
+    ~NoAllocationScope();
+
+    NoAllocationScope(const NoAllocationScope&) = delete;
+    NoAllocationScope& operator=(const NoAllocationScope&) = delete;
+
+private:
+    const char* previous_;
+};
+
+namespace detail {
+
+// operator new / TaggedMalloc 的每次分配都调用：当前线程没有跟踪器和守卫时只读两个线程局部变量
+void NoteAllocation(size_t bytes);
+
+}  // namespace detail
+
+}  // namespace linx
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <pthread.h>
+#include <time.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "LatencyHistogram.h"
+
+namespace linx {
+
+// CPU 时间的归属：按线程登记的默认类别，线程内再按 DeadlineMonitor 的阶段细分
+enum class CpuDomain : uint8_t {
+    Capture = 0,  // 采集设备读取与采集循环本身
+    Dsp,          // 回声消除、降噪、自动增益、波束形成、混音等 PCM 处理
+    Encode,       // 上行编码
+    Network,      // WebSocket/MQTT/UDP 收发、控制消息处理
+    Decode,       // 下行解码
+    Playback,     // 播放设备写入
+    Other,        // 未登记的线程（主线程、日志、指标服务等）：进程总量减去已登记线程
+    kCount,
+};
+
+// snake_case 名称，如 capture、dsp
+const char* CpuDomainName(CpuDomain domain);
+
+// 各类别累计的 CPU 时间（纳秒，用户态 + 内核态）
+struct CpuSnapshot {
+    uint64_t domain_ns[static_cast<size_t>(CpuDomain::kCount)] = {};
+    uint64_t process_ns = 0;  // getrusage(RUSAGE_SELF)
+    uint64_t wall_us = 0;     // 取快照的单调时钟时刻
+
+    uint64_t Ns(CpuDomain domain) const { return domain_ns[static_cast<size_t>(domain)]; }
+};
+
+// 一轮对话的 CPU 开销
+struct TurnCpuCost {
+    uint64_t domain_us[static_cast<size_t>(CpuDomain::kCount)] = {};
+    uint64_t total_us = 0;    // 进程 CPU 时间
+    uint64_t wall_us = 0;     // 这一轮的时长
+    double energy_mj = 0;     // 按 active_power_mw 估算的能耗，未配置时为 0
+
+    uint64_t Us(CpuDomain domain) const { return domain_us[static_cast<size_t>(domain)]; }
+};
+
+// 一个登记过的线程。Enter 只由线程本身调用：读一次 CLOCK_THREAD_CPUTIME_ID，把上一段时间记到之前的类别；
+// 其他线程通过 pthread_getcpuclockid 得到的时钟读取它的总量，尚未记账的部分归入当前类别
+class CpuThread {
+public:
+    void Enter(CpuDomain domain);
+    // 当前线程登记的 CpuThread，未登记时为空
+    static CpuThread* Current();
+    // 当前线程已登记时切换类别，否则什么也不做（供 DeadlineMonitor 等在任意线程上调用）
+    static void EnterCurrent(CpuDomain domain) {
+        if (CpuThread* thread = Current()) {
+            thread->Enter(domain);
+        }
+    }
+
+    const std::string& Name() const { return name_; }
+    CpuDomain Domain() const { return domain_; }
+
+private:
+    friend class CpuAccounting;
+
+    // 按类别累加到 out，返回线程总 CPU 时间；read_clock 为 false 或线程已退出时使用最后一次读到的值
+    uint64_t Collect(uint64_t* out, bool read_clock) const;
+
+    std::string name_;
+    CpuDomain domain_ = CpuDomain::Other;
+#ifdef __APPLE__
+    unsigned int mach_thread_ = 0;  // mach_port_t，thread_info 读取
+#else
+    clockid_t clock_ = CLOCK_THREAD_CPUTIME_ID;  // pthread_getcpuclockid 得到的该线程的时钟
+#endif
+    bool bound_ = false;
+    uint64_t mark_ns_ = 0;  // 上一次 Enter 时的线程 CPU 时间（仅线程本身访问）
+    std::atomic<uint8_t> current_{0};
+    std::atomic<uint64_t> domain_ns_[static_cast<size_t>(CpuDomain::kCount)] = {};
+    mutable std::atomic<uint64_t> last_total_ns_{0};
+};
+
+struct CpuAccountingConfig {
+    double active_power_mw = 0;  // 一个核满载时比空闲多消耗的功率（毫瓦），用于估算每轮能耗；0 表示不估算
+};
+
+// 按对话轮次的 CPU 开销统计
+// 各音频/网络线程启动时调用 RegisterCurrentThread 登记（通常在 ThreadPolicy 的线程钩子里），
+// 线程内的阶段切换由 DeadlineMonitor 的 Begin/Enter 驱动（Read -> capture、Process -> dsp、Encode -> encode、
+// Send -> network、Decode -> decode、Write -> playback），没有阶段打点的线程全部记到登记时的类别。
+// 会话状态机在轮次边界调用 BeginTurn / EndTurn：读取每个登记线程的 CPU 时钟和进程的 getrusage，
+// 差值按类别记入每类一个的直方图（微秒/轮）。边界上只有十来次系统调用，热路径每次阶段切换多一次线程时钟读取。
+class CpuAccounting {
+public:
+    static constexpr size_t kMaxThreads = 32;
+
+    explicit CpuAccounting(const CpuAccountingConfig& config = CpuAccountingConfig()) : config_(config) {}
+
+    CpuAccounting(const CpuAccounting&) = delete;
+    CpuAccounting& operator=(const CpuAccounting&) = delete;
+
+    // 在线程自身上调用；同一线程重复调用返回已有的登记，超过 kMaxThreads 时返回 nullptr（不记账）
+    CpuThread* RegisterCurrentThread(const std::string& name, CpuDomain domain);
+
+    // 当前累计值，任意线程
+    CpuSnapshot Snapshot() const;
+
+    // 轮次边界（会话状态机的回调线程上调用）：BeginTurn 时若上一轮尚未结束则先结束它
+    void BeginTurn();
+    void EndTurn();
+    bool InTurn() const;
+
+    // 停止读取各线程的时钟（退出前、join 各线程之前调用），之后的快照使用最后一次读到的值
+    void Freeze();
+
+    const LatencyHistogram& TurnHistogram(CpuDomain domain) const {
+        return turn_us_[static_cast<size_t>(domain)];
+    }
+    const LatencyHistogram& TurnTotal() const { return turn_total_us_; }
+    TurnCpuCost LastTurn() const;
+    const CpuAccountingConfig& Config() const { return config_; }
+    uint64_t Turns() const { return turns_.load(std::memory_order_relaxed); }
+
+    // 多行文本报告：每类一行 每轮 p50 / p90 / max（毫秒）与累计占比
+    std::string Report() const;
+
+private:
+    void FinishTurnLocked(const CpuSnapshot& end);
+
+    CpuAccountingConfig config_;
+    CpuThread threads_[kMaxThreads];
+    std::atomic<size_t> thread_count_{0};
+    std::atomic<bool> frozen_{false};
+    std::atomic<uint64_t> frozen_process_ns_{0};
+
+    mutable std::mutex mutex_;  // 登记与轮次状态
+    bool in_turn_ = false;
+    CpuSnapshot turn_start_;
+    TurnCpuCost last_turn_;
+
+    LatencyHistogram turn_us_[static_cast<size_t>(CpuDomain::kCount)];
+    LatencyHistogram turn_total_us_;
+    std::atomic<uint64_t> turns_{0};
+};
+
+}  // namespace linx
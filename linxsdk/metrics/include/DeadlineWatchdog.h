@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "LatencyHistogram.h"
+#include "LockProfiler.h"
+
+namespace linx {
+
+class FrameTrace;
+
+// 实时音频线程一次循环中的阶段
+enum class DeadlineStage : uint8_t {
+    Read = 0,  // 读采集设备（阻塞读取本身即是节拍）
+    Process,   // 回声消除/降噪/VAD、混音等 PCM 处理
+    Encode,    // Opus 编码
+    Send,      // 交给网络层（入发送队列）
+    Decode,    // 解码 / 丢包隐藏
+    Write,     // 写播放设备
+    kCount,
+};
+
+// snake_case 名称，如 read、encode
+const char* DeadlineStageName(DeadlineStage stage);
+
+struct DeadlineWatchdogConfig {
+    double tolerance = 0.5;         // 一次循环的忙碌时间超过 period * (1 + tolerance) 计为一次超时
+    int check_interval_ms = 100;    // 检查线程的轮询间隔
+    int stall_periods = 20;         // 心跳停滞超过这么多个周期（且不在等待中）时报告卡住
+    std::string dump_dir;           // 非空且设置了 FrameTrace 时，超时后把追踪环快照到这个目录
+    int dump_cooldown_ms = 10000;   // 两次快照的最小间隔
+    size_t max_dumps = 8;           // 进程内最多快照次数
+};
+
+struct DeadlineStats {
+    std::string name;
+    uint64_t period_us = 0;
+    uint64_t iterations = 0;           // 参与评估的循环次数
+    uint64_t misses = 0;               // 超时次数
+    uint64_t stalls = 0;               // 心跳停滞次数（检查线程发现）
+    uint64_t stage_misses[static_cast<size_t>(DeadlineStage::kCount)] = {};  // 超时时耗时最多的阶段
+    uint64_t last_lateness_us = 0;     // 最近一次超时超出周期的时长
+    DeadlineStage last_stage = DeadlineStage::Read;  // 最近一次超时的耗时阶段
+    LatencySummary lateness;           // 每次循环超出周期的时长（未超出记 0）
+};
+
+// 一个实时线程的心跳与阶段计时，由 DeadlineWatchdog::Register 创建。
+// Begin/Enter/Idle 只由该线程调用，每次只读一次单调时钟、做几次 relaxed 原子写，不加锁、不分配内存、不写日志；
+// 统计和心跳可由任意线程读取。线程在 CpuAccounting 登记过时，Begin/Enter 还按阶段切换它的 CPU 记账类别
+// （类别变化时多读一次线程 CPU 时钟）。
+//
+// 一次循环从 Begin 开始，到下一次 Begin 结束；期间由 Enter 切换阶段，Idle 表示进入有意的等待
+// （如没有数据时等待唤醒、省电暂停），等待时间不计入本次循环，也不做停滞检测。
+// 忙碌时间（循环时长减去等待时间）超过周期的 1 + tolerance 倍时计一次超时，并归因到本次循环中耗时最多的阶段。
+// 采集循环不调用 Idle：阻塞读取算作 Read 阶段，处理超时后下一次读取立即返回，两次节拍的间隔即是忙碌时间
+class DeadlineMonitor {
+public:
+    DeadlineMonitor(std::string name, uint64_t period_us, double tolerance);
+
+    DeadlineMonitor(const DeadlineMonitor&) = delete;
+    DeadlineMonitor& operator=(const DeadlineMonitor&) = delete;
+
+    // 循环开始（心跳）：评估上一次循环，然后进入 stage
+    void Begin(DeadlineStage stage = DeadlineStage::Read);
+    // 切换到下一个阶段
+    void Enter(DeadlineStage stage);
+    // 开始有意的等待，直到下一次 Begin / Enter
+    void Idle();
+
+    // 周期变化时（如设备协商出不同的周期）调用，任意线程
+    void SetPeriod(uint64_t period_us) { period_us_.store(period_us, std::memory_order_relaxed); }
+    uint64_t PeriodUs() const { return period_us_.load(std::memory_order_relaxed); }
+    const std::string& Name() const { return name_; }
+
+    uint64_t Misses() const { return misses_.load(std::memory_order_relaxed); }
+    const LatencyHistogram& Lateness() const { return lateness_; }
+    DeadlineStats GetStats() const;
+
+private:
+    friend class DeadlineWatchdog;
+
+    static constexpr uint8_t kIdleStage = static_cast<uint8_t>(DeadlineStage::kCount);
+    static constexpr uint8_t kNoStage = kIdleStage + 1;  // 尚未开始第一次循环
+
+    // 结束当前阶段，累计其耗时
+    void CloseStage(uint64_t now);
+
+    const std::string name_;
+    const double tolerance_;
+    std::atomic<uint64_t> period_us_;
+
+    // 只由被监视的线程访问
+    uint64_t begin_us_ = 0;        // 本次循环开始时刻，0 表示尚未开始
+    uint64_t stage_start_us_ = 0;
+    uint64_t idle_us_ = 0;         // 本次循环中的等待时间
+    uint64_t stage_us_[static_cast<size_t>(DeadlineStage::kCount)] = {};
+
+    // 检查线程读取
+    std::atomic<uint64_t> heartbeat_us_{0};     // 最近一次 Begin / Enter 的时刻
+    std::atomic<uint8_t> stage_{kNoStage};      // 当前阶段，kIdleStage 为等待中
+    std::atomic<uint64_t> iterations_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> stalls_{0};
+    std::atomic<uint64_t> stage_misses_[static_cast<size_t>(DeadlineStage::kCount)] = {};
+    std::atomic<uint64_t> last_lateness_us_{0};
+    std::atomic<uint8_t> last_stage_{0};
+    LatencyHistogram lateness_;
+};
+
+// 实时音频线程的超时看门狗：各线程通过 DeadlineMonitor 打心跳和阶段时间戳，
+// 检查线程（Start 后）定期汇总：发现新的超时时打印一条警告（线程名、超出时长、耗时最多的阶段），
+// 可选地把帧追踪环快照到 dump_dir，留下超时前后各阶段的完整时间线；心跳长时间不动时报告线程卡在哪个阶段。
+// 日志和文件写入都在检查线程上进行，不影响被监视的音频线程
+class DeadlineWatchdog {
+public:
+    explicit DeadlineWatchdog(const DeadlineWatchdogConfig& config = DeadlineWatchdogConfig());
+    ~DeadlineWatchdog();
+
+    DeadlineWatchdog(const DeadlineWatchdog&) = delete;
+    DeadlineWatchdog& operator=(const DeadlineWatchdog&) = delete;
+
+    // 登记一个实时线程，返回的监视器在看门狗生命周期内有效；须在 Start 前调用
+    DeadlineMonitor* Register(const std::string& name, uint64_t period_us);
+    // 超时后快照的追踪环（需同时设置 dump_dir）；须在 Start 前调用
+    void SetFrameTrace(std::shared_ptr<FrameTrace> trace) { frame_trace_ = std::move(trace); }
+
+    void Start();
+    void Stop();
+
+    std::vector<DeadlineStats> GetStats() const;
+    const std::vector<std::unique_ptr<DeadlineMonitor>>& Monitors() const { return monitors_; }
+    uint64_t Dumps() const { return dumps_.load(std::memory_order_relaxed); }
+
+    // 执行一次检查（检查线程每个间隔调用一次，也可以由调用方自己的线程驱动）
+    void Check();
+
+private:
+    struct Watch {
+        uint64_t misses = 0;            // 上次检查时的超时次数
+        uint64_t heartbeat_us = 0;      // 上次检查时的心跳
+        bool stalled = false;           // 已报告过本次停滞
+    };
+
+    void Run();
+    void Dump(const DeadlineMonitor& monitor);
+
+    DeadlineWatchdogConfig config_;
+    std::vector<std::unique_ptr<DeadlineMonitor>> monitors_;
+    std::vector<Watch> watches_;        // 只由 Check 访问
+    std::shared_ptr<FrameTrace> frame_trace_;
+    uint64_t last_dump_us_ = 0;
+    std::atomic<uint64_t> dumps_{0};
+
+    ProfiledMutex mutex_{"deadline_watchdog"};
+    ProfiledConditionVariable cv_{"deadline_watchdog"};
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+}  // namespace linx
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SteadyClock.h"
+
+namespace linx {
+
+// 帧追踪打点位置。bytes/depth 的含义按阶段而定，见各项注释
+enum class TraceStage : uint8_t {
+    CaptureRead = 0,  // 采集读出一帧：PCM 字节数
+    Encode,           // 编码完成：Opus 字节数
+    SendEnqueue,      // 入发送队列：帧字节数，入队后的队列深度（帧）
+    SendDrop,         // 发送队列满被丢弃：帧字节数，队列深度
+    SendWrite,        // lws_write 写出：帧字节数，写出后的队列深度
+    ReceiveBinary,    // 收到一条二进制消息（TTS 包）：消息字节数
+    ReceiveText,      // 收到一条文本消息（控制消息）：消息字节数
+    JitterPush,       // 解码数据写入抖动缓冲区：PCM 字节数，写入后的深度（样本）
+    JitterPop,        // 播放端从抖动缓冲区取出：PCM 字节数，取出后的深度（样本）
+    Underrun,         // 播放中途抖动缓冲区被取空：本次取到的字节数，深度
+    Conceal,          // 丢包隐藏补齐：生成的字节数，深度
+    PlaybackWrite,    // 写入播放设备：PCM 字节数，写入时设备中已排队的帧数
+    kCount,
+};
+
+// snake_case 名称，如 send_enqueue，用于导出
+const char* TraceStageName(TraceStage stage);
+
+// 追踪文件布局（小端、与写入进程同一 ABI）：256 字节文件头，之后是 capacity 条 32 字节记录。
+// 记录按写入序号 index 存放在 index & (capacity - 1) 槽位，写满后覆盖最旧的记录
+constexpr char kFrameTraceMagic[8] = {'L', 'I', 'N', 'X', 'T', 'R', 'C', '\0'};
+constexpr uint32_t kFrameTraceVersion = 1;
+constexpr size_t kFrameTraceStageSlots = 32;
+
+struct FrameTraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;         // 记录槽数（2 的幂）
+    uint64_t pid;
+    uint64_t start_steady_us;  // 打开时的单调时钟（与记录的 time_us 同一时钟）
+    uint64_t start_system_us;  // 同一时刻的墙上时间（unix 微秒），用于对照文本日志
+    char reserved[16];
+    alignas(64) std::atomic<uint64_t> head;  // 已写入的记录总数
+    alignas(64) std::atomic<uint32_t> seq[kFrameTraceStageSlots];  // 各阶段的下一个序号
+};
+
+struct FrameTraceRecord {
+    uint64_t time_us;  // steady_clock 微秒
+    uint32_t seq;      // 该阶段的序号，同一帧在 FIFO 各阶段（如 send_enqueue/send_write）序号相同
+    uint32_t bytes;
+    uint32_t depth;
+    uint8_t stage;
+    uint8_t reserved8[3];
+    uint32_t reserved;
+    // 最后写入的提交标记 = 写入序号的低 32 位 + 1；与槽位应有的序号不符表示未写完（崩溃时被撕裂）或已被覆盖
+    std::atomic<uint32_t> commit;
+};
+
+static_assert(sizeof(FrameTraceHeader) == 256, "trace header layout");
+static_assert(sizeof(FrameTraceRecord) == 32, "trace record layout");
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "trace file atomics must be lock-free to live in shared memory");
+
+struct FrameTraceConfig {
+    std::string path;              // 追踪文件路径，建议每个进程一个（如 /tmp/linx-trace.<pid>.bin）
+    size_t capacity = 1 << 17;     // 记录条数，向上取整为 2 的幂；默认 4MB
+};
+
+// 帧追踪记录器：把每个音频帧和网络消息的 时间/阶段/序号/字节数/缓冲深度 写入内存映射的环形文件。
+// 每条记录只有两次 relaxed 原子加、一次 32 字节写入和一次 release 存储，不格式化、不做系统调用，
+// 可以在生产环境常开；进程崩溃后内核仍会把映射页写回文件，用 linx_trace 解码为 Chrome/Perfetto JSON。
+// Record 可在任意线程并发调用。
+class FrameTrace {
+public:
+    explicit FrameTrace(const FrameTraceConfig& config);
+    ~FrameTrace();
+
+    FrameTrace(const FrameTrace&) = delete;
+    FrameTrace& operator=(const FrameTrace&) = delete;
+
+    // 创建（截断）追踪文件并映射，失败返回 false
+    bool Open();
+    void Close();
+    bool IsOpen() const { return records_ != nullptr; }
+
+    void Record(TraceStage stage, size_t bytes, size_t depth = 0) {
+        if (records_ == nullptr) {
+            return;
+        }
+        uint64_t index = header_->head.fetch_add(1, std::memory_order_relaxed);
+        FrameTraceRecord& record = records_[index & mask_];
+        record.time_us = SteadyNowUs();
+        record.seq = header_->seq[static_cast<size_t>(stage)].fetch_add(1, std::memory_order_relaxed);
+        record.bytes = static_cast<uint32_t>(bytes);
+        record.depth = static_cast<uint32_t>(depth);
+        record.stage = static_cast<uint8_t>(stage);
+        record.commit.store(static_cast<uint32_t>(index + 1), std::memory_order_release);
+    }
+
+    // 把当前的追踪环完整拷贝到另一个文件（先写临时文件再改名），格式与追踪文件相同，可用 linx_trace 解码。
+    // 与 Record 并发时正在写入的记录在拷贝里表现为未写完，读取时跳过；会做文件写入，不要在音频线程上调用
+    bool Snapshot(const std::string& path) const;
+
+    // 已写入的记录总数（含被覆盖的）
+    uint64_t Records() const { return header_ ? header_->head.load(std::memory_order_relaxed) : 0; }
+    const std::string& Path() const { return config_.path; }
+
+private:
+    FrameTraceConfig config_;
+    int fd_ = -1;
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    FrameTraceHeader* header_ = nullptr;
+    FrameTraceRecord* records_ = nullptr;
+    uint64_t mask_ = 0;
+};
+
+// 解码后的一条记录
+struct FrameTraceEvent {
+    uint64_t index;  // 写入序号
+    uint64_t time_us;
+    uint32_t seq;
+    uint32_t bytes;
+    uint32_t depth;
+    TraceStage stage;
+};
+
+// 追踪文件读取：按写入顺序返回环中仍然有效的记录，跳过未写完和已被覆盖的槽位
+class FrameTraceReader {
+public:
+    // 读取并校验文件，失败时 error 说明原因
+    bool Load(const std::string& path, std::string* error);
+
+    uint64_t Pid() const { return pid_; }
+    uint64_t StartSteadyUs() const { return start_steady_us_; }
+    uint64_t StartSystemUs() const { return start_system_us_; }
+    uint64_t Capacity() const { return capacity_; }
+    uint64_t TotalRecords() const { return total_; }      // 写入过的记录总数
+    uint64_t TornRecords() const { return torn_; }        // 环中被跳过的槽位数
+    const std::vector<FrameTraceEvent>& Events() const { return events_; }
+
+private:
+    uint64_t pid_ = 0;
+    uint64_t start_steady_us_ = 0;
+    uint64_t start_system_us_ = 0;
+    uint64_t capacity_ = 0;
+    uint64_t total_ = 0;
+    uint64_t torn_ = 0;
+    std::vector<FrameTraceEvent> events_;
+};
+
+}  // namespace linx
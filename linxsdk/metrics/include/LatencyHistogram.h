@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace linx {
+
+// 直方图快照
+struct LatencySummary {
+    uint64_t count = 0;
+    uint64_t min_us = 0;
+    uint64_t max_us = 0;
+    double mean_us = 0;
+    uint64_t p50_us = 0;
+    uint64_t p90_us = 0;
+    uint64_t p99_us = 0;
+};
+
+// 无锁 HDR 风格延迟直方图（微秒）
+// 对数-线性分桶：每个 2 的幂区间再等分为 16 个子桶，相对误差不超过 1/16，
+// 0 ~ 2^36us（约 19 小时）共 528 个桶，超出上限的值计入最后一个桶。
+// Record 只做几次 relaxed 原子加，可在音频线程和网络线程并发调用；Summarize 遍历所有桶，供低频汇报使用。
+class LatencyHistogram {
+public:
+    static constexpr unsigned kSubBits = 4;
+    static constexpr uint64_t kSubBuckets = 1u << kSubBits;
+    static constexpr unsigned kMaxBits = 36;
+    static constexpr size_t kBuckets = (kMaxBits - kSubBits + 1) * kSubBuckets;
+
+    LatencyHistogram() = default;
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void Record(uint64_t us) {
+        buckets_[BucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_us_.fetch_add(us, std::memory_order_relaxed);
+        uint64_t max = max_us_.load(std::memory_order_relaxed);
+        while (us > max && !max_us_.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+        }
+        uint64_t min = min_us_.load(std::memory_order_relaxed);
+        while (us < min && !min_us_.compare_exchange_weak(min, us, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t SumUs() const { return sum_us_.load(std::memory_order_relaxed); }
+    // 单个桶的累计样本数，供按桶做增量的导出方（如 TelemetryUploader）遍历
+    uint64_t BucketCount(size_t index) const { return buckets_[index].load(std::memory_order_relaxed); }
+
+    // 分位数（0～1），返回所在桶的上界；没有样本时返回 0
+    uint64_t Percentile(double q) const;
+
+    LatencySummary Summarize() const;
+
+    // 清空（与 Record 并发时，清空期间写入的样本可能部分丢失）
+    void Reset();
+
+    static size_t BucketIndex(uint64_t us) {
+        if (us < kSubBuckets) {
+            return static_cast<size_t>(us);
+        }
+        unsigned msb = 63 - static_cast<unsigned>(__builtin_clzll(us));
+        if (msb >= kMaxBits) {
+            return kBuckets - 1;
+        }
+        unsigned shift = msb - kSubBits;
+        return static_cast<size_t>((shift + 1) * kSubBuckets + ((us >> shift) - kSubBuckets));
+    }
+
+    // 桶覆盖的最大值
+    static uint64_t BucketUpper(size_t index) {
+        if (index < kSubBuckets) {
+            return index;
+        }
+        unsigned shift = static_cast<unsigned>(index / kSubBuckets) - 1;
+        uint64_t mantissa = index % kSubBuckets + kSubBuckets;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+private:
+    std::atomic<uint64_t> buckets_[kBuckets] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_us_{0};
+    std::atomic<uint64_t> max_us_{0};
+    std::atomic<uint64_t> min_us_{UINT64_MAX};
+};
+
+}  // namespace linx
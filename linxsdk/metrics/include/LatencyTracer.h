@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "LatencyHistogram.h"
+#include "SteadyClock.h"
+
+namespace linx {
+
+// 流水线各段延迟。上行：采集读出 -> 编码完成 -> 写上线路；下行：收到 -> 解码完成 -> 从抖动缓冲区取出 -> 设备播出；
+// 轮次：用户最后一个语音帧 -> 服务器 tts start / 第一个 TTS 包 / 第一个 TTS 样本播出；
+// 句子：tts sentence_start -> 该句第一个样本播出，以及相对上一句连续播放的停顿（由 SentenceScheduler 记录）
+enum class LatencyStage {
+    CaptureToEncode,    // 采集读出到编码完成
+    SendQueue,          // 入发送队列到 lws_write 返回
+    ReceiveToDecode,    // 收到 TTS 包到解码写入抖动缓冲区
+    BufferResidence,    // 帧在抖动缓冲区中停留的时间
+    DeviceQueue,        // 写入设备时设备中已排队的数据时长（到播出还需等待的时间）
+    TurnReply,          // 语音结束到收到 tts start
+    TurnFirstByte,      // 语音结束到收到第一个 TTS 包
+    TurnFirstPlay,      // 语音结束到第一个 TTS 样本从扬声器播出
+    SentenceFirstPlay,  // 收到 sentence_start 到该句第一个样本从扬声器播出
+    SentenceStall,      // 一句比上一句连续播完时晚开始的时长
+    kCount,
+};
+
+const char* LatencyStageName(LatencyStage stage);
+// 指标名用的 snake_case 形式，如 capture_to_encode
+const char* LatencyStageMetricName(LatencyStage stage);
+
+// 端到端延迟追踪：各阶段在自己的线程里打点，统一记录到每段一个的无锁直方图中。
+// 轮次追踪按 listen/tts 状态切换划分：采集线程标记语音帧，消息线程在 tts start 时开启一轮，
+// 第一个 TTS 包和第一次播出各记录一次，之后直到下一次 BeginReply 都不再记录。
+class LatencyTracer {
+public:
+    LatencyTracer() = default;
+    LatencyTracer(const LatencyTracer&) = delete;
+    LatencyTracer& operator=(const LatencyTracer&) = delete;
+
+    // 各阶段打点统一使用的时间戳，即 SteadyNowUs()
+    static uint64_t NowUs() { return SteadyNowUs(); }
+
+    void Record(LatencyStage stage, uint64_t us) { histograms_[static_cast<size_t>(stage)].Record(us); }
+    // 从 start_us 到现在
+    void RecordSince(LatencyStage stage, uint64_t start_us) {
+        uint64_t now = NowUs();
+        Record(stage, now > start_us ? now - start_us : 0);
+    }
+
+    const LatencyHistogram& Histogram(LatencyStage stage) const {
+        return histograms_[static_cast<size_t>(stage)];
+    }
+
+    // 采集线程：一帧被判为语音（或未启用 VAD 时每个发送的帧），captured_us 为该帧的读取时间
+    void MarkSpeech(uint64_t captured_us) { speech_us_.store(captured_us, std::memory_order_relaxed); }
+
+    // 消息线程：收到 tts start，以最近的语音帧为本轮起点
+    void BeginReply();
+
+    // 消息线程：每个 TTS 包到达时调用，只记录本轮第一个；返回记录的延迟，非首包返回 0
+    uint64_t MarkFirstByte();
+
+    // 播放线程：每次把 TTS 数据写入设备后调用，device_delay_us 为写入时设备中已排队的时长；
+    // 同时计入 DeviceQueue，本轮第一次调用时记录 TurnFirstPlay 并返回其值，否则返回 0
+    uint64_t MarkPlayed(uint64_t device_delay_us);
+
+    uint64_t Turns() const { return turns_.load(std::memory_order_relaxed); }
+
+    // 多行文本报告：每段一行 count / p50 / p90 / p99 / max（毫秒）
+    std::string Report() const;
+
+    void Reset();
+
+private:
+    LatencyHistogram histograms_[static_cast<size_t>(LatencyStage::kCount)];
+    std::atomic<uint64_t> speech_us_{0};
+    std::atomic<uint64_t> turn_start_us_{0};
+    std::atomic<bool> awaiting_byte_{false};
+    std::atomic<bool> awaiting_play_{false};
+    std::atomic<uint64_t> turns_{0};
+};
+
+}  // namespace linx
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "LatencyHistogram.h"
+
+namespace linx {
+
+class MetricsRegistry;
+
+// 锁竞争与等待剖析
+// SDK 的同步点统一使用 ProfiledMutex / ProfiledConditionVariable，构造时给出名字（snake_case，如 ws_queue），
+// 例外是观测设施自己的锁：日志、MetricsRegistry、CpuAccounting、StartupTrace 与本文件的统计表仍用 std::mutex。
+// 同名的多个实例（每个连接一把的锁）汇总到同一份统计。以 -DLINX_LOCK_PROFILING=ON 构建时：
+//   互斥锁：先 try_lock，失败才算一次竞争，读两次时钟记录等待时间；持有时间在 unlock 时记录。
+//           非竞争路径多一次 try_lock 和两次单调时钟读取（vDSO，几十纳秒）
+//   条件变量：每次 wait 记录从开始等待到重新拿到锁的时间（即队列/事件等待），超时另计
+// 未开启时两者只是 std::mutex / std::condition_variable 的内联转发，大小与标准类型相同，名字不保存。
+// 直方图单位为纳秒（与 LatencyHistogram 的微秒用法不同），指标名以 _ns 结尾
+struct LockProfile {
+    enum class Kind { Mutex, CondVar };
+
+    std::string name;
+    Kind kind = Kind::Mutex;
+    std::atomic<uint64_t> acquisitions{0};  // 互斥锁：lock 与成功的 try_lock；条件变量：wait 次数
+    std::atomic<uint64_t> contended{0};     // 互斥锁：lock 时需要等待的次数；条件变量：超时次数
+    LatencyHistogram wait_ns;               // 互斥锁：竞争时的等待；条件变量：每次 wait 的阻塞时间
+    LatencyHistogram hold_ns;               // 互斥锁：持有时间（条件变量上等待的时段不计入）
+};
+
+// 取回或创建名为 name 的统计，返回的指针在进程生命周期内有效；已调用 RegisterLockMetrics 时新建的同时注册指标
+LockProfile* LockProfileFor(const char* name, LockProfile::Kind kind);
+
+// 是否以 LINX_LOCK_PROFILING 构建
+bool LockProfilingEnabled();
+// 每把锁一行，按累计等待时间从大到小：获取次数、竞争比例、等待 p50/p99/max、持有 p50/p99/max（微秒）
+std::string LockReport();
+// 为已有和之后创建的每份统计注册 linx_lock_<name>_{wait_ns,hold_ns,acquisitions_total,contended_total}
+// 与 linx_cv_<name>_{wait_ns,waits_total,timeouts_total}；未开启剖析时什么也不做
+void RegisterLockMetrics(MetricsRegistry& registry);
+
+inline uint64_t LockClockNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+// 满足 Lockable，可用于 std::lock_guard / std::unique_lock / std::scoped_lock
+class ProfiledMutex {
+public:
+#if defined(LINX_LOCK_PROFILING)
+    explicit ProfiledMutex(const char* name) : profile_(LockProfileFor(name, LockProfile::Kind::Mutex)) {}
+
+    void lock() {
+        if (!mutex_.try_lock()) {
+            uint64_t start = LockClockNs();
+            mutex_.lock();
+            acquired_ns_ = LockClockNs();
+            profile_->contended.fetch_add(1, std::memory_order_relaxed);
+            profile_->wait_ns.Record(acquired_ns_ - start);
+        } else {
+            acquired_ns_ = LockClockNs();
+        }
+        profile_->acquisitions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool try_lock() {
+        if (!mutex_.try_lock()) {
+            return false;
+        }
+        acquired_ns_ = LockClockNs();
+        profile_->acquisitions.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void unlock() {
+        uint64_t held = LockClockNs() - acquired_ns_;  // acquired_ns_ 只由持锁者读写
+        mutex_.unlock();
+        profile_->hold_ns.Record(held);
+    }
+#else
+    explicit ProfiledMutex(const char*) {}
+
+    void lock() { mutex_.lock(); }
+    bool try_lock() { return mutex_.try_lock(); }
+    void unlock() { mutex_.unlock(); }
+#endif
+
+    ProfiledMutex(const ProfiledMutex&) = delete;
+    ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+private:
+    friend class ProfiledConditionVariable;
+
+#if defined(LINX_LOCK_PROFILING)
+    // 条件变量等待前后：结算等待前的持有时间，醒来后重新开始计时
+    void SuspendHold() { profile_->hold_ns.Record(LockClockNs() - acquired_ns_); }
+    void ResumeHold(uint64_t now_ns) { acquired_ns_ = now_ns; }
+
+    LockProfile* profile_;
+    uint64_t acquired_ns_ = 0;
+#endif
+    std::mutex mutex_;
+};
+
+// 与 std::unique_lock<ProfiledMutex> 配合的条件变量，接口与 std::condition_variable 的常用部分一致
+class ProfiledConditionVariable {
+public:
+#if defined(LINX_LOCK_PROFILING)
+    explicit ProfiledConditionVariable(const char* name)
+        : profile_(LockProfileFor(name, LockProfile::Kind::CondVar)) {}
+#else
+    explicit ProfiledConditionVariable(const char*) {}
+#endif
+
+    ProfiledConditionVariable(const ProfiledConditionVariable&) = delete;
+    ProfiledConditionVariable& operator=(const ProfiledConditionVariable&) = delete;
+
+    void notify_one() noexcept { cv_.notify_one(); }
+    void notify_all() noexcept { cv_.notify_all(); }
+
+    void wait(std::unique_lock<ProfiledMutex>& lock) {
+        uint64_t start = BeforeWait(lock);
+        std::unique_lock<std::mutex> inner(lock.mutex()->mutex_, std::adopt_lock);
+        cv_.wait(inner);
+        inner.release();  // 锁的所有权仍归 lock
+        AfterWait(lock, start, false);
+    }
+
+    template <typename Predicate>
+    void wait(std::unique_lock<ProfiledMutex>& lock, Predicate pred) {
+        while (!pred()) {
+            wait(lock);
+        }
+    }
+
+    template <typename Clock, typename Duration>
+    std::cv_status wait_until(std::unique_lock<ProfiledMutex>& lock,
+                              const std::chrono::time_point<Clock, Duration>& deadline) {
+        uint64_t start = BeforeWait(lock);
+        std::unique_lock<std::mutex> inner(lock.mutex()->mutex_, std::adopt_lock);
+        std::cv_status status = cv_.wait_until(inner, deadline);
+        inner.release();
+        AfterWait(lock, start, status == std::cv_status::timeout);
+        return status;
+    }
+
+    template <typename Clock, typename Duration, typename Predicate>
+    bool wait_until(std::unique_lock<ProfiledMutex>& lock, const std::chrono::time_point<Clock, Duration>& deadline,
+                    Predicate pred) {
+        while (!pred()) {
+            if (wait_until(lock, deadline) == std::cv_status::timeout) {
+                return pred();
+            }
+        }
+        return true;
+    }
+
+    template <typename Rep, typename Period>
+    std::cv_status wait_for(std::unique_lock<ProfiledMutex>& lock, const std::chrono::duration<Rep, Period>& timeout) {
+        return wait_until(lock, std::chrono::steady_clock::now() + timeout);
+    }
+
+    template <typename Rep, typename Period, typename Predicate>
+    bool wait_for(std::unique_lock<ProfiledMutex>& lock, const std::chrono::duration<Rep, Period>& timeout,
+                  Predicate pred) {
+        return wait_until(lock, std::chrono::steady_clock::now() + timeout, std::move(pred));
+    }
+
+private:
+#if defined(LINX_LOCK_PROFILING)
+    uint64_t BeforeWait(std::unique_lock<ProfiledMutex>& lock) {
+        lock.mutex()->SuspendHold();
+        return LockClockNs();
+    }
+
+    void AfterWait(std::unique_lock<ProfiledMutex>& lock, uint64_t start, bool timeout) {
+        uint64_t now = LockClockNs();
+        lock.mutex()->ResumeHold(now);
+        profile_->acquisitions.fetch_add(1, std::memory_order_relaxed);
+        if (timeout) {
+            profile_->contended.fetch_add(1, std::memory_order_relaxed);
+        }
+        profile_->wait_ns.Record(now - start);
+    }
+
+    LockProfile* profile_;
+#else
+    uint64_t BeforeWait(std::unique_lock<ProfiledMutex>&) { return 0; }
+    void AfterWait(std::unique_lock<ProfiledMutex>&, uint64_t, bool) {}
+#endif
+    std::condition_variable cv_;
+};
+
+}  // namespace linx
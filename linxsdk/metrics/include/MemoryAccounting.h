@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string>
+
+namespace linx {
+
+class MetricsRegistry;
+
+// 内存归属标签：SDK 自己的缓冲区按模块计数，回答“RSS 里多少是音频缓冲、多少是网络、多少是 JSON”
+enum class MemoryTag : uint8_t {
+    Audio = 0,  // PCM 环形缓冲区、帧池（抖动缓冲区、混音器输入）
+    Codec,      // Opus 编解码器状态和解码暂存区
+    Network,    // 发送队列槽位、合并与重组缓冲区、lws 的堆分配（WebSocketManager::EnableMemoryAccounting）
+    Json,       // JSON DOM（MemoryScope 归属，需 LINX_MEMORY_ACCOUNTING）
+    Log,        // spdlog 的异步队列与 sink（MemoryScope 归属，需 LINX_MEMORY_ACCOUNTING）
+    Recording,  // 黑匣子、会话录音、TTS 缓存
+    Heap,       // 其余经 operator new 的分配（需 LINX_MEMORY_ACCOUNTING）
+    kCount,
+};
+
+constexpr size_t kMemoryTagCount = static_cast<size_t>(MemoryTag::kCount);
+
+// snake_case 名称，如 network，用于报告和指标名
+const char* MemoryTagName(MemoryTag tag);
+
+struct MemoryTagStats {
+    int64_t bytes = 0;         // 当前字节数
+    int64_t peak_bytes = 0;    // 历史最大值
+    uint64_t allocations = 0;  // 累计分配次数
+};
+
+// 进程级内存（Linux 读 /proc/self/status，其他平台只有峰值），读不到的项为 -1
+struct ProcessMemory {
+    int64_t rss_bytes = -1;       // VmRSS
+    int64_t peak_rss_bytes = -1;  // VmHWM
+    int64_t threads = -1;
+};
+
+// 内存预算：超出即失败，在 64MB 的板子上尽早发现而不是等 OOM killer。
+// 标签预算在每次记账时检查（超出的那次分配当场失败），RSS 预算由 CheckMemoryBudget 检查
+struct MemoryBudget {
+    size_t rss_bytes = 0;                      // 进程 RSS 上限，0 不限
+    size_t tag_bytes[kMemoryTagCount] = {};    // 各标签上限，0 不限
+    bool fail_fast = true;                     // 超出时把报告写到 stderr 后 abort；false 时每个标签只报告一次
+
+    // 解析 "48M" / "48M,audio=4M,network=2M" / "network=512K"（K/M/G 为 1024 进制，无后缀为字节），失败返回 false
+    static bool Parse(const std::string& text, MemoryBudget* out);
+};
+
+// 解析 "256K" / "4M" / "1G" / "65536"（K/M/G 为 1024 进制），失败返回 false
+bool ParseMemorySize(const std::string& text, size_t* out);
+
+// 记账：delta 为正时计一次分配并检查该标签的预算。任意线程可调用，只做几次 relaxed 原子操作
+void AccountMemory(MemoryTag tag, int64_t delta);
+MemoryTagStats GetMemoryTagStats(MemoryTag tag);
+ProcessMemory ReadProcessMemory();
+
+void SetMemoryBudget(const MemoryBudget& budget);
+// 检查 RSS 预算（读一次 /proc），未设置或未超出时返回 true；超出且 fail_fast 时不返回
+bool CheckMemoryBudget();
+
+// 各标签的当前值/峰值/分配次数、进程 RSS、线程数与默认线程栈，多行文本
+std::string MemoryReport();
+// 注册 linx_memory_<tag>_bytes / _peak_bytes 与 linx_process_rss_bytes 等采样指标
+void RegisterMemoryMetrics(MetricsRegistry& registry);
+
+// 是否以 LINX_MEMORY_ACCOUNTING 构建（替换全局 operator new，按 MemoryScope 归属其余堆分配）
+bool HeapAccountingEnabled();
+
+// 当前线程此后经 operator new 的分配计入 tag，离开作用域时恢复；释放总是记回分配时的标签。
+// 未开启 LINX_MEMORY_ACCOUNTING 时只是设置一个线程局部变量
+class MemoryScope {
+public:
+    explicit MemoryScope(MemoryTag tag);
+    ~MemoryScope();
+
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+
+private:
+    MemoryTag previous_;
+};
+
+MemoryTag CurrentMemoryTag();
+
+// 带标签的原始分配：直接走 malloc / posix_memalign，不经 operator new，开启全局计数时也不会重复计入 Heap。
+// 失败抛 std::bad_alloc；释放时须传回相同的 bytes
+void* TaggedMalloc(MemoryTag tag, size_t bytes, size_t alignment = alignof(std::max_align_t));
+void TaggedFree(MemoryTag tag, void* ptr, size_t bytes);
+
+// 计数分配器，用于 SDK 的标准容器：std::vector<unsigned char, TaggedAllocator<unsigned char, MemoryTag::Network>>
+template <typename T, MemoryTag Tag>
+class TaggedAllocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = TaggedAllocator<U, Tag>;
+    };
+
+    TaggedAllocator() noexcept = default;
+    template <typename U>
+    TaggedAllocator(const TaggedAllocator<U, Tag>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(TaggedMalloc(Tag, n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, size_t n) noexcept { TaggedFree(Tag, p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const TaggedAllocator<U, Tag>&) const noexcept {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const TaggedAllocator<U, Tag>&) const noexcept {
+        return false;
+    }
+};
+
+// 带标签的定长数组（替代 std::unique_ptr<T[]>(new T[n]())），元素值初始化
+template <typename T, MemoryTag Tag>
+struct TaggedArrayDeleter {
+    size_t count = 0;
+
+    void operator()(T* p) const noexcept {
+        std::destroy_n(p, count);
+        TaggedAllocator<T, Tag>().deallocate(p, count);
+    }
+};
+
+template <typename T, MemoryTag Tag>
+using TaggedArray = std::unique_ptr<T[], TaggedArrayDeleter<T, Tag>>;
+
+template <typename T, MemoryTag Tag>
+TaggedArray<T, Tag> MakeTaggedArray(size_t count) {
+    T* p = TaggedAllocator<T, Tag>().allocate(count);
+    try {
+        std::uninitialized_value_construct_n(p, count);
+    } catch (...) {
+        TaggedAllocator<T, Tag>().deallocate(p, count);
+        throw;
+    }
+    return TaggedArray<T, Tag>(p, TaggedArrayDeleter<T, Tag>{count});
+}
+
+}  // namespace linx
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "LatencyHistogram.h"
+
+namespace linx {
+
+// 单调计数器：独占一个 cache line，不同线程更新的计数器之间没有伪共享
+class alignas(64) Counter {
+public:
+    void Add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t Value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+// 瞬时值（缓冲深度、队列长度等）
+class alignas(64) Gauge {
+public:
+    void Set(int64_t v) { value_.store(v, std::memory_order_relaxed); }
+    void Add(int64_t n) { value_.fetch_add(n, std::memory_order_relaxed); }
+    int64_t Value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+enum class MetricKind { Counter, Gauge, Histogram };
+
+// Visit 交给访问函数的一项指标：计数器/仪表为 value，直方图为 histogram
+struct MetricValue {
+    std::string_view name;
+    MetricKind kind = MetricKind::Counter;
+    double value = 0;
+    const LatencyHistogram* histogram = nullptr;
+};
+
+// 指标注册表
+// 热路径只持有 Counter/Gauge 的引用做 relaxed 原子操作；已在别处统计的量（如 CapturePumpStats、xrun 计数）
+// 注册为采样函数，只在导出时调用。注册和导出加锁，导出只读原子值，不暂停任何热路径。
+// 指标名遵循 Prometheus 约定：计数器以 _total 结尾，时长带单位后缀（_us）。
+class MetricsRegistry {
+public:
+    using Sampler = std::function<double()>;
+
+    MetricsRegistry() = default;
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    // 注册或取回同名指标；返回的引用在注册表生命周期内有效
+    Counter& AddCounter(const std::string& name, const std::string& help);
+    Gauge& AddGauge(const std::string& name, const std::string& help);
+
+    // 导出时调用 sampler 取值（在导出线程中执行，须线程安全且不阻塞）
+    void AddCounterSampler(const std::string& name, const std::string& help, Sampler sampler);
+    void AddGaugeSampler(const std::string& name, const std::string& help, Sampler sampler);
+
+    // 延迟直方图按 Prometheus summary 导出（quantile 0.5/0.9/0.99、_sum、_count，单位微秒）
+    void AddHistogram(const std::string& name, const std::string& help, const LatencyHistogram* histogram);
+
+    // Prometheus 文本格式（text/plain; version=0.0.4）
+    std::string PrometheusText() const;
+
+    // JSON 快照：{"name": value, ..., "histogram": {"count":, "p50_us":, ...}}；
+    // prefix 非空时只采样名称以它开头的指标（控制端点按需查询几项，不调用其余的采样函数）
+    std::string JsonSnapshot(std::string_view prefix = {}) const;
+
+    // 按注册顺序逐项采样并交给 visitor（持锁调用，visitor 中不要再访问注册表）；prefix 含义同 JsonSnapshot
+    void Visit(const std::function<void(const MetricValue&)>& visitor, std::string_view prefix = {}) const;
+
+    // 进程内默认注册表
+    static MetricsRegistry& Global();
+
+private:
+    enum class Type { Counter, Gauge, Summary };
+
+    struct Entry {
+        std::string name;
+        std::string help;
+        Type type = Type::Counter;
+        Counter* counter = nullptr;
+        Gauge* gauge = nullptr;
+        Sampler sampler;
+        const LatencyHistogram* histogram = nullptr;
+    };
+
+    Entry* Find(const std::string& name);
+    double Sample(const Entry& entry) const;
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Counter>> counters_;
+    std::vector<std::unique_ptr<Gauge>> gauges_;
+    std::vector<Entry> entries_;
+};
+
+}  // namespace linx
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+
+#include "Metrics.h"
+
+namespace linx {
+
+// 指标拉取端点配置：Unix 套接字和 TCP 端口可同时开启，均为空/0 时不监听
+struct MetricsServerConfig {
+    std::string unix_path;  // Unix 域套接字路径（启动时删除同名旧文件）
+    int tcp_port = 0;       // TCP 端口，只绑定 127.0.0.1，供本机 exporter/agent 抓取
+};
+
+// 指标拉取服务
+// 独立线程 poll 监听套接字，每个连接读取一次请求、写出一份快照后关闭：
+//   "GET /metrics ..."（HTTP）  -> HTTP 200 + Prometheus 文本
+//   "GET /json ..." 或 "json"   -> JSON 快照（HTTP 请求带 HTTP 头）
+//   "GET /<命令> ..." 或 "<命令>" -> AddCommand 注册的处理函数返回的文本
+//   其他（如 nc -U 直接连接）    -> Prometheus 文本
+// 导出只读注册表中的原子值，不与音频/网络线程共享任何锁。
+class MetricsServer {
+public:
+    MetricsServer(MetricsRegistry& registry, const MetricsServerConfig& config);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // 注册命令：在服务线程上调用 handler 并回复其返回的文本，用于触发诊断导出等低频操作；须在 Start 前调用
+    void AddCommand(const std::string& name, std::function<std::string()> handler);
+
+    // 创建监听套接字并启动服务线程，任一端点创建失败返回 false
+    bool Start();
+    void Stop();
+    bool Running() const { return running_; }
+
+    uint64_t Scrapes() const { return scrapes_; }
+
+private:
+    void Run();
+    void Serve(int fd);
+    int ListenUnix();
+    int ListenTcp();
+
+    MetricsRegistry& registry_;
+    MetricsServerConfig config_;
+    std::map<std::string, std::function<std::string()>> commands_;
+
+    int unix_fd_ = -1;
+    int tcp_fd_ = -1;
+    int wake_fds_[2] = {-1, -1};  // Stop 时写入以唤醒 poll
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> scrapes_{0};
+};
+
+}  // namespace linx
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace linx {
+
+// 启动阶段：begin_ms / end_ms 为相对起点的毫秒数，尚未结束的阶段 end_ms 为 -1；
+// 里程碑（Mark）是 begin_ms == end_ms 的阶段
+struct StartupPhase {
+    std::string name;
+    double begin_ms = 0;
+    double end_ms = -1;
+
+    bool Done() const { return end_ms >= 0; }
+    double DurationMs() const { return Done() ? end_ms - begin_ms : 0; }
+};
+
+// 启动过程追踪：记录各初始化阶段的起止时刻和里程碑（如连接建立、可以开始录音），
+// 结束后输出一张按开始时间排列的瀑布图，便于看出哪些阶段在关键路径上、哪些已经并行。
+// 各阶段可以在不同线程上开始和结束；每个名字只记录第一次，启动只发生一次，内部用一把锁即可
+class StartupTrace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit StartupTrace(Clock::time_point origin = Clock::now()) : origin_(origin) {}
+    StartupTrace(const StartupTrace&) = delete;
+    StartupTrace& operator=(const StartupTrace&) = delete;
+
+    // 阶段开始 / 结束；End 找不到对应的 Begin 时按里程碑记录
+    void Begin(std::string_view name);
+    void End(std::string_view name);
+    // 里程碑：只记录第一次，返回这次调用是否为第一次
+    bool Mark(std::string_view name);
+
+    // 阶段已结束（或里程碑已发生）
+    bool Has(std::string_view name) const;
+    // 阶段结束（里程碑发生）时刻相对起点的毫秒数，尚未发生返回 -1
+    double ElapsedMs(std::string_view name) const;
+    double NowMs() const;
+
+    std::vector<StartupPhase> Phases() const;
+    // 瀑布图：每个阶段一行，起止时刻、耗时和按时间比例画出的条
+    std::string Report() const;
+
+    // 阶段作用域：构造时 Begin，析构时 End
+    class Scope {
+    public:
+        Scope(StartupTrace* trace, std::string_view name) : trace_(trace), name_(name) {
+            if (trace_ != nullptr) {
+                trace_->Begin(name_);
+            }
+        }
+        ~Scope() {
+            if (trace_ != nullptr) {
+                trace_->End(name_);
+            }
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        StartupTrace* trace_;
+        std::string name_;
+    };
+
+private:
+    double SinceOriginMs(Clock::time_point now) const {
+        return std::chrono::duration<double, std::milli>(now - origin_).count();
+    }
+    StartupPhase* FindLocked(std::string_view name);
+    const StartupPhase* FindLocked(std::string_view name) const;
+
+    Clock::time_point origin_;
+    mutable std::mutex mutex_;
+    std::vector<StartupPhase> phases_;  // 按开始顺序
+};
+
+}  // namespace linx
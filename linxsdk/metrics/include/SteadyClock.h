@@ -0,0 +1,22 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace linx {
+
+// 单调时钟（steady_clock）时间戳。帧时间戳、延迟打点、抖动缓冲的到达时刻、ping 负载等会在模块之间比较，
+// 都从这里取，保证同一个时钟、同一个起点
+inline uint64_t SteadyNowUs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+// 毫秒形式，用于超时、重试与进度间隔；有符号，截止时刻相减可以为负
+inline int64_t SteadyNowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+}  // namespace linx
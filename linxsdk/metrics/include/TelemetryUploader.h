@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "HttpClient.h"
+#include "LockProfiler.h"
+#include "Metrics.h"
+
+namespace linx {
+
+struct TelemetryConfig {
+    std::string url;                        // 上报地址（POST），为空时 Start 不启动
+    std::string device_id;                  // 写入批次头，服务端据此区分设备
+    std::string prefix = "linx_";           // 只上报名称以它开头的指标
+    uint32_t sample_interval_s = 60;        // 本地采样间隔：每次采样生成一条增量记录
+    uint32_t upload_interval_s = 600;       // 上传间隔：积攒的记录合成一个批次发出
+    double jitter = 0.25;                   // 上传间隔的随机抖动比例（±），避免整个设备群同时上报
+    uint32_t max_backoff_s = 3600;          // 连续失败时指数退避的上限
+    size_t max_pending_bytes = 64 * 1024;   // 待上传记录的内存上限，超出时丢弃最旧的记录
+    long timeout_seconds = 15;              // 单次上传请求的超时
+    long flush_timeout_seconds = 3;         // Stop 时最后一次上传的超时，退出不会被网络拖住太久
+};
+
+struct TelemetryStats {
+    uint64_t records = 0;          // 生成的记录数
+    uint64_t uploads = 0;          // 成功上传的批次数
+    uint64_t failures = 0;         // 失败的上传次数（传输失败或非 2xx）
+    uint64_t records_dropped = 0;  // 因内存上限或服务端拒收而丢弃的记录数
+    uint64_t bytes_uploaded = 0;   // 成功上传的批次字节数
+    size_t pending_records = 0;
+    size_t pending_bytes = 0;
+};
+
+// 遥测上报
+// 后台线程每 sample_interval_s 遍历一次注册表，把计数器和直方图相对上一次采样的增量、仪表的当前值编码成一条
+// 紧凑的二进制记录；每 upload_interval_s（带随机抖动）把积攒的记录合成一个批次，经同一个 HttpClient POST 出去，
+// 请求之间复用 keep-alive 连接和 TLS 会话。首次上传的时刻在一个间隔内随机选取，批量重启的设备不会同时上报。
+// 上传失败时记录保留到下一次，重试间隔按失败次数指数增长（不超过 max_backoff_s）；待上传记录总量不超过
+// max_pending_bytes，超出时丢弃最旧的记录并在下一个批次头中告知服务端丢失的条数。
+//
+// 批次格式（整数均为 LEB128 变长编码，有符号数先做 zigzag）：
+//   "LXTM" u8 版本 | 设备ID | 丢弃记录数 | 名称表：个数, (长度, 字节)... | 记录数 | 记录...
+//   记录：Unix 秒, 距上一条记录的毫秒数, 条目数, 条目...
+//   条目：名称序号, u8 类型, 值
+//     计数器：增量（计数器回退时发送当前值）；增量为 0 的不发送
+//     仪表：zigzag(round(值 * 1000))
+//     直方图：非零桶数, (桶序号差, 增量)..., 样本和增量（微秒）；没有新样本的不发送
+// 桶的划分与 LatencyHistogram 相同，服务端按桶累加即可合并任意设备、任意时段的分布。
+class TelemetryUploader {
+public:
+    static constexpr uint8_t kVersion = 1;
+
+    TelemetryUploader(MetricsRegistry& registry, const TelemetryConfig& config);
+    ~TelemetryUploader();
+
+    TelemetryUploader(const TelemetryUploader&) = delete;
+    TelemetryUploader& operator=(const TelemetryUploader&) = delete;
+
+    bool Start();
+    // flush 为 true 时停止前再采样一次并尝试上传全部待上传记录（受 flush_timeout_seconds 限制）
+    void Stop(bool flush = true);
+    bool Running() const { return running_; }
+
+    TelemetryStats GetStats() const;
+
+private:
+    struct HistogramState {
+        std::vector<uint64_t> buckets;  // 上一次采样时各桶的累计值
+        uint64_t sum_us = 0;
+    };
+
+    void Run();
+    void Sample();
+    bool Upload(long timeout_seconds);
+    std::string EncodeBatch() const;
+    uint32_t NameIndex(std::string_view name);
+    // 以 base_s 为基准加减 jitter 比例的随机量
+    std::chrono::milliseconds Jittered(uint64_t base_s);
+    void DropOldest();
+
+    MetricsRegistry& registry_;
+    TelemetryConfig config_;
+    HttpClient http_;
+
+    // 以下只在上报线程上访问
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, uint32_t> name_index_;
+    std::vector<uint64_t> last_counters_;        // 按名称序号，计数器上一次采样的值
+    std::vector<HistogramState> last_histograms_;  // 按名称序号
+    std::deque<std::string> pending_;            // 已编码的待上传记录
+    size_t pending_bytes_ = 0;
+    uint64_t dropped_unreported_ = 0;            // 尚未在批次头中告知服务端的丢弃数
+    uint64_t last_sample_ms_ = 0;
+    unsigned failures_in_row_ = 0;
+    std::minstd_rand rng_;
+
+    ProfiledMutex mutex_{"telemetry_upload"};
+    ProfiledConditionVariable cv_{"telemetry_upload"};
+    bool stopping_ = false;
+    bool flush_ = true;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    std::atomic<uint64_t> records_{0};
+    std::atomic<uint64_t> uploads_{0};
+    std::atomic<uint64_t> failures_{0};
+    std::atomic<uint64_t> records_dropped_{0};
+    std::atomic<uint64_t> bytes_uploaded_{0};
+    std::atomic<size_t> pending_records_gauge_{0};
+    std::atomic<size_t> pending_bytes_gauge_{0};
+};
+
+}  // namespace linx
@@ -0,0 +1,28 @@
+#pragma once
+
+// 编译期可选的 USDT 静态探针（provider 为 linx），用于把客户端行为与内核调度放在同一条时间线上分析。
+// 以 -DLINX_USDT=ON 构建（需要 systemtap-sdt-dev 提供的 <sys/sdt.h>）时，每个探针编译为一条 nop 指令，
+// 并在 ELF 的 .note.stapsdt 中登记位置和参数；没有工具挂接时只多这一条 nop 以及参数的求值（都是已在寄存器中的值）。
+// bpftrace / perf / SystemTap 直接挂接，LTTng 用 --userspace-probe=sdt:，perf 抓到的数据可导入 Perfetto。
+// 未开启时 LINX_PROBE 展开为空，参数也不求值。
+//
+// 命名约定：成对的探针为 xxx_enter / xxx_return，单点事件用一个名字；参数只取数值（帧数、字节数、深度、返回值）。
+// 探针一览见 docs/modules/metrics.md「静态探针」一节
+
+#if defined(LINX_USDT)
+#include <sys/sdt.h>
+
+#define LINX_PROBE(...) STAP_PROBEV(linx, __VA_ARGS__)
+
+// 在当前作用域的入口触发 name_enter(value)、离开时（任一 return 路径）触发 name_return(value)。
+// 返回值不作为参数：需要时用 uretprobe 挂接函数本身
+#define LINX_PROBE_SCOPE(name, value)                                                            \
+    struct LinxProbeScope_##name {                                                               \
+        explicit LinxProbeScope_##name(long v) : value_(v) { LINX_PROBE(name##_enter, value_); } \
+        ~LinxProbeScope_##name() { LINX_PROBE(name##_return, value_); }                          \
+        long value_;                                                                             \
+    } linx_probe_scope_##name(static_cast<long>(value))
+#else
+#define LINX_PROBE(...) ((void)0)
+#define LINX_PROBE_SCOPE(name, value) ((void)0)
+#endif
@@ -0,0 +1,204 @@
+#include "AllocationTracker.h"
+
+#include <cxxabi.h>
+#include <execinfo.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "MemoryAccounting.h"
+
+namespace linx {
+
+namespace {
+
+// 分配路径上只读这两个变量：都是常量初始化的 thread_local，不需要 TLS 包装函数
+thread_local AllocationTracker* t_tracker = nullptr;
+thread_local const char* t_forbidden = nullptr;
+
+// backtrace 得到的前两帧是 NoteAllocation 和 operator new / TaggedMalloc
+constexpr int kHookFrames = 2;
+
+// 跟踪器内部（生成报告、符号化）的分配不计入
+class TrackerPause {
+public:
+    TrackerPause() : tracker_(t_tracker) { t_tracker = nullptr; }
+    ~TrackerPause() { t_tracker = tracker_; }
+
+private:
+    AllocationTracker* tracker_;
+};
+
+// backtrace_symbols 的一行："binary(mangled+0x1c) [0x...]"，能拆出符号时换成 "demangled+0x1c"
+std::string Symbolize(const char* line) {
+    const char* open = strchr(line, '(');
+    const char* plus = open != nullptr ? strchr(open, '+') : nullptr;
+    if (open == nullptr || plus == nullptr || plus == open + 1) {
+        return line;
+    }
+    std::string mangled(open + 1, plus);
+    const char* close = strchr(plus, ')');
+    std::string offset(plus, close != nullptr ? close : plus + strlen(plus));
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(mangled.c_str(), nullptr, nullptr, &status);
+    std::string name = status == 0 && demangled != nullptr ? demangled : mangled;
+    std::free(demangled);
+    return name + offset;
+}
+
+}  // namespace
+
+AllocationTracker::AllocationTracker(bool capture_sites) : previous_(t_tracker), capture_sites_(capture_sites) {
+    if (capture_sites_) {
+        // 第一次 backtrace 会加载 libgcc_s（经 malloc），提前触发，不算在被测代码头上
+        void* frames[1];
+        backtrace(frames, 1);
+    }
+    t_tracker = this;
+}
+
+AllocationTracker::~AllocationTracker() {
+    if (t_tracker == this) {
+        t_tracker = previous_;
+    }
+}
+
+bool AllocationTracker::CoversOperatorNew() { return HeapAccountingEnabled(); }
+
+void AllocationTracker::Reset() {
+    allocations_ = 0;
+    bytes_ = 0;
+    dropped_sites_ = 0;
+    site_count_ = 0;
+}
+
+void AllocationTracker::Pause() { paused_ = true; }
+
+void AllocationTracker::Resume() { paused_ = false; }
+
+void AllocationTracker::Record(size_t bytes, void* const* frames, int depth) {
+    if (paused_) {
+        return;
+    }
+    allocations_++;
+    bytes_ += bytes;
+    if (depth <= 0) {
+        return;
+    }
+    depth = std::min(depth, kMaxDepth);
+    for (size_t i = 0; i < site_count_; i++) {
+        Site& site = sites_[i];
+        if (site.depth == depth && std::equal(frames, frames + depth, site.frames)) {
+            site.count++;
+            site.bytes += bytes;
+            return;
+        }
+    }
+    if (site_count_ == kMaxSites) {
+        dropped_sites_++;
+        return;
+    }
+    Site& site = sites_[site_count_++];
+    std::copy(frames, frames + depth, site.frames);
+    site.depth = depth;
+    site.count = 1;
+    site.bytes = bytes;
+}
+
+std::vector<AllocationSite> AllocationTracker::Sites(size_t max_sites) const {
+    TrackerPause pause;
+    std::vector<const Site*> order;
+    for (size_t i = 0; i < site_count_; i++) {
+        order.push_back(&sites_[i]);
+    }
+    std::sort(order.begin(), order.end(), [](const Site* a, const Site* b) { return a->count > b->count; });
+    if (order.size() > max_sites) {
+        order.resize(max_sites);
+    }
+    std::vector<AllocationSite> out;
+    for (const Site* site : order) {
+        AllocationSite entry;
+        entry.count = site->count;
+        entry.bytes = site->bytes;
+        char** symbols = backtrace_symbols(site->frames, site->depth);
+        for (int i = 0; i < site->depth; i++) {
+            entry.frames.push_back(symbols != nullptr ? Symbolize(symbols[i]) : "?");
+        }
+        std::free(symbols);
+        out.push_back(std::move(entry));
+    }
+    return out;
+}
+
+std::string AllocationTracker::Report(size_t max_sites) const {
+    TrackerPause pause;
+    char line[160];
+    snprintf(line, sizeof(line), "allocations: %llu (%llu bytes)%s\n", static_cast<unsigned long long>(allocations_),
+             static_cast<unsigned long long>(bytes_),
+             CoversOperatorNew() ? "" : ", TaggedMalloc only (operator new needs -DLINX_MEMORY_ACCOUNTING=ON)");
+    std::string out = line;
+    std::vector<AllocationSite> sites = Sites(max_sites);
+    for (const AllocationSite& site : sites) {
+        snprintf(line, sizeof(line), "  %llu x, %llu bytes:\n", static_cast<unsigned long long>(site.count),
+                 static_cast<unsigned long long>(site.bytes));
+        out += line;
+        for (const std::string& frame : site.frames) {
+            out += "    " + frame + "\n";
+        }
+    }
+    if (site_count_ > sites.size()) {
+        snprintf(line, sizeof(line), "  ... %zu more sites\n", site_count_ - sites.size());
+        out += line;
+    }
+    if (dropped_sites_ > 0) {
+        snprintf(line, sizeof(line), "  %llu allocations beyond %zu sites not attributed\n",
+                 static_cast<unsigned long long>(dropped_sites_), kMaxSites);
+        out += line;
+    }
+    return out;
+}
+
+NoAllocationScope::NoAllocationScope(const char* what) : previous_(t_forbidden) {
+    void* frames[1];
+    backtrace(frames, 1);
+    t_forbidden = what;
+}
+
+NoAllocationScope::~NoAllocationScope() { t_forbidden = previous_; }
+
+namespace detail {
+
+// 不内联：kHookFrames 依赖这一帧存在
+__attribute__((noinline)) void NoteAllocation(size_t bytes) {
+    AllocationTracker* tracker = t_tracker;
+    const char* forbidden = t_forbidden;
+    if (tracker == nullptr && forbidden == nullptr) {
+        return;
+    }
+    void* frames[AllocationTracker::kMaxDepth + kHookFrames];
+    if (forbidden != nullptr) {
+        // 可能正位于任何锁之内：直接写 fd，backtrace_symbols_fd 不分配
+        t_forbidden = nullptr;
+        char line[160];
+        int len = snprintf(line, sizeof(line), "allocation of %zu bytes inside no-allocation scope '%s':\n", bytes,
+                           forbidden);
+        ssize_t ignored = write(STDERR_FILENO, line, std::min(static_cast<size_t>(len), sizeof(line) - 1));
+        (void)ignored;
+        int depth = backtrace(frames, AllocationTracker::kMaxDepth + kHookFrames);
+        backtrace_symbols_fd(frames + kHookFrames, std::max(depth - kHookFrames, 0), STDERR_FILENO);
+        std::abort();
+    }
+    if (!tracker->CapturesSites()) {
+        tracker->Record(bytes, nullptr, 0);
+        return;
+    }
+    int depth = backtrace(frames, AllocationTracker::kMaxDepth + kHookFrames);
+    tracker->Record(bytes, frames + kHookFrames, std::max(depth - kHookFrames, 0));
+}
+
+}  // namespace detail
+
+}  // namespace linx
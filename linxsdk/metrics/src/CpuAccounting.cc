@@ -0,0 +1,243 @@
+#include "CpuAccounting.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cstdio>
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+#include "LatencyTracer.h"
+
+namespace linx {
+
+namespace {
+
+thread_local CpuThread* current_thread = nullptr;
+
+constexpr uint64_t kNsPerSecond = 1000000000;
+
+uint64_t TimespecNs(const timespec& ts) {
+    return static_cast<uint64_t>(ts.tv_sec) * kNsPerSecond + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+uint64_t ThreadCpuNs() {
+    timespec ts;
+    return clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0 ? TimespecNs(ts) : 0;
+}
+
+uint64_t ProcessCpuNs() {
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    auto ns = [](const timeval& tv) {
+        return static_cast<uint64_t>(tv.tv_sec) * kNsPerSecond + static_cast<uint64_t>(tv.tv_usec) * 1000;
+    };
+    return ns(usage.ru_utime) + ns(usage.ru_stime);
+}
+
+constexpr size_t kDomains = static_cast<size_t>(CpuDomain::kCount);
+
+}  // namespace
+
+const char* CpuDomainName(CpuDomain domain) {
+    switch (domain) {
+        case CpuDomain::Capture:
+            return "capture";
+        case CpuDomain::Dsp:
+            return "dsp";
+        case CpuDomain::Encode:
+            return "encode";
+        case CpuDomain::Network:
+            return "network";
+        case CpuDomain::Decode:
+            return "decode";
+        case CpuDomain::Playback:
+            return "playback";
+        case CpuDomain::Other:
+            return "other";
+        default:
+            return "unknown";
+    }
+}
+
+CpuThread* CpuThread::Current() { return current_thread; }
+
+void CpuThread::Enter(CpuDomain domain) {
+    uint8_t current = current_.load(std::memory_order_relaxed);
+    if (static_cast<uint8_t>(domain) == current) {
+        return;  // 类别不变（如新一次循环又从 Read 开始）时不读时钟
+    }
+    uint64_t now = ThreadCpuNs();
+    if (now > mark_ns_) {
+        // 只有线程本身写入，读-加-写不需要原子的读改写
+        domain_ns_[current].store(domain_ns_[current].load(std::memory_order_relaxed) + (now - mark_ns_),
+                                  std::memory_order_relaxed);
+        mark_ns_ = now;
+    }
+    current_.store(static_cast<uint8_t>(domain), std::memory_order_relaxed);
+}
+
+uint64_t CpuThread::Collect(uint64_t* out, bool read_clock) const {
+    uint64_t accounted = 0;
+    for (size_t i = 0; i < kDomains; ++i) {
+        uint64_t ns = domain_ns_[i].load(std::memory_order_relaxed);
+        out[i] += ns;
+        accounted += ns;
+    }
+    uint64_t total = last_total_ns_.load(std::memory_order_relaxed);
+    if (read_clock && bound_) {
+#ifdef __APPLE__
+        thread_basic_info_data_t info;
+        mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+        if (thread_info(mach_thread_, THREAD_BASIC_INFO, reinterpret_cast<thread_info_t>(&info), &count) ==
+            KERN_SUCCESS) {
+            uint64_t ns = (static_cast<uint64_t>(info.user_time.seconds) + info.system_time.seconds) * kNsPerSecond +
+                          (static_cast<uint64_t>(info.user_time.microseconds) + info.system_time.microseconds) * 1000;
+            total = std::max(total, ns);
+        }
+#else
+        timespec ts;
+        // 线程退出后时钟失效（EINVAL），沿用最后一次读到的值
+        if (clock_gettime(clock_, &ts) == 0) {
+            total = std::max(total, TimespecNs(ts));
+        }
+#endif
+        last_total_ns_.store(total, std::memory_order_relaxed);
+    }
+    // 自上一次 Enter 以来尚未结算的部分归入当前类别
+    if (total > accounted) {
+        out[current_.load(std::memory_order_relaxed)] += total - accounted;
+    }
+    return std::max(total, accounted);
+}
+
+CpuThread* CpuAccounting::RegisterCurrentThread(const std::string& name, CpuDomain domain) {
+    if (current_thread != nullptr) {
+        return current_thread;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t index = thread_count_.load(std::memory_order_relaxed);
+    if (index >= kMaxThreads) {
+        return nullptr;
+    }
+    CpuThread& thread = threads_[index];
+    thread.name_ = name;
+    thread.domain_ = domain;
+#ifdef __APPLE__
+    thread.mach_thread_ = pthread_mach_thread_np(pthread_self());
+    thread.bound_ = true;
+#else
+    thread.bound_ = pthread_getcpuclockid(pthread_self(), &thread.clock_) == 0;
+#endif
+    // 登记之前用掉的时间记到默认类别
+    thread.mark_ns_ = ThreadCpuNs();
+    thread.domain_ns_[static_cast<size_t>(domain)].store(thread.mark_ns_, std::memory_order_relaxed);
+    thread.last_total_ns_.store(thread.mark_ns_, std::memory_order_relaxed);
+    thread.current_.store(static_cast<uint8_t>(domain), std::memory_order_relaxed);
+    thread_count_.store(index + 1, std::memory_order_release);  // 快照看到新的个数时，登记已完成
+    current_thread = &thread;
+    return &thread;
+}
+
+CpuSnapshot CpuAccounting::Snapshot() const {
+    CpuSnapshot snapshot;
+    snapshot.wall_us = LatencyTracer::NowUs();
+    bool read_clock = !frozen_.load(std::memory_order_acquire);
+    size_t count = thread_count_.load(std::memory_order_acquire);
+    uint64_t registered = 0;
+    for (size_t i = 0; i < count; ++i) {
+        registered += threads_[i].Collect(snapshot.domain_ns, read_clock);
+    }
+    snapshot.process_ns = ProcessCpuNs();
+    if (!read_clock) {
+        snapshot.process_ns = std::min(snapshot.process_ns, frozen_process_ns_.load(std::memory_order_relaxed));
+    }
+    // getrusage 的精度（通常是调度节拍）比线程时钟粗，差值为负时记 0
+    if (snapshot.process_ns > registered) {
+        snapshot.domain_ns[static_cast<size_t>(CpuDomain::Other)] += snapshot.process_ns - registered;
+    } else {
+        snapshot.process_ns = registered;
+    }
+    return snapshot;
+}
+
+void CpuAccounting::Freeze() {
+    Snapshot();  // 最后一次读取各线程时钟，结果留在 last_total_ns_
+    frozen_process_ns_.store(ProcessCpuNs(), std::memory_order_relaxed);
+    frozen_.store(true, std::memory_order_release);
+}
+
+void CpuAccounting::BeginTurn() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CpuSnapshot now = Snapshot();
+    if (in_turn_) {
+        FinishTurnLocked(now);
+    }
+    turn_start_ = now;
+    in_turn_ = true;
+}
+
+void CpuAccounting::EndTurn() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (in_turn_) {
+        FinishTurnLocked(Snapshot());
+        in_turn_ = false;
+    }
+}
+
+bool CpuAccounting::InTurn() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return in_turn_;
+}
+
+void CpuAccounting::FinishTurnLocked(const CpuSnapshot& end) {
+    TurnCpuCost cost;
+    for (size_t i = 0; i < kDomains; ++i) {
+        uint64_t ns = end.domain_ns[i] > turn_start_.domain_ns[i] ? end.domain_ns[i] - turn_start_.domain_ns[i] : 0;
+        cost.domain_us[i] = ns / 1000;
+        turn_us_[i].Record(cost.domain_us[i]);
+    }
+    cost.total_us = end.process_ns > turn_start_.process_ns ? (end.process_ns - turn_start_.process_ns) / 1000 : 0;
+    cost.wall_us = end.wall_us - turn_start_.wall_us;
+    cost.energy_mj = config_.active_power_mw * static_cast<double>(cost.total_us) / 1e6;
+    turn_total_us_.Record(cost.total_us);
+    last_turn_ = cost;
+    turns_.fetch_add(1, std::memory_order_relaxed);
+}
+
+TurnCpuCost CpuAccounting::LastTurn() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_turn_;
+}
+
+std::string CpuAccounting::Report() const {
+    CpuSnapshot total = Snapshot();
+    uint64_t turns = Turns();
+    std::string report;
+    char line[160];
+    for (size_t i = 0; i < kDomains; ++i) {
+        LatencySummary s = turn_us_[i].Summarize();
+        double share = total.process_ns > 0 ? 100.0 * total.domain_ns[i] / total.process_ns : 0;
+        if (turns > 0) {
+            snprintf(line, sizeof(line), "%-10s %9.1fms total %5.1f%%  per turn p50 %7.1fms  p90 %7.1fms  max %7.1fms\n",
+                     CpuDomainName(static_cast<CpuDomain>(i)), total.domain_ns[i] / 1e6, share, s.p50_us / 1000.0,
+                     s.p90_us / 1000.0, s.max_us / 1000.0);
+        } else {
+            snprintf(line, sizeof(line), "%-10s %9.1fms total %5.1f%%\n", CpuDomainName(static_cast<CpuDomain>(i)),
+                     total.domain_ns[i] / 1e6, share);
+        }
+        report += line;
+    }
+    LatencySummary s = turn_total_us_.Summarize();
+    snprintf(line, sizeof(line), "%-10s %9.1fms in %llu turns, per turn p50 %7.1fms  p90 %7.1fms  max %7.1fms\n",
+             "process", total.process_ns / 1e6, static_cast<unsigned long long>(turns), s.p50_us / 1000.0,
+             s.p90_us / 1000.0, s.max_us / 1000.0);
+    report += line;
+    return report;
+}
+
+}  // namespace linx
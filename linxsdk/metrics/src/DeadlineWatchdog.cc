@@ -0,0 +1,252 @@
+#include "DeadlineWatchdog.h"
+
+#include <chrono>
+
+#include "CpuAccounting.h"
+#include "FrameTrace.h"
+#include "Log.h"
+#include "SteadyClock.h"
+
+namespace linx {
+
+const char* DeadlineStageName(DeadlineStage stage) {
+    switch (stage) {
+        case DeadlineStage::Read:
+            return "read";
+        case DeadlineStage::Process:
+            return "process";
+        case DeadlineStage::Encode:
+            return "encode";
+        case DeadlineStage::Send:
+            return "send";
+        case DeadlineStage::Decode:
+            return "decode";
+        case DeadlineStage::Write:
+            return "write";
+        default:
+            return "unknown";
+    }
+}
+
+namespace {
+
+// 阶段对应的 CPU 记账类别（见 CpuAccounting）
+CpuDomain DomainOf(DeadlineStage stage) {
+    switch (stage) {
+        case DeadlineStage::Read:
+            return CpuDomain::Capture;
+        case DeadlineStage::Process:
+            return CpuDomain::Dsp;
+        case DeadlineStage::Encode:
+            return CpuDomain::Encode;
+        case DeadlineStage::Send:
+            return CpuDomain::Network;
+        case DeadlineStage::Decode:
+            return CpuDomain::Decode;
+        default:
+            return CpuDomain::Playback;
+    }
+}
+
+}  // namespace
+
+DeadlineMonitor::DeadlineMonitor(std::string name, uint64_t period_us, double tolerance)
+    : name_(std::move(name)), tolerance_(tolerance), period_us_(period_us) {}
+
+void DeadlineMonitor::CloseStage(uint64_t now) {
+    uint8_t stage = stage_.load(std::memory_order_relaxed);
+    uint64_t elapsed = now - stage_start_us_;
+    if (stage == kIdleStage) {
+        idle_us_ += elapsed;
+    } else if (stage < kIdleStage) {
+        stage_us_[stage] += elapsed;
+    }
+}
+
+void DeadlineMonitor::Begin(DeadlineStage stage) {
+    uint64_t now = SteadyNowUs();
+    if (begin_us_ != 0) {
+        CloseStage(now);
+        uint64_t elapsed = now - begin_us_;
+        uint64_t busy = elapsed > idle_us_ ? elapsed - idle_us_ : 0;
+        uint64_t period = period_us_.load(std::memory_order_relaxed);
+        lateness_.Record(busy > period ? busy - period : 0);
+        iterations_.fetch_add(1, std::memory_order_relaxed);
+        if (period > 0 && busy > period * (1.0 + tolerance_)) {
+            size_t worst = 0;
+            for (size_t i = 1; i < static_cast<size_t>(DeadlineStage::kCount); ++i) {
+                if (stage_us_[i] > stage_us_[worst]) {
+                    worst = i;
+                }
+            }
+            stage_misses_[worst].fetch_add(1, std::memory_order_relaxed);
+            last_lateness_us_.store(busy - period, std::memory_order_relaxed);
+            last_stage_.store(static_cast<uint8_t>(worst), std::memory_order_relaxed);
+            misses_.fetch_add(1, std::memory_order_release);  // 检查线程看到新的次数时，上面两项已写入
+        }
+        for (uint64_t& us : stage_us_) {
+            us = 0;
+        }
+        idle_us_ = 0;
+    }
+    begin_us_ = now;
+    stage_start_us_ = now;
+    stage_.store(static_cast<uint8_t>(stage), std::memory_order_relaxed);
+    heartbeat_us_.store(now, std::memory_order_relaxed);
+    CpuThread::EnterCurrent(DomainOf(stage));
+}
+
+void DeadlineMonitor::Enter(DeadlineStage stage) {
+    if (begin_us_ == 0) {
+        Begin(stage);
+        return;
+    }
+    uint64_t now = SteadyNowUs();
+    CloseStage(now);
+    stage_start_us_ = now;
+    stage_.store(static_cast<uint8_t>(stage), std::memory_order_relaxed);
+    heartbeat_us_.store(now, std::memory_order_relaxed);
+    CpuThread::EnterCurrent(DomainOf(stage));
+}
+
+void DeadlineMonitor::Idle() {
+    uint64_t now = SteadyNowUs();
+    if (begin_us_ != 0) {
+        CloseStage(now);
+    }
+    stage_start_us_ = now;
+    stage_.store(kIdleStage, std::memory_order_relaxed);
+}
+
+DeadlineStats DeadlineMonitor::GetStats() const {
+    DeadlineStats stats;
+    stats.name = name_;
+    stats.period_us = PeriodUs();
+    stats.iterations = iterations_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_acquire);
+    stats.stalls = stalls_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < static_cast<size_t>(DeadlineStage::kCount); ++i) {
+        stats.stage_misses[i] = stage_misses_[i].load(std::memory_order_relaxed);
+    }
+    stats.last_lateness_us = last_lateness_us_.load(std::memory_order_relaxed);
+    stats.last_stage = static_cast<DeadlineStage>(last_stage_.load(std::memory_order_relaxed));
+    stats.lateness = lateness_.Summarize();
+    return stats;
+}
+
+DeadlineWatchdog::DeadlineWatchdog(const DeadlineWatchdogConfig& config) : config_(config) {}
+
+DeadlineWatchdog::~DeadlineWatchdog() { Stop(); }
+
+DeadlineMonitor* DeadlineWatchdog::Register(const std::string& name, uint64_t period_us) {
+    if (thread_.joinable()) {
+        WARN("DeadlineWatchdog::Register must be called before start(), ignored");
+        return nullptr;
+    }
+    monitors_.push_back(std::make_unique<DeadlineMonitor>(name, period_us, config_.tolerance));
+    watches_.emplace_back();
+    return monitors_.back().get();
+}
+
+void DeadlineWatchdog::Start() {
+    if (thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        stopping_ = false;
+    }
+    thread_ = std::thread(&DeadlineWatchdog::Run, this);
+}
+
+void DeadlineWatchdog::Stop() {
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void DeadlineWatchdog::Run() {
+    std::unique_lock<ProfiledMutex> lock(mutex_);
+    while (!stopping_) {
+        cv_.wait_for(lock, std::chrono::milliseconds(config_.check_interval_ms), [this] { return stopping_; });
+        if (stopping_) {
+            break;
+        }
+        lock.unlock();
+        Check();
+        lock.lock();
+    }
+}
+
+void DeadlineWatchdog::Check() {
+    uint64_t now = SteadyNowUs();
+    for (size_t i = 0; i < monitors_.size(); ++i) {
+        DeadlineMonitor& monitor = *monitors_[i];
+        Watch& watch = watches_[i];
+        uint64_t period = monitor.PeriodUs();
+
+        uint64_t misses = monitor.misses_.load(std::memory_order_acquire);
+        if (misses > watch.misses) {
+            auto stage = static_cast<DeadlineStage>(monitor.last_stage_.load(std::memory_order_relaxed));
+            WARN("{}: {} deadline miss(es), last {:.1f}ms over the {:.1f}ms period, mostly in {}", monitor.Name(),
+                 misses - watch.misses, monitor.last_lateness_us_.load(std::memory_order_relaxed) / 1000.0,
+                 period / 1000.0, DeadlineStageName(stage));
+            watch.misses = misses;
+            Dump(monitor);
+        }
+
+        // 停滞：心跳长时间不动且不在等待中，说明线程卡在当前阶段里（如设备写阻塞、锁等待）
+        uint64_t heartbeat = monitor.heartbeat_us_.load(std::memory_order_relaxed);
+        uint8_t stage = monitor.stage_.load(std::memory_order_relaxed);
+        if (heartbeat != watch.heartbeat_us) {
+            watch.heartbeat_us = heartbeat;
+            watch.stalled = false;
+            continue;
+        }
+        if (stage >= DeadlineMonitor::kIdleStage || period == 0 || watch.stalled ||
+            now - heartbeat < period * static_cast<uint64_t>(config_.stall_periods)) {
+            continue;
+        }
+        watch.stalled = true;
+        monitor.stalls_.fetch_add(1, std::memory_order_relaxed);
+        WARN("{}: stalled for {}ms in {}", monitor.Name(), (now - heartbeat) / 1000,
+             DeadlineStageName(static_cast<DeadlineStage>(stage)));
+        Dump(monitor);
+    }
+}
+
+void DeadlineWatchdog::Dump(const DeadlineMonitor& monitor) {
+    if (!frame_trace_ || !frame_trace_->IsOpen() || config_.dump_dir.empty() ||
+        dumps_.load(std::memory_order_relaxed) >= config_.max_dumps) {
+        return;
+    }
+    uint64_t now = SteadyNowUs();
+    if (last_dump_us_ != 0 && now - last_dump_us_ < static_cast<uint64_t>(config_.dump_cooldown_ms) * 1000) {
+        return;
+    }
+    last_dump_us_ = now;
+    auto wall_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+    std::string path = config_.dump_dir + "/linx-deadline-" + monitor.Name() + "-" + std::to_string(wall_ms) + ".bin";
+    if (frame_trace_->Snapshot(path)) {
+        dumps_.fetch_add(1, std::memory_order_relaxed);
+        INFO("{}: frame trace snapshot written to {}", monitor.Name(), path);
+    }
+}
+
+std::vector<DeadlineStats> DeadlineWatchdog::GetStats() const {
+    std::vector<DeadlineStats> stats;
+    stats.reserve(monitors_.size());
+    for (const auto& monitor : monitors_) {
+        stats.push_back(monitor->GetStats());
+    }
+    return stats;
+}
+
+}  // namespace linx
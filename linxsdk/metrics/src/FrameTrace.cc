@@ -0,0 +1,223 @@
+#include "FrameTrace.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <chrono>
+#include <cstring>
+
+#include "Log.h"
+
+namespace linx {
+
+const char* TraceStageName(TraceStage stage) {
+    switch (stage) {
+        case TraceStage::CaptureRead:
+            return "capture_read";
+        case TraceStage::Encode:
+            return "encode";
+        case TraceStage::SendEnqueue:
+            return "send_enqueue";
+        case TraceStage::SendDrop:
+            return "send_drop";
+        case TraceStage::SendWrite:
+            return "send_write";
+        case TraceStage::ReceiveBinary:
+            return "receive_binary";
+        case TraceStage::ReceiveText:
+            return "receive_text";
+        case TraceStage::JitterPush:
+            return "jitter_push";
+        case TraceStage::JitterPop:
+            return "jitter_pop";
+        case TraceStage::Underrun:
+            return "underrun";
+        case TraceStage::Conceal:
+            return "conceal";
+        case TraceStage::PlaybackWrite:
+            return "playback_write";
+        default:
+            return "unknown";
+    }
+}
+
+static_assert(static_cast<size_t>(TraceStage::kCount) <= kFrameTraceStageSlots, "too many trace stages");
+
+FrameTrace::FrameTrace(const FrameTraceConfig& config) : config_(config) {}
+
+FrameTrace::~FrameTrace() {
+    Close();
+}
+
+bool FrameTrace::Open() {
+    if (IsOpen()) {
+        return true;
+    }
+    size_t capacity = 1;
+    while (capacity < config_.capacity) {
+        capacity <<= 1;
+    }
+    map_size_ = sizeof(FrameTraceHeader) + capacity * sizeof(FrameTraceRecord);
+
+    fd_ = open(config_.path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        ERROR("frame trace: open {} failed: {}", config_.path, strerror(errno));
+        return false;
+    }
+    if (ftruncate(fd_, static_cast<off_t>(map_size_)) != 0) {
+        ERROR("frame trace: resize {} failed: {}", config_.path, strerror(errno));
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    map_ = mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map_ == MAP_FAILED) {
+        ERROR("frame trace: mmap {} failed: {}", config_.path, strerror(errno));
+        map_ = nullptr;
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    // 预先触碰全部页面，热路径上的第一次写入不再触发缺页
+    memset(map_, 0, map_size_);
+
+    header_ = static_cast<FrameTraceHeader*>(map_);
+    header_->version = kFrameTraceVersion;
+    header_->record_size = sizeof(FrameTraceRecord);
+    header_->capacity = capacity;
+    header_->pid = static_cast<uint64_t>(getpid());
+    header_->start_steady_us = SteadyNowUs();
+    header_->start_system_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                                         std::chrono::system_clock::now().time_since_epoch())
+                                                         .count());
+    memcpy(header_->magic, kFrameTraceMagic, sizeof(header_->magic));  // 最后写入：文件头完整后才可识别
+    mask_ = capacity - 1;
+    records_ = reinterpret_cast<FrameTraceRecord*>(static_cast<char*>(map_) + sizeof(FrameTraceHeader));
+    INFO("frame trace: {} ({} records, {} KB)", config_.path, capacity, map_size_ / 1024);
+    return true;
+}
+
+bool FrameTrace::Snapshot(const std::string& path) const {
+    if (map_ == nullptr) {
+        return false;
+    }
+    std::string tmp = path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        WARN("frame trace: open {} failed: {}", tmp, strerror(errno));
+        return false;
+    }
+    const char* data = static_cast<const char*>(map_);
+    size_t written = 0;
+    while (written < map_size_) {
+        ssize_t n = write(fd, data + written, map_size_ - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            WARN("frame trace: write {} failed: {}", tmp, strerror(errno));
+            close(fd);
+            unlink(tmp.c_str());
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    close(fd);
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        WARN("frame trace: rename {} failed: {}", path, strerror(errno));
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// 须在所有打点线程停止后调用
+void FrameTrace::Close() {
+    if (map_ != nullptr) {
+        msync(map_, map_size_, MS_ASYNC);
+        munmap(map_, map_size_);
+        map_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    header_ = nullptr;
+    records_ = nullptr;
+}
+
+bool FrameTraceReader::Load(const std::string& path, std::string* error) {
+    events_.clear();
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        *error = std::string("open failed: ") + strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FrameTraceHeader)) {
+        *error = "file too small for a trace header";
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    // 映射而不是读入堆缓冲：文件头里的原子量需要按原始对齐访问
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        *error = std::string("mmap failed: ") + strerror(errno);
+        return false;
+    }
+
+    const auto* header = static_cast<const FrameTraceHeader*>(map);
+    bool ok = false;
+    if (memcmp(header->magic, kFrameTraceMagic, sizeof(header->magic)) != 0) {
+        *error = "not a linx frame trace";
+    } else if (header->version != kFrameTraceVersion || header->record_size != sizeof(FrameTraceRecord)) {
+        *error = "unsupported trace version " + std::to_string(header->version);
+    } else if (header->capacity == 0 || (header->capacity & (header->capacity - 1)) != 0 ||
+               size < sizeof(FrameTraceHeader) + header->capacity * sizeof(FrameTraceRecord)) {
+        *error = "truncated trace file";
+    } else {
+        ok = true;
+    }
+    if (!ok) {
+        munmap(map, size);
+        return false;
+    }
+
+    pid_ = header->pid;
+    start_steady_us_ = header->start_steady_us;
+    start_system_us_ = header->start_system_us;
+    capacity_ = header->capacity;
+    total_ = header->head.load(std::memory_order_acquire);
+    torn_ = 0;
+
+    const auto* records =
+        reinterpret_cast<const FrameTraceRecord*>(static_cast<const char*>(map) + sizeof(FrameTraceHeader));
+    uint64_t first = total_ > capacity_ ? total_ - capacity_ : 0;
+    events_.reserve(static_cast<size_t>(total_ - first));
+    for (uint64_t index = first; index < total_; ++index) {
+        const FrameTraceRecord& record = records[index & (capacity_ - 1)];
+        if (record.commit.load(std::memory_order_acquire) != static_cast<uint32_t>(index + 1) ||
+            record.stage >= static_cast<uint8_t>(TraceStage::kCount)) {
+            torn_++;
+            continue;
+        }
+        FrameTraceEvent event;
+        event.index = index;
+        event.time_us = record.time_us;
+        event.seq = record.seq;
+        event.bytes = record.bytes;
+        event.depth = record.depth;
+        event.stage = static_cast<TraceStage>(record.stage);
+        events_.push_back(event);
+    }
+    munmap(map, size);
+    return true;
+}
+
+}  // namespace linx
@@ -0,0 +1,55 @@
+#include "LatencyHistogram.h"
+
+#include <cmath>
+
+namespace linx {
+
+uint64_t LatencyHistogram::Percentile(double q) const {
+    uint64_t counts[kBuckets];
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    q = std::min(1.0, std::max(0.0, q));
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * total)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            // 桶上界不会超过实际出现过的最大值
+            return std::min(BucketUpper(i), max_us_.load(std::memory_order_relaxed));
+        }
+    }
+    return max_us_.load(std::memory_order_relaxed);
+}
+
+LatencySummary LatencyHistogram::Summarize() const {
+    LatencySummary summary;
+    summary.count = Count();
+    if (summary.count == 0) {
+        return summary;
+    }
+    summary.min_us = min_us_.load(std::memory_order_relaxed);
+    summary.max_us = max_us_.load(std::memory_order_relaxed);
+    summary.mean_us = static_cast<double>(sum_us_.load(std::memory_order_relaxed)) / summary.count;
+    summary.p50_us = Percentile(0.50);
+    summary.p90_us = Percentile(0.90);
+    summary.p99_us = Percentile(0.99);
+    return summary;
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_us_.store(0, std::memory_order_relaxed);
+    max_us_.store(0, std::memory_order_relaxed);
+    min_us_.store(UINT64_MAX, std::memory_order_relaxed);
+}
+
+}  // namespace linx
@@ -0,0 +1,127 @@
+#include "LatencyTracer.h"
+
+#include <cstdio>
+
+namespace linx {
+
+const char* LatencyStageName(LatencyStage stage) {
+    switch (stage) {
+        case LatencyStage::CaptureToEncode:
+            return "capture->encode";
+        case LatencyStage::SendQueue:
+            return "send queue";
+        case LatencyStage::ReceiveToDecode:
+            return "receive->decode";
+        case LatencyStage::BufferResidence:
+            return "jitter buffer";
+        case LatencyStage::DeviceQueue:
+            return "device queue";
+        case LatencyStage::TurnReply:
+            return "turn: tts start";
+        case LatencyStage::TurnFirstByte:
+            return "turn: first byte";
+        case LatencyStage::TurnFirstPlay:
+            return "turn: first play";
+        case LatencyStage::SentenceFirstPlay:
+            return "sentence: first play";
+        case LatencyStage::SentenceStall:
+            return "sentence: stall";
+        default:
+            return "unknown";
+    }
+}
+
+const char* LatencyStageMetricName(LatencyStage stage) {
+    switch (stage) {
+        case LatencyStage::CaptureToEncode:
+            return "capture_to_encode";
+        case LatencyStage::SendQueue:
+            return "send_queue";
+        case LatencyStage::ReceiveToDecode:
+            return "receive_to_decode";
+        case LatencyStage::BufferResidence:
+            return "jitter_buffer";
+        case LatencyStage::DeviceQueue:
+            return "device_queue";
+        case LatencyStage::TurnReply:
+            return "turn_reply";
+        case LatencyStage::TurnFirstByte:
+            return "turn_first_byte";
+        case LatencyStage::TurnFirstPlay:
+            return "turn_first_play";
+        case LatencyStage::SentenceFirstPlay:
+            return "sentence_first_play";
+        case LatencyStage::SentenceStall:
+            return "sentence_stall";
+        default:
+            return "unknown";
+    }
+}
+
+void LatencyTracer::BeginReply() {
+    uint64_t speech = speech_us_.load(std::memory_order_relaxed);
+    if (speech == 0) {
+        // 本轮没有上行语音（如服务器主动播报），不计入轮次延迟
+        awaiting_byte_.store(false, std::memory_order_relaxed);
+        awaiting_play_.store(false, std::memory_order_relaxed);
+        return;
+    }
+    turn_start_us_.store(speech, std::memory_order_relaxed);
+    speech_us_.store(0, std::memory_order_relaxed);
+    RecordSince(LatencyStage::TurnReply, speech);
+    turns_.fetch_add(1, std::memory_order_relaxed);
+    awaiting_byte_.store(true, std::memory_order_relaxed);
+    awaiting_play_.store(true, std::memory_order_release);
+}
+
+uint64_t LatencyTracer::MarkFirstByte() {
+    if (!awaiting_byte_.load(std::memory_order_relaxed) || !awaiting_byte_.exchange(false, std::memory_order_relaxed)) {
+        return 0;
+    }
+    uint64_t now = NowUs();
+    uint64_t start = turn_start_us_.load(std::memory_order_relaxed);
+    uint64_t latency = now > start ? now - start : 0;
+    Record(LatencyStage::TurnFirstByte, latency);
+    return latency;
+}
+
+uint64_t LatencyTracer::MarkPlayed(uint64_t device_delay_us) {
+    Record(LatencyStage::DeviceQueue, device_delay_us);
+    if (!awaiting_play_.load(std::memory_order_relaxed) || !awaiting_play_.exchange(false, std::memory_order_acquire)) {
+        return 0;
+    }
+    // 样本真正从扬声器播出的时刻 = 写入时刻 + 设备中排在它前面的数据时长
+    uint64_t played = NowUs() + device_delay_us;
+    uint64_t start = turn_start_us_.load(std::memory_order_relaxed);
+    uint64_t latency = played > start ? played - start : 0;
+    Record(LatencyStage::TurnFirstPlay, latency);
+    return latency;
+}
+
+std::string LatencyTracer::Report() const {
+    std::string report;
+    char line[160];
+    for (size_t i = 0; i < static_cast<size_t>(LatencyStage::kCount); ++i) {
+        LatencySummary s = histograms_[i].Summarize();
+        if (s.count == 0) {
+            continue;
+        }
+        snprintf(line, sizeof(line), "%-20s n=%-7llu p50 %8.1fms  p90 %8.1fms  p99 %8.1fms  max %8.1fms\n",
+                 LatencyStageName(static_cast<LatencyStage>(i)), static_cast<unsigned long long>(s.count),
+                 s.p50_us / 1000.0, s.p90_us / 1000.0, s.p99_us / 1000.0, s.max_us / 1000.0);
+        report += line;
+    }
+    return report;
+}
+
+void LatencyTracer::Reset() {
+    for (auto& histogram : histograms_) {
+        histogram.Reset();
+    }
+    speech_us_.store(0, std::memory_order_relaxed);
+    awaiting_byte_.store(false, std::memory_order_relaxed);
+    awaiting_play_.store(false, std::memory_order_relaxed);
+    turns_.store(0, std::memory_order_relaxed);
+}
+
+}  // namespace linx
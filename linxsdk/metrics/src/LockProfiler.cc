@@ -0,0 +1,138 @@
+#include "LockProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+#include "Metrics.h"
+
+namespace linx {
+
+namespace {
+
+// 统计本身用普通的 std::mutex：只在构造锁、注册指标和出报告时访问
+struct LockProfiles {
+    std::mutex mutex;
+    std::deque<LockProfile> profiles;  // deque 追加时不移动已有元素，LockProfileFor 返回的指针一直有效
+    MetricsRegistry* registry = nullptr;
+};
+
+LockProfiles& Profiles() {
+    static LockProfiles* profiles = new LockProfiles();  // 不析构：静态对象析构期间仍可能有锁被构造或使用
+    return *profiles;
+}
+
+void RegisterProfile(MetricsRegistry& registry, const LockProfile* profile) {
+    if (profile->kind == LockProfile::Kind::Mutex) {
+        std::string prefix = "linx_lock_" + profile->name + "_";
+        registry.AddHistogram(prefix + "wait_ns", "Time spent waiting for the " + profile->name +
+                              " lock when it was contended, nanoseconds", &profile->wait_ns);
+        registry.AddHistogram(prefix + "hold_ns", "Time the " + profile->name + " lock was held, nanoseconds",
+                              &profile->hold_ns);
+        registry.AddCounterSampler(prefix + "acquisitions_total", "Acquisitions of the " + profile->name + " lock",
+                                   [profile]() { return profile->acquisitions.load(std::memory_order_relaxed); });
+        registry.AddCounterSampler(prefix + "contended_total",
+                                   "Acquisitions of the " + profile->name + " lock that had to wait",
+                                   [profile]() { return profile->contended.load(std::memory_order_relaxed); });
+    } else {
+        std::string prefix = "linx_cv_" + profile->name + "_";
+        registry.AddHistogram(prefix + "wait_ns", "Time blocked on the " + profile->name +
+                              " condition variable per wait, nanoseconds", &profile->wait_ns);
+        registry.AddCounterSampler(prefix + "waits_total", "Waits on the " + profile->name + " condition variable",
+                                   [profile]() { return profile->acquisitions.load(std::memory_order_relaxed); });
+        registry.AddCounterSampler(prefix + "timeouts_total",
+                                   "Waits on the " + profile->name + " condition variable that timed out",
+                                   [profile]() { return profile->contended.load(std::memory_order_relaxed); });
+    }
+}
+
+double NsToUs(uint64_t ns) { return static_cast<double>(ns) / 1000.0; }
+
+}  // namespace
+
+LockProfile* LockProfileFor(const char* name, LockProfile::Kind kind) {
+    LockProfiles& all = Profiles();
+    std::lock_guard<std::mutex> lock(all.mutex);
+    for (LockProfile& profile : all.profiles) {
+        if (profile.kind == kind && profile.name == name) {
+            return &profile;
+        }
+    }
+    LockProfile& profile = all.profiles.emplace_back();
+    profile.name = name;
+    profile.kind = kind;
+    if (all.registry != nullptr) {
+        RegisterProfile(*all.registry, &profile);
+    }
+    return &profile;
+}
+
+bool LockProfilingEnabled() {
+#if defined(LINX_LOCK_PROFILING)
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::string LockReport() {
+    if (!LockProfilingEnabled()) {
+        return "lock profiling needs -DLINX_LOCK_PROFILING=ON\n";
+    }
+    LockProfiles& all = Profiles();
+    std::vector<const LockProfile*> mutexes;
+    std::vector<const LockProfile*> cvs;
+    {
+        std::lock_guard<std::mutex> lock(all.mutex);
+        for (const LockProfile& profile : all.profiles) {
+            (profile.kind == LockProfile::Kind::Mutex ? mutexes : cvs).push_back(&profile);
+        }
+    }
+    // 累计等待最多的排在前面：最值得改成无锁的路径
+    auto by_wait = [](const LockProfile* a, const LockProfile* b) { return a->wait_ns.SumUs() > b->wait_ns.SumUs(); };
+    std::sort(mutexes.begin(), mutexes.end(), by_wait);
+    std::sort(cvs.begin(), cvs.end(), by_wait);
+
+    std::string out = "locks (acquisitions, contended, wait total / p50 / p99 / max, hold p50 / p99 / max, us):\n";
+    char line[256];
+    for (const LockProfile* p : mutexes) {
+        uint64_t acquisitions = p->acquisitions.load(std::memory_order_relaxed);
+        uint64_t contended = p->contended.load(std::memory_order_relaxed);
+        LatencySummary wait = p->wait_ns.Summarize();
+        LatencySummary hold = p->hold_ns.Summarize();
+        snprintf(line, sizeof(line),
+                 "  %-24s %10llu %9llu %5.1f%%  wait %10.1f / %7.1f / %7.1f / %8.1f  hold %7.2f / %7.2f / %8.2f\n",
+                 p->name.c_str(), static_cast<unsigned long long>(acquisitions),
+                 static_cast<unsigned long long>(contended), acquisitions ? 100.0 * contended / acquisitions : 0.0,
+                 NsToUs(p->wait_ns.SumUs()), NsToUs(wait.p50_us), NsToUs(wait.p99_us), NsToUs(wait.max_us),
+                 NsToUs(hold.p50_us), NsToUs(hold.p99_us), NsToUs(hold.max_us));
+        out += line;
+    }
+    if (!cvs.empty()) {
+        out += "condition variables (waits, timeouts, blocked total / p50 / p99 / max, us):\n";
+    }
+    for (const LockProfile* p : cvs) {
+        LatencySummary wait = p->wait_ns.Summarize();
+        snprintf(line, sizeof(line), "  %-24s %10llu %9llu  blocked %12.1f / %9.1f / %9.1f / %10.1f\n",
+                 p->name.c_str(), static_cast<unsigned long long>(p->acquisitions.load(std::memory_order_relaxed)),
+                 static_cast<unsigned long long>(p->contended.load(std::memory_order_relaxed)),
+                 NsToUs(p->wait_ns.SumUs()), NsToUs(wait.p50_us), NsToUs(wait.p99_us), NsToUs(wait.max_us));
+        out += line;
+    }
+    return out;
+}
+
+void RegisterLockMetrics(MetricsRegistry& registry) {
+    if (!LockProfilingEnabled()) {
+        return;
+    }
+    LockProfiles& all = Profiles();
+    std::lock_guard<std::mutex> lock(all.mutex);
+    all.registry = &registry;
+    for (const LockProfile& profile : all.profiles) {
+        RegisterProfile(registry, &profile);
+    }
+}
+
+}  // namespace linx
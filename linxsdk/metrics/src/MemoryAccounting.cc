@@ -0,0 +1,365 @@
+#include "MemoryAccounting.h"
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "AllocationTracker.h"
+#include "Metrics.h"
+#include "ThreadPolicy.h"
+
+namespace linx {
+
+namespace {
+
+// 每个标签的计数独占一个 cache line：音频线程和网络线程记账时互不干扰
+struct alignas(64) TagCounters {
+    std::atomic<int64_t> bytes{0};
+    std::atomic<int64_t> peak{0};
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<size_t> budget{0};
+    std::atomic<bool> reported{false};
+};
+
+// 常量初始化：全局 operator new 在静态构造之前就可能调用到这里
+TagCounters g_tags[kMemoryTagCount];
+std::atomic<size_t> g_rss_budget{0};
+std::atomic<bool> g_fail_fast{true};
+std::atomic<bool> g_rss_reported{false};
+std::atomic<bool> g_failing{false};
+
+thread_local MemoryTag t_scope_tag = MemoryTag::Heap;
+
+const char* const kTagNames[kMemoryTagCount] = {"audio", "codec", "network", "json", "log", "recording", "heap"};
+
+std::string FormatBytes(int64_t bytes) {
+    char buf[32];
+    double v = static_cast<double>(bytes);
+    if (bytes < 0) {
+        snprintf(buf, sizeof(buf), "-");
+    } else if (v >= 1024.0 * 1024.0) {
+        snprintf(buf, sizeof(buf), "%.1f MiB", v / (1024.0 * 1024.0));
+    } else if (v >= 1024.0) {
+        snprintf(buf, sizeof(buf), "%.1f KiB", v / 1024.0);
+    } else {
+        snprintf(buf, sizeof(buf), "%lld B", static_cast<long long>(bytes));
+    }
+    return buf;
+}
+
+// 超出预算：分配可能正发生在日志库内部（持有其锁），报告直接写 stderr，不经 spdlog
+void BudgetExceeded(const char* what, int64_t bytes, size_t budget) {
+    bool fail_fast = g_fail_fast.load(std::memory_order_relaxed);
+    if (fail_fast && g_failing.exchange(true)) {
+        return;  // 生成报告本身的分配再次超出
+    }
+    fprintf(stderr, "memory budget exceeded: %s %s > %s\n", what, FormatBytes(bytes).c_str(),
+            FormatBytes(static_cast<int64_t>(budget)).c_str());
+    if (!fail_fast) {
+        return;
+    }
+    fputs(MemoryReport().c_str(), stderr);
+    fflush(stderr);
+    std::abort();
+}
+
+}  // namespace
+
+const char* MemoryTagName(MemoryTag tag) {
+    size_t index = static_cast<size_t>(tag);
+    return index < kMemoryTagCount ? kTagNames[index] : "unknown";
+}
+
+bool ParseMemorySize(const std::string& text, size_t* out) {
+    if (text.empty() || !isdigit(static_cast<unsigned char>(text[0]))) {
+        return false;
+    }
+    char* end = nullptr;
+    unsigned long long v = strtoull(text.c_str(), &end, 10);
+    std::string suffix(end);
+    if (suffix == "K" || suffix == "k") {
+        v <<= 10;
+    } else if (suffix == "M" || suffix == "m") {
+        v <<= 20;
+    } else if (suffix == "G" || suffix == "g") {
+        v <<= 30;
+    } else if (!suffix.empty()) {
+        return false;
+    }
+    *out = static_cast<size_t>(v);
+    return true;
+}
+
+bool MemoryBudget::Parse(const std::string& text, MemoryBudget* out) {
+    MemoryBudget budget;
+    budget.fail_fast = out->fail_fast;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = text.find(',', start);
+        std::string item = text.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) {
+            if (!ParseMemorySize(item, &budget.rss_bytes)) {
+                return false;
+            }
+        } else {
+            std::string name = item.substr(0, eq);
+            size_t index = 0;
+            while (index < kMemoryTagCount && name != kTagNames[index]) {
+                index++;
+            }
+            if (index == kMemoryTagCount || !ParseMemorySize(item.substr(eq + 1), &budget.tag_bytes[index])) {
+                return false;
+            }
+        }
+        if (comma == std::string::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    *out = budget;
+    return true;
+}
+
+void AccountMemory(MemoryTag tag, int64_t delta) {
+    TagCounters& c = g_tags[static_cast<size_t>(tag)];
+    int64_t now = c.bytes.fetch_add(delta, std::memory_order_relaxed) + delta;
+    if (delta <= 0) {
+        return;
+    }
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+    int64_t peak = c.peak.load(std::memory_order_relaxed);
+    while (now > peak && !c.peak.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+    }
+    size_t budget = c.budget.load(std::memory_order_relaxed);
+    if (budget > 0 && now > static_cast<int64_t>(budget) && !c.reported.exchange(true)) {
+        BudgetExceeded(MemoryTagName(tag), now, budget);
+    }
+}
+
+MemoryTagStats GetMemoryTagStats(MemoryTag tag) {
+    const TagCounters& c = g_tags[static_cast<size_t>(tag)];
+    MemoryTagStats stats;
+    stats.bytes = c.bytes.load(std::memory_order_relaxed);
+    stats.peak_bytes = c.peak.load(std::memory_order_relaxed);
+    stats.allocations = c.allocations.load(std::memory_order_relaxed);
+    return stats;
+}
+
+ProcessMemory ReadProcessMemory() {
+    ProcessMemory memory;
+#ifdef __linux__
+    FILE* f = fopen("/proc/self/status", "r");
+    if (f != nullptr) {
+        char line[128];
+        while (fgets(line, sizeof(line), f) != nullptr) {
+            long long v = 0;
+            if (sscanf(line, "VmRSS: %lld kB", &v) == 1) {
+                memory.rss_bytes = v * 1024;
+            } else if (sscanf(line, "VmHWM: %lld kB", &v) == 1) {
+                memory.peak_rss_bytes = v * 1024;
+            } else if (sscanf(line, "Threads: %lld", &v) == 1) {
+                memory.threads = v;
+            }
+        }
+        fclose(f);
+    }
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        memory.peak_rss_bytes = static_cast<int64_t>(usage.ru_maxrss);  // macOS 为字节
+    }
+#endif
+    return memory;
+}
+
+void SetMemoryBudget(const MemoryBudget& budget) {
+    g_fail_fast.store(budget.fail_fast, std::memory_order_relaxed);
+    g_rss_budget.store(budget.rss_bytes, std::memory_order_relaxed);
+    for (size_t i = 0; i < kMemoryTagCount; i++) {
+        g_tags[i].budget.store(budget.tag_bytes[i], std::memory_order_relaxed);
+        g_tags[i].reported.store(false, std::memory_order_relaxed);
+    }
+    g_rss_reported.store(false, std::memory_order_relaxed);
+}
+
+bool CheckMemoryBudget() {
+    size_t budget = g_rss_budget.load(std::memory_order_relaxed);
+    if (budget == 0) {
+        return true;
+    }
+    ProcessMemory memory = ReadProcessMemory();
+    if (memory.rss_bytes <= static_cast<int64_t>(budget)) {
+        return true;
+    }
+    if (!g_rss_reported.exchange(true)) {
+        BudgetExceeded("rss", memory.rss_bytes, budget);
+    }
+    return false;
+}
+
+std::string MemoryReport() {
+    std::string out = "memory (current / peak / allocations):\n";
+    int64_t total = 0;
+    for (size_t i = 0; i < kMemoryTagCount; i++) {
+        MemoryTagStats stats = GetMemoryTagStats(static_cast<MemoryTag>(i));
+        total += stats.bytes;
+        char line[160];
+        size_t budget = g_tags[i].budget.load(std::memory_order_relaxed);
+        snprintf(line, sizeof(line), "  %-10s %12s / %12s / %llu%s%s\n", kTagNames[i], FormatBytes(stats.bytes).c_str(),
+                 FormatBytes(stats.peak_bytes).c_str(), static_cast<unsigned long long>(stats.allocations),
+                 budget > 0 ? ", budget " : "", budget > 0 ? FormatBytes(static_cast<int64_t>(budget)).c_str() : "");
+        out += line;
+    }
+    ProcessMemory memory = ReadProcessMemory();
+    size_t stack = DefaultThreadStackSize();
+    char line[256];
+    snprintf(line, sizeof(line), "  tracked %s; rss %s, peak %s; %lld threads, default stack %s\n",
+             FormatBytes(total).c_str(), FormatBytes(memory.rss_bytes).c_str(),
+             FormatBytes(memory.peak_rss_bytes).c_str(), static_cast<long long>(memory.threads),
+             stack > 0 ? FormatBytes(static_cast<int64_t>(stack)).c_str() : "-");
+    out += line;
+    if (!HeapAccountingEnabled()) {
+        out += "  json/log/heap need -DLINX_MEMORY_ACCOUNTING=ON\n";
+    }
+    return out;
+}
+
+void RegisterMemoryMetrics(MetricsRegistry& registry) {
+    for (size_t i = 0; i < kMemoryTagCount; i++) {
+        MemoryTag tag = static_cast<MemoryTag>(i);
+        std::string name = std::string("linx_memory_") + kTagNames[i];
+        registry.AddGaugeSampler(name + "_bytes", std::string("Tracked bytes allocated for ") + kTagNames[i],
+                                 [tag]() { return static_cast<double>(GetMemoryTagStats(tag).bytes); });
+        registry.AddGaugeSampler(name + "_peak_bytes", std::string("Peak tracked bytes for ") + kTagNames[i],
+                                 [tag]() { return static_cast<double>(GetMemoryTagStats(tag).peak_bytes); });
+    }
+    registry.AddGaugeSampler("linx_process_rss_bytes", "Resident set size of the process",
+                             []() { return static_cast<double>(ReadProcessMemory().rss_bytes); });
+    registry.AddGaugeSampler("linx_process_rss_peak_bytes", "Peak resident set size of the process",
+                             []() { return static_cast<double>(ReadProcessMemory().peak_rss_bytes); });
+    registry.AddGaugeSampler("linx_process_threads", "Threads in the process",
+                             []() { return static_cast<double>(ReadProcessMemory().threads); });
+}
+
+bool HeapAccountingEnabled() {
+#ifdef LINX_MEMORY_ACCOUNTING
+    return true;
+#else
+    return false;
+#endif
+}
+
+MemoryScope::MemoryScope(MemoryTag tag) : previous_(t_scope_tag) { t_scope_tag = tag; }
+
+MemoryScope::~MemoryScope() { t_scope_tag = previous_; }
+
+MemoryTag CurrentMemoryTag() { return t_scope_tag; }
+
+void* TaggedMalloc(MemoryTag tag, size_t bytes, size_t alignment) {
+    void* p = nullptr;
+    if (alignment <= alignof(std::max_align_t)) {
+        p = std::malloc(bytes == 0 ? 1 : bytes);
+    } else if (posix_memalign(&p, alignment, bytes == 0 ? alignment : bytes) != 0) {
+        p = nullptr;
+    }
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    AccountMemory(tag, static_cast<int64_t>(bytes));
+    detail::NoteAllocation(bytes);
+    return p;
+}
+
+void TaggedFree(MemoryTag tag, void* ptr, size_t bytes) {
+    if (ptr == nullptr) {
+        return;
+    }
+    AccountMemory(tag, -static_cast<int64_t>(bytes));
+    std::free(ptr);
+}
+
+}  // namespace linx
+
+#ifdef LINX_MEMORY_ACCOUNTING
+
+// 全局 operator new/delete：每块前加一个长度头，记入分配时线程的 MemoryScope 标签（默认 heap）。
+// 对齐版本（align_val_t）保持标准库实现，new/delete 成对，不会混用
+namespace {
+
+struct alignas(std::max_align_t) HeapHeader {
+    size_t size;
+    linx::MemoryTag tag;
+};
+
+void* HookedNew(size_t size) {
+    auto* header = static_cast<HeapHeader*>(std::malloc(sizeof(HeapHeader) + size));
+    if (header == nullptr) {
+        return nullptr;
+    }
+    header->size = size;
+    header->tag = linx::CurrentMemoryTag();
+    linx::AccountMemory(header->tag, static_cast<int64_t>(size));
+    return header + 1;
+}
+
+void HookedDelete(void* ptr) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    HeapHeader* header = static_cast<HeapHeader*>(ptr) - 1;
+    linx::AccountMemory(header->tag, -static_cast<int64_t>(header->size));
+    std::free(header);
+}
+
+void* HookedNewOrThrow(size_t size) {
+    void* p = HookedNew(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+}  // namespace
+
+// 每个版本各自调用 NoteAllocation（不经另一个 operator new 转发），AllocationTracker 取到的调用栈帧数一致
+void* operator new(size_t size) {
+    void* p = HookedNewOrThrow(size);
+    linx::detail::NoteAllocation(size);
+    return p;
+}
+
+void* operator new[](size_t size) {
+    void* p = HookedNewOrThrow(size);
+    linx::detail::NoteAllocation(size);
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    void* p = HookedNew(size);
+    if (p != nullptr) {
+        linx::detail::NoteAllocation(size);
+    }
+    return p;
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    void* p = HookedNew(size);
+    if (p != nullptr) {
+        linx::detail::NoteAllocation(size);
+    }
+    return p;
+}
+
+void operator delete(void* ptr) noexcept { HookedDelete(ptr); }
+void operator delete[](void* ptr) noexcept { HookedDelete(ptr); }
+void operator delete(void* ptr, size_t) noexcept { HookedDelete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { HookedDelete(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { HookedDelete(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { HookedDelete(ptr); }
+
+#endif  // LINX_MEMORY_ACCOUNTING
@@ -0,0 +1,202 @@
+#include "Metrics.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+#include "Json.h"
+#include "Log.h"
+
+namespace linx {
+
+namespace {
+
+// Prometheus 文本格式中的数值：整数按整数输出，其余保留有效位
+std::string FormatValue(double v) {
+    char buf[32];
+    if (v == static_cast<double>(static_cast<int64_t>(v))) {
+        snprintf(buf, sizeof(buf), "%" PRId64, static_cast<int64_t>(v));
+    } else {
+        snprintf(buf, sizeof(buf), "%.6g", v);
+    }
+    return buf;
+}
+
+void AppendHeader(std::string* out, const std::string& name, const std::string& help, const char* type) {
+    *out += "# HELP " + name + " " + help + "\n";
+    *out += "# TYPE " + name + " " + type + "\n";
+}
+
+}  // namespace
+
+MetricsRegistry& MetricsRegistry::Global() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Entry* MetricsRegistry::Find(const std::string& name) {
+    for (auto& entry : entries_) {
+        if (entry.name == name) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+Counter& MetricsRegistry::AddCounter(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry* existing = Find(name);
+    if (existing != nullptr && existing->counter != nullptr) {
+        return *existing->counter;
+    }
+    counters_.emplace_back(new Counter());
+    if (existing != nullptr) {
+        // 同名的其他类型指标已存在：返回一个不导出的计数器，调用方照常使用
+        WARN("metric {} already registered with another type", name);
+        return *counters_.back();
+    }
+    Entry entry;
+    entry.name = name;
+    entry.help = help;
+    entry.type = Type::Counter;
+    entry.counter = counters_.back().get();
+    entries_.push_back(std::move(entry));
+    return *counters_.back();
+}
+
+Gauge& MetricsRegistry::AddGauge(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry* existing = Find(name);
+    if (existing != nullptr && existing->gauge != nullptr) {
+        return *existing->gauge;
+    }
+    gauges_.emplace_back(new Gauge());
+    if (existing != nullptr) {
+        WARN("metric {} already registered with another type", name);
+        return *gauges_.back();
+    }
+    Entry entry;
+    entry.name = name;
+    entry.help = help;
+    entry.type = Type::Gauge;
+    entry.gauge = gauges_.back().get();
+    entries_.push_back(std::move(entry));
+    return *gauges_.back();
+}
+
+void MetricsRegistry::AddCounterSampler(const std::string& name, const std::string& help, Sampler sampler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (Find(name) != nullptr) {
+        WARN("metric {} already registered", name);
+        return;
+    }
+    Entry entry;
+    entry.name = name;
+    entry.help = help;
+    entry.type = Type::Counter;
+    entry.sampler = std::move(sampler);
+    entries_.push_back(std::move(entry));
+}
+
+void MetricsRegistry::AddGaugeSampler(const std::string& name, const std::string& help, Sampler sampler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (Find(name) != nullptr) {
+        WARN("metric {} already registered", name);
+        return;
+    }
+    Entry entry;
+    entry.name = name;
+    entry.help = help;
+    entry.type = Type::Gauge;
+    entry.sampler = std::move(sampler);
+    entries_.push_back(std::move(entry));
+}
+
+void MetricsRegistry::AddHistogram(const std::string& name, const std::string& help,
+                                   const LatencyHistogram* histogram) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (histogram == nullptr || Find(name) != nullptr) {
+        WARN("metric {} already registered or null", name);
+        return;
+    }
+    Entry entry;
+    entry.name = name;
+    entry.help = help;
+    entry.type = Type::Summary;
+    entry.histogram = histogram;
+    entries_.push_back(std::move(entry));
+}
+
+double MetricsRegistry::Sample(const Entry& entry) const {
+    if (entry.counter != nullptr) {
+        return static_cast<double>(entry.counter->Value());
+    }
+    if (entry.gauge != nullptr) {
+        return static_cast<double>(entry.gauge->Value());
+    }
+    return entry.sampler ? entry.sampler() : 0;
+}
+
+std::string MetricsRegistry::PrometheusText() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string out;
+    out.reserve(entries_.size() * 128);
+    for (const auto& entry : entries_) {
+        if (entry.type == Type::Summary) {
+            LatencySummary s = entry.histogram->Summarize();
+            AppendHeader(&out, entry.name, entry.help, "summary");
+            out += entry.name + "{quantile=\"0.5\"} " + FormatValue(static_cast<double>(s.p50_us)) + "\n";
+            out += entry.name + "{quantile=\"0.9\"} " + FormatValue(static_cast<double>(s.p90_us)) + "\n";
+            out += entry.name + "{quantile=\"0.99\"} " + FormatValue(static_cast<double>(s.p99_us)) + "\n";
+            out += entry.name + "_sum " + FormatValue(s.mean_us * s.count) + "\n";
+            out += entry.name + "_count " + FormatValue(static_cast<double>(s.count)) + "\n";
+            continue;
+        }
+        AppendHeader(&out, entry.name, entry.help, entry.type == Type::Counter ? "counter" : "gauge");
+        out += entry.name + " " + FormatValue(Sample(entry)) + "\n";
+    }
+    return out;
+}
+
+std::string MetricsRegistry::JsonSnapshot(std::string_view prefix) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json snapshot = json::object();
+    for (const auto& entry : entries_) {
+        if (entry.name.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+        if (entry.type == Type::Summary) {
+            LatencySummary s = entry.histogram->Summarize();
+            snapshot[entry.name] = {{"count", s.count},   {"mean_us", s.mean_us}, {"p50_us", s.p50_us},
+                                    {"p90_us", s.p90_us}, {"p99_us", s.p99_us},   {"max_us", s.max_us}};
+            continue;
+        }
+        double v = Sample(entry);
+        if (v == static_cast<double>(static_cast<int64_t>(v))) {
+            snapshot[entry.name] = static_cast<int64_t>(v);
+        } else {
+            snapshot[entry.name] = v;
+        }
+    }
+    return snapshot.dump();
+}
+
+void MetricsRegistry::Visit(const std::function<void(const MetricValue&)>& visitor, std::string_view prefix) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : entries_) {
+        if (entry.name.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+        MetricValue value;
+        value.name = entry.name;
+        if (entry.type == Type::Summary) {
+            value.kind = MetricKind::Histogram;
+            value.histogram = entry.histogram;
+        } else {
+            value.kind = entry.type == Type::Counter ? MetricKind::Counter : MetricKind::Gauge;
+            value.value = Sample(entry);
+        }
+        visitor(value);
+    }
+}
+
+}  // namespace linx
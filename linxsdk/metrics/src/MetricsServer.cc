@@ -0,0 +1,234 @@
+#include "MetricsServer.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "Log.h"
+
+namespace linx {
+
+namespace {
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  // macOS：改为在连接上设置 SO_NOSIGPIPE
+#endif
+
+void CloseFd(int& fd) {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+bool SendAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+}  // namespace
+
+MetricsServer::MetricsServer(MetricsRegistry& registry, const MetricsServerConfig& config)
+    : registry_(registry), config_(config) {}
+
+MetricsServer::~MetricsServer() { Stop(); }
+
+int MetricsServer::ListenUnix() {
+    sockaddr_un addr{};
+    if (config_.unix_path.size() >= sizeof(addr.sun_path)) {
+        ERROR("MetricsServer: unix path too long: {}", config_.unix_path);
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        ERROR("MetricsServer: socket failed: {}", strerror(errno));
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, config_.unix_path.c_str(), config_.unix_path.size() + 1);
+    unlink(config_.unix_path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+        ERROR("MetricsServer: listen on {} failed: {}", config_.unix_path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return fd;
+}
+
+int MetricsServer::ListenTcp() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        ERROR("MetricsServer: socket failed: {}", strerror(errno));
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(config_.tcp_port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+        ERROR("MetricsServer: listen on 127.0.0.1:{} failed: {}", config_.tcp_port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return fd;
+}
+
+bool MetricsServer::Start() {
+    if (running_) {
+        return true;
+    }
+    if (!config_.unix_path.empty() && (unix_fd_ = ListenUnix()) < 0) {
+        return false;
+    }
+    if (config_.tcp_port > 0 && (tcp_fd_ = ListenTcp()) < 0) {
+        CloseFd(unix_fd_);
+        return false;
+    }
+    if (unix_fd_ < 0 && tcp_fd_ < 0) {
+        WARN("MetricsServer: no endpoint configured");
+        return false;
+    }
+    if (pipe(wake_fds_) < 0) {
+        ERROR("MetricsServer: pipe failed: {}", strerror(errno));
+        CloseFd(unix_fd_);
+        CloseFd(tcp_fd_);
+        return false;
+    }
+    running_ = true;
+    thread_ = std::thread(&MetricsServer::Run, this);
+    if (unix_fd_ >= 0) {
+        INFO("MetricsServer: serving on unix:{}", config_.unix_path);
+    }
+    if (tcp_fd_ >= 0) {
+        INFO("MetricsServer: serving on http://127.0.0.1:{}/metrics", config_.tcp_port);
+    }
+    return true;
+}
+
+void MetricsServer::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    char c = 0;
+    (void)!write(wake_fds_[1], &c, 1);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    CloseFd(wake_fds_[0]);
+    CloseFd(wake_fds_[1]);
+    CloseFd(tcp_fd_);
+    if (unix_fd_ >= 0) {
+        CloseFd(unix_fd_);
+        unlink(config_.unix_path.c_str());
+    }
+}
+
+void MetricsServer::Run() {
+    pollfd fds[3];
+    int listeners[2] = {unix_fd_, tcp_fd_};
+    while (running_) {
+        nfds_t count = 0;
+        fds[count++] = {wake_fds_[0], POLLIN, 0};
+        for (int fd : listeners) {
+            if (fd >= 0) {
+                fds[count++] = {fd, POLLIN, 0};
+            }
+        }
+        int ret = poll(fds, count, -1);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ERROR("MetricsServer: poll failed: {}", strerror(errno));
+            break;
+        }
+        if (fds[0].revents) {
+            break;
+        }
+        for (nfds_t i = 1; i < count; ++i) {
+            if (!(fds[i].revents & POLLIN)) {
+                continue;
+            }
+            int client = accept(fds[i].fd, nullptr, nullptr);
+            if (client < 0) {
+                continue;
+            }
+            Serve(client);
+            close(client);
+        }
+    }
+}
+
+void MetricsServer::AddCommand(const std::string& name, std::function<std::string()> handler) {
+    if (running_) {
+        WARN("MetricsServer::AddCommand must be called before start(), ignored");
+        return;
+    }
+    commands_[name] = std::move(handler);
+}
+
+void MetricsServer::Serve(int fd) {
+    // 请求只看第一行，读不到（如 nc 不发任何数据）时按默认格式处理；超时防止慢客户端卡住服务线程
+    timeval timeout{0, 200 * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#ifdef __APPLE__
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    char request[512];
+    ssize_t n = recv(fd, request, sizeof(request) - 1, 0);
+    request[n > 0 ? n : 0] = '\0';
+
+    bool http = strncmp(request, "GET ", 4) == 0;
+    bool want_json = http ? strncmp(request + 4, "/json", 5) == 0 : strncmp(request, "json", 4) == 0;
+    auto command = commands_.end();
+    if (!commands_.empty()) {
+        const char* word = http ? request + (request[4] == '/' ? 5 : 4) : request;
+        command = commands_.find(std::string(word, strcspn(word, " ?\r\n\t")));
+    }
+    std::string body;
+    if (command != commands_.end()) {
+        body = command->second();
+    } else {
+        body = want_json ? registry_.JsonSnapshot() : registry_.PrometheusText();
+        scrapes_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (http) {
+        std::string header = "HTTP/1.1 200 OK\r\nContent-Type: ";
+        header += command != commands_.end() ? "text/plain"
+                  : want_json                ? "application/json"
+                                             : "text/plain; version=0.0.4";
+        header += "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+        if (!SendAll(fd, header.data(), header.size())) {
+            return;
+        }
+    }
+    SendAll(fd, body.data(), body.size());
+}
+
+}  // namespace linx
@@ -0,0 +1,132 @@
+#include "StartupTrace.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace linx {
+
+namespace {
+
+constexpr int kBarWidth = 40;
+
+}  // namespace
+
+StartupPhase* StartupTrace::FindLocked(std::string_view name) {
+    for (StartupPhase& phase : phases_) {
+        if (phase.name == name) {
+            return &phase;
+        }
+    }
+    return nullptr;
+}
+
+const StartupPhase* StartupTrace::FindLocked(std::string_view name) const {
+    return const_cast<StartupTrace*>(this)->FindLocked(name);
+}
+
+void StartupTrace::Begin(std::string_view name) {
+    double now = SinceOriginMs(Clock::now());
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (FindLocked(name) != nullptr) {
+        return;
+    }
+    StartupPhase phase;
+    phase.name = std::string(name);
+    phase.begin_ms = now;
+    phases_.push_back(std::move(phase));
+}
+
+void StartupTrace::End(std::string_view name) {
+    double now = SinceOriginMs(Clock::now());
+    std::lock_guard<std::mutex> lock(mutex_);
+    StartupPhase* phase = FindLocked(name);
+    if (phase == nullptr) {
+        StartupPhase mark;
+        mark.name = std::string(name);
+        mark.begin_ms = now;
+        mark.end_ms = now;
+        phases_.push_back(std::move(mark));
+    } else if (!phase->Done()) {
+        phase->end_ms = now;
+    }
+}
+
+bool StartupTrace::Mark(std::string_view name) {
+    double now = SinceOriginMs(Clock::now());
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (FindLocked(name) != nullptr) {
+        return false;
+    }
+    StartupPhase mark;
+    mark.name = std::string(name);
+    mark.begin_ms = now;
+    mark.end_ms = now;
+    phases_.push_back(std::move(mark));
+    return true;
+}
+
+bool StartupTrace::Has(std::string_view name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const StartupPhase* phase = FindLocked(name);
+    return phase != nullptr && phase->Done();
+}
+
+double StartupTrace::ElapsedMs(std::string_view name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const StartupPhase* phase = FindLocked(name);
+    return phase != nullptr ? phase->end_ms : -1;
+}
+
+double StartupTrace::NowMs() const { return SinceOriginMs(Clock::now()); }
+
+std::vector<StartupPhase> StartupTrace::Phases() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return phases_;
+}
+
+std::string StartupTrace::Report() const {
+    std::vector<StartupPhase> phases = Phases();
+    std::stable_sort(phases.begin(), phases.end(),
+                     [](const StartupPhase& a, const StartupPhase& b) { return a.begin_ms < b.begin_ms; });
+    double span = 0;
+    size_t name_width = 5;
+    for (const StartupPhase& phase : phases) {
+        span = std::max(span, phase.Done() ? phase.end_ms : phase.begin_ms);
+        name_width = std::max(name_width, phase.name.size());
+    }
+    double scale = span > 0 ? kBarWidth / span : 0;
+
+    std::string report;
+    char line[256];
+    std::snprintf(line, sizeof(line), "  %-*s %8s %8s %8s\n", static_cast<int>(name_width), "phase", "begin",
+                  "end", "ms");
+    report += line;
+    for (const StartupPhase& phase : phases) {
+        // 条从开始时刻画到结束时刻，里程碑画成一个 '|'，未结束的阶段画到末尾并以 '>' 结尾
+        int from = static_cast<int>(phase.begin_ms * scale);
+        int to = static_cast<int>((phase.Done() ? phase.end_ms : span) * scale);
+        std::string bar(static_cast<size_t>(from), ' ');
+        if (phase.Done() && phase.end_ms == phase.begin_ms) {
+            bar += '|';
+        } else {
+            bar.append(static_cast<size_t>(std::max(1, to - from)), '#');
+            if (!phase.Done()) {
+                bar.back() = '>';
+            }
+        }
+        if (phase.Done()) {
+            std::snprintf(line, sizeof(line), "  %-*s %8.1f %8.1f %8.1f  %s\n", static_cast<int>(name_width),
+                          phase.name.c_str(), phase.begin_ms, phase.end_ms, phase.DurationMs(), bar.c_str());
+        } else {
+            std::snprintf(line, sizeof(line), "  %-*s %8.1f %8s %8s  %s\n", static_cast<int>(name_width),
+                          phase.name.c_str(), phase.begin_ms, "-", "-", bar.c_str());
+        }
+        report += line;
+    }
+    if (!report.empty() && report.back() == '\n') {
+        report.pop_back();
+    }
+    return report;
+}
+
+}  // namespace linx
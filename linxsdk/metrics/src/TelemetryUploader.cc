@@ -0,0 +1,309 @@
+#include "TelemetryUploader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "Log.h"
+#include "SteadyClock.h"
+
+namespace linx {
+
+namespace {
+
+enum : uint8_t { kEntryCounter = 0, kEntryGauge = 1, kEntryHistogram = 2 };
+
+void PutVarint(std::string* out, uint64_t v) {
+    while (v >= 0x80) {
+        out->push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out->push_back(static_cast<char>(v));
+}
+
+void PutSigned(std::string* out, int64_t v) {
+    PutVarint(out, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+}
+
+void PutBytes(std::string* out, std::string_view bytes) {
+    PutVarint(out, bytes.size());
+    out->append(bytes.data(), bytes.size());
+}
+
+uint64_t ToCount(double v) { return v > 0 ? static_cast<uint64_t>(std::llround(v)) : 0; }
+
+}  // namespace
+
+TelemetryUploader::TelemetryUploader(MetricsRegistry& registry, const TelemetryConfig& config)
+    : registry_(registry), config_(config), http_(config.url) {
+    config_.sample_interval_s = std::max<uint32_t>(1, config_.sample_interval_s);
+    config_.upload_interval_s = std::max(config_.sample_interval_s, config_.upload_interval_s);
+    config_.max_backoff_s = std::max(config_.upload_interval_s, config_.max_backoff_s);
+    config_.jitter = std::min(0.9, std::max(0.0, config_.jitter));
+    // 设备ID参与播种：同一时刻启动的设备也会选出不同的上传时刻
+    rng_.seed(static_cast<uint32_t>(std::hash<std::string>()(config_.device_id) ^ SteadyNowMs()));
+}
+
+TelemetryUploader::~TelemetryUploader() { Stop(false); }
+
+bool TelemetryUploader::Start() {
+    if (running_ || config_.url.empty()) {
+        return running_;
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        stopping_ = false;
+    }
+    last_sample_ms_ = SteadyNowMs();
+    running_ = true;
+    thread_ = std::thread(&TelemetryUploader::Run, this);
+    INFO("telemetry: uploading to {} every ~{}s, sampling every {}s", config_.url, config_.upload_interval_s,
+         config_.sample_interval_s);
+    return true;
+}
+
+void TelemetryUploader::Stop(bool flush) {
+    if (!running_) {
+        return;
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        stopping_ = true;
+        flush_ = flush;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    running_ = false;
+}
+
+TelemetryStats TelemetryUploader::GetStats() const {
+    TelemetryStats stats;
+    stats.records = records_.load(std::memory_order_relaxed);
+    stats.uploads = uploads_.load(std::memory_order_relaxed);
+    stats.failures = failures_.load(std::memory_order_relaxed);
+    stats.records_dropped = records_dropped_.load(std::memory_order_relaxed);
+    stats.bytes_uploaded = bytes_uploaded_.load(std::memory_order_relaxed);
+    stats.pending_records = pending_records_gauge_.load(std::memory_order_relaxed);
+    stats.pending_bytes = pending_bytes_gauge_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+std::chrono::milliseconds TelemetryUploader::Jittered(uint64_t base_s) {
+    std::uniform_real_distribution<double> spread(-config_.jitter, config_.jitter);
+    double ms = static_cast<double>(base_s) * 1000.0 * (1.0 + spread(rng_));
+    return std::chrono::milliseconds(std::max<int64_t>(1000, static_cast<int64_t>(ms)));
+}
+
+void TelemetryUploader::Run() {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point now = Clock::now();
+    Clock::time_point next_sample = now + std::chrono::seconds(config_.sample_interval_s);
+    // 首次上传在一个完整间隔内均匀随机：批量重启（断电恢复、OTA）后的设备群不会在同一时刻上报
+    std::uniform_int_distribution<int64_t> first(config_.sample_interval_s * 1000LL,
+                                                 config_.upload_interval_s * 1000LL);
+    Clock::time_point next_upload = now + std::chrono::milliseconds(first(rng_));
+
+    std::unique_lock<ProfiledMutex> lock(mutex_);
+    while (!stopping_) {
+        cv_.wait_until(lock, std::min(next_sample, next_upload), [this]() { return stopping_; });
+        if (stopping_) {
+            break;
+        }
+        lock.unlock();
+        now = Clock::now();
+        if (now >= next_sample) {
+            Sample();
+            next_sample += std::chrono::seconds(config_.sample_interval_s);
+            if (next_sample <= now) {
+                // 系统挂起后醒来：不补采中间错过的周期
+                next_sample = now + std::chrono::seconds(config_.sample_interval_s);
+            }
+        }
+        if (now >= next_upload) {
+            uint64_t delay_s = config_.upload_interval_s;
+            if (!Upload(config_.timeout_seconds)) {
+                // 从一个采样间隔起步翻倍：偶发的网络抖动很快重试，服务端长时间不可用时逐渐拉长
+                unsigned shift = std::min(failures_in_row_ - 1, 20u);
+                delay_s = std::min<uint64_t>(config_.max_backoff_s,
+                                             static_cast<uint64_t>(config_.sample_interval_s) << shift);
+            }
+            next_upload = Clock::now() + Jittered(delay_s);
+        }
+        lock.lock();
+    }
+    bool flush = flush_;
+    lock.unlock();
+    if (flush) {
+        Sample();
+        Upload(config_.flush_timeout_seconds);
+    }
+}
+
+uint32_t TelemetryUploader::NameIndex(std::string_view name) {
+    auto it = name_index_.find(std::string(name));
+    if (it != name_index_.end()) {
+        return it->second;
+    }
+    uint32_t index = static_cast<uint32_t>(names_.size());
+    names_.emplace_back(name);
+    name_index_.emplace(names_.back(), index);
+    last_counters_.push_back(0);
+    last_histograms_.emplace_back();
+    return index;
+}
+
+void TelemetryUploader::Sample() {
+    uint64_t now_ms = SteadyNowMs();
+    std::string entries;
+    uint64_t count = 0;
+    registry_.Visit(
+        [&](const MetricValue& metric) {
+            uint32_t index = NameIndex(metric.name);
+            switch (metric.kind) {
+                case MetricKind::Counter: {
+                    uint64_t value = ToCount(metric.value);
+                    uint64_t& last = last_counters_[index];
+                    // 计数器回退（所属对象重建）：发送当前值，服务端按新的起点累加
+                    uint64_t delta = value >= last ? value - last : value;
+                    last = value;
+                    if (delta == 0) {
+                        return;
+                    }
+                    PutVarint(&entries, index);
+                    entries.push_back(static_cast<char>(kEntryCounter));
+                    PutVarint(&entries, delta);
+                    break;
+                }
+                case MetricKind::Gauge:
+                    PutVarint(&entries, index);
+                    entries.push_back(static_cast<char>(kEntryGauge));
+                    PutSigned(&entries, static_cast<int64_t>(std::llround(metric.value * 1000.0)));
+                    break;
+                case MetricKind::Histogram: {
+                    HistogramState& state = last_histograms_[index];
+                    if (state.buckets.empty()) {
+                        state.buckets.assign(LatencyHistogram::kBuckets, 0);
+                    }
+                    std::string buckets;
+                    uint64_t nonzero = 0;
+                    size_t previous = 0;
+                    for (size_t b = 0; b < LatencyHistogram::kBuckets; ++b) {
+                        uint64_t value = metric.histogram->BucketCount(b);
+                        uint64_t delta = value >= state.buckets[b] ? value - state.buckets[b] : value;
+                        state.buckets[b] = value;
+                        if (delta == 0) {
+                            continue;
+                        }
+                        PutVarint(&buckets, b - previous);
+                        PutVarint(&buckets, delta);
+                        previous = b;
+                        ++nonzero;
+                    }
+                    uint64_t sum = metric.histogram->SumUs();
+                    uint64_t sum_delta = sum >= state.sum_us ? sum - state.sum_us : sum;
+                    state.sum_us = sum;
+                    if (nonzero == 0) {
+                        return;
+                    }
+                    PutVarint(&entries, index);
+                    entries.push_back(static_cast<char>(kEntryHistogram));
+                    PutVarint(&entries, nonzero);
+                    entries += buckets;
+                    PutVarint(&entries, sum_delta);
+                    break;
+                }
+            }
+            ++count;
+        },
+        config_.prefix);
+
+    uint64_t period_ms = now_ms - last_sample_ms_;
+    last_sample_ms_ = now_ms;
+    if (count == 0) {
+        return;
+    }
+    std::string record;
+    record.reserve(entries.size() + 16);
+    PutVarint(&record, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+                                                 std::chrono::system_clock::now().time_since_epoch())
+                                                 .count()));
+    PutVarint(&record, period_ms);
+    PutVarint(&record, count);
+    record += entries;
+
+    pending_bytes_ += record.size();
+    pending_.push_back(std::move(record));
+    records_.fetch_add(1, std::memory_order_relaxed);
+    while (pending_bytes_ > config_.max_pending_bytes && !pending_.empty()) {
+        DropOldest();
+    }
+    pending_records_gauge_.store(pending_.size(), std::memory_order_relaxed);
+    pending_bytes_gauge_.store(pending_bytes_, std::memory_order_relaxed);
+}
+
+void TelemetryUploader::DropOldest() {
+    pending_bytes_ -= pending_.front().size();
+    pending_.pop_front();
+    ++dropped_unreported_;
+    records_dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::string TelemetryUploader::EncodeBatch() const {
+    std::string batch;
+    batch.reserve(pending_bytes_ + names_.size() * 40 + 64);
+    batch.append("LXTM", 4);
+    batch.push_back(static_cast<char>(kVersion));
+    PutBytes(&batch, config_.device_id);
+    PutVarint(&batch, dropped_unreported_);
+    // 每个批次自带完整的名称表，服务端不需要保存任何设备状态即可解码
+    PutVarint(&batch, names_.size());
+    for (const std::string& name : names_) {
+        PutBytes(&batch, name);
+    }
+    PutVarint(&batch, pending_.size());
+    for (const std::string& record : pending_) {
+        batch += record;
+    }
+    return batch;
+}
+
+bool TelemetryUploader::Upload(long timeout_seconds) {
+    if (pending_.empty() && dropped_unreported_ == 0) {
+        failures_in_row_ = 0;
+        return true;
+    }
+    std::string batch = EncodeBatch();
+    std::string response;
+    long status = 0;
+    bool sent = http_.post(response, batch.data(), batch.size(), "application/x-linx-telemetry", {},
+                           timeout_seconds, &status);
+    if (sent && status >= 200 && status < 300) {
+        uploads_.fetch_add(1, std::memory_order_relaxed);
+        bytes_uploaded_.fetch_add(batch.size(), std::memory_order_relaxed);
+        pending_.clear();
+        pending_bytes_ = 0;
+        dropped_unreported_ = 0;
+        failures_in_row_ = 0;
+    } else {
+        failures_.fetch_add(1, std::memory_order_relaxed);
+        ++failures_in_row_;
+        // 服务端明确拒收（格式、鉴权、过大）时重发同一批次没有意义；超时、限流和 5xx 保留重试
+        if (sent && status >= 400 && status < 500 && status != 408 && status != 429) {
+            WARN("telemetry: server rejected {} records with HTTP {}, dropping them", pending_.size(), status);
+            records_dropped_.fetch_add(pending_.size(), std::memory_order_relaxed);
+            dropped_unreported_ += pending_.size();
+            pending_.clear();
+            pending_bytes_ = 0;
+        } else {
+            WARN("telemetry: upload of {} bytes failed (HTTP {}), {} records kept for retry", batch.size(), status,
+                 pending_.size());
+        }
+    }
+    pending_records_gauge_.store(pending_.size(), std::memory_order_relaxed);
+    pending_bytes_gauge_.store(pending_bytes_, std::memory_order_relaxed);
+    return failures_in_row_ == 0;
+}
+
+}  // namespace linx
@@ -0,0 +1,302 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "LockProfiler.h"
+#include "MemoryAccounting.h"
+#include "Opus.h"
+
+namespace linx {
+
+// 内置格式名，即 hello 中 audio_params.format 的取值
+constexpr char kFormatOpus[] = "opus";
+constexpr char kFormatPcm16[] = "pcm16";          // 16 位小端交织 PCM，不压缩
+constexpr char kFormatImaAdpcm[] = "ima_adpcm";   // IMA-ADPCM，每样本 4 位，每包自带预测器状态
+
+// 编码参数。bitrate / complexity 只对可调的编码器（Opus）有效，PCM16 与 IMA-ADPCM 的码率由采样率和声道数决定
+struct AudioCodecConfig {
+    unsigned int sample_rate = 16000;
+    int channels = 1;
+    int frame_ms = 60;
+    int bitrate = 0;           // bps，0 为编码器默认（Opus 为 opus 预设中的值）
+    int complexity = -1;       // 0~10，-1 为编码器默认
+    OpusEncoderConfig opus;    // Opus 的其余参数（预设），bitrate / complexity 非默认时覆盖其中同名项
+};
+
+// 上行编码器：与 OpusEncoderCtx 一样不加锁，同一时刻只由一个线程（采集线程）使用，
+// 所有错误以负值返回，不抛异常、不退出进程
+class AudioEncoder {
+public:
+    virtual ~AudioEncoder() = default;
+
+    virtual const char* Format() const = 0;
+    virtual bool Valid() const { return true; }
+    virtual unsigned int SampleRate() const = 0;
+    virtual int Channels() const = 0;
+    // 编码器能否按这个帧时长（毫秒）出包
+    virtual bool IsValidFrameDuration(int ms) const = 0;
+    // frames 个样本（每声道）编码后的最大字节数，用于预分配输出缓冲区
+    virtual size_t MaxPacketBytes(size_t frames) const = 0;
+
+    // 编码一帧交织 PCM（frames 为每声道样本数），返回包长，失败返回负值
+    virtual int Encode(unsigned char* out, size_t out_size, const short* pcm, size_t frames) = 0;
+
+    // 标称码率（bps）；Opus 为 OPUS_AUTO 时返回负值
+    virtual int Bitrate() const = 0;
+    // 运行时调整码率 / 复杂度，不支持时返回 false
+    virtual bool SetBitrate(int) { return false; }
+    virtual bool SetComplexity(int) { return false; }
+    // 清空编码状态，下一包不依赖之前的音频
+    virtual bool Reset() { return true; }
+    // Opus 编码器返回底层状态（预设、自适应比特率等 Opus 专有参数），其他编码器为 nullptr
+    virtual OpusEncoderCtx* Opus() { return nullptr; }
+};
+
+// 下行解码器：与 OpusDecoderCtx 一样不加锁，同一时刻只由一个线程使用（解码与丢包隐藏分属不同线程时由调用方加锁）
+class AudioDecoder {
+public:
+    virtual ~AudioDecoder() = default;
+
+    virtual const char* Format() const = 0;
+    virtual bool Valid() const { return true; }
+    // 输出的采样率和声道数（流的声道数不同时由解码器转换）
+    virtual unsigned int SampleRate() const = 0;
+    virtual int Channels() const = 0;
+    // 单个包最多解码出的样本数（每声道）
+    virtual size_t MaxFrameSamples() const = 0;
+    // 一个包解码后的样本数（每声道），包无效时返回负值
+    virtual int PacketSamples(const unsigned char* data, size_t len) const = 0;
+
+    // 解码一个包到 pcm（最多 frames 个每声道样本），返回解码出的样本数，失败返回负值
+    virtual int Decode(short* pcm, size_t frames, const unsigned char* data, size_t len) = 0;
+    // 丢包隐藏：生成 frames 个样本（每声道），返回生成的数量。Opus 由解码器外推，PCM16 / IMA-ADPCM 补静音
+    virtual int DecodeMissing(short* pcm, size_t frames) = 0;
+    virtual bool Reset() { return true; }
+
+    // 直接解码进 sink（PcmRing/JitterBuffer 等）借出的连续区域，只提交实际解码出的样本；
+    // 区域环绕或空间不足一包时经内部暂存区再 Write 一次。与 OpusDecoderCtx::DecodeInto 相同
+    template <typename Sink>
+    int DecodeInto(Sink& sink, const unsigned char* data, size_t len) {
+        int frames = PacketSamples(data, len);
+        if (frames <= 0 || static_cast<size_t>(frames) > MaxFrameSamples()) {
+            return frames <= 0 ? frames : -1;
+        }
+        size_t channels = static_cast<size_t>(Channels());
+        size_t contiguous = 0;
+        short* region = sink.WriteRegion(&contiguous);
+        if (contiguous >= static_cast<size_t>(frames) * channels) {
+            int n = Decode(region, static_cast<size_t>(frames), data, len);
+            if (n > 0) {
+                sink.CommitWrite(static_cast<size_t>(n) * channels);
+            }
+            return n;
+        }
+        if (scratch_.size() < static_cast<size_t>(frames) * channels) {
+            return -1;
+        }
+        int n = Decode(scratch_.data(), static_cast<size_t>(frames), data, len);
+        if (n > 0) {
+            sink.Write(scratch_.data(), static_cast<size_t>(n) * channels);
+        }
+        return n;
+    }
+
+protected:
+    // 派生类在构造时按 MaxFrameSamples() * Channels() 分配 DecodeInto 的暂存区
+    void AllocateScratch(size_t samples) { scratch_.assign(samples, 0); }
+
+private:
+    std::vector<short, TaggedAllocator<short, MemoryTag::Codec>> scratch_;
+};
+
+// Opus：包装 OpusEncoderCtx，可以借用已有的编码器（调用方保证其生命周期）或自己持有一个
+class OpusAudioEncoder : public AudioEncoder {
+public:
+    explicit OpusAudioEncoder(OpusEncoderCtx& encoder) : encoder_(&encoder) {}
+    explicit OpusAudioEncoder(const AudioCodecConfig& config);
+
+    const char* Format() const override { return kFormatOpus; }
+    bool Valid() const override { return encoder_->Valid(); }
+    unsigned int SampleRate() const override { return encoder_->SampleRate(); }
+    int Channels() const override { return encoder_->Channels(); }
+    bool IsValidFrameDuration(int ms) const override { return OpusEncoderCtx::IsValidFrameDuration(ms); }
+    size_t MaxPacketBytes(size_t) const override { return 4000; }  // libopus 推荐的输出缓冲区上限
+    int Encode(unsigned char* out, size_t out_size, const short* pcm, size_t frames) override {
+        return encoder_->Encode(out, out_size, pcm, frames);
+    }
+    int Bitrate() const override { return encoder_->Config().bitrate; }
+    bool SetBitrate(int bps) override;
+    bool SetComplexity(int complexity) override;
+    bool Reset() override { return encoder_->Reset(); }
+    OpusEncoderCtx* Opus() override { return encoder_; }
+
+private:
+    std::unique_ptr<OpusEncoderCtx> owned_;
+    OpusEncoderCtx* encoder_;
+};
+
+class OpusAudioDecoder : public AudioDecoder {
+public:
+    OpusAudioDecoder(unsigned int sample_rate, int channels);
+
+    const char* Format() const override { return kFormatOpus; }
+    bool Valid() const override { return decoder_.Valid(); }
+    unsigned int SampleRate() const override { return decoder_.SampleRate(); }
+    int Channels() const override { return decoder_.Channels(); }
+    size_t MaxFrameSamples() const override { return decoder_.MaxFrameSamples(); }
+    int PacketSamples(const unsigned char* data, size_t len) const override {
+        return decoder_.PacketSamples(data, len);
+    }
+    int Decode(short* pcm, size_t frames, const unsigned char* data, size_t len) override {
+        return decoder_.Decode(pcm, frames, data, len);
+    }
+    int DecodeMissing(short* pcm, size_t frames) override { return decoder_.DecodeMissing(pcm, frames); }
+    bool Reset() override { return decoder_.Reset(); }
+
+    OpusDecoderCtx& Context() { return decoder_; }
+
+private:
+    OpusDecoderCtx decoder_;
+};
+
+// PCM16：不压缩，几乎不占 CPU，码率为 采样率 × 声道 × 16（16kHz 单声道 256kbps），适合局域网
+class Pcm16Encoder : public AudioEncoder {
+public:
+    explicit Pcm16Encoder(const AudioCodecConfig& config)
+        : sample_rate_(config.sample_rate), channels_(std::max(1, config.channels)) {}
+
+    const char* Format() const override { return kFormatPcm16; }
+    unsigned int SampleRate() const override { return sample_rate_; }
+    int Channels() const override { return channels_; }
+    bool IsValidFrameDuration(int ms) const override { return ms > 0 && ms <= 120; }
+    size_t MaxPacketBytes(size_t frames) const override { return frames * channels_ * 2; }
+    int Encode(unsigned char* out, size_t out_size, const short* pcm, size_t frames) override;
+    int Bitrate() const override { return static_cast<int>(sample_rate_) * channels_ * 16; }
+
+private:
+    unsigned int sample_rate_;
+    int channels_;
+};
+
+// stream_channels：流中的声道数，与输出声道数不同时单声道复制到各声道、多声道取平均到单声道
+class Pcm16Decoder : public AudioDecoder {
+public:
+    Pcm16Decoder(unsigned int sample_rate, int channels, int stream_channels = 0);
+
+    const char* Format() const override { return kFormatPcm16; }
+    unsigned int SampleRate() const override { return sample_rate_; }
+    int Channels() const override { return channels_; }
+    size_t MaxFrameSamples() const override { return sample_rate_ * 120 / 1000; }
+    int PacketSamples(const unsigned char* data, size_t len) const override;
+    int Decode(short* pcm, size_t frames, const unsigned char* data, size_t len) override;
+    int DecodeMissing(short* pcm, size_t frames) override;
+
+private:
+    unsigned int sample_rate_;
+    int channels_;
+    int stream_channels_;
+};
+
+// IMA-ADPCM：每样本 4 位（PCM16 的 1/4，16kHz 单声道约 64kbps），每样本只有几次加减和查表，
+// CPU 开销约为 Opus 的百分之一。包布局：每声道 4 字节头（int16 预测值、uint8 步长索引，第 0 声道的第 4 字节
+// 为 1 表示最后半个字节是填充），之后是按样本交织的 4 位码（f0c0 f0c1 f1c0 ...，低半字节在前）。
+// 每包从头中的状态开始解码，丢包不会影响后续的包
+class ImaAdpcmEncoder : public AudioEncoder {
+public:
+    static constexpr size_t kHeaderBytes = 4;  // 每声道
+
+    explicit ImaAdpcmEncoder(const AudioCodecConfig& config);
+
+    const char* Format() const override { return kFormatImaAdpcm; }
+    unsigned int SampleRate() const override { return sample_rate_; }
+    int Channels() const override { return channels_; }
+    bool IsValidFrameDuration(int ms) const override { return ms > 0 && ms <= 120; }
+    size_t MaxPacketBytes(size_t frames) const override {
+        return kHeaderBytes * channels_ + (frames * channels_ + 1) / 2;
+    }
+    int Encode(unsigned char* out, size_t out_size, const short* pcm, size_t frames) override;
+    int Bitrate() const override { return static_cast<int>(sample_rate_) * channels_ * 4; }
+    bool Reset() override;
+
+private:
+    struct State {
+        int predictor = 0;
+        int index = 0;
+    };
+
+    unsigned int sample_rate_;
+    int channels_;
+    std::vector<State> state_;
+};
+
+class ImaAdpcmDecoder : public AudioDecoder {
+public:
+    ImaAdpcmDecoder(unsigned int sample_rate, int channels, int stream_channels = 0);
+
+    const char* Format() const override { return kFormatImaAdpcm; }
+    unsigned int SampleRate() const override { return sample_rate_; }
+    int Channels() const override { return channels_; }
+    size_t MaxFrameSamples() const override { return sample_rate_ * 120 / 1000; }
+    int PacketSamples(const unsigned char* data, size_t len) const override;
+    int Decode(short* pcm, size_t frames, const unsigned char* data, size_t len) override;
+    int DecodeMissing(short* pcm, size_t frames) override;
+
+private:
+    unsigned int sample_rate_;
+    int channels_;
+    int stream_channels_;
+    std::vector<short> frame_;  // 一帧流声道的样本（声道转换用）
+};
+
+// 一种格式的编解码器工厂
+struct CodecInfo {
+    std::string format;
+    std::string description;
+    // 每秒音频的相对 CPU 开销（Opus 为 100），供按设备能力选择格式时参考
+    int cpu_cost = 100;
+    // 解码器能直接输出任意支持的采样率（Opus）；否则只能按流的采样率解码，由调用方重采样
+    bool any_decode_rate = false;
+    std::function<std::unique_ptr<AudioEncoder>(const AudioCodecConfig&)> create_encoder;
+    // stream_channels 为流中的声道数（0 为与 channels 相同）
+    std::function<std::unique_ptr<AudioDecoder>(unsigned int sample_rate, int channels, int stream_channels)>
+        create_decoder;
+};
+
+// 编解码器注册表：内置 opus、pcm16、ima_adpcm，新格式（如 LC3）在启动时 Register 即可参与 hello 协商。
+// 线程安全；创建出的编解码器由调用方独占
+class CodecRegistry {
+public:
+    static CodecRegistry& Instance();
+
+    // 同名时替换，format 为空或缺少任一工厂时返回 false
+    bool Register(CodecInfo info);
+    bool Has(std::string_view format) const;
+    // 已注册的格式名，按注册顺序
+    std::vector<std::string> Formats() const;
+    // 逗号分隔的格式列表，preferred 在前、其余按注册顺序，如 "pcm16,opus,ima_adpcm"，用于 hello 的 formats
+    std::string FormatList(std::string_view preferred = {}) const;
+    bool AnyDecodeRate(std::string_view format) const;
+
+    // 未注册的格式或创建失败时返回 nullptr
+    std::unique_ptr<AudioEncoder> CreateEncoder(std::string_view format, const AudioCodecConfig& config) const;
+    std::unique_ptr<AudioDecoder> CreateDecoder(std::string_view format, unsigned int sample_rate, int channels,
+                                                int stream_channels = 0) const;
+
+private:
+    CodecRegistry();
+
+    const CodecInfo* FindLocked(std::string_view format) const;
+
+    mutable ProfiledMutex mutex_{"codec_registry"};
+    std::vector<CodecInfo> codecs_;
+};
+
+}  // namespace linx
@@ -1,58 +1,576 @@
 #pragma once
 #include <opus/opus.h>
-#include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
 
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "Log.h"
+#include "MediaFrame.h"
+#include "MemoryAccounting.h"
+#include "Tracepoints.h"
 
 namespace linx {
 
-class OpusAudio {
+// Opus 编码器参数，默认值与 libopus 默认行为一致
+struct OpusEncoderConfig {
+    int application = OPUS_APPLICATION_AUDIO;  // OPUS_APPLICATION_VOIP / AUDIO / RESTRICTED_LOWDELAY
+    int bitrate = OPUS_AUTO;                   // 比特率（bps），OPUS_AUTO 由编码器决定
+    int complexity = 10;                       // 复杂度 0~10，越低越省 CPU
+    bool vbr = true;                           // 可变码率
+    bool vbr_constraint = true;                // 受限 VBR
+    bool dtx = false;                          // 不连续传输：静音帧只发极小的包
+    bool inband_fec = false;                   // 带内前向纠错
+    int packet_loss_perc = 0;                  // 预期丢包率（%），影响 FEC 强度
+    int signal = OPUS_AUTO;                    // OPUS_SIGNAL_VOICE / OPUS_SIGNAL_MUSIC / OPUS_AUTO
+    int max_bandwidth = OPUS_BANDWIDTH_FULLBAND;
+
+    // 低功耗：语音模式 + 低复杂度 + DTX，适合 Cortex-A7 一类的设备
+    static OpusEncoderConfig LowPower() {
+        OpusEncoderConfig config;
+        config.application = OPUS_APPLICATION_VOIP;
+        config.bitrate = 16000;
+        config.complexity = 2;
+        config.dtx = true;
+        config.signal = OPUS_SIGNAL_VOICE;
+        config.max_bandwidth = OPUS_BANDWIDTH_WIDEBAND;
+        return config;
+    }
+
+    // 均衡：语音模式 + 中等复杂度 + DTX + FEC
+    static OpusEncoderConfig Balanced() {
+        OpusEncoderConfig config;
+        config.application = OPUS_APPLICATION_VOIP;
+        config.bitrate = 24000;
+        config.complexity = 5;
+        config.dtx = true;
+        config.inband_fec = true;
+        config.packet_loss_perc = 5;
+        config.signal = OPUS_SIGNAL_VOICE;
+        config.max_bandwidth = OPUS_BANDWIDTH_WIDEBAND;
+        return config;
+    }
+
+    // 高质量：通用音频模式 + 最高复杂度 + FEC
+    static OpusEncoderConfig Quality() {
+        OpusEncoderConfig config;
+        config.application = OPUS_APPLICATION_AUDIO;
+        config.bitrate = 32000;
+        config.complexity = 10;
+        config.inband_fec = true;
+        config.packet_loss_perc = 5;
+        return config;
+    }
+
+    // 按名称获取预设："low-power" / "balanced" / "quality"，未知名称返回 libopus 默认参数
+    static OpusEncoderConfig Preset(const std::string& name) {
+        if (name == "low-power") {
+            return LowPower();
+        }
+        if (name == "balanced") {
+            return Balanced();
+        }
+        if (name == "quality") {
+            return Quality();
+        }
+        WARN("Unknown Opus preset {}, using defaults", name);
+        return OpusEncoderConfig();
+    }
+};
+
+// Opus 编码器状态（RAII）：独占一个 libopus 编码器，只能移动不能拷贝。
+// 不做加锁，同一时刻只应由一个线程使用（通常是采集线程），不同会话/线程各持一个。
+// 创建失败时 Valid() 为 false，之后的编码调用返回 OPUS_INVALID_STATE；所有错误以负的错误码返回，不退出进程
+class OpusEncoderCtx {
 public:
-    OpusAudio(unsigned int sample_rate, int channels) {
-        int err;
-        encoder_ = opus_encoder_create(sample_rate, channels, OPUS_APPLICATION_AUDIO, &err);
-        check_opus_error(err, "Failed to create Opus encoder");
+    OpusEncoderCtx() = default;
+    OpusEncoderCtx(unsigned int sample_rate, int channels, const OpusEncoderConfig& config = OpusEncoderConfig())
+        : sample_rate_(sample_rate), channels_(channels) {
+        encoder_ = opus_encoder_create(sample_rate, channels, config.application, &error_);
+        if (error_ != OPUS_OK || encoder_ == nullptr) {
+            ERROR("Failed to create Opus encoder ({}Hz, {}ch): {}", sample_rate, channels, opus_strerror(error_));
+            encoder_ = nullptr;
+            return;
+        }
+        AccountMemory(MemoryTag::Codec, opus_encoder_get_size(channels));
+        config_.application = config.application;
+        ApplyConfig(config);
+    }
 
-        decoder_ = opus_decoder_create(sample_rate, channels, &err);
-        check_opus_error(err, "Failed to create Opus decoder");
+    ~OpusEncoderCtx() { Destroy(); }
+
+    OpusEncoderCtx(const OpusEncoderCtx&) = delete;
+    OpusEncoderCtx& operator=(const OpusEncoderCtx&) = delete;
+
+    OpusEncoderCtx(OpusEncoderCtx&& other) noexcept { *this = std::move(other); }
+    OpusEncoderCtx& operator=(OpusEncoderCtx&& other) noexcept {
+        if (this != &other) {
+            Destroy();
+            encoder_ = other.encoder_;
+            other.encoder_ = nullptr;
+            sample_rate_ = other.sample_rate_;
+            channels_ = other.channels_;
+            error_ = other.error_;
+            config_ = other.config_;
+        }
+        return *this;
     }
 
-    ~OpusAudio() {
-        // 销毁编码器和解码器
-        opus_encoder_destroy(encoder_);
-        opus_decoder_destroy(decoder_);
+    bool Valid() const { return encoder_ != nullptr; }
+    // 创建时的错误码（OPUS_OK 表示成功）
+    int Error() const { return error_; }
+    unsigned int SampleRate() const { return sample_rate_; }
+    int Channels() const { return channels_; }
+    // 底层句柄，用于本类未封装的 opus_encoder_ctl；无效时为 nullptr
+    OpusEncoder* Handle() const { return encoder_; }
+
+    // 指定帧时长对应的样本数（每声道）
+    size_t FrameSamples(int ms) const { return static_cast<size_t>(sample_rate_) * ms / 1000; }
+
+    // Opus 允许的帧时长（毫秒，2.5ms 除外），用于 hello 中 frame_duration 的协商
+    static constexpr bool IsValidFrameDuration(int ms) {
+        switch (ms) {
+            case 5: case 10: case 20: case 40: case 60: case 80: case 100: case 120:
+                return true;
+            default:
+                return false;
+        }
     }
 
-    int Encode(unsigned char* opus_data, size_t opus_size, opus_int16* pcm_data, size_t pcm_size) {
-        // 编码PCM数据为Opus
-        int opus_data_size;
-        opus_data_size = opus_encode(encoder_, pcm_data, pcm_size, opus_data, opus_size);
-        check_opus_error(opus_data_size, "Failed to encode Opus data");
-        return opus_data_size;
+    // 编码一帧 PCM（pcm_size 为每声道样本数），返回包长，失败返回负的错误码
+    int Encode(unsigned char* opus_data, size_t opus_size, const opus_int16* pcm_data, size_t pcm_size) {
+        LINX_PROBE_SCOPE(opus_encode, pcm_size);
+        if (encoder_ == nullptr) {
+            return OPUS_INVALID_STATE;
+        }
+        int bytes = opus_encode(encoder_, pcm_data, static_cast<int>(pcm_size), opus_data,
+                                static_cast<opus_int32>(opus_size));
+        if (bytes < 0) {
+            WARN("Opus encode failed: {}", opus_strerror(bytes));
+        }
+        return bytes;
     }
 
-    int Decode(opus_int16* pcm_data, size_t pcm_size, unsigned char* opus_data, size_t opus_size) {
-        // 编码PCM数据为Opus
-        int pcm_data_size;
-        pcm_data_size = opus_decode(decoder_, opus_data, opus_size, pcm_data, pcm_size, 0);
-        check_opus_error(pcm_data_size, "Failed to decode Opus data");
-        return pcm_data_size;
+    // float32 版本（满幅为 [-1, 1)）：浮点 DSP 链路的输出直接编码，不先转换为 int16。
+    // 浮点构建的 libopus 内部本来就按浮点处理；定点构建（--enable-fixed-point）由 libopus 自己转换
+    int Encode(unsigned char* opus_data, size_t opus_size, const float* pcm_data, size_t pcm_size) {
+        LINX_PROBE_SCOPE(opus_encode, pcm_size);
+        if (encoder_ == nullptr) {
+            return OPUS_INVALID_STATE;
+        }
+        int bytes = opus_encode_float(encoder_, pcm_data, static_cast<int>(pcm_size), opus_data,
+                                      static_cast<opus_int32>(opus_size));
+        if (bytes < 0) {
+            WARN("Opus encode failed: {}", opus_strerror(bytes));
+        }
+        return bytes;
+    }
+
+    // 按编译期格式（AudioFormat）编码一帧：帧时长在编译期校验，样本数为常量
+    template <typename Format>
+    int EncodeFrame(unsigned char* opus_data, size_t opus_size, const typename Format::Frame& frame) {
+        static_assert(IsValidFrameDuration(Format::kFrameMs), "not an Opus frame duration");
+        return Encode(opus_data, opus_size, frame.data, Format::kFrameSamples);
+    }
+
+    // 带元数据的编码：PCM 帧（视图或池中的帧）编码进 pool 中的一帧，继承时间戳、序号和标志。
+    // 声道数不符、池已空或编码失败（如帧容量不足）时返回空帧
+    MediaFrame Encode(const MediaFrame& pcm, FramePool& pool) {
+        if (encoder_ == nullptr || !pcm || pcm.kind != MediaKind::Pcm || pcm.channels != channels_) {
+            return MediaFrame();
+        }
+        LINX_PROBE_SCOPE(opus_encode, pcm.Frames());
+        FrameRef ref = pool.Acquire();
+        if (!ref) {
+            return MediaFrame();
+        }
+        int bytes = opus_encode(encoder_, pcm.Pcm(), static_cast<int>(pcm.Frames()),
+                                reinterpret_cast<unsigned char*>(ref->data),
+                                static_cast<opus_int32>(ref->capacity * sizeof(short)));
+        if (bytes <= 0) {
+            return MediaFrame();
+        }
+        ref->samples = (bytes + 1) / sizeof(short);
+        MediaFrame packet = MediaFrame::FromPool(MediaKind::Opus, std::move(ref), bytes);
+        packet.sample_rate = sample_rate_;
+        packet.channels = channels_;
+        packet.InheritFrom(pcm);
+        return packet;
     }
 
+    // 运行时调整编码参数，不重建编码器；application 只能在编码第一帧之前（或 Reset 之后）修改
+    bool ApplyConfig(const OpusEncoderConfig& config) {
+        if (encoder_ == nullptr) {
+            return false;
+        }
+        bool ok = true;
+        auto ctl = [&ok](int ret, const char* what) {
+            if (ret != OPUS_OK) {
+                WARN("opus_encoder_ctl {} failed: {}", what, opus_strerror(ret));
+                ok = false;
+            }
+        };
+        if (config.application != config_.application) {
+            ctl(opus_encoder_ctl(encoder_, OPUS_SET_APPLICATION(config.application)), "application");
+        }
+        ctl(opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(config.bitrate)), "bitrate");
+        ctl(opus_encoder_ctl(encoder_, OPUS_SET_COMPLEXITY(config.complexity)), "complexity");
+        ctl(opus_encoder_ctl(encoder_, OPUS_SET_VBR(config.vbr ? 1 : 0)), "vbr");
+        ctl(opus_encoder_ctl(encoder_, OPUS_SET_VBR_CONSTRAINT(config.vbr_constraint ? 1 : 0)),
+            "vbr_constraint");
+        ctl(opus_encoder_ctl(encoder_, OPUS_SET_DTX(config.dtx ? 1 : 0)), "dtx");
+        ctl(opus_encoder_ctl(encoder_, OPUS_SET_INBAND_FEC(config.inband_fec ? 1 : 0)), "inband_fec");
+        ctl(opus_encoder_ctl(encoder_, OPUS_SET_PACKET_LOSS_PERC(config.packet_loss_perc)),
+            "packet_loss_perc");
+        ctl(opus_encoder_ctl(encoder_, OPUS_SET_SIGNAL(config.signal)), "signal");
+        ctl(opus_encoder_ctl(encoder_, OPUS_SET_MAX_BANDWIDTH(config.max_bandwidth)), "max_bandwidth");
+        config_ = config;
+        return ok;
+    }
+
+    const OpusEncoderConfig& Config() const { return config_; }
+
+    // 编码器前瞻（每声道样本数），写入 Ogg/Opus 的 pre-skip
+    int Lookahead() const {
+        opus_int32 lookahead = 0;
+        if (encoder_ == nullptr || opus_encoder_ctl(encoder_, OPUS_GET_LOOKAHEAD(&lookahead)) != OPUS_OK) {
+            return 0;
+        }
+        return lookahead;
+    }
+
+    // 清空编码状态（保留参数），下一帧不再依赖之前的音频，用于换会话时复用编码器
+    bool Reset() {
+        if (encoder_ == nullptr) {
+            return false;
+        }
+        int ret = opus_encoder_ctl(encoder_, OPUS_RESET_STATE);
+        if (ret != OPUS_OK) {
+            WARN("opus_encoder_ctl reset failed: {}", opus_strerror(ret));
+            return false;
+        }
+        return true;
+    }
+
+private:
+    // 编码器状态由 libopus 按声道数一次性分配，计入 MemoryTag::Codec
+    void Destroy() {
+        if (encoder_ != nullptr) {
+            opus_encoder_destroy(encoder_);
+            AccountMemory(MemoryTag::Codec, -opus_encoder_get_size(channels_));
+            encoder_ = nullptr;
+        }
+    }
+
+    OpusEncoder* encoder_ = nullptr;
+    unsigned int sample_rate_ = 16000;
+    int channels_ = 1;
+    int error_ = OPUS_OK;
+    OpusEncoderConfig config_;
+};
+
+// Opus 解码器状态（RAII）：独占一个 libopus 解码器和 DecodeInto 用的暂存区，只能移动不能拷贝。
+// 不做加锁，同一时刻只应由一个线程使用；解码与丢包隐藏在不同线程上调用时由调用方加锁。
+// 创建失败时 Valid() 为 false，之后的解码调用返回 OPUS_INVALID_STATE；所有错误以负的错误码返回，不退出进程
+class OpusDecoderCtx {
 public:
-    // 检查Opus函数调用的返回值
-    void check_opus_error(int err, const char* message) {
-        if (err < 0) {
-            fprintf(stderr, "%s: %s\n", message, opus_strerror(err));
-            exit(EXIT_FAILURE);
+    OpusDecoderCtx() = default;
+    OpusDecoderCtx(unsigned int sample_rate, int channels) : sample_rate_(sample_rate), channels_(channels) {
+        decoder_ = opus_decoder_create(sample_rate, channels, &error_);
+        if (error_ != OPUS_OK || decoder_ == nullptr) {
+            ERROR("Failed to create Opus decoder ({}Hz, {}ch): {}", sample_rate, channels, opus_strerror(error_));
+            decoder_ = nullptr;
+            return;
+        }
+        AccountMemory(MemoryTag::Codec, opus_decoder_get_size(channels));
+        // 最长 120ms 一包，仅在目标区域环绕时使用
+        decode_scratch_.resize(MaxFrameSamples() * channels);
+    }
+
+    ~OpusDecoderCtx() { Destroy(); }
+
+    OpusDecoderCtx(const OpusDecoderCtx&) = delete;
+    OpusDecoderCtx& operator=(const OpusDecoderCtx&) = delete;
+
+    OpusDecoderCtx(OpusDecoderCtx&& other) noexcept { *this = std::move(other); }
+    OpusDecoderCtx& operator=(OpusDecoderCtx&& other) noexcept {
+        if (this != &other) {
+            Destroy();
+            decoder_ = other.decoder_;
+            other.decoder_ = nullptr;
+            sample_rate_ = other.sample_rate_;
+            channels_ = other.channels_;
+            error_ = other.error_;
+            decode_scratch_ = std::move(other.decode_scratch_);
+        }
+        return *this;
+    }
+
+    bool Valid() const { return decoder_ != nullptr; }
+    // 创建时的错误码（OPUS_OK 表示成功）
+    int Error() const { return error_; }
+    unsigned int SampleRate() const { return sample_rate_; }
+    int Channels() const { return channels_; }
+    // 底层句柄，用于本类未封装的 opus_decoder_ctl；无效时为 nullptr
+    OpusDecoder* Handle() const { return decoder_; }
+
+    // 单个 Opus 包最多解码出的样本数（每声道，120ms）
+    size_t MaxFrameSamples() const { return sample_rate_ * 120 / 1000; }
+
+    // 指定帧时长对应的样本数（每声道）
+    size_t FrameSamples(int ms) const { return static_cast<size_t>(sample_rate_) * ms / 1000; }
+
+    // 解码器可以直接输出的采样率：与流的编码采样率无关，解码器内部完成转换
+    static constexpr bool IsSupportedRate(unsigned int rate) {
+        return rate == 8000 || rate == 12000 || rate == 16000 || rate == 24000 || rate == 48000;
+    }
+
+    // 一个 Opus 包（可能包含多帧）解码后的样本数（每声道），包无效时返回负的错误码
+    int PacketSamples(const unsigned char* opus_data, size_t opus_size) const {
+        return opus_packet_get_nb_samples(opus_data, opus_size, sample_rate_);
+    }
+
+    // 解码一个包到 pcm_data（最多 pcm_size 个每声道样本），返回解码出的样本数，失败返回负的错误码
+    int Decode(opus_int16* pcm_data, size_t pcm_size, const unsigned char* opus_data, size_t opus_size) {
+        LINX_PROBE_SCOPE(opus_decode, opus_size);
+        if (decoder_ == nullptr) {
+            return OPUS_INVALID_STATE;
+        }
+        int n = opus_decode(decoder_, opus_data, static_cast<opus_int32>(opus_size), pcm_data,
+                            static_cast<int>(pcm_size), 0);
+        if (n < 0) {
+            WARN("Opus decode failed: {}", opus_strerror(n));
         }
+        return n;
     }
 
+    // float32 版本（满幅为 [-1, 1)，不饱和）：解码结果直接交给浮点混音 / WriteFloat，不经过 int16
+    int Decode(float* pcm_data, size_t pcm_size, const unsigned char* opus_data, size_t opus_size) {
+        LINX_PROBE_SCOPE(opus_decode, opus_size);
+        if (decoder_ == nullptr) {
+            return OPUS_INVALID_STATE;
+        }
+        int n = opus_decode_float(decoder_, opus_data, static_cast<opus_int32>(opus_size), pcm_data,
+                                  static_cast<int>(pcm_size), 0);
+        if (n < 0) {
+            WARN("Opus decode failed: {}", opus_strerror(n));
+        }
+        return n;
+    }
+
+    // 带元数据的解码：Opus 包解码进 pool 中的一帧，继承时间戳、序号和标志。
+    // 包损坏、帧容量放不下这个包或池已空时返回空帧（调用方可改用 DecodeMissing 补帧）
+    MediaFrame Decode(const MediaFrame& packet, FramePool& pool) {
+        if (decoder_ == nullptr || !packet || packet.kind != MediaKind::Opus) {
+            return MediaFrame();
+        }
+        LINX_PROBE_SCOPE(opus_decode, packet.size);
+        int frames = opus_decoder_get_nb_samples(decoder_, packet.Bytes(), static_cast<opus_int32>(packet.size));
+        if (frames <= 0 || static_cast<size_t>(frames) * channels_ > pool.FrameSamples()) {
+            return MediaFrame();
+        }
+        FrameRef ref = pool.Acquire();
+        if (!ref) {
+            return MediaFrame();
+        }
+        int decoded = opus_decode(decoder_, packet.Bytes(), static_cast<opus_int32>(packet.size), ref->data, frames, 0);
+        if (decoded <= 0) {
+            return MediaFrame();
+        }
+        ref->samples = static_cast<size_t>(decoded) * channels_;
+        MediaFrame pcm = MediaFrame::FromPool(MediaKind::Pcm, std::move(ref), static_cast<size_t>(decoded) * channels_);
+        pcm.sample_rate = sample_rate_;
+        pcm.channels = channels_;
+        pcm.InheritFrom(packet);
+        return pcm;
+    }
+
+    // 直接解码进播放缓冲区（PcmRing/JitterBuffer 等提供 WriteRegion/CommitWrite/Write 的对象）：
+    // 从 sink 借用一段连续可写区域，解码后只提交实际解码出的样本，TTS 帧只写一次内存。
+    // 包长由 PacketSamples 预先确定，支持 2.5～120ms 及多帧包；区域环绕或空间不足一包时
+    // 退回到内部暂存区，再用一次 Write 拷贝（解码器状态保持连续）。
+    // 返回解码出的样本数（每声道），失败返回负值。
+    template <typename Sink>
+    int DecodeInto(Sink& sink, const unsigned char* opus_data, size_t opus_size) {
+        LINX_PROBE_SCOPE(opus_decode, opus_size);
+        if (decoder_ == nullptr) {
+            return OPUS_INVALID_STATE;
+        }
+        int frame = PacketSamples(opus_data, opus_size);
+        if (frame <= 0 || static_cast<size_t>(frame) > MaxFrameSamples()) {
+            WARN("Invalid Opus packet: {}", opus_strerror(frame));
+            return frame;
+        }
+
+        size_t contiguous = 0;
+        short* region = sink.WriteRegion(&contiguous);
+        if (contiguous >= static_cast<size_t>(frame) * channels_) {
+            int n = opus_decode(decoder_, opus_data, opus_size, region, frame, 0);
+            if (n < 0) {
+                WARN("Opus decode failed: {}", opus_strerror(n));
+                return n;
+            }
+            sink.CommitWrite(static_cast<size_t>(n) * channels_);
+            return n;
+        }
+
+        int n = opus_decode(decoder_, opus_data, opus_size, decode_scratch_.data(), MaxFrameSamples(), 0);
+        if (n < 0) {
+            WARN("Opus decode failed: {}", opus_strerror(n));
+            return n;
+        }
+        sink.Write(decode_scratch_.data(), static_cast<size_t>(n) * channels_);
+        return n;
+    }
+
+    // 丢包隐藏（PLC）：当前帧缺失时由解码器外推生成 pcm_size 个样本，
+    // pcm_size 须为 2.5ms 的整数倍；返回生成的样本数，失败返回负的错误码
+    int DecodeMissing(opus_int16* pcm_data, size_t pcm_size) {
+        LINX_PROBE_SCOPE(opus_plc, pcm_size);
+        if (decoder_ == nullptr) {
+            return OPUS_INVALID_STATE;
+        }
+        int n = opus_decode(decoder_, nullptr, 0, pcm_data, pcm_size, 0);
+        if (n < 0) {
+            WARN("Opus PLC failed: {}", opus_strerror(n));
+        }
+        return n;
+    }
+
+    int DecodeMissing(float* pcm_data, size_t pcm_size) {
+        LINX_PROBE_SCOPE(opus_plc, pcm_size);
+        if (decoder_ == nullptr) {
+            return OPUS_INVALID_STATE;
+        }
+        int n = opus_decode_float(decoder_, nullptr, 0, pcm_data, static_cast<int>(pcm_size), 0);
+        if (n < 0) {
+            WARN("Opus PLC failed: {}", opus_strerror(n));
+        }
+        return n;
+    }
+
+    // FEC 恢复：用下一包携带的带内冗余恢复上一帧（缺失帧时长为 pcm_size）。
+    // 下一包不含 FEC 数据时退化为 PLC。恢复后仍需照常 Decode 下一包本身。
+    int DecodeFec(opus_int16* pcm_data, size_t pcm_size, const unsigned char* next_packet,
+                  size_t next_size) {
+        LINX_PROBE_SCOPE(opus_fec, next_size);
+        if (decoder_ == nullptr) {
+            return OPUS_INVALID_STATE;
+        }
+        if (next_packet == nullptr || next_size == 0 ||
+            opus_packet_has_lbrr(next_packet, next_size) <= 0) {
+            return DecodeMissing(pcm_data, pcm_size);
+        }
+        int n = opus_decode(decoder_, next_packet, next_size, pcm_data, pcm_size, 1);
+        if (n < 0) {
+            WARN("Opus FEC decode failed: {}", opus_strerror(n));
+            return DecodeMissing(pcm_data, pcm_size);
+        }
+        return n;
+    }
+
+    // 清空解码器状态（打断播放后、换会话复用时调用），下一包不会再与被丢弃的音频做重叠平滑或 PLC 外推
+    bool Reset() {
+        if (decoder_ == nullptr) {
+            return false;
+        }
+        int ret = opus_decoder_ctl(decoder_, OPUS_RESET_STATE);
+        if (ret != OPUS_OK) {
+            WARN("opus_decoder_ctl reset failed: {}", opus_strerror(ret));
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void Destroy() {
+        if (decoder_ != nullptr) {
+            opus_decoder_destroy(decoder_);
+            AccountMemory(MemoryTag::Codec, -opus_decoder_get_size(channels_));
+            decoder_ = nullptr;
+        }
+    }
+
+    OpusDecoder* decoder_ = nullptr;
+    unsigned int sample_rate_ = 16000;
+    int channels_ = 1;
+    int error_ = OPUS_OK;
+    std::vector<opus_int16, TaggedAllocator<opus_int16, MemoryTag::Codec>> decode_scratch_;
+};
+
+// 一个编码器加一个解码器的组合，便于单线程的工具（格式转换、基准测试）一次创建两者。
+// 采集与播放分属不同线程时应分别持有 OpusEncoderCtx / OpusDecoderCtx，由 Encoder() / Decoder() 取出的也是同一份状态
+class OpusAudio {
 public:
-    OpusEncoder* encoder_;
-    OpusDecoder* decoder_;
+    OpusAudio(unsigned int sample_rate, int channels)
+        : OpusAudio(sample_rate, channels, OpusEncoderConfig()) {}
+
+    OpusAudio(unsigned int sample_rate, int channels, const OpusEncoderConfig& config)
+        : sample_rate_(sample_rate), encoder_(sample_rate, channels, config), decoder_(sample_rate, channels) {}
+
+    // 编码器和解码器都创建成功
+    bool Valid() const { return encoder_.Valid() && decoder_.Valid(); }
+
+    OpusEncoderCtx& Encoder() { return encoder_; }
+    OpusDecoderCtx& Decoder() { return decoder_; }
+
+    // 单个 Opus 包最多解码出的样本数（每声道，120ms）
+    size_t MaxFrameSamples() const { return decoder_.MaxFrameSamples(); }
+
+    int Encode(unsigned char* opus_data, size_t opus_size, const opus_int16* pcm_data, size_t pcm_size) {
+        return encoder_.Encode(opus_data, opus_size, pcm_data, pcm_size);
+    }
+    int Encode(unsigned char* opus_data, size_t opus_size, const float* pcm_data, size_t pcm_size) {
+        return encoder_.Encode(opus_data, opus_size, pcm_data, pcm_size);
+    }
+
+    template <typename Format>
+    int EncodeFrame(unsigned char* opus_data, size_t opus_size, const typename Format::Frame& frame) {
+        return encoder_.EncodeFrame<Format>(opus_data, opus_size, frame);
+    }
+
+    int Decode(opus_int16* pcm_data, size_t pcm_size, const unsigned char* opus_data, size_t opus_size) {
+        return decoder_.Decode(pcm_data, pcm_size, opus_data, opus_size);
+    }
+    int Decode(float* pcm_data, size_t pcm_size, const unsigned char* opus_data, size_t opus_size) {
+        return decoder_.Decode(pcm_data, pcm_size, opus_data, opus_size);
+    }
+
+    MediaFrame Encode(const MediaFrame& pcm, FramePool& pool) { return encoder_.Encode(pcm, pool); }
+    MediaFrame Decode(const MediaFrame& packet, FramePool& pool) { return decoder_.Decode(packet, pool); }
+
+    static constexpr bool IsValidFrameDuration(int ms) { return OpusEncoderCtx::IsValidFrameDuration(ms); }
+
+    // 指定帧时长对应的样本数（每声道）
+    size_t FrameSamples(int ms) const { return static_cast<size_t>(sample_rate_) * ms / 1000; }
+
+    int PacketSamples(const unsigned char* opus_data, size_t opus_size) const {
+        return decoder_.PacketSamples(opus_data, opus_size);
+    }
+
+    template <typename Sink>
+    int DecodeInto(Sink& sink, const unsigned char* opus_data, size_t opus_size) {
+        return decoder_.DecodeInto(sink, opus_data, opus_size);
+    }
+
+    int DecodeMissing(opus_int16* pcm_data, size_t pcm_size) { return decoder_.DecodeMissing(pcm_data, pcm_size); }
+    int DecodeMissing(float* pcm_data, size_t pcm_size) { return decoder_.DecodeMissing(pcm_data, pcm_size); }
+
+    int DecodeFec(opus_int16* pcm_data, size_t pcm_size, const unsigned char* next_packet, size_t next_size) {
+        return decoder_.DecodeFec(pcm_data, pcm_size, next_packet, next_size);
+    }
+
+    void ResetDecoder() { decoder_.Reset(); }
+
+    bool ApplyEncoderConfig(const OpusEncoderConfig& config) { return encoder_.ApplyConfig(config); }
+    const OpusEncoderConfig& EncoderConfig() const { return encoder_.Config(); }
+    int Lookahead() const { return encoder_.Lookahead(); }
+
+private:
+    unsigned int sample_rate_ = 16000;
+    OpusEncoderCtx encoder_;
+    OpusDecoderCtx decoder_;
 };
 
 }  // namespace linx
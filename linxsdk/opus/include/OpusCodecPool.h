@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "LockProfiler.h"
+#include "Opus.h"
+
+namespace linx {
+
+struct OpusCodecPoolStats {
+    uint64_t created = 0;        // 新建的编码器/解码器
+    uint64_t reused = 0;         // 从空闲列表取出复用的
+    uint64_t discarded = 0;      // 归还时空闲列表已满或复位失败而销毁的
+    size_t idle_encoders = 0;
+    size_t idle_decoders = 0;
+};
+
+// 编解码器状态池：会话结束时归还编码器/解码器，下一个同格式的会话取出后复位状态直接使用，
+// 省去 opus_encoder_create / opus_decoder_create 的分配和初始化（压测工具、多连接时每个会话各持一份）。
+// 编码器按 (采样率, 声道, application) 匹配，取出后重新应用调用方的参数；解码器按 (采样率, 声道) 匹配。
+// 池本身线程安全，取出的状态由调用方独占，不与其他线程共享
+class OpusCodecPool {
+public:
+    // max_idle：每类空闲状态最多保留的个数，超出的在归还时销毁
+    explicit OpusCodecPool(size_t max_idle = 8) : max_idle_(max_idle) {}
+
+    OpusCodecPool(const OpusCodecPool&) = delete;
+    OpusCodecPool& operator=(const OpusCodecPool&) = delete;
+
+    // 创建失败时返回无效的状态（Valid() 为 false）
+    OpusEncoderCtx AcquireEncoder(unsigned int sample_rate, int channels,
+                                  const OpusEncoderConfig& config = OpusEncoderConfig());
+    OpusDecoderCtx AcquireDecoder(unsigned int sample_rate, int channels);
+
+    // 复位状态后放回空闲列表；无效的状态直接丢弃
+    void Release(OpusEncoderCtx&& encoder);
+    void Release(OpusDecoderCtx&& decoder);
+
+    // 销毁所有空闲状态
+    void Clear();
+
+    OpusCodecPoolStats GetStats() const;
+
+private:
+    size_t max_idle_;
+
+    mutable ProfiledMutex mutex_{"opus_codec_pool"};
+    std::vector<OpusEncoderCtx> encoders_;
+    std::vector<OpusDecoderCtx> decoders_;
+    uint64_t created_ = 0;
+    uint64_t reused_ = 0;
+    uint64_t discarded_ = 0;
+};
+
+}  // namespace linx
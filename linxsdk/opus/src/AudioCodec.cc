@@ -0,0 +1,397 @@
+#include "AudioCodec.h"
+
+#include <cstring>
+
+namespace linx {
+
+namespace {
+
+const int kImaStepTable[89] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,    25,    28,
+    31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,   337,   371,   408,   449,   494,
+    544,   598,   658,   724,   796,   876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,
+    9493,  10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+const int kImaIndexTable[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+
+int Clamp(int v, int lo, int hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+// 按 4 位码更新预测值和步长索引，返回新的预测值
+int ImaStep(int code, int* predictor, int* index) {
+    int step = kImaStepTable[*index];
+    int delta = step >> 3;
+    if (code & 4) {
+        delta += step;
+    }
+    if (code & 2) {
+        delta += step >> 1;
+    }
+    if (code & 1) {
+        delta += step >> 2;
+    }
+    *predictor = Clamp(*predictor + ((code & 8) ? -delta : delta), -32768, 32767);
+    *index = Clamp(*index + kImaIndexTable[code], 0, 88);
+    return *predictor;
+}
+
+int ImaEncodeSample(int sample, int* predictor, int* index) {
+    int step = kImaStepTable[*index];
+    int diff = sample - *predictor;
+    int code = 0;
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+    if (diff >= step) {
+        code |= 4;
+        diff -= step;
+    }
+    if (diff >= step >> 1) {
+        code |= 2;
+        diff -= step >> 1;
+    }
+    if (diff >= step >> 2) {
+        code |= 1;
+    }
+    ImaStep(code, predictor, index);
+    return code;
+}
+
+// 流声道 -> 输出声道：单声道复制到各声道，多声道到单声道取平均，其余按声道号对应（多出的丢弃、缺少的重复最后一个）
+void MapChannels(const short* in, int in_channels, short* out, int out_channels, size_t frames) {
+    for (size_t f = 0; f < frames; ++f) {
+        const short* src = in + f * in_channels;
+        short* dst = out + f * out_channels;
+        if (out_channels == 1) {
+            int sum = 0;
+            for (int c = 0; c < in_channels; ++c) {
+                sum += src[c];
+            }
+            dst[0] = static_cast<short>(sum / in_channels);
+        } else {
+            for (int c = 0; c < out_channels; ++c) {
+                dst[c] = src[std::min(c, in_channels - 1)];
+            }
+        }
+    }
+}
+
+}  // namespace
+
+OpusAudioEncoder::OpusAudioEncoder(const AudioCodecConfig& config) {
+    OpusEncoderConfig opus = config.opus;
+    if (config.bitrate > 0) {
+        opus.bitrate = config.bitrate;
+    }
+    if (config.complexity >= 0) {
+        opus.complexity = config.complexity;
+    }
+    owned_ = std::make_unique<OpusEncoderCtx>(config.sample_rate, config.channels, opus);
+    encoder_ = owned_.get();
+}
+
+bool OpusAudioEncoder::SetBitrate(int bps) {
+    OpusEncoderConfig config = encoder_->Config();
+    config.bitrate = bps;
+    return encoder_->ApplyConfig(config);
+}
+
+bool OpusAudioEncoder::SetComplexity(int complexity) {
+    OpusEncoderConfig config = encoder_->Config();
+    config.complexity = Clamp(complexity, 0, 10);
+    return encoder_->ApplyConfig(config);
+}
+
+OpusAudioDecoder::OpusAudioDecoder(unsigned int sample_rate, int channels) : decoder_(sample_rate, channels) {
+    AllocateScratch(decoder_.MaxFrameSamples() * std::max(1, channels));
+}
+
+int Pcm16Encoder::Encode(unsigned char* out, size_t out_size, const short* pcm, size_t frames) {
+    size_t samples = frames * channels_;
+    if (out_size < samples * 2) {
+        return -1;
+    }
+    for (size_t i = 0; i < samples; ++i) {
+        uint16_t v = static_cast<uint16_t>(pcm[i]);
+        out[2 * i] = static_cast<unsigned char>(v & 0xff);
+        out[2 * i + 1] = static_cast<unsigned char>(v >> 8);
+    }
+    return static_cast<int>(samples * 2);
+}
+
+Pcm16Decoder::Pcm16Decoder(unsigned int sample_rate, int channels, int stream_channels)
+    : sample_rate_(sample_rate),
+      channels_(std::max(1, channels)),
+      stream_channels_(stream_channels > 0 ? stream_channels : std::max(1, channels)) {
+    AllocateScratch(MaxFrameSamples() * channels_);
+}
+
+int Pcm16Decoder::PacketSamples(const unsigned char*, size_t len) const {
+    size_t frame_bytes = static_cast<size_t>(stream_channels_) * 2;
+    if (len == 0 || len % frame_bytes != 0) {
+        return -1;
+    }
+    return static_cast<int>(len / frame_bytes);
+}
+
+int Pcm16Decoder::Decode(short* pcm, size_t frames, const unsigned char* data, size_t len) {
+    int n = PacketSamples(data, len);
+    if (n <= 0 || static_cast<size_t>(n) > frames) {
+        return -1;
+    }
+    // 逐帧转换：每帧最多 8 个流声道先解出到栈上，再映射到输出声道
+    short in[8];
+    int in_channels = std::min(stream_channels_, 8);
+    for (int f = 0; f < n; ++f) {
+        const unsigned char* src = data + static_cast<size_t>(f) * stream_channels_ * 2;
+        for (int c = 0; c < in_channels; ++c) {
+            in[c] = static_cast<short>(static_cast<uint16_t>(src[2 * c] | (src[2 * c + 1] << 8)));
+        }
+        if (in_channels == channels_) {
+            memcpy(pcm + static_cast<size_t>(f) * channels_, in, sizeof(short) * channels_);
+        } else {
+            MapChannels(in, in_channels, pcm + static_cast<size_t>(f) * channels_, channels_, 1);
+        }
+    }
+    return n;
+}
+
+int Pcm16Decoder::DecodeMissing(short* pcm, size_t frames) {
+    memset(pcm, 0, frames * channels_ * sizeof(short));
+    return static_cast<int>(frames);
+}
+
+ImaAdpcmEncoder::ImaAdpcmEncoder(const AudioCodecConfig& config)
+    : sample_rate_(config.sample_rate), channels_(std::max(1, config.channels)), state_(channels_) {}
+
+bool ImaAdpcmEncoder::Reset() {
+    std::fill(state_.begin(), state_.end(), State());
+    return true;
+}
+
+int ImaAdpcmEncoder::Encode(unsigned char* out, size_t out_size, const short* pcm, size_t frames) {
+    size_t nibbles = frames * channels_;
+    size_t bytes = MaxPacketBytes(frames);
+    if (frames == 0 || out_size < bytes) {
+        return -1;
+    }
+    // 包头是本包开始时的编码器状态，解码端从这里开始，不依赖之前的包
+    for (int c = 0; c < channels_; ++c) {
+        unsigned char* header = out + c * kHeaderBytes;
+        uint16_t predictor = static_cast<uint16_t>(static_cast<int16_t>(state_[c].predictor));
+        header[0] = static_cast<unsigned char>(predictor & 0xff);
+        header[1] = static_cast<unsigned char>(predictor >> 8);
+        header[2] = static_cast<unsigned char>(state_[c].index);
+        header[3] = 0;
+    }
+    out[3] = (nibbles & 1) ? 1 : 0;
+    unsigned char* body = out + kHeaderBytes * channels_;
+    for (size_t i = 0; i < nibbles; ++i) {
+        State& s = state_[i % channels_];
+        int code = ImaEncodeSample(pcm[i], &s.predictor, &s.index);
+        if (i & 1) {
+            body[i / 2] |= static_cast<unsigned char>(code << 4);
+        } else {
+            body[i / 2] = static_cast<unsigned char>(code);
+        }
+    }
+    return static_cast<int>(bytes);
+}
+
+ImaAdpcmDecoder::ImaAdpcmDecoder(unsigned int sample_rate, int channels, int stream_channels)
+    : sample_rate_(sample_rate),
+      channels_(std::max(1, channels)),
+      stream_channels_(stream_channels > 0 ? stream_channels : std::max(1, channels)) {
+    AllocateScratch(MaxFrameSamples() * channels_);
+    if (stream_channels_ != channels_) {
+        frame_.assign(MaxFrameSamples() * stream_channels_, 0);
+    }
+}
+
+int ImaAdpcmDecoder::PacketSamples(const unsigned char* data, size_t len) const {
+    size_t header = ImaAdpcmEncoder::kHeaderBytes * stream_channels_;
+    if (len <= header) {
+        return -1;
+    }
+    size_t nibbles = (len - header) * 2 - (data[3] != 0 ? 1 : 0);
+    if (nibbles % stream_channels_ != 0) {
+        return -1;
+    }
+    return static_cast<int>(nibbles / stream_channels_);
+}
+
+int ImaAdpcmDecoder::Decode(short* pcm, size_t frames, const unsigned char* data, size_t len) {
+    int n = PacketSamples(data, len);
+    if (n <= 0 || static_cast<size_t>(n) > frames || static_cast<size_t>(n) > MaxFrameSamples()) {
+        return -1;
+    }
+    int predictor[8];
+    int index[8];
+    if (stream_channels_ > 8) {
+        return -1;
+    }
+    for (int c = 0; c < stream_channels_; ++c) {
+        const unsigned char* header = data + c * ImaAdpcmEncoder::kHeaderBytes;
+        predictor[c] = static_cast<int16_t>(static_cast<uint16_t>(header[0] | (header[1] << 8)));
+        index[c] = Clamp(header[2], 0, 88);
+    }
+    short* dst = stream_channels_ == channels_ ? pcm : frame_.data();
+    const unsigned char* body = data + ImaAdpcmEncoder::kHeaderBytes * stream_channels_;
+    size_t nibbles = static_cast<size_t>(n) * stream_channels_;
+    for (size_t i = 0; i < nibbles; ++i) {
+        int c = static_cast<int>(i % stream_channels_);
+        int code = (i & 1) ? body[i / 2] >> 4 : body[i / 2] & 0x0f;
+        dst[i] = static_cast<short>(ImaStep(code, &predictor[c], &index[c]));
+    }
+    if (dst != pcm) {
+        MapChannels(dst, stream_channels_, pcm, channels_, static_cast<size_t>(n));
+    }
+    return n;
+}
+
+int ImaAdpcmDecoder::DecodeMissing(short* pcm, size_t frames) {
+    memset(pcm, 0, frames * channels_ * sizeof(short));
+    return static_cast<int>(frames);
+}
+
+CodecRegistry& CodecRegistry::Instance() {
+    static CodecRegistry registry;
+    return registry;
+}
+
+CodecRegistry::CodecRegistry() {
+    CodecInfo opus;
+    opus.format = kFormatOpus;
+    opus.description = "Opus (libopus), 6~510 kbps";
+    opus.cpu_cost = 100;
+    opus.any_decode_rate = true;
+    opus.create_encoder = [](const AudioCodecConfig& config) -> std::unique_ptr<AudioEncoder> {
+        return std::make_unique<OpusAudioEncoder>(config);
+    };
+    opus.create_decoder = [](unsigned int rate, int channels, int) -> std::unique_ptr<AudioDecoder> {
+        return std::make_unique<OpusAudioDecoder>(rate, channels);
+    };
+    codecs_.push_back(std::move(opus));
+
+    CodecInfo pcm;
+    pcm.format = kFormatPcm16;
+    pcm.description = "16-bit little-endian PCM, uncompressed";
+    pcm.cpu_cost = 1;
+    pcm.create_encoder = [](const AudioCodecConfig& config) -> std::unique_ptr<AudioEncoder> {
+        return std::make_unique<Pcm16Encoder>(config);
+    };
+    pcm.create_decoder = [](unsigned int rate, int channels, int stream_channels) -> std::unique_ptr<AudioDecoder> {
+        return std::make_unique<Pcm16Decoder>(rate, channels, stream_channels);
+    };
+    codecs_.push_back(std::move(pcm));
+
+    CodecInfo adpcm;
+    adpcm.format = kFormatImaAdpcm;
+    adpcm.description = "IMA-ADPCM, 4 bits per sample";
+    adpcm.cpu_cost = 3;
+    adpcm.create_encoder = [](const AudioCodecConfig& config) -> std::unique_ptr<AudioEncoder> {
+        return std::make_unique<ImaAdpcmEncoder>(config);
+    };
+    adpcm.create_decoder = [](unsigned int rate, int channels, int stream_channels) -> std::unique_ptr<AudioDecoder> {
+        return std::make_unique<ImaAdpcmDecoder>(rate, channels, stream_channels);
+    };
+    codecs_.push_back(std::move(adpcm));
+}
+
+const CodecInfo* CodecRegistry::FindLocked(std::string_view format) const {
+    for (const CodecInfo& info : codecs_) {
+        if (info.format == format) {
+            return &info;
+        }
+    }
+    return nullptr;
+}
+
+bool CodecRegistry::Register(CodecInfo info) {
+    if (info.format.empty() || !info.create_encoder || !info.create_decoder) {
+        return false;
+    }
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    for (CodecInfo& existing : codecs_) {
+        if (existing.format == info.format) {
+            existing = std::move(info);
+            return true;
+        }
+    }
+    codecs_.push_back(std::move(info));
+    return true;
+}
+
+bool CodecRegistry::Has(std::string_view format) const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    return FindLocked(format) != nullptr;
+}
+
+std::vector<std::string> CodecRegistry::Formats() const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    std::vector<std::string> formats;
+    for (const CodecInfo& info : codecs_) {
+        formats.push_back(info.format);
+    }
+    return formats;
+}
+
+std::string CodecRegistry::FormatList(std::string_view preferred) const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    std::string list;
+    if (FindLocked(preferred) != nullptr) {
+        list = std::string(preferred);
+    }
+    for (const CodecInfo& info : codecs_) {
+        if (info.format != preferred) {
+            list += (list.empty() ? "" : ",") + info.format;
+        }
+    }
+    return list;
+}
+
+bool CodecRegistry::AnyDecodeRate(std::string_view format) const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    const CodecInfo* info = FindLocked(format);
+    return info != nullptr && info->any_decode_rate;
+}
+
+std::unique_ptr<AudioEncoder> CodecRegistry::CreateEncoder(std::string_view format,
+                                                           const AudioCodecConfig& config) const {
+    std::function<std::unique_ptr<AudioEncoder>(const AudioCodecConfig&)> create;
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        const CodecInfo* info = FindLocked(format);
+        if (info == nullptr) {
+            return nullptr;
+        }
+        create = info->create_encoder;
+    }
+    std::unique_ptr<AudioEncoder> encoder = create(config);
+    if (!encoder || !encoder->Valid()) {
+        return nullptr;
+    }
+    return encoder;
+}
+
+std::unique_ptr<AudioDecoder> CodecRegistry::CreateDecoder(std::string_view format, unsigned int sample_rate,
+                                                           int channels, int stream_channels) const {
+    std::function<std::unique_ptr<AudioDecoder>(unsigned int, int, int)> create;
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        const CodecInfo* info = FindLocked(format);
+        if (info == nullptr) {
+            return nullptr;
+        }
+        create = info->create_decoder;
+    }
+    std::unique_ptr<AudioDecoder> decoder = create(sample_rate, channels, stream_channels);
+    if (!decoder || !decoder->Valid()) {
+        return nullptr;
+    }
+    return decoder;
+}
+
+}  // namespace linx
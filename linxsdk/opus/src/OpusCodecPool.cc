@@ -0,0 +1,93 @@
+#include "OpusCodecPool.h"
+
+#include <utility>
+
+namespace linx {
+
+OpusEncoderCtx OpusCodecPool::AcquireEncoder(unsigned int sample_rate, int channels,
+                                             const OpusEncoderConfig& config) {
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        for (auto it = encoders_.begin(); it != encoders_.end(); ++it) {
+            if (it->SampleRate() == sample_rate && it->Channels() == channels &&
+                it->Config().application == config.application) {
+                OpusEncoderCtx encoder = std::move(*it);
+                encoders_.erase(it);
+                reused_++;
+                encoder.ApplyConfig(config);  // 复位只清编码状态，参数按本次会话重新设置
+                return encoder;
+            }
+        }
+        created_++;
+    }
+    return OpusEncoderCtx(sample_rate, channels, config);
+}
+
+OpusDecoderCtx OpusCodecPool::AcquireDecoder(unsigned int sample_rate, int channels) {
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        for (auto it = decoders_.begin(); it != decoders_.end(); ++it) {
+            if (it->SampleRate() == sample_rate && it->Channels() == channels) {
+                OpusDecoderCtx decoder = std::move(*it);
+                decoders_.erase(it);
+                reused_++;
+                return decoder;
+            }
+        }
+        created_++;
+    }
+    return OpusDecoderCtx(sample_rate, channels);
+}
+
+void OpusCodecPool::Release(OpusEncoderCtx&& encoder) {
+    OpusEncoderCtx owned = std::move(encoder);  // 调用方的对象此后为空，未缓存的状态在这里销毁
+    if (!owned.Valid()) {
+        return;
+    }
+    // 复位在锁外进行，不阻塞其他会话取用
+    bool reset = owned.Reset();
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    if (!reset || encoders_.size() >= max_idle_) {
+        discarded_++;
+        return;
+    }
+    encoders_.push_back(std::move(owned));
+}
+
+void OpusCodecPool::Release(OpusDecoderCtx&& decoder) {
+    OpusDecoderCtx owned = std::move(decoder);  // 调用方的对象此后为空，未缓存的状态在这里销毁
+    if (!owned.Valid()) {
+        return;
+    }
+    // 复位在锁外进行，不阻塞其他会话取用
+    bool reset = owned.Reset();
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    if (!reset || decoders_.size() >= max_idle_) {
+        discarded_++;
+        return;
+    }
+    decoders_.push_back(std::move(owned));
+}
+
+void OpusCodecPool::Clear() {
+    std::vector<OpusEncoderCtx> encoders;
+    std::vector<OpusDecoderCtx> decoders;
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        encoders.swap(encoders_);
+        decoders.swap(decoders_);
+    }
+}
+
+OpusCodecPoolStats OpusCodecPool::GetStats() const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    OpusCodecPoolStats stats;
+    stats.created = created_;
+    stats.reused = reused_;
+    stats.discarded = discarded_;
+    stats.idle_encoders = encoders_.size();
+    stats.idle_decoders = decoders_.size();
+    return stats;
+}
+
+}  // namespace linx
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FramePool.h"
+#include "LatencyHistogram.h"
+#include "LockProfiler.h"
+#include "MediaFrame.h"
+#include "SpscQueue.h"
+
+namespace linx {
+
+// 阶段统计
+struct PipelineStageStats {
+    uint64_t frames_in = 0;    // Process 调用次数
+    uint64_t frames_out = 0;   // Emit 的帧数
+    uint64_t copies = 0;       // 发往跨线程连接时，视图拷贝进池中帧的次数
+    uint64_t drops = 0;        // 丢弃的帧数（下游队列满、池已空，或阶段自身的失败，如编码/发送失败）
+    uint64_t expired = 0;      // 在输入队列中等待超过 StageOptions::max_age_us、未处理即丢弃的帧数
+    size_t queue_high_water = 0;  // 输入队列的最大深度（仅独立线程的阶段）
+};
+
+// 流水线阶段：子类实现 Process（处理一帧，用 Emit 交给下游），源阶段实现 Produce。
+// Process 只在一个线程上调用：独立线程的阶段在自己的工作线程上，否则在上游调用 Emit 的线程上
+class PipelineStage {
+public:
+    explicit PipelineStage(std::string name) : name_(std::move(name)) {}
+    virtual ~PipelineStage() = default;
+
+    PipelineStage(const PipelineStage&) = delete;
+    PipelineStage& operator=(const PipelineStage&) = delete;
+
+    const std::string& Name() const { return name_; }
+
+    // 处理一帧；frame 为视图时不要在返回后保留 data，需要保留时持有 frame.owner（池中的帧）
+    virtual void Process(const MediaFrame& frame) {}
+
+    // 源阶段：AudioPipeline 为它起一个线程循环调用 Produce，每次产生（Emit）零或多帧，通常由阻塞读取定节拍。
+    // 返回 false 表示源已结束，线程退出
+    virtual bool IsSource() const { return false; }
+    virtual bool Produce() { return false; }
+    // Stop 时在 join 之前调用，让阻塞在 Produce 中的源尽快返回（如唤醒等待的读取）
+    virtual void Interrupt() {}
+
+    PipelineStageStats GetStats() const;
+    // 每次 Process / Produce 自身的耗时（微秒，不含同一线程内直接调用的下游阶段），可直接注册到 MetricsRegistry
+    const LatencyHistogram& ProcessTime() const { return process_us_; }
+
+protected:
+    // 把一帧交给所有下游连接；视图只需在本次调用期间有效，跨线程的连接会自行拷贝
+    void Emit(const MediaFrame& frame);
+    // 阶段自身的失败（如编码失败）计入 drops
+    void CountDrop() { drops_.fetch_add(1, std::memory_order_relaxed); }
+
+private:
+    friend class AudioPipeline;
+
+    struct Worker;
+
+    struct Link {
+        PipelineStage* target = nullptr;
+        Worker* worker = nullptr;  // 目标有独立线程时非空，帧经 queue 交接
+        SpscQueue<MediaFrame>* queue = nullptr;
+        FramePool* pool = nullptr;
+    };
+
+    std::string name_;
+    std::vector<Link> links_;
+    LatencyHistogram process_us_;
+    std::atomic<uint64_t> frames_in_{0};
+    std::atomic<uint64_t> frames_out_{0};
+    std::atomic<uint64_t> copies_{0};
+    std::atomic<uint64_t> drops_{0};
+    std::atomic<uint64_t> expired_{0};
+    std::atomic<size_t> queue_high_water_{0};
+};
+
+// 阶段选项
+struct StageOptions {
+    // 在独立的工作线程上运行：上游经 SPSC 队列交接帧（视图会拷贝进池中的帧），上游不被本阶段的耗时阻塞。
+    // 不设置时本阶段直接在上游线程上调用，零拷贝。源阶段总有自己的线程
+    bool own_thread = false;
+    size_t queue_frames = 16;          // 每条入边的队列容量（帧）
+    std::function<void()> thread_hook;  // 工作线程启动时调用一次（调度策略、CPU 绑定等）
+    // 独立线程的阶段：取出时帧龄（MediaFrame::AgeUs，距采集时刻）超过此值的帧直接丢弃、计入 expired，
+    // 下游积压时优先追上实时而不是播出/发送过时的数据；0 不限制，没有时间戳的帧不受影响
+    uint64_t max_age_us = 0;
+};
+
+// 可组合的音频流水线：阶段按 Connect 组成有向图，源阶段各有一个线程，独立线程的阶段各有一个工作线程，
+// 其余阶段在上游线程上直接调用。每条跨线程的边一个 SPSC 队列（生产者为上游所在线程，消费者为目标的工作线程），
+// 队列满或池已空时丢弃该帧并计入上游的 drops，不阻塞上游（采集节拍不能被下游拖慢）。
+// 稳态不分配内存：队列槽位在 Start 前分配，跨线程拷贝使用构造时给出的 FramePool。
+// Add / Connect 须在 Start 之前调用，Start 之后图不可修改
+class AudioPipeline {
+public:
+    // pool 用于跨线程连接的视图拷贝，帧容量须容纳最大的一帧（PCM 样本数，或 Opus 字节数 / 2）；
+    // 为空时跨线程连接只能传递池中的帧，视图会被丢弃
+    explicit AudioPipeline(FramePool* pool = nullptr) : pool_(pool) {}
+    ~AudioPipeline();
+
+    AudioPipeline(const AudioPipeline&) = delete;
+    AudioPipeline& operator=(const AudioPipeline&) = delete;
+
+    PipelineStage* Add(std::shared_ptr<PipelineStage> stage, const StageOptions& options = StageOptions());
+    // from 的输出交给 to；一个阶段可以有多个下游（按连接顺序依次交付）和多个上游
+    void Connect(PipelineStage* from, PipelineStage* to);
+
+    void Start();
+    void Stop();
+    bool Running() const { return running_; }
+
+    void ForEachStage(const std::function<void(const PipelineStage&)>& fn) const;
+
+private:
+    friend class PipelineStage;
+
+    struct Node {
+        std::shared_ptr<PipelineStage> stage;
+        StageOptions options;
+        std::unique_ptr<PipelineStage::Worker> worker;
+        std::thread thread;
+    };
+
+    Node* Find(PipelineStage* stage);
+    void RunSource(Node* node);
+    void RunWorker(Node* node);
+
+    FramePool* pool_;
+    std::vector<std::unique_ptr<Node>> nodes_;
+    std::atomic<bool> running_{false};
+};
+
+// 独立线程阶段的输入端：每条入边一个队列，空闲时在 cv 上等待
+struct PipelineStage::Worker {
+    std::vector<std::unique_ptr<SpscQueue<MediaFrame>>> queues;
+    ProfiledMutex mutex{"pipeline_worker"};
+    ProfiledConditionVariable cv{"pipeline_worker"};
+    std::atomic<bool> sleeping{false};
+
+    void Notify();
+};
+
+}  // namespace linx
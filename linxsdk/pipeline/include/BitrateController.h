@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "Opus.h"
+
+namespace linx {
+
+// 上行拥塞信号，由发送端（通常是 WebSocketClient）提供
+struct CongestionSignals {
+    size_t queue_depth = 0;     // 发送队列中等待写出的帧数
+    double send_delay_ms = 0;   // 最近一帧从入队到写出的延迟（等待 socket 可写的时间）
+    double rtt_ms = 0;          // 平滑往返时间，0 表示未测得
+};
+
+// 自适应比特率参数
+struct BitrateControllerConfig {
+    int min_bitrate = 12000;                  // 码率下限（bps）
+    int max_bitrate = 32000;                  // 码率上限（bps），也是起始码率
+    std::chrono::milliseconds interval{500};  // 评估间隔
+    double target_delay_ms = 150;             // 发送延迟目标，超过即视为拥塞
+    size_t queue_high = 3;                    // 队列积压超过该帧数即视为拥塞
+    double rtt_margin_ms = 150;               // RTT 比测得的最小 RTT 高出该值即视为拥塞
+    double decrease = 0.75;                   // 拥塞时码率乘以该系数
+    int increase_step = 2000;                 // 连续畅通后每次上调的码率（bps）
+    int increase_hold = 4;                    // 连续多少个畅通的评估间隔后才上调
+    // FEC：码率低于 fec_min_bitrate 时关闭带内 FEC（冗余占比过高），回升后恢复基础配置
+    bool adapt_fec = true;
+    int fec_min_bitrate = 16000;
+    // 复杂度：平均编码耗时超过帧时长的 encode_budget 时逐级降低（不低于 min_complexity），
+    // 低于其一半时逐级恢复到基础配置
+    bool adapt_complexity = false;
+    int min_complexity = 2;
+    double encode_budget = 0.3;
+};
+
+struct BitrateControllerStats {
+    int bitrate = 0;          // 当前码率（bps）
+    int complexity = 0;
+    bool inband_fec = false;
+    uint64_t decreases = 0;   // 因拥塞下调的次数
+    uint64_t increases = 0;   // 畅通后上调的次数
+    uint64_t congested_intervals = 0;
+};
+
+// 拥塞控制：按评估间隔读取发送队列深度、发送延迟和 RTT，拥塞时乘性降低码率，
+// 连续畅通时加性回升（AIMD），让上行保持在延迟目标内而不是在队列里积压。
+// 只做决策不持有编码器：Update 在采集线程上每帧调用，参数变化时由调用方应用到编码器
+class BitrateController {
+public:
+    using SignalSource = std::function<CongestionSignals()>;
+
+    BitrateController(const BitrateControllerConfig& config, SignalSource source);
+
+    // base 为编码器当前（基础）配置，码率从 max_bitrate 起步
+    void Reset(const OpusEncoderConfig& base);
+
+    // encode_us 为本帧编码耗时，frame_ms 为帧时长。到达评估间隔且参数需要变化时返回 true，
+    // 并把新参数写入 config（以 base 为模板）
+    bool Update(std::chrono::steady_clock::time_point now, uint64_t encode_us, double frame_ms,
+                OpusEncoderConfig* config);
+
+    BitrateControllerStats GetStats() const;
+
+private:
+    bool Congested(const CongestionSignals& signals);
+
+    BitrateControllerConfig config_;
+    SignalSource source_;
+    OpusEncoderConfig base_;
+
+    std::chrono::steady_clock::time_point next_eval_;
+    bool started_ = false;
+    int bitrate_ = 0;
+    int complexity_ = 0;
+    bool fec_ = false;
+    int clear_intervals_ = 0;
+    double min_rtt_ms_ = 0;
+    uint64_t encode_us_total_ = 0;  // 本评估间隔内累计的编码耗时
+    uint64_t encode_frames_ = 0;
+
+    std::atomic<int> stat_bitrate_{0};
+    std::atomic<int> stat_complexity_{0};
+    std::atomic<bool> stat_fec_{false};
+    std::atomic<uint64_t> decreases_{0};
+    std::atomic<uint64_t> increases_{0};
+    std::atomic<uint64_t> congested_intervals_{0};
+};
+
+}  // namespace linx
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AudioCodec.h"
+#include "AudioInterface.h"
+#include "AutoGainController.h"
+#include "Beamformer.h"
+#include "BitrateController.h"
+#include "DeadlineWatchdog.h"
+#include "EchoCanceller.h"
+#include "FrameTrace.h"
+#include "KeywordSpotter.h"
+#include "LatencyTracer.h"
+#include "LockProfiler.h"
+#include "NoiseSuppressor.h"
+#include "Opus.h"
+#include "Vad.h"
+
+namespace linx {
+
+// 采集泵配置
+struct CapturePumpConfig {
+    unsigned int sample_rate = 16000;  // 采样率
+    int channels = 1;                  // 声道数
+    size_t frame_samples = 960;        // 每帧样本数（每声道），60ms@16kHz
+    // 编码输出缓冲区大小（Opus 为 libopus 推荐上限）；小于编码器的 MaxPacketBytes 时按后者分配
+    size_t max_packet_bytes = 4000;
+    int vad_hangover_ms = 800;         // 语音结束后继续发送的时长，保证服务端能检测到句尾静音
+    int vad_preroll_ms = 120;          // 语音起始前补发的时长，避免切掉首字
+    // 门控预录：门控关闭期间仍持续编码，最近这么长的 Opus 包保存在环中，门控打开时先一次性发出，
+    // 服务器拿到状态切换之前的语音起始（建议 200~1000ms，上限 1000ms）；0 关闭，门控关闭时不编码
+    int gate_preroll_ms = 0;
+    // 省电空闲：门控连续关闭超过这么久时暂停采集设备（AudioInterface::SuspendCapture），采集线程阻塞到
+    // Wake() 且门控打开后再恢复，期间不读设备、不编码；0 关闭。设置了唤醒词检测时不会空闲，
+    // 只对 Start() 启动的采集线程生效。空闲期间门控预录环不再更新，恢复后从空环开始
+    int idle_suspend_ms = 0;
+};
+
+// 采集泵统计
+struct CapturePumpStats {
+    uint64_t frames_read = 0;     // 成功读取的帧数
+    uint64_t read_errors = 0;     // 读取失败次数
+    uint64_t frames_gated = 0;    // 被门控挡下（未发送）的帧数，开启门控预录时这些帧仍会编码进环
+    uint64_t gate_preroll_sent = 0;  // 门控打开时从预录环补发的帧数
+    uint64_t gate_preroll_flushes = 0;  // 补发的次数（门控打开且环非空）
+    uint64_t keywords_detected = 0;  // 唤醒词命中次数
+    uint64_t kws_us = 0;          // 唤醒词检测累计耗时（微秒）
+    uint64_t frames_speech = 0;   // VAD 判为语音（含拖尾和预录）而发送的帧数
+    uint64_t frames_suppressed = 0;  // VAD 判为非语音而跳过编码发送的帧数
+    double suppressed_ratio = 0;  // frames_suppressed / (frames_speech + frames_suppressed)
+    uint64_t frames_encoded = 0;  // 编码成功的帧数
+    uint64_t encode_errors = 0;   // 编码失败次数
+    uint64_t bytes_encoded = 0;   // 编码输出的总字节数
+    uint64_t encode_us = 0;       // Encode 累计耗时（微秒，含失败的调用）
+    double period_ms = 0;         // 平滑后的实测帧周期
+    double min_period_ms = 0;     // 最短帧周期
+    double max_period_ms = 0;     // 最长帧周期
+    double capture_buffer_ms = 0;  // 平滑后的驱动缓冲延迟（硬件采集时刻到读出），后端不提供采集时间戳时为 0
+    uint64_t idle_suspends = 0;   // 进入省电空闲（暂停采集设备）的次数
+    uint64_t idle_ms = 0;         // 累计空闲时长
+    uint64_t wake_latency_us = 0;      // 最近一次从 Wake() 到恢复后读到第一帧的耗时
+    uint64_t max_wake_latency_us = 0;  // 最长的一次
+};
+
+// 采集 -> 编码 -> 发送 帧泵
+// 持有预分配的 PCM/Opus 缓冲区，仅以 AudioInterface::Read 的阻塞节奏驱动
+// （后端支持 AcquireCapture 时直接在设备 DMA 缓冲区上做 VAD 和编码），
+// 编码后的数据包通过回调交给上层（通常是 WebSocketClient::send_binary），每帧无堆分配。
+class CapturePump {
+public:
+    // 编码后数据包回调，data 只在回调期间有效
+    using PacketHandler = std::function<void(const unsigned char* data, size_t len)>;
+    // 门控回调：返回 false 时本帧只读取不编码（如未处于 listen 状态）
+    using Gate = std::function<bool()>;
+    // PCM 旁路回调：每帧回声消除、降噪和自动增益之后、门控之前调用（如会话录音），pcm 只在回调期间有效
+    using PcmTap = std::function<void(const short* pcm, size_t samples)>;
+    // 采集线程启动时在线程内调用一次，用于设置调度策略、CPU 绑定等
+    using ThreadHook = std::function<void()>;
+    // 语音起始回调：VAD 从非语音转为语音时在采集线程中调用（如用户插话时打断 TTS）
+    using SpeechStartHandler = std::function<void()>;
+    // 唤醒词回调：门控关闭期间检测器命中时在采集线程中调用，keyword 为 KeywordSpotter 返回的编号
+    using KeywordHandler = std::function<void(int keyword)>;
+
+    CapturePump(AudioInterface& audio, OpusEncoderCtx& opus,
+                const CapturePumpConfig& config = CapturePumpConfig());
+    // 任意编码器（见 AudioCodec.h）；encoder 须比本泵活得久。非 Opus 编码器不支持自适应比特率
+    CapturePump(AudioInterface& audio, AudioEncoder& encoder,
+                const CapturePumpConfig& config = CapturePumpConfig());
+    ~CapturePump();
+
+    CapturePump(const CapturePump&) = delete;
+    CapturePump& operator=(const CapturePump&) = delete;
+
+    void SetPacketHandler(PacketHandler handler) { packet_handler_ = std::move(handler); }
+    void SetGate(Gate gate) { gate_ = std::move(gate); }
+    void SetThreadHook(ThreadHook hook) { thread_hook_ = std::move(hook); }
+    void SetSpeechStartHandler(SpeechStartHandler handler) { speech_start_handler_ = std::move(handler); }
+    // 须在 Start 前调用；回调在采集线程上执行，不应阻塞
+    void SetPcmTap(PcmTap tap) { pcm_tap_ = std::move(tap); }
+    // 设置上行 VAD（位于 Read 与 Encode 之间），nullptr 关闭；须在 Start 前调用
+    void SetVoiceDetector(std::shared_ptr<VoiceDetector> vad);
+    // 设置麦克风阵列波束形成（位于 Read 之后、回声消除之前），nullptr 关闭；须在 Start 前调用。
+    // 设备按 beamformer->Channels() 声道采集（AudioInterface::SetCaptureChannels），波束输出的单声道再走后面各级；
+    // 要求 config.channels 为 1、帧长为波束形成块长的整数倍，否则忽略
+    void SetBeamformer(std::shared_ptr<Beamformer> beamformer);
+    // 设置回声消除（位于 Read 与 VAD 之间，仅单声道），nullptr 关闭；须在 Start 前调用。
+    // 参考信号优先取后端的 ReadEchoReference（全双工流），否则从 reference 取出播放路径写入的数据
+    void SetEchoCanceller(std::shared_ptr<EchoCanceller> aec, std::shared_ptr<EchoReference> reference);
+    // 设置降噪（位于回声消除之后、PCM 旁路/唤醒词/VAD 之前，仅单声道，帧长须为 NoiseSuppressor 块长的整数倍），
+    // nullptr 关闭；须在 Start 前调用。门控关闭时也持续处理，噪声估计不中断
+    void SetNoiseSuppressor(std::shared_ptr<NoiseSuppressor> ns);
+    // 设置自动增益（位于降噪之后、PCM 旁路/唤醒词/VAD 之前，声道数须与采集一致），nullptr 关闭；须在 Start 前调用。
+    // 帧已在本泵自己的缓冲区中（拷贝读取，或经过回声消除 / 降噪）时原地处理，否则（DMA 直读、PushPcm）先拷贝一次
+    void SetAutoGain(std::shared_ptr<AutoGainController> agc);
+    // 设置唤醒词检测（位于回声消除之后），只在门控关闭期间运行，门控打开时重置；nullptr 关闭；须在 Start 前调用。
+    // 回调里打开门控（如开始 listen）后，下一帧起正常编码发送，配合 gate_preroll_ms 可把唤醒词一并发给服务器
+    void SetKeywordSpotter(std::shared_ptr<KeywordSpotter> spotter, KeywordHandler handler);
+    // 记录每帧 读出->编码完成 的延迟，并把语音帧的读出时间作为轮次延迟的起点；须在 Start 前调用
+    void SetLatencyTracer(std::shared_ptr<LatencyTracer> tracer) { tracer_ = std::move(tracer); }
+    // 每帧记录 CaptureRead / Encode 到帧追踪文件；须在 Start 前调用
+    void SetFrameTrace(std::shared_ptr<FrameTrace> trace) { frame_trace_ = std::move(trace); }
+    // 每帧打心跳和阶段时间戳（read/process/encode/send），超时由看门狗汇报；monitor 须比本泵活得久，须在 Start 前调用
+    void SetDeadlineMonitor(DeadlineMonitor* monitor) { deadline_ = monitor; }
+    // 自适应比特率：每帧编码后交给控制器评估，参数变化时在采集线程上更新编码器；须在 Start 前调用。
+    // 当前编码器不是 Opus 时忽略
+    void SetBitrateController(std::shared_ptr<BitrateController> controller);
+    // 更换编码参数（任意线程调用，如重新加载设备配置），下一帧编码前在采集线程上生效；
+    // 设置了自适应比特率时同时作为控制器的新基础配置。非 Opus 编码器只取其中的 bitrate / complexity
+    void SetEncoderConfig(const OpusEncoderConfig& config);
+    // 更换编码器（任意线程调用，如 hello 协商出另一种格式），下一帧编码前在采集线程上生效，同时丢弃门控预录环；
+    // encoder 须比本泵活得久，采样率和声道数须与采集一致、MaxPacketBytes 不超过输出缓冲区，否则返回 false
+    bool SetEncoder(AudioEncoder& encoder);
+    const char* EncoderFormat() const { return encoder_format_.load(std::memory_order_relaxed); }
+    // 丢弃门控预录环中的包（任意线程调用，下一帧在采集线程上生效），如预录期间的音频含未消除的 TTS 回声
+    void DiscardGatePreroll() { gate_preroll_discard_ = true; }
+
+    // 启动/停止采集线程
+    void Start();
+    void Stop();
+    // 通知采集线程重新检查门控（任意线程调用，如会话状态变化时）：处于省电空闲且门控已打开时恢复采集设备
+    void Wake();
+    bool Idle() const { return idle_.load(std::memory_order_relaxed); }
+    bool Running() const { return running_; }
+
+    // 执行一次 读取->编码->回调，返回是否成功读到一帧；可在调用方自己的线程中驱动
+    bool PumpOnce();
+
+    // 由外部音频线程推送采集数据（如 AlsaEngine 的采集回调，每次一个设备周期），
+    // 攒满一帧后执行 编码->回调；返回本次处理的完整帧数。不要与 Start/PumpOnce 混用
+    size_t PushPcm(const short* pcm, size_t frames);
+
+    CapturePumpStats GetStats() const;
+
+    const CapturePumpConfig& Config() const { return config_; }
+
+private:
+    // owned 非空时 encoder 为 nullptr，使用 owned
+    CapturePump(AudioInterface& audio, AudioEncoder* encoder, std::unique_ptr<AudioEncoder> owned,
+                const CapturePumpConfig& config);
+
+    void Run();
+    // 门控已连续关闭 idle_suspend_ms 以上
+    bool IdleDue() const;
+    // 暂停采集设备并阻塞到 Wake() 且门控打开（或 Stop），然后恢复设备
+    void SuspendUntilWake();
+    // captured_us 为这一帧第一个样本的硬件采集时刻（AudioInterface::CaptureTimestampUs），0 时以此刻为准
+    void UpdatePeriod(uint64_t captured_us = 0);
+    bool Process(const short* frame);
+    // 设备读出的一帧：有波束形成时先合成单声道（写入 pcm_）再处理
+    bool ProcessCaptured(const short* frame);
+    size_t CaptureChannels() const;
+    bool VadAdmit(const short* frame);
+    void EncodeAndSend(const short* pcm);
+    // 采集线程：应用 SetEncoder / SetEncoderConfig 留下的编码器和参数
+    void ApplyPendingEncoderConfig();
+    int Encode(unsigned char* out, size_t out_size, const short* pcm);
+    // 门控关闭时把本帧编码进预录环；门控打开时按时间顺序发出环中的包
+    void GatePreroll(const short* pcm);
+    void FlushGatePreroll();
+
+    AudioInterface& audio_;
+    std::unique_ptr<AudioEncoder> owned_encoder_;  // OpusEncoderCtx 构造时的包装
+    AudioEncoder* encoder_;
+    OpusEncoderCtx* opus_;  // encoder_ 为 Opus 时的底层状态，否则为 nullptr（仅采集线程）
+    std::atomic<const char*> encoder_format_;
+    CapturePumpConfig config_;
+
+    std::vector<short> pcm_;
+    size_t pcm_fill_ = 0;  // PushPcm 已攒入 pcm_ 的帧数
+    std::vector<unsigned char> packet_;
+
+    // VAD 状态：预录帧保存在固定大小的环中，语音起始时按顺序先行编码
+    std::shared_ptr<VoiceDetector> vad_;
+    std::shared_ptr<Beamformer> beamformer_;
+    std::vector<short> array_;  // 阵列的多声道帧（拷贝读取、PushPcm 攒帧）
+    std::shared_ptr<EchoCanceller> aec_;
+    std::shared_ptr<EchoReference> reference_;
+    std::shared_ptr<NoiseSuppressor> ns_;
+    std::shared_ptr<AutoGainController> agc_;
+    std::shared_ptr<LatencyTracer> tracer_;
+    std::shared_ptr<FrameTrace> frame_trace_;
+    DeadlineMonitor* deadline_ = nullptr;
+    std::shared_ptr<BitrateController> bitrate_controller_;
+    std::shared_ptr<KeywordSpotter> spotter_;
+    uint64_t read_us_ = 0;  // 当前帧的采集时刻：后端有硬件时间戳时用它，否则为读出时刻（仅设置了 tracer_ 时更新）
+    std::vector<short> echo_ref_;  // 本帧的参考信号
+    std::vector<short> aec_out_;   // 消除回声后的帧
+    std::vector<short> ns_out_;    // 降噪后的帧
+    std::vector<short> agc_out_;   // 前面没有可写缓冲区时，自动增益在这里处理
+    size_t hangover_frames_ = 0;
+    size_t hangover_left_ = 0;
+    size_t preroll_frames_ = 0;
+    std::vector<short> preroll_;
+    size_t preroll_head_ = 0;
+    size_t preroll_count_ = 0;
+    // 门控预录：已编码的包，每个槽位 max_packet_bytes 字节，构造时一次分配
+    size_t gate_preroll_frames_ = 0;
+    std::vector<unsigned char> gate_ring_;
+    std::vector<size_t> gate_sizes_;
+    size_t gate_head_ = 0;
+    size_t gate_count_ = 0;
+    bool gated_ = false;  // 上一帧被门控挡下
+    std::chrono::steady_clock::time_point gated_since_;  // 门控本次关闭的时刻
+
+    // 省电空闲
+    ProfiledMutex idle_mutex_{"capture_idle"};
+    ProfiledConditionVariable idle_cv_{"capture_idle"};
+    bool wake_requested_ = false;  // 持 idle_mutex_
+    bool idle_supported_ = true;   // 后端不支持暂停时不再尝试
+    bool waking_ = false;          // 刚恢复，等待第一帧以计算唤醒延迟（仅采集线程）
+    std::atomic<bool> idle_{false};
+    std::atomic<uint64_t> wake_request_us_{0};
+    std::atomic<bool> gate_preroll_discard_{false};
+
+    // SetEncoder / SetEncoderConfig 留给采集线程的编码器和参数
+    ProfiledMutex encoder_config_mutex_{"capture_encoder_config"};
+    AudioEncoder* pending_encoder_ = nullptr;   // 持 encoder_config_mutex_
+    OpusEncoderConfig pending_encoder_config_;  // 持 encoder_config_mutex_
+    bool has_pending_config_ = false;           // 持 encoder_config_mutex_
+    std::atomic<bool> encoder_config_pending_{false};
+
+    PacketHandler packet_handler_;
+    Gate gate_;
+    ThreadHook thread_hook_;
+    SpeechStartHandler speech_start_handler_;
+    KeywordHandler keyword_handler_;
+    PcmTap pcm_tap_;
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    std::chrono::steady_clock::time_point last_read_;
+    bool has_last_read_ = false;
+
+    std::atomic<uint64_t> frames_read_{0};
+    std::atomic<uint64_t> read_errors_{0};
+    std::atomic<uint64_t> frames_gated_{0};
+    std::atomic<uint64_t> gate_preroll_sent_{0};
+    std::atomic<uint64_t> gate_preroll_flushes_{0};
+    std::atomic<uint64_t> keywords_detected_{0};
+    std::atomic<uint64_t> kws_us_{0};
+    std::atomic<uint64_t> frames_speech_{0};
+    std::atomic<uint64_t> frames_suppressed_{0};
+    std::atomic<uint64_t> frames_encoded_{0};
+    std::atomic<uint64_t> encode_errors_{0};
+    std::atomic<uint64_t> bytes_encoded_{0};
+    std::atomic<uint64_t> encode_us_{0};
+    std::atomic<double> period_ms_{0};
+    std::atomic<double> min_period_ms_{0};
+    std::atomic<double> max_period_ms_{0};
+    std::atomic<double> capture_buffer_ms_{0};
+    std::atomic<uint64_t> idle_suspends_{0};
+    std::atomic<uint64_t> idle_ms_{0};
+    std::atomic<uint64_t> wake_latency_us_{0};
+    std::atomic<uint64_t> max_wake_latency_us_{0};
+};
+
+}  // namespace linx
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "LockProfiler.h"
+
+namespace linx {
+
+struct DecodeWorkerStats {
+    uint64_t packets = 0;     // 入队的包
+    uint64_t processed = 0;   // 已交给处理回调的包
+    uint64_t dropped = 0;     // 队列已满而丢弃的包
+    uint64_t flushed = 0;     // Flush 丢弃的未处理包
+    size_t high_water = 0;    // 队列最大深度（包数）
+    size_t bytes = 0;         // 当前排队的包的字节数
+    size_t high_water_bytes = 0;  // 排队字节数的最大值
+    uint64_t flow_pauses = 0;     // 排队字节数达到高水位、请求暂停接收的次数
+    uint64_t held_us = 0;         // 解码线程因下游没有空间而等待的累计时长
+};
+
+// 下行解码线程：接收回调（lws 服务线程、UDP 接收线程等）只把包拷进有界队列就返回，
+// 由专门的线程按到达顺序调用处理回调（通常是解码写入抖动缓冲区），网络线程上不再做解码。
+// Post 的任务与包在同一个队列里按顺序执行，用于必须排在已到达音频之后生效的控制事件
+// （如 TTS 句子边界、流结束），保证它们看到的抖动缓冲区写入位置与接收顺序一致。
+// 包的缓冲区在队列内反复复用，稳态下入队不分配内存。未 Start 时 Push / Post 在调用线程上直接处理。
+// 流控（服务器快于实时下发时内存有界）：SetSinkReady 让解码线程在下游（抖动缓冲区）攒够时停下，
+// 包以压缩形式留在队列中；SetFlowControl 在排队字节数越过高/低水位时通知上游暂停/恢复接收
+class DecodeWorker {
+public:
+    // 在解码线程上调用；data 只在回调期间有效，received_us 为 Push 时传入的到达时间
+    using PacketHandler = std::function<void(const unsigned char* data, size_t len, uint64_t received_us)>;
+    // 解码线程启动时在线程内调用一次，用于设置调度策略、线程名等
+    using ThreadHook = std::function<void()>;
+    // 流控回调：paused 为 true 时请求上游暂停接收，为 false 时恢复
+    using FlowHandler = std::function<void(bool paused)>;
+    // 下游是否放得下下一个包
+    using SinkReady = std::function<bool()>;
+
+    explicit DecodeWorker(PacketHandler handler, size_t max_packets = 256);
+    ~DecodeWorker();
+
+    DecodeWorker(const DecodeWorker&) = delete;
+    DecodeWorker& operator=(const DecodeWorker&) = delete;
+
+    // 须在 Start 前调用
+    void SetThreadHook(ThreadHook hook) { thread_hook_ = std::move(hook); }
+    // 排队的包达到 high_water_bytes 字节时以 true 调用 handler，降到 low_water_bytes 及以下（含 Flush）时以 false 调用。
+    // 在 Push / 解码线程 / Flush 的调用线程上、持内部锁时调用，须立即返回且不能回调本对象；0 关闭。须在 Start 前调用
+    void SetFlowControl(size_t high_water_bytes, size_t low_water_bytes, FlowHandler handler);
+    // 解码线程处理下一个包之前调用 ready，返回 false 时暂停（排在该包之后的任务也一起等待），每隔 poll 重新检查；
+    // Flush、Stop 立即结束等待。只对 Start 后的解码线程生效。须在 Start 前调用
+    void SetSinkReady(SinkReady ready, std::chrono::milliseconds poll = std::chrono::milliseconds(10));
+    // 下游（播放线程）取走数据后调用：解码线程正在等待时立即重新检查 ready，不必等到下一次 poll。
+    // 没有在等待时只读一个原子变量，可以在音频线程上每个周期调用
+    void SinkChanged();
+
+    void Start();
+    // 停止解码线程，队列中未处理的包和任务丢弃
+    void Stop();
+    bool Running() const { return running_; }
+
+    // 任意线程：拷贝一个包入队，队列已满时丢弃并返回 false
+    bool Push(const void* data, size_t len, uint64_t received_us = 0);
+    // 任意线程：任务排在已入队的包之后执行
+    void Post(std::function<void()> task);
+    // 丢弃队列中尚未处理的包（打断播放时），任务保留；返回丢弃的包数。
+    // 正在处理的那个包不受影响，处理回调需自行判断是否已被打断
+    size_t Flush();
+
+    size_t Depth() const;
+    // 排队的包的字节数
+    size_t Bytes() const;
+    bool FlowPaused() const { return flow_paused_.load(std::memory_order_relaxed); }
+    DecodeWorkerStats GetStats() const;
+
+private:
+    struct Item {
+        std::vector<unsigned char> data;
+        size_t len = 0;
+        uint64_t received_us = 0;
+        std::function<void()> task;  // 非空时为任务
+    };
+
+    void Run();
+    void Recycle(std::vector<unsigned char>&& buffer);
+    // 持 mutex_：排队字节数变化后按水位通知流控回调
+    void UpdateFlowLocked();
+    // 持 lock：队头是包且下游没有空间时等待 poll，返回是否等待过
+    bool HoldLocked(std::unique_lock<ProfiledMutex>& lock);
+
+    PacketHandler handler_;
+    ThreadHook thread_hook_;
+    size_t max_packets_;
+    FlowHandler flow_handler_;
+    size_t flow_high_bytes_ = 0;
+    size_t flow_low_bytes_ = 0;
+    SinkReady sink_ready_;
+    std::chrono::milliseconds sink_poll_{10};
+
+    mutable ProfiledMutex mutex_{"decode_queue"};
+    ProfiledConditionVariable cv_{"decode_queue"};
+    std::deque<Item> queue_;
+    std::vector<std::vector<unsigned char>> spare_;  // 回收的包缓冲区（持 mutex_）
+    size_t queued_packets_ = 0;                       // 队列中的包数，不含任务（持 mutex_）
+    size_t queued_bytes_ = 0;                         // 队列中的包的字节数（持 mutex_）
+    uint64_t flush_generation_ = 0;                   // Flush 次数（持 mutex_）
+    uint64_t sink_generation_ = 0;                    // SinkChanged 次数（持 mutex_）
+    std::atomic<bool> holding_{false};                // 解码线程正在检查或等待下游
+    bool stopping_ = false;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+
+    std::atomic<uint64_t> packets_{0};
+    std::atomic<uint64_t> processed_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> flushed_{0};
+    std::atomic<size_t> high_water_{0};
+    std::atomic<size_t> bytes_{0};
+    std::atomic<size_t> high_water_bytes_{0};
+    std::atomic<bool> flow_paused_{false};
+    std::atomic<uint64_t> flow_pauses_{0};
+    std::atomic<uint64_t> held_us_{0};
+};
+
+}  // namespace linx
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AudioCodec.h"
+#include "Resampler.h"
+
+namespace linx {
+
+// 下行解码：按服务器 hello 中声明的流格式（audio_params 的 sample_rate/channels）和播放链路的格式选择解码器。
+// Opus 解码器可以直接输出 8/12/16/24/48kHz 中的任意一种，与流的编码采样率无关：
+//   - 播放采样率是其中之一时直接解码到播放采样率（如 24kHz 的 TTS 在 16kHz 设备上按 16kHz 解码），
+//     不做额外的重采样，也不会按更高的采样率白白解码再降下来；
+//   - 否则（如 44.1kHz 设备）按不低于 min(流采样率, 播放采样率) 的最低解码率解码，再由 Resampler 转到播放采样率，
+//     只有这种情况才插入重采样器。
+// 其他格式（PCM16、IMA-ADPCM 等，见 CodecRegistry）只能按流的采样率解码，与播放采样率不同时同样经过重采样。
+// 解码器的声道数始终与播放链路一致，单声道/立体声之间的转换由解码器完成。
+// 与 OpusDecoderCtx 一样不加锁，同一时刻只应由一个线程使用（解码与丢包隐藏分属不同线程时由调用方加锁）
+class DownlinkDecoder {
+public:
+    // output_rate / output_channels：抖动缓冲区和播放设备的格式
+    DownlinkDecoder(unsigned int output_rate, int output_channels);
+
+    DownlinkDecoder(const DownlinkDecoder&) = delete;
+    DownlinkDecoder& operator=(const DownlinkDecoder&) = delete;
+
+    bool Valid() const { return decoder_ && decoder_->Valid(); }
+
+    // 按服务器声明的流格式重新选择解码器和解码率，stream_rate / stream_channels 为 0 表示未声明。
+    // 格式或解码率变化时重建解码器并插入/移除重采样器，返回 true；不变时只复位解码状态，返回 false。
+    // 未注册的格式或新解码器创建失败时保留原来的配置
+    bool Configure(unsigned int stream_rate, int stream_channels, std::string_view format = kFormatOpus);
+
+    unsigned int StreamRate() const { return stream_rate_; }
+    int StreamChannels() const { return stream_channels_; }
+    const std::string& Format() const { return format_; }
+    unsigned int DecodeRate() const { return decoder_->SampleRate(); }
+    unsigned int OutputRate() const { return output_rate_; }
+    int OutputChannels() const { return output_channels_; }
+    // 解码率与播放采样率不同，解码后经过重采样
+    bool Resampling() const { return resampler_ != nullptr; }
+
+    // 给定流采样率（0 为未知）和播放采样率时 Opus 的解码率
+    static unsigned int ChooseDecodeRate(unsigned int stream_rate, unsigned int output_rate);
+
+    // 解码一个包写入 sink（PcmRing/JitterBuffer 等），返回写入的帧数（播放采样率，每声道），失败返回负值。
+    // 不需要重采样时与 OpusDecoderCtx::DecodeInto 相同，直接解码进 sink 借出的内存
+    template <typename Sink>
+    int DecodeInto(Sink& sink, const unsigned char* data, size_t size) {
+        if (!resampler_) {
+            return decoder_->DecodeInto(sink, data, size);
+        }
+        int n = decoder_->Decode(decode_pcm_.data(), decoder_->MaxFrameSamples(), data, size);
+        if (n <= 0) {
+            return n;
+        }
+        // 重采样输出放得进连续区域时直接写进 sink，否则经暂存区拷贝一次
+        size_t frames = resampler_->MaxOutputFrames(static_cast<size_t>(n));
+        size_t contiguous = 0;
+        short* region = sink.WriteRegion(&contiguous);
+        if (contiguous >= frames * output_channels_) {
+            size_t out = resampler_->Process(decode_pcm_.data(), static_cast<size_t>(n), region, frames);
+            sink.CommitWrite(out * output_channels_);
+            return static_cast<int>(out);
+        }
+        size_t out = resampler_->Process(decode_pcm_.data(), static_cast<size_t>(n), output_pcm_.data(),
+                                         output_pcm_.size() / output_channels_);
+        sink.Write(output_pcm_.data(), out * output_channels_);
+        return static_cast<int>(out);
+    }
+
+    // 丢包隐藏：生成不超过 frames 帧（播放采样率，每声道）的外推样本，返回生成的帧数，失败返回负值。
+    // 重采样时按 2.5ms 的整数倍外推，可能少于 frames。PCM16 / IMA-ADPCM 补静音
+    int DecodeMissing(opus_int16* pcm_data, size_t frames);
+
+    // 清空解码器和重采样器的状态（打断播放后调用）
+    void Reset();
+
+private:
+    void AllocateBuffers();
+
+    unsigned int output_rate_;
+    int output_channels_;
+    unsigned int stream_rate_ = 0;
+    int stream_channels_ = 0;
+    std::string format_ = kFormatOpus;
+    std::unique_ptr<AudioDecoder> decoder_;
+    std::unique_ptr<Resampler> resampler_;   // 仅在解码率与播放采样率不同时存在
+    std::vector<opus_int16> decode_pcm_;     // 解码率下的一包（最长 120ms）
+    std::vector<opus_int16> output_pcm_;     // 重采样输出的暂存区
+};
+
+}  // namespace linx
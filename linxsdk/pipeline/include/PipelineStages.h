@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "AudioInterface.h"
+#include "AudioPipeline.h"
+#include "FramePool.h"
+#include "Opus.h"
+#if defined(LINX_HAVE_WEBSOCKET)
+#include "Websocket.h"
+#endif
+
+namespace linx {
+
+// 采集源：后端支持 AcquireCapture 时把 DMA 缓冲区作为视图直接交给下游（零拷贝），
+// 否则读入池中的帧（给了 pool 时，下游跨线程也不必再拷贝）或读入自己的缓冲区。阻塞读取即节拍。
+// 每帧带采集时间戳、格式和连续的序号
+class CaptureSource : public PipelineStage {
+public:
+    CaptureSource(AudioInterface& audio, size_t frame_samples, int channels, FramePool* pool = nullptr);
+
+    bool IsSource() const override { return true; }
+    bool Produce() override;
+
+private:
+    // 填入格式、序号，读取失败后的第一帧带 kFrameDiscontinuity
+    MediaFrame Stamp(MediaFrame frame);
+
+    AudioInterface& audio_;
+    size_t frame_samples_;
+    int channels_;
+    FramePool* pool_;
+    std::vector<short> pcm_;
+    uint64_t sequence_ = 0;
+    bool discontinuity_ = false;
+};
+
+// 播放汇：后端支持 AcquirePlayback 时直接写入设备缓冲区，否则调用 Write
+class PlaybackSink : public PipelineStage {
+public:
+    PlaybackSink(AudioInterface& audio, int channels);
+
+    void Process(const MediaFrame& frame) override;
+
+private:
+    AudioInterface& audio_;
+    int channels_;
+};
+
+// Opus 编码：PCM 帧 -> Opus 包，继承时间戳、序号和标志。给了 pool 时输出写入池中的帧，否则为本阶段缓冲区上的视图
+class OpusEncodeStage : public PipelineStage {
+public:
+    OpusEncodeStage(OpusEncoderCtx& opus, int channels, FramePool* pool = nullptr, size_t max_packet_bytes = 4000);
+
+    void Process(const MediaFrame& frame) override;
+
+private:
+    OpusEncoderCtx& opus_;
+    int channels_;
+    FramePool* pool_;
+    std::vector<unsigned char> packet_;
+};
+
+// Opus 解码：Opus 包 -> PCM 帧，继承时间戳、序号和标志。给了 pool 时输出写入池中的帧，否则为本阶段缓冲区上的视图
+class OpusDecodeStage : public PipelineStage {
+public:
+    OpusDecodeStage(OpusDecoderCtx& opus, int channels, FramePool* pool = nullptr);
+
+    void Process(const MediaFrame& frame) override;
+
+private:
+    OpusDecoderCtx& opus_;
+    int channels_;
+    FramePool* pool_;
+    std::vector<short> pcm_;
+};
+
+#if defined(LINX_HAVE_WEBSOCKET)
+// WebSocket 两端的阶段只在构建了 linx_ws 时提供（LINX_WEBSOCKET=OFF 的 MQTT + UDP 设备不链接 libwebsockets）
+
+// WebSocket 发送汇：每个 Opus 包调用一次 send_binary，失败（未连接、发送队列满）计入 drops
+class WebSocketSendStage : public PipelineStage {
+public:
+    explicit WebSocketSendStage(WebSocketClient& client);
+
+    void Process(const MediaFrame& frame) override;
+
+private:
+    WebSocketClient& client_;
+};
+
+// WebSocket 接收源：安装零拷贝接收回调，二进制消息作为 lws 接收缓冲区上的视图交给下游（在 WebSocket 服务线程上），
+// 时间戳为到达时刻，文本消息交给 text_handler。帧由回调驱动，不占用流水线的源线程
+class WebSocketReceiveStage : public PipelineStage {
+public:
+    using TextHandler = std::function<void(std::string_view text)>;
+
+    WebSocketReceiveStage(WebSocketClient& client, TextHandler text_handler = TextHandler());
+
+private:
+    void OnMessage(std::string_view data, bool binary);
+
+    TextHandler text_handler_;
+    uint64_t sequence_ = 0;  // 按到达顺序分配（WebSocket 服务线程）
+};
+#endif  // LINX_HAVE_WEBSOCKET
+
+}  // namespace linx
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "Tracepoints.h"
+
+namespace linx {
+
+// 单生产者/单消费者无锁对象队列，槽位在构造时一次性分配（容量向上取整为 2 的幂），
+// 入队/出队只移动对象，不分配内存。与 PcmRing 相同，head_ / tail_ 各占一个 cache line，
+// 两端各自缓存对方的位置，只在看起来满/空时才重新读取。T 须可默认构造、可移动赋值
+template <typename T>
+class SpscQueue {
+public:
+    static constexpr size_t kCacheLine = 64;
+
+    explicit SpscQueue(size_t capacity) {
+        size_t cap = 1;
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        capacity_ = cap;
+        mask_ = cap - 1;
+        slots_.reset(new T[cap]());
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    size_t Capacity() const { return capacity_; }
+
+    // 当前元素数（任意线程可调用，结果为近似值）
+    size_t Size() const { return tail_.load(std::memory_order_seq_cst) - head_.load(std::memory_order_acquire); }
+    bool Empty() const { return Size() == 0; }
+
+    // 生产者：队列已满时返回 false，value 保持不变
+    bool TryPush(T&& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ == capacity_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ == capacity_) {
+                LINX_PROBE(queue_full, this);
+                return false;
+            }
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_seq_cst);  // 与消费者的休眠标志组成 Dekker 式检查，见 AudioPipeline
+        LINX_PROBE(queue_push, this, tail + 1 - cached_head_);  // 深度按生产者缓存的 head 计，只会偏大
+        return true;
+    }
+
+    // 消费者：队列为空时返回 false
+    bool TryPop(T* out) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_seq_cst);
+            if (head == cached_tail_) {
+                return false;
+            }
+        }
+        *out = std::move(slots_[head & mask_]);
+        slots_[head & mask_] = T();  // 立即释放槽位中对象持有的资源（如帧引用）
+        head_.store(head + 1, std::memory_order_release);
+        LINX_PROBE(queue_pop, this, cached_tail_ - head - 1);  // 深度按消费者缓存的 tail 计，只会偏小
+        return true;
+    }
+
+private:
+    alignas(kCacheLine) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;
+
+    alignas(kCacheLine) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;
+
+    alignas(kCacheLine) size_t capacity_ = 0;
+    size_t mask_ = 0;
+    std::unique_ptr<T[]> slots_;
+};
+
+}  // namespace linx
@@ -0,0 +1,251 @@
+#include "AudioPipeline.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "SteadyClock.h"
+
+namespace linx {
+
+namespace {
+
+// 当前线程上正在执行的阶段中，直接调用的下游阶段累计耗时，用于只统计阶段自身的耗时
+thread_local uint64_t tls_child_us = 0;
+
+template <typename Fn>
+auto Timed(LatencyHistogram& histogram, Fn&& fn) -> decltype(fn()) {
+    uint64_t saved = tls_child_us;
+    tls_child_us = 0;
+    uint64_t start = SteadyNowUs();
+    struct Scope {
+        LatencyHistogram& histogram;
+        uint64_t start;
+        uint64_t saved;
+        ~Scope() {
+            uint64_t elapsed = SteadyNowUs() - start;
+            histogram.Record(elapsed > tls_child_us ? elapsed - tls_child_us : 0);
+            tls_child_us = saved + elapsed;
+        }
+    } scope{histogram, start, saved};
+    return fn();
+}
+
+void Deliver(PipelineStage* stage, LatencyHistogram& histogram, std::atomic<uint64_t>& frames_in,
+             const MediaFrame& frame) {
+    frames_in.fetch_add(1, std::memory_order_relaxed);
+    Timed(histogram, [&] { stage->Process(frame); });
+}
+
+constexpr auto kWorkerIdleWait = std::chrono::milliseconds(50);
+
+}  // namespace
+
+PipelineStageStats PipelineStage::GetStats() const {
+    PipelineStageStats stats;
+    stats.frames_in = frames_in_.load(std::memory_order_relaxed);
+    stats.frames_out = frames_out_.load(std::memory_order_relaxed);
+    stats.copies = copies_.load(std::memory_order_relaxed);
+    stats.drops = drops_.load(std::memory_order_relaxed);
+    stats.expired = expired_.load(std::memory_order_relaxed);
+    stats.queue_high_water = queue_high_water_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void PipelineStage::Emit(const MediaFrame& frame) {
+    frames_out_.fetch_add(1, std::memory_order_relaxed);
+    for (Link& link : links_) {
+        if (link.worker == nullptr) {
+            Deliver(link.target, link.target->process_us_, link.target->frames_in_, frame);
+            continue;
+        }
+        // 跨线程：池中的帧只增加引用，视图拷贝进池中的一帧
+        MediaFrame owned;
+        if (frame.Owned()) {
+            owned = frame;
+        } else {
+            owned = link.pool != nullptr ? frame.CopyTo(*link.pool) : MediaFrame();
+            if (!owned) {
+                drops_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            copies_.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (!link.queue->TryPush(std::move(owned))) {
+            drops_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        size_t depth = link.queue->Size();
+        if (depth > link.target->queue_high_water_.load(std::memory_order_relaxed)) {
+            link.target->queue_high_water_.store(depth, std::memory_order_relaxed);
+        }
+        link.worker->Notify();
+    }
+}
+
+void PipelineStage::Worker::Notify() {
+    // TryPush 以 seq_cst 发布 tail，与工作线程 "置 sleeping -> 持锁再查队列" 配对，不会漏掉唤醒
+    if (sleeping.load(std::memory_order_seq_cst)) {
+        std::lock_guard<ProfiledMutex> lock(mutex);
+        cv.notify_one();
+    }
+}
+
+AudioPipeline::~AudioPipeline() { Stop(); }
+
+PipelineStage* AudioPipeline::Add(std::shared_ptr<PipelineStage> stage, const StageOptions& options) {
+    if (running_ || !stage) {
+        return nullptr;
+    }
+    std::unique_ptr<Node> node(new Node());
+    node->stage = std::move(stage);
+    node->options = options;
+    node->options.queue_frames = std::max<size_t>(2, options.queue_frames);
+    if (node->options.own_thread && !node->stage->IsSource()) {
+        node->worker.reset(new PipelineStage::Worker());
+    }
+    PipelineStage* raw = node->stage.get();
+    nodes_.push_back(std::move(node));
+    return raw;
+}
+
+AudioPipeline::Node* AudioPipeline::Find(PipelineStage* stage) {
+    for (auto& node : nodes_) {
+        if (node->stage.get() == stage) {
+            return node.get();
+        }
+    }
+    return nullptr;
+}
+
+void AudioPipeline::Connect(PipelineStage* from, PipelineStage* to) {
+    Node* source = Find(from);
+    Node* target = Find(to);
+    if (running_ || source == nullptr || target == nullptr || source == target) {
+        return;
+    }
+    PipelineStage::Link link;
+    link.target = to;
+    if (target->worker) {
+        // 每条入边一个队列，保证每个队列只有一个生产者线程
+        target->worker->queues.emplace_back(new SpscQueue<MediaFrame>(target->options.queue_frames));
+        link.worker = target->worker.get();
+        link.queue = target->worker->queues.back().get();
+        link.pool = pool_;
+    }
+    from->links_.push_back(link);
+}
+
+void AudioPipeline::Start() {
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    for (auto& node : nodes_) {
+        if (node->worker) {
+            node->thread = std::thread(&AudioPipeline::RunWorker, this, node.get());
+        }
+    }
+    // 下游先就绪，再启动源
+    for (auto& node : nodes_) {
+        if (node->stage->IsSource()) {
+            node->thread = std::thread(&AudioPipeline::RunSource, this, node.get());
+        }
+    }
+}
+
+void AudioPipeline::Stop() {
+    if (!running_) {
+        return;
+    }
+    running_ = false;
+    for (auto& node : nodes_) {
+        if (node->stage->IsSource()) {
+            node->stage->Interrupt();
+            if (node->thread.joinable()) {
+                node->thread.join();
+            }
+        }
+    }
+    for (auto& node : nodes_) {
+        if (node->worker) {
+            {
+                std::lock_guard<ProfiledMutex> lock(node->worker->mutex);
+            }
+            node->worker->cv.notify_all();
+        }
+        if (node->thread.joinable()) {
+            node->thread.join();
+        }
+    }
+    // 丢弃残留在队列中的帧，把引用还给池
+    for (auto& node : nodes_) {
+        if (node->worker) {
+            MediaFrame frame;
+            for (auto& queue : node->worker->queues) {
+                while (queue->TryPop(&frame)) {
+                }
+            }
+        }
+    }
+}
+
+void AudioPipeline::ForEachStage(const std::function<void(const PipelineStage&)>& fn) const {
+    for (const auto& node : nodes_) {
+        fn(*node->stage);
+    }
+}
+
+void AudioPipeline::RunSource(Node* node) {
+    if (node->options.thread_hook) {
+        node->options.thread_hook();
+    }
+    PipelineStage* stage = node->stage.get();
+    while (running_) {
+        if (!Timed(stage->process_us_, [&] { return stage->Produce(); })) {
+            break;
+        }
+    }
+}
+
+void AudioPipeline::RunWorker(Node* node) {
+    if (node->options.thread_hook) {
+        node->options.thread_hook();
+    }
+    PipelineStage* stage = node->stage.get();
+    PipelineStage::Worker& worker = *node->worker;
+    const uint64_t max_age_us = node->options.max_age_us;
+    MediaFrame frame;
+    auto drain = [&] {
+        bool any = false;
+        for (auto& queue : worker.queues) {
+            while (queue->TryPop(&frame)) {
+                if (max_age_us > 0 && frame.AgeUs(SteadyNowUs()) > max_age_us) {
+                    stage->expired_.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    Deliver(stage, stage->process_us_, stage->frames_in_, frame);
+                }
+                frame = MediaFrame();
+                any = true;
+            }
+        }
+        return any;
+    };
+    while (running_) {
+        if (drain()) {
+            continue;
+        }
+        worker.sleeping.store(true, std::memory_order_seq_cst);
+        {
+            // 持锁再查一次：生产者看到 sleeping 后要先拿到这把锁才能 notify，入队不会落在检查和等待之间
+            std::unique_lock<ProfiledMutex> lock(worker.mutex);
+            bool empty = std::all_of(worker.queues.begin(), worker.queues.end(),
+                                     [](const std::unique_ptr<SpscQueue<MediaFrame>>& queue) { return queue->Empty(); });
+            if (running_ && empty) {
+                worker.cv.wait_for(lock, kWorkerIdleWait);
+            }
+        }
+        worker.sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+}  // namespace linx
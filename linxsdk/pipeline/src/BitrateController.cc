@@ -0,0 +1,120 @@
+#include "BitrateController.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace linx {
+
+BitrateController::BitrateController(const BitrateControllerConfig& config, SignalSource source)
+    : config_(config), source_(std::move(source)) {
+    config_.min_bitrate = std::max(config_.min_bitrate, 6000);  // libopus 支持的最低码率
+    config_.max_bitrate = std::max(config_.max_bitrate, config_.min_bitrate);
+    config_.increase_hold = std::max(config_.increase_hold, 1);
+    Reset(OpusEncoderConfig());
+}
+
+void BitrateController::Reset(const OpusEncoderConfig& base) {
+    base_ = base;
+    started_ = false;
+    bitrate_ = config_.max_bitrate;
+    complexity_ = base.complexity;
+    fec_ = base.inband_fec && (!config_.adapt_fec || bitrate_ >= config_.fec_min_bitrate);
+    clear_intervals_ = 0;
+    min_rtt_ms_ = 0;
+    encode_us_total_ = 0;
+    encode_frames_ = 0;
+    stat_bitrate_ = bitrate_;
+    stat_complexity_ = complexity_;
+    stat_fec_ = fec_;
+}
+
+bool BitrateController::Congested(const CongestionSignals& signals) {
+    bool congested = signals.queue_depth > config_.queue_high || signals.send_delay_ms > config_.target_delay_ms;
+    if (signals.rtt_ms > 0) {
+        // 最小 RTT 近似链路的传播时延，高出部分来自路径上的排队
+        min_rtt_ms_ = min_rtt_ms_ > 0 ? std::min(min_rtt_ms_, signals.rtt_ms) : signals.rtt_ms;
+        congested = congested || signals.rtt_ms > min_rtt_ms_ + config_.rtt_margin_ms;
+    }
+    return congested;
+}
+
+bool BitrateController::Update(std::chrono::steady_clock::time_point now, uint64_t encode_us, double frame_ms,
+                               OpusEncoderConfig* config) {
+    encode_us_total_ += encode_us;
+    encode_frames_++;
+    if (!started_) {
+        // 第一帧：把起始码率应用到编码器
+        started_ = true;
+        next_eval_ = now + config_.interval;
+        *config = base_;
+        config->bitrate = bitrate_;
+        config->complexity = complexity_;
+        config->inband_fec = fec_;
+        return true;
+    }
+    if (now < next_eval_) {
+        return false;
+    }
+    next_eval_ = now + config_.interval;
+
+    CongestionSignals signals = source_ ? source_() : CongestionSignals();
+    int bitrate = bitrate_;
+    if (Congested(signals)) {
+        congested_intervals_.fetch_add(1, std::memory_order_relaxed);
+        clear_intervals_ = 0;
+        bitrate = std::max(config_.min_bitrate, static_cast<int>(bitrate_ * config_.decrease));
+    } else if (++clear_intervals_ >= config_.increase_hold) {
+        clear_intervals_ = 0;
+        bitrate = std::min(config_.max_bitrate, bitrate_ + config_.increase_step);
+    }
+
+    int complexity = complexity_;
+    if (config_.adapt_complexity && encode_frames_ > 0 && frame_ms > 0) {
+        double avg_ms = encode_us_total_ / 1000.0 / encode_frames_;
+        double budget_ms = frame_ms * config_.encode_budget;
+        if (avg_ms > budget_ms) {
+            complexity = std::max(std::min(config_.min_complexity, base_.complexity), complexity - 1);
+        } else if (avg_ms < budget_ms / 2) {
+            complexity = std::min(base_.complexity, complexity + 1);
+        }
+    }
+    encode_us_total_ = 0;
+    encode_frames_ = 0;
+
+    bool fec = base_.inband_fec && (!config_.adapt_fec || bitrate >= config_.fec_min_bitrate);
+    if (bitrate == bitrate_ && complexity == complexity_ && fec == fec_) {
+        return false;
+    }
+    if (bitrate < bitrate_) {
+        decreases_.fetch_add(1, std::memory_order_relaxed);
+    } else if (bitrate > bitrate_) {
+        increases_.fetch_add(1, std::memory_order_relaxed);
+    }
+    INFO("bitrate: {} -> {} bps, complexity {}, fec {} (queue {}, send delay {:.0f}ms, rtt {:.0f}ms)", bitrate_,
+         bitrate, complexity, fec ? "on" : "off", signals.queue_depth, signals.send_delay_ms, signals.rtt_ms);
+    bitrate_ = bitrate;
+    complexity_ = complexity;
+    fec_ = fec;
+    stat_bitrate_ = bitrate;
+    stat_complexity_ = complexity;
+    stat_fec_ = fec;
+
+    *config = base_;
+    config->bitrate = bitrate;
+    config->complexity = complexity;
+    config->inband_fec = fec;
+    return true;
+}
+
+BitrateControllerStats BitrateController::GetStats() const {
+    BitrateControllerStats stats;
+    stats.bitrate = stat_bitrate_.load(std::memory_order_relaxed);
+    stats.complexity = stat_complexity_.load(std::memory_order_relaxed);
+    stats.inband_fec = stat_fec_.load(std::memory_order_relaxed);
+    stats.decreases = decreases_.load(std::memory_order_relaxed);
+    stats.increases = increases_.load(std::memory_order_relaxed);
+    stats.congested_intervals = congested_intervals_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace linx
@@ -0,0 +1,619 @@
+#include "CapturePump.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "CpuAccounting.h"
+
+namespace linx {
+
+namespace {
+
+CapturePumpConfig FitPacketBytes(CapturePumpConfig config, const AudioEncoder& encoder) {
+    config.max_packet_bytes = std::max(config.max_packet_bytes, encoder.MaxPacketBytes(config.frame_samples));
+    return config;
+}
+
+}  // namespace
+
+CapturePump::CapturePump(AudioInterface& audio, OpusEncoderCtx& opus, const CapturePumpConfig& config)
+    : CapturePump(audio, nullptr, std::make_unique<OpusAudioEncoder>(opus), config) {}
+
+CapturePump::CapturePump(AudioInterface& audio, AudioEncoder& encoder, const CapturePumpConfig& config)
+    : CapturePump(audio, &encoder, nullptr, config) {}
+
+CapturePump::CapturePump(AudioInterface& audio, AudioEncoder* encoder, std::unique_ptr<AudioEncoder> owned,
+                         const CapturePumpConfig& config)
+    : audio_(audio),
+      owned_encoder_(std::move(owned)),
+      encoder_(encoder != nullptr ? encoder : owned_encoder_.get()),
+      opus_(encoder_->Opus()),
+      encoder_format_(encoder_->Format()),
+      config_(FitPacketBytes(config, *encoder_)),
+      pcm_(config.frame_samples * config.channels),
+      packet_(config_.max_packet_bytes) {
+    if (config_.gate_preroll_ms > 0) {
+        int preroll_ms = std::min(config_.gate_preroll_ms, 1000);
+        size_t frame_ms = std::max<size_t>(1, config_.frame_samples * 1000 / config_.sample_rate);
+        gate_preroll_frames_ = (static_cast<size_t>(preroll_ms) + frame_ms - 1) / frame_ms;
+        gate_ring_.assign(gate_preroll_frames_ * config_.max_packet_bytes, 0);
+        gate_sizes_.assign(gate_preroll_frames_, 0);
+    }
+}
+
+CapturePump::~CapturePump() { Stop(); }
+
+void CapturePump::SetVoiceDetector(std::shared_ptr<VoiceDetector> vad) {
+    vad_ = std::move(vad);
+    size_t frame_ms = config_.frame_samples * 1000 / config_.sample_rate;
+    if (frame_ms == 0) {
+        frame_ms = 1;
+    }
+    hangover_frames_ = (config_.vad_hangover_ms + frame_ms - 1) / frame_ms;
+    preroll_frames_ = (config_.vad_preroll_ms + frame_ms - 1) / frame_ms;
+    hangover_left_ = 0;
+    preroll_head_ = 0;
+    preroll_count_ = 0;
+    preroll_.assign(vad_ ? preroll_frames_ * pcm_.size() : 0, 0);
+}
+
+void CapturePump::SetBeamformer(std::shared_ptr<Beamformer> beamformer) {
+    bool usable = beamformer && config_.channels == 1 && config_.frame_samples % beamformer->BlockSamples() == 0;
+    beamformer_ = usable ? std::move(beamformer) : nullptr;
+    array_.assign(beamformer_ ? config_.frame_samples * beamformer_->Channels() : 0, 0);
+}
+
+size_t CapturePump::CaptureChannels() const {
+    return beamformer_ ? beamformer_->Channels() : config_.channels;
+}
+
+void CapturePump::SetEchoCanceller(std::shared_ptr<EchoCanceller> aec, std::shared_ptr<EchoReference> reference) {
+    aec_ = config_.channels == 1 ? std::move(aec) : nullptr;
+    reference_ = std::move(reference);
+    echo_ref_.assign(aec_ ? config_.frame_samples : 0, 0);
+    aec_out_.assign(aec_ ? config_.frame_samples : 0, 0);
+}
+
+void CapturePump::SetNoiseSuppressor(std::shared_ptr<NoiseSuppressor> ns) {
+    bool usable = ns && config_.channels == 1 && config_.frame_samples % ns->BlockSamples() == 0;
+    ns_ = usable ? std::move(ns) : nullptr;
+    ns_out_.assign(ns_ ? config_.frame_samples : 0, 0);
+}
+
+void CapturePump::SetAutoGain(std::shared_ptr<AutoGainController> agc) {
+    agc_ = std::move(agc);
+    agc_out_.assign(agc_ ? pcm_.size() : 0, 0);
+}
+
+void CapturePump::SetKeywordSpotter(std::shared_ptr<KeywordSpotter> spotter, KeywordHandler handler) {
+    spotter_ = std::move(spotter);
+    keyword_handler_ = std::move(handler);
+}
+
+void CapturePump::SetBitrateController(std::shared_ptr<BitrateController> controller) {
+    bitrate_controller_ = opus_ != nullptr ? std::move(controller) : nullptr;
+    if (bitrate_controller_) {
+        bitrate_controller_->Reset(opus_->Config());  // 以当前预设为基础配置
+    }
+}
+
+void CapturePump::SetEncoderConfig(const OpusEncoderConfig& config) {
+    std::lock_guard<ProfiledMutex> lock(encoder_config_mutex_);
+    pending_encoder_config_ = config;
+    has_pending_config_ = true;
+    encoder_config_pending_.store(true, std::memory_order_release);
+}
+
+bool CapturePump::SetEncoder(AudioEncoder& encoder) {
+    if (encoder.SampleRate() != config_.sample_rate || encoder.Channels() != config_.channels ||
+        encoder.MaxPacketBytes(config_.frame_samples) > config_.max_packet_bytes) {
+        return false;
+    }
+    std::lock_guard<ProfiledMutex> lock(encoder_config_mutex_);
+    pending_encoder_ = &encoder;
+    encoder_config_pending_.store(true, std::memory_order_release);
+    return true;
+}
+
+void CapturePump::ApplyPendingEncoderConfig() {
+    AudioEncoder* encoder = nullptr;
+    OpusEncoderConfig config;
+    bool has_config = false;
+    {
+        std::lock_guard<ProfiledMutex> lock(encoder_config_mutex_);
+        encoder = pending_encoder_;
+        pending_encoder_ = nullptr;
+        config = pending_encoder_config_;
+        has_config = has_pending_config_;
+        has_pending_config_ = false;
+        encoder_config_pending_.store(false, std::memory_order_relaxed);
+    }
+    if (encoder != nullptr && encoder != encoder_) {
+        // 环中是旧格式的包，不能接在新格式后面发出
+        encoder_ = encoder;
+        opus_ = encoder->Opus();
+        encoder_format_.store(encoder->Format(), std::memory_order_relaxed);
+        gate_count_ = 0;
+        if (opus_ != nullptr && bitrate_controller_) {
+            bitrate_controller_->Reset(opus_->Config());
+        }
+    }
+    if (!has_config) {
+        return;
+    }
+    if (opus_ == nullptr) {
+        if (config.bitrate > 0) {
+            encoder_->SetBitrate(config.bitrate);
+        }
+        encoder_->SetComplexity(config.complexity);
+        return;
+    }
+    opus_->ApplyConfig(config);
+    if (bitrate_controller_) {
+        bitrate_controller_->Reset(config);
+    }
+}
+
+int CapturePump::Encode(unsigned char* out, size_t out_size, const short* pcm) {
+    return encoder_->Encode(out, out_size, pcm, config_.frame_samples);
+}
+
+void CapturePump::Start() {
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    has_last_read_ = false;
+    thread_ = std::thread(&CapturePump::Run, this);
+}
+
+void CapturePump::Stop() {
+    {
+        std::lock_guard<ProfiledMutex> lock(idle_mutex_);
+        running_ = false;
+    }
+    idle_cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void CapturePump::Wake() {
+    wake_request_us_.store(LatencyTracer::NowUs(), std::memory_order_relaxed);
+    {
+        std::lock_guard<ProfiledMutex> lock(idle_mutex_);
+        wake_requested_ = true;
+    }
+    idle_cv_.notify_all();
+}
+
+void CapturePump::Run() {
+    if (thread_hook_) {
+        thread_hook_();
+    }
+    while (running_) {
+        if (IdleDue()) {
+            SuspendUntilWake();
+            continue;
+        }
+        if (PumpOnce() && waking_) {
+            waking_ = false;
+            uint64_t latency = LatencyTracer::NowUs() - wake_request_us_.load(std::memory_order_relaxed);
+            wake_latency_us_.store(latency, std::memory_order_relaxed);
+            if (latency > max_wake_latency_us_.load(std::memory_order_relaxed)) {
+                max_wake_latency_us_.store(latency, std::memory_order_relaxed);
+            }
+        }
+    }
+    if (deadline_) {
+        deadline_->Idle();  // 线程退出，不再做停滞检测
+    }
+}
+
+bool CapturePump::IdleDue() const {
+    if (config_.idle_suspend_ms <= 0 || !idle_supported_ || !gated_ || spotter_ || !gate_ || gate_()) {
+        return false;
+    }
+    return std::chrono::steady_clock::now() - gated_since_ >= std::chrono::milliseconds(config_.idle_suspend_ms);
+}
+
+void CapturePump::SuspendUntilWake() {
+    if (!audio_.SuspendCapture()) {
+        idle_supported_ = false;  // 后端不支持，继续照常读取
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    if (deadline_) {
+        deadline_->Idle();  // 暂停期间不计入循环耗时
+    }
+    idle_.store(true, std::memory_order_relaxed);
+    idle_suspends_.fetch_add(1, std::memory_order_relaxed);
+    bool waited = false;
+    {
+        // 只在状态变化时醒来：Wake() 之后门控仍关闭（如 TTS 状态变化）则继续等待。
+        // 先清掉旧的请求再检查门控，检查之后的 Wake() 不会丢失
+        std::unique_lock<ProfiledMutex> lock(idle_mutex_);
+        wake_requested_ = false;
+        while (running_ && gate_ && !gate_()) {
+            idle_cv_.wait(lock, [this]() { return wake_requested_ || !running_; });
+            wake_requested_ = false;
+            waited = true;
+        }
+    }
+    audio_.ResumeCapture();
+    idle_.store(false, std::memory_order_relaxed);
+    idle_ms_.fetch_add(std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::steady_clock::now() - start).count(),
+                       std::memory_order_relaxed);
+    // 暂停前的音频与之后不连续：预录环和参考信号作废，帧周期重新统计
+    gate_count_ = 0;
+    gated_since_ = std::chrono::steady_clock::now();
+    if (reference_) {
+        reference_->Flush();
+    }
+    has_last_read_ = false;
+    waking_ = waited && running_;
+}
+
+void CapturePump::UpdatePeriod(uint64_t captured_us) {
+    auto now = std::chrono::steady_clock::now();
+    if (has_last_read_) {
+        double period = std::chrono::duration<double, std::milli>(now - last_read_).count();
+        double smoothed = period_ms_.load(std::memory_order_relaxed);
+        smoothed = smoothed == 0 ? period : smoothed + (period - smoothed) / 16;
+        period_ms_.store(smoothed, std::memory_order_relaxed);
+        if (min_period_ms_.load(std::memory_order_relaxed) == 0 ||
+            period < min_period_ms_.load(std::memory_order_relaxed)) {
+            min_period_ms_.store(period, std::memory_order_relaxed);
+        }
+        if (period > max_period_ms_.load(std::memory_order_relaxed)) {
+            max_period_ms_.store(period, std::memory_order_relaxed);
+        }
+    }
+    last_read_ = now;
+    has_last_read_ = true;
+    if (captured_us != 0) {
+        // 数据在驱动和设备缓冲区中已经排队的时长：读出时刻的时间戳会把它漏掉
+        uint64_t now_us = LatencyTracer::NowUs();
+        double buffered = now_us > captured_us ? (now_us - captured_us) / 1000.0 : 0;
+        double smoothed = capture_buffer_ms_.load(std::memory_order_relaxed);
+        smoothed = smoothed == 0 ? buffered : smoothed + (buffered - smoothed) / 16;
+        capture_buffer_ms_.store(smoothed, std::memory_order_relaxed);
+    }
+    if (tracer_) {
+        read_us_ = captured_us != 0 ? captured_us : LatencyTracer::NowUs();
+    }
+    if (frame_trace_) {
+        frame_trace_->Record(TraceStage::CaptureRead, pcm_.size() * sizeof(short));
+    }
+}
+
+bool CapturePump::PumpOnce() {
+    if (deadline_) {
+        deadline_->Begin(DeadlineStage::Read);
+    }
+    // 零拷贝：后端以 mmap 访问设备时直接在 DMA 缓冲区上处理，环绕不足一帧时退回拷贝读取
+    size_t got = 0;
+    const short* region = audio_.AcquireCapture(config_.frame_samples, &got);
+    if (region != nullptr && got >= config_.frame_samples) {
+        frames_read_.fetch_add(1, std::memory_order_relaxed);
+        UpdatePeriod(audio_.CaptureTimestampUs());
+        ProcessCaptured(region);
+        audio_.ReleaseCapture(config_.frame_samples);
+        return true;
+    }
+    if (region != nullptr) {
+        audio_.ReleaseCapture(0);
+    }
+
+    // 从音频设备读取一帧 PCM，阻塞读取本身即是节拍
+    short* buffer = beamformer_ ? array_.data() : pcm_.data();
+    if (!audio_.Read(buffer, config_.frame_samples)) {
+        read_errors_.fetch_add(1, std::memory_order_relaxed);
+        has_last_read_ = false;
+        return false;
+    }
+    frames_read_.fetch_add(1, std::memory_order_relaxed);
+    UpdatePeriod(audio_.CaptureTimestampUs());
+    ProcessCaptured(buffer);
+    return true;
+}
+
+size_t CapturePump::PushPcm(const short* pcm, size_t frames) {
+    const size_t channels = CaptureChannels();
+    short* buffer = beamformer_ ? array_.data() : pcm_.data();
+    size_t processed = 0;
+    while (frames > 0) {
+        // 没有残留且输入够一整帧时直接在输入上处理，省一次拷贝
+        if (pcm_fill_ == 0 && frames >= config_.frame_samples) {
+            frames_read_.fetch_add(1, std::memory_order_relaxed);
+            UpdatePeriod();
+            if (deadline_) {
+                deadline_->Begin(DeadlineStage::Process);  // 外部线程推送：每帧即一次循环
+            }
+            ProcessCaptured(pcm);
+            pcm += config_.frame_samples * channels;
+            frames -= config_.frame_samples;
+            ++processed;
+            continue;
+        }
+        size_t n = std::min(frames, config_.frame_samples - pcm_fill_);
+        memcpy(buffer + pcm_fill_ * channels, pcm, n * channels * sizeof(short));
+        pcm_fill_ += n;
+        pcm += n * channels;
+        frames -= n;
+        if (pcm_fill_ == config_.frame_samples) {
+            pcm_fill_ = 0;
+            frames_read_.fetch_add(1, std::memory_order_relaxed);
+            UpdatePeriod();
+            if (deadline_) {
+                deadline_->Begin(DeadlineStage::Process);
+            }
+            ProcessCaptured(buffer);
+            ++processed;
+        }
+    }
+    if (processed > 0) {
+        // 推送线程（如 ALSA 引擎）自己的工作不计入最后一帧的发送阶段
+        if (CpuThread* thread = CpuThread::Current()) {
+            thread->Enter(thread->Domain());
+        }
+    }
+    return processed;
+}
+
+bool CapturePump::ProcessCaptured(const short* frame) {
+    if (beamformer_) {
+        if (deadline_) {
+            deadline_->Enter(DeadlineStage::Process);
+        }
+        beamformer_->Process(frame, config_.frame_samples, pcm_.data());
+        frame = pcm_.data();
+    }
+    return Process(frame);
+}
+
+bool CapturePump::Process(const short* frame) {
+    if (deadline_) {
+        deadline_->Enter(DeadlineStage::Process);
+    }
+    // frame 指向本泵自己的缓冲区（拷贝读取的 pcm_ 或前一级的输出）时可以原地处理，DMA 区域和外部推入的数据不行
+    short* owned = frame == pcm_.data() ? pcm_.data() : nullptr;
+    // 回声消除放在门控之前：门控关闭时也取出参考信号保持时间线对齐，滤波器也继续自适应
+    if (aec_) {
+        if (!audio_.ReadEchoReference(echo_ref_.data(), config_.frame_samples)) {
+            if (reference_) {
+                reference_->Pull(echo_ref_.data(), config_.frame_samples);
+            } else {
+                std::fill(echo_ref_.begin(), echo_ref_.end(), 0);
+            }
+        }
+        aec_->Process(frame, echo_ref_.data(), aec_out_.data(), config_.frame_samples);
+        frame = owned = aec_out_.data();
+    }
+    if (ns_) {
+        ns_->Process(frame, ns_out_.data(), config_.frame_samples);
+        frame = owned = ns_out_.data();
+    }
+    if (agc_) {
+        if (owned == nullptr) {
+            memcpy(agc_out_.data(), frame, pcm_.size() * sizeof(short));
+            owned = agc_out_.data();
+        }
+        agc_->Process(owned, config_.frame_samples);
+        frame = owned;
+    }
+    if (pcm_tap_) {
+        pcm_tap_(frame, pcm_.size());
+    }
+
+    if (gate_preroll_discard_.exchange(false, std::memory_order_relaxed)) {
+        gate_count_ = 0;
+    }
+    if (gate_ && !gate_()) {
+        frames_gated_.fetch_add(1, std::memory_order_relaxed);
+        hangover_left_ = 0;
+        preroll_count_ = 0;
+        if (!gated_) {
+            gated_since_ = std::chrono::steady_clock::now();
+        }
+        gated_ = true;
+        if (gate_preroll_frames_ > 0) {
+            GatePreroll(frame);
+        }
+        if (spotter_) {
+            auto start = std::chrono::steady_clock::now();
+            int keyword = spotter_->Process(frame, config_.frame_samples);
+            kws_us_.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(
+                                  std::chrono::steady_clock::now() - start).count(),
+                              std::memory_order_relaxed);
+            if (keyword >= 0) {
+                keywords_detected_.fetch_add(1, std::memory_order_relaxed);
+                if (keyword_handler_) {
+                    keyword_handler_(keyword);
+                }
+            }
+        }
+        return false;
+    }
+    if (gated_) {
+        // 门控刚打开：先补发状态切换之前的音频，当前帧紧随其后，服务器收到的是连续的编码流
+        gated_ = false;
+        FlushGatePreroll();
+        if (spotter_) {
+            spotter_->Reset();  // 下次门控关闭时从头检测，不与本轮对话之前的音频拼接
+        }
+    }
+
+    if (vad_ && !VadAdmit(frame)) {
+        return false;
+    }
+    EncodeAndSend(frame);
+    if (tracer_) {
+        tracer_->RecordSince(LatencyStage::CaptureToEncode, read_us_);
+        if (!vad_) {
+            tracer_->MarkSpeech(read_us_);
+        }
+    }
+    return true;
+}
+
+// 判断当前帧是否发送：语音帧及其后 hangover_frames_ 帧发送，
+// 其余帧存入预录环；语音起始时先把预录环中的帧按时间顺序编码发出
+bool CapturePump::VadAdmit(const short* frame) {
+    const size_t frame_len = pcm_.size();
+    if (vad_->IsSpeech(frame, config_.frame_samples)) {
+        if (tracer_) {
+            tracer_->MarkSpeech(read_us_);
+        }
+        if (hangover_left_ == 0 && speech_start_handler_) {
+            speech_start_handler_();
+        }
+        if (hangover_left_ == 0 && preroll_count_ > 0) {
+            // 预录帧此前计为跳过，补发后改计为发送
+            size_t start = (preroll_head_ + preroll_frames_ - preroll_count_) % preroll_frames_;
+            for (size_t i = 0; i < preroll_count_; ++i) {
+                size_t slot = (start + i) % preroll_frames_;
+                EncodeAndSend(preroll_.data() + slot * frame_len);
+            }
+            frames_speech_.fetch_add(preroll_count_, std::memory_order_relaxed);
+            frames_suppressed_.fetch_sub(preroll_count_, std::memory_order_relaxed);
+            preroll_count_ = 0;
+        }
+        hangover_left_ = hangover_frames_ + 1;
+    }
+
+    if (hangover_left_ > 0) {
+        --hangover_left_;
+        frames_speech_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    frames_suppressed_.fetch_add(1, std::memory_order_relaxed);
+    if (preroll_frames_ > 0) {
+        memcpy(preroll_.data() + preroll_head_ * frame_len, frame, frame_len * sizeof(short));
+        preroll_head_ = (preroll_head_ + 1) % preroll_frames_;
+        if (preroll_count_ < preroll_frames_) {
+            ++preroll_count_;
+        }
+    }
+    return false;
+}
+
+void CapturePump::EncodeAndSend(const short* pcm) {
+    if (deadline_) {
+        deadline_->Enter(DeadlineStage::Encode);
+    }
+    if (encoder_config_pending_.load(std::memory_order_acquire)) {
+        ApplyPendingEncoderConfig();
+    }
+    auto start = std::chrono::steady_clock::now();
+    int encoded = Encode(packet_.data(), packet_.size(), pcm);
+    auto end = std::chrono::steady_clock::now();
+    uint64_t encode_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    encode_us_.fetch_add(encode_us, std::memory_order_relaxed);
+    if (bitrate_controller_ && opus_ != nullptr) {
+        // 编码器只在采集线程上使用，新参数从下一帧开始生效
+        OpusEncoderConfig encoder_config;
+        double frame_ms = config_.frame_samples * 1000.0 / config_.sample_rate;
+        if (bitrate_controller_->Update(end, encode_us, frame_ms, &encoder_config)) {
+            opus_->ApplyConfig(encoder_config);
+        }
+    }
+    if (encoded <= 0) {
+        encode_errors_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    frames_encoded_.fetch_add(1, std::memory_order_relaxed);
+    bytes_encoded_.fetch_add(encoded, std::memory_order_relaxed);
+    if (frame_trace_) {
+        frame_trace_->Record(TraceStage::Encode, static_cast<size_t>(encoded));
+    }
+
+    if (deadline_) {
+        deadline_->Enter(DeadlineStage::Send);
+    }
+    if (packet_handler_) {
+        packet_handler_(packet_.data(), static_cast<size_t>(encoded));
+    }
+}
+
+CapturePumpStats CapturePump::GetStats() const {
+    CapturePumpStats stats;
+    stats.frames_read = frames_read_.load(std::memory_order_relaxed);
+    stats.read_errors = read_errors_.load(std::memory_order_relaxed);
+    stats.frames_gated = frames_gated_.load(std::memory_order_relaxed);
+    stats.gate_preroll_sent = gate_preroll_sent_.load(std::memory_order_relaxed);
+    stats.gate_preroll_flushes = gate_preroll_flushes_.load(std::memory_order_relaxed);
+    stats.keywords_detected = keywords_detected_.load(std::memory_order_relaxed);
+    stats.kws_us = kws_us_.load(std::memory_order_relaxed);
+    stats.frames_speech = frames_speech_.load(std::memory_order_relaxed);
+    stats.frames_suppressed = frames_suppressed_.load(std::memory_order_relaxed);
+    uint64_t vad_total = stats.frames_speech + stats.frames_suppressed;
+    stats.suppressed_ratio = vad_total ? static_cast<double>(stats.frames_suppressed) / vad_total : 0;
+    stats.frames_encoded = frames_encoded_.load(std::memory_order_relaxed);
+    stats.encode_errors = encode_errors_.load(std::memory_order_relaxed);
+    stats.bytes_encoded = bytes_encoded_.load(std::memory_order_relaxed);
+    stats.encode_us = encode_us_.load(std::memory_order_relaxed);
+    stats.period_ms = period_ms_.load(std::memory_order_relaxed);
+    stats.min_period_ms = min_period_ms_.load(std::memory_order_relaxed);
+    stats.max_period_ms = max_period_ms_.load(std::memory_order_relaxed);
+    stats.capture_buffer_ms = capture_buffer_ms_.load(std::memory_order_relaxed);
+    stats.idle_suspends = idle_suspends_.load(std::memory_order_relaxed);
+    stats.idle_ms = idle_ms_.load(std::memory_order_relaxed);
+    stats.wake_latency_us = wake_latency_us_.load(std::memory_order_relaxed);
+    stats.max_wake_latency_us = max_wake_latency_us_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void CapturePump::GatePreroll(const short* pcm) {
+    // 环满时覆盖最早的包；编码器状态在门控内外连续，补发的包与之后的实时帧可直接衔接
+    unsigned char* slot = gate_ring_.data() + gate_head_ * config_.max_packet_bytes;
+    if (deadline_) {
+        deadline_->Enter(DeadlineStage::Encode);
+    }
+    if (encoder_config_pending_.load(std::memory_order_acquire)) {
+        ApplyPendingEncoderConfig();
+    }
+    auto start = std::chrono::steady_clock::now();
+    int encoded = Encode(slot, config_.max_packet_bytes, pcm);
+    encode_us_.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::steady_clock::now() - start).count(),
+                         std::memory_order_relaxed);
+    if (encoded <= 0) {
+        encode_errors_.fetch_add(1, std::memory_order_relaxed);
+        gate_count_ = 0;  // 环中的包不再连续
+        return;
+    }
+    gate_sizes_[gate_head_] = static_cast<size_t>(encoded);
+    gate_head_ = (gate_head_ + 1) % gate_preroll_frames_;
+    gate_count_ = std::min(gate_count_ + 1, gate_preroll_frames_);
+}
+
+void CapturePump::FlushGatePreroll() {
+    if (gate_count_ == 0) {
+        return;
+    }
+    if (deadline_) {
+        deadline_->Enter(DeadlineStage::Send);
+    }
+    size_t start = (gate_head_ + gate_preroll_frames_ - gate_count_) % gate_preroll_frames_;
+    for (size_t i = 0; i < gate_count_; ++i) {
+        size_t slot = (start + i) % gate_preroll_frames_;
+        size_t len = gate_sizes_[slot];
+        frames_encoded_.fetch_add(1, std::memory_order_relaxed);
+        bytes_encoded_.fetch_add(len, std::memory_order_relaxed);
+        if (frame_trace_) {
+            frame_trace_->Record(TraceStage::Encode, len);
+        }
+        if (packet_handler_) {
+            packet_handler_(gate_ring_.data() + slot * config_.max_packet_bytes, len);
+        }
+    }
+    gate_preroll_sent_.fetch_add(gate_count_, std::memory_order_relaxed);
+    gate_preroll_flushes_.fetch_add(1, std::memory_order_relaxed);
+    gate_count_ = 0;
+}
+
+}  // namespace linx
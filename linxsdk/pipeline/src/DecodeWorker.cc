@@ -0,0 +1,250 @@
+#include "DecodeWorker.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace linx {
+
+DecodeWorker::DecodeWorker(PacketHandler handler, size_t max_packets)
+    : handler_(std::move(handler)), max_packets_(max_packets > 0 ? max_packets : 1) {}
+
+DecodeWorker::~DecodeWorker() { Stop(); }
+
+void DecodeWorker::SetFlowControl(size_t high_water_bytes, size_t low_water_bytes, FlowHandler handler) {
+    flow_high_bytes_ = high_water_bytes;
+    flow_low_bytes_ = std::min(low_water_bytes, high_water_bytes);
+    flow_handler_ = high_water_bytes > 0 ? std::move(handler) : nullptr;
+}
+
+void DecodeWorker::SetSinkReady(SinkReady ready, std::chrono::milliseconds poll) {
+    sink_ready_ = std::move(ready);
+    sink_poll_ = std::max(poll, std::chrono::milliseconds(1));
+}
+
+void DecodeWorker::UpdateFlowLocked() {
+    bytes_.store(queued_bytes_, std::memory_order_relaxed);
+    if (queued_bytes_ > high_water_bytes_.load(std::memory_order_relaxed)) {
+        high_water_bytes_.store(queued_bytes_, std::memory_order_relaxed);
+    }
+    if (!flow_handler_) {
+        return;
+    }
+    bool paused = flow_paused_.load(std::memory_order_relaxed);
+    if (!paused && queued_bytes_ >= flow_high_bytes_) {
+        flow_paused_.store(true, std::memory_order_relaxed);
+        flow_pauses_.fetch_add(1, std::memory_order_relaxed);
+        flow_handler_(true);
+    } else if (paused && queued_bytes_ <= flow_low_bytes_) {
+        flow_paused_.store(false, std::memory_order_relaxed);
+        flow_handler_(false);
+    }
+}
+
+void DecodeWorker::Start() {
+    if (running_) {
+        return;
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        stopping_ = false;
+    }
+    running_ = true;
+    thread_ = std::thread(&DecodeWorker::Run, this);
+}
+
+void DecodeWorker::Stop() {
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    running_ = false;
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    for (auto& item : queue_) {
+        if (!item.task) {
+            spare_.push_back(std::move(item.data));
+        }
+    }
+    queue_.clear();
+    queued_packets_ = 0;
+    queued_bytes_ = 0;
+    UpdateFlowLocked();
+}
+
+bool DecodeWorker::Push(const void* data, size_t len, uint64_t received_us) {
+    if (!running_) {
+        packets_.fetch_add(1, std::memory_order_relaxed);
+        processed_.fetch_add(1, std::memory_order_relaxed);
+        handler_(static_cast<const unsigned char*>(data), len, received_us);
+        return true;
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        if (queued_packets_ >= max_packets_) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        Item item;
+        if (!spare_.empty()) {
+            item.data = std::move(spare_.back());
+            spare_.pop_back();
+        }
+        if (item.data.size() < len) {
+            item.data.resize(len);  // 缓冲区只增不减，之后一直复用
+        }
+        memcpy(item.data.data(), data, len);
+        item.len = len;
+        item.received_us = received_us;
+        queue_.push_back(std::move(item));
+        queued_packets_++;
+        queued_bytes_ += len;
+        packets_.fetch_add(1, std::memory_order_relaxed);
+        if (queued_packets_ > high_water_.load(std::memory_order_relaxed)) {
+            high_water_.store(queued_packets_, std::memory_order_relaxed);
+        }
+        UpdateFlowLocked();
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void DecodeWorker::Post(std::function<void()> task) {
+    if (!task) {
+        return;
+    }
+    if (!running_) {
+        task();
+        return;
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        Item item;
+        item.task = std::move(task);
+        queue_.push_back(std::move(item));
+    }
+    cv_.notify_one();
+}
+
+size_t DecodeWorker::Flush() {
+    size_t dropped = 0;
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        auto keep = std::remove_if(queue_.begin(), queue_.end(), [&](Item& item) {
+            if (item.task) {
+                return false;
+            }
+            spare_.push_back(std::move(item.data));
+            dropped++;
+            return true;
+        });
+        queue_.erase(keep, queue_.end());
+        queued_packets_ = 0;
+        queued_bytes_ = 0;
+        flush_generation_++;
+        UpdateFlowLocked();
+        flushed_.fetch_add(dropped, std::memory_order_relaxed);
+    }
+    cv_.notify_all();  // 结束解码线程对下游空间的等待，排在后面的任务立即执行
+    return dropped;
+}
+
+size_t DecodeWorker::Depth() const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    return queued_packets_;
+}
+
+size_t DecodeWorker::Bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+DecodeWorkerStats DecodeWorker::GetStats() const {
+    DecodeWorkerStats stats;
+    stats.packets = packets_.load(std::memory_order_relaxed);
+    stats.processed = processed_.load(std::memory_order_relaxed);
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    stats.flushed = flushed_.load(std::memory_order_relaxed);
+    stats.high_water = high_water_.load(std::memory_order_relaxed);
+    stats.bytes = bytes_.load(std::memory_order_relaxed);
+    stats.high_water_bytes = high_water_bytes_.load(std::memory_order_relaxed);
+    stats.flow_pauses = flow_pauses_.load(std::memory_order_relaxed);
+    stats.held_us = held_us_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void DecodeWorker::Recycle(std::vector<unsigned char>&& buffer) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    spare_.push_back(std::move(buffer));
+}
+
+void DecodeWorker::SinkChanged() {
+    if (!holding_.load(std::memory_order_seq_cst)) {
+        return;
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        sink_generation_++;
+    }
+    cv_.notify_all();
+}
+
+bool DecodeWorker::HoldLocked(std::unique_lock<ProfiledMutex>& lock) {
+    if (!sink_ready_ || queue_.front().task) {
+        return false;
+    }
+    // 回调在锁外执行（可能要取下游的锁）；期间 Flush 清空了队列时由调用方重新等待。
+    // holding_ 在检查之前置位，检查之后的 SinkChanged 都会改变 sink_generation_，不会漏掉唤醒
+    holding_.store(true, std::memory_order_seq_cst);
+    uint64_t sinks = sink_generation_;
+    lock.unlock();
+    bool ready = sink_ready_();
+    lock.lock();
+    if (ready) {
+        holding_.store(false, std::memory_order_relaxed);
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    uint64_t generation = flush_generation_;
+    cv_.wait_for(lock, sink_poll_, [&] {
+        return stopping_ || flush_generation_ != generation || sink_generation_ != sinks;
+    });
+    holding_.store(false, std::memory_order_relaxed);
+    held_us_.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start)
+                           .count(),
+                       std::memory_order_relaxed);
+    return true;
+}
+
+void DecodeWorker::Run() {
+    if (thread_hook_) {
+        thread_hook_();
+    }
+    while (true) {
+        Item item;
+        {
+            std::unique_lock<ProfiledMutex> lock(mutex_);
+            do {
+                cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                if (stopping_) {
+                    return;
+                }
+            } while (HoldLocked(lock) || queue_.empty());
+            item = std::move(queue_.front());
+            queue_.pop_front();
+            if (!item.task) {
+                queued_packets_--;
+                queued_bytes_ -= item.len;
+                UpdateFlowLocked();
+            }
+        }
+        if (item.task) {
+            item.task();
+            continue;
+        }
+        handler_(item.data.data(), item.len, item.received_us);
+        processed_.fetch_add(1, std::memory_order_relaxed);
+        Recycle(std::move(item.data));
+    }
+}
+
+}  // namespace linx
@@ -0,0 +1,94 @@
+#include "DownlinkDecoder.h"
+
+#include "Log.h"
+
+namespace linx {
+
+DownlinkDecoder::DownlinkDecoder(unsigned int output_rate, int output_channels)
+    : output_rate_(output_rate),
+      output_channels_(std::max(1, output_channels)),
+      decoder_(std::make_unique<OpusAudioDecoder>(ChooseDecodeRate(0, output_rate), output_channels_)) {
+    AllocateBuffers();
+}
+
+unsigned int DownlinkDecoder::ChooseDecodeRate(unsigned int stream_rate, unsigned int output_rate) {
+    if (OpusDecoderCtx::IsSupportedRate(output_rate)) {
+        return output_rate;
+    }
+    // 既不丢掉流本身的带宽，也不超过设备能播放的带宽
+    unsigned int target = stream_rate > 0 ? std::min(stream_rate, output_rate) : output_rate;
+    for (unsigned int rate : {8000u, 12000u, 16000u, 24000u}) {
+        if (rate >= target) {
+            return rate;
+        }
+    }
+    return 48000;
+}
+
+bool DownlinkDecoder::Configure(unsigned int stream_rate, int stream_channels, std::string_view format) {
+    CodecRegistry& registry = CodecRegistry::Instance();
+    if (!registry.Has(format)) {
+        WARN("downlink format {} is not supported, keeping {}", std::string(format), format_);
+        return false;
+    }
+    // Opus 可以任选解码率，且由解码器自己转换声道；其他格式只能按流的采样率解码（未声明时假定与播放采样率相同），
+    // 包里的声道数也须与流一致
+    bool any_rate = registry.AnyDecodeRate(format);
+    unsigned int rate = any_rate ? ChooseDecodeRate(stream_rate, output_rate_)
+                                 : (stream_rate > 0 ? stream_rate : output_rate_);
+    if (Valid() && format == format_ && rate == decoder_->SampleRate() &&
+        (any_rate || stream_channels == stream_channels_)) {
+        stream_rate_ = stream_rate;
+        stream_channels_ = stream_channels;
+        Reset();
+        return false;
+    }
+    std::unique_ptr<AudioDecoder> decoder = registry.CreateDecoder(format, rate, output_channels_, stream_channels);
+    if (!decoder) {
+        return false;
+    }
+    stream_rate_ = stream_rate;
+    stream_channels_ = stream_channels;
+    format_ = std::string(format);
+    decoder_ = std::move(decoder);
+    AllocateBuffers();
+    return true;
+}
+
+int DownlinkDecoder::DecodeMissing(opus_int16* pcm_data, size_t frames) {
+    if (!resampler_) {
+        return decoder_->DecodeMissing(pcm_data, frames);
+    }
+    // Opus PLC 的时长须为 2.5ms 的整数倍，按解码率换算后向下取整，至少 2.5ms；其他格式补静音，不受此限
+    size_t unit = format_ == kFormatOpus ? decoder_->SampleRate() / 400 : 1;
+    size_t decode_frames = frames * decoder_->SampleRate() / output_rate_ / unit * unit;
+    decode_frames = std::min(std::max(decode_frames, unit), decoder_->MaxFrameSamples());
+    int n = decoder_->DecodeMissing(decode_pcm_.data(), decode_frames);
+    if (n <= 0) {
+        return n;
+    }
+    return static_cast<int>(resampler_->Process(decode_pcm_.data(), static_cast<size_t>(n), pcm_data, frames));
+}
+
+void DownlinkDecoder::Reset() {
+    decoder_->Reset();
+    if (resampler_) {
+        resampler_->Reset();
+    }
+}
+
+void DownlinkDecoder::AllocateBuffers() {
+    unsigned int rate = decoder_->SampleRate();
+    if (rate == output_rate_ || !decoder_->Valid()) {
+        resampler_.reset();
+        decode_pcm_.clear();
+        output_pcm_.clear();
+        return;
+    }
+    size_t max_frames = decoder_->MaxFrameSamples();
+    resampler_ = std::make_unique<Resampler>(rate, output_rate_, output_channels_, max_frames);
+    decode_pcm_.assign(max_frames * output_channels_, 0);
+    output_pcm_.assign(resampler_->MaxOutputFrames(max_frames) * output_channels_, 0);
+}
+
+}  // namespace linx
@@ -0,0 +1,183 @@
+#include "PipelineStages.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace linx {
+
+CaptureSource::CaptureSource(AudioInterface& audio, size_t frame_samples, int channels, FramePool* pool)
+    : PipelineStage("capture"),
+      audio_(audio),
+      frame_samples_(frame_samples),
+      channels_(std::max(1, channels)),
+      pool_(pool),
+      pcm_(frame_samples * std::max(1, channels)) {}
+
+bool CaptureSource::Produce() {
+    const size_t samples = frame_samples_ * channels_;
+    size_t got = 0;
+    const short* region = audio_.AcquireCapture(frame_samples_, &got);
+    if (region != nullptr && got >= frame_samples_) {
+        Emit(Stamp(MediaFrame::View(MediaKind::Pcm, region, samples, SteadyNowUs())));
+        audio_.ReleaseCapture(frame_samples_);
+        return true;
+    }
+    if (region != nullptr) {
+        audio_.ReleaseCapture(0);  // 环绕处不足一帧，退回拷贝读取
+    }
+
+    // 池已空时退回自己的缓冲区，不因此少读一帧
+    FrameRef ref = pool_ != nullptr && pool_->FrameSamples() >= samples ? pool_->Acquire() : FrameRef();
+    short* buffer = ref ? ref->data : pcm_.data();
+    if (!audio_.Read(buffer, frame_samples_)) {
+        CountDrop();
+        discontinuity_ = true;
+        return true;
+    }
+    uint64_t now = SteadyNowUs();
+    if (ref) {
+        ref->samples = samples;
+        ref->timestamp_us = now;
+        Emit(Stamp(MediaFrame::FromPool(MediaKind::Pcm, std::move(ref), samples)));
+    } else {
+        Emit(Stamp(MediaFrame::View(MediaKind::Pcm, buffer, samples, now)));
+    }
+    return true;
+}
+
+MediaFrame CaptureSource::Stamp(MediaFrame frame) {
+    // 序号由本阶段统一分配，不论帧来自 DMA 视图、帧池还是拷贝读取
+    frame.sample_rate = audio_.SampleRate();
+    frame.channels = channels_;
+    frame.sequence = sequence_++;
+    frame.flags &= ~static_cast<uint32_t>(kFrameDiscontinuity);
+    if (discontinuity_) {
+        frame.flags |= kFrameDiscontinuity;
+        discontinuity_ = false;
+    }
+    return frame;
+}
+
+PlaybackSink::PlaybackSink(AudioInterface& audio, int channels)
+    : PipelineStage("playback"), audio_(audio), channels_(std::max(1, channels)) {}
+
+void PlaybackSink::Process(const MediaFrame& frame) {
+    if (frame.kind != MediaKind::Pcm) {
+        CountDrop();
+        return;
+    }
+    size_t frames = frame.size / channels_;
+    const short* pcm = frame.Pcm();
+    // 直接写入设备缓冲区，环绕时分两段；不支持时整帧交给 Write
+    while (frames > 0) {
+        size_t got = 0;
+        short* region = audio_.AcquirePlayback(frames, &got);
+        if (region == nullptr || got == 0) {
+            break;
+        }
+        got = std::min(got, frames);
+        memcpy(region, pcm, got * channels_ * sizeof(short));
+        audio_.CommitPlayback(got);
+        pcm += got * channels_;
+        frames -= got;
+    }
+    if (frames > 0 && !audio_.Write(const_cast<short*>(pcm), frames)) {
+        CountDrop();
+    }
+}
+
+OpusEncodeStage::OpusEncodeStage(OpusEncoderCtx& opus, int channels, FramePool* pool, size_t max_packet_bytes)
+    : PipelineStage("opus_encode"),
+      opus_(opus),
+      channels_(std::max(1, channels)),
+      pool_(pool),
+      packet_(max_packet_bytes) {}
+
+void OpusEncodeStage::Process(const MediaFrame& frame) {
+    if (frame.kind != MediaKind::Pcm) {
+        CountDrop();
+        return;
+    }
+    if (pool_ != nullptr) {
+        // 失败（含池已空）时不再退回本阶段的缓冲区重编码，编码器状态已前进
+        MediaFrame packet = opus_.Encode(frame, *pool_);
+        if (packet) {
+            Emit(packet);
+        } else {
+            CountDrop();
+        }
+        return;
+    }
+    int encoded = opus_.Encode(packet_.data(), packet_.size(), frame.Pcm(), frame.size / channels_);
+    if (encoded <= 0) {
+        CountDrop();
+        return;
+    }
+    MediaFrame packet = MediaFrame::View(MediaKind::Opus, packet_.data(), encoded);
+    packet.sample_rate = frame.sample_rate;
+    packet.channels = channels_;
+    packet.InheritFrom(frame);
+    Emit(packet);
+}
+
+OpusDecodeStage::OpusDecodeStage(OpusDecoderCtx& opus, int channels, FramePool* pool)
+    : PipelineStage("opus_decode"),
+      opus_(opus),
+      channels_(std::max(1, channels)),
+      pool_(pool),
+      pcm_(opus.MaxFrameSamples() * std::max(1, channels)) {}
+
+void OpusDecodeStage::Process(const MediaFrame& frame) {
+    if (frame.kind != MediaKind::Opus) {
+        CountDrop();
+        return;
+    }
+    if (pool_ != nullptr) {
+        MediaFrame pcm = opus_.Decode(frame, *pool_);
+        if (pcm) {
+            Emit(pcm);
+        } else {
+            CountDrop();
+        }
+        return;
+    }
+    int decoded = opus_.Decode(pcm_.data(), opus_.MaxFrameSamples(), frame.Bytes(), frame.size);
+    if (decoded <= 0) {
+        CountDrop();
+        return;
+    }
+    MediaFrame pcm = MediaFrame::View(MediaKind::Pcm, pcm_.data(), static_cast<size_t>(decoded) * channels_);
+    pcm.sample_rate = frame.sample_rate;
+    pcm.channels = channels_;
+    pcm.InheritFrom(frame);
+    Emit(pcm);
+}
+
+#if defined(LINX_HAVE_WEBSOCKET)
+WebSocketSendStage::WebSocketSendStage(WebSocketClient& client) : PipelineStage("ws_send"), client_(client) {}
+
+void WebSocketSendStage::Process(const MediaFrame& frame) {
+    if (frame.kind != MediaKind::Opus || !client_.send_binary(frame.data, frame.size)) {
+        CountDrop();
+    }
+}
+
+WebSocketReceiveStage::WebSocketReceiveStage(WebSocketClient& client, TextHandler text_handler)
+    : PipelineStage("ws_receive"), text_handler_(std::move(text_handler)) {
+    client.SetOnMessageViewCallback([this](std::string_view data, bool binary) { OnMessage(data, binary); });
+}
+
+void WebSocketReceiveStage::OnMessage(std::string_view data, bool binary) {
+    if (!binary) {
+        if (text_handler_) {
+            text_handler_(data);
+        }
+        return;
+    }
+    MediaFrame packet = MediaFrame::View(MediaKind::Opus, data.data(), data.size(), SteadyNowUs());
+    packet.sequence = sequence_++;
+    Emit(packet);
+}
+#endif  // LINX_HAVE_WEBSOCKET
+
+}  // namespace linx
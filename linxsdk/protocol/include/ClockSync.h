@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace linx {
+
+struct ClockSyncConfig {
+    size_t window = 8;                 // 参与选择的最近样本数
+    uint64_t max_age_us = 60000000;    // 超过该时长的样本不再参与选择（两端时钟的频偏使旧样本的偏移失效）
+    uint64_t max_delay_us = 500000;    // 往返时间超过该值的样本直接丢弃
+};
+
+struct ClockSyncStats {
+    uint64_t samples = 0;    // 接受的样本数
+    uint64_t rejected = 0;   // 时间戳不自洽或往返过长而丢弃的样本数
+    int64_t offset_us = 0;   // 当前偏移：服务器时间 - 本地时间
+    int64_t delay_us = 0;    // 选中样本的往返时间（不含服务器处理时间），偏移误差不超过它的一半
+    bool synced = false;
+};
+
+// NTP 方式的时钟偏移估计：本地在 t0 发出请求，服务器在 t1 收到、t2 回复，本地在 t3 收到。
+//   offset = ((t1 - t0) + (t2 - t3)) / 2，delay = (t3 - t0) - (t2 - t1)
+// 单个样本的误差不超过 delay / 2，排队越少的样本越准：在最近 window 个、未过期的样本中取往返最短的一个
+// （NTP 的时钟过滤），网络偶发排队不会拉偏估计。
+// 本地时间为单调时钟（LatencyTracer::NowUs），服务器时间为服务器的墙上时间（Unix 微秒），
+// 偏移因此同时消化了两端的纪元差，本地墙上时间被 NTP 校正或手动修改不影响换算。
+// AddSample 只在一个线程（网络线程）上调用；换算和统计可在任意线程读取
+class ClockSync {
+public:
+    explicit ClockSync(const ClockSyncConfig& config = ClockSyncConfig());
+
+    ClockSync(const ClockSync&) = delete;
+    ClockSync& operator=(const ClockSync&) = delete;
+
+    // 一次请求/应答的四个时间戳，返回样本是否被接受
+    bool AddSample(uint64_t t0, int64_t t1, int64_t t2, uint64_t t3);
+    // 重新开始（换了服务器）：丢弃全部样本
+    void Reset();
+
+    bool Synced() const { return synced_.load(std::memory_order_acquire); }
+    // 服务器时间换算为本地单调时钟；未同步时返回 0
+    uint64_t ToLocal(int64_t server_us) const;
+    int64_t ToServer(uint64_t local_us) const;
+    int64_t OffsetUs() const { return offset_us_.load(std::memory_order_relaxed); }
+    int64_t DelayUs() const { return delay_us_.load(std::memory_order_relaxed); }
+    // 已接受的样本数，用于决定还要不要连续发起请求
+    size_t Samples() const { return samples_.size(); }
+    ClockSyncStats GetStats() const;
+
+private:
+    struct Sample {
+        uint64_t local_us;  // t3
+        int64_t offset_us;
+        int64_t delay_us;
+    };
+
+    ClockSyncConfig config_;
+    std::vector<Sample> samples_;  // 最近的样本，按到达顺序（仅调用 AddSample 的线程）
+
+    std::atomic<bool> synced_{false};
+    std::atomic<int64_t> offset_us_{0};
+    std::atomic<int64_t> delay_us_{0};
+    std::atomic<uint64_t> accepted_{0};
+    std::atomic<uint64_t> rejected_{0};
+};
+
+}  // namespace linx
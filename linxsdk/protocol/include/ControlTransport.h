@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace linx {
+
+// 控制通道：承载 hello/listen/abort/tts/stt/goodbye 等 JSON 控制消息的传输，应用逻辑只面向这个接口。
+// 两种实现：
+//   WebSocketTransport：一条常驻的 WebSocket 连接，同时承载控制消息和音频（或按 hello 协商走 UDP）；
+//   MqttTransport：经 MQTT 代理收发控制消息，连接空闲时只有 MQTT 心跳（两个字节），
+//                  音频不经过控制通道，每次会话由 hello 协商出 UDP 通道，goodbye 后关闭。
+// 回调都在传输自己的网络线程上执行，须在 Start 之前设置；发送接口可在任意线程调用
+class ControlTransport {
+public:
+    virtual ~ControlTransport() = default;
+
+    // "websocket" / "mqtt"，用于日志和 hello 的 transport 字段之外的展示
+    virtual const char* Name() const = 0;
+    // hello 中的 transport 字段：websocket 或 udp（音频走 UDP 的 MQTT 方案）
+    virtual const char* HelloTransport() const = 0;
+    // 控制通道本身能否承载音频：为 false 时音频只能走 hello 协商出的 UDP 通道，
+    // 应用在有会话时才需要 hello（空闲时不必保持会话）
+    virtual bool CarriesAudio() const = 0;
+
+    virtual void Start() = 0;
+    virtual bool IsConnected() const = 0;
+    // 连接断开后是否已安排重连（在关闭回调中查询可区分临时断线和最终断开）
+    virtual bool Reconnecting() const = 0;
+    // 正常关闭（进程退出前），不再重连；返回是否在 timeout 内关闭完毕
+    virtual bool Close(std::chrono::milliseconds timeout) = 0;
+    // 空闲断开：delay 内没有收发时关闭连接并挂起，直到 Resume；其间有收发即取消。
+    // 默认不支持（MQTT 的空闲开销只是心跳，本身就是空闲时保留的通道）
+    virtual void SuspendWhenIdle(std::chrono::milliseconds) {}
+    // 挂起中时立即重新连接并返回 true（连接建立后照常回调 on open），否则返回 false
+    virtual bool Resume() { return false; }
+    virtual bool Suspended() const { return false; }
+
+    // 发送一条控制消息；未连接或队列已满时返回 false
+    virtual bool SendText(std::string_view message) = 0;
+    // 在控制通道上发送一帧音频（二进制）；CarriesAudio() 为 false 时总是返回 false
+    virtual bool SendBinary(const void* data, size_t len) = 0;
+
+    // 连接建立（MQTT 为 CONNACK 且已订阅）后依次发出的消息，排在其他消息之前
+    virtual void SetOnOpenMessagesCallback(std::function<std::vector<std::string>()> cb) = 0;
+    // 收到一条消息：view 只在回调期间有效，binary 为二进制（音频）消息
+    virtual void SetOnMessageViewCallback(std::function<void(std::string_view, bool)> cb) = 0;
+    // 已建立的连接断开
+    virtual void SetOnCloseCallback(std::function<void()> cb) = 0;
+    // 连接失败
+    virtual void SetOnFailCallback(std::function<void()> cb) = 0;
+};
+
+}  // namespace linx
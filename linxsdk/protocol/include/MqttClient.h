@@ -0,0 +1,168 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "LockProfiler.h"
+
+typedef struct ssl_st SSL;
+typedef struct ssl_ctx_st SSL_CTX;
+
+namespace linx {
+
+// MQTT 3.1.1 客户端配置
+struct MqttConfig {
+    std::string host;
+    uint16_t port = 1883;
+    bool tls = false;                // mqtts：OpenSSL，校验证书与主机名
+    bool verify_peer = true;
+    std::string ca_file;             // 为空时使用系统的默认 CA 路径
+    std::string client_id;
+    std::string username;            // 为空时不发送用户名和密码
+    std::string password;
+    std::string subscribe_topic;     // 连接后订阅的主题，为空时不订阅
+    int subscribe_qos = 0;           // 0 或 1
+    int publish_qos = 0;             // 0 或 1
+    // 心跳：空闲时每 keepalive 发一个 PINGREQ（2 字节），代理在 1.5 倍 keepalive 内没有收到任何报文即断开连接。
+    // 间隔越长代理和蜂窝链路的负担越小，但须短于 NAT 映射的老化时间
+    std::chrono::seconds keepalive{240};
+    std::chrono::milliseconds connect_timeout{10000};  // DNS 之后 TCP + TLS + CONNACK 的总时限
+    std::chrono::milliseconds ping_timeout{10000};     // PINGREQ 之后等待 PINGRESP 的时限，超时断开重连
+    // 断线重连：指数退避，随机抖动避免大量设备在代理重启后同时重连
+    bool reconnect = true;
+    std::chrono::milliseconds initial_delay{1000};
+    std::chrono::milliseconds max_delay{60000};
+    double multiplier = 2.0;
+    double jitter = 0.3;
+    size_t max_pending_bytes = 64 * 1024;  // 尚未写出的报文总字节数上限，超过时 Publish 返回 false
+    size_t max_packet = 256 * 1024;        // 接收报文的长度上限，超过视为协议错误并断开
+};
+
+// 解析代理地址：mqtt://host[:port]、mqtts://host[:port] 或 host[:port]（端口为 8883 时启用 TLS），
+// 结果写入 config 的 host/port/tls。地址为空或端口无效时返回 false
+bool ParseMqttEndpoint(const std::string& endpoint, MqttConfig* config);
+
+struct MqttStats {
+    uint64_t connections = 0;     // 收到 CONNACK 的连接数
+    uint64_t connect_errors = 0;  // 连接失败（DNS、TCP、TLS、CONNACK 拒绝、超时）
+    uint64_t disconnects = 0;     // 已建立的连接断开
+    uint64_t published = 0;       // 排队待写出的 PUBLISH
+    uint64_t publish_drops = 0;   // 未连接或待发数据超限而拒绝的 Publish
+    uint64_t received = 0;        // 收到的 PUBLISH
+    uint64_t pings = 0;           // 发出的 PINGREQ
+    uint64_t ping_timeouts = 0;   // PINGRESP 超时而断开的次数
+    uint64_t bytes_sent = 0;      // 含 MQTT 报文头，不含 TLS/TCP 开销
+    uint64_t bytes_received = 0;
+};
+
+// 最小的 MQTT 3.1.1 客户端：一个私有线程 poll 一个 TCP（或 TLS）连接，支持 CONNECT（clean session）、
+// 单个主题的 SUBSCRIBE、QoS 0/1 的 PUBLISH、PINGREQ 心跳和断线重连；不支持 QoS 2、遗嘱和持久会话。
+// Publish 可在任意线程调用，报文编码后排队由网络线程写出；所有回调都在网络线程上执行
+class MqttClient {
+public:
+    // 收到一条 PUBLISH；topic 与 payload 只在回调期间有效
+    using MessageHandler = std::function<void(std::string_view topic, std::string_view payload)>;
+
+    explicit MqttClient(const MqttConfig& config);
+    ~MqttClient();
+
+    MqttClient(const MqttClient&) = delete;
+    MqttClient& operator=(const MqttClient&) = delete;
+
+    // 须在 Start 之前设置。on_connect 在 CONNACK 和 SUBSCRIBE 之后调用，其中 Publish 的报文排在任何后续报文之前
+    void SetOnConnect(std::function<void()> cb) { on_connect_ = std::move(cb); }
+    void SetOnMessage(MessageHandler cb) { on_message_ = std::move(cb); }
+    void SetOnDisconnect(std::function<void()> cb) { on_disconnect_ = std::move(cb); }
+    void SetOnConnectError(std::function<void()> cb) { on_connect_error_ = std::move(cb); }
+
+    // 启动网络线程并发起连接
+    bool Start();
+    // 已连接时发出 DISCONNECT 并关闭连接，最多等 timeout 写出；之后不再重连，等待网络线程结束
+    void Stop(std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+
+    // 发布到 topic（QoS 取 publish_qos）；未连接、报文过长或待发数据超限时返回 false
+    bool Publish(std::string_view topic, std::string_view payload);
+
+    bool IsConnected() const { return connected_; }
+    // 连接断开或失败后正在等待重连
+    bool Reconnecting() const { return reconnecting_; }
+    MqttStats GetStats() const;
+
+private:
+    void Run();
+    // 解析地址并完成 TCP、TLS、CONNECT/CONNACK 和 SUBSCRIBE，失败时关闭连接返回 false
+    bool Connect();
+    bool ConnectTcp(std::chrono::steady_clock::time_point deadline);
+    bool ConnectTls(std::chrono::steady_clock::time_point deadline);
+    // 连接建立后的收发循环，连接断开、出错或 Stop 时返回
+    void Serve();
+    void CloseConnection();
+    // 等待重连退避（可被 Stop 打断），返回 false 表示不再重连
+    bool WaitReconnect();
+
+    // 等待 fd 就绪直到 deadline，返回 false 表示超时或出错；interruptible 时 Stop 也会打断等待
+    bool WaitFd(short events, std::chrono::steady_clock::time_point deadline, bool interruptible = true);
+    // 非阻塞读写（TLS 时经 SSL），返回字节数；暂无数据 / 写不进返回 0 并设置 want_*，连接关闭或出错返回 -1
+    long ReadSome(char* buffer, size_t len);
+    long WriteSome(const char* data, size_t len);
+    // 把 out_ 尽量写出，出错返回 false
+    bool Flush();
+    // 解析 rx_ 中的完整报文，协议错误返回 false
+    bool ProcessInput();
+    bool HandlePacket(uint8_t header, const char* body, size_t len);
+    // 在 CONNACK 之前（connect 阶段）同步读取一个报文，超时返回 false
+    bool ReadPacket(uint8_t* header, std::string* body, std::chrono::steady_clock::time_point deadline);
+
+    // 报文编码，附加到 *out
+    void AppendPacket(std::string* out, uint8_t header, const std::string& body);
+    void Wake();
+
+    MqttConfig config_;
+    std::function<void()> on_connect_;
+    MessageHandler on_message_;
+    std::function<void()> on_disconnect_;
+    std::function<void()> on_connect_error_;
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stopping_{false};  // Stop 请求：发出 DISCONNECT 后退出
+    std::atomic<bool> connected_{false};
+    std::atomic<bool> reconnecting_{false};
+    std::atomic<int64_t> stop_timeout_ms_{0};  // Stop 时写出 DISCONNECT 的时限
+    int wake_pipe_[2] = {-1, -1};
+    int fd_ = -1;  // 仅网络线程
+    SSL_CTX* ssl_ctx_ = nullptr;
+    SSL* ssl_ = nullptr;
+    bool want_write_ = false;  // TLS 读写需要等待可写（仅网络线程）
+    unsigned attempt_ = 0;     // 连续失败次数（仅网络线程）
+    std::minstd_rand rng_;
+
+    ProfiledMutex mutex_{"mqtt_pending"};  // 保护 pending_ 与 packet_id_
+    std::string pending_;       // 其他线程编码好、尚未交给网络线程的报文
+    uint16_t packet_id_ = 0;
+    std::string out_;           // 网络线程待写出的数据
+    std::string rx_;            // 已读入、尚未解析的数据
+    std::chrono::steady_clock::time_point last_tx_;
+    std::chrono::steady_clock::time_point ping_sent_;
+    bool ping_outstanding_ = false;
+
+    std::atomic<uint64_t> connections_{0};
+    std::atomic<uint64_t> connect_errors_{0};
+    std::atomic<uint64_t> disconnects_{0};
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> publish_drops_{0};
+    std::atomic<uint64_t> received_{0};
+    std::atomic<uint64_t> pings_{0};
+    std::atomic<uint64_t> ping_timeouts_{0};
+    std::atomic<uint64_t> bytes_sent_{0};
+    std::atomic<uint64_t> bytes_received_{0};
+};
+
+}  // namespace linx
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ControlTransport.h"
+#include "MqttClient.h"
+
+namespace linx {
+
+// 经 MQTT 代理的控制通道：控制消息以 JSON 文本发布到 publish_topic，服务器发往设备的消息从 subscribe_topic 收取。
+// 空闲的设备只保持一条 MQTT 连接（心跳间隔见 MqttConfig::keepalive），不占用语音服务器的连接；
+// 会话开始时发出 hello（transport 为 udp），音频走服务器在 hello 中下发的 UDP 通道，goodbye 后关闭
+class MqttTransport : public ControlTransport {
+public:
+    MqttTransport(const MqttConfig& config, std::string publish_topic);
+
+    const char* Name() const override { return "mqtt"; }
+    const char* HelloTransport() const override { return "udp"; }
+    bool CarriesAudio() const override { return false; }
+
+    void Start() override;
+    bool IsConnected() const override { return client_.IsConnected(); }
+    bool Reconnecting() const override { return client_.Reconnecting(); }
+    bool Close(std::chrono::milliseconds timeout) override;
+
+    bool SendText(std::string_view message) override;
+    bool SendBinary(const void*, size_t) override { return false; }
+
+    void SetOnOpenMessagesCallback(std::function<std::vector<std::string>()> cb) override {
+        on_open_messages_ = std::move(cb);
+    }
+    void SetOnMessageViewCallback(std::function<void(std::string_view, bool)> cb) override {
+        on_message_ = std::move(cb);
+    }
+    void SetOnCloseCallback(std::function<void()> cb) override { on_close_ = std::move(cb); }
+    void SetOnFailCallback(std::function<void()> cb) override { on_fail_ = std::move(cb); }
+
+    MqttClient& Client() { return client_; }
+
+private:
+    MqttClient client_;
+    std::string publish_topic_;
+    std::function<std::vector<std::string>()> on_open_messages_;
+    std::function<void(std::string_view, bool)> on_message_;
+    std::function<void()> on_close_;
+    std::function<void()> on_fail_;
+};
+
+}  // namespace linx
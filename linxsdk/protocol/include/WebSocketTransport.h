@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ControlTransport.h"
+#include "Websocket.h"
+
+namespace linx {
+
+// WebSocketClient 的控制通道适配：连接、重连、背压等仍在 client 上配置，这里只转发控制接口。
+// client 须比适配器活得久
+class WebSocketTransport : public ControlTransport {
+public:
+    explicit WebSocketTransport(WebSocketClient& client) : client_(client) {}
+
+    const char* Name() const override { return "websocket"; }
+    const char* HelloTransport() const override { return "websocket"; }
+    bool CarriesAudio() const override { return true; }
+
+    void Start() override { client_.start(); }
+    bool IsConnected() const override { return client_.IsConnected(); }
+    bool Reconnecting() const override { return client_.Reconnecting(); }
+    bool Close(std::chrono::milliseconds timeout) override { return client_.Close(timeout); }
+    void SuspendWhenIdle(std::chrono::milliseconds delay) override { client_.SuspendWhenIdle(delay); }
+    bool Resume() override { return client_.Resume(); }
+    bool Suspended() const override { return client_.Suspended(); }
+
+    bool SendText(std::string_view message) override { return client_.send_text(message); }
+    bool SendBinary(const void* data, size_t len) override { return client_.send_binary(data, len); }
+
+    void SetOnOpenMessagesCallback(std::function<std::vector<std::string>()> cb) override {
+        client_.SetOnOpenMessagesCallback(std::move(cb));
+    }
+    void SetOnMessageViewCallback(std::function<void(std::string_view, bool)> cb) override {
+        client_.SetOnMessageViewCallback(std::move(cb));
+    }
+    void SetOnCloseCallback(std::function<void()> cb) override { client_.SetOnCloseCallback(std::move(cb)); }
+    void SetOnFailCallback(std::function<void()> cb) override { client_.SetOnFailCallback(std::move(cb)); }
+
+    WebSocketClient& Client() { return client_; }
+
+private:
+    WebSocketClient& client_;
+};
+
+}  // namespace linx
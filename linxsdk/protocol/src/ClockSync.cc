@@ -0,0 +1,70 @@
+#include "ClockSync.h"
+
+#include <algorithm>
+
+namespace linx {
+
+ClockSync::ClockSync(const ClockSyncConfig& config) : config_(config) {
+    config_.window = std::max<size_t>(1, config_.window);
+    samples_.reserve(config_.window);
+}
+
+bool ClockSync::AddSample(uint64_t t0, int64_t t1, int64_t t2, uint64_t t3) {
+    // 服务器处理时间为负、本地往返为负或往返过长的样本没有意义
+    int64_t round_trip = static_cast<int64_t>(t3 - t0);
+    int64_t server_time = t2 - t1;
+    int64_t delay = round_trip - server_time;
+    if (t3 < t0 || server_time < 0 || delay < 0 || delay > static_cast<int64_t>(config_.max_delay_us)) {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    int64_t offset = ((t1 - static_cast<int64_t>(t0)) + (t2 - static_cast<int64_t>(t3))) / 2;
+    if (samples_.size() == config_.window) {
+        samples_.erase(samples_.begin());
+    }
+    samples_.push_back(Sample{t3, offset, delay});
+    accepted_.fetch_add(1, std::memory_order_relaxed);
+
+    // 未过期的样本中取往返最短的；最新的样本总是参与，全部过期时退化为只用它
+    const Sample* best = &samples_.back();
+    for (const Sample& sample : samples_) {
+        if (t3 - sample.local_us <= config_.max_age_us && sample.delay_us < best->delay_us) {
+            best = &sample;
+        }
+    }
+    offset_us_.store(best->offset_us, std::memory_order_relaxed);
+    delay_us_.store(best->delay_us, std::memory_order_relaxed);
+    synced_.store(true, std::memory_order_release);
+    return true;
+}
+
+void ClockSync::Reset() {
+    samples_.clear();
+    synced_.store(false, std::memory_order_release);
+    offset_us_.store(0, std::memory_order_relaxed);
+    delay_us_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t ClockSync::ToLocal(int64_t server_us) const {
+    if (!Synced()) {
+        return 0;
+    }
+    int64_t local = server_us - offset_us_.load(std::memory_order_relaxed);
+    return local > 0 ? static_cast<uint64_t>(local) : 0;
+}
+
+int64_t ClockSync::ToServer(uint64_t local_us) const {
+    return static_cast<int64_t>(local_us) + offset_us_.load(std::memory_order_relaxed);
+}
+
+ClockSyncStats ClockSync::GetStats() const {
+    ClockSyncStats stats;
+    stats.samples = accepted_.load(std::memory_order_relaxed);
+    stats.rejected = rejected_.load(std::memory_order_relaxed);
+    stats.offset_us = offset_us_.load(std::memory_order_relaxed);
+    stats.delay_us = delay_us_.load(std::memory_order_relaxed);
+    stats.synced = Synced();
+    return stats;
+}
+
+}  // namespace linx
@@ -0,0 +1,785 @@
+#include "MqttClient.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+#include "Log.h"
+
+namespace linx {
+
+namespace {
+
+// MQTT 3.1.1 报文类型（固定头的高 4 位）
+constexpr uint8_t kConnect = 1;
+constexpr uint8_t kConnack = 2;
+constexpr uint8_t kPublish = 3;
+constexpr uint8_t kPuback = 4;
+constexpr uint8_t kSubscribe = 8;
+constexpr uint8_t kSuback = 9;
+constexpr uint8_t kPingreq = 12;
+constexpr uint8_t kPingresp = 13;
+constexpr uint8_t kDisconnect = 14;
+
+void AppendU16(std::string* out, uint16_t value) {
+    out->push_back(static_cast<char>(value >> 8));
+    out->push_back(static_cast<char>(value & 0xff));
+}
+
+void AppendString(std::string* out, std::string_view value) {
+    AppendU16(out, static_cast<uint16_t>(value.size()));
+    out->append(value.data(), value.size());
+}
+
+uint16_t ReadU16(const char* data) {
+    return static_cast<uint16_t>((static_cast<uint8_t>(data[0]) << 8) | static_cast<uint8_t>(data[1]));
+}
+
+// 解析固定头：返回 1 表示 buffer 中已有完整报文（*header_len 为固定头长度，*body_len 为剩余长度），
+// 0 表示数据还不够，-1 表示剩余长度编码无效（超过 4 字节）
+int ParseFixedHeader(std::string_view buffer, size_t* header_len, size_t* body_len) {
+    size_t length = 0;
+    size_t multiplier = 1;
+    for (size_t i = 1; i < 5; ++i) {
+        if (i >= buffer.size()) {
+            return 0;
+        }
+        uint8_t byte = static_cast<uint8_t>(buffer[i]);
+        length += (byte & 0x7f) * multiplier;
+        if ((byte & 0x80) == 0) {
+            *header_len = i + 1;
+            *body_len = length;
+            return buffer.size() >= *header_len + length ? 1 : 0;
+        }
+        multiplier *= 128;
+    }
+    return -1;
+}
+
+const char* ConnackReason(uint8_t code) {
+    switch (code) {
+        case 1:
+            return "unacceptable protocol version";
+        case 2:
+            return "client identifier rejected";
+        case 3:
+            return "server unavailable";
+        case 4:
+            return "bad user name or password";
+        case 5:
+            return "not authorized";
+        default:
+            return "unknown reason";
+    }
+}
+
+std::string SslError() {
+    unsigned long code = ERR_get_error();
+    if (code == 0) {
+        return "unknown error";
+    }
+    char buffer[256];
+    ERR_error_string_n(code, buffer, sizeof(buffer));
+    return buffer;
+}
+
+}  // namespace
+
+bool ParseMqttEndpoint(const std::string& endpoint, MqttConfig* config) {
+    std::string rest = endpoint;
+    bool tls = false;
+    bool scheme = false;
+    if (rest.compare(0, 8, "mqtts://") == 0) {
+        tls = true;
+        scheme = true;
+        rest = rest.substr(8);
+    } else if (rest.compare(0, 7, "mqtt://") == 0) {
+        scheme = true;
+        rest = rest.substr(7);
+    }
+    size_t slash = rest.find('/');
+    if (slash != std::string::npos) {
+        rest.resize(slash);
+    }
+    int port = tls ? 8883 : 1883;
+    size_t colon = rest.rfind(':');
+    if (colon != std::string::npos) {
+        char* end = nullptr;
+        long value = std::strtol(rest.c_str() + colon + 1, &end, 10);
+        if (end == rest.c_str() + colon + 1 || *end != '\0' || value <= 0 || value > 65535) {
+            return false;
+        }
+        port = static_cast<int>(value);
+        rest.resize(colon);
+    }
+    if (rest.empty()) {
+        return false;
+    }
+    config->host = rest;
+    config->port = static_cast<uint16_t>(port);
+    // 没有写协议时按惯例的端口判断：8883 为 MQTT over TLS
+    config->tls = scheme ? tls : port == 8883;
+    return true;
+}
+
+MqttClient::MqttClient(const MqttConfig& config) : config_(config), rng_(std::random_device{}()) {
+    config_.subscribe_qos = std::clamp(config_.subscribe_qos, 0, 1);
+    config_.publish_qos = std::clamp(config_.publish_qos, 0, 1);
+}
+
+MqttClient::~MqttClient() {
+    Stop(std::chrono::milliseconds(0));
+    if (ssl_ctx_ != nullptr) {
+        SSL_CTX_free(ssl_ctx_);
+    }
+}
+
+bool MqttClient::Start() {
+    if (running_) {
+        return true;
+    }
+    if (config_.host.empty()) {
+        ERROR("MQTT: no broker address");
+        return false;
+    }
+    if (pipe2(wake_pipe_, O_NONBLOCK | O_CLOEXEC) != 0) {
+        ERROR("MQTT: pipe failed: {}", strerror(errno));
+        return false;
+    }
+    running_ = true;
+    stopping_ = false;
+    thread_ = std::thread(&MqttClient::Run, this);
+    return true;
+}
+
+void MqttClient::Stop(std::chrono::milliseconds timeout) {
+    if (!running_) {
+        return;
+    }
+    stop_timeout_ms_ = std::max<int64_t>(0, timeout.count());
+    stopping_ = true;
+    Wake();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    running_ = false;
+    close(wake_pipe_[0]);
+    close(wake_pipe_[1]);
+    wake_pipe_[0] = wake_pipe_[1] = -1;
+}
+
+bool MqttClient::Publish(std::string_view topic, std::string_view payload) {
+    if (!connected_) {
+        publish_drops_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    std::string body;
+    body.reserve(2 + topic.size() + 2 + payload.size());
+    AppendString(&body, topic);
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        if (config_.publish_qos > 0) {
+            packet_id_ = packet_id_ == 0xffff ? 1 : packet_id_ + 1;  // 0 不是合法的报文标识
+            AppendU16(&body, packet_id_);
+        }
+        body.append(payload.data(), payload.size());
+        if (pending_.size() + body.size() + 5 > config_.max_pending_bytes) {
+            publish_drops_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        AppendPacket(&pending_, static_cast<uint8_t>(kPublish << 4 | config_.publish_qos << 1), body);
+    }
+    published_.fetch_add(1, std::memory_order_relaxed);
+    Wake();
+    return true;
+}
+
+MqttStats MqttClient::GetStats() const {
+    MqttStats stats;
+    stats.connections = connections_.load(std::memory_order_relaxed);
+    stats.connect_errors = connect_errors_.load(std::memory_order_relaxed);
+    stats.disconnects = disconnects_.load(std::memory_order_relaxed);
+    stats.published = published_.load(std::memory_order_relaxed);
+    stats.publish_drops = publish_drops_.load(std::memory_order_relaxed);
+    stats.received = received_.load(std::memory_order_relaxed);
+    stats.pings = pings_.load(std::memory_order_relaxed);
+    stats.ping_timeouts = ping_timeouts_.load(std::memory_order_relaxed);
+    stats.bytes_sent = bytes_sent_.load(std::memory_order_relaxed);
+    stats.bytes_received = bytes_received_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void MqttClient::Run() {
+    while (!stopping_) {
+        if (!Connect()) {
+            CloseConnection();
+            if (stopping_) {
+                break;
+            }
+            connect_errors_.fetch_add(1, std::memory_order_relaxed);
+            reconnecting_ = config_.reconnect && !stopping_;
+            if (on_connect_error_) {
+                on_connect_error_();
+            }
+            if (!WaitReconnect()) {
+                break;
+            }
+            continue;
+        }
+        attempt_ = 0;
+        reconnecting_ = false;
+        INFO("MQTT connected to {}:{}{}", config_.host, config_.port, config_.tls ? " (tls)" : "");
+        if (on_connect_) {
+            on_connect_();
+        }
+        Serve();
+        connected_ = false;
+        CloseConnection();
+        disconnects_.fetch_add(1, std::memory_order_relaxed);
+        reconnecting_ = config_.reconnect && !stopping_;
+        INFO("MQTT connection closed");
+        if (on_disconnect_) {
+            on_disconnect_();
+        }
+        if (!WaitReconnect()) {
+            break;
+        }
+    }
+    reconnecting_ = false;
+}
+
+bool MqttClient::Connect() {
+    auto deadline = std::chrono::steady_clock::now() + config_.connect_timeout;
+    if (!ConnectTcp(deadline) || (config_.tls && !ConnectTls(deadline))) {
+        return false;
+    }
+    out_.clear();
+    rx_.clear();
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        pending_.clear();  // 上一个连接上没有写出的报文随连接失效
+    }
+
+    std::string body;
+    AppendString(&body, "MQTT");
+    body.push_back(4);  // 协议级别：3.1.1
+    uint8_t flags = 0x02;  // clean session
+    if (!config_.username.empty()) {
+        flags |= 0x80 | (config_.password.empty() ? 0 : 0x40);
+    }
+    body.push_back(static_cast<char>(flags));
+    AppendU16(&body, static_cast<uint16_t>(std::min<int64_t>(config_.keepalive.count(), 0xffff)));
+    AppendString(&body, config_.client_id);
+    if (!config_.username.empty()) {
+        AppendString(&body, config_.username);
+        if (!config_.password.empty()) {
+            AppendString(&body, config_.password);
+        }
+    }
+    AppendPacket(&out_, kConnect << 4, body);
+    while (!out_.empty()) {
+        if (!Flush() || (!out_.empty() && !WaitFd(POLLOUT, deadline))) {
+            WARN("MQTT: failed to send CONNECT to {}", config_.host);
+            return false;
+        }
+    }
+
+    uint8_t header = 0;
+    std::string ack;
+    if (!ReadPacket(&header, &ack, deadline)) {
+        WARN("MQTT: no CONNACK from {} within {}ms", config_.host, config_.connect_timeout.count());
+        return false;
+    }
+    if ((header >> 4) != kConnack || ack.size() < 2) {
+        WARN("MQTT: unexpected packet type {} instead of CONNACK", header >> 4);
+        return false;
+    }
+    uint8_t code = static_cast<uint8_t>(ack[1]);
+    if (code != 0) {
+        ERROR("MQTT: connection refused by {}: {}", config_.host, ConnackReason(code));
+        return false;
+    }
+
+    if (!config_.subscribe_topic.empty()) {
+        // SUBACK 在收发循环中处理：订阅之后代理才会转发这个主题上的消息
+        std::string subscribe;
+        {
+            std::lock_guard<ProfiledMutex> lock(mutex_);
+            packet_id_ = packet_id_ == 0xffff ? 1 : packet_id_ + 1;
+            AppendU16(&subscribe, packet_id_);
+        }
+        AppendString(&subscribe, config_.subscribe_topic);
+        subscribe.push_back(static_cast<char>(config_.subscribe_qos));
+        AppendPacket(&out_, kSubscribe << 4 | 0x02, subscribe);  // SUBSCRIBE 的固定头标志位规定为 0010
+    }
+    connected_ = true;
+    connections_.fetch_add(1, std::memory_order_relaxed);
+    ping_outstanding_ = false;
+    last_tx_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool MqttClient::ConnectTcp(std::chrono::steady_clock::time_point deadline) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    std::string port = std::to_string(config_.port);
+    int rc = getaddrinfo(config_.host.c_str(), port.c_str(), &hints, &result);
+    if (rc != 0) {
+        WARN("MQTT: cannot resolve {}: {}", config_.host, gai_strerror(rc));
+        return false;
+    }
+    for (struct addrinfo* ai = result; ai != nullptr && !stopping_; ai = ai->ai_next) {
+        fd_ = socket(ai->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd_ < 0) {
+            continue;
+        }
+        if (connect(fd_, ai->ai_addr, ai->ai_addrlen) == 0 || (errno == EINPROGRESS && WaitFd(POLLOUT, deadline))) {
+            int error = 0;
+            socklen_t len = sizeof(error);
+            if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0) {
+                int one = 1;
+                setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));  // 控制消息很小，不等 Nagle 合并
+                freeaddrinfo(result);
+                return true;
+            }
+        }
+        close(fd_);
+        fd_ = -1;
+    }
+    freeaddrinfo(result);
+    WARN("MQTT: cannot connect to {}:{}", config_.host, config_.port);
+    return false;
+}
+
+bool MqttClient::ConnectTls(std::chrono::steady_clock::time_point deadline) {
+    if (ssl_ctx_ == nullptr) {
+        ssl_ctx_ = SSL_CTX_new(TLS_client_method());
+        if (ssl_ctx_ == nullptr) {
+            ERROR("MQTT: SSL_CTX_new failed: {}", SslError());
+            return false;
+        }
+        SSL_CTX_set_min_proto_version(ssl_ctx_, TLS1_2_VERSION);
+        if (config_.verify_peer) {
+            bool loaded = config_.ca_file.empty()
+                              ? SSL_CTX_set_default_verify_paths(ssl_ctx_) == 1
+                              : SSL_CTX_load_verify_locations(ssl_ctx_, config_.ca_file.c_str(), nullptr) == 1;
+            if (!loaded) {
+                WARN("MQTT: cannot load CA certificates{}: {}", config_.ca_file.empty() ? "" : " " + config_.ca_file,
+                     SslError());
+            }
+            SSL_CTX_set_verify(ssl_ctx_, SSL_VERIFY_PEER, nullptr);
+        }
+    }
+    ssl_ = SSL_new(ssl_ctx_);
+    if (ssl_ == nullptr) {
+        ERROR("MQTT: SSL_new failed: {}", SslError());
+        return false;
+    }
+    SSL_set_fd(ssl_, fd_);
+    SSL_set_tlsext_host_name(ssl_, config_.host.c_str());
+    if (config_.verify_peer) {
+        SSL_set1_host(ssl_, config_.host.c_str());
+    }
+    // 非阻塞写：允许部分写出，重试时缓冲区地址可以变化（out_ 在两次写之间可能扩容）
+    SSL_set_mode(ssl_, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    for (;;) {
+        int rc = SSL_connect(ssl_);
+        if (rc == 1) {
+            return true;
+        }
+        int error = SSL_get_error(ssl_, rc);
+        if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) {
+            if (!WaitFd(error == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT, deadline)) {
+                WARN("MQTT: TLS handshake with {} timed out", config_.host);
+                return false;
+            }
+            continue;
+        }
+        long verify = SSL_get_verify_result(ssl_);
+        if (verify != X509_V_OK) {
+            ERROR("MQTT: certificate verification for {} failed: {}", config_.host,
+                  X509_verify_cert_error_string(verify));
+        } else {
+            ERROR("MQTT: TLS handshake with {} failed: {}", config_.host, SslError());
+        }
+        return false;
+    }
+}
+
+void MqttClient::Serve() {
+    char buffer[4096];
+    while (!stopping_) {
+        {
+            std::lock_guard<ProfiledMutex> lock(mutex_);
+            out_ += pending_;
+            pending_.clear();
+        }
+        if (!out_.empty() && !Flush()) {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (ping_outstanding_ && now - ping_sent_ >= config_.ping_timeout) {
+            WARN("MQTT: no PINGRESP within {}ms, reconnecting", config_.ping_timeout.count());
+            ping_timeouts_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        bool keepalive = config_.keepalive.count() > 0;  // 0 表示不使用心跳
+        if (keepalive && !ping_outstanding_ && now - last_tx_ >= config_.keepalive) {
+            // keepalive 内没有发出任何报文：发一个 PINGREQ，代理由此确认连接仍然可用
+            AppendPacket(&out_, kPingreq << 4, std::string());
+            pings_.fetch_add(1, std::memory_order_relaxed);
+            ping_outstanding_ = true;
+            ping_sent_ = now;
+            continue;
+        }
+        auto next = ping_outstanding_ ? ping_sent_ + config_.ping_timeout
+                    : keepalive       ? last_tx_ + config_.keepalive
+                                      : now + std::chrono::seconds(60);
+        long timeout_ms =
+            std::max<long>(0, static_cast<long>(std::ceil(std::chrono::duration<double, std::milli>(next - now).count())));
+
+        struct pollfd fds[2];
+        fds[0].fd = fd_;
+        fds[0].events = static_cast<short>(POLLIN | (out_.empty() && !want_write_ ? 0 : POLLOUT));
+        fds[0].revents = 0;
+        fds[1].fd = wake_pipe_[0];
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        int ready = poll(fds, 2, static_cast<int>(std::min<long>(timeout_ms, 60000)));
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ERROR("MQTT: poll failed: {}", strerror(errno));
+            return;
+        }
+        if (fds[1].revents & POLLIN) {
+            char drain[64];
+            while (read(wake_pipe_[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            for (;;) {
+                long n = ReadSome(buffer, sizeof(buffer));
+                if (n < 0) {
+                    return;  // 代理关闭了连接或读出错
+                }
+                if (n == 0) {
+                    break;
+                }
+                rx_.append(buffer, static_cast<size_t>(n));
+            }
+            if (!ProcessInput()) {
+                return;
+            }
+        }
+    }
+    // Stop：尽量发出 DISCONNECT，代理据此不再等待心跳超时（也不发布遗嘱）
+    if (stop_timeout_ms_ > 0) {
+        {
+            std::lock_guard<ProfiledMutex> lock(mutex_);
+            out_ += pending_;  // Stop 之前发布的消息（如 goodbye）排在 DISCONNECT 之前
+            pending_.clear();
+        }
+        AppendPacket(&out_, kDisconnect << 4, std::string());
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(stop_timeout_ms_.load());
+        while (!out_.empty() && Flush() && !out_.empty() && WaitFd(POLLOUT, deadline, false)) {
+        }
+    }
+}
+
+void MqttClient::CloseConnection() {
+    if (ssl_ != nullptr) {
+        SSL_free(ssl_);
+        ssl_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    want_write_ = false;
+    out_.clear();
+    rx_.clear();
+}
+
+bool MqttClient::WaitReconnect() {
+    if (!config_.reconnect || stopping_) {
+        return false;
+    }
+    double delay_ms = static_cast<double>(config_.initial_delay.count()) *
+                      std::pow(config_.multiplier, static_cast<double>(std::min(attempt_, 30u)));
+    delay_ms = std::min(delay_ms, static_cast<double>(config_.max_delay.count()));
+    std::uniform_real_distribution<double> jitter(0.0, std::clamp(config_.jitter, 0.0, 1.0));
+    delay_ms *= 1.0 - jitter(rng_);
+    ++attempt_;
+    INFO("MQTT reconnect in {:.0f}ms (attempt {})", delay_ms, attempt_);
+    struct pollfd wake = {wake_pipe_[0], POLLIN, 0};
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(static_cast<int64_t>(delay_ms));
+    while (!stopping_) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            break;
+        }
+        int ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count()) + 1;
+        if (poll(&wake, 1, ms) > 0) {
+            char drain[64];
+            while (read(wake_pipe_[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+    }
+    return !stopping_;
+}
+
+bool MqttClient::WaitFd(short events, std::chrono::steady_clock::time_point deadline, bool interruptible) {
+    struct pollfd fds[2];
+    fds[0].fd = fd_;
+    fds[0].events = events;
+    fds[1].fd = wake_pipe_[0];
+    fds[1].events = POLLIN;
+    for (;;) {
+        if (interruptible && stopping_) {
+            return false;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return false;
+        }
+        int ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count()) + 1;
+        fds[0].revents = fds[1].revents = 0;
+        int ready = poll(fds, interruptible ? 2 : 1, ms);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (fds[0].revents != 0) {
+            return (fds[0].revents & (events | POLLHUP | POLLERR)) != 0;
+        }
+        if (fds[1].revents & POLLIN) {
+            char drain[64];
+            while (read(wake_pipe_[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+    }
+}
+
+long MqttClient::ReadSome(char* buffer, size_t len) {
+    if (ssl_ != nullptr) {
+        want_write_ = false;
+        int n = SSL_read(ssl_, buffer, static_cast<int>(len));
+        if (n > 0) {
+            bytes_received_.fetch_add(n, std::memory_order_relaxed);
+            return n;
+        }
+        int error = SSL_get_error(ssl_, n);
+        if (error == SSL_ERROR_WANT_READ) {
+            return 0;
+        }
+        if (error == SSL_ERROR_WANT_WRITE) {
+            want_write_ = true;
+            return 0;
+        }
+        if (error != SSL_ERROR_ZERO_RETURN) {
+            WARN("MQTT: TLS read failed: {}", SslError());
+        }
+        return -1;
+    }
+    ssize_t n = recv(fd_, buffer, len, 0);
+    if (n > 0) {
+        bytes_received_.fetch_add(n, std::memory_order_relaxed);
+        return n;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return 0;
+    }
+    if (n < 0) {
+        WARN("MQTT: read failed: {}", strerror(errno));
+    }
+    return -1;
+}
+
+long MqttClient::WriteSome(const char* data, size_t len) {
+    if (ssl_ != nullptr) {
+        want_write_ = false;
+        int n = SSL_write(ssl_, data, static_cast<int>(std::min<size_t>(len, 1 << 30)));
+        if (n > 0) {
+            return n;
+        }
+        int error = SSL_get_error(ssl_, n);
+        if (error == SSL_ERROR_WANT_WRITE || error == SSL_ERROR_WANT_READ) {
+            want_write_ = error == SSL_ERROR_WANT_WRITE;
+            return 0;
+        }
+        WARN("MQTT: TLS write failed: {}", SslError());
+        return -1;
+    }
+    ssize_t n = send(fd_, data, len, MSG_NOSIGNAL);
+    if (n >= 0) {
+        return n;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        return 0;
+    }
+    WARN("MQTT: write failed: {}", strerror(errno));
+    return -1;
+}
+
+bool MqttClient::Flush() {
+    size_t done = 0;
+    while (done < out_.size()) {
+        long n = WriteSome(out_.data() + done, out_.size() - done);
+        if (n < 0) {
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    if (done > 0) {
+        out_.erase(0, done);
+        bytes_sent_.fetch_add(done, std::memory_order_relaxed);
+        last_tx_ = std::chrono::steady_clock::now();
+    }
+    return true;
+}
+
+bool MqttClient::ProcessInput() {
+    size_t offset = 0;
+    bool ok = true;
+    while (ok) {
+        size_t header_len = 0;
+        size_t body_len = 0;
+        std::string_view view(rx_.data() + offset, rx_.size() - offset);
+        int state = ParseFixedHeader(view, &header_len, &body_len);
+        if (state < 0 || body_len > config_.max_packet) {
+            WARN("MQTT: malformed or oversized packet ({} bytes), closing connection", body_len);
+            return false;
+        }
+        if (state == 0) {
+            break;
+        }
+        ok = HandlePacket(static_cast<uint8_t>(view[0]), view.data() + header_len, body_len);
+        offset += header_len + body_len;
+    }
+    rx_.erase(0, offset);
+    return ok;
+}
+
+bool MqttClient::HandlePacket(uint8_t header, const char* body, size_t len) {
+    switch (header >> 4) {
+        case kPublish: {
+            int qos = (header >> 1) & 0x03;
+            if (len < 2 || 2 + static_cast<size_t>(ReadU16(body)) > len) {
+                WARN("MQTT: malformed PUBLISH");
+                return false;
+            }
+            size_t topic_len = ReadU16(body);
+            std::string_view topic(body + 2, topic_len);
+            size_t pos = 2 + topic_len;
+            if (qos > 0) {
+                if (pos + 2 > len) {
+                    WARN("MQTT: malformed PUBLISH");
+                    return false;
+                }
+                std::string ack;
+                ack.append(body + pos, 2);
+                pos += 2;
+                if (qos == 1) {
+                    AppendPacket(&out_, kPuback << 4, ack);
+                } else {
+                    // 订阅时请求的最高 QoS 为 1，合规的代理不会以 QoS 2 转发
+                    WARN("MQTT: QoS 2 PUBLISH is not supported, ignored");
+                    return true;
+                }
+            }
+            received_.fetch_add(1, std::memory_order_relaxed);
+            if (on_message_) {
+                on_message_(topic, std::string_view(body + pos, len - pos));
+            }
+            return true;
+        }
+        case kSuback:
+            if (len >= 3 && static_cast<uint8_t>(body[2]) == 0x80) {
+                ERROR("MQTT: subscription to {} rejected", config_.subscribe_topic);
+            }
+            return true;
+        case kPingresp:
+            ping_outstanding_ = false;
+            return true;
+        case kPuback:
+            return true;
+        default:
+            WARN("MQTT: unexpected packet type {}, closing connection", header >> 4);
+            return false;
+    }
+}
+
+bool MqttClient::ReadPacket(uint8_t* header, std::string* body, std::chrono::steady_clock::time_point deadline) {
+    char buffer[512];
+    for (;;) {
+        size_t header_len = 0;
+        size_t body_len = 0;
+        int state = ParseFixedHeader(rx_, &header_len, &body_len);
+        if (state < 0 || body_len > config_.max_packet) {
+            return false;
+        }
+        if (state > 0) {
+            *header = static_cast<uint8_t>(rx_[0]);
+            body->assign(rx_, header_len, body_len);
+            rx_.erase(0, header_len + body_len);
+            return true;
+        }
+        long n = ReadSome(buffer, sizeof(buffer));
+        if (n < 0) {
+            return false;
+        }
+        if (n > 0) {
+            rx_.append(buffer, static_cast<size_t>(n));
+            continue;
+        }
+        if (!WaitFd(want_write_ ? POLLOUT : POLLIN, deadline)) {
+            return false;
+        }
+    }
+}
+
+void MqttClient::AppendPacket(std::string* out, uint8_t header, const std::string& body) {
+    out->push_back(static_cast<char>(header));
+    size_t length = body.size();
+    do {
+        uint8_t byte = length % 128;
+        length /= 128;
+        if (length > 0) {
+            byte |= 0x80;
+        }
+        out->push_back(static_cast<char>(byte));
+    } while (length > 0);
+    out->append(body);
+}
+
+void MqttClient::Wake() {
+    if (wake_pipe_[1] >= 0) {
+        char c = 1;
+        ssize_t n = write(wake_pipe_[1], &c, 1);  // 管道满时已有未处理的唤醒
+        (void)n;
+    }
+}
+
+}  // namespace linx
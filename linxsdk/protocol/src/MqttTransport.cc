@@ -0,0 +1,53 @@
+#include "MqttTransport.h"
+
+#include "Log.h"
+
+namespace linx {
+
+MqttTransport::MqttTransport(const MqttConfig& config, std::string publish_topic)
+    : client_(config), publish_topic_(std::move(publish_topic)) {
+    client_.SetOnConnect([this]() {
+        if (!on_open_messages_) {
+            return;
+        }
+        for (const auto& message : on_open_messages_()) {
+            client_.Publish(publish_topic_, message);
+        }
+    });
+    client_.SetOnMessage([this](std::string_view, std::string_view payload) {
+        if (on_message_) {
+            on_message_(payload, false);  // 控制通道上只有文本消息
+        }
+    });
+    client_.SetOnDisconnect([this]() {
+        if (on_close_) {
+            on_close_();
+        }
+    });
+    client_.SetOnConnectError([this]() {
+        if (on_fail_) {
+            on_fail_();
+        }
+    });
+}
+
+void MqttTransport::Start() {
+    if (publish_topic_.empty()) {
+        WARN("MQTT transport has no publish topic, control messages will be dropped");
+    }
+    client_.Start();
+}
+
+bool MqttTransport::Close(std::chrono::milliseconds timeout) {
+    client_.Stop(timeout);
+    return true;
+}
+
+bool MqttTransport::SendText(std::string_view message) {
+    if (publish_topic_.empty()) {
+        return false;
+    }
+    return client_.Publish(publish_topic_, message);
+}
+
+}  // namespace linx
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace linx {
+
+class Reactor;
+
+struct ControlServerConfig {
+    std::string path;          // Unix 域套接字路径（启动时删除同名旧文件）
+    unsigned int mode = 0660;  // 套接字文件权限，同组的界面进程可以连接
+    size_t max_clients = 8;    // 同时连接的客户端上限，超出时新连接直接关闭
+    size_t max_line = 512;     // 一行命令的最大字节数，超出时断开这个客户端
+    size_t max_output = 64 * 1024;  // 一个客户端未发出的回复上限，读得太慢的客户端被断开
+};
+
+struct ControlServerStats {
+    uint64_t accepted = 0;   // 接受的连接数
+    uint64_t rejected = 0;   // 超出 max_clients 被关闭的连接数
+    uint64_t commands = 0;   // 执行的命令数（含未知命令）
+    uint64_t errors = 0;     // 回复 err 的命令数
+    uint64_t events = 0;     // 向订阅者广播的事件数
+    size_t clients = 0;      // 当前连接数
+};
+
+// 本地控制端点：同一设备上的界面/集成程序通过 Unix 域套接字控制正在运行的进程，不需要重启。
+// 行协议，一行一条命令，空格分隔参数，每条命令按顺序回复一行：
+//   "<命令> [参数...]\n"  ->  "ok [结果]\n" 或 "err <原因>\n"
+// 连接可以长期保持、连续发送多条命令（可流水线发送），也可以 nc -U / socat 一次性调用；
+// 发送 "subscribe" 后这条连接还会收到 Broadcast 的事件行 "event <内容>\n"（如会话状态变化），界面不需要轮询。
+// 监听和全部连接都注册在 Reactor 上，命令处理函数在 reactor 线程上执行，不另开线程；
+// 套接字非阻塞，写不出的回复在这个连接上排队，等 POLLOUT 再发。
+// AddCommand 须在 Start 之前调用；Broadcast 可在任意线程调用
+class ControlServer {
+public:
+    // 命令处理函数：args 为命令名之后的部分（已去掉首尾空白），返回 true 时回复 "ok <reply>"，否则 "err <reply>"
+    using Handler = std::function<bool(std::string_view args, std::string* reply)>;
+
+    explicit ControlServer(const ControlServerConfig& config);
+    ~ControlServer();
+
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    // 注册命令；同名时替换。内置命令 help（列出全部命令）和 subscribe / unsubscribe
+    void AddCommand(const std::string& name, Handler handler);
+
+    // 创建监听套接字并注册到 reactor，失败返回 false
+    bool Start(Reactor& reactor);
+    // 关闭监听和全部连接；reactor 在其他线程运行时投递到 reactor 线程执行并等待完成
+    void Stop();
+    bool Running() const { return running_; }
+
+    // 向全部订阅的连接发送一行 "event <line>"
+    void Broadcast(std::string line);
+
+    ControlServerStats GetStats() const;
+    const std::string& Path() const { return config_.path; }
+
+private:
+    struct Client {
+        int fd = -1;
+        std::string input;   // 未处理完的输入（不完整的一行）
+        std::string output;  // 未发出的回复
+        bool subscribed = false;
+    };
+
+    int Listen();
+    void Accept();
+    void OnClient(int fd, short revents);
+    void HandleLine(Client& client, std::string_view line);
+    void Queue(Client& client, std::string_view text);
+    bool Flush(Client& client);
+    void CloseClient(int fd);
+    void Teardown();
+
+    ControlServerConfig config_;
+    std::map<std::string, Handler> commands_;
+    Reactor* reactor_ = nullptr;
+    int listen_fd_ = -1;
+    std::map<int, std::unique_ptr<Client>> clients_;  // 仅 reactor 线程访问
+    std::atomic<bool> running_{false};
+
+    std::atomic<uint64_t> accepted_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> commands_run_{0};
+    std::atomic<uint64_t> errors_{0};
+    std::atomic<uint64_t> events_{0};
+    std::atomic<size_t> client_count_{0};
+};
+
+}  // namespace linx
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "AudioProfile.h"
+#include "JitterBuffer.h"
+#include "Opus.h"
+#include "ThreadPolicy.h"
+
+namespace linx {
+
+// 一类设备的整套调优参数：帧长 / 设备周期、编码参数、抖动缓冲目标、音频线程策略和上行处理级，
+// 作为一个整体选择，不再分散在各处的常量里。
+// 帧长、周期、线程策略、省电和处理级在打开设备、启动线程时确定，改变后要重启才生效；
+// 编码参数和抖动缓冲目标可以在运行中重新加载（CapturePump::SetEncoderConfig、JitterBuffer::SetDelayLimits）
+struct DeviceProfile {
+    std::string name = "normal";
+
+    // 需要重启的部分
+    int frame_ms = 60;             // Opus 帧时长，hello 中的 frame_duration
+    int period_ms = 20;            // 设备周期时长，frame_ms 须为它的整数倍
+    int periods = 6;               // 设备缓冲区的周期数
+    ThreadPolicy audio_thread;     // 音频 I/O 线程的调度策略
+    int idle_suspend_ms = 0;       // 省电空闲延迟，0 表示关闭
+    bool silence_fill = false;     // 由驱动补静音
+    bool noise_suppression = false;
+    bool auto_gain = false;
+
+    // 运行中可重新加载的部分
+    OpusEncoderConfig codec = OpusEncoderConfig::Balanced();
+    int jitter_min_ms = 60;        // 抖动缓冲目标延迟的下限 / 初始值 / 上限
+    int jitter_initial_ms = 120;
+    int jitter_max_ms = 600;
+    int playout_start_ms = 120;    // 每段 TTS 开始播放前至少缓冲的时长（起播门限）
+
+    // 内置配置："normal" / "low-latency" / "battery" / "far-field"，未知名称返回 false 且不修改 *out
+    static bool Builtin(const std::string& name, DeviceProfile* out);
+    static std::vector<std::string> BuiltinNames();
+
+    // 按本配置的帧长和周期生成音频流水线参数（20ms 及以下的帧视为低延迟模式）
+    AudioProfile Audio(unsigned int sample_rate, int channels) const;
+    // 写入抖动缓冲区的延迟参数，其余字段（采样率、容量等）保持不变
+    void ApplyTo(JitterBufferConfig* config) const;
+    // 与 other 相比，需要重启才能生效的字段有变化时返回 true，变化的字段名写入 *fields（逗号分隔）
+    bool RestartRequired(const DeviceProfile& other, std::string* fields = nullptr) const;
+    // 检查参数是否自洽，出错时写入 *error
+    bool Validate(std::string* error) const;
+};
+
+// 配置文件中的一组命名配置（JSON）：
+//   {
+//     "profile": "battery",                        // 默认选择的配置
+//     "profiles": {
+//       "battery": {"codec": {"bitrate": 12000}},  // 与内置配置同名时在内置配置基础上修改
+//       "kiosk": {"base": "far-field", "frame_ms": 20, "period_ms": 10, "periods": 4,
+//                 "audio_thread": "fifo:70@1", "jitter": {"min_ms": 40, "max_ms": 300}}
+//     }
+//   }
+// 每个配置以 base（默认同名的内置配置，否则 normal）为模板，只覆盖写出的字段；base 也可以是文件中的其他配置。
+// 字段：frame_ms、period_ms、periods、audio_thread（ThreadPolicy::Parse 的格式）、idle_suspend_ms、silence_fill、
+// ns、agc、codec {preset、bitrate、complexity、dtx、fec、loss_perc}、jitter {min_ms、initial_ms、max_ms、start_ms}
+class DeviceProfileSet {
+public:
+    // 读取并解析配置文件，失败时写入 *error 且不修改已有内容
+    bool LoadFile(const std::string& path, std::string* error);
+    bool Parse(const std::string& text, std::string* error);
+
+    // 按名称取配置：文件中定义的优先，其次是内置配置；name 为空时取文件的 "profile"，未指定时为 normal
+    bool Find(const std::string& name, DeviceProfile* out) const;
+
+    const std::string& DefaultName() const { return default_name_; }
+    // 文件中定义的配置名
+    std::vector<std::string> Names() const;
+
+private:
+    std::string default_name_ = "normal";
+    std::map<std::string, DeviceProfile> profiles_;
+};
+
+}  // namespace linx
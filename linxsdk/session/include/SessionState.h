@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "LockProfiler.h"
+
+namespace linx {
+
+// 录音（语音识别）状态
+enum class ListenState : uint8_t {
+    Stop = 0,
+    Start,
+};
+
+// 服务器下发的 TTS 状态（tts 消息的 state 字段）
+enum class TtsState : uint8_t {
+    Idle = 0,
+    Start,
+    SentenceStart,
+    SentenceEnd,
+    Stop,
+};
+
+const char* ListenStateName(ListenState state);
+const char* TtsStateName(TtsState state);
+// 解析协议中的状态字符串，未知取值返回 false
+bool ParseListenState(std::string_view text, ListenState* state);
+bool ParseTtsState(std::string_view text, TtsState* state);
+
+// 某一时刻的完整会话状态
+struct SessionSnapshot {
+    ListenState listen = ListenState::Stop;
+    TtsState tts = TtsState::Idle;
+    uint64_t generation = 0;  // 会话 ID 每变化一次加一
+
+    bool Listening() const { return listen == ListenState::Start; }
+};
+
+// 会话状态机：录音状态、TTS 状态和会话代数打包在一个独占缓存行的 64 位原子量里，
+// 采集/播放等热路径每帧只做一次原子读，不加锁、不比较字符串；写入用 CAS，任意线程可调用。
+// 会话 ID 本身是字符串，由互斥锁保护，只在收发控制消息时访问；是否换了会话由代数判断即可。
+// 每次实际发生的状态变化在写入线程上回调 TransitionHandler。
+class SessionState {
+public:
+    using TransitionHandler = std::function<void(const SessionSnapshot& from, const SessionSnapshot& to)>;
+
+    SessionState() = default;
+
+    SessionState(const SessionState&) = delete;
+    SessionState& operator=(const SessionState&) = delete;
+
+    // 热路径读取：单次原子读
+    SessionSnapshot Snapshot() const { return Unpack(word_.load(std::memory_order_acquire)); }
+    bool Listening() const { return Snapshot().Listening(); }
+    ListenState Listen() const { return Snapshot().listen; }
+    TtsState Tts() const { return Snapshot().tts; }
+    uint64_t Generation() const { return Snapshot().generation; }
+
+    // 状态变化时返回 true 并回调 TransitionHandler
+    bool SetListen(ListenState state);
+    bool SetTts(TtsState state);
+
+    // 设置会话 ID；与当前不同时代数加一（空字符串表示会话结束），返回是否变化
+    bool SetSessionId(std::string_view session_id);
+    std::string SessionId() const;
+    bool IsSession(std::string_view session_id) const;
+
+    // 须在状态开始变化之前设置
+    void SetTransitionHandler(TransitionHandler handler) { handler_ = std::move(handler); }
+
+private:
+    static constexpr size_t kCacheLine = 64;
+    static constexpr int kTtsShift = 8;
+    static constexpr int kGenerationShift = 16;
+
+    static SessionSnapshot Unpack(uint64_t word) {
+        SessionSnapshot snapshot;
+        snapshot.listen = static_cast<ListenState>(word & 0xff);
+        snapshot.tts = static_cast<TtsState>((word >> kTtsShift) & 0xff);
+        snapshot.generation = word >> kGenerationShift;
+        return snapshot;
+    }
+    static uint64_t Pack(const SessionSnapshot& snapshot) {
+        return static_cast<uint64_t>(snapshot.listen) | (static_cast<uint64_t>(snapshot.tts) << kTtsShift) |
+               (snapshot.generation << kGenerationShift);
+    }
+
+    // 以 update 修改当前状态并 CAS 写回，状态变化时回调并返回 true
+    template <typename Update>
+    bool Transition(Update update);
+
+    alignas(kCacheLine) std::atomic<uint64_t> word_{0};
+
+    // 与 word_ 不在同一缓存行，收发控制消息时不干扰热路径的读取
+    alignas(kCacheLine) mutable ProfiledMutex id_mutex_{"session_id"};
+    std::string session_id_;
+    TransitionHandler handler_;
+};
+
+}  // namespace linx
@@ -0,0 +1,312 @@
+#include "ControlServer.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <future>
+#include <vector>
+
+#include "Log.h"
+#include "Reactor.h"
+
+namespace linx {
+
+namespace {
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  // macOS：改为在连接上设置 SO_NOSIGPIPE
+#endif
+
+std::string_view Trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+void SetNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+}  // namespace
+
+ControlServer::ControlServer(const ControlServerConfig& config) : config_(config) {}
+
+ControlServer::~ControlServer() { Stop(); }
+
+void ControlServer::AddCommand(const std::string& name, Handler handler) {
+    commands_[name] = std::move(handler);
+}
+
+int ControlServer::Listen() {
+    sockaddr_un addr{};
+    if (config_.path.empty() || config_.path.size() >= sizeof(addr.sun_path)) {
+        ERROR("ControlServer: invalid socket path: '{}'", config_.path);
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        ERROR("ControlServer: socket failed: {}", strerror(errno));
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, config_.path.c_str(), config_.path.size() + 1);
+    unlink(config_.path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+        ERROR("ControlServer: listen on {} failed: {}", config_.path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    chmod(config_.path.c_str(), static_cast<mode_t>(config_.mode));
+    SetNonBlocking(fd);
+    return fd;
+}
+
+bool ControlServer::Start(Reactor& reactor) {
+    if (running_) {
+        return true;
+    }
+    listen_fd_ = Listen();
+    if (listen_fd_ < 0) {
+        return false;
+    }
+    reactor_ = &reactor;
+    running_ = true;
+    reactor.AddFd(listen_fd_, POLLIN, [this](int, short) { Accept(); });
+    INFO("control socket: {}", config_.path);
+    return true;
+}
+
+void ControlServer::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (reactor_->Running() && !reactor_->InLoopThread()) {
+        // 连接只在 reactor 线程上访问
+        std::promise<void> done;
+        reactor_->Post([this, &done]() {
+            Teardown();
+            done.set_value();
+        });
+        done.get_future().wait();
+    } else {
+        Teardown();
+    }
+}
+
+void ControlServer::Teardown() {
+    reactor_->RemoveFd(listen_fd_);
+    close(listen_fd_);
+    listen_fd_ = -1;
+    unlink(config_.path.c_str());
+    while (!clients_.empty()) {
+        CloseClient(clients_.begin()->first);
+    }
+}
+
+void ControlServer::Accept() {
+    while (true) {
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;  // EAGAIN：本轮已全部接受
+        }
+        if (clients_.size() >= config_.max_clients) {
+            static const char kBusy[] = "err too many clients\n";
+            send(fd, kBusy, sizeof(kBusy) - 1, MSG_NOSIGNAL);
+            close(fd);
+            rejected_++;
+            continue;
+        }
+        SetNonBlocking(fd);
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        auto client = std::make_unique<Client>();
+        client->fd = fd;
+        clients_[fd] = std::move(client);
+        client_count_ = clients_.size();
+        accepted_++;
+        reactor_->AddFd(fd, POLLIN, [this](int client_fd, short revents) { OnClient(client_fd, revents); });
+    }
+}
+
+void ControlServer::OnClient(int fd, short revents) {
+    auto it = clients_.find(fd);
+    if (it == clients_.end()) {
+        return;
+    }
+    Client& client = *it->second;
+    bool closing = (revents & (POLLERR | POLLNVAL)) != 0;
+    if (!closing && (revents & (POLLIN | POLLHUP)) != 0) {
+        char buf[1024];
+        while (true) {
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                client.input.append(buf, static_cast<size_t>(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                closing = true;  // 对端关闭：先执行已收到的完整命令，再断开
+            }
+            break;
+        }
+        size_t start = 0;
+        size_t newline;
+        while ((newline = client.input.find('\n', start)) != std::string::npos) {
+            HandleLine(client, std::string_view(client.input).substr(start, newline - start));
+            start = newline + 1;
+        }
+        client.input.erase(0, start);
+        if (client.input.size() > config_.max_line) {
+            Queue(client, "err line too long\n");
+            closing = true;
+        }
+    }
+    bool flushed = Flush(client);
+    if (closing || !flushed) {
+        CloseClient(fd);
+        return;
+    }
+    reactor_->ModifyFd(fd, client.output.empty() ? POLLIN : POLLIN | POLLOUT);
+}
+
+void ControlServer::HandleLine(Client& client, std::string_view line) {
+    line = Trim(line);
+    if (line.empty()) {
+        return;
+    }
+    commands_run_++;
+    size_t space = line.find_first_of(" \t");
+    std::string name(line.substr(0, space));
+    std::string_view args = space == std::string_view::npos ? std::string_view() : Trim(line.substr(space + 1));
+    std::string reply;
+    bool ok = true;
+    if (name == "help") {
+        reply = "help subscribe unsubscribe";
+        for (const auto& command : commands_) {
+            reply += ' ';
+            reply += command.first;
+        }
+    } else if (name == "subscribe" || name == "unsubscribe") {
+        client.subscribed = name == "subscribe";
+    } else {
+        auto it = commands_.find(name);
+        if (it == commands_.end()) {
+            ok = false;
+            reply = "unknown command '" + name + "'";
+        } else {
+            ok = it->second(args, &reply);
+        }
+    }
+    if (!ok) {
+        errors_++;
+    }
+    // 回复只占一行：处理函数返回的多行文本把换行折成空格
+    for (char& c : reply) {
+        if (c == '\n' || c == '\r') {
+            c = ' ';
+        }
+    }
+    std::string text = ok ? "ok" : "err";
+    if (!reply.empty()) {
+        text += ' ';
+        text += reply;
+    }
+    text += '\n';
+    Queue(client, text);
+}
+
+void ControlServer::Queue(Client& client, std::string_view text) {
+    client.output.append(text.data(), text.size());
+}
+
+bool ControlServer::Flush(Client& client) {
+    size_t sent = 0;
+    while (sent < client.output.size()) {
+        ssize_t n = send(client.fd, client.output.data() + sent, client.output.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        return false;
+    }
+    client.output.erase(0, sent);
+    return client.output.size() <= config_.max_output;
+}
+
+void ControlServer::CloseClient(int fd) {
+    reactor_->RemoveFd(fd);
+    close(fd);
+    clients_.erase(fd);
+    client_count_ = clients_.size();
+}
+
+void ControlServer::Broadcast(std::string line) {
+    if (!running_) {
+        return;
+    }
+    auto send_event = [this, line = std::move(line)]() {
+        if (!running_) {
+            return;
+        }
+        events_++;
+        std::string text = "event " + line + "\n";
+        std::vector<int> slow;
+        for (auto& entry : clients_) {
+            Client& client = *entry.second;
+            if (!client.subscribed) {
+                continue;
+            }
+            Queue(client, text);
+            if (!Flush(client)) {
+                slow.push_back(entry.first);
+            } else if (!client.output.empty()) {
+                reactor_->ModifyFd(entry.first, POLLIN | POLLOUT);
+            }
+        }
+        for (int fd : slow) {
+            CloseClient(fd);
+        }
+    };
+    if (reactor_->InLoopThread()) {
+        send_event();
+    } else {
+        reactor_->Post(std::move(send_event));
+    }
+}
+
+ControlServerStats ControlServer::GetStats() const {
+    ControlServerStats stats;
+    stats.accepted = accepted_;
+    stats.rejected = rejected_;
+    stats.commands = commands_run_;
+    stats.errors = errors_;
+    stats.events = events_;
+    stats.clients = client_count_;
+    return stats;
+}
+
+}  // namespace linx
@@ -0,0 +1,350 @@
+#include "DeviceProfile.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "Json.h"
+
+namespace linx {
+
+namespace {
+
+constexpr int kMaxBaseDepth = 8;  // base 链的最大长度，防止循环引用
+
+bool ReadInt(const json& object, const char* key, int* value, std::string* error) {
+    auto it = object.find(key);
+    if (it == object.end()) {
+        return true;
+    }
+    if (!it->is_number_integer()) {
+        *error = std::string(key) + " must be an integer";
+        return false;
+    }
+    *value = it->get<int>();
+    return true;
+}
+
+bool ReadBool(const json& object, const char* key, bool* value, std::string* error) {
+    auto it = object.find(key);
+    if (it == object.end()) {
+        return true;
+    }
+    if (!it->is_boolean()) {
+        *error = std::string(key) + " must be true or false";
+        return false;
+    }
+    *value = it->get<bool>();
+    return true;
+}
+
+bool ReadString(const json& object, const char* key, std::string* value, std::string* error) {
+    auto it = object.find(key);
+    if (it == object.end()) {
+        return true;
+    }
+    if (!it->is_string()) {
+        *error = std::string(key) + " must be a string";
+        return false;
+    }
+    *value = it->get<std::string>();
+    return true;
+}
+
+bool ReadObject(const json& object, const char* key, const json** value, std::string* error) {
+    auto it = object.find(key);
+    if (it == object.end()) {
+        *value = nullptr;
+        return true;
+    }
+    if (!it->is_object()) {
+        *error = std::string(key) + " must be an object";
+        return false;
+    }
+    *value = &*it;
+    return true;
+}
+
+bool KnownPreset(const std::string& name) {
+    return name == "low-power" || name == "balanced" || name == "quality";
+}
+
+// 把 entry 中写出的字段覆盖到 *profile
+bool ApplyEntry(const json& entry, DeviceProfile* profile, std::string* error) {
+    if (!ReadInt(entry, "frame_ms", &profile->frame_ms, error) ||
+        !ReadInt(entry, "period_ms", &profile->period_ms, error) ||
+        !ReadInt(entry, "periods", &profile->periods, error) ||
+        !ReadInt(entry, "idle_suspend_ms", &profile->idle_suspend_ms, error) ||
+        !ReadBool(entry, "silence_fill", &profile->silence_fill, error) ||
+        !ReadBool(entry, "ns", &profile->noise_suppression, error) ||
+        !ReadBool(entry, "agc", &profile->auto_gain, error)) {
+        return false;
+    }
+    std::string thread;
+    if (!ReadString(entry, "audio_thread", &thread, error)) {
+        return false;
+    }
+    if (!thread.empty()) {
+        ThreadPolicy policy;
+        if (!ThreadPolicy::Parse(thread, &policy)) {
+            *error = "invalid audio_thread " + thread;
+            return false;
+        }
+        profile->audio_thread = policy;
+    }
+
+    const json* codec = nullptr;
+    if (!ReadObject(entry, "codec", &codec, error)) {
+        return false;
+    }
+    if (codec != nullptr) {
+        std::string preset;
+        if (!ReadString(*codec, "preset", &preset, error)) {
+            return false;
+        }
+        if (!preset.empty()) {
+            if (!KnownPreset(preset)) {
+                *error = "unknown codec preset " + preset;
+                return false;
+            }
+            profile->codec = OpusEncoderConfig::Preset(preset);
+        }
+        if (!ReadInt(*codec, "bitrate", &profile->codec.bitrate, error) ||
+            !ReadInt(*codec, "complexity", &profile->codec.complexity, error) ||
+            !ReadBool(*codec, "dtx", &profile->codec.dtx, error) ||
+            !ReadBool(*codec, "fec", &profile->codec.inband_fec, error) ||
+            !ReadInt(*codec, "loss_perc", &profile->codec.packet_loss_perc, error)) {
+            return false;
+        }
+    }
+
+    const json* jitter = nullptr;
+    if (!ReadObject(entry, "jitter", &jitter, error)) {
+        return false;
+    }
+    if (jitter != nullptr) {
+        if (!ReadInt(*jitter, "min_ms", &profile->jitter_min_ms, error) ||
+            !ReadInt(*jitter, "initial_ms", &profile->jitter_initial_ms, error) ||
+            !ReadInt(*jitter, "max_ms", &profile->jitter_max_ms, error) ||
+            !ReadInt(*jitter, "start_ms", &profile->playout_start_ms, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 解析文件中名为 name 的配置（先解析它的 base）
+bool Resolve(const json& entries, const std::string& name, int depth, DeviceProfile* out, std::string* error) {
+    if (depth > kMaxBaseDepth) {
+        *error = "base chain too long at " + name;
+        return false;
+    }
+    const json& entry = entries.at(name);
+    if (!entry.is_object()) {
+        *error = "profile " + name + " must be an object";
+        return false;
+    }
+    std::string base;
+    if (!ReadString(entry, "base", &base, error)) {
+        *error = "profile " + name + ": " + *error;
+        return false;
+    }
+    DeviceProfile profile;
+    if (base.empty()) {
+        if (!DeviceProfile::Builtin(name, &profile)) {
+            DeviceProfile::Builtin("normal", &profile);
+        }
+    } else if (base != name && entries.contains(base)) {
+        if (!Resolve(entries, base, depth + 1, &profile, error)) {
+            return false;
+        }
+    } else if (!DeviceProfile::Builtin(base, &profile)) {
+        *error = "profile " + name + ": unknown base " + base;
+        return false;
+    }
+    if (!ApplyEntry(entry, &profile, error)) {
+        *error = "profile " + name + ": " + *error;
+        return false;
+    }
+    profile.name = name;
+    *out = profile;
+    return true;
+}
+
+}  // namespace
+
+bool DeviceProfile::Builtin(const std::string& name, DeviceProfile* out) {
+    DeviceProfile profile;
+    profile.name = name;
+    if (name == "normal") {
+        // 默认值：60ms 帧、20ms x 6 周期，与 AudioProfile 的 normal 模式一致
+    } else if (name == "low-latency") {
+        // 20ms 帧、10ms 周期，实时调度音频线程（无权限时自动降级），抖动缓冲压到两三帧
+        profile.frame_ms = 20;
+        profile.period_ms = 10;
+        profile.periods = 4;
+        ThreadPolicy::Parse("fifo:70", &profile.audio_thread);
+        profile.jitter_min_ms = 40;
+        profile.jitter_initial_ms = 60;
+        profile.jitter_max_ms = 300;
+        profile.playout_start_ms = 60;
+    } else if (name == "battery") {
+        // 60ms 周期：每帧只唤醒一次；低复杂度编码，空闲时暂停设备，由驱动补静音
+        profile.period_ms = 60;
+        profile.periods = 3;
+        profile.idle_suspend_ms = 5000;
+        profile.silence_fill = true;
+        profile.codec = OpusEncoderConfig::LowPower();
+        profile.jitter_min_ms = 120;
+        profile.jitter_initial_ms = 180;
+        profile.jitter_max_ms = 800;
+        profile.playout_start_ms = 180;
+    } else if (name == "far-field") {
+        // 远场：降噪 + 自动增益，高质量编码给 ASR 留出余量，带内 FEC 抗丢包
+        profile.noise_suppression = true;
+        profile.auto_gain = true;
+        profile.codec = OpusEncoderConfig::Quality();
+        profile.codec.signal = OPUS_SIGNAL_VOICE;
+    } else {
+        return false;
+    }
+    *out = profile;
+    return true;
+}
+
+std::vector<std::string> DeviceProfile::BuiltinNames() {
+    return {"normal", "low-latency", "battery", "far-field"};
+}
+
+AudioProfile DeviceProfile::Audio(unsigned int sample_rate, int channels) const {
+    AudioProfile profile = AudioProfile::ForMode(frame_ms <= 20 ? LatencyMode::Low : LatencyMode::Normal,
+                                                 sample_rate, channels);
+    profile.frame_ms = frame_ms;
+    profile.period_ms = period_ms;
+    profile.periods = periods;
+    return profile;
+}
+
+void DeviceProfile::ApplyTo(JitterBufferConfig* config) const {
+    config->min_delay_ms = jitter_min_ms;
+    config->initial_delay_ms = jitter_initial_ms;
+    config->max_delay_ms = jitter_max_ms;
+    config->start_threshold_ms = playout_start_ms;
+}
+
+bool DeviceProfile::RestartRequired(const DeviceProfile& other, std::string* fields) const {
+    std::string changed;
+    auto check = [&changed](bool differs, const char* field) {
+        if (differs) {
+            changed += changed.empty() ? field : std::string(",") + field;
+        }
+    };
+    check(frame_ms != other.frame_ms, "frame_ms");
+    check(period_ms != other.period_ms, "period_ms");
+    check(periods != other.periods, "periods");
+    check(audio_thread.policy != other.audio_thread.policy || audio_thread.priority != other.audio_thread.priority ||
+              audio_thread.cpus != other.audio_thread.cpus,
+          "audio_thread");
+    check(idle_suspend_ms != other.idle_suspend_ms, "idle_suspend_ms");
+    check(silence_fill != other.silence_fill, "silence_fill");
+    check(noise_suppression != other.noise_suppression, "ns");
+    check(auto_gain != other.auto_gain, "agc");
+    if (fields != nullptr) {
+        *fields = changed;
+    }
+    return !changed.empty();
+}
+
+bool DeviceProfile::Validate(std::string* error) const {
+    static const int kOpusFrameMs[] = {10, 20, 40, 60};
+    bool frame_ok = false;
+    for (int ms : kOpusFrameMs) {
+        frame_ok = frame_ok || frame_ms == ms;
+    }
+    if (!frame_ok) {
+        *error = "frame_ms must be 10, 20, 40 or 60";
+        return false;
+    }
+    if (period_ms <= 0 || frame_ms % period_ms != 0) {
+        *error = "frame_ms must be a multiple of period_ms";
+        return false;
+    }
+    if (periods < 2) {
+        *error = "periods must be at least 2";
+        return false;
+    }
+    if (codec.complexity < 0 || codec.complexity > 10) {
+        *error = "codec complexity must be 0..10";
+        return false;
+    }
+    if (jitter_min_ms < 0 || jitter_max_ms < jitter_min_ms) {
+        *error = "jitter max_ms must not be below min_ms";
+        return false;
+    }
+    return true;
+}
+
+bool DeviceProfileSet::LoadFile(const std::string& path, std::string* error) {
+    std::ifstream in(path);
+    if (!in) {
+        *error = "cannot open " + path;
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return Parse(buffer.str(), error);
+}
+
+bool DeviceProfileSet::Parse(const std::string& text, std::string* error) {
+    json root = json::parse(text, nullptr, false);
+    if (root.is_discarded() || !root.is_object()) {
+        *error = "config is not a JSON object";
+        return false;
+    }
+    std::string default_name = "normal";
+    const json* entries = nullptr;
+    if (!ReadString(root, "profile", &default_name, error) || !ReadObject(root, "profiles", &entries, error)) {
+        return false;
+    }
+    std::map<std::string, DeviceProfile> profiles;
+    if (entries != nullptr) {
+        for (auto it = entries->begin(); it != entries->end(); ++it) {
+            DeviceProfile profile;
+            if (!Resolve(*entries, it.key(), 0, &profile, error)) {
+                return false;
+            }
+            if (!profile.Validate(error)) {
+                *error = "profile " + it.key() + ": " + *error;
+                return false;
+            }
+            profiles[it.key()] = profile;
+        }
+    }
+    DeviceProfile unused;
+    if (profiles.count(default_name) == 0 && !DeviceProfile::Builtin(default_name, &unused)) {
+        *error = "unknown profile " + default_name;
+        return false;
+    }
+    default_name_ = default_name;
+    profiles_ = std::move(profiles);
+    return true;
+}
+
+bool DeviceProfileSet::Find(const std::string& name, DeviceProfile* out) const {
+    const std::string& key = name.empty() ? default_name_ : name;
+    auto it = profiles_.find(key);
+    if (it != profiles_.end()) {
+        *out = it->second;
+        return true;
+    }
+    return DeviceProfile::Builtin(key, out);
+}
+
+std::vector<std::string> DeviceProfileSet::Names() const {
+    std::vector<std::string> names;
+    for (const auto& entry : profiles_) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+}  // namespace linx
@@ -0,0 +1,121 @@
+#include "SessionState.h"
+
+namespace linx {
+
+namespace {
+
+struct ListenName {
+    ListenState state;
+    const char* name;
+};
+
+struct TtsName {
+    TtsState state;
+    const char* name;
+};
+
+constexpr ListenName kListenNames[] = {
+    {ListenState::Stop, "stop"},
+    {ListenState::Start, "start"},
+};
+
+constexpr TtsName kTtsNames[] = {
+    {TtsState::Idle, "idle"},
+    {TtsState::Start, "start"},
+    {TtsState::SentenceStart, "sentence_start"},
+    {TtsState::SentenceEnd, "sentence_end"},
+    {TtsState::Stop, "stop"},
+};
+
+}  // namespace
+
+const char* ListenStateName(ListenState state) {
+    for (const ListenName& entry : kListenNames) {
+        if (entry.state == state) {
+            return entry.name;
+        }
+    }
+    return "unknown";
+}
+
+const char* TtsStateName(TtsState state) {
+    for (const TtsName& entry : kTtsNames) {
+        if (entry.state == state) {
+            return entry.name;
+        }
+    }
+    return "unknown";
+}
+
+bool ParseListenState(std::string_view text, ListenState* state) {
+    for (const ListenName& entry : kListenNames) {
+        if (text == entry.name) {
+            *state = entry.state;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ParseTtsState(std::string_view text, TtsState* state) {
+    for (const TtsName& entry : kTtsNames) {
+        if (text == entry.name) {
+            *state = entry.state;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename Update>
+bool SessionState::Transition(Update update) {
+    uint64_t expected = word_.load(std::memory_order_relaxed);
+    SessionSnapshot from;
+    SessionSnapshot to;
+    uint64_t desired;
+    do {
+        from = Unpack(expected);
+        to = from;
+        update(to);
+        desired = Pack(to);
+        if (desired == expected) {
+            return false;
+        }
+    } while (!word_.compare_exchange_weak(expected, desired, std::memory_order_acq_rel,
+                                          std::memory_order_relaxed));
+    if (handler_) {
+        handler_(from, to);
+    }
+    return true;
+}
+
+bool SessionState::SetListen(ListenState state) {
+    return Transition([state](SessionSnapshot& s) { s.listen = state; });
+}
+
+bool SessionState::SetTts(TtsState state) {
+    return Transition([state](SessionSnapshot& s) { s.tts = state; });
+}
+
+bool SessionState::SetSessionId(std::string_view session_id) {
+    {
+        std::lock_guard<ProfiledMutex> lock(id_mutex_);
+        if (session_id_ == session_id) {
+            return false;
+        }
+        session_id_.assign(session_id.data(), session_id.size());
+    }
+    return Transition([](SessionSnapshot& s) { s.generation++; });
+}
+
+std::string SessionState::SessionId() const {
+    std::lock_guard<ProfiledMutex> lock(id_mutex_);
+    return session_id_;
+}
+
+bool SessionState::IsSession(std::string_view session_id) const {
+    std::lock_guard<ProfiledMutex> lock(id_mutex_);
+    return session_id_ == session_id;
+}
+
+}  // namespace linx
@@ -0,0 +1,194 @@
+#pragma once
+
+// C++20 协程支持：Task<T>、在 Reactor 上启动 / 切换 / 定时等待。
+// 库按 C++17 构建时本头文件为空（LINX_HAS_COROUTINES 未定义），以 -DLINX_COROUTINES=ON 构建时启用
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L && __has_include(<coroutine>)
+#define LINX_HAS_COROUTINES 1
+#endif
+
+#ifdef LINX_HAS_COROUTINES
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <utility>
+
+#include "Log.h"
+#include "Reactor.h"
+
+namespace linx {
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    // 结束时直接转到等待者（对称转移，不加深调用栈）
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            std::coroutine_handle<> next = handle.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() { error = std::current_exception(); }
+    void Rethrow() {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    T value{};
+
+    Task<T> get_return_object();
+    template <typename U>
+    void return_value(U&& result) {
+        value = std::forward<U>(result);
+    }
+    T Result() {
+        Rethrow();
+        return std::move(value);
+    }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object();
+    void return_void() {}
+    void Result() { Rethrow(); }
+};
+
+}  // namespace detail
+
+// 惰性协程：创建时不执行，被 co_await（或交给 Spawn）时才开始，结束后恢复等待者；
+// 协程内未捕获的异常在 co_await 处重新抛出。只能移动，析构时销毁协程帧
+template <typename T>
+class Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() { Reset(); }
+
+    bool Valid() const { return static_cast<bool>(handle_); }
+    bool Done() const { return !handle_ || handle_.done(); }
+
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+            bool await_ready() noexcept { return !handle || handle.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+            T await_resume() { return handle.promise().Result(); }
+        };
+        return Awaiter{handle_};
+    }
+
+private:
+    void Reset() {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+// Spawn 用的自销毁协程：立即开始，结束时自行释放协程帧
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() {}
+    };
+};
+
+inline Detached RunDetached(Task<void> task) {
+    try {
+        co_await std::move(task);
+    } catch (const std::exception& e) {
+        ERROR("Detached coroutine failed: {}", e.what());
+    } catch (...) {
+        ERROR("Detached coroutine failed");
+    }
+}
+
+}  // namespace detail
+
+// 把协程投递到 reactor 的循环线程上启动，不等待结果；异常记录日志后丢弃。
+// 一个 reactor 线程可以同时运行任意多个协程（如压测时的多路会话），它们只在 co_await 处交错执行
+inline void Spawn(Reactor& reactor, Task<void> task) {
+    auto holder = std::make_shared<Task<void>>(std::move(task));
+    reactor.Post([holder] { detail::RunDetached(std::move(*holder)); });
+}
+
+// co_await ResumeOn(reactor)：之后的代码在 reactor 的循环线程上执行（已在循环线程上时不挂起）
+inline auto ResumeOn(Reactor& reactor) {
+    struct Awaiter {
+        Reactor& reactor;
+        bool await_ready() const noexcept { return reactor.InLoopThread(); }
+        void await_suspend(std::coroutine_handle<> handle) { reactor.Post([handle] { handle.resume(); }); }
+        void await_resume() const noexcept {}
+    };
+    return Awaiter{reactor};
+}
+
+// co_await SleepFor(reactor, 20ms)：用 reactor 的定时器挂起，不占用线程
+inline auto SleepFor(Reactor& reactor, std::chrono::microseconds delay) {
+    struct Awaiter {
+        Reactor& reactor;
+        std::chrono::microseconds delay;
+        bool await_ready() const noexcept { return delay.count() <= 0; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            reactor.AddTimer(delay, [handle] { handle.resume(); });
+        }
+        void await_resume() const noexcept {}
+    };
+    return Awaiter{reactor, delay};
+}
+
+}  // namespace linx
+
+#endif  // LINX_HAS_COROUTINES
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <poll.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "LockProfiler.h"
+
+namespace linx {
+
+// 事件循环统计
+struct ReactorStats {
+    uint64_t wakeups = 0;       // poll 返回次数
+    uint64_t fd_events = 0;     // 分发的 fd 事件数
+    uint64_t timers_fired = 0;  // 触发的定时器次数
+    uint64_t tasks_run = 0;     // 执行的投递任务数
+};
+
+// 单线程事件循环：一个 poll 复用所有注册的 fd（lws 连接、ALSA 设备描述符等），并提供定时器和跨线程任务投递。
+// 所有处理函数都在调用 Run/RunOnce 的线程上串行执行，彼此之间无需加锁；
+// 网络、音频和定时事件共用一个线程时，唤醒次数只由实际事件决定，不再有各线程各自的轮询和睡眠。
+// 注册、注销、定时器和 Post 可在任意线程调用（内部加锁并唤醒循环）。
+class Reactor {
+public:
+    using FdHandler = std::function<void(int fd, short revents)>;
+    using TimerHandler = std::function<void()>;
+    using Task = std::function<void()>;
+    using TimerId = uint64_t;
+
+    Reactor();
+    ~Reactor();
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    // 注册 fd 及关心的事件（POLLIN/POLLOUT 等），同一 fd 重复注册时替换处理函数；
+    // 在循环线程上注销后，本轮尚未分发的事件不再回调它
+    bool AddFd(int fd, short events, FdHandler handler);
+    bool ModifyFd(int fd, short events);
+    void RemoveFd(int fd);
+
+    // delay 后触发一次；period 大于 0 时之后按 period 周期触发，直到 CancelTimer
+    TimerId AddTimer(std::chrono::microseconds delay, TimerHandler handler,
+                     std::chrono::microseconds period = std::chrono::microseconds(0));
+    bool CancelTimer(TimerId id);
+
+    // 把任务投递到循环线程执行
+    void Post(Task task);
+
+    // 在当前线程运行循环，直到 Stop；退出前执行完已投递的任务
+    void Run();
+    // 最多等待 timeout_ms（-1 为一直等到有事件）处理一轮事件，供自行驱动循环的调用方使用
+    void RunOnce(int timeout_ms);
+    // 任意线程调用，Run 在当前一轮处理完后返回
+    void Stop();
+
+    bool Running() const { return running_; }
+    bool InLoopThread() const { return loop_thread_ == std::this_thread::get_id(); }
+
+    ReactorStats GetStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct FdEntry {
+        int fd = -1;
+        short events = 0;
+        std::shared_ptr<FdHandler> handler;
+    };
+
+    struct Timer {
+        Clock::time_point deadline;
+        Clock::duration period{0};
+        std::shared_ptr<TimerHandler> handler;
+    };
+
+    void Wake();
+    void RebuildPollSet();
+    bool StillRegistered(int fd, const std::shared_ptr<FdHandler>& handler);
+    void RunTasks();
+    void RunTimers();
+    int PollTimeout(int timeout_ms);
+
+    int wake_fds_[2] = {-1, -1};
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> wake_pending_{false};
+    std::atomic<std::thread::id> loop_thread_{};
+
+    mutable ProfiledMutex mutex_{"reactor"};
+    std::vector<FdEntry> entries_;
+    std::atomic<bool> dirty_{true};     // entries_ 变化后需要重建 poll 集合（持锁修改）
+    std::vector<Task> tasks_;
+    std::map<TimerId, Timer> timers_;
+    std::priority_queue<std::pair<Clock::time_point, TimerId>, std::vector<std::pair<Clock::time_point, TimerId>>,
+                        std::greater<std::pair<Clock::time_point, TimerId>>>
+        timer_queue_;                   // 按到期时间排序；取消或重新排期后的旧项出队时跳过
+    TimerId next_timer_id_ = 1;
+
+    // 仅循环线程访问
+    std::vector<struct pollfd> polls_;
+    std::vector<std::shared_ptr<FdHandler>> poll_handlers_;
+    std::vector<Task> running_tasks_;
+
+    std::atomic<uint64_t> wakeups_{0};
+    std::atomic<uint64_t> fd_events_{0};
+    std::atomic<uint64_t> timers_fired_{0};
+    std::atomic<uint64_t> tasks_run_{0};
+};
+
+}  // namespace linx
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "LockProfiler.h"
+
+namespace linx {
+
+class StartupTrace;
+
+// 启动任务：带显式依赖的一次性初始化步骤（打开音频设备、取 OTA 配置、解析和连接服务器等）。
+// 并行模式下每个任务在 Add 时即在自己的线程上开始，先等依赖完成再执行；
+// 顺序模式下任务不会自行开始，第一次 Wait 时在调用线程上（连同尚未执行的依赖）依次执行，即按需惰性初始化。
+// 任务抛出的异常保存下来，由 Wait 该任务（或依赖它的任务）的一方重新抛出。
+// 析构时等待所有已开始的任务结束；未被 Wait 的失败只记录，不再抛出
+class StartupTasks {
+public:
+    explicit StartupTasks(bool parallel, StartupTrace* trace = nullptr) : parallel_(parallel), trace_(trace) {}
+    ~StartupTasks();
+
+    StartupTasks(const StartupTasks&) = delete;
+    StartupTasks& operator=(const StartupTasks&) = delete;
+
+    // 登记任务；deps 必须是已登记的任务名，未知名字或重名时抛出 std::invalid_argument。
+    // 执行时计入 trace 的同名阶段
+    void Add(std::string name, std::initializer_list<std::string_view> deps, std::function<void()> fn);
+
+    // 等待任务完成（顺序模式下就地执行），任务失败时抛出它的异常，不存在时抛出 std::invalid_argument
+    void Wait(std::string_view name);
+    bool Done(std::string_view name) const;
+
+    bool Parallel() const { return parallel_; }
+
+private:
+    enum class State { Pending, Running, Done };
+
+    struct Task {
+        std::string name;
+        std::vector<size_t> deps;
+        std::function<void()> fn;
+        State state = State::Pending;
+        std::exception_ptr error;
+        bool observed = false;  // 异常已由 Wait 抛给调用方
+    };
+
+    size_t IndexLocked(std::string_view name) const;
+    // 执行第 index 个任务（先等待依赖），结果写回任务
+    void Run(size_t index);
+    void WaitIndex(size_t index);
+
+    bool parallel_;
+    StartupTrace* trace_;
+    mutable ProfiledMutex mutex_{"startup_tasks"};
+    ProfiledConditionVariable done_cv_{"startup_tasks"};
+    std::vector<std::unique_ptr<Task>> tasks_;  // 元素地址固定，任务线程持有下标即可
+    std::vector<std::thread> threads_;
+};
+
+}  // namespace linx
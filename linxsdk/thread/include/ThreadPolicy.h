@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace linx {
+
+// 调度策略
+enum class SchedPolicy {
+    Default,     // SCHED_OTHER（CFS），不修改
+    Fifo,        // SCHED_FIFO 实时
+    RoundRobin,  // SCHED_RR 实时
+};
+
+// 线程策略：作用于调用 ApplyThreadPolicy 的当前线程
+struct ThreadPolicy {
+    SchedPolicy policy = SchedPolicy::Default;
+    int priority = 0;           // 实时优先级（1～99），Default 时忽略
+    int fallback_nice = -10;    // 实时策略被拒绝时退而设置的 nice 值（0 表示不设置）
+    std::vector<int> cpus;      // 绑定的 CPU 核，空表示不限制（仅 Linux）
+    std::string name;           // 线程名（最长 15 字符，便于 top -H 查看），空表示不修改
+    size_t prefault_stack = 0;  // 预先触碰的栈字节数，配合 mlockall 避免运行中缺页
+
+    bool IsRealtime() const { return policy != SchedPolicy::Default; }
+
+    // 解析 "fifo:70@1,2" / "rr:50" / "default@0" 形式的描述，失败返回 false
+    static bool Parse(const std::string& text, ThreadPolicy* out);
+};
+
+// 实际生效的策略
+struct ThreadPolicyResult {
+    SchedPolicy policy = SchedPolicy::Default;  // 实际调度策略
+    int priority = 0;                           // 实际实时优先级
+    int nice = 0;                               // 非实时时的 nice 值
+    bool affinity = false;                      // CPU 绑定是否成功
+    std::string error;                          // 被拒绝或降级的原因，全部满足时为空
+
+    std::string Describe() const;
+};
+
+// 对当前线程应用策略。权限不足时按 RLIMIT_RTPRIO 降低优先级重试，仍失败则回退到
+// SCHED_OTHER + fallback_nice；返回实际生效的结果，不抛异常
+ThreadPolicyResult ApplyThreadPolicy(const ThreadPolicy& policy);
+
+// mlockall(MCL_CURRENT | MCL_FUTURE)：锁定进程当前和以后分配的全部内存，避免音频路径缺页。
+// 失败（通常是 RLIMIT_MEMLOCK 不足）时返回 false 并写入 error
+bool LockProcessMemory(std::string* error = nullptr);
+
+// 逐页写一遍缓冲区，让物理页在进入实时路径前就分配好
+void PrefaultMemory(void* data, size_t bytes);
+
+// 在当前线程栈上预先触碰 bytes 字节
+void PrefaultStack(size_t bytes);
+
+// 此后创建的线程（包括 std::thread、spdlog 的后台线程）的默认栈大小，按页向上取整、不小于 PTHREAD_STACK_MIN。
+// glibc 默认取 RLIMIT_STACK（通常 8MB）：平时只占触碰过的页，但 LockProcessMemory 之后每个线程的整个栈都常驻。
+// 须在创建线程之前调用；不支持的平台（macOS）返回 false 并写入 error
+bool SetDefaultThreadStackSize(size_t bytes, std::string* error = nullptr);
+// 当前的默认线程栈大小，无法获取时返回 0
+size_t DefaultThreadStackSize();
+
+const char* SchedPolicyName(SchedPolicy policy);
+
+}  // namespace linx
@@ -0,0 +1,285 @@
+#include "Reactor.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "Log.h"
+
+namespace linx {
+
+Reactor::Reactor() {
+    // 唤醒用的管道（macOS 没有 eventfd），两端都设为非阻塞
+    if (pipe(wake_fds_) < 0) {
+        ERROR("Reactor: pipe failed: {}", strerror(errno));
+        wake_fds_[0] = wake_fds_[1] = -1;
+        return;
+    }
+    for (int fd : wake_fds_) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+}
+
+Reactor::~Reactor() {
+    Stop();
+    for (int fd : wake_fds_) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+bool Reactor::AddFd(int fd, short events, FdHandler handler) {
+    if (fd < 0 || !handler) {
+        return false;
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        auto handler_ptr = std::make_shared<FdHandler>(std::move(handler));
+        auto it = std::find_if(entries_.begin(), entries_.end(), [fd](const FdEntry& e) { return e.fd == fd; });
+        if (it != entries_.end()) {
+            it->events = events;
+            it->handler = std::move(handler_ptr);
+        } else {
+            entries_.push_back({fd, events, std::move(handler_ptr)});
+        }
+        dirty_ = true;
+    }
+    Wake();
+    return true;
+}
+
+bool Reactor::ModifyFd(int fd, short events) {
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        auto it = std::find_if(entries_.begin(), entries_.end(), [fd](const FdEntry& e) { return e.fd == fd; });
+        if (it == entries_.end()) {
+            return false;
+        }
+        if (it->events == events) {
+            return true;
+        }
+        it->events = events;
+        dirty_ = true;
+    }
+    Wake();
+    return true;
+}
+
+void Reactor::RemoveFd(int fd) {
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        auto it = std::find_if(entries_.begin(), entries_.end(), [fd](const FdEntry& e) { return e.fd == fd; });
+        if (it == entries_.end()) {
+            return;
+        }
+        entries_.erase(it);
+        dirty_ = true;
+    }
+    Wake();
+}
+
+Reactor::TimerId Reactor::AddTimer(std::chrono::microseconds delay, TimerHandler handler,
+                                   std::chrono::microseconds period) {
+    TimerId id;
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        id = next_timer_id_++;
+        Timer timer;
+        timer.deadline = Clock::now() + delay;
+        timer.period = period;
+        timer.handler = std::make_shared<TimerHandler>(std::move(handler));
+        timer_queue_.push({timer.deadline, id});
+        timers_.emplace(id, std::move(timer));
+    }
+    if (!InLoopThread()) {
+        Wake();  // 新定时器可能比循环当前的等待期限更早到期
+    }
+    return id;
+}
+
+bool Reactor::CancelTimer(TimerId id) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    return timers_.erase(id) > 0;
+}
+
+void Reactor::Post(Task task) {
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    Wake();
+}
+
+void Reactor::Wake() {
+    // 循环处理完上一次唤醒之前，重复的唤醒只写一次管道
+    if (wake_fds_[1] < 0 || wake_pending_.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    char c = 0;
+    (void)!write(wake_fds_[1], &c, 1);
+}
+
+void Reactor::Run() {
+    loop_thread_ = std::this_thread::get_id();
+    running_ = true;
+    while (!stop_) {
+        RunOnce(-1);
+    }
+    RunTasks();
+    running_ = false;
+    stop_ = false;
+    loop_thread_ = std::thread::id();
+}
+
+void Reactor::Stop() {
+    // 在 Run 开始之前调用时，Run 处理完一轮后立即返回
+    stop_ = true;
+    wake_pending_ = false;
+    Wake();
+}
+
+void Reactor::RebuildPollSet() {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    if (!dirty_) {
+        return;
+    }
+    polls_.clear();
+    poll_handlers_.clear();
+    polls_.push_back({wake_fds_[0], POLLIN, 0});
+    poll_handlers_.push_back(nullptr);
+    for (const FdEntry& entry : entries_) {
+        polls_.push_back({entry.fd, entry.events, 0});
+        poll_handlers_.push_back(entry.handler);
+    }
+    dirty_ = false;
+}
+
+bool Reactor::StillRegistered(int fd, const std::shared_ptr<FdHandler>& handler) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    return std::any_of(entries_.begin(), entries_.end(),
+                       [&](const FdEntry& e) { return e.fd == fd && e.handler == handler; });
+}
+
+int Reactor::PollTimeout(int timeout_ms) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    if (!tasks_.empty()) {
+        return 0;
+    }
+    // 丢弃已取消定时器留下的队首旧项，取最近的有效到期时间
+    while (!timer_queue_.empty()) {
+        auto it = timers_.find(timer_queue_.top().second);
+        if (it != timers_.end() && it->second.deadline == timer_queue_.top().first) {
+            break;
+        }
+        timer_queue_.pop();
+    }
+    if (timer_queue_.empty()) {
+        return timeout_ms;
+    }
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(timer_queue_.top().first - Clock::now());
+    // 向上取整到毫秒，避免提前醒来后空转
+    int ms = std::max<int>(0, static_cast<int>(wait.count()) + 1);
+    return timeout_ms < 0 ? ms : std::min(ms, timeout_ms);
+}
+
+void Reactor::RunOnce(int timeout_ms) {
+    if (loop_thread_ == std::thread::id()) {
+        loop_thread_ = std::this_thread::get_id();
+    }
+    RebuildPollSet();
+    int ret = poll(polls_.data(), polls_.size(), PollTimeout(timeout_ms));
+    if (ret < 0) {
+        if (errno != EINTR) {
+            ERROR("Reactor: poll failed: {}", strerror(errno));
+        }
+        return;
+    }
+    wakeups_.fetch_add(1, std::memory_order_relaxed);
+
+    if (polls_[0].revents & POLLIN) {
+        char buf[64];
+        while (read(wake_fds_[0], buf, sizeof(buf)) > 0) {
+        }
+        wake_pending_.store(false, std::memory_order_release);
+    }
+    RunTasks();
+
+    for (size_t i = 1; i < polls_.size() && ret > 0; ++i) {
+        short revents = polls_[i].revents;
+        if (revents == 0) {
+            continue;
+        }
+        ret--;
+        // 之前的处理函数可能注销了这个 fd（例如 lws 关闭连接），此时不再分发
+        if (dirty_ && !StillRegistered(polls_[i].fd, poll_handlers_[i])) {
+            continue;
+        }
+        fd_events_.fetch_add(1, std::memory_order_relaxed);
+        (*poll_handlers_[i])(polls_[i].fd, revents);
+    }
+
+    RunTimers();
+}
+
+void Reactor::RunTasks() {
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        if (tasks_.empty()) {
+            return;
+        }
+        running_tasks_.swap(tasks_);
+    }
+    for (Task& task : running_tasks_) {
+        task();
+    }
+    tasks_run_.fetch_add(running_tasks_.size(), std::memory_order_relaxed);
+    running_tasks_.clear();
+}
+
+void Reactor::RunTimers() {
+    auto now = Clock::now();
+    for (;;) {
+        std::shared_ptr<TimerHandler> handler;
+        {
+            std::lock_guard<ProfiledMutex> lock(mutex_);
+            if (timer_queue_.empty() || timer_queue_.top().first > now) {
+                return;
+            }
+            auto [deadline, id] = timer_queue_.top();
+            timer_queue_.pop();
+            auto it = timers_.find(id);
+            if (it == timers_.end() || it->second.deadline != deadline) {
+                continue;  // 已取消
+            }
+            handler = it->second.handler;
+            if (it->second.period.count() > 0) {
+                // 按原定节拍排期，不随处理延迟漂移；落后超过一个周期时从当前时刻重新开始
+                it->second.deadline += it->second.period;
+                if (it->second.deadline <= now) {
+                    it->second.deadline = now + it->second.period;
+                }
+                timer_queue_.push({it->second.deadline, id});
+            } else {
+                timers_.erase(it);
+            }
+        }
+        timers_fired_.fetch_add(1, std::memory_order_relaxed);
+        (*handler)();
+    }
+}
+
+ReactorStats Reactor::GetStats() const {
+    ReactorStats stats;
+    stats.wakeups = wakeups_.load(std::memory_order_relaxed);
+    stats.fd_events = fd_events_.load(std::memory_order_relaxed);
+    stats.timers_fired = timers_fired_.load(std::memory_order_relaxed);
+    stats.tasks_run = tasks_run_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace linx
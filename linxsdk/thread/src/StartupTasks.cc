@@ -0,0 +1,134 @@
+#include "StartupTasks.h"
+
+#include <stdexcept>
+
+#include "Log.h"
+#include "StartupTrace.h"
+
+namespace linx {
+
+namespace {
+
+constexpr size_t kNotFound = static_cast<size_t>(-1);
+
+}  // namespace
+
+StartupTasks::~StartupTasks() {
+    for (std::thread& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    for (const auto& task : tasks_) {
+        if (task->error && !task->observed) {
+            try {
+                std::rethrow_exception(task->error);
+            } catch (const std::exception& e) {
+                WARN("startup task {} failed: {}", task->name, e.what());
+            } catch (...) {
+                WARN("startup task {} failed", task->name);
+            }
+        }
+    }
+}
+
+size_t StartupTasks::IndexLocked(std::string_view name) const {
+    for (size_t i = 0; i < tasks_.size(); ++i) {
+        if (tasks_[i]->name == name) {
+            return i;
+        }
+    }
+    return kNotFound;
+}
+
+void StartupTasks::Add(std::string name, std::initializer_list<std::string_view> deps, std::function<void()> fn) {
+    size_t index;
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        if (IndexLocked(name) != kNotFound) {
+            throw std::invalid_argument("duplicate startup task: " + name);
+        }
+        auto task = std::make_unique<Task>();
+        for (std::string_view dep : deps) {
+            size_t dep_index = IndexLocked(dep);
+            if (dep_index == kNotFound) {
+                throw std::invalid_argument("startup task " + name + " depends on unknown task " + std::string(dep));
+            }
+            task->deps.push_back(dep_index);
+        }
+        task->name = std::move(name);
+        task->fn = std::move(fn);
+        index = tasks_.size();
+        tasks_.push_back(std::move(task));
+        if (parallel_) {
+            tasks_[index]->state = State::Running;
+        }
+    }
+    if (parallel_) {
+        threads_.emplace_back(&StartupTasks::Run, this, index);
+    }
+}
+
+void StartupTasks::Run(size_t index) {
+    Task* task;
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        task = tasks_[index].get();
+    }
+    std::exception_ptr error;
+    try {
+        // 依赖失败时以依赖的异常结束，不执行本任务
+        for (size_t dep : task->deps) {
+            WaitIndex(dep);
+        }
+        StartupTrace::Scope phase(trace_, task->name);
+        task->fn();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        task->error = error;
+        task->state = State::Done;
+    }
+    done_cv_.notify_all();
+}
+
+void StartupTasks::WaitIndex(size_t index) {
+    std::unique_lock<ProfiledMutex> lock(mutex_);
+    Task* task = tasks_[index].get();
+    if (task->state == State::Pending) {
+        // 顺序模式：由第一个等待者就地执行
+        task->state = State::Running;
+        lock.unlock();
+        Run(index);
+        lock.lock();
+    }
+    done_cv_.wait(lock, [task]() { return task->state == State::Done; });
+    if (task->error) {
+        std::exception_ptr error = task->error;
+        task->observed = true;  // 已交给等待者处理，析构时不再重复记录
+        lock.unlock();
+        std::rethrow_exception(error);
+    }
+}
+
+void StartupTasks::Wait(std::string_view name) {
+    size_t index;
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        index = IndexLocked(name);
+    }
+    if (index == kNotFound) {
+        throw std::invalid_argument("unknown startup task: " + std::string(name));
+    }
+    WaitIndex(index);
+}
+
+bool StartupTasks::Done(std::string_view name) const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    size_t index = IndexLocked(name);
+    return index != kNotFound && tasks_[index]->state == State::Done;
+}
+
+}  // namespace linx
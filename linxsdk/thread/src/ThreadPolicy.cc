@@ -0,0 +1,288 @@
+#include "ThreadPolicy.h"
+
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+namespace linx {
+
+namespace {
+
+int ToNativePolicy(SchedPolicy policy) {
+    switch (policy) {
+        case SchedPolicy::Fifo:
+            return SCHED_FIFO;
+        case SchedPolicy::RoundRobin:
+            return SCHED_RR;
+        default:
+            return SCHED_OTHER;
+    }
+}
+
+int SetRealtime(SchedPolicy policy, int priority) {
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    return pthread_setschedparam(pthread_self(), ToNativePolicy(policy), &param);
+}
+
+// 非特权进程可用的最高实时优先级（RLIMIT_RTPRIO），macOS 上没有该限制项
+int RealtimePriorityLimit() {
+#ifdef RLIMIT_RTPRIO
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_RTPRIO, &limit) == 0) {
+        return limit.rlim_cur == RLIM_INFINITY ? 99 : static_cast<int>(limit.rlim_cur);
+    }
+#endif
+    return 0;
+}
+
+// 只调整当前线程的 nice 值（Linux 上 setpriority 作用于 tid）
+bool SetThreadNice(int nice) {
+#ifdef __linux__
+    return setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), nice) == 0;
+#else
+    (void)nice;
+    return false;
+#endif
+}
+
+}  // namespace
+
+const char* SchedPolicyName(SchedPolicy policy) {
+    switch (policy) {
+        case SchedPolicy::Fifo:
+            return "SCHED_FIFO";
+        case SchedPolicy::RoundRobin:
+            return "SCHED_RR";
+        default:
+            return "SCHED_OTHER";
+    }
+}
+
+bool ThreadPolicy::Parse(const std::string& text, ThreadPolicy* out) {
+    ThreadPolicy policy;
+    std::string sched = text;
+    std::string cpus;
+    size_t at = text.find('@');
+    if (at != std::string::npos) {
+        sched = text.substr(0, at);
+        cpus = text.substr(at + 1);
+    }
+
+    std::string name = sched;
+    size_t colon = sched.find(':');
+    if (colon != std::string::npos) {
+        name = sched.substr(0, colon);
+        char* end = nullptr;
+        long priority = strtol(sched.c_str() + colon + 1, &end, 10);
+        if (end == sched.c_str() + colon + 1 || *end != '\0' || priority < 1 || priority > 99) {
+            return false;
+        }
+        policy.priority = static_cast<int>(priority);
+    }
+    if (name == "fifo") {
+        policy.policy = SchedPolicy::Fifo;
+    } else if (name == "rr") {
+        policy.policy = SchedPolicy::RoundRobin;
+    } else if (name == "default" || name == "other" || name.empty()) {
+        policy.policy = SchedPolicy::Default;
+    } else {
+        return false;
+    }
+    if (policy.IsRealtime() && policy.priority == 0) {
+        policy.priority = 50;
+    }
+
+    size_t pos = 0;
+    while (pos < cpus.size()) {
+        size_t comma = cpus.find(',', pos);
+        std::string item = cpus.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        char* end = nullptr;
+        long cpu = strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || cpu < 0) {
+            return false;
+        }
+        policy.cpus.push_back(static_cast<int>(cpu));
+        if (comma == std::string::npos) {
+            break;
+        }
+        pos = comma + 1;
+    }
+
+    *out = policy;
+    return true;
+}
+
+std::string ThreadPolicyResult::Describe() const {
+    std::string text = SchedPolicyName(policy);
+    if (policy != SchedPolicy::Default) {
+        text += "/" + std::to_string(priority);
+    } else if (nice != 0) {
+        text += " nice " + std::to_string(nice);
+    }
+    if (affinity) {
+        text += ", pinned";
+    }
+    if (!error.empty()) {
+        text += " (" + error + ")";
+    }
+    return text;
+}
+
+ThreadPolicyResult ApplyThreadPolicy(const ThreadPolicy& policy) {
+    ThreadPolicyResult result;
+
+#ifdef __linux__
+    if (!policy.name.empty()) {
+        pthread_setname_np(pthread_self(), policy.name.substr(0, 15).c_str());
+    }
+    if (!policy.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : policy.cpus) {
+            if (cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        result.affinity = err == 0;
+        if (err != 0) {
+            result.error = std::string("affinity: ") + strerror(err);
+        }
+    }
+#else
+    if (!policy.name.empty()) {
+        pthread_setname_np(policy.name.substr(0, 15).c_str());
+    }
+    if (!policy.cpus.empty()) {
+        result.error = "affinity unsupported";
+    }
+#endif
+
+    if (policy.prefault_stack > 0) {
+        PrefaultStack(policy.prefault_stack);
+    }
+
+    if (!policy.IsRealtime()) {
+        return result;
+    }
+
+    int priority = std::max(1, std::min(policy.priority, 99));
+    int err = SetRealtime(policy.policy, priority);
+    if (err == EPERM) {
+        // 无 CAP_SYS_NICE 时只能用到 RLIMIT_RTPRIO 允许的优先级
+        int limit = RealtimePriorityLimit();
+        if (limit > 0 && limit < priority) {
+            priority = limit;
+            err = SetRealtime(policy.policy, priority);
+        }
+    }
+    if (err == 0) {
+        result.policy = policy.policy;
+        result.priority = priority;
+        return result;
+    }
+
+    std::string reason = std::string(SchedPolicyName(policy.policy)) + " denied: " + strerror(err);
+    result.error = result.error.empty() ? reason : result.error + "; " + reason;
+    if (policy.fallback_nice != 0 && SetThreadNice(policy.fallback_nice)) {
+        result.nice = policy.fallback_nice;
+    }
+    return result;
+}
+
+bool LockProcessMemory(std::string* error) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+        return true;
+    }
+    if (error != nullptr) {
+        *error = strerror(errno);
+    }
+    return false;
+}
+
+void PrefaultMemory(void* data, size_t bytes) {
+    if (data == nullptr || bytes == 0) {
+        return;
+    }
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    volatile char* p = static_cast<volatile char*>(data);
+    for (size_t i = 0; i < bytes; i += page) {
+        p[i] = p[i];
+    }
+    p[bytes - 1] = p[bytes - 1];
+}
+
+void PrefaultStack(size_t bytes) {
+    // 栈上分配并逐页写入，返回后这些页保持驻留（mlockall 之后不会被换出）
+    volatile char* stack = static_cast<volatile char*>(alloca(bytes));
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (size_t i = 0; i < bytes; i += page) {
+        stack[i] = 0;
+    }
+}
+
+bool SetDefaultThreadStackSize(size_t bytes, std::string* error) {
+#ifdef __linux__
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    bytes = std::max<size_t>(bytes, PTHREAD_STACK_MIN);
+    bytes = (bytes + page - 1) / page * page;
+    pthread_attr_t attr;
+    int err = pthread_getattr_default_np(&attr);
+    if (err == 0) {
+        err = pthread_attr_setstacksize(&attr, bytes);
+        if (err == 0) {
+            err = pthread_setattr_default_np(&attr);
+        }
+        pthread_attr_destroy(&attr);
+    }
+    if (err != 0 && error != nullptr) {
+        *error = strerror(err);
+    }
+    return err == 0;
+#else
+    (void)bytes;
+    if (error != nullptr) {
+        *error = "not supported on this platform";
+    }
+    return false;
+#endif
+}
+
+size_t DefaultThreadStackSize() {
+#ifdef __linux__
+    pthread_attr_t attr;
+    if (pthread_getattr_default_np(&attr) != 0) {
+        return 0;
+    }
+    size_t bytes = 0;
+    pthread_attr_getstacksize(&attr, &bytes);
+    pthread_attr_destroy(&attr);
+    if (bytes == 0) {
+        // glibc 未显式设置时报告 0，实际取 RLIMIT_STACK
+        struct rlimit limit;
+        if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+            bytes = static_cast<size_t>(limit.rlim_cur);
+        }
+    }
+    return bytes;
+#else
+    return 0;
+#endif
+}
+
+}  // namespace linx
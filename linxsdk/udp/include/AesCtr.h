@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+struct evp_cipher_ctx_st;
+
+namespace linx {
+
+// AES-CTR 加解密（OpenSSL EVP），CTR 模式下加密与解密是同一运算。
+// 上下文在构造时创建、每个包只重设 IV，稳态不分配内存。一个实例只供一个线程使用
+class AesCtr {
+public:
+    static constexpr size_t kIvSize = 16;
+
+    AesCtr();
+    ~AesCtr();
+
+    AesCtr(const AesCtr&) = delete;
+    AesCtr& operator=(const AesCtr&) = delete;
+
+    // 密钥长度 16/24/32 字节分别对应 AES-128/192/256，其他长度返回 false
+    bool SetKey(const unsigned char* key, size_t len);
+    bool HasKey() const { return key_len_ > 0; }
+
+    // 以 iv 为初始计数器处理 len 字节，out 可以与 in 相同
+    bool Apply(const unsigned char* iv, const unsigned char* in, size_t len, unsigned char* out);
+
+private:
+    evp_cipher_ctx_st* ctx_ = nullptr;
+    size_t key_len_ = 0;
+};
+
+}  // namespace linx
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "AesCtr.h"
+#include "LockProfiler.h"
+#include "Reactor.h"
+
+namespace linx {
+
+// 服务器在 hello 的 udp 对象中下发的通道参数
+struct UdpAudioConfig {
+    std::string server;  // 主机名或 IP
+    uint16_t port = 0;
+    std::string key;     // AES 密钥（原始字节，16/24/32 字节）
+    std::string nonce;   // 16 字节包头模板（原始字节），其中的 ssrc 标识本设备
+};
+
+// 把 hello 中的十六进制字符串解码为原始字节，长度为奇数或含非十六进制字符时返回 false
+bool DecodeHex(std::string_view hex, std::string* out);
+
+struct UdpAudioStats {
+    uint64_t packets_sent = 0;
+    uint64_t bytes_sent = 0;      // 含包头
+    uint64_t send_errors = 0;     // sendto 失败（含 socket 缓冲区满）而丢弃的包
+    uint64_t packets_received = 0;
+    uint64_t bytes_received = 0;
+    uint64_t malformed = 0;       // 包头类型或长度不符、解密失败的包
+    uint64_t lost = 0;            // 按序号空洞累计的丢失包数
+    uint64_t reordered = 0;       // 序号回退（乱序到达或重复）的包
+};
+
+// UDP 音频通道：Opus 帧走 UDP，WebSocket 只承载 JSON 控制消息。
+// 丢一个包只影响这一帧（由抖动缓冲区的丢包隐藏补齐），不会像 TCP 那样让后续所有帧等一个 RTO。
+// 每个包 = 16 字节明文包头 + AES-CTR 加密的负载，包头同时作为 CTR 的初始计数器：
+//   type(u8=0x01) flags(u8) payload_size(u16) ssrc(u32) timestamp_ms(u32) sequence(u32)，网络字节序；
+// flags 与 ssrc 取自服务器下发的 nonce 模板。
+// Send 可在任意线程调用（通常是采集线程）；接收在 Start() 的私有线程或 Attach() 的 reactor 线程上回调
+class UdpAudioChannel {
+public:
+    static constexpr size_t kHeaderSize = 16;
+    static constexpr size_t kMaxPacket = 1500;
+
+    // 收到一帧解密后的 Opus 负载；data 只在回调期间有效
+    using PacketHandler = std::function<void(const unsigned char* data, size_t len, uint32_t timestamp_ms)>;
+
+    UdpAudioChannel() = default;
+    ~UdpAudioChannel();
+
+    UdpAudioChannel(const UdpAudioChannel&) = delete;
+    UdpAudioChannel& operator=(const UdpAudioChannel&) = delete;
+
+    // 解析服务器地址、创建并 connect UDP socket、设置密钥；已打开时先关闭。失败返回 false
+    bool Open(const UdpAudioConfig& config);
+    // 需在 Start/Attach 之前设置
+    void SetPacketHandler(PacketHandler handler) { packet_handler_ = std::move(handler); }
+    // 启动私有接收线程
+    bool Start();
+    // 不创建线程，把 socket 注册到 reactor，在其循环线程上接收
+    bool Attach(Reactor& reactor);
+    // 停止接收并关闭 socket；reactor 模式下在其他线程调用时等待循环线程完成注销
+    void Close();
+    bool IsOpen() const { return open_; }
+
+    // 加密并发送一帧（非阻塞，socket 缓冲区满时丢弃并计数）
+    bool Send(const unsigned char* data, size_t len);
+
+    UdpAudioStats GetStats() const;
+
+private:
+    void Run();
+    void OnReadable();
+    void StopReceiver();
+
+    ProfiledMutex send_mutex_{"udp_send"};  // 保护 fd_ 的发送以及加密上下文和发送缓冲区
+    int fd_ = -1;
+    int wake_pipe_[2] = {-1, -1};
+    std::atomic<bool> open_{false};
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    Reactor* reactor_ = nullptr;
+
+    unsigned char nonce_[kHeaderSize] = {};
+    AesCtr send_cipher_;
+    AesCtr recv_cipher_;  // 仅接收线程使用
+    std::vector<unsigned char> send_buf_;
+    std::vector<unsigned char> recv_buf_;
+    uint32_t send_sequence_ = 0;
+    uint64_t start_ms_ = 0;
+    PacketHandler packet_handler_;
+
+    bool recv_sequence_active_ = false;
+    uint32_t recv_last_sequence_ = 0;
+
+    std::atomic<uint64_t> packets_sent_{0};
+    std::atomic<uint64_t> bytes_sent_{0};
+    std::atomic<uint64_t> send_errors_{0};
+    std::atomic<uint64_t> packets_received_{0};
+    std::atomic<uint64_t> bytes_received_{0};
+    std::atomic<uint64_t> malformed_{0};
+    std::atomic<uint64_t> lost_{0};
+    std::atomic<uint64_t> reordered_{0};
+};
+
+}  // namespace linx
@@ -0,0 +1,51 @@
+#include "AesCtr.h"
+
+#include <openssl/evp.h>
+
+namespace linx {
+
+AesCtr::AesCtr() : ctx_(EVP_CIPHER_CTX_new()) {}
+
+AesCtr::~AesCtr() {
+    EVP_CIPHER_CTX_free(ctx_);
+}
+
+bool AesCtr::SetKey(const unsigned char* key, size_t len) {
+    const EVP_CIPHER* cipher = nullptr;
+    switch (len) {
+        case 16:
+            cipher = EVP_aes_128_ctr();
+            break;
+        case 24:
+            cipher = EVP_aes_192_ctr();
+            break;
+        case 32:
+            cipher = EVP_aes_256_ctr();
+            break;
+        default:
+            return false;
+    }
+    key_len_ = 0;
+    if (ctx_ == nullptr || EVP_EncryptInit_ex(ctx_, cipher, nullptr, key, nullptr) != 1) {
+        return false;
+    }
+    key_len_ = len;
+    return true;
+}
+
+bool AesCtr::Apply(const unsigned char* iv, const unsigned char* in, size_t len, unsigned char* out) {
+    if (key_len_ == 0) {
+        return false;
+    }
+    // 只重设 IV，密钥扩展保留在上下文中
+    if (EVP_EncryptInit_ex(ctx_, nullptr, nullptr, nullptr, iv) != 1) {
+        return false;
+    }
+    int n = 0;
+    if (EVP_EncryptUpdate(ctx_, out, &n, in, static_cast<int>(len)) != 1) {
+        return false;
+    }
+    return static_cast<size_t>(n) == len;
+}
+
+}  // namespace linx
@@ -0,0 +1,295 @@
+#include "UdpAudioChannel.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <future>
+
+#include "BinaryProtocol.h"
+#include "Log.h"
+#include "SteadyClock.h"
+
+namespace linx {
+
+namespace {
+
+constexpr unsigned char kPacketTypeAudio = 0x01;
+
+void PutU16(unsigned char* p, uint32_t v) {
+    p[0] = static_cast<unsigned char>(v >> 8);
+    p[1] = static_cast<unsigned char>(v);
+}
+
+void PutU32(unsigned char* p, uint32_t v) {
+    p[0] = static_cast<unsigned char>(v >> 24);
+    p[1] = static_cast<unsigned char>(v >> 16);
+    p[2] = static_cast<unsigned char>(v >> 8);
+    p[3] = static_cast<unsigned char>(v);
+}
+
+uint32_t GetU32(const unsigned char* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+// SOCK_NONBLOCK/pipe2 在 macOS 上不可用，统一用 fcntl 设置
+bool SetNonBlockingCloexec(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0 && fcntl(fd, F_SETFD, FD_CLOEXEC) == 0;
+}
+
+int HexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+}  // namespace
+
+bool DecodeHex(std::string_view hex, std::string* out) {
+    if (hex.size() % 2 != 0) {
+        return false;
+    }
+    out->clear();
+    out->reserve(hex.size() / 2);
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        int hi = HexDigit(hex[i]);
+        int lo = HexDigit(hex[i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        out->push_back(static_cast<char>((hi << 4) | lo));
+    }
+    return true;
+}
+
+UdpAudioChannel::~UdpAudioChannel() {
+    Close();
+}
+
+bool UdpAudioChannel::Open(const UdpAudioConfig& config) {
+    Close();
+    if (config.nonce.size() != kHeaderSize) {
+        ERROR("udp audio: nonce must be {} bytes, got {}", kHeaderSize, config.nonce.size());
+        return false;
+    }
+    const auto* key = reinterpret_cast<const unsigned char*>(config.key.data());
+    if (!send_cipher_.SetKey(key, config.key.size()) || !recv_cipher_.SetKey(key, config.key.size())) {
+        ERROR("udp audio: invalid AES key ({} bytes)", config.key.size());
+        return false;
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    struct addrinfo* result = nullptr;
+    std::string port = std::to_string(config.port);
+    int rc = getaddrinfo(config.server.c_str(), port.c_str(), &hints, &result);
+    if (rc != 0 || result == nullptr) {
+        ERROR("udp audio: resolve {} failed: {}", config.server, gai_strerror(rc));
+        return false;
+    }
+    int fd = socket(result->ai_family, SOCK_DGRAM, 0);
+    // connect 之后只收该服务器地址的包，发送也不必每次带地址
+    if (fd < 0 || !SetNonBlockingCloexec(fd) || connect(fd, result->ai_addr, result->ai_addrlen) != 0) {
+        ERROR("udp audio: connect {}:{} failed: {}", config.server, config.port, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        freeaddrinfo(result);
+        return false;
+    }
+    freeaddrinfo(result);
+
+    std::lock_guard<ProfiledMutex> lock(send_mutex_);
+    fd_ = fd;
+    memcpy(nonce_, config.nonce.data(), kHeaderSize);
+    nonce_[0] = kPacketTypeAudio;
+    send_buf_.assign(kMaxPacket, 0);
+    recv_buf_.assign(kMaxPacket, 0);
+    send_sequence_ = 0;
+    start_ms_ = SteadyNowMs();
+    recv_sequence_active_ = false;
+    open_ = true;
+    INFO("udp audio: {}:{} (AES-{}-CTR)", config.server, config.port, config.key.size() * 8);
+    return true;
+}
+
+bool UdpAudioChannel::Start() {
+    if (!open_ || running_) {
+        return open_;
+    }
+    if (pipe(wake_pipe_) != 0 || !SetNonBlockingCloexec(wake_pipe_[0]) || !SetNonBlockingCloexec(wake_pipe_[1])) {
+        ERROR("udp audio: pipe failed: {}", strerror(errno));
+        for (int& fd : wake_pipe_) {
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        return false;
+    }
+    running_ = true;
+    thread_ = std::thread(&UdpAudioChannel::Run, this);
+    return true;
+}
+
+bool UdpAudioChannel::Attach(Reactor& reactor) {
+    if (!open_ || running_) {
+        return open_;
+    }
+    reactor_ = &reactor;
+    running_ = true;
+    return reactor.AddFd(fd_, POLLIN, [this](int, short) { OnReadable(); });
+}
+
+void UdpAudioChannel::Run() {
+    struct pollfd fds[2];
+    fds[0].fd = fd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = wake_pipe_[0];
+    fds[1].events = POLLIN;
+    while (running_) {
+        int n = poll(fds, 2, -1);
+        if (n < 0 && errno != EINTR) {
+            ERROR("udp audio: poll failed: {}", strerror(errno));
+            break;
+        }
+        if (n > 0 && (fds[0].revents & POLLIN)) {
+            OnReadable();
+        }
+    }
+}
+
+// 每次就绪把 socket 中排队的包读完
+void UdpAudioChannel::OnReadable() {
+    for (;;) {
+        ssize_t n = recv(fd_, recv_buf_.data(), recv_buf_.size(), 0);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                // 如服务器端口不可达（ICMP）：不影响之后的包
+                WARN_EVERY(10000, "udp audio: recv failed: {}", strerror(errno));
+            }
+            return;
+        }
+        unsigned char* packet = recv_buf_.data();
+        size_t len = static_cast<size_t>(n);
+        size_t payload_size = len >= kHeaderSize ? (static_cast<size_t>(packet[2]) << 8 | packet[3]) : 0;
+        if (len < kHeaderSize || packet[0] != kPacketTypeAudio || payload_size != len - kHeaderSize ||
+            !recv_cipher_.Apply(packet, packet + kHeaderSize, payload_size, packet + kHeaderSize)) {
+            malformed_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        packets_received_.fetch_add(1, std::memory_order_relaxed);
+        bytes_received_.fetch_add(len, std::memory_order_relaxed);
+
+        uint32_t sequence = GetU32(packet + 12);
+        if (!recv_sequence_active_) {
+            recv_sequence_active_ = true;
+        } else {
+            int32_t delta = SequenceDelta(recv_last_sequence_, sequence, 32);
+            if (delta > 0) {
+                lost_.fetch_add(static_cast<uint64_t>(delta - 1), std::memory_order_relaxed);
+            } else {
+                reordered_.fetch_add(1, std::memory_order_relaxed);
+                sequence = recv_last_sequence_;
+            }
+        }
+        recv_last_sequence_ = sequence;
+
+        if (packet_handler_) {
+            packet_handler_(packet + kHeaderSize, payload_size, GetU32(packet + 8));
+        }
+    }
+}
+
+bool UdpAudioChannel::Send(const unsigned char* data, size_t len) {
+    std::lock_guard<ProfiledMutex> lock(send_mutex_);
+    if (!open_ || len > kMaxPacket - kHeaderSize) {
+        send_errors_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    unsigned char* packet = send_buf_.data();
+    memcpy(packet, nonce_, kHeaderSize);
+    PutU16(packet + 2, static_cast<uint32_t>(len));
+    PutU32(packet + 8, static_cast<uint32_t>(SteadyNowMs() - start_ms_));
+    PutU32(packet + 12, ++send_sequence_);
+    // 负载直接加密进发送缓冲区的包头之后
+    if (!send_cipher_.Apply(packet, data, len, packet + kHeaderSize)) {
+        send_errors_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    ssize_t n = send(fd_, packet, kHeaderSize + len, 0);  // 非阻塞 socket，缓冲区满时直接失败
+    if (n != static_cast<ssize_t>(kHeaderSize + len)) {
+        send_errors_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    packets_sent_.fetch_add(1, std::memory_order_relaxed);
+    bytes_sent_.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+    return true;
+}
+
+void UdpAudioChannel::StopReceiver() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (reactor_ != nullptr) {
+        Reactor* reactor = reactor_;
+        reactor_ = nullptr;
+        if (reactor->Running() && !reactor->InLoopThread()) {
+            // 等循环线程完成注销，之后不会再有正在执行的接收回调
+            std::promise<void> done;
+            int fd = fd_;
+            reactor->Post([reactor, fd, &done]() {
+                reactor->RemoveFd(fd);
+                done.set_value();
+            });
+            done.get_future().wait();
+        } else {
+            reactor->RemoveFd(fd_);
+        }
+        return;
+    }
+    char byte = 1;
+    if (write(wake_pipe_[1], &byte, 1) < 0) {
+        WARN("udp audio: wake failed: {}", strerror(errno));
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    close(wake_pipe_[0]);
+    close(wake_pipe_[1]);
+    wake_pipe_[0] = wake_pipe_[1] = -1;
+}
+
+void UdpAudioChannel::Close() {
+    StopReceiver();
+    std::lock_guard<ProfiledMutex> lock(send_mutex_);
+    open_ = false;
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+UdpAudioStats UdpAudioChannel::GetStats() const {
+    UdpAudioStats stats;
+    stats.packets_sent = packets_sent_;
+    stats.bytes_sent = bytes_sent_;
+    stats.send_errors = send_errors_;
+    stats.packets_received = packets_received_;
+    stats.bytes_received = bytes_received_;
+    stats.malformed = malformed_;
+    stats.lost = lost_;
+    stats.reordered = reordered_;
+    return stats;
+}
+
+}  // namespace linx
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace linx {
+
+// 二进制消息分帧，版本通过握手头 Protocol-Version 和 hello 的 version 协商，所有字段为网络字节序：
+//   v1：没有帧头，消息即 Opus 负载
+//   v2：16 字节 = version(u16) type(u16) sequence(u32) timestamp_ms(u32) payload_size(u32)
+//   v3：4 字节  = type(u8) sequence(u8) payload_size(u16)
+// sequence 占用标准协议中的保留字段（对端不使用时恒为 0）：发送端从 1 开始递增、自然回绕，
+// 接收端收到第一个非 0 序号后才开始统计丢包和乱序。v3 只有低 8 位，足以发现短时间内的丢包和乱序
+enum class BinaryFrameType : uint8_t {
+    Audio = 0,  // Opus 音频帧
+    Json = 1,   // 以二进制消息承载的 JSON 控制消息
+    // 多个 Opus 帧合并为一条消息（需要对端支持）：负载为若干 [size(u16)][帧数据]，按发送顺序排列
+    AudioBatch = 2,
+};
+
+constexpr int kMaxBinaryProtocolVersion = 3;
+constexpr size_t kBinaryHeaderSizeV2 = 16;
+constexpr size_t kBinaryHeaderSizeV3 = 4;
+
+struct BinaryFrameHeader {
+    BinaryFrameType type = BinaryFrameType::Audio;
+    uint32_t sequence = 0;
+    uint32_t timestamp_ms = 0;  // v3 不携带，解析结果为 0
+    uint32_t payload_size = 0;
+};
+
+// 各版本的帧头长度，v1 为 0；不支持的版本返回 0
+size_t BinaryHeaderSize(int version);
+bool IsValidBinaryProtocol(int version);
+
+// 把帧头写到 out（至少 BinaryHeaderSize(version) 字节），返回写入的字节数。
+// v3 的 payload_size 只有 16 位，超出时返回 0
+size_t WriteBinaryHeader(unsigned char* out, int version, const BinaryFrameHeader& header);
+
+// 解析一条二进制消息：校验版本和长度后给出帧头和负载（指向 data，不拷贝）。
+// v1 时整条消息即负载；帧头不完整或 payload_size 与消息长度不符时返回 false
+bool ParseBinaryFrame(const void* data, size_t len, int version, BinaryFrameHeader* header,
+                      std::string_view* payload);
+
+// 合并消息中每帧前的长度前缀
+constexpr size_t kBatchEntryHeaderSize = 2;
+
+// 在 out 写入一帧的长度前缀，返回写入的字节数
+size_t WriteBatchEntryHeader(unsigned char* out, uint16_t frame_size);
+
+// 依次取出 AudioBatch 负载中的各帧（视图指向负载，不拷贝）
+class AudioBatchReader {
+public:
+    explicit AudioBatchReader(std::string_view payload) : rest_(payload) {}
+    // 取下一帧；取完或长度前缀越界时返回 false，后者 Error() 为 true
+    bool Next(std::string_view* frame);
+    bool Error() const { return error_; }
+
+private:
+    std::string_view rest_;
+    bool error_ = false;
+};
+
+// 序号比较：按 bits 位回绕，返回 b 相对 a 前进的帧数（负数表示 b 更旧）
+int32_t SequenceDelta(uint32_t a, uint32_t b, int bits);
+
+}  // namespace linx
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "LockProfiler.h"
+
+namespace linx {
+
+// 一个候选 WebSocket 服务器及记住的建连耗时
+struct EndpointInfo {
+    std::string url;
+    double rtt_ms = 0;      // 平滑的 TCP 建连耗时（约一个往返），0 为尚未测得
+    uint32_t failures = 0;  // 连续竞速失败（所有地址都连不上）的次数
+};
+
+// 一次竞速的结果：address 为胜出连接的对端 IP（数字形式），交给 lws 直接连接，省去再次解析
+struct EndpointRaceResult {
+    bool ok = false;
+    size_t index = 0;
+    std::string url;
+    std::string address;
+    double connect_ms = 0;
+};
+
+// 多个候选服务器（如各区域的接入点）之间按延迟选择：Race() 并行解析所有候选，
+// 按 happy eyeballs（RFC 8305）对每个候选的 IPv6/IPv4 地址交替、间隔 250ms 发起非阻塞 TCP 连接，
+// 不同候选同时竞速，最先完成三次握手的连接胜出，其余立即放弃。胜出者的建连耗时按 1/4 平滑记入该候选。
+//
+// 记住的延迟用于下次启动：最快的候选与未测得的候选立即开始，已知较慢的候选推迟 250ms，
+// 最快的候选仍然可用时不再对其他服务器发起多余的连接。SaveState / LoadState 把记录序列化为 JSON，
+// 由调用方持久化。竞速只测量 TCP 建连，之后由 WebSocketClient 用胜出的地址重新建立 WebSocket 连接。
+// 所有方法线程安全；Race() 会阻塞到有连接胜出、全部失败或超时，应在启动线程上调用
+class EndpointSelector {
+public:
+    EndpointSelector() = default;
+    explicit EndpointSelector(const std::vector<std::string>& urls) { SetEndpoints(urls); }
+
+    // 设置候选列表（去重，保持顺序）；已在列表中的候选保留记住的延迟
+    void SetEndpoints(const std::vector<std::string>& urls);
+    std::vector<EndpointInfo> Endpoints() const;
+    size_t Size() const;
+
+    EndpointRaceResult Race(std::chrono::milliseconds timeout = std::chrono::milliseconds(3000));
+
+    // 按记住的延迟排序（未测得的排在已测得的之后，连续失败多的靠后），返回 current 之后的下一个候选，用于连接失败后换一个服务器
+    size_t Next(size_t current) const;
+    std::string UrlAt(size_t index) const;
+
+    std::string SaveState() const;
+    // 只恢复当前列表中仍存在的候选的记录；格式错误时忽略并返回 false
+    bool LoadState(const std::string& state);
+
+private:
+    struct Candidate;
+
+    static constexpr std::chrono::milliseconds kAttemptDelay{250};  // RFC 8305 推荐的连接尝试间隔
+    static constexpr double kRttGain = 0.25;
+
+    std::vector<size_t> RankedLocked() const;
+
+    mutable ProfiledMutex mutex_{"endpoint_selector"};
+    std::vector<EndpointInfo> endpoints_;
+};
+
+}  // namespace linx
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Coroutine.h"
+
+#ifdef LINX_HAS_COROUTINES
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "Reactor.h"
+#include "Websocket.h"
+
+namespace linx {
+
+// 协程收到的一条消息；closed 为 true 表示连接已关闭或连接失败（data 为空）
+struct WsMessage {
+    std::string data;
+    bool binary = false;
+    bool closed = false;
+};
+
+// WebSocketClient 的协程接口：接管 client 的打开、关闭、失败和零拷贝接收回调，
+// 消息拷贝进有界队列后在 reactor 的循环线程上交给等待的协程，会话逻辑可以顺序书写：
+//
+//   Task<void> Session(Reactor& reactor, WebSocketChannel& ws) {
+//       if (!co_await ws.Connect()) co_return;
+//       co_await ws.Send(hello);
+//       for (;;) {
+//           WsMessage msg = co_await ws.NextMessage();
+//           if (msg.closed) break;
+//           ...
+//       }
+//   }
+//
+// 所有 co_await 须在运行于该 reactor 上的协程中进行（由 Spawn 启动）；client 通常挂在同一 reactor 的
+// WebSocketManager 上，此时回调本身就在循环线程上，一个线程可承载多路会话。
+// 同一时刻只能有一个协程等待 Connect / NextMessage。channel 须比 client 先销毁（析构时解除回调）
+class WebSocketChannel {
+public:
+    // max_queued：未被取走的消息上限，超出时丢弃最旧的一条并计入 Dropped()
+    WebSocketChannel(Reactor& reactor, WebSocketClient& client, size_t max_queued = 256);
+    ~WebSocketChannel();
+
+    WebSocketChannel(const WebSocketChannel&) = delete;
+    WebSocketChannel& operator=(const WebSocketChannel&) = delete;
+
+    // 已连接时立即返回 true；否则（首次调用时执行 client.start()）等到连接建立（true）或失败 / 关闭（false）
+    auto Connect() {
+        struct Awaiter {
+            WebSocketChannel& channel;
+            bool await_ready() const noexcept { return channel.client_.IsConnected(); }
+            void await_suspend(std::coroutine_handle<> handle) { channel.BeginConnect(handle); }
+            bool await_resume() const noexcept { return channel.client_.IsConnected(); }
+        };
+        return Awaiter{*this};
+    }
+
+    // 取出下一条消息，队列为空时挂起到消息到达或连接关闭
+    auto NextMessage() {
+        struct Awaiter {
+            WebSocketChannel& channel;
+            bool await_ready() const noexcept { return !channel.state_->messages.empty(); }
+            void await_suspend(std::coroutine_handle<> handle) { channel.state_->message_waiter = handle; }
+            WsMessage await_resume() { return channel.PopMessage(); }
+        };
+        return Awaiter{*this};
+    }
+
+    // 发送文本 / 二进制：先直接入队，发送队列已满时按 retry 间隔重试直到 timeout，
+    // 返回是否入队成功（连接断开或超时返回 false）
+    auto Send(std::string text, std::chrono::milliseconds timeout = std::chrono::milliseconds(1000)) {
+        return SendAwaiter{*this, std::move(text), false, timeout};
+    }
+    auto SendBinary(std::string data, std::chrono::milliseconds timeout = std::chrono::milliseconds(1000)) {
+        return SendAwaiter{*this, std::move(data), true, timeout};
+    }
+
+    size_t Queued() const { return state_->messages.size(); }
+    uint64_t Dropped() const { return state_->dropped; }
+    WebSocketClient& Client() { return client_; }
+
+private:
+    static constexpr std::chrono::milliseconds kSendRetry{5};
+
+    // 回调与投递的任务共享的状态：channel 析构后仍在途的投递任务只看到 alive == false
+    struct State {
+        std::deque<WsMessage> messages;
+        size_t max_queued = 0;
+        uint64_t dropped = 0;
+        bool alive = true;
+        std::coroutine_handle<> message_waiter;
+        std::coroutine_handle<> connect_waiter;
+    };
+
+    struct SendAwaiter {
+        WebSocketChannel& channel;
+        std::string payload;
+        bool binary;
+        std::chrono::milliseconds timeout;
+        bool sent = false;
+
+        bool await_ready() {
+            sent = channel.TrySend(payload, binary);
+            return sent || !channel.client_.IsConnected();
+        }
+        void await_suspend(std::coroutine_handle<> handle) {
+            channel.RetrySend(this, handle, std::chrono::steady_clock::now() + timeout);
+        }
+        bool await_resume() const noexcept { return sent; }
+    };
+
+    void BeginConnect(std::coroutine_handle<> handle);
+    WsMessage PopMessage();
+    bool TrySend(const std::string& payload, bool binary);
+    void RetrySend(SendAwaiter* awaiter, std::coroutine_handle<> handle, std::chrono::steady_clock::time_point deadline);
+    // 以下在循环线程上执行
+    static void Deliver(const std::shared_ptr<State>& state, WsMessage message);
+    static void ResumeConnect(const std::shared_ptr<State>& state);
+
+    Reactor& reactor_;
+    WebSocketClient& client_;
+    std::shared_ptr<State> state_;
+    bool started_ = false;
+};
+
+}  // namespace linx
+
+#endif  // LINX_HAS_COROUTINES
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <libwebsockets.h>
+
+#include "LockProfiler.h"
+#include "Reactor.h"
+
+namespace linx {
+
+class WebSocketClient;
+
+// lws 的缓冲区大小，创建上下文时生效（0 表示使用 lws 的默认值）。
+// 内存紧张的板子上可以调小；接收缓冲区小于消息时 lws 分多次回调，由 WebSocketClient 重组，不影响正确性
+struct WebSocketBufferConfig {
+    size_t rx_buffer_size = 1024;  // 每个连接的接收缓冲区
+    size_t tx_packet_size = 0;     // 单次写出的分片上限，0 与 rx_buffer_size 相同
+    size_t pt_serv_buf_size = 0;   // 服务线程共用的缓冲区（lws 默认 4096），须放得下握手请求头
+};
+
+// permessage-deflate（RFC 7692）协商，创建上下文时生效；服务器不接受时按未压缩连接，无需另行处理。
+// 按消息选择是否压缩：只压缩不短于 min_text_bytes 的文本消息（stt/llm/tts 等控制消息），
+// 二进制帧（Opus 已经是压缩数据）和短文本原样发出、不经过 deflate，音频路径不增加任何开销。
+// 不请求 no_context_takeover：每个连接的 zlib 上下文在消息之间保留复用，不逐条重新初始化，
+// 重复出现的 JSON 键名也能被后续消息引用。需要 libwebsockets 以 LWS_WITHOUT_EXTENSIONS=OFF 和 zlib 构建
+struct WebSocketDeflateConfig {
+    bool enabled = false;
+    size_t min_text_bytes = 128;  // 更短的文本压缩后几乎不变小
+    int level = 1;                // zlib 压缩级别（1～9），默认取最省 CPU 的 1，0 为 lws 的默认值
+    int mem_level = 0;            // zlib memLevel（1～9，越小占用越少），0 为 lws 的默认值
+};
+
+// 多个 WebSocketClient 共用的 lws 上下文和服务线程（网关设备代理多个房间时，一个上下文、一次 TLS 初始化、一个线程）。
+// 每个逻辑连接仍有独立的回调、握手头和发送队列：连接级 lws 回调按 lws_wsi_user 分发到各自的 client，
+// 上下文级回调（LWS_CALLBACK_EVENT_WAIT_CANCELLED）由管理器转发给所有挂载的 client。
+// 构造时没有传入管理器的 WebSocketClient 在 start() 时创建一个私有管理器，行为与单连接时一致。
+// 传入 Reactor 时不创建服务线程：lws 的 fd 通过外部 poll 回调（ADD/DEL/CHANGE_MODE_POLL_FD）注册到 reactor，
+// 所有 lws 回调都在 reactor 的循环线程上执行，可与 AlsaEngine 等共用一个线程。
+class WebSocketManager {
+public:
+    explicit WebSocketManager(Reactor* reactor = nullptr, const WebSocketBufferConfig& buffers = WebSocketBufferConfig(),
+                              const WebSocketDeflateConfig& deflate = WebSocketDeflateConfig());
+    ~WebSocketManager();
+
+    WebSocketManager(const WebSocketManager&) = delete;
+    WebSocketManager& operator=(const WebSocketManager&) = delete;
+
+    // 创建 lws 上下文并启动服务线程；client 的 start() 会自动调用，重复调用直接返回
+    bool Start();
+    // 停止服务线程并销毁上下文，所有连接随之关闭；析构时自动调用。
+    // reactor 模式下在其他线程调用时，销毁投递到循环线程执行并等待完成
+    void Stop();
+
+    // 当前挂载的 client 数
+    size_t ClientCount() const;
+    const WebSocketDeflateConfig& DeflateConfig() const { return deflate_; }
+
+    // 把 lws 的堆分配换成带长度头的计数实现，计入 MemoryTag::Network。须在创建任何 lws 上下文之前调用
+    //（lws 默认分配器分配的内存不能交给计数实现释放），重复调用无效
+    static void EnableMemoryAccounting();
+
+private:
+    friend class WebSocketClient;
+
+    void Run();
+    // 挂载 client 并在服务线程上发起连接
+    void Attach(WebSocketClient* client);
+    // 摘除 client：阻塞到服务线程不会再回调它为止（在服务线程上调用时立即完成）
+    void Detach(WebSocketClient* client);
+    // 唤醒服务线程（任意线程）
+    void Wake();
+    // LWS_CALLBACK_EVENT_WAIT_CANCELLED：处理挂载/摘除请求，并让各 client 请求可写回调（服务线程）
+    void OnWake();
+    void RemoveLocked(WebSocketClient* client);
+    // 当前线程是否为执行 lws 回调的线程
+    bool OnServiceThread() const;
+    // 服务线程（或 reactor 循环）是否还在运行，决定 Detach 能否交给它处理
+    bool ServiceActive() const;
+    void Teardown();
+    // reactor 模式：外部 poll 回调，以及 fd 就绪后的服务
+    void OnPollFd(enum lws_callback_reasons reason, const struct lws_pollargs* args);
+    void ServiceFd(int fd, short revents);
+    void ServicePending();
+    // 安排 delay 后服务一次 lws 的内部定时器（服务线程）：reactor 模式下 lws 定时器平时按 1 秒粒度服务，
+    // 重连等短延迟需要单独的 reactor 定时器；服务线程模式下 lws_service 按最近的定时器自行唤醒，无需处理
+    void ServiceAfter(std::chrono::microseconds delay);
+#if !defined(LWS_WITHOUT_EXTENSIONS)
+    // 包装 lws 的 permessage-deflate 扩展：按 client 为当前消息做出的选择跳过压缩，并统计压缩前后的字节数
+    static int DeflateCallback(struct lws_context* context, const struct lws_extension* ext, struct lws* wsi,
+                               enum lws_extension_callback_reasons reason, void* user, void* in, size_t len);
+#endif
+
+    Reactor* reactor_ = nullptr;
+    Reactor::TimerId lws_timer_ = 0;
+    Reactor::TimerId service_timer_ = 0;
+    std::chrono::steady_clock::time_point service_deadline_;
+    struct lws_context* context_ = nullptr;
+    WebSocketBufferConfig buffers_;
+    struct lws_protocols protocols_[2];
+    WebSocketDeflateConfig deflate_;
+#if !defined(LWS_WITHOUT_EXTENSIONS)
+    struct lws_extension extensions_[2];
+#endif
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    mutable ProfiledMutex mutex_{"ws_manager"};
+    ProfiledConditionVariable detached_cv_{"ws_manager"};
+    std::vector<WebSocketClient*> clients_;
+    std::vector<WebSocketClient*> connect_queue_;
+    std::vector<WebSocketClient*> detach_queue_;
+    std::vector<WebSocketClient*> connect_swap_;  // 仅服务线程使用
+};
+
+}  // namespace linx
@@ -1,41 +1,324 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <functional>
 #include <thread>
 #include <atomic>
+#include <chrono>
 #include <mutex>
+#include <random>
 #include <libwebsockets.h>
 
+#include "BinaryProtocol.h"
+#include "EndpointSelector.h"
+#include "FrameTrace.h"
+#include "LatencyTracer.h"
+#include "LockProfiler.h"
 #include "Log.h"
+#include "MemoryAccounting.h"
+#include "WebSocketManager.h"
 
 namespace linx {
 
+// 发送队列入队到写上线路（lws_write 返回）的延迟统计
+struct SendLatencyStats {
+    uint64_t frames = 0;    // 已写出的帧数
+    double avg_us = 0;      // 平均延迟
+    double max_us = 0;      // 最大延迟
+    double last_us = 0;     // 最近一帧的延迟
+};
+
+// 上行背压：网络停顿时限制音频在发送队列中的积压，使上行延迟有上界而不随停顿时长增长。
+// 只丢弃音频帧（Audio / AudioBatch），总是先丢最旧的；文本等控制消息从不因此丢弃
+struct SendBackpressure {
+    std::chrono::milliseconds max_audio_age{0};  // 音频帧排队超过该时长即丢弃（入队和写出时检查），0 为不限
+    size_t max_audio_frames = 0;                 // 队列中音频帧的上限，超出时丢弃最旧的一帧，0 为只受队列容量限制
+};
+
+// 发送通道：每条通道是一个独立的固定槽位队列，可写回调按 Control > Audio > Bulk 的严格优先级取帧写出，
+// 排队中的音频再多，控制消息也只等正在写出的那一帧。同一通道内保持入队顺序，不同通道之间不保证
+enum class SendLane : uint8_t {
+    Control = 0,  // 文本控制消息（hello、listen、abort 等），send_text 的默认通道
+    Audio = 1,    // 上行音频（send_binary），背压策略只作用于此通道
+    Bulk = 2,     // 体积大、不急于送达的文本（如工具调用结果、状态上报），只在前两条通道都为空时写出
+};
+constexpr size_t kSendLaneCount = 3;
+
+// 发送端按原因统计的丢弃数，四项之和为 SendQueueDrops()
+struct SendDropStats {
+    uint64_t queue_full = 0;   // 队列已满且没有可挤掉的音频，新消息被拒绝
+    uint64_t expired = 0;      // 排队超过 max_audio_age 的音频帧
+    uint64_t over_budget = 0;  // 超出 max_audio_frames，或队列满时为新消息腾出槽位而挤掉的最旧音频帧
+    uint64_t oversize = 0;     // 超出协议长度限制的帧
+};
+
+// 接收端二进制分帧统计（协议 v2/v3）
+struct BinaryRxStats {
+    uint64_t frames = 0;     // 收到的二进制帧
+    uint64_t malformed = 0;  // 帧头不完整或长度不符而被丢弃的消息
+    uint64_t lost = 0;       // 按序号空洞累计的丢失帧数
+    uint64_t reordered = 0;  // 序号回退（乱序到达或重复）的帧
+};
+
+// 断线重连策略：连接失败或已建立的连接断开后，按指数退避（带随机抖动）在服务线程上重新发起连接。
+// 重连复用同一个 client：发送队列中未写出的帧、握手头、回调和统计都保留，lws 上下文不重建
+struct ReconnectPolicy {
+    bool enabled = false;
+    std::chrono::milliseconds initial_delay{100};  // 第一次重连前的等待
+    std::chrono::milliseconds max_delay{30000};    // 退避上限
+    double multiplier = 2.0;                       // 每次连续失败后延迟的倍数
+    double jitter = 0.3;                           // 延迟随机减少的最大比例，避免大量设备同时重连
+    unsigned max_attempts = 0;                     // 连续失败多少次后放弃，0 为不限
+};
+
+// 上行 Opus 帧合并：K 帧合成一条 AudioBatch 消息，减少蜂窝链路上每条消息的 WebSocket/TLS/TCP 开销，
+// 代价是最多 max_hold 的额外延迟。需要二进制分帧 v2/v3，且对端支持 AudioBatch
+enum class AggregationMode : uint8_t {
+    Off,    // 每帧一条消息
+    Fixed,  // 始终合并 max_frames 帧
+    Auto,   // 出口为蜂窝网卡（wwan/ppp/rmnet 等）或平滑 RTT 超过 auto_rtt_ms 时合并，否则每帧一条
+};
+
+struct AggregationConfig {
+    AggregationMode mode = AggregationMode::Off;
+    size_t max_frames = 3;                     // 每条消息最多合并的帧数
+    std::chrono::milliseconds max_hold{150};   // 第一帧最多等待多久，到期即发出不满 K 帧的消息
+    double auto_rtt_ms = 150;                  // Auto 模式的 RTT 阈值（需 SetPingInterval 测量 RTT）
+};
+
+// permessage-deflate 统计（WebSocketDeflateConfig）
+struct WebSocketDeflateStats {
+    bool negotiated = false;      // 当前连接上服务器接受了扩展
+    uint64_t compressed = 0;      // 经 deflate 发出的文本消息数
+    uint64_t skipped = 0;         // 协商成功但按策略原样发出的消息数（二进制帧、短文本）
+    uint64_t bytes_in = 0;        // 压缩的消息压缩前的字节数
+    uint64_t bytes_out = 0;       // 压缩后实际写出的负载字节数
+};
+
 class WebSocketClient {
 public:
     WebSocketClient() = delete;
 
-    WebSocketClient(const std::string& ws_url);
+    // manager 为空时 start() 创建私有的 lws 上下文和服务线程；
+    // 传入共享的 WebSocketManager 时多个 client 共用一个上下文和一个服务线程，各自独立连接
+    WebSocketClient(const std::string& ws_url, std::shared_ptr<WebSocketManager> manager = nullptr);
     ~WebSocketClient();
 
     void SetWsHeaders(const std::map<std::string, std::string>& ws_headers);
+    // 构造后更换服务器地址（例如使用 OTA 下发的地址）；需在 start() 之前设置，之后调用无效
+    void SetUrl(const std::string& ws_url);
+    // 当前使用的服务器地址；设置了多个候选时随竞速和失败切换变化
+    std::string Url() const;
+    // 多个候选服务器（需在 start() 之前设置）：Resolve() / start() 在调用线程上对所有候选竞速，
+    // 连接最先完成 TCP 握手的服务器及其地址；连接失败后按记住的延迟换下一个候选重试（需启用重连）
+    void SetEndpoints(std::shared_ptr<EndpointSelector> endpoints);
+    uint64_t EndpointSwitches() const { return endpoint_switches_; }  // 连接失败后切换候选的次数
+    // 构造后再指定共享管理器（例如挂在 Reactor 上的管理器）；需在 start() 之前设置，之后调用无效
+    void SetManager(std::shared_ptr<WebSocketManager> manager);
+    // start() 创建私有管理器时使用的 lws 缓冲区大小（共享管理器按其构造参数）；需在 start() 之前设置
+    void SetBufferConfig(const WebSocketBufferConfig& config) { buffers_ = config; }
+    // start() 创建私有管理器时的 permessage-deflate 协商（共享管理器按其构造参数）；需在 start() 之前设置
+    void SetDeflateConfig(const WebSocketDeflateConfig& config) { deflate_ = config; }
+    WebSocketDeflateStats GetDeflateStats() const;
     void start();
-    void send_text(const std::string& message);
-    void send_binary(const void* data, size_t len);
+    // 正常关闭（进程退出前）：在服务线程上发出 close 帧（1001 going away）并等待对端确认，最多等 timeout；
+    // 之后不再重连，正在连接或等待重连的连接直接放弃。不能在服务线程（lws 回调）中调用。
+    // 返回是否在 timeout 内关闭完毕（关闭回调已执行）；超时后剩下的连接随管理器销毁强制断开
+    bool Close(std::chrono::milliseconds timeout);
+    // 空闲断开：delay 内没有任何消息收发（入队或收到）时，在服务线程上发出 close 帧（1001 "idle"）并挂起连接，
+    // 挂起期间不再重连，排队的帧丢弃；lws 上下文、上次连通的 IP 和 TLS 会话缓存都保留。
+    // 其间有收发即取消（会话重新开始），之后须重新调用。可在任意线程调用，未 start() 时无效
+    void SuspendWhenIdle(std::chrono::milliseconds delay);
+    // 结束挂起并立即发起连接（不经退避），连接建立后照常回调 on open。返回是否处于挂起状态：
+    // 为 false 时连接未被挂起，尚未到期的空闲断开随之取消。与空闲断开的判定互斥，两者不会同时生效
+    bool Resume();
+    bool Suspended() const { return suspended_; }
+    uint64_t IdleSuspends() const { return idle_suspends_; }  // 空闲断开的次数
+    // 最近一次 Resume 到连接建立（握手完成）的耗时，未恢复过时为 0
+    double LastResumeMs() const { return last_resume_us_ / 1000.0; }
+    bool IsConnected() const { return connected_; }
+    // 下行流控：paused 为 true 时停止从 socket 读取（lws_rx_flow_control），内核接收缓冲区填满后
+    // TCP 接收窗口关闭，服务器随之放慢发送；为 false 时恢复读取。任意线程调用，在服务线程上生效，
+    // 重连后的新连接沿用当前状态。暂停期间读不到 pong，ping 超时判定顺延、这期间的 RTT 样本不计
+    void PauseReceive(bool paused);
+    bool ReceivePaused() const { return rx_pause_wanted_; }
+    uint64_t ReceivePauses() const { return rx_pauses_; }  // 实际暂停读取的次数
+    double ReceivePausedMs() const;                         // 累计暂停时长（含进行中的一次）
+    // 发送接口可在任意线程调用：数据拷贝进带 LWS_PRE 头部空间的缓冲区后入队，
+    // 实际的 lws_write 只在服务线程的 LWS_CALLBACK_CLIENT_WRITEABLE 中执行。
+    // 队列已满（或连接未建立时发送二进制）返回 false。
+    // 文本按 lane 入队（默认 Control），二进制总是进入 Audio 通道
+    bool send_text(std::string_view message, SendLane lane = SendLane::Control);
+    bool send_binary(const void* data, size_t len);
+
+    // 二进制分帧版本（1~3，默认 1 即裸 Opus），需在 start() 之前设置，同时写入握手头 Protocol-Version。
+    // v2/v3 下 send_binary 在发送槽位的 LWS_PRE 之后就地写入帧头（序号、时间戳、长度），负载紧随其后，不额外拷贝；
+    // 收到的二进制消息先校验并剥离帧头，回调只拿到负载，type 为 JSON 的帧按文本消息回调
+    void SetBinaryProtocol(int version);
+    int BinaryProtocol() const { return binary_version_; }
+    BinaryRxStats GetBinaryRxStats() const;
+    // 最近收到的下行帧序号（0 表示对端不填序号）；断线后保留到下一条带序号的帧到达，供续接会话时上报
+    uint32_t LastRxSequence() const { return rx_last_seen_.load(std::memory_order_relaxed); }
+    // 上行帧合并，需在 start() 之前设置；接收端总是拆开 AudioBatch 消息、逐帧回调
+    void SetAggregation(const AggregationConfig& config);
+    // 当前每条消息合并的帧数（1 表示不合并），Auto 模式下随链路类型和 RTT 变化
+    size_t BatchFrames() const { return batch_frames_; }
+    uint64_t BatchesSent() const { return batches_sent_; }
+    // 按 interval 发送 WebSocket ping，由 pong 测量往返时间；0（默认）不发送。需在 start() 之前设置。
+    // timeout 大于 0 时检测对端失联：ping 发出后 timeout 内既没有 pong 也没有任何消息，即判定 NAT 映射或对端已失效，
+    // 主动关闭连接（计入 DeadPeers），启用了重连时随即按退避策略重连，不必等 TCP 超时
+    void SetPingInterval(std::chrono::milliseconds interval,
+                         std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+    double RttMs() const { return srtt_us_ / 1000.0; }          // 平滑 RTT（未测得时为 0）
+    double LastRttMs() const { return last_rtt_us_ / 1000.0; }
+    double RttJitterMs() const { return rttvar_us_ / 1000.0; }  // RTT 平均偏差（与 TCP 的 RTTVAR 相同的 1/4 平滑）
+    uint64_t DeadPeers() const { return dead_peers_; }          // 因 ping 超时关闭的连接数
+    // 出口网卡名与是否判定为蜂窝链路，连接建立时确定
+    std::string LinkInterface() const;
+    bool CellularLink() const { return cellular_link_; }
+
+    // 发送队列上限（帧数），每条通道各 max_frames 个槽位；需在 start() 之前设置
+    void SetMaxSendQueue(size_t max_frames);
+    void SetMaxSendQueue(SendLane lane, size_t max_frames);
+    // 全部通道合计的排队帧数与其峰值；带 lane 的版本只计该通道
+    size_t SendQueueDepth() const;
+    size_t SendQueueDepth(SendLane lane) const;
+    size_t SendQueueHighWater() const { return send_high_water_; }
+    size_t SendQueueHighWater(SendLane lane) const;
+    uint64_t SendQueueDrops() const { return send_drops_; }
+    // 上行背压策略，需在 start() 之前设置；设置任一限制后，队列满时先挤掉最旧的音频帧再拒绝新消息
+    void SetSendBackpressure(const SendBackpressure& policy);
+    SendDropStats GetSendDropStats() const;
+    SendLatencyStats GetSendLatencyStats() const;
+    // 连接计数：成功建立、连接失败、已建立的连接断开；断线重连时三者随之增长
+    uint64_t Connections() const { return connections_; }
+    uint64_t ConnectErrors() const { return connect_errors_; }
+    uint64_t Disconnects() const { return disconnects_; }
+    // 断线重连：需在 start() 之前设置。启用后 start() 先在调用线程上解析服务器地址，
+    // 之后的连接直接使用上次连通的 IP，重连不再做 DNS 查询；用缓存地址连接失败时退回按主机名解析。
+    // libwebsockets 以 LWS_WITH_TLS_SESSIONS 构建时，重连用缓存的 TLS 会话恢复，省去完整握手
+    void SetReconnectPolicy(const ReconnectPolicy& policy);
+    // 提前解析服务器地址（start() 之前，可在任意一个线程上调用，与其他初始化并行），
+    // 第一次连接即使用解析结果；未调用时 start() 在启用重连的情况下自行解析。返回是否得到地址
+    bool Resolve();
+    // 是否已安排重连（在关闭/失败回调中查询可区分临时断线和最终断开）
+    bool Reconnecting() const { return reconnect_pending_; }
+    uint64_t Reconnects() const { return reconnects_; }           // 发起的重连次数
+    uint64_t ResumedSessions() const { return resumed_sessions_; }  // 恢复了 TLS 会话的连接数
+    // 每帧 入队->写出 的延迟同时计入 tracer 的 LatencyStage::SendQueue；需在 start() 之前设置
+    void SetLatencyTracer(std::shared_ptr<LatencyTracer> tracer) { tracer_ = std::move(tracer); }
+    // 每帧的入队/丢弃/写出和每条收到的消息记录到帧追踪文件；需在 start() 之前设置
+    void SetFrameTrace(std::shared_ptr<FrameTrace> trace) { frame_trace_ = std::move(trace); }
     
     void SetOnOpenCallback(std::function<std::string(void)> cb);
+    // 同上，连接建立后按顺序发出多条消息（如 hello 之后紧接 listen），全部排在断线前积压的帧之前
+    void SetOnOpenMessagesCallback(std::function<std::vector<std::string>(void)> cb);
     void SetOnCloseCallback(std::function<void(void)> cb);
     void SetOnFailCallback(std::function<void(void)> cb);
     void SetOnMessageCallback(std::function<std::string(const std::string&, bool)> cb);
+    // 零拷贝接收回调：view 指向 lws 接收缓冲区或连接内复用的重组缓冲区，只在回调期间有效。
+    // 分片消息会先重组完整再回调；设置后优先于 SetOnMessageCallback。
+    void SetOnMessageViewCallback(std::function<void(std::string_view, bool)> cb);
 
 private:
+    friend class WebSocketManager;
+
+    static constexpr const char* kProtocolName = "websocket-protocol";
+
     static int callback_websocket(struct lws *wsi, enum lws_callback_reasons reason,
                                   void *user, void *in, size_t len);
     
+    // 待发送帧：buf 前 LWS_PRE 字节为 lws 头部预留空间，负载从 buf[LWS_PRE] 开始
+    // 每条发送通道是固定槽位的环形队列，槽位缓冲区反复复用，稳态入队/出队都是 O(1) 且不分配内存
+    using NetworkBuffer = std::vector<unsigned char, TaggedAllocator<unsigned char, MemoryTag::Network>>;
+
+    struct SendFrame {
+        NetworkBuffer buf;
+        size_t len = 0;
+        enum lws_write_protocol type = LWS_WRITE_BINARY;
+        std::chrono::steady_clock::time_point enqueue_time;
+    };
+
+    struct SendQueue {
+        std::vector<SendFrame> ring;
+        size_t head = 0;                 // 下一个待写出的槽位（仅服务线程推进）
+        size_t count = 0;                // 队列中的帧数
+        std::atomic<size_t> depth{0};    // 持锁修改 count 时同步更新，指标采样无需加锁
+        std::atomic<size_t> high_water{0};
+    };
+
+    // 服务线程定时器（重连、ping、合并等待）：lws 的 sul 回调只给出链表节点，通过外层结构找到 client
+    struct ServiceTimer {
+        lws_sorted_usec_list_t sul;
+        WebSocketClient* client;
+        void (*cb)(lws_sorted_usec_list_t*);
+        bool pending = false;  // 仅服务线程
+    };
+
     void parse_url(const std::string& url);
-    void run_event_loop();
+    void resolve_host();
+    // 对候选服务器竞速并采用胜出者，没有可达的候选时返回 false
+    bool race_endpoints();
+    // 服务线程：连接失败后换用下一个候选，地址交给 lws 按主机名解析
+    void switch_endpoint();
+    // 连接失败或断开后（服务线程）：按策略安排下一次连接，不再重连时返回 false
+    bool schedule_reconnect();
+    void cancel_reconnect();
+    static void on_reconnect_timer(lws_sorted_usec_list_t* sul);
+    static void on_ping_timer(lws_sorted_usec_list_t* sul);
+    static void on_pong_timer(lws_sorted_usec_list_t* sul);
+    static void on_batch_timer(lws_sorted_usec_list_t* sul);
+    static void on_idle_timer(lws_sorted_usec_list_t* sul);
+    // 服务线程：挂起后关闭当前连接
+    void suspend_connection();
+    // 服务线程：跳过退避，尽快发起连接
+    void connect_soon();
+    void init_timer(ServiceTimer& timer, void (*cb)(lws_sorted_usec_list_t*));
+    // 服务线程上调用；已安排的定时器改为新的到期时间
+    void schedule_timer(ServiceTimer& timer, std::chrono::microseconds delay);
+    void cancel_timer(ServiceTimer& timer);
+    void on_established(struct lws* wsi);
+    void on_pong(const void* data, size_t len);
+    void update_batch_frames();
+    void dispatch_message(std::string_view message, bool is_binary);
+    // 持 queue_mutex_ 调用：把已合并的帧作为一条消息入队
+    void flush_batch_locked();
+    // 以下三个只在服务线程上由 WebSocketManager 调用
+    void connect();
+    void on_wake();
+    void unhook();
+    // 关闭完成（服务线程）：唤醒等待中的 Close
+    void finish_close();
+    // front 为 true 时插到通道队头（重连后的 hello 先于断线前积压的控制消息写出）
+    bool enqueue(const void* data, size_t len, enum lws_write_protocol type, SendLane lane, bool front = false);
+    bool enqueue_locked(const void* data, size_t len, enum lws_write_protocol type, SendLane lane, bool front,
+                        BinaryFrameType frame_type);
+    int on_writeable(struct lws* wsi);
+    // reserve 为每个槽位预留的负载空间，0 时槽位在第一次使用时按消息大小分配
+    void allocate_send_ring(SendQueue& queue, size_t slots, size_t reserve);
+    // 以下持 queue_mutex_ 调用。index 为从队头起的位置；正在写出的队头帧不会被移动或丢弃
+    SendQueue& lane_locked(SendLane lane) { return lanes_[static_cast<size_t>(lane)]; }
+    SendFrame& send_slot_locked(SendQueue& queue, size_t index) {
+        return queue.ring[(queue.head + index) % queue.ring.size()];
+    }
+    // 优先级最高的非空通道，全部为空时返回 nullptr
+    SendQueue* next_lane_locked();
+    // 移除 queue 中 [first, end) 的帧，其后的帧前移补位；同步更新深度
+    void remove_frames_locked(SendQueue& queue, size_t first, size_t end);
+    void update_depth_locked(SendQueue& queue);
+    void count_drop_locked(std::atomic<uint64_t>& reason, size_t len);
+    void expire_audio_locked(std::chrono::steady_clock::time_point now);
+    bool drop_oldest_audio_locked();
+    void on_receive(struct lws* wsi, const char* data, size_t len);
+    // 服务线程：按 rx_pause_wanted_ 暂停/恢复当前连接的读取。release 为 true 时（关闭连接）恢复读取并结算暂停时长，
+    // 不改变 rx_pause_wanted_，下一个连接建立时重新应用
+    void apply_rx_flow(bool release = false);
+    void deliver_message(std::string_view message, bool is_binary);
+    void track_sequence(uint32_t sequence);
     
     std::string ws_url_;
     std::string host_;
@@ -45,21 +328,124 @@ private:
     
     std::map<std::string, std::string> ws_headers_;
     
-    struct lws_context *context_;
-    struct lws *wsi_;
-    struct lws_protocols protocols_[2];
+    std::shared_ptr<WebSocketManager> manager_;
+    WebSocketBufferConfig buffers_;  // 私有管理器的 lws 缓冲区大小
+    WebSocketDeflateConfig deflate_;  // 私有管理器的 permessage-deflate 协商
+    struct lws *wsi_;  // 仅服务线程访问
     
-    std::function<std::string(void)> on_open_cb_;
+    std::function<std::vector<std::string>(void)> on_open_cb_;
     std::function<std::string(const std::string&, bool)> on_message_cb_;
+    std::function<void(std::string_view, bool)> on_message_view_cb_;
     std::function<void()> on_close_cb_;
     std::function<void()> on_fail_cb_;
     
-    std::thread event_thread_;
-    std::atomic<bool> running_;
-    std::mutex send_mutex_;
+    std::atomic<bool> running_;  // 已 start()，挂载在 manager_ 上
+    std::atomic<bool> connected_{false};
+    std::atomic<uint64_t> connections_{0};
+    std::atomic<uint64_t> connect_errors_{0};
+    std::atomic<uint64_t> disconnects_{0};
+
+    ReconnectPolicy reconnect_;
+    ServiceTimer reconnect_timer_;
+    unsigned reconnect_attempt_ = 0;         // 连续失败次数，连接建立后清零（仅服务线程）
+    std::atomic<bool> reconnect_pending_{false};
+    std::atomic<uint64_t> reconnects_{0};
+    std::atomic<uint64_t> resumed_sessions_{0};
+    std::minstd_rand reconnect_rng_;
+    std::shared_ptr<EndpointSelector> endpoints_;
+    size_t endpoint_index_ = 0;              // 当前使用的候选（启动线程设置，之后仅服务线程）
+    bool endpoints_raced_ = false;
+    std::atomic<uint64_t> endpoint_switches_{0};
+    std::string resolved_address_;           // 缓存的服务器 IP，为空时交给 lws 按主机名解析
+    bool connecting_resolved_ = false;       // 本次连接使用的是缓存地址
     
-    std::vector<std::string> send_queue_;
-    std::mutex queue_mutex_;
+    SendQueue lanes_[kSendLaneCount];   // 按 SendLane 下标
+    SendQueue* send_in_flight_ = nullptr;  // 服务线程正在锁外写出其队头帧的通道
+    SendBackpressure backpressure_;
+    std::atomic<uint64_t> drops_queue_full_{0};
+    std::atomic<uint64_t> drops_expired_{0};
+    std::atomic<uint64_t> drops_over_budget_{0};
+    std::atomic<uint64_t> drops_oversize_{0};
+    std::atomic<size_t> pending_{0};
+    std::atomic<size_t> send_high_water_{0};
+    std::atomic<uint64_t> send_drops_{0};
+    std::atomic<uint64_t> sent_frames_{0};
+    std::atomic<uint64_t> send_latency_total_ns_{0};
+    std::atomic<uint64_t> send_latency_max_ns_{0};
+    std::atomic<uint64_t> send_latency_last_ns_{0};
+    mutable ProfiledMutex queue_mutex_{"ws_queue"};
+    int binary_version_ = 1;
+    AggregationConfig aggregation_;
+    std::atomic<size_t> batch_frames_{1};
+    NetworkBuffer batch_buf_;               // 待合并的帧：[size(u16)][数据]...（持 queue_mutex_）
+    size_t batch_count_ = 0;
+    std::chrono::steady_clock::time_point batch_start_;
+    std::atomic<bool> batch_timer_wanted_{false};  // 有新的合并批次，请服务线程设置等待定时器
+    ServiceTimer batch_timer_;
+    std::atomic<uint64_t> batches_sent_{0};
+
+    bool tx_deflate_ = false;  // 正在写出的消息是否交给 deflate（仅服务线程，扩展回调据此跳过）
+    std::atomic<bool> deflate_active_{false};
+    std::atomic<uint64_t> deflate_compressed_{0};
+    std::atomic<uint64_t> deflate_skipped_{0};
+    std::atomic<uint64_t> deflate_in_bytes_{0};
+    std::atomic<uint64_t> deflate_out_bytes_{0};
+
+    std::chrono::milliseconds ping_interval_{0};
+    std::chrono::milliseconds ping_timeout_{0};
+    ServiceTimer ping_timer_;
+    ServiceTimer pong_timer_;      // ping 超时判定
+    bool ping_due_ = false;        // 仅服务线程
+    uint64_t awaiting_pong_us_ = 0;  // 等待应答的 ping 的发送时刻，收到任何数据后清零（仅服务线程）
+    std::atomic<uint64_t> srtt_us_{0};
+    std::atomic<uint64_t> last_rtt_us_{0};
+    std::atomic<uint64_t> rttvar_us_{0};
+    std::atomic<uint64_t> dead_peers_{0};
+    ServiceTimer idle_timer_;
+    std::atomic<int64_t> idle_delay_us_{0};     // SuspendWhenIdle 的等待时长，0 为未请求
+    std::atomic<bool> idle_wanted_{false};      // 有新的空闲断开请求，请服务线程安排定时器
+    uint64_t idle_mark_ = 0;                    // 安排定时器时的 activity_，到期时不同即有过收发（仅服务线程）
+    std::atomic<uint64_t> activity_{0};         // 收发计数：入队时（持 queue_mutex_）和收到消息时递增
+    std::atomic<bool> suspended_{false};        // 空闲挂起中，与 idle 判定一起持 queue_mutex_ 修改
+    std::atomic<bool> resume_wanted_{false};    // Resume 请求，请服务线程发起连接
+    bool resume_after_close_ = false;           // 挂起的连接还没关完就要恢复：关闭后立即连接（仅服务线程）
+    std::chrono::steady_clock::time_point resume_start_;  // 仅服务线程
+    bool resume_timing_ = false;                // 下一次连接建立时记录 Resume 耗时（仅服务线程）
+    std::atomic<uint64_t> idle_suspends_{0};
+    std::atomic<uint64_t> last_resume_us_{0};
+    const char* close_reason_ = "shutdown";     // 下一个 close 帧的原因（仅服务线程）
+    std::atomic<bool> closing_{false};  // 已调用 Close：不再连接、不再重连
+    bool close_started_ = false;        // 仅服务线程
+    bool close_due_ = false;            // 下一次可写回调发出 close 帧（仅服务线程）
+    ProfiledMutex close_mutex_{"ws_close"};
+    ProfiledConditionVariable close_cv_{"ws_close"};
+    bool close_done_ = false;           // 持 close_mutex_
+    std::string link_interface_;  // 持 queue_mutex_
+    std::atomic<bool> cellular_link_{false};
+    uint32_t tx_sequence_ = 0;  // 持 queue_mutex_ 递增，与入队顺序一致
+    std::chrono::steady_clock::time_point stream_start_ = std::chrono::steady_clock::now();  // 帧头时间戳的零点
+    std::shared_ptr<LatencyTracer> tracer_;
+    std::shared_ptr<FrameTrace> frame_trace_;
+
+    // 接收重组缓冲区（仅服务线程访问），容量在连接生命周期内复用
+    std::basic_string<char, std::char_traits<char>, TaggedAllocator<char, MemoryTag::Network>> rx_buffer_;
+    bool rx_binary_ = false;
+    // 接收序号跟踪（仅服务线程访问），每个连接重新开始
+    bool rx_sequence_active_ = false;
+    uint32_t rx_last_sequence_ = 0;
+    std::atomic<uint32_t> rx_last_seen_{0};
+    std::atomic<uint64_t> rx_frames_{0};
+    std::atomic<uint64_t> rx_malformed_{0};
+    std::atomic<uint64_t> rx_lost_{0};
+    std::atomic<uint64_t> rx_reordered_{0};
+    // 下行流控
+    std::atomic<bool> rx_pause_wanted_{false};
+    std::atomic<bool> rx_flow_changed_{false};  // 请服务线程应用 rx_pause_wanted_
+    bool rx_paused_ = false;                    // 当前连接已暂停读取（仅服务线程）
+    std::atomic<int64_t> rx_paused_since_us_{0};  // 本次暂停的开始时刻（steady_clock 微秒），未暂停时为 0
+    std::atomic<uint64_t> rx_pauses_{0};
+    std::atomic<uint64_t> rx_paused_us_{0};
+    uint64_t ping_pause_mark_ = 0;              // 发出待应答 ping 时的 rx_pauses_（仅服务线程）
 };
 
 }  // namespace linx
\ No newline at end of file
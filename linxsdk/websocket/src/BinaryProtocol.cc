@@ -0,0 +1,142 @@
+#include "BinaryProtocol.h"
+
+namespace linx {
+
+namespace {
+
+void PutU16(unsigned char* p, uint32_t v) {
+    p[0] = static_cast<unsigned char>(v >> 8);
+    p[1] = static_cast<unsigned char>(v);
+}
+
+void PutU32(unsigned char* p, uint32_t v) {
+    p[0] = static_cast<unsigned char>(v >> 24);
+    p[1] = static_cast<unsigned char>(v >> 16);
+    p[2] = static_cast<unsigned char>(v >> 8);
+    p[3] = static_cast<unsigned char>(v);
+}
+
+uint32_t GetU16(const unsigned char* p) {
+    return (static_cast<uint32_t>(p[0]) << 8) | p[1];
+}
+
+uint32_t GetU32(const unsigned char* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+}  // namespace
+
+size_t BinaryHeaderSize(int version) {
+    switch (version) {
+        case 1:
+            return 0;
+        case 2:
+            return kBinaryHeaderSizeV2;
+        case 3:
+            return kBinaryHeaderSizeV3;
+        default:
+            return 0;
+    }
+}
+
+bool IsValidBinaryProtocol(int version) {
+    return version >= 1 && version <= kMaxBinaryProtocolVersion;
+}
+
+size_t WriteBinaryHeader(unsigned char* out, int version, const BinaryFrameHeader& header) {
+    switch (version) {
+        case 2:
+            PutU16(out, 2);
+            PutU16(out + 2, static_cast<uint32_t>(header.type));
+            PutU32(out + 4, header.sequence);
+            PutU32(out + 8, header.timestamp_ms);
+            PutU32(out + 12, header.payload_size);
+            return kBinaryHeaderSizeV2;
+        case 3:
+            if (header.payload_size > 0xffff) {
+                return 0;
+            }
+            out[0] = static_cast<unsigned char>(header.type);
+            out[1] = static_cast<unsigned char>(header.sequence);
+            PutU16(out + 2, header.payload_size);
+            return kBinaryHeaderSizeV3;
+        default:
+            return 0;
+    }
+}
+
+bool ParseBinaryFrame(const void* data, size_t len, int version, BinaryFrameHeader* header,
+                      std::string_view* payload) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    *header = BinaryFrameHeader();
+    size_t header_size = 0;
+    switch (version) {
+        case 1:
+            header->payload_size = static_cast<uint32_t>(len);
+            *payload = std::string_view(static_cast<const char*>(data), len);
+            return true;
+        case 2:
+            if (len < kBinaryHeaderSizeV2 || GetU16(p) != 2) {
+                return false;
+            }
+            header->type = static_cast<BinaryFrameType>(GetU16(p + 2));
+            header->sequence = GetU32(p + 4);
+            header->timestamp_ms = GetU32(p + 8);
+            header->payload_size = GetU32(p + 12);
+            header_size = kBinaryHeaderSizeV2;
+            break;
+        case 3:
+            if (len < kBinaryHeaderSizeV3) {
+                return false;
+            }
+            header->type = static_cast<BinaryFrameType>(p[0]);
+            header->sequence = p[1];
+            header->payload_size = GetU16(p + 2);
+            header_size = kBinaryHeaderSizeV3;
+            break;
+        default:
+            return false;
+    }
+    if (header->payload_size != len - header_size) {
+        return false;
+    }
+    *payload = std::string_view(static_cast<const char*>(data) + header_size, header->payload_size);
+    return true;
+}
+
+size_t WriteBatchEntryHeader(unsigned char* out, uint16_t frame_size) {
+    PutU16(out, frame_size);
+    return kBatchEntryHeaderSize;
+}
+
+bool AudioBatchReader::Next(std::string_view* frame) {
+    if (rest_.empty() || error_) {
+        return false;
+    }
+    if (rest_.size() < kBatchEntryHeaderSize) {
+        error_ = true;
+        return false;
+    }
+    size_t size = GetU16(reinterpret_cast<const unsigned char*>(rest_.data()));
+    if (size > rest_.size() - kBatchEntryHeaderSize) {
+        error_ = true;
+        return false;
+    }
+    *frame = rest_.substr(kBatchEntryHeaderSize, size);
+    rest_.remove_prefix(kBatchEntryHeaderSize + size);
+    return true;
+}
+
+int32_t SequenceDelta(uint32_t a, uint32_t b, int bits) {
+    if (bits >= 32) {
+        return static_cast<int32_t>(b - a);
+    }
+    uint32_t mask = (1u << bits) - 1;
+    uint32_t diff = (b - a) & mask;
+    // 超过半个序号空间视为回退
+    return diff > (mask >> 1) ? static_cast<int32_t>(diff) - static_cast<int32_t>(mask + 1)
+                              : static_cast<int32_t>(diff);
+}
+
+}  // namespace linx
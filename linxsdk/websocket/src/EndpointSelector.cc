@@ -0,0 +1,394 @@
+#include "EndpointSelector.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <thread>
+
+#include "Json.h"
+#include "Log.h"
+
+namespace linx {
+
+namespace {
+
+struct SocketAddress {
+    sockaddr_storage storage;
+    socklen_t length = 0;
+};
+
+// 取出 ws:// / wss:// 地址中的主机和端口（支持 [v6 字面量]:port）
+bool SplitUrl(const std::string& url, std::string* host, std::string* port) {
+    bool tls = url.compare(0, 6, "wss://") == 0;
+    size_t scheme = url.find("://");
+    std::string rest = scheme == std::string::npos ? url : url.substr(scheme + 3);
+    std::string authority = rest.substr(0, rest.find('/'));
+    *port = tls ? "443" : "80";
+    if (!authority.empty() && authority[0] == '[') {
+        size_t close = authority.find(']');
+        if (close == std::string::npos) {
+            return false;
+        }
+        *host = authority.substr(1, close - 1);
+        if (close + 1 < authority.size() && authority[close + 1] == ':') {
+            *port = authority.substr(close + 2);
+        }
+    } else {
+        size_t colon = authority.find(':');
+        *host = authority.substr(0, colon);
+        if (colon != std::string::npos) {
+            *port = authority.substr(colon + 1);
+        }
+    }
+    return !host->empty() && !port->empty();
+}
+
+// 解析全部地址，按 RFC 8305 交替排列两个地址族，以解析结果中第一个地址的地址族开头
+std::vector<SocketAddress> ResolveAll(const std::string& url) {
+    std::vector<SocketAddress> addresses;
+    std::string host;
+    std::string port;
+    if (!SplitUrl(url, &host, &port)) {
+        WARN("endpoint race: bad url {}", url);
+        return addresses;
+    }
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    int rc = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+    if (rc != 0 || result == nullptr) {
+        WARN("endpoint race: resolve {} failed: {}", host, gai_strerror(rc));
+        return addresses;
+    }
+    std::vector<SocketAddress> first_family;
+    std::vector<SocketAddress> other_family;
+    for (struct addrinfo* info = result; info != nullptr; info = info->ai_next) {
+        if (info->ai_addrlen > sizeof(sockaddr_storage)) {
+            continue;
+        }
+        SocketAddress address;
+        memcpy(&address.storage, info->ai_addr, info->ai_addrlen);
+        address.length = info->ai_addrlen;
+        (info->ai_family == result->ai_family ? first_family : other_family).push_back(address);
+    }
+    freeaddrinfo(result);
+    for (size_t i = 0; i < std::max(first_family.size(), other_family.size()); ++i) {
+        if (i < first_family.size()) {
+            addresses.push_back(first_family[i]);
+        }
+        if (i < other_family.size()) {
+            addresses.push_back(other_family[i]);
+        }
+    }
+    return addresses;
+}
+
+std::string NumericHost(const SocketAddress& address) {
+    char host[NI_MAXHOST];
+    if (getnameinfo(reinterpret_cast<const sockaddr*>(&address.storage), address.length, host, sizeof(host), nullptr,
+                    0, NI_NUMERICHOST) != 0) {
+        return std::string();
+    }
+    return host;
+}
+
+// 解析在各自的线程上并行进行；竞速超时返回后仍未完成的解析线程只写入共享状态，不再访问 selector
+struct ResolveState {
+    explicit ResolveState(size_t count) : addresses(count), done(count, false) {}
+    ProfiledMutex mutex{"endpoint_resolve"};
+    std::vector<std::vector<SocketAddress>> addresses;
+    std::vector<bool> done;
+};
+
+}  // namespace
+
+struct EndpointSelector::Candidate {
+    std::vector<SocketAddress> addresses;
+    size_t next = 0;    // 下一个要尝试的地址
+    size_t active = 0;  // 进行中的连接数
+    bool resolved = false;
+    std::chrono::steady_clock::time_point next_due;
+
+    bool Exhausted() const { return resolved && next >= addresses.size() && active == 0; }
+};
+
+void EndpointSelector::SetEndpoints(const std::vector<std::string>& urls) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    std::vector<EndpointInfo> endpoints;
+    for (const auto& url : urls) {
+        if (url.empty() || std::any_of(endpoints.begin(), endpoints.end(),
+                                       [&](const EndpointInfo& info) { return info.url == url; })) {
+            continue;
+        }
+        EndpointInfo info;
+        info.url = url;
+        for (const auto& previous : endpoints_) {
+            if (previous.url == url) {
+                info = previous;
+            }
+        }
+        endpoints.push_back(info);
+    }
+    endpoints_ = std::move(endpoints);
+}
+
+std::vector<EndpointInfo> EndpointSelector::Endpoints() const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    return endpoints_;
+}
+
+size_t EndpointSelector::Size() const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    return endpoints_.size();
+}
+
+std::string EndpointSelector::UrlAt(size_t index) const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    return index < endpoints_.size() ? endpoints_[index].url : std::string();
+}
+
+std::vector<size_t> EndpointSelector::RankedLocked() const {
+    std::vector<size_t> ranked(endpoints_.size());
+    for (size_t i = 0; i < ranked.size(); ++i) {
+        ranked[i] = i;
+    }
+    auto key = [this](size_t index) {
+        const EndpointInfo& info = endpoints_[index];
+        double rtt = info.rtt_ms > 0 ? info.rtt_ms : std::numeric_limits<double>::max();
+        return std::make_pair(info.failures, rtt);
+    };
+    std::stable_sort(ranked.begin(), ranked.end(), [&](size_t a, size_t b) { return key(a) < key(b); });
+    return ranked;
+}
+
+size_t EndpointSelector::Next(size_t current) const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    std::vector<size_t> ranked = RankedLocked();
+    if (ranked.empty()) {
+        return 0;
+    }
+    auto it = std::find(ranked.begin(), ranked.end(), current);
+    if (it == ranked.end() || ++it == ranked.end()) {
+        return ranked.front();
+    }
+    return *it;
+}
+
+EndpointRaceResult EndpointSelector::Race(std::chrono::milliseconds timeout) {
+    std::vector<EndpointInfo> endpoints;
+    std::vector<size_t> ranked;
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        endpoints = endpoints_;
+        ranked = RankedLocked();
+    }
+    EndpointRaceResult result;
+    if (endpoints.empty()) {
+        return result;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + timeout;
+    auto resolve = std::make_shared<ResolveState>(endpoints.size());
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        std::thread([resolve, i, url = endpoints[i].url]() {
+            std::vector<SocketAddress> addresses = ResolveAll(url);
+            std::lock_guard<ProfiledMutex> lock(resolve->mutex);
+            resolve->addresses[i] = std::move(addresses);
+            resolve->done[i] = true;
+        }).detach();
+    }
+
+    // 最快的已知候选与未测得的候选立即开始，已知较慢的候选推迟一个尝试间隔
+    std::vector<Candidate> candidates(endpoints.size());
+    bool best_known = endpoints[ranked.front()].rtt_ms > 0;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        bool slower = best_known && i != ranked.front() && endpoints[i].rtt_ms > 0;
+        candidates[i].next_due = start + (slower ? kAttemptDelay : std::chrono::milliseconds(0));
+    }
+
+    struct Attempt {
+        size_t endpoint;
+        SocketAddress address;
+        int fd;
+        std::chrono::steady_clock::time_point started;
+    };
+    std::vector<Attempt> attempts;
+    bool won = false;
+    Attempt winner{};
+    auto finish = [&](const Attempt& attempt) {
+        won = true;
+        winner = attempt;
+        result.connect_ms =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - attempt.started).count();
+    };
+
+    while (!won) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            break;
+        }
+        {
+            std::lock_guard<ProfiledMutex> lock(resolve->mutex);
+            for (size_t i = 0; i < candidates.size(); ++i) {
+                if (!candidates[i].resolved && resolve->done[i]) {
+                    candidates[i].resolved = true;
+                    candidates[i].addresses = std::move(resolve->addresses[i]);
+                }
+            }
+        }
+
+        // 发起到期的连接：每个候选同一时刻只新开一个，上一个失败时下一个地址立即开始
+        for (size_t i = 0; i < candidates.size() && !won; ++i) {
+            Candidate& candidate = candidates[i];
+            while (candidate.resolved && candidate.next < candidate.addresses.size() && now >= candidate.next_due) {
+                Attempt attempt{i, candidate.addresses[candidate.next++], -1, now};
+                attempt.fd = socket(attempt.address.storage.ss_family, SOCK_STREAM, 0);
+                if (attempt.fd < 0) {
+                    continue;
+                }
+                fcntl(attempt.fd, F_SETFL, fcntl(attempt.fd, F_GETFL) | O_NONBLOCK);
+                int rc = connect(attempt.fd, reinterpret_cast<const sockaddr*>(&attempt.address.storage),
+                                 attempt.address.length);
+                if (rc == 0) {
+                    finish(attempt);
+                    break;
+                }
+                if (errno != EINPROGRESS) {
+                    close(attempt.fd);
+                    continue;
+                }
+                attempts.push_back(attempt);
+                candidate.active++;
+                candidate.next_due = now + kAttemptDelay;
+                break;
+            }
+        }
+        if (won) {
+            break;
+        }
+
+        bool unresolved = false;
+        bool remaining = !attempts.empty();
+        auto wake = deadline;
+        for (const auto& candidate : candidates) {
+            if (!candidate.resolved) {
+                unresolved = true;
+            } else if (candidate.next < candidate.addresses.size()) {
+                remaining = true;
+                wake = std::min(wake, candidate.next_due);
+            }
+        }
+        if (!remaining && !unresolved) {
+            break;  // 所有地址都已失败
+        }
+        if (unresolved) {
+            wake = std::min(wake, now + std::chrono::milliseconds(5));  // 定期取回新的解析结果
+        }
+
+        std::vector<struct pollfd> fds(attempts.size());
+        for (size_t i = 0; i < attempts.size(); ++i) {
+            fds[i].fd = attempts[i].fd;
+            fds[i].events = POLLOUT;
+            fds[i].revents = 0;
+        }
+        int wait_ms = static_cast<int>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count());
+        int ready = poll(fds.data(), fds.size(), std::max(wait_ms, 0));
+        if (ready <= 0) {
+            continue;
+        }
+        now = std::chrono::steady_clock::now();
+        for (size_t i = fds.size(); i-- > 0;) {
+            if (fds[i].revents == 0) {
+                continue;
+            }
+            Attempt attempt = attempts[i];
+            attempts.erase(attempts.begin() + static_cast<ptrdiff_t>(i));
+            candidates[attempt.endpoint].active--;
+            int error = 0;
+            socklen_t length = sizeof(error);
+            if (!won && getsockopt(attempt.fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0) {
+                finish(attempt);
+                continue;
+            }
+            close(attempt.fd);
+            candidates[attempt.endpoint].next_due = now;
+        }
+    }
+
+    for (const auto& attempt : attempts) {
+        close(attempt.fd);
+    }
+    if (won) {
+        close(winner.fd);  // 只用来测量，WebSocket 连接由 lws 用胜出的地址重新建立
+        result.ok = true;
+        result.index = winner.endpoint;
+        result.url = endpoints[winner.endpoint].url;
+        result.address = NumericHost(winner.address);
+        INFO("endpoint race: {} ({}) won in {:.1f}ms after {:.1f}ms", result.url, result.address, result.connect_ms,
+             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    } else {
+        WARN("endpoint race: no endpoint reachable within {}ms", timeout.count());
+    }
+
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        for (auto& info : endpoints_) {
+            if (info.url != endpoints[i].url) {
+                continue;
+            }
+            if (won && i == winner.endpoint) {
+                info.rtt_ms = info.rtt_ms > 0 ? info.rtt_ms + (result.connect_ms - info.rtt_ms) * kRttGain
+                                              : result.connect_ms;
+                info.failures = 0;
+            } else if (candidates[i].Exhausted()) {
+                // 全部地址都连不上：忘掉旧的延迟，下次立即参与竞速
+                info.rtt_ms = 0;
+                info.failures++;
+            }
+        }
+    }
+    return result;
+}
+
+std::string EndpointSelector::SaveState() const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    json state = json::array();
+    for (const auto& info : endpoints_) {
+        state.push_back({{"url", info.url}, {"rtt_ms", info.rtt_ms}, {"failures", info.failures}});
+    }
+    return state.dump();
+}
+
+bool EndpointSelector::LoadState(const std::string& state) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    try {
+        json stored = json::parse(state);
+        for (const auto& entry : stored) {
+            std::string url = entry.at("url").get<std::string>();
+            for (auto& info : endpoints_) {
+                if (info.url == url) {
+                    info.rtt_ms = entry.value("rtt_ms", 0.0);
+                    info.failures = entry.value("failures", 0u);
+                }
+            }
+        }
+    } catch (const json_exception& e) {
+        WARN("endpoint state is corrupt, ignored: {}", e.what());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace linx
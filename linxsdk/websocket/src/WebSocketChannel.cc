@@ -0,0 +1,113 @@
+#include "WebSocketChannel.h"
+
+#ifdef LINX_HAS_COROUTINES
+
+#include <utility>
+
+namespace linx {
+
+WebSocketChannel::WebSocketChannel(Reactor& reactor, WebSocketClient& client, size_t max_queued)
+    : reactor_(reactor), client_(client), state_(std::make_shared<State>()) {
+    state_->max_queued = max_queued > 0 ? max_queued : 1;
+    Reactor* loop = &reactor_;
+    std::weak_ptr<State> weak = state_;
+    // 回调可能在 WebSocket 服务线程上执行（未挂在 reactor 上时），一律拷贝后投递到循环线程再处理
+    client_.SetOnMessageViewCallback([loop, weak](std::string_view data, bool binary) {
+        WsMessage message;
+        message.data.assign(data.data(), data.size());
+        message.binary = binary;
+        loop->Post([weak, message = std::move(message)]() mutable {
+            if (auto state = weak.lock()) {
+                Deliver(state, std::move(message));
+            }
+        });
+    });
+    client_.SetOnOpenCallback([loop, weak]() {
+        loop->Post([weak] {
+            if (auto state = weak.lock()) {
+                ResumeConnect(state);
+            }
+        });
+        return std::string();
+    });
+    auto on_down = [loop, weak]() {
+        loop->Post([weak] {
+            if (auto state = weak.lock()) {
+                WsMessage closed;
+                closed.closed = true;
+                Deliver(state, std::move(closed));
+                ResumeConnect(state);
+            }
+        });
+    };
+    client_.SetOnCloseCallback(on_down);
+    client_.SetOnFailCallback(on_down);
+}
+
+WebSocketChannel::~WebSocketChannel() {
+    state_->alive = false;
+    client_.SetOnMessageViewCallback(nullptr);
+    client_.SetOnOpenCallback(nullptr);
+    client_.SetOnCloseCallback(nullptr);
+    client_.SetOnFailCallback(nullptr);
+}
+
+void WebSocketChannel::BeginConnect(std::coroutine_handle<> handle) {
+    state_->connect_waiter = handle;
+    if (!started_) {
+        started_ = true;
+        client_.start();
+    }
+}
+
+WsMessage WebSocketChannel::PopMessage() {
+    WsMessage message = std::move(state_->messages.front());
+    state_->messages.pop_front();
+    return message;
+}
+
+bool WebSocketChannel::TrySend(const std::string& payload, bool binary) {
+    return binary ? client_.send_binary(payload.data(), payload.size()) : client_.send_text(payload);
+}
+
+void WebSocketChannel::RetrySend(SendAwaiter* awaiter, std::coroutine_handle<> handle,
+                                 std::chrono::steady_clock::time_point deadline) {
+    std::weak_ptr<State> weak = state_;
+    reactor_.AddTimer(kSendRetry, [this, weak, awaiter, handle, deadline] {
+        auto state = weak.lock();
+        if (!state || !state->alive) {
+            handle.resume();  // channel 已销毁：以失败结束这次发送
+            return;
+        }
+        awaiter->sent = TrySend(awaiter->payload, awaiter->binary);
+        if (awaiter->sent || !client_.IsConnected() || std::chrono::steady_clock::now() >= deadline) {
+            handle.resume();
+            return;
+        }
+        RetrySend(awaiter, handle, deadline);
+    });
+}
+
+void WebSocketChannel::Deliver(const std::shared_ptr<State>& state, WsMessage message) {
+    if (!state->alive) {
+        return;
+    }
+    if (state->messages.size() >= state->max_queued) {
+        state->messages.pop_front();
+        ++state->dropped;
+    }
+    state->messages.push_back(std::move(message));
+    if (state->message_waiter) {
+        std::exchange(state->message_waiter, nullptr).resume();
+    }
+}
+
+void WebSocketChannel::ResumeConnect(const std::shared_ptr<State>& state) {
+    if (state->alive && state->connect_waiter) {
+        std::exchange(state->connect_waiter, nullptr).resume();
+    }
+}
+
+}  // namespace linx
+
+#endif  // LINX_HAS_COROUTINES
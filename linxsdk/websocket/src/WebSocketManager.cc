@@ -0,0 +1,341 @@
+#include "WebSocketManager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+
+#include "Log.h"
+#include "MemoryAccounting.h"
+#include "Tracepoints.h"
+#include "Websocket.h"
+
+namespace linx {
+
+namespace {
+
+// lws 的分配器只给出 realloc 语义（size 为 0 即释放），长度记在块前的头里
+struct alignas(std::max_align_t) LwsBlockHeader {
+    size_t size;
+};
+
+void* LwsCountingRealloc(void* ptr, size_t size, const char* reason) {
+    (void)reason;
+    LwsBlockHeader* header = ptr ? static_cast<LwsBlockHeader*>(ptr) - 1 : nullptr;
+    size_t old_size = header ? header->size : 0;
+    if (size == 0) {
+        if (header) {
+            AccountMemory(MemoryTag::Network, -static_cast<int64_t>(old_size));
+            free(header);
+        }
+        return nullptr;
+    }
+    auto* block = static_cast<LwsBlockHeader*>(realloc(header, sizeof(LwsBlockHeader) + size));
+    if (!block) {
+        return nullptr;  // 原块保持不变
+    }
+    block->size = size;
+    if (old_size > 0) {
+        AccountMemory(MemoryTag::Network, -static_cast<int64_t>(old_size));
+    }
+    AccountMemory(MemoryTag::Network, static_cast<int64_t>(size));
+    return block + 1;
+}
+
+}  // namespace
+
+void WebSocketManager::EnableMemoryAccounting() {
+    static std::once_flag once;
+    std::call_once(once, []() { lws_set_allocator(LwsCountingRealloc); });
+}
+
+WebSocketManager::WebSocketManager(Reactor* reactor, const WebSocketBufferConfig& buffers,
+                                   const WebSocketDeflateConfig& deflate)
+    : reactor_(reactor), buffers_(buffers), deflate_(deflate) {
+    // 所有连接共用一个协议；连接级回调的 user 指针即 connect 时传入的 client
+    protocols_[0] = {
+        WebSocketClient::kProtocolName,
+        WebSocketClient::callback_websocket,
+        0,
+        buffers_.rx_buffer_size,
+        0, nullptr,
+        buffers_.tx_packet_size
+    };
+    protocols_[1] = { nullptr, nullptr, 0, 0, 0, nullptr, 0 };
+#if !defined(LWS_WITHOUT_EXTENSIONS)
+    // 握手中提出 permessage-deflate，允许服务器限制客户端的窗口大小；不提出 no_context_takeover
+    extensions_[0] = { "permessage-deflate", DeflateCallback, "permessage-deflate; client_max_window_bits" };
+    extensions_[1] = { nullptr, nullptr, nullptr };
+#endif
+}
+
+#if !defined(LWS_WITHOUT_EXTENSIONS)
+int WebSocketManager::DeflateCallback(struct lws_context* context, const struct lws_extension* ext, struct lws* wsi,
+                                      enum lws_extension_callback_reasons reason, void* user, void* in, size_t len) {
+    WebSocketClient* client = wsi ? static_cast<WebSocketClient*>(lws_wsi_user(wsi)) : nullptr;
+    if (reason == LWS_EXT_CB_PAYLOAD_TX && client && !client->tx_deflate_) {
+        // 不交给 deflate：lws 发出原始负载，帧头不置 RSV1，对端按未压缩消息接收；zlib 上下文不受影响
+        return 0;
+    }
+    int n = lws_extension_callback_pm_deflate(context, ext, wsi, reason, user, in, len);
+    if (!client) {
+        return n;
+    }
+    switch (reason) {
+        case LWS_EXT_CB_CLIENT_CONSTRUCT:
+            // 服务器接受了扩展，本连接上的 zlib 上下文已建立
+            client->deflate_active_ = n == 0;
+            break;
+        case LWS_EXT_CB_DESTROY:
+            client->deflate_active_ = false;
+            break;
+        case LWS_EXT_CB_PAYLOAD_TX:
+            if (n >= 0) {
+                const auto* ebufs = static_cast<const struct lws_ext_pm_deflate_rx_ebufs*>(in);
+                client->deflate_out_bytes_.fetch_add(static_cast<uint64_t>(std::max(ebufs->eb_out.len, 0)),
+                                                     std::memory_order_relaxed);
+            }
+            break;
+        default:
+            break;
+    }
+    return n;
+}
+#endif
+
+WebSocketManager::~WebSocketManager() { Stop(); }
+
+bool WebSocketManager::Start() {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    if (context_) {
+        return true;
+    }
+
+    struct lws_context_creation_info info;
+    memset(&info, 0, sizeof(info));
+
+    info.port = CONTEXT_PORT_NO_LISTEN;
+    info.protocols = protocols_;
+    info.gid = -1;
+    info.uid = -1;
+    info.pt_serv_buf_size = static_cast<unsigned int>(buffers_.pt_serv_buf_size);
+    info.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
+    info.user = this;  // 供 LWS_CALLBACK_EVENT_WAIT_CANCELLED 等非连接回调找到管理器
+    if (deflate_.enabled) {
+#if !defined(LWS_WITHOUT_EXTENSIONS)
+        info.extensions = extensions_;
+#else
+        WARN("libwebsockets built with LWS_WITHOUT_EXTENSIONS, permessage-deflate disabled");
+#endif
+    }
+
+    // reactor 模式下创建上下文期间 lws 就会通过 ADD_POLL_FD 注册取消管道等 fd
+    context_ = lws_create_context(&info);
+    if (!context_) {
+        ERROR("Failed to create libwebsockets context");
+        return false;
+    }
+
+    running_ = true;
+    if (reactor_) {
+        // lws 的超时、心跳等内部定时器：每秒无阻塞地服务一次
+        lws_timer_ = reactor_->AddTimer(
+            std::chrono::seconds(1), [this]() { lws_service_tsi(context_, -1, 0); }, std::chrono::seconds(1));
+    } else {
+        thread_ = std::thread(&WebSocketManager::Run, this);
+    }
+    return true;
+}
+
+void WebSocketManager::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (reactor_) {
+        if (reactor_->Running() && !reactor_->InLoopThread()) {
+            // lws 上下文只能在执行回调的线程上销毁
+            std::promise<void> done;
+            reactor_->Post([this, &done]() {
+                Teardown();
+                done.set_value();
+            });
+            done.get_future().wait();
+        } else {
+            Teardown();
+        }
+        return;
+    }
+    lws_cancel_service(context_);  // 唤醒阻塞在 lws_service 中的服务线程
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    Teardown();
+}
+
+void WebSocketManager::Teardown() {
+    if (reactor_) {
+        reactor_->CancelTimer(lws_timer_);
+        reactor_->CancelTimer(service_timer_);
+        service_timer_ = 0;
+    }
+    // 销毁上下文时仍挂载的连接会收到关闭回调；reactor 模式下 lws 同时通过 DEL_POLL_FD 注销各个 fd
+    lws_context_destroy(context_);
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    context_ = nullptr;
+    clients_.clear();
+    connect_queue_.clear();
+    detach_queue_.clear();
+    detached_cv_.notify_all();
+}
+
+void WebSocketManager::Run() {
+    // 服务线程只在网络事件、lws 内部定时器或 lws_cancel_service 唤醒时运行
+    while (running_) {
+        LINX_PROBE(ws_service_enter);
+        int ret = lws_service(context_, 0);
+        LINX_PROBE(ws_service_return, ret);
+        if (ret < 0) {
+            break;
+        }
+    }
+}
+
+size_t WebSocketManager::ClientCount() const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    return clients_.size();
+}
+
+void WebSocketManager::Attach(WebSocketClient* client) {
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        clients_.push_back(client);
+        connect_queue_.push_back(client);
+    }
+    Wake();
+}
+
+void WebSocketManager::RemoveLocked(WebSocketClient* client) {
+    clients_.erase(std::remove(clients_.begin(), clients_.end(), client), clients_.end());
+    connect_queue_.erase(std::remove(connect_queue_.begin(), connect_queue_.end(), client), connect_queue_.end());
+}
+
+bool WebSocketManager::OnServiceThread() const {
+    return reactor_ ? reactor_->InLoopThread() : std::this_thread::get_id() == thread_.get_id();
+}
+
+bool WebSocketManager::ServiceActive() const {
+    return running_ && (!reactor_ || reactor_->Running());
+}
+
+void WebSocketManager::Detach(WebSocketClient* client) {
+    std::unique_lock<ProfiledMutex> lock(mutex_);
+    if (std::find(clients_.begin(), clients_.end(), client) == clients_.end()) {
+        return;
+    }
+    if (!ServiceActive() || OnServiceThread()) {
+        // 服务线程已停止，或在 client 自己的回调中析构：直接摘除
+        if (running_) {
+            client->unhook();
+            // 可能正处于 OnWake 的连接循环中：本轮尚未发起的连接不再发起
+            std::replace(connect_swap_.begin(), connect_swap_.end(), client, static_cast<WebSocketClient*>(nullptr));
+        }
+        RemoveLocked(client);
+        return;
+    }
+    detach_queue_.push_back(client);
+    lws_cancel_service(context_);
+    detached_cv_.wait(lock, [&]() {
+        return std::find(clients_.begin(), clients_.end(), client) == clients_.end();
+    });
+}
+
+void WebSocketManager::Wake() {
+    if (running_) {
+        lws_cancel_service(context_);
+    }
+}
+
+void WebSocketManager::OnWake() {
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        if (!detach_queue_.empty()) {
+            for (WebSocketClient* client : detach_queue_) {
+                client->unhook();
+                RemoveLocked(client);
+            }
+            detach_queue_.clear();
+            detached_cv_.notify_all();
+        }
+        connect_swap_.swap(connect_queue_);
+        for (WebSocketClient* client : clients_) {
+            client->on_wake();
+        }
+    }
+    // lws_client_connect_via_info 可能同步触发 CONNECTION_ERROR 回调，不持锁调用
+    for (size_t i = 0; i < connect_swap_.size(); ++i) {
+        if (connect_swap_[i]) {
+            connect_swap_[i]->connect();
+        }
+    }
+    connect_swap_.clear();
+}
+
+void WebSocketManager::OnPollFd(enum lws_callback_reasons reason, const struct lws_pollargs* args) {
+    if (!reactor_ || !args) {
+        return;
+    }
+    switch (reason) {
+        case LWS_CALLBACK_ADD_POLL_FD:
+            reactor_->AddFd(args->fd, static_cast<short>(args->events),
+                            [this](int fd, short revents) { ServiceFd(fd, revents); });
+            break;
+        case LWS_CALLBACK_DEL_POLL_FD:
+            reactor_->RemoveFd(args->fd);
+            break;
+        case LWS_CALLBACK_CHANGE_MODE_POLL_FD:
+            reactor_->ModifyFd(args->fd, static_cast<short>(args->events));
+            break;
+        default:
+            break;
+    }
+}
+
+void WebSocketManager::ServiceFd(int fd, short revents) {
+    if (!context_) {
+        return;
+    }
+    struct lws_pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = revents;
+    pfd.revents = revents;
+    lws_service_fd(context_, &pfd);
+    ServicePending();
+}
+
+void WebSocketManager::ServiceAfter(std::chrono::microseconds delay) {
+    if (!reactor_) {
+        return;
+    }
+    // 只保留最早的一个：更晚到期的 lws 定时器在这次服务之后由每秒一次的定时服务兜底
+    auto deadline = std::chrono::steady_clock::now() + delay;
+    if (service_timer_ != 0 && service_deadline_ <= deadline) {
+        return;
+    }
+    reactor_->CancelTimer(service_timer_);
+    service_deadline_ = deadline;
+    service_timer_ = reactor_->AddTimer(delay, [this]() {
+        service_timer_ = 0;
+        if (context_) {
+            lws_service_tsi(context_, -1, 0);
+            ServicePending();
+        }
+    });
+}
+
+void WebSocketManager::ServicePending() {
+    // TLS 层已读入但尚未交给 lws 处理的数据不会再让 fd 就绪，需要主动服务一次
+    if (context_ && lws_service_adjust_timeout(context_, 1, 0) == 0) {
+        lws_service_tsi(context_, -1, 0);
+    }
+}
+
+}  // namespace linx
@@ -1,33 +1,88 @@
 #include "Websocket.h"
+#include "WebSocketManager.h"
+#include "Tracepoints.h"
+#include "SteadyClock.h"
+#include <ifaddrs.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
 #include <sstream>
 #include <cstring>
 
 namespace linx {
 
-WebSocketClient::WebSocketClient(const std::string& ws_url) 
-    : ws_url_(ws_url), context_(nullptr), wsi_(nullptr), running_(false) {
+namespace {
+
+// 连接所用的本地网卡：按 socket 的本地地址在网卡列表中查找
+std::string InterfaceForSocket(int fd) {
+    struct sockaddr_storage local;
+    socklen_t len = sizeof(local);
+    if (fd < 0 || getsockname(fd, reinterpret_cast<struct sockaddr*>(&local), &len) != 0) {
+        return {};
+    }
+    struct ifaddrs* list = nullptr;
+    if (getifaddrs(&list) != 0) {
+        return {};
+    }
+    std::string name;
+    for (struct ifaddrs* it = list; it != nullptr && name.empty(); it = it->ifa_next) {
+        if (it->ifa_addr == nullptr || it->ifa_addr->sa_family != local.ss_family) {
+            continue;
+        }
+        if (local.ss_family == AF_INET) {
+            const auto* a = reinterpret_cast<const struct sockaddr_in*>(it->ifa_addr);
+            const auto* b = reinterpret_cast<const struct sockaddr_in*>(&local);
+            if (a->sin_addr.s_addr == b->sin_addr.s_addr) {
+                name = it->ifa_name;
+            }
+        } else if (local.ss_family == AF_INET6) {
+            const auto* a = reinterpret_cast<const struct sockaddr_in6*>(it->ifa_addr);
+            const auto* b = reinterpret_cast<const struct sockaddr_in6*>(&local);
+            if (memcmp(&a->sin6_addr, &b->sin6_addr, sizeof(a->sin6_addr)) == 0) {
+                name = it->ifa_name;
+            }
+        }
+    }
+    freeifaddrs(list);
+    return name;
+}
+
+// 常见的蜂窝网卡命名：Linux 的 wwan/ppp/rmnet/USB 网卡模块，Android 的 ccmni，macOS/iOS 的 pdp_ip
+bool IsCellularInterface(const std::string& name) {
+    static const char* const kPrefixes[] = {"wwan", "wwp", "ppp", "rmnet", "ccmni", "usb", "pdp_ip"};
+    for (const char* prefix : kPrefixes) {
+        if (name.compare(0, strlen(prefix), prefix) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+WebSocketClient::WebSocketClient(const std::string& ws_url, std::shared_ptr<WebSocketManager> manager)
+    : ws_url_(ws_url), manager_(std::move(manager)), wsi_(nullptr), running_(false),
+      reconnect_rng_(std::random_device{}()) {
     
     parse_url(ws_url);
-    
-    // 初始化协议
-    protocols_[0] = {
-        "websocket-protocol",
-        callback_websocket,
-        0,
-        1024,
-        0, this, 0
-    };
-    protocols_[1] = { nullptr, nullptr, 0, 0, 0, nullptr, 0 };
+    init_timer(reconnect_timer_, &WebSocketClient::on_reconnect_timer);
+    init_timer(ping_timer_, &WebSocketClient::on_ping_timer);
+    init_timer(pong_timer_, &WebSocketClient::on_pong_timer);
+    init_timer(batch_timer_, &WebSocketClient::on_batch_timer);
+    init_timer(idle_timer_, &WebSocketClient::on_idle_timer);
+
+    SetMaxSendQueue(256);
 }
 
 WebSocketClient::~WebSocketClient() {
-    running_ = false;
-    if (event_thread_.joinable()) {
-        event_thread_.join();
-    }
-    if (context_) {
-        lws_context_destroy(context_);
+    if (running_) {
+        // 先确保服务线程不再回调本对象；私有管理器随后随 manager_ 一起销毁
+        manager_->Detach(this);
+        running_ = false;
     }
 }
 
@@ -68,43 +123,352 @@ void WebSocketClient::parse_url(const std::string& url) {
 }
 
 void WebSocketClient::SetWsHeaders(const std::map<std::string, std::string>& ws_headers) {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
+    std::lock_guard<ProfiledMutex> lock(queue_mutex_);
     ws_headers_ = ws_headers;
+    if (binary_version_ > 1) {
+        ws_headers_["Protocol-Version"] = std::to_string(binary_version_);  // 与分帧版本保持一致
+    }
+}
+
+void WebSocketClient::SetBinaryProtocol(int version) {
+    std::lock_guard<ProfiledMutex> lock(queue_mutex_);
+    if (running_) {
+        WARN("SetBinaryProtocol must be called before start(), ignored");
+        return;
+    }
+    if (!IsValidBinaryProtocol(version)) {
+        WARN("unsupported binary protocol version {}, keeping {}", version, binary_version_);
+        return;
+    }
+    binary_version_ = version;
+    ws_headers_["Protocol-Version"] = std::to_string(version);
+}
+
+BinaryRxStats WebSocketClient::GetBinaryRxStats() const {
+    BinaryRxStats stats;
+    stats.frames = rx_frames_;
+    stats.malformed = rx_malformed_;
+    stats.lost = rx_lost_;
+    stats.reordered = rx_reordered_;
+    return stats;
+}
+
+void WebSocketClient::SetAggregation(const AggregationConfig& config) {
+    std::lock_guard<ProfiledMutex> lock(queue_mutex_);
+    if (running_) {
+        WARN("SetAggregation must be called before start(), ignored");
+        return;
+    }
+    if (config.mode != AggregationMode::Off && binary_version_ == 1) {
+        // v1 裸 Opus 没有帧类型，对端无法区分合并消息
+        WARN("frame aggregation needs binary protocol v2/v3, disabled");
+    }
+    aggregation_ = config;
+    aggregation_.max_frames = std::max<size_t>(aggregation_.max_frames, 1);
+}
+
+void WebSocketClient::SetPingInterval(std::chrono::milliseconds interval, std::chrono::milliseconds timeout) {
+    if (running_) {
+        WARN("SetPingInterval must be called before start(), ignored");
+        return;
+    }
+    ping_interval_ = std::max(interval, std::chrono::milliseconds(0));
+    ping_timeout_ = std::max(timeout, std::chrono::milliseconds(0));
+}
+
+std::string WebSocketClient::LinkInterface() const {
+    std::lock_guard<ProfiledMutex> lock(queue_mutex_);
+    return link_interface_;
+}
+
+void WebSocketClient::SetUrl(const std::string& ws_url) {
+    if (running_) {
+        WARN("SetUrl must be called before start(), ignored");
+        return;
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(queue_mutex_);
+        ws_url_ = ws_url;
+    }
+    parse_url(ws_url);
+    resolved_address_.clear();
+}
+
+std::string WebSocketClient::Url() const {
+    std::lock_guard<ProfiledMutex> lock(queue_mutex_);
+    return ws_url_;
 }
 
+void WebSocketClient::SetEndpoints(std::shared_ptr<EndpointSelector> endpoints) {
+    if (running_) {
+        WARN("SetEndpoints must be called before start(), ignored");
+        return;
+    }
+    endpoints_ = std::move(endpoints);
+    endpoints_raced_ = false;
+    resolved_address_.clear();
+}
+
+bool WebSocketClient::race_endpoints() {
+    endpoints_raced_ = true;  // 每次启动只竞速一次，全部失败时退回按当前地址解析
+    EndpointRaceResult winner = endpoints_->Race();
+    if (!winner.ok) {
+        return false;
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(queue_mutex_);
+        ws_url_ = winner.url;
+    }
+    parse_url(winner.url);
+    endpoint_index_ = winner.index;
+    resolved_address_ = winner.address;
+    return !resolved_address_.empty();
+}
+
+void WebSocketClient::switch_endpoint() {
+    size_t next = endpoints_->Next(endpoint_index_);
+    std::string url = endpoints_->UrlAt(next);
+    if (next == endpoint_index_ || url.empty()) {
+        return;
+    }
+    INFO("WebSocket endpoint {} unreachable, switching to {}", Url(), url);
+    {
+        std::lock_guard<ProfiledMutex> lock(queue_mutex_);
+        ws_url_ = url;
+    }
+    parse_url(url);
+    endpoint_index_ = next;
+    resolved_address_.clear();
+    endpoint_switches_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void WebSocketClient::SetReconnectPolicy(const ReconnectPolicy& policy) {
+    if (running_) {
+        WARN("SetReconnectPolicy must be called before start(), ignored");
+        return;
+    }
+    reconnect_ = policy;
+}
+
+bool WebSocketClient::Resolve() {
+    if (running_) {
+        WARN("Resolve must be called before start(), ignored");
+        return false;
+    }
+    if (resolved_address_.empty() && endpoints_ && endpoints_->Size() > 0 && !endpoints_raced_) {
+        race_endpoints();
+    }
+    if (resolved_address_.empty()) {
+        resolve_host();
+    }
+    return !resolved_address_.empty();
+}
+
+void WebSocketClient::resolve_host() {
+    // 预先解析：启动时在调用线程上查询一次，服务线程上的连接和重连都不必再阻塞在 DNS 上
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    auto start = std::chrono::steady_clock::now();
+    int rc = getaddrinfo(host_.c_str(), nullptr, &hints, &result);
+    if (rc != 0 || result == nullptr) {
+        WARN("resolve {} failed: {}", host_, gai_strerror(rc));
+        return;
+    }
+    char address[NI_MAXHOST];
+    if (getnameinfo(result->ai_addr, result->ai_addrlen, address, sizeof(address), nullptr, 0, NI_NUMERICHOST) == 0) {
+        resolved_address_ = address;
+        INFO("resolved {} -> {} in {:.1f}ms", host_, resolved_address_,
+             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    freeaddrinfo(result);
+}
+
+void WebSocketClient::SetManager(std::shared_ptr<WebSocketManager> manager) {
+    if (running_) {
+        WARN("SetManager must be called before start(), ignored");
+        return;
+    }
+    manager_ = std::move(manager);
+}
 
 void WebSocketClient::start() {
-    struct lws_context_creation_info info;
-    memset(&info, 0, sizeof(info));
-    
-    info.port = CONTEXT_PORT_NO_LISTEN;
-    info.protocols = protocols_;
-    info.gid = -1;
-    info.uid = -1;
-    info.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
-    
-    context_ = lws_create_context(&info);
-    if (!context_) {
-        ERROR("Failed to create libwebsockets context");
+    if (running_) {
+        return;
+    }
+    if (!manager_) {
+        manager_ = std::make_shared<WebSocketManager>(nullptr, buffers_, deflate_);
+    }
+    if (!manager_->Start()) {
         return;
     }
+    if (resolved_address_.empty() && endpoints_ && endpoints_->Size() > 0 && !endpoints_raced_) {
+        race_endpoints();
+    }
+    if (reconnect_.enabled && resolved_address_.empty()) {
+        resolve_host();
+    }
+#if !defined(LWS_WITH_TLS_SESSIONS)
+    if (reconnect_.enabled && use_ssl_) {
+        INFO("libwebsockets built without LWS_WITH_TLS_SESSIONS, reconnects use a full TLS handshake");
+    }
+#endif
     
     running_ = true;
-    event_thread_ = std::thread(&WebSocketClient::run_event_loop, this);
+    manager_->Attach(this);  // 连接在服务线程上发起
+}
+
+bool WebSocketClient::Close(std::chrono::milliseconds timeout) {
+    if (!running_ || !manager_->ServiceActive() || manager_->OnServiceThread()) {
+        return false;
+    }
+    closing_ = true;
+    manager_->Wake();  // 在服务线程的 on_wake 中发起关闭
+    std::unique_lock<ProfiledMutex> lock(close_mutex_);
+    return close_cv_.wait_for(lock, timeout, [this]() { return close_done_; });
 }
 
-void WebSocketClient::run_event_loop() {
+void WebSocketClient::PauseReceive(bool paused) {
+    if (rx_pause_wanted_.exchange(paused) == paused) {
+        return;
+    }
+    rx_flow_changed_ = true;
+    if (running_) {
+        manager_->Wake();  // 在服务线程的 on_wake 中生效
+    }
+}
+
+double WebSocketClient::ReceivePausedMs() const {
+    uint64_t total = rx_paused_us_.load(std::memory_order_relaxed);
+    int64_t since = rx_paused_since_us_.load(std::memory_order_relaxed);
+    if (since > 0) {
+        int64_t now = static_cast<int64_t>(SteadyNowUs());
+        total += static_cast<uint64_t>(std::max<int64_t>(0, now - since));
+    }
+    return total / 1000.0;
+}
+
+void WebSocketClient::apply_rx_flow(bool release) {
+    // 正在关闭（退出或空闲挂起）的连接须读到对端回应的 close 帧，不再暂停
+    bool want = !release && !closing_ && !suspended_ && rx_pause_wanted_.load();
+    if (want != rx_paused_ && (release || (wsi_ && connected_))) {
+        if (wsi_) {
+            lws_rx_flow_control(wsi_, want ? 0 : 1);
+        }
+        int64_t now = static_cast<int64_t>(SteadyNowUs());
+        if (want && !rx_paused_) {
+            rx_pauses_.fetch_add(1, std::memory_order_relaxed);
+            rx_paused_since_us_ = now;
+        } else if (!want && rx_paused_) {
+            rx_paused_us_.fetch_add(static_cast<uint64_t>(std::max<int64_t>(0, now - rx_paused_since_us_.load())),
+                                    std::memory_order_relaxed);
+            rx_paused_since_us_ = 0;
+        }
+        rx_paused_ = want;
+    }
+}
+
+void WebSocketClient::SuspendWhenIdle(std::chrono::milliseconds delay) {
+    if (!running_ || delay.count() <= 0) {
+        return;
+    }
+    idle_delay_us_ = std::chrono::duration_cast<std::chrono::microseconds>(delay).count();
+    idle_wanted_ = true;
+    manager_->Wake();  // 在服务线程的 on_wake 中安排定时器
+}
+
+bool WebSocketClient::Resume() {
+    bool was_suspended;
+    {
+        // 与空闲定时器的判定互斥：要么这里看到已挂起（随后重连），要么定时器看到有过活动而取消
+        std::lock_guard<ProfiledMutex> lock(queue_mutex_);
+        was_suspended = suspended_.exchange(false);
+        activity_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (was_suspended && running_) {
+        resume_wanted_ = true;
+        manager_->Wake();
+    }
+    return was_suspended;
+}
+
+void WebSocketClient::on_idle_timer(lws_sorted_usec_list_t* sul) {
+    WebSocketClient* client = reinterpret_cast<ServiceTimer*>(sul)->client;
+    client->idle_timer_.pending = false;
+    if (client->closing_ || client->suspended_) {
+        return;
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(client->queue_mutex_);
+        if (client->activity_.load(std::memory_order_relaxed) != client->idle_mark_) {
+            return;  // 定时期间有过收发：会话重新开始，不再断开
+        }
+        client->suspended_ = true;
+        // 挂起期间不写出任何帧；服务线程上没有进行中的写出，可以直接清空
+        size_t discarded = client->pending_;
+        for (SendQueue& queue : client->lanes_) {
+            client->remove_frames_locked(queue, 0, queue.count);
+        }
+        client->batch_buf_.clear();
+        client->batch_count_ = 0;
+        if (discarded > 0) {
+            INFO("WebSocket idle: discarded {} queued frames", discarded);
+        }
+    }
+    client->idle_suspends_.fetch_add(1, std::memory_order_relaxed);
+    INFO("WebSocket idle for {}ms, closing connection until resumed", client->idle_delay_us_.load() / 1000);
+    client->suspend_connection();
+}
+
+void WebSocketClient::suspend_connection() {
+    cancel_reconnect();
+    cancel_timer(batch_timer_);
+    reconnect_attempt_ = 0;
+    if (!wsi_) {
+        return;
+    }
+    if (connected_) {
+        close_reason_ = "idle";
+        close_due_ = true;
+        lws_callback_on_writable(wsi_);
+        apply_rx_flow();  // 须读到对端回应的 close 帧
+    } else {
+        lws_set_timeout(wsi_, PENDING_TIMEOUT_USER_OK, LWS_TO_KILL_ASYNC);  // 握手尚未完成，直接放弃
+    }
+}
+
+void WebSocketClient::connect_soon() {
+    cancel_reconnect();
+    reconnect_pending_ = true;
+    schedule_timer(reconnect_timer_, std::chrono::microseconds(1));  // 不在 lws 回调内直接发起新连接
+}
+
+void WebSocketClient::finish_close() {
+    std::lock_guard<ProfiledMutex> lock(close_mutex_);
+    close_done_ = true;
+    close_cv_.notify_all();
+}
+
+void WebSocketClient::connect() {
+    if (closing_) {
+        finish_close();  // 关闭请求先于排队的连接（或重连）到达
+        return;
+    }
     struct lws_client_connect_info ccinfo;
     memset(&ccinfo, 0, sizeof(ccinfo));
     
-    ccinfo.context = context_;
-    ccinfo.address = host_.c_str();
+    ccinfo.context = manager_->context_;
+    // 有缓存的 IP 时直接连接，Host 头和 TLS SNI 仍使用主机名
+    connecting_resolved_ = !resolved_address_.empty();
+    ccinfo.address = connecting_resolved_ ? resolved_address_.c_str() : host_.c_str();
     ccinfo.port = port_;
     ccinfo.path = path_.c_str();
     ccinfo.host = host_.c_str();
     ccinfo.origin = host_.c_str();
-    ccinfo.protocol = protocols_[0].name;
-    ccinfo.userdata = this;
+    ccinfo.protocol = kProtocolName;
+    ccinfo.userdata = this;  // 连接级回调通过 lws_wsi_user 找到本对象
     
     if (use_ssl_) {
         ccinfo.ssl_connection = LCCSCF_USE_SSL | LCCSCF_ALLOW_SELFSIGNED | LCCSCF_SKIP_SERVER_CERT_HOSTNAME_CHECK;
@@ -113,40 +477,685 @@ void WebSocketClient::run_event_loop() {
     wsi_ = lws_client_connect_via_info(&ccinfo);
     if (!wsi_) {
         ERROR("Failed to connect to websocket server");
+        schedule_reconnect();  // 已在同步触发的 CONNECTION_ERROR 中安排过时不重复安排
+    }
+}
+
+bool WebSocketClient::schedule_reconnect() {
+    if (!running_ || !manager_->running_ || closing_) {
+        return false;  // 已摘除、正在关闭，或上下文正在销毁
+    }
+    if (resume_after_close_ && !suspended_) {
+        resume_after_close_ = false;
+        connect_soon();  // 挂起的连接刚关完，Resume 已经在等
+        return true;
+    }
+    if (!reconnect_.enabled || suspended_) {
+        return false;  // 未启用，或空闲挂起中
+    }
+    if (reconnect_pending_) {
+        return true;
+    }
+    if (reconnect_.max_attempts > 0 && reconnect_attempt_ >= reconnect_.max_attempts) {
+        ERROR("WebSocket reconnect: giving up after {} attempts", reconnect_attempt_);
+        return false;
+    }
+
+    double delay_ms = static_cast<double>(reconnect_.initial_delay.count()) *
+                      std::pow(reconnect_.multiplier, static_cast<double>(reconnect_attempt_));
+    delay_ms = std::min(delay_ms, static_cast<double>(reconnect_.max_delay.count()));
+    double jitter = std::min(std::max(reconnect_.jitter, 0.0), 1.0);
+    delay_ms *= 1.0 - jitter * std::uniform_real_distribution<double>(0.0, 1.0)(reconnect_rng_);
+    reconnect_attempt_++;
+
+    reconnect_pending_ = true;
+    schedule_timer(reconnect_timer_, std::chrono::microseconds(static_cast<int64_t>(delay_ms * 1000) + 1));
+    INFO("WebSocket reconnect #{} in {:.0f}ms", reconnect_attempt_, delay_ms);
+    return true;
+}
+
+void WebSocketClient::cancel_reconnect() {
+    cancel_timer(reconnect_timer_);
+    reconnect_pending_ = false;
+}
+
+void WebSocketClient::init_timer(ServiceTimer& timer, void (*cb)(lws_sorted_usec_list_t*)) {
+    memset(&timer.sul, 0, sizeof(timer.sul));
+    timer.client = this;
+    timer.cb = cb;
+    timer.pending = false;
+}
+
+void WebSocketClient::schedule_timer(ServiceTimer& timer, std::chrono::microseconds delay) {
+    timer.pending = true;
+    lws_sul_schedule(manager_->context_, 0, &timer.sul, timer.cb, static_cast<lws_usec_t>(delay.count()));
+    manager_->ServiceAfter(delay);
+}
+
+void WebSocketClient::cancel_timer(ServiceTimer& timer) {
+    if (timer.pending && manager_ && manager_->context_) {
+        lws_sul_schedule(manager_->context_, 0, &timer.sul, timer.cb, LWS_SET_TIMER_USEC_CANCEL);
+    }
+    timer.pending = false;
+}
+
+void WebSocketClient::on_reconnect_timer(lws_sorted_usec_list_t* sul) {
+    WebSocketClient* client = reinterpret_cast<ServiceTimer*>(sul)->client;
+    client->reconnect_timer_.pending = false;
+    client->reconnect_pending_ = false;
+    if (!client->running_ || client->wsi_ || client->suspended_) {
         return;
     }
-    
-    while (running_ && lws_service(context_, 50) >= 0) {
-        // 处理发送队列
-        std::lock_guard<std::mutex> lock(queue_mutex_);
-        if (!send_queue_.empty() && wsi_) {
-            std::string msg = send_queue_.front();
-            send_queue_.erase(send_queue_.begin());
-            
-            unsigned char buf[LWS_PRE + msg.length()];
-            memcpy(&buf[LWS_PRE], msg.c_str(), msg.length());
-            lws_write(wsi_, &buf[LWS_PRE], msg.length(), LWS_WRITE_TEXT);
+    client->reconnects_.fetch_add(1, std::memory_order_relaxed);
+    client->connect();
+}
+
+void WebSocketClient::on_ping_timer(lws_sorted_usec_list_t* sul) {
+    WebSocketClient* client = reinterpret_cast<ServiceTimer*>(sul)->client;
+    client->ping_timer_.pending = false;
+    if (!client->wsi_ || !client->connected_) {
+        return;  // 连接建立时重新开始
+    }
+    client->ping_due_ = true;
+    lws_callback_on_writable(client->wsi_);
+    client->schedule_timer(client->ping_timer_, client->ping_interval_);
+}
+
+void WebSocketClient::on_pong_timer(lws_sorted_usec_list_t* sul) {
+    WebSocketClient* client = reinterpret_cast<ServiceTimer*>(sul)->client;
+    client->pong_timer_.pending = false;
+    if (!client->wsi_ || !client->connected_ || client->awaiting_pong_us_ == 0) {
+        return;  // 已收到应答或数据，或连接已断开
+    }
+    if (client->rx_paused_) {
+        // 下行流控暂停了读取，应答可能就在接收缓冲区里：恢复读取后再判定
+        client->schedule_timer(client->pong_timer_, client->ping_timeout_);
+        return;
+    }
+    WARN("WebSocket peer silent for {}ms after ping, closing connection", client->ping_timeout_.count());
+    client->dead_peers_.fetch_add(1, std::memory_order_relaxed);
+    client->awaiting_pong_us_ = 0;
+    // 异步关闭：随后的 LWS_CALLBACK_CLOSED 照常触发关闭回调和重连
+    lws_set_timeout(client->wsi_, PENDING_TIMEOUT_USER_OK, LWS_TO_KILL_ASYNC);
+}
+
+void WebSocketClient::on_batch_timer(lws_sorted_usec_list_t* sul) {
+    WebSocketClient* client = reinterpret_cast<ServiceTimer*>(sul)->client;
+    client->batch_timer_.pending = false;
+    std::chrono::microseconds remaining(0);
+    {
+        std::lock_guard<ProfiledMutex> lock(client->queue_mutex_);
+        if (client->batch_count_ == 0) {
+            return;  // 已凑满 K 帧发出
+        }
+        auto deadline = client->batch_start_ + client->aggregation_.max_hold;
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            client->flush_batch_locked();
+        } else {
+            // 定时器属于更早的一批，当前这批还没到期
+            remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - now);
+        }
+    }
+    if (remaining.count() > 0) {
+        client->schedule_timer(client->batch_timer_, remaining);
+    } else if (client->wsi_ && client->connected_) {
+        lws_callback_on_writable(client->wsi_);
+    }
+}
+
+void WebSocketClient::on_wake() {
+    if (closing_ && !close_started_) {
+        close_started_ = true;
+        cancel_reconnect();
+        if (!wsi_) {
+            finish_close();
+        } else if (connected_) {
+            close_due_ = true;  // close 帧和其他数据一样只在可写回调中写出
+            lws_callback_on_writable(wsi_);
+            apply_rx_flow();  // 须读到对端回应的 close 帧
+        } else {
+            // 握手尚未完成：没有可以发 close 帧的连接，直接放弃，随后的 CONNECTION_ERROR 完成关闭
+            lws_set_timeout(wsi_, PENDING_TIMEOUT_USER_OK, LWS_TO_KILL_ASYNC);
+        }
+        return;
+    }
+    if (resume_wanted_.exchange(false) && !closing_ && !suspended_) {
+        resume_start_ = std::chrono::steady_clock::now();
+        resume_timing_ = true;
+        if (wsi_) {
+            resume_after_close_ = true;  // 空闲 close 还在进行，关闭回调中再连
+        } else {
+            connect_soon();
+        }
+    }
+    if (idle_wanted_.exchange(false) && !closing_ && !suspended_) {
+        idle_mark_ = activity_.load(std::memory_order_relaxed);
+        schedule_timer(idle_timer_, std::chrono::microseconds(idle_delay_us_.load()));
+    }
+    if (rx_flow_changed_.exchange(false)) {
+        apply_rx_flow();
+    }
+    // 其他线程调用了 lws_cancel_service：有新数据入队，在服务线程上请求可写回调
+    if (pending_ > 0 && wsi_ && connected_) {
+        lws_callback_on_writable(wsi_);
+    }
+    // 新的合并批次：按第一帧的时间安排最长等待
+    if (batch_timer_wanted_.exchange(false) && !batch_timer_.pending) {
+        std::chrono::microseconds remaining(0);
+        {
+            std::lock_guard<ProfiledMutex> lock(queue_mutex_);
+            if (batch_count_ > 0) {
+                remaining = std::chrono::duration_cast<std::chrono::microseconds>(
+                    batch_start_ + aggregation_.max_hold - std::chrono::steady_clock::now());
+            }
+        }
+        schedule_timer(batch_timer_, std::max(remaining, std::chrono::microseconds(1)));
+    }
+}
+
+void WebSocketClient::unhook() {
+    if (wsi_) {
+        // 之后该连接上的回调拿到的 user 为空，直接忽略；连接异步关闭
+        lws_set_wsi_user(wsi_, nullptr);
+        lws_set_timeout(wsi_, PENDING_TIMEOUT_USER_OK, LWS_TO_KILL_ASYNC);
+        wsi_ = nullptr;
+    }
+    cancel_reconnect();
+    cancel_timer(ping_timer_);
+    cancel_timer(pong_timer_);
+    cancel_timer(batch_timer_);
+    cancel_timer(idle_timer_);
+    apply_rx_flow(true);
+    connected_ = false;
+}
+
+void WebSocketClient::allocate_send_ring(SendQueue& queue, size_t slots, size_t reserve) {
+    queue.ring.clear();
+    queue.ring.resize(slots > 0 ? slots : 1);
+    if (reserve > 0) {
+        for (auto& slot : queue.ring) {
+            slot.buf.reserve(LWS_PRE + reserve);
+        }
+    }
+    queue.head = 0;
+    queue.count = 0;
+    queue.depth = 0;
+    queue.high_water = 0;
+    size_t pending = 0;
+    for (const SendQueue& lane : lanes_) {
+        pending += lane.count;
+    }
+    pending_ = pending;
+}
+
+WebSocketClient::SendQueue* WebSocketClient::next_lane_locked() {
+    // 严格优先级：数组下标即 SendLane 的优先级顺序
+    for (SendQueue& queue : lanes_) {
+        if (queue.count > 0) {
+            return &queue;
+        }
+    }
+    return nullptr;
+}
+
+void WebSocketClient::update_depth_locked(SendQueue& queue) {
+    queue.depth.store(queue.count, std::memory_order_relaxed);
+    if (queue.count > queue.high_water.load(std::memory_order_relaxed)) {
+        queue.high_water.store(queue.count, std::memory_order_relaxed);
+    }
+    size_t pending = 0;
+    for (const SendQueue& lane : lanes_) {
+        pending += lane.count;
+    }
+    pending_ = pending;
+    if (pending > send_high_water_) {
+        send_high_water_ = pending;
+    }
+}
+
+void WebSocketClient::remove_frames_locked(SendQueue& queue, size_t first, size_t end) {
+    if (end <= first) {
+        return;
+    }
+    if (first == 0) {
+        queue.head = (queue.head + end) % queue.ring.size();
+    } else {
+        // 队头帧正在写出、不能移动：把后面的帧前移补上空位（交换槽位，缓冲区随之移动、继续复用）
+        for (size_t keep = first, index = end; index < queue.count; ++keep, ++index) {
+            std::swap(send_slot_locked(queue, keep), send_slot_locked(queue, index));
+        }
+    }
+    queue.count -= end - first;
+    update_depth_locked(queue);
+}
+
+void WebSocketClient::count_drop_locked(std::atomic<uint64_t>& reason, size_t len) {
+    reason.fetch_add(1, std::memory_order_relaxed);
+    send_drops_++;
+    LINX_PROBE(ws_drop, len, pending_.load(std::memory_order_relaxed));
+    if (frame_trace_) {
+        frame_trace_->Record(TraceStage::SendDrop, len, pending_.load(std::memory_order_relaxed));
+    }
+}
+
+void WebSocketClient::expire_audio_locked(std::chrono::steady_clock::time_point now) {
+    // 音频通道按入队时间有序：从队头起数出过期的帧，遇到第一帧未过期的即可停止
+    SendQueue& queue = lane_locked(SendLane::Audio);
+    auto cutoff = now - backpressure_.max_audio_age;
+    size_t first = send_in_flight_ == &queue ? 1 : 0;
+    size_t end = first;
+    for (; end < queue.count; ++end) {
+        const SendFrame& frame = send_slot_locked(queue, end);
+        if (frame.enqueue_time >= cutoff) {
+            break;
+        }
+        count_drop_locked(drops_expired_, frame.len);
+    }
+    remove_frames_locked(queue, first, end);
+}
+
+bool WebSocketClient::drop_oldest_audio_locked() {
+    SendQueue& queue = lane_locked(SendLane::Audio);
+    size_t first = send_in_flight_ == &queue ? 1 : 0;
+    if (queue.count <= first) {
+        return false;
+    }
+    count_drop_locked(drops_over_budget_, send_slot_locked(queue, first).len);
+    remove_frames_locked(queue, first, first + 1);
+    return true;
+}
+
+bool WebSocketClient::enqueue(const void* data, size_t len, enum lws_write_protocol type, SendLane lane,
+                              bool front) {
+    std::lock_guard<ProfiledMutex> lock(queue_mutex_);
+    return enqueue_locked(data, len, type, lane, front, BinaryFrameType::Audio);
+}
+
+bool WebSocketClient::enqueue_locked(const void* data, size_t len, enum lws_write_protocol type, SendLane lane,
+                                     bool front, BinaryFrameType frame_type) {
+    auto now = std::chrono::steady_clock::now();
+    SendQueue& queue = lane_locked(lane);
+    bool audio = lane == SendLane::Audio;
+    bool limited = backpressure_.max_audio_age.count() > 0 || backpressure_.max_audio_frames > 0;
+    if (backpressure_.max_audio_age.count() > 0) {
+        expire_audio_locked(now);
+    }
+    while (audio && backpressure_.max_audio_frames > 0 && queue.count >= backpressure_.max_audio_frames) {
+        if (!drop_oldest_audio_locked()) {
+            break;
+        }
+    }
+    // 启用背压时音频通道满先挤掉最旧的一帧；控制和大块通道与音频互不占用槽位，满了直接拒绝
+    if (queue.count >= queue.ring.size() && !(audio && limited && drop_oldest_audio_locked())) {
+        count_drop_locked(drops_queue_full_, len);
+        return false;
+    }
+
+    size_t header_size = type == LWS_WRITE_BINARY ? BinaryHeaderSize(binary_version_) : 0;
+    if (header_size > 0 && binary_version_ == 3 && len > 0xffff) {
+        WARN("binary frame of {} bytes exceeds the v3 payload size limit, dropped", len);
+        count_drop_locked(drops_oversize_, len);
+        return false;
+    }
+    // 写入队尾槽位；服务线程只读取队头槽位，两者不会重叠。
+    // 插到队头只发生在服务线程上（连接建立回调中），此时没有进行中的写出
+    if (front) {
+        queue.head = (queue.head + queue.ring.size() - 1) % queue.ring.size();
+    }
+    SendFrame& frame = send_slot_locked(queue, front ? 0 : queue.count);
+    if (frame.buf.size() < LWS_PRE + header_size + len) {
+        frame.buf.resize(LWS_PRE + header_size + len);
+    }
+    if (header_size > 0) {
+        // 帧头就地写在 lws 头部空间之后，负载直接拷到帧头后面
+        BinaryFrameHeader header;
+        header.type = frame_type;
+        header.sequence = ++tx_sequence_;
+        header.timestamp_ms = static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - stream_start_)
+                .count());
+        header.payload_size = static_cast<uint32_t>(len);
+        WriteBinaryHeader(frame.buf.data() + LWS_PRE, binary_version_, header);
+    }
+    memcpy(frame.buf.data() + LWS_PRE + header_size, data, len);
+    frame.len = header_size + len;
+    frame.type = type;
+    frame.enqueue_time = now;
+    activity_.fetch_add(1, std::memory_order_relaxed);
+    queue.count++;
+    update_depth_locked(queue);
+    LINX_PROBE(ws_enqueue, len, pending_.load(std::memory_order_relaxed));
+    if (frame_trace_) {
+        frame_trace_->Record(TraceStage::SendEnqueue, len, pending_.load(std::memory_order_relaxed));
+    }
+    if (running_) {
+        // 唤醒服务线程，由它在 LWS_CALLBACK_EVENT_WAIT_CANCELLED 中请求可写回调
+        manager_->Wake();
+    }
+    return true;
+}
+
+// 每次可写回调尽可能多地写出帧，直到全部通道为空或 socket 发送缓冲区被占满。
+// 每写完一帧都重新按优先级选通道：控制消息最多等正在写出的那一帧，不会排在积压的音频后面
+int WebSocketClient::on_writeable(struct lws* wsi) {
+    if (close_due_) {
+        // 返回 -1 时 lws 带上 close_reason 发出 close 帧，等对端回应后触发 LWS_CALLBACK_CLOSED；队列中剩余的帧丢弃
+        close_due_ = false;
+        lws_close_reason(wsi, LWS_CLOSE_STATUS_GOINGAWAY,
+                         reinterpret_cast<unsigned char*>(const_cast<char*>(close_reason_)), strlen(close_reason_));
+        close_reason_ = "shutdown";
+        return -1;
+    }
+    if (ping_due_) {
+        // ping 负载为发送时刻（steady_clock 微秒），pong 原样带回
+        ping_due_ = false;
+        unsigned char ping[LWS_PRE + 8];
+        uint64_t now_us = SteadyNowUs();
+        memcpy(ping + LWS_PRE, &now_us, sizeof(now_us));
+        if (lws_write(wsi, ping + LWS_PRE, sizeof(now_us), LWS_WRITE_PING) < static_cast<int>(sizeof(now_us))) {
+            ERROR("lws_write ping failed");
+            return -1;
+        }
+        ping_pause_mark_ = rx_pauses_.load(std::memory_order_relaxed);
+        if (ping_timeout_.count() > 0 && awaiting_pong_us_ == 0) {
+            // 从最早一个未应答的 ping 起计时，后续 ping 不推迟判定
+            awaiting_pong_us_ = now_us;
+            schedule_timer(pong_timer_, ping_timeout_);
+        }
+        if (pending_ > 0 && lws_send_pipe_choked(wsi)) {
+            lws_callback_on_writable(wsi);
+            return 0;
+        }
+    }
+    while (true) {
+        SendQueue* queue = nullptr;
+        SendFrame* frame = nullptr;
+        {
+            std::lock_guard<ProfiledMutex> lock(queue_mutex_);
+            if (backpressure_.max_audio_age.count() > 0) {
+                // 停顿后恢复时，先丢掉排队过久的音频，不再写出已无意义的旧帧
+                expire_audio_locked(std::chrono::steady_clock::now());
+            }
+            queue = next_lane_locked();
+            if (queue == nullptr) {
+                return 0;
+            }
+            frame = &queue->ring[queue->head];
+            send_in_flight_ = queue;
+        }
+
+        // 队头槽位在出队前不会被生产者改写或移动，可以在锁外写出
+        bool deflate = deflate_active_.load(std::memory_order_relaxed);
+        tx_deflate_ = deflate && frame->type == LWS_WRITE_TEXT && frame->len >= manager_->deflate_.min_text_bytes;
+        LINX_PROBE(ws_write_enter, frame->len, static_cast<int>(frame->type));
+        int n = lws_write(wsi, frame->buf.data() + LWS_PRE, frame->len, frame->type);
+        LINX_PROBE(ws_write_return, n);
+        if (n < static_cast<int>(frame->len)) {
+            ERROR("lws_write failed: {} of {} bytes", n, frame->len);
+            std::lock_guard<ProfiledMutex> lock(queue_mutex_);
+            send_in_flight_ = nullptr;
+            return -1;
+        }
+
+        uint64_t latency_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::steady_clock::now() - frame->enqueue_time)
+                                  .count();
+        sent_frames_++;
+        if (tx_deflate_) {
+            deflate_compressed_.fetch_add(1, std::memory_order_relaxed);
+            deflate_in_bytes_.fetch_add(frame->len, std::memory_order_relaxed);
+        } else if (deflate) {
+            deflate_skipped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        send_latency_total_ns_ += latency_ns;
+        send_latency_last_ns_ = latency_ns;
+        if (latency_ns > send_latency_max_ns_) {
+            send_latency_max_ns_ = latency_ns;
+        }
+        if (tracer_) {
+            tracer_->Record(LatencyStage::SendQueue, latency_ns / 1000);
+        }
+
+        size_t written = frame->len;
+        size_t remaining = 0;
+        {
+            std::lock_guard<ProfiledMutex> lock(queue_mutex_);
+            send_in_flight_ = nullptr;
+            remove_frames_locked(*queue, 0, 1);
+            remaining = pending_;
+        }
+        if (frame_trace_) {
+            frame_trace_->Record(TraceStage::SendWrite, written, remaining);
+        }
+
+        if (remaining == 0) {
+            return 0;
+        }
+        if (lws_send_pipe_choked(wsi)) {
+            // socket 暂时写不下，等下一次可写回调继续
+            lws_callback_on_writable(wsi);
+            return 0;
         }
     }
 }
 
-void WebSocketClient::send_text(const std::string& message) {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    send_queue_.push_back(message);
+bool WebSocketClient::send_text(std::string_view message, SendLane lane) {
     INFO(">> {}", message);
+    return enqueue(message.data(), message.size(), LWS_WRITE_TEXT, lane);
 }
 
-void WebSocketClient::send_binary(const void* data, size_t len) {
-    if (!wsi_) return;
-    
-    std::lock_guard<std::mutex> lock(send_mutex_);
-    unsigned char buf[LWS_PRE + len];
-    memcpy(&buf[LWS_PRE], data, len);
-    lws_write(wsi_, &buf[LWS_PRE], len, LWS_WRITE_BINARY);
+bool WebSocketClient::send_binary(const void* data, size_t len) {
+    if (!connected_) return false;
+    std::lock_guard<ProfiledMutex> lock(queue_mutex_);
+    size_t batch_frames = batch_frames_.load(std::memory_order_relaxed);
+    if (batch_frames <= 1) {
+        if (batch_count_ > 0) {
+            flush_batch_locked();  // 刚从合并切回逐帧：先发出已攒的帧，保持顺序
+        }
+        return enqueue_locked(data, len, LWS_WRITE_BINARY, SendLane::Audio, false, BinaryFrameType::Audio);
+    }
+    if (len > 0xffff) {
+        WARN("binary frame of {} bytes too large to aggregate, dropped", len);
+        count_drop_locked(drops_oversize_, len);
+        return false;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (batch_count_ > 0 && now - batch_start_ >= aggregation_.max_hold) {
+        flush_batch_locked();  // 等待定时器还没来得及触发
+    }
+    if (batch_count_ == 0) {
+        batch_buf_.clear();
+        batch_start_ = now;
+        // 由服务线程按第一帧的时间设置最长等待定时器
+        batch_timer_wanted_ = true;
+        manager_->Wake();
+    }
+    size_t offset = batch_buf_.size();
+    batch_buf_.resize(offset + kBatchEntryHeaderSize + len);
+    WriteBatchEntryHeader(batch_buf_.data() + offset, static_cast<uint16_t>(len));
+    memcpy(batch_buf_.data() + offset + kBatchEntryHeaderSize, data, len);
+    batch_count_++;
+    if (batch_count_ >= batch_frames) {
+        flush_batch_locked();
+    }
+    return true;
+}
+
+void WebSocketClient::flush_batch_locked() {
+    if (batch_count_ == 0) {
+        return;
+    }
+    if (batch_count_ == 1) {
+        // 只攒到一帧（到期或切换）：按普通音频帧发出，省去条目头
+        enqueue_locked(batch_buf_.data() + kBatchEntryHeaderSize, batch_buf_.size() - kBatchEntryHeaderSize,
+                       LWS_WRITE_BINARY, SendLane::Audio, false, BinaryFrameType::Audio);
+    } else if (enqueue_locked(batch_buf_.data(), batch_buf_.size(), LWS_WRITE_BINARY, SendLane::Audio, false,
+                              BinaryFrameType::AudioBatch)) {
+        batches_sent_.fetch_add(1, std::memory_order_relaxed);
+    }
+    batch_count_ = 0;
+    batch_buf_.clear();  // 保留容量供下一批复用
+}
+
+void WebSocketClient::on_established(struct lws* wsi) {
+    std::string name = InterfaceForSocket(lws_get_socket_fd(wsi));
+    bool cellular = IsCellularInterface(name);
+    {
+        std::lock_guard<ProfiledMutex> lock(queue_mutex_);
+        link_interface_ = name;
+    }
+    cellular_link_ = cellular;
+    INFO("WebSocket egress interface: {}{}", name.empty() ? "unknown" : name, cellular ? " (cellular)" : "");
+    awaiting_pong_us_ = 0;
+    if (ping_interval_.count() > 0) {
+        schedule_timer(ping_timer_, ping_interval_);
+    }
+    apply_rx_flow();  // 断线前暂停了读取时，新连接同样暂停
+    update_batch_frames();
+}
+
+void WebSocketClient::on_pong(const void* data, size_t len) {
+    awaiting_pong_us_ = 0;  // 任何 pong 都说明对端仍然在线
+    uint64_t sent_us = 0;
+    if (len != sizeof(sent_us)) {
+        return;  // 不是本端 ping 的应答（对端主动发送的 pong）
+    }
+    if (rx_paused_ || rx_pauses_.load(std::memory_order_relaxed) != ping_pause_mark_) {
+        return;  // ping 发出后暂停过读取，往返时间包含了暂停时长
+    }
+    memcpy(&sent_us, data, sizeof(sent_us));
+    uint64_t now_us = SteadyNowUs();
+    if (now_us < sent_us) {
+        return;
+    }
+    uint64_t rtt = now_us - sent_us;
+    uint64_t srtt = srtt_us_.load(std::memory_order_relaxed);
+    uint64_t rttvar = rttvar_us_.load(std::memory_order_relaxed);
+    // 与 TCP（RFC 6298）相同：RTTVAR 按 1/4、SRTT 按 1/8 指数平滑，RTTVAR 用更新前的 SRTT
+    if (srtt == 0) {
+        srtt = rtt;
+        rttvar = rtt / 2;
+    } else {
+        int64_t deviation = std::llabs(static_cast<int64_t>(srtt) - static_cast<int64_t>(rtt));
+        rttvar = static_cast<uint64_t>(static_cast<int64_t>(rttvar) + (deviation - static_cast<int64_t>(rttvar)) / 4);
+        srtt = static_cast<uint64_t>(static_cast<int64_t>(srtt) +
+                                     (static_cast<int64_t>(rtt) - static_cast<int64_t>(srtt)) / 8);
+    }
+    last_rtt_us_ = rtt;
+    srtt_us_ = srtt;
+    rttvar_us_ = rttvar;
+    update_batch_frames();
+}
+
+void WebSocketClient::update_batch_frames() {
+    size_t frames = 1;
+    if (binary_version_ > 1) {
+        switch (aggregation_.mode) {
+            case AggregationMode::Off:
+                break;
+            case AggregationMode::Fixed:
+                frames = aggregation_.max_frames;
+                break;
+            case AggregationMode::Auto:
+                if (cellular_link_ || RttMs() >= aggregation_.auto_rtt_ms) {
+                    frames = aggregation_.max_frames;
+                }
+                break;
+        }
+    }
+    size_t previous = batch_frames_.exchange(frames);
+    if (previous != frames) {
+        INFO("uplink aggregation: {} frame(s) per message (rtt {:.1f} ms{})", frames, RttMs(),
+             cellular_link_ ? ", cellular" : "");
+    }
+}
+
+void WebSocketClient::SetMaxSendQueue(size_t max_frames) {
+    for (size_t lane = 0; lane < kSendLaneCount; ++lane) {
+        SetMaxSendQueue(static_cast<SendLane>(lane), max_frames);
+    }
+}
+
+void WebSocketClient::SetMaxSendQueue(SendLane lane, size_t max_frames) {
+    // 音频槽位预留 LWS_PRE + 典型 Opus 帧的空间；文本通道平时只用到少数槽位，按消息大小在第一次使用时分配。
+    // 更大的消息会让该槽位增长一次后一直复用
+    constexpr size_t kAudioSlotReserve = 1536;
+    std::lock_guard<ProfiledMutex> lock(queue_mutex_);
+    if (running_) {
+        WARN("SetMaxSendQueue must be called before start(), ignored");
+        return;
+    }
+    allocate_send_ring(lane_locked(lane), max_frames, lane == SendLane::Audio ? kAudioSlotReserve : 0);
+}
+
+void WebSocketClient::SetSendBackpressure(const SendBackpressure& policy) {
+    std::lock_guard<ProfiledMutex> lock(queue_mutex_);
+    if (running_) {
+        WARN("SetSendBackpressure must be called before start(), ignored");
+        return;
+    }
+    backpressure_ = policy;
+    backpressure_.max_audio_age = std::max(policy.max_audio_age, std::chrono::milliseconds(0));
+}
+
+SendDropStats WebSocketClient::GetSendDropStats() const {
+    SendDropStats stats;
+    stats.queue_full = drops_queue_full_.load(std::memory_order_relaxed);
+    stats.expired = drops_expired_.load(std::memory_order_relaxed);
+    stats.over_budget = drops_over_budget_.load(std::memory_order_relaxed);
+    stats.oversize = drops_oversize_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+WebSocketDeflateStats WebSocketClient::GetDeflateStats() const {
+    WebSocketDeflateStats stats;
+    stats.negotiated = deflate_active_.load(std::memory_order_relaxed);
+    stats.compressed = deflate_compressed_.load(std::memory_order_relaxed);
+    stats.skipped = deflate_skipped_.load(std::memory_order_relaxed);
+    stats.bytes_in = deflate_in_bytes_.load(std::memory_order_relaxed);
+    stats.bytes_out = deflate_out_bytes_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+SendLatencyStats WebSocketClient::GetSendLatencyStats() const {
+    SendLatencyStats stats;
+    stats.frames = sent_frames_;
+    if (stats.frames > 0) {
+        stats.avg_us = send_latency_total_ns_ / 1000.0 / stats.frames;
+    }
+    stats.max_us = send_latency_max_ns_ / 1000.0;
+    stats.last_us = send_latency_last_ns_ / 1000.0;
+    return stats;
+}
+
+size_t WebSocketClient::SendQueueDepth() const {
+    // pending_ 在持锁修改各通道帧数时同步更新，读取无需加锁（指标采样不与发送路径争锁）
+    return pending_.load(std::memory_order_relaxed);
+}
+
+size_t WebSocketClient::SendQueueDepth(SendLane lane) const {
+    return lanes_[static_cast<size_t>(lane)].depth.load(std::memory_order_relaxed);
+}
+
+size_t WebSocketClient::SendQueueHighWater(SendLane lane) const {
+    return lanes_[static_cast<size_t>(lane)].high_water.load(std::memory_order_relaxed);
 }
 
 void WebSocketClient::SetOnOpenCallback(std::function<std::string(void)> cb) {
-    on_open_cb_ = cb;
+    on_open_cb_ = [cb]() {
+        std::vector<std::string> messages;
+        std::string message = cb();
+        if (!message.empty()) {
+            messages.push_back(std::move(message));
+        }
+        return messages;
+    };
+}
+
+void WebSocketClient::SetOnOpenMessagesCallback(std::function<std::vector<std::string>(void)> cb) {
+    on_open_cb_ = std::move(cb);
 }
 
 void WebSocketClient::SetOnCloseCallback(std::function<void(void)> cb) {
@@ -161,12 +1170,120 @@ void WebSocketClient::SetOnMessageCallback(std::function<std::string(const std::
     on_message_cb_ = cb;
 }
 
+void WebSocketClient::SetOnMessageViewCallback(std::function<void(std::string_view, bool)> cb) {
+    on_message_view_cb_ = cb;
+}
+
+void WebSocketClient::deliver_message(std::string_view message, bool is_binary) {
+    activity_.fetch_add(1, std::memory_order_relaxed);  // 空闲断开只看有没有收发，不区分方向
+    if (frame_trace_) {
+        frame_trace_->Record(is_binary ? TraceStage::ReceiveBinary : TraceStage::ReceiveText, message.size());
+    }
+    if (is_binary && binary_version_ > 1) {
+        BinaryFrameHeader header;
+        std::string_view payload;
+        if (!ParseBinaryFrame(message.data(), message.size(), binary_version_, &header, &payload)) {
+            if (rx_malformed_.fetch_add(1, std::memory_order_relaxed) == 0) {
+                WARN("malformed v{} binary frame ({} bytes), dropped", binary_version_, message.size());
+            }
+            return;
+        }
+        rx_frames_.fetch_add(1, std::memory_order_relaxed);
+        track_sequence(header.sequence);
+        message = payload;
+        if (header.type == BinaryFrameType::Json) {
+            is_binary = false;
+        } else if (header.type == BinaryFrameType::AudioBatch) {
+            AudioBatchReader reader(payload);
+            std::string_view frame;
+            while (reader.Next(&frame)) {
+                dispatch_message(frame, true);
+            }
+            if (reader.Error() && rx_malformed_.fetch_add(1, std::memory_order_relaxed) == 0) {
+                WARN("truncated audio batch ({} bytes), rest dropped", payload.size());
+            }
+            return;
+        }
+    }
+    dispatch_message(message, is_binary);
+}
+
+void WebSocketClient::dispatch_message(std::string_view message, bool is_binary) {
+    if (on_message_view_cb_) {
+        on_message_view_cb_(message, is_binary);
+    } else if (on_message_cb_) {
+        std::string response = on_message_cb_(std::string(message), is_binary);
+        if (!response.empty()) {
+            send_text(response);
+        }
+    }
+}
+
+void WebSocketClient::track_sequence(uint32_t sequence) {
+    if (!rx_sequence_active_) {
+        // 对端不填序号时恒为 0，不做统计
+        if (sequence != 0) {
+            rx_sequence_active_ = true;
+            rx_last_sequence_ = sequence;
+            rx_last_seen_.store(sequence, std::memory_order_relaxed);
+        }
+        return;
+    }
+    int32_t delta = SequenceDelta(rx_last_sequence_, sequence, binary_version_ == 3 ? 8 : 32);
+    if (delta > 0) {
+        rx_lost_.fetch_add(static_cast<uint64_t>(delta - 1), std::memory_order_relaxed);
+        rx_last_sequence_ = sequence;
+        rx_last_seen_.store(sequence, std::memory_order_relaxed);
+    } else {
+        rx_reordered_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// lws 会把大消息按 rx_buffer_size 拆成多次回调，WebSocket 层也可能分片发送；
+// 单块完整消息直接在 lws 缓冲区上回调（零拷贝），否则追加到复用的重组缓冲区，收齐后回调
+void WebSocketClient::on_receive(struct lws* wsi, const char* data, size_t len) {
+    bool message_done = lws_is_final_fragment(wsi) && lws_remaining_packet_payload(wsi) == 0;
+
+    if (rx_buffer_.empty()) {
+        rx_binary_ = (lws_frame_is_binary(wsi) != 0);
+        if (message_done) {
+            deliver_message(std::string_view(data, len), rx_binary_);
+            return;
+        }
+    }
+
+    rx_buffer_.append(data, len);
+    if (message_done) {
+        deliver_message(std::string_view(rx_buffer_), rx_binary_);
+        rx_buffer_.clear();  // 保留容量供下一条消息复用
+    }
+}
+
 int WebSocketClient::callback_websocket(struct lws *wsi, enum lws_callback_reasons reason,
                                        void *user, void *in, size_t len) {
-    WebSocketClient* client = static_cast<WebSocketClient*>(lws_context_user(lws_get_context(wsi)));
-    if (!client && reason != LWS_CALLBACK_PROTOCOL_INIT) {
-        client = static_cast<WebSocketClient*>(lws_wsi_user(wsi));
+    switch (reason) {
+        case LWS_CALLBACK_EVENT_WAIT_CANCELLED:
+        case LWS_CALLBACK_ADD_POLL_FD:
+        case LWS_CALLBACK_DEL_POLL_FD:
+        case LWS_CALLBACK_CHANGE_MODE_POLL_FD: {
+            // 上下文级回调：lws_cancel_service 唤醒由管理器转发给所有挂载的 client；
+            // 外部 poll 回调在管理器挂在 Reactor 上时把 fd 注册到 reactor
+            WebSocketManager* manager = static_cast<WebSocketManager*>(lws_context_user(lws_get_context(wsi)));
+            if (manager) {
+                if (reason == LWS_CALLBACK_EVENT_WAIT_CANCELLED) {
+                    manager->OnWake();
+                } else {
+                    manager->OnPollFd(reason, static_cast<const struct lws_pollargs*>(in));
+                }
+            }
+            return 0;
+        }
+        default:
+            break;
     }
+
+    // 连接级回调按 lws_wsi_user 分发：同一上下文上的每个连接对应各自的 client
+    WebSocketClient* client = static_cast<WebSocketClient*>(lws_wsi_user(wsi));
     
     switch (reason) {
         case LWS_CALLBACK_CLIENT_APPEND_HANDSHAKE_HEADER:
@@ -176,7 +1293,7 @@ int WebSocketClient::callback_websocket(struct lws *wsi, enum lws_callback_reaso
                 unsigned char *end = (*p) + len;
                 
                 // 添加线程安全保护
-                std::lock_guard<std::mutex> lock(client->queue_mutex_);
+                std::lock_guard<ProfiledMutex> lock(client->queue_mutex_);
                 
                 for (const auto& header : client->ws_headers_) {
                     // 验证header名称和值的合法性
@@ -209,41 +1326,128 @@ int WebSocketClient::callback_websocket(struct lws *wsi, enum lws_callback_reaso
             
         case LWS_CALLBACK_CLIENT_ESTABLISHED:
             INFO("WebSocket connection established");
+            if (client) {
+                client->connected_ = true;
+                client->connections_.fetch_add(1, std::memory_order_relaxed);
+                client->reconnect_attempt_ = 0;
+                // 记下实际连通的地址，下次重连直接使用
+                char peer[64];
+                if (lws_get_peer_simple(wsi, peer, sizeof(peer)) != nullptr && peer[0] != '\0') {
+                    client->resolved_address_ = peer;
+                }
+#if !defined(LWS_WITHOUT_EXTENSIONS)
+                if (client->deflate_active_) {
+                    // 压缩上下文在第一条压缩消息时才初始化，此时设置的级别对整个连接生效
+                    const WebSocketDeflateConfig& deflate = client->manager_->deflate_;
+                    if (deflate.level > 0) {
+                        lws_set_extension_option(wsi, "permessage-deflate", "compression_level",
+                                                 std::to_string(deflate.level).c_str());
+                    }
+                    if (deflate.mem_level > 0) {
+                        lws_set_extension_option(wsi, "permessage-deflate", "mem_level",
+                                                 std::to_string(deflate.mem_level).c_str());
+                    }
+                    INFO("permessage-deflate negotiated, compressing text messages of {}+ bytes",
+                         deflate.min_text_bytes);
+                }
+#endif
+#if defined(LWS_WITH_TLS_SESSIONS)
+                if (client->use_ssl_ && lws_tls_session_is_reused(wsi)) {
+                    client->resumed_sessions_.fetch_add(1, std::memory_order_relaxed);
+                    INFO("TLS session resumed");
+                }
+#endif
+                if (client->resume_timing_) {
+                    client->resume_timing_ = false;
+                    auto elapsed = std::chrono::steady_clock::now() - client->resume_start_;
+                    client->last_resume_us_ =
+                        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+                    INFO("WebSocket resumed from idle in {:.1f}ms", client->LastResumeMs());
+                }
+                client->on_established(wsi);
+            }
             if (client && client->on_open_cb_) {
-                std::string response = client->on_open_cb_();
-                if (!response.empty()) {
-                    client->send_text(response);
+                std::vector<std::string> messages = client->on_open_cb_();
+                for (const std::string& message : messages) {
+                    INFO(">> {}", message);
                 }
+                // 断线前积压的帧排在后面：服务器先收到本次连接的握手消息；逐条插到控制通道队头，所以倒序入队
+                for (auto it = messages.rbegin(); it != messages.rend(); ++it) {
+                    if (!it->empty()) {
+                        client->enqueue(it->data(), it->size(), LWS_WRITE_TEXT, SendLane::Control, true);
+                    }
+                }
+            }
+            // 连接建立前已入队的文本消息
+            if (client && client->pending_ > 0) {
+                lws_callback_on_writable(wsi);
             }
             break;
             
         case LWS_CALLBACK_CLIENT_RECEIVE:
-            if (client && client->on_message_cb_) {
-                std::string message(static_cast<char*>(in), len);
-                bool is_binary = (lws_frame_is_binary(wsi) != 0);
-                std::string response = client->on_message_cb_(message, is_binary);
-                if (!response.empty()) {
-                    client->send_text(response);
-                }
+            if (client) {
+                client->awaiting_pong_us_ = 0;  // 收到数据即说明连接仍然可用
+            }
+            if (client && (client->on_message_view_cb_ || client->on_message_cb_)) {
+                client->on_receive(wsi, static_cast<const char*>(in), len);
             }
             break;
             
+        case LWS_CALLBACK_CLIENT_RECEIVE_PONG:
+            if (client) {
+                client->on_pong(in, len);
+            }
+            break;
+
         case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
             ERROR("WebSocket connection error");
+            if (client) {
+                client->connect_errors_.fetch_add(1, std::memory_order_relaxed);
+                client->connected_ = false;
+                client->wsi_ = nullptr;
+                if (client->connecting_resolved_) {
+                    // 缓存的地址可能已失效（服务器迁移、网络切换），下一次按主机名重新解析
+                    client->resolved_address_.clear();
+                }
+                if (client->endpoints_ && client->reconnect_.enabled) {
+                    client->switch_endpoint();  // 重连时换一个候选服务器
+                }
+                client->schedule_reconnect();
+            }
             if (client && client->on_fail_cb_) {
                 client->on_fail_cb_();
             }
+            if (client && client->closing_) {
+                client->finish_close();
+            }
             break;
             
         case LWS_CALLBACK_CLOSED:
             INFO("WebSocket connection closed");
+            if (client) {
+                client->disconnects_.fetch_add(1, std::memory_order_relaxed);
+                client->connected_ = false;
+                client->wsi_ = nullptr;
+                client->rx_buffer_.clear();
+                client->rx_sequence_active_ = false;
+                client->awaiting_pong_us_ = 0;
+                client->cancel_timer(client->pong_timer_);
+                client->apply_rx_flow(true);
+                client->schedule_reconnect();
+            }
             if (client && client->on_close_cb_) {
                 client->on_close_cb_();
             }
+            if (client && client->closing_) {
+                client->finish_close();
+            }
             break;
             
         case LWS_CALLBACK_CLIENT_WRITEABLE:
-            // 可以发送数据
+            // 可以发送数据：所有 lws_write 都只在这里、在服务线程上执行
+            if (client) {
+                return client->on_writeable(wsi);
+            }
             break;
             
         default: